@@ -203,6 +203,37 @@ Options:
       endforeach()
       set(map "${map}};\n")
       file(APPEND ${target} "${map}")
+
+      # the aliases of each locale so a language is found without parsing every locale
+      set(names "")
+      foreach(file ${json_files})
+        get_filename_component(locale "${file}" NAME_WE)
+        list(APPEND names ${locale})
+      endforeach()
+      set(aliases "\nconst std::unordered_map<std::string, std::string> locales_aliases = {\n")
+      foreach(file ${json_files})
+        get_filename_component(locale "${file}" NAME_WE)
+        file(READ ${file} content)
+        string(FIND "${content}" "\"aliases\"" start)
+        if(NOT start EQUAL -1)
+          string(SUBSTRING "${content}" ${start} -1 content)
+          string(FIND "${content}" "]" end)
+          string(SUBSTRING "${content}" 0 ${end} content)
+          string(REGEX MATCHALL "\"[^\"]+\"" quoted "${content}")
+          list(REMOVE_AT quoted 0)
+          foreach(alias ${quoted})
+            string(REPLACE "\"" "" alias ${alias})
+            list(FIND names ${alias} duplicate)
+            if(NOT duplicate EQUAL -1)
+              message(FATAL_ERROR "Alias '${alias}' in json locale '${locale}' has a duplicate")
+            endif()
+            list(APPEND names ${alias})
+            set(aliases "${aliases}    {\"${alias}\", \"${locale}\"},\n")
+          endforeach()
+        endif()
+      endforeach()
+      set(aliases "${aliases}};\n")
+      file(APPEND ${target} "${aliases}")
     endif()
   endif()
 endif()
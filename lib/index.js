@@ -32,8 +32,11 @@ module.exports = function(configStr, options = {}) {
         destroy: deleteWorker 
     };
 
+    // every actor runs its requests on the libuv thread pool and the actors share their tiles, so
+    // by default there are as many actors as there are threads to run them
+    const threads = parseInt(process.env.UV_THREADPOOL_SIZE, 10) || 4;
     const opts = {
-        max: options.maxWorkers || 1,
+        max: options.maxWorkers || threads,
         min: options.minWorkers || 1
     };
     
@@ -48,35 +51,39 @@ module.exports = function(configStr, options = {}) {
                 if (!request || !cb) throw new Error('method must be called with string and callback');
 
                 actorPool.acquire().then(function(actor) {
-                    actorPool.on('factoryCreateError', function(err) {
-                        return cb(err);
-                    });
-
                     actor[methodName](request, function(err, result) {
                         actorPool.release(actor);
                         return cb(err, result);
                     });
-                });
+                }, cb);
             }
         }
 
-        this.route = actorMethodFactory('route'); 
-
-        this.locate = actorMethodFactory('locate');
-
-        this.height = actorMethodFactory('height');
-
-        this.isochrone = actorMethodFactory('isochrone');
+        function actorPromiseFactory(methodName) {
+            return function(request) {
+                if (!request) return Promise.reject(new Error('method must be called with string'));
 
-        this.matrix = actorMethodFactory('matrix');
-
-        this.optimizedRoute = actorMethodFactory('optimizedRoute');
+                return actorPool.acquire().then(function(actor) {
+                    return new Promise(function(resolve, reject) {
+                        actor[methodName](request, function(err, result) {
+                            actorPool.release(actor);
+                            return err ? reject(err) : resolve(result);
+                        });
+                    });
+                });
+            }
+        }
 
-        this.traceAttributes = actorMethodFactory('traceAttributes');
+        const methods = ['route', 'locate', 'height', 'isochrone', 'matrix', 'optimizedRoute',
+            'traceAttributes', 'traceRoute', 'transitAvailable', 'expansion'];
 
-        this.traceRoute = actorMethodFactory('traceRoute');
+        // the same methods returning promises instead of taking callbacks
+        this.promises = {};
 
-        this.transitAvailable = actorMethodFactory('transitAvailable');
+        for (const method of methods) {
+            this[method] = actorMethodFactory(method);
+            this.promises[method] = actorPromiseFactory(method);
+        }
     };
 }
 
@@ -0,0 +1,119 @@
+#include "baldr/cellpartition.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Identifies cell partition files and their layout version
+constexpr uint32_t kPartitionMagic = 0x31504356; // "VCP1"
+
+template <typename T> void write_vector(std::ofstream& out, const std::vector<T>& v) {
+  uint64_t count = v.size();
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char*>(v.data()), count * sizeof(T));
+}
+
+template <typename T> bool read_vector(std::ifstream& in, std::vector<T>& v) {
+  uint64_t count = 0;
+  if (!in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+    return false;
+  }
+  v.resize(count);
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(v.data()), count * sizeof(T)));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::string CellPartition::file_name(const std::string& tile_dir) {
+  return tile_dir + "/crp/partition.bin";
+}
+
+std::shared_ptr<const CellPartition> CellPartition::load(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    return nullptr;
+  }
+
+  uint32_t magic = 0, levels = 0;
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char*>(&levels), sizeof(levels));
+  auto partition = std::make_shared<CellPartition>();
+  bool valid = magic == kPartitionMagic && in && read_vector(in, partition->nodes);
+  partition->cells.resize(valid ? levels : 0);
+  for (auto& cells : partition->cells) {
+    valid = valid && read_vector(in, cells) && cells.size() == partition->nodes.size();
+  }
+  valid = valid && read_vector(in, partition->edges);
+  for (const auto& edge : partition->edges) {
+    valid = valid && edge.from < partition->nodes.size() && edge.to < partition->nodes.size();
+  }
+  if (!valid) {
+    LOG_ERROR("Invalid cell partition file: " + file);
+    return nullptr;
+  }
+  partition->Finish();
+  return partition;
+}
+
+void CellPartition::write(const std::string& file) const {
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + file + " for writing");
+  }
+  uint32_t count = levels();
+  out.write(reinterpret_cast<const char*>(&kPartitionMagic), sizeof(kPartitionMagic));
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  write_vector(out, nodes);
+  for (const auto& level : cells) {
+    write_vector(out, level);
+  }
+  write_vector(out, edges);
+}
+
+uint32_t CellPartition::node_index(const GraphId& node) const {
+  auto itr = std::lower_bound(nodes.begin(), nodes.end(), node.value);
+  return (itr == nodes.end() || *itr != node.value) ? kInvalidCellIndex
+                                                    : static_cast<uint32_t>(itr - nodes.begin());
+}
+
+void CellPartition::Finish() {
+  // Index the edges by their start node
+  std::stable_sort(edges.begin(), edges.end(),
+                   [](const PartitionEdge& a, const PartitionEdge& b) { return a.from < b.from; });
+  offsets.assign(nodes.size() + 1, 0);
+  for (const auto& edge : edges) {
+    ++offsets[edge.from + 1];
+  }
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+
+  // Both ends of an edge between cells are boundary nodes of their cells
+  boundaries.assign(levels(), {});
+  boundary_index.assign(levels(), std::vector<uint32_t>(nodes.size(), kInvalidCellIndex));
+  for (uint32_t level = 0; level < levels(); ++level) {
+    const auto& cell = cells[level];
+    auto& index = boundary_index[level];
+    for (const auto& edge : edges) {
+      if (cell[edge.from] == cell[edge.to]) {
+        continue;
+      }
+      for (auto node : {edge.from, edge.to}) {
+        if (index[node] == kInvalidCellIndex) {
+          auto& boundary = boundaries[level][cell[node]];
+          index[node] = boundary.size();
+          boundary.push_back(node);
+        }
+      }
+    }
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,90 @@
+#include "baldr/chgraph.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Identifies contraction hierarchy files and their layout version
+constexpr uint32_t kCHMagic = 0x32484356; // "VCH2"
+
+template <typename T> void write_vector(std::ofstream& out, const std::vector<T>& v) {
+  uint64_t count = v.size();
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char*>(v.data()), count * sizeof(T));
+}
+
+template <typename T> bool read_vector(std::ifstream& in, std::vector<T>& v) {
+  uint64_t count = 0;
+  if (!in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+    return false;
+  }
+  v.resize(count);
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(v.data()), count * sizeof(T)));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::string CHGraph::file_name(const std::string& tile_dir, const std::string& costing) {
+  return tile_dir + "/ch/" + costing + ".ch";
+}
+
+std::shared_ptr<const CHGraph> CHGraph::load(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    return nullptr;
+  }
+
+  uint32_t magic = 0;
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  auto graph = std::make_shared<CHGraph>();
+  std::vector<char> options;
+  if (magic != kCHMagic || !read_vector(in, options) || !read_vector(in, graph->nodes) ||
+      !read_vector(in, graph->ranks) || !read_vector(in, graph->edges) ||
+      !read_vector(in, graph->up_offsets) || !read_vector(in, graph->up_edges) ||
+      !read_vector(in, graph->down_offsets) || !read_vector(in, graph->down_edges)) {
+    LOG_ERROR("Invalid contraction hierarchy file: " + file);
+    return nullptr;
+  }
+  graph->costing_options.assign(options.begin(), options.end());
+
+  // Sanity check the layout so queries can index without checking
+  size_t n = graph->nodes.size();
+  if (graph->ranks.size() != n || graph->up_offsets.size() != n + 1 ||
+      graph->down_offsets.size() != n + 1 || graph->up_offsets.back() != graph->up_edges.size() ||
+      graph->down_offsets.back() != graph->down_edges.size()) {
+    LOG_ERROR("Inconsistent contraction hierarchy file: " + file);
+    return nullptr;
+  }
+  return graph;
+}
+
+void CHGraph::write(const std::string& file) const {
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + file + " for writing");
+  }
+  out.write(reinterpret_cast<const char*>(&kCHMagic), sizeof(kCHMagic));
+  write_vector(out, std::vector<char>(costing_options.begin(), costing_options.end()));
+  write_vector(out, nodes);
+  write_vector(out, ranks);
+  write_vector(out, edges);
+  write_vector(out, up_offsets);
+  write_vector(out, up_edges);
+  write_vector(out, down_offsets);
+  write_vector(out, down_edges);
+}
+
+uint32_t CHGraph::node_index(const GraphId& node) const {
+  auto itr = std::lower_bound(nodes.begin(), nodes.end(), node.value);
+  return (itr == nodes.end() || *itr != node.value) ? kInvalidCHIndex
+                                                    : static_cast<uint32_t>(itr - nodes.begin());
+}
+
+} // namespace baldr
+} // namespace valhalla
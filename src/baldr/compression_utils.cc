@@ -1,5 +1,113 @@
 #include "baldr/compression_utils.h"
 
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// zlib counts the bytes it is handed in an unsigned int so larger buffers go in pieces
+constexpr size_t kMaxChunk = std::numeric_limits<uInt>::max();
+
+// Resetting a stream keeps the buffers of the last use, which the callers expect to start empty
+void clear_buffers(z_stream& stream) {
+  stream.next_in = nullptr;
+  stream.avail_in = 0;
+  stream.next_out = nullptr;
+  stream.avail_out = 0;
+}
+
+// Setting up a stream allocates its window and tables, which costs as much as inflating a small
+// tile, so each thread keeps one of each and resets it between buffers instead
+struct inflate_context_t {
+  z_stream stream{};
+  bool ready = false;
+
+  ~inflate_context_t() {
+    if (ready)
+      inflateEnd(&stream);
+  }
+
+  z_stream* get() {
+    if (ready && inflateReset(&stream) != Z_OK) {
+      inflateEnd(&stream);
+      ready = false;
+    }
+    if (!ready) {
+      // MAX_WBITS is the max size of the window and should be 15, this will work with headerless
+      // defalted streams to work with gzip add 16, to work with both gzip and libz add 32
+      stream = z_stream{};
+      ready = inflateInit2(&stream, MAX_WBITS + 32) == Z_OK;
+    }
+    clear_buffers(stream);
+    return ready ? &stream : nullptr;
+  }
+};
+
+struct deflate_context_t {
+  z_stream stream{};
+  bool ready = false;
+  int level = 0;
+  bool gzip = false;
+
+  ~deflate_context_t() {
+    if (ready)
+      deflateEnd(&stream);
+  }
+
+  z_stream* get(int level, bool gzip) {
+    // the header is chosen when the stream is set up so a different one needs a new stream
+    if (ready && (level != this->level || gzip != this->gzip || deflateReset(&stream) != Z_OK)) {
+      deflateEnd(&stream);
+      ready = false;
+    }
+    if (!ready) {
+      // add 16 to window bits for gzip header instead of zlib header, 9 is max speed
+      stream = z_stream{};
+      ready = deflateInit2(&stream, level, Z_DEFLATED, gzip ? 15 + 16 : 15, 9,
+                           Z_DEFAULT_STRATEGY) == Z_OK;
+      this->level = level;
+      this->gzip = gzip;
+    }
+    clear_buffers(stream);
+    return ready ? &stream : nullptr;
+  }
+};
+
+inflate_context_t& inflate_context() {
+  thread_local inflate_context_t context;
+  return context;
+}
+
+deflate_context_t& deflate_context() {
+  thread_local deflate_context_t context;
+  return context;
+}
+
+// Inflates the whole buffer, more_out is called whenever the stream runs out of room and leaves
+// it without any when there is no more
+template <typename more_out_t>
+bool inflate_buffer(z_stream& stream, const char* src, size_t src_size, more_out_t more_out) {
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(src));
+  size_t left = src_size;
+  while (true) {
+    if (stream.avail_in == 0 && left > 0) {
+      stream.avail_in = static_cast<uInt>(std::min(left, kMaxChunk));
+      left -= stream.avail_in;
+    }
+    if (stream.avail_out == 0)
+      more_out(stream);
+
+    // a stream that needs more input or room than there is stops making progress
+    int code = inflate(&stream, Z_NO_FLUSH);
+    if (code == Z_STREAM_END)
+      return true;
+    if (code != Z_OK)
+      return false;
+  }
+}
+
+} // namespace
+
 namespace valhalla {
 namespace baldr {
 
@@ -14,11 +122,11 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
              const std::function<void(z_stream&)>& dst_func,
              int level,
              bool gzip) {
-  // initialize the stream
-  // add 16 to window bits for gzip header instead of zlib header, 9 is max speed
-  z_stream stream{};
-  if (deflateInit2(&stream, level, Z_DEFLATED, gzip ? 15 + 16 : 15, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+  // get the stream of this thread
+  z_stream* stream_ptr = deflate_context().get(level, gzip);
+  if (!stream_ptr)
     return false;
+  z_stream& stream = *stream_ptr;
 
   int flush = Z_NO_FLUSH;
   int code = Z_OK;
@@ -28,7 +136,6 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
       if (stream.avail_in == 0)
         flush = src_func(stream);
     } catch (...) {
-      deflateEnd(&stream);
       return false;
     }
 
@@ -38,14 +145,12 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
         if (stream.avail_out == 0)
           dst_func(stream);
       } catch (...) {
-        deflateEnd(&stream);
         return false;
       }
 
       // only one fatal error to worry about
       code = deflate(&stream, flush);
       if (code == Z_STREAM_ERROR) {
-        deflateEnd(&stream);
         return false;
       }
       // only stop when we've got nothing more to put in the dst buffer
@@ -55,8 +160,6 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
 
   // hand back the final buffer
   dst_func(stream);
-  // if we got here we expected to finish but weren't thats not good
-  deflateEnd(&stream);
   return true;
 }
 
@@ -68,12 +171,11 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
 bool inflate(const std::function<void(z_stream&)>& src_func,
              const std::function<int(z_stream&)>& dst_func) {
 
-  // initialize the stream
-  // MAX_WBITS is the max size of the window and should be 15, this will work with headerless
-  // defalted streams to work with gzip add 16, to work with both gzip and libz add 32
-  z_stream stream{};
-  if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK)
+  // get the stream of this thread
+  z_stream* stream_ptr = inflate_context().get();
+  if (!stream_ptr)
     return false;
+  z_stream& stream = *stream_ptr;
 
   int flush = Z_NO_FLUSH;
   int code = Z_OK;
@@ -85,7 +187,6 @@ bool inflate(const std::function<void(z_stream&)>& src_func,
       if (stream.avail_in == 0)
         throw;
     } catch (...) {
-      inflateEnd(&stream);
       return false;
     }
 
@@ -95,7 +196,6 @@ bool inflate(const std::function<void(z_stream&)>& src_func,
         if (stream.avail_out == 0)
           flush = dst_func(stream);
       } catch (...) {
-        inflateEnd(&stream);
         return false;
       }
 
@@ -106,7 +206,6 @@ bool inflate(const std::function<void(z_stream&)>& src_func,
         case Z_NEED_DICT:
         case Z_DATA_ERROR:
         case Z_MEM_ERROR:
-          inflateEnd(&stream);
           return false;
       }
       // only stop when we've got nothing more to put in the dst buffer
@@ -116,10 +215,86 @@ bool inflate(const std::function<void(z_stream&)>& src_func,
 
   // hand back the final buffer
   dst_func(stream);
-  // if we got here we expected to finish but weren't thats not good
-  inflateEnd(&stream);
   return true;
 }
 
+bool deflate(const char* src, size_t src_size, std::string& dst, int level, bool gzip) {
+  z_stream* stream = deflate_context().get(level, gzip);
+  if (!stream)
+    return false;
+
+  // the bound is enough to deflate it all at once, unless it's a huge buffer fed in pieces
+  dst.resize(deflateBound(stream, src_size));
+  stream->next_out = reinterpret_cast<Bytef*>(&dst[0]);
+  stream->avail_out = static_cast<uInt>(std::min(dst.size(), kMaxChunk));
+  stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(src));
+  size_t left = src_size;
+  int code = Z_OK;
+  do {
+    if (stream->avail_in == 0 && left > 0) {
+      stream->avail_in = static_cast<uInt>(std::min(left, kMaxChunk));
+      left -= stream->avail_in;
+    }
+    if (stream->avail_out == 0) {
+      size_t used = stream->total_out;
+      dst.resize(std::max(dst.size(), used + std::max(used / 2, size_t(1024))));
+      stream->next_out = reinterpret_cast<Bytef*>(&dst[used]);
+      stream->avail_out = static_cast<uInt>(std::min(dst.size() - used, kMaxChunk));
+    }
+    code = deflate(stream, left == 0 ? Z_FINISH : Z_NO_FLUSH);
+    if (code == Z_STREAM_ERROR)
+      return false;
+  } while (code != Z_STREAM_END);
+  dst.resize(stream->total_out);
+  return true;
+}
+
+bool inflate(const char* src, size_t src_size, char* dst, size_t& dst_size) {
+  z_stream* stream = inflate_context().get();
+  if (!stream)
+    return false;
+
+  char* end = dst + dst_size;
+  stream->next_out = reinterpret_cast<Bytef*>(dst);
+  stream->avail_out = 0;
+  bool inflated = inflate_buffer(*stream, src, src_size, [end](z_stream& s) {
+    size_t room = end - reinterpret_cast<char*>(s.next_out);
+    s.avail_out = static_cast<uInt>(std::min(room, kMaxChunk));
+  });
+  dst_size = stream->total_out;
+  return inflated;
+}
+
+bool inflate(const char* src, size_t src_size, std::vector<char>& dst) {
+  z_stream* stream = inflate_context().get();
+  if (!stream)
+    return false;
+
+  // with a gzip header the first buffer is big enough, one more byte lets the stream end in it
+  size_t hint = gzip_size(src, src_size);
+  dst.resize(hint > 0 ? hint + 1 : src_size * 4 + 1024);
+  stream->next_out = reinterpret_cast<Bytef*>(dst.data());
+  stream->avail_out = static_cast<uInt>(std::min(dst.size(), kMaxChunk));
+  bool inflated = inflate_buffer(*stream, src, src_size, [&dst](z_stream& s) {
+    size_t used = s.total_out;
+    dst.resize(std::max(dst.size(), used + std::max(used / 2, size_t(1024))));
+    s.next_out = reinterpret_cast<Bytef*>(dst.data() + used);
+    s.avail_out = static_cast<uInt>(std::min(dst.size() - used, kMaxChunk));
+  });
+  dst.resize(inflated ? stream->total_out : 0);
+  return inflated;
+}
+
+size_t gzip_size(const char* src, size_t src_size) {
+  // a gzip member is at least a 10 byte header and an 8 byte trailer ending in the size mod 2^32
+  const auto* bytes = reinterpret_cast<const unsigned char*>(src);
+  if (src_size < 18 || bytes[0] != 0x1f || bytes[1] != 0x8b) {
+    return 0;
+  }
+  const auto* isize = bytes + src_size - 4;
+  return static_cast<size_t>(isize[0]) | static_cast<size_t>(isize[1]) << 8 |
+         static_cast<size_t>(isize[2]) << 16 | static_cast<size_t>(isize[3]) << 24;
+}
+
 } // namespace baldr
 } // namespace valhalla
\ No newline at end of file
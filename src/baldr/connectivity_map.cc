@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <list>
+#include <mutex>
 #include <random>
 #include <sstream>
+#include <sys/stat.h>
 #include <unordered_set>
 
 #include "baldr/connectivity_map.h"
@@ -12,12 +17,28 @@
 #include "midgard/constants.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
+#include "midgard/sequence.h"
 #include "midgard/util.h"
 
 using namespace valhalla::baldr;
 using namespace valhalla::midgard;
 
 namespace {
+
+// the connectivity file is a header followed by a record per tile sorted by level and tile id
+constexpr char kConnectivityMagic[8] = {'V', 'C', 'O', 'N', 'N', '0', '0', '1'};
+
+struct connectivity_header_t {
+  char magic[8];
+  uint64_t count;
+};
+
+struct connectivity_record_t {
+  uint32_t level;
+  uint32_t tileid;
+  uint64_t color;
+};
+
 /*
    { "type": "FeatureCollection",
     "features": [
@@ -112,11 +133,18 @@ std::string to_feature_collection(const std::unordered_map<size_t, polygon_t>& b
 
 namespace valhalla {
 namespace baldr {
-connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt) {
+connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt, bool load) {
+  transit_level = TileHierarchy::levels().rbegin()->second.level + 1;
+
+  // If it was computed when the tiles were built we dont have to look at the tiles at all
+  auto file_name = pt.get<std::string>("connectivity_file", "");
+  if (load && !file_name.empty() && load_file(file_name)) {
+    return;
+  }
+
   // See what kind of tiles we are dealing with here by getting a graphreader
   GraphReader reader(pt);
   auto tiles = reader.GetTileSet();
-  transit_level = TileHierarchy::levels().rbegin()->second.level + 1;
 
   // Quick hack to remove connectivity between known unconnected regions
   // The only land connection from north to south america is through
@@ -152,6 +180,84 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt) {
   }
 }
 
+std::shared_ptr<const connectivity_map_t>
+connectivity_map_t::Global(const boost::property_tree::ptree& pt) {
+  // one per set of tiles, since a process can have workers for more than one
+  static std::mutex global_mutex;
+  static std::unordered_map<std::string, std::shared_ptr<const connectivity_map_t>> global_maps;
+  auto key = pt.get<std::string>("tile_extract", "") + '\n' + pt.get<std::string>("tile_dir", "") +
+             '\n' + pt.get<std::string>("connectivity_file", "");
+  std::lock_guard<std::mutex> lock(global_mutex);
+  auto& map = global_maps[key];
+  if (!map) {
+    map = std::make_shared<connectivity_map_t>(pt);
+  }
+  return map;
+}
+
+void connectivity_map_t::save(const std::string& file_name) const {
+  std::vector<connectivity_record_t> records;
+  for (const auto& level : colors) {
+    for (const auto& color : level.second) {
+      records.push_back({level.first, color.first, color.second});
+    }
+  }
+  std::sort(records.begin(), records.end(),
+            [](const connectivity_record_t& a, const connectivity_record_t& b) {
+              return a.level < b.level || (a.level == b.level && a.tileid < b.tileid);
+            });
+
+  connectivity_header_t header{};
+  std::memcpy(header.magic, kConnectivityMagic, sizeof(header.magic));
+  header.count = records.size();
+  std::ofstream file(file_name, std::ios::binary | std::ios::out | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(records.data()),
+             records.size() * sizeof(connectivity_record_t));
+  if (!file) {
+    throw std::runtime_error("Failed to write the connectivity file " + file_name);
+  }
+}
+
+bool connectivity_map_t::load_file(const std::string& file_name) {
+  struct stat s;
+  if (stat(file_name.c_str(), &s) || static_cast<size_t>(s.st_size) < sizeof(connectivity_header_t)) {
+    LOG_WARN("Connectivity file " + file_name + " not found, computing the connectivity instead");
+    return false;
+  }
+
+  try {
+    midgard::mem_map<char> file(file_name, s.st_size);
+    const auto* header = reinterpret_cast<const connectivity_header_t*>(file.get());
+    if (std::memcmp(header->magic, kConnectivityMagic, sizeof(header->magic)) != 0 ||
+        static_cast<size_t>(s.st_size) !=
+            sizeof(connectivity_header_t) + header->count * sizeof(connectivity_record_t)) {
+      LOG_WARN("Connectivity file " + file_name + " is invalid, computing the connectivity instead");
+      return false;
+    }
+
+    // the records are sorted so each level is one run of them
+    const auto* records =
+        reinterpret_cast<const connectivity_record_t*>(file.get() + sizeof(connectivity_header_t));
+    for (const auto* record = records; record != records + header->count;) {
+      const auto* end = record;
+      while (end != records + header->count && end->level == record->level) {
+        ++end;
+      }
+      auto& level_colors = colors[record->level];
+      level_colors.reserve(end - record);
+      for (; record != end; ++record) {
+        level_colors.emplace(record->tileid, record->color);
+      }
+    }
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not load the connectivity file " + file_name + ": " + e.what());
+    colors.clear();
+    return false;
+  }
+  return true;
+}
+
 size_t connectivity_map_t::get_color(const GraphId& id) const {
   auto level = colors.find(id.level());
   if (level == colors.cend()) {
@@ -237,6 +343,22 @@ std::string connectivity_map_t::to_geojson(const uint32_t hierarchy_level) const
   return to_feature_collection<decltype(comp)>(boundaries, arities);
 }
 
+std::string tiles_to_geojson(const uint32_t hierarchy_level,
+                             const std::unordered_map<uint32_t, json::MapPtr>& properties) {
+  const auto& tiles = hierarchy_level == TileHierarchy::GetTransitLevel().level
+                          ? TileHierarchy::GetTransitLevel().tiles
+                          : TileHierarchy::get_tiling(hierarchy_level);
+  auto features = json::array({});
+  for (const auto& tile : properties) {
+    features->emplace_back(json::map({{"type", std::string("Feature")},
+                                      {"geometry", to_geometry(to_boundary({tile.first}, tiles))},
+                                      {"properties", tile.second}}));
+  }
+  std::stringstream ss;
+  ss << *json::map({{"type", std::string("FeatureCollection")}, {"features", features}});
+  return ss.str();
+}
+
 std::vector<size_t> connectivity_map_t::to_image(const uint32_t hierarchy_level) const {
   uint32_t tile_level = (hierarchy_level == transit_level) ? transit_level - 1 : hierarchy_level;
   auto bbox = TileHierarchy::levels().find(tile_level);
@@ -3,6 +3,7 @@
 #include "midgard/util.h"
 
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 
 #ifdef CURL_STATICLIB
@@ -29,9 +30,41 @@ struct curl_singleton_t {
   }
 };
 
+// All the curlers in the process share dns lookups, tls sessions and, where libcurl can, open
+// connections. So a connection (or an http/2 one multiplexing requests) to the tile server is
+// set up once instead of once per curler
+struct curl_share_t {
+  curl_share_t() : share(curl_share_init()) {
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+  }
+  ~curl_share_t() {
+    curl_share_cleanup(share);
+  }
+  static void lock(CURL*, curl_lock_data data, curl_lock_access, void* self) {
+    static_cast<curl_share_t*>(self)->locks[data % CURL_LOCK_DATA_LAST].lock();
+  }
+  static void unlock(CURL*, curl_lock_data data, void* self) {
+    static_cast<curl_share_t*>(self)->locks[data % CURL_LOCK_DATA_LAST].unlock();
+  }
+  CURLSH* share;
+  std::mutex locks[CURL_LOCK_DATA_LAST];
+};
+
 static std::shared_ptr<CURL> init_curl() {
   static curl_singleton_t s;
-  return std::shared_ptr<CURL>(curl_easy_init(), [](CURL* c) { curl_easy_cleanup(c); });
+  static curl_share_t share;
+  auto curl = std::shared_ptr<CURL>(curl_easy_init(), [](CURL* c) { curl_easy_cleanup(c); });
+  if (curl) {
+    curl_easy_setopt(curl.get(), CURLOPT_SHARE, share.share);
+  }
+  return curl;
 }
 
 char ALL_ENCODINGS[] = "";
@@ -59,6 +92,12 @@ struct curler_t::pimpl_t {
                 "Failed to set error buffer ");
     assert_curl(curl_easy_setopt(connection.get(), CURLOPT_FOLLOWLOCATION, 1L),
                 "Failed to set redirect option ");
+    // keep connections open between tiles and use http/2 where the server speaks it
+    curl_easy_setopt(connection.get(), CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(connection.get(), CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    curl_easy_setopt(connection.get(), CURLOPT_PIPEWAIT, 1L);
+#endif
     assert_curl(curl_easy_setopt(connection.get(), CURLOPT_WRITEFUNCTION, write_callback),
                 "Failed to set writer ");
     // this is less secure but we'll worry about that later
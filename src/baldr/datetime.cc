@@ -1,8 +1,10 @@
 #include <algorithm>
 #include <bitset>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -45,17 +47,55 @@ const tz_db_t& get_tz_db() {
   return tz_db;
 }
 
-// get a formatted date.  date in the format of 2016-11-06T01:00 or 2016-11-06
+namespace {
+
+// read a number of at most the given digits like the %Y, %m, %d, %H and %M of date::parse
+bool read_number(const char*& c, const char* end, int max_digits, int& value) {
+  value = 0;
+  int digits = 0;
+  for (; c != end && digits < max_digits && *c >= '0' && *c <= '9'; ++c, ++digits) {
+    value = value * 10 + (*c - '0');
+  }
+  return digits > 0;
+}
+
+bool read_char(const char*& c, const char* end, char expected) {
+  if (c == end || *c != expected) {
+    return false;
+  }
+  ++c;
+  return true;
+}
+
+} // namespace
+
+// get a formatted date.  date in the format of 2016-11-06T01:00 or 2016-11-06. this is read by
+// hand rather than with date::parse, which goes through a stream and its locale for every date
+// of every request, but it takes and rejects the same dates: anything after the minutes is
+// ignored and what cannot be read is the epoch
 date::local_seconds get_formatted_date(const std::string& date) {
-  std::istringstream in{date};
-  date::local_seconds tp;
+  const bool has_time = date.find('T') != std::string::npos;
+  if (!has_time && date.find('-') == std::string::npos) {
+    return date::local_seconds{};
+  }
 
-  if (date.find('T') != std::string::npos)
-    in >> date::parse("%FT%R", tp);
-  else if (date.find('-') != std::string::npos)
-    in >> date::parse("%F", tp);
+  const char* c = date.data();
+  const char* end = c + date.size();
+  int year, month, day, hours = 0, minutes = 0;
+  if (!read_number(c, end, 4, year) || !read_char(c, end, '-') || !read_number(c, end, 2, month) ||
+      !read_char(c, end, '-') || !read_number(c, end, 2, day)) {
+    return date::local_seconds{};
+  }
+  if (has_time && (!read_char(c, end, 'T') || !read_number(c, end, 2, hours) ||
+                   !read_char(c, end, ':') || !read_number(c, end, 2, minutes))) {
+    return date::local_seconds{};
+  }
 
-  return tp;
+  const date::year_month_day ymd{date::year{year}, date::month(month), date::day(day)};
+  if (!ymd.ok() || hours > 23 || minutes > 59) {
+    return date::local_seconds{};
+  }
+  return date::local_days{ymd} + std::chrono::hours{hours} + std::chrono::minutes{minutes};
 }
 
 // get a local_date_time with support for dst.  Assumes that we are moving
@@ -97,6 +137,28 @@ uint64_t seconds_since_epoch(const std::string& date_time, const date::time_zone
   return static_cast<uint64_t>(utc.time_since_epoch().count());
 }
 
+namespace {
+
+// The UTC offset of a timezone at a time. Searches ask about the same few timezones at times
+// close to each other, so each thread keeps the span between transitions it last found for
+// each timezone and only searches the rules of the timezone again once a time falls outside
+// of it.
+std::chrono::seconds utc_offset(const date::time_zone* time_zone, const date::sys_seconds& tp) {
+  thread_local std::unordered_map<const date::time_zone*, date::sys_info> spans;
+  auto& span = spans[time_zone];
+  if (tp < span.begin || tp >= span.end) {
+    span = time_zone->get_info(tp);
+  }
+  return span.offset;
+}
+
+date::local_seconds to_local(const date::time_zone* time_zone, const uint64_t seconds) {
+  date::sys_seconds tp{std::chrono::seconds(seconds)};
+  return date::local_seconds{tp.time_since_epoch() + utc_offset(time_zone, tp)};
+}
+
+} // namespace
+
 // Get the difference between two timezones using the current time (seconds from epoch
 // so that DST can be take into account). Returns the difference in seconds.
 int timezone_diff(const uint64_t seconds,
@@ -106,19 +168,8 @@ int timezone_diff(const uint64_t seconds,
   if (!origin_tz || !dest_tz || origin_tz == dest_tz) {
     return 0;
   }
-  std::chrono::seconds dur(seconds);
-  std::chrono::time_point<std::chrono::system_clock> tp(dur);
-
-  const auto origin = date::make_zoned(origin_tz, tp);
-  const auto dest = date::make_zoned(dest_tz, tp);
-
-  auto duration = std::chrono::duration_cast<std::chrono::seconds>(origin.get_local_time() -
-                                                                   dest.get_local_time());
-  if (origin.get_info().offset < dest.get_info().offset) {
-    return abs(duration.count());
-  } else {
-    return -1 * abs(duration.count());
-  }
+  date::sys_seconds tp{std::chrono::seconds(seconds)};
+  return (utc_offset(dest_tz, tp) - utc_offset(origin_tz, tp)).count();
 }
 
 std::string
@@ -217,40 +268,45 @@ get_duration(const std::string& date_time, const uint32_t seconds, const date::t
   return iso_date;
 }
 
-// does this date fall in the begin and end date range?
-bool is_conditional_active(const bool type,
-                           const uint8_t begin_hrs,
-                           const uint8_t begin_mins,
-                           const uint8_t end_hrs,
-                           const uint8_t end_mins,
-                           const uint8_t dow,
-                           const uint8_t begin_week,
-                           const uint8_t begin_month,
-                           const uint8_t begin_day_dow,
-                           const uint8_t end_week,
-                           const uint8_t end_month,
-                           const uint8_t end_day_dow,
-                           const uint64_t current_time,
-                           const date::time_zone* time_zone) {
+namespace {
 
-  if (!time_zone)
-    return false;
-
-  bool dow_in_range = true;
-  bool dt_in_range = false;
-
-  // date::time_of_day()
+// What a condition comes down to on one local day: whether it can be active at all that day
+// and, if so, the local time range and the time of day window it is active within
+struct day_condition_t {
+  bool active = false;
+  bool ranged = false; // only active from begin to end
+  date::local_seconds begin, end;
   std::chrono::minutes b_td = std::chrono::hours(0);
   std::chrono::minutes e_td = std::chrono::hours(23) + std::chrono::minutes(59);
+  bool wraps = false; // the time of day window goes past midnight, ie. 19:00 - 06:00
 
-  std::chrono::seconds dur(current_time);
-  std::chrono::time_point<std::chrono::system_clock> tp(dur);
-
-  const auto in_local_time = date::make_zoned(time_zone, tp);
-  auto date = date::floor<date::days>(in_local_time.get_local_time());
-  auto d = date::year_month_day(date);
-  auto t = date::make_time(in_local_time.get_local_time() - date); // Yields time_of_day type
-  std::chrono::minutes td = t.hours() + t.minutes();               // Yields time_of_day type
+  bool is_active(const date::local_seconds& local_time, const std::chrono::minutes td) const {
+    if (!active || (ranged && (local_time < begin || end < local_time))) {
+      return false;
+    }
+    return wraps ? !(e_td <= td && td <= b_td) : (b_td <= td && td <= e_td);
+  }
+};
+
+// Works out a condition for a local day. This is where the begin and end of date ranges get
+// resolved, which takes the timezone rules and the leap seconds so it is worth doing once a day.
+day_condition_t day_condition(const bool type,
+                              const uint8_t begin_hrs,
+                              const uint8_t begin_mins,
+                              const uint8_t end_hrs,
+                              const uint8_t end_mins,
+                              const uint8_t dow,
+                              const uint8_t begin_week,
+                              const uint8_t begin_month,
+                              const uint8_t begin_day_dow,
+                              const uint8_t end_week,
+                              const uint8_t end_month,
+                              const uint8_t end_day_dow,
+                              const date::local_days& day,
+                              const date::time_zone* time_zone) {
+  day_condition_t condition;
+  bool dow_in_range = true;
+  auto d = date::year_month_day(day);
 
   try {
     date::year_month_day begin_date, end_date;
@@ -258,7 +314,7 @@ bool is_conditional_active(const bool type,
     // we have dow
     if (dow) {
 
-      uint8_t wd = (date::weekday{date} - date::Sunday).count();
+      uint8_t wd = (date::weekday{day} - date::Sunday).count();
       uint8_t local_dow = 0;
       switch (wd) {
         case 0:
@@ -283,12 +339,11 @@ bool is_conditional_active(const bool type,
           local_dow = kSaturday;
           break;
         default:
-          return false; // should never happen
+          return condition; // should never happen
           break;
       }
       dow_in_range = (dow & local_dow);
     }
-
     uint8_t b_month = begin_month;
     uint8_t e_month = end_month;
     uint8_t b_day_dow = begin_day_dow;
@@ -321,15 +376,13 @@ bool is_conditional_active(const bool type,
     if (type == kYMD && (b_month && e_month) && (!b_day_dow && !e_day_dow && !b_week && !b_week) &&
         b_month == e_month) {
 
-      dt_in_range = (b_month <= unsigned(d.month()) && unsigned(d.month()) <= e_month);
-
       if (begin_hrs || begin_mins || end_hrs || end_mins) {
-        b_td = std::chrono::hours(begin_hrs) + std::chrono::minutes(begin_mins);
-        e_td = std::chrono::hours(end_hrs) + std::chrono::minutes(end_mins);
+        condition.b_td = std::chrono::hours(begin_hrs) + std::chrono::minutes(begin_mins);
+        condition.e_td = std::chrono::hours(end_hrs) + std::chrono::minutes(end_mins);
       }
-
-      dt_in_range = (dt_in_range && (b_td <= td && td <= e_td));
-      return (dow_in_range && dt_in_range);
+      condition.active = dow_in_range && (b_month <= unsigned(d.month()) &&
+                                          unsigned(d.month()) <= e_month);
+      return condition;
     } else if (type == kYMD && b_month && b_day_dow) {
 
       uint32_t e_year = int(d.year()), b_year = int(d.year());
@@ -404,54 +457,110 @@ bool is_conditional_active(const bool type,
     } else { // do we have just time?
 
       if (begin_hrs || begin_mins || end_hrs || end_mins) {
-        b_td = std::chrono::hours(begin_hrs) + std::chrono::minutes(begin_mins);
-        e_td = std::chrono::hours(end_hrs) + std::chrono::minutes(end_mins);
-
-        if (begin_hrs > end_hrs) { // 19:00 - 06:00
-          dt_in_range = !(e_td <= td && td <= b_td);
-        } else {
-          dt_in_range = (b_td <= td && td <= e_td);
-        }
+        condition.b_td = std::chrono::hours(begin_hrs) + std::chrono::minutes(begin_mins);
+        condition.e_td = std::chrono::hours(end_hrs) + std::chrono::minutes(end_mins);
+        condition.wraps = begin_hrs > end_hrs;
+        condition.active = dow_in_range;
       }
-      return (dow_in_range && dt_in_range);
+      return condition;
     }
 
     if (begin_hrs || begin_mins || end_hrs || end_mins) {
-      b_td = std::chrono::hours(begin_hrs) + std::chrono::minutes(begin_mins);
-      e_td = std::chrono::hours(end_hrs) + std::chrono::minutes(end_mins);
+      condition.b_td = std::chrono::hours(begin_hrs) + std::chrono::minutes(begin_mins);
+      condition.e_td = std::chrono::hours(end_hrs) + std::chrono::minutes(end_mins);
     }
 
     date::sys_seconds sec = date::sys_days(begin_date);
     date::utc_seconds utc = date::to_utc_time(sec);
     auto leap_s = utc.time_since_epoch() - sec.time_since_epoch();
-    auto b_in_local_time = date::make_zoned(time_zone, date::local_days(begin_date) + b_td + leap_s);
+    auto b_in_local_time =
+        date::make_zoned(time_zone, date::local_days(begin_date) + condition.b_td + leap_s);
 
     sec = date::sys_days(end_date);
     utc = date::to_utc_time(sec);
     leap_s = utc.time_since_epoch() - sec.time_since_epoch();
-    auto e_in_local_time = date::make_zoned(time_zone, date::local_days(end_date) + e_td + leap_s);
+    auto e_in_local_time =
+        date::make_zoned(time_zone, date::local_days(end_date) + condition.e_td + leap_s);
+
+    condition.ranged = true;
+    condition.begin = b_in_local_time.get_local_time();
+    condition.end = e_in_local_time.get_local_time();
+    condition.wraps = begin_hrs > end_hrs;
+    condition.active = dow_in_range;
+  } catch (std::exception& e) {}
+  return condition;
+}
 
-    dt_in_range = (b_in_local_time.get_local_time() <= in_local_time.get_local_time() &&
-                   in_local_time.get_local_time() <= e_in_local_time.get_local_time());
+} // namespace
 
-    bool time_in_range = false;
+// does this date fall in the begin and end date range?
+bool is_conditional_active(const bool type,
+                           const uint8_t begin_hrs,
+                           const uint8_t begin_mins,
+                           const uint8_t end_hrs,
+                           const uint8_t end_mins,
+                           const uint8_t dow,
+                           const uint8_t begin_week,
+                           const uint8_t begin_month,
+                           const uint8_t begin_day_dow,
+                           const uint8_t end_week,
+                           const uint8_t end_month,
+                           const uint8_t end_day_dow,
+                           const uint64_t current_time,
+                           const date::time_zone* time_zone) {
+
+  if (!time_zone)
+    return false;
 
-    if (begin_hrs > end_hrs) { // 19:00 - 06:00
-      time_in_range = !(e_td <= td && td <= b_td);
-    } else {
-      time_in_range = (b_td <= td && td <= e_td);
+  const auto local_time = to_local(time_zone, current_time);
+  auto day = date::floor<date::days>(local_time);
+  auto t = date::make_time(local_time - day);         // Yields time_of_day type
+  std::chrono::minutes td = t.hours() + t.minutes(); // Yields time_of_day type
+
+  // Searches check the same conditions over and over within a day, so each thread keeps what
+  // the conditions it checked come down to for the days it checked them on
+  struct key_t {
+    uint64_t conditions;
+    uint64_t day;
+    const date::time_zone* time_zone;
+    bool operator==(const key_t& other) const {
+      return conditions == other.conditions && day == other.day && time_zone == other.time_zone;
     }
+  };
+  struct hash_t {
+    size_t operator()(const key_t& key) const {
+      return std::hash<uint64_t>()(key.conditions ^ (key.day * 0x9E3779B97F4A7C15ull)) ^
+             std::hash<const date::time_zone*>()(key.time_zone);
+    }
+  };
+  thread_local std::unordered_map<key_t, day_condition_t, hash_t> days;
+  if (days.size() > 4096) {
+    days.clear();
+  }
 
-    dt_in_range = (dt_in_range && time_in_range);
-  } catch (std::exception& e) {}
-  return (dow_in_range && dt_in_range);
+  key_t key{static_cast<uint64_t>(type) | static_cast<uint64_t>(dow) << 1 |
+                static_cast<uint64_t>(begin_hrs) << 9 | static_cast<uint64_t>(begin_mins) << 17 |
+                static_cast<uint64_t>(begin_week) << 25 |
+                static_cast<uint64_t>(begin_month) << 33 |
+                static_cast<uint64_t>(begin_day_dow) << 41 | static_cast<uint64_t>(end_hrs) << 49,
+            static_cast<uint64_t>(static_cast<uint32_t>(day.time_since_epoch().count())) |
+                static_cast<uint64_t>(end_week) << 32 | static_cast<uint64_t>(end_month) << 40 |
+                static_cast<uint64_t>(end_day_dow) << 48 | static_cast<uint64_t>(end_mins) << 56,
+            time_zone};
+  auto found = days.find(key);
+  if (found == days.end()) {
+    found = days
+                .emplace(key, day_condition(type, begin_hrs, begin_mins, end_hrs, end_mins, dow,
+                                            begin_week, begin_month, begin_day_dow, end_week,
+                                            end_month, end_day_dow, day, time_zone))
+                .first;
+  }
+  return found->second.is_active(local_time, td);
 }
 
 uint32_t second_of_week(uint32_t epoch_time, const date::time_zone* time_zone) {
   // get the date time in this timezone
-  std::chrono::seconds dur(epoch_time);
-  std::chrono::time_point<std::chrono::system_clock> utp(dur);
-  const auto tp = date::make_zoned(time_zone, utp).get_local_time();
+  const auto tp = to_local(time_zone, epoch_time);
   // floor to midnight of that day
   auto days = date::floor<date::days>(tp);
   // get the ordinal day of the week
@@ -543,6 +543,15 @@ void DirectedEdge::set_bss_connection(const bool bss_connection) {
   bss_connection_ = bss_connection;
 }
 
+void DirectedEdge::set_component_class(const uint32_t mode, const uint32_t component_class) {
+  if (mode >= kComponentModeCount) {
+    LOG_WARN("Exceeding max component mode: " + std::to_string(mode));
+    return;
+  }
+  uint32_t clamped = std::min(component_class, kMaxComponentClass);
+  components_ = (components_ & ~(kMaxComponentClass << (mode * 3))) | (clamped << (mode * 3));
+}
+
 // Json representation
 json::MapPtr DirectedEdge::json() const {
   return json::map({
@@ -15,6 +15,19 @@ json::MapPtr bike_network_json(uint8_t mask) {
   });
 }
 
+// Reads one unsigned varint and moves past it
+uint32_t read_varint(const char*& ptr) {
+  uint32_t value = 0;
+  uint32_t shift = 0;
+  uint8_t byte;
+  do {
+    byte = static_cast<uint8_t>(*ptr++);
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
 json::ArrayPtr names_json(const std::vector<std::string>& names) {
   auto a = json::array({});
   for (const auto& n : names) {
@@ -44,6 +57,15 @@ EdgeInfo::EdgeInfo(char* ptr, const char* names_list, const size_t names_list_le
   // Set encoded_shape_ pointer
   encoded_shape_ = ptr;
   ptr += (encoded_shape_size() * sizeof(char));
+
+  // The optional elevation profile is prefixed with its size
+  encoded_elevation_ = nullptr;
+  encoded_elevation_size_ = 0;
+  if (item_->has_elevation_profile) {
+    const char* size = ptr;
+    encoded_elevation_size_ = read_varint(size);
+    encoded_elevation_ = size;
+  }
 }
 
 EdgeInfo::~EdgeInfo() {
@@ -65,18 +87,7 @@ std::vector<std::string> EdgeInfo::GetNames() const {
   // Get each name
   std::vector<std::string> names;
   names.reserve(name_count());
-  const NameInfo* ni = name_info_list_;
-  for (uint32_t i = 0; i < name_count(); i++, ni++) {
-    // Skip any tagged names (FUTURE code may make use of them)
-    if (ni->tagged_) {
-      continue;
-    }
-    if (ni->name_offset_ < names_list_length_) {
-      names.push_back(names_list_ + ni->name_offset_);
-    } else {
-      throw std::runtime_error("GetNames: offset exceeds size of text list");
-    }
-  }
+  ForEachName([&names](const char* name, bool) { names.emplace_back(name); });
   return names;
 }
 
@@ -85,18 +96,9 @@ std::vector<std::pair<std::string, bool>> EdgeInfo::GetNamesAndTypes() const {
   // Get each name
   std::vector<std::pair<std::string, bool>> name_type_pairs;
   name_type_pairs.reserve(name_count());
-  const NameInfo* ni = name_info_list_;
-  for (uint32_t i = 0; i < name_count(); i++, ni++) {
-    // Skip any tagged names (FUTURE code may make use of them)
-    if (ni->tagged_) {
-      continue;
-    }
-    if (ni->name_offset_ < names_list_length_) {
-      name_type_pairs.push_back({names_list_ + ni->name_offset_, ni->is_route_num_});
-    } else {
-      throw std::runtime_error("GetNamesAndTypes: offset exceeds size of text list");
-    }
-  }
+  ForEachName([&name_type_pairs](const char* name, bool is_route_number) {
+    name_type_pairs.emplace_back(name, is_route_number);
+  });
   return name_type_pairs;
 }
 
@@ -127,6 +129,20 @@ std::string EdgeInfo::encoded_shape() const {
                                    : std::string(encoded_shape_, item_->encoded_shape_size);
 }
 
+// Returns the elevation profile in meters
+std::vector<float> EdgeInfo::elevation_profile() const {
+  std::vector<float> profile;
+  int32_t elevation = 0;
+  const char* end = encoded_elevation_ + encoded_elevation_size_;
+  for (const char* ptr = encoded_elevation_; ptr < end;) {
+    // undo the zig zag to get the signed delta
+    uint32_t delta = read_varint(ptr);
+    elevation += static_cast<int32_t>((delta & 1) ? ~(delta >> 1) : (delta >> 1));
+    profile.push_back(elevation * kElevationProfilePrecision);
+  }
+  return profile;
+}
+
 json::MapPtr EdgeInfo::json() const {
   return json::map({
       {"way_id", static_cast<uint64_t>(wayid())},
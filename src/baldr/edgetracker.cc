@@ -21,6 +21,25 @@ bool bitset_t::get(const uint64_t id) const {
   return bits[id / u64_size] & (u64_one << (id % u64_size));
 }
 
+atomic_bitset_t::atomic_bitset_t(size_t size) : bits((size + bits_per_value - 1) / bits_per_value) {
+}
+
+bool atomic_bitset_t::set(const uint64_t id) {
+  if (id >= bits.size() * bits_per_value) {
+    throw std::runtime_error("id out of bounds");
+  }
+  const value_type bit = value_type(1) << (id % bits_per_value);
+  return !(bits[id / bits_per_value].fetch_or(bit, std::memory_order_relaxed) & bit);
+}
+
+bool atomic_bitset_t::get(const uint64_t id) const {
+  if (id >= bits.size() * bits_per_value) {
+    throw std::runtime_error("id out of bounds");
+  }
+  const value_type bit = value_type(1) << (id % bits_per_value);
+  return bits[id / bits_per_value].load(std::memory_order_relaxed) & bit;
+}
+
 bool edge_tracker::get(const GraphId& edge_id) const {
   auto itr = m_edges_in_tiles.find(edge_id.Tile_Base());
   assert(itr != m_edges_in_tiles.end());
@@ -33,5 +52,17 @@ void edge_tracker::set(const GraphId& edge_id) {
   m_edge_set.set(edge_id.id() + itr->second);
 }
 
+bool concurrent_edge_tracker::get(const GraphId& edge_id) const {
+  auto itr = m_edges_in_tiles.find(edge_id.Tile_Base());
+  assert(itr != m_edges_in_tiles.end());
+  return m_edge_set.get(edge_id.id() + itr->second);
+}
+
+bool concurrent_edge_tracker::set(const GraphId& edge_id) {
+  auto itr = m_edges_in_tiles.find(edge_id.Tile_Base());
+  assert(itr != m_edges_in_tiles.end());
+  return m_edge_set.set(edge_id.id() + itr->second);
+}
+
 } // namespace baldr
 } // namespace valhalla
@@ -1,15 +1,31 @@
 #include "baldr/graphreader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "midgard/sequence.h"
 
 #include "baldr/connectivity_map.h"
+#include "baldr/tileindex.h"
 #include "filesystem.h"
 
 using namespace valhalla::midgard;
@@ -18,19 +34,345 @@ namespace {
 constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
+constexpr size_t DEFAULT_TILE_CACHE_SHARDS = 64;
+constexpr size_t DEFAULT_MAX_PREFETCHED_TILES = 64;
+constexpr size_t DEFAULT_TILE_ACCESS_LOG_INTERVAL = 300; // seconds
+constexpr size_t TILE_ACCESSES_PER_FLUSH = 65536;
+
+// The share of the cache new tiles are kept in before they have to win a place in the main cache
+constexpr float TINYLFU_WINDOW_RATIO = 0.01f;
+// The fewest counters of the sketch, it gets as many as the tiles the cache holds rounded up to a
+// power of 2
+constexpr size_t TINYLFU_MIN_COUNTERS = 1024;
+// Requests counted per counter before every count is halved
+constexpr size_t TINYLFU_SAMPLE_FACTOR = 10;
+constexpr uint8_t TINYLFU_MAX_COUNT = 15;
+
+// Spreads the bits of a graphid so the counters of a tile are independent of each other
+uint64_t mix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+// Tiles being fetched from a tile url by some thread of this process. Whoever asks for one of
+// them while it is on its way waits for that fetch rather than fetching it again
+struct url_fetches_t {
+  std::mutex lock;
+  std::unordered_map<std::string, std::shared_future<valhalla::baldr::GraphTile>> inflight;
+};
+
+url_fetches_t& url_fetches() {
+  static url_fetches_t fetches;
+  return fetches;
+}
+
+// The tile metrics of all of the readers of the process
+metrics::Counter& tile_bytes_read(const bool url) {
+  static auto& disk = metrics::GetCounter("valhalla_tile_bytes_read_total",
+                                          "Bytes of graph tiles loaded", {{"source", "disk"}});
+  static auto& http = metrics::GetCounter("valhalla_tile_bytes_read_total",
+                                          "Bytes of graph tiles loaded", {{"source", "http"}});
+  return url ? http : disk;
+}
+
+metrics::Counter& tile_cache_lookups() {
+  static auto& lookups = metrics::GetCounter("valhalla_tile_cache_lookups_total",
+                                             "Graph tiles looked up in the cache");
+  return lookups;
+}
+
+metrics::Counter& tile_cache_misses() {
+  static auto& misses = metrics::GetCounter("valhalla_tile_cache_misses_total",
+                                            "Graph tiles that were not in the cache");
+  return misses;
+}
+
+using tile_accesses_t =
+    std::unordered_map<valhalla::baldr::GraphId, valhalla::baldr::GraphReader::TileAccesses>;
+
+// One line per tile: level tileid count misses miss_micros, logs written before misses were
+// counted only have the first three
+void read_tile_accesses(const std::string& path, tile_accesses_t& counts) {
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    uint32_t level, tileid;
+    uint64_t count, misses = 0, miss_micros = 0;
+    if (!(fields >> level >> tileid >> count) ||
+        level > valhalla::baldr::TileHierarchy::get_max_level() ||
+        tileid > valhalla::baldr::kMaxGraphTileId) {
+      continue;
+    }
+    fields >> misses >> miss_micros;
+    auto& accesses = counts[valhalla::baldr::GraphId(tileid, level, 0)];
+    accesses.count += count;
+    accesses.misses += misses;
+    accesses.miss_micros += miss_micros;
+  }
+}
+
+// The tiles of an extract as an index file beside it lists them. Nothing if there is no index or
+// the extract changed after the index was written
+std::vector<valhalla::baldr::TileIndexEntry> read_tile_index(const std::string& index_file,
+                                                              const std::string& extract_file) {
+  struct stat index_stat, extract_stat;
+  if (index_file.empty() || stat(index_file.c_str(), &index_stat) != 0 ||
+      stat(extract_file.c_str(), &extract_stat) != 0 ||
+      index_stat.st_mtime < extract_stat.st_mtime ||
+      index_stat.st_size % sizeof(valhalla::baldr::TileIndexEntry) != 0) {
+    return {};
+  }
+  std::vector<valhalla::baldr::TileIndexEntry> entries(index_stat.st_size /
+                                                       sizeof(valhalla::baldr::TileIndexEntry));
+  std::ifstream file(index_file, std::ios::binary);
+  if (!file.read(reinterpret_cast<char*>(entries.data()), index_stat.st_size)) {
+    return {};
+  }
+  for (const auto& entry : entries) {
+    if (entry.offset + entry.size > static_cast<uint64_t>(extract_stat.st_size)) {
+      return {};
+    }
+  }
+  return entries;
+}
+
+// Writes the index of the tiles of an extract beside it so the next process skips the walk over
+// the tar, it is moved into place once complete since other processes may be reading it
+void write_tile_index(const std::string& index_file,
+                      const std::unordered_map<uint64_t, std::pair<char*, size_t>>& tiles,
+                      const char* extract) {
+  std::vector<valhalla::baldr::TileIndexEntry> entries;
+  entries.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    entries.push_back({static_cast<uint64_t>(tile.second.first - extract), tile.first,
+                       tile.second.second});
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const valhalla::baldr::TileIndexEntry& a, const valhalla::baldr::TileIndexEntry& b) {
+              return a.tile_id < b.tile_id;
+            });
+  auto temporary = index_file + "." + std::to_string(getpid());
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(entries.data()),
+               entries.size() * sizeof(valhalla::baldr::TileIndexEntry));
+    if (!file) {
+      LOG_WARN("Could not write the tile extract index " + index_file);
+      std::remove(temporary.c_str());
+      return;
+    }
+  }
+  if (std::rename(temporary.c_str(), index_file.c_str()) != 0) {
+    LOG_WARN("Could not write the tile extract index " + index_file);
+    std::remove(temporary.c_str());
+  }
+}
+
+// How often each tile was asked for and missed, shared by the readers of this process logging to
+// the same file and starting from what that file held when the first of them was made
+struct tile_histogram_t {
+  std::mutex lock;
+  tile_accesses_t counts;
+  std::chrono::steady_clock::time_point written;
+};
+
+tile_histogram_t& tile_histogram(const std::string& path) {
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::unique_ptr<tile_histogram_t>> histograms;
+  std::lock_guard<std::mutex> guard(lock);
+  auto& histogram = histograms[path];
+  if (!histogram) {
+    histogram.reset(new tile_histogram_t);
+    histogram->written = std::chrono::steady_clock::now();
+    read_tile_accesses(path, histogram->counts);
+  }
+  return *histogram;
+}
+
+// Replaces the log file so that a reader of it never sees half of one
+void write_tile_histogram(const std::string& path, const tile_histogram_t& histogram) {
+  std::string temp = path + "." + std::to_string(getpid());
+  {
+    std::ofstream file(temp, std::ios::trunc);
+    for (const auto& count : histogram.counts) {
+      const auto& id = count.first;
+      file << id.level() << ' ' << id.tileid() << ' ' << count.second.count << ' '
+           << count.second.misses << ' ' << count.second.miss_micros << '\n';
+    }
+    if (!file) {
+      LOG_WARN("Failed to write tile access log " + temp);
+      return;
+    }
+  }
+  if (std::rename(temp.c_str(), path.c_str()) != 0) {
+    LOG_WARN("Failed to replace tile access log " + path);
+  }
+}
+
+#ifdef __linux__
+// Parses lists like 0-3,8,10-11 as used by sysfs for cpus and numa nodes
+std::vector<int> parse_id_list(const std::string& list) {
+  std::vector<int> ids;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    try {
+      auto dash = range.find('-');
+      int first = std::stoi(range.substr(0, dash));
+      int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int id = first; id <= last; ++id) {
+        ids.push_back(id);
+      }
+    } catch (...) {
+      // not something we can use
+    }
+  }
+  return ids;
+}
+
+// The cpus of each online numa node
+std::vector<cpu_set_t> numa_nodes() {
+  std::vector<cpu_set_t> nodes;
+  std::ifstream online("/sys/devices/system/node/online");
+  std::string list;
+  std::getline(online, list);
+  for (int node : parse_id_list(list)) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::getline(file, list);
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : parse_id_list(list)) {
+      if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &cpus);
+      }
+    }
+    if (CPU_COUNT(&cpus) > 0) {
+      nodes.push_back(cpus);
+    }
+  }
+  return nodes;
+}
+#endif
+
+// Applies the placement options of the tile extract to some memory holding it
+void place_extract(char* data, size_t size, const boost::property_tree::ptree& pt) {
+#ifndef _MSC_VER
+#ifdef MADV_HUGEPAGE
+  if (pt.get<bool>("tile_extract_hugepages", false) && madvise(data, size, MADV_HUGEPAGE) != 0) {
+    LOG_WARN("Tile extract could not use huge pages: " + std::string(strerror(errno)));
+  }
+#endif
+  if (pt.get<bool>("tile_extract_lock", false)) {
+    // locking faults everything in as well
+    if (mlock(data, size) != 0) {
+      LOG_WARN("Tile extract could not be locked in memory: " + std::string(strerror(errno)));
+    }
+  } else if (pt.get<bool>("tile_extract_populate", false)) {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    volatile char sum = 0;
+    for (size_t offset = 0; offset < size; offset += page_size) {
+      sum += data[offset];
+    }
+  }
+#endif
+}
+
+int parse_mmap_advice(const std::string& advice) {
+  if (advice == "normal") {
+    return POSIX_MADV_NORMAL;
+  } else if (advice == "random") {
+    return POSIX_MADV_RANDOM;
+  } else if (advice == "sequential") {
+    return POSIX_MADV_SEQUENTIAL;
+  } else if (advice == "willneed") {
+    return POSIX_MADV_WILLNEED;
+  }
+  throw std::runtime_error("Unknown mmap_advice: " + advice);
+}
 } // namespace
 
 namespace valhalla {
 namespace baldr {
 
+struct GraphReader::traffic_extract_t {
+  traffic_extract_t(const boost::property_tree::ptree& pt) {
+    // if you really meant to load it
+    if (pt.get_optional<std::string>("traffic_extract")) {
+      try {
+        // load the tar, it stays mapped shared so updates to the file are seen right away
+        archive.reset(new midgard::tar(pt.get<std::string>("traffic_extract")));
+        // map files to graph ids
+        for (auto& c : archive->contents) {
+          try {
+            auto id = GraphTile::GetTileId(c.first);
+            tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
+          } catch (...) {
+            // skip files we dont understand
+          }
+        }
+        if (tiles.empty()) {
+          LOG_WARN("Traffic extract contained no usuable tiles");
+        } else {
+          LOG_INFO("Traffic extract successfully loaded with tile count: " +
+                   std::to_string(tiles.size()));
+        }
+      } catch (const std::exception& e) {
+        LOG_ERROR(e.what());
+        LOG_WARN("Traffic extract could not be loaded");
+      }
+    }
+  }
+
+  // Point the tile at its live traffic, which the tile ignores if it is for another tile or version
+  void attach(GraphTile& tile) const {
+    if (tiles.empty() || !tile.header()) {
+      return;
+    }
+    auto t = tiles.find(tile.header()->graphid());
+    if (t != tiles.cend()) {
+      tile.set_traffic_tile(TrafficTile(t->second.first, t->second.second));
+    }
+  }
+
+  std::unordered_map<uint64_t, std::pair<char*, size_t>> tiles;
+  std::shared_ptr<midgard::tar> archive;
+};
+
 struct GraphReader::tile_extract_t {
   tile_extract_t(const boost::property_tree::ptree& pt) {
     // if you really meant to load it
     if (pt.get_optional<std::string>("tile_extract")) {
       try {
+        // an index beside the extract saves walking the tar
+        auto extract_file = pt.get<std::string>("tile_extract");
+        auto index_file = pt.get<std::string>("tile_extract_index", "");
+        auto entries = read_tile_index(index_file, extract_file);
+        for (const auto& entry : entries) {
+          tiles[entry.tile_id] = std::make_pair(nullptr, entry.size);
+        }
         // load the tar
-        archive.reset(new midgard::tar(pt.get<std::string>("tile_extract")));
-        // map files to graph ids
+        archive.reset(new midgard::tar(extract_file, true, kTileIndexFile, entries.empty()));
+        for (const auto& entry : entries) {
+          tiles[entry.tile_id].first = const_cast<char*>(archive->mm.get()) + entry.offset;
+        }
+        // an extract written by the build has an index of its tiles
+        auto tile_index = archive->contents.find(kTileIndexFile);
+        if (tile_index != archive->contents.end()) {
+          const auto* entry = reinterpret_cast<const TileIndexEntry*>(tile_index->second.first);
+          auto count = tile_index->second.second / sizeof(TileIndexEntry);
+          for (size_t i = 0; i < count; ++i, ++entry) {
+            if (entry->offset + entry->size <= archive->mm.size()) {
+              tiles[entry->tile_id] =
+                  std::make_pair(const_cast<char*>(archive->mm.get()) + entry->offset, entry->size);
+            }
+          }
+        }
+        // otherwise map files to graph ids
         for (auto& c : archive->contents) {
           try {
             auto id = GraphTile::GetTileId(c.first);
@@ -39,6 +381,13 @@ struct GraphReader::tile_extract_t {
             // skip files we dont understand
           }
         }
+        // the tar had to be walked so the next process can skip that
+        if (!index_file.empty() && entries.empty() && tile_index == archive->contents.end() &&
+            !tiles.empty()) {
+          write_tile_index(index_file, tiles, archive->mm.get());
+        }
+        place_extract(archive->mm.get(), archive->mm.size(), pt);
+        index(*get_traffic_extract_instance(pt));
         // couldn't load it
         if (tiles.empty()) {
           LOG_WARN("Tile extract contained no usuable tiles");
@@ -57,16 +406,210 @@ struct GraphReader::tile_extract_t {
       }
     }
   }
+
+  // A copy of the extract in anonymous memory, since the calling thread is the first to touch
+  // its pages they are allocated on the numa node that thread runs on
+  tile_extract_t(const tile_extract_t& source, const boost::property_tree::ptree& pt)
+      : archive(source.archive), replica_size(archive->mm.size()) {
+#ifndef _MSC_VER
+    void* data = mmap(nullptr, replica_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+    if (data == MAP_FAILED) {
+      throw std::runtime_error("Tile extract replica (mmap): " + std::string(strerror(errno)));
+    }
+    replica = static_cast<char*>(data);
+#ifdef MADV_HUGEPAGE
+    if (pt.get<bool>("tile_extract_hugepages", false)) {
+      madvise(replica, replica_size, MADV_HUGEPAGE);
+    }
+#endif
+    memcpy(replica, archive->mm.get(), replica_size);
+    if (pt.get<bool>("tile_extract_lock", false) && mlock(replica, replica_size) != 0) {
+      LOG_WARN("Tile extract replica could not be locked in memory: " +
+               std::string(strerror(errno)));
+    }
+    for (const auto& tile : source.tiles) {
+      tiles.emplace(tile.first, std::make_pair(replica + (tile.second.first - archive->mm.get()),
+                                               tile.second.second));
+    }
+    index(*get_traffic_extract_instance(pt));
+#endif
+  }
+
+  ~tile_extract_t() {
+#ifndef _MSC_VER
+    if (replica) {
+      munmap(replica, replica_size);
+    }
+#endif
+  }
+
+  // Make a tile for each file of the extract up front and index them by level and tile id, so a
+  // tile is found with one array lookup without hashing and without going through the cache
+  void index(const traffic_extract_t& traffic) {
+    views.reserve(tiles.size());
+    for (const auto& t : tiles) {
+      GraphTile tile(GraphId(t.first), t.second.first, t.second.second);
+      if (!tile.header()) {
+        continue;
+      }
+      traffic.attach(tile);
+      views.emplace_back(std::move(tile));
+    }
+    for (const auto& view : views) {
+      auto id = view.id();
+      if (id.level() >= levels.size()) {
+        levels.resize(id.level() + 1);
+      }
+      auto& level = levels[id.level()];
+      if (id.tileid() >= level.size()) {
+        level.resize(id.tileid() + 1, nullptr);
+      }
+      level[id.tileid()] = &view;
+    }
+  }
+
+  // The tile of a tile base id, nullptr if the extract does not have it
+  const GraphTile* find(const GraphId& base) const {
+    if (base.level() >= levels.size() || base.tileid() >= levels[base.level()].size()) {
+      return nullptr;
+    }
+    return levels[base.level()][base.tileid()];
+  }
+
   // TODO: dont remove constness, and actually make graphtile read only?
   std::unordered_map<uint64_t, std::pair<char*, size_t>> tiles;
+  std::vector<GraphTile> views;
+  std::vector<std::vector<const GraphTile*>> levels;
   std::shared_ptr<midgard::tar> archive;
+  char* replica = nullptr;
+  size_t replica_size = 0;
+};
+
+std::shared_ptr<const GraphReader::traffic_extract_t>
+GraphReader::get_traffic_extract_instance(const boost::property_tree::ptree& pt) {
+  static std::shared_ptr<const GraphReader::traffic_extract_t> traffic_extract(
+      new GraphReader::traffic_extract_t(pt));
+  return traffic_extract;
+}
+
+// Point the tile at its live traffic, which the tile ignores if it is for another tile or version
+void GraphReader::AttachTraffic(GraphTile& tile) const {
+  traffic_extract_->attach(tile);
+}
+
+// A version of the tile extract along with its copies on each numa node
+struct GraphReader::tile_set_t {
+  tile_set_t(const boost::property_tree::ptree& pt, const uint64_t version)
+      : version(version), extract(new tile_extract_t(pt)) {
+#ifdef __linux__
+    // One copy of the extract per numa node, made by threads bound to the cpus of each node
+    auto nodes = numa_nodes();
+    if (!pt.get<bool>("tile_extract_numa_replicas", false) || extract->tiles.empty() ||
+        nodes.size() < 2) {
+      return;
+    }
+    replicas.resize(nodes.size());
+    std::vector<std::thread> copiers;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      replicas[i].first = nodes[i];
+      copiers.emplace_back([this, &pt, i]() {
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &replicas[i].first);
+        try {
+          replicas[i].second.reset(new GraphReader::tile_extract_t(*extract, pt));
+        } catch (const std::exception& e) {
+          LOG_WARN(e.what());
+        }
+      });
+    }
+    for (auto& copier : copiers) {
+      copier.join();
+    }
+    LOG_INFO("Tile extract replicated to " + std::to_string(nodes.size()) + " numa nodes");
+#endif
+  }
+
+  // The copy on the node we run on, we stay there so it remains the local one
+  std::shared_ptr<const tile_extract_t> local() const {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    for (const auto& replica : replicas) {
+      if (replica.second && cpu >= 0 && CPU_ISSET(cpu, &replica.first)) {
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &replica.first);
+        return replica.second;
+      }
+    }
+#endif
+    return extract;
+  }
+
+  const uint64_t version;
+  std::shared_ptr<const tile_extract_t> extract;
+#ifdef __linux__
+  std::vector<std::pair<cpu_set_t, std::shared_ptr<const tile_extract_t>>> replicas;
+#endif
 };
 
+std::mutex GraphReader::latest_tile_set_lock_;
+std::shared_ptr<const GraphReader::tile_set_t> GraphReader::latest_tile_set_;
+std::atomic<uint64_t> GraphReader::latest_tile_set_version_(0);
+
+// The latest version of the extract, the first reader loads it
+std::shared_ptr<const GraphReader::tile_set_t>
+GraphReader::get_tile_set(const boost::property_tree::ptree& pt) {
+  std::lock_guard<std::mutex> lock(latest_tile_set_lock_);
+  if (!latest_tile_set_) {
+    latest_tile_set_.reset(new tile_set_t(pt, 1));
+    latest_tile_set_version_.store(1);
+  }
+  return latest_tile_set_;
+}
+
 std::shared_ptr<const GraphReader::tile_extract_t>
 GraphReader::get_extract_instance(const boost::property_tree::ptree& pt) {
-  static std::shared_ptr<const GraphReader::tile_extract_t> tile_extract(
-      new GraphReader::tile_extract_t(pt));
-  return tile_extract;
+  return get_tile_set(pt)->local();
+}
+
+uint64_t GraphReader::SwapTileExtract(const boost::property_tree::ptree& pt) {
+  // One swap at a time so the versions go up in the order they were loaded
+  static std::mutex swap_lock;
+  std::lock_guard<std::mutex> swapping(swap_lock);
+  auto version = latest_tile_set_version_.load() + 1;
+  std::shared_ptr<const tile_set_t> tile_set(new tile_set_t(pt, version));
+  if (tile_set->extract->tiles.empty()) {
+    throw std::runtime_error("Tile extract has no usable tiles, it was not swapped in");
+  }
+  {
+    std::lock_guard<std::mutex> lock(latest_tile_set_lock_);
+    latest_tile_set_ = tile_set;
+    latest_tile_set_version_.store(version);
+  }
+  LOG_INFO("Tile extract version " + std::to_string(version) + " swapped in");
+  return version;
+}
+
+bool GraphReader::UpdateTileExtract() {
+  if (latest_tile_set_version_.load() == tile_set_->version) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(latest_tile_set_lock_);
+    tile_set_ = latest_tile_set_;
+  }
+  tile_extract_ = tile_set_->local();
+  // the cache may have tiles from before there was an extract
+  Clear();
+  return true;
+}
+
+uint64_t GraphReader::tile_extract_version() const {
+  return tile_set_->version;
+}
+
+// Get a handle to a tile, by default a copy which shares the tile memory
+graph_tile_ptr TileCache::GetHandle(const GraphId& graphid) const {
+  const GraphTile* tile = Get(graphid);
+  return tile ? std::make_shared<const GraphTile>(*tile) : nullptr;
 }
 
 // ----------------------------------------------------------------------------
@@ -223,6 +766,214 @@ TileCacheLRU::Put(const GraphId& graphid, const GraphTile& tile, size_t new_tile
   return &key_val_lru_list_.front().tile;
 }
 
+// ----------------------------------------------------------------------------
+// TileCacheTinyLFU implementation
+// ----------------------------------------------------------------------------
+
+TileCacheTinyLFU::TileCacheTinyLFU(size_t max_size, TileCacheLRU::MemoryLimitControl mem_control)
+    : sketch_(TINYLFU_MIN_COUNTERS, 0), additions_(0),
+      sample_size_(TINYLFU_MIN_COUNTERS * TINYLFU_SAMPLE_FACTOR), mem_control_(mem_control),
+      window_size_(0), main_size_(0), max_window_size_(max_size * TINYLFU_WINDOW_RATIO),
+      max_cache_size_(max_size) {
+}
+
+void TileCacheTinyLFU::Reserve(size_t tile_size) {
+  assert(tile_size != 0);
+  size_t tiles = max_cache_size_ / tile_size;
+  cache_.reserve(tiles);
+  size_t counters = TINYLFU_MIN_COUNTERS;
+  while (counters < tiles) {
+    counters <<= 1;
+  }
+  sketch_.assign(counters, 0);
+  additions_ = 0;
+  sample_size_ = counters * TINYLFU_SAMPLE_FACTOR;
+}
+
+bool TileCacheTinyLFU::Contains(const GraphId& graphid) const {
+  return cache_.find(graphid) != cache_.cend();
+}
+
+bool TileCacheTinyLFU::OverCommitted() const {
+  return window_size_ + main_size_ > max_cache_size_;
+}
+
+void TileCacheTinyLFU::Clear() {
+  cache_.clear();
+  window_.clear();
+  main_.clear();
+  window_size_ = main_size_ = 0;
+}
+
+void TileCacheTinyLFU::Trim() {
+  TrimToFit(0);
+}
+
+const GraphTile* TileCacheTinyLFU::Get(const GraphId& graphid) const {
+  Increment(graphid);
+  auto cached = cache_.find(graphid);
+  if (cached == cache_.cend()) {
+    return nullptr;
+  }
+
+  auto& list = cached->second.main ? main_ : window_;
+  list.splice(list.begin(), list, cached->second.entry);
+  return &cached->second.entry->tile;
+}
+
+uint8_t TileCacheTinyLFU::Frequency(const GraphId& graphid) const {
+  uint64_t hash = mix(graphid.value);
+  size_t mask = sketch_.size() - 1;
+  uint8_t frequency = TINYLFU_MAX_COUNT;
+  for (uint64_t i = 0; i < 4; ++i) {
+    frequency = std::min(frequency, sketch_[(hash + i * ((hash >> 32) | 1)) & mask]);
+  }
+  return frequency;
+}
+
+void TileCacheTinyLFU::Increment(const GraphId& graphid) const {
+  // only the smallest counters are counted up, which keeps collisions from inflating the others
+  uint64_t hash = mix(graphid.value);
+  size_t mask = sketch_.size() - 1;
+  uint8_t frequency = Frequency(graphid);
+  if (frequency < TINYLFU_MAX_COUNT) {
+    for (uint64_t i = 0; i < 4; ++i) {
+      auto& counter = sketch_[(hash + i * ((hash >> 32) | 1)) & mask];
+      if (counter == frequency) {
+        ++counter;
+      }
+    }
+  }
+
+  if (++additions_ >= sample_size_) {
+    for (auto& counter : sketch_) {
+      counter >>= 1;
+    }
+    additions_ /= 2;
+  }
+}
+
+void TileCacheTinyLFU::Evict(KeyValueList& list) {
+  const auto& entry = list.back();
+  (&list == &main_ ? main_size_ : window_size_) -= entry.size;
+  cache_.erase(entry.id);
+  list.pop_back();
+}
+
+void TileCacheTinyLFU::TrimToFit(const size_t required_size) {
+  size_t max_main_size = max_cache_size_ - max_window_size_;
+  while (!window_.empty() || !main_.empty()) {
+    // the oldest tiles of a full window move to the main cache while it has room
+    while (window_size_ > max_window_size_ && main_size_ + window_.back().size <= max_main_size) {
+      auto& moved = window_.back();
+      window_size_ -= moved.size;
+      main_size_ += moved.size;
+      cache_[moved.id].main = true;
+      main_.splice(main_.begin(), window_, std::prev(window_.end()));
+    }
+    if (window_size_ + main_size_ + required_size <= max_cache_size_) {
+      break;
+    }
+
+    // once it has none the oldest tile of the window and of the main cache compete for it and
+    // the one asked for less often goes, newcomers lose ties so the cache resists scans
+    if (window_size_ > max_window_size_ && !main_.empty()) {
+      Evict(Frequency(window_.back().id) > Frequency(main_.back().id) ? main_ : window_);
+    } else {
+      Evict(main_.empty() ? window_ : main_);
+    }
+  }
+}
+
+const GraphTile* TileCacheTinyLFU::Put(const GraphId& graphid, const GraphTile& tile, size_t size) {
+  if (size > max_cache_size_) {
+    throw std::runtime_error("TileCacheTinyLFU: tile size is bigger than max cache size");
+  }
+
+  auto cached = cache_.find(graphid);
+  if (cached != cache_.end()) {
+    // an overwrite stays where the tile is
+    auto& list = cached->second.main ? main_ : window_;
+    auto& entry = cached->second.entry;
+    list.splice(list.begin(), list, entry);
+    (cached->second.main ? main_size_ : window_size_) += size - entry->size;
+    entry->tile = tile;
+    entry->size = size;
+    if (mem_control_ == TileCacheLRU::MemoryLimitControl::HARD) {
+      TrimToFit(0);
+    }
+    return &entry->tile;
+  }
+
+  if (mem_control_ == TileCacheLRU::MemoryLimitControl::HARD) {
+    TrimToFit(size);
+  }
+  window_.emplace_front(KeyValue{graphid, tile, size});
+  window_size_ += size;
+  cache_.emplace(graphid, Slot{false, window_.begin()});
+  return &window_.front().tile;
+}
+
+// ----------------------------------------------------------------------------
+// PinningTileCache implementation
+// ----------------------------------------------------------------------------
+
+PinningTileCache::PinningTileCache(const std::vector<uint8_t>& pinned_levels,
+                                   size_t pinned_size,
+                                   std::unique_ptr<TileCache>&& others)
+    : pinned_size_(0), max_pinned_size_(pinned_size), others_(std::move(others)) {
+  for (auto level : pinned_levels) {
+    if (level >= pinned_levels_.size()) {
+      pinned_levels_.resize(level + 1, false);
+    }
+    pinned_levels_[level] = true;
+  }
+}
+
+void PinningTileCache::Reserve(size_t tile_size) {
+  pinned_.reserve(max_pinned_size_ / tile_size);
+  others_->Reserve(tile_size);
+}
+
+bool PinningTileCache::Contains(const GraphId& graphid) const {
+  return pinned_.find(graphid) != pinned_.end() || others_->Contains(graphid);
+}
+
+const GraphTile* PinningTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size) {
+  auto level = graphid.level();
+  if (level < pinned_levels_.size() && pinned_levels_[level] &&
+      pinned_size_ + size <= max_pinned_size_) {
+    pinned_size_ += size;
+    return &pinned_.emplace(graphid, tile).first->second;
+  }
+  return others_->Put(graphid, tile, size);
+}
+
+const GraphTile* PinningTileCache::Get(const GraphId& graphid) const {
+  auto cached = pinned_.find(graphid);
+  return cached != pinned_.end() ? &cached->second : others_->Get(graphid);
+}
+
+graph_tile_ptr PinningTileCache::GetHandle(const GraphId& graphid) const {
+  auto cached = pinned_.find(graphid);
+  return cached != pinned_.end() ? std::make_shared<const GraphTile>(cached->second)
+                                 : others_->GetHandle(graphid);
+}
+
+bool PinningTileCache::OverCommitted() const {
+  return others_->OverCommitted();
+}
+
+void PinningTileCache::Clear() {
+  pinned_.clear();
+  pinned_size_ = 0;
+  others_->Clear();
+}
+
+void PinningTileCache::Trim() {
+  others_->Trim();
+}
+
 // ----------------------------------------------------------------------------
 // SynchronizedTileCache implementation
 // ----------------------------------------------------------------------------
@@ -267,6 +1018,12 @@ const GraphTile* SynchronizedTileCache::Get(const GraphId& graphid) const {
   return cache_.Get(graphid);
 }
 
+// Get a handle to a graph tile object given a GraphId.
+graph_tile_ptr SynchronizedTileCache::GetHandle(const GraphId& graphid) const {
+  std::lock_guard<std::mutex> lock(mutex_ref_);
+  return cache_.GetHandle(graphid);
+}
+
 // Puts a copy of a tile of into the cache.
 const GraphTile*
 SynchronizedTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size) {
@@ -274,15 +1031,210 @@ SynchronizedTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t
   return cache_.Put(graphid, tile, size);
 }
 
+// ----------------------------------------------------------------------------
+// ShardedTileCache implementation
+// ----------------------------------------------------------------------------
+
+namespace {
+// tile values are 25 bits (3 for the level and 22 for the tile id), slots are
+// allocated in chunks so we only pay for the parts of the world we actually load
+constexpr uint32_t kTileValueBits = 25;
+constexpr uint32_t kChunkBits = 12;
+constexpr uint32_t kChunkSize = 1 << kChunkBits;
+constexpr uint32_t kChunkCount = 1 << (kTileValueBits - kChunkBits);
+} // namespace
+
+ShardedTileCache::state_t::state_t(size_t max_size, size_t shard_count)
+    : chunks(new std::atomic<slot_t*>[kChunkCount]()), cache_size(0), clock_hand(0),
+      max_cache_size(max_size) {
+  uint32_t shard_bits = 0;
+  while ((size_t(1) << shard_bits) < shard_count && shard_bits < 16) {
+    ++shard_bits;
+  }
+  shard_shift = 32 - shard_bits;
+  shards = std::vector<shard_t>(size_t(1) << shard_bits);
+}
+
+ShardedTileCache::state_t::~state_t() {
+  for (uint32_t i = 0; i < kChunkCount; ++i) {
+    delete[] chunks[i].load(std::memory_order_relaxed);
+  }
+}
+
+// Constructor.
+ShardedTileCache::ShardedTileCache(size_t max_size, size_t shard_count)
+    : state_(std::make_shared<state_t>(max_size, shard_count)) {
+}
+
+ShardedTileCache::slot_t* ShardedTileCache::slot(uint32_t tile_value, bool allocate) const {
+  auto& chunk = state_->chunks[tile_value >> kChunkBits];
+  slot_t* slots = chunk.load(std::memory_order_acquire);
+  if (!slots && allocate) {
+    // whoever loses the race throws their chunk away
+    slot_t* fresh = new slot_t[kChunkSize]();
+    if (chunk.compare_exchange_strong(slots, fresh, std::memory_order_acq_rel)) {
+      slots = fresh;
+    } else {
+      delete[] fresh;
+    }
+  }
+  return slots ? slots + (tile_value & (kChunkSize - 1)) : nullptr;
+}
+
+ShardedTileCache::shard_t& ShardedTileCache::shard(uint32_t tile_value) const {
+  // neighboring tiles are often loaded together so scatter them over the shards
+  uint32_t hash = tile_value * 0x9E3779B1u;
+  return state_->shards[state_->shard_shift == 32 ? 0 : hash >> state_->shard_shift];
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ShardedTileCache::Reserve(size_t tile_size) {
+  size_t per_shard = state_->max_cache_size / tile_size / state_->shards.size();
+  for (auto& shard : state_->shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.tiles.reserve(per_shard);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ShardedTileCache::Contains(const GraphId& graphid) const {
+  const slot_t* s = slot(graphid.tile_value(), false);
+  return s && s->tile.load(std::memory_order_acquire) != nullptr;
+}
+
+// Lets you know if the cache is too large.
+bool ShardedTileCache::OverCommitted() const {
+  return state_->cache_size.load(std::memory_order_relaxed) > state_->max_cache_size;
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+const GraphTile* ShardedTileCache::Get(const GraphId& graphid) const {
+  const slot_t* s = slot(graphid.tile_value(), false);
+  if (!s) {
+    return nullptr;
+  }
+  const GraphTile* tile = s->tile.load(std::memory_order_acquire);
+  // only write the flag when it changes so hot tiles dont bounce cache lines between cores
+  if (tile && !s->referenced.load(std::memory_order_relaxed)) {
+    s->referenced.store(true, std::memory_order_relaxed);
+  }
+  return tile;
+}
+
+// Get a handle to a graph tile object given a GraphId.
+graph_tile_ptr ShardedTileCache::GetHandle(const GraphId& graphid) const {
+  uint32_t tile_value = graphid.tile_value();
+  auto& shard = this->shard(tile_value);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto found = shard.tiles.find(tile_value);
+  return found != shard.tiles.end() ? found->second.tile : nullptr;
+}
+
+// Puts a copy of a tile of into the cache.
+const GraphTile* ShardedTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size) {
+  uint32_t tile_value = graphid.tile_value();
+  slot_t* s = slot(tile_value, true);
+  auto& shard = this->shard(tile_value);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // someone else beat us to it, keep theirs since other threads may already be using it
+  auto found = shard.tiles.find(tile_value);
+  if (found != shard.tiles.end()) {
+    return found->second.tile.get();
+  }
+
+  auto handle = std::make_shared<const GraphTile>(tile);
+  const GraphTile* cached = handle.get();
+  shard.tiles.emplace(tile_value, entry_t{std::move(handle), size});
+  state_->cache_size.fetch_add(size, std::memory_order_relaxed);
+  s->referenced.store(false, std::memory_order_relaxed);
+  s->tile.store(cached, std::memory_order_release);
+  return cached;
+}
+
+// Clears the cache.
+void ShardedTileCache::Clear() {
+  for (auto& shard : state_->shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto& entry : shard.tiles) {
+      slot(entry.first, false)->tile.store(nullptr, std::memory_order_release);
+      state_->cache_size.fetch_sub(entry.second.size, std::memory_order_relaxed);
+    }
+    shard.tiles.clear();
+  }
+}
+
+void ShardedTileCache::TrimShard(shard_t& shard, bool second_pass) {
+  for (auto entry = shard.tiles.begin(); entry != shard.tiles.end() && OverCommitted();) {
+    slot_t* s = slot(entry->first, false);
+    if (!second_pass && s->referenced.exchange(false, std::memory_order_relaxed)) {
+      ++entry;
+      continue;
+    }
+    s->tile.store(nullptr, std::memory_order_release);
+    state_->cache_size.fetch_sub(entry->second.size, std::memory_order_relaxed);
+    entry = shard.tiles.erase(entry);
+  }
+}
+
+void ShardedTileCache::Trim() {
+  // start at a different shard every time so we dont always evict from the same ones
+  size_t shard_count = state_->shards.size();
+  size_t start = state_->clock_hand.fetch_add(1, std::memory_order_relaxed);
+  for (bool second_pass : {false, true}) {
+    for (size_t i = 0; i < shard_count && OverCommitted(); ++i) {
+      auto& shard = state_->shards[(start + i) & (shard_count - 1)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      TrimShard(shard, second_pass);
+    }
+  }
+}
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
 
   bool use_lru_cache = pt.get<bool>("use_lru_mem_cache", false);
+  bool use_tinylfu_cache = pt.get<bool>("use_tinylfu_mem_cache", false);
   auto lru_mem_control = pt.get<bool>("lru_mem_cache_hard_control", false)
                              ? TileCacheLRU::MemoryLimitControl::HARD
                              : TileCacheLRU::MemoryLimitControl::SOFT;
 
+  // one process wide cache which is thread-safe on its own, every reader gets a view of it
+  if (pt.get<bool>("use_sharded_tile_cache", false)) {
+    static std::mutex factoryMutex;
+    static std::unique_ptr<ShardedTileCache> globalTileCache_;
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    if (!globalTileCache_) {
+      globalTileCache_.reset(new ShardedTileCache(max_cache_size,
+                                                  pt.get<size_t>("tile_cache_shards",
+                                                                 DEFAULT_TILE_CACHE_SHARDS)));
+    }
+    return new ShardedTileCache(*globalTileCache_);
+  }
+
+  // the levels whose tiles are pinned in a budget of their own, the rest share max_cache_size
+  std::vector<uint8_t> pinned_levels;
+  const boost::property_tree::ptree no_levels;
+  for (const auto& level : pt.get_child("pinned_cache.levels", no_levels)) {
+    pinned_levels.push_back(level.second.get_value<uint8_t>());
+  }
+  size_t pinned_size = pt.get<size_t>("pinned_cache.max_size", 0);
+  auto make_cache = [&]() -> TileCache* {
+    std::unique_ptr<TileCache> cache;
+    if (use_tinylfu_cache) {
+      cache.reset(new TileCacheTinyLFU(max_cache_size, lru_mem_control));
+    } else if (use_lru_cache) {
+      cache.reset(new TileCacheLRU(max_cache_size, lru_mem_control));
+    } else {
+      cache.reset(new SimpleTileCache(max_cache_size));
+    }
+    if (pinned_levels.empty() || pinned_size == 0) {
+      return cache.release();
+    }
+    return new PinningTileCache(pinned_levels, pinned_size, std::move(cache));
+  };
+
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
     // Handle synchronization of cache
@@ -292,36 +1244,364 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
     static std::mutex factoryMutex;
     std::lock_guard<std::mutex> lock(factoryMutex);
     if (!globalTileCache_) {
-      if (use_lru_cache) {
-        globalTileCache_.reset(new TileCacheLRU(max_cache_size, lru_mem_control));
-      } else {
-        globalTileCache_.reset(new SimpleTileCache(max_cache_size));
-      }
+      globalTileCache_.reset(make_cache());
     }
     return new SynchronizedTileCache(*globalTileCache_, globalCacheMutex_);
   }
 
   // Otherwise: No synchronization
-  if (use_lru_cache) {
-    return new TileCacheLRU(max_cache_size, lru_mem_control);
-  }
-  return new SimpleTileCache(max_cache_size);
+  return make_cache();
 }
 
+// Tiles being loaded in the background. Loaded tiles are kept here rather than put in the
+// cache since the cache need not be thread safe, the thread asking for one moves it over.
+struct GraphReader::prefetcher_t {
+  struct loaded_t {
+    GraphTile tile;
+    bool mapped;
+  };
+
+  prefetcher_t(size_t threads, size_t max_tiles, const std::string& user_agent)
+      : curlers(threads, user_agent), max_tiles(max_tiles), stop(false) {
+  }
+
+  curler_pool_t curlers;
+  const size_t max_tiles;
+  std::mutex lock;
+  std::condition_variable work;
+  std::condition_variable done;
+  std::deque<GraphId> queued;
+  std::unordered_set<GraphId> loading;
+  std::unordered_map<GraphId, loaded_t> loaded;
+  std::unordered_set<GraphId> hinted;
+  std::vector<std::thread> threads;
+  bool stop;
+
+  bool pending(const GraphId& base) const {
+    return loading.count(base) || loaded.count(base) ||
+           std::find(queued.cbegin(), queued.cend(), base) != queued.cend();
+  }
+};
+
+struct GraphReader::access_log_t {
+  access_log_t(const std::string& path, size_t interval, size_t sample_rate)
+      : path(path), interval(interval), sample_rate(std::max<size_t>(sample_rate, 1)),
+        histogram(tile_histogram(path)), recorded(0), skipped(0) {
+  }
+
+  ~access_log_t() {
+    flush(true);
+  }
+
+  // Counts one in every sample_rate lookups as sample_rate of them, returns whether it counted
+  bool record(const GraphId& base) {
+    if (++skipped < sample_rate) {
+      return false;
+    }
+    skipped = 0;
+    counts[base].count += sample_rate;
+    if (++recorded == TILE_ACCESSES_PER_FLUSH) {
+      flush(false);
+    }
+    return true;
+  }
+
+  // Times loading a tile that was not in the cache, from construction to destruction
+  struct miss_t {
+    miss_t(access_log_t* log, const GraphId& base)
+        : log(log), base(base), start(log ? std::chrono::steady_clock::now()
+                                          : std::chrono::steady_clock::time_point{}) {
+    }
+    ~miss_t() {
+      if (log) {
+        auto& accesses = log->counts[base];
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        accesses.misses += log->sample_rate;
+        accesses.miss_micros += elapsed.count() * log->sample_rate;
+      }
+    }
+    access_log_t* log;
+    GraphId base;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  // Adds what this reader counted to the histogram, which is written every so often
+  void flush(bool write) {
+    std::lock_guard<std::mutex> lock(histogram.lock);
+    for (const auto& count : counts) {
+      auto& accesses = histogram.counts[count.first];
+      accesses.count += count.second.count;
+      accesses.misses += count.second.misses;
+      accesses.miss_micros += count.second.miss_micros;
+    }
+    counts.clear();
+    recorded = 0;
+    auto now = std::chrono::steady_clock::now();
+    if (write || now - histogram.written >= interval) {
+      write_tile_histogram(path, histogram);
+      histogram.written = now;
+    }
+  }
+
+  const std::string path;
+  const std::chrono::seconds interval;
+  const size_t sample_rate;
+  tile_histogram_t& histogram;
+  tile_accesses_t counts;
+  size_t recorded;
+  size_t skipped;
+};
+
 // Constructor using separate tile files
 GraphReader::GraphReader(const boost::property_tree::ptree& pt)
-    : tile_extract_(get_extract_instance(pt)), tile_dir_(pt.get<std::string>("tile_dir", "")),
+    : tile_set_(get_tile_set(pt)), tile_extract_(tile_set_->local()),
+      traffic_extract_(get_traffic_extract_instance(pt)),
+      tile_dir_(pt.get<std::string>("tile_dir", "")),
+      mmap_tiles_(pt.get<bool>("mmap_tiles", false)),
+      mmap_populate_(pt.get<bool>("mmap_populate", false)),
+      mmap_advice_(parse_mmap_advice(pt.get<std::string>("mmap_advice", "normal"))),
       curlers_(std::make_unique<curler_pool_t>(pt.get<size_t>("max_concurrent_reader_users", 1),
                                                pt.get<std::string>("user_agent", ""))),
+      user_agent_(pt.get<std::string>("user_agent", "")),
       tile_url_(pt.get<std::string>("tile_url", "")),
       tile_url_gz_(pt.get<bool>("tile_url_gz", false)),
-      cache_(TileCacheFactory::createTileCache(pt)) {
+      max_cache_size_(pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE)),
+      cache_(TileCacheFactory::createTileCache(pt)), tiles_fetched_(0), tiles_missed_(0),
+      tiles_fetched_reported_(0), tiles_missed_reported_(0) {
   // validate tile url
   if (!tile_url_.empty() && tile_url_.find(GraphTile::kTilePathPattern) == std::string::npos)
     throw std::runtime_error("Not found tilePath pattern in tile url");
-  // Reserve cache (based on whether using individual tile files or shared,
-  // mmap'd file
-  cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+  // Reserve cache (based on whether using individual tile files or mmap'd
+  // ones), tiles in an extract do not go through the cache
+  if (tile_extract_->tiles.empty()) {
+    cache_->Reserve(mmap_tiles_ ? AVERAGE_MM_TILE_SIZE : AVERAGE_TILE_SIZE);
+  }
+
+  // Start loading tiles in the background if asked to, tiles in an extract are already mapped
+  size_t prefetch_threads = pt.get<size_t>("prefetch_threads", 0);
+  if (prefetch_threads > 0 && tile_extract_->tiles.empty()) {
+    prefetcher_.reset(new prefetcher_t(prefetch_threads,
+                                       pt.get<size_t>("max_prefetched_tiles",
+                                                      DEFAULT_MAX_PREFETCHED_TILES),
+                                       user_agent_));
+    for (size_t i = 0; i < prefetch_threads; ++i) {
+      prefetcher_->threads.emplace_back([this]() {
+        auto& p = *prefetcher_;
+        std::unique_lock<std::mutex> lock(p.lock);
+        while (true) {
+          p.work.wait(lock, [&p]() { return p.stop || !p.queued.empty(); });
+          if (p.stop) {
+            return;
+          }
+          GraphId base = p.queued.front();
+          p.queued.pop_front();
+          p.loading.insert(base);
+          lock.unlock();
+          bool mapped = false;
+          GraphTile tile;
+          try {
+            tile = LoadTile(base, p.curlers, mapped);
+          } catch (const std::exception& e) {
+            // whoever asks for it later will try again
+            LOG_WARN("Failed to prefetch tile " + GraphTile::FileSuffix(base) + ": " + e.what());
+          }
+          lock.lock();
+          p.loading.erase(base);
+          if (tile.header()) {
+            p.loaded.emplace(base, prefetcher_t::loaded_t{std::move(tile), mapped});
+          }
+          p.done.notify_all();
+        }
+      });
+    }
+  }
+
+  // Count which tiles are asked for so that a later reader can preload them
+  auto access_log = pt.get<std::string>("tile_access_log", "");
+  if (!access_log.empty()) {
+    access_log_.reset(
+        new access_log_t(access_log,
+                         pt.get<size_t>("tile_access_log_interval",
+                                        DEFAULT_TILE_ACCESS_LOG_INTERVAL),
+                         pt.get<size_t>("tile_access_log_sample_rate", 1)));
+  }
+}
+
+GraphReader::~GraphReader() {
+  if (prefetcher_) {
+    {
+      std::lock_guard<std::mutex> lock(prefetcher_->lock);
+      prefetcher_->stop = true;
+    }
+    prefetcher_->work.notify_all();
+    for (auto& thread : prefetcher_->threads) {
+      thread.join();
+    }
+  }
+}
+
+// Clear the cache and drop any tiles loaded in the background
+void GraphReader::Clear() {
+  cache_->Clear();
+  if (prefetcher_) {
+    std::lock_guard<std::mutex> lock(prefetcher_->lock);
+    prefetcher_->loaded.clear();
+    prefetcher_->hinted.clear();
+  }
+}
+
+// Load the tiles used most before they are asked for
+size_t GraphReader::Preload(size_t max_tiles, size_t threads) {
+  // Tiles in an extract are all made up front, there is nothing to load
+  if (!access_log_ || max_tiles == 0 || !tile_extract_->tiles.empty()) {
+    return 0;
+  }
+
+  // What was counted so far by this process or earlier ones, most used first
+  std::vector<std::pair<uint64_t, GraphId>> ranked;
+  {
+    access_log_->flush(false);
+    std::lock_guard<std::mutex> lock(access_log_->histogram.lock);
+    for (const auto& count : access_log_->histogram.counts) {
+      if (!cache_->Contains(count.first)) {
+        ranked.emplace_back(count.second.count, count.first);
+      }
+    }
+  }
+  auto most_used = [](const std::pair<uint64_t, GraphId>& a,
+                      const std::pair<uint64_t, GraphId>& b) { return a.first > b.first; };
+  if (ranked.size() > max_tiles) {
+    std::nth_element(ranked.begin(), ranked.begin() + max_tiles, ranked.end(), most_used);
+    ranked.resize(max_tiles);
+  }
+  std::sort(ranked.begin(), ranked.end(), most_used);
+
+  size_t preloaded = 0;
+  size_t used = 0;
+
+  // Otherwise load a few tiles per thread at a time and stop adding once the cache is full
+  threads = std::max<size_t>(1, std::min(threads, ranked.size()));
+  curler_pool_t curlers(threads, user_agent_);
+  const size_t batch = threads * 4;
+  for (size_t begin = 0; begin < ranked.size(); begin += batch) {
+    size_t end = std::min(begin + batch, ranked.size());
+    std::vector<std::pair<GraphTile, bool>> loaded(end - begin);
+    std::atomic<size_t> next(begin);
+    std::vector<std::thread> loaders;
+    for (size_t i = 0; i < threads; ++i) {
+      loaders.emplace_back([&]() {
+        for (size_t j; (j = next++) < end;) {
+          try {
+            loaded[j - begin].first = LoadTile(ranked[j].second, curlers, loaded[j - begin].second);
+          } catch (const std::exception& e) {
+            LOG_WARN("Failed to preload tile " + GraphTile::FileSuffix(ranked[j].second) + ": " +
+                     e.what());
+          }
+        }
+      });
+    }
+    for (auto& loader : loaders) {
+      loader.join();
+    }
+
+    for (size_t j = begin; j < end; ++j) {
+      auto& tile = loaded[j - begin];
+      if (!tile.first.header()) {
+        continue;
+      }
+      size_t size = tile.second ? AVERAGE_MM_TILE_SIZE : tile.first.header()->end_offset();
+      if (used + size > max_cache_size_ || cache_->OverCommitted()) {
+        return preloaded;
+      }
+      AttachTraffic(tile.first);
+      cache_->Put(ranked[j].second, tile.first, size);
+      used += size;
+      ++preloaded;
+    }
+  }
+  return preloaded;
+}
+
+// Queue the neighbors of a tile for loading in the background
+void GraphReader::QueueNeighbors(const GraphId& graphid, const midgard::PointLL* toward) {
+  auto base = graphid.Tile_Base();
+  if (base.level() > TileHierarchy::levels().rbegin()->first) {
+    return;
+  }
+  const auto& tiles = TileHierarchy::get_tiling(base.level());
+  auto& p = *prefetcher_;
+  std::unique_lock<std::mutex> lock(p.lock);
+  // Tiles hinted long ago may have been evicted since so now and then start over
+  if (p.hinted.size() > p.max_tiles * 64) {
+    p.hinted.clear();
+  }
+  if (!p.hinted.insert(base).second) {
+    return;
+  }
+
+  // The 8 tiles around this one, closest to where the search is heading first
+  auto center = tiles.Center(base.tileid());
+  std::vector<std::pair<float, GraphId>> neighbors;
+  auto rowcol = tiles.GetRowColumn(base.tileid());
+  for (int32_t row = rowcol.first - 1; row <= rowcol.first + 1; ++row) {
+    for (int32_t col = rowcol.second - 1; col <= rowcol.second + 1; ++col) {
+      if (row < 0 || row >= tiles.nrows() || col < 0 || col >= tiles.ncolumns() ||
+          (row == rowcol.first && col == rowcol.second)) {
+        continue;
+      }
+      GraphId neighbor(tiles.TileId(col, row), base.level(), 0);
+      float distance = toward ? tiles.Center(neighbor.tileid()).Distance(*toward) : 0.f;
+      if (toward && distance > center.Distance(*toward)) {
+        continue;
+      }
+      neighbors.emplace_back(distance, neighbor);
+    }
+  }
+  std::sort(neighbors.begin(), neighbors.end(),
+            [](const std::pair<float, GraphId>& a, const std::pair<float, GraphId>& b) {
+              return a.first < b.first;
+            });
+
+  lock.unlock();
+  std::vector<GraphId> ids;
+  for (const auto& neighbor : neighbors) {
+    ids.push_back(neighbor.second);
+  }
+  Prefetch(ids);
+}
+
+// Queue tiles for loading in the background
+void GraphReader::Prefetch(const std::vector<GraphId>& tiles) {
+  if (!prefetcher_) {
+    return;
+  }
+
+  // Skip what we already have, what is on its way and what we know does not exist
+  auto& p = *prefetcher_;
+  std::unique_lock<std::mutex> lock(p.lock);
+  bool queued = false;
+  for (const auto& id : tiles) {
+    if (p.queued.size() + p.loading.size() + p.loaded.size() >= p.max_tiles) {
+      break;
+    }
+    auto base = id.Tile_Base();
+    if (!base.Is_Valid() || p.pending(base) || cache_->Contains(base)) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      if (_404s.find(base) != _404s.end()) {
+        continue;
+      }
+    }
+    p.queued.push_back(base);
+    queued = true;
+  }
+  lock.unlock();
+  if (queued) {
+    p.work.notify_all();
+  }
 }
 
 // Method to test if tile exists
@@ -376,68 +1656,156 @@ const GraphTile* GraphReader::GetGraphTile(const GraphId& graphid) {
 
   // Check if the level/tileid combination is in the cache
   auto base = graphid.Tile_Base();
+  bool sampled = access_log_ && access_log_->record(base);
+  tiles_fetched_.fetch_add(1, std::memory_order_relaxed);
+
+  // The memmapped tar extract has all its tiles ready, the cache is not used for them
+  if (!tile_extract_->tiles.empty()) {
+    return tile_extract_->find(base);
+  }
+
   if (auto cached = cache_->Get(base)) {
     // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
     return cached;
   }
-
-  // Try getting it from the memmapped tar extract
-  if (!tile_extract_->tiles.empty()) {
-    // Do we have this tile
-    auto t = tile_extract_->tiles.find(base);
-    if (t == tile_extract_->tiles.cend()) {
-      // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
-      return nullptr;
+  tiles_missed_.fetch_add(1, std::memory_order_relaxed);
+  access_log_t::miss_t miss(sampled ? access_log_.get() : nullptr, base);
+
+  // Try getting it from flat file
+  GraphTile tile;
+  bool mapped = false;
+  bool loaded = false;
+
+  // It may have been loaded in the background already, or be loading right now
+  if (prefetcher_) {
+    auto& p = *prefetcher_;
+    std::unique_lock<std::mutex> lock(p.lock);
+    auto queued = std::find(p.queued.begin(), p.queued.end(), base);
+    if (queued != p.queued.end()) {
+      p.queued.erase(queued);
+    }
+    p.done.wait(lock, [&p, &base]() { return !p.loading.count(base); });
+    auto prefetched = p.loaded.find(base);
+    if (prefetched != p.loaded.end()) {
+      tile = std::move(prefetched->second.tile);
+      mapped = prefetched->second.mapped;
+      p.loaded.erase(prefetched);
+      loaded = true;
     }
+  }
 
-    // This initializes the tile from mmap
-    GraphTile tile(base, t->second.first, t->second.second);
+  // Otherwise load it now
+  if (!loaded) {
+    tile = LoadTile(base, *curlers_, mapped);
     if (!tile.header()) {
-      // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
     }
-    // LOG_DEBUG("Memory map cache hit " + GraphTile::FileSuffix(base));
+  }
 
-    // Keep a copy in the cache and return it
-    size_t size = AVERAGE_MM_TILE_SIZE; // tile.end_offset();  // TODO what size??
-    auto inserted = cache_->Put(base, tile, size);
-    return inserted;
-  } // Try getting it from flat file
-  else {
-    // Try to get it from disk and if we cant..
-    GraphTile tile(tile_dir_, base);
-    if (!tile.header()) {
-      {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        // See if we are configured for a url and if we are
-        if (tile_url_.empty() || _404s.find(base) != _404s.end()) {
-          // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
-          return nullptr;
-        }
+  // Keep a copy in the cache and return it, mapped tiles live in the page cache
+  AttachTraffic(tile);
+  size_t size = mapped ? AVERAGE_MM_TILE_SIZE : tile.header()->end_offset();
+  auto inserted = cache_->Put(base, tile, size);
+  return inserted;
+}
+
+// Load a tile from disk, mapped if we can, and if we cant from the tile url
+GraphTile GraphReader::LoadTile(const GraphId& base, curler_pool_t& curlers, bool& mapped) {
+  GraphTile tile;
+  mapped = false;
+  if (mmap_tiles_) {
+    tile = GraphTile::MapTileFile(tile_dir_, base, mmap_populate_, mmap_advice_);
+    mapped = tile.header() != nullptr;
+  }
+  if (!mapped) {
+    tile = GraphTile(tile_dir_, base);
+  }
+  if (!tile.header()) {
+    {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      // See if we are configured for a url and if we are
+      if (tile_url_.empty() || _404s.find(base) != _404s.end()) {
+        // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
+        return tile;
       }
+    }
 
-      {
-        scoped_curler_t curler(*curlers_);
-        // Get it from the url and cache it to disk if you can
+    // Get it from the url and cache it to disk if you can, unless some other thread already is
+    auto key = tile_url_ + (tile_url_gz_ ? "#gz#" : "#") + std::to_string(base.value);
+    auto& fetches = url_fetches();
+    std::unique_lock<std::mutex> lock(fetches.lock);
+    auto inflight = fetches.inflight.find(key);
+    if (inflight != fetches.inflight.end()) {
+      auto fetch = inflight->second;
+      lock.unlock();
+      tile = fetch.get();
+    } else {
+      std::promise<GraphTile> promise;
+      fetches.inflight.emplace(key, promise.get_future().share());
+      lock.unlock();
+      try {
+        scoped_curler_t curler(curlers);
         tile = GraphTile::CacheTileURL(tile_url_, base, curler.get(), tile_url_gz_, tile_dir_);
+        if (tile.header()) {
+          tile_bytes_read(true).add(tile.header()->end_offset());
+        }
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+        lock.lock();
+        fetches.inflight.erase(key);
+        throw;
       }
+      promise.set_value(tile);
+      lock.lock();
+      fetches.inflight.erase(key);
+      lock.unlock();
+    }
 
-      if (!tile.header()) {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        _404s.insert(base);
-        // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
-        return nullptr;
-      }
-      // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(base));
-    } else {
-      // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
+    if (!tile.header()) {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      _404s.insert(base);
+      // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
+      return tile;
     }
+    // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(base));
+  } else {
+    // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
+    tile_bytes_read(false).add(tile.header()->end_offset());
+  }
+  return tile;
+}
+
+std::unordered_map<GraphId, GraphReader::TileAccesses>
+GraphReader::ReadTileAccessLog(const std::string& path) {
+  tile_accesses_t counts;
+  read_tile_accesses(path, counts);
+  return counts;
+}
 
-    // Keep a copy in the cache and return it
-    size_t size = tile.header()->end_offset();
-    auto inserted = cache_->Put(base, tile, size);
-    return inserted;
+void GraphReader::ReportMetrics() {
+  // Whoever moves the reported count forward adds the difference, the others add nothing
+  auto report = [](const uint64_t count, std::atomic<uint64_t>& reported,
+                   metrics::Counter& counter) {
+    auto last = reported.load(std::memory_order_relaxed);
+    while (last < count && !reported.compare_exchange_weak(last, count)) {
+    }
+    if (last < count) {
+      counter.add(count - last);
+    }
+  };
+  report(tiles_fetched(), tiles_fetched_reported_, tile_cache_lookups());
+  report(tiles_missed(), tiles_missed_reported_, tile_cache_misses());
+}
+
+// Get a reference counted handle to a graph tile object given a GraphId.
+graph_tile_ptr GraphReader::GetGraphTileHandle(const GraphId& graphid) {
+  const GraphTile* tile = GetGraphTile(graphid);
+  if (!tile) {
+    return nullptr;
   }
+  // the cache may share its own copy, otherwise we make one which shares the tile memory
+  auto handle = cache_->GetHandle(graphid.Tile_Base());
+  return handle ? handle : std::make_shared<const GraphTile>(*tile);
 }
 
 // Convenience method to get an opposing directed edge graph Id.
@@ -475,7 +1843,7 @@ bool GraphReader::AreEdgesConnected(const GraphId& edge1, const GraphId& edge2)
       const NodeInfo* ni = tile->node(n1);
       if (ni->transition_count() == 0)
         return false;
-      const NodeTransition* trans = tile->transition(ni->transition_index());
+      const NodeTransition* trans = tile->transition_unchecked(ni->transition_index());
       for (uint32_t i = 0; i < ni->transition_count(); ++i, ++trans) {
         if (trans->endnode() == n2) {
           return true;
@@ -626,7 +1994,13 @@ std::vector<GraphId> GraphReader::RecoverShortcut(const GraphId& shortcut_id) {
     return {shortcut_id};
   }
 
-  // loop over the edges leaving its begin node and find the superseded edge
+  // tiles built with shortcut expansions list the edges
+  auto listed = tile->GetShortcutEdges(shortcut_id.id());
+  if (listed.size() > 0) {
+    return std::vector<GraphId>(listed.begin(), listed.end());
+  }
+
+  // otherwise walk from its begin node over the edges alike the shortcut
   GraphId begin_node = edge_startnode(shortcut_id);
   if (!begin_node)
     return {shortcut_id};
@@ -836,7 +2210,7 @@ AABB2<PointLL> GraphReader::GetMinimumBoundingBox(const AABB2<PointLL>& bb) {
           min_bb = AABB2<PointLL>(node_ll, node_ll);
 
         // Look at the shape of each edge leaving the node
-        const auto* diredge = tile->directededge(node->edge_index());
+        const auto* diredge = tile->directededge_unchecked(node->edge_index());
         for (uint32_t i = 0; i < node->edge_count(); i++, diredge++) {
           auto shape = tile->edgeinfo(diredge->edgeinfo_offset()).lazy_shape();
           while (!shape.empty()) {
@@ -6,8 +6,10 @@
 #include "filesystem.h"
 #include "midgard/aabb2.h"
 #include "midgard/pointll.h"
+#include "midgard/sequence.h"
 #include "midgard/tiles.h"
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <chrono>
@@ -19,6 +21,7 @@
 #include <iomanip>
 #include <iostream>
 #include <locale>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -37,12 +40,48 @@ protected:
 };
 const std::locale dir_locale(std::locale("C"), new dir_facet());
 const AABB2<PointLL> world_box(PointLL(-180, -90), PointLL(180, 90));
-constexpr float COMPRESSION_HINT = 3.5f;
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Where a tile of some size goes in a buffer with room to spare so that its nodes, right after
+// the header, start on a cache line. The sections are back to back in the tile so this is the
+// one alignment that holds for every tile, and it keeps any one node from straddling two lines
+size_t aligned_offset(std::vector<char>& buffer, size_t size) {
+  buffer.resize(size + CACHE_LINE_SIZE);
+  auto nodes = reinterpret_cast<uintptr_t>(buffer.data()) +
+               sizeof(valhalla::baldr::GraphTileHeader);
+  return (CACHE_LINE_SIZE - nodes % CACHE_LINE_SIZE) % CACHE_LINE_SIZE;
+}
 } // namespace
 
 namespace valhalla {
 namespace baldr {
 
+// The deflated edge info, text list and lane connectivity of a tile and the memory they are
+// inflated into, which is only written (and so only paged in) when they are first used
+struct GraphTile::cold_sections_t {
+  cold_sections_t(const char* compressed, size_t compressed_size, size_t size)
+      : compressed(compressed), compressed_size(compressed_size), data(new char[size]),
+        size(size) {
+  }
+
+  void inflate() {
+    std::call_once(inflated, [this]() {
+      // the sections fill the buffer exactly, anything more or less means a broken tile
+      size_t inflated_size = size;
+      if (!baldr::inflate(compressed, compressed_size, data.get(), inflated_size) ||
+          inflated_size != size) {
+        throw std::runtime_error("Failed to inflate the compressed sections of the tile");
+      }
+    });
+  }
+
+  const char* compressed;
+  const size_t compressed_size;
+  std::unique_ptr<char[]> data;
+  const size_t size;
+  std::once_flag inflated;
+};
+
 // Default constructor
 GraphTile::GraphTile()
     : header_(nullptr), nodes_(nullptr), directededges_(nullptr), ext_directededges_(nullptr),
@@ -52,7 +91,8 @@ GraphTile::GraphTile()
       complex_restriction_reverse_(nullptr), edgeinfo_(nullptr), textlist_(nullptr),
       complex_restriction_forward_size_(0), complex_restriction_reverse_size_(0), edgeinfo_size_(0),
       textlist_size_(0), lane_connectivity_(nullptr), lane_connectivity_size_(0),
-      turnlanes_(nullptr) {
+      bin_bounds_(nullptr), shortcut_expansions_(nullptr), shortcut_expansion_count_(0),
+      shortcut_edges_(nullptr), turnlanes_(nullptr) {
 }
 
 // Constructor given a filename. Reads the graph data into memory.
@@ -71,13 +111,15 @@ GraphTile::GraphTile(const std::string& tile_dir, const GraphId& graphid) : head
     // Read binary file into memory. TODO - protect against failure to
     // allocate memory
     size_t filesize = file.tellg();
-    graphtile_.reset(new std::vector<char>(filesize));
+    graphtile_.reset(new std::vector<char>());
+    size_t offset = aligned_offset(*graphtile_, filesize);
+    char* tile_ptr = graphtile_->data() + offset;
     file.seekg(0, std::ios::beg);
-    file.read(graphtile_->data(), filesize);
+    file.read(tile_ptr, filesize);
     file.close();
 
     // Set pointers to internal data structures
-    Initialize(graphid, graphtile_->data(), graphtile_->size());
+    Initialize(graphid, tile_ptr, filesize);
   } else {
     // try to load a gzipped tile
     std::ifstream file(file_location + ".gz", std::ios::in | std::ios::binary | std::ios::ate);
@@ -96,39 +138,30 @@ GraphTile::GraphTile(const std::string& tile_dir, const GraphId& graphid) : head
 }
 
 bool GraphTile::DecompressTile(const GraphId& graphid, std::vector<char>& compressed) {
-  // for setting where to read compressed data from
-  auto src_func = [&compressed](z_stream& s) -> void {
-    s.next_in = static_cast<Byte*>(static_cast<void*>(compressed.data()));
-    s.avail_in = static_cast<unsigned int>(compressed.size());
-  };
-
-  // for setting where to write the uncompressed data to
+  // gzip records the size of the tile so it is inflated straight to where its nodes are aligned
   graphtile_.reset(new std::vector<char>(0, 0));
-  auto dst_func = [this, &compressed](z_stream& s) -> int {
-    // if the whole buffer wasn't used we are done
-    auto size = graphtile_->size();
-    if (s.total_out < size)
-      graphtile_->resize(s.total_out);
-    // we need more space
-    else {
-      // assume we need 3.5x the space
-      graphtile_->resize(size + (compressed.size() * COMPRESSION_HINT));
-      // set the pointer to the next spot
-      s.next_out = static_cast<Byte*>(static_cast<void*>(graphtile_->data() + size));
-      s.avail_out = compressed.size() * COMPRESSION_HINT;
-    }
-    return Z_NO_FLUSH;
-  };
-
-  // Decompress tile into memory
-  if (!baldr::inflate(src_func, dst_func)) {
+  size_t size = gzip_size(compressed.data(), compressed.size());
+  size_t offset = 0;
+  bool inflated = false;
+  if (size > 0) {
+    offset = aligned_offset(*graphtile_, size);
+    inflated = baldr::inflate(compressed.data(), compressed.size(), graphtile_->data() + offset,
+                              size);
+  } else if (baldr::inflate(compressed.data(), compressed.size(), *graphtile_)) {
+    // otherwise move it where its nodes are aligned once its size is known
+    size = graphtile_->size();
+    offset = aligned_offset(*graphtile_, size);
+    std::memmove(graphtile_->data() + offset, graphtile_->data(), size);
+    inflated = true;
+  }
+  if (!inflated) {
     LOG_ERROR("Failed to gunzip " + FileSuffix(graphid, true));
     graphtile_.reset();
     return false;
   }
 
   // Set pointers to internal data structures
-  Initialize(graphid, graphtile_->data(), graphtile_->size());
+  Initialize(graphid, graphtile_->data() + offset, size);
   return true;
 }
 
@@ -138,6 +171,58 @@ GraphTile::GraphTile(const GraphId& graphid, char* ptr, size_t size) : header_(n
   Initialize(graphid, ptr, size);
 }
 
+GraphTile GraphTile::MapTileFile(const std::string& tile_dir,
+                                 const GraphId& graphid,
+                                 bool populate,
+                                 int advice) {
+  // Don't bother with invalid ids
+  GraphTile tile;
+  if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level() || tile_dir.empty()) {
+    return tile;
+  }
+
+  std::string file_location =
+      tile_dir + filesystem::path::preferred_separator + FileSuffix(graphid.Tile_Base());
+#if defined(_MSC_VER)
+  auto fd = _open(file_location.c_str(), O_RDONLY, 0);
+#else
+  auto fd = open(file_location.c_str(), O_RDONLY, 0);
+#endif
+  if (fd == -1) {
+    return tile;
+  }
+
+  // The mapping stays valid once the file is closed
+  struct stat s;
+  void* ptr = MAP_FAILED;
+  if (fstat(fd, &s) == 0 && s.st_size > 0) {
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (populate) {
+      flags |= MAP_POPULATE;
+    }
+#endif
+    ptr = mmap(nullptr, s.st_size, PROT_READ, flags, fd, 0);
+  }
+#if defined(_MSC_VER)
+  _close(fd);
+#else
+  close(fd);
+#endif
+  if (ptr == MAP_FAILED) {
+    return tile;
+  }
+
+  size_t size = s.st_size;
+#if !defined(_MSC_VER)
+  posix_madvise(ptr, size, advice);
+#endif
+  tile.mapped_.reset(static_cast<const char*>(ptr),
+                     [size](const char* p) { munmap(const_cast<char*>(p), size); });
+  tile.Initialize(graphid, const_cast<char*>(tile.mapped_.get()), size);
+  return tile;
+}
+
 std::string MakeSingleTileUrl(const std::string& tile_url, const GraphId& graphid) {
   auto id_pos = tile_url.find(GraphTile::kTilePathPattern);
   return tile_url.substr(0, id_pos) + GraphTile::FileSuffix(graphid.Tile_Base()) +
@@ -237,6 +322,13 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr, const size_t
   directededges_ = reinterpret_cast<DirectedEdge*>(ptr);
   ptr += header_->directededgecount() * sizeof(DirectedEdge);
 
+  // Pull the hot attributes of the directed edges together
+  routing_edges_.clear();
+  routing_edges_.reserve(header_->directededgecount());
+  for (uint32_t i = 0; i < header_->directededgecount(); ++i) {
+    routing_edges_.emplace_back(directededges_[i]);
+  }
+
   // Extended directed edge attribution (if available).
   if (header_->has_ext_directededge()) {
     ext_directededges_ = reinterpret_cast<DirectedEdgeExt*>(ptr);
@@ -281,6 +373,22 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr, const size_t
 
   // Set a pointer to the edge bin list
   edge_bins_ = reinterpret_cast<GraphId*>(ptr);
+  if (static_cast<size_t>(ptr - tile_ptr) > tile_size) {
+    throw std::runtime_error("Header counts exceed the raw tile data size = " +
+                             std::to_string(tile_size) + ". Tile file might be corrupted");
+  }
+
+  // Check the edges and transitions of every node once here so that the inner loops of the
+  // path algorithms can use the unchecked accessors with them
+  for (uint32_t i = 0; i < header_->nodecount(); ++i) {
+    const auto& node = nodes_[i];
+    if (node.edge_index() + node.edge_count() > header_->directededgecount() ||
+        node.transition_index() + node.transition_count() > header_->transitioncount()) {
+      throw std::runtime_error("Node " + std::to_string(i) +
+                               " has edges or transitions out of bounds. Tile file might be "
+                               "corrupted");
+    }
+  }
 
   // Start of forward restriction information and its size
   complex_restriction_forward_ = tile_ptr + header_->complex_restriction_forward_offset();
@@ -292,18 +400,42 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr, const size_t
   complex_restriction_reverse_size_ =
       header_->edgeinfo_offset() - header_->complex_restriction_reverse_offset();
 
+  // Where the edge info, text list and lane connectivity are, compressed tiles have them in one
+  // deflated block in place of the edge info which the sections point into once inflated
+  size_t cold_end = header_->predictedspeeds_count() > 0 ? header_->predictedspeeds_offset()
+                                                         : header_->end_offset();
+  if (header_->bin_bounds_offset() > 0 && header_->bin_bounds_offset() < cold_end) {
+    cold_end = header_->bin_bounds_offset();
+  }
+  if (header_->shortcut_expansions_offset() > 0 &&
+      header_->shortcut_expansions_offset() < cold_end) {
+    cold_end = header_->shortcut_expansions_offset();
+  }
+  char* cold_ptr = tile_ptr;
+  cold_.reset();
+  if (header_->cold_size() > 0) {
+    if (cold_end < header_->edgeinfo_offset()) {
+      throw std::runtime_error("Invalid compressed tile sections. Tile file might me corrupted");
+    }
+    cold_ = std::make_shared<cold_sections_t>(tile_ptr + header_->edgeinfo_offset(),
+                                              cold_end - header_->edgeinfo_offset(),
+                                              header_->cold_size());
+    cold_ptr = cold_->data.get() - header_->edgeinfo_offset();
+    cold_end = header_->edgeinfo_offset() + header_->cold_size();
+  }
+
   // Start of edge information and its size
-  edgeinfo_ = tile_ptr + header_->edgeinfo_offset();
+  edgeinfo_ = cold_ptr + header_->edgeinfo_offset();
   edgeinfo_size_ = header_->textlist_offset() - header_->edgeinfo_offset();
 
   // Start of text list and its size
-  textlist_ = tile_ptr + header_->textlist_offset();
+  textlist_ = cold_ptr + header_->textlist_offset();
   textlist_size_ = header_->lane_connectivity_offset() - header_->textlist_offset();
 
   // Start of lane connections and their size
   lane_connectivity_ =
-      reinterpret_cast<LaneConnectivity*>(tile_ptr + header_->lane_connectivity_offset());
-  lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
+      reinterpret_cast<LaneConnectivity*>(cold_ptr + header_->lane_connectivity_offset());
+  lane_connectivity_size_ = cold_end - header_->lane_connectivity_offset();
 
   // Start of predicted speed data.
   if (header_->predictedspeeds_count() > 0) {
@@ -311,10 +443,24 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr, const size_t
     char* ptr2 = ptr1 + (header_->directededgecount() * sizeof(int32_t));
     predictedspeeds_.set_offset(reinterpret_cast<uint32_t*>(ptr1));
     predictedspeeds_.set_profiles(reinterpret_cast<int16_t*>(ptr2));
+  }
 
-    lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
-  } else {
-    lane_connectivity_size_ = header_->end_offset() - header_->lane_connectivity_offset();
+  // Bounding boxes of the edges in the bins
+  bin_bounds_ = header_->bin_bounds_offset() > 0
+                    ? reinterpret_cast<BinBounds*>(tile_ptr + header_->bin_bounds_offset())
+                    : nullptr;
+
+  // Edges superseded by the shortcuts
+  shortcut_expansions_ = nullptr;
+  shortcut_expansion_count_ = 0;
+  shortcut_edges_ = nullptr;
+  if (header_->shortcut_expansions_offset() > 0) {
+    const auto* counts =
+        reinterpret_cast<const uint32_t*>(tile_ptr + header_->shortcut_expansions_offset());
+    shortcut_expansion_count_ = counts[0];
+    shortcut_expansions_ = reinterpret_cast<ShortcutExpansion*>(
+        tile_ptr + header_->shortcut_expansions_offset() + 2 * sizeof(uint32_t));
+    shortcut_edges_ = reinterpret_cast<GraphId*>(shortcut_expansions_ + counts[0] + 1);
   }
 
   // For reference - how to use the end offset to set size of an object (that
@@ -323,6 +469,9 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr, const size_t
 
   // ANY NEW EXPANSION DATA GOES HERE
 
+  // Index the departures of the transit lines
+  IndexTransitLines();
+
   // Associate one stop Ids for transit tiles
   if (graphid.level() == 3) {
     AssociateOneStopIds(graphid);
@@ -558,7 +707,7 @@ iterable_t<const DirectedEdge> GraphTile::GetDirectedEdges(const GraphId& node)
 iterable_t<const DirectedEdge> GraphTile::GetDirectedEdges(const size_t idx) const {
   if (idx < header_->nodecount()) {
     const auto& nodeinfo = nodes_[idx];
-    const auto* edge = directededge(nodeinfo.edge_index());
+    const auto* edge = directededge_unchecked(nodeinfo.edge_index());
     return iterable_t<const DirectedEdge>{edge, nodeinfo.edge_count()};
   }
   throw std::runtime_error(
@@ -568,8 +717,14 @@ iterable_t<const DirectedEdge> GraphTile::GetDirectedEdges(const size_t idx) con
       " nodecount= " + std::to_string(header_->nodecount()));
 }
 
+// Inflate the compressed sections unless another copy of the tile already did
+void GraphTile::InflateCompressedSections() const {
+  cold_->inflate();
+}
+
 // Get a pointer to edge info.
 EdgeInfo GraphTile::edgeinfo(const size_t offset) const {
+  InflateColdSections();
   return EdgeInfo(edgeinfo_ + offset, textlist_, textlist_size_);
 }
 
@@ -577,27 +732,11 @@ EdgeInfo GraphTile::edgeinfo(const size_t offset) const {
 // the id and modes.
 std::vector<ComplexRestriction*>
 GraphTile::GetRestrictions(const bool forward, const GraphId id, const uint64_t modes) const {
-  size_t offset = 0;
   std::vector<ComplexRestriction*> cr_vector;
-  if (forward) {
-    while (offset < complex_restriction_forward_size_) {
-      ComplexRestriction* cr =
-          reinterpret_cast<ComplexRestriction*>(complex_restriction_forward_ + offset);
-      if (cr->to_graphid() == id && (cr->modes() & modes)) {
-        cr_vector.push_back(cr);
-      }
-      offset += cr->SizeOf();
-    }
-  } else {
-    while (offset < complex_restriction_reverse_size_) {
-      ComplexRestriction* cr =
-          reinterpret_cast<ComplexRestriction*>(complex_restriction_reverse_ + offset);
-      if (cr->from_graphid() == id && (cr->modes() & modes)) {
-        cr_vector.push_back(cr);
-      }
-      offset += cr->SizeOf();
-    }
-  }
+  ForEachRestriction(forward, id, modes, [&cr_vector](const ComplexRestriction* cr) {
+    cr_vector.push_back(const_cast<ComplexRestriction*>(cr));
+    return true;
+  });
   return cr_vector;
 }
 
@@ -607,7 +746,7 @@ GraphTile::GetDirectedEdges(const uint32_t node_index, uint32_t& count, uint32_t
   const NodeInfo* nodeinfo = node(node_index);
   count = nodeinfo->edge_count();
   edge_index = nodeinfo->edge_index();
-  return directededge(nodeinfo->edge_index());
+  return directededge_unchecked(nodeinfo->edge_index());
 }
 
 // Convenience method to get the names for an edge given the offset to the
@@ -626,6 +765,7 @@ uint16_t GraphTile::GetTypes(const uint32_t edgeinfo_offset) const {
 AdminInfo GraphTile::admininfo(const size_t idx) const {
   if (idx < header_->admincount()) {
     const Admin& admin = admins_[idx];
+    InflateColdSections();
     return AdminInfo(textlist_ + admin.country_offset(), textlist_ + admin.state_offset(),
                      admin.country_iso(), admin.state_iso());
   }
@@ -643,6 +783,7 @@ const Admin* GraphTile::admin(const size_t idx) const {
 // Convenience method to get the text/name for a given offset to the textlist
 std::string GraphTile::GetName(const uint32_t textlist_offset) const {
   if (textlist_offset < textlist_size_) {
+    InflateColdSections();
     return textlist_ + textlist_offset;
   } else {
     throw std::runtime_error("GetName: offset exceeds size of text list");
@@ -681,6 +822,7 @@ std::vector<SignInfo> GraphTile::GetSigns(const uint32_t idx, bool signs_on_node
   }
 
   // Add signs
+  InflateColdSections();
   for (; found < count && signs_[found].index() == idx; ++found) {
     if (signs_[found].text_offset() < textlist_size_) {
       // Skip tagged text strings (Future code is needed to handle tagged strings)
@@ -706,43 +848,63 @@ std::vector<SignInfo> GraphTile::GetSigns(const uint32_t idx, bool signs_on_node
 
 // Get lane connections ending on this edge.
 std::vector<LaneConnectivity> GraphTile::GetLaneConnectivity(const uint32_t idx) const {
+  auto range = GetLaneConnectivityRange(idx);
+  if (range.size() == 0) {
+    LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
+  }
+  return std::vector<LaneConnectivity>(range.begin(), range.end());
+}
+
+// Get lane connections ending on this edge in place in the tile.
+midgard::iterable_t<const LaneConnectivity>
+GraphTile::GetLaneConnectivityRange(const uint32_t idx) const {
   uint32_t count = lane_connectivity_size_ / sizeof(LaneConnectivity);
-  std::vector<LaneConnectivity> lcs;
+  const LaneConnectivity* begin = lane_connectivity_;
   if (count == 0) {
-    LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
-    return lcs;
+    return {begin, begin};
   }
+  InflateColdSections();
 
   // Lane connections are sorted by edge index.
-  // Binary search to find a sign with matching edge index.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& lc = lane_connectivity_[mid];
-    // matching edge index
-    if (idx == lc.to()) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller index
-    else if (idx < lc.to()) {
-      high = mid - 1;
-    } // need a bigger index
-    else {
-      low = mid + 1;
-    }
+  const LaneConnectivity* end = begin + count;
+  const LaneConnectivity* first =
+      std::lower_bound(begin, end, idx, [](const LaneConnectivity& lc, const uint32_t index) {
+        return lc.to() < index;
+      });
+  const auto* last = first;
+  while (last != end && last->to() == idx) {
+    ++last;
   }
+  return {first, last};
+}
 
-  // Add Lane connections
-  for (; found < count && lane_connectivity_[found].to() == idx; ++found) {
-    lcs.emplace_back(lane_connectivity_[found]);
-  }
-  if (lcs.size() == 0) {
-    LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
+// Index the departures of each transit line
+void GraphTile::IndexTransitLines() {
+  transit_lines_.clear();
+  departure_times_.clear();
+  uint32_t count = header_->departurecount();
+  departure_times_.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& dep = departures_[i];
+    departure_times_.push_back(dep.departure_time());
+    if (transit_lines_.empty() || transit_lines_.back().lineid != dep.lineid()) {
+      transit_lines_.push_back({dep.lineid(), i, i, i});
+    }
+    auto& line = transit_lines_.back();
+    if (dep.type() == kFixedSchedule) {
+      line.frequency = i + 1;
+    }
+    line.end = i + 1;
   }
-  return lcs;
+}
+
+// Get where the departures of a transit line are
+const GraphTile::transit_line_t* GraphTile::GetTransitLine(const uint32_t lineid) const {
+  auto line = std::lower_bound(transit_lines_.begin(), transit_lines_.end(), lineid,
+                               [](const transit_line_t& line, const uint32_t lineid) {
+                                 return line.lineid < lineid;
+                               });
+  return line == transit_lines_.end() || line->lineid != lineid ? nullptr : &*line;
 }
 
 // Get the next departure given the directed line Id and the current
@@ -754,134 +916,96 @@ const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
                                                     bool date_before_tile,
                                                     bool wheelchair,
                                                     bool bicycle) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
+  const auto* line = GetTransitLine(lineid);
+  if (line == nullptr) {
     return nullptr;
   }
 
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    // matching lineid and a workable time
-    if (lineid == dep.lineid() &&
-        ((current_time <= dep.departure_time() && dep.type() == kFixedSchedule) ||
-         (current_time <= dep.end_time() && dep.type() == kFrequencySchedule))) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    } // either need a bigger lineid or a later time
-    else {
-      low = mid + 1;
+  // Whether a departure runs on the day and carries what is needed
+  const auto runs = [&](const TransitDeparture& dep) {
+    return GetTransitSchedule(dep.schedule_index())->IsValid(day, dow, date_before_tile) &&
+           (!wheelchair || dep.wheelchair_accessible()) && (!bicycle || dep.bicycle_accessible());
+  };
+
+  // Search the fixed departures of the line by time, the first one at or after the current time
+  // that runs on the day is the next
+  const TransitDeparture* next = nullptr;
+  auto first = std::lower_bound(departure_times_.begin() + line->begin,
+                                departure_times_.begin() + line->frequency, current_time);
+  for (uint32_t i = first - departure_times_.begin(); i < line->frequency; ++i) {
+    if (runs(departures_[i])) {
+      next = &departures_[i];
+      break;
     }
   }
 
-  // Iterate through departures until one is found with valid date, dow or
-  // calendar date, and does not have a calendar exception.
-  for (; found < count && departures_[found].lineid() == lineid; ++found) {
-    // Make sure valid departure time
-    if (departures_[found].type() == kFixedSchedule) {
-      if (departures_[found].departure_time() >= current_time &&
-          GetTransitSchedule(departures_[found].schedule_index())
-              ->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
-        return &departures_[found];
-      }
-    } else {
-      uint32_t departure_time = departures_[found].departure_time();
-      uint32_t end_time = departures_[found].end_time();
-      uint32_t frequency = departures_[found].frequency();
-      while (departure_time < current_time && departure_time < end_time) {
-        departure_time += frequency;
-      }
-
-      if (departure_time >= current_time && departure_time < end_time &&
-          GetTransitSchedule(departures_[found].schedule_index())
-              ->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
-
-        const auto& d = departures_[found];
-        const TransitDeparture* dep =
-            new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
-                                 d.headsign_offset(), departure_time, d.end_time(), d.frequency(),
-                                 d.elapsed_time(), d.schedule_index(), d.wheelchair_accessible(),
-                                 d.bicycle_accessible());
-        return dep;
+  // Frequency based departures leave every so often until their end time, take the earliest
+  // run leaving before the next fixed departure
+  uint32_t next_time =
+      next == nullptr ? std::numeric_limits<uint32_t>::max() : next->departure_time();
+  uint32_t frequency_index = line->end;
+  for (uint32_t i = line->frequency; i < line->end; ++i) {
+    const auto& d = departures_[i];
+    uint32_t departure_time = d.departure_time();
+    if (departure_time < current_time) {
+      if (d.frequency() == 0) {
+        continue;
       }
+      departure_time += (current_time - departure_time + d.frequency() - 1) / d.frequency() *
+                        d.frequency();
+    }
+    if (departure_time < d.end_time() && departure_time < next_time && runs(d)) {
+      next_time = departure_time;
+      frequency_index = i;
     }
   }
+  if (frequency_index != line->end) {
+    const auto& d = departures_[frequency_index];
+    return new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
+                                d.headsign_offset(), next_time, d.end_time(), d.frequency(),
+                                d.elapsed_time(), d.schedule_index(), d.wheelchair_accessible(),
+                                d.bicycle_accessible());
+  }
 
   // TODO - maybe wrap around, try next day?
-  LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
-            " current_time = " + std::to_string(current_time));
-  return nullptr;
+  if (next == nullptr) {
+    LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
+              " current_time = " + std::to_string(current_time));
+  }
+  return next;
 }
 
 // Get the departure given the line Id and tripid
 const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
                                                        const uint32_t tripid,
                                                        const uint32_t current_time) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
-    return nullptr;
-  }
-
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    // find the first matching lineid in the list
-    if (lineid == dep.lineid() &&
-        ((current_time <= dep.departure_time() && dep.type() == kFixedSchedule) ||
-         (current_time <= dep.end_time() && dep.type() == kFrequencySchedule))) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    } // need a bigger lineid
-    else {
-      low = mid + 1;
+  const auto* line = GetTransitLine(lineid);
+  if (line != nullptr) {
+    // The fixed departure of the trip at or after the current time
+    auto first = std::lower_bound(departure_times_.begin() + line->begin,
+                                  departure_times_.begin() + line->frequency, current_time);
+    for (uint32_t i = first - departure_times_.begin(); i < line->frequency; ++i) {
+      if (departures_[i].tripid() == tripid) {
+        return &departures_[i];
+      }
     }
-  }
 
-  // Iterate through departures until one is found with matching trip id
-  for (; found < count && departures_[found].lineid() == lineid; ++found) {
-    if (departures_[found].tripid() == tripid) {
-
-      if (departures_[found].type() == kFixedSchedule) {
-        return &departures_[found];
+    // Or the run of a frequency based trip at or after the current time
+    for (uint32_t i = line->frequency; i < line->end; ++i) {
+      const auto& d = departures_[i];
+      if (d.tripid() != tripid || current_time > d.end_time()) {
+        continue;
       }
-
-      uint32_t departure_time = departures_[found].departure_time();
-      uint32_t end_time = departures_[found].end_time();
-      uint32_t frequency = departures_[found].frequency();
-      while (departure_time < current_time && departure_time < end_time) {
-        departure_time += frequency;
+      uint32_t departure_time = d.departure_time();
+      if (departure_time < current_time && d.frequency() > 0) {
+        departure_time += (current_time - departure_time + d.frequency() - 1) / d.frequency() *
+                          d.frequency();
       }
-
-      if (departure_time >= current_time && departure_time < end_time) {
-        const auto& d = departures_[found];
-        const TransitDeparture* dep =
-            new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
-                                 d.headsign_offset(), departure_time, d.end_time(), d.frequency(),
-                                 d.elapsed_time(), d.schedule_index(), d.wheelchair_accessible(),
-                                 d.bicycle_accessible());
-        return dep;
+      if (departure_time >= current_time && departure_time < d.end_time()) {
+        return new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
+                                    d.headsign_offset(), departure_time, d.end_time(),
+                                    d.frequency(), d.elapsed_time(), d.schedule_index(),
+                                    d.wheelchair_accessible(), d.bicycle_accessible());
       }
     }
   }
@@ -893,14 +1017,11 @@ const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
 
 // Get a map of departures based on lineid.  No dups exist in the map.
 std::unordered_map<uint32_t, TransitDeparture*> GraphTile::GetTransitDepartures() const {
-
   std::unordered_map<uint32_t, TransitDeparture*> deps;
-  deps.reserve(header_->departurecount());
-
-  for (uint32_t i = 0; i < header_->departurecount(); i++) {
-    deps.insert({departures_[i].lineid(), &departures_[i]});
+  deps.reserve(transit_lines_.size());
+  for (const auto& line : transit_lines_) {
+    deps.emplace(line.lineid, &departures_[line.begin]);
   }
-
   return deps;
 }
 
@@ -961,43 +1082,31 @@ const TransitSchedule* GraphTile::GetTransitSchedule(const uint32_t idx) const {
 // Get the access restriction given its directed edge index
 std::vector<AccessRestriction> GraphTile::GetAccessRestrictions(const uint32_t idx,
                                                                 const uint32_t access) const {
-
+  // Add restrictions for only the access that we are interested in
   std::vector<AccessRestriction> restrictions;
-  uint32_t count = header_->access_restriction_count();
-  if (count == 0) {
-    return restrictions;
-  }
-
-  // Access restriction are sorted by edge Id.
-  // Binary search to find a access restriction with matching edge Id.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& res = access_restrictions_[mid];
-    // find the first matching index in the list
-    if (idx == res.edgeindex()) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller index
-    else if (idx < res.edgeindex()) {
-      high = mid - 1;
-    } // need a bigger index
-    else {
-      low = mid + 1;
+  for (const auto& restriction : GetAccessRestrictionRange(idx)) {
+    if (restriction.modes() & access) {
+      restrictions.emplace_back(restriction);
     }
   }
+  return restrictions;
+}
 
-  // Add restrictions for only the access that we are interested in
-  for (; found < count && access_restrictions_[found].edgeindex() == idx; ++found) {
-    if (access_restrictions_[found].modes() & access) {
-      restrictions.emplace_back(access_restrictions_[found]);
-    }
+// Get the access restrictions of an edge in place in the tile.
+midgard::iterable_t<const AccessRestriction>
+GraphTile::GetAccessRestrictionRange(const uint32_t idx) const {
+  // Access restriction are sorted by edge Id.
+  const AccessRestriction* begin = access_restrictions_;
+  const AccessRestriction* end = begin + header_->access_restriction_count();
+  const AccessRestriction* first =
+      std::lower_bound(begin, end, idx, [](const AccessRestriction& res, const uint32_t index) {
+        return res.edgeindex() < index;
+      });
+  const auto* last = first;
+  while (last != end && last->edgeindex() == idx) {
+    ++last;
   }
-
-  return restrictions;
+  return {first, last};
 }
 
 // Get the array of graphids for this bin
@@ -1011,6 +1120,32 @@ midgard::iterable_t<GraphId> GraphTile::GetBin(size_t index) const {
   return iterable_t<GraphId>{edge_bins_ + offsets.first, edge_bins_ + offsets.second};
 }
 
+midgard::iterable_t<BinBounds> GraphTile::GetBinBounds(size_t index) const {
+  if (bin_bounds_ == nullptr) {
+    return iterable_t<BinBounds>{bin_bounds_, bin_bounds_};
+  }
+  auto offsets = header_->bin_offset(index);
+  return iterable_t<BinBounds>{bin_bounds_ + offsets.first, bin_bounds_ + offsets.second};
+}
+
+midgard::PointLL GraphTile::GetBinCorner(size_t index) const {
+  auto bin_size = TileHierarchy::levels().rbegin()->second.tiles.TileSize() / kBinsDim;
+  return midgard::PointLL(header_->base_ll().lng() + (index % kBinsDim) * bin_size,
+                          header_->base_ll().lat() + (index / kBinsDim) * bin_size);
+}
+
+midgard::iterable_t<GraphId> GraphTile::GetShortcutEdges(const uint32_t idx) const {
+  auto end = shortcut_expansions_ + shortcut_expansion_count_;
+  auto found = std::lower_bound(shortcut_expansions_, end, idx,
+                                [](const ShortcutExpansion& expansion, const uint32_t idx) {
+                                  return expansion.shortcut < idx;
+                                });
+  if (found == end || found->shortcut != idx) {
+    return iterable_t<GraphId>{shortcut_edges_, shortcut_edges_};
+  }
+  return iterable_t<GraphId>{shortcut_edges_ + found->first, shortcut_edges_ + (found + 1)->first};
+}
+
 // Get turn lanes for this edge.
 uint32_t GraphTile::turnlanes_offset(const uint32_t idx) const {
   uint32_t count = header_->turnlane_count();
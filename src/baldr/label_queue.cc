@@ -0,0 +1,51 @@
+#include "baldr/label_queue.h"
+#include "baldr/double_bucket_queue.h"
+#include "baldr/radix_queue.h"
+
+namespace valhalla {
+namespace baldr {
+
+// Creates a queue of the requested type
+std::shared_ptr<LabelQueue> make_label_queue(const LabelQueueType type,
+                                             const float mincost,
+                                             const float range,
+                                             const uint32_t bucketsize,
+                                             const LabelCost& labelcost) {
+  switch (type) {
+    case LabelQueueType::kRadixHeap:
+      return std::make_shared<RadixQueue>(mincost, labelcost);
+    case LabelQueueType::kDoubleBucket:
+    default:
+      return std::make_shared<DoubleBucketQueue>(mincost, range, bucketsize, labelcost);
+  }
+}
+
+// Reuses the queue if it is of the requested type, creates a new one otherwise
+void reuse_label_queue(std::shared_ptr<LabelQueue>& queue,
+                       const LabelQueueType type,
+                       const float mincost,
+                       const float range,
+                       const uint32_t bucketsize,
+                       const LabelCost& labelcost) {
+  if (queue && queue->type() == type) {
+    queue->reuse(mincost, range, bucketsize, labelcost);
+  } else {
+    queue = make_label_queue(type, mincost, range, bucketsize, labelcost);
+  }
+}
+
+// Parses the configuration name of a queue type
+bool parse_label_queue_type(const std::string& name, LabelQueueType& type) {
+  if (name == "double_bucket") {
+    type = LabelQueueType::kDoubleBucket;
+    return true;
+  }
+  if (name == "radix_heap") {
+    type = LabelQueueType::kRadixHeap;
+    return true;
+  }
+  return false;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,109 @@
+#include "baldr/landmarks.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Identifies landmark files and their layout version
+constexpr uint32_t kLandmarksMagic = 0x31544c41; // "ALT1"
+
+template <typename T> void write_vector(std::ofstream& out, const std::vector<T>& v) {
+  uint64_t count = v.size();
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char*>(v.data()), count * sizeof(T));
+}
+
+template <typename T> bool read_vector(std::ifstream& in, std::vector<T>& v) {
+  uint64_t count = 0;
+  if (!in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+    return false;
+  }
+  v.resize(count);
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(v.data()), count * sizeof(T)));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::string Landmarks::file_name(const std::string& tile_dir, const std::string& mode) {
+  return tile_dir + "/landmarks/" + mode + ".alt";
+}
+
+std::shared_ptr<const Landmarks> Landmarks::load(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    return nullptr;
+  }
+
+  uint32_t magic = 0;
+  auto landmarks = std::make_shared<Landmarks>();
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char*>(&landmarks->access), sizeof(landmarks->access));
+  in.read(reinterpret_cast<char*>(&landmarks->count), sizeof(landmarks->count));
+  in.read(reinterpret_cast<char*>(&landmarks->resolution), sizeof(landmarks->resolution));
+  if (!in || magic != kLandmarksMagic || !read_vector(in, landmarks->landmarks) ||
+      !read_vector(in, landmarks->tiles) || !read_vector(in, landmarks->offsets) ||
+      !read_vector(in, landmarks->values)) {
+    LOG_ERROR("Invalid landmarks file: " + file);
+    return nullptr;
+  }
+
+  // Sanity check the layout so lookups can index without checking
+  if (landmarks->landmarks.size() != landmarks->count || landmarks->resolution <= 0.f ||
+      landmarks->offsets.size() != landmarks->tiles.size() + 1 ||
+      landmarks->values.size() != size_t(landmarks->offsets.back()) * 2 * landmarks->count) {
+    LOG_ERROR("Inconsistent landmarks file: " + file);
+    return nullptr;
+  }
+  return landmarks;
+}
+
+void Landmarks::write(const std::string& file) const {
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + file + " for writing");
+  }
+  out.write(reinterpret_cast<const char*>(&kLandmarksMagic), sizeof(kLandmarksMagic));
+  out.write(reinterpret_cast<const char*>(&access), sizeof(access));
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char*>(&resolution), sizeof(resolution));
+  write_vector(out, landmarks);
+  write_vector(out, tiles);
+  write_vector(out, offsets);
+  write_vector(out, values);
+}
+
+const uint16_t* Landmarks::lengths(const GraphId& node) const {
+  auto itr = std::lower_bound(tiles.begin(), tiles.end(), node.Tile_Base().value);
+  if (itr == tiles.end() || *itr != node.Tile_Base().value) {
+    return nullptr;
+  }
+  auto tile = itr - tiles.begin();
+  auto index = offsets[tile] + node.id();
+  return index < offsets[tile + 1] ? values.data() + size_t(index) * 2 * count : nullptr;
+}
+
+float Landmarks::LowerBound(const uint16_t* from, const uint16_t* to) const {
+  // by the triangle inequality the path is at least as long as the difference of the lengths
+  // from a landmark to either end and of the lengths from either end to a landmark. the stored
+  // lengths are rounded down so one unit is taken off each difference
+  int32_t bound = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (from[i] != kUnreachedLandmark && to[i] != kUnreachedLandmark) {
+      bound = std::max(bound, to[i] - from[i] - 1);
+    }
+    auto j = count + i;
+    if (from[j] != kUnreachedLandmark && to[j] != kUnreachedLandmark) {
+      bound = std::max(bound, from[j] - to[j] - 1);
+    }
+  }
+  return bound * resolution;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -2,7 +2,11 @@
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/range/adaptor/map.hpp>
+#include <exception>
+#include <thread>
 #include <utility>
 
 namespace bra = boost::adaptors;
@@ -93,18 +97,20 @@ private:
 
 namespace detail {
 
-edge_collapser::edge_collapser(GraphReader& reader,
-                               edge_tracker& tracker,
-                               std::function<bool(const DirectedEdge*)> edge_merge_pred,
-                               std::function<bool(const DirectedEdge*)> edge_allowed_pred,
-                               std::function<void(const path&)> func)
+template <typename tracker_t>
+edge_collapser<tracker_t>::edge_collapser(GraphReader& reader,
+                                          tracker_t& tracker,
+                                          std::function<bool(const DirectedEdge*)> edge_merge_pred,
+                                          std::function<bool(const DirectedEdge*)> edge_allowed_pred,
+                                          std::function<void(const path&)> func)
     : m_reader(reader), m_tracker(tracker), m_edge_merge_predicate(std::move(edge_merge_pred)),
       m_edge_allowed_predicate(std::move(edge_allowed_pred)), m_func(std::move(func)) {
 }
 
 // returns the pair of nodes reachable from the given @node_id where they
 // are the only two nodes reachable based on the predicate methods.
-std::pair<GraphId, GraphId> edge_collapser::nodes_reachable_from(GraphId node_id) {
+template <typename tracker_t>
+std::pair<GraphId, GraphId> edge_collapser<tracker_t>::nodes_reachable_from(GraphId node_id) {
   static const std::pair<GraphId, GraphId> none;
   GraphId first, second;
 
@@ -148,7 +154,8 @@ std::pair<GraphId, GraphId> edge_collapser::nodes_reachable_from(GraphId node_id
   }
 }
 
-GraphId edge_collapser::next_node_id(GraphId last_node_id, GraphId node_id) {
+template <typename tracker_t>
+GraphId edge_collapser<tracker_t>::next_node_id(GraphId last_node_id, GraphId node_id) {
   //
   //        -->--     -->--
   //   \   /  e4 \   /  e1 \   /
@@ -171,7 +178,8 @@ GraphId edge_collapser::next_node_id(GraphId last_node_id, GraphId node_id) {
 
 // Get the edge Id between 2 nodes. Will return an invalid edge Id if there
 // is no "allowed" edge between the 2 nodes.
-GraphId edge_collapser::edge_between(GraphId cur, GraphId next) {
+template <typename tracker_t>
+GraphId edge_collapser<tracker_t>::edge_between(GraphId cur, GraphId next) {
   // Get the tile of the current node, return none if the tile is not found
   const GraphTile* tile = m_reader.GetGraphTile(cur);
   if (tile == nullptr) {
@@ -191,7 +199,7 @@ GraphId edge_collapser::edge_between(GraphId cur, GraphId next) {
 // before and have exactly two out-edges.
 //
 // the user-defined function is called for each path found.
-void edge_collapser::explore(GraphId node_id) {
+template <typename tracker_t> void edge_collapser<tracker_t>::explore(GraphId node_id) {
   auto nodes = nodes_reachable_from(node_id);
   if (!nodes.first || !nodes.second) {
     return;
@@ -223,7 +231,8 @@ void edge_collapser::explore(GraphId node_id) {
 // walk in a single direction, using the "direction" given by two nodes to
 // select which edge is considered to be "forward". Returns true if a loop
 // is found, otherwise returns false.
-bool edge_collapser::explore(GraphId prev, GraphId cur, path& forward, path& reverse) {
+template <typename tracker_t>
+bool edge_collapser<tracker_t>::explore(GraphId prev, GraphId cur, path& forward, path& reverse) {
   const auto original_node_id = prev;
 
   GraphId maybe_next;
@@ -266,6 +275,122 @@ bool edge_collapser::explore(GraphId prev, GraphId cur, path& forward, path& rev
   return false;
 }
 
+// walks the same nodes as explore without marking any edges. the walk can't run on forever because
+// every node on it has exactly two neighbours, so it either ends or comes back to where it started
+template <typename tracker_t> bool edge_collapser<tracker_t>::stays_in_tile(GraphId node_id) {
+  const auto tile_id = node_id.Tile_Base();
+  auto nodes = nodes_reachable_from(node_id);
+  for (auto cur : {nodes.first, nodes.second}) {
+    GraphId prev = node_id;
+    while (cur && cur != node_id) {
+      if (cur.Tile_Base() != tile_id) {
+        return false;
+      }
+      auto next = next_node_id(prev, cur);
+      prev = cur;
+      cur = next;
+    }
+  }
+  return true;
+}
+
+template struct edge_collapser<edge_tracker>;
+template struct edge_collapser<concurrent_edge_tracker>;
+
+void parallel_merge(const std::vector<GraphId>& tiles,
+                    const std::function<std::unique_ptr<GraphReader>()>& make_reader,
+                    size_t threads,
+                    const std::function<bool(const DirectedEdge*)>& edge_merge_pred,
+                    const std::function<bool(const DirectedEdge*)>& edge_allowed_pred,
+                    const std::function<void(const path&)>& func) {
+  threads = std::max(threads, size_t(1));
+  std::vector<std::unique_ptr<GraphReader>> readers;
+  for (size_t i = 0; i < threads; ++i) {
+    readers.emplace_back(make_reader());
+  }
+  auto tracker = concurrent_edge_tracker::create(tiles, *readers.front());
+
+  // runs the work on each tile, the threads take the next tile until there are none left
+  auto for_each_tile = [&](const std::function<void(GraphReader&, size_t)>& work) {
+    std::atomic<size_t> next_tile(0);
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < threads; ++i) {
+      pool.emplace_back([&, i]() {
+        try {
+          for (size_t t = next_tile++; t < tiles.size(); t = next_tile++) {
+            work(*readers[i], t);
+            if (readers[i]->OverCommitted()) {
+              readers[i]->Trim();
+            }
+          }
+        } catch (...) { errors[i] = std::current_exception(); }
+      });
+    }
+    for (auto& thread : pool) {
+      thread.join();
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  };
+
+  // first walk the paths that stay in one tile, each tile is only worked on by one thread so none
+  // of these paths are walked twice. the nodes whose paths leave their tile are kept for later
+  std::vector<std::vector<GraphId>> crossing(tiles.size());
+  for_each_tile([&](GraphReader& reader, size_t t) {
+    edge_collapser<concurrent_edge_tracker> e(reader, tracker, edge_merge_pred, edge_allowed_pred,
+                                              func);
+    const auto* tile = reader.GetGraphTile(tiles[t]);
+    uint32_t node_count = tile->header()->nodecount();
+    GraphId node_id(tiles[t].tileid(), tiles[t].level(), 0);
+    for (uint32_t i = 0; i < node_count; ++i, ++node_id) {
+      if (e.stays_in_tile(node_id)) {
+        e.explore(node_id);
+      } else {
+        crossing[t].push_back(node_id);
+      }
+    }
+  });
+
+  // then walk the paths that cross from one tile to another on a single thread
+  {
+    auto& reader = *readers.front();
+    edge_collapser<concurrent_edge_tracker> e(reader, tracker, edge_merge_pred, edge_allowed_pred,
+                                              func);
+    for (auto& nodes : crossing) {
+      for (const auto& node_id : nodes) {
+        e.explore(node_id);
+      }
+      nodes = std::vector<GraphId>();
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+
+  // the single edges that remain are only read from the tracker so the threads can share them out
+  for_each_tile([&](GraphReader& reader, size_t t) {
+    const auto* tile = reader.GetGraphTile(tiles[t]);
+    const auto num_edges = tile->header()->directededgecount();
+    GraphId edge_id(tiles[t].tileid(), tiles[t].level(), 0);
+    for (uint32_t i = 0; i < num_edges; ++i, ++edge_id) {
+      if (!tracker.get(edge_id)) {
+        auto* edge = tile->directededge(edge_id);
+        if (edge_allowed_pred(edge)) {
+          auto end_nodes = reader.GetDirectedEdgeNodes(tile, edge);
+          path p(segment(end_nodes.first, edge_id, end_nodes.second));
+          if (p.m_start.Is_Valid()) {
+            func(p);
+          }
+        }
+      }
+    }
+  });
+}
+
 } // namespace detail
 
 segment::segment(GraphId start, GraphId edge, GraphId end)
@@ -0,0 +1,139 @@
+#include "baldr/shardmap.h"
+#include "baldr/json.h"
+#include "baldr/tilehierarchy.h"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace valhalla::midgard;
+
+namespace valhalla {
+namespace baldr {
+
+ShardMap::ShardMap() : border_(0.f) {
+}
+
+ShardMap::ShardMap(const boost::property_tree::ptree& pt) : border_(pt.get<float>("border", 0.f)) {
+  for (const auto& shard : pt.get_child("shards")) {
+    std::vector<float> bbox;
+    for (const auto& coord : shard.second.get_child("bbox")) {
+      bbox.push_back(coord.second.get_value<float>());
+    }
+    if (bbox.size() != 4 || bbox[0] >= bbox[2] || bbox[1] >= bbox[3]) {
+      throw std::runtime_error("The bbox of a shard must be [minx, miny, maxx, maxy]");
+    }
+    shards_.push_back({shard.second.get<std::string>("name"),
+                       {bbox[0], bbox[1], bbox[2], bbox[3]},
+                       shard.second.get<std::string>("url", "")});
+  }
+}
+
+ShardMap ShardMap::Grid(const AABB2<PointLL>& bounds,
+                        const uint32_t columns,
+                        const uint32_t rows,
+                        const float border,
+                        const std::string& url) {
+  if (columns == 0 || rows == 0) {
+    throw std::runtime_error("A grid of shards needs at least one column and row");
+  }
+  ShardMap map;
+  map.border_ = border;
+  float width = bounds.Width() / columns;
+  float height = bounds.Height() / rows;
+  for (uint32_t row = 0; row < rows; ++row) {
+    for (uint32_t column = 0; column < columns; ++column) {
+      auto name = std::to_string(column) + '_' + std::to_string(row);
+      auto shard_url = url;
+      auto pattern = shard_url.find("{name}");
+      if (pattern != std::string::npos) {
+        shard_url.replace(pattern, 6, name);
+      }
+      // the last column and row end at the bounds so rounding leaves no gap
+      AABB2<PointLL> region(bounds.minx() + column * width, bounds.miny() + row * height,
+                            column + 1 == columns ? bounds.maxx()
+                                                  : bounds.minx() + (column + 1) * width,
+                            row + 1 == rows ? bounds.maxy() : bounds.miny() + (row + 1) * height);
+      map.shards_.push_back({name, region, shard_url});
+    }
+  }
+  return map;
+}
+
+int32_t ShardMap::Index(const std::string& name) const {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    if (shards_[i].name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+AABB2<PointLL> ShardMap::Bounds(const size_t shard) const {
+  const auto& region = shards_[shard].region;
+  return {region.minx() - border_, region.miny() - border_, region.maxx() + border_,
+          region.maxy() + border_};
+}
+
+bool ShardMap::Keeps(const size_t shard, const GraphId& tile) const {
+  // every shard has the whole highway network
+  const auto& levels = TileHierarchy::levels();
+  if (tile.level() == levels.begin()->first) {
+    return true;
+  }
+  // transit tiles are tiled like the local level
+  const auto& transit = TileHierarchy::GetTransitLevel();
+  const auto& tiles = tile.level() == transit.level ? transit.tiles : levels.at(tile.level()).tiles;
+  return Bounds(shard).Intersects(tiles.TileBounds(tile.tileid()));
+}
+
+int32_t ShardMap::Find(const std::vector<PointLL>& points) const {
+  if (points.empty()) {
+    return -1;
+  }
+  // the shard of the origin wins ties so start from it
+  int32_t best = -1;
+  size_t most = 0;
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    if (shards_[i].region.Contains(points.front())) {
+      best = i;
+      break;
+    }
+  }
+  if (best != -1) {
+    auto bounds = Bounds(best);
+    for (const auto& point : points) {
+      most += bounds.Contains(point);
+    }
+  }
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    auto bounds = Bounds(i);
+    size_t count = 0;
+    for (const auto& point : points) {
+      count += bounds.Contains(point);
+    }
+    if (count > most) {
+      best = i;
+      most = count;
+    }
+  }
+  return best;
+}
+
+std::string ShardMap::ToJson() const {
+  auto shards = json::array({});
+  for (const auto& shard : shards_) {
+    shards->emplace_back(json::map({
+        {"name", shard.name},
+        {"bbox", json::array({json::fp_t{shard.region.minx(), 6}, json::fp_t{shard.region.miny(), 6},
+                              json::fp_t{shard.region.maxx(), 6},
+                              json::fp_t{shard.region.maxy(), 6}})},
+        {"url", shard.url},
+    }));
+  }
+  std::stringstream ss;
+  ss << *json::map({{"border", json::fp_t{border_, 6}}, {"shards", shards}});
+  return ss.str();
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -95,7 +95,8 @@ public:
                      InstanceMethod("traceRoute", &Actor::TraceRoute),
                      InstanceMethod("traceAttributes", &Actor::TraceAttributes),
                      InstanceMethod("height", &Actor::Height),
-                     InstanceMethod("transitAvailable", &Actor::TransitAvailable)});
+                     InstanceMethod("transitAvailable", &Actor::TransitAvailable),
+                     InstanceMethod("expansion", &Actor::Expansion)});
 
     int length = info.Length();
 
@@ -145,6 +146,12 @@ private:
       pt = make_conf(std::string(info[0].As<Napi::String>()).c_str());
     } catch (...) { throw Napi::Error::New(info.Env(), "Unable to parse config"); }
 
+    // the pool of actors works on requests at the same time on the libuv threads, unless the config
+    // already shares a thread safe cache they all read their tiles from the sharded one
+    if (!pt.get<bool>("mjolnir.global_synchronized_cache", false)) {
+      pt.put("mjolnir.use_sharded_tile_cache", true);
+    }
+
     return pt;
   }
 
@@ -8,27 +8,40 @@
 #include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "tyr/actor.h"
+#include "worker.h"
 
 namespace {
 
 // statically set the config file and configure logging, throw if you never configured
 // configuring multiple times is wasteful/ineffectual but not harmful
-// TODO: make this threadsafe just in case its abused
 const boost::property_tree::ptree&
 configure(const boost::optional<std::string>& config = boost::none) {
+  static std::mutex config_mutex;
   static boost::optional<boost::property_tree::ptree> pt;
+  std::lock_guard<std::mutex> lock(config_mutex);
   // if we haven't already loaded one
   if (config && !pt) {
     try {
       // parse the config
       boost::property_tree::ptree temp_pt;
       rapidjson::read_json(config.get(), temp_pt);
+      // every actor of the process, one per python thread or batch thread, reads the same tiles
+      // so unless the config already shares a thread safe cache they share the sharded one
+      if (!temp_pt.get<bool>("mjolnir.global_synchronized_cache", false)) {
+        temp_pt.put("mjolnir.use_sharded_tile_cache", true);
+      }
       pt = temp_pt;
 
       // configure logging
@@ -53,16 +66,128 @@ void py_configure(const std::string& config_file) {
   configure(config_file);
 }
 
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(route_overloads, route, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(locate_overloads, locate, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(optimized_route_overloads, optimized_route, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(matrix_overloads, matrix, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(isochrone_overloads, isochrone, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(trace_route_overloads, trace_route, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(trace_attributes_overloads, trace_attributes, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(height_overloads, height, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(transit_available_overloads, transit_available, 1, 1);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(expansion_overloads, expansion, 1, 1);
+using action_t = std::string (valhalla::tyr::actor_t::*)(const std::string&,
+                                                        const std::function<void()>&);
+
+// lets other python threads run while the calling thread works on requests
+struct gil_release_t {
+  gil_release_t() : state(PyEval_SaveThread()) {
+  }
+  ~gil_release_t() {
+    PyEval_RestoreThread(state);
+  }
+  PyThreadState* state;
+};
+
+// the actor a python Actor wraps plus the ones its batches run on in other threads. an actor is
+// not thread safe so python threads should each make their own, the tiles are shared anyway
+struct py_actor_t {
+  py_actor_t() : actors{std::make_shared<valhalla::tyr::actor_t>(configure(), true)} {
+  }
+  std::vector<std::shared_ptr<valhalla::tyr::actor_t>> actors;
+};
+
+template <action_t action> std::string act(py_actor_t& actor, const std::string& request) {
+  gil_release_t release;
+  return (*actor.actors.front().*action)(request, []() {});
+}
+
+// the error response of a request in a batch, so that one bad request does not lose the others
+std::string batch_error(const valhalla::valhalla_exception_t& e) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("error_code");
+  writer.Uint(e.code);
+  writer.Key("http_code");
+  writer.Uint(e.http_code);
+  writer.Key("message");
+  writer.String(e.message);
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+// runs a list of requests of one action on up to threads threads, 0 meaning one per core, and
+// returns their responses in the same order. requests that fail get their error as the response
+boost::python::list batch(py_actor_t& actor,
+                          const std::string& name,
+                          const boost::python::list& requests,
+                          size_t threads) {
+  static const std::unordered_map<std::string, action_t> actions{
+      {"route", &valhalla::tyr::actor_t::route},
+      {"locate", &valhalla::tyr::actor_t::locate},
+      {"optimized_route", &valhalla::tyr::actor_t::optimized_route},
+      {"sources_to_targets", &valhalla::tyr::actor_t::matrix},
+      {"isochrone", &valhalla::tyr::actor_t::isochrone},
+      {"trace_route", &valhalla::tyr::actor_t::trace_route},
+      {"trace_attributes", &valhalla::tyr::actor_t::trace_attributes},
+      {"height", &valhalla::tyr::actor_t::height},
+      {"transit_available", &valhalla::tyr::actor_t::transit_available},
+      {"expansion", &valhalla::tyr::actor_t::expansion},
+  };
+  auto found = actions.find(name);
+  if (found == actions.cend()) {
+    throw std::runtime_error("Unknown action: " + name);
+  }
+  auto action = found->second;
+
+  // copy the requests out of python before letting go of the interpreter
+  std::vector<std::string> in(boost::python::len(requests));
+  for (size_t i = 0; i < in.size(); ++i) {
+    in[i] = boost::python::extract<std::string>(requests[i]);
+  }
+  std::vector<std::string> out(in.size());
+
+  {
+    gil_release_t release;
+    if (threads == 0) {
+      threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = std::max<size_t>(std::min(threads, in.size()), 1);
+    while (actor.actors.size() < threads) {
+      actor.actors.emplace_back(std::make_shared<valhalla::tyr::actor_t>(configure(), true));
+    }
+
+    // each thread takes the next request until there are none left
+    std::atomic<size_t> next(0);
+    std::exception_ptr failure;
+    std::mutex failure_mutex;
+    auto work = [&](valhalla::tyr::actor_t& worker) {
+      try {
+        for (size_t i = next++; i < in.size(); i = next++) {
+          try {
+            out[i] = (worker.*action)(in[i], []() {});
+          } catch (const valhalla::valhalla_exception_t& e) {
+            worker.cleanup();
+            out[i] = batch_error(e);
+          }
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(failure_mutex);
+        failure = std::current_exception();
+        next = in.size();
+      }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i) {
+      pool.emplace_back(work, std::ref(*actor.actors[i]));
+    }
+    work(*actor.actors.front());
+    for (auto& thread : pool) {
+      thread.join();
+    }
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+
+  boost::python::list responses;
+  for (auto& response : out) {
+    responses.append(response);
+  }
+  return responses;
+}
+
 } // namespace
 
 BOOST_PYTHON_MODULE(valhalla) {
@@ -70,21 +195,22 @@ BOOST_PYTHON_MODULE(valhalla) {
   // python interface for configuring the system, always call this first in your python program
   boost::python::def("Configure", py_configure);
 
-  boost::python::class_<valhalla::tyr::actor_t, boost::noncopyable,
-                        boost::shared_ptr<valhalla::tyr::actor_t>>("Actor", boost::python::no_init)
-      .def("__init__", boost::python::make_constructor(+[]() {
-             return boost::make_shared<valhalla::tyr::actor_t>(configure(), true);
-           }))
-      .def("Route", &valhalla::tyr::actor_t::route, route_overloads())
-      .def("Locate", &valhalla::tyr::actor_t::route, locate_overloads())
-      .def("OptimizedRoute", &valhalla::tyr::actor_t::route, optimized_route_overloads())
-      .def("Matrix", &valhalla::tyr::actor_t::route, matrix_overloads())
-      .def("Isochrone", &valhalla::tyr::actor_t::route, isochrone_overloads())
-      .def("TraceRoute", &valhalla::tyr::actor_t::route, trace_route_overloads())
-      .def("TraceAttributes", &valhalla::tyr::actor_t::route, trace_attributes_overloads())
-      .def("Height", &valhalla::tyr::actor_t::route, height_overloads())
-      .def("TransitAvailable", &valhalla::tyr::actor_t::route, transit_available_overloads())
-      .def("Expansion", &valhalla::tyr::actor_t::route, expansion_overloads())
+  // calls on an actor let go of the GIL while they work, so python threads each using their own
+  // actor run in parallel. Batch runs a list of requests of one action on several threads at once
+  boost::python::class_<py_actor_t, boost::noncopyable, boost::shared_ptr<py_actor_t>>("Actor")
+      .def("Route", &act<&valhalla::tyr::actor_t::route>)
+      .def("Locate", &act<&valhalla::tyr::actor_t::locate>)
+      .def("OptimizedRoute", &act<&valhalla::tyr::actor_t::optimized_route>)
+      .def("Matrix", &act<&valhalla::tyr::actor_t::matrix>)
+      .def("Isochrone", &act<&valhalla::tyr::actor_t::isochrone>)
+      .def("TraceRoute", &act<&valhalla::tyr::actor_t::trace_route>)
+      .def("TraceAttributes", &act<&valhalla::tyr::actor_t::trace_attributes>)
+      .def("Height", &act<&valhalla::tyr::actor_t::height>)
+      .def("TransitAvailable", &act<&valhalla::tyr::actor_t::transit_available>)
+      .def("Expansion", &act<&valhalla::tyr::actor_t::expansion>)
+      .def("Batch", &batch,
+           (boost::python::arg("action"), boost::python::arg("requests"),
+            boost::python::arg("threads") = 0))
 
       ;
 }
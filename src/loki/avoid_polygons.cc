@@ -0,0 +1,186 @@
+#include "loki/avoid_polygons.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/aabb2.h"
+
+#include <algorithm>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// Is the point inside the ring, by the number of its edges a ray to the east crosses
+bool inside(const std::vector<PointLL>& ring, const PointLL& p) {
+  bool in = false;
+  for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+    if ((ring[i].lat() > p.lat()) != (ring[j].lat() > p.lat()) &&
+        p.lng() < (ring[j].lng() - ring[i].lng()) * (p.lat() - ring[i].lat()) /
+                          (ring[j].lat() - ring[i].lat()) +
+                      ring[i].lng()) {
+      in = !in;
+    }
+  }
+  return in;
+}
+
+// Which side of the line through a and b the point is on
+double side(const PointLL& a, const PointLL& b, const PointLL& p) {
+  return (b.lng() - a.lng()) * (p.lat() - a.lat()) - (b.lat() - a.lat()) * (p.lng() - a.lng());
+}
+
+bool crosses(const PointLL& a, const PointLL& b, const PointLL& c, const PointLL& d) {
+  return ((side(a, b, c) > 0) != (side(a, b, d) > 0)) &&
+         ((side(c, d, a) > 0) != (side(c, d, b) > 0));
+}
+
+// Does the shape of an edge touch the polygon
+bool covers(const std::vector<PointLL>& ring,
+            const AABB2<PointLL>& bbox,
+            const std::vector<PointLL>& shape) {
+  if (shape.empty() || !bbox.Intersects(AABB2<PointLL>(shape))) {
+    return false;
+  }
+  for (const auto& p : shape) {
+    if (bbox.Contains(p) && inside(ring, p)) {
+      return true;
+    }
+  }
+  for (size_t i = 1; i < shape.size(); ++i) {
+    for (size_t j = 0, k = ring.size() - 1; j < ring.size(); k = j++) {
+      if (crosses(shape[i - 1], shape[i], ring[k], ring[j])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace loki {
+
+avoid_masks_t RasterizeAvoidPolygon(const std::vector<PointLL>& ring, GraphReader& reader) {
+  avoid_masks_t masks;
+  if (ring.size() < 3) {
+    return masks;
+  }
+  AABB2<PointLL> bbox(ring);
+  for (const auto& level : TileHierarchy::levels()) {
+    for (auto id : level.second.tiles.TileList(bbox)) {
+      GraphId tile_id(id, level.first, 0);
+      const GraphTile* tile = reader.GetGraphTile(tile_id);
+      if (tile == nullptr) {
+        continue;
+      }
+
+      // Both directions of an edge share its shape so it is only checked once
+      const uint32_t count = tile->header()->directededgecount();
+      std::vector<uint64_t> mask((count + 63) / 64, 0);
+      std::unordered_map<uint32_t, bool> covered;
+      bool any = false;
+      for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t offset = tile->directededge(i)->edgeinfo_offset();
+        auto found = covered.find(offset);
+        if (found == covered.end()) {
+          const bool edge_covered = covers(ring, bbox, tile->edgeinfo(offset).shape());
+          found = covered.emplace(offset, edge_covered).first;
+        }
+        if (found->second) {
+          mask[i >> 6] |= 1ull << (i & 63);
+          any = true;
+        }
+      }
+      if (any) {
+        masks.emplace(tile_id, std::move(mask));
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+  return masks;
+}
+
+void AddAvoidMasks(Options& options, GraphReader& reader, AvoidMaskCache* cache) {
+  // A tile under several polygons gets a single mask with the edges of all of them. The edges of
+  // a polygon change with the tile extract
+  avoid_masks_t masks;
+  const std::string version = std::to_string(reader.tile_extract_version()) + ":";
+  for (const auto& polygon : options.avoid_polygons()) {
+    std::vector<PointLL> ring;
+    for (const auto& point : polygon.points()) {
+      ring.emplace_back(point.lng(), point.lat());
+    }
+    const auto rasterize = [&]() {
+      return std::make_shared<const avoid_masks_t>(RasterizeAvoidPolygon(ring, reader));
+    };
+    auto polygon_masks = cache && polygon.has_name()
+                             ? cache->Get(version + polygon.SerializeAsString(), rasterize)
+                             : rasterize();
+    for (const auto& tile : *polygon_masks) {
+      auto& mask = masks[tile.first];
+      mask.resize(std::max(mask.size(), tile.second.size()), 0);
+      for (size_t i = 0; i < tile.second.size(); ++i) {
+        mask[i] |= tile.second[i];
+      }
+    }
+  }
+  for (const auto& tile : masks) {
+    auto* mask = options.add_avoid_masks();
+    mask->set_tile_id(tile.first.value);
+    for (auto edges : tile.second) {
+      mask->add_edges(edges);
+    }
+  }
+}
+
+AvoidMaskCache::AvoidMaskCache(const size_t max_polygons) : max_polygons_(max_polygons), uses_(0) {
+}
+
+AvoidMaskCache::masks_t AvoidMaskCache::Get(const std::string& key,
+                                            const std::function<masks_t()>& rasterize) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = polygons_.find(key);
+    if (found != polygons_.end()) {
+      found->second.used = ++uses_;
+      return found->second.masks;
+    }
+  }
+
+  // Rasterizing reads a lot of tiles so other workers keep using the cache meanwhile
+  auto masks = rasterize();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (polygons_.size() >= max_polygons_ && polygons_.count(key) == 0) {
+    auto lru = std::min_element(polygons_.begin(), polygons_.end(),
+                                [](const std::pair<const std::string, entry_t>& a,
+                                   const std::pair<const std::string, entry_t>& b) {
+                                  return a.second.used < b.second.used;
+                                });
+    polygons_.erase(lru);
+  }
+  polygons_[key] = entry_t{masks, ++uses_};
+  return masks;
+}
+
+size_t AvoidMaskCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return polygons_.size();
+}
+
+std::shared_ptr<AvoidMaskCache> AvoidMaskCache::Global(const size_t max_polygons) {
+  static std::mutex global_mutex;
+  static std::shared_ptr<AvoidMaskCache> global_cache;
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (max_polygons == 0) {
+    return nullptr;
+  }
+  if (!global_cache) {
+    global_cache = std::make_shared<AvoidMaskCache>(max_polygons);
+  }
+  return global_cache;
+}
+
+} // namespace loki
+} // namespace valhalla
@@ -0,0 +1,150 @@
+#include "loki/correlationcache.h"
+#include "loki/search.h"
+
+#include <cmath>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// Append the bytes of a value to the key
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace loki {
+
+CorrelationCache::CorrelationCache(const size_t max_locations) : max_locations_(max_locations) {
+}
+
+std::unordered_map<Location, PathLocation>
+CorrelationCache::Search(const std::vector<Location>& locations,
+                         GraphReader& reader,
+                         const sif::DynamicCost* costing,
+                         const std::string& costing_key,
+                         size_t threads) {
+  // answer what we can from the cache
+  auto version = reader.tile_extract_version();
+  std::unordered_map<Location, PathLocation> correlated;
+  std::vector<Location> misses;
+  std::vector<std::string> miss_keys;
+  for (const auto& location : locations) {
+    if (correlated.find(location) != correlated.end()) {
+      continue;
+    }
+    auto key = Key(location, costing_key);
+    PathLocation cached(location);
+    if (Get(key, version, location, cached)) {
+      correlated.emplace(location, std::move(cached));
+    } else {
+      misses.push_back(location);
+      miss_keys.push_back(std::move(key));
+    }
+  }
+
+  // search the rest and remember them for next time, the ones that could not be correlated are
+  // left out just like Search does
+  if (!misses.empty()) {
+    auto searched = loki::Search(misses, reader, costing, threads);
+    for (size_t i = 0; i < misses.size(); ++i) {
+      auto found = searched.find(misses[i]);
+      if (found != searched.end()) {
+        Put(miss_keys[i], version, found->second);
+        correlated.emplace(found->first, std::move(found->second));
+      }
+    }
+  }
+  return correlated;
+}
+
+bool CorrelationCache::Get(const std::string& key,
+                           const uint64_t version,
+                           const Location& location,
+                           PathLocation& result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = correlations_.find(key);
+  if (found == correlations_.end()) {
+    return false;
+  }
+  if (found->second.version != version) {
+    Drop(found);
+    return false;
+  }
+  used_.splice(used_.begin(), used_, found->second.used);
+  // the candidates of the cached location with everything else of the one asked for
+  result = found->second.correlation;
+  static_cast<Location&>(result) = location;
+  return true;
+}
+
+void CorrelationCache::Put(const std::string& key,
+                           const uint64_t version,
+                           const PathLocation& correlation) {
+  if (max_locations_ == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = correlations_.find(key);
+  if (found != correlations_.end()) {
+    Drop(found);
+  }
+  while (correlations_.size() >= max_locations_) {
+    Drop(correlations_.find(used_.back()));
+  }
+  used_.push_front(key);
+  correlations_.emplace(key, entry_t{correlation, version, used_.begin()});
+}
+
+size_t CorrelationCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return correlations_.size();
+}
+
+void CorrelationCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  used_.clear();
+  correlations_.clear();
+}
+
+void CorrelationCache::Drop(std::unordered_map<std::string, entry_t>::iterator entry) {
+  used_.erase(entry->second.used);
+  correlations_.erase(entry);
+}
+
+// The address, time and stop type of a location don't change what it correlates to
+std::string CorrelationCache::Key(const Location& location, const std::string& costing_key) {
+  std::string key;
+  key.reserve(64 + costing_key.size());
+  append(key, static_cast<int32_t>(std::round(location.latlng_.lng() * 1e6)));
+  append(key, static_cast<int32_t>(std::round(location.latlng_.lat() * 1e6)));
+  append(key, static_cast<bool>(location.heading_));
+  append(key, location.heading_ ? *location.heading_ : 0.f);
+  append(key, static_cast<bool>(location.way_id_));
+  append(key, location.way_id_ ? *location.way_id_ : uint64_t(0));
+  append(key, location.min_outbound_reach_);
+  append(key, location.min_inbound_reach_);
+  append(key, location.radius_);
+  append(key, location.preferred_side_);
+  append(key, location.node_snap_tolerance_);
+  append(key, location.heading_tolerance_);
+  append(key, location.search_cutoff_);
+  append(key, location.street_side_tolerance_);
+  key.append(costing_key);
+  return key;
+}
+
+std::shared_ptr<CorrelationCache> CorrelationCache::Global(const size_t max_locations) {
+  static std::mutex global_mutex;
+  static std::shared_ptr<CorrelationCache> global_cache;
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (!global_cache && max_locations > 0) {
+    global_cache = std::make_shared<CorrelationCache>(max_locations);
+  }
+  return max_locations > 0 ? global_cache : nullptr;
+}
+
+} // namespace loki
+} // namespace valhalla
@@ -3,6 +3,9 @@
 #include "midgard/logging.h"
 #include "tyr/serializers.h"
 
+#include <atomic>
+#include <thread>
+
 using namespace valhalla;
 using namespace valhalla::tyr;
 using namespace valhalla::midgard;
@@ -17,6 +20,42 @@ void from_ll(valhalla::Location* l, const PointLL& p) {
   l->mutable_ll()->set_lat(p.lat());
   l->mutable_ll()->set_lng(p.lng());
 }
+
+// resample the shape but make sure to keep the first and last shapepoint
+void resample(std::vector<PointLL>& shape, const double resample_distance) {
+  auto last = shape.back();
+  shape = midgard::resample_spherical_polyline(shape, resample_distance);
+  shape.emplace_back(std::move(last));
+}
+
+// the distances along the shape to each of its points
+std::vector<float> get_ranges(const std::vector<PointLL>& shape) {
+  std::vector<float> ranges;
+  ranges.reserve(shape.size());
+  ranges.emplace_back(0);
+  for (auto point = std::next(shape.cbegin()); point != shape.cend(); ++point) {
+    ranges.emplace_back(ranges.back() + point->Distance(*std::prev(point)));
+  }
+  return ranges;
+}
+
+// does some work for each shape, the threads take turns grabbing the next shape
+template <class work_t> void for_each_shape(size_t count, size_t threads, const work_t& work) {
+  std::atomic<size_t> next(0);
+  auto take_turns = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      work(i);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < std::min(threads, count); ++i) {
+    workers.emplace_back(take_turns);
+  }
+  take_turns();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
 } // namespace
 
 namespace valhalla {
@@ -42,10 +81,7 @@ std::vector<PointLL> loki_worker_t::init_height(Api& request) {
       throw valhalla_exception_t{313, " " + std::to_string(min_resample) + " meters"};
     };
     if (options.shape_size() > 1) {
-      // resample the shape but make sure to keep the first and last shapepoint
-      auto last = shape.back();
-      shape = midgard::resample_spherical_polyline(shape, options.resample_distance());
-      shape.emplace_back(std::move(last));
+      resample(shape, options.resample_distance());
       // put it back
       options.clear_shape();
       for (const auto& p : shape) {
@@ -76,6 +112,11 @@ std::vector<PointLL> loki_worker_t::init_height(Api& request) {
 }
 */
 std::string loki_worker_t::height(Api& request) {
+  // many shapes at once
+  if (request.options().height_shapes_size() > 0) {
+    return heights(request);
+  }
+
   auto shape = init_height(request);
   // get the elevation of each posting
   std::vector<double> heights = sample.get_all(shape);
@@ -86,14 +127,87 @@ std::string loki_worker_t::height(Api& request) {
   // get the distances between the postings if desired
   std::vector<float> ranges;
   if (request.options().range()) {
-    ranges.reserve(shape.size());
-    ranges.emplace_back(0);
-    for (auto point = std::next(shape.cbegin()); point != shape.cend(); ++point) {
-      ranges.emplace_back(ranges.back() + point->Distance(*std::prev(point)));
-    }
+    ranges = get_ranges(shape);
   }
 
   return tyr::serializeHeight(request, heights, ranges);
 }
+
+/* example heights response:
+{
+  "heights": [
+    { "shape": [ {"lat": 40.712433, "lon": -76.504913}, {"lat": 40.712276, "lon": -76.605263} ],
+      "height": [307,272] },
+    { "encoded_polyline": "s{cplAfiz{pCa]xB", "height": [258,258] }
+  ]
+}
+*/
+std::string loki_worker_t::heights(Api& request) {
+  auto& options = *request.mutable_options();
+  const bool resampled = options.has_resample_distance();
+  if (resampled && options.resample_distance() < min_resample) {
+    throw valhalla_exception_t{313, " " + std::to_string(min_resample) + " meters"};
+  }
+
+  // convert back to native pointll :(
+  std::vector<std::vector<PointLL>> shapes(options.height_shapes_size());
+  for (int i = 0; i < options.height_shapes_size(); ++i) {
+    for (const auto& point : options.height_shapes(i).points()) {
+      shapes[i].emplace_back(point.lng(), point.lat());
+    }
+  }
+
+  // long shapes take a while to resample so it happens on the threads too
+  if (resampled) {
+    for_each_shape(shapes.size(), height_threads, [&](size_t i) {
+      if (shapes[i].size() > 1) {
+        resample(shapes[i], options.resample_distance());
+      }
+    });
+  }
+
+  // the limit is on the points of all the shapes together
+  size_t sample_count = 0;
+  for (const auto& shape : shapes) {
+    sample_count += shape.size();
+  }
+  if (sample_count > max_elevation_shape) {
+    throw valhalla_exception_t{314, " (" + std::to_string(sample_count) +
+                                        (resampled ? " after resampling" : "") + "). The limit is " +
+                                        std::to_string(max_elevation_shape)};
+  }
+
+  // get the elevation of each posting of each shape and the distances between them if desired
+  std::vector<std::vector<double>> heights(shapes.size());
+  std::vector<std::vector<float>> ranges(shapes.size());
+  for_each_shape(shapes.size(), height_threads, [&](size_t i) {
+    heights[i] = sample.get_all(shapes[i]);
+    if (options.range()) {
+      ranges[i] = get_ranges(shapes[i]);
+    }
+  });
+  if (!options.do_not_track()) {
+    valhalla::midgard::logging::Log("sample_count::" + std::to_string(sample_count),
+                                    " [ANALYTICS] ");
+  }
+
+  // put the resampled shapes back, re-encoded for display if they were sent encoded
+  if (resampled) {
+    for (size_t i = 0; i < shapes.size(); ++i) {
+      auto* height_shape = options.mutable_height_shapes(i);
+      height_shape->clear_points();
+      for (const auto& p : shapes[i]) {
+        auto* point = height_shape->add_points();
+        point->set_lng(p.lng());
+        point->set_lat(p.lat());
+      }
+      if (height_shape->has_encoded_polyline()) {
+        height_shape->set_encoded_polyline(midgard::encode(shapes[i]));
+      }
+    }
+  }
+
+  return tyr::serializeHeights(request, heights, ranges);
+}
 } // namespace loki
 } // namespace valhalla
@@ -66,15 +66,24 @@ void loki_worker_t::init_isochrones(Api& request) {
 void loki_worker_t::isochrones(Api& request) {
   init_isochrones(request);
   auto& options = *request.mutable_options();
-  // check that location size does not exceed max
-  if (options.locations_size() > max_locations.find("isochrone")->second) {
+  // a batch expands from each location on its own so they can be as many and as far apart as
+  // the batch limit allows
+  if (options.batch()) {
+    if (options.locations_size() > max_batch_locations) {
+      throw valhalla_exception_t{150, std::to_string(max_batch_locations)};
+    }
+  } // check that location size does not exceed max
+  else if (options.locations_size() > max_locations.find("isochrone")->second) {
     throw valhalla_exception_t{150, std::to_string(max_locations.find("isochrone")->second)};
   };
 
   // check the distances
   auto max_location_distance = std::numeric_limits<float>::min();
-  check_distance(options.locations(), max_distance.find("isochrone")->second, max_location_distance);
-  if (!options.do_not_track()) {
+  if (!options.batch()) {
+    check_distance(options.locations(), max_distance.find("isochrone")->second,
+                   max_location_distance);
+  }
+  if (!options.batch() && !options.do_not_track()) {
     valhalla::midgard::logging::Log("max_location_distance::" +
                                         std::to_string(max_location_distance * midgard::kKmPerMeter) +
                                         "km",
@@ -84,7 +93,7 @@ void loki_worker_t::isochrones(Api& request) {
   try {
     // correlate the various locations to the underlying graph
     auto locations = PathLocation::fromPBF(options.locations());
-    const auto projections = loki::Search(locations, *reader, costing.get());
+    const auto projections = search(locations, options);
     for (size_t i = 0; i < locations.size(); ++i) {
       const auto& projection = projections.at(locations[i]);
       PathLocation::toPBF(projection, options.mutable_locations(i), *reader);
@@ -3,7 +3,9 @@
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/tiles.h"
+#include <algorithm>
 #include <cmath>
+#include <unordered_set>
 
 namespace vm = valhalla::midgard;
 namespace vb = valhalla::baldr;
@@ -47,6 +49,14 @@ struct tile_cache {
     return m_last_tile_id;
   }
 
+  // forget the last tile, the reader might have let go of it since
+  inline void reset() {
+    m_last_tile_id = vb::GraphId();
+    m_tile = nullptr;
+    m_nodes = nullptr;
+    m_edges = nullptr;
+  }
+
 private:
   void lookup(vb::GraphId id_base) {
     m_last_tile_id = id_base;
@@ -186,19 +196,28 @@ merge_intersections(const std::vector<vm::AABB2<vm::PointLL>>& boxes,
 }
 
 struct filtered_nodes {
-  explicit filtered_nodes(const vm::AABB2<vm::PointLL>& b, std::vector<vb::GraphId>& nodes)
-      : m_box(b), m_nodes(nodes) {
+  filtered_nodes() : m_visitor(nullptr) {
+  }
+
+  // start filtering for another box, the set keeps its buckets for the next search
+  inline void reset(const vm::AABB2<vm::PointLL>& b,
+                    const std::function<void(const vb::GraphId&)>& visitor) {
+    m_box = b;
+    m_visitor = &visitor;
+    m_seen.clear();
   }
 
   inline void push_back(vb::GraphId id, const vm::PointLL& ll) {
-    if (m_box.Contains(ll)) {
-      m_nodes.push_back(id);
+    if (m_box.Contains(ll) && m_seen.insert(id).second) {
+      (*m_visitor)(id);
     }
   }
 
 private:
   vm::AABB2<vm::PointLL> m_box;
-  std::vector<vb::GraphId>& m_nodes;
+  const std::function<void(const vb::GraphId&)>* m_visitor;
+  // a node can be found once from each of its edges so we keep track of the ones already visited
+  std::unordered_set<vb::GraphId> m_seen;
 };
 
 // functor to sort GraphId objects by level, tile then id within the tile.
@@ -335,8 +354,8 @@ private:
   // access objects grouped by (level, tile).
   tile_cache& m_cache;
 
-  // a bounding-box filtered list of nodes. we append nodes to this, and when
-  // the algorithm finishes, this list can be made unique.
+  // a bounding-box filtered visitor of nodes. we append nodes to this and it
+  // only passes on the ones it hasnt seen yet.
   filtered_nodes& m_nodes;
 
   // keep a set of (hopefully rare) "tweeners", which are edges which cross
@@ -364,11 +383,34 @@ private:
 namespace valhalla {
 namespace loki {
 
-std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
-                                          baldr::GraphReader& reader) {
-  std::vector<vb::GraphId> nodes;
+// the buffers of a search which are kept from one search to the next
+struct node_search_t::context_t {
+  explicit context_t(vb::GraphReader& reader) : cache(reader), collector(cache, filtered) {
+  }
+
+  // we cache the last tile lookup, since the nodes and tweeners arrays are in
+  // order then this guarantees the smallest number of times we have to look up
+  // a new tile from the reader.
+  tile_cache cache;
 
-  auto tiles = vb::TileHierarchy::levels().rbegin()->second.tiles;
+  // wraps the visitor in a filter so that only nodes contained within the
+  // bounding box are visited, and only once each.
+  filtered_nodes filtered;
+
+  // a wrapper process which aims to order the lookups against tiles into a
+  // number of sequential passes through the set of tiles.
+  node_collector collector;
+};
+
+node_search_t::node_search_t(baldr::GraphReader& reader) : context(new context_t(reader)) {
+}
+
+node_search_t::~node_search_t() {
+}
+
+void node_search_t::visit(const vm::AABB2<vm::PointLL>& bbox,
+                          const std::function<void(const baldr::GraphId&)>& visitor) {
+  const auto& tiles = vb::TileHierarchy::levels().rbegin()->second.tiles;
   const uint8_t bin_level = vb::TileHierarchy::levels().rbegin()->second.level;
 
   // if the bbox only touches the edge of the tile or bin, then we need to
@@ -377,19 +419,9 @@ std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
   auto expanded_bboxes = expand_bbox_across_boundaries(bbox, tiles);
   auto intersections = merge_intersections(expanded_bboxes, tiles);
 
-  // we cache the last tile lookup, since the nodes and tweeners arrays are in
-  // order then this guarantees the smallest number of times we have to look up
-  // a new tile from the reader.
-  tile_cache cache(reader);
-
-  // wrap the nodes in a filter so that only nodes contained within the bounding
-  // box are appended to the vector. there might be duplicates, so we have to
-  // sort and uniq the vector later.
-  filtered_nodes filtered(bbox, nodes);
-
-  // a wrapper process which aims to order the lookups against tiles into a
-  // number of sequential passes through the set of tiles.
-  node_collector collector(cache, filtered);
+  auto& cache = context->cache;
+  cache.reset();
+  context->filtered.reset(bbox, visitor);
 
   for (const auto& entry : intersections) {
     vb::GraphId tile_id(entry.first, bin_level, 0);
@@ -402,23 +434,24 @@ std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
 
     for (auto bin_id : entry.second) {
       for (auto edge_id : tile.tile()->GetBin(bin_id)) {
-        collector.add_edge(edge_id);
+        context->collector.add_edge(edge_id);
       }
     }
   }
 
   // finish the collector by going over any stored edges or nodes which weren't
   // accessible in the current tile at the time they were found.
-  collector.finish();
-
-  // erase the duplicates
-  std::sort(nodes.begin(), nodes.end());
-  auto uniq_end = std::unique(nodes.begin(), nodes.end());
+  context->collector.finish();
+}
 
-  // remove any of the space at the end of the nodes array which is unused since
-  // duplicates were removed.
-  nodes.erase(uniq_end, nodes.end());
+std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
+                                          baldr::GraphReader& reader) {
+  std::vector<vb::GraphId> nodes;
+  node_search_t search(reader);
+  search.visit(bbox, [&nodes](const vb::GraphId& node) { nodes.push_back(node); });
 
+  // the nodes are unique already but keep giving them back in order
+  std::sort(nodes.begin(), nodes.end());
   return nodes;
 }
 
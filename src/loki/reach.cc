@@ -1,6 +1,8 @@
 #include "loki/reach.h"
+#include "midgard/flat_hash.h"
 
 using namespace valhalla::baldr;
+using namespace valhalla::midgard;
 
 namespace valhalla {
 namespace loki {
@@ -23,7 +25,7 @@ directed_reach SimpleReach(const DirectedEdge* edge,
   // the done set is used to avoid duplicate expansion of already dequeued nodes
   // we also track how many nodes were added as transitions from other levels
   // this allows us to have "duplicate" nodes but not do any trickery with the expansion
-  std::unordered_set<uint64_t> queue, done;
+  flat_hash_set<uint64_t> queue, done;
   queue.reserve(max_reach);
   done.reserve(max_reach);
   size_t transitions = 0;
@@ -6,9 +6,11 @@
 #include "midgard/util.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iterator>
 #include <list>
+#include <thread>
 #include <unordered_set>
 
 using namespace valhalla::midgard;
@@ -90,6 +92,38 @@ std::function<std::tuple<int32_t, unsigned short, float>()> make_binner(const Po
   return tiles.ClosestFirst(p);
 }
 
+// the distance along a hilbert curve filling an n by n grid, n must be a power of 2, of the
+// cell at x, y. cells close to each other on the curve are also close to each other in the grid
+uint64_t hilbert_index(uint64_t x, uint64_t y, const uint64_t n) {
+  uint64_t d = 0;
+  for (uint64_t s = n / 2; s > 0; s /= 2) {
+    uint64_t rx = (x & s) > 0;
+    uint64_t ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    // rotate the quadrant so the curve within it has the right orientation
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+// where the bin is along a hilbert curve over all of the bins of the local level
+uint64_t bin_order(const int32_t tile_index, const unsigned short bin_index) {
+  const auto& tiles = TileHierarchy::levels().rbegin()->second.tiles;
+  uint64_t n = 1;
+  while (n < std::max(tiles.ncolumns(), tiles.nrows()) * kBinsDim) {
+    n *= 2;
+  }
+  auto row_column = tiles.GetRowColumn(tile_index);
+  return hilbert_index(row_column.second * kBinsDim + bin_index % kBinsDim,
+                       row_column.first * kBinsDim + bin_index / kBinsDim, n);
+}
+
 // Model a segment (2 consecutive points in an edge in a bin).
 struct candidate_t {
   double sq_distance;
@@ -117,8 +151,10 @@ struct candidate_t {
     // to fix it we simply compute the plane formed by the triangle
     // through the center of the earth and the two shape points and test
     // whether the original point is above or below the plane (depending on winding)
-    auto& shape = edge_info->shape();
-    LineSegment2<PointLL> segment(shape[index], shape[index + 1]);
+    auto shape = edge_info->lazy_shape().begin();
+    std::advance(shape, index);
+    auto u = *shape;
+    LineSegment2<PointLL> segment(u, *++shape);
     return (segment.IsLeft(original) > 0) == edge->forward() ? PathLocation::SideOfStreet::LEFT
                                                              : PathLocation::SideOfStreet::RIGHT;
   }
@@ -148,14 +184,10 @@ struct projector_wrapper {
   projector_wrapper(projector_wrapper&&) = default;
   projector_wrapper& operator=(projector_wrapper&&) = default;
 
-  // the ones marked with null current tile are finished so put them on the end
-  // otherwise we sort by bin so that ones with the same bin are next to each other
+  // the finished ones are ordered last so put them on the end otherwise we sort by bin so that
+  // ones with the same bin are next to each other and ones with nearby bins are close by
   bool operator<(const projector_wrapper& other) const {
-    // the
-    if (cur_tile != other.cur_tile) {
-      return cur_tile > other.cur_tile;
-    }
-    return bin_index < other.bin_index;
+    return order < other.order;
   }
 
   bool has_same_bin(const projector_wrapper& other) const {
@@ -179,12 +211,14 @@ struct projector_wrapper {
           (reachable.size() && distance > location.radius_ &&
            distance > std::sqrt(reachable.back().sq_distance))) {
         cur_tile = nullptr;
+        order = std::numeric_limits<uint64_t>::max();
         break;
       }
 
       // grab the tile the lat, lon is in
       auto tile_id = GraphId(tile_index, TileHierarchy::levels().rbegin()->first, 0);
       reader.GetGraphTile(tile_id, cur_tile);
+      order = bin_order(tile_index, bin_index);
     } while (!cur_tile);
   }
 
@@ -192,6 +226,7 @@ struct projector_wrapper {
   const GraphTile* cur_tile = nullptr;
   Location location;
   unsigned short bin_index = 0;
+  uint64_t order = std::numeric_limits<uint64_t>::max();
   double sq_radius;
   std::vector<candidate_t> unreachable;
   std::vector<candidate_t> reachable;
@@ -208,8 +243,13 @@ struct bin_handler_t {
   NodeFilter node_filter;
   const DynamicCost* costing;
   unsigned int max_reach_limit;
+  // which of the labeled components of the edges the costing can use, if any
+  uint32_t component_mode = kComponentModeCount;
+  size_t threads;
   std::vector<candidate_t> bin_candidates;
   std::unordered_set<uint64_t> correlated_edges;
+  // coordinates of the shape before a candidate, kept apart so their distances are done in a batch
+  std::vector<float> shape_lngs, shape_lats, shape_dists;
 
   // keep track of edges whose reachability we've already computed
   // TODO: dont use pointers as keys, its safe for now but fancy caching one day could be bad
@@ -217,8 +257,9 @@ struct bin_handler_t {
 
   bin_handler_t(const std::vector<valhalla::baldr::Location>& locations,
                 valhalla::baldr::GraphReader& reader,
-                const DynamicCost* costing)
-      : reader(reader), costing(costing),
+                const DynamicCost* costing,
+                size_t threads)
+      : reader(reader), costing(costing), threads(std::max(threads, static_cast<size_t>(1))),
         edge_filter(costing ? costing->GetEdgeFilter() : PassThroughEdgeFilter),
         node_filter(costing ? costing->GetNodeFilter() : PassThroughNodeFilter) {
     // get the unique set of input locations and the max reachability of them all
@@ -230,6 +271,11 @@ struct bin_handler_t {
       max_reach_limit = std::max(max_reach_limit, loc.min_outbound_reach_);
       max_reach_limit = std::max(max_reach_limit, loc.min_inbound_reach_);
     }
+    // the components are labeled for the access modes, any costing with one of those can use them
+    for (uint32_t mode = 0; costing && mode < kComponentModeCount; ++mode) {
+      if (costing->access_mode() == kComponentAccess[mode])
+        component_mode = mode;
+    }
     // very annoying but it saves a lot of time to preallocate this instead of doing it in the loop
     // in handle_bins
     bin_candidates.resize(pps.size());
@@ -256,7 +302,7 @@ struct bin_handler_t {
         return;
       }
       const auto* node = tile->node(node_id);
-      const auto* start_edge = tile->directededge(node->edge_index());
+      const auto* start_edge = tile->directededge_unchecked(node->edge_index());
       const auto* end_edge = start_edge + node->edge_count();
       PointLL node_ll = node->latlng(tile->header()->base_ll());
       // cache the distance
@@ -279,7 +325,8 @@ struct bin_handler_t {
                                            PathLocation::NONE,
                                            reach.outbound,
                                            reach.inbound};
-          auto index = edge->forward() ? 0 : info.shape().size() - 2;
+          // only the heading filter needs the index of the segment at the node
+          auto index = location.heading_ && !edge->forward() ? info.shape().size() - 2 : 0;
           if (heading_filter(edge, info, location, candidate.point, index)) {
             filtered.emplace_back(std::move(path_edge));
           } else if (correlated_edges.insert(path_edge.id).second) {
@@ -304,9 +351,8 @@ struct bin_handler_t {
                                            reach.outbound,
                                            reach.inbound};
           // index is opposite the logic above
-          auto index = other_edge->forward() ? info.shape().size() - 2 : 0;
-          if (heading_filter(other_edge, tile->edgeinfo(edge->edgeinfo_offset()), location,
-                             candidate.point, index)) {
+          auto index = location.heading_ && other_edge->forward() ? info.shape().size() - 2 : 0;
+          if (heading_filter(other_edge, info, location, candidate.point, index)) {
             filtered.emplace_back(std::move(path_edge));
           } else if (correlated_edges.insert(path_edge.id).second) {
             correlated.edges.push_back(std::move(path_edge));
@@ -316,7 +362,7 @@ struct bin_handler_t {
 
       // Follow transition to other hierarchy levels
       if (follow_transitions && node->transition_count() > 0) {
-        const NodeTransition* trans = tile->transition(node->transition_index());
+        const NodeTransition* trans = tile->transition_unchecked(node->transition_index());
         for (uint32_t i = 0; i < node->transition_count(); ++i, ++trans) {
           crawl(trans->endnode(), false);
         }
@@ -339,12 +385,25 @@ struct bin_handler_t {
     // now that we have an edge we can pass back all the info about it
     if (candidate.edge != nullptr) {
       // we need the ratio in the direction of the edge we are correlated to
-      double partial_length = 0;
+      shape_lngs.clear();
+      shape_lats.clear();
+      auto shape = candidate.edge_info->lazy_shape().begin();
+      shape_lngs.push_back(shape->lng());
+      shape_lats.push_back(shape->lat());
       for (size_t i = 0; i < candidate.index; ++i) {
-        partial_length +=
-            candidate.edge_info->shape()[i].Distance(candidate.edge_info->shape()[i + 1]);
+        ++shape;
+        shape_lngs.push_back(shape->lng());
+        shape_lats.push_back(shape->lat());
+      }
+      shape_lngs.push_back(candidate.point.lng());
+      shape_lats.push_back(candidate.point.lat());
+      shape_dists.resize(shape_lngs.size() - 1);
+      PointLL::Distances(shape_lngs.data(), shape_lats.data(), shape_lngs.size(),
+                         shape_dists.data());
+      double partial_length = 0;
+      for (auto d : shape_dists) {
+        partial_length += d;
       }
-      partial_length += candidate.edge_info->shape()[candidate.index].Distance(candidate.point);
       partial_length = std::min(partial_length, static_cast<double>(candidate.edge->length()));
       float length_ratio =
           static_cast<float>(partial_length / static_cast<double>(candidate.edge->length()));
@@ -409,6 +468,12 @@ struct bin_handler_t {
     if (max_reach_limit == 0)
       return {};
 
+    // no need either when the edge is on a component big enough that we'd hit the limit anyway
+    if (component_mode < kComponentModeCount &&
+        kComponentClassSizes[edge->component_class(component_mode)] >= max_reach_limit &&
+        edge_filter(edge) > 0.f)
+      return {max_reach_limit, max_reach_limit};
+
     // do we already know about this one?
     auto found = directed_reaches.find(edge);
     if (found != directed_reaches.cend())
@@ -442,174 +507,327 @@ struct bin_handler_t {
     return reach;
   }
 
-  // handle a bin for the range of candidates that share it
-  void handle_bin(std::vector<projector_wrapper>::iterator begin,
-                  std::vector<projector_wrapper>::iterator end) {
-    // iterate over the edges in the bin
-    auto tile = begin->cur_tile;
-    auto edges = tile->GetBin(begin->bin_index);
-    for (auto e : edges) {
-      // get the tile and edge
-      if (!reader.GetGraphTile(e, tile)) {
-        continue;
+  // whether an edge whose shape is inside the box could replace or add to the candidates any of
+  // the locations have, if not it can be skipped without decoding its shape. an edge that
+  // far away is assumed reachable (see check_reachability) unless its reach is known already
+  bool could_improve(std::vector<projector_wrapper>::iterator begin,
+                     std::vector<projector_wrapper>::iterator end,
+                     const AABB2<PointLL>& box,
+                     const DirectedEdge* edge) const {
+    for (auto p_itr = begin; p_itr != end; ++p_itr) {
+      // the closest point of the box gives the least distance any point of the shape can have
+      const auto& ll = p_itr->location.latlng_;
+      PointLL closest(std::max(box.minx(), std::min(ll.lng(), box.maxx())),
+                      std::max(box.miny(), std::min(ll.lat(), box.maxy())));
+      auto sq_distance = p_itr->project.approx.DistanceSquared(closest);
+      if (sq_distance < p_itr->sq_radius || p_itr->reachable.empty() ||
+          sq_distance < p_itr->reachable.back().sq_distance ||
+          sq_distance < p_itr->closest_external_reachable) {
+        return true;
       }
-
-      // no thanks on this one or its evil twin
-      const auto* edge = tile->directededge(e);
-      if (edge_filter(edge) == 0.0f && (!(e = reader.GetOpposingEdgeId(e, tile)).Is_Valid() ||
-                                        edge_filter(edge = tile->directededge(e)) == 0.0f)) {
-        continue;
+      if (p_itr->unreachable.empty() ? max_reach_limit > 0 && directed_reaches.count(edge)
+                                     : sq_distance < p_itr->unreachable.back().sq_distance) {
+        return true;
       }
+    }
+    return false;
+  }
 
-      // reset these so we know the best point along the edge
-      auto c_itr = bin_candidates.begin();
-      decltype(begin) p_itr;
-      for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-        c_itr->sq_distance = std::numeric_limits<float>::max();
-      }
+  // find the edge in the bin, or its opposing edge, the locations might want. returns false if
+  // the edge is filtered or too far away to be of use for any of the locations
+  bool binned_edge(std::vector<projector_wrapper>::iterator begin,
+                   std::vector<projector_wrapper>::iterator end,
+                   const BinBounds* bounds,
+                   const PointLL& corner,
+                   GraphId& e,
+                   const GraphTile*& tile,
+                   const DirectedEdge*& edge) {
+    // get the tile and edge
+    if (!reader.GetGraphTile(e, tile)) {
+      return false;
+    }
 
-      // TODO: can we speed this up? the majority of edges will be short and far away enough
-      // such that the closest point on the edge will be one of the edges end points, we can get
-      // these coordinates them from the nodes in the graph. we can then find whichever end is
-      // closest to the input point p, call it n. we can then define an half plane h intersecting n
-      // so that its orthogonal to the ray from p to n. using h, we only need to test segments
-      // of the shape which are on the same side of h that p is. to make this fast we would need a
-      // a trivial half plane test as maybe a single dot product and comparison?
+    // no thanks on this one or its evil twin
+    edge = tile->directededge(e);
+    if (edge_filter(edge) == 0.0f && (!(e = reader.GetOpposingEdgeId(e, tile)).Is_Valid() ||
+                                      edge_filter(edge = tile->directededge(e)) == 0.0f)) {
+      return false;
+    }
 
-      // get some shape of the edge
-      auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge->edgeinfo_offset()));
-      auto shape = edge_info->lazy_shape();
-      PointLL v;
-      if (!shape.empty()) {
-        v = shape.pop();
-      }
+    // too far away to be of use for any of the locations
+    return !bounds || !bounds->bounded() || could_improve(begin, end, bounds->box(corner), edge);
+  }
 
-      // iterate along this edges segments projecting each of the points
-      for (size_t i = 0; !shape.empty(); ++i) {
-        auto u = v;
-        v = shape.pop();
-        // for each input point
-        c_itr = bin_candidates.begin();
-        for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-          // how close is the input to this segment
-          auto point = p_itr->project(u, v);
-          auto sq_distance = p_itr->project.approx.DistanceSquared(point);
-          // do we want to keep it
-          if (sq_distance < c_itr->sq_distance) {
-            c_itr->sq_distance = sq_distance;
-            c_itr->point = std::move(point);
-            c_itr->index = i;
-          }
+  // find the closest point along the edge for each of the locations
+  static void project(std::vector<projector_wrapper>::iterator begin,
+                      std::vector<projector_wrapper>::iterator end,
+                      const EdgeInfo& edge_info,
+                      std::vector<candidate_t>::iterator candidates) {
+    // reset these so we know the best point along the edge
+    auto c_itr = candidates;
+    decltype(begin) p_itr;
+    for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
+      c_itr->sq_distance = std::numeric_limits<float>::max();
+    }
+
+    // TODO: can we speed this up? the majority of edges will be short and far away enough
+    // such that the closest point on the edge will be one of the edges end points, we can get
+    // these coordinates them from the nodes in the graph. we can then find whichever end is
+    // closest to the input point p, call it n. we can then define an half plane h intersecting n
+    // so that its orthogonal to the ray from p to n. using h, we only need to test segments
+    // of the shape which are on the same side of h that p is. to make this fast we would need a
+    // a trivial half plane test as maybe a single dot product and comparison?
+
+    // iterate along this edges segments a batch at a time, the last point of one batch is the
+    // first of the next
+    auto shape = edge_info.lazy_shape();
+    PointLL points[projector_t::kBatchSegments + 1];
+    for (size_t first = 0, count = 0; !shape.empty(); first += count - 1) {
+      count = 0;
+      if (first > 0) {
+        points[count++] = points[projector_t::kBatchSegments];
+      }
+      for (; count < projector_t::kBatchSegments + 1 && !shape.empty(); ++count) {
+        points[count] = shape.pop();
+      }
+      // project each of the input points onto the batch and keep the closest
+      c_itr = candidates;
+      for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
+        float sq_distance = c_itr->sq_distance;
+        auto index = p_itr->project.closest(points, count, c_itr->point, sq_distance);
+        if (index < count) {
+          c_itr->sq_distance = sq_distance;
+          c_itr->index = first + index;
         }
       }
+    }
+  }
 
-      // if we already have a better reachable candidate we can just assume this one is reachable
-      auto reach = check_reachability(begin, end, tile, edge);
+  // handle a bin for the range of candidates that share it
+  void handle_bin(std::vector<projector_wrapper>::iterator begin,
+                  std::vector<projector_wrapper>::iterator end) {
+    // iterate over the edges in the bin, along with their bounds if the tile has them
+    auto bin_tile = begin->cur_tile;
+    auto edges = bin_tile->GetBin(begin->bin_index);
+    auto bounds = bin_tile->GetBinBounds(begin->bin_index);
+    auto corner = bin_tile->GetBinCorner(begin->bin_index);
+    for (size_t i = 0; i < edges.size(); ++i) {
+      auto e = edges[i];
+      const GraphTile* tile = bin_tile;
+      const DirectedEdge* edge;
+      if (!binned_edge(begin, end, bounds.size() ? &bounds[i] : nullptr, corner, e, tile, edge)) {
+        continue;
+      }
+      auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge->edgeinfo_offset()));
+      project(begin, end, *edge_info, bin_candidates.begin());
+      keep_candidates(begin, end, e, tile, edge, edge_info);
+    }
 
-      // keep the best point along this edge if it makes sense
-      c_itr = bin_candidates.begin();
-      for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-        // is this edge reachable in the right way
-        bool reachable = reach.outbound >= p_itr->location.min_outbound_reach_ &&
-                         reach.inbound >= p_itr->location.min_inbound_reach_;
-        // it's possible that it isnt reachable but the opposing is, switch to that if so
-        const GraphTile* opp_tile = tile;
-        const DirectedEdge* opp_edge = nullptr;
-        if (!reachable && (opp_edge = reader.GetOpposingEdge(edge, opp_tile)) &&
-            edge_filter(opp_edge) > 0.f) {
-          auto opp_reach = check_reachability(begin, end, opp_tile, opp_edge);
-          if (opp_reach.outbound >= p_itr->location.min_outbound_reach_ &&
-              opp_reach.inbound >= p_itr->location.min_inbound_reach_) {
-            tile = opp_tile;
-            edge = opp_edge;
-            reach = opp_reach;
-            reachable = true;
-          }
-        }
+    // bin is finished, advance the candidates to their respective next bins
+    for (auto p_itr = begin; p_itr != end; ++p_itr) {
+      p_itr->next_bin(reader);
+    }
+  }
 
-        // which batch of findings will this go into
-        auto* batch = reachable ? &p_itr->reachable : &p_itr->unreachable;
+  // about how many projections handle_bins holds on to at once
+  static constexpr size_t kMaxProjections = 1 << 18;
+
+  // the ranges of candidates that share a bin
+  using range_t =
+      std::pair<std::vector<projector_wrapper>::iterator, std::vector<projector_wrapper>::iterator>;
+
+  // an edge of a bin which is worth projecting the locations onto
+  struct projected_edge_t {
+    std::vector<range_t>::const_iterator range;
+    GraphId id;
+    const GraphTile* tile;
+    const DirectedEdge* edge;
+    std::shared_ptr<const EdgeInfo> edge_info;
+    // where its projections start in the projections of all the edges
+    size_t offset;
+  };
+
+  // handle the bins of the ranges of candidates that share them. the edges of all the bins are
+  // looked up first, then the locations are projected onto them on multiple threads and last the
+  // projections are kept or not as they would be by handle_bin. the reader and the reachability
+  // are only ever used by this thread. the edges are found with the candidates the locations
+  // had before any of their bins were handled which can only mean more of them get projected
+  void handle_bins(const std::vector<range_t>& ranges) {
+    // dont hold the projections of too many edges at once
+    for (auto range = ranges.cbegin(); range != ranges.cend();) {
+      range = handle_bins(range, ranges.cend());
+    }
+  }
 
-        // if its empty append
-        if (batch->empty()) {
-          c_itr->edge = edge;
-          c_itr->edge_id = e;
-          c_itr->edge_info = edge_info;
-          c_itr->tile = tile;
-          batch->emplace_back(std::move(*c_itr));
-          continue;
+  // handles the bins of the ranges until it has projected enough, returns where it stopped
+  std::vector<range_t>::const_iterator handle_bins(std::vector<range_t>::const_iterator ranges_begin,
+                                                   std::vector<range_t>::const_iterator ranges_end) {
+    // find what edges to project onto and where their projections go
+    std::vector<projected_edge_t> projected;
+    size_t projection_count = 0;
+    auto range = ranges_begin;
+    for (; range != ranges_end && projection_count < kMaxProjections; ++range) {
+      auto bin_tile = range->first->cur_tile;
+      auto edges = bin_tile->GetBin(range->first->bin_index);
+      auto bounds = bin_tile->GetBinBounds(range->first->bin_index);
+      auto corner = bin_tile->GetBinCorner(range->first->bin_index);
+      for (size_t i = 0; i < edges.size(); ++i) {
+        projected_edge_t edge{range, edges[i], bin_tile, nullptr, nullptr, projection_count};
+        if (binned_edge(range->first, range->second, bounds.size() ? &bounds[i] : nullptr, corner,
+                        edge.id, edge.tile, edge.edge)) {
+          edge.edge_info =
+              std::make_shared<const EdgeInfo>(edge.tile->edgeinfo(edge.edge->edgeinfo_offset()));
+          projected.emplace_back(std::move(edge));
+          projection_count += range->second - range->first;
         }
+      }
+    }
 
-        // get some info about possibilities
-        bool in_radius = c_itr->sq_distance < p_itr->sq_radius;
-        bool better = c_itr->sq_distance < batch->back().sq_distance;
-        bool last_in_radius = batch->back().sq_distance < p_itr->sq_radius;
-        // TODO: this is a bit blunt in that any reachable edges between the best or ones within
-        // the radius will make unreachable edges that are even the tiniest bit further away unviable
-        // it seems like we should have a slightly looser radius to allow for unreachable edges but
-        // its unclear what that should be as in most cases we are working around not actually knowing
-        // the accuracy or even input modality of the incoming location
-        bool closer_external_reachable =
-            reachable && c_itr->sq_distance < p_itr->closest_external_reachable;
-
-        // it has to either be better or in the radius to move on
-        if (in_radius || better) {
-          c_itr->edge = edge;
-          c_itr->edge_id = e;
-          c_itr->edge_info = edge_info;
-          c_itr->tile = tile;
-          // the last one wasnt in the radius so replace it with this one because its better or is
-          // in the radius
-          if (!last_in_radius) {
-            if (closer_external_reachable)
-              p_itr->closest_external_reachable = batch->back().sq_distance;
-            batch->back() = std::move(*c_itr);
-            // last one is in the radius but this one is better so put it on the end
-          } else if (better) {
-            batch->emplace_back(std::move(*c_itr));
-            // last one and this one are both in the radius but this one is not as good
-          } else {
-            batch->emplace_back(std::move(*c_itr));
-            std::swap(*(batch->end() - 1), *(batch->end() - 2));
-          }
-        } // not in radius or better and reachable and closer than closest one outside of radius
-        else if (closer_external_reachable)
-          p_itr->closest_external_reachable = c_itr->sq_distance;
+    // project the locations onto the edges, the threads take turns grabbing a few edges at a time
+    std::vector<candidate_t> projections(projection_count);
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+      constexpr size_t kEdgesPerTurn = 16;
+      for (size_t first = next.fetch_add(kEdgesPerTurn); first < projected.size();
+           first = next.fetch_add(kEdgesPerTurn)) {
+        for (size_t i = first; i < std::min(first + kEdgesPerTurn, projected.size()); ++i) {
+          const auto& edge = projected[i];
+          project(edge.range->first, edge.range->second, *edge.edge_info,
+                  projections.begin() + edge.offset);
+        }
       }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+      workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+      worker.join();
     }
 
-    // bin is finished, advance the candidates to their respective next bins
-    for (auto p_itr = begin; p_itr != end; ++p_itr) {
-      p_itr->next_bin(reader);
+    // keep the projections that make good candidates in the order handle_bin would
+    auto edge = projected.cbegin();
+    for (auto bin = ranges_begin; bin != range; ++bin) {
+      for (; edge != projected.cend() && edge->range == bin; ++edge) {
+        std::copy_n(projections.begin() + edge->offset, bin->second - bin->first,
+                    bin_candidates.begin());
+        keep_candidates(bin->first, bin->second, edge->id, edge->tile, edge->edge,
+                        edge->edge_info);
+      }
+      // bin is finished, advance the candidates to their respective next bins
+      for (auto p_itr = bin->first; p_itr != bin->second; ++p_itr) {
+        p_itr->next_bin(reader);
+      }
     }
+    return range;
   }
 
-  // Find the best range to do.  The given vector should be sorted for
-  // interesting grouping.  Returns the greatest range of non empty
-  // equal bins.
-  std::pair<std::vector<projector_wrapper>::iterator, std::vector<projector_wrapper>::iterator>
-  find_best_range(std::vector<projector_wrapper>& pps) const {
-    auto best = std::make_pair(pps.begin(), pps.begin());
-    auto cur = best;
-    while (cur.second != pps.end()) {
-      cur.first = cur.second;
-      cur.second = std::find_if_not(cur.first, pps.end(), [&cur](const projector_wrapper& pp) {
-        return cur.first->has_same_bin(pp);
-      });
-      if (cur.first->has_bin() && cur.second - cur.first > best.second - best.first) {
-        best = cur;
+  // keep the best points along the edge, in bin_candidates, for the locations they are good for
+  void keep_candidates(std::vector<projector_wrapper>::iterator begin,
+                       std::vector<projector_wrapper>::iterator end,
+                       const GraphId& e,
+                       const GraphTile* tile,
+                       const DirectedEdge* edge,
+                       const std::shared_ptr<const EdgeInfo>& edge_info) {
+    // if we already have a better reachable candidate we can just assume this one is reachable
+    auto reach = check_reachability(begin, end, tile, edge);
+
+    // keep the best point along this edge if it makes sense
+    auto c_itr = bin_candidates.begin();
+    for (auto p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
+      // is this edge reachable in the right way
+      bool reachable = reach.outbound >= p_itr->location.min_outbound_reach_ &&
+                       reach.inbound >= p_itr->location.min_inbound_reach_;
+      // it's possible that it isnt reachable but the opposing is, switch to that if so
+      const GraphTile* opp_tile = tile;
+      const DirectedEdge* opp_edge = nullptr;
+      if (!reachable && (opp_edge = reader.GetOpposingEdge(edge, opp_tile)) &&
+          edge_filter(opp_edge) > 0.f) {
+        auto opp_reach = check_reachability(begin, end, opp_tile, opp_edge);
+        if (opp_reach.outbound >= p_itr->location.min_outbound_reach_ &&
+            opp_reach.inbound >= p_itr->location.min_inbound_reach_) {
+          tile = opp_tile;
+          edge = opp_edge;
+          reach = opp_reach;
+          reachable = true;
+        }
       }
+
+      // which batch of findings will this go into
+      auto* batch = reachable ? &p_itr->reachable : &p_itr->unreachable;
+
+      // if its empty append
+      if (batch->empty()) {
+        c_itr->edge = edge;
+        c_itr->edge_id = e;
+        c_itr->edge_info = edge_info;
+        c_itr->tile = tile;
+        batch->emplace_back(std::move(*c_itr));
+        continue;
+      }
+
+      // get some info about possibilities
+      bool in_radius = c_itr->sq_distance < p_itr->sq_radius;
+      bool better = c_itr->sq_distance < batch->back().sq_distance;
+      bool last_in_radius = batch->back().sq_distance < p_itr->sq_radius;
+      // TODO: this is a bit blunt in that any reachable edges between the best or ones within
+      // the radius will make unreachable edges that are even the tiniest bit further away unviable
+      // it seems like we should have a slightly looser radius to allow for unreachable edges but
+      // its unclear what that should be as in most cases we are working around not actually knowing
+      // the accuracy or even input modality of the incoming location
+      bool closer_external_reachable =
+          reachable && c_itr->sq_distance < p_itr->closest_external_reachable;
+
+      // it has to either be better or in the radius to move on
+      if (in_radius || better) {
+        c_itr->edge = edge;
+        c_itr->edge_id = e;
+        c_itr->edge_info = edge_info;
+        c_itr->tile = tile;
+        // the last one wasnt in the radius so replace it with this one because its better or is
+        // in the radius
+        if (!last_in_radius) {
+          if (closer_external_reachable)
+            p_itr->closest_external_reachable = batch->back().sq_distance;
+          batch->back() = std::move(*c_itr);
+          // last one is in the radius but this one is better so put it on the end
+        } else if (better) {
+          batch->emplace_back(std::move(*c_itr));
+          // last one and this one are both in the radius but this one is not as good
+        } else {
+          batch->emplace_back(std::move(*c_itr));
+          std::swap(*(batch->end() - 1), *(batch->end() - 2));
+        }
+      } // not in radius or better and reachable and closer than closest one outside of radius
+      else if (closer_external_reachable)
+        p_itr->closest_external_reachable = c_itr->sq_distance;
     }
-    return best;
   }
 
-  // we keep the points sorted at each round such that unfinished ones
-  // are at the front of the sorted list
+  // we keep the points sorted at each round such that unfinished ones are at the front and the
+  // ones sharing a bin are next to each other, in the order a hilbert curve visits the bins. each
+  // round handles all of the bins the points are at, one after the other or with their
+  // projections done on multiple threads
   void search() {
+    std::vector<range_t> ranges;
     std::sort(pps.begin(), pps.end());
     while (pps.front().has_bin()) {
-      auto range = find_best_range(pps);
-      handle_bin(range.first, range.second);
+      ranges.clear();
+      for (auto first = pps.begin(); first != pps.end() && first->has_bin();) {
+        auto last = std::find_if_not(first, pps.end(), [&first](const projector_wrapper& pp) {
+          return first->has_same_bin(pp);
+        });
+        ranges.emplace_back(first, last);
+        first = last;
+      }
+      if (threads > 1) {
+        handle_bins(ranges);
+      } else {
+        for (const auto& range : ranges) {
+          handle_bin(range.first, range.second);
+        }
+      }
       std::sort(pps.begin(), pps.end());
     }
   }
@@ -639,12 +857,15 @@ struct bin_handler_t {
       std::vector<PathLocation::PathEdge> filtered;
       for (const auto& candidate : pp.reachable) {
         // this may be at a node, either because it was the closest thing or from snap tolerance
-        bool front = candidate.point == candidate.edge_info->shape().front() ||
-                     pp.location.latlng_.Distance(candidate.edge_info->shape().front()) <
-                         pp.location.node_snap_tolerance_;
-        bool back = candidate.point == candidate.edge_info->shape().back() ||
-                    pp.location.latlng_.Distance(candidate.edge_info->shape().back()) <
-                        pp.location.node_snap_tolerance_;
+        auto shape = candidate.edge_info->lazy_shape();
+        auto first = shape.pop(), last = first;
+        while (!shape.empty()) {
+          last = shape.pop();
+        }
+        bool front = candidate.point == first ||
+                     pp.location.latlng_.Distance(first) < pp.location.node_snap_tolerance_;
+        bool back = candidate.point == last ||
+                    pp.location.latlng_.Distance(last) < pp.location.node_snap_tolerance_;
         // it was the begin node
         if ((front && candidate.edge->forward()) || (back && !candidate.edge->forward())) {
           const GraphTile* other_tile;
@@ -724,12 +945,13 @@ namespace loki {
 std::unordered_map<valhalla::baldr::Location, PathLocation>
 Search(const std::vector<valhalla::baldr::Location>& locations,
        GraphReader& reader,
-       const DynamicCost* costing) {
+       const DynamicCost* costing,
+       size_t threads) {
   // trivially finished already
   if (locations.empty())
     return std::unordered_map<valhalla::baldr::Location, PathLocation>{};
   // setup the unique list of locations
-  bin_handler_t handler(locations, reader, costing);
+  bin_handler_t handler(locations, reader, costing, threads);
   // search over the bins doing multiple locations per bin
   handler.search();
   // turn each locations candidate set into path locations
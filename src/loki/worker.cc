@@ -1,4 +1,5 @@
 #include <boost/property_tree/ptree.hpp>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <sstream>
@@ -17,6 +18,7 @@
 #include "sif/pedestriancost.h"
 #include "tyr/actor.h"
 
+#include "loki/avoid_polygons.h"
 #include "loki/search.h"
 #include "loki/worker.h"
 
@@ -80,7 +82,14 @@ void loki_worker_t::parse_costing(Api& api) {
   }
 
   try {
-    costing = factory.Create(costing_type, options);
+    // Reuse the costing of an earlier request with the same costing options
+    costing = costing_cache.Get(costing_type, options, [&]() {
+      auto start = std::chrono::steady_clock::now();
+      auto cost = factory.Create(costing_type, options);
+      metrics.costing(
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      return cost;
+    });
   } catch (const std::runtime_error&) { throw valhalla_exception_t{125, "'" + costing_str + "'"}; }
 
   // See if we have avoids and take care of them
@@ -129,6 +138,11 @@ void loki_worker_t::parse_costing(Api& api) {
     }
   }
 
+  // Rasterize the avoid polygons into a mask of the avoided edges of each tile under them
+  if (options.avoid_polygons_size()) {
+    AddAvoidMasks(options, *reader, avoid_mask_cache.get());
+  }
+
   // If more alternates are requested than we support we cap it
   if (options.alternates() > max_alternates)
     options.set_alternates(max_alternates);
@@ -136,15 +150,24 @@ void loki_worker_t::parse_costing(Api& api) {
 
 loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
-    : config(config), reader(graph_reader),
+    : config(config), costing_cache(config.get<size_t>("loki.costing_cache_size", 0)),
+      reader(graph_reader),
+      avoid_mask_cache(
+          AvoidMaskCache::Global(config.get<size_t>("loki.avoid_mask_cache_size", 0))),
       connectivity_map(config.get<bool>("loki.use_connectivity", true)
-                           ? new connectivity_map_t(config.get_child("mjolnir"))
+                           ? connectivity_map_t::Global(config.get_child("mjolnir"))
                            : nullptr),
-      long_request(config.get<float>("loki.logging.long_request")),
+      long_request(config.get<float>("loki.logging.long_request")), metrics("loki"),
+      admission(config, "loki"),
       max_contours(config.get<size_t>("service_limits.isochrone.max_contours")),
       max_time(config.get<size_t>("service_limits.isochrone.max_time")),
+      max_batch_locations(
+          config.get<size_t>("service_limits.isochrone.max_batch_locations",
+                             config.get<size_t>("service_limits.isochrone.max_locations"))),
       max_trace_shape(config.get<size_t>("service_limits.trace.max_shape")),
-      sample(config.get<std::string>("additional_data.elevation", "test/data/")),
+      sample(config.get<std::string>("additional_data.elevation", "test/data/"),
+             config.get<size_t>("additional_data.elevation_cache_size", 0),
+             config.get<std::string>("additional_data.elevation_cache_dir", "")),
       max_elevation_shape(config.get<size_t>("service_limits.skadi.max_shape")),
       min_resample(config.get<float>("service_limits.skadi.min_resample")) {
   // If we weren't provided with a graph reader make our own
@@ -169,7 +192,7 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   for (const auto& kv : config.get_child("service_limits")) {
     if (kv.first == "max_avoid_locations" || kv.first == "max_reachability" ||
         kv.first == "max_radius" || kv.first == "max_timedep_distance" ||
-        kv.first == "max_alternates") {
+        kv.first == "max_alternates" || kv.first == "max_timeout") {
       continue;
     }
     if (kv.first != "skadi" && kv.first != "trace") {
@@ -224,12 +247,70 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   max_best_paths = config.get<unsigned int>("service_limits.trace.max_best_paths");
   max_best_paths_shape = config.get<size_t>("service_limits.trace.max_best_paths_shape");
   max_alternates = config.get<unsigned int>("service_limits.max_alternates");
+  max_timeout = config.get<float>("service_limits.max_timeout", 0.f);
+  search_threads = config.get<size_t>("loki.search_threads", 1);
+  correlation_cache = CorrelationCache::Global(config.get<size_t>("loki.correlation_cache_size", 0));
+  height_threads = config.get<size_t>("loki.height_threads", 1);
+
+  // the shards valhalla_build_shards split the tiles into and the one these tiles are
+  shard = -1;
+  auto shards_file = config.get<std::string>("loki.shards.file", "");
+  if (!shards_file.empty()) {
+    boost::property_tree::ptree shards_pt;
+    rapidjson::read_json(shards_file, shards_pt);
+    shards = ShardMap(shards_pt);
+    shard = shards.Index(config.get<std::string>("loki.shards.name", ""));
+    if (shard == -1) {
+      throw std::runtime_error("loki.shards.name is not one of the shards of " + shards_file);
+    }
+  }
 
   // Register standard edge/node costing methods
   factory.RegisterStandardCostingModels();
 }
 
+std::unordered_map<Location, PathLocation>
+loki_worker_t::search(const std::vector<Location>& locations, const Options& options, size_t threads) {
+  // without a costing every edge is a candidate, which is not worth caching
+  if (!correlation_cache || !costing) {
+    return loki::Search(locations, *reader, costing.get(), threads);
+  }
+  return correlation_cache->Search(locations, *reader, costing.get(),
+                                   sif::CostingCache::Key(options.costing(), options), threads);
+}
+
+void loki_worker_t::limit_deadline(Api& request) const {
+  if (max_timeout <= 0) {
+    return;
+  }
+  auto& options = *request.mutable_options();
+  auto deadline = microseconds_since_epoch() + static_cast<uint64_t>(max_timeout * 1e6);
+  if (!options.has_deadline() || options.deadline() > deadline) {
+    options.set_deadline(deadline);
+  }
+}
+
+std::string loki_worker_t::shard_url(const Api& request) const {
+  if (shard == -1) {
+    return {};
+  }
+  const auto& options = request.options();
+  std::vector<PointLL> points;
+  for (const auto* locations :
+       {&options.locations(), &options.sources(), &options.targets(), &options.shape()}) {
+    for (const auto& location : *locations) {
+      points.emplace_back(location.ll().lng(), location.ll().lat());
+    }
+  }
+  // requests outside of every shard and shards without a url are served here
+  auto found = shards.Find(points);
+  return found == -1 || found == shard ? std::string() : shards.shards()[found].url;
+}
+
 void loki_worker_t::cleanup() {
+  // switch to a newly swapped in tile extract between requests
+  reader->UpdateTileExtract();
+  reader->ReportMetrics();
   if (reader->OverCommitted()) {
     reader->Trim();
   }
@@ -245,7 +326,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
   auto s = std::chrono::system_clock::now();
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Loki Request " + std::to_string(info.id));
-  Api request;
+  Api& request = new_request();
   try {
     // request parsing
     auto http_request =
@@ -259,8 +340,18 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
       return jsonify_error({106, action_str}, info, request);
     }
 
-    // Set the interrupt function
+    // requests the tiles of another shard serve are sent there
+    auto url = shard_url(request);
+    if (!url.empty()) {
+      return to_redirect(url, http_request, info);
+    }
+
+    // Set the interrupt function and when to give up on the request
     service_worker_t::set_interrupt(interrupt_function);
+    limit_deadline(request);
+    service_worker_t::set_deadline(options.deadline());
+    // expensive requests may have to wait for a turn so they do not hold up the cheap ones
+    auto ticket = admission.admit(request, *interrupt);
 
     prime_server::worker_t::result_t result{true};
     // do request specific processing
@@ -268,7 +359,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
       case Options::route:
       case Options::expansion:
         route(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(forward(request));
         break;
       case Options::locate:
         result = to_response_json(locate(request), info, request);
@@ -276,16 +367,16 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
       case Options::sources_to_targets:
       case Options::optimized_route:
         matrix(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(forward(request));
         break;
       case Options::isochrone:
         isochrones(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(forward(request));
         break;
       case Options::trace_attributes:
       case Options::trace_route:
         trace(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(forward(request));
         break;
       case Options::height:
         result = to_response_json(height(request), info, request);
@@ -300,6 +391,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
     // get processing time for loki
     auto e = std::chrono::system_clock::now();
     std::chrono::duration<float, std::milli> elapsed_time = e - s;
+    metrics.request(request, elapsed_time.count() / 1000);
     // log request if greater than X (ms)
     auto work_units = options.locations_size()
                           ? options.locations_size()
@@ -332,7 +424,11 @@ void run_service(const boost::property_tree::ptree& config) {
 
   // listen for requests
   zmq::context_t context;
-  loki_worker_t loki_worker(config);
+  auto reader = std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"));
+  // warm up the tile cache with the tiles used most before taking any requests
+  reader->Preload(config.get<size_t>("mjolnir.preload_tiles", 0),
+                  config.get<size_t>("mjolnir.preload_threads", 4));
+  loki_worker_t loki_worker(config, reader);
   prime_server::worker_t worker(context, upstream_endpoint, downstream_endpoint, loopback_endpoint,
                                 interrupt_endpoint,
                                 std::bind(&loki_worker_t::work, std::ref(loki_worker),
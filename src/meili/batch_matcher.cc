@@ -0,0 +1,120 @@
+#include "meili/batch_matcher.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// How many traces per thread may be taken past the oldest one that is not done yet, which
+// bounds the results waiting to be handed back in order
+constexpr size_t kPendingPerThread = 8;
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+BatchMatcher::BatchMatcher(const boost::property_tree::ptree& config,
+                           const std::shared_ptr<baldr::GraphReader>& reader,
+                           unsigned int threads) {
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  for (unsigned int i = 0; i < threads; ++i) {
+    // Threads without the shared reader load their own tiles
+    std::shared_ptr<baldr::GraphReader> shared;
+    if (reader && (i == 0 || reader->IsThreadSafe())) {
+      shared = reader;
+    }
+    factories_.emplace_back(new MapMatcherFactory(config, shared));
+  }
+}
+
+void BatchMatcher::Match(const Options& options,
+                         const next_t& next,
+                         const done_t& done,
+                         uint32_t k) {
+  struct trace_t {
+    std::vector<Measurement> measurements;
+    std::vector<MatchResults> results;
+  };
+
+  std::mutex mutex;
+  std::condition_variable handed_back;
+  std::map<size_t, trace_t> finished;
+  size_t next_index = 0, done_index = 0;
+  bool more = true;
+  std::exception_ptr error;
+  const size_t max_pending = kPendingPerThread * factories_.size();
+
+  auto work = [&](MapMatcherFactory& factory) {
+    try {
+      std::unique_ptr<MapMatcher> matcher(factory.Create(options));
+      while (true) {
+        // Take the next trace unless too many results are waiting for an older one
+        size_t index;
+        std::vector<Measurement> measurements;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          handed_back.wait(lock, [&]() {
+            return !more || error || next_index - done_index < max_pending;
+          });
+          if (!more || error) {
+            return;
+          }
+          if (!next(measurements)) {
+            more = false;
+            handed_back.notify_all();
+            return;
+          }
+          index = next_index++;
+        }
+
+        auto results = matcher->OfflineMatch(measurements, k);
+        factory.ClearGridCache();
+
+        // Hand back the results of this and the traces after it that are done, in order
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.emplace(index, trace_t{std::move(measurements), std::move(results)});
+        for (auto trace = finished.begin(); trace != finished.end() && trace->first == done_index;
+             trace = finished.erase(trace), ++done_index) {
+          done(trace->first, std::move(trace->second.measurements),
+               std::move(trace->second.results));
+        }
+        handed_back.notify_all();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      handed_back.notify_all();
+    }
+  };
+
+  // The calling thread is one of the workers
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < factories_.size(); ++i) {
+    threads.emplace_back(work, std::ref(*factories_[i]));
+  }
+  work(*factories_.front());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Nobody is using the tiles anymore so its safe to trim them
+  for (auto& factory : factories_) {
+    factory->ClearFullCache();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace meili
+} // namespace valhalla
@@ -159,8 +159,10 @@ void IndexBin(const baldr::GraphTile& tile,
 
 CandidateGridQuery::CandidateGridQuery(baldr::GraphReader& reader,
                                        float cell_width,
-                                       float cell_height)
-    : CandidateQuery(reader), cell_width_(cell_width), cell_height_(cell_height), grid_cache_() {
+                                       float cell_height,
+                                       const std::shared_ptr<CandidateGridCache>& shared_cache)
+    : CandidateQuery(reader), cell_width_(cell_width), cell_height_(cell_height), grid_cache_(),
+      shared_cache_(shared_cache) {
   bin_level_ = baldr::TileHierarchy::levels().rbegin()->second.level;
 }
 
@@ -174,10 +176,26 @@ CandidateGridQuery::GetGrid(const int32_t bin_id,
   // Check if the bin is in the cache
   const auto it = grid_cache_.find(bin_id);
   if (it != grid_cache_.end()) {
-    return &(it->second);
+    return it->second.get();
   }
 
-  // Not in the cache. Get the tile and Index the bin within the tile.
+  // Not in the cache. Another query may have made it already, otherwise make it
+  CandidateGridCache::grid_ptr_t grid;
+  if (shared_cache_) {
+    grid = shared_cache_->Get(bin_id, [&]() { return MakeGrid(bin_id, tiles, bins); });
+  } else {
+    grid = MakeGrid(bin_id, tiles, bins);
+  }
+  if (!grid) {
+    return nullptr;
+  }
+  return grid_cache_.emplace(bin_id, std::move(grid)).first->second.get();
+}
+
+CandidateGridCache::grid_ptr_t CandidateGridQuery::MakeGrid(const int32_t bin_id,
+                                                            const Tiles<PointLL>& tiles,
+                                                            const Tiles<PointLL>& bins) const {
+  // Get the tile and Index the bin within the tile.
   int32_t ndiv = tiles.nsubdivisions();
   auto rc = bins.GetRowColumn(bin_id);
   int32_t tile_id = tiles.TileId(rc.second / ndiv, rc.first / ndiv);
@@ -192,11 +210,10 @@ CandidateGridQuery::GetGrid(const int32_t bin_id,
   int32_t bin_col = rc.second % ndiv;
   int32_t bin_index = (bin_row * ndiv) + bin_col;
 
-  // Insert the bin into the cache and index the bin
-  const auto inserted =
-      grid_cache_.emplace(bin_id, grid_t(tile->BoundingBox(), cell_width_, cell_height_));
-  IndexBin(*tile, bin_index, reader_, inserted.first->second);
-  return &(inserted.first->second);
+  // Index the bin
+  auto grid = std::make_shared<grid_t>(tile->BoundingBox(), cell_width_, cell_height_);
+  IndexBin(*tile, bin_index, reader_, *grid);
+  return grid;
 }
 
 std::unordered_set<baldr::GraphId>
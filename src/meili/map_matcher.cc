@@ -14,6 +14,9 @@ using namespace valhalla::meili;
 
 constexpr float MAX_ACCUMULATED_COST = 99999999;
 
+// Measurements the paths get to converge in the online matching before they are cut
+constexpr uint32_t kDefaultOnlineWindow = 60;
+
 inline float GreatCircleDistanceSquared(const Measurement& left, const Measurement& right) {
   return left.lnglat().DistanceSquared(right.lnglat());
 }
@@ -46,6 +49,13 @@ struct Interpolation {
   }
 };
 
+// Whether the trace lingered at the last matched measurement before moving on to the next one,
+// which is when a measurement interpolated in between is much closer to the last one
+inline bool Lingered(const Measurement& last, const Measurement& next, const Measurement& between) {
+  auto p = between.lnglat().Project(last.lnglat(), next.lnglat());
+  return p.Distance(last.lnglat()) / last.lnglat().Distance(next.lnglat()) < .2f;
+}
+
 inline MatchResult CreateMatchResult(const Measurement& measurement) {
   return {measurement.lnglat(), 0.f, baldr::GraphId{}, -1.f, measurement.epoch_time(), StateId()};
 }
@@ -184,17 +194,13 @@ std::vector<MatchResult> InterpolateMeasurements(const MapMatcher& mapmatcher,
   return results;
 }
 
-// Find the match result of a state, given its previous state and next state
+// Find the match result of a state at a time, given its previous state and next state
 MatchResult FindMatchResult(const MapMatcher& mapmatcher,
-                            const std::vector<StateId>& stateids,
+                            const StateId& prev_stateid,
+                            const StateId& stateid,
+                            const StateId& next_stateid,
                             StateId::Time time,
                             baldr::GraphReader& graph_reader) {
-  if (!(time < stateids.size())) {
-    throw std::runtime_error("reading stateid at time out of bounds");
-  }
-
-  const auto &prev_stateid = 0 < time ? stateids[time - 1] : StateId(), stateid = stateids[time],
-             next_stateid = time + 1 < stateids.size() ? stateids[time + 1] : StateId();
   const auto& measurement = mapmatcher.state_container().measurement(time);
 
   if (!stateid.IsValid()) {
@@ -274,7 +280,10 @@ std::vector<MatchResult> FindMatchResults(const MapMatcher& mapmatcher,
                                           baldr::GraphReader& graph_reader) {
   std::vector<MatchResult> results;
   for (StateId::Time time = 0; time < stateids.size(); time++) {
-    results.push_back(FindMatchResult(mapmatcher, stateids, time, graph_reader));
+    const auto& prev_stateid = 0 < time ? stateids[time - 1] : StateId();
+    const auto& next_stateid = time + 1 < stateids.size() ? stateids[time + 1] : StateId();
+    results.push_back(FindMatchResult(mapmatcher, prev_stateid, stateids[time], next_stateid, time,
+                                      graph_reader));
   }
 
   return results;
@@ -326,7 +335,9 @@ MapMatcher::MapMatcher(const boost::property_tree::ptree& config,
                              container_,
                              mode_costing_,
                              travelmode_,
-                             config_) {
+                             config_),
+      online_time_(0), online_result_(),
+      online_window_(std::max(config_.get<uint32_t>("online_window", kDefaultOnlineWindow), 1u)) {
   vs_.set_emission_cost_model(emission_cost_model_);
   vs_.set_transition_cost_model(transition_cost_model_);
 }
@@ -341,6 +352,10 @@ void MapMatcher::Clear() {
   vs_.set_transition_cost_model(transition_cost_model_);
   ts_.Clear();
   container_.Clear();
+  transition_cost_model_.ClearQueueStats();
+  interpolated_.clear();
+  online_time_ = 0;
+  online_result_ = {};
 }
 
 void MapMatcher::RemoveRedundancies(const std::vector<StateId>& result) {
@@ -694,13 +709,11 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
     if (sq_interpolation_distance < sq_distance || std::next(m) == measurements.end()) {
       // If there were interpolated points between these two points with time information
       if (interpolated_epoch_time != -1) {
-        // Project the last interpolated point onto the line between the two match points
-        auto p = interpolated[time].back().lnglat().Project(last->lnglat(), m->lnglat());
-        // If its significantly closer to the previous match point then it looks like the trace
-        // lingered so we use the time information of the last interpolation point as the actual
-        // time they started traveling towards the next match point which will help us determine
-        // what paths are really likely
-        if (p.Distance(last->lnglat()) / last->lnglat().Distance(m->lnglat()) < .2f) {
+        // If the last interpolated point is significantly closer to the previous match point then
+        // it looks like the trace lingered so we use the time information of the last
+        // interpolation point as the actual time they started traveling towards the next match
+        // point which will help us determine what paths are really likely
+        if (Lingered(*last, *m, interpolated[time].back())) {
           container_.SetMeasurementLeaveTime(time, interpolated_epoch_time);
         }
       }
@@ -722,6 +735,145 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
   return interpolated;
 }
 
+MatchResults MapMatcher::OnlineMatch(const Measurement& measurement) {
+  const float max_search_radius = config_.get<float>("max_search_radius"),
+              sq_max_search_radius = max_search_radius * max_search_radius;
+  const float interpolation_distance = config_.get<float>("interpolation_distance"),
+              sq_interpolation_distance = interpolation_distance * interpolation_distance;
+
+  // Always match the first measurement, the ones close to the last match are interpolated
+  if (0 < container_.size()) {
+    const auto time = container_.size() - 1;
+    if (GreatCircleDistanceSquared(container_.measurement(time), measurement) <=
+        sq_interpolation_distance) {
+      interpolated_[time].push_back(measurement);
+      return MatchResults(std::vector<MatchResult>{}, std::vector<EdgeSegment>{}, 0);
+    }
+    UpdateLeaveTime(measurement);
+  }
+  const auto time = AppendMeasurement(measurement, sq_max_search_radius);
+  vs_.SearchWinner(time);
+
+  // The results are final before the time the paths converged at, unless they take too long
+  auto converged = vs_.ConvergedTime();
+  if ((converged == kInvalidTime || converged <= online_time_) &&
+      online_window_ <= time - online_time_) {
+    CutOnlineMatch();
+    converged = online_time_ + 1;
+  }
+  if (converged == kInvalidTime || converged <= online_time_) {
+    return MatchResults(std::vector<MatchResult>{}, std::vector<EdgeSegment>{}, 0);
+  }
+  return EmitOnlineMatch(converged);
+}
+
+MatchResults MapMatcher::FinishOnlineMatch() {
+  if (container_.size() == 0) {
+    return MatchResults(std::vector<MatchResult>{}, std::vector<EdgeSegment>{}, 0);
+  }
+
+  // Always match the last measurement
+  auto time = container_.size() - 1;
+  const auto found = interpolated_.find(time);
+  if (found != interpolated_.end()) {
+    const auto measurement = found->second.back();
+    found->second.pop_back();
+    if (found->second.empty()) {
+      interpolated_.erase(found);
+    }
+    UpdateLeaveTime(measurement);
+    const float max_search_radius = config_.get<float>("max_search_radius");
+    time = AppendMeasurement(measurement, max_search_radius * max_search_radius);
+  }
+  vs_.SearchWinner(time);
+
+  // Everything is final now, get ready for the next trace
+  auto results = EmitOnlineMatch(time + 1);
+  Clear();
+  return results;
+}
+
+void MapMatcher::UpdateLeaveTime(const Measurement& next) {
+  const auto time = container_.size() - 1;
+  const auto found = interpolated_.find(time);
+  if (found != interpolated_.end() && found->second.back().epoch_time() != -1 &&
+      Lingered(container_.measurement(time), next, found->second.back())) {
+    container_.SetMeasurementLeaveTime(time, found->second.back().epoch_time());
+  }
+}
+
+void MapMatcher::CutOnlineMatch() {
+  // The best path at the times from the last final one to the two after it
+  const auto last = container_.size() - 1;
+  const auto first = container_.first_time() < online_time_ ? online_time_ - 1 : online_time_;
+  std::vector<StateId> path(online_time_ + 2 - first);
+  for (auto it = vs_.SearchPath(last); it != vs_.PathEnd(); ++it) {
+    if (first <= it.time() && it.time() < first + path.size()) {
+      path[it.time() - first] = *it;
+    }
+  }
+
+  // Remove the other states there and search again, the paths now converge after it
+  for (auto time = first; time < first + path.size(); ++time) {
+    for (const auto& state : container_.column(time)) {
+      if (state.stateid() != path[time - first]) {
+        vs_.RemoveStateId(state.stateid());
+      }
+    }
+  }
+  vs_.ClearSearch();
+  vs_.SearchWinner(last);
+}
+
+MatchResults MapMatcher::EmitOnlineMatch(StateId::Time end) {
+  // The best path to the latest time, which is final before the given time
+  const auto first = container_.first_time(), last = container_.size() - 1;
+  std::vector<StateId> path(last + 1 - first);
+  for (auto it = vs_.SearchPath(last); it != vs_.PathEnd(); ++it) {
+    path[it.time() - first] = *it;
+  }
+  const auto stateid = [&path, first, last](StateId::Time time) {
+    return first <= time && time <= last ? path[time - first] : StateId();
+  };
+
+  // Begin with the last final match so that the route continues the one returned before
+  std::vector<MatchResult> results;
+  if (online_result_.HasState() && online_result_.stateid.time() + 1 == online_time_) {
+    results.push_back(online_result_);
+  }
+  const bool continued = !results.empty();
+
+  for (auto time = online_time_; time < end; ++time) {
+    const auto prev_stateid = 0 < time ? stateid(time - 1) : StateId();
+    results.push_back(
+        FindMatchResult(*this, prev_stateid, stateid(time), stateid(time + 1), time, graphreader_));
+    online_result_ = results.back();
+
+    // Interpolate the points between this and the next state
+    const auto found = interpolated_.find(time);
+    if (found != interpolated_.end()) {
+      const auto& interpolated_results =
+          InterpolateMeasurements(*this, found->second, stateid(time), stateid(time + 1));
+      std::copy(interpolated_results.cbegin(), interpolated_results.cend(),
+                std::back_inserter(results));
+      interpolated_.erase(found);
+    }
+  }
+
+  auto segments = ConstructRoute(*this, results.cbegin(), results.cend());
+  if (continued) {
+    results.erase(results.begin());
+  }
+  const auto score = vs_.AccumulatedCost(stateid(end - 1));
+  online_time_ = end;
+
+  // Keep the last final time, the next results need its state
+  vs_.Forget(end - 1);
+  container_.DropBefore(end - 1);
+
+  return MatchResults(std::move(results), std::move(segments), score);
+}
+
 StateId::Time MapMatcher::AppendMeasurement(const Measurement& measurement,
                                             const float sq_max_search_radius) {
   // Test interrupt
@@ -1,3 +1,4 @@
+#include <mutex>
 #include <string>
 
 #include "baldr/graphreader.h"
@@ -20,6 +21,21 @@ inline float local_tile_size() {
   return tiles.TileSize();
 }
 
+// One process wide cache of the candidate grids when asked for, every factory shares it
+std::shared_ptr<valhalla::meili::CandidateGridCache>
+shared_grid_cache(const boost::property_tree::ptree& root) {
+  if (!root.get<bool>("meili.grid.global_cache", false)) {
+    return nullptr;
+  }
+  static std::mutex mutex;
+  static std::shared_ptr<valhalla::meili::CandidateGridCache> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!cache) {
+    cache.reset(new valhalla::meili::CandidateGridCache(root.get<size_t>("meili.grid.cache_size")));
+  }
+  return cache;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -33,7 +49,8 @@ MapMatcherFactory::MapMatcherFactory(const boost::property_tree::ptree& root,
     graphreader_.reset(new baldr::GraphReader(root.get_child("mjolnir")));
   candidatequery_.reset(
       new CandidateGridQuery(*graphreader_, local_tile_size() / root.get<size_t>("meili.grid.size"),
-                             local_tile_size() / root.get<size_t>("meili.grid.size")));
+                             local_tile_size() / root.get<size_t>("meili.grid.size"),
+                             shared_grid_cache(root)));
   cost_factory_.RegisterStandardCostingModels();
 }
 
@@ -95,6 +112,10 @@ void MapMatcherFactory::ClearFullCache() {
     graphreader_->Trim();
   }
 
+  ClearGridCache();
+}
+
+void MapMatcherFactory::ClearGridCache() {
   if (candidatequery_->size() > max_grid_cache_size_) {
     candidatequery_->Clear();
   }
@@ -103,6 +124,9 @@ void MapMatcherFactory::ClearFullCache() {
 void MapMatcherFactory::ClearCache() {
   graphreader_->Clear();
   candidatequery_->Clear();
+  if (candidatequery_->shared_cache()) {
+    candidatequery_->shared_cache()->Clear();
+  }
 }
 
 } // namespace meili
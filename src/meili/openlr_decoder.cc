@@ -0,0 +1,180 @@
+#include "meili/openlr_decoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "baldr/graphtile.h"
+#include "midgard/openlr.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// The distance to the next location reference point is encoded in a byte of 58.6 meter steps
+constexpr float kMaxLrpDistance = 255 * 58.6f;
+
+// Consecutive location reference points can be further apart than measurements of a trace are,
+// connectivity between them is considered up to the longest distance that can be encoded
+boost::property_tree::ptree decoder_config(const boost::property_tree::ptree& config) {
+  auto copy = config;
+  auto breakage_distance = copy.get<float>("meili.default.breakage_distance");
+  copy.put<float>("meili.default.breakage_distance", std::max(breakage_distance, kMaxLrpDistance));
+  return copy;
+}
+
+// The location reference points as measurements, they have no time
+std::vector<valhalla::meili::Measurement> to_measurements(const OpenLR::LineLocation& location,
+                                                          float gps_accuracy,
+                                                          float search_radius) {
+  std::vector<valhalla::meili::Measurement> measurements;
+  measurements.reserve(location.intermediate.size() + 2);
+  measurements.emplace_back(location.getFirstCoordinate(), gps_accuracy, search_radius, -1);
+  for (const auto& lrp : location.intermediate) {
+    measurements.emplace_back(PointLL{lrp.longitude, lrp.latitude}, gps_accuracy, search_radius,
+                              -1);
+  }
+  measurements.emplace_back(location.getLastCoordinate(), gps_accuracy, search_radius, -1);
+  return measurements;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+OpenLRDecoder::OpenLRDecoder(const boost::property_tree::ptree& config,
+                             const std::shared_ptr<baldr::GraphReader>& reader,
+                             unsigned int threads,
+                             size_t max_cached)
+    : reader_(reader ? reader : std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"))),
+      matcher_(decoder_config(config), reader_, threads),
+      gps_accuracy_(config.get<float>("meili.default.gps_accuracy")),
+      search_radius_(config.get<float>("meili.default.search_radius")), max_cached_(max_cached),
+      costing_(Costing::auto_) {
+}
+
+std::vector<OpenLRDecoder::path_ptr>
+OpenLRDecoder::Decode(const Options& options, const std::vector<std::string>& references) {
+  // Paths depend on the costing so the cache only holds those of one
+  if (options.costing() != costing_) {
+    cache_.clear();
+    costing_ = options.costing();
+  }
+
+  // Find the references we have paths for and parse the others, each of them once
+  std::vector<path_ptr> paths(references.size());
+  std::vector<std::pair<size_t, size_t>> waiting;
+  std::unordered_map<std::string, size_t> pending;
+  std::vector<OpenLR::LineLocation> locations;
+  std::vector<const std::string*> keys;
+  for (size_t i = 0; i < references.size(); ++i) {
+    auto cached = cache_.find(references[i]);
+    if (cached != cache_.end()) {
+      paths[i] = cached->second;
+      continue;
+    }
+    auto found = pending.find(references[i]);
+    if (found == pending.end()) {
+      try {
+        locations.emplace_back(references[i]);
+      } catch (const std::invalid_argument&) { continue; }
+      keys.push_back(&references[i]);
+      found = pending.emplace(references[i], locations.size() - 1).first;
+    }
+    waiting.emplace_back(i, found->second);
+  }
+  if (locations.empty()) {
+    return paths;
+  }
+
+  // Match them all at once
+  std::vector<path_t> matched(locations.size());
+  size_t taken = 0;
+  matcher_.Match(
+      options,
+      [&](std::vector<Measurement>& measurements) {
+        if (taken == locations.size()) {
+          return false;
+        }
+        measurements = to_measurements(locations[taken++], gps_accuracy_, search_radius_);
+        return true;
+      },
+      [&](size_t index, std::vector<Measurement>&&, std::vector<MatchResults>&& results) {
+        if (!results.empty()) {
+          matched[index] = std::move(results.front().segments);
+        }
+      });
+
+  // Nobody else is using the reader anymore so we can trim the offsets and keep the paths
+  std::vector<path_ptr> decoded(locations.size());
+  for (size_t i = 0; i < locations.size(); ++i) {
+    Trim(matched[i], locations[i].poff, locations[i].noff);
+    if (!matched[i].empty()) {
+      decoded[i] = std::make_shared<const path_t>(std::move(matched[i]));
+    }
+    if (max_cached_ > 0) {
+      if (cache_.size() >= max_cached_) {
+        cache_.clear();
+      }
+      cache_.emplace(*keys[i], decoded[i]);
+    }
+  }
+  for (const auto& w : waiting) {
+    paths[w.first] = decoded[w.second];
+  }
+  return paths;
+}
+
+void OpenLRDecoder::Trim(path_t& path, float poff, float noff) const {
+  // The path is split where the location reference points matched
+  path_t merged;
+  merged.reserve(path.size());
+  for (const auto& segment : path) {
+    if (!merged.empty() && merged.back().edgeid == segment.edgeid &&
+        merged.back().target == segment.source) {
+      merged.back().target = segment.target;
+    } else {
+      merged.push_back(segment);
+    }
+  }
+  path = std::move(merged);
+
+  // Get the length of an edge, 0 if we cant find it
+  const baldr::GraphTile* tile = nullptr;
+  auto length = [this, &tile](const baldr::GraphId& edgeid) {
+    return reader_->GetGraphTile(edgeid, tile) ? tile->directededge(edgeid)->length() : 0.f;
+  };
+
+  // Drop the edges within the positive offset and cut into the one it ends on
+  size_t begin = 0;
+  for (; begin < path.size() && poff > 0.f; ++begin) {
+    auto& segment = path[begin];
+    float edge_length = length(segment.edgeid);
+    float along = (segment.target - segment.source) * edge_length;
+    if (along > poff) {
+      segment.source += poff / edge_length;
+      break;
+    }
+    poff -= along;
+  }
+
+  // Same for the negative offset from the other end
+  size_t end = path.size();
+  for (; end > begin && noff > 0.f; --end) {
+    auto& segment = path[end - 1];
+    float edge_length = length(segment.edgeid);
+    float along = (segment.target - segment.source) * edge_length;
+    if (along > noff) {
+      segment.target -= noff / edge_length;
+      break;
+    }
+    noff -= along;
+  }
+
+  path.erase(path.begin() + end, path.end());
+  path.erase(path.begin(), path.begin() + begin);
+}
+
+} // namespace meili
+} // namespace valhalla
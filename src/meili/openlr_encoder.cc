@@ -0,0 +1,173 @@
+#include "meili/openlr_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "baldr/directededge.h"
+#include "midgard/openlr.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+using lrp_t = OpenLR::LocationReferencePoint;
+
+// The distance to the next location reference point is encoded in a byte of 58.6 meter steps
+constexpr float kMaxLrpDistance = 255 * 58.6f;
+
+// Bearings are taken towards the point this far along the path, see 5.2.4 of the white paper
+constexpr float kBearingDistance = 20.f;
+
+// A part of an edge of the path
+struct piece_t {
+  GraphId edgeid;
+  float source;
+  float target;
+  float length;
+  const DirectedEdge* edge;
+};
+
+lrp_t::FormOfWay form_of_way(const DirectedEdge* edge) {
+  if (edge->roundabout()) {
+    return lrp_t::ROUNDABOUT;
+  }
+  if (edge->link()) {
+    return lrp_t::SLIPROAD;
+  }
+  if (edge->classification() == RoadClass::kMotorway) {
+    return lrp_t::MOTORWAY;
+  }
+  if (edge->use() != Use::kRoad) {
+    return lrp_t::OTHER;
+  }
+  // A road that can only be driven one way is most likely one side of a divided road
+  return (edge->forwardaccess() & kAutoAccess) && (edge->reverseaccess() & kAutoAccess)
+             ? lrp_t::SINGLE_CARRIAGEWAY
+             : lrp_t::MULTIPLE_CARRIAGEWAY;
+}
+
+lrp_t make_lrp(const PointLL& ll, const float bearing, const DirectedEdge* edge) {
+  lrp_t lrp;
+  lrp.longitude = ll.lng();
+  lrp.latitude = ll.lat();
+  lrp.bearing = bearing;
+  lrp.distance = 0.f;
+  lrp.frc = static_cast<unsigned char>(edge->classification());
+  lrp.lfrcnp = lrp.frc;
+  lrp.fow = form_of_way(edge);
+  return lrp;
+}
+
+// Put the location reference points along the edges. With an offset the path is extended to the
+// node at that end, without one the point is put where the path ends
+OpenLR::LineLocation
+locate(GraphReader& reader, std::vector<piece_t> edges, const float poff, const float noff) {
+  if (poff > 0.f) {
+    edges.front().source = 0.f;
+  }
+  if (noff > 0.f) {
+    edges.back().target = 1.f;
+  }
+
+  // Edges longer than the points can be apart are cut into pieces that are not
+  std::vector<piece_t> pieces;
+  for (const auto& edge : edges) {
+    float along = (edge.target - edge.source) * edge.length;
+    size_t count = std::max(static_cast<size_t>(std::ceil(along / kMaxLrpDistance)), size_t(1));
+    float step = (edge.target - edge.source) / count;
+    for (size_t i = 0; i < count; ++i) {
+      float target = i + 1 == count ? edge.target : edge.source + (i + 1) * step;
+      pieces.push_back({edge.edgeid, edge.source + i * step, target, edge.length, edge.edge});
+    }
+  }
+
+  // Start a new point on a node whenever the next piece would take it too far from the last one
+  std::vector<lrp_t> lrps;
+  std::vector<PointLL> shape;
+  const DirectedEdge* first_edge = nullptr;
+  float distance = 0.f;
+  unsigned char lfrcnp = 0;
+  auto add_lrp = [&]() {
+    lrps.push_back(
+        make_lrp(shape.front(), PointLL::HeadingAlongPolyline(shape, kBearingDistance), first_edge));
+    lrps.back().distance = distance;
+    lrps.back().lfrcnp = lfrcnp;
+  };
+  for (const auto& piece : pieces) {
+    float length = (piece.target - piece.source) * piece.length;
+    if (!shape.empty() && distance + length > kMaxLrpDistance) {
+      add_lrp();
+      shape.clear();
+    }
+    if (shape.empty()) {
+      first_edge = piece.edge;
+      distance = 0.f;
+      lfrcnp = 0;
+    }
+    auto piece_shape = meili::EdgeSegment(piece.edgeid, piece.source, piece.target).Shape(reader);
+    shape.insert(shape.end(), piece_shape.begin() + (shape.empty() ? 0 : 1), piece_shape.end());
+    distance += length;
+    lfrcnp = std::max(lfrcnp, static_cast<unsigned char>(piece.edge->classification()));
+  }
+  add_lrp();
+
+  // The last point looks back along the path
+  float bearing = PointLL::HeadingAtEndOfPolyline(shape, kBearingDistance) + 180.f;
+  auto last = make_lrp(shape.back(), bearing >= 360.f ? bearing - 360.f : bearing,
+                       pieces.back().edge);
+  std::vector<lrp_t> intermediate(lrps.begin() + 1, lrps.end());
+  return OpenLR::LineLocation(lrps.front(), intermediate, last, poff, noff);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+OpenLREncoder::OpenLREncoder(GraphReader& reader) : reader_(reader) {
+}
+
+std::string OpenLREncoder::Encode(const path_t& path) const {
+  // Find the edges, merging the pieces of an edge the path was split into
+  std::vector<piece_t> edges;
+  for (const auto& segment : path) {
+    if (!edges.empty() && edges.back().edgeid == segment.edgeid &&
+        edges.back().target == segment.source) {
+      edges.back().target = segment.target;
+      continue;
+    }
+    const auto* edge = reader_.directededge(segment.edgeid);
+    if (edge == nullptr) {
+      return {};
+    }
+    edges.push_back({segment.edgeid, segment.source, segment.target,
+                     static_cast<float>(edge->length()), edge});
+  }
+  if (edges.empty()) {
+    return {};
+  }
+
+  // The offsets are encoded as a fraction of the distance to the second point, when they are too
+  // long for that the points are put where the path ends instead
+  float poff = edges.front().source * edges.front().length;
+  float noff = (1.f - edges.back().target) * edges.back().length;
+  auto location = locate(reader_, edges, poff, noff);
+  if (location.poff >= location.first.distance || location.noff >= location.first.distance) {
+    location = locate(reader_, edges, 0.f, 0.f);
+  }
+  return location.toBinary();
+}
+
+std::vector<std::string> OpenLREncoder::Encode(const std::vector<path_t>& paths) const {
+  std::vector<std::string> references;
+  references.reserve(paths.size());
+  for (const auto& path : paths) {
+    references.push_back(Encode(path));
+  }
+  return references;
+}
+
+} // namespace meili
+} // namespace valhalla
@@ -12,13 +12,25 @@
 
 #include "meili/routing.h"
 
+namespace {
+
+// Labels popped between calls to the interrupt
+constexpr uint32_t kInterruptIterationsInterval = 5000;
+
+} // namespace
+
 namespace valhalla {
 
 namespace meili {
 
-LabelSet::LabelSet(const float max_cost, const float bucket_size) {
+LabelSet::LabelSet(const float max_cost, const float bucket_size, Workspace workspace)
+    : queue_(std::move(workspace.queue)), status_(std::move(workspace.status)) {
   const auto edgecost = [this](const uint32_t label) { return labels_[label].sortcost(); };
-  queue_.reset(new baldr::DoubleBucketQueue(0.0f, max_cost, bucket_size, edgecost));
+  if (queue_) {
+    queue_->reuse(0.0f, max_cost, bucket_size, edgecost);
+  } else {
+    queue_.reset(new baldr::DoubleBucketQueue(0.0f, max_cost, bucket_size, edgecost));
+  }
 }
 
 void LabelSet::put(const baldr::GraphId& nodeid,
@@ -37,24 +49,23 @@ void LabelSet::put(const baldr::GraphId& nodeid,
 
   // Find the node Id. If not found, create a new label and push
   // it to the queue
-  const auto it = node_status_.find(nodeid);
-  if (it == node_status_.end()) {
+  const Status* status = status_.find(nodeid);
+  if (!status) {
     const uint32_t idx = labels_.size();
     labels_.emplace_back(nodeid, kInvalidDestination, edgeid, source, target, cost, turn_cost,
                          sortcost, predecessor, edge, mode);
     queue_->add(idx);
-    node_status_.emplace(nodeid, idx);
+    status_.emplace(nodeid, idx);
   } else {
     // Node has been found. Check if there is a lower sortcost than the
     // existing label - if so update priority queue and Label
-    const auto& status = it->second;
-    if (!status.permanent && sortcost < labels_[status.label_idx].sortcost()) {
+    if (!status->permanent && sortcost < labels_[status->label_idx].sortcost()) {
       // Update queue first since it uses the label cost within the decrease
       // method to determine the current bucket.
-      queue_->decrease(status.label_idx, sortcost);
-      labels_[status.label_idx] = {nodeid, kInvalidDestination, edgeid,   source,      target,
-                                   cost,   turn_cost,           sortcost, predecessor, edge,
-                                   mode};
+      queue_->decrease(status->label_idx, sortcost);
+      labels_[status->label_idx] = {nodeid, kInvalidDestination, edgeid,   source,      target,
+                                    cost,   turn_cost,           sortcost, predecessor, edge,
+                                    mode};
     }
   }
 }
@@ -76,22 +87,21 @@ void LabelSet::put(const uint16_t dest,
   // Find the destination. If not count, create a new label and push it
   // to the queue
   baldr::GraphId inv;
-  const auto it = dest_status_.find(dest);
-  if (it == dest_status_.end()) {
+  const Status* status = status_.find(dest);
+  if (!status) {
     const uint32_t idx = labels_.size();
     labels_.emplace_back(inv, dest, edgeid, source, target, cost, turn_cost, sortcost, predecessor,
                          edge, travelmode);
     queue_->add(idx);
-    dest_status_.emplace(dest, idx);
+    status_.emplace(dest, idx);
   } else {
     // Decrease cost of the existing label
-    const auto& status = it->second;
-    if (!status.permanent && sortcost < labels_[status.label_idx].sortcost()) {
+    if (!status->permanent && sortcost < labels_[status->label_idx].sortcost()) {
       // Update queue first since it uses the label cost within the decrease
       // method to determine the current bucket.
-      queue_->decrease(status.label_idx, sortcost);
-      labels_[status.label_idx] = {inv,       dest,     edgeid,      source, target,    cost,
-                                   turn_cost, sortcost, predecessor, edge,   travelmode};
+      queue_->decrease(status->label_idx, sortcost);
+      labels_[status->label_idx] = {inv,       dest,     edgeid,      source, target,    cost,
+                                    turn_cost, sortcost, predecessor, edge,   travelmode};
     }
   }
 }
@@ -105,21 +115,20 @@ uint32_t LabelSet::pop() {
   if (idx != baldr::kInvalidLabel) {
     const auto& label = labels_[idx];
     if (label.nodeid().Is_Valid()) {
-      const auto it = node_status_.find(label.nodeid());
+      Status* status = status_.find(label.nodeid());
 
       // When these logic errors happen, go check LabelSet::put
-      if (it == node_status_.end()) {
+      if (!status) {
         // No exception, unless BucketQueue::put was wrong: it said it
         // added but actually failed
         throw std::logic_error("all nodes in the queue should have its status");
       }
-      auto& status = it->second;
-      if (status.label_idx != idx) {
+      if (status->label_idx != idx) {
         throw std::logic_error(
-            "the index stored in the node status " + std::to_string(status.label_idx) +
+            "the index stored in the node status " + std::to_string(status->label_idx) +
             " is not synced up with the index popped from the queue idx = " + std::to_string(idx));
       }
-      if (status.permanent) {
+      if (status->permanent) {
         // For example, if the queue has popped up an index 2, and
         // marked the label at this index as permanent (optimal), then
         // some time later the queue pops up another index 2
@@ -128,25 +137,24 @@ uint32_t LabelSet::pop() {
                                " probably negative costs occurred");
       }
 
-      status.permanent = true;
+      status->permanent = true;
     } else { // assert(label.dest != kInvalidDestination)
-      const auto it = dest_status_.find(label.dest());
+      Status* status = status_.find(label.dest());
 
-      if (it == dest_status_.end()) {
+      if (!status) {
         throw std::logic_error("all dests in the queue should have its status");
       }
-      auto& status = it->second;
-      if (status.label_idx != idx) {
+      if (status->label_idx != idx) {
         throw std::logic_error(
-            "the index stored in the dest status " + std::to_string(status.label_idx) +
+            "the index stored in the dest status " + std::to_string(status->label_idx) +
             " is not synced up with the index popped from the queue idx = " + std::to_string(idx));
       }
-      if (status.permanent) {
+      if (status->permanent) {
         throw std::logic_error("the principle of optimality is violated during routing,"
                                " probably negative costs occurred");
       }
 
-      status.permanent = true;
+      status->permanent = true;
     }
   }
   return idx;
@@ -356,7 +364,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const Label* edgelabel,
                    const float turn_cost_table[181],
                    const float max_dist,
-                   const float max_time) {
+                   const float max_time,
+                   const std::function<void()>* interrupt) {
   Label label;
   const sif::TravelMode travelmode = costing->travel_mode();
 
@@ -460,7 +469,7 @@ find_shortest_path(baldr::GraphReader& reader,
 
     // Handle transitions - expand from the end node each transition
     if (!from_transition && nodeinfo->transition_count() > 0) {
-      const baldr::NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+      const baldr::NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
       for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
         expand(trans->endnode(), label_idx, true);
       }
@@ -474,7 +483,12 @@ find_shortest_path(baldr::GraphReader& reader,
   set_origin(reader, destinations, origin_idx, labelset, travelmode, costing, edgelabel);
 
   std::unordered_map<uint16_t, uint32_t> results;
+  uint32_t n = 0;
   while (true) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
     uint32_t label_idx = labelset->pop();
     if (label_idx == baldr::kInvalidLabel) {
       // Exhausted labels without finding all destinations
@@ -1,5 +1,9 @@
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include "meili/traffic_segment_matcher.h"
 #include "midgard/logging.h"
@@ -119,7 +123,7 @@ namespace meili {
 constexpr float kQueueSpeedThreshold = 2.0f; // approx 4.3 MPH
 
 TrafficSegmentMatcher::TrafficSegmentMatcher(const boost::property_tree::ptree& config)
-    : matcher_factory(config),
+    : config(config), matcher_factory(config),
       customizable(midgard::ToSet<boost::property_tree::ptree, std::unordered_set<std::string>>(
           config.get_child("meili.customizable"))) {
 }
@@ -144,6 +148,88 @@ std::string TrafficSegmentMatcher::match(const std::string& json) {
     return R"({"segments":[]})";
   }
 
+  // Get the segments along the measurements
+  auto traffic_segments = match_segments(matcher, measurements);
+
+  // Check if we are overcommitted on either cache and and clear if needed
+  matcher_factory.ClearFullCache();
+
+  // give back json
+  return serialize(traffic_segments);
+}
+
+std::vector<std::vector<traffic_segment_t>>
+TrafficSegmentMatcher::match(const Options& options,
+                             const std::vector<std::vector<Measurement>>& traces,
+                             unsigned int threads) {
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  threads = std::max(std::min<unsigned int>(threads, traces.size()), 1u);
+
+  // The first thread uses our factory, the others get their own and only share our tiles if
+  // the reader is thread safe
+  std::vector<std::unique_ptr<MapMatcherFactory>> factories;
+  const auto& reader = matcher_factory.graphreader();
+  for (unsigned int i = 1; i < threads; ++i) {
+    std::shared_ptr<baldr::GraphReader> shared;
+    if (reader->IsThreadSafe()) {
+      shared = reader;
+    }
+    factories.emplace_back(new MapMatcherFactory(config, shared));
+  }
+
+  // Each thread takes the next trace and writes its segments in its place
+  std::vector<std::vector<traffic_segment_t>> traffic_segments(traces.size());
+  std::atomic<size_t> next_trace(0);
+  std::mutex mutex;
+  std::exception_ptr error;
+  auto work = [&](MapMatcherFactory& factory) {
+    try {
+      std::shared_ptr<MapMatcher> matcher(factory.Create(options));
+      for (size_t i = next_trace++; i < traces.size(); i = next_trace++) {
+        if (!traces[i].empty()) {
+          traffic_segments[i] = match_segments(matcher, traces[i]);
+        }
+        factory.ClearGridCache();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) {
+          return;
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  };
+
+  // The calling thread is one of the workers
+  std::vector<std::thread> workers;
+  for (auto& factory : factories) {
+    workers.emplace_back(work, std::ref(*factory));
+  }
+  work(matcher_factory);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // Nobody is using the tiles anymore so its safe to trim them
+  matcher_factory.ClearFullCache();
+  for (auto& factory : factories) {
+    factory->ClearFullCache();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return traffic_segments;
+}
+
+std::vector<traffic_segment_t>
+TrafficSegmentMatcher::match_segments(const std::shared_ptr<MapMatcher>& matcher,
+                                      const std::vector<Measurement>& measurements) const {
   // Create the matched path results
   auto topk_matches = matcher->OfflineMatch(measurements);
   const auto& match_results = topk_matches.front().results;
@@ -156,13 +242,7 @@ std::string TrafficSegmentMatcher::match(const std::string& json) {
   auto interpolations = interpolate_matches(match_results, edge_segments, matcher);
 
   // Get the segments along the measurements
-  auto traffic_segments = form_segments(interpolations, matcher->graphreader());
-
-  // Check if we are overcommitted on either cache and and clear if needed
-  matcher_factory.ClearFullCache();
-
-  // give back json
-  return serialize(traffic_segments);
+  return form_segments(interpolations, matcher->graphreader());
 }
 
 std::list<std::vector<interpolation_t>>
@@ -1,13 +1,6 @@
 #include "meili/transition_cost_model.h"
 #include "meili/routing.h"
 
-namespace {
-inline float GreatCircleDistance(const valhalla::meili::Measurement& left,
-                                 const valhalla::meili::Measurement& right) {
-  return left.lnglat().Distance(right.lnglat());
-}
-} // namespace
-
 namespace valhalla {
 namespace meili {
 
@@ -26,7 +19,8 @@ TransitionCostModel::TransitionCostModel(baldr::GraphReader& graphreader,
       travelmode_(travelmode), beta_(beta), inv_beta_(1.f / beta_),
       breakage_distance_(breakage_distance), max_route_distance_factor_(max_route_distance_factor),
       max_route_time_factor_(max_route_time_factor),
-      turn_penalty_factor_(turn_penalty_factor), turn_cost_table_{0.f} {
+      turn_penalty_factor_(turn_penalty_factor), turn_cost_table_{0.f},
+      interrupt_(nullptr) {
   if (beta_ <= 0.f) {
     throw std::invalid_argument("Expect beta to be positive");
   }
@@ -74,11 +68,9 @@ float TransitionCostModel::operator()(const StateId& lhs, const StateId& rhs) co
   const auto label = left.last_label(right);
   if (label) {
     // Get some basic info about difference between the two measurements
-    const auto& left_measurement = container_.measurement(lhs.time());
-    const auto& right_measurement = container_.measurement(rhs.time());
     return CalculateTransitionCost(label->turn_cost(), label->cost().cost,
-                                   GreatCircleDistance(left_measurement, right_measurement),
-                                   label->cost().secs, ClockDistance(lhs.time(), rhs.time()));
+                                   GreatCircleDistance(lhs.time(), rhs.time()), label->cost().secs,
+                                   ClockDistance(lhs.time(), rhs.time()));
   }
 
   // No path found
@@ -123,13 +115,12 @@ void TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) co
     //}
   }
 
-  const auto& left_measurement = container_.measurement(lhs.time());
   const auto& right_measurement = container_.measurement(rhs.time());
 
   const midgard::DistanceApproximator approximator(right_measurement.lnglat());
 
   auto max_route_distance =
-      std::min(GreatCircleDistance(left_measurement, right_measurement) * max_route_distance_factor_,
+      std::min(GreatCircleDistance(lhs.time(), rhs.time()) * max_route_distance_factor_,
                breakage_distance_);
   // Route, we have to make sure that the max distance is greater
   // than 0 otherwise we wont be able to get any labels into the
@@ -141,14 +132,34 @@ void TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) co
     max_route_time = std::ceil(max_route_time);
   }
 
-  labelset_ptr_t labelset = std::make_shared<LabelSet>(max_route_distance);
+  // The states only keep the labels of their searches, the queue and status maps are handed
+  // from one search to the next so they are not allocated again for every state
+  labelset_ptr_t labelset =
+      std::make_shared<LabelSet>(max_route_distance, 1.0f, std::move(workspace_));
   const auto& results = find_shortest_path(graphreader_, locations, 0, labelset, approximator,
                                            right_measurement.search_radius(),
                                            mode_costing_[static_cast<size_t>(travelmode_)], edgelabel,
-                                           turn_cost_table_, max_route_distance, max_route_time);
+                                           turn_cost_table_, max_route_distance, max_route_time,
+                                           interrupt_);
+  queue_stats_ += labelset->queue_stats();
+  workspace_ = labelset->release();
 
   left.SetRoute(unreached_stateids, results, labelset);
 }
 
+float TransitionCostModel::GreatCircleDistance(const StateId::Time& lhs,
+                                              const StateId::Time& rhs) const {
+  // Every pair of candidates of the two measurements asks for the same distance, so it is only
+  // computed again once the measurements change
+  const auto& left = container_.measurement(lhs).lnglat();
+  const auto& right = container_.measurement(rhs).lnglat();
+  if (!(left == distance_left_ && right == distance_right_)) {
+    distance_left_ = left;
+    distance_right_ = right;
+    distance_ = left.Distance(right);
+  }
+  return distance_;
+}
+
 } // namespace meili
 } // namespace valhalla
@@ -1,7 +1,7 @@
 #include "baldr/rapidjson_utils.h"
 #include <boost/property_tree/ptree.hpp>
 
-#include "meili/map_matcher_factory.h"
+#include "meili/batch_matcher.h"
 #include "meili/measurement.h"
 
 using namespace valhalla::midgard;
@@ -37,54 +37,57 @@ ReadMeasurements(istream_t& istream, float default_gps_accuracy, float default_s
 
 int main(int argc, char* argv[]) {
   if (argc < 2) {
-    std::cout << "usage: map_matching CONFIG" << std::endl;
+    std::cout << "usage: map_matching CONFIG [THREADS]" << std::endl;
+    std::cout << "  THREADS traces are matched at once, 0 uses all cores. They share the tiles when"
+              << std::endl;
+    std::cout << "  mjolnir.global_synchronized_cache is set, otherwise each loads its own"
+              << std::endl;
     return 1;
   }
 
   boost::property_tree::ptree config;
   rapidjson::read_json(argv[1], config);
   const std::string modename = config.get<std::string>("meili.mode");
+  valhalla::Options options;
   valhalla::Costing costing;
   if (!valhalla::Costing_Enum_Parse(modename, &costing)) {
     throw std::runtime_error("No costing method found");
   }
-
-  MapMatcherFactory matcher_factory(config);
-  auto mapmatcher = matcher_factory.Create(costing);
-
-  const float default_gps_accuracy = mapmatcher->config().get<float>("gps_accuracy"),
-              default_search_radius = mapmatcher->config().get<float>("search_radius");
-
-  size_t index = 0;
-  for (auto measurements = ReadMeasurements(std::cin, default_gps_accuracy, default_search_radius);
-       !measurements.empty();
-       measurements = ReadMeasurements(std::cin, default_gps_accuracy, default_search_radius)) {
-
-    // Offline match
-    std::cout << "Sequence " << index++ << std::endl;
-    auto results = mapmatcher->OfflineMatch(measurements).front().results;
-
-    // Show results
-    size_t mmt_id = 0, count = 0;
-    for (const auto& result : results) {
-      if (result.HasState()) {
-        std::cout << mmt_id << " ";
-        std::cout << result.distance_from << std::endl;
-        count++;
-      }
-      mmt_id++;
-    }
-
-    // Summary
-    std::cout << count << "/" << measurements.size() << std::endl << std::endl;
-
-    // Clean up
-    measurements.clear();
-    matcher_factory.ClearFullCache();
-  }
-
-  delete mapmatcher;
-  matcher_factory.ClearCache();
+  options.set_costing(costing);
+  const unsigned int threads = argc > 2 ? std::stoul(argv[2]) : 1;
+
+  std::shared_ptr<valhalla::baldr::GraphReader> reader(
+      new valhalla::baldr::GraphReader(config.get_child("mjolnir")));
+  BatchMatcher batch_matcher(config, reader, threads);
+
+  const float default_gps_accuracy = config.get<float>("meili.default.gps_accuracy"),
+              default_search_radius = config.get<float>("meili.default.search_radius");
+
+  // Read the sequences from the input and print their results in the same order
+  batch_matcher.Match(
+      options,
+      [&](std::vector<Measurement>& measurements) {
+        measurements = ReadMeasurements(std::cin, default_gps_accuracy, default_search_radius);
+        return !measurements.empty();
+      },
+      [](size_t index, std::vector<Measurement>&& measurements,
+         std::vector<MatchResults>&& best_paths) {
+        std::cout << "Sequence " << index << std::endl;
+
+        // Show results
+        size_t mmt_id = 0, count = 0;
+        for (const auto& result : best_paths.front().results) {
+          if (result.HasState()) {
+            std::cout << mmt_id << " ";
+            std::cout << result.distance_from << std::endl;
+            count++;
+          }
+          mmt_id++;
+        }
+
+        // Summary
+        std::cout << count << "/" << measurements.size() << std::endl << std::endl;
+      });
 
   return 0;
 }
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <string>
+#include <unordered_set>
 
 namespace valhalla {
 namespace meili {
@@ -55,9 +56,9 @@ StateIdIterator::StateIdIterator(IViterbiSearch& vs) : StateIdIterator(vs, kInva
 void StateIdIterator::Next() {
   ValidateStateId(time_, stateid_);
 
-  // We're done searching between states if time == 0 meaning we found the last one or
-  // we are at a state without a path to it but aren't allowing breaks in the path
-  if (time_ == 0 ||
+  // We're done searching between states if time is the first one meaning we found the last one
+  // or we are at a state without a path to it but aren't allowing breaks in the path
+  if (time_ <= vs_.first_time() ||
       (stateid_.IsValid() && !(stateid_ = vs_.Predecessor(stateid_)).IsValid() && !allow_breaks_)) {
     time_ = kInvalidTime;
     stateid_ = StateId();
@@ -121,6 +122,7 @@ IViterbiSearch::~IViterbiSearch() {
 
 void IViterbiSearch::Clear() {
   added_states_.clear();
+  first_time_ = 0;
 }
 
 bool IViterbiSearch::AddStateId(const StateId& stateid) {
@@ -363,19 +365,25 @@ ViterbiSearch::~ViterbiSearch() {
 }
 
 bool ViterbiSearch::AddStateId(const StateId& stateid) {
+  if (stateid.time() < first_time_) {
+    throw std::invalid_argument("the states before time " + std::to_string(first_time_) +
+                                " are forgotten");
+  }
+
   if (!IViterbiSearch::AddStateId(stateid)) {
     return false;
   }
 
-  if (states_by_time.size() <= stateid.time()) {
-    states_by_time.resize(stateid.time() + 1);
+  const auto offset = stateid.time() - first_time_;
+  if (states_by_time.size() <= offset) {
+    states_by_time.resize(offset + 1);
   }
-  states_by_time[stateid.time()].push_back(stateid);
+  states_by_time[offset].push_back(stateid);
 
-  if (unreached_states_by_time.size() <= stateid.time()) {
-    unreached_states_by_time.resize(stateid.time() + 1);
+  if (unreached_states_by_time.size() <= offset) {
+    unreached_states_by_time.resize(offset + 1);
   }
-  unreached_states_by_time[stateid.time()].push_back(stateid);
+  unreached_states_by_time[offset].push_back(stateid);
 
   return true;
 }
@@ -386,7 +394,7 @@ bool ViterbiSearch::RemoveStateId(const StateId& stateid) {
     return false;
   }
   // remove it from columns
-  auto& column = states_by_time[stateid.time()];
+  auto& column = states_by_time[stateid.time() - first_time_];
   const auto it = std::find(column.begin(), column.end(), stateid);
   if (it == column.end()) {
     throw std::logic_error("the state must exist in the column");
@@ -396,16 +404,21 @@ bool ViterbiSearch::RemoveStateId(const StateId& stateid) {
 }
 
 StateId ViterbiSearch::SearchWinner(StateId::Time time) {
+  // Nothing is known about forgotten times
+  if (time < first_time_) {
+    return {};
+  }
+
   // Use the cache
-  if (time < winner_by_time.size()) {
-    return winner_by_time[time];
+  if (time - first_time_ < winner_by_time.size()) {
+    return winner_by_time[time - first_time_];
   }
 
   if (unreached_states_by_time.empty()) {
     return {};
   }
 
-  const StateId::Time max_allowed_time = unreached_states_by_time.size() - 1;
+  const StateId::Time max_allowed_time = first_time_ + unreached_states_by_time.size() - 1;
   const auto target = std::min(time, max_allowed_time);
 
   // Continue last search if possible
@@ -416,11 +429,11 @@ StateId ViterbiSearch::SearchWinner(StateId::Time time) {
     // last search, so we request a new start
     searched_time = IterativeSearch(target, true);
     // Guarantee that that winner_by_time.size() is increasing and searched_time ==
-    // winner_by_time.size() - 1
+    // first_time_ + winner_by_time.size() - 1
   }
 
-  if (time < winner_by_time.size()) {
-    return winner_by_time[time];
+  if (time - first_time_ < winner_by_time.size()) {
+    return winner_by_time[time - first_time_];
   }
 
   return {};
@@ -430,9 +443,10 @@ StateId ViterbiSearch::Predecessor(const StateId& stateid) const {
   const auto it = scanned_labels_.find(stateid);
   if (it == scanned_labels_.end()) {
     return {};
-  } else {
-    return (it->second).predecessor();
   }
+  // Paths end at the first time that is not forgotten
+  const auto predecessor = (it->second).predecessor();
+  return predecessor.IsValid() && predecessor.time() < first_time_ ? StateId() : predecessor;
 }
 
 double ViterbiSearch::AccumulatedCost(const StateId& stateid) const {
@@ -451,7 +465,7 @@ void ViterbiSearch::Clear() {
 }
 
 void ViterbiSearch::ClearSearch() {
-  earliest_time_ = 0;
+  earliest_time_ = first_time_;
   queue_.clear();
   scanned_labels_.clear();
   winner_by_time.clear();
@@ -470,7 +484,7 @@ void ViterbiSearch::InitQueue(const std::vector<StateId>& column) {
 }
 
 void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid) {
-  if (!(stateid.time() + 1 < unreached_states_by_time.size())) {
+  if (!(stateid.time() + 1 < first_time_ + unreached_states_by_time.size())) {
     throw std::logic_error("the state at time " + std::to_string(stateid.time()) +
                            " is impossible to have successors");
   }
@@ -488,7 +502,7 @@ void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid) {
 
   // Optimal states have been removed from unreached_states_by_time so no
   // worry about optimality
-  for (const auto& next_stateid : unreached_states_by_time[stateid.time() + 1]) {
+  for (const auto& next_stateid : unreached_states_by_time[stateid.time() + 1 - first_time_]) {
     const auto emission_cost = EmissionCost(next_stateid);
     if (IsInvalidCost(emission_cost)) {
       continue;
@@ -509,31 +523,33 @@ void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid) {
 }
 
 StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_new_start) {
-  if (unreached_states_by_time.size() <= target) {
+  // The times are searched in order so the ones up to the end of the winners are done
+  const StateId::Time searched_end = first_time_ + winner_by_time.size();
+  if (first_time_ + unreached_states_by_time.size() <= target) {
     if (unreached_states_by_time.empty()) {
       throw std::runtime_error("empty states: add some states at least before searching");
     } else {
       throw std::runtime_error("the target time is beyond the maximum allowed time " +
-                               std::to_string(unreached_states_by_time.size() - 1));
+                               std::to_string(first_time_ + unreached_states_by_time.size() - 1));
     }
   }
 
   // Do nothing since the winner at the target time is already known
-  if (target < winner_by_time.size()) {
+  if (target < searched_end) {
     return target;
   }
 
-  // Clearly here we have precondition: winner_by_time.size() <= target <
-  // unreached_states_by_time.size()
+  // Clearly here we have precondition: searched_end <= target <
+  // first_time_ + unreached_states_by_time.size()
 
   StateId::Time source;
   // Either continue last search, or start a new search
   if (!request_new_start && !winner_by_time.empty() && winner_by_time.back().IsValid()) {
-    source = winner_by_time.size() - 1;
-    AddSuccessorsToQueue(winner_by_time[source]);
+    source = searched_end - 1;
+    AddSuccessorsToQueue(winner_by_time.back());
   } else {
-    source = winner_by_time.size();
-    InitQueue(unreached_states_by_time[source]);
+    source = searched_end;
+    InitQueue(unreached_states_by_time[source - first_time_]);
   }
 
   // Start with the source time, which will be searched anyhow
@@ -561,7 +577,7 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
     }
 
     // Remove it from its column
-    auto& column = unreached_states_by_time[stateid.time()];
+    auto& column = unreached_states_by_time[stateid.time() - first_time_];
     const auto it = std::find(column.begin(), column.end(), stateid);
     if (it == column.end()) {
       throw std::logic_error("the state must exist in the column");
@@ -577,8 +593,8 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
 
     // If it's the first state that arrives at this column, mark it as
     // the winner at this time
-    if (winner_by_time.size() <= stateid.time()) {
-      if (!(stateid.time() == winner_by_time.size())) {
+    if (first_time_ + winner_by_time.size() <= stateid.time()) {
+      if (!(stateid.time() == first_time_ + winner_by_time.size())) {
         // Should check if states at unreached_states_by_time[time] are all
         // at the same TIME
         throw std::logic_error("found a state from the future time " +
@@ -601,11 +617,12 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
 
   // Guarantee that either winner (if found) or invalid stateid (not
   // found) is saved at searched_time
-  if (winner_by_time.size() <= searched_time) {
-    winner_by_time.resize(searched_time + 1);
+  if (first_time_ + winner_by_time.size() <= searched_time) {
+    winner_by_time.resize(searched_time + 1 - first_time_);
   }
 
-  // Postcondition: searched_time == winner_by_time.size() - 1 && search_time <= target
+  // Postcondition: searched_time == first_time_ + winner_by_time.size() - 1 &&
+  // search_time <= target
   // If search_time < target it implies that there is a breakage,
   // i.e. unable to find any connection from the column at search_time
   // to the column at search_time + 1
@@ -613,6 +630,72 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
   return searched_time;
 }
 
+StateId::Time ViterbiSearch::ConvergedTime() {
+  if (winner_by_time.empty()) {
+    return kInvalidTime;
+  }
+
+  // The paths the search can still extend end at the last winner, whose successors are added
+  // when the search continues, and at the predecessors of the labels in the queue. A label
+  // without one starts a new path after a breakage, which continues the path to the winner
+  // before it
+  std::vector<std::pair<StateId::Time, StateId>> ends;
+  std::unordered_set<StateId> seen;
+  ends.emplace_back(first_time_ + winner_by_time.size() - 1, winner_by_time.back());
+  seen.insert(winner_by_time.back());
+  for (const auto& label : queue_) {
+    const auto time = label.stateid().time();
+    if (time < earliest_time_) {
+      continue;
+    }
+    const auto predecessor = label.predecessor();
+    if (predecessor.IsValid() && first_time_ <= predecessor.time()) {
+      if (seen.insert(predecessor).second) {
+        ends.emplace_back(predecessor.time(), predecessor);
+      }
+    } else if (!predecessor.IsValid() && first_time_ < time) {
+      const auto& winner = winner_by_time[time - 1 - first_time_];
+      if (!winner.IsValid() || seen.insert(winner).second) {
+        ends.emplace_back(time - 1, winner);
+      }
+    }
+  }
+
+  // Walk back the path to the last winner and then the others until they join it
+  std::vector<StateId> reference(ends.front().first - first_time_ + 1);
+  for (StateIdIterator it(*this, ends.front().first, ends.front().second); it != PathEnd(); ++it) {
+    reference[it.time() - first_time_] = *it;
+  }
+  StateId::Time converged = ends.front().first;
+  for (auto end = std::next(ends.cbegin()); end != ends.cend(); ++end) {
+    StateIdIterator it(*this, end->first, end->second);
+    while (it != PathEnd() && reference[it.time() - first_time_] != *it) {
+      ++it;
+    }
+    if (it == PathEnd()) {
+      return kInvalidTime;
+    }
+    converged = std::min(converged, it.time());
+  }
+
+  return converged;
+}
+
+void ViterbiSearch::Forget(StateId::Time time) {
+  while (first_time_ < time && !winner_by_time.empty()) {
+    for (const auto& stateid : states_by_time.front()) {
+      IViterbiSearch::RemoveStateId(stateid);
+      scanned_labels_.erase(stateid);
+    }
+    states_by_time.pop_front();
+    unreached_states_by_time.pop_front();
+    winner_by_time.pop_front();
+    ++first_time_;
+  }
+  // The labels left in the queue before it can't be on a path anymore
+  earliest_time_ = std::max(earliest_time_, first_time_);
+}
+
 constexpr bool ViterbiSearch::IsInvalidCost(double cost) {
   return cost < 0.f;
 }
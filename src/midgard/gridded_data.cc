@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <unordered_map>
 
 namespace valhalla {
 namespace midgard {
@@ -24,18 +25,115 @@ GriddedData<coord_t>::GriddedData(const AABB2<coord_t>& bounds,
   std::fill(data_.begin(), data_.end(), value);
 }
 
+// Draw a batch of segments. Most segments are within a cell or cross into a neighbor, only the
+// longer ones need to be rasterized. The cells of a band of rows are contiguous so each band only
+// touches its own range of the data.
+template <class coord_t>
+void GriddedData<coord_t>::SetIfLessThan(const std::vector<segment_t>& segments,
+                                         const parallel_for_t& parallel_for) {
+  const int32_t ncolumns = this->ncolumns_, nrows = this->nrows_;
+  auto row = [this, nrows](const coord_t& pt) {
+    auto r = static_cast<int32_t>((pt.second - this->tilebounds_.miny()) / this->tilesize_);
+    return std::max(0, std::min(nrows - 1, r));
+  };
+  auto draw = [this, ncolumns](const segment_t& segment, const int32_t first_row,
+                               const int32_t last_row) {
+    const int32_t first = first_row * ncolumns, last = last_row * ncolumns;
+    auto mark = [&](const int32_t cell) {
+      if (cell >= first && cell < last && segment.value < data_[cell]) {
+        data_[cell] = segment.value;
+      }
+    };
+    auto cell1 = this->TileId(segment.a);
+    auto cell2 = this->TileId(segment.b);
+    if (cell1 == cell2) {
+      mark(cell1);
+    } else if (this->AreNeighbors(cell1, cell2)) {
+      mark(cell1);
+      mark(cell2);
+    } else {
+      for (const auto& cell : this->IntersectBins(std::vector<coord_t>{segment.a, segment.b})) {
+        mark(cell.first);
+      }
+    }
+  };
+
+  // A band needs enough segments and rows to be worth handing to another thread
+  constexpr size_t kSegmentsPerBand = 8192;
+  constexpr int32_t kRowsPerBand = 8;
+  uint32_t bands = std::min<size_t>(segments.size() / kSegmentsPerBand, nrows / kRowsPerBand);
+  if (!parallel_for || bands < 2) {
+    for (const auto& segment : segments) {
+      draw(segment, 0, nrows);
+    }
+    return;
+  }
+
+  // Every band looks at all the segments but only draws those whose rows it overlaps, a row of
+  // slack covers rasterizing that strays off the straight line
+  parallel_for(bands, [&](const uint32_t band) {
+    const int32_t first_row = band * nrows / bands, last_row = (band + 1) * nrows / bands;
+    for (const auto& segment : segments) {
+      auto row1 = row(segment.a), row2 = row(segment.b);
+      if (std::max(row1, row2) + 1 >= first_row && std::min(row1, row2) - 1 < last_row) {
+        draw(segment, first_row, last_row);
+      }
+    }
+  });
+}
+
 // Generate contour lines from the isotile data.
-// contours is an ordered list of contour interval values
-// Derivation from the C code version of CONREC by Paul Bourke:
-// http://paulbourke.net/papers/conrec/
+// contours is an ordered list of contour interval values. The intervals do not
+// share anything so each one is traced, cleaned up and generalized on its own,
+// concurrently if a parallel_for is given.
 template <class coord_t>
 typename GriddedData<coord_t>::contours_t
 GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_intervals,
                                        const bool rings_only,
                                        const float denoise,
-                                       const float generalize) const {
+                                       const float generalize,
+                                       const parallel_for_t& parallel_for) const {
   // TODO: sort and validate contour range
 
+  // If the generalization value equals kOptimalGeneralization then set
+  // the generalization factor to 1/4 of the grid size
+  float gen_factor = generalize;
+  if (generalize == kOptimalGeneralization) {
+    gen_factor = this->tilesize_ * 0.25f * kMetersPerDegreeLat;
+  }
+
+  // we need something to hold each iso-line, bigger ones first
+  std::vector<std::list<feature_t>> features(contour_intervals.size());
+  auto work = [&](const uint32_t i) {
+    features[i] = GenerateContour(contour_intervals[i], rings_only, denoise, gen_factor);
+  };
+  if (parallel_for && contour_intervals.size() > 1) {
+    parallel_for(contour_intervals.size(), work);
+  } else {
+    for (uint32_t i = 0; i < contour_intervals.size(); ++i) {
+      work(i);
+    }
+  }
+
+  contours_t contours([](float a, float b) { return a > b; });
+  for (size_t i = 0; i < contour_intervals.size(); ++i) {
+    auto& collection = contours[contour_intervals[i]];
+    if (collection.empty()) {
+      collection = std::move(features[i]);
+    }
+  }
+  return contours;
+}
+
+// Trace the contour lines of one interval.
+// Derivation from the C code version of CONREC by Paul Bourke:
+// http://paulbourke.net/papers/conrec/
+template <class coord_t>
+std::list<typename GriddedData<coord_t>::feature_t>
+GriddedData<coord_t>::GenerateContour(const float contour,
+                                      const bool rings_only,
+                                      const float denoise,
+                                      const float gen_factor) const {
   // Values at tile corners and center (0 element is center)
   int sh[5];
   typename coord_t::first_type s[5]; // Values at the tile corners and center
@@ -48,15 +146,12 @@ GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_interva
                    (s[p2] * tile_corners[p1].y() - s[p1] * tile_corners[p2].y()) / ds);
   };
 
-  // we need something to hold each iso-line, bigger ones first
-  contours_t contours([](float a, float b) { return a > b; });
-  for (auto v : contour_intervals) {
-    contours[v].emplace_back();
-  }
-  // and something to find them quickly
+  // we need something to hold the iso-lines, all in one feature until the end
+  std::list<feature_t> features(1);
+  feature_t& feature = features.front();
+  // and something to find their ends quickly
   using contour_lookup_t = std::unordered_map<coord_t, typename feature_t::iterator>;
-  std::unordered_map<float, contour_lookup_t> lookup(contour_intervals.size());
-  // TODO: preallocate the lookups for each interval
+  contour_lookup_t lookup;
 
   int tile_inc[4] = {0, 1, this->ncolumns_ + 1, this->ncolumns_};
   int case_value;
@@ -75,251 +170,234 @@ GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_interva
       auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
       auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
 
-      // Continue if outside the range of contour values
-      if (dmax < contour_intervals.front() || dmin > contour_intervals.back()) {
+      // Continue if the contour does not cross this cell
+      if (contour < dmin || contour > dmax) {
         continue;
       }
 
-      for (auto contour : contour_intervals) {
-        if (contour < dmin || contour > dmax) {
+      for (int m = 4; m >= 0; m--) {
+        if (m > 0) {
+          int newtileid = tileid + tile_inc[m - 1];
+          // Make sure the tile corner value is not set to the max_value
+          // (messes up the intersect method). Set a value slightly above
+          // the contour (e.g. 1 minute higher).
+          // TODO - the value 1 is a bit of a hack.
+          s[m] = (data_[newtileid] < max_value_) ? data_[newtileid] - contour : 1.0f;
+          tile_corners[m] = this->Base(newtileid);
+        } else {
+          s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
+          tile_corners[0] = this->Center(tileid);
+        }
+        if (s[m] > 0.0f) {
+          sh[m] = 1;
+        } else if (s[m] < 0.0f) {
+          sh[m] = -1;
+        } else {
+          sh[m] = 0;
+        }
+      }
+
+      /*
+       Note: at this stage the relative heights of the corners and the
+       centre are in the h array, and the corresponding coordinates are
+       in the xh and yh arrays. The centre of the box is indexed by 0
+       and the 4 corners by 1 to 4 as shown below.
+       Each triangle is then indexed by the parameter m, and the 3
+       vertices of each triangle are indexed by parameters m1,m2,and m3.
+       It is assumed that the centre of the box is always vertex 2
+       though this is important only when all 3 vertices lie exactly on
+       the same contour level, in which case only the side of the box
+       is drawn.
+          vertex 4 +-------------------+ vertex 3
+                   | \               / |
+                   |   \    m-3    /   |
+                   |     \       /     |
+                   |       \   /       |
+                   |  m=2    X   m=2   |       the centre is vertex 0
+                   |       /   \       |
+                   |     /       \     |
+                   |   /    m=1    \   |
+                   | /               \ |
+          vertex 1 +-------------------+ vertex 2
+      */
+
+      // Scan each triangle in the box
+      coord_t pt1, pt2;
+      for (int m = 1; m <= 4; m++) {
+        int m1 = m;
+        int m2 = 0;
+        int m3 = (m != 4) ? m + 1 : 1;
+        if ((case_value = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1]) == 0) {
           continue;
         }
-        for (int m = 4; m >= 0; m--) {
-          if (m > 0) {
-            int newtileid = tileid + tile_inc[m - 1];
-            // Make sure the tile corner value is not set to the max_value
-            // (messes up the intersect method). Set a value slightly above
-            // the contour (e.g. 1 minute higher).
-            // TODO - the value 1 is a bit of a hack.
-            s[m] = (data_[newtileid] < max_value_) ? data_[newtileid] - contour : 1.0f;
-            tile_corners[m] = this->Base(newtileid);
-          } else {
-            s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
-            tile_corners[0] = this->Center(tileid);
-          }
-          if (s[m] > 0.0f) {
-            sh[m] = 1;
-          } else if (s[m] < 0.0f) {
-            sh[m] = -1;
-          } else {
-            sh[m] = 0;
-          }
+
+        switch (case_value) {
+          case 1: // Line between vertices 1 and 2
+            pt1 = tile_corners[m1];
+            pt2 = tile_corners[m2];
+            break;
+          case 2: // Line between vertices 2 and 3
+            pt1 = tile_corners[m2];
+            pt2 = tile_corners[m3];
+            break;
+          case 3: // Line between vertices 3 and 1
+            pt1 = tile_corners[m3];
+            pt2 = tile_corners[m1];
+            break;
+          case 4: // Line between vertex 1 and side 2-3
+            pt1 = tile_corners[m1];
+            pt2 = intersect(m2, m3);
+            break;
+          case 5: // Line between vertex 2 and side 3-1
+            pt1 = tile_corners[m2];
+            pt2 = intersect(m3, m1);
+            break;
+          case 6: // Line between vertex 3 and side 1-2
+            pt1 = tile_corners[m3];
+            pt2 = intersect(m1, m2);
+            break;
+          case 7: // Line between sides 1-2 and 2-3
+            pt1 = intersect(m1, m2);
+            pt2 = intersect(m2, m3);
+            break;
+          case 8: // Line between sides 2-3 and 3-1
+            pt1 = intersect(m2, m3);
+            pt2 = intersect(m3, m1);
+            break;
+          case 9: // Line between sides 3-1 and 1-2
+            pt1 = intersect(m3, m1);
+            pt2 = intersect(m1, m2);
+            break;
+          default:
+            break;
         }
 
-        /*
-         Note: at this stage the relative heights of the corners and the
-         centre are in the h array, and the corresponding coordinates are
-         in the xh and yh arrays. The centre of the box is indexed by 0
-         and the 4 corners by 1 to 4 as shown below.
-         Each triangle is then indexed by the parameter m, and the 3
-         vertices of each triangle are indexed by parameters m1,m2,and m3.
-         It is assumed that the centre of the box is always vertex 2
-         though this is important only when all 3 vertices lie exactly on
-         the same contour level, in which case only the side of the box
-         is drawn.
-            vertex 4 +-------------------+ vertex 3
-                     | \               / |
-                     |   \    m-3    /   |
-                     |     \       /     |
-                     |       \   /       |
-                     |  m=2    X   m=2   |       the centre is vertex 0
-                     |       /   \       |
-                     |     /       \     |
-                     |   /    m=1    \   |
-                     | /               \ |
-            vertex 1 +-------------------+ vertex 2
-        */
-
-        // Scan each triangle in the box
-        coord_t pt1, pt2;
-        for (int m = 1; m <= 4; m++) {
-          int m1 = m;
-          int m2 = 0;
-          int m3 = (m != 4) ? m + 1 : 1;
-          if ((case_value = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1]) == 0) {
-            continue;
-          }
+        // this isnt a segment..
+        if (pt1 == pt2) {
+          continue;
+        }
 
-          switch (case_value) {
-            case 1: // Line between vertices 1 and 2
-              pt1 = tile_corners[m1];
-              pt2 = tile_corners[m2];
-              break;
-            case 2: // Line between vertices 2 and 3
-              pt1 = tile_corners[m2];
-              pt2 = tile_corners[m3];
-              break;
-            case 3: // Line between vertices 3 and 1
-              pt1 = tile_corners[m3];
-              pt2 = tile_corners[m1];
-              break;
-            case 4: // Line between vertex 1 and side 2-3
-              pt1 = tile_corners[m1];
-              pt2 = intersect(m2, m3);
-              break;
-            case 5: // Line between vertex 2 and side 3-1
-              pt1 = tile_corners[m2];
-              pt2 = intersect(m3, m1);
-              break;
-            case 6: // Line between vertex 3 and side 1-2
-              pt1 = tile_corners[m3];
-              pt2 = intersect(m1, m2);
-              break;
-            case 7: // Line between sides 1-2 and 2-3
-              pt1 = intersect(m1, m2);
-              pt2 = intersect(m2, m3);
-              break;
-            case 8: // Line between sides 2-3 and 3-1
-              pt1 = intersect(m2, m3);
-              pt2 = intersect(m3, m1);
-              break;
-            case 9: // Line between sides 3-1 and 1-2
-              pt1 = intersect(m3, m1);
-              pt2 = intersect(m1, m2);
-              break;
-            default:
-              break;
-          }
+        // see if we have anything to connect this segment to
+        typename contour_lookup_t::iterator rec_a = lookup.find(pt1);
+        typename contour_lookup_t::iterator rec_b = lookup.find(pt2);
+        if (rec_b != lookup.end()) {
+          std::swap(pt1, pt2);
+          std::swap(rec_a, rec_b);
+        }
+
+        // we want to merge two records
+        if (rec_b != lookup.end()) {
+          // get the segments in question and remove their lookup info
+          auto segment_a = rec_a->second;
+          bool head_a = rec_a->first == segment_a->front();
+          auto segment_b = rec_b->second;
+          bool head_b = rec_b->first == segment_b->front();
+          lookup.erase(rec_a);
+          lookup.erase(rec_b);
 
-          // this isnt a segment..
-          if (pt1 == pt2) {
+          // this segment is now a ring
+          if (segment_a == segment_b) {
+            segment_a->push_back(segment_a->front());
             continue;
           }
 
-          // see if we have anything to connect this segment to
-          typename contour_lookup_t::iterator rec_a = lookup[contour].find(pt1);
-          typename contour_lookup_t::iterator rec_b = lookup[contour].find(pt2);
-          if (rec_b != lookup[contour].end()) {
-            std::swap(pt1, pt2);
-            std::swap(rec_a, rec_b);
+          // erase the other lookups
+          lookup.erase(lookup.find(
+              pt1 == segment_a->front() ? segment_a->back() : segment_a->front()));
+          lookup.erase(lookup.find(
+              pt2 == segment_b->front() ? segment_b->back() : segment_b->front()));
+
+          // add b to a
+          if (!head_a && head_b) {
+            segment_a->splice(segment_a->end(), *segment_b);
+            feature.erase(segment_b);
+          } // add a to b
+          else if (!head_b && head_a) {
+            segment_b->splice(segment_b->end(), *segment_a);
+            feature.erase(segment_a);
+            segment_a = segment_b;
+          } // flip a and add b
+          else if (head_a && head_b) {
+            segment_a->reverse();
+            segment_a->splice(segment_a->end(), *segment_b);
+            feature.erase(segment_b);
+          } // flip b and add to a
+          else if (!head_a && !head_b) {
+            segment_b->reverse();
+            segment_a->splice(segment_a->end(), *segment_b);
+            feature.erase(segment_b);
           }
 
-          // we want to merge two records
-          if (rec_b != lookup[contour].end()) {
-            // get the segments in question and remove their lookup info
-            auto segment_a = rec_a->second;
-            bool head_a = rec_a->first == segment_a->front();
-            auto segment_b = rec_b->second;
-            bool head_b = rec_b->first == segment_b->front();
-            lookup[contour].erase(rec_a);
-            lookup[contour].erase(rec_b);
-
-            // this segment is now a ring
-            if (segment_a == segment_b) {
-              segment_a->push_back(segment_a->front());
-              continue;
-            }
-
-            // erase the other lookups
-            lookup[contour].erase(lookup[contour].find(
-                pt1 == segment_a->front() ? segment_a->back() : segment_a->front()));
-            lookup[contour].erase(lookup[contour].find(
-                pt2 == segment_b->front() ? segment_b->back() : segment_b->front()));
-
-            // add b to a
-            if (!head_a && head_b) {
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
-            } // add a to b
-            else if (!head_b && head_a) {
-              segment_b->splice(segment_b->end(), *segment_a);
-              contours[contour].front().erase(segment_a);
-              segment_a = segment_b;
-            } // flip a and add b
-            else if (head_a && head_b) {
-              segment_a->reverse();
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
-            } // flip b and add to a
-            else if (!head_a && !head_b) {
-              segment_b->reverse();
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
-            }
-
-            // update the look up
-            lookup[contour].emplace(segment_a->front(), segment_a);
-            lookup[contour].emplace(segment_a->back(), segment_a);
-          } // ap/prepend to an existing one
-          else if (rec_a != lookup[contour].end()) {
-            // it goes on the front
-            if (rec_a->second->front() == pt1) {
-              rec_a->second->push_front(pt2);
-              // it goes on the back
-            } else {
-              rec_a->second->push_back(pt2);
-            }
-
-            // update the lookup table
-            lookup[contour].emplace(pt2, rec_a->second);
-            lookup[contour].erase(rec_a);
-          } // this is an orphan segment for now
-          else {
-            contours[contour].front().push_front(contour_t{pt1, pt2});
-            lookup[contour].emplace(pt1, contours[contour].front().begin());
-            lookup[contour].emplace(pt2, contours[contour].front().begin());
+          // update the look up
+          lookup.emplace(segment_a->front(), segment_a);
+          lookup.emplace(segment_a->back(), segment_a);
+        } // ap/prepend to an existing one
+        else if (rec_a != lookup.end()) {
+          // it goes on the front
+          if (rec_a->second->front() == pt1) {
+            rec_a->second->push_front(pt2);
+            // it goes on the back
+          } else {
+            rec_a->second->push_back(pt2);
           }
-        }
-      } // Each contour
-    }   // Each tile col
-  }     // Each tile row
 
-  // If the generalization value equals kOptimalGeneralization then set
-  // the generalization factor to 1/4 of the grid size
-  float gen_factor = generalize;
-  if (generalize == kOptimalGeneralization) {
-    gen_factor = this->tilesize_ * 0.25f * kMetersPerDegreeLat;
-  }
+          // update the lookup table
+          lookup.emplace(pt2, rec_a->second);
+          lookup.erase(rec_a);
+        } // this is an orphan segment for now
+        else {
+          feature.push_front(contour_t{pt1, pt2});
+          lookup.emplace(pt1, feature.begin());
+          lookup.emplace(pt2, feature.begin());
+        }
+      }
+    } // Each tile col
+  }   // Each tile row
 
   // some info about the area the image covers
-  auto c = this->TileBounds().Center();
   auto h = this->tilesize_ / 2;
-  // for each contour
-  for (auto& collection : contours) {
-    auto& contour = collection.second.front();
-    // they only wanted rings
-    if (rings_only) {
-      contour.remove_if([](const contour_t& line) { return line.front() != line.back(); });
-    }
-    // sort them by area (maybe length would be sufficient?) biggest first
-    std::unordered_map<const contour_t*, typename coord_t::first_type> cache(contour.size());
-    std::for_each(contour.cbegin(), contour.cend(),
-                  [&cache](const contour_t& c) { cache[&c] = polygon_area(c); });
-    contour.sort([&cache](const contour_t& a, const contour_t& b) {
-      return std::abs(cache[&a]) > std::abs(cache[&b]);
+  // they only wanted rings
+  if (rings_only) {
+    feature.remove_if([](const contour_t& line) { return line.front() != line.back(); });
+  }
+  // sort them by area (maybe length would be sufficient?) biggest first
+  std::unordered_map<const contour_t*, typename coord_t::first_type> cache(feature.size());
+  std::for_each(feature.cbegin(), feature.cend(),
+                [&cache](const contour_t& c) { cache[&c] = polygon_area(c); });
+  feature.sort([&cache](const contour_t& a, const contour_t& b) {
+    return std::abs(cache[&a]) > std::abs(cache[&b]);
+  });
+  // they only want the most significant ones!
+  if (denoise > 0.f) {
+    feature.remove_if([&cache, &feature, denoise](const contour_t& c) {
+      return std::abs(cache[&c] / cache[&feature.front()]) < denoise;
     });
-    // they only want the most significant ones!
-    if (denoise > 0.f) {
-      contour.remove_if([&cache, &contour, denoise](const contour_t& c) {
-        return std::abs(cache[&c] / cache[&contour.front()]) < denoise;
-      });
+  }
+  // clean up the lines
+  for (auto& line : feature) {
+    // TODO: generalizing makes self intersections which makes other libraries unhappy
+    if (gen_factor > 0.f) {
+      Polyline2<coord_t>::Generalize(line, gen_factor, {});
     }
-    // clean up the lines
-    for (auto& line : contour) {
-      // TODO: generalizing makes self intersections which makes other libraries unhappy
-      if (gen_factor > 0.f) {
-        Polyline2<coord_t>::Generalize(line, gen_factor, {});
-      }
-      // if this ends up as an inner we'll undo this later
-      if (cache[&line] > 0) {
-        line.reverse();
-      }
-      // sampling the bottom left corner means everything is skewed, so unskew it
-      for (auto& coord : line) {
-        coord.first += h;
-        coord.second += h;
-      }
+    // if this ends up as an inner we'll undo this later
+    if (cache[&line] > 0) {
+      line.reverse();
     }
-    // if they just wanted linestrings we need only one per feature
-    if (!rings_only) {
-      for (auto& linestring : contour) {
-        collection.second.push_back({std::move(linestring)});
-      }
-      collection.second.pop_front();
+    // sampling the bottom left corner means everything is skewed, so unskew it
+    for (auto& coord : line) {
+      coord.first += h;
+      coord.second += h;
+    }
+  }
+  // if they just wanted linestrings we need only one per feature
+  if (!rings_only) {
+    for (auto& linestring : feature) {
+      features.push_back({std::move(linestring)});
     }
+    features.pop_front();
   }
 
-  return contours;
+  return features;
 }
 
 // Explicit instantiation
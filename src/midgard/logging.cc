@@ -1,6 +1,10 @@
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
@@ -8,6 +12,7 @@
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -44,6 +49,17 @@ std::string TimeStamp() {
   return buffer;
 }
 
+// a whole line of the log as the loggers write it out
+std::string Record(const std::string& message, const std::string& custom_directive) {
+  std::string output;
+  output.reserve(message.length() + 64);
+  output.append(TimeStamp());
+  output.append(custom_directive);
+  output.append(message);
+  output.push_back('\n');
+  return output;
+}
+
 // the Log levels we support
 struct EnumHasher {
   template <typename T> std::size_t operator()(T t) const {
@@ -117,16 +133,30 @@ bool logger_registered = RegisterLogger("", [](const LoggingConfig& config) {
   return l;
 });
 
+// logger that writes out whole records, so another logger can format them and leave writing them
+// to this one
+class RecordLogger : public Logger {
+public:
+  using Logger::Logger;
+  virtual const std::string& Directive(const LogLevel level) const {
+    return uncolored.find(level)->second;
+  }
+  virtual void Write(const std::string& records) = 0;
+};
+
 // logger that writes to standard out
-class StdOutLogger : public Logger {
+class StdOutLogger : public RecordLogger {
 public:
   StdOutLogger() = delete;
   StdOutLogger(const LoggingConfig& config)
-      : Logger(config),
+      : RecordLogger(config),
         levels(config.find("color") != config.end() && config.find("color")->second == "true"
                    ? colored
                    : uncolored) {
   }
+  virtual const std::string& Directive(const LogLevel level) const {
+    return levels.find(level)->second;
+  }
   virtual void Log(const std::string& message, const LogLevel level) {
 #ifdef __ANDROID__
     __android_log_print(android_levels.find(level)->second, "valhalla", "%s", message.c_str());
@@ -138,17 +168,18 @@ public:
 #ifdef __ANDROID__
     __android_log_print(ANDROID_LOG_INFO, "valhalla", "%s", message.c_str());
 #else
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
+    Write(Record(message, custom_directive));
+#endif
+  }
+  virtual void Write(const std::string& records) {
+#ifdef __ANDROID__
+    __android_log_print(ANDROID_LOG_INFO, "valhalla", "%s", records.c_str());
+#else
     // cout is thread safe, to avoid multiple threads interleaving on one line
     // though, we make sure to only call the << operator once on std::cout
     // otherwise the << operators from different threads could interleave
     // obviously we dont care if flushes interleave
-    std::cout << output;
+    std::cout << records;
     std::cout.flush();
 #endif
   }
@@ -167,13 +198,14 @@ class StdErrLogger : public StdOutLogger {
 #ifdef __ANDROID__
     __android_log_print(ANDROID_LOG_ERROR, "valhalla", "%s", message.c_str());
 #else
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
-    std::cerr << output;
+    Write(Record(message, custom_directive));
+#endif
+  }
+  virtual void Write(const std::string& records) {
+#ifdef __ANDROID__
+    __android_log_print(ANDROID_LOG_ERROR, "valhalla", "%s", records.c_str());
+#else
+    std::cerr << records;
     std::cerr.flush();
 #endif
   }
@@ -185,10 +217,10 @@ bool std_err_logger_registered = RegisterLogger("std_err", [](const LoggingConfi
 
 // TODO: add log rolling
 // logger that writes to file
-class FileLogger : public Logger {
+class FileLogger : public RecordLogger {
 public:
   FileLogger() = delete;
-  FileLogger(const LoggingConfig& config) : Logger(config) {
+  FileLogger(const LoggingConfig& config) : RecordLogger(config) {
     // grab the file name
     auto name = config.find("file_name");
     if (name == config.end()) {
@@ -211,17 +243,14 @@ public:
     ReOpen();
   }
   virtual void Log(const std::string& message, const LogLevel level) {
-    Log(message, uncolored.find(level)->second);
+    Log(message, Directive(level));
   }
   virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
+    Write(Record(message, custom_directive));
+  }
+  virtual void Write(const std::string& records) {
     lock.lock();
-    file << output;
+    file << records;
     file.flush();
     lock.unlock();
     ReOpen();
@@ -260,6 +289,158 @@ bool file_logger_registered = RegisterLogger("file", [](const LoggingConfig& con
   return l;
 });
 
+// logger that formats records on the calling thread and hands them to a thread of its own that
+// writes them out with another logger, the sink. records go through a bounded lock free queue and
+// are dropped when it is full rather than making the caller wait, the writer logs how many were
+// dropped once it catches up
+class AsyncLogger : public Logger {
+public:
+  AsyncLogger() = delete;
+  AsyncLogger(const LoggingConfig& config)
+      : Logger(config), tail(0), head(0), dropped(0), done(false),
+        dropped_total(metrics::GetCounter("valhalla_log_records_dropped_total",
+                                          "Log records the async logger had no room for")) {
+    // make the logger that does the writing
+    auto sink_config = config;
+    auto sink = config.find("sink");
+    sink_config["type"] = sink == config.end() ? "std_out" : sink->second;
+    std::unique_ptr<Logger> logger(
+        sink_config["type"] == "async" ? nullptr : GetFactory().Produce(sink_config));
+    writer.reset(dynamic_cast<RecordLogger*>(logger.get()));
+    if (!writer) {
+      throw std::runtime_error("The async logger can't write with a logger of type: " +
+                               sink_config["type"]);
+    }
+    logger.release();
+
+    // how many records can wait, rounded up to a power of two
+    size_t size = 8192;
+    auto queue_size = config.find("queue_size");
+    if (queue_size != config.end()) {
+      try {
+        size = std::stoul(queue_size->second);
+      } catch (...) { size = 0; }
+      if (size == 0) {
+        throw std::runtime_error(queue_size->second + " is not a valid queue size");
+      }
+    }
+    mask = 1;
+    while (mask < size) {
+      mask <<= 1;
+    }
+    slots.reset(new slot_t[mask]);
+    for (size_t i = 0; i < mask; ++i) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    --mask;
+
+    thread = std::thread(&AsyncLogger::Drain, this);
+  }
+  virtual ~AsyncLogger() {
+    done.store(true, std::memory_order_release);
+    wake.notify_one();
+    thread.join();
+  }
+  virtual void Log(const std::string& message, const LogLevel level) {
+    Enqueue(Record(message, writer->Directive(level)));
+  }
+  virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
+    Enqueue(Record(message, custom_directive));
+  }
+
+protected:
+  // a record and the position in the queue it is ready for, see Vyukov's bounded queue
+  struct slot_t {
+    std::atomic<size_t> sequence;
+    std::string record;
+  };
+
+  void Enqueue(std::string record) {
+    auto position = tail.load(std::memory_order_relaxed);
+    while (true) {
+      auto& slot = slots[position & mask];
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      // the slot is free so try to claim it
+      if (difference == 0) {
+        if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          slot.record = std::move(record);
+          slot.sequence.store(position + 1, std::memory_order_release);
+          wake.notify_one();
+          return;
+        }
+      } // the writer has not gotten to the record a lap ago so we are full
+      else if (difference < 0) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        dropped_total.add();
+        return;
+      } // another thread claimed it first
+      else {
+        position = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // only the writer thread takes records off
+  bool Dequeue(std::string& records) {
+    auto& slot = slots[head & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+      return false;
+    }
+    records.append(slot.record);
+    slot.record.clear();
+    slot.sequence.store(head + mask + 1, std::memory_order_release);
+    ++head;
+    return true;
+  }
+
+  void Drain() {
+    std::string records;
+    uint64_t reported = 0;
+    while (true) {
+      // anything logged before we were told to stop still gets written
+      auto stopping = done.load(std::memory_order_acquire);
+      // write whatever has queued up so far all at once
+      while (Dequeue(records) && records.size() < kMaxWrite) {
+      }
+      auto count = dropped.load(std::memory_order_relaxed);
+      if (count != reported) {
+        records.append(Record(std::to_string(count - reported) + " log records were dropped",
+                              writer->Directive(LogLevel::WARN)));
+        reported = count;
+      }
+      if (!records.empty()) {
+        writer->Write(records);
+        records.clear();
+        continue;
+      }
+      if (stopping) {
+        return;
+      }
+      // producers dont take the lock to notify so we may miss one, hence the timeout
+      std::unique_lock<std::mutex> guard(lock);
+      wake.wait_for(guard, std::chrono::milliseconds(10));
+    }
+  }
+
+  static constexpr size_t kMaxWrite = 1 << 16;
+
+  std::unique_ptr<RecordLogger> writer;
+  std::unique_ptr<slot_t[]> slots;
+  size_t mask;
+  std::atomic<size_t> tail;
+  size_t head;
+  std::atomic<uint64_t> dropped;
+  std::atomic<bool> done;
+  metrics::Counter& dropped_total;
+  std::condition_variable wake;
+  std::thread thread;
+};
+bool async_logger_registered = RegisterLogger("async", [](const LoggingConfig& config) {
+  Logger* l = new AsyncLogger(config);
+  return l;
+});
+
 } // namespace logging
 
 // statically get a logger using the factory
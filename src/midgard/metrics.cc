@@ -0,0 +1,171 @@
+#include "midgard/metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+using namespace valhalla::midgard::metrics;
+
+// the metrics of one name, by their rendered labels
+struct family_t {
+  std::string help;
+  bool histogram;
+  std::map<std::string, std::unique_ptr<Counter>> counters;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms;
+};
+
+struct registry_t {
+  std::mutex lock;
+  std::map<std::string, family_t> families;
+};
+
+registry_t& registry() {
+  static registry_t registry;
+  return registry;
+}
+
+// labels as they go between the braces, with the values escaped
+std::string render(const Labels& labels) {
+  std::string rendered;
+  for (const auto& label : labels) {
+    if (!rendered.empty()) {
+      rendered.push_back(',');
+    }
+    rendered += label.first + "=\"";
+    for (const auto c : label.second) {
+      switch (c) {
+        case '\\':
+          rendered += "\\\\";
+          break;
+        case '"':
+          rendered += "\\\"";
+          break;
+        case '\n':
+          rendered += "\\n";
+          break;
+        default:
+          rendered.push_back(c);
+      }
+    }
+    rendered.push_back('"');
+  }
+  return rendered;
+}
+
+std::string number(const double value) {
+  char buffer[32];
+  return std::string(buffer, std::snprintf(buffer, sizeof(buffer), "%.9g", value));
+}
+
+family_t& family(registry_t& r, const std::string& name, const std::string& help, bool histogram) {
+  auto inserted = r.families.emplace(name, family_t{help, histogram, {}, {}});
+  if (inserted.first->second.histogram != histogram) {
+    throw std::logic_error("Metric " + name + " is already registered with another type");
+  }
+  return inserted.first->second;
+}
+
+void series(std::string& out,
+            const std::string& name,
+            const std::string& labels,
+            const std::string& value) {
+  out += name;
+  if (!labels.empty()) {
+    out += '{' + labels + '}';
+  }
+  out += ' ' + value + '\n';
+}
+
+} // namespace
+
+namespace valhalla {
+namespace midgard {
+namespace metrics {
+
+Histogram::Histogram(const std::vector<double>& bounds)
+    : bounds_(bounds), counts_(new std::atomic<uint64_t>[bounds.size() + 1]), sum_(0) {
+  std::sort(bounds_.begin(), bounds_.end());
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::observe(const double value) {
+  auto bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+  counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+  // there is no fetch_add for floating point atomics until c++20
+  auto sum = sum_.load(std::memory_order_relaxed);
+  while (!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t Histogram::count() const {
+  uint64_t total = 0;
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    total += count(i);
+  }
+  return total;
+}
+
+Counter& GetCounter(const std::string& name, const std::string& help, const Labels& labels) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.lock);
+  auto& counter = family(r, name, help, false).counters[render(labels)];
+  if (!counter) {
+    counter.reset(new Counter());
+  }
+  return *counter;
+}
+
+Histogram& GetHistogram(const std::string& name,
+                        const std::string& help,
+                        const std::vector<double>& bounds,
+                        const Labels& labels) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.lock);
+  auto& histogram = family(r, name, help, true).histograms[render(labels)];
+  if (!histogram) {
+    histogram.reset(new Histogram(bounds));
+  }
+  return *histogram;
+}
+
+std::string Expose() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.lock);
+  std::string out;
+  for (const auto& named : r.families) {
+    const auto& name = named.first;
+    const auto& f = named.second;
+    out += "# HELP " + name + ' ' + f.help + '\n';
+    out += "# TYPE " + name + (f.histogram ? " histogram\n" : " counter\n");
+    for (const auto& counter : f.counters) {
+      series(out, name, counter.first, std::to_string(counter.second->value()));
+    }
+    // the buckets are cumulative in the exposition format
+    for (const auto& histogram : f.histograms) {
+      const auto& labels = histogram.first;
+      const auto& h = *histogram.second;
+      const auto prefix = labels.empty() ? std::string() : labels + ',';
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < h.bounds().size(); ++i) {
+        cumulative += h.count(i);
+        series(out, name + "_bucket", prefix + "le=\"" + number(h.bounds()[i]) + '"',
+               std::to_string(cumulative));
+      }
+      cumulative += h.count(h.bounds().size());
+      series(out, name + "_bucket", prefix + "le=\"+Inf\"", std::to_string(cumulative));
+      series(out, name + "_sum", labels, number(h.sum()));
+      series(out, name + "_count", labels, std::to_string(cumulative));
+    }
+  }
+  return out;
+}
+
+} // namespace metrics
+} // namespace midgard
+} // namespace valhalla
@@ -1,6 +1,7 @@
 #include "midgard/pointll.h"
 #include "midgard/constants.h"
 #include "midgard/distanceapproximator.h"
+#include "midgard/fastmath.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "midgard/vector2.h"
@@ -121,6 +122,36 @@ float PointLL::Heading(const PointLL& ll2) const {
   return (bearing < 0.0) ? bearing + 360.0 : bearing;
 }
 
+void PointLL::Distances(const float* lngs, const float* lats, size_t count, float* dists) {
+  // Haversine rather than the law of cosines, the acos of a number close to 1 loses too much
+  // precision in single precision floats for the short segments of most shapes
+  for (size_t i = 1; i < count; ++i) {
+    float sin_dlat = fast_sin((lats[i] - lats[i - 1]) * (kRadPerDeg * 0.5f));
+    float sin_dlng = fast_sin((lngs[i] - lngs[i - 1]) * (kRadPerDeg * 0.5f));
+    float h = sin_dlat * sin_dlat + fast_cos(lats[i - 1] * kRadPerDeg) *
+                                        fast_cos(lats[i] * kRadPerDeg) * sin_dlng * sin_dlng;
+    h = h > 1.0f ? 1.0f : h;
+    dists[i - 1] = 2.0f * kRadEarthMeters * fast_atan2(std::sqrt(h), std::sqrt(1.0f - h));
+  }
+}
+
+void PointLL::Headings(const float* lngs, const float* lats, size_t count, float* headings) {
+  // the x of Heading is rewritten with the differences of the angles in degrees, as the difference
+  // of its two terms cancels out most of the precision of a float for points close to each other
+  for (size_t i = 1; i < count; ++i) {
+    float lat1 = lats[i - 1] * kRadPerDeg;
+    float lat2 = lats[i] * kRadPerDeg;
+    float dlng = (lngs[i] - lngs[i - 1]) * kRadPerDeg;
+    float cos_lat2 = fast_cos(lat2);
+    float sin_half_dlng = fast_sin(dlng * 0.5f);
+    float y = fast_sin(dlng) * cos_lat2;
+    float x = fast_sin((lats[i] - lats[i - 1]) * kRadPerDeg) +
+              2.0f * fast_sin(lat1) * cos_lat2 * sin_half_dlng * sin_half_dlng;
+    float bearing = fast_atan2(y, x) * kDegPerRad;
+    headings[i - 1] = bearing < 0.0f ? bearing + 360.0f : bearing;
+  }
+}
+
 // Finds the closest point to the supplied polyline as well as the distance
 // squared to that point and the index of the segment where the closest point
 // lies.
@@ -1,7 +1,8 @@
 #include "valhalla/midgard/polyline2.h"
 
-#include <functional>
+#include <limits>
 #include <list>
+#include <utility>
 #include <vector>
 
 namespace valhalla {
@@ -95,53 +96,72 @@ void Polyline2<coord_t>::Generalize(container_t& polyline,
   if (epsilon <= 0.f || polyline.size() < 3)
     return;
 
-  // the recursive bit
+  // points by index, whether each has to be kept no matter what and whether it is kept
+  std::vector<const coord_t*> points;
+  points.reserve(polyline.size());
+  for (const auto& p : polyline) {
+    points.push_back(&p);
+  }
+  std::vector<bool> special(points.size(), false);
+  for (auto i : indices) {
+    if (i < special.size())
+      special[i] = true;
+  }
+  std::vector<bool> keep(points.size(), false);
+  keep.front() = keep.back() = true;
+
+  // the sections left to simplify, each is worked on independently of the others so rather
+  // than recursing into them we keep a stack of the ones still to do
   epsilon *= epsilon;
-  std::function<void(typename container_t::iterator, size_t, typename container_t::iterator, size_t)>
-      peucker;
-  peucker = [&peucker, &polyline, epsilon, &indices](typename container_t::iterator start, size_t s,
-                                                     typename container_t::iterator end, size_t e) {
+  std::vector<std::pair<size_t, size_t>> sections{{0, points.size() - 1}};
+  while (!sections.empty()) {
+    size_t s = sections.back().first, e = sections.back().second;
+    sections.pop_back();
+
     // find the point furthest from the line
     float dmax = std::numeric_limits<float>::lowest();
-    typename container_t::iterator itr;
-    LineSegment2<coord_t> l{*start, *end};
-    size_t j = e - 1, k;
+    LineSegment2<coord_t> l{*points[s], *points[e]};
+    size_t k = e;
     coord_t tmp;
-    for (auto i = std::prev(end); i != start; --i, --j) {
+    for (size_t j = e - 1; j > s; --j) {
       // special points we dont want to generalize no matter what take precidence
-      if (indices.find(j) != indices.end()) {
-        itr = i;
+      if (special[j]) {
         dmax = epsilon;
         k = j;
         break;
       }
 
       // if this is the highest frequency detail so far
-      auto d = l.DistanceSquared(*i, tmp);
+      auto d = l.DistanceSquared(*points[j], tmp);
       if (d > dmax) {
-        itr = i;
         dmax = d;
         k = j;
       }
     }
 
     // there are some high frequency details between start and end
-    // so we need to look for flatter sections between them
+    // so we need to look for flatter sections between them, otherwise
+    // nothing sticks out between start and end so everything between goes
     if (dmax >= epsilon) {
-      // we recurse from right to left for two reasons:
-      // 1. we want to preserve iterator validity in the vector version
-      // 2. its the only way to preserve the indices in the keep set
+      keep[k] = true;
       if (e - k > 1)
-        peucker(itr, k, end, e);
+        sections.emplace_back(k, e);
       if (k - s > 1)
-        peucker(start, s, itr, k);
-    } // nothing sticks out between start and end so simplify everything between away
-    else
-      polyline.erase(std::next(start), end);
-  };
-
-  // recurse!
-  peucker(polyline.begin(), 0, std::prev(polyline.end()), polyline.size() - 1);
+        sections.emplace_back(s, k);
+    }
+  }
+
+  // drop the points that were not kept in one pass
+  auto out = polyline.begin();
+  size_t i = 0;
+  for (auto p = polyline.begin(); p != polyline.end(); ++p, ++i) {
+    if (keep[i]) {
+      if (out != p)
+        *out = std::move(*p);
+      ++out;
+    }
+  }
+  polyline.erase(out, polyline.end());
 }
 
 // Clip this polyline to the specified bounding box.
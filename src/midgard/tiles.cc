@@ -2,8 +2,10 @@
 #include "midgard/distanceapproximator.h"
 #include "midgard/polyline2.h"
 #include "midgard/util.h"
+#include <algorithm>
 #include <cmath>
 #include <set>
+#include <stdexcept>
 
 namespace {
 
@@ -295,13 +297,10 @@ void Tiles<coord_t>::ColorMap(std::unordered_map<uint32_t, size_t>& connectivity
 }
 
 template <class coord_t>
-template <class container_t>
-std::unordered_map<int32_t, std::unordered_set<unsigned short>>
-Tiles<coord_t>::Intersect(const container_t& linestring) const {
-  std::unordered_map<int32_t, std::unordered_set<unsigned short>> intersection;
-
+template <class container_t, class mark_t>
+void Tiles<coord_t>::Rasterize(const container_t& linestring, const mark_t& mark) const {
   // what to do when we want to mark a subdivision as containing a segment of this linestring
-  const auto set_pixel = [this, &intersection](int32_t x, int32_t y) {
+  const auto set_pixel = [this, &mark](int32_t x, int32_t y) {
     // cant mark ones that are outside the valid range of tiles
     // TODO: wrap coordinates around x and y?
     if (x < 0 || y < 0 || x >= nsubdivisions_ * ncolumns_ || y >= nsubdivisions_ * nrows_) {
@@ -313,7 +312,7 @@ Tiles<coord_t>::Intersect(const container_t& linestring) const {
     int32_t tile = tile_row * ncolumns_ + tile_column;
     // find the subdivision
     unsigned short subdivision = (y % nsubdivisions_) * nsubdivisions_ + (x % nsubdivisions_);
-    intersection[tile].insert(subdivision);
+    mark(tile, subdivision);
     return false;
   };
 
@@ -339,7 +338,7 @@ Tiles<coord_t>::Intersect(const container_t& linestring) const {
     if (vi != line.cend()) {
       v = *vi;
     } else if (line.size() > 1) {
-      return intersection;
+      return;
     }
     ui = vi;
 
@@ -367,8 +366,49 @@ Tiles<coord_t>::Intersect(const container_t& linestring) const {
       bresenham_line(x0, y0, x1, y1, set_pixel);
     }
   }
+}
+
+template <class coord_t>
+template <class container_t>
+std::unordered_map<int32_t, std::unordered_set<unsigned short>>
+Tiles<coord_t>::Intersect(const container_t& linestring) const {
+  std::unordered_map<int32_t, std::unordered_set<unsigned short>> intersection;
+  Rasterize(linestring, [&intersection](int32_t tile, unsigned short subdivision) {
+    intersection[tile].insert(subdivision);
+  });
+  return intersection;
+}
+
+template <class coord_t>
+template <class container_t>
+std::vector<std::pair<int32_t, uint64_t>>
+Tiles<coord_t>::IntersectBins(const container_t& linestring) const {
+  if (nsubdivisions_ * nsubdivisions_ > 64) {
+    throw std::logic_error("Cannot mask more than 64 subdivisions per tile");
+  }
 
-  // give them back
+  // consecutive cells are almost always in the same tile so they just go into its mask
+  std::vector<std::pair<int32_t, uint64_t>> intersection;
+  Rasterize(linestring, [&intersection](int32_t tile, unsigned short subdivision) {
+    if (intersection.empty() || intersection.back().first != tile) {
+      intersection.emplace_back(tile, 0);
+    }
+    intersection.back().second |= uint64_t(1) << subdivision;
+  });
+
+  // the line can come back to a tile so we merge those runs together
+  std::sort(intersection.begin(), intersection.end());
+  auto last = intersection.begin();
+  for (auto i = intersection.begin(); i != intersection.end(); ++i) {
+    if (i->first == last->first) {
+      last->second |= i->second;
+    } else {
+      *++last = *i;
+    }
+  }
+  if (!intersection.empty()) {
+    intersection.erase(last + 1, intersection.end());
+  }
   return intersection;
 }
 
@@ -433,6 +473,14 @@ template class std::unordered_map<int32_t, std::unordered_set<unsigned short>>
 Tiles<Point2>::Intersect(const std::vector<Point2>&) const;
 template class std::unordered_map<int32_t, std::unordered_set<unsigned short>>
 Tiles<PointLL>::Intersect(const std::vector<PointLL>&) const;
+template std::vector<std::pair<int32_t, uint64_t>>
+Tiles<Point2>::IntersectBins(const std::list<Point2>&) const;
+template std::vector<std::pair<int32_t, uint64_t>>
+Tiles<PointLL>::IntersectBins(const std::list<PointLL>&) const;
+template std::vector<std::pair<int32_t, uint64_t>>
+Tiles<Point2>::IntersectBins(const std::vector<Point2>&) const;
+template std::vector<std::pair<int32_t, uint64_t>>
+Tiles<PointLL>::IntersectBins(const std::vector<PointLL>&) const;
 
 } // namespace midgard
 } // namespace valhalla
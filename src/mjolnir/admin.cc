@@ -1,11 +1,190 @@
 #include "mjolnir/admin.h"
 #include "baldr/datetime.h"
 #include "midgard/logging.h"
+#include <algorithm>
 #include <boost/filesystem/operations.hpp>
+#include <cstring>
+#include <fstream>
 #include <spatialite.h>
 #include <sqlite3.h>
+#include <stdexcept>
 #include <unordered_map>
 
+namespace {
+
+using namespace valhalla::mjolnir;
+
+// Identifies a polygon file, the number goes up whenever the layout changes
+constexpr char kPolygonFileMagic[8] = {'V', 'P', 'O', 'L', 'Y', '0', '0', '1'};
+
+struct polygon_file_header_t {
+  char magic[8];
+  uint32_t kind;
+  uint32_t spare;
+  uint64_t count;          // number of polygons
+  uint64_t records_offset; // where the table of records starts
+};
+
+// One per polygon, the table of them at the end of the file is what gets searched
+struct polygon_record_t {
+  double minx;
+  double miny;
+  double maxx;
+  double maxy;
+  uint64_t offset; // where the names and coordinates of the polygon start
+  uint32_t flags;
+  uint32_t spare;
+};
+
+constexpr uint32_t kDriveOnRight = 1;
+constexpr uint32_t kAllowIntersectionNames = 2;
+
+template <class T> void write_value(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// The file is only aligned where the records start so everything else is copied out
+template <class T> T read_value(const char*& data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  return value;
+}
+
+void write_ring(std::ofstream& out, const polygon_type::ring_type& ring) {
+  write_value(out, static_cast<uint32_t>(ring.size()));
+  for (const auto& point : ring) {
+    write_value(out, point.x());
+    write_value(out, point.y());
+  }
+}
+
+void read_ring(const char*& data, polygon_type::ring_type& ring) {
+  auto count = read_value<uint32_t>(data);
+  ring.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto x = read_value<double>(data);
+    auto y = read_value<double>(data);
+    ring.emplace_back(x, y);
+  }
+}
+
+// Pack the rows of a query into the file. The first columns are names and the last one is the
+// geometry as WKT, admins have their drive on right and intersection name flags before it
+void write_rows(sqlite3* db_handle,
+                const std::string& sql,
+                int name_count,
+                bool has_flags,
+                std::ofstream& out,
+                std::vector<polygon_record_t>& records) {
+  sqlite3_stmt* stmt = 0;
+  uint32_t ret = sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, 0);
+  if (ret != SQLITE_OK) {
+    LOG_ERROR("sqlite3_prepare_v2() error: " + std::string(sqlite3_errmsg(db_handle)));
+    sqlite3_finalize(stmt);
+    return;
+  }
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    polygon_record_t record{};
+    record.offset = static_cast<uint64_t>(out.tellp());
+
+    int column = 0;
+    for (; column < name_count; ++column) {
+      std::string name;
+      if (sqlite3_column_type(stmt, column) == SQLITE_TEXT) {
+        name = (char*)sqlite3_column_text(stmt, column);
+      }
+      write_value(out, static_cast<uint32_t>(name.size()));
+      out.write(name.data(), name.size());
+    }
+
+    if (has_flags) {
+      bool dor = true;
+      if (sqlite3_column_type(stmt, column) == SQLITE_INTEGER) {
+        dor = sqlite3_column_int(stmt, column);
+      }
+      ++column;
+      bool intersection_name = false;
+      if (sqlite3_column_type(stmt, column) == SQLITE_INTEGER) {
+        intersection_name = sqlite3_column_int(stmt, column);
+      }
+      ++column;
+      record.flags = (dor ? kDriveOnRight : 0) | (intersection_name ? kAllowIntersectionNames : 0);
+    }
+
+    std::string geom;
+    if (sqlite3_column_type(stmt, column) == SQLITE_TEXT) {
+      geom = (char*)sqlite3_column_text(stmt, column);
+    }
+    multi_polygon_type multi_poly;
+    boost::geometry::read_wkt(geom, multi_poly);
+    boost::geometry::model::box<point_type> box;
+    boost::geometry::envelope(multi_poly, box);
+    record.minx = box.min_corner().x();
+    record.miny = box.min_corner().y();
+    record.maxx = box.max_corner().x();
+    record.maxy = box.max_corner().y();
+
+    write_value(out, static_cast<uint32_t>(multi_poly.size()));
+    for (const auto& poly : multi_poly) {
+      write_value(out, static_cast<uint32_t>(poly.inners().size() + 1));
+      write_ring(out, poly.outer());
+      for (const auto& inner : poly.inners()) {
+        write_ring(out, inner);
+      }
+    }
+    records.push_back(record);
+  }
+  sqlite3_finalize(stmt);
+}
+
+// Write the polygons of some queries to a file followed by the table of their bounding boxes
+size_t write_polygon_file(sqlite3* db_handle,
+                          const std::string& file,
+                          PolygonFile::Kind kind,
+                          const std::vector<std::string>& queries,
+                          int name_count,
+                          bool has_flags) {
+  if (!db_handle) {
+    return 0;
+  }
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    LOG_ERROR("Could not open " + file + " for writing");
+    return 0;
+  }
+
+  // Leave room for the header, it is written once we know where the records are
+  polygon_file_header_t header{};
+  write_value(out, header);
+
+  std::vector<polygon_record_t> records;
+  for (const auto& sql : queries) {
+    write_rows(db_handle, sql, name_count, has_flags, out, records);
+  }
+
+  // The records are aligned so they can be searched right where they are mapped
+  while (static_cast<uint64_t>(out.tellp()) % alignof(polygon_record_t) != 0) {
+    out.put('\0');
+  }
+  std::memcpy(header.magic, kPolygonFileMagic, sizeof(header.magic));
+  header.kind = static_cast<uint32_t>(kind);
+  header.count = records.size();
+  header.records_offset = static_cast<uint64_t>(out.tellp());
+  out.write(reinterpret_cast<const char*>(records.data()),
+            records.size() * sizeof(polygon_record_t));
+  out.seekp(0);
+  write_value(out, header);
+  if (!out) {
+    LOG_ERROR("Could not write " + file);
+    return 0;
+  }
+  return records.size();
+}
+
+} // namespace
+
 namespace valhalla {
 namespace mjolnir {
 
@@ -77,6 +256,80 @@ uint32_t GetMultiPolyId(const std::unordered_multimap<uint32_t, multi_polygon_ty
   return index;
 }
 
+PolygonGrid::PolygonGrid(const std::unordered_multimap<uint32_t, multi_polygon_type>& polys,
+                         const AABB2<PointLL>& bounds,
+                         GraphTileBuilder* graphtile,
+                         const uint32_t divisions)
+    : polys_(polys), bounds_(bounds), graphtile_(graphtile),
+      divisions_(std::max(divisions, static_cast<uint32_t>(1))),
+      cell_width_(bounds.Width() / divisions_), cell_height_(bounds.Height() / divisions_),
+      cells_(divisions_ * divisions_) {
+}
+
+// Get the polygon index of a point within the tile
+uint32_t PolygonGrid::Get(const PointLL& ll) {
+  if (polys_.empty()) {
+    return 0;
+  }
+
+  // Find the cell, points on or past the edge of the tile go to the outer cells
+  auto last = static_cast<int>(divisions_) - 1;
+  auto col = static_cast<int>((ll.lng() - bounds_.minx()) / cell_width_);
+  auto row = static_cast<int>((ll.lat() - bounds_.miny()) / cell_height_);
+  col = std::min(std::max(col, 0), last);
+  row = std::min(std::max(row, 0), last);
+  auto& cell = cells_[row * divisions_ + col];
+  if (!cell.ready) {
+    Prepare(cell, row, col);
+  }
+
+  // Only test the point when a boundary goes through the cell
+  if (cell.covered) {
+    return cell.index;
+  }
+  return Find(cell.polys, point_type(ll.lng(), ll.lat()), false);
+}
+
+// Work out which polys touch the cell and whether they cover it
+void PolygonGrid::Prepare(cell_t& cell, const uint32_t row, const uint32_t col) {
+  double minx = bounds_.minx() + col * cell_width_;
+  double miny = bounds_.miny() + row * cell_height_;
+  boost::geometry::model::box<point_type> box(point_type(minx, miny),
+                                              point_type(minx + cell_width_, miny + cell_height_));
+  polygon_type cell_poly;
+  boost::geometry::convert(box, cell_poly);
+
+  // Keep the polys in the order GetMultiPolyId would look at them
+  cell.covered = true;
+  for (const auto& poly : polys_) {
+    if (boost::geometry::intersects(cell_poly, poly.second)) {
+      cell.polys.push_back(&poly);
+      cell.covered = cell.covered && boost::geometry::covered_by(cell_poly, poly.second);
+    }
+  }
+  if (cell.covered) {
+    cell.index = Find(cell.polys, point_type(minx, miny), true);
+  }
+  cell.ready = true;
+}
+
+// Pick the poly a point is in from the candidates, the state poly wins over the country one for
+// admins and the first one found for everything else
+uint32_t PolygonGrid::Find(const std::vector<const poly_t*>& polys,
+                           const point_type& p,
+                           bool covered) const {
+  uint32_t index = 0;
+  for (const auto* poly : polys) {
+    if (covered || boost::geometry::covered_by(p, poly->second)) {
+      if (graphtile_ == nullptr || graphtile_->admins_builder(poly->first).state_offset()) {
+        return poly->first;
+      }
+      index = poly->first;
+    }
+  }
+  return index;
+}
+
 // Get the timezone polys from the db
 std::unordered_multimap<uint32_t, multi_polygon_type> GetTimeZones(sqlite3* db_handle,
                                                                    const AABB2<PointLL>& aabb) {
@@ -254,6 +507,144 @@ GetAdminInfo(sqlite3* db_handle,
   return polys;
 }
 
+PolygonFile::PolygonFile(const std::string& file)
+    : kind_(Kind::kAdmins), count_(0), records_(nullptr) {
+  auto size = boost::filesystem::file_size(file);
+  polygon_file_header_t header;
+  if (size < sizeof(header)) {
+    throw std::runtime_error(file + " is not a polygon file");
+  }
+  memory_.map(file, size);
+  std::memcpy(&header, memory_.get(), sizeof(header));
+  if (std::memcmp(header.magic, kPolygonFileMagic, sizeof(header.magic)) != 0 ||
+      header.records_offset > size ||
+      (size - header.records_offset) / sizeof(polygon_record_t) < header.count) {
+    throw std::runtime_error(file + " is not a polygon file");
+  }
+  kind_ = static_cast<Kind>(header.kind);
+  count_ = header.count;
+  records_ = memory_.get() + header.records_offset;
+}
+
+PolygonFile::Kind PolygonFile::kind() const {
+  return kind_;
+}
+
+// Get the polygons that intersect a bounding box, in the order they were written
+std::vector<PackedPolygon> PolygonFile::Get(const AABB2<PointLL>& aabb) const {
+  boost::geometry::model::box<point_type> bounds(point_type(aabb.minx(), aabb.miny()),
+                                                 point_type(aabb.maxx(), aabb.maxy()));
+  polygon_type box;
+  boost::geometry::convert(bounds, box);
+  int name_count = kind_ == Kind::kAdmins ? 4 : 1;
+
+  std::vector<PackedPolygon> polygons;
+  for (uint64_t i = 0; i < count_; ++i) {
+    // Only decode the polygons whose bounding box overlaps
+    polygon_record_t record;
+    std::memcpy(&record, records_ + i * sizeof(record), sizeof(record));
+    if (record.maxx < aabb.minx() || record.minx > aabb.maxx() || record.maxy < aabb.miny() ||
+        record.miny > aabb.maxy()) {
+      continue;
+    }
+
+    PackedPolygon polygon;
+    const char* data = memory_.get() + record.offset;
+    for (int n = 0; n < name_count; ++n) {
+      auto length = read_value<uint32_t>(data);
+      polygon.names.emplace_back(data, length);
+      data += length;
+    }
+    polygon.drive_on_right = record.flags & kDriveOnRight;
+    polygon.allow_intersection_names = record.flags & kAllowIntersectionNames;
+    polygon.polygon.resize(read_value<uint32_t>(data));
+    for (auto& poly : polygon.polygon) {
+      auto rings = read_value<uint32_t>(data);
+      read_ring(data, poly.outer());
+      poly.inners().resize(rings > 0 ? rings - 1 : 0);
+      for (auto& inner : poly.inners()) {
+        read_ring(data, inner);
+      }
+    }
+
+    // Same as the ST_Intersects the db is queried with
+    if (boost::geometry::intersects(box, polygon.polygon)) {
+      polygons.emplace_back(std::move(polygon));
+    }
+  }
+  return polygons;
+}
+
+// Open a polygon file if one is configured and it exists
+std::unique_ptr<PolygonFile> OpenPolygonFile(const boost::optional<std::string>& file,
+                                             PolygonFile::Kind kind) {
+  if (!file || !boost::filesystem::exists(*file)) {
+    return nullptr;
+  }
+  try {
+    std::unique_ptr<PolygonFile> polygons(new PolygonFile(*file));
+    if (polygons->kind() == kind) {
+      return polygons;
+    }
+    LOG_WARN(*file + " has the wrong kind of polygons");
+  } catch (const std::exception& e) { LOG_WARN(e.what()); }
+  return nullptr;
+}
+
+// Pack the admin polys of an admin db into a polygon file
+size_t WriteAdminPolygons(sqlite3* db_handle, const std::string& file) {
+  std::vector<std::string> queries{
+      "SELECT country.name, state.name, country.iso_code, state.iso_code, state.drive_on_right, "
+      "state.allow_intersection_names, st_astext(state.geom) from admins state, admins country "
+      "where country.rowid = state.parent_admin and state.admin_level=4;",
+      "SELECT name, \"\", iso_code, \"\", drive_on_right, allow_intersection_names, "
+      "st_astext(geom) from admins where admin_level=2;"};
+  return write_polygon_file(db_handle, file, PolygonFile::Kind::kAdmins, queries, 4, true);
+}
+
+// Pack the timezone polys of a timezone db into a polygon file
+size_t WriteTimeZonePolygons(sqlite3* db_handle, const std::string& file) {
+  std::vector<std::string> queries{"select TZID, st_astext(geom) from tz_world;"};
+  return write_polygon_file(db_handle, file, PolygonFile::Kind::kTimeZones, queries, 1, false);
+}
+
+// Get the timezone polys from a polygon file
+std::unordered_multimap<uint32_t, multi_polygon_type> GetTimeZones(const PolygonFile& file,
+                                                                   const AABB2<PointLL>& aabb) {
+  std::unordered_multimap<uint32_t, multi_polygon_type> polys;
+  if (file.kind() != PolygonFile::Kind::kTimeZones) {
+    return polys;
+  }
+  for (auto& tz : file.Get(aabb)) {
+    uint32_t idx = DateTime::get_tz_db().to_index(tz.names.front());
+    if (idx != 0) {
+      polys.emplace(idx, std::move(tz.polygon));
+    }
+  }
+  return polys;
+}
+
+// Get the admin polys that intersect with the tile bounding box from a polygon file
+std::unordered_multimap<uint32_t, multi_polygon_type>
+GetAdminInfo(const PolygonFile& file,
+             std::unordered_map<uint32_t, bool>& drive_on_right,
+             std::unordered_map<uint32_t, bool>& allow_intersection_names,
+             const AABB2<PointLL>& aabb,
+             GraphTileBuilder& tilebuilder) {
+  std::unordered_multimap<uint32_t, multi_polygon_type> polys;
+  if (file.kind() != PolygonFile::Kind::kAdmins) {
+    return polys;
+  }
+  for (auto& admin : file.Get(aabb)) {
+    uint32_t index =
+        tilebuilder.AddAdmin(admin.names[0], admin.names[1], admin.names[2], admin.names[3]);
+    polys.emplace(index, std::move(admin.polygon));
+    drive_on_right.emplace(index, admin.drive_on_right);
+    allow_intersection_names.emplace(index, admin.allow_intersection_names);
+  }
+  return polys;
+}
+
 // Get all the country access records from the db and save them to a map.
 std::unordered_map<std::string, std::vector<int>> GetCountryAccess(sqlite3* db_handle) {
 
@@ -28,6 +28,7 @@
 #include "midgard/sequence.h"
 #include "midgard/util.h"
 #include "mjolnir/osmnode.h"
+#include "mjolnir/util.h"
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -412,11 +413,11 @@ using bss_by_tile_t = std::unordered_map<GraphId, std::vector<OSMNode>>;
 
 void build(const boost::property_tree::ptree& pt,
            std::mutex& lock,
-           bss_by_tile_t::const_iterator tile_start,
-           bss_by_tile_t::const_iterator tile_end) {
+           TileScheduler<bss_by_tile_t::const_iterator>& tile_queue) {
 
   GraphReader reader_local_level(pt);
-  for (; tile_start != tile_end; ++tile_start) {
+  bss_by_tile_t::const_iterator tile_start;
+  while (tile_queue.next(tile_start)) {
 
     const GraphTile* local_tile = nullptr;
     std::unique_ptr<GraphTileBuilder> tilebuilder_local = nullptr;
@@ -487,20 +488,18 @@ void BssBuilder::Build(const boost::property_tree::ptree& pt, const std::string&
            std::to_string(bss_by_tile.size()) + " local graphs with " + std::to_string(nb_threads) +
            " thread(s)");
 
-  size_t floor = bss_by_tile.size() / threads.size();
-  size_t at_ceiling = bss_by_tile.size() - (threads.size() * floor);
-  bss_by_tile_t::const_iterator tile_start, tile_end = bss_by_tile.begin();
+  // Each station is matched against the edges of its tile so that is roughly the cost of a tile
+  std::vector<std::pair<bss_by_tile_t::const_iterator, size_t>> tile_costs;
+  for (auto tile = bss_by_tile.cbegin(); tile != bss_by_tile.cend(); ++tile) {
+    tile_costs.emplace_back(tile, tile->second.size() *
+                                      reader.GetGraphTile(tile->first)->header()->directededgecount());
+  }
+  TileScheduler<bss_by_tile_t::const_iterator> tile_queue(std::move(tile_costs));
 
   for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
     // Make the thread
     threads[i].reset(new std::thread(build, std::cref(pt.get_child("mjolnir")), std::ref(lock),
-                                     tile_start, tile_end));
+                                     std::ref(tile_queue)));
   }
 
   for (auto& thread : threads) {
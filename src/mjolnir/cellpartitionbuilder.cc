@@ -0,0 +1,109 @@
+#include "mjolnir/cellpartitionbuilder.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <string>
+#include <vector>
+
+#include "baldr/cellpartition.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace valhalla {
+namespace mjolnir {
+
+namespace {
+
+// The cells of the lowest level split a local tile 8x8, a few kilometers across, so that
+// customizing one only searches a few thousand nodes
+constexpr uint32_t kTileSubdivisions = 8;
+
+} // namespace
+
+uint32_t CellPartitionBuilder::Cell(const PointLL& ll, const uint32_t level) {
+  const double size =
+      TileHierarchy::levels().rbegin()->second.tiles.TileSize() / kTileSubdivisions;
+  uint32_t row = static_cast<uint32_t>((ll.lat() + 90.0) / size) >> level;
+  uint32_t col = static_cast<uint32_t>((ll.lng() + 180.0) / size) >> level;
+  return (row << 16) | col;
+}
+
+void CellPartitionBuilder::Build(const boost::property_tree::ptree& pt) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  const uint32_t levels = std::max(pt.get<uint32_t>("mjolnir.cell_partition_levels", 6), 1u);
+
+  // Collect the nodes on all road levels
+  CellPartition partition;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() == transit_level) {
+      continue;
+    }
+    const GraphTile* tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      partition.nodes.push_back(GraphId(tile_id.tileid(), tile_id.level(), i).value);
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  std::sort(partition.nodes.begin(), partition.nodes.end());
+  LOG_INFO("Cell partition over " + std::to_string(partition.nodes.size()) + " nodes");
+
+  // Put every node in its cells and collect the edges, transitions between levels included
+  partition.cells.assign(levels, std::vector<uint32_t>(partition.nodes.size()));
+  for (uint32_t from = 0; from < partition.nodes.size(); ++from) {
+    GraphId node_id(partition.nodes[from]);
+    const GraphTile* tile = reader.GetGraphTile(node_id);
+    const NodeInfo* node = tile->node(node_id);
+    auto ll = node->latlng(tile->header()->base_ll());
+    for (uint32_t level = 0; level < levels; ++level) {
+      partition.cells[level][from] = Cell(ll, level);
+    }
+    GraphId edge_id(node_id.tileid(), node_id.level(), node->edge_index());
+    const DirectedEdge* edge = tile->directededge(node->edge_index());
+    for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge, ++edge_id) {
+      if (edge->is_shortcut()) {
+        continue;
+      }
+      uint32_t to = partition.node_index(edge->endnode());
+      if (to != kInvalidCellIndex) {
+        partition.edges.push_back({edge_id.value, from, to});
+      }
+    }
+    for (const auto& trans : tile->GetNodeTransitions(node)) {
+      uint32_t to = partition.node_index(trans.endnode());
+      if (to != kInvalidCellIndex) {
+        partition.edges.push_back({kInvalidGraphId, from, to});
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // Say how many boundary nodes each level has, the fewer the faster the customization
+  partition.Finish();
+  for (uint32_t level = 0; level < levels; ++level) {
+    size_t boundary = 0;
+    for (const auto& cell : partition.boundaries[level]) {
+      boundary += cell.second.size();
+    }
+    LOG_INFO("Level " + std::to_string(level) + " has " +
+             std::to_string(partition.boundaries[level].size()) + " cells with " +
+             std::to_string(boundary) + " boundary nodes");
+  }
+
+  auto file = CellPartition::file_name(reader.tile_dir());
+  boost::filesystem::create_directories(boost::filesystem::path(file).parent_path());
+  partition.write(file);
+  LOG_INFO("Wrote cell partition to " + file);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
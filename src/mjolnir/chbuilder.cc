@@ -0,0 +1,381 @@
+#include "mjolnir/chbuilder.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "sif/autocost.h"
+#include "sif/bicyclecost.h"
+#include "sif/pedestriancost.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Limit the number of nodes settled by a witness search. A search that gives
+// up early only adds a shortcut that was not needed, never a wrong one.
+constexpr uint32_t kMaxWitnessSettled = 500;
+
+// Adjacency of a node in the remaining (not yet contracted) graph
+struct Arc {
+  uint32_t node; // Node at the other end
+  float cost;    // Cost of the edge
+  uint32_t edge; // Index of the CHEdge
+};
+
+using queue_entry_t = std::pair<float, uint32_t>;
+using min_queue_t =
+    std::priority_queue<queue_entry_t, std::vector<queue_entry_t>, std::greater<queue_entry_t>>;
+
+// Candidate shortcut around the node being contracted
+struct Shortcut {
+  uint32_t from;
+  uint32_t to;
+  float cost;
+  uint32_t in_edge;
+  uint32_t out_edge;
+};
+
+/**
+ * Contracts nodes in order of their edge difference (shortcuts added minus
+ * edges removed plus the number of contracted neighbors), updating the
+ * priorities lazily when a node reaches the front of the queue.
+ */
+class Contractor {
+public:
+  Contractor(const uint32_t node_count, std::vector<CHEdge>& edges)
+      : edges_(edges), out_(node_count), in_(node_count), contracted_(node_count, false),
+        deleted_neighbors_(node_count, 0),
+        dist_(node_count, std::numeric_limits<float>::infinity()) {
+    for (uint32_t i = 0; i < edges_.size(); ++i) {
+      const auto& edge = edges_[i];
+      if (edge.from != edge.to) {
+        add_arc(edge.from, edge.to, edge.cost, i);
+      }
+    }
+  }
+
+  void run(CHGraph& graph) {
+    const uint32_t n = static_cast<uint32_t>(out_.size());
+    min_queue_t order;
+    for (uint32_t v = 0; v < n; ++v) {
+      order.emplace(static_cast<float>(priority(v)), v);
+    }
+
+    // Contract and remember the up and down edges of each node as it goes
+    std::vector<uint32_t> up_start(n), up_count(n), down_start(n), down_count(n);
+    std::vector<uint32_t> up, down;
+    graph.ranks.assign(n, 0);
+    uint32_t rank = 0;
+    while (!order.empty()) {
+      uint32_t v = order.top().second;
+      order.pop();
+      if (contracted_[v]) {
+        continue;
+      }
+
+      // Lazy update: requeue if the node is no longer the least important
+      float p = static_cast<float>(priority(v));
+      if (!order.empty() && p > order.top().first) {
+        order.emplace(p, v);
+        continue;
+      }
+
+      up_start[v] = up.size();
+      down_start[v] = down.size();
+      contract(v, up, down);
+      up_count[v] = up.size() - up_start[v];
+      down_count[v] = down.size() - down_start[v];
+      graph.ranks[v] = rank++;
+      if (rank % 1000000 == 0) {
+        LOG_INFO("Contracted " + std::to_string(rank) + " of " + std::to_string(n) + " nodes");
+      }
+    }
+
+    // Lay out the edge lists in node order
+    graph.up_offsets.resize(n + 1);
+    graph.down_offsets.resize(n + 1);
+    graph.up_edges.reserve(up.size());
+    graph.down_edges.reserve(down.size());
+    for (uint32_t v = 0; v < n; ++v) {
+      graph.up_offsets[v] = graph.up_edges.size();
+      graph.up_edges.insert(graph.up_edges.end(), up.begin() + up_start[v],
+                            up.begin() + up_start[v] + up_count[v]);
+      graph.down_offsets[v] = graph.down_edges.size();
+      graph.down_edges.insert(graph.down_edges.end(), down.begin() + down_start[v],
+                              down.begin() + down_start[v] + down_count[v]);
+    }
+    graph.up_offsets[n] = graph.up_edges.size();
+    graph.down_offsets[n] = graph.down_edges.size();
+  }
+
+private:
+  std::vector<CHEdge>& edges_;
+  std::vector<std::vector<Arc>> out_;
+  std::vector<std::vector<Arc>> in_;
+  std::vector<bool> contracted_;
+  std::vector<uint32_t> deleted_neighbors_;
+
+  // Witness search state
+  std::vector<float> dist_;
+  std::vector<uint32_t> touched_;
+  std::vector<Shortcut> shortcuts_;
+
+  // Adds an arc or lowers the cost of an existing one between the same nodes
+  void add_arc(const uint32_t from, const uint32_t to, const float cost, const uint32_t edge) {
+    auto& out = out_[from];
+    auto itr = std::find_if(out.begin(), out.end(), [to](const Arc& a) { return a.node == to; });
+    if (itr == out.end()) {
+      out.push_back({to, cost, edge});
+      in_[to].push_back({from, cost, edge});
+    } else if (cost < itr->cost) {
+      itr->cost = cost;
+      itr->edge = edge;
+      auto& in = in_[to];
+      auto back =
+          std::find_if(in.begin(), in.end(), [from](const Arc& a) { return a.node == from; });
+      back->cost = cost;
+      back->edge = edge;
+    }
+  }
+
+  // Dijkstra from source within the remaining graph, skipping the node being
+  // contracted. Stops past the cost limit or after settling enough nodes.
+  void witness_search(const uint32_t source, const uint32_t skip, const float limit) {
+    for (auto t : touched_) {
+      dist_[t] = std::numeric_limits<float>::infinity();
+    }
+    touched_.clear();
+
+    min_queue_t queue;
+    dist_[source] = 0.0f;
+    touched_.push_back(source);
+    queue.emplace(0.0f, source);
+    uint32_t settled = 0;
+    while (!queue.empty()) {
+      auto top = queue.top();
+      queue.pop();
+      if (top.first > dist_[top.second]) {
+        continue;
+      }
+      if (top.first > limit || ++settled > kMaxWitnessSettled) {
+        break;
+      }
+      for (const auto& arc : out_[top.second]) {
+        if (arc.node == skip) {
+          continue;
+        }
+        float d = top.first + arc.cost;
+        if (d < dist_[arc.node]) {
+          if (dist_[arc.node] == std::numeric_limits<float>::infinity()) {
+            touched_.push_back(arc.node);
+          }
+          dist_[arc.node] = d;
+          queue.emplace(d, arc.node);
+        }
+      }
+    }
+  }
+
+  // Finds the shortcuts contracting v would need
+  void find_shortcuts(const uint32_t v) {
+    shortcuts_.clear();
+    float max_out = 0.0f;
+    for (const auto& out : out_[v]) {
+      max_out = std::max(max_out, out.cost);
+    }
+    for (const auto& in : in_[v]) {
+      witness_search(in.node, v, in.cost + max_out);
+      for (const auto& out : out_[v]) {
+        if (out.node == in.node) {
+          continue;
+        }
+        float cost = in.cost + out.cost;
+        if (dist_[out.node] > cost) {
+          shortcuts_.push_back({in.node, out.node, cost, in.edge, out.edge});
+        }
+      }
+    }
+  }
+
+  int64_t priority(const uint32_t v) {
+    find_shortcuts(v);
+    return static_cast<int64_t>(shortcuts_.size()) - static_cast<int64_t>(in_[v].size()) -
+           static_cast<int64_t>(out_[v].size()) + deleted_neighbors_[v];
+  }
+
+  void contract(const uint32_t v, std::vector<uint32_t>& up, std::vector<uint32_t>& down) {
+    find_shortcuts(v);
+    for (const auto& s : shortcuts_) {
+      uint32_t index = edges_.size();
+      const auto& in = edges_[s.in_edge];
+      const auto& out = edges_[s.out_edge];
+      edges_.push_back({kInvalidGraphId, s.from, s.to, s.cost, in.secs + out.secs,
+                        in.length + out.length, s.in_edge, s.out_edge});
+      add_arc(s.from, s.to, s.cost, index);
+    }
+
+    // The remaining edges of v lead to nodes contracted later: higher ranks
+    for (const auto& out : out_[v]) {
+      up.push_back(out.edge);
+      auto& in = in_[out.node];
+      in.erase(std::remove_if(in.begin(), in.end(), [v](const Arc& a) { return a.node == v; }),
+               in.end());
+      ++deleted_neighbors_[out.node];
+    }
+    for (const auto& in : in_[v]) {
+      down.push_back(in.edge);
+      auto& out = out_[in.node];
+      out.erase(std::remove_if(out.begin(), out.end(), [v](const Arc& a) { return a.node == v; }),
+                out.end());
+      ++deleted_neighbors_[in.node];
+    }
+    std::vector<Arc>().swap(out_[v]);
+    std::vector<Arc>().swap(in_[v]);
+    contracted_[v] = true;
+  }
+};
+
+// Parses the default options of a costing a hierarchy can be built for and makes the costing
+valhalla::sif::cost_ptr_t
+make_costing(const std::string& name, valhalla::Options& options, valhalla::Costing& costing) {
+  using namespace valhalla;
+  rapidjson::Document doc;
+  doc.SetObject();
+  while (options.costing_options_size() <= static_cast<int>(Costing::pedestrian)) {
+    options.add_costing_options();
+  }
+  const std::string key = "/costing_options/" + name;
+  if (name == "auto") {
+    costing = Costing::auto_;
+    sif::ParseAutoCostOptions(doc, key, options.mutable_costing_options(costing));
+    return sif::CreateAutoCost(costing, options);
+  } else if (name == "bicycle") {
+    costing = Costing::bicycle;
+    sif::ParseBicycleCostOptions(doc, key, options.mutable_costing_options(costing));
+    return sif::CreateBicycleCost(costing, options);
+  } else if (name == "pedestrian") {
+    costing = Costing::pedestrian;
+    sif::ParsePedestrianCostOptions(doc, key, options.mutable_costing_options(costing));
+    return sif::CreatePedestrianCost(costing, options);
+  }
+  throw std::runtime_error("No contraction hierarchy can be built for the " + name + " costing");
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+CHGraph CHBuilder::Contract(const uint32_t node_count, std::vector<CHEdge>&& edges) {
+  CHGraph graph;
+  graph.edges = std::move(edges);
+  Contractor contractor(node_count, graph.edges);
+  contractor.run(graph);
+  return graph;
+}
+
+void CHBuilder::Build(const boost::property_tree::ptree& pt) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  std::vector<std::string> costings;
+  if (auto listed = pt.get_child_optional("mjolnir.contraction_hierarchy_costings")) {
+    for (const auto& costing : *listed) {
+      costings.push_back(costing.second.get_value<std::string>());
+    }
+  }
+  if (costings.empty()) {
+    costings.push_back("auto");
+  }
+
+  // Collect the nodes on all road levels
+  CHGraph lookup;
+  std::vector<uint64_t> nodes;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() == transit_level) {
+      continue;
+    }
+    const GraphTile* tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      nodes.push_back(GraphId(tile_id.tileid(), tile_id.level(), i).value);
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+  lookup.nodes = std::move(nodes);
+  LOG_INFO("Contraction hierarchies over " + std::to_string(lookup.nodes.size()) + " nodes");
+
+  for (const auto& name : costings) {
+    // The costing with its default options
+    Options options;
+    Costing type;
+    auto costing = make_costing(name, options, type);
+    auto edge_filter = costing->GetEdgeFilter();
+    auto node_filter = costing->GetNodeFilter();
+
+    // Collect the edges the costing allows plus 0 cost transitions between levels
+    std::vector<CHEdge> edges;
+    for (uint32_t from = 0; from < lookup.nodes.size(); ++from) {
+      GraphId node_id(lookup.nodes[from]);
+      const GraphTile* tile = reader.GetGraphTile(node_id);
+      const NodeInfo* node = tile->node(node_id);
+      if (node_filter(node)) {
+        continue;
+      }
+      GraphId edge_id(node_id.tileid(), node_id.level(), node->edge_index());
+      const DirectedEdge* edge = tile->directededge(node->edge_index());
+      for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge, ++edge_id) {
+        if (edge_filter(edge) == 0.0f) {
+          continue;
+        }
+        uint32_t to = lookup.node_index(edge->endnode());
+        if (to == kInvalidCHIndex) {
+          continue;
+        }
+        auto cost = costing->EdgeCost(edge, tile);
+        edges.push_back({edge_id.value, from, to, cost.cost, cost.secs,
+                         static_cast<float>(edge->length()), kInvalidCHIndex, kInvalidCHIndex});
+      }
+      for (const auto& trans : tile->GetNodeTransitions(node)) {
+        uint32_t to = lookup.node_index(trans.endnode());
+        if (to != kInvalidCHIndex) {
+          edges.push_back(
+              {kInvalidGraphId, from, to, 0.0f, 0.0f, 0.0f, kInvalidCHIndex, kInvalidCHIndex});
+        }
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+    LOG_INFO("Contracting " + std::to_string(edges.size()) + " " + name + " edges");
+
+    // Contract and write next to the tiles
+    auto contracted = Contract(lookup.nodes.size(), std::move(edges));
+    contracted.nodes = lookup.nodes;
+    contracted.costing_options =
+        options.costing_options(static_cast<int>(type)).SerializeAsString();
+    LOG_INFO("Contraction hierarchy has " + std::to_string(contracted.edges.size()) + " edges");
+
+    auto file = CHGraph::file_name(reader.tile_dir(), name);
+    boost::filesystem::create_directories(boost::filesystem::path(file).parent_path());
+    contracted.write(file);
+    LOG_INFO("Wrote contraction hierarchy to " + file);
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
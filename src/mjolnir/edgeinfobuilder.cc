@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <ostream>
 
@@ -8,6 +9,19 @@
 #include "midgard/logging.h"
 #include "mjolnir/edgeinfobuilder.h"
 
+namespace {
+
+// Appends one unsigned varint
+void write_varint(std::string& output, uint32_t value) {
+  while (value > 0x7f) {
+    output.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+} // namespace
+
 namespace valhalla {
 namespace mjolnir {
 
@@ -72,12 +86,36 @@ void EdgeInfoBuilder::set_encoded_shape(const std::string& encoded_shape) {
   std::copy(encoded_shape.begin(), encoded_shape.end(), back_inserter(encoded_shape_));
 }
 
+// Set the elevation profile. Each sample is stored as the zig zag encoded difference in
+// decimeters from the one before it so a profile is about a byte per sample.
+void EdgeInfoBuilder::set_elevation_profile(const std::vector<double>& elevations) {
+  encoded_elevation_.clear();
+  int32_t last = 0;
+  for (auto elevation : elevations) {
+    int32_t quantized = static_cast<int32_t>(std::round(elevation / kElevationProfilePrecision));
+    int32_t delta = quantized - last;
+    write_varint(encoded_elevation_, delta < 0 ? ~(static_cast<uint32_t>(delta) << 1)
+                                               : static_cast<uint32_t>(delta) << 1);
+    last = quantized;
+  }
+}
+
+// Set the encoded elevation profile.
+void EdgeInfoBuilder::set_encoded_elevation_profile(const std::string& encoded_elevation) {
+  encoded_elevation_ = encoded_elevation;
+}
+
 // Get the size of the edge info (including name offsets and shape string)
 std::size_t EdgeInfoBuilder::BaseSizeOf() const {
   std::size_t size = sizeof(uint64_t);
   size += sizeof(baldr::EdgeInfo::PackedItem);
   size += (name_info_list_.size() * sizeof(NameInfo));
   size += (encoded_shape_.size() * sizeof(std::string::value_type));
+  if (!encoded_elevation_.empty()) {
+    std::string prefix;
+    write_varint(prefix, encoded_elevation_.size());
+    size += prefix.size() + encoded_elevation_.size();
+  }
   return size;
 }
 
@@ -96,7 +134,7 @@ std::size_t EdgeInfoBuilder::SizeOf() const {
 // Output edge info to output stream
 std::ostream& operator<<(std::ostream& os, const EdgeInfoBuilder& eib) {
   // Pack the name count and encoded shape size. Check against limits.
-  baldr::EdgeInfo::PackedItem item;
+  baldr::EdgeInfo::PackedItem item{};
   uint32_t name_count = eib.name_info_list_.size();
   if (name_count > kMaxNamesPerEdge) {
     LOG_WARN("Exceeding max names per edge: " + std::to_string(name_count));
@@ -112,6 +150,8 @@ std::ostream& operator<<(std::ostream& os, const EdgeInfoBuilder& eib) {
     item.encoded_shape_size = static_cast<uint32_t>(eib.encoded_shape_.size());
   }
 
+  item.has_elevation_profile = !eib.encoded_elevation_.empty();
+
   // Write out the bytes
   os.write(reinterpret_cast<const char*>(&eib.w0_.value_), sizeof(uint64_t));
   os.write(reinterpret_cast<const char*>(&item), sizeof(baldr::EdgeInfo::PackedItem));
@@ -119,6 +159,13 @@ std::ostream& operator<<(std::ostream& os, const EdgeInfoBuilder& eib) {
            (name_count * sizeof(NameInfo)));
   os << eib.encoded_shape_;
 
+  // The elevation profile, prefixed with its size
+  if (item.has_elevation_profile) {
+    std::string prefix;
+    write_varint(prefix, eib.encoded_elevation_.size());
+    os << prefix << eib.encoded_elevation_;
+  }
+
   // Pad to an 8 byte boundary
   std::size_t n = (eib.BaseSizeOf() % 8);
   if (n != 0) {
@@ -2,6 +2,7 @@
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/format.hpp>
+#include <cmath>
 #include <future>
 #include <set>
 #include <thread>
@@ -10,6 +11,7 @@
 #include "baldr/graphconstants.h"
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/polyline2.h"
@@ -36,13 +38,16 @@ constexpr double kMinimumInterval = 10.0f;
  * Adds elevation to a set of tiles. Each thread pulls a tile of the queue
  */
 void add_elevation(const boost::property_tree::ptree& pt,
-                   std::deque<GraphId>& tilequeue,
+                   TileScheduler<GraphId>& tilequeue,
                    std::mutex& lock,
                    const std::unique_ptr<const valhalla::skadi::sample>& sample,
                    std::promise<uint32_t>& result) {
   // Local Graphreader
   GraphReader graphreader(pt.get_child("mjolnir"));
 
+  // Optionally store the elevation along each edge about every this many meters
+  auto profile_interval = pt.get<float>("additional_data.elevation_profile_interval", 0.f);
+
   // We usually end up accessing the same shape twice (once for each direction along an edge).
   // Use a cache to record elevation attributes based on the EdgeInfo offset. This includes
   // weighted grade (forward and reverse) as well as max slopes (up/down for forward and reverse).
@@ -51,15 +56,11 @@ void add_elevation(const boost::property_tree::ptree& pt,
 
   // Check for more tiles
   while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
+    // Get the next tile Id
+    GraphId tile_id;
+    if (!tilequeue.next(tile_id)) {
       break;
     }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
 
     // Get the tile. Serialize the entire tile?
     GraphTileBuilder tilebuilder(graphreader.tile_dir(), tile_id, true);
@@ -135,6 +136,20 @@ void add_elevation(const boost::property_tree::ptree& pt,
 
         // Set the mean elevation on EdgeInfo
         tilebuilder.set_mean_elevation(edge_info_offset, mean_elevation);
+
+        // Store the profile with both ends of the shape so that requests can read the elevation
+        // along the edge from the tile. Tunnels and ferries are not on the surface so get none
+        if (profile_interval > 0.f && !directededge.tunnel() && directededge.use() != Use::kFerry) {
+          std::vector<PointLL> postings = {shape.front(), shape.back()};
+          if (length > profile_interval * 1.5f) {
+            postings = valhalla::midgard::resample_polyline(shape, length, profile_interval);
+          }
+          auto heights = sample->get_all(postings);
+          if (std::find(heights.begin(), heights.end(),
+                        valhalla::skadi::sample::get_no_data_value()) == heights.end()) {
+            tilebuilder.set_elevation_profile(edge_info_offset, heights);
+          }
+        }
       }
 
       // Edge elevation information. If the edge is forward (with respect to the shape)
@@ -170,32 +185,59 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt) {
   auto hierarchy_properties = pt.get_child("mjolnir");
   std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
 
-  // Crack open some elevation data if its there. Return if it is not.
+  // Setup threads
+  uint32_t nthreads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+
+  // Crack open some elevation data if its there. Return if it is not. The threads share it so
+  // each of them can use the elevation tiles another one already unzipped
   boost::optional<std::string> elevation = pt.get_optional<std::string>("additional_data.elevation");
   std::unique_ptr<const skadi::sample> sample;
   if (elevation && boost::filesystem::exists(*elevation)) {
-    sample.reset(new skadi::sample(*elevation));
+    // keep at least a couple of unzipped tiles per thread
+    auto cache_size = std::max(pt.get<size_t>("additional_data.elevation_cache_size", 0),
+                               nthreads * 2 * skadi::sample::get_tile_bytes());
+    sample.reset(new skadi::sample(*elevation, cache_size,
+                                   pt.get<std::string>("additional_data.elevation_cache_dir", "")));
   } else {
     LOG_INFO("ElevationBuilder: no elevation data, skipping");
     return;
   }
 
-  // Create a randomized queue of tiles (at all levels) to work from
-  std::deque<GraphId> tilequeue;
+  // Create a queue of tiles (at all levels) to work from. Tiles within the same elevation tile
+  // (1 degree) are kept together so the threads are all working in about the same place and each
+  // elevation tile is only unzipped about once, within those the biggest tiles go first
   GraphReader reader(pt.get_child("mjolnir"));
-  auto tileset = reader.GetTileSet();
-  for (const auto& id : tileset) {
-    tilequeue.emplace_back(id);
+  auto costs = TileCosts(reader.tile_dir(), reader.GetTileSet());
+  auto elevation_tile = [](const GraphId& tile_id) {
+    const auto& transit_level = TileHierarchy::GetTransitLevel();
+    const auto& tiles = tile_id.level() == transit_level.level
+                            ? transit_level.tiles
+                            : TileHierarchy::get_tiling(tile_id.level());
+    auto center = tiles.TileBounds(tile_id.tileid()).Center();
+    return std::make_pair(std::floor(center.lat()), std::floor(center.lng()));
+  };
+  std::vector<std::pair<std::pair<double, double>, std::pair<GraphId, size_t>>> ordered;
+  for (const auto& cost : costs) {
+    ordered.emplace_back(elevation_tile(cost.first), cost);
+  }
+  std::sort(ordered.begin(), ordered.end(), [](const decltype(ordered)::value_type& a,
+                                               const decltype(ordered)::value_type& b) {
+    if (a.first != b.first) {
+      return a.first < b.first;
+    }
+    return a.second.second > b.second.second;
+  });
+  std::vector<GraphId> tiles;
+  tiles.reserve(ordered.size());
+  for (const auto& tile : ordered) {
+    tiles.push_back(tile.second.first);
   }
-  std::random_shuffle(tilequeue.begin(), tilequeue.end());
+  TileScheduler<GraphId> tilequeue(std::move(tiles));
 
   // An mutex we can use to do the synchronization
   std::mutex lock;
-
-  // Setup threads
-  uint32_t nthreads =
-      std::max(static_cast<unsigned int>(1),
-               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
   std::vector<std::shared_ptr<std::thread>> threads(nthreads);
 
   // Setup promises. Hold the results for the threads
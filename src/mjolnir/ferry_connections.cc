@@ -1,7 +1,12 @@
 #include "mjolnir/ferry_connections.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <queue>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "baldr/graphconstants.h"
 #include "midgard/util.h"
@@ -35,7 +40,7 @@ public:
 
 // Form the shortest path from the start node until a node that
 // touches the specified road classification.
-uint32_t ShortestPath(const uint32_t start_node_idx,
+std::vector<size_t> ShortestPath(const uint32_t start_node_idx,
                       const uint32_t node_idx,
                       sequence<OSMWay>& ways,
                       sequence<OSMWayNode>& way_nodes,
@@ -169,13 +174,13 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
 
   // If only one label we have immediately found an edge with proper
   // classification - or we cannot expand due to driveability
+  std::vector<size_t> path_edges;
   if (node_labels.size() == 1) {
     LOG_DEBUG("Only 1 edge reclassified");
-    return 0;
+    return path_edges;
   }
 
-  // Trace shortest path backwards and upgrade edge classifications
-  uint32_t count = 0;
+  // Trace shortest path backwards and collect the edges to upgrade
   while (true) {
     // Get the edge between this node and the predecessor
     uint32_t idx = node_labels[index].node_index;
@@ -183,15 +188,9 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
     auto expand_node_itr = nodes[idx];
     auto bundle2 = collect_node_edges(expand_node_itr, nodes, edges);
     for (auto& edge : bundle2.node_edges) {
-      if (edge.first.sourcenode_ == pred_node || edge.first.targetnode_ == pred_node) {
-        sequence<Edge>::iterator element = edges[edge.second];
-        auto update_edge = *element;
-        if (update_edge.attributes.importance > rc) {
-          update_edge.attributes.importance = rc;
-          update_edge.attributes.reclass_ferry = true;
-          element = update_edge;
-          count++;
-        }
+      if ((edge.first.sourcenode_ == pred_node || edge.first.targetnode_ == pred_node) &&
+          edge.first.attributes.importance > rc) {
+        path_edges.push_back(edge.second);
       }
     }
 
@@ -201,7 +200,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
     }
     index = node_status[pred_node].index;
   }
-  return count;
+  return path_edges;
 }
 
 // Check if the ferry included in this node bundle is short. Must be
@@ -250,6 +249,40 @@ bool ShortFerry(const uint32_t node_index,
   return short_edge;
 }
 
+namespace {
+
+// A shortest path search from the end node of an edge connected to a ferry
+struct ferry_search_t {
+  uint32_t start_node_idx;
+  uint32_t node_idx;
+  bool inbound;
+};
+
+// Run searches until there are none left, each thread has its own view of the
+// data files and its own queue and labels inside ShortestPath. The edges to
+// reclassify are only collected here, they are updated once all searches are done
+void FerrySearches(const std::string& ways_file,
+                   const std::string& way_nodes_file,
+                   const std::string& nodes_file,
+                   const std::string& edges_file,
+                   const uint32_t rc,
+                   const std::vector<ferry_search_t>& searches,
+                   std::atomic<size_t>& next_search,
+                   std::vector<std::vector<size_t>>& path_edges) {
+  sequence<OSMWay> ways(ways_file, false);
+  sequence<OSMWayNode> way_nodes(way_nodes_file, false);
+  sequence<Edge> edges(edges_file, false);
+  sequence<Node> nodes(nodes_file, false);
+
+  for (size_t i = next_search++; i < searches.size(); i = next_search++) {
+    const auto& search = searches[i];
+    path_edges[i] = ShortestPath(search.start_node_idx, search.node_idx, ways, way_nodes, edges,
+                                 nodes, search.inbound, rc);
+  }
+}
+
+} // namespace
+
 // Reclassify edges from a ferry along the shortest path to the
 // specified road classification.
 void ReclassifyFerryConnections(const std::string& ways_file,
@@ -257,13 +290,15 @@ void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& nodes_file,
                                 const std::string& edges_file,
                                 const uint32_t rc,
-                                DataQuality& stats) {
+                                DataQuality& stats,
+                                const unsigned int thread_count) {
   LOG_INFO("Reclassifying ferry connection graph edges...");
 
   sequence<OSMWay> ways(ways_file, false);
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   sequence<Edge> edges(edges_file, false);
   sequence<Node> nodes(nodes_file, false);
+  nodes.readahead();
 
   // Need to expand from the end of the ferry until we meet a road with the
   // specified classification. Want to do simple shortest path (time based
@@ -272,7 +307,8 @@ void ReclassifyFerryConnections(const std::string& ways_file,
   // Iterate through nodes and find any that connect to both a ferry and a
   // regular (non-ferry) edge. Skip short ferry edges (river crossing?)
   uint32_t ferry_endpoint_count = 0;
-  uint32_t total_count = 0;
+  std::vector<ferry_search_t> searches;
+  std::vector<size_t> start_edges;
   sequence<Node>::iterator node_itr = nodes.begin();
   while (node_itr != nodes.end()) {
     auto bundle = collect_node_edges(node_itr, nodes, edges);
@@ -281,7 +317,6 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         !ShortFerry(node_itr.position(), bundle, edges, nodes, ways, way_nodes)) {
       // Form shortest path from node along each edge connected to the ferry,
       // track until the specified RC is reached
-      bool oneway_reverse = false;
       for (const auto& edge : bundle.node_edges) {
         // Skip ferry edges and non-driveable edges
         if (edge.first.attributes.driveable_ferry ||
@@ -290,7 +325,8 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         }
 
         // Expand/reclassify from the end node of this edge.
-        uint32_t end_node_idx = (edge.first.sourcenode_ == node_itr.position())
+        uint32_t start_node_idx = node_itr.position();
+        uint32_t end_node_idx = (edge.first.sourcenode_ == start_node_idx)
                                     ? edge.first.targetnode_
                                     : edge.first.sourcenode_;
 
@@ -301,33 +337,67 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         if (edge.first.attributes.driveableforward == edge.first.attributes.driveablereverse) {
           // Driveable in both directions - get an inbound path and an
           // outbound path.
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, true, rc);
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, false, rc);
+          searches.push_back({start_node_idx, end_node_idx, true});
+          searches.push_back({start_node_idx, end_node_idx, false});
         } else {
           // Check if oneway inbound to the ferry
-          bool inbound = (edge.first.sourcenode_ == node_itr.position())
+          bool inbound = (edge.first.sourcenode_ == start_node_idx)
                              ? edge.first.attributes.driveablereverse
                              : edge.first.attributes.driveableforward;
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, inbound, rc);
+          searches.push_back({start_node_idx, end_node_idx, inbound});
         }
         ferry_endpoint_count++;
 
-        // Reclassify the first/start edge. Do this AFTER finding shortest path so
-        // we do not immediately determine we hit the specified classification
-        sequence<Edge>::iterator element = edges[edge.second];
-        auto update_edge = *element;
-        update_edge.attributes.importance = rc;
-        element = update_edge;
-        total_count++;
+        // Reclassify the first/start edge once the searches are done so
+        // they do not immediately determine we hit the specified classification
+        start_edges.push_back(edge.second);
       }
     }
 
     // Go to the next node
     node_itr += bundle.node_count;
   }
+
+  // The searches only read the data files so they can all run at once. Since
+  // edges are only updated after all of them finish each search sees the graph
+  // as it was before any reclassification, which keeps the result the same no
+  // matter how many threads there are
+  std::vector<std::vector<size_t>> path_edges(searches.size());
+  std::atomic<size_t> next_search(0);
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(1u, std::min(thread_count, static_cast<unsigned int>(searches.size()))));
+  for (auto& thread : threads) {
+    thread.reset(new std::thread(FerrySearches, std::cref(ways_file), std::cref(way_nodes_file),
+                                 std::cref(nodes_file), std::cref(edges_file), rc,
+                                 std::cref(searches), std::ref(next_search),
+                                 std::ref(path_edges)));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  // Upgrade the edges along each path, paths often share edges near the ferry
+  // so only the edges not yet upgraded count
+  uint32_t total_count = 0;
+  for (const auto& path : path_edges) {
+    for (auto edge_index : path) {
+      sequence<Edge>::iterator element = edges[edge_index];
+      auto update_edge = *element;
+      if (update_edge.attributes.importance > rc) {
+        update_edge.attributes.importance = rc;
+        update_edge.attributes.reclass_ferry = true;
+        element = update_edge;
+        total_count++;
+      }
+    }
+  }
+  for (auto edge_index : start_edges) {
+    sequence<Edge>::iterator element = edges[edge_index];
+    auto update_edge = *element;
+    update_edge.attributes.importance = rc;
+    element = update_edge;
+    total_count++;
+  }
   LOG_INFO("Finished ReclassifyFerryEdges: ferry_endpoint_count = " +
            std::to_string(ferry_endpoint_count) + ", " + std::to_string(total_count) +
            " edges reclassified.");
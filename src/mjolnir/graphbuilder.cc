@@ -41,21 +41,27 @@ namespace {
  *
  */
 std::map<GraphId, size_t>
-SortGraph(const std::string& nodes_file, const std::string& edges_file, const uint8_t level) {
+SortGraph(const std::string& nodes_file,
+          const std::string& edges_file,
+          const uint8_t level,
+          const unsigned int threads) {
   LOG_INFO("Sorting graph...");
 
   // Sort nodes by graphid then by osmid, so its basically a set of tiles
   sequence<Node> nodes(nodes_file, false);
-  nodes.sort([](const Node& a, const Node& b) {
-    if (a.graph_id == b.graph_id) {
-      return a.node.osmid_ < b.node.osmid_;
-    }
-    return a.graph_id < b.graph_id;
-  });
+  nodes.sort(
+      [](const Node& a, const Node& b) {
+        if (a.graph_id == b.graph_id) {
+          return a.node.osmid_ < b.node.osmid_;
+        }
+        return a.graph_id < b.graph_id;
+      },
+      1024 * 1024 * 512 / sizeof(Node), threads);
   // run through the sorted nodes, going back to the edges they reference and updating each edge
   // to point to the first (out of the duplicates) nodes index. at the end of this there will be
   // tons of nodes that no edges reference, but we need them because they are the means by which
   // we know what edges connect to a given node from the nodes perspective
+  nodes.readahead();
   sequence<Edge> edges(edges_file, false);
   uint32_t run_index = 0;
   uint32_t node_index = 0;
@@ -122,6 +128,9 @@ void ConstructEdges(const OSMData& osmdata,
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   sequence<Edge> edges(edges_file, true);
   sequence<Node> nodes(nodes_file, true);
+  // both are walked front to back
+  ways.readahead();
+  way_nodes.readahead();
 
   // Method to get length of an edge (used to find short link edges)
   const auto Length = [&way_nodes](const size_t idx1, const OSMNode& node2) {
@@ -388,7 +397,7 @@ void BuildTileSet(const std::string& ways_file,
                   const std::string& complex_restriction_to_file,
                   const std::string& tile_dir,
                   const OSMData& osmdata,
-                  std::map<GraphId, size_t>::const_iterator tile_start,
+                  TileScheduler<std::map<GraphId, size_t>::const_iterator>& tile_queue,
                   std::map<GraphId, size_t>::const_iterator tile_end,
                   const uint32_t tile_creation_date,
                   const boost::property_tree::ptree& pt,
@@ -406,18 +415,27 @@ void BuildTileSet(const std::string& ways_file,
       pt.get<bool>("data_processing.infer_internal_intersections", true);
   bool infer_turn_channels = pt.get<bool>("data_processing.infer_turn_channels", true);
 
-  // Initialize the admin DB (if it exists)
-  sqlite3* admin_db_handle = database ? GetDBHandle(*database) : nullptr;
-  if (!database) {
+  // Use the packed admin polygons if there are some, otherwise initialize the admin DB (if it
+  // exists)
+  auto admin_file = OpenPolygonFile(pt.get_optional<std::string>("admin_polygons"),
+                                    PolygonFile::Kind::kAdmins);
+  sqlite3* admin_db_handle = !admin_file && database ? GetDBHandle(*database) : nullptr;
+  if (admin_file) {
+    LOG_DEBUG("Using packed admin polygons.");
+  } else if (!database) {
     LOG_WARN("Admin db not found.  Not saving admin information.");
   } else if (!admin_db_handle) {
     LOG_WARN("Admin db " + *database + " not found.  Not saving admin information.");
   }
 
+  // Same for the timezones
   database = pt.get_optional<std::string>("timezone");
-  // Initialize the tz DB (if it exists)
-  sqlite3* tz_db_handle = database ? GetDBHandle(*database) : nullptr;
-  if (!database) {
+  auto tz_file = OpenPolygonFile(pt.get_optional<std::string>("timezone_polygons"),
+                                 PolygonFile::Kind::kTimeZones);
+  sqlite3* tz_db_handle = !tz_file && database ? GetDBHandle(*database) : nullptr;
+  if (tz_file) {
+    LOG_DEBUG("Using packed time zone polygons.");
+  } else if (!database) {
     LOG_WARN("Time zone db not found.  Not saving time zone information.");
   } else if (!tz_db_handle) {
     LOG_WARN("Time zone db " + *database + " not found.  Not saving time zone information.");
@@ -447,7 +465,8 @@ void BuildTileSet(const std::string& ways_file,
 
   ////////////////////////////////////////////////////////////////////////////
   // Iterate over tiles
-  for (; tile_start != tile_end; ++tile_start) {
+  std::map<GraphId, size_t>::const_iterator tile_start;
+  while (tile_queue.next(tile_start)) {
     try {
       // What actually writes the tile
       GraphId tile_id = tile_start->first.Tile_Base();
@@ -469,24 +488,32 @@ void BuildTileSet(const std::string& ways_file,
       std::unordered_map<uint32_t, bool> drive_on_right;
       std::unordered_map<uint32_t, bool> allow_intersection_names;
 
-      if (admin_db_handle) {
+      if (admin_file) {
+        admin_polys = GetAdminInfo(*admin_file, drive_on_right, allow_intersection_names,
+                                   tiling.TileBounds(id), graphtile);
+      } else if (admin_db_handle) {
         admin_polys = GetAdminInfo(admin_db_handle, drive_on_right, allow_intersection_names,
                                    tiling.TileBounds(id), graphtile);
-        if (admin_polys.size() == 1) {
-          // TODO - check if tile bounding box is entirely inside the polygon...
-          tile_within_one_admin = true;
-        }
+      }
+      if (admin_polys.size() == 1) {
+        // TODO - check if tile bounding box is entirely inside the polygon...
+        tile_within_one_admin = true;
       }
 
       bool tile_within_one_tz = false;
       std::unordered_multimap<uint32_t, multi_polygon_type> tz_polys;
-      if (tz_db_handle) {
-        tz_polys = GetTimeZones(tz_db_handle, tiling.TileBounds(id));
+      if (tz_file || tz_db_handle) {
+        tz_polys = tz_file ? GetTimeZones(*tz_file, tiling.TileBounds(id))
+                           : GetTimeZones(tz_db_handle, tiling.TileBounds(id));
         if (tz_polys.size() == 1) {
           tile_within_one_tz = true;
         }
       }
 
+      // Grids over the tile so most nodes find their polygons without testing them
+      PolygonGrid admin_grid(admin_polys, tiling.TileBounds(id), &graphtile);
+      PolygonGrid tz_grid(tz_polys, tiling.TileBounds(id));
+
       // Iterate through the nodes
       uint32_t idx = 0; // Current directed edge index
 
@@ -514,9 +541,8 @@ void BuildTileSet(const std::string& ways_file,
         PointLL node_ll{node.lng_, node.lat_};
 
         // Get the admin index
-        uint32_t admin_index = (tile_within_one_admin)
-                                   ? admin_polys.begin()->first
-                                   : GetMultiPolyId(admin_polys, node_ll, graphtile);
+        uint32_t admin_index =
+            (tile_within_one_admin) ? admin_polys.begin()->first : admin_grid.Get(node_ll);
 
         // Look for potential duplicates
         // CheckForDuplicates(nodeid, node, edgelengths, nodes, edges, osmdata.ways, stats);
@@ -1010,8 +1036,7 @@ void BuildTileSet(const std::string& ways_file,
         }
 
         // Set the time zone index
-        uint32_t tz_index =
-            (tile_within_one_tz) ? tz_polys.begin()->first : GetMultiPolyId(tz_polys, node_ll);
+        uint32_t tz_index = (tile_within_one_tz) ? tz_polys.begin()->first : tz_grid.Get(node_ll);
 
         graphtile.nodes().back().set_timezone(tz_index);
 
@@ -1087,26 +1112,25 @@ void BuildLocalTiles(const unsigned int thread_count,
   // Hold the results (DataQuality/stats) for the threads
   std::vector<std::promise<DataQuality>> results(threads.size());
 
-  // Divvy up the work
-  size_t floor = tiles.size() / threads.size();
-  size_t at_ceiling = tiles.size() - (threads.size() * floor);
-  std::map<GraphId, size_t>::const_iterator tile_start, tile_end = tiles.begin();
+  // Divvy up the work, the nodes are sorted by tile so a tile has the nodes up to the next one
+  size_t node_count = sequence<Node>(nodes_file, false).size();
+  std::vector<std::pair<std::map<GraphId, size_t>::const_iterator, size_t>> tile_costs;
+  for (auto tile = tiles.cbegin(); tile != tiles.cend(); ++tile) {
+    auto next = std::next(tile);
+    tile_costs.emplace_back(tile, (next == tiles.cend() ? node_count : next->second) - tile->second);
+  }
+  TileScheduler<std::map<GraphId, size_t>::const_iterator> tile_queue(std::move(tile_costs));
 
   // Atomically pass around stats info
   for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
     // Make the thread
     threads[i].reset(new std::thread(BuildTileSet, std::cref(ways_file), std::cref(way_nodes_file),
                                      std::cref(nodes_file), std::cref(edges_file),
                                      std::cref(complex_from_restriction_file),
                                      std::cref(complex_to_restriction_file), std::cref(tile_dir),
-                                     std::cref(osmdata), tile_start, tile_end, tile_creation_date,
-                                     std::cref(pt.get_child("mjolnir")), std::ref(results[i])));
+                                     std::cref(osmdata), std::ref(tile_queue), tiles.cend(),
+                                     tile_creation_date, std::cref(pt.get_child("mjolnir")),
+                                     std::ref(results[i])));
   }
 
   // Join all the threads to wait for them to finish up their work
@@ -1160,7 +1184,7 @@ void GraphBuilder::Build(const boost::property_tree::ptree& pt,
                  pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
 
   // Line up the nodes and then re-map the edges that the edges to them
-  auto tiles = SortGraph(nodes_file, edges_file, level);
+  auto tiles = SortGraph(nodes_file, edges_file, level, threads);
 
   // Reclassify links (ramps). Cannot do this when building tiles since the
   // edge list needs to be modified
@@ -1180,7 +1204,7 @@ void GraphBuilder::Build(const boost::property_tree::ptree& pt,
     }
   }
   ReclassifyFerryConnections(ways_file, way_nodes_file, nodes_file, edges_file,
-                             static_cast<uint32_t>(rc), stats);
+                             static_cast<uint32_t>(rc), stats, threads);
 
   // Build tiles at the local level. Form connected graph from nodes and edges.
   BuildLocalTiles(threads, osmdata, ways_file, way_nodes_file, nodes_file, edges_file,
@@ -0,0 +1,279 @@
+#include "mjolnir/graphcomponents.h"
+#include "mjolnir/graphtilebuilder.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Dense indices for all of the nodes of all of the tiles, the nodes of a tile are consecutive
+class node_index_t {
+public:
+  node_index_t(GraphReader& reader) : count_(0) {
+    for (const auto& tile_id : reader.GetTileSet()) {
+      const auto* tile = reader.GetGraphTile(tile_id);
+      if (!tile || tile->header()->nodecount() == 0) {
+        continue;
+      }
+      tiles_.emplace_back(0, tile_id);
+    }
+    // in id order so that the nodes of nearby tiles are also near each other here
+    std::sort(tiles_.begin(), tiles_.end(),
+              [](const std::pair<uint32_t, GraphId>& a, const std::pair<uint32_t, GraphId>& b) {
+                return a.second < b.second;
+              });
+    for (auto& tile : tiles_) {
+      tile.first = count_;
+      offsets_.emplace(tile.second, count_);
+      count_ += reader.GetGraphTile(tile.second)->header()->nodecount();
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+
+  // the index of the node or size() if its tile has no nodes
+  uint32_t operator()(const GraphId& node) const {
+    auto offset = offsets_.find(node.Tile_Base());
+    return offset == offsets_.cend() ? count_ : offset->second + node.id();
+  }
+
+  // the node at the index
+  GraphId operator[](const uint32_t index) const {
+    auto tile = std::upper_bound(tiles_.cbegin(), tiles_.cend(), index,
+                                 [](const uint32_t index, const std::pair<uint32_t, GraphId>& tile) {
+                                   return index < tile.first;
+                                 }) -
+                1;
+    return {tile->second.tileid(), tile->second.level(), index - tile->first};
+  }
+
+  uint32_t size() const {
+    return count_;
+  }
+
+private:
+  std::vector<std::pair<uint32_t, GraphId>> tiles_;
+  std::unordered_map<GraphId, uint32_t> offsets_;
+  uint32_t count_;
+};
+
+// the next node of the graph of the mode after the given way out of a node, counting its edges
+// and then its transitions, or an invalid id if the mode doesnt go that way
+GraphId next_node(GraphReader& reader,
+                  const GraphTile* tile,
+                  const NodeInfo* node,
+                  const uint32_t way,
+                  const uint32_t mode) {
+  GraphId next;
+  if (way < node->edge_count()) {
+    const auto* edge = tile->directededge(node->edge_index() + way);
+    if (GraphComponents::Usable(*edge, mode)) {
+      next = edge->endnode();
+    }
+  } else {
+    next = tile->transition(node->transition_index() + way - node->edge_count())->endnode();
+  }
+  const GraphTile* next_tile = tile;
+  if (next.Is_Valid() && (!reader.GetGraphTile(next, next_tile) ||
+                          !GraphComponents::Usable(*next_tile->node(next), mode))) {
+    return {};
+  }
+  return next;
+}
+
+// finds the size class of the strongly connected component of every node of the graph of the
+// mode. it is tarjan's algorithm with an explicit stack of the nodes being expanded so that long
+// chains of nodes dont run out of call stack
+std::vector<uint8_t> find_components(const node_index_t& nodes, GraphReader& reader, uint32_t mode) {
+  std::vector<uint8_t> classes(nodes.size(), 0);
+  std::vector<uint32_t> order(nodes.size(), 0);
+  std::vector<uint32_t> low(nodes.size(), 0);
+  std::vector<bool> on_stack(nodes.size(), false);
+  uint32_t visited = 0;
+
+  // the nodes not yet in a component along with how many copies of them there are on the levels
+  struct member_t {
+    uint32_t index;
+    uint32_t copies;
+  };
+  std::vector<member_t> members;
+
+  // the nodes being expanded and which of their ways out is next
+  struct expansion_t {
+    uint32_t index;
+    GraphId id;
+    uint32_t way;
+  };
+  std::vector<expansion_t> expansions;
+
+  const GraphTile* tile = nullptr;
+  auto visit = [&](const uint32_t index, const GraphId& id, const NodeInfo* node) {
+    order[index] = low[index] = ++visited;
+    members.push_back({index, node->transition_count() + 1});
+    on_stack[index] = true;
+    expansions.push_back({index, id, 0});
+  };
+
+  for (uint32_t root = 0; root < nodes.size(); ++root) {
+    auto root_id = nodes[root];
+    if (order[root] != 0 || !reader.GetGraphTile(root_id, tile) ||
+        !GraphComponents::Usable(*tile->node(root_id), mode)) {
+      continue;
+    }
+    visit(root, root_id, tile->node(root_id));
+
+    while (!expansions.empty()) {
+      // the tiles are fetched again every step so this never leaves a dangling tile behind
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+      auto& expansion = expansions.back();
+      reader.GetGraphTile(expansion.id, tile);
+      const auto* node = tile->node(expansion.id);
+
+      // find the next way out of the node the mode can take
+      GraphId next;
+      while (!next.Is_Valid() && expansion.way < node->edge_count() + node->transition_count()) {
+        next = next_node(reader, tile, node, expansion.way++, mode);
+      }
+
+      // expand the next node or just take note of it if its already being expanded
+      if (next.Is_Valid()) {
+        auto index = nodes(next);
+        if (index == nodes.size()) {
+          continue;
+        }
+        if (order[index] == 0) {
+          const GraphTile* next_tile = nullptr;
+          reader.GetGraphTile(next, next_tile);
+          visit(index, next, next_tile->node(next));
+        } else if (on_stack[index]) {
+          low[expansion.index] = std::min(low[expansion.index], order[index]);
+        }
+        continue;
+      }
+
+      // the node is done, the one before it can reach whatever it can
+      auto index = expansion.index;
+      expansions.pop_back();
+      if (!expansions.empty()) {
+        low[expansions.back().index] = std::min(low[expansions.back().index], low[index]);
+      }
+      if (low[index] != order[index]) {
+        continue;
+      }
+
+      // its the first node of a component, count the nodes once no matter how many levels
+      // they are on
+      double size = 0;
+      auto first = members.size();
+      do {
+        --first;
+        size += 1.0 / members[first].copies;
+      } while (members[first].index != index);
+      uint8_t component_class = 0;
+      while (component_class < kMaxComponentClass &&
+             kComponentClassSizes[component_class + 1] <= size + .5) {
+        ++component_class;
+      }
+      for (auto member = members.begin() + first; member != members.end(); ++member) {
+        classes[member->index] = component_class;
+        on_stack[member->index] = false;
+      }
+      members.resize(first);
+    }
+  }
+  return classes;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+bool GraphComponents::Usable(const DirectedEdge& edge, const uint32_t mode) {
+  if (edge.is_shortcut() || !(edge.forwardaccess() & kComponentAccess[mode])) {
+    return false;
+  }
+  switch (kComponentAccess[mode]) {
+    // no rail or ferries for transit and nothing but the easiest hiking for any pedestrian
+    case kPedestrianAccess:
+      return edge.use() < Use::kFerry && edge.sac_scale() == SacScale::kNone;
+    // no steps and only the surfaces a road bike is allowed on
+    case kBicycleAccess:
+      return edge.use() != Use::kSteps && edge.surface() <= Surface::kCompacted;
+    default:
+      return true;
+  }
+}
+
+bool GraphComponents::Usable(const NodeInfo& node, const uint32_t mode) {
+  return node.access() & kComponentAccess[mode];
+}
+
+size_t GraphComponents::Label(const boost::property_tree::ptree& pt) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  node_index_t nodes(reader);
+  LOG_INFO("Finding the strongly connected components of " + std::to_string(nodes.size()) +
+           " nodes...");
+
+  // the component size classes of all the nodes for every mode
+  std::vector<std::vector<uint8_t>> classes;
+  for (uint32_t mode = 0; mode < kComponentModeCount; ++mode) {
+    classes.emplace_back(find_components(nodes, reader, mode));
+  }
+
+  // label each edge with the smaller of the components at its ends, the reach is at least that
+  // in both directions
+  size_t labeled = 0;
+  std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  for (const auto& tile_id : reader.GetTileSet()) {
+    GraphTileBuilder tilebuilder(tile_dir, tile_id, false);
+    const auto* header = tilebuilder.header();
+    if (header->nodecount() == 0 || header->directededgecount() == 0) {
+      continue;
+    }
+    const auto* first_node = &tilebuilder.node(0);
+    const auto* first_edge = &tilebuilder.directededge(0);
+    std::vector<NodeInfo> nodeinfos(first_node, first_node + header->nodecount());
+    std::vector<DirectedEdge> directededges(first_edge, first_edge + header->directededgecount());
+    auto begin = nodes(tile_id);
+    for (uint32_t i = 0; i < nodeinfos.size(); ++i) {
+      const auto& nodeinfo = nodeinfos[i];
+      for (uint32_t j = 0; j < nodeinfo.edge_count(); ++j) {
+        auto& directededge = directededges[nodeinfo.edge_index() + j];
+        auto end = nodes(directededge.endnode());
+        bool label = false;
+        for (uint32_t mode = 0; mode < kComponentModeCount; ++mode) {
+          auto component_class =
+              end < nodes.size() ? std::min(classes[mode][begin + i], classes[mode][end]) : 0;
+          directededge.set_component_class(mode, component_class);
+          label = label || component_class > 0;
+        }
+        labeled += label;
+      }
+    }
+    tilebuilder.Update(nodeinfos, directededges);
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  LOG_INFO("Labeled " + std::to_string(labeled) + " directed edges with their components");
+  return labeled;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
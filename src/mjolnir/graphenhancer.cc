@@ -4,13 +4,13 @@
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/util.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <future>
 #include <limits>
 #include <list>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <set>
 #include <stdexcept>
 #include <thread>
@@ -64,6 +64,11 @@ constexpr float kDensityRadius = 2.0f;
 constexpr float kDensityRadius2 = kDensityRadius * kDensityRadius;
 constexpr float kDensityLatDeg = (kDensityRadius * kMetersPerKm) / kMetersPerDegreeLat;
 
+// Cells per side of the grid the road lengths of a local tile are binned into for the density
+// and how many of those grids a thread keeps around before starting over
+constexpr uint32_t kDensityCells = 32;
+constexpr size_t kMaxDensityGrids = 64;
+
 // Factors used to adjust speed assignments
 constexpr float kTurnChannelFactor = 1.25f;
 constexpr float kRampDensityFactor = 0.8f;
@@ -909,6 +914,118 @@ bool IsNextEdgeInternal(const DirectedEdge directededge,
   return false;
 }
 
+/**
+ * The road lengths at the nodes of a local tile binned into a grid. The density around a node
+ * takes the cells the radius covers whole and only checks the nodes of the cells it cuts,
+ * instead of checking every node of every tile within the radius.
+ */
+class DensityGrid {
+public:
+  DensityGrid(const GraphTile* tile, const AABB2<PointLL>& bounds)
+      : bounds_(bounds), cell_width_(bounds.Width() / kDensityCells),
+        cell_height_(bounds.Height() / kDensityCells), offsets_(kDensityCells * kDensityCells + 1),
+        lengths_(kDensityCells * kDensityCells), extents_(kDensityCells * kDensityCells) {
+    // Road length at each node (excluding parking, walkways, ferries, etc.)
+    std::vector<std::pair<uint32_t, std::pair<PointLL, uint32_t>>> roads;
+    PointLL base_ll = tile->header()->base_ll();
+    const auto start_node = tile->node(0);
+    const auto end_node = start_node + tile->header()->nodecount();
+    for (auto node = start_node; node < end_node; ++node) {
+      uint32_t length = 0;
+      const DirectedEdge* directededge = tile->directededge(node->edge_index());
+      for (uint32_t i = 0; i < node->edge_count(); i++, directededge++) {
+        if (directededge->use() == Use::kRoad || directededge->use() == Use::kRamp ||
+            directededge->use() == Use::kTurnChannel || directededge->use() == Use::kAlley ||
+            directededge->use() == Use::kEmergencyAccess) {
+          length += directededge->length();
+        }
+      }
+      if (length > 0) {
+        auto ll = node->latlng(base_ll);
+        roads.emplace_back(cell(ll.lng(), ll.lat()), std::make_pair(ll, length));
+      }
+    }
+
+    // Sort the nodes by cell, keeping the total and the extent of the nodes in each cell
+    for (const auto& road : roads) {
+      ++offsets_[road.first + 1];
+    }
+    for (size_t i = 1; i < offsets_.size(); ++i) {
+      offsets_[i] += offsets_[i - 1];
+    }
+    auto next = offsets_;
+    nodes_.resize(roads.size());
+    for (const auto& road : roads) {
+      nodes_[next[road.first]++] = road.second;
+      if (lengths_[road.first] == 0) {
+        extents_[road.first] = AABB2<PointLL>(road.second.first, road.second.first);
+      } else {
+        extents_[road.first].Expand(road.second.first);
+      }
+      lengths_[road.first] += road.second.second;
+    }
+  }
+
+  /**
+   * Sums the road lengths at the nodes within a radius.
+   * @param  approximator  Distance approximator centered on the middle of the radius.
+   * @param  bbox          Bounding box of the radius.
+   * @param  mr2           Radius (meters) squared.
+   * @return Returns the sum of the road lengths.
+   */
+  uint64_t RoadLength(const DistanceApproximator& approximator,
+                      const AABB2<PointLL>& bbox,
+                      const float mr2) const {
+    // Cells whose nodes are all well within the radius count as a whole. The region within
+    // the radius is convex so that holds when the corners of their extent are within it. The
+    // margin keeps rounding from counting a node the per node check would not.
+    const float inner = mr2 * 0.999f;
+    uint64_t length = 0;
+    uint32_t c0 = cell(bbox.minx(), bbox.miny()), c1 = cell(bbox.maxx(), bbox.maxy());
+    for (uint32_t row = c0 / kDensityCells; row <= c1 / kDensityCells; ++row) {
+      for (uint32_t col = c0 % kDensityCells; col <= c1 % kDensityCells; ++col) {
+        uint32_t c = row * kDensityCells + col;
+        if (lengths_[c] == 0) {
+          continue;
+        }
+        const auto& extent = extents_[c];
+        if (approximator.DistanceSquared({extent.minx(), extent.miny()}) < inner &&
+            approximator.DistanceSquared({extent.maxx(), extent.miny()}) < inner &&
+            approximator.DistanceSquared({extent.minx(), extent.maxy()}) < inner &&
+            approximator.DistanceSquared({extent.maxx(), extent.maxy()}) < inner) {
+          length += lengths_[c];
+          continue;
+        }
+        for (uint32_t i = offsets_[c]; i < offsets_[c + 1]; ++i) {
+          if (approximator.DistanceSquared(nodes_[i].first) < mr2) {
+            length += nodes_[i].second;
+          }
+        }
+      }
+    }
+    return length;
+  }
+
+private:
+  // Cell a position falls in, positions off the tile (ie. on its edge) go to the nearest one
+  uint32_t cell(const float lng, const float lat) const {
+    auto index = [](const float offset, const float size) {
+      return static_cast<uint32_t>(
+          std::min(std::max(std::floor(offset / size), 0.0f), kDensityCells - 1.0f));
+    };
+    return index(lat - bounds_.miny(), cell_height_) * kDensityCells +
+           index(lng - bounds_.minx(), cell_width_);
+  }
+
+  AABB2<PointLL> bounds_;
+  float cell_width_;
+  float cell_height_;
+  std::vector<uint32_t> offsets_;                    // First node of each cell
+  std::vector<std::pair<PointLL, uint32_t>> nodes_; // Position and road length of the nodes
+  std::vector<uint64_t> lengths_;                    // Road length in each cell
+  std::vector<AABB2<PointLL>> extents_;              // Extent of the nodes in each cell
+};
+
 /**
  * Get the road density around the specified lat,lng position. This is a
  * value from 0-15 indicating a relative road density. This can be used
@@ -919,6 +1036,8 @@ bool IsNextEdgeInternal(const DirectedEdge directededge,
  * @param  maxdensity    (OUT) max density found
  * @param  tiles         Tiling (for getting list of required tiles)
  * @param  local_level   Level of the local tiles.
+ * @param  grids         Density grids of the local tiles this thread has looked at so far,
+ *                       null for the tiles without nodes.
  * @return  Returns the relative road density (0-15) - higher values are
  *          more dense.
  */
@@ -927,7 +1046,8 @@ uint32_t GetDensity(GraphReader& reader,
                     const PointLL& ll,
                     enhancer_stats& stats,
                     const Tiles<PointLL>& tiles,
-                    uint8_t local_level) {
+                    uint8_t local_level,
+                    std::unordered_map<int32_t, std::unique_ptr<DensityGrid>>& grids) {
   // Radius is in km - turn into meters
   float rm = kDensityRadius * kMetersPerKm;
   float mr2 = rm * rm;
@@ -941,35 +1061,33 @@ uint32_t GetDensity(GraphReader& reader,
                       Point2(ll.lng() + lngdeg, ll.lat() + kDensityLatDeg));
   std::vector<int32_t> tilelist = tiles.TileList(bbox);
 
+  // Cells are picked by a slightly bigger box so no node within the radius is left out of it
+  AABB2<PointLL> cells(Point2(bbox.minx() - lngdeg * 0.01f, bbox.miny() - kDensityLatDeg * 0.01f),
+                       Point2(bbox.maxx() + lngdeg * 0.01f, bbox.maxy() + kDensityLatDeg * 0.01f));
+
   // For all tiles needed to find nodes within the radius...find nodes within
-  // the radius (squared) and add lengths of directed edges
-  float roadlengths = 0.0f;
+  // the radius (squared) and add lengths of directed edges. Lengths are whole
+  // meters so summing them as integers matches summing them one by one.
+  uint64_t roadlengths = 0;
   for (auto t : tilelist) {
-    // Check all the nodes within the tile. Skip if tile has no nodes (can be
-    // an empty tile added for connectivity map logic).
-    lock.lock();
-    const GraphTile* newtile = reader.GetGraphTile(GraphId(t, local_level, 0));
-    lock.unlock();
-    if (!newtile || newtile->header()->nodecount() == 0) {
-      continue;
-    }
-    PointLL base_ll = newtile->header()->base_ll();
-    const auto start_node = newtile->node(0);
-    const auto end_node = start_node + newtile->header()->nodecount();
-    for (auto node = start_node; node < end_node; ++node) {
-      // Check if within radius
-      if (approximator.DistanceSquared(node->latlng(base_ll)) < mr2) {
-        // Get all directed edges and add length
-        const DirectedEdge* directededge = newtile->directededge(node->edge_index());
-        for (uint32_t i = 0; i < node->edge_count(); i++, directededge++) {
-          // Exclude non-roads (parking, walkways, ferries, etc.)
-          if (directededge->use() == Use::kRoad || directededge->use() == Use::kRamp ||
-              directededge->use() == Use::kTurnChannel || directededge->use() == Use::kAlley ||
-              directededge->use() == Use::kEmergencyAccess) {
-            roadlengths += directededge->length();
-          }
-        }
+    auto grid = grids.find(t);
+    if (grid == grids.end()) {
+      // Start over rather than growing without bound, neighbouring tiles come back quickly
+      if (grids.size() >= kMaxDensityGrids) {
+        grids.clear();
       }
+      // Skip if tile has no nodes (can be an empty tile added for connectivity map logic).
+      lock.lock();
+      const GraphTile* newtile = reader.GetGraphTile(GraphId(t, local_level, 0));
+      lock.unlock();
+      std::unique_ptr<DensityGrid> built;
+      if (newtile && newtile->header()->nodecount() > 0) {
+        built.reset(new DensityGrid(newtile, tiles.TileBounds(t)));
+      }
+      grid = grids.emplace(t, std::move(built)).first;
+    }
+    if (grid->second) {
+      roadlengths += grid->second->RoadLength(approximator, cells, mr2);
     }
   }
 
@@ -1391,7 +1509,8 @@ void enhance(const boost::property_tree::ptree& pt,
              const OSMData& osmdata,
              const std::string& access_file,
              const boost::property_tree::ptree& hierarchy_properties,
-             std::queue<GraphId>& tilequeue,
+             StealingTileScheduler<GraphId>& tilequeue,
+             size_t worker,
              std::mutex& lock,
              std::promise<enhancer_stats>& result) {
 
@@ -1432,18 +1551,17 @@ void enhance(const boost::property_tree::ptree& pt,
   enhancer_stats stats{std::numeric_limits<float>::min(), 0};
   const auto& local_level = TileHierarchy::levels().rbegin()->second.level;
   const auto& tiles = TileHierarchy::levels().rbegin()->second.tiles;
+  std::unordered_map<int32_t, std::unique_ptr<DensityGrid>> grids;
 
   // Iterate through the tiles in the queue and perform enhancements
   while (true) {
     // Get the next tile Id from the queue and get writeable and readable
-    // tile. Lock while we access the tile queue and get the tile.
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
+    // tile. Lock while we get the tile.
+    GraphId tile_id;
+    if (!tilequeue.next(worker, tile_id)) {
       break;
     }
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop();
+    lock.lock();
 
     // Get a readable tile.If the tile is empty, skip it. Empty tiles are
     // added where ways go through a tile but no end not is within the tile.
@@ -1551,7 +1669,7 @@ void enhance(const boost::property_tree::ptree& pt,
 
       // Get relative road density and local density
       uint32_t density =
-          GetDensity(reader, lock, nodeinfo.latlng(base_ll), stats, tiles, local_level);
+          GetDensity(reader, lock, nodeinfo.latlng(base_ll), stats, tiles, local_level, grids);
       nodeinfo.set_density(density);
 
       uint32_t admin_index = nodeinfo.admin_index();
@@ -1845,27 +1963,42 @@ void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
   // A place to hold the results of those threads, exceptions or otherwise
   std::list<std::promise<enhancer_stats>> results;
 
-  // Create a randomized queue of tiles to work from
-  std::deque<GraphId> tempqueue;
+  // Create a queue of tiles to work from along a z-order curve, so each thread works its way
+  // through a region and the density grids of the tiles around the one it is on are at hand
   boost::property_tree::ptree hierarchy_properties = pt.get_child("mjolnir");
   auto local_level = TileHierarchy::levels().rbegin()->second.level;
+  const auto& tiles = TileHierarchy::levels().rbegin()->second.tiles;
   GraphReader reader(hierarchy_properties);
   auto local_tiles = reader.GetTileSet(local_level);
-  for (const auto& tile_id : local_tiles) {
-    tempqueue.emplace_back(tile_id);
+  auto z_order = [&tiles](const GraphId& id) {
+    uint64_t row = id.tileid() / tiles.ncolumns(), col = id.tileid() % tiles.ncolumns();
+    uint64_t z = 0;
+    for (uint32_t bit = 0; bit < 32; ++bit) {
+      z |= ((row >> bit) & 1) << (2 * bit + 1) | ((col >> bit) & 1) << (2 * bit);
+    }
+    return z;
+  };
+  std::vector<std::pair<uint64_t, GraphId>> ordered;
+  for (const auto& id : local_tiles) {
+    ordered.emplace_back(z_order(id), id);
+  }
+  std::sort(ordered.begin(), ordered.end());
+  std::vector<GraphId> tile_order;
+  for (const auto& tile : ordered) {
+    tile_order.push_back(tile.second);
   }
-  std::random_shuffle(tempqueue.begin(), tempqueue.end());
-  std::queue<GraphId> tilequeue(tempqueue);
+  StealingTileScheduler<GraphId> tilequeue(std::move(tile_order), threads.size());
 
   // An atomic object we can use to do the synchronization
   std::mutex lock;
 
   // Start the threads
-  for (auto& thread : threads) {
+  for (size_t i = 0; i < threads.size(); ++i) {
     results.emplace_back();
-    thread.reset(new std::thread(enhance, std::cref(hierarchy_properties), std::cref(osmdata),
-                                 std::cref(access_file), std::ref(hierarchy_properties),
-                                 std::ref(tilequeue), std::ref(lock), std::ref(results.back())));
+    threads[i].reset(new std::thread(enhance, std::cref(hierarchy_properties), std::cref(osmdata),
+                                     std::cref(access_file), std::ref(hierarchy_properties),
+                                     std::ref(tilequeue), i, std::ref(lock),
+                                     std::ref(results.back())));
   }
 
   // Wait for them to finish up their work
@@ -1,9 +1,14 @@
 #include "mjolnir/graphfilter.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/util.h"
 
 #include <boost/property_tree/ptree.hpp>
+#include <future>
 #include <iostream>
-#include <unordered_map>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "baldr/graphconstants.h"
@@ -13,6 +18,7 @@
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/encoded.h"
+#include "midgard/flat_hash.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/sequence.h"
@@ -22,28 +28,57 @@ using namespace valhalla::mjolnir;
 
 namespace {
 
-uint32_t n_original_edges = 0;
-uint32_t n_original_nodes = 0;
-uint32_t n_filtered_edges = 0;
-uint32_t n_filtered_nodes = 0;
-uint32_t can_aggregate = 0;
+// Counts of what was filtered, each thread keeps its own and they are added up at the end
+struct filter_stats_t {
+  uint32_t n_original_edges = 0;
+  uint32_t n_original_nodes = 0;
+  uint32_t n_filtered_edges = 0;
+  uint32_t n_filtered_nodes = 0;
+  uint32_t can_aggregate = 0;
+
+  filter_stats_t& operator+=(const filter_stats_t& other) {
+    n_original_edges += other.n_original_edges;
+    n_original_nodes += other.n_original_nodes;
+    n_filtered_edges += other.n_filtered_edges;
+    n_filtered_nodes += other.n_filtered_nodes;
+    can_aggregate += other.can_aggregate;
+    return *this;
+  }
+};
 
 // Group wheelchair and pedestrian access together
 constexpr uint32_t kAllPedestrianAccess = (kPedestrianAccess | kWheelchairAccess);
 
+// Marks a node that was filtered out in the remapping of its tile
+constexpr uint32_t kFilteredNode = std::numeric_limits<uint32_t>::max();
+
+// The new index of each of the original nodes of a tile, indexed by the original node index.
+// Nodes never move to another tile and keep their order so this is all that is needed to map
+// the original node Ids to the new ones, and it takes 4 bytes a node instead of a hash map entry.
+using node_remap_t = valhalla::midgard::flat_hash_map<GraphId, std::vector<uint32_t>>;
+
 /**
- * Filter edges to optionally remove edges by access.
- * @param  reader  Graph reader.
- * @param  old_to_new  Map of original node Ids to new nodes Ids (after filtering).
+ * Filter edges to optionally remove edges by access. Tiles are claimed from the queue until
+ * there are none left so this can run on any number of threads.
+ * @param  pt  Mjolnir configuration.
+ * @param  tilequeue  Queue of the tiles to filter.
+ * @param  lock  Guards the node remapping.
+ * @param  old_to_new  Receives the new node indexes of the nodes of each tile (after filtering).
  * @param  include_driving  Include edge if driving (any vehicular) access in either direction.
  * @param  include_bicycle  Include edge if bicycle access in either direction.
  * @param  include_pedestrian  Include edge if pedestrian or wheelchair access in either direction.
+ * @param  result  Receives the counts of what was filtered by this thread.
  */
-void FilterTiles(GraphReader& reader,
-                 std::unordered_map<GraphId, GraphId>& old_to_new,
+void FilterTiles(const boost::property_tree::ptree& pt,
+                 TileScheduler<GraphId>& tilequeue,
+                 std::mutex& lock,
+                 node_remap_t& old_to_new,
                  const bool include_driving,
                  const bool include_bicycle,
-                 const bool include_pedestrian) {
+                 const bool include_pedestrian,
+                 std::promise<filter_stats_t>& result) {
+  GraphReader reader(pt);
+  filter_stats_t stats;
 
   // lambda to check if an edge should be included
   auto include_edge = [&include_driving, &include_bicycle,
@@ -59,16 +94,16 @@ void FilterTiles(GraphReader& reader,
            (pedestrian_access && include_pedestrian);
   };
 
-  // Iterate through all tiles in the local level
-  auto local_tiles = reader.GetTileSet(TileHierarchy::levels().rbegin()->second.level);
-  for (const auto& tile_id : local_tiles) {
+  GraphId tile_id;
+  while (tilequeue.next(tile_id)) {
     // Create a new tilebuilder - should copy header information
     GraphTileBuilder tilebuilder(reader.tile_dir(), tile_id, false);
-    n_original_nodes += tilebuilder.header()->nodecount();
-    n_original_edges += tilebuilder.header()->directededgecount();
+    stats.n_original_nodes += tilebuilder.header()->nodecount();
+    stats.n_original_edges += tilebuilder.header()->directededgecount();
 
     // Get the graph tile. Read from this tile to create the new tile.
     const GraphTile* tile = reader.GetGraphTile(tile_id);
+    std::vector<uint32_t> new_nodes(tile->header()->nodecount(), kFilteredNode);
 
     std::hash<std::string> hasher;
     GraphId nodeid(tile_id.tileid(), tile_id.level(), 0);
@@ -88,7 +123,7 @@ void FilterTiles(GraphReader& reader,
         // Check if the directed edge should be included
         const DirectedEdge* directededge = tile->directededge(edgeid);
         if (!include_edge(directededge)) {
-          ++n_filtered_edges;
+          ++stats.n_filtered_edges;
           continue;
         }
 
@@ -162,7 +197,7 @@ void FilterTiles(GraphReader& reader,
       // Add the node to the tilebuilder unless no edges remain
       if (edge_count > 0) {
         // Add a node builder to the tile. Update the edge count and edgeindex
-        GraphId new_node(nodeid.tileid(), nodeid.level(), tilebuilder.nodes().size());
+        uint32_t new_node = tilebuilder.nodes().size();
         tilebuilder.nodes().push_back(*nodeinfo);
         NodeInfo& node = tilebuilder.nodes().back();
         node.set_edge_count(edge_count);
@@ -182,18 +217,22 @@ void FilterTiles(GraphReader& reader,
         }
 
         // Associate the old node to the new node.
-        old_to_new[nodeid] = new_node;
+        new_nodes[i] = new_node;
 
         // Check if edges at this node can be aggregated. Only 2 edges, same way Id (so that
         // edge attributes should match), don't end at same node (no loops).
         if (edge_count == 2 && wayid[0] == wayid[1] && endnode[0] != endnode[1]) {
-          ++can_aggregate;
+          ++stats.can_aggregate;
         }
       } else {
-        ++n_filtered_nodes;
+        ++stats.n_filtered_nodes;
       }
     }
 
+    lock.lock();
+    old_to_new.emplace(tile_id, std::move(new_nodes));
+    lock.unlock();
+
     // Store the updated tile data (or remove tile if all edges are filtered)
     if (tilebuilder.nodes().size() > 0) {
       tilebuilder.StoreTileData();
@@ -209,27 +248,23 @@ void FilterTiles(GraphReader& reader,
       reader.Trim();
     }
   }
-  LOG_INFO("Filtered " + std::to_string(n_filtered_nodes) + " nodes out of " +
-           std::to_string(n_original_nodes));
-  LOG_INFO("Filtered " + std::to_string(n_filtered_edges) + " directededges out of " +
-           std::to_string(n_original_edges));
-  LOG_INFO("Can aggregate: " + std::to_string(can_aggregate));
+
+  result.set_value(stats);
 }
 
 /**
- * Update end nodes of all directed edges.
- * @param  reader  Graph reader.
- * @param  old_to_new  Map of original node Ids to new nodes Ids (after filtering).
+ * Update end nodes of all directed edges. The remapping is only read so this can run on any
+ * number of threads once all tiles are filtered.
+ * @param  pt  Mjolnir configuration.
+ * @param  tilequeue  Queue of the tiles to update.
+ * @param  old_to_new  New node indexes of the nodes of each tile (after filtering).
  */
-void UpdateEndNodes(GraphReader& reader, std::unordered_map<GraphId, GraphId>& old_to_new) {
-  LOG_INFO("Update end nodes of directed edges");
-
-  int found = 0;
-  int not_found = 0;
-
-  // Iterate through all tiles in the local level
-  auto local_tiles = reader.GetTileSet(TileHierarchy::levels().rbegin()->second.level);
-  for (const auto& tile_id : local_tiles) {
+void UpdateEndNodes(const boost::property_tree::ptree& pt,
+                    TileScheduler<GraphId>& tilequeue,
+                    const node_remap_t& old_to_new) {
+  GraphReader reader(pt);
+  GraphId tile_id;
+  while (tilequeue.next(tile_id)) {
     // Get the graph tile. Skip if no tile exists or no nodes exist in the tile
     // (should not happen!?)
     const GraphTile* tile = reader.GetGraphTile(tile_id);
@@ -255,12 +290,13 @@ void UpdateEndNodes(GraphReader& reader, std::unordered_map<GraphId, GraphId>& o
 
       // Find the end node in the old_to_new mapping
       GraphId end_node;
-      auto iter = old_to_new.find(edge->endnode());
-      if (iter == old_to_new.end()) {
+      auto iter = old_to_new.find(edge->endnode().Tile_Base());
+      if (iter == old_to_new.end() || edge->endnode().id() >= iter->second.size() ||
+          iter->second[edge->endnode().id()] == kFilteredNode) {
         LOG_ERROR("UpdateEndNodes - failed to find associated node");
       } else {
-        end_node = iter->second;
-        found++;
+        end_node = GraphId(edge->endnode().tileid(), edge->endnode().level(),
+                           iter->second[edge->endnode().id()]);
       }
 
       // Copy the edge to the directededges vector and update the end node
@@ -285,9 +321,6 @@ namespace mjolnir {
 
 // Optionally filter edges and nodes based on access.
 void GraphFilter::Filter(const boost::property_tree::ptree& pt) {
-
-  // TODO: thread this. Could be difficult due to sequence creates to associate nodes
-
   // Edge filtering (optionally exclude edges)
   bool include_driving = pt.get_child("mjolnir").get<bool>("include_driving", true);
   if (!include_driving) {
@@ -307,21 +340,56 @@ void GraphFilter::Filter(const boost::property_tree::ptree& pt) {
     return;
   }
 
-  // Map of old node Ids to new node Ids (after filtering).
-  std::unordered_map<baldr::GraphId, baldr::GraphId> old_to_new;
-
-  // Construct GraphReader
+  // Create queues of the tiles in the local level to work from, biggest first
   GraphReader reader(pt.get_child("mjolnir"));
+  auto local_tiles = reader.GetTileSet(TileHierarchy::levels().rbegin()->second.level);
+  auto costs = TileCosts(reader.tile_dir(), local_tiles);
+  TileScheduler<GraphId> filterqueue(costs);
+  TileScheduler<GraphId> updatequeue(std::move(costs));
+
+  // Setup threads
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+
+  // New node indexes of the original nodes of each tile (after filtering).
+  node_remap_t old_to_new(local_tiles.size());
 
   // Filter edges (and nodes) by access
-  FilterTiles(reader, old_to_new, include_driving, include_bicycle, include_pedestrian);
+  std::mutex lock;
+  std::list<std::promise<filter_stats_t>> results;
+  for (auto& thread : threads) {
+    results.emplace_back();
+    thread.reset(new std::thread(FilterTiles, std::cref(pt.get_child("mjolnir")),
+                                 std::ref(filterqueue), std::ref(lock), std::ref(old_to_new),
+                                 include_driving, include_bicycle, include_pedestrian,
+                                 std::ref(results.back())));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  filter_stats_t stats;
+  for (auto& result : results) {
+    stats += result.get_future().get();
+  }
+  LOG_INFO("Filtered " + std::to_string(stats.n_filtered_nodes) + " nodes out of " +
+           std::to_string(stats.n_original_nodes));
+  LOG_INFO("Filtered " + std::to_string(stats.n_filtered_edges) + " directededges out of " +
+           std::to_string(stats.n_original_edges));
+  LOG_INFO("Can aggregate: " + std::to_string(stats.can_aggregate));
 
   // TODO - aggregate / combine edges across false nodes (only 2 directed edges)
   // where way Ids are equal
 
-  // Update end nodes. Clear the GraphReader cache first.
-  reader.Clear();
-  UpdateEndNodes(reader, old_to_new);
+  // Update end nodes, now that every tile has been filtered
+  LOG_INFO("Update end nodes of directed edges");
+  for (auto& thread : threads) {
+    thread.reset(new std::thread(UpdateEndNodes, std::cref(pt.get_child("mjolnir")),
+                                 std::ref(updatequeue), std::cref(old_to_new)));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
 
   LOG_INFO("Done GraphFilter");
 }
@@ -1,5 +1,6 @@
 #include "mjolnir/graphtilebuilder.h"
 
+#include "baldr/compression_utils.h"
 #include "baldr/datetime.h"
 #include "baldr/edgeinfo.h"
 #include "baldr/tilehierarchy.h"
@@ -14,6 +15,63 @@
 
 using namespace valhalla::baldr;
 
+namespace {
+
+// Whether an edge can be part of a shortcut, the shortcut builder only contracts edges alike.
+// The speed is left out since the enhancer changes it
+bool Alike(const DirectedEdge& edge, const DirectedEdge* shortcut) {
+  return !edge.is_shortcut() && edge.forwardaccess() == shortcut->forwardaccess() &&
+         edge.sign() == shortcut->sign() && edge.use() == shortcut->use() &&
+         edge.classification() == shortcut->classification() &&
+         edge.roundabout() == shortcut->roundabout() && edge.link() == shortcut->link() &&
+         edge.toll() == shortcut->toll() && edge.destonly() == shortcut->destonly() &&
+         edge.unpaved() == shortcut->unpaved() && edge.surface() == shortcut->surface();
+}
+
+// Adds the edge and the edges alike after it until the end node of the shortcut is reached with
+// its length. Backs out and returns false if there is no such path from the edge
+bool Expand(GraphReader& reader,
+            const DirectedEdge* shortcut,
+            const GraphId& from_node,
+            const GraphId& edge_id,
+            uint32_t length,
+            std::vector<GraphId>& edges) {
+  const GraphTile* tile = reader.GetGraphTile(edge_id);
+  if (tile == nullptr) {
+    return false;
+  }
+  const DirectedEdge* edge = tile->directededge(edge_id);
+  length += edge->length();
+  if (length > shortcut->length()) {
+    return false;
+  }
+  edges.push_back(edge_id);
+  if (edge->endnode() == shortcut->endnode()) {
+    if (length == shortcut->length()) {
+      return true;
+    }
+    edges.pop_back();
+    return false;
+  }
+
+  // go on through the end node without turning back
+  const NodeInfo* node = reader.GetEndNode(edge, tile);
+  if (node != nullptr) {
+    GraphId next(edge->endnode().tileid(), edge->endnode().level(), node->edge_index());
+    for (const auto& candidate : tile->GetDirectedEdges(node)) {
+      if (candidate.endnode() != from_node && Alike(candidate, shortcut) &&
+          Expand(reader, shortcut, edge->endnode(), next, length, edges)) {
+        return true;
+      }
+      ++next;
+    }
+  }
+  edges.pop_back();
+  return false;
+}
+
+} // namespace
+
 namespace valhalla {
 namespace mjolnir {
 
@@ -28,9 +86,11 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
                                    bool serialize_turn_lanes)
     : tile_dir_(tile_dir), GraphTile(tile_dir, graphid) {
 
-  // Copy tile header to a builder (if tile exists). Always set the tileid
+  // Copy tile header to a builder (if tile exists). Always set the tileid. The tile is always
+  // stored with its sections as they are
   if (header_) {
     header_builder_ = *header_;
+    header_builder_.set_cold_size(0);
   }
   header_builder_.set_graphid(graphid);
 
@@ -46,6 +106,9 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
     return;
   }
 
+  // Everything below reads the edge info and text list
+  InflateColdSections();
+
   // Street name info. Unique set of offsets into the text list
   std::set<NameInfo> name_info;
   name_info.insert({0});
@@ -157,6 +220,7 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
       eib.AddNameInfo(info);
     }
     eib.set_encoded_shape(ei.encoded_shape());
+    eib.set_encoded_elevation_profile(ei.encoded_elevation_profile());
     edge_info_offset_ += eib.SizeOf();
     edgeinfo_list_.emplace_back(std::move(eib));
 
@@ -192,8 +256,13 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
 
 // Output the tile to file. Stores as binary data.
 void GraphTileBuilder::StoreTileData() {
+  StoreTileData(tile_dir_);
+}
+
+// Output the tile to a file in the given tile directory.
+void GraphTileBuilder::StoreTileData(const std::string& tile_dir) {
   // Get the name of the file
-  boost::filesystem::path filename(tile_dir_ + filesystem::path::preferred_separator +
+  boost::filesystem::path filename(tile_dir + filesystem::path::preferred_separator +
                                    GraphTile::FileSuffix(header_builder_.graphid()));
 
   // Make sure the directory exists on the system
@@ -201,6 +270,11 @@ void GraphTileBuilder::StoreTileData() {
     boost::filesystem::create_directories(filename.parent_path());
   }
 
+  // Edge infos that changed size move the ones after them
+  if (edgeinfo_resized_) {
+    UpdateEdgeInfoOffsets();
+  }
+
   // Open file and truncate
   std::stringstream in_mem;
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
@@ -335,9 +409,11 @@ void GraphTileBuilder::StoreTileData() {
     in_mem.write(reinterpret_cast<const char*>(lane_connectivity_builder_.data()),
                  lane_connectivity_builder_.size() * sizeof(LaneConnectivity));
 
-    // Set the end offset
+    // Set the end offset. The bin bounds are not written, the bins may have changed
     header_builder_.set_end_offset(header_builder_.lane_connectivity_offset() +
                                    (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)));
+    header_builder_.set_bin_bounds_offset(0);
+    header_builder_.set_shortcut_expansions_offset(0);
 
     // Sanity check for the end offset
     uint32_t curr =
@@ -691,6 +767,41 @@ void GraphTileBuilder::set_mean_elevation(const uint32_t offset, const float ele
   e->second->set_mean_elevation(elev);
 }
 
+// Set the elevation profile to the EdgeInfo given the edge info offset. This requires
+// a serialized tile builder.
+void GraphTileBuilder::set_elevation_profile(const uint32_t offset,
+                                             const std::vector<double>& elevations) {
+  auto e = edgeinfo_offset_map_.find(offset);
+  if (e == edgeinfo_offset_map_.end()) {
+    LOG_ERROR("set_elevation_profile - could not find the EdgeInfo index given the offset");
+    return;
+  }
+  e->second->set_elevation_profile(elevations);
+  edgeinfo_resized_ = true;
+}
+
+// Lay the edge infos out again and point the directed edges at their new offsets
+void GraphTileBuilder::UpdateEdgeInfoOffsets() {
+  std::unordered_map<const EdgeInfoBuilder*, uint32_t> new_offsets;
+  edge_info_offset_ = 0;
+  for (const auto& edgeinfo : edgeinfo_list_) {
+    new_offsets.emplace(&edgeinfo, edge_info_offset_);
+    edge_info_offset_ += edgeinfo.SizeOf();
+  }
+  for (auto& directededge : directededges_builder_) {
+    auto e = edgeinfo_offset_map_.find(directededge.edgeinfo_offset());
+    if (e != edgeinfo_offset_map_.end()) {
+      directededge.set_edgeinfo_offset(new_offsets[e->second]);
+    }
+  }
+  std::unordered_map<uint32_t, EdgeInfoBuilder*> offset_map;
+  for (const auto& e : edgeinfo_offset_map_) {
+    offset_map.emplace(new_offsets[e.second], e.second);
+  }
+  edgeinfo_offset_map_.swap(offset_map);
+  edgeinfo_resized_ = false;
+}
+
 // Add a name to the text list
 uint32_t GraphTileBuilder::AddName(const std::string& name) {
   if (name.empty()) {
@@ -896,7 +1007,7 @@ std::array<std::vector<GraphId>, kBinCount> GraphTileBuilder::BinEdges(const Gra
     }
 
     // for each bin that got intersected
-    auto intersection = tiles.Intersect(shape);
+    auto intersection = tiles.IntersectBins(shape);
     GraphId edge_id(tile->header()->graphid().tileid(), tile->header()->graphid().level(),
                     edge - start_edge);
     for (const auto& i : intersection) {
@@ -910,8 +1021,10 @@ std::array<std::vector<GraphId>, kBinCount> GraphTileBuilder::BinEdges(const Gra
                              ? bins
                              : tweeners.insert({GraphId(i.first, max_level, 0), {}}).first->second;
         // keep the edge id
-        for (auto bin : i.second) {
-          out_bins[bin].push_back(edge_id);
+        for (size_t bin = 0; bin < kBinCount; ++bin) {
+          if (i.second & (uint64_t(1) << bin)) {
+            out_bins[bin].push_back(edge_id);
+          }
         }
       }
     }
@@ -934,6 +1047,15 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
     shift += more_bins[i].size();
   }
   shift *= sizeof(GraphId);
+  // the bounds of the old bins are dropped, they are the last thing in the tile unless
+  // predicted speeds were added after them
+  uint32_t tile_end = tile->header()->end_offset();
+  uint32_t bounds_offset = tile->header()->bin_bounds_offset();
+  if (bounds_offset > 0 &&
+      bounds_offset + tile->header()->bin_offset(kBinCount - 1).second * sizeof(BinBounds) ==
+          tile_end) {
+    tile_end = bounds_offset;
+  }
   // update header bin indices
   uint32_t offsets[kBinCount] = {static_cast<uint32_t>(bins[0].size())};
   for (size_t i = 1; i < kBinCount; ++i) {
@@ -948,7 +1070,12 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   header.set_edgeinfo_offset(header.edgeinfo_offset() + shift);
   header.set_textlist_offset(header.textlist_offset() + shift);
   header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
-  header.set_end_offset(header.end_offset() + shift);
+  header.set_end_offset(tile_end + shift);
+  header.set_bin_bounds_offset(0);
+  // the shortcut expansions do not depend on the bins so they are only moved
+  if (header.shortcut_expansions_offset() > 0) {
+    header.set_shortcut_expansions_offset(header.shortcut_expansions_offset() + shift);
+  }
   // rewrite the tile
   boost::filesystem::path filename =
       tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(header.graphid());
@@ -970,7 +1097,7 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
     }
     // the rest of the stuff after bins
     begin = reinterpret_cast<const char*>(tile->GetBin(kBinsDim - 1, kBinsDim - 1).end());
-    end = reinterpret_cast<const char*>(tile->header()) + tile->header()->end_offset();
+    end = reinterpret_cast<const char*>(tile->header()) + tile_end;
     file.write(begin, end - begin);
   } // failed
   else {
@@ -978,6 +1105,229 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   }
 }
 
+// Get the bounding box of the shape of every edge in the bins of the tile
+std::vector<BinBounds> GraphTileBuilder::BoundBins(const GraphTile* tile, GraphReader& reader) {
+  std::vector<BinBounds> bounds;
+  bounds.reserve(tile->header()->bin_offset(kBinCount - 1).second);
+  for (size_t b = 0; b < kBinCount; ++b) {
+    auto corner = tile->GetBinCorner(b);
+    for (const auto& edge_id : tile->GetBin(b)) {
+      // the box of the whole shape, the search projects onto all of it. edges without shape
+      // stay unbounded so the search looks at them
+      midgard::AABB2<midgard::PointLL> box(180.f, 90.f, -180.f, -90.f);
+      const GraphTile* edge_tile = reader.GetGraphTile(edge_id);
+      if (edge_tile) {
+        const auto* edge = edge_tile->directededge(edge_id);
+        for (const auto& point : edge_tile->edgeinfo(edge->edgeinfo_offset()).lazy_shape()) {
+          box.Expand(point);
+        }
+      }
+      bounds.emplace_back(box, corner);
+    }
+  }
+  return bounds;
+}
+
+// Rewrite the tile with the bounds of the edges in its bins at the end
+void GraphTileBuilder::AddBinBounds(const std::string& tile_dir,
+                                    const GraphTile* tile,
+                                    const std::vector<BinBounds>& bounds) {
+  const GraphTileHeader* header = tile->header();
+  if (bounds.size() != header->bin_offset(kBinCount - 1).second) {
+    throw std::runtime_error("GraphTileBuilder::AddBinBounds - bounds do not match the bins");
+  }
+  // bounds from before are replaced if they are at the end, otherwise they are left unused
+  uint32_t end = header->end_offset();
+  if (header->bin_bounds_offset() > 0 &&
+      header->bin_bounds_offset() + bounds.size() * sizeof(BinBounds) == end) {
+    end = header->bin_bounds_offset();
+  }
+  GraphTileHeader bounded = *header;
+  bounded.set_bin_bounds_offset(end);
+  bounded.set_end_offset(end + bounds.size() * sizeof(BinBounds));
+
+  // rewrite the tile into a temporary file first so readers never see a partial tile
+  boost::filesystem::path filename =
+      tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(header->graphid());
+  if (!boost::filesystem::exists(filename.parent_path())) {
+    boost::filesystem::create_directories(filename.parent_path());
+  }
+  boost::filesystem::path temp = filename.string() + ".bounds";
+  {
+    std::ofstream file(temp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file " + temp.string());
+    }
+    const auto* data = reinterpret_cast<const char*>(header);
+    file.write(reinterpret_cast<const char*>(&bounded), sizeof(GraphTileHeader));
+    file.write(data + sizeof(GraphTileHeader), end - sizeof(GraphTileHeader));
+    file.write(reinterpret_cast<const char*>(bounds.data()), bounds.size() * sizeof(BinBounds));
+  }
+  boost::filesystem::rename(temp, filename);
+}
+
+// Find the edges superseded by every shortcut in the tile
+std::map<uint32_t, std::vector<GraphId>> GraphTileBuilder::ExpandShortcuts(const GraphTile* tile,
+                                                                           GraphReader& reader) {
+  std::map<uint32_t, std::vector<GraphId>> expansions;
+  GraphId node_id = tile->header()->graphid();
+  for (uint32_t n = 0; n < tile->header()->nodecount(); ++n, ++node_id) {
+    const NodeInfo* node = tile->node(n);
+    auto edges = tile->GetDirectedEdges(node);
+    for (const auto& shortcut : edges) {
+      if (!shortcut.is_shortcut()) {
+        continue;
+      }
+      // the edge the shortcut supersedes is marked unless the node has too many shortcuts, then
+      // any edge alike may be it
+      std::vector<GraphId> path;
+      for (bool marked : {true, false}) {
+        GraphId edge_id(node_id.tileid(), node_id.level(), node->edge_index());
+        for (const auto& edge : edges) {
+          if ((marked ? (shortcut.shortcut() & edge.superseded()) != 0 : edge.superseded() == 0) &&
+              Alike(edge, &shortcut) && Expand(reader, &shortcut, node_id, edge_id, 0, path)) {
+            break;
+          }
+          ++edge_id;
+        }
+        if (!path.empty()) {
+          break;
+        }
+      }
+      if (path.empty()) {
+        LOG_WARN("Unable to expand shortcut " + std::to_string(&shortcut - tile->directededge(0)) +
+                 " of tile " + std::to_string(node_id.Tile_Base()));
+        continue;
+      }
+      expansions.emplace(&shortcut - tile->directededge(0), std::move(path));
+    }
+  }
+  return expansions;
+}
+
+// Rewrite the tile with the edges its shortcuts supersede at the end
+void GraphTileBuilder::AddShortcutExpansions(
+    const std::string& tile_dir,
+    const GraphTile* tile,
+    const std::map<uint32_t, std::vector<GraphId>>& expansions) {
+  // lay the section out, the counts and the shortcuts ending with one past the last
+  std::vector<ShortcutExpansion> index;
+  std::vector<GraphId> edges;
+  for (const auto& expansion : expansions) {
+    index.push_back({expansion.first, static_cast<uint32_t>(edges.size())});
+    edges.insert(edges.end(), expansion.second.begin(), expansion.second.end());
+  }
+  index.push_back({kMaxGraphId, static_cast<uint32_t>(edges.size())});
+  uint32_t counts[2] = {static_cast<uint32_t>(expansions.size()),
+                        static_cast<uint32_t>(edges.size())};
+  uint32_t size =
+      sizeof(counts) + index.size() * sizeof(ShortcutExpansion) + edges.size() * sizeof(GraphId);
+
+  // expansions from before are replaced if they are at the end, otherwise they are left unused
+  const GraphTileHeader* header = tile->header();
+  uint32_t end = header->end_offset();
+  uint32_t offset = header->shortcut_expansions_offset();
+  if (offset > 0) {
+    const auto* old_counts = reinterpret_cast<const uint32_t*>(
+        reinterpret_cast<const char*>(header) + offset);
+    if (offset + sizeof(counts) + (old_counts[0] + 1) * sizeof(ShortcutExpansion) +
+            old_counts[1] * sizeof(GraphId) ==
+        end) {
+      end = offset;
+    }
+  }
+  GraphTileHeader expanded = *header;
+  expanded.set_shortcut_expansions_offset(end);
+  expanded.set_end_offset(end + size);
+
+  // rewrite the tile into a temporary file first so readers never see a partial tile
+  boost::filesystem::path filename =
+      tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(header->graphid());
+  if (!boost::filesystem::exists(filename.parent_path())) {
+    boost::filesystem::create_directories(filename.parent_path());
+  }
+  boost::filesystem::path temp = filename.string() + ".shortcuts";
+  {
+    std::ofstream file(temp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file " + temp.string());
+    }
+    const auto* data = reinterpret_cast<const char*>(header);
+    file.write(reinterpret_cast<const char*>(&expanded), sizeof(GraphTileHeader));
+    file.write(data + sizeof(GraphTileHeader), end - sizeof(GraphTileHeader));
+    file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+    file.write(reinterpret_cast<const char*>(index.data()),
+               index.size() * sizeof(ShortcutExpansion));
+    file.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(GraphId));
+  }
+  boost::filesystem::rename(temp, filename);
+}
+
+// Rewrite the tile with the edge info, text list and lane connectivity deflated
+bool GraphTileBuilder::CompressColdSections(const std::string& tile_dir, const GraphTile* tile) {
+  const GraphTileHeader* header = tile->header();
+  if (header->cold_size() > 0) {
+    return false;
+  }
+  const auto* data = reinterpret_cast<const char*>(header);
+  uint32_t begin = header->edgeinfo_offset();
+  uint32_t end =
+      header->predictedspeeds_count() > 0 ? header->predictedspeeds_offset() : header->end_offset();
+  if (header->bin_bounds_offset() > 0 && header->bin_bounds_offset() < end) {
+    end = header->bin_bounds_offset();
+  }
+  if (header->shortcut_expansions_offset() > 0 && header->shortcut_expansions_offset() < end) {
+    end = header->shortcut_expansions_offset();
+  }
+  if (end <= begin) {
+    return false;
+  }
+
+  // deflate the sections with a zlib wrapper
+  std::string deflated;
+  if (!baldr::deflate(data + begin, end - begin, deflated, Z_BEST_COMPRESSION, false)) {
+    throw std::runtime_error("Failed to deflate tile " + GraphTile::FileSuffix(header->graphid()));
+  }
+
+  // pad the block so the sections after it stay aligned the way they were
+  size_t padding = (8 + (end % 8) - (begin + deflated.size()) % 8) % 8;
+  deflated.resize(deflated.size() + padding, 0);
+  if (deflated.size() >= end - begin) {
+    return false;
+  }
+  uint32_t shift = end - begin - deflated.size();
+
+  // update header offsets, the ones inside the block stay where they are once inflated
+  GraphTileHeader compressed = *header;
+  compressed.set_cold_size(end - begin);
+  if (header->predictedspeeds_count() > 0) {
+    compressed.set_predictedspeeds_offset(header->predictedspeeds_offset() - shift);
+  }
+  if (header->bin_bounds_offset() > 0) {
+    compressed.set_bin_bounds_offset(header->bin_bounds_offset() - shift);
+  }
+  if (header->shortcut_expansions_offset() > 0) {
+    compressed.set_shortcut_expansions_offset(header->shortcut_expansions_offset() - shift);
+  }
+  compressed.set_end_offset(header->end_offset() - shift);
+
+  // rewrite the tile
+  boost::filesystem::path filename =
+      tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(header->graphid());
+  if (!boost::filesystem::exists(filename.parent_path())) {
+    boost::filesystem::create_directories(filename.parent_path());
+  }
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file " + filename.string());
+  }
+  file.write(reinterpret_cast<const char*>(&compressed), sizeof(GraphTileHeader));
+  file.write(data + sizeof(GraphTileHeader), begin - sizeof(GraphTileHeader));
+  file.write(deflated.data(), deflated.size());
+  file.write(data + end, header->end_offset() - end);
+  return true;
+}
+
 // Add a predicted speed profile for a directed edge.
 void GraphTileBuilder::AddPredictedSpeed(const uint32_t idx,
                                          const std::vector<int16_t>& profile,
@@ -5,18 +5,19 @@
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/format.hpp>
+#include <algorithm>
 #include <future>
 #include <iostream>
 #include <list>
 #include <mutex>
 #include <numeric>
 #include <ostream>
-#include <queue>
 #include <set>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -246,11 +247,87 @@ uint32_t GetOpposingEdgeIndex(const GraphId& startnode,
   return opp_index;
 }
 
+// What validating an edge that ends in another tile needs from that tile. These are found before
+// any tile is rewritten so that the tiles can then be validated without reading their neighbors
+struct leaving_edge_t {
+  uint32_t opp_index;
+  bool deadend;
+  bool internal;
+  bool ctry_crossing;
+};
+// The edges leaving each tile, in the order of the directed edges of the tile
+using leaving_edges_t = std::unordered_map<GraphId, std::vector<leaving_edge_t>>;
+
+// Find the opposing edges of the edges that end in another tile. No tiles are written while this
+// runs so each thread can read whatever tiles it needs without locking
+void find_leaving_edges(const boost::property_tree::ptree& pt,
+                        TileScheduler<GraphId>& tilequeue,
+                        std::mutex& lock,
+                        leaving_edges_t& leaving_edges,
+                        std::promise<std::vector<uint32_t>>& result) {
+  // Local Graphreader
+  GraphReader graph_reader(pt.get_child("mjolnir"));
+  auto numLevels = TileHierarchy::levels().size() + 1; // To account for transit
+  auto transit_level = TileHierarchy::levels().rbegin()->second.level + 1;
+
+  // Array to hold duplicates
+  std::vector<uint32_t> duplicates(numLevels, 0);
+
+  // Vector to hold problem ways
+  std::set<uint32_t> problem_ways;
+
+  GraphId tile_id;
+  while (tilequeue.next(tile_id)) {
+    const GraphTile* tile = graph_reader.GetGraphTile(tile_id);
+    std::vector<leaving_edge_t> leaving;
+    uint32_t dupcount = 0;
+    GraphId node = tile_id;
+    for (uint32_t i = 0; i < tile->header()->nodecount(); i++, ++node) {
+      const NodeInfo* nodeinfo = tile->node(i);
+      const DirectedEdge* de = tile->directededge(nodeinfo->edge_index());
+      std::string begin_node_iso;
+      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, de++) {
+        if (tile_id == de->endnode().Tile_Base()) {
+          continue;
+        }
+        if (begin_node_iso.empty()) {
+          begin_node_iso = tile->admin(nodeinfo->admin_index())->country_iso();
+        }
+
+        // Finding the opposing edge sets flags on the edge so work on a copy of it
+        DirectedEdge edge = *de;
+        std::string end_node_iso;
+        uint32_t wayid = tile->edgeinfo(edge.edgeinfo_offset()).wayid();
+        const GraphTile* endnode_tile = graph_reader.GetGraphTile(edge.endnode());
+        uint32_t opp_index = GetOpposingEdgeIndex(node, edge, wayid, tile, endnode_tile,
+                                                  problem_ways, dupcount, end_node_iso,
+                                                  transit_level);
+        bool ctry_crossing =
+            !begin_node_iso.empty() && !end_node_iso.empty() && begin_node_iso != end_node_iso;
+        leaving.push_back({opp_index, edge.deadend(), edge.internal(), ctry_crossing});
+      }
+    }
+    duplicates[tile_id.level()] += dupcount;
+
+    lock.lock();
+    leaving_edges.emplace(tile_id, std::move(leaving));
+    lock.unlock();
+
+    // Check if we need to clear the tile cache
+    if (graph_reader.OverCommitted()) {
+      graph_reader.Trim();
+    }
+  }
+
+  // Fill promise with return data
+  result.set_value(std::move(duplicates));
+}
+
 using tweeners_t = GraphTileBuilder::tweeners_t;
 void validate(
     const boost::property_tree::ptree& pt,
-    std::deque<GraphId>& tilequeue,
-    std::mutex& lock,
+    TileScheduler<GraphId>& tilequeue,
+    const leaving_edges_t& leaving_edges,
     std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>&
         result) {
   // Our local copy of edges binned to tiles that they pass through (dont start or end in)
@@ -272,15 +349,11 @@ void validate(
 
   // Check for more tiles
   while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
+    // Get the next tile Id
+    GraphId tile_id;
+    if (!tilequeue.next(tile_id)) {
       break;
     }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
 
     // Point tiles to the set we need for current level
     auto level = tile_id.level();
@@ -299,10 +372,11 @@ void validate(
     std::vector<NodeInfo> nodes;
     std::vector<DirectedEdge> directededges;
 
-    // Get this tile
-    lock.lock();
+    // Get this tile and what we found out about the edges leaving it. Only this thread reads or
+    // writes this tile from here on so there is nothing to lock
     const GraphTile* tile = graph_reader.GetGraphTile(tile_id);
-    lock.unlock();
+    const auto& leaving = leaving_edges.at(tile_id);
+    size_t leaving_index = 0;
 
     // Iterate through the nodes and the directed edges
     uint32_t dupcount = 0;
@@ -375,28 +449,31 @@ void validate(
           valid_length = true;
         }
 
-        // Check if end node is in a different tile
-        const GraphTile* endnode_tile = tile;
+        // Set the opposing edge index and get the country ISO at the end
+        // node. Set the deadend flag and internal flag (if the opposing
+        // edge is internal then make sure this edge is as well)
+        uint32_t opp_index;
+        bool ctry_crossing;
         if (tile_id != directededge.endnode().Tile_Base()) {
           directededge.set_leaves_tile(true);
 
-          // Get the end node tile
-          lock.lock();
-          endnode_tile = graph_reader.GetGraphTile(directededge.endnode());
-          lock.unlock();
-          // make sure this is set to false as access tag logic could of set this to true.
+          // The end node tile was already looked at before any tiles were rewritten
+          const auto& leaving_edge = leaving[leaving_index++];
+          opp_index = leaving_edge.opp_index;
+          directededge.set_deadend(leaving_edge.deadend);
+          directededge.set_internal(leaving_edge.internal);
+          ctry_crossing = leaving_edge.ctry_crossing;
         } else {
+          // make sure this is set to false as access tag logic could of set this to true.
           directededge.set_leaves_tile(false);
-        }
 
-        // Set the opposing edge index and get the country ISO at the end
-        // node. Set the deadend flag and internal flag (if the opposing
-        // edge is internal then make sure this edge is as well)
-        std::string end_node_iso;
-        uint32_t wayid = tile->edgeinfo(directededge.edgeinfo_offset()).wayid();
-        uint32_t opp_index =
-            GetOpposingEdgeIndex(node, directededge, wayid, tile, endnode_tile, problem_ways,
-                                 dupcount, end_node_iso, transit_level);
+          std::string end_node_iso;
+          uint32_t wayid = tile->edgeinfo(directededge.edgeinfo_offset()).wayid();
+          opp_index = GetOpposingEdgeIndex(node, directededge, wayid, tile, tile, problem_ways,
+                                           dupcount, end_node_iso, transit_level);
+          ctry_crossing =
+              !begin_node_iso.empty() && !end_node_iso.empty() && begin_node_iso != end_node_iso;
+        }
         directededge.set_opp_index(opp_index);
         if (directededge.use() == Use::kTransitConnection ||
             directededge.use() == Use::kEgressConnection ||
@@ -405,7 +482,7 @@ void validate(
         }
 
         // Mark a country crossing if country ISO codes do not match
-        if (!begin_node_iso.empty() && !end_node_iso.empty() && begin_node_iso != end_node_iso) {
+        if (ctry_crossing) {
           directededge.set_ctry_crossing(true);
         }
 
@@ -464,7 +541,6 @@ void validate(
     auto bins = GraphTileBuilder::BinEdges(tile, tweeners);
 
     // Write the new tile
-    lock.lock();
     tilebuilder.Update(nodes, directededges);
 
     // Write the bins to it
@@ -477,7 +553,6 @@ void validate(
     if (graph_reader.OverCommitted()) {
       graph_reader.Trim();
     }
-    lock.unlock();
 
     // Add possible duplicates to return class
     duplicates[level] += dupcount;
@@ -550,29 +625,46 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
   auto hierarchy_properties = pt.get_child("mjolnir");
   std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
 
-  // Create a randomized queue of tiles (at all levels) to work from
-  std::deque<GraphId> tilequeue;
+  // Create a queue of tiles (at all levels) to work from, biggest first
   GraphReader reader(pt.get_child("mjolnir"));
   auto tileset = reader.GetTileSet();
-  for (const auto& id : tileset) {
-    tilequeue.emplace_back(id);
-  }
-  std::random_shuffle(tilequeue.begin(), tilequeue.end());
+  auto costs = TileCosts(tile_dir, tileset);
+  TileScheduler<GraphId> leavingqueue(costs);
+  TileScheduler<GraphId> tilequeue(std::move(costs));
 
   // Remember what the dataset id is in case we have to make some tiles
-  auto dataset_id = GraphTile(tile_dir, *tilequeue.begin()).header()->dataset_id();
+  auto dataset_id = GraphTile(tile_dir, *tileset.begin()).header()->dataset_id();
 
   // An mutex we can use to do the synchronization
   std::mutex lock;
 
   // Setup threads
-  /*
   std::vector<std::shared_ptr<std::thread>> threads(
       std::max(static_cast<unsigned int>(1),
                pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency())));
-  */
- std::vector<std::shared_ptr<std::thread>> threads(6);
-  
+
+  // Find the opposing edges of the edges that leave their tile while all tiles can still be read
+  std::vector<uint32_t> duplicates(TileHierarchy::levels().size(), 0);
+  leaving_edges_t leaving_edges(tileset.size());
+  {
+    std::list<std::promise<std::vector<uint32_t>>> leaving_results;
+    for (auto& thread : threads) {
+      leaving_results.emplace_back();
+      thread.reset(new std::thread(find_leaving_edges, std::cref(pt), std::ref(leavingqueue),
+                                   std::ref(lock), std::ref(leaving_edges),
+                                   std::ref(leaving_results.back())));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    for (auto& result : leaving_results) {
+      auto data = result.get_future().get();
+      for (uint8_t i = 0; i < TileHierarchy::levels().size(); ++i) {
+        duplicates[i] += data[i];
+      }
+    }
+  }
+
   // Setup promises
   std::list<
       std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>>
@@ -581,8 +673,8 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
   // Spawn the threads
   for (auto& thread : threads) {
     results.emplace_back();
-    thread.reset(new std::thread(validate, std::cref(pt), std::ref(tilequeue), std::ref(lock),
-                                 std::ref(results.back())));
+    thread.reset(new std::thread(validate, std::cref(pt), std::ref(tilequeue),
+                                 std::cref(leaving_edges), std::ref(results.back())));
   }
 
   // Wait for threads to finish
@@ -590,7 +682,6 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
     thread->join();
   }
   // Get the promise from the future
-  std::vector<uint32_t> duplicates(TileHierarchy::levels().size(), 0);
   std::vector<std::vector<float>> densities(3);
   tweeners_t tweeners;
   for (auto& result : results) {
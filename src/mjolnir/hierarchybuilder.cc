@@ -5,11 +5,18 @@
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <stdexcept>
@@ -20,9 +27,11 @@
 #include "baldr/graphtile.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
+#include "midgard/flat_hash.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/sequence.h"
+#include "mjolnir/util.h"
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -70,23 +79,28 @@ bool AddUpwardTransition(const GraphId& node, GraphTileBuilder* tilebuilder) {
   }
 }
 
-void SortSequences(const std::string& new_to_old_file, const std::string& old_to_new_file) {
+void SortSequences(const std::string& new_to_old_file,
+                   const std::string& old_to_new_file,
+                   const unsigned int thread_count) {
   // Sort the new nodes. Sort so highway level is first
   sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-  new_to_old.sort([](const std::pair<GraphId, GraphId>& a, const std::pair<GraphId, GraphId>& b) {
-    if (a.first.level() == b.first.level()) {
-      if (a.first.tileid() == b.first.tileid()) {
-        return a.first.id() < b.first.id();
-      }
-      return a.first.tileid() < b.first.tileid();
-    }
-    return a.first.level() < b.first.level();
-  });
+  new_to_old.sort(
+      [](const std::pair<GraphId, GraphId>& a, const std::pair<GraphId, GraphId>& b) {
+        if (a.first.level() == b.first.level()) {
+          if (a.first.tileid() == b.first.tileid()) {
+            return a.first.id() < b.first.id();
+          }
+          return a.first.tileid() < b.first.tileid();
+        }
+        return a.first.level() < b.first.level();
+      },
+      1024 * 1024 * 512 / sizeof(std::pair<GraphId, GraphId>), thread_count);
 
   // Sort old to new by node Id
   sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
   old_to_new.sort(
-      [](const OldToNewNodes& a, const OldToNewNodes& b) { return a.node_id < b.node_id; });
+      [](const OldToNewNodes& a, const OldToNewNodes& b) { return a.node_id < b.node_id; },
+      1024 * 1024 * 512 / sizeof(OldToNewNodes), thread_count);
 }
 
 // Convenience method to find the node association.
@@ -133,16 +147,13 @@ bool OpposingEdgeInfoMatches(const GraphTile* tile, const DirectedEdge* edge) {
   return false;
 }
 
-// Form tiles in the new level.
-void FormTilesInNewLevel(GraphReader& reader,
-                         const std::string& new_to_old_file,
-                         const std::string& old_to_new_file) {
-  // Use the sequence that associate new nodes to old nodes
-  sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-
-  // Use the sorted sequence that associates old nodes to new nodes
-  sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
-
+// Form a tile in the new level from the new nodes in [begin, end) of the new to old
+// associations, which all belong to that tile.
+void FormTileInNewLevel(GraphReader& reader,
+                        sequence<std::pair<GraphId, GraphId>>& new_to_old,
+                        sequence<OldToNewNodes>& old_to_new,
+                        const size_t begin,
+                        const size_t end) {
   // lambda to indicate whether a directed edge should be included
   auto include_edge = [&old_to_new](const DirectedEdge* directededge, const GraphId& base_node,
                                     const uint8_t current_level) {
@@ -169,39 +180,22 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
   };
 
-  // Iterate through the new nodes. They have been sorted by level so that
-  // highway level is done first.
-  reader.Clear();
+  // New tilebuilder for the tile
   bool added = false;
-  uint8_t current_level;
-  GraphId tile_id;
   std::hash<std::string> hasher;
-  PointLL base_ll;
-  GraphTileBuilder* tilebuilder = nullptr;
-  for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++) {
-    // Get the node - check if a new tile
+  GraphId tile_id = (*new_to_old[begin]).first.Tile_Base();
+  uint8_t current_level = tile_id.level();
+  std::unique_ptr<GraphTileBuilder> tilebuilder(
+      new GraphTileBuilder(reader.tile_dir(), tile_id, false));
+
+  // Set the base ll for this tile
+  PointLL base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
+  tilebuilder->header_builder().set_base_ll(base_ll);
+
+  // Iterate through the new nodes of the tile
+  for (size_t n = begin; n < end; ++n) {
+    auto new_node = new_to_old[n];
     GraphId nodea = (*new_node).first;
-    if (nodea.Tile_Base() != tile_id) {
-      // Store the prior tile
-      if (tilebuilder != nullptr) {
-        tilebuilder->StoreTileData();
-        delete tilebuilder;
-      }
-
-      // New tilebuilder for the next tile. Update current level.
-      tile_id = nodea.Tile_Base();
-      tilebuilder = new GraphTileBuilder(reader.tile_dir(), tile_id, false);
-      current_level = nodea.level();
-
-      // Set the base ll for this tile
-      base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
-      tilebuilder->header_builder().set_base_ll(base_ll);
-
-      // Check if we need to clear the base/local tile cache
-      if (reader.OverCommitted()) {
-        reader.Trim();
-      }
-    }
 
     // Get the node in the base level
     GraphId base_node = (*new_node).second;
@@ -344,15 +338,15 @@ void FormTilesInNewLevel(GraphReader& reader,
     uint32_t index = tilebuilder->transitions().size();
     auto new_nodes = find_nodes(old_to_new, base_node);
     if (current_level == 0) {
-      AddDownwardTransition(new_nodes.arterial_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddDownwardTransition(new_nodes.arterial_node, tilebuilder.get());
+      AddDownwardTransition(new_nodes.local_node, tilebuilder.get());
     } else if (current_level == 1) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, tilebuilder.get());
+      AddDownwardTransition(new_nodes.local_node, tilebuilder.get());
     }
     if (current_level == 2) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddUpwardTransition(new_nodes.arterial_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, tilebuilder.get());
+      AddUpwardTransition(new_nodes.arterial_node, tilebuilder.get());
     }
 
     // Set the node transition count and index
@@ -376,11 +370,129 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
   }
 
-  // Delete the tile builder
-  if (tilebuilder != nullptr) {
-    tilebuilder->StoreTileData();
-    delete tilebuilder;
+  // Store the tile
+  tilebuilder->StoreTileData();
+
+  // Check if we need to clear the base/local tile cache
+  if (reader.OverCommitted()) {
+    reader.Trim();
+  }
+}
+
+// Thread that forms the new tiles claimed from the queue with its own reader
+void FormTilesInNewLevelThread(const boost::property_tree::ptree& pt,
+                               const std::string& new_to_old_file,
+                               const std::string& old_to_new_file,
+                               TileScheduler<std::pair<size_t, size_t>>& tilequeue,
+                               std::promise<void>& result) {
+  try {
+    GraphReader reader(pt);
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
+    std::pair<size_t, size_t> range;
+    while (tilequeue.next(range)) {
+      FormTileInNewLevel(reader, new_to_old, old_to_new, range.first, range.second);
+    }
+    result.set_value();
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
+
+// Form tiles in the new levels.
+void FormTilesInNewLevel(const boost::property_tree::ptree& pt,
+                         const unsigned int thread_count,
+                         const std::string& new_to_old_file,
+                         const std::string& old_to_new_file) {
+  // The new nodes have been sorted by level and tile, find the range of new nodes of each new
+  // tile and how many there are
+  std::map<uint8_t, std::vector<std::pair<std::pair<size_t, size_t>, size_t>>> level_tiles;
+  {
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    size_t begin = 0, n = 0;
+    GraphId tile_id;
+    for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++, n++) {
+      GraphId new_tile_id = (*new_node).first.Tile_Base();
+      if (n > 0 && new_tile_id != tile_id) {
+        level_tiles[tile_id.level()].emplace_back(std::make_pair(begin, n), n - begin);
+        begin = n;
+      }
+      tile_id = new_tile_id;
+    }
+    if (n > 0) {
+      level_tiles[tile_id.level()].emplace_back(std::make_pair(begin, n), n - begin);
+    }
+  }
+
+  // Do one level at a time starting with the highway level. The tiles of a level only read the
+  // base tiles of their own nodes, but the local level overwrites the base tiles which the
+  // levels above read from all over the place
+  for (auto& level : level_tiles) {
+    TileScheduler<std::pair<size_t, size_t>> tilequeue(std::move(level.second));
+    std::vector<std::shared_ptr<std::thread>> threads(thread_count);
+    std::vector<std::promise<void>> results(thread_count);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      threads[i].reset(new std::thread(FormTilesInNewLevelThread, std::cref(pt),
+                                       std::cref(new_to_old_file), std::cref(old_to_new_file),
+                                       std::ref(tilequeue), std::ref(results[i])));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+
+    // If something bad went down this will rethrow it
+    for (auto& result : results) {
+      result.get_future().get();
+    }
+  }
+}
+
+// Levels a base node exists on and the new tiles it goes in on the highway and arterial levels
+struct NodeLevels {
+  bool levels[3];
+  uint32_t highway_tile;
+  uint32_t arterial_tile;
+  uint32_t density;
+};
+
+// Find the levels each node of a base tile exists on.
+std::vector<NodeLevels> FindNodeLevels(const GraphTile* tile) {
+  // Hierarchy level information
+  auto tile_level = TileHierarchy::levels().rbegin();
+  tile_level++;
+  auto& arterial_level = tile_level->second;
+  tile_level++;
+  auto& highway_level = tile_level->second;
+
+  // Iterate through the nodes. Add nodes to the new level when
+  // best road class <= the new level classification cutoff
+  uint32_t nodecount = tile->header()->nodecount();
+  std::vector<NodeLevels> nodes(nodecount);
+  GraphId edgeid = tile->id();
+  PointLL base_ll = tile->header()->base_ll();
+  const NodeInfo* nodeinfo = tile->node(tile->id());
+  for (uint32_t i = 0; i < nodecount; i++, nodeinfo++) {
+    // Iterate through the edges to see which levels this node exists.
+    bool* levels = nodes[i].levels;
+    levels[0] = levels[1] = levels[2] = false;
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
+      // Update the flag for the level of this edge (skip transit
+      // connection edges)
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      if (directededge->bss_connection()) {
+        // Despite the road class, Bike Share Stations' connections are always at local level
+        levels[2] = true;
+      } else if (directededge->use() != Use::kTransitConnection &&
+                 directededge->use() != Use::kEgressConnection &&
+                 directededge->use() != Use::kPlatformConnection) {
+        levels[TileHierarchy::get_level(directededge->classification())] = true;
+      }
+    }
+    nodes[i].highway_tile = highway_level.tiles.TileId(nodeinfo->latlng(base_ll));
+    nodes[i].arterial_tile = arterial_level.tiles.TileId(nodeinfo->latlng(base_ll));
+    nodes[i].density = nodeinfo->density();
   }
+  return nodes;
 }
 
 /**
@@ -388,13 +500,16 @@ void FormTilesInNewLevel(GraphReader& reader,
  * hierarchy levels and the existing nodes on the base/local level. The
  * associations go both ways: from the "old" nodes on the base/local level
  * to new nodes (using a mapping in memory) and from new nodes to old nodes
- * using a sequence (file).
+ * using a sequence (file). The threads find the levels of the nodes of the
+ * base tiles while the new node Ids are handed out here in base tile order,
+ * so the Ids do not depend on the number of threads.
  */
-void CreateNodeAssociations(GraphReader& reader,
+void CreateNodeAssociations(const boost::property_tree::ptree& pt,
+                            const unsigned int thread_count,
                             const std::string& new_to_old_file,
                             const std::string& old_to_new_file) {
   // Map of tiles vs. count of nodes. Used to construct new node Ids.
-  std::unordered_map<GraphId, uint32_t> new_nodes;
+  flat_hash_map<GraphId, uint32_t> new_nodes;
 
   // lambda to get the next "new" node Id given a tile
   auto get_new_node = [&new_nodes](const GraphId& tile) {
@@ -424,58 +539,89 @@ void CreateNodeAssociations(GraphReader& reader,
   tile_level++;
   auto& highway_level = tile_level->second;
 
-  // Get the set of tiles on the local level
+  // Get the set of tiles on the local level, in a fixed order
+  GraphReader reader(pt);
   auto local_tiles = reader.GetTileSet(base_level.level);
+  std::vector<GraphId> base_tiles(local_tiles.begin(), local_tiles.end());
+  std::sort(base_tiles.begin(), base_tiles.end());
+
+  // The threads work on the tiles a little ahead of the one being associated here, each
+  // finished tile is handed over in its slot. A slot with no vector is not done yet
+  const size_t window = thread_count * 4;
+  std::vector<std::unique_ptr<std::vector<NodeLevels>>> found(base_tiles.size());
+  std::atomic<size_t> next_tile(0);
+  size_t associated = 0;
+  std::exception_ptr error;
+  std::mutex lock;
+  std::condition_variable changed;
+  auto find_levels = [&]() {
+    GraphReader reader(pt);
+    for (size_t t = next_tile++; t < base_tiles.size(); t = next_tile++) {
+      // Dont get too far ahead
+      {
+        std::unique_lock<std::mutex> l(lock);
+        changed.wait(l, [&]() { return t < associated + window || error; });
+        if (error) {
+          return;
+        }
+      }
+      std::unique_ptr<std::vector<NodeLevels>> nodes(new std::vector<NodeLevels>());
+      try {
+        // Skip if no tile exists or no nodes exist in the tile.
+        const GraphTile* tile = reader.GetGraphTile(base_tiles[t]);
+        if (tile != nullptr && tile->header()->nodecount() != 0) {
+          *nodes = FindNodeLevels(tile);
+        }
+        // Check if we need to clear the tile cache
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> l(lock);
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> l(lock);
+        found[t] = std::move(nodes);
+      }
+      changed.notify_all();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    threads.emplace_back(find_levels);
+  }
 
   // Iterate through all tiles in the local level
-  uint32_t ntiles = base_level.tiles.TileCount();
-  uint32_t bl = static_cast<uint32_t>(base_level.level);
   uint32_t al = static_cast<uint32_t>(arterial_level.level);
   uint32_t hl = static_cast<uint32_t>(highway_level.level);
-  for (const auto& base_tile_id : local_tiles) {
-    // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
-    const GraphTile* tile = reader.GetGraphTile(base_tile_id);
-    if (tile == nullptr || tile->header()->nodecount() == 0) {
-      continue;
+  for (size_t t = 0; t < base_tiles.size(); ++t) {
+    // Wait for the tile
+    std::unique_ptr<std::vector<NodeLevels>> nodes;
+    {
+      std::unique_lock<std::mutex> l(lock);
+      changed.wait(l, [&]() { return found[t] || error; });
+      if (error) {
+        break;
+      }
+      nodes = std::move(found[t]);
     }
 
-    // Iterate through the nodes. Add nodes to the new level when
-    // best road class <= the new level classification cutoff
-    bool levels[3];
-    uint32_t nodecount = tile->header()->nodecount();
+    GraphId base_tile_id = base_tiles[t];
     GraphId basenode = base_tile_id;
-    GraphId edgeid = base_tile_id;
-    PointLL base_ll = tile->header()->base_ll();
-    const NodeInfo* nodeinfo = tile->node(basenode);
-    for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
-      // Iterate through the edges to see which levels this node exists.
-      levels[0] = levels[1] = levels[2] = false;
-      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
-        // Update the flag for the level of this edge (skip transit
-        // connection edges)
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        if (directededge->bss_connection()) {
-          // Despite the road class, Bike Share Stations' connections are always at local level
-          levels[2] = true;
-        } else if (directededge->use() != Use::kTransitConnection &&
-                   directededge->use() != Use::kEgressConnection &&
-                   directededge->use() != Use::kPlatformConnection) {
-          levels[TileHierarchy::get_level(directededge->classification())] = true;
-        }
-      }
+    for (const auto& node : *nodes) {
+      const bool* levels = node.levels;
 
       // Associate new nodes to base nodes and base node to new nodes
       GraphId highway_node, arterial_node, local_node;
       if (levels[0]) {
         // New node is on the highway level. Associate back to base/local node
-        GraphId new_tile(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
-        highway_node = get_new_node(new_tile);
+        highway_node = get_new_node(GraphId(node.highway_tile, hl, 0));
         new_to_old.push_back(std::make_pair(highway_node, basenode));
       }
       if (levels[1]) {
         // New node is on the arterial level. Associate back to base/local node
-        GraphId new_tile(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
-        arterial_node = get_new_node(new_tile);
+        arterial_node = get_new_node(GraphId(node.arterial_tile, al, 0));
         new_to_old.push_back(std::make_pair(arterial_node, basenode));
       }
       if (levels[2]) {
@@ -490,14 +636,24 @@ void CreateNodeAssociations(GraphReader& reader,
 
       // Associate the old node to the new node(s). Entries in the tuple
       // that are invalid nodes indicate no node exists in the new level.
-      OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, nodeinfo->density());
+      OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, node.density);
       old_to_new.push_back(assoc);
+      ++basenode;
     }
 
-    // Check if we need to clear the tile cache
-    if (reader.OverCommitted()) {
-      reader.Trim();
+    // Let the threads move on
+    {
+      std::lock_guard<std::mutex> l(lock);
+      associated = t + 1;
     }
+    changed.notify_all();
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
   }
 }
 
@@ -562,7 +718,7 @@ void UpdateTransitConnections(GraphReader& reader, const std::string& old_to_new
 // only exist on arterial and highway levels)
 void RemoveUnusedLocalTiles(const std::string& tile_dir, const std::string& old_to_new_file) {
   // Iterate through the node association sequence
-  std::unordered_map<GraphId, bool> tile_map;
+  flat_hash_map<GraphId, bool> tile_map;
   sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
   for (auto itr = old_to_new.begin(); itr != old_to_new.end(); itr++) {
     auto f = tile_map.find((*itr).node_id.Tile_Base());
@@ -598,22 +754,22 @@ void HierarchyBuilder::Build(const boost::property_tree::ptree& pt,
                              const std::string& new_to_old_file,
                              const std::string& old_to_new_file) {
 
-  // TODO: thread this. Might be more possible now that we don't create
-  // shortcuts in the HierarchyBuilder
-
   // Construct GraphReader
   LOG_INFO("HierarchyBuilder");
   GraphReader reader(pt.get_child("mjolnir"));
+  unsigned int thread_count =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
 
   // Association of old nodes to new nodes
-  CreateNodeAssociations(reader, new_to_old_file, old_to_new_file);
+  CreateNodeAssociations(pt.get_child("mjolnir"), thread_count, new_to_old_file, old_to_new_file);
 
   // Sort the sequences
-  SortSequences(new_to_old_file, old_to_new_file);
+  SortSequences(new_to_old_file, old_to_new_file, thread_count);
 
   // Iterate through the hierarchy (from highway down to local) and build
   // new tiles
-  FormTilesInNewLevel(reader, new_to_old_file, old_to_new_file);
+  FormTilesInNewLevel(pt.get_child("mjolnir"), thread_count, new_to_old_file, old_to_new_file);
 
   // Remove any base tiles that no longer have any data (nodes and edges
   // only exist on arterial and highway levels)
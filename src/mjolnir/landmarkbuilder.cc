@@ -0,0 +1,231 @@
+#include "mjolnir/landmarkbuilder.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Landmarks per access mode and the meters per unit of the lengths, which makes for 16 bit
+// lengths of up to 655km
+constexpr uint32_t kLandmarkCount = 16;
+constexpr float kLandmarkResolution = 10.f;
+
+// The edges out of (or into) each node in compressed rows
+struct adjacency_t {
+  std::vector<uint32_t> offsets;
+  std::vector<std::pair<uint32_t, float>> arcs;
+
+  adjacency_t(const uint32_t node_count, const std::vector<LandmarkEdge>& edges, const bool in)
+      : offsets(node_count + 1, 0), arcs(edges.size()) {
+    for (const auto& edge : edges) {
+      ++offsets[(in ? edge.to : edge.from) + 1];
+    }
+    for (uint32_t i = 0; i < node_count; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+    auto next = offsets;
+    for (const auto& edge : edges) {
+      arcs[next[in ? edge.to : edge.from]++] = {in ? edge.from : edge.to, edge.length};
+    }
+  }
+};
+
+// the lengths of the shortest paths from the source to every node over the adjacency
+void dijkstra(const adjacency_t& adjacency, const uint32_t source, std::vector<float>& lengths) {
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  lengths.assign(adjacency.offsets.size() - 1, std::numeric_limits<float>::infinity());
+  lengths[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > lengths[top.second]) {
+      continue;
+    }
+    for (auto arc = adjacency.offsets[top.second]; arc < adjacency.offsets[top.second + 1]; ++arc) {
+      const auto& next = adjacency.arcs[arc];
+      float length = top.first + next.second;
+      if (length < lengths[next.first]) {
+        lengths[next.first] = length;
+        queue.emplace(length, next.first);
+      }
+    }
+  }
+}
+
+// rounds a length down to the units it is stored in
+uint16_t quantize(const float length, const float resolution) {
+  float units = std::floor(length / resolution);
+  return units < kUnreachedLandmark ? static_cast<uint16_t>(units) : kUnreachedLandmark;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+Landmarks LandmarkBuilder::Compute(const uint32_t node_count,
+                                   const std::vector<LandmarkEdge>& edges,
+                                   const uint32_t count,
+                                   const float resolution) {
+  Landmarks result;
+  result.resolution = resolution;
+  adjacency_t out(node_count, edges, false);
+  adjacency_t in(node_count, edges, true);
+
+  // the first landmark is the node farthest from wherever the graph starts and every next one is
+  // the node farthest from the landmarks picked so far, going there and back
+  auto farthest = [node_count](const std::vector<float>& lengths) {
+    uint32_t best = node_count;
+    for (uint32_t i = 0; i < node_count; ++i) {
+      if (lengths[i] > 0.f && lengths[i] != std::numeric_limits<float>::infinity() &&
+          (best == node_count || lengths[i] > lengths[best])) {
+        best = i;
+      }
+    }
+    return best;
+  };
+  std::vector<float> from, to;
+  std::vector<float> closest(node_count, std::numeric_limits<float>::infinity());
+  std::vector<std::vector<uint16_t>> from_landmark, to_landmark;
+  uint32_t landmark = node_count;
+  for (uint32_t i = 0; i < node_count && landmark == node_count; ++i) {
+    if (out.offsets[i] != out.offsets[i + 1]) {
+      dijkstra(out, i, from);
+      landmark = farthest(from);
+    }
+  }
+  while (landmark != node_count && result.landmarks.size() < count) {
+    result.landmarks.push_back(landmark);
+    dijkstra(out, landmark, from);
+    dijkstra(in, landmark, to);
+    from_landmark.emplace_back(node_count);
+    to_landmark.emplace_back(node_count);
+    for (uint32_t i = 0; i < node_count; ++i) {
+      from_landmark.back()[i] = quantize(from[i], resolution);
+      to_landmark.back()[i] = quantize(to[i], resolution);
+      closest[i] = std::min(closest[i], from[i] + to[i]);
+    }
+    landmark = farthest(closest);
+    LOG_INFO("Landmark " + std::to_string(result.landmarks.size()) + " of " +
+             std::to_string(count) + " is node " + std::to_string(result.landmarks.back()));
+  }
+
+  // lay the lengths out by node so a lookup touches one stretch of memory
+  result.count = result.landmarks.size();
+  result.values.resize(size_t(node_count) * 2 * result.count);
+  auto value = result.values.begin();
+  for (uint32_t i = 0; i < node_count; ++i) {
+    for (const auto& lengths : from_landmark) {
+      *value++ = lengths[i];
+    }
+    for (const auto& lengths : to_landmark) {
+      *value++ = lengths[i];
+    }
+  }
+  return result;
+}
+
+void LandmarkBuilder::Build(const boost::property_tree::ptree& pt) {
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // Number the nodes on all road levels by tile
+  Landmarks layout;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() != transit_level) {
+      layout.tiles.push_back(tile_id.value);
+    }
+  }
+  std::sort(layout.tiles.begin(), layout.tiles.end());
+  layout.offsets.push_back(0);
+  for (auto tile_id : layout.tiles) {
+    const GraphTile* tile = reader.GetGraphTile(GraphId(tile_id));
+    layout.offsets.push_back(layout.offsets.back() + (tile ? tile->header()->nodecount() : 0));
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  const uint32_t node_count = layout.offsets.back();
+  auto index = [&layout, node_count](const GraphId& node) {
+    auto itr = std::lower_bound(layout.tiles.begin(), layout.tiles.end(), node.Tile_Base().value);
+    if (itr == layout.tiles.end() || *itr != node.Tile_Base().value) {
+      return node_count;
+    }
+    auto tile = itr - layout.tiles.begin();
+    auto i = layout.offsets[tile] + node.id();
+    return i < layout.offsets[tile + 1] ? i : node_count;
+  };
+  LOG_INFO("Landmarks over " + std::to_string(node_count) + " nodes");
+
+  for (uint32_t mode = 0; mode < kLandmarkModeCount; ++mode) {
+    // Every edge the mode is allowed on, whatever a costing thinks of it, so the lengths are a
+    // lower bound for all the costings of the mode. Transitions between levels are free
+    std::vector<LandmarkEdge> edges;
+    for (size_t t = 0; t < layout.tiles.size(); ++t) {
+      const GraphTile* tile = reader.GetGraphTile(GraphId(layout.tiles[t]));
+      for (uint32_t from = layout.offsets[t]; from < layout.offsets[t + 1]; ++from) {
+        const NodeInfo* node = tile->node(from - layout.offsets[t]);
+        const DirectedEdge* edge = tile->directededge(node->edge_index());
+        for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge) {
+          if (edge->is_shortcut() || !(edge->forwardaccess() & kLandmarkAccess[mode])) {
+            continue;
+          }
+          auto to = index(edge->endnode());
+          if (to != node_count) {
+            edges.push_back({from, to, static_cast<float>(edge->length())});
+          }
+        }
+        for (const auto& trans : tile->GetNodeTransitions(node)) {
+          auto to = index(trans.endnode());
+          if (to != node_count) {
+            edges.push_back({from, to, 0.f});
+          }
+        }
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+    LOG_INFO("Finding " + std::string(kLandmarkModes[mode]) + " landmarks over " +
+             std::to_string(edges.size()) + " edges");
+
+    // Pick the landmarks and write them next to the tiles with their GraphIds
+    auto landmarks = Compute(node_count, edges, kLandmarkCount, kLandmarkResolution);
+    landmarks.access = kLandmarkAccess[mode];
+    landmarks.tiles = layout.tiles;
+    landmarks.offsets = layout.offsets;
+    for (auto& landmark : landmarks.landmarks) {
+      auto tile = std::upper_bound(layout.offsets.begin(), layout.offsets.end(), landmark) -
+                  layout.offsets.begin() - 1;
+      GraphId tile_id(layout.tiles[tile]);
+      landmark =
+          GraphId(tile_id.tileid(), tile_id.level(), landmark - layout.offsets[tile]).value;
+    }
+    auto file = Landmarks::file_name(reader.tile_dir(), kLandmarkModes[mode]);
+    boost::filesystem::create_directories(boost::filesystem::path(file).parent_path());
+    landmarks.write(file);
+    LOG_INFO("Wrote " + std::to_string(landmarks.count) + " landmarks to " + file);
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,1557 @@
+#include "mjolnir/nativetagtransform.h"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// The tables of lua/graph.lua, keep them in sync with the script
+using StringTable = std::unordered_map<std::string, std::string>;
+using NumberTable = std::unordered_map<std::string, uint32_t>;
+
+const std::string kTrue = "true";
+const std::string kFalse = "false";
+
+// the keys the highway table sets and, in the same order, its values for each kind of highway
+const std::array<const char*, 8> kHighwayModes = {"auto_forward",  "truck_forward",
+                                                  "bus_forward",   "taxi_forward",
+                                                  "moped_forward", "motorcycle_forward",
+                                                  "pedestrian",    "bike_forward"};
+const std::unordered_map<std::string, std::array<bool, 8>> kHighway = {
+    {"motorway", {true, true, true, true, false, true, false, false}},
+    {"motorway_link", {true, true, true, true, false, true, false, false}},
+    {"trunk", {true, true, true, true, true, true, true, true}},
+    {"trunk_link", {true, true, true, true, true, true, true, true}},
+    {"primary", {true, true, true, true, true, true, true, true}},
+    {"primary_link", {true, true, true, true, true, true, true, true}},
+    {"secondary", {true, true, true, true, true, true, true, true}},
+    {"secondary_link", {true, true, true, true, true, true, true, true}},
+    {"residential", {true, true, true, true, true, true, true, true}},
+    {"residential_link", {true, true, true, true, true, true, true, true}},
+    {"service", {true, true, true, true, true, true, true, true}},
+    {"tertiary", {true, true, true, true, true, true, true, true}},
+    {"tertiary_link", {true, true, true, true, true, true, true, true}},
+    {"road", {true, true, true, true, true, true, true, true}},
+    {"track", {true, true, true, true, true, true, true, true}},
+    {"unclassified", {true, true, true, true, true, true, true, true}},
+    {"undefined", {false, false, false, false, false, false, false, false}},
+    {"unknown", {false, false, false, false, false, false, false, false}},
+    {"living_street", {true, true, true, true, true, true, true, true}},
+    {"footway", {false, false, false, false, false, false, true, false}},
+    {"pedestrian", {false, false, false, false, false, false, true, false}},
+    {"steps", {false, false, false, false, false, false, true, true}},
+    {"bridleway", {false, false, false, false, false, false, false, false}},
+    {"construction", {false, false, false, false, false, false, false, false}},
+    {"cycleway", {false, false, false, false, false, false, false, true}},
+    {"path", {false, false, false, false, false, false, true, true}},
+    {"bus_guideway", {false, false, true, false, false, false, false, false}},
+};
+
+const NumberTable kRoadClass = {
+    {"motorway", 0},     {"motorway_link", 0},  {"trunk", 1},          {"trunk_link", 1},
+    {"primary", 2},      {"primary_link", 2},   {"secondary", 3},      {"secondary_link", 3},
+    {"tertiary", 4},     {"tertiary_link", 4},  {"unclassified", 5},   {"residential", 6},
+    {"residential_link", 6},
+};
+
+const NumberTable kRestriction = {
+    {"no_left_turn", 0},   {"no_right_turn", 1},    {"no_straight_on", 2}, {"no_u_turn", 3},
+    {"only_right_turn", 4}, {"only_left_turn", 5},  {"only_straight_on", 6}, {"no_entry", 7},
+    {"no_exit", 8},        {"no_turn", 9},
+};
+
+// indexed by road class, the speed of tracks is lowered later on
+const std::array<uint32_t, 8> kDefaultSpeed = {105, 90, 75, 60, 50, 40, 35, 25};
+
+const StringTable kAccess = {
+    {"yes", "true"},          {"private", "true"},      {"no", "false"},
+    {"permissive", "true"},   {"agricultural", "false"}, {"use_sidepath", "true"},
+    {"delivery", "true"},     {"designated", "true"},   {"dismount", "true"},
+    {"discouraged", "false"}, {"forestry", "false"},    {"destination", "true"},
+    {"customers", "true"},    {"official", "false"},    {"public", "true"},
+    {"restricted", "true"},   {"allowed", "true"},      {"emergency", "false"},
+};
+
+const StringTable kPrivate = {{"private", "true"}, {"delivery", "true"}};
+
+const StringTable kNoThruTraffic = {
+    {"destination", "true"},
+    {"customers", "true"},
+    {"delivery", "true"},
+};
+
+const NumberTable kUse = {
+    {"driveway", 4},         {"alley", 5},         {"parking_aisle", 6},
+    {"emergency_access", 7}, {"drive-through", 8},
+};
+
+const StringTable kMotorVehicle = {
+    {"yes", "true"},         {"private", "true"},      {"no", "false"},
+    {"permissive", "true"},  {"agricultural", "false"}, {"delivery", "true"},
+    {"designated", "true"},  {"discouraged", "false"}, {"forestry", "false"},
+    {"destination", "true"}, {"customers", "true"},    {"official", "false"},
+    {"public", "true"},      {"restricted", "true"},   {"allowed", "true"},
+};
+
+const StringTable kMoped = {
+    {"yes", "true"},         {"designated", "true"}, {"private", "true"},
+    {"permissive", "true"},  {"destination", "true"}, {"delivery", "true"},
+    {"dismount", "true"},    {"no", "false"},        {"unknown", "false"},
+    {"agricultural", "false"},
+};
+
+const StringTable kFoot = {
+    {"yes", "true"},         {"private", "true"},     {"no", "false"},
+    {"permissive", "true"},  {"agricultural", "false"}, {"use_sidepath", "true"},
+    {"delivery", "true"},    {"designated", "true"},  {"discouraged", "false"},
+    {"forestry", "false"},   {"destination", "true"}, {"customers", "true"},
+    {"official", "true"},    {"public", "true"},      {"restricted", "true"},
+    {"crossing", "true"},    {"sidewalk", "true"},    {"allowed", "true"},
+    {"passable", "true"},    {"footway", "true"},
+};
+
+const StringTable kWheelchair = {
+    {"no", "false"},         {"yes", "true"},        {"designated", "true"},
+    {"limited", "true"},     {"official", "true"},   {"destination", "true"},
+    {"public", "true"},      {"permissive", "true"}, {"only", "true"},
+    {"private", "true"},     {"impassable", "false"}, {"partial", "false"},
+    {"bad", "false"},        {"half", "false"},      {"assisted", "true"},
+};
+
+// the bus and taxi tables are the same
+const StringTable kBus = {
+    {"no", "false"},         {"yes", "true"},         {"designated", "true"},
+    {"urban", "true"},       {"permissive", "true"},  {"restricted", "true"},
+    {"destination", "true"}, {"delivery", "false"},   {"official", "false"},
+};
+const StringTable& kTaxi = kBus;
+
+const StringTable kPsv = {
+    {"bus", "true"},        {"taxi", "true"}, {"no", "false"}, {"yes", "true"},
+    {"designated", "true"}, {"permissive", "true"}, {"1", "true"}, {"2", "true"},
+};
+
+const StringTable kTruck = {
+    {"designated", "true"},   {"yes", "true"},
+    {"no", "false"},          {"destination", "true"},
+    {"delivery", "true"},     {"local", "true"},
+    {"agricultural", "false"}, {"private", "true"},
+    {"discouraged", "false"}, {"permissive", "false"},
+    {"unsuitable", "false"},  {"agricultural;forestry", "false"},
+    {"official", "false"},    {"forestry", "false"},
+    {"destination;delivery", "true"},
+};
+
+const StringTable kHazmat = {
+    {"designated", "true"}, {"yes", "true"}, {"no", "false"},
+    {"destination", "true"}, {"delivery", "true"},
+};
+
+const StringTable kShoulder = {{"yes", "true"}, {"both", "true"}, {"no", "false"}};
+const StringTable kShoulderRight = {{"right", "true"}};
+const StringTable kShoulderLeft = {{"left", "true"}};
+
+const StringTable kBicycle = {
+    {"yes", "true"},          {"designated", "true"}, {"use_sidepath", "true"},
+    {"no", "false"},          {"permissive", "true"}, {"destination", "true"},
+    {"dismount", "true"},     {"lane", "true"},       {"track", "true"},
+    {"shared", "true"},       {"shared_lane", "true"}, {"sidepath", "true"},
+    {"share_busway", "true"}, {"none", "false"},      {"allowed", "true"},
+    {"private", "true"},      {"official", "true"},
+};
+
+const StringTable kCycleway = {
+    {"yes", "true"},          {"designated", "true"},  {"use_sidepath", "true"},
+    {"permissive", "true"},   {"destination", "true"}, {"dismount", "true"},
+    {"lane", "true"},         {"track", "true"},       {"shared", "true"},
+    {"shared_lane", "true"},  {"sidepath", "true"},    {"share_busway", "true"},
+    {"allowed", "true"},      {"private", "true"},     {"cyclestreet", "true"},
+    {"crossing", "true"},
+};
+
+const StringTable kBikeReverse = {
+    {"opposite", "true"},
+    {"opposite_lane", "true"},
+    {"opposite_track", "true"},
+};
+
+const StringTable kBusReverse = {{"opposite", "true"}, {"opposite_lane", "true"}};
+
+// the shared, dedicated and separated tables as the kind of cycle lane they stand for
+const NumberTable kCycleLane = {
+    {"shared_lane", 1},   {"share_busway", 1}, {"shared", 1},    {"opposite_lane", 2},
+    {"lane", 2},          {"buffered_lane", 2}, {"opposite_track", 3}, {"track", 3},
+};
+const NumberTable kBuffer = {{"yes", 2}};
+
+const StringTable kOneway = {
+    {"no", "false"}, {"-1", "true"}, {"yes", "true"}, {"true", "true"}, {"1", "true"},
+};
+
+const StringTable kBridge = {{"yes", "true"}, {"no", "false"}, {"1", "true"}};
+
+const StringTable kTunnel = {
+    {"yes", "true"},
+    {"no", "false"},
+    {"1", "true"},
+    {"building_passage", "true"},
+};
+
+const StringTable kToll = {
+    {"yes", "true"},  {"no", "false"},       {"true", "true"},       {"false", "false"},
+    {"1", "true"},    {"interval", "true"},  {"snowmobile", "true"},
+};
+
+// the node tables give the bits of the access mask instead
+const NumberTable kMotorVehicleNode = {
+    {"yes", 1},         {"private", 1},   {"no", 0},          {"permissive", 1},
+    {"agricultural", 0}, {"delivery", 1}, {"designated", 1},  {"discouraged", 0},
+    {"forestry", 0},    {"destination", 1}, {"customers", 1}, {"official", 0},
+    {"public", 1},      {"restricted", 1}, {"allowed", 1},
+};
+
+const NumberTable kBicycleNode = {
+    {"yes", 4},       {"designated", 4},  {"use_sidepath", 4}, {"no", 0},
+    {"permissive", 4}, {"destination", 4}, {"dismount", 4},    {"lane", 4},
+    {"track", 4},     {"shared", 4},      {"shared_lane", 4},  {"sidepath", 4},
+    {"share_busway", 4}, {"none", 0},     {"allowed", 4},      {"private", 4},
+    {"official", 4},
+};
+
+const NumberTable kFootNode = {
+    {"yes", 2},          {"private", 2},     {"no", 0},          {"permissive", 2},
+    {"agricultural", 0}, {"use_sidepath", 2}, {"delivery", 2},   {"designated", 2},
+    {"discouraged", 0},  {"forestry", 0},    {"destination", 2}, {"customers", 2},
+    {"official", 2},     {"public", 2},      {"restricted", 2},  {"crossing", 2},
+    {"sidewalk", 2},     {"allowed", 2},     {"passable", 2},    {"footway", 2},
+};
+
+const NumberTable kWheelchairNode = {
+    {"no", 0},           {"yes", 256},       {"designated", 256}, {"limited", 256},
+    {"official", 256},   {"destination", 256}, {"public", 256},   {"permissive", 256},
+    {"only", 256},       {"private", 256},   {"impassable", 0},   {"partial", 0},
+    {"bad", 0},          {"half", 0},        {"assisted", 256},
+};
+
+const NumberTable kMopedNode = {
+    {"yes", 512},        {"designated", 512}, {"private", 512}, {"permissive", 512},
+    {"destination", 512}, {"delivery", 512},  {"dismount", 512}, {"no", 0},
+    {"unknown", 0},      {"agricultural", 0},
+};
+
+const NumberTable kMotorcycleNode = {
+    {"yes", 1024},        {"private", 1024},   {"no", 0},           {"permissive", 1024},
+    {"agricultural", 0},  {"delivery", 1024},  {"designated", 1024}, {"discouraged", 0},
+    {"forestry", 0},      {"destination", 1024}, {"customers", 1024}, {"official", 0},
+    {"public", 1024},     {"restricted", 1024}, {"allowed", 1024},
+};
+
+const NumberTable kBusNode = {
+    {"no", 0},          {"yes", 64},         {"designated", 64}, {"urban", 64},
+    {"permissive", 64}, {"restricted", 64},  {"destination", 64}, {"delivery", 0},
+    {"official", 0},
+};
+
+const NumberTable kTaxiNode = {
+    {"no", 0},          {"yes", 32},         {"designated", 32}, {"urban", 32},
+    {"permissive", 32}, {"restricted", 32},  {"destination", 32}, {"delivery", 0},
+    {"official", 0},
+};
+
+const NumberTable kTruckNode = {
+    {"designated", 8},   {"yes", 8},          {"no", 0},
+    {"destination", 8},  {"delivery", 8},     {"local", 8},
+    {"agricultural", 0}, {"private", 8},      {"discouraged", 0},
+    {"permissive", 0},   {"unsuitable", 0},   {"agricultural;forestry", 0},
+    {"official", 0},     {"forestry", 0},     {"destination;delivery", 8},
+};
+
+const NumberTable kPsvBusNode = {
+    {"bus", 64}, {"no", 0}, {"yes", 64}, {"designated", 64}, {"permissive", 64}, {"1", 64},
+    {"2", 64},
+};
+
+const NumberTable kPsvTaxiNode = {
+    {"taxi", 32}, {"no", 0}, {"yes", 32}, {"designated", 32}, {"permissive", 32}, {"1", 32},
+    {"2", 32},
+};
+
+// the first of the values that is not nil, like chaining them with or in lua
+template <class T> const T* first(std::initializer_list<const T*> values) {
+  for (const auto* value : values) {
+    if (value) {
+      return value;
+    }
+  }
+  return nullptr;
+}
+
+template <class T> boost::optional<T> first(std::initializer_list<boost::optional<T>> values) {
+  for (const auto& value : values) {
+    if (value) {
+      return value;
+    }
+  }
+  return boost::none;
+}
+
+// formats a number the way tostring does in lua
+std::string number(const double value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.14g", value);
+  return buffer;
+}
+
+double round(const double value, const int digits = 0) {
+  double scale = std::pow(10., digits);
+  return std::floor(value * scale + 0.5) / scale;
+}
+
+bool ends_with(const std::string& str, const char* suffix) {
+  std::string end(suffix);
+  return str.size() >= end.size() && str.compare(str.size() - end.size(), end.size(), end) == 0;
+}
+
+std::string strip_spaces(const std::string& str) {
+  std::string stripped;
+  for (char c : str) {
+    if (c != ' ' && (c < '\t' || c > '\r')) {
+      stripped.push_back(c);
+    }
+  }
+  return stripped;
+}
+
+bool is_digit(const char c) {
+  return c >= '0' && c <= '9';
+}
+
+// the number the string starts with, the digits and dots before anything else when decimals
+// are allowed. like tonumber, prefixes with more than one dot are no number
+boost::optional<double> numeric_prefix(const std::string* str, const bool allow_decimals) {
+  if (!str) {
+    return boost::none;
+  }
+  size_t index = 0, dots = 0;
+  for (; index < str->size(); ++index) {
+    if ((*str)[index] == '.' && allow_decimals) {
+      ++dots;
+    } else if (!is_digit((*str)[index])) {
+      break;
+    }
+  }
+  if (index == 0 || dots > 1 || index == dots) {
+    return boost::none;
+  }
+  return std::strtod(str->substr(0, index).c_str(), nullptr);
+}
+
+boost::optional<double> normalize_speed(const std::string* speed) {
+  auto num = numeric_prefix(speed, false);
+  if (num) {
+    if (ends_with(*speed, "mph")) {
+      num = round(*num * 1.609344);
+    }
+    // toss speeds over 150kph or under 10kph
+    if (*num > 150 || *num < 10) {
+      return boost::none;
+    }
+  }
+  return num;
+}
+
+boost::optional<double> normalize_weight(const std::string* weight) {
+  if (!weight) {
+    return boost::none;
+  }
+  auto w = strip_spaces(*weight);
+  auto num = numeric_prefix(&w, true);
+  if (!num) {
+    return boost::none;
+  }
+  auto n = number(*num);
+  if (ends_with(w, "t") || ends_with(w, "tonne") || ends_with(w, "tonnes")) {
+    if (n + "t" == w || n + "tonne" == w || n + "tonnes" == w) {
+      return round(*num, 2);
+    }
+  }
+  if (ends_with(w, "ton") || ends_with(w, "tons")) {
+    if (n + "ton" == w || n + "tons" == w) {
+      return round(*num, 2);
+    }
+  }
+  if (ends_with(w, "lb") || ends_with(w, "lbs")) {
+    if (n + "lb" == w || n + "lbs" == w) {
+      return round(*num / 2000, 2);
+    }
+  }
+  if (ends_with(w, "kg")) {
+    if (n + "kg" == w) {
+      return round(*num / 1000, 2);
+    }
+  }
+  return round(*num, 2);
+}
+
+// the part of a measurement after its feet and whatever comes before the inches
+std::string inches_of(const std::string& measurement, const double feet) {
+  auto length = number(feet).size();
+  auto m = length < measurement.size() ? measurement.substr(length) : std::string();
+  size_t index = 0;
+  while (index < m.size() && !is_digit(m[index])) {
+    ++index;
+  }
+  return m.substr(index);
+}
+
+boost::optional<double> normalize_measurement(const std::string* measurement) {
+  if (!measurement) {
+    return boost::none;
+  }
+  // 7'6" or 7ft6in, 7m or 7
+  auto m = strip_spaces(*measurement);
+  auto num = numeric_prefix(&m, true);
+  if (!num) {
+    return boost::none;
+  }
+  auto n = number(*num);
+  if (ends_with(m, "m") || ends_with(m, "meter") || ends_with(m, "meters")) {
+    if (n + "m" == m || n + "meter" == m || n + "meters" == m) {
+      return round(*num, 2);
+    }
+  }
+
+  if (ends_with(m, "in") || ends_with(m, "\"") || ends_with(m, "inches") || ends_with(m, "inch")) {
+    // inches only
+    if (n + "in" == m || n + "\"" == m || n + "inches" == m || n + "inch" == m) {
+      return round(*num * 0.0254, 2);
+    }
+    // the script fails on feet followed by something other than inches, those are just feet here
+    auto feet = *num;
+    auto rest = inches_of(*measurement, feet);
+    auto inches = numeric_prefix(&rest, true);
+    num = round(feet * 0.3048 + (inches ? *inches * 0.0254 : 0.), 2);
+  } else if (ends_with(m, "ft") || ends_with(m, "'") || ends_with(m, "feet")) {
+    num = round(*num * 0.3048, 2);
+  } else {
+    // crappy data such as 7'6 or 7ft6
+    auto feet = *num;
+    auto length = number(feet).size();
+    auto rest = length < measurement->size() ? measurement->substr(length) : std::string();
+    if (!rest.empty() && !is_digit(rest.front())) {
+      rest = inches_of(*measurement, feet);
+      auto inches = numeric_prefix(&rest, true);
+      num = inches ? round(feet * 0.3048 + *inches * 0.0254, 2) : round(feet * 0.3048, 2);
+    }
+  }
+  return round(*num, 2);
+}
+
+// the type of restriction of a conditional restriction, no_left_turn @ (07:00-09:00) gives
+// no_left_turn
+boost::optional<std::string> restriction_prefix(const std::string* restriction) {
+  if (!restriction) {
+    return boost::none;
+  }
+  auto at = restriction->find('@');
+  if (at == std::string::npos) {
+    return boost::none;
+  }
+  // the script counts the characters that are not spaces but takes that many from the start
+  size_t index = 0;
+  for (size_t i = 0; i < at; ++i) {
+    index += (*restriction)[i] != ' ';
+  }
+  return restriction->substr(0, index);
+}
+
+// the condition of a conditional restriction, no_left_turn @ (07:00-09:00) gives (07:00-09:00)
+boost::optional<std::string> restriction_suffix(const std::string* restriction) {
+  if (!restriction) {
+    return boost::none;
+  }
+  auto at = restriction->find('@');
+  if (at == std::string::npos) {
+    return boost::none;
+  }
+  auto start = restriction->find_first_not_of(' ', at + 1);
+  // without a condition the script gives the last character
+  return restriction->substr(start == std::string::npos ? restriction->size() - 1 : start);
+}
+
+// the tags of the element being transformed, read and written like the lua table of tags
+class Kv {
+public:
+  explicit Kv(const Tags& tags) : tags_(tags) {
+  }
+
+  const std::string* get(const std::string& key) const {
+    auto found = tags_.find(key);
+    return found == tags_.end() ? nullptr : &found->second;
+  }
+
+  bool has(const std::string& key) const {
+    return tags_.find(key) != tags_.end();
+  }
+
+  bool is(const std::string& key, const char* value) const {
+    auto found = tags_.find(key);
+    return found != tags_.end() && found->second == value;
+  }
+
+  // the entry of a table for the value of key, nullptr if there is none
+  template <class T>
+  const T* in(const std::unordered_map<std::string, T>& table, const std::string& key) const {
+    auto value = get(key);
+    if (!value) {
+      return nullptr;
+    }
+    auto found = table.find(*value);
+    return found == table.end() ? nullptr : &found->second;
+  }
+
+  template <class T>
+  boost::optional<T> in_optional(const std::unordered_map<std::string, T>& table,
+                                 const std::string& key) const {
+    auto found = in(table, key);
+    return found ? boost::optional<T>(*found) : boost::none;
+  }
+
+  void set(const std::string& key, const std::string& value) {
+    tags_[key] = value;
+  }
+
+  // assigning nil erases the key
+  void set(const std::string& key, const std::string* value) {
+    if (value) {
+      std::string copy(*value);
+      tags_[key] = std::move(copy);
+    } else {
+      tags_.erase(key);
+    }
+  }
+
+  template <class T> void set_number(const std::string& key, const boost::optional<T>& value) {
+    if (value) {
+      tags_[key] = number(*value);
+    } else {
+      tags_.erase(key);
+    }
+  }
+
+  // sets key only if the value is not nil, like x = value or x
+  void set_if(const std::string& key, const std::string* value) {
+    if (value) {
+      set(key, value);
+    }
+  }
+
+  void erase(const std::string& key) {
+    tags_.erase(key);
+  }
+
+  void swap(const std::string& a, const std::string& b) {
+    auto value_a = get(a) ? boost::make_optional(*get(a)) : boost::none;
+    set(a, get(b));
+    set(b, value_a ? &*value_a : nullptr);
+  }
+
+  Tags& tags() {
+    return tags_;
+  }
+
+private:
+  Tags tags_;
+};
+
+void SetAll(Kv& kv, std::initializer_list<const char*> keys, const std::string& value) {
+  for (const auto* key : keys) {
+    kv.set(key, value);
+  }
+}
+
+// the access the tags of a way give each mode, nullptr for the modes they leave alone
+struct ModeTags {
+  explicit ModeTags(const Kv& kv) {
+    auto motor_vehicle = kv.in(kMotorVehicle, "motor_vehicle");
+    auto psv = first({kv.in(kPsv, "psv"), kv.in(kPsv, "lanes:psv:forward")});
+    auto_ = first({kv.in(kMotorVehicle, "motorcar"), motor_vehicle});
+    truck = first({kv.in(kTruck, "hgv"), motor_vehicle});
+    bus = first({kv.in(kBus, "bus"), psv, motor_vehicle});
+    taxi = first({kv.in(kTaxi, "taxi"), psv, motor_vehicle});
+    foot = first({kv.in(kFoot, "foot"), kv.in(kFoot, "pedestrian")});
+    bike = first({kv.in(kBicycle, "bicycle"), kv.in(kCycleway, "cycleway"),
+                  kv.in(kBicycle, "bicycle_road"), kv.in(kBicycle, "cyclestreet")});
+    moped = first({kv.in(kMoped, "moped"), kv.in(kMoped, "mofa"), motor_vehicle});
+    motorcycle = first({kv.in(kMotorVehicle, "motorcycle"), motor_vehicle});
+  }
+  const std::string* auto_;
+  const std::string* truck;
+  const std::string* bus;
+  const std::string* taxi;
+  const std::string* foot;
+  const std::string* bike;
+  const std::string* moped;
+  const std::string* motorcycle;
+};
+
+// the cycle lane the value of a cycleway key or its buffer stands for
+uint32_t cycle_lane(const Kv& kv, const std::string& key, const std::string& buffer) {
+  auto lane = first({kv.in_optional(kCycleLane, key), kv.in_optional(kBuffer, buffer)});
+  return lane ? *lane : 0;
+}
+
+const std::string& value_or(const std::string* value, const std::string& otherwise) {
+  return value ? *value : otherwise;
+}
+
+// nodes_proc
+void TransformNode(Kv& kv) {
+  // normalize a few tags that we care about
+  std::string access = value_or(kv.in(kAccess, "access"), kTrue);
+  if (kv.is("impassable", "yes") ||
+      (kv.is("access", "private") &&
+       (kv.is("emergency", "yes") || kv.is("service", "emergency_access")))) {
+    access = "false";
+  }
+
+  boost::optional<uint32_t> hov_tag;
+  if ((kv.has("hov") && !kv.is("hov", "no")) || kv.has("hov:lanes") || kv.has("hov:minimum")) {
+    hov_tag = 128;
+  }
+
+  auto foot_tag = kv.in_optional(kFootNode, "foot");
+  auto wheelchair_tag = kv.in_optional(kWheelchairNode, "wheelchair");
+  auto bike_tag = kv.in_optional(kBicycleNode, "bicycle");
+  auto truck_tag = kv.in_optional(kTruckNode, "hgv");
+  auto auto_tag = kv.in_optional(kMotorVehicleNode, "motorcar");
+  auto motor_vehicle_tag = kv.in_optional(kMotorVehicleNode, "motor_vehicle");
+  auto moped_tag =
+      first({kv.in_optional(kMopedNode, "moped"), kv.in_optional(kMopedNode, "mofa")});
+  auto motorcycle_tag = kv.in_optional(kMotorcycleNode, "motorcycle");
+
+  if (!auto_tag) {
+    auto_tag = motor_vehicle_tag;
+  }
+  auto bus_tag = first({kv.in_optional(kBusNode, "bus"), kv.in_optional(kPsvBusNode, "psv")});
+  // if bus was not set and car is
+  if (!bus_tag && auto_tag == 1u) {
+    bus_tag = 64;
+  }
+  // if wheelchair was not set and foot is
+  if (!wheelchair_tag && foot_tag == 2u) {
+    wheelchair_tag = 256;
+  }
+  // if hov was not set and car is
+  if (!hov_tag && auto_tag == 1u) {
+    hov_tag = 128;
+  }
+  auto taxi_tag = first({kv.in_optional(kTaxiNode, "taxi"), kv.in_optional(kPsvTaxiNode, "psv")});
+  // if taxi was not set and car is
+  if (!taxi_tag && auto_tag == 1u) {
+    taxi_tag = 32;
+  }
+  // if truck was not set and car is
+  if (!truck_tag && auto_tag == 1u) {
+    truck_tag = 8;
+  }
+  // must shut these off if motor_vehicle = 0
+  if (motor_vehicle_tag == 0u) {
+    bus_tag = taxi_tag = truck_tag = moped_tag = motorcycle_tag = 0u;
+  }
+
+  boost::optional<uint32_t> emergency_tag;
+  if (kv.is("access", "emergency") || kv.is("emergency", "yes") ||
+      kv.is("service", "emergency_access")) {
+    emergency_tag = 16;
+  }
+
+  // do not shut off bike access if there is a highway crossing
+  if (bike_tag == 0u && kv.is("highway", "crossing")) {
+    bike_tag = 4;
+  }
+
+  // if a tag exists use it, otherwise access is allowed for all modes unless access = false,
+  // hov = designated or vehicle = no
+  auto auto_ = auto_tag.value_or(1);
+  auto truck = truck_tag.value_or(8);
+  auto bus = bus_tag.value_or(64);
+  auto taxi = taxi_tag.value_or(32);
+  auto foot = foot_tag.value_or(2);
+  auto wheelchair = wheelchair_tag.value_or(256);
+  auto bike = bike_tag.value_or(4);
+  auto emergency = emergency_tag.value_or(16);
+  auto hov = hov_tag.value_or(128);
+  auto moped = moped_tag.value_or(512);
+  auto motorcycle = motorcycle_tag.value_or(1024);
+
+  // if access = false use the tag if it exists, otherwise there is no access for that mode
+  if (access == "false" || kv.is("vehicle", "no") || kv.is("hov", "designated")) {
+    auto_ = auto_tag.value_or(0);
+    truck = truck_tag.value_or(0);
+    bus = bus_tag.value_or(0);
+    taxi = taxi_tag.value_or(0);
+    // don't change pedestrians if vehicle = no
+    if (access == "false" || kv.is("hov", "designated")) {
+      foot = foot_tag.value_or(0);
+    }
+    wheelchair = wheelchair_tag.value_or(0);
+    bike = bike_tag.value_or(0);
+    moped = moped_tag.value_or(0);
+    motorcycle = motorcycle_tag.value_or(0);
+    emergency = emergency_tag.value_or(0);
+    hov = hov_tag.value_or(0);
+  }
+
+  // check for gates and bollards
+  bool gate = kv.is("barrier", "gate") || kv.is("barrier", "lift_gate");
+  bool bollard = false;
+  if (!gate) {
+    // if there was a bollard cars can't get through it
+    bollard = kv.is("barrier", "bollard") || kv.is("barrier", "block") ||
+              kv.is("bollard", "removable");
+    // save rising bollards as gates
+    if (bollard && kv.is("bollard", "rising")) {
+      gate = true;
+      bollard = false;
+    }
+    // a bollard shuts off access unless the tag exists
+    if (bollard) {
+      auto_ = auto_tag.value_or(0);
+      truck = truck_tag.value_or(0);
+      bus = bus_tag.value_or(0);
+      taxi = taxi_tag.value_or(0);
+      foot = foot_tag.value_or(2);
+      wheelchair = wheelchair_tag.value_or(256);
+      bike = bike_tag.value_or(4);
+      moped = moped_tag.value_or(0);
+      motorcycle = motorcycle_tag.value_or(0);
+      emergency = emergency_tag.value_or(0);
+      hov = hov_tag.value_or(0);
+    }
+  }
+
+  // if nothing blocks access at this node assume access is allowed. the script leaves the
+  // access of taxis as it is here
+  if (!gate && !bollard && access == "true") {
+    if (kv.is("highway", "crossing") || kv.is("railway", "crossing") ||
+        kv.is("footway", "crossing") || kv.is("cycleway", "crossing") ||
+        kv.is("foot", "crossing") || kv.is("bicycle", "crossing") ||
+        kv.is("pedestrian", "crossing") || kv.has("crossing")) {
+      auto_ = auto_tag.value_or(1);
+      truck = truck_tag.value_or(8);
+      bus = bus_tag.value_or(64);
+      foot = foot_tag.value_or(2);
+      wheelchair = wheelchair_tag.value_or(256);
+      bike = bike_tag.value_or(4);
+      moped = moped_tag.value_or(512);
+      motorcycle = motorcycle_tag.value_or(1024);
+      emergency = emergency_tag.value_or(16);
+      hov = hov_tag.value_or(128);
+    }
+  }
+
+  // store the gate and bollard info
+  kv.set("gate", gate ? kTrue : kFalse);
+  kv.set("bollard", bollard ? kTrue : kFalse);
+
+  if (kv.is("barrier", "border_control")) {
+    kv.set("border_control", kTrue);
+  } else if (kv.is("barrier", "toll_booth")) {
+    kv.set("toll_booth", kTrue);
+  }
+
+  const auto& coins = value_or(kv.in(kToll, "payment:coins"), kFalse);
+  const auto& notes = value_or(kv.in(kToll, "payment:notes"), kFalse);
+  // assume cash for toll, toll:* and fee
+  const auto& cash =
+      value_or(first({kv.in(kToll, "toll"), kv.in(kToll, "toll:hgv"),
+                      kv.in(kToll, "toll:bicycle"), kv.in(kToll, "toll:hov"),
+                      kv.in(kToll, "toll:motorcar"), kv.in(kToll, "toll:motor_vehicle"),
+                      kv.in(kToll, "toll:bus"), kv.in(kToll, "toll:motorcycle"),
+                      kv.in(kToll, "payment:cash"), kv.in(kToll, "fee")}),
+               kFalse);
+  const auto& etc = value_or(first({kv.in(kToll, "payment:e_zpass"),
+                                    kv.in(kToll, "payment:e_zpass:name"),
+                                    kv.in(kToll, "payment:pikepass"),
+                                    kv.in(kToll, "payment:via_verde")}),
+                             kFalse);
+
+  uint32_t cash_payment = 0;
+  if (cash == kTrue || (coins == kTrue && notes == kTrue)) {
+    cash_payment = 3;
+  } else if (coins == kTrue) {
+    cash_payment = 1;
+  } else if (notes == kTrue) {
+    cash_payment = 2;
+  }
+  uint32_t etc_payment = etc == kTrue ? 4 : 0;
+
+  // store a mask denoting payment type
+  kv.set("payment_mask", std::to_string(cash_payment | etc_payment));
+
+  if (kv.is("amenity", "bicycle_rental") ||
+      (kv.is("shop", "bicycle") && kv.is("service:bicycle:rental", "yes"))) {
+    kv.set("bicycle_rental", kTrue);
+  }
+
+  if (kv.is("traffic_signals:direction", "forward")) {
+    kv.set("forward_signal", kTrue);
+    if (!kv.has("public_transport") && kv.has("name")) {
+      kv.set("junction", "named");
+    }
+  }
+  if (kv.is("traffic_signals:direction", "backward")) {
+    kv.set("backward_signal", kTrue);
+    if (!kv.has("public_transport") && kv.has("name")) {
+      kv.set("junction", "named");
+    }
+  }
+  if (!kv.has("public_transport") && kv.has("name")) {
+    if (kv.is("highway", "traffic_signals")) {
+      if (!kv.is("junction", "yes")) {
+        kv.set("junction", "named");
+      }
+    } else if (kv.is("junction", "yes") || kv.is("reference_point", "yes")) {
+      kv.set("junction", "named");
+    }
+  }
+
+  // store a mask denoting access
+  kv.set("access_mask", std::to_string(auto_ | emergency | truck | bike | foot | wheelchair | bus |
+                                       hov | moped | motorcycle | taxi));
+}
+
+// filter_tags_generic, returns false for the ways to filter out
+bool TransformWay(Kv& kv) {
+  if (kv.is("highway", "construction") || kv.is("highway", "proposed")) {
+    return false;
+  }
+
+  // figure out what basic type of road it is
+  auto forward = kv.in(kHighway, "highway");
+  bool ferry = kv.is("route", "ferry");
+  bool rail = kv.is("route", "shuttle_train");
+  auto access = kv.in(kAccess, "access");
+
+  kv.set("emergency_forward", kFalse);
+  kv.set("emergency_backward", kFalse);
+  if (ferry || rail || kv.has("highway")) {
+    if (kv.is("access", "emergency") || kv.is("emergency", "yes") ||
+        kv.is("service", "emergency_access")) {
+      kv.set("emergency_forward", kTrue);
+      kv.set("emergency_tag", kTrue);
+    }
+    if (kv.is("emergency", "no")) {
+      kv.set("emergency_tag", kFalse);
+    }
+  }
+
+  bool closed = kv.is("impassable", "yes") || (access && *access == kFalse) ||
+                (kv.is("access", "private") &&
+                 (kv.is("emergency", "yes") || kv.is("service", "emergency_access")));
+  auto shut_off = [&kv](bool pedestrian) {
+    SetAll(kv,
+           {"auto_forward", "truck_forward", "bus_forward", "taxi_forward", "moped_forward",
+            "motorcycle_forward", "bike_forward", "auto_backward", "truck_backward",
+            "bus_backward", "taxi_backward", "moped_backward", "motorcycle_backward",
+            "bike_backward"},
+           kFalse);
+    if (pedestrian) {
+      kv.set("pedestrian", kFalse);
+    }
+  };
+  // the tags of the modes, computed after the highway sets pedestrian as the script does
+  auto set_mode_tags = [&kv](const ModeTags& modes) {
+    kv.set("auto_tag", modes.auto_);
+    kv.set("truck_tag", modes.truck);
+    kv.set("bus_tag", modes.bus);
+    kv.set("taxi_tag", modes.taxi);
+    kv.set("foot_tag", modes.foot);
+    kv.set("bike_tag", modes.bike);
+    kv.set("moped_tag", modes.moped);
+    kv.set("motorcycle_tag", modes.motorcycle);
+    if (!modes.bike) {
+      if (kv.is("sac_scale", "hiking")) {
+        kv.set("bike_forward", kTrue);
+        kv.set("bike_tag", kTrue);
+      } else if (kv.has("sac_scale")) {
+        kv.set("bike_forward", kFalse);
+      }
+    }
+    if (kv.is("motorroad", "yes")) {
+      kv.set("motorroad_tag", kTrue);
+    }
+  };
+
+  if (forward) {
+    for (size_t i = 0; i < kHighwayModes.size(); ++i) {
+      kv.set(kHighwayModes[i], (*forward)[i] ? kTrue : kFalse);
+    }
+    if (closed) {
+      shut_off(true);
+    } else if (kv.is("vehicle", "no")) {
+      // don't change pedestrian access
+      shut_off(false);
+    }
+    // the tags of the modes override the highway
+    ModeTags modes(kv);
+    kv.set_if("auto_forward", modes.auto_);
+    kv.set_if("truck_forward", modes.truck);
+    kv.set_if("bus_forward", modes.bus);
+    kv.set_if("taxi_forward", modes.taxi);
+    kv.set_if("pedestrian", modes.foot);
+    kv.set_if("bike_forward", modes.bike);
+    kv.set_if("moped_forward", modes.moped);
+    kv.set_if("motorcycle_forward", modes.motorcycle);
+    set_mode_tags(modes);
+  } else if (!(ferry || rail) || closed) {
+    shut_off(true);
+  } else {
+    // ferries and rail are open to every mode unless their tags say otherwise
+    const auto& ped_val = kTrue;
+    const auto& default_val = kv.is("vehicle", "no") ? kFalse : kTrue;
+    ModeTags modes(kv);
+    kv.set("auto_forward", first({modes.auto_, &default_val}));
+    kv.set("truck_forward", first({kv.in(kTruck, "hgv"), kv.get("truck_forward"),
+                                   kv.in(kMotorVehicle, "motor_vehicle"), &default_val}));
+    kv.set("bus_forward", first({modes.bus, &default_val}));
+    kv.set("taxi_forward", first({modes.taxi, &default_val}));
+    kv.set("pedestrian", first({modes.foot, &ped_val}));
+    kv.set("bike_forward", first({modes.bike, &default_val}));
+    kv.set("moped_forward", first({modes.moped, &default_val}));
+    kv.set("motorcycle_forward", first({modes.motorcycle, &default_val}));
+    set_mode_tags(modes);
+  }
+
+  // TODO: handle time conditional restrictions if available for HOVs with oneway = reversible
+  if ((kv.is("access", "permissive") || kv.is("access", "hov") || kv.is("access", "taxi")) &&
+      kv.is("oneway", "reversible")) {
+    // for now enable only for buses if the tag exists and they are allowed
+    if (!kv.is("bus_forward", "true")) {
+      return false;
+    }
+    SetAll(kv,
+           {"auto_forward", "truck_forward", "pedestrian", "bike_forward", "moped_forward",
+            "motorcycle_forward"},
+           kFalse);
+  }
+
+  // service=driveway means all are routable
+  if (kv.is("service", "driveway") && !kv.has("access")) {
+    SetAll(kv,
+           {"auto_forward", "truck_forward", "bus_forward", "taxi_forward", "pedestrian",
+            "bike_forward", "moped_forward", "motorcycle_forward"},
+           kTrue);
+  }
+
+  // check the oneway-ness and traversability against the direction of the geom
+  if ((kv.is("oneway", "yes") && kv.is("oneway:bicycle", "no")) ||
+      kv.is("bicycle:backward", "yes") || kv.is("bicycle:backward", "no")) {
+    kv.set("bike_backward", kTrue);
+  }
+  if (!kv.has("bike_backward") || kv.is("bike_backward", "false")) {
+    kv.set("bike_backward",
+           first({kv.in(kBikeReverse, "cycleway"), kv.in(kBikeReverse, "cycleway:left"),
+                  kv.in(kBikeReverse, "cycleway:right"), &kFalse}));
+  }
+  const std::string* oneway_bike = nullptr;
+  if (kv.is("bike_backward", "true")) {
+    oneway_bike = kv.in(kOneway, "oneway:bicycle");
+  }
+
+  if (!kv.has("oneway:bus") && kv.has("oneway:psv")) {
+    kv.set("oneway:bus", kv.get("oneway:psv"));
+  }
+  if ((kv.is("oneway", "yes") && kv.is("oneway:bus", "no")) || kv.is("bus:backward", "yes") ||
+      kv.is("bus:backward", "designated")) {
+    kv.set("bus_backward", kTrue);
+  }
+  if (!kv.has("bus_backward") || kv.is("bus_backward", "false")) {
+    kv.set("bus_backward",
+           first({kv.in(kBusReverse, "busway"), kv.in(kBusReverse, "busway:left"),
+                  kv.in(kBusReverse, "busway:right"), kv.in(kPsv, "lanes:psv:backward"),
+                  &kFalse}));
+  }
+  const std::string* oneway_bus = nullptr;
+  if (kv.is("bus_backward", "true")) {
+    oneway_bus = kv.in(kOneway, "oneway:bus");
+    if (oneway_bus && *oneway_bus == kFalse && kv.is("bus:backward", "yes")) {
+      oneway_bus = &kTrue;
+    }
+  }
+
+  if (!kv.has("oneway:taxi") && kv.has("oneway:psv")) {
+    kv.set("oneway:taxi", kv.get("oneway:psv"));
+  }
+  if ((kv.is("oneway", "yes") && kv.is("oneway:taxi", "no")) || kv.is("taxi:backward", "yes") ||
+      kv.is("taxi:backward", "designated")) {
+    kv.set("taxi_backward", kTrue);
+  }
+  if (!kv.has("taxi_backward") || kv.is("taxi_backward", "false")) {
+    kv.set("taxi_backward", first({kv.in(kPsv, "lanes:psv:backward"), &kFalse}));
+  }
+  const std::string* oneway_taxi = nullptr;
+  if (kv.is("taxi_backward", "true")) {
+    oneway_taxi = kv.in(kOneway, "oneway:taxi");
+    if (oneway_taxi && *oneway_taxi == kFalse && kv.is("taxi:backward", "yes")) {
+      oneway_taxi = &kTrue;
+    }
+  }
+
+  if (!kv.has("moped_backward")) {
+    kv.set("moped_backward", kFalse);
+  }
+  if ((kv.is("oneway", "yes") && (kv.is("oneway:moped", "no") || kv.is("oneway:mofa", "no"))) ||
+      kv.is("moped:backward", "yes") || kv.is("mofa:backward", "yes")) {
+    kv.set("moped_backward", kTrue);
+  }
+  const std::string* oneway_moped = nullptr;
+  if (kv.is("moped_backward", "true")) {
+    oneway_moped = first({kv.in(kOneway, "oneway:moped"), kv.in(kOneway, "oneway:mofa")});
+  }
+
+  if (!kv.has("motorcycle_backward")) {
+    kv.set("motorcycle_backward", kFalse);
+  }
+  if ((kv.is("oneway", "yes") && kv.is("oneway:motorcycle", "no")) ||
+      kv.is("motorcycle:backward", "yes")) {
+    kv.set("motorcycle_backward", kTrue);
+  }
+  const std::string* oneway_motorcycle = nullptr;
+  if (kv.is("motorcycle_backward", "true")) {
+    oneway_motorcycle = kv.in(kOneway, "oneway:motorcycle");
+  }
+
+  bool oneway_reverse = kv.is("oneway", "-1");
+  auto oneway_norm = kv.in(kOneway, "oneway");
+  if (kv.is("junction", "roundabout") || kv.is("junction", "circular")) {
+    oneway_norm = &kTrue;
+    kv.set("roundabout", kTrue);
+  } else {
+    kv.set("roundabout", kFalse);
+  }
+  kv.set("oneway", oneway_norm);
+  if (oneway_norm && *oneway_norm == kTrue) {
+    kv.set("auto_backward", kFalse);
+    kv.set("truck_backward", kFalse);
+    kv.set("emergency_backward", kFalse);
+
+    // modes going against a oneway only go that way if their oneway tag says so, both ways if
+    // it says no
+    auto backward = [&kv](const char* forward, const char* backward, const std::string* oneway) {
+      if (kv.is(backward, "true") && oneway) {
+        kv.set(forward, *oneway == kTrue ? kFalse : kTrue);
+      }
+    };
+    backward("bike_forward", "bike_backward", oneway_bike);
+    backward("bus_forward", "bus_backward", oneway_bus);
+    backward("taxi_forward", "taxi_backward", oneway_taxi);
+    backward("moped_forward", "moped_backward", oneway_moped);
+    backward("motorcycle_forward", "motorcycle_backward", oneway_motorcycle);
+  } else {
+    kv.set("auto_backward", kv.get("auto_forward"));
+    kv.set("truck_backward", kv.get("truck_forward"));
+    kv.set("emergency_backward", kv.get("emergency_forward"));
+
+    if (kv.is("bike_backward", "false") &&
+        (!kv.has("oneway:bicycle") || kv.is("oneway:bicycle", "no"))) {
+      kv.set("bike_backward", kv.get("bike_forward"));
+    }
+    if (kv.is("bus_backward", "false") && !kv.has("oneway:bus")) {
+      kv.set("bus_backward", kv.get("bus_forward"));
+    }
+    if (kv.is("taxi_backward", "false") && !kv.has("oneway:taxi")) {
+      kv.set("taxi_backward", kv.get("taxi_forward"));
+    }
+    if (kv.is("moped_backward", "false") &&
+        (!kv.has("oneway:moped") || kv.is("oneway:moped", "no")) &&
+        (!kv.has("oneway:mofa") || kv.is("oneway:mofa", "no"))) {
+      kv.set("moped_backward", kv.get("moped_forward"));
+    }
+    if (kv.is("motorcycle_backward", "false") &&
+        (!kv.has("oneway:motorcycle") || kv.is("oneway:motorcycle", "no"))) {
+      kv.set("motorcycle_backward", kv.get("motorcycle_forward"));
+    }
+  }
+
+  // bike forward / backward overrides
+  if (kv.in(kCycleLane, "cycleway:both") ||
+      (kv.in(kCycleLane, "cycleway:right") && kv.in(kCycleLane, "cycleway:left"))) {
+    kv.set("bike_forward", kTrue);
+    kv.set("bike_backward", kTrue);
+  }
+
+  if (kv.is("busway", "lane") || (kv.is("busway:left", "lane") && kv.is("busway:right", "lane"))) {
+    kv.set("bus_forward", kTrue);
+    kv.set("bus_backward", kTrue);
+  }
+
+  // flip the onewayness
+  kv.set("oneway_reverse", oneway_reverse ? kTrue : kFalse);
+  if (oneway_reverse) {
+    for (const auto* mode : {"auto", "truck", "emergency", "bus", "taxi", "bike", "moped",
+                             "motorcycle"}) {
+      kv.swap(std::string(mode) + "_forward", std::string(mode) + "_backward");
+    }
+  }
+
+  if (kv.is("oneway:bicycle", "-1")) {
+    kv.swap("bike_forward", "bike_backward");
+  }
+  if (kv.is("oneway:bus", "-1")) {
+    kv.swap("bus_forward", "bus_backward");
+  }
+
+  // bus only logic
+  if (kv.is("lanes:bus", "1")) {
+    kv.set("bus_forward", kTrue);
+    kv.set("bus_backward", kFalse);
+  } else if (kv.is("lanes:bus", "2")) {
+    kv.set("bus_forward", kTrue);
+    kv.set("bus_backward", kTrue);
+  }
+
+  if (kv.is("oneway:taxi", "-1")) {
+    kv.swap("taxi_forward", "taxi_backward");
+  }
+  if (kv.is("lanes:psv", "1")) {
+    kv.set("taxi_forward", kTrue);
+    kv.set("taxi_backward", kFalse);
+  } else if (kv.is("lanes:psv", "2")) {
+    kv.set("taxi_forward", kTrue);
+    kv.set("taxi_backward", kTrue);
+  }
+
+  // if none of the modes were set we are done looking at this, bridleways are saved for the
+  // country access logic
+  bool none = true;
+  for (const auto* key :
+       {"auto_forward", "truck_forward", "bus_forward", "bike_forward", "emergency_forward",
+        "moped_forward", "motorcycle_forward", "auto_backward", "truck_backward", "bus_backward",
+        "bike_backward", "emergency_backward", "moped_backward", "motorcycle_backward",
+        "pedestrian"}) {
+    none = none && kv.is(key, "false");
+  }
+  if (none && !kv.is("highway", "bridleway")) {
+    return false;
+  }
+
+  // toss actual areas
+  if (kv.is("area", "yes")) {
+    return false;
+  }
+
+  // toss where access=private and highway=service and service != driveway
+  if (kv.is("access", "private") && kv.is("highway", "service") &&
+      !kv.is("service", "driveway")) {
+    return false;
+  }
+
+  for (const auto* key : {"FIXME", "note", "source"}) {
+    kv.erase(key);
+  }
+
+  // set a few flags
+  auto road_class = kv.in_optional(kRoadClass, "highway");
+  if (!kv.has("highway") && ferry) {
+    // TODO: can we weight based on ferry types?
+    road_class = 2;
+  } else if (!kv.has("highway") && (kv.has("railway") || kv.is("route", "shuttle_train"))) {
+    // TODO: can we weight based on rail types?
+    road_class = 2;
+  } else if (!road_class) {
+    // service and other
+    road_class = 7;
+  }
+  kv.set_number("road_class", road_class);
+
+  auto default_speed = kDefaultSpeed[*road_class];
+  // lower the default speed for driveways
+  if (kv.is("service", "driveway")) {
+    default_speed = static_cast<uint32_t>(std::floor(default_speed * 0.5));
+  }
+
+  auto use = kv.in_optional(kUse, "service");
+  if (kv.has("highway")) {
+    if (kv.is("highway", "track")) {
+      use = 3;
+    } else if (kv.is("highway", "living_street")) {
+      use = 10;
+    } else if (kv.is("highway", "cycleway")) {
+      use = 20;
+    } else if (kv.is("pedestrian", "false") && kv.is("auto_forward", "false") &&
+               kv.is("auto_backward", "false") &&
+               (kv.is("bike_forward", "true") || kv.is("bike_backward", "true"))) {
+      use = 20;
+    } else if (kv.is("highway", "footway") && kv.is("footway", "sidewalk")) {
+      use = 24;
+    } else if (kv.is("highway", "footway")) {
+      use = 25;
+    } else if (kv.is("highway", "steps")) {
+      // steps/stairs
+      use = 26;
+    } else if (kv.is("highway", "path")) {
+      use = 27;
+    } else if (kv.is("highway", "pedestrian")) {
+      use = 28;
+    } else if (kv.is("pedestrian", "true") && kv.is("auto_forward", "false") &&
+               kv.is("auto_backward", "false") && kv.is("truck_forward", "false") &&
+               kv.is("truck_backward", "false") && kv.is("bus_forward", "false") &&
+               kv.is("bus_backward", "false") && kv.is("bike_forward", "false") &&
+               kv.is("bike_backward", "false") && kv.is("moped_forward", "false") &&
+               kv.is("moped_backward", "false") && kv.is("motorcycle_forward", "false") &&
+               kv.is("motorcycle_backward", "false")) {
+      use = 28;
+    } else if (kv.is("highway", "bridleway")) {
+      use = 29;
+    }
+  }
+  if (!use) {
+    // other or a general road without special use
+    use = kv.has("service") ? 40 : 0;
+  }
+  if (kv.is("access", "emergency") || kv.is("emergency", "yes")) {
+    use = 7;
+  }
+  kv.set_number("use", use);
+
+  auto r_shoulder = first({kv.in(kShoulder, "shoulder"), kv.in(kShoulder, "shoulder:both")});
+  auto l_shoulder = r_shoulder;
+  if (!r_shoulder) {
+    r_shoulder =
+        first({kv.in(kShoulder, "shoulder:right"), kv.in(kShoulderRight, "shoulder"), &kFalse});
+    l_shoulder =
+        first({kv.in(kShoulder, "shoulder:left"), kv.in(kShoulderLeft, "shoulder"), &kFalse});
+    // if the road is oneway and one shoulder is tagged but not the other we set both so that
+    // driving on the right or the left side doesn't miss the shoulder in the graph builder
+    if (oneway_norm && *oneway_norm == kTrue) {
+      if (*r_shoulder == kTrue && *l_shoulder == kFalse) {
+        l_shoulder = &kTrue;
+      } else if (*r_shoulder == kFalse && *l_shoulder == kTrue) {
+        r_shoulder = &kTrue;
+      }
+    }
+  }
+  kv.set("shoulder_right", r_shoulder);
+  kv.set("shoulder_left", l_shoulder);
+
+  const std::string* cycle_lane_right_opposite = &kFalse;
+  const std::string* cycle_lane_left_opposite = &kFalse;
+  uint32_t cycle_lane_right = 0;
+  uint32_t cycle_lane_left = 0;
+
+  // we have special use cases for cycle lanes on a cycleway, footway or path
+  if ((*use == 20 || *use == 25 || *use == 27) &&
+      (kv.is("bike_forward", "true") || kv.is("bike_backward", "true"))) {
+    if (kv.is("pedestrian", "false")) {
+      // separated
+      cycle_lane_right = 3;
+    } else if (kv.is("segregated", "yes")) {
+      // dedicated
+      cycle_lane_right = 2;
+    } else if (kv.is("segregated", "no")) {
+      // shared
+      cycle_lane_right = 1;
+    } else {
+      // without a segregated tag cycleways are assumed to have their own lanes while footways
+      // and paths are assumed to share them
+      cycle_lane_right = *use == 20 ? 2 : 1;
+    }
+    cycle_lane_left = cycle_lane_right;
+  } else {
+    // set flags if any of the lanes are marked opposite (contraflow)
+    cycle_lane_right_opposite = first({kv.in(kBikeReverse, "cycleway"), &kFalse});
+    cycle_lane_left_opposite = cycle_lane_right_opposite;
+    if (*cycle_lane_right_opposite == kFalse) {
+      cycle_lane_right_opposite = first({kv.in(kBikeReverse, "cycleway:right"), &kFalse});
+      cycle_lane_left_opposite = first({kv.in(kBikeReverse, "cycleway:left"), &kFalse});
+    }
+
+    // figure out which side of the road has what cycle lane
+    cycle_lane_right = cycle_lane(kv, "cycleway", "cycleway:both:buffer");
+    cycle_lane_left = cycle_lane_right;
+    if (cycle_lane_right == 0) {
+      cycle_lane_right = cycle_lane(kv, "cycleway:right", "cycleway:right:buffer");
+      cycle_lane_left = cycle_lane(kv, "cycleway:left", "cycleway:left:buffer");
+    }
+
+    // with oneway:bicycle=no and no opposite lanes the cycle lane is two way in some cases, based
+    // on the examples of wiki.openstreetmap.org/wiki/Bicycle
+    if (kv.is("oneway:bicycle", "no") && *cycle_lane_right_opposite == kFalse &&
+        *cycle_lane_left_opposite == kFalse) {
+      bool oneway = oneway_norm && *oneway_norm == kTrue;
+      if (cycle_lane_right == 2 || cycle_lane_right == 3) {
+        if (oneway) {
+          // example M1 or M2d but on the right side
+          cycle_lane_left = cycle_lane_right;
+          cycle_lane_left_opposite = &kTrue;
+        } else if (cycle_lane_left == 0) {
+          // example L1b
+          cycle_lane_left = cycle_lane_right;
+        }
+      } else if (cycle_lane_left == 2 || cycle_lane_left == 3) {
+        if (oneway) {
+          // example M2d
+          cycle_lane_right = cycle_lane_left;
+          cycle_lane_right_opposite = &kTrue;
+        } else if (cycle_lane_right == 0) {
+          // example L1b but on the left side
+          cycle_lane_right = cycle_lane_left;
+        }
+      }
+    }
+  }
+  kv.set("cycle_lane_right", std::to_string(cycle_lane_right));
+  kv.set("cycle_lane_left", std::to_string(cycle_lane_left));
+  kv.set("cycle_lane_right_opposite", cycle_lane_right_opposite);
+  kv.set("cycle_lane_left_opposite", cycle_lane_left_opposite);
+
+  if (kv.has("highway") && kv.get("highway")->find("_link") != std::string::npos) {
+    kv.set("link", kTrue);
+  }
+
+  kv.set("private", first({kv.in(kPrivate, "access"), kv.in(kPrivate, "motor_vehicle"), &kFalse}));
+  kv.set("no_thru_traffic", first({kv.in(kNoThruTraffic, "access"), &kFalse}));
+  kv.set("ferry", ferry ? kTrue : kFalse);
+  kv.set("rail", kv.is("auto_forward", "true") &&
+                         (kv.is("railway", "rail") || kv.is("route", "shuttle_train"))
+                     ? kTrue
+                     : kFalse);
+  kv.set_number("max_speed", normalize_speed(kv.get("maxspeed")));
+  kv.set_number("advisory_speed", normalize_speed(kv.get("maxspeed:advisory")));
+  kv.set_number("average_speed", normalize_speed(kv.get("maxspeed:practical")));
+  kv.set_number("backward_speed", normalize_speed(kv.get("maxspeed:backward")));
+  kv.set_number("forward_speed", normalize_speed(kv.get("maxspeed:forward")));
+  kv.set("wheelchair", kv.in(kWheelchair, "wheelchair"));
+
+  // lower the default speed for tracks
+  if (kv.is("highway", "track")) {
+    default_speed = 5;
+    if (kv.is("tracktype", "grade1")) {
+      default_speed = 20;
+    } else if (kv.is("tracktype", "grade2")) {
+      default_speed = 15;
+    } else if (kv.is("tracktype", "grade3")) {
+      default_speed = 12;
+    } else if (kv.is("tracktype", "grade4")) {
+      default_speed = 10;
+    }
+  }
+  kv.set("default_speed", std::to_string(default_speed));
+
+  // use unsigned_ref if all the conditions are met
+  if (!kv.has("name") && !kv.has("name:en") && !kv.has("alt_name") &&
+      !kv.has("official_name") && !kv.has("ref") && !kv.has("int_ref") &&
+      (kv.is("highway", "motorway") || kv.is("highway", "trunk") ||
+       kv.is("highway", "primary")) &&
+      kv.has("unsigned_ref")) {
+    kv.set("ref", kv.get("unsigned_ref"));
+  }
+
+  auto lane_count = [&kv](const char* key) {
+    auto lanes = numeric_prefix(kv.get(key), false);
+    return lanes && *lanes > 15 ? boost::none : lanes;
+  };
+  kv.set_number("lanes", lane_count("lanes"));
+  kv.set_number("forward_lanes", lane_count("lanes:forward"));
+  kv.set_number("backward_lanes", lane_count("lanes:backward"));
+
+  kv.set("bridge", first({kv.in(kBridge, "bridge"), &kFalse}));
+
+  // TODO: access:conditional
+  if (kv.has("seasonal") && !kv.is("seasonal", "no")) {
+    kv.set("seasonal", kTrue);
+  }
+
+  if (kv.is("hov", "no")) {
+    kv.set("hov_tag", kFalse);
+    kv.set("hov_forward", kFalse);
+    kv.set("hov_backward", kFalse);
+  } else {
+    kv.set("hov_forward", kv.get("auto_forward"));
+    kv.set("hov_backward", kv.get("auto_backward"));
+  }
+
+  // hov restrictions
+  if ((kv.has("hov") && !kv.is("hov", "no")) || kv.has("hov:lanes") || kv.has("hov:minimum")) {
+    kv.set("hov_tag", kTrue);
+    bool only_hov_allowed = kv.is("hov", "designated");
+    if (only_hov_allowed && kv.has("hov:lanes")) {
+      const auto& lanes = *kv.get("hov:lanes");
+      size_t start = 0;
+      do {
+        auto end = lanes.find('|', start);
+        auto lane = lanes.substr(start, end == std::string::npos ? end : end - start);
+        only_hov_allowed = only_hov_allowed && lane == "designated";
+        start = end == std::string::npos ? end : end + 1;
+      } while (start != std::string::npos);
+    }
+    if (only_hov_allowed) {
+      if (!kv.has("auto_tag")) {
+        kv.set("auto_forward", kFalse);
+        kv.set("auto_backward", kFalse);
+      }
+      if (!kv.has("truck_tag")) {
+        kv.set("truck_forward", kFalse);
+        kv.set("truck_backward", kFalse);
+      }
+      if (!kv.has("foot_tag")) {
+        kv.set("pedestrian", kFalse);
+      }
+      if (!kv.has("bike_tag")) {
+        kv.set("bike_forward", kFalse);
+        kv.set("bike_backward", kFalse);
+      }
+    }
+  }
+
+  kv.set("tunnel", first({kv.in(kTunnel, "tunnel"), &kFalse}));
+  kv.set("toll", first({kv.in(kToll, "toll"), &kFalse}));
+
+  // truck goodies
+  kv.set_number("maxheight", first({normalize_measurement(kv.get("maxheight")),
+                                    normalize_measurement(kv.get("maxheight:physical"))}));
+  kv.set_number("maxwidth", first({normalize_measurement(kv.get("maxwidth")),
+                                   normalize_measurement(kv.get("maxwidth:physical"))}));
+  kv.set_number("maxlength", normalize_measurement(kv.get("maxlength")));
+  kv.set_number("maxweight", normalize_weight(kv.get("maxweight")));
+  kv.set_number("maxaxleload", normalize_weight(kv.get("maxaxleload")));
+
+  // TODO: hazmat really should have subcategories
+  kv.set("hazmat", first({kv.in(kHazmat, "hazmat"), kv.in(kHazmat, "hazmat:water"),
+                          kv.in(kHazmat, "hazmat:A"), kv.in(kHazmat, "hazmat:B"),
+                          kv.in(kHazmat, "hazmat:C"), kv.in(kHazmat, "hazmat:D"),
+                          kv.in(kHazmat, "hazmat:E")}));
+  kv.set_number("maxspeed:hgv", normalize_speed(kv.get("maxspeed:hgv")));
+
+  if (kv.has("hgv:national_network") || kv.has("hgv:state_network") || kv.is("hgv", "local") ||
+      kv.is("hgv", "designated")) {
+    kv.set("truck_route", kTrue);
+  }
+
+  uint32_t bike_mask = 0;
+  if (kv.has("ncn_ref") || kv.is("ncn", "yes")) {
+    bike_mask |= 1;
+  }
+  if (kv.has("rcn_ref") || kv.is("rcn", "yes")) {
+    bike_mask |= 2;
+  }
+  if (kv.has("lcn_ref") || kv.is("lcn", "yes")) {
+    bike_mask |= 4;
+  }
+  if (kv.is("mtb", "yes")) {
+    bike_mask |= 8;
+  }
+  kv.set("bike_national_ref", kv.get("ncn_ref"));
+  kv.set("bike_regional_ref", kv.get("rcn_ref"));
+  kv.set("bike_local_ref", kv.get("lcn_ref"));
+  kv.set("bike_network_mask", std::to_string(bike_mask));
+  return true;
+}
+
+// rels_proc, returns false for the relations to filter out
+bool TransformRelation(Kv& kv) {
+  if (kv.is("type", "connectivity")) {
+    return true;
+  }
+  if (!kv.is("type", "route") && !kv.is("type", "restriction")) {
+    return false;
+  }
+
+  auto restrict = kv.in_optional(kRestriction, "restriction");
+  auto prefix = restriction_prefix(kv.get("restriction:conditional"));
+  if (!restrict && prefix) {
+    auto found = kRestriction.find(*prefix);
+    if (found != kRestriction.end()) {
+      restrict = found->second;
+    }
+  }
+  const std::initializer_list<const char*> typed = {
+      "restriction:hgv",      "restriction:emergency", "restriction:taxi",
+      "restriction:motorcar", "restriction:bus",       "restriction:bicycle",
+      "restriction:hazmat",   "restriction:motorcycle"};
+  boost::optional<uint32_t> restrict_type;
+  for (const auto* key : typed) {
+    restrict_type = restrict_type ? restrict_type : kv.in_optional(kRestriction, key);
+  }
+  // restrictions with a type win over the restriction key, people enter both
+  if (restrict_type) {
+    restrict = restrict_type;
+  }
+
+  if (kv.is("type", "restriction") || kv.has("restriction:conditional")) {
+    if (!restrict) {
+      return false;
+    }
+    auto suffix = restriction_suffix(kv.get("restriction:conditional"));
+    kv.set("restriction:conditional", suffix ? &*suffix : nullptr);
+    for (const auto* key : typed) {
+      kv.set_number(key, kv.in_optional(kRestriction, key));
+    }
+    if (restrict_type) {
+      kv.erase("restriction");
+    } else {
+      kv.set_number("restriction", restrict);
+    }
+    return true;
+  }
+
+  if (kv.is("route", "bicycle") || kv.is("route", "mtb")) {
+    uint32_t bike_mask = kv.is("network", "mtb") || kv.is("route", "mtb") ? 8 : 0;
+    if (kv.is("network", "ncn")) {
+      bike_mask |= 1;
+    } else if (kv.is("network", "rcn")) {
+      bike_mask |= 2;
+    } else if (kv.is("network", "lcn")) {
+      bike_mask |= 4;
+    }
+    kv.set("bike_network_mask", std::to_string(bike_mask));
+  } else if (restrict) {
+    // has a restriction but the type is not restriction, ignore it
+    return false;
+  }
+  kv.erase("day_on");
+  kv.erase("day_off");
+  kv.erase("restriction");
+  return true;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+Tags NativeTagTransform::Transform(OSMType type, const Tags& tags) const {
+  Kv kv(tags);
+  switch (type) {
+    case OSMType::kNode:
+      TransformNode(kv);
+      break;
+    case OSMType::kWay:
+      // ways without tags are of no use
+      if (tags.empty() || !TransformWay(kv)) {
+        return {};
+      }
+      break;
+    default:
+      if (!TransformRelation(kv)) {
+        return {};
+      }
+      break;
+  }
+  return std::move(kv.tags());
+}
+
+} // namespace mjolnir
+} // namespace valhalla
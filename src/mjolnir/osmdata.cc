@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <type_traits>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -26,169 +27,60 @@ const std::string node_names_file = "osmdata_node_names.bin";
 const std::string unique_names_file = "osmdata_unique_strings.bin";
 const std::string lane_connectivity_file = "osmdata_lane_connectivity.bin";
 
-// Data structures to assist writing and reading data
-struct TempRestriction {
-  uint32_t way_id;
-  OSMRestriction restriction;
-  TempRestriction() : way_id(0), restriction(OSMRestriction()) {
-  }
-  TempRestriction(const uint32_t w, const OSMRestriction& r) : way_id(w), restriction(r) {
-  }
-};
-
-struct TempWayRef {
-  uint32_t way_id;
-  uint32_t name_index;
-  TempWayRef() : way_id(0), name_index(0) {
-  }
-  TempWayRef(const uint32_t w, const uint32_t& index) : way_id(w), name_index(index) {
-  }
-};
-
-struct BikeRelation {
-  uint32_t way_id;
-  OSMBike relation;
-  BikeRelation() : way_id(0), relation(OSMBike()) {
-  }
-  BikeRelation(const uint32_t w, const OSMBike& r) : way_id(w), relation(r) {
-  }
-};
-
-struct TempAccessRestriction {
-  uint32_t way_id;
-  OSMAccessRestriction restriction;
-  TempAccessRestriction() : way_id(0), restriction(OSMAccessRestriction()) {
-  }
-  TempAccessRestriction(const uint32_t w, const OSMAccessRestriction& r) : way_id(w), restriction(r) {
-  }
-};
-
-struct TempLaneConnectivity {
-  uint32_t way_id;
-  OSMLaneConnectivity lane;
-  TempLaneConnectivity() : way_id(0), lane(OSMLaneConnectivity()) {
-  }
-  TempLaneConnectivity(const uint32_t w, const OSMLaneConnectivity& l) : way_id(w), lane(l) {
-  }
-};
-
-bool write_restrictions(const std::string& filename, const RestrictionsMultiMap& res_map) {
+// Write the pairs (or keys) of a sorted map, the count and then the items as they are
+template <class T> bool write_sorted(const std::string& filename, const T& sorted) {
   // Open file and truncate
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (!file.is_open()) {
-    LOG_ERROR("write_restrictions failed to open output file: " + filename);
+    LOG_ERROR("write_sorted failed to open output file: " + filename);
     return false;
   }
 
-  // Convert the multi map into a vector of TempRestriction
-  std::vector<TempRestriction> res;
-  for (auto it = res_map.cbegin(); it != res_map.cend(); ++it) {
-    res.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = res.size();
+  const auto& items = sorted.items();
+  uint32_t sz = items.size();
   file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(res.data()), res.size() * sizeof(TempRestriction));
+  file.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(items[0]));
   file.close();
   return true;
 }
 
-bool write_viaset(const std::string& filename, const ViaSet& via_set) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_viaset failed to open output file: " + filename);
-    return false;
-  }
-
-  // Create a vector to hold the elements of the via set
-  uint32_t i = 0;
-  std::vector<uint32_t> via_vector(via_set.size());
-  for (const auto v : via_set) {
-    via_vector[i] = v;
-    ++i;
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = via_vector.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(via_vector.data()), via_vector.size() * sizeof(uint32_t));
-  file.close();
-  return true;
-}
-
-bool write_access_restrictions(const std::string& filename,
-                               const AccessRestrictionsMultiMap& access_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_access_restrictions failed to open output file: " + filename);
-    return false;
-  }
-
-  // Convert the multi map into a vector of TempAccessRestriction
-  std::vector<TempAccessRestriction> res;
-  for (auto it = access_map.cbegin(); it != access_map.cend(); ++it) {
-    res.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = res.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(res.data()), res.size() * sizeof(TempAccessRestriction));
-  file.close();
-  return true;
-}
-
-bool write_bike_relations(const std::string& filename, const BikeMultiMap& bike_relations) {
-  // Open file and truncate
-  std::stringstream in_mem;
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+// Read back what write_sorted wrote, no need to sort again
+template <class T> bool read_sorted(const std::string& filename, T& sorted) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
   if (!file.is_open()) {
-    LOG_ERROR("write_bike_relations failed to open output file: " + filename);
+    LOG_ERROR("read_sorted failed to open input file: " + filename);
     return false;
   }
 
-  // Create a vector of bike relations from the multimap
-  std::vector<BikeRelation> relations;
-  for (auto it = bike_relations.cbegin(); it != bike_relations.cend(); ++it) {
-    relations.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the bike relations
-  uint32_t sz = relations.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(relations.data()),
-             relations.size() * sizeof(BikeRelation));
+  // Read the count and then the items
+  uint32_t count = 0;
+  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
+  typename std::remove_const<typename std::remove_reference<decltype(sorted.items())>::type>::type
+      items(count);
+  file.read(reinterpret_cast<char*>(items.data()), count * sizeof(items[0]));
   file.close();
+  sorted.assign_sorted(std::move(items));
   return true;
 }
 
-bool write_way_refs(const std::string& filename, const OSMStringMap& way_refs) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_way_refs failed to open output file: " + filename);
-    return false;
-  }
-
-  // Store the way Id keys and name indexes in a TempWayRef vector
-  uint32_t i = 0;
-  std::vector<TempWayRef> temp_wayrefs(way_refs.size());
-  std::vector<char> strings;
-  for (const auto& s : way_refs) {
-    temp_wayrefs[i] = {s.first, s.second};
-    ++i;
+// Sort the entries of a way ref map and join the refs of each way into one
+void join_refs(OSMStringMap& refs, UniqueNames& names) {
+  refs.sort();
+  std::vector<OSMStringMap::value_type> joined;
+  for (auto it = refs.begin(); it != refs.end();) {
+    uint32_t way_id = it->first;
+    uint32_t index = it->second;
+    if (++it == refs.end() || it->first != way_id) {
+      joined.emplace_back(way_id, index);
+      continue;
+    }
+    std::string ref = names.name(index);
+    for (; it != refs.end() && it->first == way_id; ++it) {
+      ref += ";" + names.name(it->second);
+    }
+    joined.emplace_back(way_id, names.index(ref));
   }
-
-  // Write the count and then the TempWayRefs
-  uint32_t sz = temp_wayrefs.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(temp_wayrefs.data()),
-             temp_wayrefs.size() * sizeof(TempWayRef));
-  file.close();
-  return true;
+  refs.assign_sorted(std::move(joined));
 }
 
 bool write_node_names(const std::string& filename, const UniqueNames& names) {
@@ -253,140 +145,6 @@ bool write_unique_names(const std::string& filename, const UniqueNames& names) {
   return true;
 }
 
-bool write_lane_connectivity(const std::string& filename,
-                             const OSMLaneConnectivityMultiMap& lane_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_lane_connectivity failed to open output file: " + filename);
-    return false;
-  }
-
-  // Convert the multi map into a vector of TempLaneConnectivity
-  std::vector<TempLaneConnectivity> lanes;
-  for (auto it = lane_map.cbegin(); it != lane_map.cend(); ++it) {
-    lanes.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = lanes.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(lanes.data()),
-             lanes.size() * sizeof(TempLaneConnectivity));
-  file.close();
-  return true;
-  return true;
-}
-
-bool read_restrictions(const std::string& filename, RestrictionsMultiMap& res_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_restrictions failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary restriction list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempRestriction> access_res(count);
-  file.read(reinterpret_cast<char*>(access_res.data()), count * sizeof(TempRestriction));
-  file.close();
-
-  // Iterate through the temporary restriction list and add to the restriction multi-map
-  for (const auto& r : access_res) {
-    res_map.insert({r.way_id, r.restriction});
-  }
-  return true;
-}
-
-bool read_viaset(const std::string& filename, ViaSet& via_set) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_viaset failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the via ids
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<uint32_t> via_vector(count);
-  file.read(reinterpret_cast<char*>(via_vector.data()), count * sizeof(uint32_t));
-  file.close();
-
-  // Iterate through the vector of via Ids and add them to the via set
-  for (const auto v : via_vector) {
-    via_set.insert(v);
-  }
-  return true;
-}
-
-bool read_access_restrictions(const std::string& filename, AccessRestrictionsMultiMap& access_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_access_restrictions failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary access restriction list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempAccessRestriction> access_res(count);
-  file.read(reinterpret_cast<char*>(access_res.data()), count * sizeof(TempAccessRestriction));
-  file.close();
-
-  // Iterate through the temporary access restriction list and add to the restriction multi-map
-  for (const auto& r : access_res) {
-    access_map.insert({r.way_id, r.restriction});
-  }
-  return true;
-}
-
-bool read_bike_relations(const std::string& filename, BikeMultiMap& bike_relations) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_bike_relations failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the bike relations list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<BikeRelation> rel(count);
-  file.read(reinterpret_cast<char*>(rel.data()), count * sizeof(BikeRelation));
-  file.close();
-
-  // Iterate through the temporary bike relations list and add to the bike relations multi-map
-  for (const auto& r : rel) {
-    bike_relations.insert({r.way_id, r.relation});
-  }
-  return true;
-}
-
-bool read_way_refs(const std::string& filename, OSMStringMap& way_refs) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_way_refs failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the wayids (keys)
-  uint32_t count;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempWayRef> temp_wayrefs(count);
-  file.read(reinterpret_cast<char*>(temp_wayrefs.data()), sizeof(TempWayRef) * count);
-
-  // Iterate through the temp wayrefs and form map
-  for (const auto& r : temp_wayrefs) {
-    way_refs[r.way_id] = r.name_index;
-  }
-  return true;
-}
-
 bool read_node_names(const std::string& filename, UniqueNames& names) {
   // Open file and truncate
   std::ifstream file(filename, std::ios::in | std::ios::binary);
@@ -451,28 +209,6 @@ bool read_unique_names(const std::string& filename, UniqueNames& names) {
   return true;
 }
 
-bool read_lane_connectivity(const std::string& filename, OSMLaneConnectivityMultiMap& lane_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_lane_connectivity failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary lane connectivity list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempLaneConnectivity> lanes(count);
-  file.read(reinterpret_cast<char*>(lanes.data()), count * sizeof(TempLaneConnectivity));
-  file.close();
-
-  // Iterate through the temporary lane connectivity list and add to the lane connectivity multi-map
-  for (const auto& l : lanes) {
-    lane_map.insert({l.way_id, l.lane});
-  }
-  return true;
-}
-
 } // namespace
 
 namespace valhalla {
@@ -501,16 +237,17 @@ bool OSMData::write_to_temp_files(const std::string& tile_dir) {
   file.write(reinterpret_cast<const char*>(&node_exit_to_count), sizeof(size_t));
   file.close();
 
-  // Write the rest of OSMData
-  bool status = write_restrictions(tile_dir + restrictions_file, restrictions) &&
-                write_viaset(tile_dir + viaset_file, via_set) &&
-                write_access_restrictions(tile_dir + access_restrictions_file, access_restrictions) &&
-                write_bike_relations(tile_dir + bike_relations_file, bike_relations) &&
-                write_way_refs(tile_dir + way_ref_file, way_ref) &&
-                write_way_refs(tile_dir + way_ref_rev_file, way_ref_rev) &&
+  // Write the rest of OSMData, the maps are written sorted so reading them needs no work
+  sort_maps();
+  bool status = write_sorted(tile_dir + restrictions_file, restrictions) &&
+                write_sorted(tile_dir + viaset_file, via_set) &&
+                write_sorted(tile_dir + access_restrictions_file, access_restrictions) &&
+                write_sorted(tile_dir + bike_relations_file, bike_relations) &&
+                write_sorted(tile_dir + way_ref_file, way_ref) &&
+                write_sorted(tile_dir + way_ref_rev_file, way_ref_rev) &&
                 write_node_names(tile_dir + node_names_file, node_names) &&
                 write_unique_names(tile_dir + unique_names_file, name_offset_map) &&
-                write_lane_connectivity(tile_dir + lane_connectivity_file, lane_connectivity_map);
+                write_sorted(tile_dir + lane_connectivity_file, lane_connectivity_map);
   LOG_INFO("Done");
   return status;
 }
@@ -539,15 +276,15 @@ bool OSMData::read_from_temp_files(const std::string& tile_dir) {
   file.close();
 
   // Read the other data
-  bool status = read_restrictions(tile_dir + restrictions_file, restrictions) &&
-                read_viaset(tile_dir + viaset_file, via_set) &&
-                read_access_restrictions(tile_dir + access_restrictions_file, access_restrictions) &&
-                read_bike_relations(tile_dir + bike_relations_file, bike_relations) &&
-                read_way_refs(tile_dir + way_ref_file, way_ref) &&
-                read_way_refs(tile_dir + way_ref_rev_file, way_ref_rev) &&
+  bool status = read_sorted(tile_dir + restrictions_file, restrictions) &&
+                read_sorted(tile_dir + viaset_file, via_set) &&
+                read_sorted(tile_dir + access_restrictions_file, access_restrictions) &&
+                read_sorted(tile_dir + bike_relations_file, bike_relations) &&
+                read_sorted(tile_dir + way_ref_file, way_ref) &&
+                read_sorted(tile_dir + way_ref_rev_file, way_ref_rev) &&
                 read_node_names(tile_dir + node_names_file, node_names) &&
                 read_unique_names(tile_dir + unique_names_file, name_offset_map) &&
-                read_lane_connectivity(tile_dir + lane_connectivity_file, lane_connectivity_map);
+                read_sorted(tile_dir + lane_connectivity_file, lane_connectivity_map);
   LOG_INFO("Done");
   return status;
 }
@@ -562,6 +299,17 @@ bool OSMData::read_from_unique_names_file(const std::string& tile_dir) {
   return status;
 }
 
+// Sort the maps so they can be looked up
+void OSMData::sort_maps() {
+  restrictions.sort();
+  via_set.sort();
+  access_restrictions.sort();
+  bike_relations.sort();
+  lane_connectivity_map.sort();
+  join_refs(way_ref, name_offset_map);
+  join_refs(way_ref_rev, name_offset_map);
+}
+
 // add the direction information to the forward or reverse map for relations.
 void OSMData::add_to_name_map(const uint32_t member_id,
                               const std::string& direction,
@@ -577,22 +325,11 @@ void OSMData::add_to_name_map(const uint32_t member_id,
        boost::starts_with(dir, "East (") || boost::starts_with(dir, "West (")) ||
       dir == "North" || dir == "South" || dir == "East" || dir == "West") {
 
+    // the refs of a way are joined together once parsing is done, see sort_maps
     if (forward) {
-      auto iter = way_ref.find(member_id);
-      if (iter != way_ref.end()) {
-        std::string ref = name_offset_map.name(iter->second);
-        way_ref[member_id] = name_offset_map.index(ref + ";" + reference + "|" + dir);
-      } else {
-        way_ref[member_id] = name_offset_map.index(reference + "|" + dir);
-      }
+      way_ref.insert({member_id, name_offset_map.index(reference + "|" + dir)});
     } else {
-      auto iter = way_ref_rev.find(member_id);
-      if (iter != way_ref_rev.end()) {
-        std::string ref = name_offset_map.name(iter->second);
-        way_ref_rev[member_id] = name_offset_map.index(ref + ";" + reference + "|" + dir);
-      } else {
-        way_ref_rev[member_id] = name_offset_map.index(reference + "|" + dir);
-      }
+      way_ref_rev.insert({member_id, name_offset_map.index(reference + "|" + dir)});
     }
   }
 }
@@ -33,6 +33,9 @@
 #else
 #include <netinet/in.h>
 #endif
+#include <deque>
+#include <future>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <zlib.h>
@@ -81,9 +84,7 @@ BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
   return result;
 }
 
-int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
-  Blob blob;
-
+void read_blob_bytes(char* buffer, std::ifstream& file, const BlobHeader& header) {
   // is the size of the following blob sane
   int32_t sz = header.datasize();
   if (sz > MAX_UNCOMPRESSED_BLOB_SIZE) {
@@ -94,6 +95,10 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   if (!file.read(buffer, sz)) {
     throw std::runtime_error("unable to read blob from file");
   }
+}
+
+int32_t unpack_blob(const char* buffer, int32_t sz, char* unpack_buffer) {
+  Blob blob;
 
   // turn it into a protobuf object
   if (!blob.ParseFromArray(buffer, sz)) {
@@ -139,28 +144,25 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   throw std::runtime_error("Unsupported blob data format");
 }
 
+int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
+  read_blob_bytes(buffer, file, header);
+  return unpack_blob(buffer, header.datasize(), unpack_buffer);
+}
+
+// the keys and values are copied straight from the string table of the block, which holds each
+// of them once
 template <class T> OSMPBF::Tags get_tags(const T& object, const OSMPBF::PrimitiveBlock& primblock) {
   OSMPBF::Tags result(object.keys_size());
+  const auto& strings = primblock.stringtable();
   for (int i = 0; i < object.keys_size(); ++i) {
-    uint64_t key = object.keys(i);
-    uint64_t val = object.vals(i);
-    std::string key_string = primblock.stringtable().s(key);
-    std::string val_string = primblock.stringtable().s(val);
-    result[key_string] = val_string;
+    result[strings.s(object.keys(i))] = strings.s(object.vals(i));
   }
   return result;
 }
 
-void parse_primitive_block(char* unpack_buffer,
-                           int32_t sz,
-                           const Interest interest,
-                           Callback& callback) {
-  // turn the blob bytes into a protobuf object
-  PrimitiveBlock primblock;
-  if (!primblock.ParseFromArray(unpack_buffer, sz)) {
-    throw std::runtime_error("unable to parse primitive block");
-  }
-
+void deliver_primitive_block(const PrimitiveBlock& primblock,
+                             const Interest interest,
+                             Callback& callback) {
   // for each primitive group
   for (const auto& primitive_group : primblock.primitivegroup()) {
 
@@ -170,7 +172,9 @@ void parse_primitive_block(char* unpack_buffer,
       for (const auto& node : primitive_group.nodes()) {
         double lon = 0.000000001 * (primblock.lon_offset() + (primblock.granularity() * node.lon()));
         double lat = 0.000000001 * (primblock.lat_offset() + (primblock.granularity() * node.lat()));
-        callback.node_callback(node.id(), lon, lat, get_tags<Node>(node, primblock));
+        bool wanted = callback.wants_tags(NODES, node.id());
+        callback.node_callback(node.id(), lon, lat,
+                               wanted ? get_tags<Node>(node, primblock) : Tags());
         if (node.has_info() && node.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS) {
           callback.changeset_callback(node.info().changeset());
         }
@@ -193,14 +197,15 @@ void parse_primitive_block(char* unpack_buffer,
 
           // can't exactly preallocate because you don't know how many there are
           Tags tags;
+          bool wanted = callback.wants_tags(NODES, id);
+          const auto& strings = primblock.stringtable();
           while (current_kv < dense_nodes.keys_vals_size() &&
                  dense_nodes.keys_vals(current_kv) != 0) {
-            uint64_t key = dense_nodes.keys_vals(current_kv);
-            uint64_t val = dense_nodes.keys_vals(current_kv + 1);
-            std::string key_string = primblock.stringtable().s(key);
-            std::string val_string = primblock.stringtable().s(val);
+            if (wanted) {
+              tags[strings.s(dense_nodes.keys_vals(current_kv))] =
+                  strings.s(dense_nodes.keys_vals(current_kv + 1));
+            }
             current_kv += 2;
-            tags[key_string] = val_string;
           }
           ++current_kv;
           callback.node_callback(id, lon, lat, tags);
@@ -227,7 +232,10 @@ void parse_primitive_block(char* unpack_buffer,
             nodes.push_back(node);
           }
         }
-        callback.way_callback(way.id(), get_tags<Way>(way, primblock), nodes);
+        callback.way_callback(way.id(),
+                              callback.wants_tags(WAYS, way.id()) ? get_tags<Way>(way, primblock)
+                                                                  : Tags(),
+                              nodes);
         if (way.has_info() && way.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS) {
           callback.changeset_callback(way.info().changeset());
         }
@@ -245,7 +253,11 @@ void parse_primitive_block(char* unpack_buffer,
           members.emplace_back(relation.types(l), member,
                                primblock.stringtable().s(relation.roles_sid(l)));
         }
-        callback.relation_callback(relation.id(), get_tags<Relation>(relation, primblock), members);
+        callback.relation_callback(relation.id(),
+                                   callback.wants_tags(RELATIONS, relation.id())
+                                       ? get_tags<Relation>(relation, primblock)
+                                       : Tags(),
+                                   members);
         if (relation.has_info() && relation.info().has_changeset() &&
             (interest & CHANGESETS) == CHANGESETS) {
           callback.changeset_callback(relation.info().changeset());
@@ -262,6 +274,39 @@ void parse_primitive_block(char* unpack_buffer,
   }
 }
 
+// which kinds of objects are in the block
+uint8_t block_contents(const PrimitiveBlock& primblock) {
+  uint8_t contents = NONE;
+  for (const auto& primitive_group : primblock.primitivegroup()) {
+    if (primitive_group.nodes_size() > 0 || primitive_group.has_dense()) {
+      contents |= NODES;
+    }
+    if (primitive_group.ways_size() > 0) {
+      contents |= WAYS;
+    }
+    if (primitive_group.relations_size() > 0) {
+      contents |= RELATIONS;
+    }
+    if (primitive_group.changesets_size() > 0) {
+      contents |= CHANGESETS;
+    }
+  }
+  return contents;
+}
+
+uint8_t parse_primitive_block(char* unpack_buffer,
+                              int32_t sz,
+                              const Interest interest,
+                              Callback& callback) {
+  // turn the blob bytes into a protobuf object
+  PrimitiveBlock primblock;
+  if (!primblock.ParseFromArray(unpack_buffer, sz)) {
+    throw std::runtime_error("unable to parse primitive block");
+  }
+  deliver_primitive_block(primblock, interest, callback);
+  return block_contents(primblock);
+}
+
 void parse_header_block(char* unpack_buffer, int32_t sz) {
   // turn the blob bytes into a protobuf object
   HeaderBlock header_block;
@@ -272,6 +317,129 @@ void parse_header_block(char* unpack_buffer, int32_t sz) {
   // TODO: do something with replication information?
 }
 
+// walks the blobs of a file: all of them while filling in an index or without one, otherwise only
+// the ones the index says hold something of interest
+class blob_cursor_t {
+public:
+  blob_cursor_t(std::ifstream& file, const Interest interest, BlobIndex* index)
+      : file_(file), interest_(interest), index_(index),
+        indexed_(index != nullptr && !index->entries.empty()), next_entry_(0) {
+    // start from the top
+    file_.clear();
+    file_.seekg(0, std::ios::beg);
+  }
+
+  // reads the header of the next blob to parse, false once there are none left
+  bool next(char* buffer, BlobHeader& header) {
+    if (indexed_) {
+      // skip the blobs without anything we are interested in
+      while (next_entry_ < index_->entries.size() &&
+             (index_->entries[next_entry_].contents & interest_) == 0) {
+        ++next_entry_;
+      }
+      if (next_entry_ == index_->entries.size()) {
+        return false;
+      }
+      // only seek when the blob isnt the one we are already at
+      uint64_t offset = index_->entries[next_entry_++].offset;
+      if (static_cast<uint64_t>(file_.tellg()) != offset) {
+        file_.seekg(offset, std::ios::beg);
+      }
+    } else if (index_) {
+      index_->entries.push_back({static_cast<uint64_t>(file_.tellg()), NONE});
+    }
+
+    bool finished = false;
+    header = read_header(buffer, file_, finished);
+    if (finished && index_ && !indexed_) {
+      index_->entries.pop_back();
+    }
+    return !finished;
+  }
+
+  // records what the nth blob returned by next holds when filling in the index
+  void set_contents(const size_t n, const uint8_t contents) {
+    if (index_ && !indexed_) {
+      index_->entries[n].contents = contents;
+    }
+  }
+
+protected:
+  std::ifstream& file_;
+  const Interest interest_;
+  BlobIndex* index_;
+  const bool indexed_;
+  size_t next_entry_;
+};
+
+// a blob read from the file but not yet decoded
+struct raw_blob_t {
+  std::string type;
+  std::vector<char> bytes;
+};
+
+// a decoded blob, only data blobs have a primitive block
+using decoded_blob_t = std::unique_ptr<PrimitiveBlock>;
+
+decoded_blob_t decode_blob(const raw_blob_t& raw) {
+  std::unique_ptr<char[]> unpack_buffer(new char[MAX_UNCOMPRESSED_BLOB_SIZE]);
+  int32_t sz = unpack_blob(raw.bytes.data(), raw.bytes.size(), unpack_buffer.get());
+  if (raw.type == "OSMData") {
+    decoded_blob_t primblock(new PrimitiveBlock());
+    if (!primblock->ParseFromArray(unpack_buffer.get(), sz)) {
+      throw std::runtime_error("unable to parse primitive block");
+    }
+    return primblock;
+  } else if (raw.type == "OSMHeader") {
+    parse_header_block(unpack_buffer.get(), sz);
+  } else {
+    LOG_WARN("Unknown blob type: " + raw.type);
+  }
+  return nullptr;
+}
+
+// reads blobs in order while up to threads of them are inflated and decoded in the background,
+// the decoded blobs are handed to the callback in the same order they were read
+void parse_concurrently(char* buffer,
+                        std::ifstream& file,
+                        blob_cursor_t& cursor,
+                        const Interest interest,
+                        Callback& callback,
+                        const unsigned int threads) {
+  // a couple more blobs than threads are in flight so the threads never wait on the reader
+  const size_t max_in_flight = threads * 2;
+  std::deque<std::future<decoded_blob_t>> in_flight;
+  size_t delivered = 0;
+  const auto deliver_oldest = [&]() {
+    decoded_blob_t primblock = in_flight.front().get();
+    in_flight.pop_front();
+    if (primblock) {
+      deliver_primitive_block(*primblock, interest, callback);
+      cursor.set_contents(delivered, block_contents(*primblock));
+    }
+    ++delivered;
+  };
+
+  // grab the blob header and the blob that goes with it
+  BlobHeader header;
+  while (cursor.next(buffer, header)) {
+    std::shared_ptr<raw_blob_t> raw(new raw_blob_t{header.type(), {}});
+    read_blob_bytes(buffer, file, header);
+    raw->bytes.assign(buffer, buffer + header.datasize());
+
+    // decode it in the background, waiting for the oldest one if too many are in flight
+    if (in_flight.size() == max_in_flight) {
+      deliver_oldest();
+    }
+    in_flight.emplace_back(std::async(std::launch::async, [raw]() { return decode_blob(*raw); }));
+  }
+
+  // hand out what is left
+  while (!in_flight.empty()) {
+    deliver_oldest();
+  }
+}
+
 } // namespace
 
 // extend the protobuf osmpbf namespace
@@ -285,38 +453,35 @@ Member::Member(Member&& other)
     : member_type(other.member_type), member_id(other.member_id), role(std::move(other.role)) {
 }
 
-void Parser::parse(std::ifstream& file, const Interest interest, Callback& callback) {
-  char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-  char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-
-  // start from the top
-  file.clear();
-  file.seekg(0, std::ios::beg);
+void Parser::parse(std::ifstream& file,
+                   const Interest interest,
+                   Callback& callback,
+                   const unsigned int threads,
+                   BlobIndex* index) {
+  std::unique_ptr<char[]> buffer(new char[MAX_UNCOMPRESSED_BLOB_SIZE]);
+  blob_cursor_t cursor(file, interest, index);
+
+  // decode blobs in the background
+  if (threads > 1) {
+    parse_concurrently(buffer.get(), file, cursor, interest, callback, threads);
+    return;
+  }
 
-  // while there is more to read
-  while (!file.eof()) {
-    // grab the blob header
-    bool finished = false;
-    BlobHeader header = read_header(buffer, file, finished);
-    // if we didnt hit the end
-    if (!finished) {
-      // grab the blob that goes with the blob header
-      int32_t sz = read_blob(buffer, unpack_buffer, file, header);
-      // if its data parse it
-      if (header.type() == "OSMData") {
-        parse_primitive_block(unpack_buffer, sz, interest, callback);
-        // if its something other than a header
-      } else if (header.type() == "OSMHeader") {
-        parse_header_block(unpack_buffer, sz);
-      } else {
-        LOG_WARN("Unknown blob type: " + header.type());
-      }
+  // while there is more to read grab the blob header and the blob that goes with it
+  std::unique_ptr<char[]> unpack_buffer(new char[MAX_UNCOMPRESSED_BLOB_SIZE]);
+  BlobHeader header;
+  for (size_t n = 0; cursor.next(buffer.get(), header); ++n) {
+    int32_t sz = read_blob(buffer.get(), unpack_buffer.get(), file, header);
+    // if its data parse it
+    if (header.type() == "OSMData") {
+      cursor.set_contents(n, parse_primitive_block(unpack_buffer.get(), sz, interest, callback));
+      // if its something other than a header
+    } else if (header.type() == "OSMHeader") {
+      parse_header_block(unpack_buffer.get(), sz);
+    } else {
+      LOG_WARN("Unknown blob type: " + header.type());
     }
   }
-
-  // done with protobuf and buffers
-  delete[] buffer;
-  delete[] unpack_buffer;
 }
 
 void Parser::free() {
@@ -11,6 +11,7 @@
 #include <boost/format.hpp>
 #include <future>
 #include <thread>
+#include <tuple>
 #include <utility>
 
 #include "baldr/tilehierarchy.h"
@@ -43,6 +44,11 @@ public:
         lua_(std::string(lua_admin_lua, lua_admin_lua + lua_admin_lua_len)) {
   }
 
+  // only the tags of the relations are used
+  virtual bool wants_tags(const OSMPBF::Interest type, const uint64_t osmid) override {
+    return type == OSMPBF::RELATIONS;
+  }
+
   virtual void
   node_callback(const uint64_t osmid, double lng, double lat, const OSMPBF::Tags& tags) override {
     // Check if it is in the list of nodes used by ways
@@ -151,14 +157,22 @@ OSMAdminData PBFAdminParser::Parse(const boost::property_tree::ptree& pt,
   OSMAdminData osmdata{};
   admin_callback callback(pt, osmdata);
 
+  // Blobs are decoded on this many threads, the callbacks stay on this one
+  unsigned int threads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+
   LOG_INFO("Parsing files: " + boost::algorithm::join(input_files, ", "));
 
   // hold open all the files so that if something else (like diff application)
-  // needs to mess with them we wont have troubles with inodes changing underneath us
-  std::list<std::ifstream> file_handles;
+  // needs to mess with them we wont have troubles with inodes changing underneath us. the first
+  // pass over each file indexes its blobs so the later passes only read the ones they care about
+  std::list<std::pair<std::ifstream, OSMPBF::BlobIndex>> file_handles;
   for (const auto& input_file : input_files) {
-    file_handles.emplace_back(input_file, std::ios::binary);
-    if (!file_handles.back().is_open()) {
+    file_handles.emplace_back(std::piecewise_construct,
+                              std::forward_as_tuple(input_file, std::ios::binary),
+                              std::forward_as_tuple());
+    if (!file_handles.back().first.is_open()) {
       throw std::runtime_error("Unable to open: " + input_file);
     }
   }
@@ -166,10 +180,10 @@ OSMAdminData PBFAdminParser::Parse(const boost::property_tree::ptree& pt,
   // Parse each input file for relations
   LOG_INFO("Parsing relations...");
   for (auto& file_handle : file_handles) {
-    OSMPBF::Parser::parse(file_handle,
+    OSMPBF::Parser::parse(file_handle.first,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads, &file_handle.second);
   }
   LOG_INFO("Finished with " + std::to_string(osmdata.admins_.size()) +
            " admin polygons comprised of " + std::to_string(osmdata.osm_way_count) + " ways");
@@ -177,10 +191,10 @@ OSMAdminData PBFAdminParser::Parse(const boost::property_tree::ptree& pt,
   // Parse the ways.
   LOG_INFO("Parsing ways...");
   for (auto& file_handle : file_handles) {
-    OSMPBF::Parser::parse(file_handle,
+    OSMPBF::Parser::parse(file_handle.first,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads, &file_handle.second);
   }
   LOG_INFO("Finished with " + std::to_string(osmdata.way_map.size()) + " ways comprised of " +
            std::to_string(osmdata.node_count) + " nodes");
@@ -189,10 +203,10 @@ OSMAdminData PBFAdminParser::Parse(const boost::property_tree::ptree& pt,
   // being used in a way.
   LOG_INFO("Parsing nodes...");
   for (auto& file_handle : file_handles) {
-    OSMPBF::Parser::parse(file_handle,
+    OSMPBF::Parser::parse(file_handle.first,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads, &file_handle.second);
   }
   LOG_INFO("Finished with " + std::to_string(osmdata.osm_node_count) + " nodes");
 
@@ -5,6 +5,7 @@
 #include "graph_lua_proc.h"
 #include "mjolnir/idtable.h"
 #include "mjolnir/luatagtransform.h"
+#include "mjolnir/nativetagtransform.h"
 #include "mjolnir/osmaccess.h"
 
 #include <boost/algorithm/string.hpp>
@@ -12,7 +13,9 @@
 #include <boost/optional.hpp>
 #include <boost/range/algorithm/remove_if.hpp>
 #include <future>
+#include <memory>
 #include <thread>
+#include <tuple>
 #include <utility>
 
 #include "baldr/complexrestriction.h"
@@ -50,7 +53,15 @@ public:
   }
 
   graph_callback(const boost::property_tree::ptree& pt, OSMData& osmdata)
-      : shape_(kMaxOSMNodeId), intersection_(kMaxOSMNodeId), osmdata_(osmdata), lua_(get_lua(pt)) {
+      : shape_(kMaxOSMNodeId), intersection_(kMaxOSMNodeId), osmdata_(osmdata) {
+
+    // custom scripts need lua, the default script can be run natively
+    if (pt.get<std::string>("tag_transform", "lua") == "native" &&
+        !pt.get_optional<std::string>("graph_lua_name")) {
+      LOG_INFO("Using the native tag transform");
+    } else {
+      lua_.reset(new LuaTagTransform(get_lua(pt)));
+    }
 
     current_way_node_index_ = last_node_ = last_way_ = last_relation_ = 0;
 
@@ -80,12 +91,21 @@ public:
     return std::string(lua_graph_lua, lua_graph_lua + lua_graph_lua_len);
   }
 
+  Tags transform(OSMType type, const Tags& tags) {
+    return lua_ ? lua_->Transform(type, tags) : native_.Transform(type, tags);
+  }
+
+  // only the nodes of ways and bike share stations need their tags
+  virtual bool wants_tags(const OSMPBF::Interest type, const uint64_t osmid) override {
+    return type != OSMPBF::NODES || bss_nodes_ || shape_.get(osmid);
+  }
+
   virtual void
   node_callback(uint64_t osmid, double lng, double lat, const OSMPBF::Tags& tags) override {
     boost::optional<Tags> results = boost::none;
     if (bss_nodes_) {
       // Get tags
-      results = lua_.Transform(OSMType::kNode, tags);
+      results = transform(OSMType::kNode, tags);
 
       for (auto& key_value : *results) {
         if (key_value.first == "amenity" && key_value.second == "bicycle_rental") {
@@ -105,7 +125,7 @@ public:
     }
 
     // Get tags if not already available
-    results = results ? results : lua_.Transform(OSMType::kNode, tags);
+    results = results ? results : transform(OSMType::kNode, tags);
     if (results->size() == 0) {
       return;
     }
@@ -251,7 +271,7 @@ public:
 
     // Transform tags. If no results that means the way does not have tags
     // suitable for use in routing.
-    Tags results = lua_.Transform(OSMType::kWay, tags);
+    Tags results = transform(OSMType::kWay, tags);
     if (results.size() == 0) {
       return;
     }
@@ -1145,7 +1165,7 @@ public:
                                  const OSMPBF::Tags& tags,
                                  const std::vector<OSMPBF::Member>& members) override {
     // Get tags
-    Tags results = lua_.Transform(OSMType::kRelation, tags);
+    Tags results = transform(OSMType::kRelation, tags);
     if (results.size() == 0) {
       return;
     }
@@ -1599,8 +1619,9 @@ public:
   // Road class assignment needs to be set to the highway cutoff for ferries and auto trains.
   RoadClass highway_cutoff_rc_;
 
-  // Lua Tag Transformation class
-  LuaTagTransform lua_;
+  // Lua Tag Transformation class, null when the tags are transformed natively
+  std::unique_ptr<LuaTagTransform> lua_;
+  NativeTagTransform native_;
 
   // Pointer to all the OSM data (for use by callbacks)
   OSMData& osmdata_;
@@ -1660,11 +1681,14 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
   LOG_INFO("Parsing files: " + boost::algorithm::join(input_files, ", "));
 
   // hold open all the files so that if something else (like diff application)
-  // needs to mess with them we wont have troubles with inodes changing underneath us
-  std::list<std::ifstream> file_handles;
+  // needs to mess with them we wont have troubles with inodes changing underneath us. the first
+  // pass over each file indexes its blobs so the later passes only read the ones they care about
+  std::list<std::pair<std::ifstream, OSMPBF::BlobIndex>> file_handles;
   for (const auto& input_file : input_files) {
-    file_handles.emplace_back(input_file, std::ios::binary);
-    if (!file_handles.back().is_open()) {
+    file_handles.emplace_back(std::piecewise_construct,
+                              std::forward_as_tuple(input_file, std::ios::binary),
+                              std::forward_as_tuple());
+    if (!file_handles.back().first.is_open()) {
       throw std::runtime_error("Unable to open: " + input_file);
     }
   }
@@ -1676,8 +1700,9 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
           callback.last_relation_ = 0;
       callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr,
                      new sequence<OSMNode>(bss_nodes_file, true));
-      OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES),
-                            callback);
+      OSMPBF::Parser::parse(file_handle.first,
+                            static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES), callback,
+                            threads, &file_handle.second);
     }
   }
 
@@ -1692,10 +1717,10 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
   for (auto& file_handle : file_handles) {
     callback.current_way_node_index_ = callback.last_node_ = callback.last_way_ =
         callback.last_relation_ = 0;
-    OSMPBF::Parser::parse(file_handle,
+    OSMPBF::Parser::parse(file_handle.first,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads, &file_handle.second);
   }
   callback.output_loops();
   LOG_INFO("Finished with " + std::to_string(osmdata.osm_way_count) + " routable ways containing " +
@@ -1705,7 +1730,8 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm access tags by way id...");
   {
     sequence<OSMAccess> access(access_file, false);
-    access.sort([](const OSMAccess& a, const OSMAccess& b) { return a.way_id() < b.way_id(); });
+    access.sort([](const OSMAccess& a, const OSMAccess& b) { return a.way_id() < b.way_id(); },
+                1024 * 1024 * 512 / sizeof(OSMAccess), threads);
   }
 
   // Parse relations.
@@ -1713,10 +1739,10 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
   for (auto& file_handle : file_handles) {
     callback.current_way_node_index_ = callback.last_node_ = callback.last_way_ =
         callback.last_relation_ = 0;
-    OSMPBF::Parser::parse(file_handle,
+    OSMPBF::Parser::parse(file_handle.first,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads, &file_handle.second);
   }
   LOG_INFO("Finished with " + std::to_string(osmdata.restrictions.size()) + " simple restrictions");
   LOG_INFO("Finished with " + std::to_string(osmdata.lane_connectivity_map.size()) +
@@ -1746,7 +1772,8 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
     way_nodes.sort(
-        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; });
+        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; },
+        1024 * 1024 * 512 / sizeof(OSMWayNode), threads);
   }
   LOG_INFO("Finished");
 
@@ -1761,10 +1788,10 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
                    nullptr, nullptr);
     callback.current_way_node_index_ = callback.last_node_ = callback.last_way_ =
         callback.last_relation_ = 0;
-    OSMPBF::Parser::parse(file_handle,
+    OSMPBF::Parser::parse(file_handle.first,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads, &file_handle.second);
   }
   uint64_t max_osm_id = callback.last_node_;
   callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
@@ -1776,13 +1803,15 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm way node references by way index and node shape index...");
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
-    way_nodes.sort([](const OSMWayNode& a, const OSMWayNode& b) {
-      if (a.way_index == b.way_index) {
-        // TODO: if its equal we have screwed something up, should we check and throw here?
-        return a.way_shape_node_index < b.way_shape_node_index;
-      }
-      return a.way_index < b.way_index;
-    });
+    way_nodes.sort(
+        [](const OSMWayNode& a, const OSMWayNode& b) {
+          if (a.way_index == b.way_index) {
+            // TODO: if its equal we have screwed something up, should we check and throw here?
+            return a.way_shape_node_index < b.way_shape_node_index;
+          }
+          return a.way_index < b.way_index;
+        },
+        1024 * 1024 * 512 / sizeof(OSMWayNode), threads);
   }
 
   // Some OSM extracts do not have changeset Ids. For these set the max changeset Id
@@ -1794,6 +1823,9 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt,
     LOG_INFO("Finished: changeset id " + std::to_string(osmdata.max_changeset_id_));
   }
 
+  // Everything has been added to the lookup maps, sort them so they can be used
+  osmdata.sort_maps();
+
   // Log some information about extra node information and names
   LOG_INFO("Number of nodes with refs (exits) = " + std::to_string(osmdata.node_ref_count));
   LOG_INFO("Number of nodes with exit_to = " + std::to_string(osmdata.node_exit_to_count));
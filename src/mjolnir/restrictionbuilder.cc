@@ -3,9 +3,9 @@
 #include "mjolnir/dataquality.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/osmrestriction.h"
+#include "mjolnir/util.h"
 
 #include <future>
-#include <queue>
 #include <set>
 #include <thread>
 
@@ -29,14 +29,12 @@ using namespace valhalla::mjolnir;
 std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
                                 GraphReader& reader,
                                 GraphId& tileid,
-                                std::mutex& lock,
-                                std::vector<uint64_t> res_way_ids) {
+                                const std::vector<uint64_t>& res_way_ids) {
 
   std::deque<GraphId> graphids;
 
-  lock.lock();
   const GraphTile* endnodetile = reader.GetGraphTile(n_graphId);
-  lock.unlock();
+
 
   const NodeInfo* n_info = endnodetile->node(n_graphId);
   bool bBeginFound = false;
@@ -78,9 +76,8 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
           currentNode = de->endnode();
           // get the new tile if needed.
           if (endnodetile->id() != currentNode.Tile_Base()) {
-            lock.lock();
             endnodetile = reader.GetGraphTile(currentNode);
-            lock.unlock();
+
           }
 
           // get new end node and start over.
@@ -95,9 +92,8 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
             currentNode = de->endnode();
             // get the new tile if needed.
             if (endnodetile->id() != currentNode.Tile_Base()) {
-              lock.lock();
               endnodetile = reader.GetGraphTile(currentNode);
-              lock.unlock();
+
             }
 
             // get new end node and start over.
@@ -121,9 +117,8 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
             const NodeTransition* trans = endnodetile->transition(n_info->transition_index() + k);
 
             if (temp_endnodetile->id() != trans->endnode().Tile_Base()) {
-              lock.lock();
               temp_endnodetile = reader.GetGraphTile(trans->endnode());
-              lock.unlock();
+
             }
 
             currentNode = trans->endnode();
@@ -160,9 +155,8 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
 
                   // get the new tile if needed.
                   if (endnodetile->id() != currentNode.Tile_Base()) {
-                    lock.lock();
                     endnodetile = reader.GetGraphTile(currentNode);
-                    lock.unlock();
+
                   }
 
                   // get new end node and start over.
@@ -187,9 +181,8 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
               visited_set.clear();
               i = 0; // start over avoiding the first graphid
                      //(i.e., we walked the graph in the wrong direction)
-              lock.lock();
               endnodetile = reader.GetGraphTile(n_graphId);
-              lock.unlock();
+
               n_info = endnodetile->node(n_graphId);
               currentNode = n_graphId;
               prev_Node = GraphId();
@@ -209,9 +202,8 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
             visited_set.clear();
             i = 0; // start over avoiding the first graphid
                    //(i.e., we walked the graph in the wrong direction)
-            lock.lock();
             endnodetile = reader.GetGraphTile(n_graphId);
-            lock.unlock();
+
             n_info = endnodetile->node(n_graphId);
             currentNode = n_graphId;
             prev_Node = GraphId();
@@ -235,12 +227,23 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
   return graphids;
 }
 
-void build(const std::string& complex_restriction_from_file,
-           const std::string& complex_restriction_to_file,
-           const boost::property_tree::ptree& hierarchy_properties,
-           std::queue<GraphId>& tilequeue,
-           std::mutex& lock,
-           std::promise<DataQuality>& result) {
+// The complex restrictions found for a tile, they are stored in the tile once all of the tiles of
+// the level have been searched
+struct tile_restrictions_t {
+  std::vector<ComplexRestrictionBuilder> forward;
+  std::vector<ComplexRestrictionBuilder> reverse;
+};
+using level_restrictions_t = std::unordered_map<GraphId, tile_restrictions_t>;
+
+// Walks the restrictions starting and ending at the nodes of the tiles in the queue. Nothing is
+// written until the whole level has been searched so the tiles can be read without locking
+void find(const std::string& complex_restriction_from_file,
+          const std::string& complex_restriction_to_file,
+          const boost::property_tree::ptree& hierarchy_properties,
+          TileScheduler<GraphId>& tilequeue,
+          std::mutex& lock,
+          level_restrictions_t& level_restrictions,
+          std::promise<DataQuality>& result) {
   sequence<OSMRestriction> complex_restrictions_from(complex_restriction_from_file, false);
   sequence<OSMRestriction> complex_restrictions_to(complex_restriction_to_file, false);
 
@@ -249,43 +252,30 @@ void build(const std::string& complex_restriction_from_file,
 
   // Iterate through the tiles in the queue and perform enhancements
   while (true) {
-    // Get the next tile Id from the queue and get writeable and readable
-    // tile. Lock while we access the tile queue and get the tile.
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
+    // Get the next tile Id from the queue
+    GraphId tile_id;
+    if (!tilequeue.next(tile_id)) {
       break;
     }
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop();
 
     // Get a readable tile.If the tile is empty, skip it. Empty tiles are
     // added where ways go through a tile but no end not is within the tile.
     // This allows creation of connectivity maps using the tile set,
     const GraphTile* tile = reader.GetGraphTile(tile_id);
-    if (tile->header()->nodecount() == 0) {
-      lock.unlock();
+    if (tile == nullptr || tile->header()->nodecount() == 0) {
       continue;
     }
 
-    // Tile builder - serialize in existing tile
-    GraphTileBuilder tilebuilder(reader.tile_dir(), tile_id, true);
-    lock.unlock();
-
+    tile_restrictions_t restrictions;
     std::unordered_multimap<GraphId, ComplexRestrictionBuilder> forward_tmp_cr;
     std::unordered_multimap<GraphId, ComplexRestrictionBuilder> reverse_tmp_cr;
 
-    size_t forward_count = 0, reverse_count = 0;
+    for (uint32_t i = 0; i < tile->header()->nodecount(); i++) {
+      const NodeInfo* nodeinfo = tile->node(i);
 
-    uint32_t id = tile_id.tileid();
-    GraphId prevNode;
-    for (uint32_t i = 0; i < tilebuilder.header()->nodecount(); i++) {
-      NodeInfo& nodeinfo = tilebuilder.node_builder(i);
-
-      // Go through directed edges and "enhance" directed edge attributes
-      const DirectedEdge* edges = tilebuilder.directededges(nodeinfo.edge_index());
-      for (uint32_t j = 0; j < nodeinfo.edge_count(); j++) {
-        DirectedEdge& directededge = tilebuilder.directededge_builder(nodeinfo.edge_index() + j);
+      // Go through directed edges looking for the ones restrictions start or end on
+      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++) {
+        const DirectedEdge& directededge = *tile->directededge(nodeinfo->edge_index() + j);
 
         if (directededge.IsTransitLine() || directededge.is_shortcut() ||
             directededge.use() == Use::kTransitConnection ||
@@ -293,7 +283,7 @@ void build(const std::string& complex_restriction_from_file,
             directededge.use() == Use::kPlatformConnection) {
           continue;
         }
-        auto e_offset = tilebuilder.edgeinfo(directededge.edgeinfo_offset());
+        auto e_offset = tile->edgeinfo(directededge.edgeinfo_offset());
         //    |      |       |
         //    |      |  to   |
         // ---O------O---x---O---
@@ -345,7 +335,7 @@ void build(const std::string& complex_restriction_from_file,
 
               // walk in the forward direction.
               std::deque<GraphId> tmp_ids =
-                  GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                  GetGraphIds(currentNode, reader, tileid, res_way_ids);
 
               // now that we have the tile and currentNode walk in the reverse direction as this is
               // really what needs to be stored in this tile.
@@ -370,7 +360,7 @@ void build(const std::string& complex_restriction_from_file,
                 }
 
                 res_way_ids.push_back(e_offset.wayid());
-                tmp_ids = GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                tmp_ids = GetGraphIds(currentNode, reader, tileid, res_way_ids);
 
                 if (tmp_ids.size()) {
 
@@ -426,8 +416,7 @@ void build(const std::string& complex_restriction_from_file,
                   }
                   if (!bfound) { // no dups.
                     reverse_tmp_cr.emplace(tmp_ids.at(0), complex_restriction);
-                    tilebuilder.AddReverseComplexRestriction(complex_restriction);
-                    reverse_count++;
+                    restrictions.reverse.push_back(complex_restriction);
                   }
                 }
               }
@@ -489,7 +478,7 @@ void build(const std::string& complex_restriction_from_file,
 
                 // walk in the forward direction (reverse in relation to the restriction)
                 std::deque<GraphId> tmp_ids =
-                    GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                    GetGraphIds(currentNode, reader, tileid, res_way_ids);
 
                 // now that we have the tile and currentNode walk in the reverse
                 // direction(forward in relation to the restriction) as this is really what
@@ -513,7 +502,7 @@ void build(const std::string& complex_restriction_from_file,
                     res_way_ids.push_back(restriction.to());
                   }
 
-                  tmp_ids = GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                  tmp_ids = GetGraphIds(currentNode, reader, tileid, res_way_ids);
 
                   if (tmp_ids.size()) {
                     std::vector<GraphId> vias;
@@ -565,8 +554,7 @@ void build(const std::string& complex_restriction_from_file,
                     }
                     if (!bfound) { // no dups.
                       forward_tmp_cr.emplace(tmp_ids.at(0), complex_restriction);
-                      tilebuilder.AddForwardComplexRestriction(complex_restriction);
-                      forward_count++;
+                      restrictions.forward.push_back(complex_restriction);
                     }
                   }
                 }
@@ -578,24 +566,51 @@ void build(const std::string& complex_restriction_from_file,
         }
       }
     }
-    stats.forward_restrictions_count += forward_count;
-    stats.reverse_restrictions_count += reverse_count;
+    stats.forward_restrictions_count += restrictions.forward.size();
+    stats.reverse_restrictions_count += restrictions.reverse.size();
 
-    // Write the new file
-    lock.lock();
-    tilebuilder.StoreTileData();
+    // Keep them until the level is done
+    if (!restrictions.forward.empty() || !restrictions.reverse.empty()) {
+      lock.lock();
+      level_restrictions.emplace(tile_id, std::move(restrictions));
+      lock.unlock();
+    }
 
     // Check if we need to clear the tile cache
     if (reader.OverCommitted()) {
       reader.Trim();
     }
-    lock.unlock();
   }
 
   // Send back the statistics
   result.set_value(stats);
 }
 
+// Writes the restrictions found for the tiles in the queue into them. Tiles nothing was found for
+// are left alone
+void store(const std::string& tile_dir,
+           TileScheduler<GraphId>& tilequeue,
+           const level_restrictions_t& level_restrictions,
+           std::promise<void>& result) {
+  try {
+    GraphId tile_id;
+    while (tilequeue.next(tile_id)) {
+      const auto& restrictions = level_restrictions.find(tile_id)->second;
+      GraphTileBuilder tilebuilder(tile_dir, tile_id, true);
+      for (const auto& complex_restriction : restrictions.forward) {
+        tilebuilder.AddForwardComplexRestriction(complex_restriction);
+      }
+      for (const auto& complex_restriction : restrictions.reverse) {
+        tilebuilder.AddReverseComplexRestriction(complex_restriction);
+      }
+      tilebuilder.StoreTileData();
+    }
+    result.set_value();
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
+
 namespace valhalla {
 namespace mjolnir {
 
@@ -608,15 +623,10 @@ void RestrictionBuilder::Build(const boost::property_tree::ptree& pt,
   GraphReader reader(hierarchy_properties);
   auto level = TileHierarchy::levels().rbegin();
   for (; level != TileHierarchy::levels().rend(); ++level) {
-    // Create a randomized queue of tiles to work from
+    // Create a queue of tiles to work from, biggest first
     auto tile_level = level->second;
-    std::deque<GraphId> tempqueue;
     auto level_tiles = reader.GetTileSet(tile_level.level);
-    for (const auto& tile_id : level_tiles) {
-      tempqueue.emplace_back(tile_id);
-    }
-    std::random_shuffle(tempqueue.begin(), tempqueue.end());
-    std::queue<GraphId> tilequeue(tempqueue);
+    TileScheduler<GraphId> tilequeue(TileCosts(reader.tile_dir(), level_tiles));
 
     // An atomic object we can use to do the synchronization
     std::mutex lock;
@@ -628,13 +638,16 @@ void RestrictionBuilder::Build(const boost::property_tree::ptree& pt,
     // Hold the results (DataQuality/stats) for the threads
     std::vector<std::promise<DataQuality>> results(threads.size());
 
-    // Start the threads
+    // Start the threads, the restrictions of the whole level are found before any tile is
+    // written so the walks from one tile into the next never wait on a writer
     LOG_INFO("Adding Restrictions at level " + std::to_string(tile_level.level));
+    level_restrictions_t level_restrictions;
     for (size_t i = 0; i < threads.size(); ++i) {
-      threads[i].reset(new std::thread(build, std::cref(complex_from_restrictions_file),
+      threads[i].reset(new std::thread(find, std::cref(complex_from_restrictions_file),
                                        std::cref(complex_to_restrictions_file),
                                        std::cref(hierarchy_properties), std::ref(tilequeue),
-                                       std::ref(lock), std::ref(results[i])));
+                                       std::ref(lock), std::ref(level_restrictions),
+                                       std::ref(results[i])));
     }
 
     // Wait for them to finish up their work
@@ -656,6 +669,27 @@ void RestrictionBuilder::Build(const boost::property_tree::ptree& pt,
         throw e;
       }
     }
+
+    // Only the tiles that got restrictions are written, the ones with the most of them first
+    std::vector<std::pair<GraphId, size_t>> costs;
+    costs.reserve(level_restrictions.size());
+    for (const auto& restrictions : level_restrictions) {
+      costs.emplace_back(restrictions.first,
+                         restrictions.second.forward.size() + restrictions.second.reverse.size());
+    }
+    TileScheduler<GraphId> storequeue(std::move(costs));
+    std::vector<std::promise<void>> stored(threads.size());
+    for (size_t i = 0; i < threads.size(); ++i) {
+      threads[i].reset(new std::thread(store, std::cref(reader.tile_dir()), std::ref(storequeue),
+                                       std::cref(level_restrictions), std::ref(stored[i])));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    for (auto& result : stored) {
+      result.get_future().get();
+    }
+
     LOG_INFO("--Forward restrictions added: " + std::to_string(forward_restrictions_count));
     LOG_INFO("--Reverse restrictions added: " + std::to_string(reverse_restrictions_count));
   }
@@ -4,20 +4,25 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <future>
 #include <iostream>
 #include <map>
 #include <ostream>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "baldr/accessrestriction.h"
 #include "baldr/graphconstants.h"
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
 #include "baldr/graphtile.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -94,6 +99,29 @@ bool EdgesMatch(const GraphTile* tile, const DirectedEdge* edge1, const Directed
   return true;
 }
 
+// Adds the hazmat and dimension restrictions of an edge along a shortcut to those of the chain.
+// They say whether a vehicle may use the edge at all, so the shortcut needs all of them for a
+// vehicle like a truck to only be allowed on it when it is allowed on every edge it replaces. Of
+// the same dimension for the same modes only the tightest is kept
+void AddChainRestrictions(const GraphTile* tile,
+                          const GraphId& edgeid,
+                          std::vector<AccessRestriction>& chain) {
+  for (const auto& res : tile->GetAccessRestrictions(edgeid.id(), kAllAccess)) {
+    if (res.type() == AccessType::kTimedAllowed || res.type() == AccessType::kTimedDenied) {
+      continue;
+    }
+    auto same = std::find_if(chain.begin(), chain.end(), [&res](const AccessRestriction& other) {
+      return other.type() == res.type() && other.modes() == res.modes() &&
+             (res.type() != AccessType::kHazmat || other.value() == res.value());
+    });
+    if (same == chain.end()) {
+      chain.emplace_back(0, res.type(), res.modes(), res.value());
+    } else if (res.value() < same->value()) {
+      *same = AccessRestriction(0, res.type(), res.modes(), res.value());
+    }
+  }
+}
+
 // Get the GraphId of the opposing edge.
 GraphId GetOpposingEdge(const GraphId& node,
                         const DirectedEdge* edge,
@@ -417,8 +445,9 @@ uint32_t AddShortcutEdges(GraphReader& reader,
       auto names = tile->GetNames(directededge->edgeinfo_offset());
       auto types = tile->GetTypes(directededge->edgeinfo_offset());
 
-      // Add any access restriction records. TODO - make sure we don't contract
-      // across edges with different restrictions.
+      // Add any access restriction records. The hazmat and dimension ones of the other edges
+      // are added below. TODO - make sure we don't contract across edges with different timed
+      // restrictions.
       if (newedge.access_restriction()) {
         auto restrictions = tile->GetAccessRestrictions(edge_id.id(), kAllAccess);
         for (const auto& res : restrictions) {
@@ -427,6 +456,11 @@ uint32_t AddShortcutEdges(GraphReader& reader,
         }
       }
 
+      // The hazmat and dimension restrictions along the rest of the shortcut, and whether all of
+      // it is part of the truck network
+      std::vector<AccessRestriction> chain_restrictions;
+      bool truck_route = newedge.truck_route();
+
       // Connect edges to the shortcut while the end node is marked as
       // contracted (contains edge pairs in the shortcut info).
       uint32_t rst = 0;
@@ -455,6 +489,13 @@ uint32_t AddShortcutEdges(GraphReader& reader,
           break;
         }
 
+        // Collect what restricts the vehicles on the matching outbound directed edge
+        const DirectedEdge* next_edge = tile->directededge(next_edge_id);
+        if (next_edge->access_restriction()) {
+          AddChainRestrictions(tile, next_edge_id, chain_restrictions);
+        }
+        truck_route = truck_route && next_edge->truck_route();
+
         // Connect the matching outbound directed edge (updates the next
         // end node in the new level). Keep track of the last restriction
         // on the connected shortcut - need to set that so turn restrictions
@@ -463,6 +504,30 @@ uint32_t AddShortcutEdges(GraphReader& reader,
                                average_density);
       }
 
+      // Add the restrictions along the shortcut that the first edge does not have already, so
+      // that a truck too big for any edge of the shortcut is not allowed on it and expands the
+      // regular edges instead. Only what is a truck route all along makes the shortcut one
+      if (!chain_restrictions.empty()) {
+        auto first = newedge.access_restriction()
+                         ? tile->GetAccessRestrictions(edge_id.id(), kAllAccess)
+                         : std::vector<AccessRestriction>{};
+        uint32_t modes = newedge.access_restriction();
+        for (const auto& res : chain_restrictions) {
+          auto same = [&res](const AccessRestriction& r) {
+            return r.type() == res.type() && r.modes() == res.modes() && r.value() == res.value();
+          };
+          auto found = std::find_if(first.cbegin(), first.cend(), same);
+          if (found == first.cend()) {
+            tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
+                                                               res.type(), res.modes(),
+                                                               res.value()));
+            modes |= res.modes();
+          }
+        }
+        newedge.set_access_restriction(modes);
+      }
+      newedge.set_truck_route(truck_route);
+
       // Do we need to force adding edgeinfo (opposing edge could have diff names)?
       // If end node is in the same tile and opposing edge does not have matching
       // edge_info_offset).
@@ -551,25 +616,26 @@ uint32_t AddShortcutEdges(GraphReader& reader,
   return shortcut_count;
 }
 
-// Form shortcuts for tiles in this level.
-uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
-  // Iterate through the tiles at this level (TODO - can we mark the tiles
-  // the tiles that shortcuts end within?)
-  reader.Clear();
+// Form shortcuts for the tiles of a level claimed from the queue. The new tiles are written to
+// the staging directory so that every thread keeps reading the original tiles of the level,
+// which makes the result independent of the order the tiles are worked on.
+uint32_t FormShortcuts(GraphReader& reader,
+                       const std::string& staging_dir,
+                       TileScheduler<GraphId>& tilequeue) {
   bool added = false;
   uint32_t shortcut_count = 0;
-  uint32_t ntiles = level.tiles.TileCount();
-  uint32_t tile_level = (uint32_t)level.level;
   const GraphTile* tile = nullptr;
-  for (uint32_t tileid = 0; tileid < ntiles; tileid++) {
-    // Get the graph tile. Skip if no tile exists (common case)
-    tile = reader.GetGraphTile(GraphId(tileid, tile_level, 0));
+  GraphId new_tile;
+  while (tilequeue.next(new_tile)) {
+    // Get the graph tile. Skip if no tile exists
+    uint32_t tileid = new_tile.tileid();
+    uint32_t tile_level = new_tile.level();
+    tile = reader.GetGraphTile(new_tile);
     if (tile == nullptr || tile->header()->nodecount() == 0) {
       continue;
     }
 
     // Create GraphTileBuilder for the new tile
-    GraphId new_tile(tileid, tile_level, 0);
     GraphTileBuilder tilebuilder(reader.tile_dir(), new_tile, false);
 
     // Since the old tile is not serialized we must copy any data that is not
@@ -691,7 +757,7 @@ uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
     }
 
     // Store the new tile
-    tilebuilder.StoreTileData();
+    tilebuilder.StoreTileData(staging_dir);
     LOG_DEBUG((boost::format("ShortcutBuilder created tile %1%: %2% bytes") % tile %
                tilebuilder.header_builder().end_offset())
                   .str());
@@ -704,6 +770,19 @@ uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
   return shortcut_count;
 }
 
+// Thread that forms shortcuts with its own reader
+void FormShortcutsThread(const boost::property_tree::ptree& pt,
+                         const std::string& staging_dir,
+                         TileScheduler<GraphId>& tilequeue,
+                         std::promise<uint32_t>& result) {
+  try {
+    GraphReader reader(pt);
+    result.set_value(FormShortcuts(reader, staging_dir, tilequeue));
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -714,20 +793,53 @@ namespace mjolnir {
 // attributes. Shortcut edges are inserted before regular edges.
 void ShortcutBuilder::Build(const boost::property_tree::ptree& pt) {
 
-  // TODO: thread this. would need to make sure we dont make shortcuts
-  // across tile boundaries so that we are only messing with one tile
-  // in one thread at a time
-
   // Get GraphReader
-  GraphReader reader(pt.get_child("mjolnir"));
+  const auto& hierarchy_properties = pt.get_child("mjolnir");
+  GraphReader reader(hierarchy_properties);
+  unsigned int thread_count =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+
+  // Shortcuts cross tile boundaries so while a level is being worked on its new tiles go here,
+  // next to the level directories so they are on the same file system and can be moved in place
+  std::string staging_dir =
+      reader.tile_dir() + filesystem::path::preferred_separator + "shortcuts_staging";
 
   auto level = TileHierarchy::levels().rbegin();
   level++;
   for (; level != TileHierarchy::levels().rend(); ++level) {
     // Create shortcuts on this level
     auto tile_level = level->second;
-    LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level.level));
-    uint32_t count = FormShortcuts(reader, tile_level);
+    LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level.level) + " with " +
+             std::to_string(thread_count) + " threads");
+    auto tiles = reader.GetTileSet(tile_level.level);
+    TileScheduler<GraphId> tilequeue(TileCosts(reader.tile_dir(), tiles));
+
+    std::vector<std::shared_ptr<std::thread>> threads(thread_count);
+    std::vector<std::promise<uint32_t>> results(thread_count);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      threads[i].reset(new std::thread(FormShortcutsThread, std::cref(hierarchy_properties),
+                                       std::cref(staging_dir), std::ref(tilequeue),
+                                       std::ref(results[i])));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+
+    // If something bad went down this will rethrow it
+    uint32_t count = 0;
+    for (auto& result : results) {
+      count += result.get_future().get();
+    }
+
+    // Now that nobody reads the level anymore replace its tiles with the new ones
+    for (const auto& tile_id : tiles) {
+      auto suffix = filesystem::path::preferred_separator + GraphTile::FileSuffix(tile_id);
+      if (boost::filesystem::exists(staging_dir + suffix)) {
+        boost::filesystem::rename(staging_dir + suffix, reader.tile_dir() + suffix);
+      }
+    }
+    boost::filesystem::remove_all(staging_dir);
     LOG_INFO("Finished with " + std::to_string(count) + " shortcuts");
   }
 }
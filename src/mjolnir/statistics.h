@@ -280,7 +280,13 @@ public:
 
   void add(const statistics& stats);
 
-  void build_db(const boost::property_tree::ptree& pt);
+  /**
+   * Writes the statistics to statistics.sqlite.
+   * @param pt      the configuration
+   * @param update  replace only the rows of the gathered tiles in an existing database instead
+   *                of writing a new one
+   */
+  void build_db(const boost::property_tree::ptree& pt, const bool update = false);
 
 private:
   void create_tile_tables(sqlite3* db_handle, sqlite3_stmt* stmt);
@@ -294,6 +300,10 @@ private:
   void insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt);
 
   void insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt);
+
+  void insert_ctry_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt);
+
+  void update_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt);
 };
 } // namespace mjolnir
 } // namespace valhalla
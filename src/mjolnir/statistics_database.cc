@@ -15,9 +15,9 @@ using namespace valhalla::mjolnir;
 namespace valhalla {
 namespace mjolnir {
 
-void statistics::build_db(const boost::property_tree::ptree& pt) {
+void statistics::build_db(const boost::property_tree::ptree& pt, const bool update) {
   std::string database = "statistics.sqlite";
-  if (boost::filesystem::exists(database)) {
+  if (!update && boost::filesystem::exists(database)) {
     boost::filesystem::remove(database);
   }
 
@@ -64,6 +64,15 @@ void statistics::build_db(const boost::property_tree::ptree& pt) {
     return;
   }
 
+  // Only replace the rows of the tiles that were gathered again. The country totals need every
+  // tile so they stay as they were until the next full build
+  if (update) {
+    update_tile_data(db_handle, stmt);
+    sqlite3_close(db_handle);
+    LOG_INFO("Statistics of " + std::to_string(tile_ids.size()) + " tiles updated in " + database);
+    return;
+  }
+
   LOG_INFO("Creating tables");
 
   create_tile_tables(db_handle, stmt);
@@ -82,6 +91,7 @@ void statistics::build_db(const boost::property_tree::ptree& pt) {
   LOG_INFO("Country info inserted");
 
   insert_exit_data(db_handle, stmt);
+  insert_ctry_exit_data(db_handle, stmt);
   LOG_INFO("Exit info inserted");
 
   // Create Index on geometry column
@@ -115,6 +125,49 @@ void statistics::build_db(const boost::property_tree::ptree& pt) {
   sqlite3_close(db_handle);
   LOG_INFO("Statistics database saved to statistics.sqlite");
 }
+void statistics::update_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
+  uint32_t ret;
+  char* err_msg = NULL;
+  std::string sql;
+
+  // Drop the old rows of the tiles in one go, the rows referencing tiledata first
+  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
+  if (ret != SQLITE_OK) {
+    LOG_ERROR("Error: " + std::string(err_msg));
+    sqlite3_free(err_msg);
+    return;
+  }
+  for (const auto& table : {"rclasstiledata", "truckrclasstiledata", "tile_exitinfo",
+                            "tile_forkinfo", "tiledata"}) {
+    sql = "DELETE FROM " + std::string(table) + " WHERE tileid = ?";
+    ret = sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, NULL);
+    if (ret != SQLITE_OK) {
+      LOG_ERROR("SQL error: " + sql);
+      LOG_ERROR(std::string(sqlite3_errmsg(db_handle)));
+      sqlite3_exec(db_handle, "ROLLBACK", NULL, NULL, NULL);
+      return;
+    }
+    for (auto tileid : tile_ids) {
+      sqlite3_reset(stmt);
+      sqlite3_bind_int(stmt, 1, tileid);
+      ret = sqlite3_step(stmt);
+      if (ret != SQLITE_DONE) {
+        LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
+      }
+    }
+    sqlite3_finalize(stmt);
+  }
+  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
+  if (ret != SQLITE_OK) {
+    LOG_ERROR("Error: " + std::string(err_msg));
+    sqlite3_free(err_msg);
+    return;
+  }
+
+  insert_tile_data(db_handle, stmt);
+  insert_exit_data(db_handle, stmt);
+}
+
 void statistics::create_tile_tables(sqlite3* db_handle, sqlite3_stmt* stmt) {
   uint32_t ret;
   char* err_msg = NULL;
@@ -796,6 +849,12 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     sqlite3_close(db_handle);
     return;
   }
+}
+
+void statistics::insert_ctry_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
+  uint32_t ret;
+  char* err_msg = NULL;
+  std::string sql;
 
   // Begin adding the exit statistics for countries
   ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
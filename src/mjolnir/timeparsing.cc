@@ -1,8 +1,10 @@
 #include <bitset>
+#include <cctype>
 #include <fstream>
 #include <iostream>
 #include <regex>
 #include <sstream>
+#include <unordered_map>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -29,9 +31,7 @@ std::vector<std::string> GetTokens(const std::string& tag_value, char delim) {
 }
 
 bool RegexFound(const std::string& source, const std::regex& regex) {
-  auto begin = std::sregex_iterator(source.begin(), source.end(), regex);
-  auto end = std::sregex_iterator();
-  return std::distance(begin, end);
+  return std::regex_search(source, regex);
 }
 
 std::string
@@ -39,6 +39,41 @@ FormatCondition(const std::string& source, const std::regex& regex, const std::s
   return std::regex_replace(source, regex, pattern);
 }
 
+namespace {
+
+// fifth is the equivalent of last week in month (-1)
+void LastWeekToFifth(std::string& condition) {
+  for (auto found = condition.find("[-1]"); found != std::string::npos;
+       found = condition.find("[-1]", found + 3)) {
+    condition.replace(found, 4, "[5]");
+  }
+}
+
+// the hours and minutes of 09:30 like the stream that used to read them: leading white space is
+// skipped, one character is skipped between them and what is missing is 0
+void GetHoursMinutes(const std::string& time, uint32_t& hour, uint32_t& min) {
+  auto read = [&time](std::string::const_iterator& c, uint32_t& value) {
+    while (c != time.cend() && std::isspace(static_cast<unsigned char>(*c))) {
+      ++c;
+    }
+    value = 0;
+    bool digits = false;
+    for (; c != time.cend() && std::isdigit(static_cast<unsigned char>(*c)); ++c) {
+      value = value * 10 + (*c - '0');
+      digits = true;
+    }
+    return digits;
+  };
+
+  auto c = time.cbegin();
+  min = 0;
+  if (read(c, hour) && c != time.cend()) {
+    read(++c, min);
+  }
+}
+
+} // namespace
+
 // get the dow mask from user inputed string.  try to handle most inputs
 uint8_t get_dow_mask(const std::string& dow) {
 
@@ -147,7 +182,9 @@ MONTH get_month(const std::string& month) {
   return MONTH::kNone;
 }
 
-std::vector<uint64_t> get_time_range(const std::string& str) {
+namespace {
+
+std::vector<uint64_t> ParseTimeRange(const std::string& str) {
 
   std::vector<uint64_t> time_domains;
 
@@ -166,7 +203,8 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
     }
 
     // Dec Su[-1]-Mar 3
-    std::regex regex = std::regex(
+    // the patterns are compiled once, building a regex costs far more than matching it
+    static const std::regex nth_week_to_day(
         "(?:(January|February|March|April|May|June|July|"
         "August|September|October|November|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|"
         "Sep|Sept|Oct|Nov|Dec)) (?:(Monday|Tuesday|Wednesday|Thursday|Friday|Saturday|"
@@ -175,14 +213,13 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
         "|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Sept|Oct|Nov|Dec)) (\\d{1,2}))",
         std::regex_constants::icase);
 
-    if (RegexFound(condition, regex)) {
-      condition = FormatCondition(condition, regex, "$1#$2#$3-$4#$5");
-      // fifth is the equivalent of last week in month (-1)
-      condition = FormatCondition(condition, std::regex("\\[-1\\]"), "[5]");
+    if (RegexFound(condition, nth_week_to_day)) {
+      condition = FormatCondition(condition, nth_week_to_day, "$1#$2#$3-$4#$5");
+      LastWeekToFifth(condition);
     } else {
 
       // Mar 3-Dec Su[-1]
-      std::regex regex = std::regex(
+      static const std::regex day_to_nth_week(
           "(?:(January|February|March|April|May|June|July|August|"
           "September|October|November|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Sept|Oct|"
           "Nov|Dec)) (\\d{1,2})-(?:(January|February|March|April|May|June|July|"
@@ -192,14 +229,13 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
           ")",
           std::regex_constants::icase);
 
-      if (RegexFound(condition, regex)) {
-        condition = FormatCondition(condition, regex, "$1#$2-$3#$4#$5");
-        // fifth is the equivalent of last week in month (-1)
-        condition = FormatCondition(condition, std::regex("\\[-1\\]"), "[5]");
+      if (RegexFound(condition, day_to_nth_week)) {
+        condition = FormatCondition(condition, day_to_nth_week, "$1#$2-$3#$4#$5");
+        LastWeekToFifth(condition);
       } else {
 
         // Dec Su[-1]
-        regex = std::regex(
+        static const std::regex month_nth_week(
             "(?:(January|February|March|April|May|June|July|"
             "August|September|October|November|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|"
             "Sep|Sept|Oct|Nov|Dec)) (?:(Monday|Tuesday|Wednesday|Thursday|Friday|Saturday|"
@@ -207,42 +243,41 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
             "\\]))",
             std::regex_constants::icase);
 
-        if (RegexFound(condition, regex)) {
-          condition = FormatCondition(condition, regex, "$1#$2#$3");
-          // fifth is the equivalent of last week in month (-1)
-          condition = FormatCondition(condition, std::regex("\\[-1\\]"), "[5]");
+        if (RegexFound(condition, month_nth_week)) {
+          condition = FormatCondition(condition, month_nth_week, "$1#$2#$3");
+          LastWeekToFifth(condition);
         } else {
 
-          regex = std::regex("(?:(Monday|Tuesday|Wednesday|Thursday|Friday|Saturday|"
-                             "Sunday|Mon|Mo|Tues|Tue|Tu|Weds|Wed|We|Thurs|Thur|Th|Fri|Fr|Sat|Sa|Sun|"
-                             "Su)(\\[-?[0-9]\\]))",
-                             std::regex_constants::icase);
+          static const std::regex nth_week(
+              "(?:(Monday|Tuesday|Wednesday|Thursday|Friday|Saturday|"
+              "Sunday|Mon|Mo|Tues|Tue|Tu|Weds|Wed|We|Thurs|Thur|Th|Fri|Fr|Sat|Sa|Sun|"
+              "Su)(\\[-?[0-9]\\]))",
+              std::regex_constants::icase);
 
-          if (RegexFound(condition, regex)) {
-            condition = FormatCondition(condition, regex, "$1#$2");
-            // fifth is the equivalent of last week in month (-1)
-            condition = FormatCondition(condition, std::regex("\\[-1\\]"), "[5]");
+          if (RegexFound(condition, nth_week)) {
+            condition = FormatCondition(condition, nth_week, "$1#$2");
+            LastWeekToFifth(condition);
           } else {
 
             // Feb 16-Oct 15 09:00-18:30
-            regex = std::
-                regex("(?:(January|February|March|April|May|June|July|"
-                      "August|September|October|November|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|"
-                      "Sep|Sept|Oct|Nov|Dec)) (\\d{1,2})",
-                      std::regex_constants::icase);
-
-            if (RegexFound(condition, regex)) {
-              condition = FormatCondition(condition, regex, "$1#$2");
+            static const std::regex month_day(
+                "(?:(January|February|March|April|May|June|July|"
+                "August|September|October|November|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|"
+                "Sep|Sept|Oct|Nov|Dec)) (\\d{1,2})",
+                std::regex_constants::icase);
+
+            if (RegexFound(condition, month_day)) {
+              condition = FormatCondition(condition, month_day, "$1#$2");
             } else {
               // Feb 2-14
-              regex = std::
-                  regex("(?:(January|February|March|April|May|June|July|"
-                        "August|September|October|November|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|"
-                        "Sep|Sept|Oct|Nov|Dec)) (\\d{1,2})-(\\d{1,2})",
-                        std::regex_constants::icase);
-
-              if (RegexFound(condition, regex)) {
-                condition = FormatCondition(condition, regex, "$1#$2-$1#$3");
+              static const std::regex month_days(
+                  "(?:(January|February|March|April|May|June|July|"
+                  "August|September|October|November|December|Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|"
+                  "Sep|Sept|Oct|Nov|Dec)) (\\d{1,2})-(\\d{1,2})",
+                  std::regex_constants::icase);
+
+              if (RegexFound(condition, month_days)) {
+                condition = FormatCondition(condition, month_days, "$1#$2-$1#$3");
               }
             }
           }
@@ -285,12 +320,8 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
               return time_domains;
             }
 
-            std::stringstream stream(on_off.at(0));
             uint32_t hour, min;
-
-            stream >> hour;
-            stream.ignore();
-            stream >> min;
+            GetHoursMinutes(on_off.at(0), hour, min);
 
             timedomain.set_begin_hrs(hour);
             timedomain.set_begin_mins(min);
@@ -301,13 +332,7 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
               return time_domains;
             }
 
-            stream.str("");
-            stream.clear();
-            stream.str(on_off.at(1));
-
-            stream >> hour;
-            stream.ignore();
-            stream >> min;
+            GetHoursMinutes(on_off.at(1), hour, min);
 
             timedomain.set_end_hrs(hour);
             timedomain.set_end_mins(min);
@@ -556,12 +581,8 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
               return time_domains;
             }
 
-            std::stringstream stream(on_off.at(0));
             uint32_t hour, min;
-
-            stream >> hour;
-            stream.ignore();
-            stream >> min;
+            GetHoursMinutes(on_off.at(0), hour, min);
 
             timedomain.set_begin_hrs(hour);
             timedomain.set_begin_mins(min);
@@ -572,13 +593,7 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
               return time_domains;
             }
 
-            stream.str("");
-            stream.clear();
-            stream.str(on_off.at(1));
-
-            stream >> hour;
-            stream.ignore();
-            stream >> min;
+            GetHoursMinutes(on_off.at(1), hour, min);
 
             timedomain.set_end_hrs(hour);
             timedomain.set_end_mins(min);
@@ -604,5 +619,22 @@ std::vector<uint64_t> get_time_range(const std::string& str) {
   return time_domains;
 }
 
+} // namespace
+
+std::vector<uint64_t> get_time_range(const std::string& condition) {
+  // the same few conditions are on a great many ways so each thread keeps what it parsed, a
+  // whole planet has far fewer distinct conditions than the bound but it is there just in case
+  constexpr size_t kMaxConditions = 16384;
+  thread_local std::unordered_map<std::string, std::vector<uint64_t>> parsed;
+  auto found = parsed.find(condition);
+  if (found != parsed.cend()) {
+    return found->second;
+  }
+  if (parsed.size() == kMaxConditions) {
+    parsed.clear();
+  }
+  return parsed.emplace(condition, ParseTimeRange(condition)).first->second;
+}
+
 } // namespace mjolnir
 } // namespace valhalla
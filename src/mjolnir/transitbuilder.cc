@@ -1,6 +1,7 @@
 #include "mjolnir/transitbuilder.h"
 #include "mjolnir/graphtilebuilder.h"
 
+#include <algorithm>
 #include <fstream>
 #include <future>
 #include <iostream>
@@ -20,6 +21,7 @@
 #include "baldr/graphtile.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
+#include "midgard/aabb2.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
@@ -68,6 +70,94 @@ struct builder_stats {
   }
 };
 
+// Index of the nodes and directed edges of a local level tile, built once per
+// tile so that connecting each of its stops does not scan the whole tile. The
+// nodes are binned into a grid over the tile and the directed edges are
+// grouped by their way Id
+struct stop_connection_index_t {
+  // A directed edge and the index of the node it leaves from
+  struct edge_t {
+    uint32_t node_index;
+    uint32_t edge_index;
+  };
+
+  // Cells per side of the grid, at the local level that is under 1km per cell
+  static constexpr uint32_t kGridSize = 32;
+
+  AABB2<PointLL> bounds;
+  float cell_width;
+  float cell_height;
+  std::vector<std::vector<uint32_t>> cells;
+  std::unordered_map<uint64_t, std::vector<edge_t>> way_edges;
+
+  explicit stop_connection_index_t(const GraphTile* tile)
+      : bounds(tile->BoundingBox()), cell_width(bounds.Width() / kGridSize),
+        cell_height(bounds.Height() / kGridSize), cells(kGridSize * kGridSize) {
+    PointLL base_ll = tile->header()->base_ll();
+    for (uint32_t i = 0; i < tile->header()->nodecount(); i++) {
+      const NodeInfo* node = tile->node(i);
+      PointLL ll = node->latlng(base_ll);
+      cells[row(ll.lat()) * kGridSize + column(ll.lng())].push_back(i);
+      for (uint32_t j = 0, n = node->edge_count(); j < n; j++) {
+        const DirectedEdge* directededge = tile->directededge(node->edge_index() + j);
+        uint64_t wayid = tile->edgeinfo(directededge->edgeinfo_offset()).wayid();
+        way_edges[wayid].push_back({i, node->edge_index() + j});
+      }
+    }
+  }
+
+  uint32_t column(const float lng) const {
+    float c = (lng - bounds.minx()) / cell_width;
+    return c <= 0.0f ? 0 : std::min(static_cast<uint32_t>(c), kGridSize - 1);
+  }
+  uint32_t row(const float lat) const {
+    float r = (lat - bounds.miny()) / cell_height;
+    return r <= 0.0f ? 0 : std::min(static_cast<uint32_t>(r), kGridSize - 1);
+  }
+
+  // Calls the function with the index of each node in the cells the box touches
+  template <typename node_function_t>
+  void nodes_within(const AABB2<PointLL>& box, const node_function_t& node_function) const {
+    uint32_t min_row = row(box.miny()), max_row = row(box.maxy());
+    uint32_t min_column = column(box.minx()), max_column = column(box.maxx());
+    for (uint32_t r = min_row; r <= max_row; ++r) {
+      for (uint32_t c = min_column; c <= max_column; ++c) {
+        for (auto node_index : cells[r * kGridSize + c]) {
+          node_function(node_index);
+        }
+      }
+    }
+  }
+
+  // Directed edges of the way, in the order of the nodes they leave from
+  const std::vector<edge_t>& edges_of_way(const uint64_t wayid) const {
+    static const std::vector<edge_t> kNoEdges;
+    auto found = way_edges.find(wayid);
+    return found == way_edges.end() ? kNoEdges : found->second;
+  }
+};
+
+// The indexes of the local level tiles a thread has needed so far, the stops of a
+// tile can also fall back to the tiles around it. Only the most recent tiles are
+// kept around
+class stop_connection_indexes_t {
+public:
+  const stop_connection_index_t& get(const GraphId& tile_id, const GraphTile* tile) {
+    auto found = indexes_.find(tile_id);
+    if (found != indexes_.end()) {
+      return found->second;
+    }
+    if (indexes_.size() >= kMaxIndexes) {
+      indexes_.clear();
+    }
+    return indexes_.emplace(tile_id, stop_connection_index_t(tile)).first->second;
+  }
+
+private:
+  static constexpr size_t kMaxIndexes = 64;
+  std::unordered_map<GraphId, stop_connection_index_t> indexes_;
+};
+
 // Converts a transit stop GraphId on local level to be on the transit level
 GraphId GetGraphId(const GraphId& nodeid, const std::unordered_set<GraphId>& tiles) {
   auto t = tiles.find(nodeid.Tile_Base());
@@ -369,6 +459,7 @@ void ConnectToGraph(GraphTileBuilder& tilebuilder_local,
 void FindOSMConnection(const PointLL& stop_ll,
                        GraphReader& reader_local_level,
                        std::mutex& lock,
+                       stop_connection_indexes_t& indexes,
                        std::vector<std::string>& names,
                        uint64_t& wayid,
                        GraphId& startnode,
@@ -402,10 +493,12 @@ void FindOSMConnection(const PointLL& stop_ll,
       continue;
     }
 
-    // Use distance approximator for all distance checks
+    // Use distance approximator for all distance checks. Only the nodes in
+    // the grid cells around the stop can be within the radius
     PointLL base_ll = newtile->header()->base_ll();
     DistanceApproximator approximator(stop_ll);
-    for (uint32_t i = 0; i < newtile->header()->nodecount(); i++) {
+    const auto& index = indexes.get(GraphId(t, local_level, 0), newtile);
+    index.nodes_within(bbox, [&](const uint32_t i) {
       const NodeInfo* node = newtile->node(i);
       // Check if within radius
       if (approximator.DistanceSquared(node->latlng(base_ll)) < mr2) {
@@ -423,13 +516,10 @@ void FindOSMConnection(const PointLL& stop_ll,
           }
 
           auto this_closest = stop_ll.ClosestPoint(this_shape);
-          // Get names
-          names = edgeinfo.GetNames();
-
           if (std::get<1>(this_closest) < mindist) {
-            // use the new wayid
-
+            // use the new wayid and its names
             wayid = edgeinfo.wayid();
+            names = edgeinfo.GetNames();
             startnode = {newtile->header()->graphid().tileid(), newtile->header()->graphid().level(),
                          i};
             endnode = directededge->endnode();
@@ -440,7 +530,7 @@ void FindOSMConnection(const PointLL& stop_ll,
           }
         }
       }
-    }
+    });
   }
 }
 
@@ -451,6 +541,7 @@ void AddOSMConnection(const GraphId& transit_stop_node,
                       const GraphTile* tile,
                       GraphReader& reader_local_level,
                       std::mutex& lock,
+                      stop_connection_indexes_t& indexes,
                       std::vector<OSMConnectionEdge>& connection_edges) {
 
   const PointLL& stop_ll = transit_node->latlng(tile->header()->base_ll());
@@ -462,39 +553,33 @@ void AddOSMConnection(const GraphId& transit_stop_node,
   std::vector<PointLL> closest_shape;
   std::tuple<PointLL, float, int> closest;
   std::vector<std::string> names;
-  for (uint32_t i = 0; i < tile->header()->nodecount(); i++) {
-    const NodeInfo* node = tile->node(i);
-    for (uint32_t j = 0, n = node->edge_count(); j < n; j++) {
-      const DirectedEdge* directededge = tile->directededge(node->edge_index() + j);
-      auto edgeinfo = tile->edgeinfo(directededge->edgeinfo_offset());
-
-      if (edgeinfo.wayid() == wayid) {
+  const auto& index = indexes.get(tile->header()->graphid(), tile);
+  for (const auto& way_edge : index.edges_of_way(wayid)) {
+    const DirectedEdge* directededge = tile->directededge(way_edge.edge_index);
+    auto edgeinfo = tile->edgeinfo(directededge->edgeinfo_offset());
 
-        // Get shape and find closest point
-        auto this_shape = edgeinfo.shape();
+    // Get shape and find closest point
+    auto this_shape = edgeinfo.shape();
 
-        if (!directededge->forward()) {
-          std::reverse(this_shape.begin(), this_shape.end());
-        }
-        auto this_closest = stop_ll.ClosestPoint(this_shape);
-        // Get names
-        names = edgeinfo.GetNames();
-
-        if (std::get<1>(this_closest) < mindist) {
-          startnode = {tile->header()->graphid().tileid(), tile->header()->graphid().level(), i};
-          endnode = directededge->endnode();
-          mindist = std::get<1>(this_closest);
-          closest = this_closest;
-          closest_shape = this_shape;
-          edgelength = directededge->length();
-        }
-      }
+    if (!directededge->forward()) {
+      std::reverse(this_shape.begin(), this_shape.end());
+    }
+    auto this_closest = stop_ll.ClosestPoint(this_shape);
+    if (std::get<1>(this_closest) < mindist) {
+      names = edgeinfo.GetNames();
+      startnode = {tile->header()->graphid().tileid(), tile->header()->graphid().level(),
+                   way_edge.node_index};
+      endnode = directededge->endnode();
+      mindist = std::get<1>(this_closest);
+      closest = this_closest;
+      closest_shape = this_shape;
+      edgelength = directededge->length();
     }
   }
 
   // Check for invalid tile Ids
   if (!startnode.Is_Valid() && !endnode.Is_Valid()) {
-    FindOSMConnection(stop_ll, reader_local_level, lock, names, wayid, startnode, endnode,
+    FindOSMConnection(stop_ll, reader_local_level, lock, indexes, names, wayid, startnode, endnode,
                       closest_shape, closest);
 
     // Check for invalid tile Ids...are we still no good?
@@ -577,6 +662,10 @@ void build(const std::string& transit_dir,
   GraphReader reader_local_level(pt);
   GraphReader reader_transit_level(pt);
 
+  // Indexes of the local tiles used to connect the stops to OSM. They point at nothing
+  // in the tiles themselves, so they stay good when the reader cache is trimmed
+  stop_connection_indexes_t indexes;
+
   // Iterate through the tiles in the queue and find any that include stops
   for (; tile_start != tile_end; ++tile_start) {
     // Get the next tile Id from the queue and get a tile builder
@@ -624,7 +713,7 @@ void build(const std::string& transit_dir,
         // Form connections to the stop
         // TODO - deal with station hierarchy (only connect egress locations)
         AddOSMConnection(transit_stop_node, transit_stop, stop_name, local_tile, reader_local_level,
-                         lock, connection_edges);
+                         lock, indexes, connection_edges);
       }
     }
 
@@ -1,18 +1,28 @@
 #include "mjolnir/util.h"
 
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/json.h"
 #include "baldr/tilehierarchy.h"
+#include "baldr/tileindex.h"
 #include "filesystem.h"
 #include "midgard/aabb2.h"
 #include "midgard/logging.h"
 #include "midgard/point2.h"
 #include "midgard/polyline2.h"
+#include "midgard/sequence.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/cellpartitionbuilder.h"
+#include "mjolnir/chbuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
+#include "mjolnir/graphcomponents.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/graphfilter.h"
+#include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/landmarkbuilder.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/restrictionbuilder.h"
@@ -24,6 +34,18 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+
 using namespace valhalla::midgard;
 
 namespace {
@@ -40,6 +62,49 @@ const std::string cr_to_file = "complex_to_restrictions.bin";
 const std::string new_to_old_file = "new_nodes_to_old_nodes.bin";
 const std::string old_to_new_file = "old_nodes_to_new_nodes.bin";
 
+// Tar files are in blocks of a header and the data of tiles in an extract start on a page
+constexpr uint64_t kTarBlockSize = sizeof(valhalla::midgard::tar::header_t);
+constexpr uint64_t kExtractPageSize = 4096;
+
+uint64_t tar_blocks(const uint64_t size) {
+  return (size + kTarBlockSize - 1) / kTarBlockSize * kTarBlockSize;
+}
+
+// The ustar header of a regular file in an extract
+valhalla::midgard::tar::header_t tar_header(const std::string& name, const uint64_t size) {
+  valhalla::midgard::tar::header_t header{};
+  snprintf(header.name, sizeof(header.name), "%s", name.c_str());
+  snprintf(header.mode, sizeof(header.mode), "%07o", 0644);
+  snprintf(header.uid, sizeof(header.uid), "%07o", 0);
+  snprintf(header.gid, sizeof(header.gid), "%07o", 0);
+  snprintf(header.size, sizeof(header.size), "%011llo", static_cast<unsigned long long>(size));
+  snprintf(header.mtime, sizeof(header.mtime), "%011llo",
+           static_cast<unsigned long long>(time(nullptr)));
+  header.typeflag = '0';
+  memcpy(header.magic, "ustar", sizeof(header.magic));
+  memcpy(header.version, "00", sizeof(header.version));
+  memset(header.chksum, ' ', sizeof(header.chksum));
+  unsigned checksum = 0;
+  for (size_t i = 0; i < sizeof(header); ++i) {
+    checksum += reinterpret_cast<const unsigned char*>(&header)[i];
+  }
+  snprintf(header.chksum, sizeof(header.chksum), "%06o", checksum);
+  return header;
+}
+
+// Writes all of the bytes at an offset of the file
+void write_at(const int fd, const char* data, uint64_t size, uint64_t offset) {
+  while (size > 0) {
+    auto written = pwrite(fd, data, size, offset);
+    if (written < 0) {
+      throw std::runtime_error("Could not write the tile extract: " + std::string(strerror(errno)));
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -130,6 +195,372 @@ bool shapes_match(const std::vector<PointLL>& shape1, const std::vector<PointLL>
   }
 }
 
+// Estimate the cost of working on tiles by the size of their files
+std::vector<std::pair<baldr::GraphId, size_t>>
+TileCosts(const std::string& tile_dir, const std::unordered_set<baldr::GraphId>& tiles) {
+  std::vector<std::pair<baldr::GraphId, size_t>> costs;
+  costs.reserve(tiles.size());
+  for (const auto& tile_id : tiles) {
+    auto file = tile_dir + filesystem::path::preferred_separator +
+                baldr::GraphTile::FileSuffix(tile_id.Tile_Base());
+    boost::system::error_code ec;
+    auto size = boost::filesystem::file_size(file, ec);
+    costs.emplace_back(tile_id, ec ? 0 : size);
+  }
+  return costs;
+}
+
+std::unordered_set<baldr::GraphId>
+DirtyTiles(const std::vector<midgard::AABB2<midgard::PointLL>>& changed, const uint8_t level) {
+  auto found = baldr::TileHierarchy::levels().find(level);
+  if (found == baldr::TileHierarchy::levels().end()) {
+    throw std::runtime_error("Invalid hierarchy level: " + std::to_string(level));
+  }
+  const auto& tiles = found->second.tiles;
+
+  // Grow each box by a tile on every side to pick up the neighbours
+  std::unordered_set<baldr::GraphId> dirty;
+  for (const auto& box : changed) {
+    midgard::AABB2<midgard::PointLL> grown(box.minx() - tiles.TileSize(),
+                                           box.miny() - tiles.TileSize(),
+                                           box.maxx() + tiles.TileSize(),
+                                           box.maxy() + tiles.TileSize());
+    for (auto tile_id : tiles.TileList(grown)) {
+      dirty.emplace(tile_id, level, 0);
+    }
+  }
+  return dirty;
+}
+
+size_t AddBinBounds(const boost::property_tree::ptree& config) {
+  std::string tile_dir = config.get<std::string>("mjolnir.tile_dir");
+  auto bin_level = baldr::TileHierarchy::levels().rbegin()->first;
+  std::vector<baldr::GraphId> tiles;
+  for (const auto& id : baldr::GraphReader(config.get_child("mjolnir")).GetTileSet(bin_level)) {
+    tiles.push_back(id);
+  }
+  LOG_INFO("Bounding the binned edges of " + std::to_string(tiles.size()) + " tiles...");
+
+  // each thread looks up the binned edges with its own reader, the tiles being bounded are
+  // read into memory since their files are replaced
+  std::atomic<size_t> next(0);
+  std::atomic<size_t> bounded(0);
+  std::vector<std::thread> threads(
+      std::max(static_cast<unsigned int>(1),
+               config.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      baldr::GraphReader reader(config.get_child("mjolnir"));
+      for (size_t i; (i = next++) < tiles.size();) {
+        baldr::GraphTile tile(tile_dir, tiles[i]);
+        if (!tile.header() || tile.header()->bin_offset(baldr::kBinCount - 1).second == 0) {
+          continue;
+        }
+        auto bounds = GraphTileBuilder::BoundBins(&tile, reader);
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
+        GraphTileBuilder::AddBinBounds(tile_dir, &tile, bounds);
+        ++bounded;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG_INFO("Bounded the bins of " + std::to_string(bounded) + " tiles");
+  return bounded;
+}
+
+size_t AddShortcutExpansions(const boost::property_tree::ptree& config) {
+  std::string tile_dir = config.get<std::string>("mjolnir.tile_dir");
+  std::vector<baldr::GraphId> tiles;
+  const auto transit_level = baldr::TileHierarchy::GetTransitLevel().level;
+  for (const auto& id : baldr::GraphReader(config.get_child("mjolnir")).GetTileSet()) {
+    if (id.level() != transit_level) {
+      tiles.push_back(id);
+    }
+  }
+  LOG_INFO("Expanding the shortcuts of " + std::to_string(tiles.size()) + " tiles...");
+
+  // each thread follows the superseded edges with its own reader, the tiles being expanded are
+  // read into memory since their files are replaced
+  std::atomic<size_t> next(0);
+  std::atomic<size_t> expanded(0);
+  std::vector<std::thread> threads(
+      std::max(static_cast<unsigned int>(1),
+               config.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      baldr::GraphReader reader(config.get_child("mjolnir"));
+      for (size_t i; (i = next++) < tiles.size();) {
+        baldr::GraphTile tile(tile_dir, tiles[i]);
+        if (!tile.header()) {
+          continue;
+        }
+        auto expansions = GraphTileBuilder::ExpandShortcuts(&tile, reader);
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
+        if (!expansions.empty()) {
+          GraphTileBuilder::AddShortcutExpansions(tile_dir, &tile, expansions);
+          ++expanded;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG_INFO("Expanded the shortcuts of " + std::to_string(expanded) + " tiles");
+  return expanded;
+}
+
+size_t CompressColdSections(const boost::property_tree::ptree& config) {
+  std::string tile_dir = config.get<std::string>("mjolnir.tile_dir");
+  auto tile_set = baldr::GraphReader(config.get_child("mjolnir")).GetTileSet();
+  std::vector<baldr::GraphId> tiles(tile_set.begin(), tile_set.end());
+  LOG_INFO("Compressing the edge info and text of " + std::to_string(tiles.size()) + " tiles...");
+
+  // the tiles are read into memory, never mapped, since their files are rewritten
+  std::atomic<size_t> next(0);
+  std::atomic<size_t> compressed(0);
+  std::vector<std::thread> threads(
+      std::max(static_cast<unsigned int>(1),
+               config.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      for (size_t i; (i = next++) < tiles.size();) {
+        baldr::GraphTile tile(tile_dir, tiles[i]);
+        if (tile.header() && GraphTileBuilder::CompressColdSections(tile_dir, &tile)) {
+          ++compressed;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG_INFO("Compressed " + std::to_string(compressed) + " tiles");
+  return compressed;
+}
+
+size_t WriteTileExtract(const boost::property_tree::ptree& config, const std::string& extract) {
+  std::string tile_dir = config.get<std::string>("mjolnir.tile_dir");
+  auto tile_set = baldr::GraphReader(config.get_child("mjolnir")).GetTileSet();
+  std::vector<baldr::GraphId> tiles(tile_set.begin(), tile_set.end());
+  std::sort(tiles.begin(), tiles.end());
+  LOG_INFO("Writing " + std::to_string(tiles.size()) + " tiles to the extract " + extract);
+
+  // Lay the extract out: the index, then each tile behind a header. When the data of a tile would
+  // not start on a page a padding file before it pushes it there
+  std::vector<baldr::TileIndexEntry> index;
+  std::vector<std::string> names;
+  index.reserve(tiles.size());
+  names.reserve(tiles.size());
+  uint64_t offset = kTarBlockSize + tar_blocks(tiles.size() * sizeof(baldr::TileIndexEntry));
+  std::vector<std::pair<uint64_t, uint64_t>> paddings;
+  for (const auto& tile_id : tiles) {
+    names.push_back(baldr::GraphTile::FileSuffix(tile_id));
+    boost::system::error_code ec;
+    auto size = boost::filesystem::file_size(tile_dir + filesystem::path::preferred_separator +
+                                                 names.back(),
+                                             ec);
+    if (ec) {
+      throw std::runtime_error("Could not size tile " + names.back() + ": " + ec.message());
+    }
+    auto misaligned = (offset + kTarBlockSize) % kExtractPageSize;
+    if (misaligned != 0) {
+      paddings.emplace_back(offset, kExtractPageSize - misaligned - kTarBlockSize);
+      offset += kExtractPageSize - misaligned;
+    }
+    index.push_back({offset + kTarBlockSize, tile_id.value, size});
+    offset += kTarBlockSize + tar_blocks(size);
+  }
+  // and the two empty blocks that end a tar
+  const uint64_t extract_size = offset + 2 * kTarBlockSize;
+
+  // The file is sized up front so the tiles can be written anywhere in it at once
+  const std::string temporary = extract + ".tmp";
+  int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, extract_size) != 0) {
+    throw std::runtime_error("Could not create the tile extract " + temporary + ": " +
+                             strerror(errno));
+  }
+  auto header = tar_header(baldr::kTileIndexFile, index.size() * sizeof(baldr::TileIndexEntry));
+  write_at(fd, reinterpret_cast<const char*>(&header), sizeof(header), 0);
+  write_at(fd, reinterpret_cast<const char*>(index.data()),
+           index.size() * sizeof(baldr::TileIndexEntry), kTarBlockSize);
+  for (const auto& padding : paddings) {
+    header = tar_header(".padding", padding.second);
+    write_at(fd, reinterpret_cast<const char*>(&header), sizeof(header), padding.first);
+  }
+
+  // Each thread copies tiles to where the index put them, the gaps are already zeros
+  std::atomic<size_t> next(0);
+  std::exception_ptr failure;
+  std::mutex failure_lock;
+  std::vector<std::thread> threads(
+      std::max(static_cast<unsigned int>(1),
+               config.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      std::vector<char> data;
+      try {
+        for (size_t i; (i = next++) < tiles.size();) {
+          std::ifstream file(tile_dir + filesystem::path::preferred_separator + names[i],
+                             std::ios::binary);
+          data.resize(index[i].size);
+          if (!file.read(data.data(), data.size())) {
+            throw std::runtime_error("Could not read tile " + names[i]);
+          }
+          auto tile_header = tar_header(names[i], data.size());
+          write_at(fd, reinterpret_cast<const char*>(&tile_header), sizeof(tile_header),
+                   index[i].offset - kTarBlockSize);
+          write_at(fd, data.data(), data.size(), index[i].offset);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(failure_lock);
+        failure = std::current_exception();
+        next = tiles.size();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  close(fd);
+  if (failure) {
+    boost::filesystem::remove(temporary);
+    std::rethrow_exception(failure);
+  }
+  boost::filesystem::rename(temporary, extract);
+  LOG_INFO("Wrote " + std::to_string(tiles.size()) + " tiles to the extract " + extract);
+  return tiles.size();
+}
+
+BuildProfile::Stage::Stage(BuildProfile& profile, const BuildStage stage)
+    : profile_(profile), stage_(stage) {
+#ifdef __linux__
+  // Resets the peak resident memory of the process so that we get the one of this stage
+  std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+  start_ = Now();
+}
+
+BuildProfile::Stage::~Stage() {
+  auto end = Now();
+  Usage usage{stage_,
+              std::chrono::duration<double>(end.time - start_.time).count(),
+              end.cpu_seconds - start_.cpu_seconds,
+              0,
+              end.bytes_read - start_.bytes_read,
+              end.bytes_written - start_.bytes_written,
+              end.storage_bytes_read - start_.storage_bytes_read,
+              end.storage_bytes_written - start_.storage_bytes_written,
+              0};
+
+  // Without the resettable peak of linux all we have is the peak of the process so far
+  rusage resources{};
+  getrusage(RUSAGE_SELF, &resources);
+#ifdef __APPLE__
+  usage.peak_rss_bytes = resources.ru_maxrss;
+#else
+  usage.peak_rss_bytes = static_cast<uint64_t>(resources.ru_maxrss) * 1024;
+#endif
+#ifdef __linux__
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      usage.peak_rss_bytes = std::stoull(line.substr(6)) * 1024;
+      break;
+    }
+  }
+#endif
+
+  // Whatever the stage left behind, tiles and temporary files
+  boost::system::error_code ec;
+  for (boost::filesystem::recursive_directory_iterator i(profile_.tile_dir_, ec), end_i;
+       !ec && i != end_i; i.increment(ec)) {
+    if (boost::filesystem::is_regular_file(i->path(), ec)) {
+      usage.tile_dir_bytes += boost::filesystem::file_size(i->path(), ec);
+    }
+  }
+
+  profile_.Add(usage);
+}
+
+BuildProfile::Stage::counters_t BuildProfile::Stage::Now() {
+  counters_t counters{std::chrono::steady_clock::now(), 0, 0, 0, 0, 0};
+  rusage resources{};
+  getrusage(RUSAGE_SELF, &resources);
+  counters.cpu_seconds = resources.ru_utime.tv_sec + resources.ru_utime.tv_usec / 1e6 +
+                         resources.ru_stime.tv_sec + resources.ru_stime.tv_usec / 1e6;
+#ifdef __linux__
+  // Lines like "rchar: 1234", there is no portable way to get these
+  std::ifstream io("/proc/self/io");
+  std::string name;
+  uint64_t value;
+  while (io >> name >> value) {
+    if (name == "rchar:") {
+      counters.bytes_read = value;
+    } else if (name == "wchar:") {
+      counters.bytes_written = value;
+    } else if (name == "read_bytes:") {
+      counters.storage_bytes_read = value;
+    } else if (name == "write_bytes:") {
+      counters.storage_bytes_written = value;
+    }
+  }
+#endif
+  return counters;
+}
+
+BuildProfile::BuildProfile(const std::string& tile_dir, const std::string& output_file)
+    : tile_dir_(tile_dir), output_file_(output_file) {
+}
+
+void BuildProfile::Add(const Usage& usage) {
+  stages_.push_back(usage);
+  LOG_INFO("Stage " + to_string(usage.stage) + " took " + std::to_string(usage.wall_seconds) +
+           "s (" + std::to_string(usage.cpu_seconds) + "s cpu), peak rss " +
+           std::to_string(usage.peak_rss_bytes >> 20) + "MB, read " +
+           std::to_string(usage.bytes_read >> 20) + "MB, wrote " +
+           std::to_string(usage.bytes_written >> 20) + "MB, tile dir " +
+           std::to_string(usage.tile_dir_bytes >> 20) + "MB");
+
+  // Rewritten after every stage so a build that fails still leaves the ones before
+  if (!output_file_.empty()) {
+    std::ofstream file(output_file_, std::ios::trunc);
+    file << ToJson();
+    if (!file) {
+      LOG_WARN("Failed to write the build profile to " + output_file_);
+    }
+  }
+}
+
+std::string BuildProfile::ToJson() const {
+  namespace json = valhalla::baldr::json;
+  auto stages = json::array({});
+  for (const auto& usage : stages_) {
+    stages->emplace_back(json::map({
+        {"stage", to_string(usage.stage)},
+        {"wall_seconds", json::fp_t{usage.wall_seconds, 3}},
+        {"cpu_seconds", json::fp_t{usage.cpu_seconds, 3}},
+        {"peak_rss_bytes", usage.peak_rss_bytes},
+        {"bytes_read", usage.bytes_read},
+        {"bytes_written", usage.bytes_written},
+        {"storage_bytes_read", usage.storage_bytes_read},
+        {"storage_bytes_written", usage.storage_bytes_written},
+        {"tile_dir_bytes", usage.tile_dir_bytes},
+    }));
+  }
+  std::stringstream ss;
+  ss << *json::map({{"stages", stages}});
+  return ss.str();
+}
+
 bool build_tile_set(const boost::property_tree::ptree& config,
                     const std::vector<std::string>& input_files,
                     const BuildStage start_stage,
@@ -151,9 +582,13 @@ bool build_tile_set(const boost::property_tree::ptree& config,
     tile_dir.push_back(filesystem::path::preferred_separator);
   }
 
+  // What each stage takes, logged as it ends and written to mjolnir.build_profile if there is one
+  BuildProfile profile(tile_dir, config.get<std::string>("mjolnir.build_profile", ""));
+
   // During the initialize stage the tile directory will be purged (if it already exists)
   // and will be created if it does not already exist
   if (start_stage == BuildStage::kInitialize) {
+    BuildProfile::Stage measure(profile, BuildStage::kInitialize);
     // set up the directories and purge old tiles if starting at the parsing stage
     for (const auto& level : valhalla::baldr::TileHierarchy::levels()) {
       auto level_dir = tile_dir + std::to_string(level.first);
@@ -193,6 +628,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Parse OSM data
   if (start_stage <= BuildStage::kParse && BuildStage::kParse <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kParse);
     // Read the OSM protocol buffer file. Callbacks for nodes, ways, and
     // relations are defined within the PBFParser class
     osm_data =
@@ -210,6 +646,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Build Valhalla routing tiles
   if (start_stage <= BuildStage::kBuild && BuildStage::kBuild <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kBuild);
     // Read OSMData from files if building tiles is the first stage
     if (start_stage == BuildStage::kBuild) {
       osm_data.read_from_temp_files(tile_dir);
@@ -224,6 +661,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   // level that is usable across all levels (density, administrative
   // information (and country based attribution), edge transition logic, etc.
   if (start_stage <= BuildStage::kEnhance && BuildStage::kEnhance <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kEnhance);
     // Read OSMData names from file if building tiles is the first stage
     if (start_stage == BuildStage::kEnhance) {
       osm_data.read_from_unique_names_file(tile_dir);
@@ -233,16 +671,19 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Perform optional edge filtering (remove edges and nodes for specific access modes)
   if (start_stage <= BuildStage::kFilter && BuildStage::kFilter <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kFilter);
     GraphFilter::Filter(config);
   }
 
   // Add transit
   if (start_stage <= BuildStage::kTransit && BuildStage::kTransit <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kTransit);
     TransitBuilder::Build(config);
   }
 
   // Build bike share stations
   if (start_stage <= BuildStage::kBss && BuildStage::kBss <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kBss);
     BssBuilder::Build(config, bss_nodes_bin);
   }
 
@@ -251,6 +692,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   auto build_hierarchy = config.get<bool>("mjolnir.hierarchy", true);
   if (build_hierarchy) {
     if (start_stage <= BuildStage::kHierarchy && BuildStage::kHierarchy <= end_stage) {
+      BuildProfile::Stage measure(profile, BuildStage::kHierarchy);
       HierarchyBuilder::Build(config, new_to_old_bin, old_to_new_bin);
     }
 
@@ -259,6 +701,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
     auto build_shortcuts = config.get<bool>("mjolnir.shortcuts", true);
     if (build_shortcuts) {
       if (start_stage <= BuildStage::kShortcuts && BuildStage::kShortcuts <= end_stage) {
+        BuildProfile::Stage measure(profile, BuildStage::kShortcuts);
         ShortcutBuilder::Build(config);
       }
     } else {
@@ -268,8 +711,17 @@ bool build_tile_set(const boost::property_tree::ptree& config,
     LOG_INFO("Skipping hierarchy builder and shortcut builder");
   }
 
+  // Build the contraction hierarchy for auto routes if specified in the config file
+  if (config.get<bool>("mjolnir.contraction_hierarchy", false)) {
+    if (start_stage <= BuildStage::kContraction && BuildStage::kContraction <= end_stage) {
+      BuildProfile::Stage measure(profile, BuildStage::kContraction);
+      CHBuilder::Build(config);
+    }
+  }
+
   // Add elevation to the tiles
   if (start_stage <= BuildStage::kElevation && BuildStage::kElevation <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kElevation);
     ElevationBuilder::Build(config);
   }
 
@@ -278,16 +730,48 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   // elevation into the tiles reads each tile and serializes the data to "builders"
   // within the tile. However, there is no serialization currently available for complex restrictions.
   if (start_stage <= BuildStage::kRestrictions && BuildStage::kRestrictions <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kRestrictions);
     RestrictionBuilder::Build(config, cr_from_bin, cr_to_bin);
   }
 
   // Validate the graph and add information that cannot be added until full graph is formed.
   if (start_stage <= BuildStage::kValidate && BuildStage::kValidate <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kValidate);
     GraphValidator::Validate(config);
+    // Nothing changes which edges connect to which after validation
+    if (config.get<bool>("mjolnir.label_components", false)) {
+      GraphComponents::Label(config);
+    }
+    // Nor does the length of any edge
+    if (config.get<bool>("mjolnir.landmarks", false)) {
+      LandmarkBuilder::Build(config);
+    }
+    // Or the topology the cells are cut from
+    if (config.get<bool>("mjolnir.cell_partition", false)) {
+      CellPartitionBuilder::Build(config);
+    }
+    // The bins are final once the tiles are validated
+    if (config.get<bool>("mjolnir.bin_bounds", false)) {
+      AddBinBounds(config);
+    }
+    // As are the edges the shortcuts supersede
+    if (config.get<bool>("mjolnir.shortcut_expansions", false)) {
+      AddShortcutExpansions(config);
+    }
+    // Compressing the tiles is the last thing done to them
+    if (config.get<bool>("mjolnir.compress_cold_sections", false)) {
+      CompressColdSections(config);
+    }
+    // So they can go into an extract now
+    auto extract = config.get<std::string>("mjolnir.build_extract", "");
+    if (!extract.empty()) {
+      WriteTileExtract(config, extract);
+    }
   }
 
   // Cleanup bin files
   if (start_stage <= BuildStage::kCleanup && BuildStage::kCleanup <= end_stage) {
+    BuildProfile::Stage measure(profile, BuildStage::kCleanup);
     LOG_INFO("Cleaning up temporary *.bin files within " + tile_dir);
     remove_temp_file(ways_bin);
     remove_temp_file(way_nodes_bin);
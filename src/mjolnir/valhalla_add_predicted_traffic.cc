@@ -9,16 +9,17 @@
 #include <cmath>
 #include <cstdint>
 
-#include <boost/archive/iterators/base64_from_binary.hpp>
-#include <boost/archive/iterators/binary_from_base64.hpp>
-#include <boost/archive/iterators/transform_width.hpp>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
-#include <boost/tokenizer.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <deque>
+#include <fstream>
 #include <future>
+#include <limits>
 #include <mutex>
 #include <queue>
 #include <string>
@@ -53,136 +54,206 @@ struct stats {
   }
 };
 
+// Speeds of a directed edge, indexed by the edge's id within the tile. The entries and their
+// coefficients are reused from tile to tile so parsing does not allocate once warmed up
 struct TrafficSpeeds {
-  uint8_t constrained_flow_speed;
-  uint8_t free_flow_speed;
+  bool parsed;
+  uint32_t constrained_flow_speed;
+  uint32_t free_flow_speed;
   std::vector<int16_t> coefficients;
 };
 
-// Convert big endian bytes to little endian
-int16_t to_little_endian(const int16_t val) {
-  return (val << 8) | ((val >> 8) & 0x00ff);
+// Size of the base64 decoded predicted speeds, 2 big endian bytes per coefficient plus padding
+constexpr size_t kDecodedSpeedSize = 402;
+
+// Skip the spaces at either end of a field
+void trim(const char*& pos, const char*& end) {
+  while (pos < end && (*pos == ' ' || *pos == '\t'))
+    ++pos;
+  while (end > pos && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+    --end;
 }
 
-// base64 decoding
-std::string decode64(const std::string& val) {
-  using namespace boost::archive::iterators;
-  using It = transform_width<binary_from_base64<std::string::const_iterator>, 8, 6>;
-  return std::string(It(std::begin(val)), It(std::end(val)));
+// Parse an unsigned number from the front of [pos, end) and move pos past it
+bool parse_uint(const char*& pos, const char* end, uint32_t& value) {
+  const char* start = pos;
+  uint64_t v = 0;
+  for (; pos < end && *pos >= '0' && *pos <= '9'; ++pos) {
+    v = v * 10 + (*pos - '0');
+    if (v > std::numeric_limits<uint32_t>::max())
+      return false;
+  }
+  value = static_cast<uint32_t>(v);
+  return pos != start;
+}
+
+// A field holding only an unsigned number
+bool parse_uint_field(const char* pos, const char* end, uint32_t& value) {
+  trim(pos, end);
+  return parse_uint(pos, end, value) && pos == end;
+}
+
+// The edge id of a level/tile/id field
+bool parse_edge_id(const char* pos, const char* end, uint32_t& id) {
+  trim(pos, end);
+  uint32_t level, tile;
+  return parse_uint(pos, end, level) && pos < end && *pos++ == '/' && parse_uint(pos, end, tile) &&
+         pos < end && *pos++ == '/' && parse_uint(pos, end, id) && pos == end &&
+         id <= kMaxGraphId;
+}
+
+// base64 decoding straight into the output, returns the decoded size or -1 if it isnt base64
+int decode64(const char* pos, const char* end, uint8_t* out, const size_t max_size) {
+  static const auto table = []() {
+    std::array<int8_t, 256> table;
+    table.fill(-1);
+    const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (int8_t i = 0; i < 64; ++i)
+      table[static_cast<uint8_t>(alphabet[i])] = i;
+    return table;
+  }();
+
+  // padding is optional
+  while (end > pos && end[-1] == '=')
+    --end;
+  size_t size = 0;
+  uint32_t bits = 0, bit_count = 0;
+  for (; pos < end; ++pos) {
+    auto value = table[static_cast<uint8_t>(*pos)];
+    if (value < 0)
+      return -1;
+    bits = (bits << 6) | value;
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      if (size == max_size)
+        return -1;
+      out[size++] = static_cast<uint8_t>(bits >> bit_count);
+    }
+  }
+  return static_cast<int>(size);
 }
 
 /**
- * Read speed CSV file and update the tile_speeds in unique_data
+ * Parse one row of a speed CSV file: edge id, free flow speed, constrained flow speed and the
+ * optional base64 encoded predicted speeds
  */
-std::unordered_map<uint32_t, TrafficSpeeds>
-ParseTrafficFile(const std::vector<std::string>& filenames, stats& stat) {
-  typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
-  boost::char_separator<char> sep{","};
-  std::unordered_map<uint32_t, TrafficSpeeds> ts;
+bool ParseTrafficRow(const char* pos,
+                     const char* end,
+                     std::vector<TrafficSpeeds>& speeds,
+                     stats& stat,
+                     const std::string& filename,
+                     const uint32_t line_num) {
+  // split the fields without copying them
+  std::array<std::pair<const char*, const char*>, 4> fields;
+  size_t field_count = 0;
+  while (field_count < fields.size()) {
+    const char* comma = static_cast<const char*>(std::memchr(pos, ',', end - pos));
+    fields[field_count++] = {pos, comma ? comma : end};
+    if (!comma)
+      break;
+    pos = comma + 1;
+  }
 
-  // for each traffic tile
-  for (const auto& full_filename : filenames) {
-    // Open file
-    std::string line;
-    std::ifstream file(full_filename);
-    uint32_t line_num = 0;
-    if (file.is_open()) {
-      // for each row in the file
-      while (getline(file, line) && ++line_num) {
-        decltype(ts)::iterator traffic = ts.end();
-        tokenizer tok{line, sep};
-        uint32_t field_num = 0;
-        bool has_error = false;
-        // for each column in the row
-        for (const auto& t : tok) {
-          if (has_error)
-            break;
-          // parse each column
-          switch (field_num) {
-            case 0: {
-              try {
-                auto inserted = ts.insert(decltype(ts)::value_type(GraphId(t).id(), {}));
-                traffic = inserted.first;
-                // skip duplicates
-                if (!inserted.second) {
-                  ++stat.dup_count;
-                  has_error = true;
-                  traffic = ts.end();
-                }
-              } catch (std::exception& e) {
-                LOG_WARN("Invalid GraphId in file: " + full_filename + " line number " +
-                         std::to_string(line_num));
-                has_error = true;
-              }
-            } break;
-            case 1: {
-              try {
-                traffic->second.free_flow_speed = std::stoi(t);
-                stat.free_flow_count++;
-              } catch (std::exception& e) {
-                LOG_WARN("Invalid free flow speed in file: " + full_filename + " line number " +
-                         std::to_string(line_num));
-                has_error = true;
-              }
-            } break;
-            case 2: {
-              try {
-                traffic->second.constrained_flow_speed = std::stoi(t);
-                stat.constrained_count++;
-              } catch (std::exception& e) {
-                LOG_WARN("Invalid constrained flow speed in file: " + full_filename +
-                         " line number " + std::to_string(line_num));
-                has_error = true;
-              }
-            } break;
-            case 3: {
-              if (t.size()) {
-                try {
-                  // Decode the base64 predicted speeds
-                  // Decode the base64 string and cast the data to a raw string of signed bytes
-                  auto decoded_str = decode64(t);
-                  if (decoded_str.size() != 402) {
-                    throw std::runtime_error("Decoded speed string size should be 402 but is " +
-                                             std::to_string(decoded_str.size()));
-                  }
-                  auto raw = reinterpret_cast<const int8_t*>(decoded_str.data());
-
-                  // Create the coefficients. Each group of 2 bytes represents a signed, int16 number
-                  // (big endian). Convert to little endian.
-                  traffic->second.coefficients.reserve(kCoefficientCount);
-                  for (uint32_t i = 0, idx = 0; i < kCoefficientCount; ++i, idx += 2) {
-                    traffic->second.coefficients.push_back(
-                        to_little_endian(*(reinterpret_cast<const int16_t*>(&raw[idx]))));
-                  }
-                  stat.compressed_count++;
-                } catch (std::exception& e) {
-                  LOG_WARN("Invalid compressed speeds in file: " + full_filename + " line number " +
-                           std::to_string(line_num));
-                  has_error = true;
-                }
-              }
-            } break;
-            default:
-              break;
-          }
-          field_num++;
-        }
-        // if this one was erroneous lets not keep it
-        if (has_error && traffic != ts.end())
-          ts.erase(traffic);
+  uint32_t id;
+  if (!parse_edge_id(fields[0].first, fields[0].second, id)) {
+    LOG_WARN("Invalid GraphId in file: " + filename + " line number " + std::to_string(line_num));
+    return false;
+  }
+  if (id >= speeds.size())
+    speeds.resize(id + 1);
+  auto& speed = speeds[id];
+  // skip duplicates
+  if (speed.parsed) {
+    ++stat.dup_count;
+    return false;
+  }
+
+  uint32_t free_flow = 0, constrained = 0;
+  if (field_count > 1 && !parse_uint_field(fields[1].first, fields[1].second, free_flow)) {
+    LOG_WARN("Invalid free flow speed in file: " + filename + " line number " +
+             std::to_string(line_num));
+    return false;
+  }
+  if (field_count > 2 && !parse_uint_field(fields[2].first, fields[2].second, constrained)) {
+    LOG_WARN("Invalid constrained flow speed in file: " + filename + " line number " +
+             std::to_string(line_num));
+    return false;
+  }
+
+  // Decode the base64 predicted speeds. Each group of 2 bytes represents a signed, int16 number
+  // (big endian)
+  speed.coefficients.clear();
+  if (field_count > 3) {
+    const char *first = fields[3].first, *last = fields[3].second;
+    trim(first, last);
+    if (first != last) {
+      std::array<uint8_t, kDecodedSpeedSize> raw;
+      if (decode64(first, last, raw.data(), raw.size()) != static_cast<int>(raw.size())) {
+        LOG_WARN("Invalid compressed speeds in file: " + filename + " line number " +
+                 std::to_string(line_num));
+        return false;
+      }
+      speed.coefficients.reserve(kCoefficientCount);
+      for (uint32_t i = 0, idx = 0; i < kCoefficientCount; ++i, idx += 2) {
+        speed.coefficients.push_back(static_cast<int16_t>((raw[idx] << 8) | raw[idx + 1]));
       }
-      file.close();
-    } else {
-      LOG_ERROR("Could not open file: " + full_filename);
+      stat.compressed_count++;
     }
   }
 
-  return ts;
+  speed.parsed = true;
+  speed.free_flow_speed = free_flow;
+  speed.constrained_flow_speed = constrained;
+  stat.free_flow_count += field_count > 1;
+  stat.constrained_count += field_count > 2;
+  return true;
+}
+
+/**
+ * Read the speed CSV files of a tile into speeds, indexed by the edge id within the tile
+ */
+void ParseTrafficFile(const std::vector<std::string>& filenames,
+                      std::vector<TrafficSpeeds>& speeds,
+                      std::string& buffer,
+                      stats& stat) {
+  // forget the last tile but keep the memory
+  for (auto& speed : speeds) {
+    speed.parsed = false;
+  }
+
+  // for each traffic tile
+  for (const auto& filename : filenames) {
+    // Read the whole file at once
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      LOG_ERROR("Could not open file: " + filename);
+      continue;
+    }
+    buffer.resize(file.tellg());
+    file.seekg(0);
+    file.read(&buffer[0], buffer.size());
+    buffer.resize(file.gcount());
+
+    // for each row in the file
+    uint32_t line_num = 0;
+    const char* pos = buffer.data();
+    const char* end = pos + buffer.size();
+    while (pos < end) {
+      const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+      if (!eol)
+        eol = end;
+      ++line_num;
+      if (eol != pos)
+        ParseTrafficRow(pos, eol, speeds, stat, filename, line_num);
+      pos = eol + 1;
+    }
+  }
 }
 
 void update_tile(const std::string& tile_dir,
                  const GraphId& tile_id,
-                 const std::unordered_map<uint32_t, TrafficSpeeds>& speeds,
+                 const std::vector<TrafficSpeeds>& speeds,
                  stats& stat) {
   auto tile_path = tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(tile_id);
   if (!filesystem::exists(tile_path)) {
@@ -192,23 +263,23 @@ void update_tile(const std::string& tile_dir,
 
   // Get the tile
   vj::GraphTileBuilder tile_builder(tile_dir, tile_id, false);
+  uint32_t edge_count = tile_builder.header()->directededgecount();
+  uint32_t speed_count = std::min(edge_count, static_cast<uint32_t>(speeds.size()));
 
   // Get a count of how many predicted speed edges there will be this avoids reallocs
   size_t pred_count = 0;
-  for (uint32_t j = 0; j < tile_builder.header()->directededgecount(); ++j) {
-    auto found = speeds.find(j);
-    pred_count += found != speeds.cend() && found->second.coefficients.size() == kCoefficientCount;
+  for (uint32_t j = 0; j < speed_count; ++j) {
+    pred_count += speeds[j].parsed && speeds[j].coefficients.size() == kCoefficientCount;
   }
 
   // Update directed edges as needed
   std::vector<DirectedEdge> directededges;
-  directededges.reserve(tile_builder.header()->directededgecount());
-  for (uint32_t j = 0; j < tile_builder.header()->directededgecount(); ++j) {
+  directededges.reserve(edge_count);
+  for (uint32_t j = 0; j < edge_count; ++j) {
     // skip edges for which we dont have speed data
     DirectedEdge& directededge = tile_builder.directededge(j);
-    auto found = speeds.find(j);
-    if (found != speeds.end()) {
-      const auto& speed = found->second;
+    if (j < speed_count && speeds[j].parsed) {
+      const auto& speed = speeds[j];
       if (speed.constrained_flow_speed) {
         directededge.set_constrained_flow_speed(speed.constrained_flow_speed);
       }
@@ -234,27 +305,29 @@ void update_tile(const std::string& tile_dir,
  * Read both the constrained and freeflow speed CSV files
  * We expect the files to be named as <quadtreeID>.constrained.csv and
  * <quadtreeID>.freeflow.csv. (e.g., 1202021.constrained.csv and 1202021.freeflow.csv)
+ * The threads take the next tile from the shared list when they finish one so that a few
+ * large tiles dont hold up the whole run. Each tile is read and written exactly once.
  */
-void update_tiles(
-    const std::string& tile_dir,
-    std::vector<std::pair<GraphId, std::vector<std::string>>>::const_iterator tile_start,
-    std::vector<std::pair<GraphId, std::vector<std::string>>>::const_iterator tile_end,
-    std::promise<stats>& result) {
+void update_tiles(const std::string& tile_dir,
+                  const std::vector<std::pair<GraphId, std::vector<std::string>>>& tiles,
+                  std::atomic<size_t>& next_tile,
+                  std::promise<stats>& result) {
 
   std::stringstream thread_name;
   thread_name << std::this_thread::get_id();
 
   // Iterate through the tiles and parse them
-  size_t total = tile_end - tile_start;
-  double count = 0;
   stats stat{};
-  for (; tile_start != tile_end; ++tile_start) {
-    LOG_INFO(thread_name.str() + " parsing traffic data for " + std::to_string(tile_start->first));
-    auto traffic = ParseTrafficFile(tile_start->second, stat);
-    LOG_INFO(thread_name.str() + " add traffic data to " + std::to_string(tile_start->first));
-    update_tile(tile_dir, tile_start->first, traffic, stat);
-    LOG_INFO(thread_name.str() + " finished " + std::to_string(tile_start->first) + "(" +
-             std::to_string(++count / total * 100.0) + ")");
+  std::vector<TrafficSpeeds> speeds;
+  std::string buffer;
+  for (size_t i = next_tile++; i < tiles.size(); i = next_tile++) {
+    const auto& tile = tiles[i];
+    LOG_INFO(thread_name.str() + " parsing traffic data for " + std::to_string(tile.first));
+    ParseTrafficFile(tile.second, speeds, buffer, stat);
+    LOG_INFO(thread_name.str() + " add traffic data to " + std::to_string(tile.first));
+    update_tile(tile_dir, tile.first, speeds, stat);
+    LOG_INFO(thread_name.str() + " finished " + std::to_string(tile.first) + "(" +
+             std::to_string((i + 1) * 100.0 / tiles.size()) + ")");
   }
 
   result.set_value(stat);
@@ -364,22 +437,16 @@ int main(int argc, char** argv) {
   std::vector<std::shared_ptr<std::thread>> threads(num_threads);
 
   LOG_INFO("Parsing speeds from " + std::to_string(traffic_tiles.size()) + " tiles.");
-  size_t floor = traffic_tiles.size() / threads.size();
-  size_t at_ceiling = traffic_tiles.size() - (threads.size() * floor);
-  decltype(traffic_tiles)::const_iterator tile_start, tile_end = traffic_tiles.begin();
   auto tile_dir = pt.get<std::string>("mjolnir.tile_dir");
   // A place to hold the results of those threads (exceptions, stats)
   std::list<std::promise<stats>> results;
-  // Atomically pass around stats info
+  // The threads pull the tiles one at a time
+  std::atomic<size_t> next_tile(0);
   for (size_t i = 0; i < threads.size(); ++i) {
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    tile_end += (i < at_ceiling ? floor + 1 : floor);
     // Make the thread
     results.emplace_back();
-    threads[i].reset(
-        new std::thread(update_tiles, tile_dir, tile_start, tile_end, std::ref(results.back())));
+    threads[i].reset(new std::thread(update_tiles, tile_dir, std::cref(traffic_tiles),
+                                     std::ref(next_tile), std::ref(results.back())));
   }
 
   // wait for it to finish
@@ -41,6 +41,7 @@
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/util.h"
+#include "mjolnir/admin.h"
 
 namespace bpo = boost::program_options;
 using namespace valhalla::midgard;
@@ -156,11 +157,17 @@ void Benchmark(const boost::property_tree::ptree& pt) {
 
   uint32_t counts[128] = {};
 
-  // Initialize the admin DB (if it exists)
+  // Time the packed admin polygons if there are some, otherwise initialize the admin DB (if it
+  // exists)
   auto database = pt.get_optional<std::string>("admin");
+  auto admin_file =
+      valhalla::mjolnir::OpenPolygonFile(pt.get_optional<std::string>("admin_polygons"),
+                                         valhalla::mjolnir::PolygonFile::Kind::kAdmins);
 
   sqlite3* db_handle = nullptr;
-  if (boost::filesystem::exists(*database)) {
+  if (admin_file) {
+    LOG_INFO("Using packed admin polygons");
+  } else if (boost::filesystem::exists(*database)) {
     spatialite_init(0);
     sqlite3_stmt* stmt = 0;
     char* err_msg = nullptr;
@@ -200,16 +207,17 @@ void Benchmark(const boost::property_tree::ptree& pt) {
   auto tiles = TileHierarchy::levels().rbegin()->second.tiles;
 
   // Iterate through the tiles and perform enhancements
-  std::unordered_map<uint32_t, multi_polygon_type> polys;
   std::unordered_map<uint32_t, bool> drive_on_right;
   for (uint32_t id = 0; id < tiles.TileCount(); id++) {
     // Get the admin polys if there is data for tiles that exist
     GraphId tile_id(id, local_level, 0);
     if (GraphReader::DoesTileExist(hierarchy_properties, tile_id)) {
-      polys = GetAdminInfo(db_handle, drive_on_right, tiles.TileBounds(id));
-      LOG_INFO("polys: " + std::to_string(polys.size()));
-      if (polys.size() < 128) {
-        counts[polys.size()]++;
+      size_t count = admin_file
+                         ? admin_file->Get(tiles.TileBounds(id)).size()
+                         : GetAdminInfo(db_handle, drive_on_right, tiles.TileBounds(id)).size();
+      LOG_INFO("polys: " + std::to_string(count));
+      if (count < 128) {
+        counts[count]++;
       }
     }
   }
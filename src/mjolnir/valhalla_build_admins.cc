@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "baldr/graphconstants.h"
+#include "mjolnir/admin.h"
 #include "mjolnir/adminconstants.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfadminparser.h"
@@ -701,8 +702,28 @@ void BuildAdminFromPBF(const boost::property_tree::ptree& pt,
     return;
   }
 
+  // Pack the polygons so the tile builder does not have to query the dbs
+  auto admin_polygons = pt.get_optional<std::string>("admin_polygons");
+  if (admin_polygons) {
+    auto count = WriteAdminPolygons(db_handle, *admin_polygons);
+    LOG_INFO("Packed " + std::to_string(count) + " admin polygons into " + *admin_polygons);
+  }
   sqlite3_close(db_handle);
 
+  auto timezone = pt.get_optional<std::string>("timezone");
+  auto timezone_polygons = pt.get_optional<std::string>("timezone_polygons");
+  if (timezone && timezone_polygons) {
+    sqlite3* tz_db_handle = GetDBHandle(*timezone);
+    if (tz_db_handle) {
+      auto count = WriteTimeZonePolygons(tz_db_handle, *timezone_polygons);
+      LOG_INFO("Packed " + std::to_string(count) + " time zone polygons into " +
+               *timezone_polygons);
+      sqlite3_close(tz_db_handle);
+    } else {
+      LOG_WARN("Time zone db " + *timezone + " not found.  Not packing time zone polygons.");
+    }
+  }
+
   LOG_INFO("Finished.");
 }
 
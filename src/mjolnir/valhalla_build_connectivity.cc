@@ -38,7 +38,8 @@ bool ParseArguments(int argc, char* argv[]) {
       " Usage: connectivitymap [options]\n"
       "\n"
       "connectivitymap is a program that creates a PPM image file representing "
-      "the connectivity between tiles."
+      "the connectivity between tiles. If the config has a mjolnir.connectivity_file "
+      "the connectivity is also written there for the services to load at startup."
       "\n"
       "\n");
 
@@ -114,8 +115,14 @@ int main(int argc, char** argv) {
   boost::property_tree::ptree pt;
   rapidjson::read_json(config_file_path.c_str(), pt);
 
-  // Get something we can use to fetch tiles
-  valhalla::baldr::connectivity_map_t connectivity_map(pt.get_child("mjolnir"));
+  // Get something we can use to fetch tiles, always from the tiles and not a previous file
+  valhalla::baldr::connectivity_map_t connectivity_map(pt.get_child("mjolnir"), false);
+
+  // Save it so the services dont have to compute it
+  auto connectivity_file = pt.get<std::string>("mjolnir.connectivity_file", "");
+  if (!connectivity_file.empty()) {
+    connectivity_map.save(connectivity_file);
+  }
 
   uint32_t transit_level = TileHierarchy::levels().rbegin()->second.level + 1;
   for (uint32_t level = 0; level <= transit_level; level++) {
@@ -0,0 +1,183 @@
+#include "baldr/rapidjson_utils.h"
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/shardmap.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+
+namespace {
+
+// puts a tile in the directory of a shard, linked so that the shards take no room of their own
+// unless they are copied to other disks
+bool place(const bfs::path& from, const bfs::path& to, bool copy) {
+  boost::system::error_code ec;
+  bfs::create_directories(to.parent_path(), ec);
+  bfs::remove(to, ec);
+  if (!copy) {
+    bfs::create_hard_link(from, to, ec);
+    if (!ec) {
+      return true;
+    }
+  }
+  bfs::copy_file(from, to, ec);
+  return !ec;
+}
+
+} // namespace
+
+// program entry point
+int main(int argc, char* argv[]) {
+  std::string config, output, url;
+  uint32_t columns, rows;
+  float border;
+  bool copy = false;
+  bpo::options_description options(
+      "valhalla_build_shards " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_build_shards [options]\n"
+      "\n"
+      "valhalla_build_shards splits the tiles of mjolnir.tile_dir into a grid of geographic "
+      "shards for serving them on several boxes. Each shard gets a tile directory with the tiles "
+      "of its region grown by a border and every tile of the highway level, so that it can also "
+      "route between regions. shards.json lists the region and url of every shard, point "
+      "loki.shards.file of each shard's config at it and loki.shards.name at the shard's name to "
+      "have the shards send requests to the one whose region holds them."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "columns", bpo::value<uint32_t>(&columns)->default_value(2),
+      "Number of shards from west to east.")("rows",
+                                             bpo::value<uint32_t>(&rows)->default_value(1),
+                                             "Number of shards from south to north.")(
+      "border,b", bpo::value<float>(&border)->default_value(1.f),
+      "Degrees the region of each shard is grown by.")(
+      "url,u", bpo::value<std::string>(&url)->default_value(""),
+      "Url of the shards, {name} is replaced with the name of each shard.")(
+      "output,o", bpo::value<std::string>(&output)->default_value("shards"),
+      "Directory the tile directory of each shard and shards.json are written to.")(
+      "copy", bpo::bool_switch(&copy), "Copy the tiles instead of hard linking them.")
+      // positional arguments
+      ("config", bpo::value<std::string>(&config), "Valhalla configuration file [required]");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("config", 1);
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help") || !vm.count("config")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_build_shards " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(config.c_str(), pt);
+  GraphReader reader(pt.get_child("mjolnir"));
+  if (reader.tile_dir().empty()) {
+    std::cerr << "The tiles to shard must be in mjolnir.tile_dir" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // the grid covers the local tiles, the highway tiles go to every shard anyway
+  auto tiles = reader.GetTileSet();
+  const auto& local = TileHierarchy::levels().rbegin()->second;
+  AABB2<PointLL> bounds;
+  bool first = true;
+  for (const auto& tile : tiles) {
+    if (tile.level() != local.level) {
+      continue;
+    }
+    auto tile_bounds = local.tiles.TileBounds(tile.tileid());
+    if (first) {
+      bounds = tile_bounds;
+      first = false;
+    } else {
+      bounds.Expand(tile_bounds);
+    }
+  }
+  if (first) {
+    std::cerr << "There are no tiles in " << reader.tile_dir() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ShardMap shards;
+  try {
+    shards = ShardMap::Grid(bounds, columns, rows, border, url);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // link each tile into the shards that keep it, tiles may be gzipped
+  std::vector<size_t> kept(shards.shards().size());
+  for (const auto& tile : tiles) {
+    std::string suffix;
+    for (bool gzipped : {false, true}) {
+      if (bfs::exists(bfs::path(reader.tile_dir()) / GraphTile::FileSuffix(tile, gzipped))) {
+        suffix = GraphTile::FileSuffix(tile, gzipped);
+        break;
+      }
+    }
+    if (suffix.empty()) {
+      continue;
+    }
+    for (size_t i = 0; i < shards.shards().size(); ++i) {
+      if (!shards.Keeps(i, tile)) {
+        continue;
+      }
+      if (!place(bfs::path(reader.tile_dir()) / suffix,
+                 bfs::path(output) / shards.shards()[i].name / suffix, copy)) {
+        std::cerr << "Unable to put " << suffix << " in shard " << shards.shards()[i].name
+                  << std::endl;
+        return EXIT_FAILURE;
+      }
+      ++kept[i];
+    }
+  }
+
+  boost::system::error_code ec;
+  bfs::create_directories(output, ec);
+  std::ofstream file((bfs::path(output) / "shards.json").string(), std::ios::trunc);
+  file << shards.ToJson();
+  if (!file) {
+    std::cerr << "Unable to write " << (bfs::path(output) / "shards.json").string() << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < shards.shards().size(); ++i) {
+    LOG_INFO("Shard " + shards.shards()[i].name + " keeps " + std::to_string(kept[i]) + " of " +
+             std::to_string(tiles.size()) + " tiles");
+  }
+  return EXIT_SUCCESS;
+}
@@ -7,6 +7,7 @@
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <ctime>
 #include <future>
 #include <iostream>
 #include <list>
@@ -35,6 +36,7 @@ using namespace valhalla::mjolnir;
 
 namespace bpo = boost::program_options;
 boost::filesystem::path config_file_path;
+bool incremental = false;
 
 namespace {
 
@@ -491,12 +493,10 @@ void build(const boost::property_tree::ptree& pt,
     stats.add_tile_area(tileid, area);
     stats.add_tile_geom(tileid, tiles.TileBounds(tileid));
 
-    // Check if we need to clear the tile cache
-    lock.lock();
+    // Check if we need to clear the tile cache, the reader is this thread's own
     if (graph_reader.OverCommitted()) {
       graph_reader.Trim();
     }
-    lock.unlock();
   }
 
   // Fill promise with statistics
@@ -504,11 +504,27 @@ void build(const boost::property_tree::ptree& pt,
 }
 } // namespace
 
-void BuildStatistics(const boost::property_tree::ptree& pt) {
+void BuildStatistics(const boost::property_tree::ptree& pt, const bool update) {
 
   // Graph tile properties
   auto tile_properties = pt.get_child("mjolnir");
 
+  // When updating only the tiles written after the database need gathering again. Tiles in an
+  // extract have no time of their own so they are always gathered
+  const std::string database = "statistics.sqlite";
+  bool updating = update && boost::filesystem::exists(database);
+  std::time_t written = updating ? boost::filesystem::last_write_time(database) : 0;
+  auto changed = [&](const GraphId& tile_id) {
+    if (!updating) {
+      return true;
+    }
+    auto file = boost::filesystem::path(tile_properties.get<std::string>("tile_dir")) /
+                GraphTile::FileSuffix(tile_id);
+    boost::system::error_code ec;
+    auto modified = boost::filesystem::last_write_time(file, ec);
+    return ec || modified >= written;
+  };
+
   // Create a randomized queue of tiles to work from
   std::deque<GraphId> tilequeue;
   for (auto tier : TileHierarchy::levels()) {
@@ -517,7 +533,7 @@ void BuildStatistics(const boost::property_tree::ptree& pt) {
     for (uint32_t id = 0; id < tiles.TileCount(); id++) {
       // If tile exists add it to the queue
       GraphId tile_id(id, level, 0);
-      if (GraphReader::DoesTileExist(tile_properties, tile_id)) {
+      if (GraphReader::DoesTileExist(tile_properties, tile_id) && changed(tile_id)) {
         tilequeue.emplace_back(std::move(tile_id));
       }
     }
@@ -528,13 +544,20 @@ void BuildStatistics(const boost::property_tree::ptree& pt) {
       for (uint32_t id = 0; id < tiles.TileCount(); id++) {
         // If tile exists add it to the queue
         GraphId tile_id(id, level, 0);
-        if (GraphReader::DoesTileExist(tile_properties, tile_id)) {
+        if (GraphReader::DoesTileExist(tile_properties, tile_id) && changed(tile_id)) {
           tilequeue.emplace_back(std::move(tile_id));
         }
       }
     }
   }
   std::random_shuffle(tilequeue.begin(), tilequeue.end());
+  if (updating) {
+    LOG_INFO(std::to_string(tilequeue.size()) + " tiles changed since " + database +
+             " was written");
+    if (tilequeue.empty()) {
+      return;
+    }
+  }
 
   // A mutex we can use to do the synchronization
   std::mutex lock;
@@ -569,7 +592,7 @@ void BuildStatistics(const boost::property_tree::ptree& pt) {
   }
   LOG_INFO("Finished");
 
-  stats.build_db(pt);
+  stats.build_db(pt, updating);
   stats.roulette_data.GenerateTasks(pt);
 }
 
@@ -580,7 +603,10 @@ bool ParseArguments(int argc, char* argv[]) {
                                                    boost::program_options::value<
                                                        boost::filesystem::path>(&config_file_path)
                                                        ->required(),
-                                                   "Path to the json configuration file.");
+                                                   "Path to the json configuration file.")(
+      "incremental,i", bpo::bool_switch(&incremental),
+      "Gather only the tiles written since statistics.sqlite and replace their rows in it. The "
+      "country totals are left as they were.");
   bpo::variables_map vm;
   try {
     bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
@@ -624,7 +650,7 @@ int main(int argc, char** argv) {
     valhalla::midgard::logging::Configure(loggin_config);
   }
 
-  BuildStatistics(pt);
+  BuildStatistics(pt, incremental);
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,152 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/traffictile.h"
+#include "config.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace bpo = boost::program_options;
+
+boost::filesystem::path config_file_path;
+
+bool ParseArguments(int argc, char* argv[]) {
+  bpo::options_description options(
+      "valhalla_build_traffic_extract " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_build_traffic_extract [options]\n"
+      "\n"
+      "valhalla_build_traffic_extract is a program that writes a tar with an empty live traffic "
+      "tile for every graph tile to mjolnir.traffic_extract. The services map it shared and use "
+      "the speeds another process writes to it in place, one 64 bit record per directed edge."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "config,c",
+      boost::program_options::value<boost::filesystem::path>(&config_file_path)->required(),
+      "Path to the json configuration file.");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return false;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return true;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_build_traffic_extract " << VALHALLA_VERSION << "\n";
+    return true;
+  }
+
+  if (vm.count("config")) {
+    if (boost::filesystem::is_regular_file(config_file_path)) {
+      return true;
+    } else {
+      std::cerr << "Configuration file is required\n\n" << options << "\n\n";
+    }
+  }
+
+  return false;
+}
+
+// Write a regular file entry to the tar, its data padded to a whole block
+void write_entry(std::ofstream& out, const std::string& name, const std::vector<char>& data) {
+  tar::header_t header{};
+  std::strncpy(header.name, name.c_str(), sizeof(header.name) - 1);
+  std::snprintf(header.mode, sizeof(header.mode), "%07o", 0644);
+  std::snprintf(header.uid, sizeof(header.uid), "%07o", 0);
+  std::snprintf(header.gid, sizeof(header.gid), "%07o", 0);
+  std::snprintf(header.size, sizeof(header.size), "%011llo",
+                static_cast<unsigned long long>(data.size()));
+  std::snprintf(header.mtime, sizeof(header.mtime), "%011llo",
+                static_cast<unsigned long long>(time(nullptr)));
+  header.typeflag = '0';
+  std::memcpy(header.magic, "ustar", 6);
+  std::memcpy(header.version, "00", 2);
+
+  // the checksum is taken with the checksum field blank
+  std::memset(header.chksum, ' ', sizeof(header.chksum));
+  uint64_t sum = 0;
+  for (size_t i = 0; i < sizeof(header); ++i) {
+    sum += reinterpret_cast<const unsigned char*>(&header)[i];
+  }
+  std::snprintf(header.chksum, sizeof(header.chksum), "%06llo", static_cast<unsigned long long>(sum));
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(data.data(), data.size());
+  std::vector<char> padding((sizeof(header) - data.size() % sizeof(header)) % sizeof(header), 0);
+  out.write(padding.data(), padding.size());
+}
+
+int main(int argc, char** argv) {
+  if (!ParseArguments(argc, argv)) {
+    return EXIT_FAILURE;
+  }
+
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(config_file_path.c_str(), pt);
+  auto traffic_extract = pt.get<std::string>("mjolnir.traffic_extract", "");
+  if (traffic_extract.empty()) {
+    LOG_ERROR("The config has no mjolnir.traffic_extract to write");
+    return EXIT_FAILURE;
+  }
+
+  // Write next to the extract and move it over the old one, services that have the old one mapped
+  // keep using it until they restart
+  std::string tmp = traffic_extract + ".tmp";
+  std::ofstream out(tmp, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!out) {
+    LOG_ERROR("Unable to open output file: " + tmp);
+    return EXIT_FAILURE;
+  }
+
+  GraphReader reader(pt.get_child("mjolnir"));
+  size_t count = 0;
+  for (const auto& id : reader.GetTileSet()) {
+    const GraphTile* tile = reader.GetGraphTile(id);
+    if (tile == nullptr) {
+      continue;
+    }
+    write_entry(out, GraphTile::FileSuffix(id),
+                TrafficTile::Create(id, tile->header()->directededgecount()));
+    ++count;
+  }
+
+  // A tar ends with two empty blocks
+  std::vector<char> end(sizeof(tar::header_t) * 2, 0);
+  out.write(end.data(), end.size());
+  out.close();
+  if (!out || std::rename(tmp.c_str(), traffic_extract.c_str()) != 0) {
+    LOG_ERROR("Unable to write " + traffic_extract);
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Wrote " + std::to_string(count) + " traffic tiles to " + traffic_extract);
+  return EXIT_SUCCESS;
+}
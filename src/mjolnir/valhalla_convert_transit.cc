@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <fstream>
@@ -72,161 +73,183 @@ ProcessStopPairs(GraphTileBuilder& transit_tilebuilder,
   uint32_t schedule_index = 0;
   std::map<TransitSchedule, uint32_t> schedules;
 
-  std::size_t slash_found = file.find_last_of("/\\");
-  std::string directory = file.substr(0, slash_found);
-
-  boost::filesystem::recursive_directory_iterator transit_file_itr(directory);
-  boost::filesystem::recursive_directory_iterator end_file_itr;
+  // The stop pairs of a tile are in its pbf file, which is already loaded, and in the files
+  // with an incremented extension fetched after the first one got too large
+  Transit more;
+  for (int32_t ext = -1;; ++ext) {
+    std::string fname = file;
+    if (ext >= 0) {
+      fname += '.' + std::to_string(ext);
+      if (!boost::filesystem::exists(fname)) {
+        break;
+      }
+      more = read_pbf(fname, lock);
+    }
+    const Transit& spp = ext >= 0 ? more : transit;
+    if (spp.stop_pairs_size() == 0) {
+      if (transit.nodes_size() > 0) {
+        LOG_ERROR("Tile " + fname + " has 0 schedule stop pairs but has " +
+                  std::to_string(transit.nodes_size()) + " stops");
+      }
+      departures.clear();
+      return departures;
+    }
 
-  // for each tile.
-  for (; transit_file_itr != end_file_itr; ++transit_file_itr) {
-    if (boost::filesystem::is_regular(transit_file_itr->path())) {
-      std::string fname = transit_file_itr->path().string();
-      std::string ext = transit_file_itr->path().extension().string();
-      std::string file_name = fname.substr(0, fname.size() - ext.size());
-
-      // make sure we are looking at a pbf file
-      if ((ext == ".pbf" && fname == file) ||
-          (file_name.substr(file_name.size() - 4) == ".pbf" && file_name == file)) {
-
-        Transit spp;
-        {
-          // already loaded
-          if (ext == ".pbf") {
-            spp = transit;
-          } else {
-            spp = read_pbf(fname, lock);
-          }
-        }
+    // Iterate through the stop pairs in this tile and form Valhalla departure
+    // records
+    for (const auto& sp : spp.stop_pairs()) {
+      // We do not know in this step if the end node is in a valid (non-empty)
+      // Valhalla tile. So just add the stop pair and we will address this later
+
+      // Use transit PBF graph Ids internally until adding to the graph tiles
+      // TODO - wheelchair accessible, shape information
+      Departure dep;
+      dep.orig_pbf_graphid = GraphId(sp.origin_graphid());
+      dep.dest_pbf_graphid = GraphId(sp.destination_graphid());
+      dep.route = sp.route_index();
+      dep.trip = sp.trip_id();
+
+      // if we have shape data then set everything else shapeid = 0;
+      if (sp.has_shape_id() && sp.has_destination_dist_traveled() &&
+          sp.has_origin_dist_traveled()) {
+        dep.shapeid = sp.shape_id();
+        dep.orig_dist_traveled = sp.origin_dist_traveled();
+        dep.dest_dist_traveled = sp.destination_dist_traveled();
+      } else {
+        dep.shapeid = 0;
+      }
 
-        if (spp.stop_pairs_size() == 0) {
-          if (transit.nodes_size() > 0) {
-            LOG_ERROR("Tile " + fname + " has 0 schedule stop pairs but has " +
-                      std::to_string(transit.nodes_size()) + " stops");
-          }
-          departures.clear();
-          return departures;
-        }
+      dep.blockid = sp.has_block_id() ? sp.block_id() : 0;
+      dep.dep_time = sp.origin_departure_time();
+      dep.elapsed_time = sp.destination_arrival_time() - dep.dep_time;
 
-        // Iterate through the stop pairs in this tile and form Valhalla departure
-        // records
-        for (const auto& sp : spp.stop_pairs()) {
-          // We do not know in this step if the end node is in a valid (non-empty)
-          // Valhalla tile. So just add the stop pair and we will address this later
-
-          // Use transit PBF graph Ids internally until adding to the graph tiles
-          // TODO - wheelchair accessible, shape information
-          Departure dep;
-          dep.orig_pbf_graphid = GraphId(sp.origin_graphid());
-          dep.dest_pbf_graphid = GraphId(sp.destination_graphid());
-          dep.route = sp.route_index();
-          dep.trip = sp.trip_id();
-
-          // if we have shape data then set everything else shapeid = 0;
-          if (sp.has_shape_id() && sp.has_destination_dist_traveled() &&
-              sp.has_origin_dist_traveled()) {
-            dep.shapeid = sp.shape_id();
-            dep.orig_dist_traveled = sp.origin_dist_traveled();
-            dep.dest_dist_traveled = sp.destination_dist_traveled();
-          } else {
-            dep.shapeid = 0;
-          }
+      dep.frequency_end_time = sp.has_frequency_end_time() ? sp.frequency_end_time() : 0;
+      dep.frequency = sp.has_frequency_headway_seconds() ? sp.frequency_headway_seconds() : 0;
 
-          dep.blockid = sp.has_block_id() ? sp.block_id() : 0;
-          dep.dep_time = sp.origin_departure_time();
-          dep.elapsed_time = sp.destination_arrival_time() - dep.dep_time;
+      if (!sp.bikes_allowed()) {
+        stop_access[dep.orig_pbf_graphid] |= kBicycleAccess;
+        stop_access[dep.dest_pbf_graphid] |= kBicycleAccess;
+      }
 
-          dep.frequency_end_time = sp.has_frequency_end_time() ? sp.frequency_end_time() : 0;
-          dep.frequency = sp.has_frequency_headway_seconds() ? sp.frequency_headway_seconds() : 0;
+      if (!sp.wheelchair_accessible()) {
+        stop_access[dep.orig_pbf_graphid] |= kWheelchairAccess;
+        stop_access[dep.dest_pbf_graphid] |= kWheelchairAccess;
+      }
 
-          if (!sp.bikes_allowed()) {
-            stop_access[dep.orig_pbf_graphid] |= kBicycleAccess;
-            stop_access[dep.dest_pbf_graphid] |= kBicycleAccess;
+      dep.bicycle_accessible = sp.bikes_allowed();
+      dep.wheelchair_accessible = sp.wheelchair_accessible();
+
+      // Compute days of week mask
+      uint32_t dow_mask = kDOWNone;
+      for (uint32_t x = 0; x < sp.service_days_of_week_size(); x++) {
+        bool dow = sp.service_days_of_week(x);
+        if (dow) {
+          switch (x) {
+            case 0:
+              dow_mask |= kMonday;
+              break;
+            case 1:
+              dow_mask |= kTuesday;
+              break;
+            case 2:
+              dow_mask |= kWednesday;
+              break;
+            case 3:
+              dow_mask |= kThursday;
+              break;
+            case 4:
+              dow_mask |= kFriday;
+              break;
+            case 5:
+              dow_mask |= kSaturday;
+              break;
+            case 6:
+              dow_mask |= kSunday;
+              break;
           }
+        }
+      }
 
-          if (!sp.wheelchair_accessible()) {
-            stop_access[dep.orig_pbf_graphid] |= kWheelchairAccess;
-            stop_access[dep.dest_pbf_graphid] |= kWheelchairAccess;
-          }
+      // Compute the valid days
+      // set the bits based on the dow.
 
-          dep.bicycle_accessible = sp.bikes_allowed();
-          dep.wheelchair_accessible = sp.wheelchair_accessible();
-
-          // Compute days of week mask
-          uint32_t dow_mask = kDOWNone;
-          for (uint32_t x = 0; x < sp.service_days_of_week_size(); x++) {
-            bool dow = sp.service_days_of_week(x);
-            if (dow) {
-              switch (x) {
-                case 0:
-                  dow_mask |= kMonday;
-                  break;
-                case 1:
-                  dow_mask |= kTuesday;
-                  break;
-                case 2:
-                  dow_mask |= kWednesday;
-                  break;
-                case 3:
-                  dow_mask |= kThursday;
-                  break;
-                case 4:
-                  dow_mask |= kFriday;
-                  break;
-                case 5:
-                  dow_mask |= kSaturday;
-                  break;
-                case 6:
-                  dow_mask |= kSunday;
-                  break;
-              }
-            }
-          }
+      auto d = date::floor<date::days>(DateTime::pivot_date_);
+      date::sys_days start_date =
+          date::sys_days(date::year_month_day(d + date::days(sp.service_start_date())));
+      date::sys_days end_date =
+          date::sys_days(date::year_month_day(d + date::days(sp.service_end_date())));
 
-          // Compute the valid days
-          // set the bits based on the dow.
+      uint64_t days = get_service_days(start_date, end_date, tile_date, dow_mask);
 
-          auto d = date::floor<date::days>(DateTime::pivot_date_);
-          date::sys_days start_date =
-              date::sys_days(date::year_month_day(d + date::days(sp.service_start_date())));
-          date::sys_days end_date =
-              date::sys_days(date::year_month_day(d + date::days(sp.service_end_date())));
+      // if this is a service addition for one day, delete the dow_mask.
+      if (sp.service_start_date() == sp.service_end_date()) {
+        dow_mask = kDOWNone;
+      }
 
-          uint64_t days = get_service_days(start_date, end_date, tile_date, dow_mask);
+      // if dep.days == 0 then feed either starts after the end_date or tile_header_date >
+      // end_date
+      if (days == 0 && !sp.service_added_dates_size()) {
+        LOG_DEBUG("Feed rejected!  Start date: " + to_iso_extended_string(start_date) +
+                  " End date: " + to_iso_extended_string(end_date));
+        continue;
+      }
 
-          // if this is a service addition for one day, delete the dow_mask.
-          if (sp.service_start_date() == sp.service_end_date()) {
-            dow_mask = kDOWNone;
-          }
+      dep.headsign_offset = transit_tilebuilder.AddName(sp.trip_headsign());
 
-          // if dep.days == 0 then feed either starts after the end_date or tile_header_date >
-          // end_date
-          if (days == 0 && !sp.service_added_dates_size()) {
-            LOG_DEBUG("Feed rejected!  Start date: " + to_iso_extended_string(start_date) +
-                      " End date: " + to_iso_extended_string(end_date));
-            continue;
-          }
+      date::sys_days t_d = date::sys_days(date::year_month_day(d + date::days(tile_date)));
+      uint32_t end_day = static_cast<uint32_t>((end_date - t_d).count());
 
-          dep.headsign_offset = transit_tilebuilder.AddName(sp.trip_headsign());
+      if (end_day > kScheduleEndDay) {
+        end_day = kScheduleEndDay;
+      }
 
-          date::sys_days t_d = date::sys_days(date::year_month_day(d + date::days(tile_date)));
-          uint32_t end_day = static_cast<uint32_t>((end_date - t_d).count());
+      // if subtractions are between start and end date then turn off bit.
+      for (const auto& x : sp.service_except_dates()) {
+        date::sys_days rm_date = date::sys_days(date::year_month_day(d + date::days(x)));
+        days = remove_service_day(days, end_date, tile_date, rm_date);
+      }
 
-          if (end_day > kScheduleEndDay) {
-            end_day = kScheduleEndDay;
-          }
+      // if additions are between start and end date then turn on bit.
+      for (const auto& x : sp.service_added_dates()) {
+        date::sys_days add_date = date::sys_days(date::year_month_day(d + date::days(x)));
+        days = add_service_day(days, end_date, tile_date, add_date);
+      }
 
-          // if subtractions are between start and end date then turn off bit.
-          for (const auto& x : sp.service_except_dates()) {
-            date::sys_days rm_date = date::sys_days(date::year_month_day(d + date::days(x)));
-            days = remove_service_day(days, end_date, tile_date, rm_date);
-          }
+      TransitSchedule sched(days, dow_mask, end_day);
+      auto sched_itr = schedules.find(sched);
+      if (sched_itr == schedules.end()) {
+        // Not in the map - add a new transit schedule to the tile
+        transit_tilebuilder.AddTransitSchedule(sched);
 
-          // if additions are between start and end date then turn on bit.
-          for (const auto& x : sp.service_added_dates()) {
-            date::sys_days add_date = date::sys_days(date::year_month_day(d + date::days(x)));
-            days = add_service_day(days, end_date, tile_date, add_date);
-          }
+        // Add to the map and increment the index
+        schedules[sched] = schedule_index;
+        dep.schedule_index = schedule_index;
+        schedule_index++;
+      } else {
+        dep.schedule_index = sched_itr->second;
+      }
+
+      // is this passed midnight?
+      // create a departure for before midnight and one after
+      uint32_t origin_seconds = sp.origin_departure_time();
+      if (origin_seconds >= kSecondsPerDay) {
+
+        // Add the current dep to the departures list
+        // and then update it with new dep time.  This
+        // dep will be used when the start time is after
+        // midnight.
+        stats.midnight_dep_count++;
+        departures.emplace(dep.orig_pbf_graphid, dep);
+        while (origin_seconds >= kSecondsPerDay) {
+          origin_seconds -= kSecondsPerDay;
+          // Then we need to fix the dow mask and dates
+          // The departure that was initially for every Friday   26h
+          // needs to be for                      every Saturday 02h
+          // If there was an exception on the Friday 11th of January,
+          // then we need an exception on the Saturday 12th of January instead
+          days = shift_service_day(days);
+          dow_mask =
+              ((dow_mask << 1) & kAllDaysOfWeek) | (dow_mask & kSaturday ? kSunday : kDOWNone);
 
           TransitSchedule sched(days, dow_mask, end_day);
           auto sched_itr = schedules.find(sched);
@@ -241,63 +264,25 @@ ProcessStopPairs(GraphTileBuilder& transit_tilebuilder,
           } else {
             dep.schedule_index = sched_itr->second;
           }
+        }
 
-          // is this passed midnight?
-          // create a departure for before midnight and one after
-          uint32_t origin_seconds = sp.origin_departure_time();
-          if (origin_seconds >= kSecondsPerDay) {
-
-            // Add the current dep to the departures list
-            // and then update it with new dep time.  This
-            // dep will be used when the start time is after
-            // midnight.
-            stats.midnight_dep_count++;
-            departures.emplace(dep.orig_pbf_graphid, dep);
-            while (origin_seconds >= kSecondsPerDay) {
-              origin_seconds -= kSecondsPerDay;
-              // Then we need to fix the dow mask and dates
-              // The departure that was initially for every Friday   26h
-              // needs to be for                      every Saturday 02h
-              // If there was an exception on the Friday 11th of January,
-              // then we need an exception on the Saturday 12th of January instead
-              days = shift_service_day(days);
-              dow_mask =
-                  ((dow_mask << 1) & kAllDaysOfWeek) | (dow_mask & kSaturday ? kSunday : kDOWNone);
-
-              TransitSchedule sched(days, dow_mask, end_day);
-              auto sched_itr = schedules.find(sched);
-              if (sched_itr == schedules.end()) {
-                // Not in the map - add a new transit schedule to the tile
-                transit_tilebuilder.AddTransitSchedule(sched);
-
-                // Add to the map and increment the index
-                schedules[sched] = schedule_index;
-                dep.schedule_index = schedule_index;
-                schedule_index++;
-              } else {
-                dep.schedule_index = sched_itr->second;
-              }
-            }
-
-            dep.dep_time = origin_seconds;
-            dep.frequency_end_time = 0;
-            dep.frequency = 0;
-            if (sp.has_frequency_end_time() && sp.has_frequency_headway_seconds()) {
-              uint32_t frequency_end_time = sp.frequency_end_time();
-              // adjust the end time if it is after midnight.
-              while (frequency_end_time >= kSecondsPerDay) {
-                frequency_end_time -= kSecondsPerDay;
-              }
-
-              dep.frequency_end_time = frequency_end_time;
-              dep.frequency = sp.frequency_headway_seconds();
-            }
+        dep.dep_time = origin_seconds;
+        dep.frequency_end_time = 0;
+        dep.frequency = 0;
+        if (sp.has_frequency_end_time() && sp.has_frequency_headway_seconds()) {
+          uint32_t frequency_end_time = sp.frequency_end_time();
+          // adjust the end time if it is after midnight.
+          while (frequency_end_time >= kSecondsPerDay) {
+            frequency_end_time -= kSecondsPerDay;
           }
-          // Add to the departures list
-          departures.emplace(dep.orig_pbf_graphid, std::move(dep));
-          stats.dep_count++;
+
+          dep.frequency_end_time = frequency_end_time;
+          dep.frequency = sp.frequency_headway_seconds();
         }
       }
+      // Add to the departures list
+      departures.emplace(dep.orig_pbf_graphid, std::move(dep));
+      stats.dep_count++;
     }
   }
   return departures;
@@ -366,34 +351,39 @@ Use GetTransitUse(const uint32_t rt) {
   }
 }
 
-std::list<PointLL> GetShape(const PointLL& stop_ll,
-                            const PointLL& endstop_ll,
-                            uint32_t shapeid,
-                            const float orig_dist_traveled,
-                            const float dest_dist_traveled,
-                            const std::vector<PointLL>& trip_shape,
-                            const std::vector<float>& distances,
-                            const std::string& origin_id,
-                            const std::string& dest_id) {
-
-  std::list<PointLL> shape;
-  if (shapeid != 0 && trip_shape.size() && stop_ll != endstop_ll &&
+// Get the shape between two stops from the shape of the trip, whose distances along it are a range
+// of the distances of all the shapes of the tile
+std::vector<PointLL> GetShape(const PointLL& stop_ll,
+                              const PointLL& endstop_ll,
+                              uint32_t shapeid,
+                              const float orig_dist_traveled,
+                              const float dest_dist_traveled,
+                              const Shape* trip,
+                              const std::vector<float>& all_distances,
+                              const std::string& origin_id,
+                              const std::string& dest_id) {
+
+  std::vector<PointLL> shape;
+  if (shapeid != 0 && trip != nullptr && trip->shape.size() && stop_ll != endstop_ll &&
       orig_dist_traveled < dest_dist_traveled) {
 
+    const std::vector<PointLL>& trip_shape = trip->shape;
+    const auto distances_begin = all_distances.cbegin() + trip->begins;
+    const auto distances_end = all_distances.cbegin() + trip->ends;
     float distance = 0.0f, d_from_p0_to_x = 0.0f;
 
     // point x - we are trying to find it on the line segment between p0 and p1
     PointLL x;
     // find out where orig_dist_traveled should be in the list.
-    auto lower_bound = std::lower_bound(distances.cbegin(), distances.cend(), orig_dist_traveled);
+    auto lower_bound = std::lower_bound(distances_begin, distances_end, orig_dist_traveled);
     // find out where dest_dist_traveled should be in the list.
-    auto upper_bound = std::upper_bound(distances.cbegin(), distances.cend(), dest_dist_traveled);
+    auto upper_bound = std::upper_bound(distances_begin, distances_end, dest_dist_traveled);
     float prev_distance = *(lower_bound);
 
     // distance calculations can be off just a bit (i.e., 9372.224609 < 9372.500000) so set it to
     // the last element.
-    if (distances.back() < dest_dist_traveled) {
-      upper_bound = distances.cend() - 1;
+    if (*(distances_end - 1) < dest_dist_traveled) {
+      upper_bound = distances_end - 1;
     }
 
     // lower_bound returns an iterator pointing to the first element which does not compare less
@@ -422,7 +412,7 @@ std::list<PointLL> GetShape(const PointLL& stop_ll,
        */
 
       // index into our vector of points
-      uint32_t index = (itr - distances.cbegin());
+      uint32_t index = (itr - distances_begin);
       PointLL p0 = trip_shape[index];
       PointLL p1 = trip_shape[index + 1];
 
@@ -481,7 +471,7 @@ std::list<PointLL> GetShape(const PointLL& stop_ll,
 
 void AddToGraph(GraphTileBuilder& tilebuilder_transit,
                 const GraphId& tileid,
-                const std::string& tile,
+                const Transit& transit,
                 const std::string& transit_dir,
                 std::mutex& lock,
                 const std::unordered_set<GraphId>& all_tiles,
@@ -496,8 +486,8 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
                 uint32_t& no_dir_edge_count) {
   auto t1 = std::chrono::high_resolution_clock::now();
 
-  // Get Transit PBF data for this tile
-  Transit transit = read_pbf(tile, lock);
+  // The stops of the other tiles the transit edges end in, read once per tile
+  std::unordered_map<GraphId, Transit> end_tiles;
 
   std::set<uint64_t> added_stations;
   std::set<uint64_t> added_egress;
@@ -652,7 +642,7 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
         // Add edge info to the tile and set the offset in the directed edge
         bool added = false;
         std::vector<std::string> names;
-        std::list<PointLL> shape = {egress_ll, station_ll};
+        std::vector<PointLL> shape = {egress_ll, station_ll};
 
         uint32_t edge_info_offset =
             tilebuilder_transit.AddEdgeInfo(0, egress_graphid, station_graphid, 0, 0, 0, 0, shape,
@@ -700,7 +690,7 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
         // Add edge info to the tile and set the offset in the directed edge
         bool added = false;
         std::vector<std::string> names;
-        std::list<PointLL> shape = {station_ll, egress_ll};
+        std::vector<PointLL> shape = {station_ll, egress_ll};
 
         // TODO - these need to be valhalla graph Ids
         uint32_t edge_info_offset =
@@ -757,7 +747,7 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
         // Add edge info to the tile and set the offset in the directed edge
         bool added = false;
         std::vector<std::string> names;
-        std::list<PointLL> shape = {station_ll, platform_ll};
+        std::vector<PointLL> shape = {station_ll, platform_ll};
 
         // TODO - these need to be valhalla graph Ids
         uint32_t edge_info_offset =
@@ -835,7 +825,7 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
     // Add edge info to the tile and set the offset in the directed edge
     bool added = false;
     std::vector<std::string> names;
-    std::list<PointLL> shape = {platform_ll, station_ll};
+    std::vector<PointLL> shape = {platform_ll, station_ll};
 
     // TODO - these need to be valhalla graph Ids
     uint32_t edge_info_offset = tilebuilder_transit.AddEdgeInfo(0, platform_graphid, station_graphid,
@@ -870,15 +860,20 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
         dest_id = endplatform.onestop_id();
 
       } else {
-        // Get Transit PBF data for this tile
-        // Get transit pbf tile
-        std::string file_name = GraphTile::FileSuffix(
-            GraphId(end_platform_graphid.tileid(), end_platform_graphid.level(), 0));
-        boost::algorithm::trim_if(file_name, boost::is_any_of(".gph"));
-        file_name += ".pbf";
-        const std::string file = transit_dir + filesystem::path::preferred_separator + file_name;
-        Transit endtransit = read_pbf(file, lock);
-        const Transit_Node& endplatform = endtransit.nodes(end_platform_graphid.id());
+        // Get Transit PBF data for the tile of the end stop, keeping only its stops
+        auto end_tile = end_tiles.find(end_platform_graphid.Tile_Base());
+        if (end_tile == end_tiles.end()) {
+          std::string file_name = GraphTile::FileSuffix(
+              GraphId(end_platform_graphid.tileid(), end_platform_graphid.level(), 0));
+          boost::algorithm::trim_if(file_name, boost::is_any_of(".gph"));
+          file_name += ".pbf";
+          const std::string file = transit_dir + filesystem::path::preferred_separator + file_name;
+          Transit endtransit = read_pbf(file, lock);
+          endtransit.clear_stop_pairs();
+          endtransit.clear_shapes();
+          end_tile = end_tiles.emplace(end_platform_graphid.Tile_Base(), std::move(endtransit)).first;
+        }
+        const Transit_Node& endplatform = end_tile->second.nodes(end_platform_graphid.id());
         endstopname = endplatform.name();
         endll = {endplatform.lon(), endplatform.lat()};
         dest_id = endplatform.onestop_id();
@@ -907,16 +902,11 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
       bool added = false;
       std::vector<std::string> names;
 
-      std::vector<PointLL> points;
-      std::vector<float> distance;
       // get the indexes and vector of points for this shape id
+      const Shape* trip = nullptr;
       const auto& found = shape_data.find(transitedge.shapeid);
       if (transitedge.shapeid != 0 && found != shape_data.cend()) {
-        const auto& shape_d = found->second;
-        points = shape_d.shape;
-        // copy only the distances that we care about.
-        std::copy((distances.cbegin() + shape_d.begins), (distances.cbegin() + shape_d.ends),
-                  back_inserter(distance));
+        trip = &found->second;
       } else if (transitedge.shapeid != 0) {
         LOG_WARN("Shape Id not found: " + std::to_string(transitedge.shapeid));
       }
@@ -925,7 +915,7 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
       // we will need to do something to differentiate edges (maybe use
       // lineid) so the shape doesn't get messed up.
       auto shape = GetShape(platform_ll, endll, transitedge.shapeid, transitedge.orig_dist_traveled,
-                            transitedge.dest_dist_traveled, points, distance, origin_id, dest_id);
+                            transitedge.dest_dist_traveled, trip, distances, origin_id, dest_id);
 
       uint32_t edge_info_offset =
           tilebuilder_transit.AddEdgeInfo(transitedge.routeid, platform_graphid, endnode, 0, 0, 0, 0,
@@ -960,12 +950,12 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
 }
 
 // We make sure to lock on reading and writing since tiles are now being
-// written. Also lock on queue access since shared by different threads.
+// written. Each thread takes the next tile of the queue when done with its last one.
 void build_tiles(const boost::property_tree::ptree& pt,
                  std::mutex& lock,
                  const std::unordered_set<GraphId>& all_tiles,
-                 std::unordered_set<GraphId>::const_iterator tile_start,
-                 std::unordered_set<GraphId>::const_iterator tile_end,
+                 const std::vector<GraphId>& queue,
+                 std::atomic<size_t>& next_tile,
                  std::vector<OneStopTest>& onestoptests,
                  std::promise<builder_stats>& results) {
 
@@ -984,12 +974,12 @@ void build_tiles(const boost::property_tree::ptree& pt,
 
   const auto& tiles = TileHierarchy::levels().rbegin()->second.tiles;
   // Iterate through the tiles in the queue and find any that include stops
-  for (; tile_start != tile_end; ++tile_start) {
+  for (size_t i = next_tile++; i < queue.size(); i = next_tile++) {
     // Get the next tile Id from the queue and get a tile builder
     if (reader_transit_level.OverCommitted()) {
       reader_transit_level.Trim();
     }
-    GraphId tile_id = tile_start->Tile_Base();
+    GraphId tile_id = queue[i].Tile_Base();
 
     // Get transit pbf tile
     const std::string transit_dir = pt.get<std::string>("transit_dir");
@@ -1001,7 +991,7 @@ void build_tiles(const boost::property_tree::ptree& pt,
     // Make sure it exists
     if (!boost::filesystem::exists(file)) {
       LOG_ERROR("File not found.  " + file);
-      return;
+      continue;
     }
 
     Transit transit = read_pbf(file, lock);
@@ -1045,7 +1035,7 @@ void build_tiles(const boost::property_tree::ptree& pt,
     std::vector<float> distances;
     for (uint32_t i = 0; i < transit.shapes_size(); i++) {
       const Transit_Shape& shape = transit.shapes(i);
-      const std::vector<PointLL> trip_shape = decode7<std::vector<PointLL>>(shape.encoded_shape());
+      std::vector<PointLL> trip_shape = decode7<std::vector<PointLL>>(shape.encoded_shape());
 
       float distance = 0.0f;
       Shape shape_data;
@@ -1065,9 +1055,9 @@ void build_tiles(const boost::property_tree::ptree& pt,
       // must be distances.size for the end index as we use std::copy later on and want
       // to include the last element in the vector we wish to copy.
       shape_data.ends = distances.size();
-      shape_data.shape = trip_shape;
+      shape_data.shape = std::move(trip_shape);
       // shape id --> begin and end indexes in the distance vector and vector of points.
-      shapes[shape.shape_id()] = shape_data;
+      shapes[shape.shape_id()] = std::move(shape_data);
     }
 
     // Get all scheduled departures from the stops within this tile.
@@ -1158,7 +1148,7 @@ void build_tiles(const boost::property_tree::ptree& pt,
     }
 
     // Add nodes, directededges, and edgeinfo
-    AddToGraph(tilebuilder_transit, tile_id, file, transit_dir, lock, all_tiles, stop_edge_map,
+    AddToGraph(tilebuilder_transit, tile_id, transit, transit_dir, lock, all_tiles, stop_edge_map,
                stop_access, shapes, distances, route_types, onestoptests, tile_within_one_tz,
                tz_polys, stats.no_dir_edge_count);
 
@@ -1211,24 +1201,35 @@ void build(const ptree& pt,
   // A place to hold the results of those threads (exceptions, stats)
   std::list<std::promise<builder_stats>> results;
 
-  // Start the threads, divvy up the work
+  // Queue the tiles with the largest transit data first so that a metro area does not start
+  // last and keep one thread busy long after the others are done
   LOG_INFO("Adding " + std::to_string(all_tiles.size()) + " transit tiles to the transit graph...");
-  size_t floor = all_tiles.size() / threads.size();
-  size_t at_ceiling = all_tiles.size() - (threads.size() * floor);
-  std::unordered_set<GraphId>::const_iterator tile_start, tile_end = all_tiles.begin();
+  const std::string transit_dir = pt.get<std::string>("mjolnir.transit_dir");
+  std::vector<std::pair<uintmax_t, GraphId>> sized_tiles;
+  for (const auto& tile_id : all_tiles) {
+    std::string file_name = GraphTile::FileSuffix(GraphId(tile_id.tileid(), tile_id.level(), 0));
+    boost::algorithm::trim_if(file_name, boost::is_any_of(".gph"));
+    const std::string file = transit_dir + filesystem::path::preferred_separator + file_name + ".pbf";
+    boost::system::error_code ec;
+    uintmax_t size = boost::filesystem::file_size(file, ec);
+    sized_tiles.emplace_back(ec ? 0 : size, tile_id);
+  }
+  std::sort(sized_tiles.begin(), sized_tiles.end(),
+            [](const std::pair<uintmax_t, GraphId>& a, const std::pair<uintmax_t, GraphId>& b) {
+              return a.first > b.first;
+            });
+  std::vector<GraphId> queue;
+  queue.reserve(sized_tiles.size());
+  for (const auto& tile : sized_tiles) {
+    queue.push_back(tile.second);
+  }
+  std::atomic<size_t> next_tile(0);
 
-  // Atomically pass around stats info
+  // Start the threads, each takes the next tile of the queue until it is empty
   for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
-    // Make the thread
     results.emplace_back();
     threads[i].reset(new std::thread(build_tiles, std::cref(pt.get_child("mjolnir")), std::ref(lock),
-                                     std::cref(all_tiles), tile_start, tile_end,
+                                     std::cref(all_tiles), std::cref(queue), std::ref(next_tile),
                                      std::ref(onestoptests), std::ref(results.back())));
   }
 
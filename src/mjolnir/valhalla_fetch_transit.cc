@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <fstream>
@@ -84,6 +87,7 @@ struct pt_curler_t {
     std::stringstream result;
     assert_curl(curl_easy_setopt(connection.get(), CURLOPT_WRITEDATA, &result),
                 "Failed to set write data ");
+    auto backoff = kInitialBackoff;
     while (++tries) {
       result.str("");
       long http_code = 0;
@@ -109,11 +113,15 @@ struct pt_curler_t {
           log_extra = "Unusable response ";
         }
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      // back off exponentially, with some jitter so the threads that were rate limited together
+      // dont all come back at the same time
+      std::uniform_int_distribution<int64_t> jitter(backoff.count() / 2, backoff.count());
+      std::this_thread::sleep_for(std::chrono::milliseconds(jitter(generator)));
+      backoff = std::min<std::chrono::milliseconds>(backoff * 2, kMaxBackoff);
       // dont log rate limit stuff its too frequent
-      // if (http_code != 429 || (tries % 10) == 0) {
-      LOG_WARN(log_extra + "retrying " + url);
-      //}
+      if (http_code != 429 || (tries % 10) == 0) {
+        LOG_WARN(log_extra + "retrying " + url);
+      }
     };
     return pt;
   }
@@ -133,7 +141,51 @@ protected:
   }
   std::shared_ptr<CURL> connection;
   char error[CURL_ERROR_SIZE];
+  std::minstd_rand generator{std::random_device{}()};
+  static constexpr std::chrono::milliseconds kInitialBackoff{500};
+  static constexpr std::chrono::milliseconds kMaxBackoff{30000};
 };
+constexpr std::chrono::milliseconds pt_curler_t::kInitialBackoff;
+constexpr std::chrono::milliseconds pt_curler_t::kMaxBackoff;
+
+// the number of threads, and so of requests in flight at once, used to fetch from the api
+unsigned int fetch_threads(const ptree& pt) {
+  return std::max(1u, pt.get<unsigned int>("mjolnir.transit_fetch_threads", 6));
+}
+
+// the active version of each feed as of the last fetch, kept in the transit directory so that
+// the next fetch can skip the tiles none of whose feeds have changed since
+using feed_versions_t = std::unordered_map<std::string, std::string>;
+
+std::string feed_versions_file(const ptree& pt) {
+  return pt.get<std::string>("mjolnir.transit_dir") + filesystem::path::preferred_separator +
+         "feed_versions.txt";
+}
+
+feed_versions_t read_feed_versions(const ptree& pt) {
+  feed_versions_t versions;
+  std::ifstream file(feed_versions_file(pt));
+  std::string onestop_id, version;
+  while (file >> onestop_id >> version) {
+    versions[onestop_id] = version;
+  }
+  return versions;
+}
+
+void write_feed_versions(const ptree& pt, const feed_versions_t& versions) {
+  std::ofstream file(feed_versions_file(pt));
+  for (const auto& version : versions) {
+    file << version.first << ' ' << version.second << '\n';
+  }
+}
+
+// the name the first transit pbf of a tile is written to
+std::string transit_file(const ptree& pt, const GraphId& tile) {
+  auto file_name = GraphTile::FileSuffix(tile);
+  file_name = file_name.substr(0, file_name.size() - 3) + "pbf";
+  return pt.get<std::string>("mjolnir.transit_dir") + filesystem::path::preferred_separator +
+         file_name;
+}
 
 std::string url(const std::string& path, const ptree& pt) {
   auto url = pt.get<std::string>("base_url") + path;
@@ -152,7 +204,8 @@ struct weighted_tile_t {
     return w == o.w ? t < o.t : w < o.w;
   }
 };
-std::priority_queue<weighted_tile_t> which_tiles(const ptree& pt, const std::string& feed) {
+std::priority_queue<weighted_tile_t>
+which_tiles(const ptree& pt, const std::string& feed, feed_versions_t& versions) {
   // now real need to catch exceptions since we can't really proceed without this stuff
   LOG_INFO("Fetching transit feeds");
 
@@ -170,6 +223,9 @@ std::priority_queue<weighted_tile_t> which_tiles(const ptree& pt, const std::str
           : "";
 
   std::set<GraphId> tiles;
+  // tiles touched by a feed whose active version is not the one we last fetched
+  bool incremental = pt.get<bool>("mjolnir.transit_fetch_incremental", false);
+  std::unordered_set<GraphId> changed;
   const auto& tile_level = TileHierarchy::levels().rbegin()->second;
   pt_curler_t curler;
   auto request = url("/api/v1/feeds.geojson?per_page=false", pt);
@@ -180,6 +236,13 @@ std::priority_queue<weighted_tile_t> which_tiles(const ptree& pt, const std::str
 
     auto onestop_feed = feature.second.get_optional<std::string>("properties.onestop_id");
     if (feed.empty() || (onestop_feed && *onestop_feed == feed)) {
+      // a feed without an id or a version always counts as changed
+      auto version = feature.second.get<std::string>("properties.active_feed_version", "");
+      bool feed_changed = !incremental || !onestop_feed || version.empty() || version == "null" ||
+                          versions[*onestop_feed] != version;
+      if (onestop_feed && !version.empty() && version != "null") {
+        versions[*onestop_feed] = version;
+      }
 
       // should be a polygon
       auto type = feature.second.get_optional<std::string>("geometry.type");
@@ -221,6 +284,9 @@ std::priority_queue<weighted_tile_t> which_tiles(const ptree& pt, const std::str
       for (auto i = min_c; i <= max_c; ++i) {
         for (auto j = min_r; j <= max_r; ++j) {
           tiles.emplace(GraphId(tile_level.tiles.TileId(i, j), tile_level.level, 0));
+          if (feed_changed) {
+            changed.emplace(GraphId(tile_level.tiles.TileId(i, j), tile_level.level, 0));
+          }
         }
       }
     }
@@ -252,6 +318,26 @@ std::priority_queue<weighted_tile_t> which_tiles(const ptree& pt, const std::str
              (boost::format("%1%,%2%,%3%,%4%") % my_min_x % my_min_y % my_max_x % my_max_y).str());
   }
 
+  // a tile is only skipped if neither it nor its neighbours have a changed feed, as the stop
+  // pairs dangling into a neighbour are stitched to the stops of its previous fetch
+  auto unchanged = [&](const GraphId& tile) {
+    if (!incremental || !boost::filesystem::exists(transit_file(pt, tile))) {
+      return false;
+    }
+    auto row_col = tile_level.tiles.GetRowColumn(tile.tileid());
+    for (auto r = row_col.first - 1; r <= row_col.first + 1; ++r) {
+      for (auto c = row_col.second - 1; c <= row_col.second + 1; ++c) {
+        if (r >= 0 && r < tile_level.tiles.nrows() && c >= 0 && c < tile_level.tiles.ncolumns() &&
+            changed.count(GraphId(tile_level.tiles.TileId(c, r), tile_level.level, 0))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  std::vector<std::pair<GraphId, std::string>> requests;
+  size_t skipped = 0;
   for (const auto& tile : tiles) {
     auto bbox = tile_level.tiles.TileBounds(tile.tileid());
     auto min_y = std::max(bbox.miny(), bbox.minpt().MidPoint({bbox.maxx(), bbox.miny()}).second);
@@ -261,36 +347,48 @@ std::priority_queue<weighted_tile_t> which_tiles(const ptree& pt, const std::str
     // stop count restricted to tiles overlapping the bounding box
     if (transit_bounding_box == "" || (!(bbox.minx() >= my_max_x || my_min_x >= bbox.maxx()) &&
                                        !(bbox.miny() >= my_max_y || my_min_y >= bbox.maxy()))) {
+      if (unchanged(tile)) {
+        ++skipped;
+        continue;
+      }
       auto request = url((boost::format("/api/v1/stop_stations?total=true&bbox=%1%,%2%,%3%,%4%") %
                           bbox.minx() % bbox.miny() % bbox.maxx() % bbox.maxy())
                              .str(),
                          pt);
       request += import_level;
-      auto stations_total = curler(request, "meta.total").get<size_t>("meta.total");
-      LOG_INFO(request);
-      /*
-      //route count
-      request = url((boost::format("/api/v1/routes?total=true&per_page=0&bbox=%1%,%2%,%3%,%4%")
-        % bbox.minx() % bbox.miny() % bbox.maxx() % bbox.maxy()).str(), pt);
-      auto routes_total = curler(request, "meta.total").get<size_t>("meta.total");
-      //pair count
-      request =
-      url((boost::format("/api/v1/schedule_stop_pairs?total=true&per_page=0&bbox=%1%,%2%,%3%,%4%&service_from_date=%5%-%6%-%7%")
-        % bbox.minx() % bbox.miny() % bbox.maxx() % bbox.maxy() % utc->tm_year % utc->tm_mon %
-      utc->tm_mday).str(), pt); auto pairs_total = curler(request,
-      "meta.total").get<size_t>("meta.total");
-      */
-      // we have anything we want it
-      if (stations_total > 0 /* || routes_total > 0|| pairs_total > 0*/) {
-        prioritized.push(
-            weighted_tile_t{tile,
-                            stations_total +
-                                10 /* + routes_total * 1000 + pairs_total*/}); // TODO: factor in stop
-                                                                               // pairs as well
-        LOG_INFO(GraphTile::FileSuffix(tile) + " should have " + std::to_string(stations_total) +
-                " stations " /* +
-            std::to_string(routes_total) +  " routes and " + std::to_string(pairs_total) +  " stop_pairs"*/);
+      requests.emplace_back(tile, request);
+    }
+  }
+  if (skipped) {
+    LOG_INFO("Skipping " + std::to_string(skipped) + " transit tiles whose feeds have not changed");
+  }
+
+  // count the stations of each tile, with as many requests in flight as there are fetch threads
+  std::vector<size_t> stations_totals(requests.size());
+  std::atomic<size_t> next_request(0);
+  std::vector<std::shared_ptr<std::thread>> threads(fetch_threads(pt));
+  for (auto& thread : threads) {
+    thread.reset(new std::thread([&]() {
+      pt_curler_t curler;
+      for (size_t i = next_request++; i < requests.size(); i = next_request++) {
+        stations_totals[i] = curler(requests[i].second, "meta.total").get<size_t>("meta.total");
+        LOG_INFO(requests[i].second);
       }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    const auto& tile = requests[i].first;
+    auto stations_total = stations_totals[i];
+    // we have anything we want it
+    if (stations_total > 0) {
+      // TODO: factor in stop pairs as well
+      prioritized.push(weighted_tile_t{tile, stations_total + 10});
+      LOG_INFO(GraphTile::FileSuffix(tile) + " should have " + std::to_string(stations_total) +
+               " stations");
     }
   }
   LOG_INFO("Finished with " + std::to_string(prioritized.size()) + " transit tiles in " +
@@ -838,10 +936,7 @@ void fetch_tiles(const ptree& pt,
     LOG_INFO("ok1");
 
     Transit tile;
-    auto file_name = GraphTile::FileSuffix(current);
-    file_name = file_name.substr(0, file_name.size() - 3) + "pbf";
-    boost::filesystem::path transit_tile = pt.get<std::string>("mjolnir.transit_dir") +
-                                           filesystem::path::preferred_separator + file_name;
+    boost::filesystem::path transit_tile = transit_file(pt, current);
 
     // tiles are wrote out with .pbf or .pbf.n ext
     uint32_t ext = 0;
@@ -935,9 +1030,7 @@ void fetch_tiles(const ptree& pt,
 
     do {
       // grab some stuff
-      uniques.lock.lock();
       response = curler(*request, "routes");
-      uniques.lock.unlock();
       // copy routes in, keeping track of routeid to route index
       get_routes(tile, routes, websites, short_names, response);
       // please sir may i have some more?
@@ -1017,12 +1110,9 @@ void fetch_tiles(const ptree& pt,
   promise.set_value(dangling);
 }
 
-std::list<GraphId> fetch(const ptree& pt,
-                         std::priority_queue<weighted_tile_t>& tiles,
-                         unsigned int thread_count = std::max(static_cast<unsigned int>(1),
-                                                              std::thread::hardware_concurrency())) {
-  //thread_count = thread_count - 1;
-  thread_count = 6;
+std::list<GraphId> fetch(const ptree& pt, std::priority_queue<weighted_tile_t>& tiles) {
+  // each thread has one request in flight at a time
+  auto thread_count = fetch_threads(pt);
   LOG_INFO("Fetching " + std::to_string(tiles.size()) + " transit tiles with " +
            std::to_string(thread_count) + " threads...");
 
@@ -1249,11 +1339,13 @@ int main(int argc, char** argv) {
 
   // go get information about what transit tiles we should be fetching
 
-  auto transit_tiles = which_tiles(pt, feed);
+  auto feed_versions = read_feed_versions(pt);
+  auto transit_tiles = which_tiles(pt, feed, feed_versions);
   LOG_INFO("step 1");
   // spawn threads to download all the tiles returning a list of
   // tiles that ended up having dangling stop pairs
   auto dangling_tiles = fetch(pt, transit_tiles);
+  write_feed_versions(pt, feed_versions);
   LOG_INFO("step 2");
   curl_global_cleanup();
   LOG_INFO("step 3");
@@ -1,8 +1,13 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <fstream>
+#include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
-#include <unordered_map>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 #include "config.h"
@@ -27,16 +32,33 @@ using namespace valhalla::midgard;
 
 boost::filesystem::path config_file_path;
 std::vector<std::string> input_files;
+unsigned int num_threads = std::thread::hardware_concurrency();
+unsigned int num_shards = 1;
+bool binary = false;
 
-// Structure holding an edge Id and forward flag
-struct EdgeAndDirection {
-  bool forward;
+// An edge of a way. The output is ordered by way id and the edges of a way by tile and edge id
+struct WayEdge {
+  uint64_t wayid;
   GraphId edgeid;
+  bool forward;
 
-  EdgeAndDirection(const bool f, const GraphId& id) : forward(f), edgeid(id) {
+  bool operator<(const WayEdge& other) const {
+    return std::make_tuple(wayid, edgeid.tileid(), edgeid.id()) <
+           std::make_tuple(other.wayid, other.edgeid.tileid(), other.edgeid.id());
   }
 };
 
+// Fixed width record of the binary output, one per edge
+struct WayEdgeRecord {
+  uint64_t wayid;
+  uint64_t edgeid : 46;
+  uint64_t forward : 1;
+  uint64_t spare : 17;
+};
+
+// Size of the buffer of each output file
+constexpr size_t kWriteBufferSize = 1024 * 1024;
+
 bool ParseArguments(int argc, char* argv[]) {
 
   bpo::options_description options(
@@ -45,7 +67,8 @@ bool ParseArguments(int argc, char* argv[]) {
       " Usage: ways_to_edges [options]\n"
       "\n"
       "ways_to_edges is a program that creates a list of edges for each OSM way "
-      "on the local level tiles."
+      "on the local level tiles. The ways are written ordered by way id to way_edges.txt "
+      "in the tile directory, or to one file per shard."
       "\n"
       "\n");
 
@@ -53,7 +76,13 @@ bool ParseArguments(int argc, char* argv[]) {
                                                               "Print the version of this software.")(
       "config,c",
       boost::program_options::value<boost::filesystem::path>(&config_file_path)->required(),
-      "Path to the json configuration file.")
+      "Path to the json configuration file.")("concurrency,j",
+                                              bpo::value<unsigned int>(&num_threads),
+                                              "Number of threads to use.")(
+      "shards,s", bpo::value<unsigned int>(&num_shards),
+      "Number of files to split the ways over by way id [default=1].")(
+      "binary,b", "Write fixed width records of a 64 bit way id and a 64 bit edge id with the "
+                  "forward flag in bit 46 instead of text [default=false].")
       // positional arguments
       ("input_files",
        boost::program_options::value<std::vector<std::string>>(&input_files)->multitoken());
@@ -83,6 +112,10 @@ bool ParseArguments(int argc, char* argv[]) {
     return true;
   }
 
+  binary = vm.count("binary");
+  num_threads = std::max(num_threads, 1u);
+  num_shards = std::max(num_shards, 1u);
+
   if (vm.count("config")) {
     if (boost::filesystem::is_regular_file(config_file_path)) {
       return true;
@@ -106,53 +139,96 @@ int main(int argc, char** argv) {
   boost::property_tree::ptree pt;
   rapidjson::read_json(config_file_path.c_str(), pt);
 
-  // Get something we can use to fetch tiles
+  // Get the tiles at the local level
   auto tile_properties = pt.get_child("mjolnir");
   auto local_level = TileHierarchy::levels().rbegin()->second.level;
   auto tiles = TileHierarchy::levels().rbegin()->second.tiles;
-
-  // Create an unordered map of OSM ways Ids and their associated graph edges
-  std::unordered_map<uint64_t, std::vector<EdgeAndDirection>> ways_edges;
-
-  // Iterate through tiles at the local level
-  GraphReader reader(pt.get_child("mjolnir"));
+  std::vector<GraphId> tile_ids;
   for (uint32_t id = 0; id < tiles.TileCount(); id++) {
-    // If tile exists add it to the queue
-    GraphId edge_id(id, local_level, 0);
-    if (!reader.DoesTileExist(tile_properties, edge_id)) {
-      continue;
+    GraphId tile_id(id, local_level, 0);
+    if (GraphReader::DoesTileExist(tile_properties, tile_id)) {
+      tile_ids.push_back(tile_id);
     }
+  }
 
-    const GraphTile* tile = reader.GetGraphTile(edge_id);
-    for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, ++edge_id) {
-      const DirectedEdge* edge = tile->directededge(edge_id);
-      if (edge->IsTransitLine() || edge->use() == Use::kTransitConnection ||
-          edge->use() == Use::kEgressConnection || edge->use() == Use::kPlatformConnection) {
-        continue;
+  // Each thread collects the edges of the tiles it takes by the shard of their way
+  std::atomic<size_t> next(0);
+  std::vector<std::vector<std::vector<WayEdge>>> ways_edges(
+      num_threads, std::vector<std::vector<WayEdge>>(num_shards));
+  std::vector<std::thread> threads(num_threads);
+  for (size_t t = 0; t < threads.size(); ++t) {
+    threads[t] = std::thread([&, t]() {
+      GraphReader reader(tile_properties);
+      for (size_t i; (i = next++) < tile_ids.size();) {
+        GraphId edge_id = tile_ids[i];
+        const GraphTile* tile = reader.GetGraphTile(edge_id);
+        for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, ++edge_id) {
+          const DirectedEdge* edge = tile->directededge(edge_id);
+          if (edge->IsTransitLine() || edge->use() == Use::kTransitConnection ||
+              edge->use() == Use::kEgressConnection || edge->use() == Use::kPlatformConnection) {
+            continue;
+          }
+
+          // Skip if the edge does not allow auto use
+          if (!(edge->forwardaccess() & kAutoAccess)) {
+            continue;
+          }
+
+          // Get the way Id
+          uint64_t wayid = tile->edgeinfo(edge->edgeinfo_offset()).wayid();
+          ways_edges[t][wayid % num_shards].push_back({wayid, edge_id, edge->forward()});
+        }
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
       }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
 
-      // Skip if the edge does not allow auto use
-      if (!(edge->forwardaccess() & kAutoAccess)) {
-        continue;
+  // Sort and write the shards in parallel, each to its own buffered file
+  std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  next = 0;
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      for (size_t shard; (shard = next++) < num_shards;) {
+        std::vector<WayEdge> edges;
+        for (auto& thread_edges : ways_edges) {
+          edges.insert(edges.end(), thread_edges[shard].begin(), thread_edges[shard].end());
+          std::vector<WayEdge>().swap(thread_edges[shard]);
+        }
+        std::sort(edges.begin(), edges.end());
+
+        std::string fname = tile_dir + "/way_edges" +
+                            (num_shards > 1 ? "." + std::to_string(shard) : std::string()) +
+                            (binary ? ".bin" : ".txt");
+        std::unique_ptr<char[]> buffer(new char[kWriteBufferSize]);
+        std::ofstream ways_file;
+        ways_file.rdbuf()->pubsetbuf(buffer.get(), kWriteBufferSize);
+        ways_file.open(fname, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+        for (auto edge = edges.cbegin(); edge != edges.cend(); ++edge) {
+          if (binary) {
+            WayEdgeRecord record{edge->wayid, edge->edgeid.value, edge->forward, 0};
+            ways_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            continue;
+          }
+          if (edge == edges.cbegin() || (edge - 1)->wayid != edge->wayid) {
+            ways_file << (edge == edges.cbegin() ? "" : "\n") << edge->wayid;
+          }
+          ways_file << "," << (uint32_t)edge->forward << "," << (uint64_t)edge->edgeid;
+        }
+        if (!binary && !edges.empty()) {
+          ways_file << "\n";
+        }
+        ways_file.close();
       }
-
-      // Get the way Id
-      uint64_t wayid = tile->edgeinfo(edge->edgeinfo_offset()).wayid();
-      ways_edges[wayid].push_back({edge->forward(), edge_id});
-    }
+    });
   }
-
-  std::ofstream ways_file;
-  std::string fname = pt.get<std::string>("mjolnir.tile_dir") + "/way_edges.txt";
-  ways_file.open(fname, std::ofstream::out | std::ofstream::trunc);
-  for (auto way : ways_edges) {
-    ways_file << way.first;
-    for (auto edge : way.second) {
-      ways_file << "," << (uint32_t)edge.forward << "," << (uint64_t)edge.edgeid;
-    }
-    ways_file << std::endl;
+  for (auto& thread : threads) {
+    thread.join();
   }
-  ways_file.close();
 
   return EXIT_SUCCESS;
 }
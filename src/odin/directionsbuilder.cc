@@ -1,5 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "midgard/logging.h"
 #include "odin/directionsbuilder.h"
@@ -67,44 +73,110 @@ const std::unordered_map<int, DirectionsLeg_TravelMode> translate_travel_mode{
 // NarrativeBuilder::Build to form the maneuver list. This method
 // calls PopulateDirectionsLeg to transform the maneuver list into the
 // trip directions.
-void DirectionsBuilder::Build(Api& api) {
+void DirectionsBuilder::Build(Api& api,
+                              uint32_t threads,
+                              const std::function<void()>* interrupt) {
   const auto& options = api.options();
+
+  // Make a place for the directions of every leg up front so the legs can be filled out in any
+  // order. Each leg only touches its own messages so they can be narrated at the same time
+  std::vector<std::pair<TripLeg*, DirectionsLeg*>> legs;
   for (auto& trip_route : *api.mutable_trip()->mutable_routes()) {
     auto& directions_route = *api.mutable_directions()->mutable_routes()->Add();
     for (auto& trip_path : *trip_route.mutable_legs()) {
-      auto& trip_directions = *directions_route.mutable_legs()->Add();
+      legs.emplace_back(&trip_path, directions_route.mutable_legs()->Add());
+    }
+  }
 
-      // Validate trip path node list
-      if (trip_path.node_size() < 1) {
-        throw valhalla_exception_t{210};
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  threads = std::min(threads, static_cast<uint32_t>(legs.size()));
+  if (threads <= 1) {
+    for (auto& leg : legs) {
+      if (interrupt) {
+        (*interrupt)();
       }
+      BuildLeg(options, *leg.first, *leg.second);
+    }
+    return;
+  }
+
+  // Each thread takes the next leg until there are none left, the calling thread helps out. Only
+  // the calling thread checks the interrupt, when it throws no more legs are handed out
+  std::atomic<size_t> next(0);
+  std::vector<std::exception_ptr> errors(legs.size());
+  std::exception_ptr interrupted;
+  auto work = [&](const std::function<void()>* check) {
+    for (size_t i = next++; i < legs.size(); i = next++) {
+      if (check) {
+        try {
+          (*check)();
+        } catch (...) {
+          interrupted = std::current_exception();
+          next = legs.size();
+          return;
+        }
+      }
+      try {
+        BuildLeg(options, *legs[i].first, *legs[i].second);
+      } catch (...) { errors[i] = std::current_exception(); }
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (uint32_t i = 1; i < threads; ++i) {
+    workers.emplace_back(work, nullptr);
+  }
+  work(interrupt);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  if (interrupted) {
+    std::rethrow_exception(interrupted);
+  }
 
-      // Create an enhanced trip path from the specified trip_path
-      EnhancedTripLeg etp(trip_path);
+  // The error of the first leg that failed, as if they had been narrated one after the other
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
 
-      // Produce maneuvers if desired
-      std::list<Maneuver> maneuvers;
-      if (options.directions_type() != DirectionsType::none) {
-        // Update the heading of ~0 length edges
-        UpdateHeading(&etp);
+// Builds the directions of one leg
+void DirectionsBuilder::BuildLeg(const Options& options,
+                                 TripLeg& trip_path,
+                                 DirectionsLeg& trip_directions) {
+  // Validate trip path node list
+  if (trip_path.node_size() < 1) {
+    throw valhalla_exception_t{210};
+  }
 
-        ManeuversBuilder maneuversBuilder(options, &etp);
-        maneuvers = maneuversBuilder.Build();
+  // Create an enhanced trip path from the specified trip_path
+  EnhancedTripLeg etp(trip_path);
 
-        // Create the instructions if desired
-        if (options.directions_type() == DirectionsType::instructions) {
-          std::unique_ptr<NarrativeBuilder> narrative_builder =
-              NarrativeBuilderFactory::Create(options, &etp);
-          narrative_builder->Build(options, &etp, maneuvers);
-        }
-      }
+  // Produce maneuvers if desired
+  std::list<Maneuver> maneuvers;
+  if (options.directions_type() != DirectionsType::none) {
+    // Update the heading of ~0 length edges
+    UpdateHeading(&etp);
 
-      // Return trip directions
-      PopulateDirectionsLeg(options, &etp, maneuvers, trip_directions);
+    ManeuversBuilder maneuversBuilder(options, &etp);
+    maneuvers = maneuversBuilder.Build();
 
-      LOG_INFO("maneuver_count::" + std::to_string(trip_directions.maneuver_size()));
+    // Create the instructions if desired
+    if (options.directions_type() == DirectionsType::instructions) {
+      std::unique_ptr<NarrativeBuilder> narrative_builder =
+          NarrativeBuilderFactory::Create(options, &etp);
+      narrative_builder->Build(options, &etp, maneuvers);
     }
   }
+
+  // Return trip directions
+  PopulateDirectionsLeg(options, &etp, maneuvers, trip_directions);
+
+  LOG_INFO("maneuver_count::" + std::to_string(trip_directions.maneuver_size()));
 }
 
 // Update the heading of ~0 length edges.
@@ -184,28 +184,58 @@ namespace odin {
 EnhancedTripLeg::EnhancedTripLeg(TripLeg& trip_path) : trip_path_(trip_path) {
 }
 
-std::unique_ptr<EnhancedTripLeg_Node> EnhancedTripLeg::GetEnhancedNode(const int node_index) {
-  return std::make_unique<EnhancedTripLeg_Node>(mutable_node(node_index));
+void EnhancedTripLeg::Index() const {
+  if (nodes_.size() == static_cast<size_t>(node_size()) &&
+      admins_.size() == static_cast<size_t>(admin_size())) {
+    return;
+  }
+  nodes_.clear();
+  edges_.clear();
+  last_edge_.reset();
+  admins_.clear();
+  nodes_.reserve(node_size());
+  edges_.reserve(node_size());
+  for (int i = 0; i < node_size(); ++i) {
+    nodes_.emplace_back(mutable_node(i));
+    if (!IsLastNodeIndex(i)) {
+      edges_.emplace_back(mutable_node(i)->mutable_edge());
+    }
+  }
+  admins_.reserve(admin_size());
+  for (int i = 0; i < admin_size(); ++i) {
+    admins_.emplace_back(trip_path_.mutable_admin(i));
+  }
 }
 
-std::unique_ptr<EnhancedTripLeg_Edge> EnhancedTripLeg::GetPrevEdge(const int node_index, int delta) {
+EnhancedTripLeg_Node* EnhancedTripLeg::GetEnhancedNode(const int node_index) {
+  Index();
+  return &nodes_.at(node_index);
+}
+
+EnhancedTripLeg_Edge* EnhancedTripLeg::GetPrevEdge(const int node_index, int delta) {
   int index = node_index - delta;
-  if (IsValidNodeIndex(index)) {
-    return std::make_unique<EnhancedTripLeg_Edge>(mutable_node(index)->mutable_edge());
-  } else {
+  if (!IsValidNodeIndex(index)) {
     return nullptr;
   }
+  Index();
+  if (IsLastNodeIndex(index)) {
+    if (!last_edge_) {
+      last_edge_.reset(new EnhancedTripLeg_Edge(mutable_node(index)->mutable_edge()));
+    }
+    return last_edge_.get();
+  }
+  return &edges_[index];
 }
 
-std::unique_ptr<EnhancedTripLeg_Edge> EnhancedTripLeg::GetCurrEdge(const int node_index) const {
+EnhancedTripLeg_Edge* EnhancedTripLeg::GetCurrEdge(const int node_index) const {
   return GetNextEdge(node_index, 0);
 }
 
-std::unique_ptr<EnhancedTripLeg_Edge> EnhancedTripLeg::GetNextEdge(const int node_index,
-                                                                   int delta) const {
+EnhancedTripLeg_Edge* EnhancedTripLeg::GetNextEdge(const int node_index, int delta) const {
   int index = node_index + delta;
   if (IsValidNodeIndex(index) && !IsLastNodeIndex(index)) {
-    return std::make_unique<EnhancedTripLeg_Edge>(mutable_node(index)->mutable_edge());
+    Index();
+    return &edges_[index];
   } else {
     return nullptr;
   }
@@ -236,8 +266,9 @@ int EnhancedTripLeg::GetLastNodeIndex() const {
   return (node_size() - 1);
 }
 
-std::unique_ptr<EnhancedTripLeg_Admin> EnhancedTripLeg::GetAdmin(size_t index) {
-  return std::make_unique<EnhancedTripLeg_Admin>(mutable_admin(index));
+EnhancedTripLeg_Admin* EnhancedTripLeg::GetAdmin(size_t index) {
+  Index();
+  return &admins_.at(index);
 }
 
 std::string EnhancedTripLeg::GetCountryCode(int node_index) {
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -259,25 +260,47 @@ std::list<Maneuver> ManeuversBuilder::Produce() {
 void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
   bool maneuvers_have_been_combined = true;
 
+  // Whether a maneuver is combined only depends on it, the one before it and the one after it. So
+  // a pass can start right before the first maneuver the last pass changed, the maneuvers before
+  // that were already found to not combine
+  size_t first_combined = 0;
+
   // Continue trying to combine maneuvers until no maneuvers have been combined
   while (maneuvers_have_been_combined) {
     maneuvers_have_been_combined = false;
 
-    auto prev_man = maneuvers.begin();
     auto curr_man = maneuvers.begin();
-    auto next_man = maneuvers.begin();
+    if (first_combined > 1) {
+      std::advance(curr_man, first_combined - 1);
+    }
+    auto prev_man = (curr_man == maneuvers.begin()) ? curr_man : std::prev(curr_man);
+    auto next_man = curr_man;
 
     if (next_man != maneuvers.end()) {
       ++next_man;
     }
 
-    while (next_man != maneuvers.end()) {
-      // Process common base names
-      std::unique_ptr<StreetNames> common_base_names =
-          curr_man->street_names().FindCommonBaseNames(next_man->street_names());
+    // Remember where the first maneuver of this pass was combined, it is at the position of the
+    // current maneuver once the maneuvers are combined
+    auto combined = [&]() {
+      if (!maneuvers_have_been_combined) {
+        first_combined = std::distance(maneuvers.begin(), curr_man);
+      }
+      maneuvers_have_been_combined = true;
+    };
 
-      // Get the begin edge of the next maneuver
-      auto next_man_begin_edge = trip_path_->GetCurrEdge(next_man->begin_node_index());
+    while (next_man != maneuvers.end()) {
+      // The common base names and the begin edge of the next maneuver are only found for the
+      // maneuvers that get that far in the checks below
+      std::unique_ptr<StreetNames> common_base_names;
+      auto have_common_base_names = [&]() {
+        common_base_names = curr_man->street_names().FindCommonBaseNames(next_man->street_names());
+        return !common_base_names->empty();
+      };
+      auto next_man_begins_off_turn_channel = [&]() {
+        auto next_man_begin_edge = trip_path_->GetCurrEdge(next_man->begin_node_index());
+        return next_man_begin_edge && !next_man_begin_edge->IsTurnChannelUse();
+      };
 
       bool is_first_man = (curr_man == maneuvers.begin());
 
@@ -289,7 +312,7 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
           curr_man->transit_connection_platform_info().type() == TransitPlatformInfo_Type_kStop) {
         LOG_TRACE("+++ Combine: Collapse the TransitConnectionStart Maneuver +++");
         curr_man = CollapseTransitConnectionStartManeuver(maneuvers, curr_man, next_man);
-        maneuvers_have_been_combined = true;
+        combined();
         ++next_man;
       }
       // Collapse the TransitConnectionDestination Maneuver
@@ -300,7 +323,7 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
                    TransitPlatformInfo_Type_kStop) {
         LOG_TRACE("+++ Combine: Collapse the TransitConnectionDestination Maneuver +++");
         next_man = CollapseTransitConnectionDestinationManeuver(maneuvers, curr_man, next_man);
-        maneuvers_have_been_combined = true;
+        combined();
       }
       // Do not combine
       // if any transit connection maneuvers
@@ -358,7 +381,7 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
         if (is_first_man) {
           prev_man = curr_man;
         }
-        maneuvers_have_been_combined = true;
+        combined();
         ++next_man;
       }
       // Combine current turn channel maneuver with next maneuver
@@ -368,7 +391,7 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
         if (is_first_man) {
           prev_man = curr_man;
         }
-        maneuvers_have_been_combined = true;
+        combined();
         ++next_man;
       }
       // Do not combine
@@ -402,9 +425,9 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
       // and the next maneuver is not a ramp
       // and current and next maneuvers have a common base name
       else if ((next_man->begin_relative_direction() == Maneuver::RelativeDirection::kKeepStraight) &&
-               (next_man_begin_edge && !next_man_begin_edge->IsTurnChannelUse()) &&
-               !next_man->internal_intersection() && !curr_man->ramp() && !next_man->ramp() &&
-               !curr_man->roundabout() && !next_man->roundabout() && !common_base_names->empty()) {
+               next_man_begins_off_turn_channel() && !next_man->internal_intersection() &&
+               !curr_man->ramp() && !next_man->ramp() && !curr_man->roundabout() &&
+               !next_man->roundabout() && have_common_base_names()) {
 
         LOG_TRACE("+++ Combine: Several factors +++");
         // If needed, set the begin street names
@@ -417,25 +440,24 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
         curr_man->set_street_names(std::move(common_base_names));
 
         next_man = CombineManeuvers(maneuvers, curr_man, next_man);
-        maneuvers_have_been_combined = true;
+        combined();
       }
       // Combine unnamed straight maneuvers
       else if ((next_man->begin_relative_direction() == Maneuver::RelativeDirection::kKeepStraight) &&
                !curr_man->HasStreetNames() && !next_man->HasStreetNames() && !curr_man->IsTransit() &&
-               !next_man->IsTransit() &&
-               (next_man_begin_edge && !next_man_begin_edge->IsTurnChannelUse()) &&
+               !next_man->IsTransit() && next_man_begins_off_turn_channel() &&
                !next_man->internal_intersection() && !curr_man->ramp() && !next_man->ramp() &&
                !curr_man->roundabout() && !next_man->roundabout()) {
 
         LOG_TRACE("+++ Combine: unnamed straight maneuvers +++");
         next_man = CombineManeuvers(maneuvers, curr_man, next_man);
-        maneuvers_have_been_combined = true;
+        combined();
       }
       // Combine ramp maneuvers
       else if (AreRampManeuversCombinable(curr_man, next_man)) {
         LOG_TRACE("+++ Combine: ramp maneuvers +++");
         next_man = CombineManeuvers(maneuvers, curr_man, next_man);
-        maneuvers_have_been_combined = true;
+        combined();
       } else {
         LOG_TRACE("+++ Do Not Combine +++");
         // Update with no combine
@@ -800,10 +822,12 @@ void ManeuversBuilder::CreateDestinationManeuver(Maneuver& maneuver) {
     maneuver.set_transit_type(prev_edge->transit_type());
   }
 
-  // Set the verbal text formatter
-  maneuver.set_verbal_formatter(
-      VerbalTextFormatterFactory::Create(trip_path_->GetCountryCode(node_index),
-                                         trip_path_->GetStateCode(node_index)));
+  // Set the verbal text formatter, only the narrative uses it
+  if (options_.directions_type() == DirectionsType::instructions) {
+    maneuver.set_verbal_formatter(
+        VerbalTextFormatterFactory::Create(trip_path_->GetCountryCode(node_index),
+                                           trip_path_->GetStateCode(node_index)));
+  }
 }
 
 void ManeuversBuilder::CreateStartManeuver(Maneuver& maneuver) {
@@ -1143,10 +1167,12 @@ void ManeuversBuilder::FinalizeManeuver(Maneuver& maneuver, int node_index) {
     }
   }
 
-  // Set the verbal text formatter
-  maneuver.set_verbal_formatter(
-      VerbalTextFormatterFactory::Create(trip_path_->GetCountryCode(node_index),
-                                         trip_path_->GetStateCode(node_index)));
+  // Set the verbal text formatter, only the narrative uses it
+  if (options_.directions_type() == DirectionsType::instructions) {
+    maneuver.set_verbal_formatter(
+        VerbalTextFormatterFactory::Create(trip_path_->GetCountryCode(node_index),
+                                           trip_path_->GetStateCode(node_index)));
+  }
 
   // Guide signs
   if (curr_edge->has_sign()) {
@@ -1329,7 +1355,7 @@ void ManeuversBuilder::SetManeuverType(Maneuver& maneuver, bool none_type_allowe
     }
   }
   // Process merge
-  else if (IsMergeManeuverType(maneuver, prev_edge.get(), curr_edge.get())) {
+  else if (IsMergeManeuverType(maneuver, prev_edge, curr_edge)) {
     switch (maneuver.merge_to_relative_direction()) {
       case Maneuver::RelativeDirection::kKeepRight: {
         maneuver.set_type(DirectionsLeg_Maneuver_Type_kMergeRight);
@@ -1360,7 +1386,7 @@ void ManeuversBuilder::SetManeuverType(Maneuver& maneuver, bool none_type_allowe
   // Process simple direction
   else {
     LOG_TRACE("ManeuverType=SIMPLE");
-    SetSimpleDirectionalManeuverType(maneuver, prev_edge.get(), curr_edge.get());
+    SetSimpleDirectionalManeuverType(maneuver, prev_edge, curr_edge);
   }
 }
 
@@ -1698,8 +1724,8 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
 
   /////////////////////////////////////////////////////////////////////////////
   // Process fork
-  if (IsFork(node_index, prev_edge.get(), curr_edge.get()) ||
-      IsPedestrianFork(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsFork(node_index, prev_edge, curr_edge) ||
+      IsPedestrianFork(node_index, prev_edge, curr_edge)) {
     maneuver.set_fork(true);
     return false;
   }
@@ -1788,12 +1814,12 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
 
   /////////////////////////////////////////////////////////////////////////////
   // Process pencil point u-turns
-  if (IsLeftPencilPointUturn(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsLeftPencilPointUturn(node_index, prev_edge, curr_edge)) {
     maneuver.set_type(DirectionsLeg_Maneuver_Type_kUturnLeft);
     LOG_TRACE("ManeuverType=PENCIL_POINT_UTURN_LEFT");
     return false;
   }
-  if (IsRightPencilPointUturn(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsRightPencilPointUturn(node_index, prev_edge, curr_edge)) {
     maneuver.set_type(DirectionsLeg_Maneuver_Type_kUturnRight);
     LOG_TRACE("ManeuverType=PENCIL_POINT_UTURN_RIGHT");
     return false;
@@ -1801,14 +1827,14 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
 
   /////////////////////////////////////////////////////////////////////////////
   // Intersecting forward edge
-  if (IsIntersectingForwardEdge(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsIntersectingForwardEdge(node_index, prev_edge, curr_edge)) {
     maneuver.set_intersecting_forward_edge(true);
     return false;
   }
 
   /////////////////////////////////////////////////////////////////////////////
   // Process 'T' intersection
-  if (IsTee(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsTee(node_index, prev_edge, curr_edge)) {
     maneuver.set_tee(true);
     return false;
   }
@@ -1828,7 +1854,7 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
   /////////////////////////////////////////////////////////////////////////////
   // Process unnamed edge
   if (!maneuver.HasStreetNames() && prev_edge->IsUnnamed() &&
-      IncludeUnnamedPrevEdge(node_index, prev_edge.get(), curr_edge.get())) {
+      IncludeUnnamedPrevEdge(node_index, prev_edge, curr_edge)) {
     return true;
   }
 
@@ -1887,7 +1913,7 @@ bool ManeuversBuilder::IsMergeManeuverType(Maneuver& maneuver,
         curr_edge->IsOneway() && curr_edge->IsForward(maneuver.turn_degree()) &&
         node->HasIntersectingEdgeCurrNameConsistency()))) {
     maneuver.set_merge_to_relative_direction(
-        DetermineMergeToRelativeDirection(node.get(), prev_edge));
+        DetermineMergeToRelativeDirection(node, prev_edge));
     return true;
   }
 
@@ -1,4 +1,5 @@
 #include <stdexcept>
+#include <string>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -35,6 +36,69 @@ std::unordered_map<K, V> as_unordered_map(boost::property_tree::ptree const& pt,
 namespace valhalla {
 namespace odin {
 
+PhraseTemplate::PhraseTemplate(const std::string& phrase) : phrase_(phrase) {
+  // A tag is a name of capital letters and underscores in angle brackets
+  uint32_t text = 0;
+  for (uint32_t i = 0; i < phrase_.size(); ++i) {
+    if (phrase_[i] != '<') {
+      continue;
+    }
+    uint32_t end = i + 1;
+    for (; end < phrase_.size(); ++end) {
+      if ((phrase_[end] < 'A' || phrase_[end] > 'Z') && phrase_[end] != '_') {
+        break;
+      }
+    }
+    if (end == i + 1 || end == phrase_.size() || phrase_[end] != '>') {
+      continue;
+    }
+    if (text < i) {
+      pieces_.push_back({text, i, false});
+    }
+    pieces_.push_back({i, end + 1, true});
+    text = end + 1;
+    i = end;
+  }
+  // Even an empty phrase has a piece so that it counts as loaded
+  if (text < phrase_.size() || pieces_.empty()) {
+    pieces_.push_back({text, static_cast<uint32_t>(phrase_.size()), false});
+  }
+}
+
+std::string PhraseTemplate::Render(std::initializer_list<Value> values) const {
+  size_t size = phrase_.size();
+  for (const auto& value : values) {
+    size += value.value.size();
+  }
+  std::string instruction;
+  instruction.reserve(size);
+  for (const auto& piece : pieces_) {
+    const Value* found = nullptr;
+    if (piece.tag) {
+      for (const auto& value : values) {
+        if (phrase_.compare(piece.begin, piece.end - piece.begin, value.tag) == 0) {
+          found = &value;
+          break;
+        }
+      }
+    }
+    if (found) {
+      instruction.append(found->value);
+    } else {
+      instruction.append(phrase_, piece.begin, piece.end - piece.begin);
+    }
+  }
+  return instruction;
+}
+
+std::string PhraseSet::Render(uint32_t phrase_id,
+                              std::initializer_list<PhraseTemplate::Value> values) const {
+  if (phrase_id >= templates.size() || !templates[phrase_id].loaded()) {
+    throw std::out_of_range("No phrase with id " + std::to_string(phrase_id));
+  }
+  return templates[phrase_id].Render(values);
+}
+
 NarrativeDictionary::NarrativeDictionary(const std::string& language_tag,
                                          const boost::property_tree::ptree& narrative_pt) {
   this->language_tag = language_tag;
@@ -331,6 +395,20 @@ void NarrativeDictionary::Load(PhraseSet& phrase_handle,
                                const boost::property_tree::ptree& phrase_pt) {
 
   phrase_handle.phrases = as_unordered_map<std::string, std::string>(phrase_pt, kPhrasesKey);
+
+  // Split the phrases at their tags once so they can be formed without searching them
+  phrase_handle.templates.clear();
+  for (const auto& phrase : phrase_handle.phrases) {
+    size_t end = 0;
+    auto phrase_id = std::stoul(phrase.first, &end);
+    if (end != phrase.first.size()) {
+      throw std::runtime_error("Invalid phrase id: " + phrase.first);
+    }
+    if (phrase_id >= phrase_handle.templates.size()) {
+      phrase_handle.templates.resize(phrase_id + 1);
+    }
+    phrase_handle.templates[phrase_id] = PhraseTemplate(phrase.second);
+  }
 }
 
 void NarrativeDictionary::Load(StartSubset& start_handle,
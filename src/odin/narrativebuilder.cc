@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <sstream>
@@ -43,6 +44,16 @@ NarrativeBuilder::NarrativeBuilder(const Options& options,
                                    const NarrativeDictionary& dictionary)
     : options_(options), trip_path_(trip_path), dictionary_(dictionary),
       articulated_preposition_enabled_(false) {
+  // All of the instructions are formed unless only some of them were asked for
+  auto enabled = [&options](Options::InstructionType type) {
+    return options.instruction_types_size() == 0 ||
+           std::find(options.instruction_types().begin(), options.instruction_types().end(),
+                     type) != options.instruction_types().end();
+  };
+  text_enabled_ = enabled(Options::text_instruction);
+  verbal_alert_enabled_ = enabled(Options::verbal_transition_alert_instruction);
+  verbal_pre_enabled_ = enabled(Options::verbal_pre_transition_instruction);
+  verbal_post_enabled_ = enabled(Options::verbal_post_transition_instruction);
 }
 
 void NarrativeBuilder::Build(const Options& options,
@@ -55,14 +66,18 @@ void NarrativeBuilder::Build(const Options& options,
       case DirectionsLeg_Maneuver_Type_kStart:
       case DirectionsLeg_Maneuver_Type_kStartLeft: {
         // Set instruction
-        maneuver.set_instruction(FormStartInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormStartInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalStartInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalStartInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction only if there are
         // begin street names
-        if (maneuver.HasBeginStreetNames()) {
+        if (verbal_post_enabled_ && maneuver.HasBeginStreetNames()) {
           maneuver.set_verbal_post_transition_instruction(
               FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
         }
@@ -72,27 +87,40 @@ void NarrativeBuilder::Build(const Options& options,
       case DirectionsLeg_Maneuver_Type_kDestination:
       case DirectionsLeg_Maneuver_Type_kDestinationLeft: {
         // Set instruction
-        maneuver.set_instruction(FormDestinationInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormDestinationInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertDestinationInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertDestinationInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalDestinationInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalDestinationInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kBecomes: {
         // Set instruction
-        maneuver.set_instruction(FormBecomesInstruction(maneuver, prev_maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormBecomesInstruction(maneuver, prev_maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalBecomesInstruction(maneuver, prev_maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalBecomesInstruction(maneuver, prev_maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kSlightRight:
@@ -102,48 +130,73 @@ void NarrativeBuilder::Build(const Options& options,
       case DirectionsLeg_Maneuver_Type_kSharpLeft:
       case DirectionsLeg_Maneuver_Type_kLeft: {
         // Set instruction
-        maneuver.set_instruction(FormTurnInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormTurnInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertTurnInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertTurnInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalTurnInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalTurnInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kUturnRight:
       case DirectionsLeg_Maneuver_Type_kUturnLeft: {
         // Set instruction
-        maneuver.set_instruction(FormUturnInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormUturnInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertUturnInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertUturnInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalUturnInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalUturnInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kRampStraight: {
         // Set instruction
-        maneuver.set_instruction(FormRampStraightInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormRampStraightInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertRampStraightInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertRampStraightInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalRampStraightInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalRampStraightInstruction(maneuver));
+        }
 
         // Only set verbal post if > min ramp length
-        if (maneuver.length() > kVerbalPostMinimumRampLength) {
+        if (verbal_post_enabled_ && maneuver.length() > kVerbalPostMinimumRampLength) {
           // Set verbal post transition instruction
           maneuver.set_verbal_post_transition_instruction(
               FormVerbalPostTransitionInstruction(maneuver));
@@ -153,16 +206,23 @@ void NarrativeBuilder::Build(const Options& options,
       case DirectionsLeg_Maneuver_Type_kRampRight:
       case DirectionsLeg_Maneuver_Type_kRampLeft: {
         // Set instruction
-        maneuver.set_instruction(FormRampInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormRampInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertRampInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertRampInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalRampInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalRampInstruction(maneuver));
+        }
 
         // Only set verbal post if > min ramp length
-        if (maneuver.length() > kVerbalPostMinimumRampLength) {
+        if (verbal_post_enabled_ && maneuver.length() > kVerbalPostMinimumRampLength) {
           // Set verbal post transition instruction
           maneuver.set_verbal_post_transition_instruction(
               FormVerbalPostTransitionInstruction(maneuver));
@@ -172,16 +232,23 @@ void NarrativeBuilder::Build(const Options& options,
       case DirectionsLeg_Maneuver_Type_kExitRight:
       case DirectionsLeg_Maneuver_Type_kExitLeft: {
         // Set instruction
-        maneuver.set_instruction(FormExitInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormExitInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertExitInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertExitInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalExitInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalExitInstruction(maneuver));
+        }
 
         // Only set verbal post if > min ramp length
-        if (maneuver.length() > kVerbalPostMinimumRampLength) {
+        if (verbal_post_enabled_ && maneuver.length() > kVerbalPostMinimumRampLength) {
           // Set verbal post transition instruction
           maneuver.set_verbal_post_transition_instruction(
               FormVerbalPostTransitionInstruction(maneuver));
@@ -193,33 +260,47 @@ void NarrativeBuilder::Build(const Options& options,
       case DirectionsLeg_Maneuver_Type_kStayLeft: {
         if (maneuver.to_stay_on()) {
           // Set stay on instruction
-          maneuver.set_instruction(FormKeepToStayOnInstruction(maneuver));
+          if (text_enabled_) {
+            maneuver.set_instruction(FormKeepToStayOnInstruction(maneuver));
+          }
 
           // Set verbal transition alert instruction
-          maneuver.set_verbal_transition_alert_instruction(
-              FormVerbalAlertKeepToStayOnInstruction(maneuver));
+          if (verbal_alert_enabled_) {
+            maneuver.set_verbal_transition_alert_instruction(
+                FormVerbalAlertKeepToStayOnInstruction(maneuver));
+          }
 
           // Set verbal pre transition instruction
-          maneuver.set_verbal_pre_transition_instruction(FormVerbalKeepToStayOnInstruction(maneuver));
+          if (verbal_pre_enabled_) {
+            maneuver.set_verbal_pre_transition_instruction(
+                FormVerbalKeepToStayOnInstruction(maneuver));
+          }
 
           // Only set verbal post if > min ramp length
-          if (maneuver.length() > kVerbalPostMinimumRampLength) {
+          if (verbal_post_enabled_ && maneuver.length() > kVerbalPostMinimumRampLength) {
             // Set verbal post transition instruction
             maneuver.set_verbal_post_transition_instruction(
                 FormVerbalPostTransitionInstruction(maneuver));
           }
         } else {
           // Set instruction
-          maneuver.set_instruction(FormKeepInstruction(maneuver));
+          if (text_enabled_) {
+            maneuver.set_instruction(FormKeepInstruction(maneuver));
+          }
 
           // Set verbal transition alert instruction
-          maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertKeepInstruction(maneuver));
+          if (verbal_alert_enabled_) {
+            maneuver.set_verbal_transition_alert_instruction(
+                FormVerbalAlertKeepInstruction(maneuver));
+          }
 
           // Set verbal pre transition instruction
-          maneuver.set_verbal_pre_transition_instruction(FormVerbalKeepInstruction(maneuver));
+          if (verbal_pre_enabled_) {
+            maneuver.set_verbal_pre_transition_instruction(FormVerbalKeepInstruction(maneuver));
+          }
 
           // Only set verbal post if > min ramp length
-          if (maneuver.length() > kVerbalPostMinimumRampLength) {
+          if (verbal_post_enabled_ && maneuver.length() > kVerbalPostMinimumRampLength) {
             // Set verbal post transition instruction
             maneuver.set_verbal_post_transition_instruction(
                 FormVerbalPostTransitionInstruction(maneuver));
@@ -231,220 +312,328 @@ void NarrativeBuilder::Build(const Options& options,
       case DirectionsLeg_Maneuver_Type_kMergeRight:
       case DirectionsLeg_Maneuver_Type_kMergeLeft: {
         // Set instruction
-        maneuver.set_instruction(FormMergeInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormMergeInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction if previous maneuver
         // is greater than 2 km
-        if (prev_maneuver && (prev_maneuver->length(Options::kilometers) >
-                              kVerbalAlertMergePriorManeuverMinimumLength)) {
+        if (verbal_alert_enabled_ && prev_maneuver &&
+            (prev_maneuver->length(Options::kilometers) >
+             kVerbalAlertMergePriorManeuverMinimumLength)) {
           maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertMergeInstruction(maneuver));
         }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalMergeInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalMergeInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kRoundaboutEnter: {
         // Set instruction
-        maneuver.set_instruction(FormEnterRoundaboutInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormEnterRoundaboutInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertEnterRoundaboutInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertEnterRoundaboutInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalEnterRoundaboutInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalEnterRoundaboutInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kRoundaboutExit: {
         // Set instruction
-        maneuver.set_instruction(FormExitRoundaboutInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormExitRoundaboutInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalExitRoundaboutInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalExitRoundaboutInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kFerryEnter: {
         // Set instruction
-        maneuver.set_instruction(FormEnterFerryInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormEnterFerryInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertEnterFerryInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertEnterFerryInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalEnterFerryInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalEnterFerryInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kFerryExit: {
         // Set instruction
-        maneuver.set_instruction(FormExitFerryInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormExitFerryInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertExitFerryInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertExitFerryInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalExitFerryInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalExitFerryInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitConnectionStart: {
         // Set instruction
-        maneuver.set_instruction(FormTransitConnectionStartInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormTransitConnectionStartInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitConnectionStartInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitConnectionStartInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitConnectionTransfer: {
         // Set instruction
-        maneuver.set_instruction(FormTransitConnectionTransferInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormTransitConnectionTransferInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitConnectionTransferInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitConnectionTransferInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitConnectionDestination: {
         // Set instruction
-        maneuver.set_instruction(FormTransitConnectionDestinationInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormTransitConnectionDestinationInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitConnectionDestinationInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitConnectionDestinationInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransit: {
         // Set depart instruction
-        maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
+        }
 
         // Set verbal depart instruction
-        maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        }
 
         // Set instruction
-        maneuver.set_instruction(FormTransitInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormTransitInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalTransitInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalTransitInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionTransitInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionTransitInstruction(maneuver));
+        }
 
         // Set arrive instruction
-        maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
+        }
 
         // Set verbal arrive instruction
-        maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        }
 
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitRemainOn: {
         // Set depart instruction
-        maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
+        }
 
         // Set verbal depart instruction
-        maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        }
 
         // Set instruction
-        maneuver.set_instruction(FormTransitRemainOnInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormTransitRemainOnInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitRemainOnInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitRemainOnInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionTransitInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionTransitInstruction(maneuver));
+        }
 
         // Set arrive instruction
-        maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
+        }
 
         // Set verbal arrive instruction
-        maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        }
 
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitTransfer: {
         // Set depart instruction
-        maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
+        }
 
         // Set verbal depart instruction
-        maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        }
 
         // Set instruction
-        maneuver.set_instruction(FormTransitTransferInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormTransitTransferInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitTransferInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitTransferInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionTransitInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionTransitInstruction(maneuver));
+        }
 
         // Set arrive instruction
-        maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
+        }
 
         // Set verbal arrive instruction
-        maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kPostTransitConnectionDestination: {
         // Set instruction
-        maneuver.set_instruction(FormPostTransitConnectionDestinationInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormPostTransitConnectionDestinationInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalPostTransitConnectionDestinationInstruction(maneuver));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalPostTransitConnectionDestinationInstruction(maneuver));
+        }
 
         // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+        if (verbal_post_enabled_) {
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kContinue:
       default: {
         // Set instruction
-        maneuver.set_instruction(FormContinueInstruction(maneuver));
+        if (text_enabled_) {
+          maneuver.set_instruction(FormContinueInstruction(maneuver));
+        }
 
         // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertContinueInstruction(maneuver));
+        if (verbal_alert_enabled_) {
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertContinueInstruction(maneuver));
+        }
 
         // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalContinueInstruction(maneuver, options.units()));
+        if (verbal_pre_enabled_) {
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalContinueInstruction(maneuver, options.units()));
+        }
         // NOTE: No verbal post transition instruction
         break;
       }
@@ -455,7 +644,9 @@ void NarrativeBuilder::Build(const Options& options,
   }
 
   // Iterate over maneuvers to form verbal multi-cue instructions
-  FormVerbalMultiCue(maneuvers);
+  if (verbal_pre_enabled_) {
+    FormVerbalMultiCue(maneuvers);
+  }
 }
 
 std::string NarrativeBuilder::FormStartInstruction(Maneuver& maneuver) {
@@ -503,13 +694,11 @@ std::string NarrativeBuilder::FormStartInstruction(Maneuver& maneuver) {
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.start_subset.Render(phrase_id, {{kCardinalDirectionTag, cardinal_direction},
+                                                  {kStreetNamesTag, street_names},
+                                                  {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -561,16 +750,16 @@ std::string NarrativeBuilder::FormVerbalStartInstruction(Maneuver& maneuver,
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto length = FormLength(maneuver,
+                                 dictionary_.start_verbal_subset.metric_lengths,
+                                 dictionary_.start_verbal_subset.us_customary_lengths);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.start_verbal_subset.metric_lengths,
-                                dictionary_.start_verbal_subset.us_customary_lengths));
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.start_verbal_subset.Render(
+      phrase_id, {{kCardinalDirectionTag, cardinal_direction},
+                  {kStreetNamesTag, street_names},
+                  {kBeginStreetNamesTag, begin_street_names},
+                  {kLengthTag, length}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -615,7 +804,7 @@ std::string NarrativeBuilder::FormDestinationInstruction(Maneuver& maneuver) {
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_subset.phrases.at(std::to_string(phrase_id));
+  instruction = dictionary_.destination_subset.Render(phrase_id);
 
   if (phrase_id > 0) {
     // Replace phrase tags with values
@@ -671,7 +860,7 @@ std::string NarrativeBuilder::FormVerbalAlertDestinationInstruction(Maneuver& ma
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
+  instruction = dictionary_.destination_verbal_alert_subset.Render(phrase_id);
 
   if (phrase_id > 0) {
     // Replace phrase tags with values
@@ -727,7 +916,7 @@ std::string NarrativeBuilder::FormVerbalDestinationInstruction(Maneuver& maneuve
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_subset.phrases.at(std::to_string(phrase_id));
+  instruction = dictionary_.destination_verbal_subset.Render(phrase_id);
 
   if (phrase_id > 0) {
     // Replace phrase tags with values
@@ -756,12 +945,10 @@ std::string NarrativeBuilder::FormBecomesInstruction(Maneuver& maneuver, Maneuve
   // Determine which phrase to use
   uint8_t phrase_id = 0;
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.becomes_subset.Render(phrase_id, {{kPreviousStreetNamesTag, prev_street_names},
+                                                    {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -791,12 +978,10 @@ std::string NarrativeBuilder::FormVerbalBecomesInstruction(Maneuver& maneuver,
   // Determine which phrase to use
   uint8_t phrase_id = 0;
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.becomes_verbal_subset.Render(
+      phrase_id, {{kPreviousStreetNamesTag, prev_street_names},
+                  {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -824,11 +1009,8 @@ std::string NarrativeBuilder::FormContinueInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.continue_subset.Render(phrase_id, {{kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -859,11 +1041,9 @@ std::string NarrativeBuilder::FormVerbalAlertContinueInstruction(Maneuver& maneu
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.continue_verbal_alert_subset.Render(phrase_id, {{kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -895,14 +1075,14 @@ std::string NarrativeBuilder::FormVerbalContinueInstruction(Maneuver& maneuver,
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto length = FormLength(maneuver,
+                                 dictionary_.continue_verbal_subset.metric_lengths,
+                                 dictionary_.continue_verbal_subset.us_customary_lengths);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.continue_verbal_subset.metric_lengths,
-                                dictionary_.continue_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.continue_verbal_subset.Render(phrase_id, {{kLengthTag, length},
+                                                            {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -958,14 +1138,13 @@ std::string NarrativeBuilder::FormTurnInstruction(Maneuver& maneuver) {
     phrase_id = 3;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), subset->relative_directions);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = subset->Render(phrase_id, {{kRelativeDirectionTag, relative_direction},
+                                           {kStreetNamesTag, street_names},
+                                           {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1037,14 +1216,13 @@ std::string NarrativeBuilder::FormVerbalTurnInstruction(Maneuver& maneuver,
     phrase_id = 3;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), subset->relative_directions);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = subset->Render(phrase_id, {{kRelativeDirectionTag, relative_direction},
+                                           {kStreetNamesTag, street_names},
+                                           {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1085,15 +1263,14 @@ std::string NarrativeBuilder::FormUturnInstruction(Maneuver& maneuver) {
     phrase_id += 3;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_subset.phrases.at(std::to_string(phrase_id));
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), dictionary_.uturn_subset.relative_directions);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.uturn_subset.relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.uturn_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_direction},
+                                                  {kStreetNamesTag, street_names},
+                                                  {kCrossStreetNamesTag, cross_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1194,13 +1371,11 @@ std::string NarrativeBuilder::FormVerbalUturnInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.uturn_verbal_subset.Render(
+      phrase_id, {{kRelativeDirectionTag, relative_dir},
+                  {kStreetNamesTag, street_names},
+                  {kCrossStreetNamesTag, cross_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1246,13 +1421,11 @@ std::string NarrativeBuilder::FormRampStraightInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.ramp_straight_subset.Render(phrase_id, {{kBranchSignTag, exit_branch_sign},
+                                                          {kTowardSignTag, exit_toward_sign},
+                                                          {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1349,13 +1522,11 @@ std::string NarrativeBuilder::FormVerbalRampStraightInstruction(uint8_t phrase_i
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.ramp_straight_verbal_subset.Render(phrase_id, {{kBranchSignTag, exit_branch_sign},
+                                                                 {kTowardSignTag, exit_toward_sign},
+                                                                 {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1423,16 +1594,15 @@ std::string NarrativeBuilder::FormRampInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_subset.phrases.at(std::to_string(phrase_id));
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), dictionary_.ramp_subset.relative_directions);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.ramp_subset.relative_directions));
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.ramp_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_direction},
+                                                 {kBranchSignTag, exit_branch_sign},
+                                                 {kTowardSignTag, exit_toward_sign},
+                                                 {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1581,14 +1751,12 @@ std::string NarrativeBuilder::FormVerbalRampInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.ramp_verbal_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_dir},
+                                                        {kBranchSignTag, exit_branch_sign},
+                                                        {kTowardSignTag, exit_toward_sign},
+                                                        {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1666,17 +1834,16 @@ std::string NarrativeBuilder::FormExitInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_subset.phrases.at(std::to_string(phrase_id));
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), dictionary_.exit_subset.relative_directions);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.exit_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.exit_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_direction},
+                                                 {kNumberSignTag, exit_number_sign},
+                                                 {kBranchSignTag, exit_branch_sign},
+                                                 {kTowardSignTag, exit_toward_sign},
+                                                 {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1833,15 +2000,13 @@ std::string NarrativeBuilder::FormVerbalExitInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.exit_verbal_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_dir},
+                                                        {kNumberSignTag, exit_number_sign},
+                                                        {kBranchSignTag, exit_branch_sign},
+                                                        {kTowardSignTag, exit_toward_sign},
+                                                        {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1906,16 +2071,15 @@ std::string NarrativeBuilder::FormKeepInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitTowardString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_subset.phrases.at(std::to_string(phrase_id));
+  const auto relative_direction =
+      FormRelativeThreeDirection(maneuver.type(), dictionary_.keep_subset.relative_directions);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeThreeDirection(maneuver.type(),
-                                                dictionary_.keep_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.keep_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_direction},
+                                                 {kNumberSignTag, exit_number_sign},
+                                                 {kStreetNamesTag, street_names},
+                                                 {kTowardSignTag, exit_toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2039,14 +2203,12 @@ std::string NarrativeBuilder::FormVerbalKeepInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.keep_verbal_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_dir},
+                                                        {kNumberSignTag, exit_number_sign},
+                                                        {kStreetNamesTag, street_names},
+                                                        {kTowardSignTag, exit_toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2091,16 +2253,16 @@ std::string NarrativeBuilder::FormKeepToStayOnInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitTowardString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_subset.phrases.at(std::to_string(phrase_id));
+  const auto relative_direction =
+      FormRelativeThreeDirection(maneuver.type(),
+                                 dictionary_.keep_to_stay_on_subset.relative_directions);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeThreeDirection(maneuver.type(), dictionary_.keep_to_stay_on_subset
-                                                                     .relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.keep_to_stay_on_subset.Render(
+      phrase_id, {{kRelativeDirectionTag, relative_direction},
+                  {kStreetNamesTag, street_names},
+                  {kNumberSignTag, exit_number_sign},
+                  {kTowardSignTag, exit_toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2181,14 +2343,12 @@ std::string NarrativeBuilder::FormVerbalKeepToStayOnInstruction(uint8_t phrase_i
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.keep_to_stay_on_verbal_subset.Render(
+      phrase_id, {{kRelativeDirectionTag, relative_dir},
+                  {kStreetNamesTag, street_names},
+                  {kNumberSignTag, exit_number_sign},
+                  {kTowardSignTag, exit_toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2227,12 +2387,10 @@ std::string NarrativeBuilder::FormMergeInstruction(Maneuver& maneuver) {
     phrase_id += 2;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.merge_subset.Render(phrase_id, {{kRelativeDirectionTag, relative_direction},
+                                                  {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2286,12 +2444,10 @@ std::string NarrativeBuilder::FormVerbalMergeInstruction(Maneuver& maneuver,
     phrase_id += 2;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.merge_verbal_subset.Render(
+      phrase_id, {{kRelativeDirectionTag, relative_direction},
+                  {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2319,11 +2475,9 @@ std::string NarrativeBuilder::FormEnterRoundaboutInstruction(Maneuver& maneuver)
         dictionary_.enter_roundabout_subset.ordinal_values.at(maneuver.roundabout_exit_count() - 1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.enter_roundabout_subset.Render(phrase_id, {{kOrdinalValueTag, ordinal_value}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2353,11 +2507,9 @@ std::string NarrativeBuilder::FormVerbalAlertEnterRoundaboutInstruction(Maneuver
         maneuver.roundabout_exit_count() - 1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.enter_roundabout_verbal_subset.Render(
+      phrase_id, {{kOrdinalValueTag, ordinal_value}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2387,11 +2539,9 @@ std::string NarrativeBuilder::FormVerbalEnterRoundaboutInstruction(Maneuver& man
         maneuver.roundabout_exit_count() - 1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.enter_roundabout_verbal_subset.Render(
+      phrase_id, {{kOrdinalValueTag, ordinal_value}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2427,12 +2577,10 @@ std::string NarrativeBuilder::FormExitRoundaboutInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.exit_roundabout_subset.Render(
+      phrase_id, {{kStreetNamesTag, street_names},
+                  {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2472,12 +2620,10 @@ std::string NarrativeBuilder::FormVerbalExitRoundaboutInstruction(Maneuver& mane
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.exit_roundabout_verbal_subset.Render(
+      phrase_id, {{kStreetNamesTag, street_names},
+                  {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2511,12 +2657,9 @@ std::string NarrativeBuilder::FormEnterFerryInstruction(Maneuver& maneuver) {
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.enter_ferry_subset.Render(phrase_id, {{kStreetNamesTag, street_names},
+                                                                  {kFerryLabelTag, ferry_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2563,12 +2706,10 @@ std::string NarrativeBuilder::FormVerbalEnterFerryInstruction(Maneuver& maneuver
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.enter_ferry_verbal_subset.Render(phrase_id, {{kStreetNamesTag, street_names},
+                                                               {kFerryLabelTag, ferry_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2624,13 +2765,11 @@ std::string NarrativeBuilder::FormExitFerryInstruction(Maneuver& maneuver) {
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_ferry_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.exit_ferry_subset.Render(phrase_id, {{kCardinalDirectionTag, cardinal_direction},
+                                                       {kStreetNamesTag, street_names},
+                                                       {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2709,13 +2848,11 @@ std::string NarrativeBuilder::FormVerbalExitFerryInstruction(Maneuver& maneuver,
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_ferry_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.exit_ferry_verbal_subset.Render(
+      phrase_id, {{kCardinalDirectionTag, cardinal_direction},
+                  {kStreetNamesTag, street_names},
+                  {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2748,12 +2885,10 @@ std::string NarrativeBuilder::FormTransitConnectionStartInstruction(Maneuver& ma
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_start_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_connection_start_subset.Render(
+      phrase_id, {{kTransitPlatformTag, transit_stop},
+                  {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2786,13 +2921,10 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionStartInstruction(Maneuv
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_start_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_connection_start_verbal_subset.Render(
+      phrase_id, {{kTransitPlatformTag, transit_stop},
+                  {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2825,12 +2957,10 @@ std::string NarrativeBuilder::FormTransitConnectionTransferInstruction(Maneuver&
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_transfer_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_connection_transfer_subset.Render(
+      phrase_id, {{kTransitPlatformTag, transit_stop},
+                  {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2863,13 +2993,10 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionTransferInstruction(Man
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_connection_transfer_verbal_subset.Render(
+      phrase_id, {{kTransitPlatformTag, transit_stop},
+                  {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2902,13 +3029,10 @@ std::string NarrativeBuilder::FormTransitConnectionDestinationInstruction(Maneuv
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_destination_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_connection_destination_subset.Render(
+      phrase_id, {{kTransitPlatformTag, transit_stop},
+                  {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2941,13 +3065,10 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionDestinationInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_destination_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_connection_destination_verbal_subset.Render(
+      phrase_id, {{kTransitPlatformTag, transit_stop},
+                  {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2970,13 +3091,13 @@ std::string NarrativeBuilder::FormDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_subset.phrases.at(std::to_string(phrase_id));
+  const auto localized_time =
+      get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale());
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.depart_subset.Render(phrase_id, {{kTransitPlatformTag, transit_stop_name},
+                                                   {kTimeTag, localized_time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2999,13 +3120,13 @@ std::string NarrativeBuilder::FormVerbalDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto localized_time =
+      get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale());
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.depart_verbal_subset.Render(phrase_id, {{kTransitPlatformTag, transit_stop_name},
+                                                          {kTimeTag, localized_time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3028,13 +3149,13 @@ std::string NarrativeBuilder::FormArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_subset.phrases.at(std::to_string(phrase_id));
+  const auto localized_time =
+      get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale());
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.arrive_subset.Render(phrase_id, {{kTransitPlatformTag, transit_stop_name},
+                                                   {kTimeTag, localized_time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3057,13 +3178,13 @@ std::string NarrativeBuilder::FormVerbalArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto localized_time =
+      get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale());
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.arrive_verbal_subset.Render(phrase_id, {{kTransitPlatformTag, transit_stop_name},
+                                                          {kTimeTag, localized_time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3090,16 +3211,16 @@ std::string NarrativeBuilder::FormTransitInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_subset.phrases.at(std::to_string(phrase_id));
+  const auto transit_name = FormTransitName(maneuver,
+                                            dictionary_.transit_subset.empty_transit_name_labels);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_subset.Render(
+      phrase_id, {{kTransitNameTag, transit_name},
+                  {kTransitHeadSignTag, transit_headsign},
+                  // TODO: locale specific numerals
+                  {kTransitPlatformCountTag, std::to_string(stop_count)},
+                  {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3122,14 +3243,13 @@ std::string NarrativeBuilder::FormVerbalTransitInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto transit_name =
+      FormTransitName(maneuver, dictionary_.transit_verbal_subset.empty_transit_name_labels);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_verbal_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_verbal_subset.Render(
+      phrase_id, {{kTransitNameTag, transit_name},
+                  {kTransitHeadSignTag, transit_headsign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3157,17 +3277,16 @@ std::string NarrativeBuilder::FormTransitRemainOnInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_subset.phrases.at(std::to_string(phrase_id));
+  const auto transit_name =
+      FormTransitName(maneuver, dictionary_.transit_remain_on_subset.empty_transit_name_labels);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_remain_on_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_remain_on_subset.Render(
+      phrase_id, {{kTransitNameTag, transit_name},
+                  {kTransitHeadSignTag, transit_headsign},
+                  // TODO: locale specific numerals
+                  {kTransitPlatformCountTag, std::to_string(stop_count)},
+                  {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3190,14 +3309,14 @@ std::string NarrativeBuilder::FormVerbalTransitRemainOnInstruction(Maneuver& man
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto transit_name =
+      FormTransitName(maneuver,
+                      dictionary_.transit_remain_on_verbal_subset.empty_transit_name_labels);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_remain_on_verbal_subset
-                                                   .empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_remain_on_verbal_subset.Render(
+      phrase_id, {{kTransitNameTag, transit_name},
+                  {kTransitHeadSignTag, transit_headsign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3225,17 +3344,16 @@ std::string NarrativeBuilder::FormTransitTransferInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_subset.phrases.at(std::to_string(phrase_id));
+  const auto transit_name =
+      FormTransitName(maneuver, dictionary_.transit_transfer_subset.empty_transit_name_labels);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_transfer_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_transfer_subset.Render(
+      phrase_id, {{kTransitNameTag, transit_name},
+                  {kTransitHeadSignTag, transit_headsign},
+                  // TODO: locale specific numerals
+                  {kTransitPlatformCountTag, std::to_string(stop_count)},
+                  {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3258,14 +3376,14 @@ std::string NarrativeBuilder::FormVerbalTransitTransferInstruction(Maneuver& man
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto transit_name =
+      FormTransitName(maneuver,
+                      dictionary_.transit_transfer_verbal_subset.empty_transit_name_labels);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_transfer_verbal_subset
-                                                   .empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.transit_transfer_verbal_subset.Render(
+      phrase_id, {{kTransitNameTag, transit_name},
+                  {kTransitHeadSignTag, transit_headsign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3324,14 +3442,11 @@ std::string NarrativeBuilder::FormPostTransitConnectionDestinationInstruction(Ma
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.post_transit_connection_destination_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.post_transit_connection_destination_subset.Render(
+      phrase_id, {{kCardinalDirectionTag, cardinal_direction},
+                  {kStreetNamesTag, street_names},
+                  {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3395,14 +3510,11 @@ NarrativeBuilder::FormVerbalPostTransitConnectionDestinationInstruction(Maneuver
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transit_connection_destination_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.post_transit_connection_destination_verbal_subset.Render(
+      phrase_id, {{kCardinalDirectionTag, cardinal_direction},
+                  {kStreetNamesTag, street_names},
+                  {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3434,14 +3546,14 @@ std::string NarrativeBuilder::FormVerbalPostTransitionInstruction(Maneuver& mane
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transition_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto length = FormLength(maneuver,
+                                 dictionary_.post_transition_verbal_subset.metric_lengths,
+                                 dictionary_.post_transition_verbal_subset.us_customary_lengths);
 
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.post_transition_verbal_subset.metric_lengths,
-                                dictionary_.post_transition_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction = dictionary_.post_transition_verbal_subset.Render(
+      phrase_id, {{kLengthTag, length},
+                  {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3462,14 +3574,11 @@ std::string NarrativeBuilder::FormVerbalPostTransitionTransitInstruction(Maneuve
       FormTransitPlatformCountLabel(stop_count, dictionary_.post_transition_transit_verbal_subset
                                                     .transit_stop_count_labels);
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.post_transition_transit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+                  // TODO: locale specific numerals
+  instruction = dictionary_.post_transition_transit_verbal_subset.Render(
+      phrase_id, {{kTransitPlatformCountTag, std::to_string(stop_count)},
+                  {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3783,12 +3892,10 @@ std::string NarrativeBuilder::FormVerbalMultiCue(Maneuver* maneuver, Maneuver& n
                                     ? next_maneuver.verbal_transition_alert_instruction()
                                     : next_maneuver.verbal_pre_transition_instruction();
 
-  // Set instruction to the verbal multi-cue
-  instruction = dictionary_.verbal_multi_cue_subset.phrases.at("0");
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCurrentVerbalCueTag, current_verbal_cue);
-  boost::replace_all(instruction, kNextVerbalCueTag, next_verbal_cue);
+  // Set instruction to the determined tagged phrase with its tags replaced by values
+  instruction =
+      dictionary_.verbal_multi_cue_subset.Render(0, {{kCurrentVerbalCueTag, current_verbal_cue},
+                                                     {kNextVerbalCueTag, next_verbal_cue}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
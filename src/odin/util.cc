@@ -5,6 +5,7 @@
 #include <boost/algorithm/string/replace.hpp>
 
 #include <chrono>
+#include <mutex>
 #include <sstream>
 
 #include <date/date.h>
@@ -16,37 +17,28 @@
 
 namespace {
 
-valhalla::odin::locales_singleton_t load_narrative_locals() {
-  valhalla::odin::locales_singleton_t locales;
-  // for each locale
-  for (const auto& json : locales_json) {
-    LOG_TRACE("LOCALES");
-    LOG_TRACE("-------");
-    LOG_TRACE("- " + json.first);
-    // load the json
-    boost::property_tree::ptree narrative_pt;
-    std::stringstream ss;
-    ss << json.second;
-    rapidjson::read_json(ss, narrative_pt);
-    LOG_TRACE("JSON read");
-    // parse it into an object and add it to the map
-    auto narrative_dictionary =
-        std::make_shared<valhalla::odin::NarrativeDictionary>(json.first, narrative_pt);
-    LOG_TRACE("NarrativeDictionary created");
-    locales.insert(std::make_pair(json.first, narrative_dictionary));
-    // insert all the aliases as this same object
-    auto aliases = narrative_pt.get_child("aliases");
-    for (const auto& alias : aliases) {
-      auto name = alias.second.get_value<std::string>();
-      auto inserted = locales.insert(std::make_pair(name, narrative_dictionary));
-      if (!inserted.second) {
-        throw std::logic_error("Alias '" + name + "' in json locale '" + json.first +
-                               "' has duplicate with posix_locale '" +
-                               inserted.first->second->GetLocale().name());
-      }
-    }
+// Parses the locale of a language tag
+std::shared_ptr<valhalla::odin::NarrativeDictionary> load_narrative_locale(const std::string& tag) {
+  LOG_TRACE("LOCALE " + tag);
+  boost::property_tree::ptree narrative_pt;
+  std::stringstream ss;
+  ss << locales_json.find(tag)->second;
+  rapidjson::read_json(ss, narrative_pt);
+  LOG_TRACE("JSON read");
+  auto narrative_dictionary =
+      std::make_shared<valhalla::odin::NarrativeDictionary>(tag, narrative_pt);
+  LOG_TRACE("NarrativeDictionary created");
+  return narrative_dictionary;
+}
+
+// The language tag of a language tag or alias, the aliases are found when the locales are compiled
+const std::string* locale_tag(const std::string& language) {
+  auto json = locales_json.find(language);
+  if (json != locales_json.end()) {
+    return &json->first;
   }
-  return locales;
+  auto alias = locales_aliases.find(language);
+  return alias == locales_aliases.end() ? nullptr : &alias->second;
 }
 
 } // namespace
@@ -126,10 +118,40 @@ std::string get_localized_date(const std::string& date_time, const std::locale&
 
 const locales_singleton_t& get_locales() {
   // thread safe static initializer for singleton
-  static locales_singleton_t locales(load_narrative_locals());
+  static locales_singleton_t locales([]() {
+    locales_singleton_t all;
+    for (const auto& json : locales_json) {
+      all.emplace(json.first, get_locale(json.first));
+    }
+    for (const auto& alias : locales_aliases) {
+      all.emplace(alias.first, get_locale(alias.second));
+    }
+    return all;
+  }());
   return locales;
 }
 
+std::shared_ptr<NarrativeDictionary> get_locale(const std::string& language) {
+  const auto* tag = locale_tag(language);
+  if (tag == nullptr) {
+    return nullptr;
+  }
+
+  // Only the locales requests ask for are parsed, each once for the whole process
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<NarrativeDictionary>> loaded;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& dictionary = loaded[*tag];
+  if (!dictionary) {
+    dictionary = load_narrative_locale(*tag);
+  }
+  return dictionary;
+}
+
+bool has_locale(const std::string& language) {
+  return locale_tag(language) != nullptr;
+}
+
 const std::unordered_map<std::string, std::string>& get_locales_json() {
   return locales_json;
 }
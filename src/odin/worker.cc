@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <sstream>
@@ -26,7 +27,9 @@ using namespace valhalla::baldr;
 namespace valhalla {
 namespace odin {
 
-odin_worker_t::odin_worker_t(const boost::property_tree::ptree& config) {
+odin_worker_t::odin_worker_t(const boost::property_tree::ptree& config)
+    : narration_threads(config.get<uint32_t>("odin.narration_threads", 1)), metrics("odin"),
+      admission(config, "odin") {
 }
 
 odin_worker_t::~odin_worker_t() {
@@ -38,8 +41,10 @@ void odin_worker_t::cleanup() {
 void odin_worker_t::narrate(Api& request) const {
   // get some annotated directions
   try {
-    odin::DirectionsBuilder().Build(request);
-  } catch (...) { throw valhalla_exception_t{202}; }
+    odin::DirectionsBuilder().Build(request, narration_threads, interrupt);
+  } catch (const valhalla_exception_t&) { throw; } catch (...) {
+    throw valhalla_exception_t{202};
+  }
 }
 
 #ifdef HAVE_HTTP
@@ -47,22 +52,29 @@ prime_server::worker_t::result_t
 odin_worker_t::work(const std::list<zmq::message_t>& job,
                     void* request_info,
                     const std::function<void()>& interrupt_function) {
+  auto s = std::chrono::steady_clock::now();
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Odin Request " + std::to_string(info.id));
-  Api request;
+  Api& request = new_request();
   try {
     // Set the interrupt function
     service_worker_t::set_interrupt(interrupt_function);
 
     // crack open the in progress request
     request.ParseFromArray(job.front().data(), job.front().size());
+    metrics.queue_wait(request);
+    service_worker_t::set_deadline(request.options().deadline());
+    auto ticket = admission.admit(request, *interrupt);
 
-    // narrate them and serialize them along
+    // narrate them and serialize them along, unless the client stopped waiting meanwhile
     narrate(request);
+    (*interrupt)();
     auto response = tyr::serializeDirections(request);
-    auto* to_response =
-        request.options().format() == Options::gpx ? to_response_xml : to_response_json;
+    metrics.request(request,
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - s).count());
     return to_response(response, info, request);
+  } catch (const valhalla_exception_t& e) {
+    return jsonify_error(e, info, request);
   } catch (const std::exception& e) {
     return jsonify_error({299, std::string(e.what())}, info, request);
   }
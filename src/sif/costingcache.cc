@@ -0,0 +1,50 @@
+#include "sif/costingcache.h"
+
+namespace valhalla {
+namespace sif {
+
+CostingCache::CostingCache(const size_t max_costings) : max_costings_(max_costings) {
+}
+
+size_t CostingCache::size() const {
+  return costings_.size();
+}
+
+void CostingCache::Clear() {
+  costings_.clear();
+}
+
+// The costings read their own costing options and the edges to avoid, nothing else. The masks of
+// the avoid polygons follow from the polygons
+std::string CostingCache::Key(const Costing costing, const Options& options) {
+  std::string key = std::to_string(static_cast<int>(costing));
+  key.push_back(':');
+  if (static_cast<int>(costing) < options.costing_options_size()) {
+    auto costing_options = options.costing_options(static_cast<int>(costing)).SerializeAsString();
+    key += std::to_string(costing_options.size());
+    key.push_back(':');
+    key += costing_options;
+  }
+  for (const auto& edge : options.avoid_edges()) {
+    uint64_t id = edge.id();
+    float percent_along = edge.percent_along();
+    key.append(reinterpret_cast<const char*>(&id), sizeof(id));
+    key.append(reinterpret_cast<const char*>(&percent_along), sizeof(percent_along));
+  }
+  for (const auto& polygon : options.avoid_polygons()) {
+    auto serialized = polygon.SerializeAsString();
+    key += std::to_string(serialized.size());
+    key.push_back(':');
+    key += serialized;
+  }
+  return key;
+}
+
+void CostingCache::Reset(entry_t& entry) {
+  entry.costing->set_pass(0);
+  entry.costing->set_allow_destination_only(true);
+  entry.costing->GetHierarchyLimits() = entry.hierarchy_limits;
+}
+
+} // namespace sif
+} // namespace valhalla
@@ -40,7 +40,7 @@ namespace sif {
 
 DynamicCost::DynamicCost(const Options& options, const TravelMode mode)
     : pass_(0), allow_transit_connections_(false), allow_destination_only_(true), travel_mode_(mode),
-      flow_mask_(kDefaultFlowMask) {
+      flow_mask_(kDefaultFlowMask), costing_hash_(0) {
   // Parse property tree to get hierarchy limits
   // TODO - get the number of levels
   uint32_t n_levels = sizeof(kDefaultMaxUpTransitions) / sizeof(kDefaultMaxUpTransitions[0]);
@@ -52,6 +52,11 @@ DynamicCost::DynamicCost(const Options& options, const TravelMode mode)
   for (auto& edge : options.avoid_edges()) {
     user_avoid_edges_.insert({GraphId(edge.id()), edge.percent_along()});
   }
+
+  // And the masks of the tiles under avoid polygons
+  for (const auto& mask : options.avoid_masks()) {
+    user_avoid_masks_[GraphId(mask.tile_id())].assign(mask.edges().begin(), mask.edges().end());
+  }
 }
 
 DynamicCost::~DynamicCost() {
@@ -69,9 +74,33 @@ bool DynamicCost::AllowMultiPass() const {
 // with a time that tells the function that we aren't using time. This avoids having to worry about
 // default parameters and inheritance (which are a bad mix)
 Cost DynamicCost::EdgeCost(const baldr::DirectedEdge* edge, const baldr::GraphTile* tile) const {
+  if (CacheEdgeCosts(tile)) {
+    return edge_cost_cache_->Get(costing_hash_, tile, edge, [this, edge, tile]() {
+      return EdgeCost(edge, tile, kInvalidSecondsOfWeek);
+    });
+  }
   return EdgeCost(edge, tile, kInvalidSecondsOfWeek);
 }
 
+// Without a time the cost of an edge only depends on the options so it can be cached
+void DynamicCost::set_edge_cost_cache(const std::shared_ptr<EdgeCostCache>& cache,
+                                      const uint64_t costing_hash) {
+  edge_cost_cache_ = cache;
+  costing_hash_ = costing_hash;
+}
+
+// Checks which outbound edges of a node are allowed and gets their costs through the vtable.
+// Costings that know their own type override this to call their methods non virtually.
+void DynamicCost::GetAllowedEdges(const DirectedEdge* edges,
+                                  const uint32_t count,
+                                  const GraphId& edgeid,
+                                  const EdgeLabel& pred,
+                                  const GraphTile*& tile,
+                                  const uint32_t seconds,
+                                  AllowedEdges& allowed) const {
+  FillAllowedEdges<DynamicCost>(edges, count, edgeid, pred, tile, seconds, allowed);
+}
+
 // Returns the cost to make the transition from the predecessor edge.
 // Defaults to 0. Costing models that wish to include edge transition
 // costs (i.e., intersection/turn costs) must override this method.
@@ -0,0 +1,113 @@
+#include "sif/edgecostcache.h"
+
+#include <functional>
+#include <string>
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace sif {
+
+constexpr uint64_t EdgeCostCache::kEmpty;
+thread_local EdgeCostCache::last_t EdgeCostCache::last_;
+
+EdgeCostCache::table_t::table_t(const size_t count) : costs(count) {
+  for (auto& cost : costs) {
+    cost.store(kEmpty, std::memory_order_relaxed);
+  }
+}
+
+EdgeCostCache::EdgeCostCache(const size_t max_edges) : max_edges_(max_edges), edges_(0) {
+}
+
+size_t EdgeCostCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return edges_;
+}
+
+void EdgeCostCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tables_.clear();
+  edges_ = 0;
+}
+
+uint64_t EdgeCostCache::Hash(const Costing costing, const Options& options) {
+  std::string key = std::to_string(static_cast<int>(costing));
+  if (static_cast<int>(costing) < options.costing_options_size()) {
+    key += options.costing_options(static_cast<int>(costing)).SerializeAsString();
+  }
+  return std::hash<std::string>()(key);
+}
+
+std::shared_ptr<EdgeCostCache> EdgeCostCache::Global(const size_t max_edges) {
+  static std::mutex global_mutex;
+  static std::shared_ptr<EdgeCostCache> global_cache;
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (!global_cache && max_edges > 0) {
+    global_cache = std::make_shared<EdgeCostCache>(max_edges);
+  }
+  return max_edges > 0 ? global_cache : nullptr;
+}
+
+std::atomic<uint64_t>* EdgeCostCache::Slot(const uint64_t costing_hash,
+                                           const GraphTile* tile,
+                                           const DirectedEdge* edge) {
+  // some callers cost an edge with the tile of the edge before it, only cache the edges we
+  // can find in the tile we were given
+  size_t count = tile->header()->directededgecount();
+  if (count == 0) {
+    return nullptr;
+  }
+  auto first = reinterpret_cast<uintptr_t>(tile->directededge(size_t(0)));
+  auto address = reinterpret_cast<uintptr_t>(edge);
+  if (address < first || address >= first + count * sizeof(DirectedEdge)) {
+    return nullptr;
+  }
+  size_t index = (address - first) / sizeof(DirectedEdge);
+
+  // find the table unless its the one this thread used last
+  uint64_t tile_id = tile->header()->graphid().value;
+  if (last_.cache != this || last_.costing_hash != costing_hash || last_.tile_id != tile_id ||
+      !last_.table) {
+    auto table = Table(costing_hash, tile_id, count);
+    if (!table) {
+      return nullptr;
+    }
+    last_.cache = this;
+    last_.costing_hash = costing_hash;
+    last_.tile_id = tile_id;
+    last_.table = std::move(table);
+  }
+
+  // the tile could have been reloaded with more edges since the table was made
+  if (index >= last_.table->costs.size()) {
+    return nullptr;
+  }
+  return &last_.table->costs[index];
+}
+
+std::shared_ptr<EdgeCostCache::table_t>
+EdgeCostCache::Table(const uint64_t costing_hash, const uint64_t tile_id, const size_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto key = std::make_pair(costing_hash, tile_id);
+  auto found = tables_.find(key);
+  if (found != tables_.cend()) {
+    return found->second;
+  }
+
+  // start over when its full, the threads still using a dropped table keep it until they move on
+  if (count > max_edges_) {
+    return nullptr;
+  }
+  if (edges_ + count > max_edges_) {
+    tables_.clear();
+    edges_ = 0;
+  }
+  auto table = std::make_shared<table_t>(count);
+  tables_.emplace(key, table);
+  edges_ += count;
+  return table;
+}
+
+} // namespace sif
+} // namespace valhalla
@@ -1,7 +1,65 @@
 #include "sif/hierarchylimits.h"
 
+#include <algorithm>
+#include <stdexcept>
+
+using namespace valhalla::midgard;
 using namespace valhalla::sif;
 
 bool HierarchyLimits::StopExpanding(const float dist) const {
   return (dist > expansion_within_dist && up_transition_count > max_up_transitions);
 }
+
+TunedHierarchyLimits::TunedHierarchyLimits(const boost::property_tree::ptree& pt) {
+  for (const auto& costing : pt) {
+    for (const auto& entry : costing.second) {
+      region_t region{costing.first, true, {}, {}, {}};
+      if (auto bbox = entry.second.get_child_optional("bbox")) {
+        std::vector<double> corners;
+        for (const auto& corner : *bbox) {
+          corners.push_back(corner.second.get_value<double>());
+        }
+        if (corners.size() != 4) {
+          throw std::runtime_error("The bbox of hierarchy limits for " + costing.first +
+                                   " needs min_lon, min_lat, max_lon and max_lat");
+        }
+        region.everywhere = false;
+        region.bbox = AABB2<PointLL>(corners[0], corners[1], corners[2], corners[3]);
+      }
+      if (auto levels = entry.second.get_child_optional("max_up_transitions")) {
+        for (const auto& level : *levels) {
+          region.max_up_transitions.push_back(level.second.get_value<uint32_t>());
+        }
+      }
+      if (auto levels = entry.second.get_child_optional("expansion_within_dist")) {
+        for (const auto& level : *levels) {
+          region.expansion_within_dist.push_back(level.second.get_value<float>());
+        }
+      }
+      regions_.push_back(std::move(region));
+    }
+  }
+}
+
+bool TunedHierarchyLimits::Apply(const std::string& costing,
+                                 const std::vector<PointLL>& locations,
+                                 std::vector<HierarchyLimits>& limits) const {
+  for (const auto& region : regions_) {
+    if (region.costing != costing ||
+        (!region.everywhere &&
+         !std::all_of(locations.begin(), locations.end(),
+                      [&region](const PointLL& ll) { return region.bbox.Contains(ll); }))) {
+      continue;
+    }
+    for (size_t level = 0; level < limits.size(); ++level) {
+      if (level < region.max_up_transitions.size()) {
+        limits[level].max_up_transitions = region.max_up_transitions[level];
+      }
+      if (level < region.expansion_within_dist.size()) {
+        limits[level].expansion_within_dist = region.expansion_within_dist[level];
+      }
+    }
+    return true;
+  }
+  return false;
+}
@@ -7,6 +7,9 @@
 #include "midgard/constants.h"
 #include "midgard/util.h"
 
+#include <algorithm>
+#include <cmath>
+
 #ifdef INLINE_TEST
 #include "test/test.h"
 #include "worker.h"
@@ -38,16 +41,6 @@ constexpr float kDefaultCountryCrossingPenalty = 0.0f;   // Seconds
 constexpr float kDefaultLowClassPenalty = 30.0f; // Seconds
 constexpr float kDefaultUseTolls = 0.5f;         // Factor between 0 and 1
 
-// Default turn costs
-constexpr float kTCStraight = 0.5f;
-constexpr float kTCSlight = 0.75f;
-constexpr float kTCFavorable = 1.0f;
-constexpr float kTCFavorableSharp = 1.5f;
-constexpr float kTCCrossing = 2.0f;
-constexpr float kTCUnfavorable = 2.5f;
-constexpr float kTCUnfavorableSharp = 3.5f;
-constexpr float kTCReverse = 5.0f;
-
 // Default truck attributes
 constexpr float kDefaultTruckWeight = 21.77f;  // Metric Tons (48,000 lbs)
 constexpr float kDefaultTruckAxleLoad = 9.07f; // Metric Tons (20,000 lbs)
@@ -55,17 +48,6 @@ constexpr float kDefaultTruckHeight = 4.11f;   // Meters (13 feet 6 inches)
 constexpr float kDefaultTruckWidth = 2.6f;     // Meters (102.36 inches)
 constexpr float kDefaultTruckLength = 21.64f;  // Meters (71 feet)
 
-// Turn costs based on side of street driving
-constexpr float kRightSideTurnCosts[] = {kTCStraight,       kTCSlight,  kTCFavorable,
-                                         kTCFavorableSharp, kTCReverse, kTCUnfavorableSharp,
-                                         kTCUnfavorable,    kTCSlight};
-constexpr float kLeftSideTurnCosts[] = {kTCStraight,         kTCSlight,  kTCUnfavorable,
-                                        kTCUnfavorableSharp, kTCReverse, kTCFavorableSharp,
-                                        kTCFavorable,        kTCSlight};
-
-// How much to favor truck routes.
-constexpr float kTruckRouteFactor = 0.85f;
-
 // Weighting factor based on road class. These apply penalties to lower class
 // roads.
 constexpr float kRoadClassFactor[] = {
@@ -100,220 +82,24 @@ constexpr ranged_default_t<float> kTruckWidthRange{0, kDefaultTruckWidth, 10.0f}
 constexpr ranged_default_t<float> kTruckLengthRange{0, kDefaultTruckLength, 50.0f};
 constexpr ranged_default_t<float> kUseTollsRange{0, kDefaultUseTolls, 1.0f};
 
-} // namespace
-
-/**
- * Derived class providing dynamic edge costing for truck routes.
- */
-class TruckCost : public DynamicCost {
-public:
-  /**
-   * Construct truck costing. Pass in cost type and options using protocol buffer(pbf).
-   * @param  costing specified costing type.
-   * @param  options pbf with request options.
-   */
-  TruckCost(const Costing costing, const Options& options);
-
-  virtual ~TruckCost();
-
-  /**
-   * Does the costing allow hierarchy transitions. Truck costing will allow
-   * transitions by default.
-   * @return  Returns true if the costing model allows hierarchy transitions).
-   */
-  virtual bool AllowTransitions() const;
-
-  /**
-   * Does the costing method allow multiple passes (with relaxed hierarchy
-   * limits).
-   * @return  Returns true if the costing model allows multiple passes.
-   */
-  virtual bool AllowMultiPass() const;
-
-  /**
-   * Get the access mode used by this costing method.
-   * @return  Returns access mode.
-   */
-  uint32_t access_mode() const;
-
-  /**
-   * Checks if access is allowed for the provided directed edge.
-   * This is generally based on mode of travel and the access modes
-   * allowed on the edge. However, it can be extended to exclude access
-   * based on other parameters such as conditional restrictions and
-   * conditional access that can depend on time and travel mode.
-   * @param  edge           Pointer to a directed edge.
-   * @param  pred           Predecessor edge information.
-   * @param  tile           Current tile.
-   * @param  edgeid         GraphId of the directed edge.
-   * @param  current_time   Current time (seconds since epoch). A value of 0
-   *                        indicates the route is not time dependent.
-   * @param  tz_index       timezone index for the node
-   * @return Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::DirectedEdge* edge,
-                       const EdgeLabel& pred,
-                       const baldr::GraphTile*& tile,
-                       const baldr::GraphId& edgeid,
-                       const uint64_t current_time,
-                       const uint32_t tz_index,
-                       bool& time_restricted) const;
-
-  /**
-   * Checks if access is allowed for an edge on the reverse path
-   * (from destination towards origin). Both opposing edges (current and
-   * predecessor) are provided. The access check is generally based on mode
-   * of travel and the access modes allowed on the edge. However, it can be
-   * extended to exclude access based on other parameters such as conditional
-   * restrictions and conditional access that can depend on time and travel
-   * mode.
-   * @param  edge           Pointer to a directed edge.
-   * @param  pred           Predecessor edge information.
-   * @param  opp_edge       Pointer to the opposing directed edge.
-   * @param  tile           Current tile.
-   * @param  edgeid         GraphId of the opposing edge.
-   * @param  current_time   Current time (seconds since epoch). A value of 0
-   *                        indicates the route is not time dependent.
-   * @param  tz_index       timezone index for the node
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool AllowedReverse(const baldr::DirectedEdge* edge,
-                              const EdgeLabel& pred,
-                              const baldr::DirectedEdge* opp_edge,
-                              const baldr::GraphTile*& tile,
-                              const baldr::GraphId& opp_edgeid,
-                              const uint64_t current_time,
-                              const uint32_t tz_index,
-                              bool& has_time_restrictions) const;
-
-  /**
-   * Checks if access is allowed for the provided node. Node access can
-   * be restricted if bollards or gates are present.
-   * @param  node  Pointer to node information.
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::NodeInfo* node) const;
-
-  /**
-   * Callback for Allowed doing mode  specific restriction checks
-   */
-  virtual bool ModeSpecificAllowed(const baldr::AccessRestriction& restriction) const;
-
-  /**
-   * Only transit costings are valid for this method call, hence we throw
-   * @param edge
-   * @param departure
-   * @param curr_time
-   * @return
-   */
-  virtual Cost EdgeCost(const baldr::DirectedEdge* edge,
-                        const baldr::TransitDeparture* departure,
-                        const uint32_t curr_time) const {
-    throw std::runtime_error("TruckCost::EdgeCost does not support transit edges");
+// The smallest restriction value, in hundredths, that a vehicle of the given size is not above.
+// Matches comparing the size to the value scaled down to a float so no edge changes its access
+uint64_t min_fitting(const float size) {
+  auto value = static_cast<uint64_t>(std::max(0.0f, std::floor(size * 100.0f)));
+  while (value > 0 && size <= static_cast<float>((value - 1) * 0.01)) {
+    --value;
   }
-
-  /**
-   * Get the cost to traverse the specified directed edge. Cost includes
-   * the time (seconds) to traverse the edge.
-   * @param  edge      Pointer to a directed edge.
-   * @param  tile      Current tile.
-   * @param  seconds   Time of week in seconds.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost EdgeCost(const baldr::DirectedEdge* edge,
-                        const baldr::GraphTile* tile,
-                        const uint32_t seconds) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge.
-   * Defaults to 0. Costing models that wish to include edge transition
-   * costs (i.e., intersection/turn costs) must override this method.
-   * @param  edge  Directed edge (the to edge)
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  Predecessor edge information.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
-                              const baldr::NodeInfo* node,
-                              const EdgeLabel& pred) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge
-   * when using a reverse search (from destination towards the origin).
-   * @param  idx   Directed edge local index
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  the opposing current edge in the reverse tree.
-   * @param  edge  the opposing predecessor in the reverse tree
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCostReverse(const uint32_t idx,
-                                     const baldr::NodeInfo* node,
-                                     const baldr::DirectedEdge* pred,
-                                     const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Get the cost factor for A* heuristics. This factor is multiplied
-   * with the distance to the destination to produce an estimate of the
-   * minimum cost to the destination. The A* heuristic must underestimate the
-   * cost to the destination. So a time based estimate based on speed should
-   * assume the maximum speed is used to the destination such that the time
-   * estimate is less than the least possible time along roads.
-   */
-  virtual float AStarCostFactor() const;
-
-  /**
-   * Get the current travel type.
-   * @return  Returns the current travel type.
-   */
-  virtual uint8_t travel_type() const;
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude and allow ranking results from the search by looking at each
-   * edges attribution and suitability for use as a location by the travel
-   * mode used by the costing method. Function/functor is also used to filter
-   * edges not usable / inaccessible by truck.
-   */
-  virtual const EdgeFilter GetEdgeFilter() const {
-    // Throw back a lambda that checks the access for this type of costing
-    return [](const baldr::DirectedEdge* edge) {
-      if (edge->is_shortcut() || !(edge->forwardaccess() & kTruckAccess)) {
-        return 0.0f;
-      } else {
-        // TODO - use classification/use to alter the factor
-        return 1.0f;
-      }
-    };
+  while (size > static_cast<float>(value * 0.01)) {
+    ++value;
   }
+  return value;
+}
 
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude results from the search by looking at each node's attribution
-   * @return Function/functor to be used in filtering out nodes
-   */
-  virtual const NodeFilter GetNodeFilter() const {
-    // throw back a lambda that checks the access for this type of costing
-    return [](const baldr::NodeInfo* node) { return !(node->access() & kTruckAccess); };
-  }
+} // namespace
 
-public:
-  VehicleType type_; // Vehicle type: tractor trailer
-  float speedfactor_[kMaxSpeedKph + 1];
-  float density_factor_[16]; // Density factor
-  float toll_factor_;        // Factor applied when road has a toll
-  float low_class_penalty_;  // Penalty (seconds) to go to residential or service road
-
-  // Vehicle attributes (used for special restrictions and costing)
-  bool hazmat_;     // Carrying hazardous materials
-  float weight_;    // Vehicle weight in metric tons
-  float axle_load_; // Axle load weight in metric tons
-  float height_;    // Vehicle height in meters
-  float width_;     // Vehicle width in meters
-  float length_;    // Vehicle length in meters
-
-  // Density factor used in edge transition costing
-  std::vector<float> trans_density_factor_;
-};
+// The tables of the inline costing methods need a definition until we use C++17
+constexpr float TruckCost::kRightSideTurnCosts[];
+constexpr float TruckCost::kLeftSideTurnCosts[];
 
 // Constructor
 TruckCost::TruckCost(const Costing costing, const Options& options)
@@ -340,6 +126,14 @@ TruckCost::TruckCost(const Costing costing, const Options& options)
   width_ = costing_options.width();
   length_ = costing_options.length();
 
+  // Dimension restrictions are checked against these so an edge only costs an integer compare
+  min_fitting_.fill(0);
+  min_fitting_[static_cast<size_t>(AccessType::kMaxHeight)] = min_fitting(height_);
+  min_fitting_[static_cast<size_t>(AccessType::kMaxWidth)] = min_fitting(width_);
+  min_fitting_[static_cast<size_t>(AccessType::kMaxLength)] = min_fitting(length_);
+  min_fitting_[static_cast<size_t>(AccessType::kMaxWeight)] = min_fitting(weight_);
+  min_fitting_[static_cast<size_t>(AccessType::kMaxAxleLoad)] = min_fitting(axle_load_);
+
   // Create speed cost table
   speedfactor_[0] = kSecPerHour; // TODO - what to make speed=0?
   for (uint32_t s = 1; s <= kMaxSpeedKph; s++) {
@@ -382,205 +176,16 @@ uint32_t TruckCost::access_mode() const {
 bool TruckCost::ModeSpecificAllowed(const baldr::AccessRestriction& restriction) const {
   switch (restriction.type()) {
     case AccessType::kHazmat:
-      if (hazmat_ != restriction.value()) {
-        return false;
-      }
-      break;
-    case AccessType::kMaxAxleLoad:
-      if (axle_load_ > static_cast<float>(restriction.value() * 0.01)) {
-        return false;
-      }
-      break;
+      return hazmat_ == restriction.value();
     case AccessType::kMaxHeight:
-      if (height_ > static_cast<float>(restriction.value() * 0.01)) {
-        return false;
-      }
-      break;
+    case AccessType::kMaxWidth:
     case AccessType::kMaxLength:
-      if (length_ > static_cast<float>(restriction.value() * 0.01)) {
-        return false;
-      }
-      break;
     case AccessType::kMaxWeight:
-      if (weight_ > static_cast<float>(restriction.value() * 0.01)) {
-        return false;
-      }
-      break;
-    case AccessType::kMaxWidth:
-      if (width_ > static_cast<float>(restriction.value() * 0.01)) {
-        return false;
-      }
-      break;
+    case AccessType::kMaxAxleLoad:
+      return restriction.value() >= min_fitting_[static_cast<size_t>(restriction.type())];
     default:
       return true;
   };
-  return true;
-}
-
-// Check if access is allowed on the specified edge.
-inline bool TruckCost::Allowed(const baldr::DirectedEdge* edge,
-                               const EdgeLabel& pred,
-                               const baldr::GraphTile*& tile,
-                               const baldr::GraphId& edgeid,
-                               const uint64_t current_time,
-                               const uint32_t tz_index,
-                               bool& has_time_restrictions) const {
-  // Check access, U-turn, and simple turn restriction.
-  // TODO - perhaps allow U-turns at dead-end nodes?
-  if (!(edge->forwardaccess() & kTruckAccess) || (pred.opp_local_idx() == edge->localedgeidx()) ||
-      (pred.restrictions() & (1 << edge->localedgeidx())) ||
-      edge->surface() == Surface::kImpassable || IsUserAvoidEdge(edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && edge->destonly())) {
-    return false;
-  }
-
-  return DynamicCost::EvaluateRestrictions(kTruckAccess, edge, tile, edgeid, current_time, tz_index,
-                                           has_time_restrictions);
-}
-
-// Checks if access is allowed for an edge on the reverse path (from
-// destination towards origin). Both opposing edges are provided.
-bool TruckCost::AllowedReverse(const baldr::DirectedEdge* edge,
-                               const EdgeLabel& pred,
-                               const baldr::DirectedEdge* opp_edge,
-                               const baldr::GraphTile*& tile,
-                               const baldr::GraphId& opp_edgeid,
-                               const uint64_t current_time,
-                               const uint32_t tz_index,
-                               bool& has_time_restrictions) const {
-  // Check access, U-turn, and simple turn restriction.
-  // TODO - perhaps allow U-turns at dead-end nodes?
-  if (!(opp_edge->forwardaccess() & kTruckAccess) || (pred.opp_local_idx() == edge->localedgeidx()) ||
-      (opp_edge->restrictions() & (1 << pred.opp_local_idx())) ||
-      opp_edge->surface() == Surface::kImpassable || IsUserAvoidEdge(opp_edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly())) {
-    return false;
-  }
-
-  return DynamicCost::EvaluateRestrictions(kTruckAccess, edge, tile, opp_edgeid, current_time,
-                                           tz_index, has_time_restrictions);
-}
-
-// Check if access is allowed at the specified node.
-bool TruckCost::Allowed(const baldr::NodeInfo* node) const {
-  return (node->access() & kTruckAccess);
-}
-
-// Get the cost to traverse the edge in seconds
-Cost TruckCost::EdgeCost(const baldr::DirectedEdge* edge,
-                         const baldr::GraphTile* tile,
-                         const uint32_t seconds) const {
-  auto speed = tile->GetSpeed(edge, flow_mask_, seconds);
-  float factor = density_factor_[edge->density()];
-  if (edge->truck_route() > 0) {
-    factor *= kTruckRouteFactor;
-  }
-
-  if (edge->toll()) {
-    factor += toll_factor_;
-  }
-
-  // Use the lower or truck speed (ir present) and speed
-  uint32_t s = (edge->truck_speed() > 0) ? std::min(edge->truck_speed(), speed) : speed;
-  float sec = edge->length() * speedfactor_[s];
-  return {sec * factor, sec};
-}
-
-// Returns the time (in seconds) to make the transition from the predecessor
-Cost TruckCost::TransitionCost(const baldr::DirectedEdge* edge,
-                               const baldr::NodeInfo* node,
-                               const EdgeLabel& pred) const {
-  // Get the transition cost for country crossing, ferry, gate, toll booth,
-  // destination only, alley, maneuver penalty
-  uint32_t idx = pred.opp_local_idx();
-  Cost c = base_transition_cost(node, edge, pred, idx);
-
-  // Penalty to transition onto low class roads.
-  if (edge->classification() == RoadClass::kResidential ||
-      edge->classification() == RoadClass::kServiceOther) {
-    c.cost += low_class_penalty_;
-  }
-
-  // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (node->drive_on_right())
-                      ? kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))]
-                      : kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-
-    if ((edge->use() != Use::kRamp && pred.use() == Use::kRamp) ||
-        (edge->use() == Use::kRamp && pred.use() != Use::kRamp)) {
-      turn_cost += 1.5f;
-      if (edge->roundabout())
-        turn_cost += 0.5f;
-    }
-
-    // Separate time and penalty when traffic is present. With traffic, edge speeds account for
-    // much of the intersection transition time (TODO - evaluate different elapsed time settings).
-    // Still want to add a penalty so routes avoid high cost intersections.
-    float seconds = turn_cost * edge->stopimpact(idx);
-    // Apply density factor penality if there isnt traffic on this edge or youre not using traffic
-    if (!edge->has_flow_speed() || flow_mask_ == 0)
-      seconds *= trans_density_factor_[node->density()];
-
-    c.cost += seconds;
-    c.secs += seconds;
-  }
-  return c;
-}
-
-// Returns the cost to make the transition from the predecessor edge
-// when using a reverse search (from destination towards the origin).
-// pred is the opposing current edge in the reverse tree
-// edge is the opposing predecessor in the reverse tree
-Cost TruckCost::TransitionCostReverse(const uint32_t idx,
-                                      const baldr::NodeInfo* node,
-                                      const baldr::DirectedEdge* pred,
-                                      const baldr::DirectedEdge* edge) const {
-  // Get the transition cost for country crossing, ferry, gate, toll booth,
-  // destination only, alley, maneuver penalty
-  Cost c = base_transition_cost(node, edge, pred, idx);
-
-  // Penalty to transition onto low class roads.
-  if (edge->classification() == RoadClass::kResidential ||
-      edge->classification() == RoadClass::kServiceOther) {
-    c.cost += low_class_penalty_;
-  }
-
-  // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (node->drive_on_right())
-                      ? kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))]
-                      : kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-
-    if ((edge->use() != Use::kRamp && pred->use() == Use::kRamp) ||
-        (edge->use() == Use::kRamp && pred->use() != Use::kRamp)) {
-      turn_cost += 1.5f;
-      if (edge->roundabout())
-        turn_cost += 0.5f;
-    }
-
-    // Separate time and penalty when traffic is present. With traffic, edge speeds account for
-    // much of the intersection transition time (TODO - evaluate different elapsed time settings).
-    // Still want to add a penalty so routes avoid high cost intersections.
-    float seconds = turn_cost * edge->stopimpact(idx);
-    // Apply density factor penality if there isnt traffic on this edge or youre not using traffic
-    if (!edge->has_flow_speed() || flow_mask_ == 0)
-      seconds *= trans_density_factor_[node->density()];
-
-    c.cost += seconds;
-    c.secs += seconds;
-  }
-  return c;
 }
 
 // Get the cost factor for A* heuristics. This factor is multiplied
@@ -744,6 +349,25 @@ public:
   using TruckCost::toll_booth_cost_;
 };
 
+void testDimensionRestrictions() {
+  // The precomputed limits agree with comparing to the scaled down value
+  for (float height : {0.0f, 2.5f, 3.99f, 4.0f, 4.01f, 4.11f, 4.115f, 7.3f}) {
+    Api request;
+    ParseApi(R"({"costing_options":{"truck":{"height":)" + std::to_string(height) + "}}}",
+             valhalla::Options::route, request);
+    TestTruckCost cost(valhalla::Costing::truck, request.options());
+    float parsed = request.options().costing_options(valhalla::Costing::truck).height();
+    for (uint64_t value = 0; value < 1000; ++value) {
+      AccessRestriction restriction(0, AccessType::kMaxHeight, kTruckAccess, value);
+      bool expected = !(parsed > static_cast<float>(value * 0.01));
+      if (cost.ModeSpecificAllowed(restriction) != expected) {
+        throw std::runtime_error("Height restriction of " + std::to_string(value) +
+                                 " disagrees for a truck of height " + std::to_string(parsed));
+      }
+    }
+  }
+}
+
 TestTruckCost* make_truckcost_from_json(const std::string& property, float testVal) {
   std::stringstream ss;
   ss << R"({"costing_options":{"truck":{")" << property << R"(":)" << testVal << "}}}";
@@ -921,6 +545,8 @@ int main() {
 
   suite.test(TEST_CASE(testTruckCostParams));
 
+  suite.test(TEST_CASE(testDimensionRestrictions));
+
   return suite.tear_down();
 }
 
@@ -1,14 +1,20 @@
 #include "skadi/sample.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstdio>
 #include <fstream>
+#include <future>
 #include <limits>
 #include <list>
+#include <mutex>
 #include <regex>
+#include <type_traits>
 #include <stdexcept>
 #include <string>
 #include <sys/stat.h>
+#include <unordered_map>
 
 #include <boost/optional.hpp>
 
@@ -101,103 +107,20 @@ uint64_t file_size(const std::string& file_name) {
   return rc == 0 ? s.st_size : -1;
 }
 
-} // namespace
-
-namespace valhalla {
-namespace skadi {
-
-::valhalla::skadi::sample::sample(const std::string& data_source)
-    : mapped_cache(TILE_COUNT), unzipped_cache(-1, std::vector<int16_t>(HGT_PIXELS)),
-      data_source(data_source) {
-  // messy but needed
-  while (this->data_source.size() &&
-         this->data_source.back() == filesystem::path::preferred_separator) {
-    this->data_source.pop_back();
-  }
-
-  // check the directory for files that look like what we need
-  auto files = get_files(data_source);
-  for (const auto& f : files) {
-    // make sure its a valid index
-    format_t format = format_t::UNKNOWN;
-    auto index = is_hgt(f, format);
-    if (index < mapped_cache.size() && format != format_t::UNKNOWN) {
-      auto size = file_size(f);
-      if (format == format_t::RAW && size != HGT_BYTES) {
-        LOG_WARN("Corrupt elevation data: " + f);
-        continue;
-      }
-      mapped_cache[index].first = format;
-      mapped_cache[index].second.map(f, size, POSIX_MADV_SEQUENTIAL);
-    }
-  }
-}
-
-const int16_t* sample::source(uint16_t index) const {
-  // bail if its out of bounds
-  if (index >= TILE_COUNT) {
-    return nullptr;
-  }
-
-  // if we dont have anything maybe its lazy loaded
-  auto& mapped = mapped_cache[index];
-  if (mapped.second.get() == nullptr) {
-    auto f = data_source + name_hgt(index);
-    auto size = file_size(f);
-    if (size != HGT_BYTES) {
-      return nullptr;
-    }
-    mapped.first = format_t::RAW;
-    mapped.second.map(f, size, POSIX_MADV_SEQUENTIAL);
-  }
-
-  // we have it raw or we dont
-  if (mapped.first == format_t::RAW) {
-    return static_cast<const int16_t*>(static_cast<const void*>(mapped.second.get()));
-  }
-
-  // if we have it already unzipped
-  if (unzipped_cache.first == index) {
-    return unzipped_cache.second.data();
-  }
-
-  // for setting where to read compressed data from
-  auto src_func = [&mapped](z_stream& s) -> void {
-    s.next_in = static_cast<Byte*>(static_cast<void*>(mapped.second.get()));
-    s.avail_in = static_cast<unsigned int>(mapped.second.size());
-  };
-
-  // for setting where to write the uncompressed data to
-  auto dst_func = [this](z_stream& s) -> int {
-    s.next_out = static_cast<Byte*>(static_cast<void*>(unzipped_cache.second.data()));
-    s.avail_out = HGT_BYTES;
-    return Z_FINISH; // we know the output will hold all the input
-  };
-
-  // we have to unzip it
-  if (!baldr::inflate(src_func, dst_func)) {
-    LOG_WARN("Corrupt compressed elevation data");
-    unzipped_cache.first = -1;
-    return nullptr;
-  }
-
-  // update the simple cache
-  // TODO: LRU
-  unzipped_cache.first = index;
-  return unzipped_cache.second.data();
-}
-
-template <class coord_t> double sample::get(const coord_t& coord) const {
-  // check the cache and load
+// index of the data tile a coordinate is in
+template <class coord_t> uint16_t tile_index(const coord_t& coord) {
   auto lon = std::floor(coord.first);
   auto lat = std::floor(coord.second);
-  auto index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
+  return static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
+}
 
-  // get the proper source of the data
-  const auto* t = source(index);
+// bilinear interpolation of the postings around coord within the tile data t
+template <class coord_t> double interpolate(const int16_t* t, const coord_t& coord) {
   if (t == nullptr) {
     return NO_DATA_VALUE;
   }
+  auto lon = std::floor(coord.first);
+  auto lat = std::floor(coord.second);
 
   // figure out what row and column we need from the array of data
   // NOTE: data is arranged from upper left to bottom right, so y is flipped
@@ -260,11 +183,269 @@ template <class coord_t> double sample::get(const coord_t& coord) const {
   return value / adjust;
 }
 
+// the same bilinear interpolation as above for many postings within one tile at a time. each
+// block of postings goes through a few loops without branches so the compiler can vectorize the
+// arithmetic, leaving only the lookups of the 4 pixels as scalar loads
+template <class value_t>
+void interpolate_all(const int16_t* t,
+                     const std::vector<value_t>& lons,
+                     const std::vector<value_t>& lats,
+                     const uint32_t* begin,
+                     const uint32_t* end,
+                     std::vector<double>& values) {
+  if (t == nullptr) {
+    for (; begin != end; ++begin) {
+      values[*begin] = NO_DATA_VALUE;
+    }
+    return;
+  }
+
+  constexpr size_t kBlock = 64;
+  double u[kBlock], v[kBlock], bottom[kBlock];
+  double pixels[4][kBlock], weights[4][kBlock];
+  while (begin != end) {
+    size_t n = std::min(static_cast<size_t>(end - begin), kBlock);
+
+    // fractional pixels
+    for (size_t i = 0; i < n; ++i) {
+      auto lon = lons[begin[i]];
+      auto lat = lats[begin[i]];
+      u[i] = (lon - std::floor(lon)) * (HGT_DIM - 1);
+      v[i] = (1.0 - (lat - std::floor(lat))) * (HGT_DIM - 1);
+    }
+
+    // the 4 pixels around each posting, the bottom row is past the end for the last row so the
+    // last row is read again and not used
+    for (size_t i = 0; i < n; ++i) {
+      size_t x = std::floor(u[i]);
+      size_t y = std::floor(v[i]);
+      size_t next = y < HGT_DIM - 1 ? HGT_DIM : 0;
+      pixels[0][i] = flip(t[y * HGT_DIM + x]);
+      pixels[1][i] = flip(t[y * HGT_DIM + x + 1]);
+      pixels[2][i] = flip(t[y * HGT_DIM + next + x]);
+      pixels[3][i] = flip(t[y * HGT_DIM + next + x + 1]);
+      bottom[i] = next != 0;
+    }
+
+    // coefficients, zeroed for pixels with no data
+    for (size_t i = 0; i < n; ++i) {
+      auto x = std::floor(u[i]);
+      auto y = std::floor(v[i]);
+      double u_ratio = u[i] - x;
+      double v_ratio = v[i] - y;
+      double u_inv = 1 - u_ratio;
+      double v_inv = 1 - v_ratio;
+      weights[0][i] = !(out_of_range(pixels[0][i])) * (u_inv * v_inv);
+      weights[1][i] = !(out_of_range(pixels[1][i])) * (u_ratio * v_inv);
+      weights[2][i] = bottom[i] * !(out_of_range(pixels[2][i])) * (u_inv * v_ratio);
+      weights[3][i] = bottom[i] * !(out_of_range(pixels[3][i])) * (u_ratio * v_ratio);
+    }
+
+    // weighted values, adjusted for the pixels that were missing
+    for (size_t i = 0; i < n; ++i) {
+      double value = pixels[0][i] * weights[0][i] + pixels[1][i] * weights[1][i];
+      value += pixels[2][i] * weights[2][i] + pixels[3][i] * weights[3][i];
+      double adjust = weights[0][i] + weights[1][i];
+      adjust += weights[2][i] + weights[3][i];
+      values[begin[i]] = adjust == 0 ? NO_DATA_VALUE : value / adjust;
+    }
+    begin += n;
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace skadi {
+
+// unzipped tiles are shared by the threads. the first one to ask for a tile does the unzipping,
+// others asking for it in the mean time wait on its future
+struct sample::unzipped_cache_t {
+  using data_t = std::shared_ptr<const int16_t>;
+  using entry_t = std::pair<uint16_t, std::shared_future<data_t>>;
+
+  unzipped_cache_t(size_t cache_size, const std::string& dir)
+      : capacity(std::max(cache_size / HGT_BYTES, size_t(1))), dir(dir), files(0) {
+  }
+
+  // a place for one unzipped tile, on the heap or in a file of its own which goes away with it
+  std::shared_ptr<int16_t> allocate() {
+    if (dir.empty()) {
+      auto data = std::make_shared<std::vector<int16_t>>(HGT_PIXELS);
+      return std::shared_ptr<int16_t>(data, data->data());
+    }
+    std::string file_name;
+    {
+      std::lock_guard<std::mutex> l(lock);
+      file_name = dir + filesystem::path::preferred_separator + "unzipped_" +
+                  std::to_string(reinterpret_cast<uintptr_t>(this)) + "_" +
+                  std::to_string(files++) + ".hgt";
+    }
+    auto remove = [file_name](midgard::mem_map<int16_t>* m) {
+      delete m;
+      std::remove(file_name.c_str());
+    };
+    std::shared_ptr<midgard::mem_map<int16_t>> data(new midgard::mem_map<int16_t>(), remove);
+    data->create(file_name, HGT_PIXELS);
+    return std::shared_ptr<int16_t>(data, data->get());
+  }
+
+  std::mutex lock;
+  size_t capacity;
+  std::string dir;
+  size_t files;
+  // most recently used first
+  std::list<entry_t> lru;
+  std::unordered_map<uint16_t, std::list<entry_t>::iterator> entries;
+};
+
+::valhalla::skadi::sample::sample(const std::string& data_source,
+                                  size_t cache_size,
+                                  const std::string& cache_dir)
+    : mapped_cache(TILE_COUNT), unzipped_cache(new unzipped_cache_t(cache_size, cache_dir)),
+      data_source(data_source) {
+  // messy but needed
+  while (this->data_source.size() &&
+         this->data_source.back() == filesystem::path::preferred_separator) {
+    this->data_source.pop_back();
+  }
+
+  // check the directory for files that look like what we need
+  auto files = get_files(data_source);
+  for (const auto& f : files) {
+    // make sure its a valid index
+    format_t format = format_t::UNKNOWN;
+    auto index = is_hgt(f, format);
+    if (index < mapped_cache.size() && format != format_t::UNKNOWN) {
+      auto size = file_size(f);
+      if (format == format_t::RAW && size != HGT_BYTES) {
+        LOG_WARN("Corrupt elevation data: " + f);
+        continue;
+      }
+      mapped_cache[index].first = format;
+      mapped_cache[index].second.map(f, size, POSIX_MADV_SEQUENTIAL);
+    }
+  }
+}
+
+sample::sample(sample&&) = default;
+
+sample& sample::operator=(sample&&) = default;
+
+sample::~sample() {
+}
+
+sample::tile_data_t sample::source(uint16_t index) const {
+  // bail if its out of bounds
+  if (index >= TILE_COUNT) {
+    return {nullptr, nullptr};
+  }
+
+  auto& mapped = mapped_cache[index];
+  std::promise<unzipped_cache_t::data_t> unzipped;
+  std::shared_future<unzipped_cache_t::data_t> found;
+  {
+    std::lock_guard<std::mutex> l(unzipped_cache->lock);
+    // if we dont have anything maybe its lazy loaded
+    if (mapped.second.get() == nullptr) {
+      auto f = data_source + name_hgt(index);
+      auto size = file_size(f);
+      if (size != HGT_BYTES) {
+        return {nullptr, nullptr};
+      }
+      mapped.first = format_t::RAW;
+      mapped.second.map(f, size, POSIX_MADV_SEQUENTIAL);
+    }
+
+    // we have it raw or we dont
+    if (mapped.first == format_t::RAW) {
+      return {static_cast<const int16_t*>(static_cast<const void*>(mapped.second.get())), nullptr};
+    }
+
+    // if we have it already unzipped (or someone is working on it)
+    auto& cache = *unzipped_cache;
+    auto entry = cache.entries.find(index);
+    if (entry != cache.entries.end()) {
+      cache.lru.splice(cache.lru.begin(), cache.lru, entry->second);
+      found = entry->second->second;
+    } // otherwise its on us to unzip it, make room for it
+    else {
+      cache.lru.emplace_front(index, unzipped.get_future().share());
+      cache.entries.emplace(index, cache.lru.begin());
+      if (cache.lru.size() > cache.capacity) {
+        cache.entries.erase(cache.lru.back().first);
+        cache.lru.pop_back();
+      }
+    }
+  }
+
+  // someone else unzipped it
+  if (found.valid()) {
+    auto data = found.get();
+    return {data.get(), data};
+  }
+
+  std::shared_ptr<int16_t> data;
+  try {
+    data = unzipped_cache->allocate();
+
+    // we have to unzip it, we know the output will hold all the input
+    size_t size = HGT_BYTES;
+    if (!baldr::inflate(mapped.second.get(), mapped.second.size(),
+                        reinterpret_cast<char*>(data.get()), size)) {
+      LOG_WARN("Corrupt compressed elevation data");
+      data.reset();
+    }
+  } catch (...) {
+    unzipped.set_exception(std::current_exception());
+    throw;
+  }
+  unzipped.set_value(data);
+  return {data.get(), data};
+}
+
+template <class coord_t> double sample::get(const coord_t& coord) const {
+  // get the proper source of the data
+  auto tile = source(tile_index(coord));
+  return interpolate(tile.data, coord);
+}
+
 template <class coords_t> std::vector<double> sample::get_all(const coords_t& coords) const {
-  std::vector<double> values;
-  values.reserve(coords.size());
+  using coord_t = typename coords_t::value_type;
+  using value_t = typename std::decay<decltype(std::declval<coord_t>().first)>::type;
+
+  // pull the coordinates apart into flat arrays and find their data tiles
+  std::vector<value_t> lons, lats;
+  std::vector<uint16_t> tiles;
+  lons.reserve(coords.size());
+  lats.reserve(coords.size());
+  tiles.reserve(coords.size());
+  bool one_tile = true;
   for (const auto& coord : coords) {
-    values.emplace_back(get(coord));
+    lons.push_back(coord.first);
+    lats.push_back(coord.second);
+    tiles.push_back(tile_index(coord));
+    one_tile = one_tile && tiles.back() == tiles.front();
+  }
+
+  // group the coordinates by tile so each tile is only looked up once
+  std::vector<uint32_t> order(coords.size());
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  if (!one_tile) {
+    std::stable_sort(order.begin(), order.end(),
+                     [&tiles](uint32_t a, uint32_t b) { return tiles[a] < tiles[b]; });
+  }
+
+  // interpolate each run of coordinates within the same tile together
+  std::vector<double> values(coords.size());
+  for (size_t begin = 0, end = 0; begin < order.size(); begin = end) {
+    auto index = tiles[order[begin]];
+    for (end = begin + 1; end < order.size() && tiles[order[end]] == index; ++end) {
+    }
+    auto tile = source(index);
+    interpolate_all(tile.data, lons, lats, order.data() + begin, order.data() + end, values);
   }
   return values;
 }
@@ -273,6 +454,10 @@ double sample::get_no_data_value() {
   return NO_DATA_VALUE;
 }
 
+size_t sample::get_tile_bytes() {
+  return HGT_BYTES;
+}
+
 // explicit instantiations for templated get
 template double sample::get<std::pair<double, double>>(const std::pair<double, double>&) const;
 template double sample::get<std::pair<float, float>>(const std::pair<float, float>&) const;
@@ -23,7 +23,8 @@ constexpr uint32_t kMaxIterationsWithoutConvergence = 200000;
 // Default constructor
 AStarPathAlgorithm::AStarPathAlgorithm()
     : PathAlgorithm(), mode_(TravelMode::kDrive), travel_type_(0), adjacencylist_(nullptr),
-      max_label_count_(std::numeric_limits<uint32_t>::max()) {
+      max_label_count_(std::numeric_limits<uint32_t>::max()),
+      edgelabel_arena_(kInitialEdgeLabelCount) {
 }
 
 // Destructor
@@ -33,11 +34,13 @@ AStarPathAlgorithm::~AStarPathAlgorithm() {
 
 // Clear the temporary information generated during path construction.
 void AStarPathAlgorithm::Clear() {
-  // Clear the edge labels and destination list. Reset the adjacency list
-  // and clear edge status.
-  edgelabels_.clear();
+  // Clear the edge labels and destination list, the adjacency list and
+  // edge status. The storage is kept for the next search.
+  edgelabel_arena_.recycle(edgelabels_);
   destinations_percent_along_.clear();
-  adjacencylist_.reset();
+  if (adjacencylist_) {
+    adjacencylist_->clear();
+  }
   edgestatus_.clear();
 
   // Set the ferry flag to false
@@ -56,18 +59,19 @@ void AStarPathAlgorithm::Init(const midgard::PointLL& origll, const midgard::Poi
   float mincost = astarheuristic_.Get(origll);
 
   // Reserve size for edge labels - do this here rather than in constructor so
-  // to limit how much extra memory is used for persistent objects.
+  // to limit how much extra memory is used for persistent objects. The
+  // reservation follows the label counts of recent searches.
   // TODO - reserve based on estimate based on distance and route type.
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  edgelabel_arena_.reserve(edgelabels_);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
 
-  // Construct adjacency list, clear edge status.
+  // Construct (or reuse) the adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue(mincost, range, bucketsize, edgecost));
+  reuse_label_queue(adjacencylist_, queue_type_, mincost, range, bucketsize, edgecost);
   edgestatus_.clear();
 
   // Get hierarchy limits from the costing. Get a copy since we increment
@@ -130,21 +134,20 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
   uint32_t max_shortcut_length = static_cast<uint32_t>(pred.distance() * 0.5f);
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid, ++es) {
     // Skip shortcut edges until we have stopped expanding on the next level.
     // Also skip shortcut edges when near the destination. Always skip within
     // 10km but also reject long shortcut edges outside this distance.
     // TODO - configure this distance based on density?
     // Use regular edges while still expanding on the next level since we can still
-    // transition down to that level. If using a shortcut, set the shortcuts mask.
-    // Skip if this is a regular edge superseded by a shortcut.
+    // transition down to that level. If using a shortcut the costing allows, set the
+    // shortcuts mask. Otherwise its regular edges are the way around what it is not allowed
+    // on. Skip if this is a regular edge superseded by a shortcut.
     if (directededge->is_shortcut()) {
       if (!hierarchy_limits_[edgeid.level() + 1].StopExpanding() ||
           (pred.distance() < 10000.0f || directededge->length() > max_shortcut_length)) {
         continue;
-      } else {
-        shortcuts |= directededge->shortcut();
       }
     } else if (shortcuts & directededge->superseded()) {
       continue;
@@ -154,11 +157,19 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
     // directed edge), if no access is allowed to this edge (based on costing method),
     // or if a complex restriction exists.
     bool has_time_restrictions = false;
-    if (es->set() == EdgeSet::kPermanent ||
-        !costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
+    if (es->set() == EdgeSet::kPermanent) {
+      if (directededge->is_shortcut()) {
+        shortcuts |= directededge->shortcut();
+      }
+      continue;
+    }
+    if (!costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
         costing_->Restricted(directededge, pred, edgelabels_, tile, edgeid, true)) {
       continue;
     }
+    if (directededge->is_shortcut()) {
+      shortcuts |= directededge->shortcut();
+    }
 
     // Compute the cost to the end of this edge
     auto edge_cost = costing_->EdgeCost(directededge, tile);
@@ -214,7 +225,8 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
       if (t2 == nullptr) {
         continue;
       }
-      sortcost += astarheuristic_.Get(t2->get_node_ll(directededge->endnode()), dist);
+      sortcost += astarheuristic_.Get(t2->get_node_ll(directededge->endnode()),
+                                      directededge->endnode(), dist);
     }
 
     // Add to the adjacency list and edge labels.
@@ -226,7 +238,7 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       if (trans->up()) {
         hierarchy_limits_[node.level()].up_transition_count++;
@@ -261,6 +273,13 @@ AStarPathAlgorithm::GetBestPath(valhalla::Location& origin,
   Init(origin_new, destination_new);
   float mindist = astarheuristic_.GetDistance(origin_new);
 
+  // Bound the heuristic with the landmarks of the access mode if there are any
+  if (const auto* landmarks = GetLandmarks(costing_->access_mode())) {
+    astarheuristic_.SetLandmarks(landmarks,
+                                 GetLandmarkTargets(*landmarks, graphreader, destination, false),
+                                 false);
+  }
+
   // Initialize the origin and destination locations. Initialize the
   // destination first in case the origin edge includes a destination edge.
   uint32_t density = SetDestination(graphreader, destination);
@@ -60,6 +60,7 @@ const std::unordered_map<std::string, bool> AttributesController::kDefaultAttrib
     {kEdgeMaxUpwardGrade, true},
     {kEdgeMaxDownwardGrade, true},
     {kEdgeMeanElevation, true},
+    {kEdgeElevation, true},
     {kEdgeLaneCount, true},
     {kEdgeLaneConnectivity, true},
     {kEdgeCycleLane, true},
@@ -4,9 +4,14 @@
 #include "baldr/graphid.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "sif/autocost.h"
 #include "sif/edgelabel.h"
+#include "sif/pedestriancost.h"
+#include "sif/truckcost.h"
 #include <algorithm>
 #include <map>
+#include <typeinfo>
+#include <unordered_set>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -25,18 +30,62 @@ constexpr uint64_t kInitialEdgeLabelCountBD = 1000000;
 // cost creates large performance drops - so perhaps some other metric can be found?
 constexpr float kThresholdDelta = 420.0f;
 
+// Alternates cost at most this much more than the best path, with alternates the searches go
+// on until the sort cost is this much past that of the first connection
+constexpr float kAlternateMaxStretch = 1.25f;
+
+// Alternates share at most this fraction of their cost with the paths already found
+constexpr float kAlternateMaxSharing = 0.5f;
+
+// The plateau around the via edge of an alternate is at least this fraction of the cost it does
+// not share, so the detour is a shortest path itself and not a loop off another path
+constexpr float kAlternateMinPlateau = 0.2f;
+
+// Hint the highway and arterial tiles between the origin and destination, this is where most
+// of the tiles of a long route come from. Closest to either end first since the searches
+// start from both ends.
+void PrefetchCorridor(GraphReader& graphreader, const PointLL& origin, const PointLL& destination) {
+  if (!graphreader.Prefetching()) {
+    return;
+  }
+  std::vector<PointLL> line{origin, destination};
+  std::vector<std::pair<float, GraphId>> tiles;
+  for (uint8_t level = 0; level < TileHierarchy::levels().rbegin()->first; ++level) {
+    const auto& tiling = TileHierarchy::get_tiling(level);
+    for (const auto& tile : tiling.IntersectBins(line)) {
+      auto center = tiling.Center(tile.first);
+      tiles.emplace_back(std::min(center.Distance(origin), center.Distance(destination)),
+                         GraphId(tile.first, level, 0));
+    }
+  }
+  std::sort(tiles.begin(), tiles.end(),
+            [](const std::pair<float, GraphId>& a, const std::pair<float, GraphId>& b) {
+              return a.first < b.first;
+            });
+  std::vector<GraphId> ids;
+  for (const auto& tile : tiles) {
+    ids.push_back(tile.second);
+  }
+  graphreader.Prefetch(ids);
+}
+
 } // namespace
 
 namespace valhalla {
 namespace thor {
 
 // Default constructor
-BidirectionalAStar::BidirectionalAStar() : PathAlgorithm() {
+BidirectionalAStar::BidirectionalAStar()
+    : PathAlgorithm(), edgelabel_arena_forward_(kInitialEdgeLabelCountBD),
+      edgelabel_arena_reverse_(kInitialEdgeLabelCountBD) {
   threshold_ = 0;
+  desired_paths_ = 1;
   mode_ = TravelMode::kDrive;
   access_mode_ = kAutoAccess;
   travel_type_ = 0;
   cost_diff_ = 0.0f;
+  origin_seconds_of_week_ = kInvalidSecondsOfWeek;
+  destination_seconds_of_week_ = kInvalidSecondsOfWeek;
   adjacencylist_forward_ = nullptr;
   adjacencylist_reverse_ = nullptr;
 }
@@ -48,10 +97,16 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
-  edgelabels_forward_.clear();
-  edgelabels_reverse_.clear();
-  adjacencylist_forward_.reset();
-  adjacencylist_reverse_.reset();
+  // Clear the edge labels and adjacency lists, the storage is kept for the
+  // next search
+  edgelabel_arena_forward_.recycle(edgelabels_forward_);
+  edgelabel_arena_reverse_.recycle(edgelabels_reverse_);
+  if (adjacencylist_forward_) {
+    adjacencylist_forward_->clear();
+  }
+  if (adjacencylist_reverse_) {
+    adjacencylist_reverse_->clear();
+  }
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
 
@@ -66,11 +121,14 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   float factor = costing_->AStarCostFactor();
   astarheuristic_forward_.Init(destll, factor);
   astarheuristic_reverse_.Init(origll, factor);
+  origin_ll_ = origll;
+  destination_ll_ = destll;
 
   // Reserve size for edge labels - do this here rather than in constructor so
-  // to limit how much extra memory is used for persistent objects
-  edgelabels_forward_.reserve(kInitialEdgeLabelCountBD);
-  edgelabels_reverse_.reserve(kInitialEdgeLabelCountBD);
+  // to limit how much extra memory is used for persistent objects. The
+  // reservation follows the label counts of recent searches.
+  edgelabel_arena_forward_.reserve(edgelabels_forward_);
+  edgelabel_arena_reverse_.reserve(edgelabels_reverse_);
 
   // Set up lambdas to get sort costs
   const auto forward_edgecost = [this](const uint32_t label) {
@@ -80,14 +138,16 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
     return edgelabels_reverse_[label].sortcost();
   };
 
-  // Construct adjacency list and initialize edge status lookup.
+  // Construct (or reuse) the adjacency lists and initialize edge status lookup.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
   float mincostf = astarheuristic_forward_.Get(origll);
-  adjacencylist_forward_.reset(new DoubleBucketQueue(mincostf, range, bucketsize, forward_edgecost));
   float mincostr = astarheuristic_reverse_.Get(destll);
-  adjacencylist_reverse_.reset(new DoubleBucketQueue(mincostr, range, bucketsize, reverse_edgecost));
+  reuse_label_queue(adjacencylist_forward_, queue_type_, mincostf, range, bucketsize,
+                    forward_edgecost);
+  reuse_label_queue(adjacencylist_reverse_, queue_type_, mincostr, range, bucketsize,
+                    reverse_edgecost);
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
 
@@ -98,6 +158,7 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
 
   // Initialize best connection with max cost
   best_connection_ = {GraphId(), GraphId(), std::numeric_limits<float>::max()};
+  best_connections_.clear();
 
   // Set the cost threshold to the maximum float value. Once the initial connection is found
   // the threshold is set.
@@ -108,7 +169,28 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   hierarchy_limits_reverse_ = costing_->GetHierarchyLimits();
 }
 
+// The second of the week to cost the edges of the forward search at, elapsed seconds after the
+// origin. Noon when the forward search is not time dependent.
+uint32_t BidirectionalAStar::ForwardSecondsOfWeek(const float elapsed) const {
+  if (origin_seconds_of_week_ == kInvalidSecondsOfWeek) {
+    return kConstrainedFlowSecondOfDay;
+  }
+  return (origin_seconds_of_week_ + static_cast<uint32_t>(elapsed)) % midgard::kSecondsPerWeek;
+}
+
+// The second of the week to cost the edges of the reverse search at, elapsed seconds before
+// the destination. Noon when the reverse search is not time dependent.
+uint32_t BidirectionalAStar::ReverseSecondsOfWeek(const float elapsed) const {
+  if (destination_seconds_of_week_ == kInvalidSecondsOfWeek) {
+    return kConstrainedFlowSecondOfDay;
+  }
+  int32_t seconds = static_cast<int32_t>(destination_seconds_of_week_) -
+                    static_cast<int32_t>(elapsed) % static_cast<int32_t>(midgard::kSecondsPerWeek);
+  return DateTime::normalize_seconds_of_week(seconds);
+}
+
 // Returns true if function ended up adding an edge for expansion
+template <class CostingT>
 bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
                                        const GraphId& node,
                                        BDEdgeLabel& pred,
@@ -121,46 +203,60 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
     return false;
   }
   const NodeInfo* nodeinfo = tile->node(node);
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!CostingCalls<CostingT>::Allowed(*costing_, nodeinfo)) {
     return false;
   }
 
   uint32_t shortcuts = 0;
   EdgeMetadata meta = EdgeMetadata::make(node, nodeinfo, tile, edgestatus_forward_);
 
+  // Check access and get the costs of all of the edges of the node at once
+  AllowedEdges allowed;
+  uint32_t seconds = ForwardSecondsOfWeek(pred.cost().secs);
+  costing_->GetAllowedEdges(meta.edge, nodeinfo->edge_count(), meta.edge_id, pred, tile, seconds,
+                            allowed);
+  uint32_t next_allowed = 0;
+
   bool found_valid_edge = false;
   bool found_uturn = false;
   EdgeMetadata uturn_meta = {};
 
   // Expand from end node in forward direction.
   for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, meta.increment_pointers()) {
+    // The slot of this edge in the allowed edges, or -1 if it is not allowed
+    int32_t slot = -1;
+    if (next_allowed < allowed.count && allowed.index[next_allowed] == i) {
+      slot = next_allowed++;
+    }
 
     // Begin by checking if this is the opposing edge to pred.
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    if (pred.opp_local_idx() == meta.edge->localedgeidx()) {
+    if (pred.opp_local_idx() == meta.routing_edge->localedgeidx) {
       uturn_meta = meta;
       found_uturn = true;
       continue;
     }
 
-    found_valid_edge =
-        ExpandForwardInner(graphreader, pred, nodeinfo, pred_idx, meta, shortcuts, tile) ||
-        found_valid_edge;
+    found_valid_edge = ExpandForwardInner<CostingT>(graphreader, pred, nodeinfo, pred_idx, meta,
+                                                    shortcuts, tile, allowed, slot) ||
+                       found_valid_edge;
   }
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       if (trans->up()) {
         hierarchy_limits_forward_[node.level()].up_transition_count++;
         found_valid_edge =
-            ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true) || found_valid_edge;
+            ExpandForward<CostingT>(graphreader, trans->endnode(), pred, pred_idx, true) ||
+            found_valid_edge;
       } else if (!hierarchy_limits_forward_[trans->endnode().level()].StopExpanding()) {
         found_valid_edge =
-            ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true) || found_valid_edge;
+            ExpandForward<CostingT>(graphreader, trans->endnode(), pred, pred_idx, true) ||
+            found_valid_edge;
       }
     }
   }
@@ -183,9 +279,13 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
       if (was_uturn_shortcut_added) {
         found_valid_edge = true;
       } else {
-        // We didn't add any shortcut of the uturn, therefore evaluate the regular uturn instead
+        // We didn't add any shortcut of the uturn, therefore evaluate the regular uturn instead.
+        // Check its access again since the predecessor may have just become a deadend
+        costing_->GetAllowedEdges(uturn_meta.edge, 1, uturn_meta.edge_id, pred, tile, seconds,
+                                  allowed);
         bool uturn_added =
-            ExpandForwardInner(graphreader, pred, nodeinfo, pred_idx, uturn_meta, shortcuts, tile);
+            ExpandForwardInner<CostingT>(graphreader, pred, nodeinfo, pred_idx, uturn_meta,
+                                         shortcuts, tile, allowed, allowed.count > 0 ? 0 : -1);
         found_valid_edge = found_valid_edge || uturn_added;
       }
     }
@@ -200,24 +300,29 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
 // TODO: Merge this with ExpandReverseInner
 //
 // Returns true if any edge _could_ have been expanded after restrictions etc.
+template <class CostingT>
 inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
                                                    const BDEdgeLabel& pred,
                                                    const NodeInfo* nodeinfo,
                                                    const uint32_t pred_idx,
                                                    const EdgeMetadata& meta,
                                                    uint32_t& shortcuts,
-                                                   const GraphTile* tile) {
+                                                   const GraphTile* tile,
+                                                   const AllowedEdges& allowed,
+                                                   const int32_t slot) {
   // Skip shortcut edges until we have stopped expanding on the next level. Use regular
   // edges while still expanding on the next level since we can still transition down to
-  // that level. If using a shortcut, set the shortcuts mask. Skip if this is a regular
-  // edge superseded by a shortcut.
-  if (meta.edge->is_shortcut()) {
-    if (hierarchy_limits_forward_[meta.edge_id.level() + 1].StopExpanding()) {
-      shortcuts |= meta.edge->shortcut();
-    } else {
+  // that level. If using a shortcut the costing allows, set the shortcuts mask. Otherwise
+  // its regular edges are the way around what it is not allowed on, like a bridge too low
+  // for a truck. Skip if this is a regular edge superseded by a shortcut.
+  if (meta.routing_edge->is_shortcut) {
+    if (!hierarchy_limits_forward_[meta.edge_id.level() + 1].StopExpanding()) {
       return false;
     }
-  } else if (shortcuts & meta.edge->superseded()) {
+    if (slot >= 0) {
+      shortcuts |= meta.routing_edge->shortcut;
+    }
+  } else if (shortcuts & meta.routing_edge->superseded) {
     return false;
   }
 
@@ -227,15 +332,15 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
   if (meta.edge_status->set() == EdgeSet::kPermanent) {
     return true; // This is an edge we _could_ have expanded, so return true
   }
-  bool has_time_restrictions = false;
-  if (!costing_->Allowed(meta.edge, pred, tile, meta.edge_id, 0, 0, has_time_restrictions) ||
+  if (slot < 0 ||
       costing_->Restricted(meta.edge, pred, edgelabels_forward_, tile, meta.edge_id, true)) {
     return false;
   }
+  bool has_time_restrictions = allowed.has_time_restrictions[slot];
 
   // Get cost. Separate out transition cost.
-  Cost tc = costing_->TransitionCost(meta.edge, nodeinfo, pred);
-  Cost newcost = pred.cost() + tc + costing_->EdgeCost(meta.edge, tile, kConstrainedFlowSecondOfDay);
+  Cost tc = CostingCalls<CostingT>::TransitionCost(*costing_, meta.edge, nodeinfo, pred);
+  Cost newcost = pred.cost() + tc + allowed.cost[slot];
 
   // Check if edge is temporarily labeled and this path has less cost. If
   // less cost the predecessor is updated and the sort cost is decremented
@@ -252,17 +357,22 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
 
   // Get end node tile (skip if tile is not found) and opposing edge Id
   const GraphTile* t2 =
-      meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
+      meta.routing_edge->leaves_tile ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
   if (t2 == nullptr) {
     return false;
   }
+  if (meta.routing_edge->leaves_tile) {
+    // Start loading the tiles past this one on the way to the destination
+    graphreader.PrefetchNeighbors(meta.edge->endnode(), destination_ll_);
+  }
   GraphId opp_edge_id = t2->GetOpposingEdgeId(meta.edge);
 
   // Find the sort cost (with A* heuristic) using the lat,lng at the
   // end node of the directed edge.
   float dist = 0.0f;
   float sortcost =
-      newcost.cost + astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+      newcost.cost + astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()),
+                                                meta.edge->endnode(), dist);
 
   // Add edge label, add to the adjacency list and set edge status
   uint32_t idx = edgelabels_forward_.size();
@@ -284,6 +394,7 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
 // Expand from a node in reverse direction.
 //
 // Returns true if function ended up adding an edge for expansion
+template <class CostingT>
 bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
                                        const GraphId& node,
                                        BDEdgeLabel& pred,
@@ -297,7 +408,7 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     return false;
   }
   const NodeInfo* nodeinfo = tile->node(node);
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!CostingCalls<CostingT>::Allowed(*costing_, nodeinfo)) {
     return false;
   }
 
@@ -315,29 +426,31 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    if (pred.opp_local_idx() == meta.edge->localedgeidx()) {
+    if (pred.opp_local_idx() == meta.routing_edge->localedgeidx) {
       uturn_meta = meta;
       found_uturn = true;
       continue;
     }
 
-    edge_was_added = ExpandReverseInner(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx, meta,
-                                        shortcuts, tile) ||
+    edge_was_added = ExpandReverseInner<CostingT>(graphreader, pred, opp_pred_edge, nodeinfo,
+                                                  pred_idx, meta, shortcuts, tile) ||
                      edge_was_added;
   }
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       if (trans->up()) {
         hierarchy_limits_reverse_[node.level()].up_transition_count++;
         edge_was_added =
-            ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true) ||
+            ExpandReverse<CostingT>(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge,
+                                    true) ||
             edge_was_added;
       } else if (!hierarchy_limits_reverse_[trans->endnode().level()].StopExpanding()) {
         edge_was_added =
-            ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true) ||
+            ExpandReverse<CostingT>(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge,
+                                    true) ||
             edge_was_added;
       }
     }
@@ -362,8 +475,8 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
         edge_was_added = true;
       } else {
         // We didn't add any shortcut of the uturn, therefore evaluate the regular uturn instead
-        edge_was_added = ExpandReverseInner(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx,
-                                            uturn_meta, shortcuts, tile) ||
+        edge_was_added = ExpandReverseInner<CostingT>(graphreader, pred, opp_pred_edge, nodeinfo,
+                                                      pred_idx, uturn_meta, shortcuts, tile) ||
                          edge_was_added;
       }
     }
@@ -377,6 +490,7 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
 // TODO: Merge this with ExpandForwardInner
 //
 // Returns true if any edge _could_ have been expanded after restrictions etc.
+template <class CostingT>
 inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
                                                    const BDEdgeLabel& pred,
                                                    const DirectedEdge* opp_pred_edge,
@@ -387,34 +501,40 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
                                                    const GraphTile* tile) {
   // Skip shortcut edges until we have stopped expanding on the next level. Use regular
   // edges while still expanding on the next level since we can still transition down to
-  // that level. If using a shortcut, set the shortcuts mask. Skip if this is a regular
-  // edge superseded by a shortcut.
-  if (meta.edge->is_shortcut()) {
-    if (hierarchy_limits_reverse_[meta.edge_id.level() + 1].StopExpanding()) {
-      shortcuts |= meta.edge->shortcut();
-    } else {
+  // that level. Once a shortcut is found to be allowed by the costing set the shortcuts
+  // mask, until then its regular edges are the way around what it is not allowed on. Skip
+  // if this is a regular edge superseded by a shortcut.
+  if (meta.routing_edge->is_shortcut) {
+    if (!hierarchy_limits_reverse_[meta.edge_id.level() + 1].StopExpanding()) {
       return false;
     }
-  } else if (shortcuts & meta.edge->superseded()) {
+  } else if (shortcuts & meta.routing_edge->superseded) {
     return false;
   }
 
   // Skip this edge if permanently labeled (best path already found to this
   // directed edge)
   if (meta.edge_status->set() == EdgeSet::kPermanent) {
+    if (meta.routing_edge->is_shortcut) {
+      shortcuts |= meta.routing_edge->shortcut;
+    }
     return true; // This is an edge we _could_ have expanded, so return true
   }
   // TODO Why is this check necessary? opp_edge.forwardaccess() is checked in Allowed(...)
-  if (!(meta.edge->reverseaccess() & access_mode_)) {
+  if (!(meta.routing_edge->reverseaccess & access_mode_)) {
     return false;
   }
 
   // Get end node tile, opposing edge Id, and opposing directed edge.
   const GraphTile* t2 =
-      meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
+      meta.routing_edge->leaves_tile ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
   if (t2 == nullptr) {
     return false;
   }
+  if (meta.routing_edge->leaves_tile) {
+    // Start loading the tiles past this one on the way back to the origin
+    graphreader.PrefetchNeighbors(meta.edge->endnode(), origin_ll_);
+  }
 
   GraphId opp_edge_id = t2->GetOpposingEdgeId(meta.edge);
   const DirectedEdge* opp_edge = t2->directededge(opp_edge_id);
@@ -422,17 +542,23 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   // Skip this edge if no access is allowed (based on costing method)
   // or if a complex restriction prevents transition onto this edge.
   bool has_time_restrictions = false;
-  if (!costing_->AllowedReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, 0, 0,
-                                has_time_restrictions) ||
+  if (!CostingCalls<CostingT>::AllowedReverse(*costing_, meta.edge, pred, opp_edge, t2, opp_edge_id,
+                                              0, 0, has_time_restrictions) ||
       costing_->Restricted(meta.edge, pred, edgelabels_reverse_, tile, meta.edge_id, false)) {
     return false;
   }
+  if (meta.routing_edge->is_shortcut) {
+    shortcuts |= meta.routing_edge->shortcut;
+  }
 
   // Get cost. Use opposing edge for EdgeCost. Separate the transition seconds so we
   // can properly recover elapsed time on the reverse path.
-  Cost tc =
-      costing_->TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge, opp_pred_edge);
-  Cost newcost = pred.cost() + costing_->EdgeCost(opp_edge, t2, kConstrainedFlowSecondOfDay);
+  Cost tc = CostingCalls<CostingT>::TransitionCostReverse(*costing_, meta.edge->localedgeidx(),
+                                                         nodeinfo, opp_edge, opp_pred_edge);
+  Cost newcost =
+      pred.cost() +
+      CostingCalls<CostingT>::EdgeCost(*costing_, opp_edge, t2,
+                                       ReverseSecondsOfWeek(pred.cost().secs));
   newcost.cost += tc.cost;
 
   // Check if edge is temporarily labeled and this path has less cost. If
@@ -452,7 +578,8 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   // end node of the directed edge.
   float dist = 0.0f;
   float sortcost =
-      newcost.cost + astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+      newcost.cost + astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()),
+                                                meta.edge->endnode(), dist);
 
   // Add edge label, add to the adjacency list and set edge status
   uint32_t idx = edgelabels_reverse_.size();
@@ -471,8 +598,8 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   return true;
 }
 
-// Calculate best path using bi-directional A*. No hierarchies or time
-// dependencies are used. Suitable for pedestrian routes (and bicycle?).
+// Calculate best path using bi-directional A*. No hierarchies are used. With a date_time at
+// either end the search leaving that end is time dependent.
 std::vector<std::vector<PathInfo>>
 BidirectionalAStar::GetBestPath(valhalla::Location& origin,
                                 valhalla::Location& destination,
@@ -485,11 +612,54 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   travel_type_ = costing_->travel_type();
   access_mode_ = costing_->access_mode();
+  desired_paths_ = options.alternates() + 1;
+
+  // Expand with the costing methods called non virtually for the costings we can, derived
+  // costings have to be checked for with their exact type so they dont get their base's methods
+  auto forward_expansion = &BidirectionalAStar::ExpandForward<DynamicCost>;
+  auto reverse_expansion = &BidirectionalAStar::ExpandReverse<DynamicCost>;
+  const auto& costing_type = typeid(*costing_);
+  if (costing_type == typeid(AutoCost)) {
+    forward_expansion = &BidirectionalAStar::ExpandForward<AutoCost>;
+    reverse_expansion = &BidirectionalAStar::ExpandReverse<AutoCost>;
+  } else if (costing_type == typeid(TruckCost)) {
+    forward_expansion = &BidirectionalAStar::ExpandForward<TruckCost>;
+    reverse_expansion = &BidirectionalAStar::ExpandReverse<TruckCost>;
+  } else if (costing_type == typeid(PedestrianCost)) {
+    forward_expansion = &BidirectionalAStar::ExpandForward<PedestrianCost>;
+    reverse_expansion = &BidirectionalAStar::ExpandReverse<PedestrianCost>;
+  }
+
+  // A date_time at the origin makes the forward search time dependent, otherwise one at the
+  // destination makes the reverse search time dependent. The other search costs its edges at
+  // noon like it does when there is no date_time.
+  origin_seconds_of_week_ = kInvalidSecondsOfWeek;
+  destination_seconds_of_week_ = kInvalidSecondsOfWeek;
+  if (origin.has_date_time()) {
+    origin_seconds_of_week_ = DateTime::day_of_week(origin.date_time()) * midgard::kSecondsPerDay +
+                              DateTime::seconds_from_midnight(origin.date_time());
+  } else if (destination.has_date_time()) {
+    destination_seconds_of_week_ =
+        DateTime::day_of_week(destination.date_time()) * midgard::kSecondsPerDay +
+        DateTime::seconds_from_midnight(destination.date_time());
+  }
 
   // Initialize - create adjacency list, edgestatus support, A*, etc.
   PointLL origin_new(origin.path_edges(0).ll().lng(), origin.path_edges(0).ll().lat());
   PointLL destination_new(destination.path_edges(0).ll().lng(), destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
+  PrefetchCorridor(graphreader, origin_new, destination_new);
+
+  // Bound the heuristics with the landmarks of the access mode if there are any
+  if (const auto* landmarks = GetLandmarks(access_mode_)) {
+    astarheuristic_forward_.SetLandmarks(landmarks,
+                                         GetLandmarkTargets(*landmarks, graphreader, destination,
+                                                            false),
+                                         false);
+    astarheuristic_reverse_.SetLandmarks(landmarks,
+                                         GetLandmarkTargets(*landmarks, graphreader, origin, true),
+                                         true);
+  }
 
   // Set origin and destination locations - seeds the adj. lists
   // Note: because we can correlate to more than one place for a given
@@ -599,7 +769,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       }
 
       // Expand from the end node in forward direction.
-      ExpandForward(graphreader, fwd_pred.endnode(), fwd_pred, forward_pred_idx, false);
+      (this->*forward_expansion)(graphreader, fwd_pred.endnode(), fwd_pred, forward_pred_idx, false);
     } else {
       // Expand reverse - set to get next edge from reverse adj. list on the next pass
       expand_forward = false;
@@ -625,8 +795,8 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
           graphreader.GetGraphTile(rev_pred.opp_edgeid())->directededge(rev_pred.opp_edgeid());
 
       // Expand from the end node in reverse direction.
-      ExpandReverse(graphreader, rev_pred.endnode(), rev_pred, reverse_pred_idx, opp_pred_edge,
-                    false);
+      (this->*reverse_expansion)(graphreader, rev_pred.endnode(), rev_pred, reverse_pred_idx,
+                                 opp_pred_edge, false);
     }
   }
   return {}; // If we are here the route failed
@@ -662,14 +832,22 @@ bool BidirectionalAStar::SetForwardConnection(GraphReader& graphreader, const BD
     c = pred.cost().cost + oppcost + edgelabels_reverse_[oppedgestatus.index()].transition_cost();
   }
 
-  // Set best_connection if cost is less than the best cost so far.
+  // Set best_connection if cost is less than the best cost so far. Keep all of them to form
+  // alternates from.
   if (c < best_connection_.cost) {
     best_connection_ = {pred.edgeid(), oppedge, c};
   }
+  if (desired_paths_ > 1) {
+    best_connections_.push_back({pred.edgeid(), oppedge, c});
+  }
 
-  // Set a threshold to extend search
+  // Set a threshold to extend search, further with alternates
   if (threshold_ == std::numeric_limits<float>::max()) {
-    threshold_ = pred.sortcost() + cost_diff_ + kThresholdDelta;
+    float sortcost = pred.sortcost() + cost_diff_;
+    threshold_ =
+        sortcost + (desired_paths_ > 1 ? std::max(kThresholdDelta,
+                                                  sortcost * (kAlternateMaxStretch - 1.0f))
+                                       : kThresholdDelta);
   }
 
   // setting this edge as connected
@@ -710,14 +888,22 @@ bool BidirectionalAStar::SetReverseConnection(GraphReader& graphreader, const BD
     c = pred.cost().cost + oppcost + edgelabels_forward_[oppedgestatus.index()].transition_cost();
   }
 
-  // Set best_connection if cost is less than the best cost so far.
+  // Set best_connection if cost is less than the best cost so far. Keep all of them to form
+  // alternates from.
   if (c < best_connection_.cost) {
     best_connection_ = {oppedge, pred.edgeid(), c};
   }
+  if (desired_paths_ > 1) {
+    best_connections_.push_back({oppedge, pred.edgeid(), c});
+  }
 
-  // Set a threshold to extend search
+  // Set a threshold to extend search, further with alternates
   if (threshold_ == std::numeric_limits<float>::max()) {
-    threshold_ = pred.sortcost() + kThresholdDelta;
+    float sortcost = pred.sortcost();
+    threshold_ =
+        sortcost + (desired_paths_ > 1 ? std::max(kThresholdDelta,
+                                                  sortcost * (kAlternateMaxStretch - 1.0f))
+                                       : kThresholdDelta);
   }
 
   // setting this edge as connected, sending the opposing because this is the reverse tree
@@ -766,7 +952,7 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader, valhalla::Location&
     // Get cost and sort cost (based on distance from endnode of this edge
     // to the destination
     nodeinfo = endtile->node(directededge->endnode());
-    Cost cost = costing_->EdgeCost(directededge, tile, kConstrainedFlowSecondOfDay) *
+    Cost cost = costing_->EdgeCost(directededge, tile, ForwardSecondsOfWeek(0.0f)) *
                 (1.0f - edge.percent_along());
 
     // Store a node-info for later timezone retrieval (approximate for closest)
@@ -848,7 +1034,7 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader, const valhalla
     // destination edge. Note that the end node of the opposing edge is in the
     // same tile as the directed edge.
     Cost cost =
-        costing_->EdgeCost(directededge, tile, kConstrainedFlowSecondOfDay) * edge.percent_along();
+        costing_->EdgeCost(directededge, tile, ReverseSecondsOfWeek(0.0f)) * edge.percent_along();
 
     // We need to penalize this location based on its score (distance in meters from input)
     // We assume the slowest speed you could travel to cover that distance to start/end the route
@@ -878,23 +1064,76 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader, const valhalla
   }
 }
 
-// Form the path from the adjacency list.
+// Form the path from the adjacency list, and the alternates if there should be any.
 std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& graphreader,
                                                                 const valhalla::Options&) {
-  // Get the indexes where the connection occurs.
-  uint32_t idx1 = edgestatus_forward_.Get(best_connection_.edgeid).index();
-  uint32_t idx2 = edgestatus_reverse_.Get(best_connection_.opp_edgeid).index();
-
   // Metrics (TODO - more accurate cost)
-  uint32_t pathcost = edgelabels_forward_[idx1].cost().cost + edgelabels_reverse_[idx2].cost().cost;
-  LOG_DEBUG("path_cost::" + std::to_string(pathcost));
+  LOG_DEBUG("path_cost::" + std::to_string(best_connection_.cost));
   LOG_DEBUG("FormPath path_iterations::" + std::to_string(edgelabels_forward_.size()) + "," +
             std::to_string(edgelabels_reverse_.size()));
 
-  // Work backwards on the forward path
   std::vector<std::vector<PathInfo>> paths;
-  paths.emplace_back();
-  std::vector<PathInfo>& path = paths.back();
+  paths.emplace_back(FormPath(best_connection_));
+  if (desired_paths_ == 1) {
+    return paths;
+  }
+
+  // The edges of the paths found so far, to tell how much an alternate shares with them
+  std::unordered_set<GraphId> path_edges;
+  for (const auto& info : paths.back()) {
+    path_edges.insert(info.edgeid);
+  }
+
+  // Try the other connections, cheapest first. Whether there is a ferry is about the best path.
+  bool has_ferry = has_ferry_;
+  std::sort(best_connections_.begin(), best_connections_.end());
+  for (const auto& connection : best_connections_) {
+    if (paths.size() == desired_paths_ ||
+        connection.cost > best_connection_.cost * kAlternateMaxStretch) {
+      break;
+    }
+
+    // A connection on a path already found leads back to (most of) that path
+    if (path_edges.count(connection.edgeid)) {
+      continue;
+    }
+
+    // Get the cost it shares with the paths so far, the trees can also meet in a loop
+    auto path = FormPath(connection);
+    std::unordered_set<GraphId> edges;
+    bool loop = false;
+    float shared = 0.0f;
+    for (size_t i = 0; i < path.size(); ++i) {
+      loop = loop || !edges.insert(path[i].edgeid).second;
+      if (path_edges.count(path[i].edgeid)) {
+        shared += path[i].elapsed_cost - (i > 0 ? path[i - 1].elapsed_cost : 0.0f);
+      }
+    }
+    float cost = path.back().elapsed_cost;
+    if (loop || shared > cost * kAlternateMaxSharing ||
+        PlateauCost(connection) < (cost - shared) * kAlternateMinPlateau) {
+      continue;
+    }
+
+    path_edges.insert(edges.begin(), edges.end());
+    paths.emplace_back(std::move(path));
+  }
+  has_ferry_ = has_ferry;
+  LOG_DEBUG("FormPath alternates::" + std::to_string(paths.size() - 1) + " of " +
+            std::to_string(best_connections_.size()) + " connections");
+  return paths;
+}
+
+// Form the path through a connection of the two search trees. Recovers the path from where the
+// paths meet back towards the origin then reverses this path. The path from where the paths
+// meet to the destination is then appended using the opposing edges.
+std::vector<PathInfo> BidirectionalAStar::FormPath(const CandidateConnection& connection) {
+  // Get the indexes where the connection occurs.
+  uint32_t idx1 = edgestatus_forward_.Get(connection.edgeid).index();
+  uint32_t idx2 = edgestatus_reverse_.Get(connection.opp_edgeid).index();
+
+  // Work backwards on the forward path
+  std::vector<PathInfo> path;
   for (auto edgelabel_index = idx1; edgelabel_index != kInvalidLabel;
        edgelabel_index = edgelabels_forward_[edgelabel_index].predecessor()) {
     const BDEdgeLabel& edgelabel = edgelabels_forward_[edgelabel_index];
@@ -924,7 +1163,7 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
       path.back().elapsed_time = edgelabels_reverse_[idx2].cost().secs;
       path.back().elapsed_cost = edgelabels_reverse_[idx2].cost().cost;
     }
-    return paths;
+    return path;
   }
 
   // Get the elapsed time at the end of the forward path. NOTE: PathInfo
@@ -965,7 +1204,54 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
     tc.secs = edgelabel.transition_secs();
     tc.cost = edgelabel.transition_cost();
   }
-  return paths;
+  return path;
+}
+
+// Get the cost of the plateau around a connection. Going back towards the origin an edge is on
+// the plateau while the reverse tree goes from it to the next edge of the path, and going on
+// towards the destination while the forward tree comes to it from the edge before.
+float BidirectionalAStar::PlateauCost(const CandidateConnection& connection) const {
+  uint32_t fwd = edgestatus_forward_.Get(connection.edgeid).index();
+  uint32_t rev = edgestatus_reverse_.Get(connection.opp_edgeid).index();
+
+  // Back along the forward tree
+  uint32_t start = fwd;
+  uint32_t next = rev;
+  for (uint32_t idx = edgelabels_forward_[fwd].predecessor(); idx != kInvalidLabel;
+       idx = edgelabels_forward_[idx].predecessor()) {
+    const GraphId& opp_edgeid = edgelabels_forward_[idx].opp_edgeid();
+    EdgeStatusInfo status =
+        opp_edgeid.Is_Valid() ? edgestatus_reverse_.Get(opp_edgeid) : EdgeStatusInfo();
+    if (status.set() == EdgeSet::kUnreached ||
+        edgelabels_reverse_[status.index()].predecessor() != next) {
+      break;
+    }
+    start = idx;
+    next = status.index();
+  }
+  uint32_t before = edgelabels_forward_[start].predecessor();
+  float cost = edgelabels_forward_[fwd].cost().cost -
+               (before == kInvalidLabel ? 0.0f : edgelabels_forward_[before].cost().cost);
+
+  // On along the reverse tree, which already has the connecting edge
+  uint32_t end = kInvalidLabel;
+  uint32_t previous = fwd;
+  for (uint32_t idx = edgelabels_reverse_[rev].predecessor(); idx != kInvalidLabel;
+       idx = edgelabels_reverse_[idx].predecessor()) {
+    EdgeStatusInfo status = edgestatus_forward_.Get(edgelabels_reverse_[idx].opp_edgeid());
+    if (status.set() == EdgeSet::kUnreached ||
+        edgelabels_forward_[status.index()].predecessor() != previous) {
+      break;
+    }
+    end = idx;
+    previous = status.index();
+  }
+  if (end != kInvalidLabel) {
+    uint32_t after = edgelabels_reverse_[end].predecessor();
+    cost += edgelabels_reverse_[edgelabels_reverse_[rev].predecessor()].cost().cost -
+            (after == kInvalidLabel ? 0.0f : edgelabels_reverse_[after].cost().cost);
+  }
+  return cost;
 }
 
 } // namespace thor
@@ -0,0 +1,413 @@
+#include "thor/celloverlay.h"
+#include "midgard/logging.h"
+#include "thor/costmatrix.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+using queue_entry_t = std::pair<float, uint32_t>;
+using min_queue_t =
+    std::priority_queue<queue_entry_t, std::vector<queue_entry_t>, std::greater<queue_entry_t>>;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+CellOverlay::CellOverlay(const std::shared_ptr<const CellPartition>& partition,
+                         std::vector<Cost>&& edge_costs)
+    : partition_(partition), edge_costs_(std::move(edge_costs)) {
+  // From the smallest cells up, each level searches the overlay of the level below
+  labels_t labels;
+  cliques_.resize(partition_->levels());
+  for (uint32_t level = 0; level < partition_->levels(); ++level) {
+    for (const auto& cell : partition_->boundaries[level]) {
+      const auto& boundary = cell.second;
+      const size_t n = boundary.size();
+      std::vector<float> clique(n * n, kMaxCost);
+      for (size_t i = 0; i < n; ++i) {
+        CellSearch(level, boundary[i], kInvalidCellIndex, labels);
+        for (size_t j = 0; j < n; ++j) {
+          auto found = labels.find(boundary[j]);
+          if (found != labels.end()) {
+            clique[i * n + j] = found->second.cost;
+          }
+        }
+      }
+      cliques_[level].emplace(cell.first, std::move(clique));
+    }
+  }
+}
+
+std::shared_ptr<const CellOverlay>
+CellOverlay::Customize(const std::shared_ptr<const CellPartition>& partition,
+                       GraphReader& graphreader,
+                       const DynamicCost& costing) {
+  // Cost the edges the costing allows, transitions between levels are free
+  std::vector<Cost> edge_costs(partition->edges.size(), Cost(kMaxCost, kMaxCost));
+  auto edge_filter = costing.GetEdgeFilter();
+  auto node_filter = costing.GetNodeFilter();
+  for (uint32_t node = 0; node < partition->nodes.size(); ++node) {
+    GraphId node_id(partition->nodes[node]);
+    const GraphTile* tile = graphreader.GetGraphTile(node_id);
+    if (tile == nullptr || node_filter(tile->node(node_id))) {
+      continue;
+    }
+    for (uint32_t e = partition->offsets[node]; e < partition->offsets[node + 1]; ++e) {
+      GraphId edgeid(partition->edges[e].edgeid);
+      if (!edgeid.Is_Valid()) {
+        edge_costs[e] = Cost(0.0f, 0.0f);
+        continue;
+      }
+      const DirectedEdge* edge = tile->directededge(edgeid);
+      if (edge_filter(edge) != 0.0f) {
+        edge_costs[e] = costing.EdgeCost(edge, tile);
+      }
+    }
+    if (graphreader.OverCommitted()) {
+      graphreader.Trim();
+    }
+  }
+  return std::make_shared<CellOverlay>(partition, std::move(edge_costs));
+}
+
+size_t CellOverlay::bytes() const {
+  size_t bytes = edge_costs_.size() * sizeof(Cost);
+  for (const auto& level : cliques_) {
+    for (const auto& clique : level) {
+      bytes += clique.second.size() * sizeof(float);
+    }
+  }
+  return bytes;
+}
+
+template <typename arc_f>
+void CellOverlay::ForArcs(const uint32_t node, const uint32_t level, arc_f f) const {
+  const auto& partition = *partition_;
+  if (level == 0) {
+    for (uint32_t e = partition.offsets[node]; e < partition.offsets[node + 1]; ++e) {
+      if (edge_costs_[e].cost < kMaxCost) {
+        f(partition.edges[e].to, edge_costs_[e].cost, e, 0);
+      }
+    }
+    return;
+  }
+
+  // The costs to the other boundary nodes of the cell below and the edges leaving that cell
+  const uint32_t below = level - 1;
+  const uint32_t cell = partition.cells[below][node];
+  const uint32_t i = partition.boundary_index[below][node];
+  const auto& boundary = partition.boundaries[below].find(cell)->second;
+  const auto& clique = cliques_[below].find(cell)->second;
+  const size_t n = boundary.size();
+  for (size_t j = 0; j < n; ++j) {
+    if (j != i && clique[i * n + j] < kMaxCost) {
+      f(boundary[j], clique[i * n + j], kInvalidCellIndex, below);
+    }
+  }
+  for (uint32_t e = partition.offsets[node]; e < partition.offsets[node + 1]; ++e) {
+    const auto to = partition.edges[e].to;
+    if (edge_costs_[e].cost < kMaxCost && partition.cells[below][to] != cell) {
+      f(to, edge_costs_[e].cost, e, 0);
+    }
+  }
+}
+
+void CellOverlay::CellSearch(const uint32_t level,
+                             const uint32_t source,
+                             const uint32_t target,
+                             labels_t& labels) const {
+  labels.clear();
+  const auto& cells = partition_->cells[level];
+  const uint32_t cell = cells[source];
+  min_queue_t queue;
+  labels.emplace(source, Label{0.0f, kInvalidCellIndex, kInvalidCellIndex, 0});
+  queue.emplace(0.0f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > labels.find(top.second)->second.cost) {
+      continue;
+    }
+    if (top.second == target) {
+      break;
+    }
+    ForArcs(top.second, level,
+            [&](const uint32_t to, const float cost, const uint32_t edge, const uint32_t below) {
+              if (cells[to] != cell) {
+                return;
+              }
+              const float c = top.first + cost;
+              auto inserted = labels.emplace(to, Label{c, top.second, edge, below});
+              if (inserted.second || c < inserted.first->second.cost) {
+                inserted.first->second = Label{c, top.second, edge, below};
+                queue.emplace(c, to);
+              }
+            });
+  }
+}
+
+void CellOverlay::Unpack(const uint32_t level,
+                         const uint32_t from,
+                         const uint32_t to,
+                         std::vector<uint32_t>& path) const {
+  // Find the path again within the cell and unpack the costs of the cells below along it
+  labels_t labels;
+  CellSearch(level, from, to, labels);
+  std::vector<uint32_t> nodes;
+  for (uint32_t node = to; node != from; node = labels.find(node)->second.pred) {
+    nodes.push_back(node);
+  }
+  for (auto node = nodes.rbegin(); node != nodes.rend(); ++node) {
+    const auto& label = labels.find(*node)->second;
+    if (label.edge != kInvalidCellIndex) {
+      path.push_back(label.edge);
+    } else {
+      Unpack(label.level, label.pred, *node, path);
+    }
+  }
+}
+
+bool CellOverlay::Search(const std::vector<seed_t>& sources,
+                         const std::vector<seed_t>& targets,
+                         std::vector<uint32_t>& path,
+                         uint32_t& source,
+                         uint32_t& target,
+                         float& cost,
+                         const std::function<void()>* interrupt) const {
+  path.clear();
+  const auto& partition = *partition_;
+
+  // The search stays on the edges of the cells the sources and targets are in, elsewhere it
+  // only uses the costs between the boundary nodes of the largest cell without any of them
+  std::vector<std::vector<uint32_t>> near(partition.levels());
+  for (const auto* seeds : {&sources, &targets}) {
+    for (const auto& seed : *seeds) {
+      for (uint32_t level = 0; level < partition.levels(); ++level) {
+        near[level].push_back(partition.cells[level][seed.first]);
+      }
+    }
+  }
+  const auto query_level = [&](const uint32_t node) {
+    uint32_t level = 0;
+    while (level < partition.levels() &&
+           std::find(near[level].begin(), near[level].end(), partition.cells[level][node]) ==
+               near[level].end()) {
+      ++level;
+    }
+    while (level > 0 && partition.boundary_index[level - 1][node] == kInvalidCellIndex) {
+      --level;
+    }
+    return level;
+  };
+
+  // A seed has no predecessor, its level is the index of the seed
+  labels_t labels;
+  min_queue_t queue;
+  for (uint32_t i = 0; i < sources.size(); ++i) {
+    const Label seed{sources[i].second, kInvalidCellIndex, kInvalidCellIndex, i};
+    auto inserted = labels.emplace(sources[i].first, seed);
+    if (inserted.second || seed.cost < inserted.first->second.cost) {
+      inserted.first->second = seed;
+      queue.emplace(sources[i].second, sources[i].first);
+    }
+  }
+  std::unordered_map<uint32_t, uint32_t> ends;
+  for (uint32_t i = 0; i < targets.size(); ++i) {
+    auto inserted = ends.emplace(targets[i].first, i);
+    if (!inserted.second && targets[i].second < targets[inserted.first->second].second) {
+      inserted.first->second = i;
+    }
+  }
+
+  float best = kMaxCost;
+  uint32_t meet = kInvalidCellIndex;
+  size_t n = 0;
+  while (!queue.empty() && queue.top().first < best) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > labels.find(top.second)->second.cost) {
+      continue;
+    }
+
+    // Check for interrupt
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    auto end = ends.find(top.second);
+    if (end != ends.end() && top.first + targets[end->second].second < best) {
+      best = top.first + targets[end->second].second;
+      meet = top.second;
+    }
+
+    ForArcs(top.second, query_level(top.second),
+            [&](const uint32_t to, const float arc, const uint32_t edge, const uint32_t level) {
+              const float c = top.first + arc;
+              auto inserted = labels.emplace(to, Label{c, top.second, edge, level});
+              if (inserted.second || c < inserted.first->second.cost) {
+                inserted.first->second = Label{c, top.second, edge, level};
+                queue.emplace(c, to);
+              }
+            });
+  }
+  if (meet == kInvalidCellIndex) {
+    return false;
+  }
+
+  // Walk back to the source and unpack the costs between boundary nodes along the way
+  std::vector<uint32_t> nodes;
+  uint32_t node = meet;
+  for (; labels.find(node)->second.pred != kInvalidCellIndex;
+       node = labels.find(node)->second.pred) {
+    nodes.push_back(node);
+  }
+  source = labels.find(node)->second.level;
+  for (auto itr = nodes.rbegin(); itr != nodes.rend(); ++itr) {
+    const auto& label = labels.find(*itr)->second;
+    if (label.edge != kInvalidCellIndex) {
+      path.push_back(label.edge);
+    } else {
+      Unpack(label.level, label.pred, *itr, path);
+    }
+  }
+  target = ends.find(meet)->second;
+  cost = best;
+  return true;
+}
+
+std::vector<std::vector<PathInfo>>
+CellOverlayQuery::GetBestPath(valhalla::Location& origin,
+                              valhalla::Location& dest,
+                              GraphReader& graphreader,
+                              const std::shared_ptr<DynamicCost>* mode_costing,
+                              const TravelMode mode,
+                              const Options& options) {
+  if (!overlay_) {
+    return {};
+  }
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+  const auto& partition = overlay_->partition();
+
+  // As with the contraction hierarchy the search starts at the end node of each origin edge
+  // and ends at the start node of each destination edge
+  struct candidate_t {
+    GraphId edgeid;
+    Cost cost;
+  };
+  std::vector<CellOverlay::seed_t> sources, targets;
+  std::vector<candidate_t> origin_edges, dest_edges;
+  for (const auto& edge : origin.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    uint32_t node = partition.node_index(directededge->endnode());
+    if (node == kInvalidCellIndex) {
+      continue;
+    }
+    Cost cost = costing->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    sources.emplace_back(node, cost.cost);
+    origin_edges.push_back({edgeid, cost});
+  }
+  for (const auto& edge : dest.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    uint32_t node = partition.node_index(graphreader.edge_startnode(edgeid));
+    if (node == kInvalidCellIndex) {
+      continue;
+    }
+    Cost cost = costing->EdgeCost(directededge, tile) * edge.percent_along();
+    targets.emplace_back(node, cost.cost);
+    dest_edges.push_back({edgeid, cost});
+  }
+
+  std::vector<uint32_t> edges;
+  uint32_t source, target;
+  float total;
+  if (sources.empty() || targets.empty() ||
+      !overlay_->Search(sources, targets, edges, source, target, total, interrupt)) {
+    LOG_DEBUG("No cell overlay path found");
+    return {};
+  }
+
+  // Form the path: origin edge, edges of the path (transitions between levels are not edges of
+  // the path) and the destination edge
+  std::vector<PathInfo> path;
+  Cost elapsed = origin_edges[source].cost;
+  path.emplace_back(mode, elapsed.secs, origin_edges[source].edgeid, 0, elapsed.cost, false);
+  for (auto index : edges) {
+    GraphId edgeid(partition.edges[index].edgeid);
+    if (!edgeid.Is_Valid()) {
+      continue;
+    }
+    elapsed += overlay_->edge_cost(index);
+    path.emplace_back(mode, elapsed.secs, edgeid, 0, elapsed.cost, false);
+  }
+  elapsed += dest_edges[target].cost;
+  path.emplace_back(mode, elapsed.secs, dest_edges[target].edgeid, 0, elapsed.cost, false);
+  return {path};
+}
+
+CellOverlayCache::CellOverlayCache(const size_t max_overlays)
+    : max_overlays_(max_overlays), uses_(0) {
+}
+
+CellOverlayCache::overlay_t CellOverlayCache::Get(const std::string& key,
+                                                  const std::function<overlay_t()>& customize) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = overlays_.find(key);
+    if (found != overlays_.end()) {
+      found->second.used = ++uses_;
+      return found->second.overlay;
+    }
+  }
+
+  // Customizing takes a while so other workers keep using the cache meanwhile
+  auto overlay = customize();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (overlays_.size() >= max_overlays_ && overlays_.count(key) == 0) {
+    auto lru = std::min_element(overlays_.begin(), overlays_.end(),
+                                [](const std::pair<const std::string, entry_t>& a,
+                                   const std::pair<const std::string, entry_t>& b) {
+                                  return a.second.used < b.second.used;
+                                });
+    overlays_.erase(lru);
+  }
+  overlays_[key] = entry_t{overlay, ++uses_};
+  return overlay;
+}
+
+size_t CellOverlayCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return overlays_.size();
+}
+
+std::shared_ptr<CellOverlayCache> CellOverlayCache::Global(const size_t max_overlays) {
+  static std::mutex global_mutex;
+  static std::shared_ptr<CellOverlayCache> global_cache;
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (max_overlays == 0) {
+    return nullptr;
+  }
+  if (!global_cache) {
+    global_cache = std::make_shared<CellOverlayCache>(max_overlays);
+  }
+  return global_cache;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,243 @@
+#include "thor/chmatrix.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+using queue_entry_t = std::pair<float, uint32_t>;
+using min_queue_t =
+    std::priority_queue<queue_entry_t, std::vector<queue_entry_t>, std::greater<queue_entry_t>>;
+
+// Same thresholds as CostMatrix so both engines answer the same requests
+float cost_threshold(const valhalla::sif::TravelMode mode, const float max_matrix_distance) {
+  switch (mode) {
+    case TravelMode::kBicycle:
+      return 2.0f * max_matrix_distance / valhalla::thor::kCostThresholdBicycleDivisor;
+    case TravelMode::kPedestrian:
+    case TravelMode::kPublicTransit:
+      return 2.0f * max_matrix_distance / valhalla::thor::kCostThresholdPedestrianDivisor;
+    case TravelMode::kDrive:
+    default:
+      return 2.0f * max_matrix_distance / valhalla::thor::kCostThresholdAutoDivisor;
+  }
+}
+
+bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
+  return a.lat() == b.lat() && a.lng() == b.lng();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+CHMatrix::CHMatrix(const std::shared_ptr<const CHGraph>& graph) : graph_(graph) {
+}
+
+void CHMatrix::Clear() {
+  labels_.clear();
+  buckets_.clear();
+  best_.clear();
+}
+
+std::vector<TimeDistance> CHMatrix::SourceToTarget(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+    GraphReader& graphreader,
+    const std::shared_ptr<DynamicCost>* mode_costing,
+    const TravelMode mode,
+    const float max_matrix_distance) {
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+
+  // Sources start at the end node of their edges with the remaining part of
+  // the edge, targets at the start node with the part before the location.
+  // The distance of the location from the edge is added to the cost like
+  // CostMatrix does.
+  const auto seeds = [&](const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                         const bool source) {
+    std::vector<std::vector<Seed>> all(locations.size());
+    for (int i = 0; i < locations.size(); ++i) {
+      for (const auto& edge : locations.Get(i).path_edges()) {
+        GraphId edgeid(edge.graph_id());
+        const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+        if (tile == nullptr) {
+          continue;
+        }
+        const DirectedEdge* directededge = tile->directededge(edgeid);
+        uint32_t node = graph_->node_index(source ? directededge->endnode()
+                                                  : graphreader.edge_startnode(edgeid));
+        if (node == kInvalidCHIndex) {
+          continue;
+        }
+        float part = source ? 1.0f - edge.percent_along() : edge.percent_along();
+        Cost cost = costing->EdgeCost(directededge, tile) * part;
+        all[i].push_back({node, cost.cost + edge.distance(), cost.secs,
+                          directededge->length() * part});
+      }
+    }
+    return all;
+  };
+  Search(seeds(source_location_list, true), seeds(target_location_list, false),
+         cost_threshold(mode, max_matrix_distance));
+
+  // Pairs on the same edge (source before target) and identical locations
+  // never meet at a node
+  const uint32_t target_count = target_location_list.size();
+  for (int i = 0; i < source_location_list.size(); ++i) {
+    const auto& source = source_location_list.Get(i);
+    for (uint32_t j = 0; j < target_count; ++j) {
+      const auto& target = target_location_list.Get(j);
+      auto& best = best_[i * target_count + j];
+      if (equals(source.ll(), target.ll())) {
+        best = {kInvalidCHIndex, j, 0.0f, 0.0f, 0.0f};
+        continue;
+      }
+      for (const auto& s : source.path_edges()) {
+        for (const auto& t : target.path_edges()) {
+          if (s.graph_id() != t.graph_id() || s.percent_along() > t.percent_along()) {
+            continue;
+          }
+          GraphId edgeid(s.graph_id());
+          const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+          if (tile == nullptr) {
+            continue;
+          }
+          const DirectedEdge* directededge = tile->directededge(edgeid);
+          float part = t.percent_along() - s.percent_along();
+          Cost cost = costing->EdgeCost(directededge, tile) * part;
+          float c = cost.cost + s.distance() + t.distance();
+          if (c < best.cost) {
+            best = {kInvalidCHIndex, j, c, cost.secs, directededge->length() * part};
+          }
+        }
+      }
+    }
+  }
+  return FormTimeDistanceMatrix();
+}
+
+std::vector<TimeDistance> CHMatrix::Compute(const std::vector<std::vector<Seed>>& sources,
+                                            const std::vector<std::vector<Seed>>& targets,
+                                            const float cost_threshold) {
+  Search(sources, targets, cost_threshold);
+  return FormTimeDistanceMatrix();
+}
+
+void CHMatrix::Search(const std::vector<std::vector<Seed>>& sources,
+                      const std::vector<std::vector<Seed>>& targets,
+                      const float cost_threshold) {
+  Clear();
+  const uint32_t target_count = targets.size();
+  best_.resize(sources.size() * target_count, {kInvalidCHIndex, 0, kMaxCost, kMaxCost, kMaxCost});
+  if (!graph_) {
+    return;
+  }
+
+  // Target searches fill the buckets, sorted so a node's entries are contiguous
+  for (uint32_t j = 0; j < target_count; ++j) {
+    Expand(targets[j], j, false, cost_threshold, buckets_);
+  }
+  std::sort(buckets_.begin(), buckets_.end());
+
+  // Each source scans the buckets of the nodes it settles
+  std::vector<Settled> settled;
+  for (uint32_t i = 0; i < sources.size(); ++i) {
+    settled.clear();
+    Expand(sources[i], i, true, cost_threshold, settled);
+    auto* row = best_.data() + i * target_count;
+    for (const auto& s : settled) {
+      auto range = std::equal_range(buckets_.begin(), buckets_.end(),
+                                    Settled{s.node, 0, 0.0f, 0.0f, 0.0f},
+                                    [](const Settled& a, const Settled& b) {
+                                      return a.node < b.node;
+                                    });
+      for (auto entry = range.first; entry != range.second; ++entry) {
+        float cost = s.cost + entry->cost;
+        auto& best = row[entry->location];
+        if (cost < best.cost) {
+          best = {s.node, entry->location, cost, s.secs + entry->secs, s.length + entry->length};
+        }
+      }
+    }
+  }
+  LOG_DEBUG("CHMatrix bucket entries: " + std::to_string(buckets_.size()));
+}
+
+void CHMatrix::Expand(const std::vector<Seed>& seeds,
+                      const uint32_t location,
+                      const bool forward,
+                      const float cost_threshold,
+                      std::vector<Settled>& settled) {
+  labels_.clear();
+  min_queue_t queue;
+  for (const auto& seed : seeds) {
+    auto inserted =
+        labels_.emplace(seed.node, Settled{seed.node, location, seed.cost, seed.secs, seed.length});
+    if (inserted.second || seed.cost < inserted.first->second.cost) {
+      inserted.first->second = {seed.node, location, seed.cost, seed.secs, seed.length};
+      queue.emplace(seed.cost, seed.node);
+    }
+  }
+
+  // Forward searches go up the hierarchy along upward edges, reverse
+  // searches against the downward edges. Stalling looks the other way.
+  const auto& offsets = forward ? graph_->up_offsets : graph_->down_offsets;
+  const auto& edges = forward ? graph_->up_edges : graph_->down_edges;
+  const auto& stall_offsets = forward ? graph_->down_offsets : graph_->up_offsets;
+  const auto& stall_edges = forward ? graph_->down_edges : graph_->up_edges;
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    const auto label = labels_[top.second];
+    if (top.first > label.cost) {
+      continue;
+    }
+    if (top.first > cost_threshold) {
+      break;
+    }
+
+    // Stall on demand: reached cheaper through a higher ranked node
+    const uint32_t node = top.second;
+    bool stalled = false;
+    for (uint32_t i = stall_offsets[node]; i < stall_offsets[node + 1] && !stalled; ++i) {
+      const auto& e = graph_->edges[stall_edges[i]];
+      auto higher = labels_.find(forward ? e.from : e.to);
+      stalled = higher != labels_.end() && higher->second.cost + e.cost < top.first;
+    }
+    if (stalled) {
+      continue;
+    }
+    settled.push_back(label);
+
+    for (uint32_t i = offsets[node]; i < offsets[node + 1]; ++i) {
+      const auto& e = graph_->edges[edges[i]];
+      const uint32_t next = forward ? e.to : e.from;
+      Settled reached{next, location, label.cost + e.cost, label.secs + e.secs,
+                      label.length + e.length};
+      auto inserted = labels_.emplace(next, reached);
+      if (inserted.second || reached.cost < inserted.first->second.cost) {
+        inserted.first->second = reached;
+        queue.emplace(reached.cost, next);
+      }
+    }
+  }
+}
+
+std::vector<TimeDistance> CHMatrix::FormTimeDistanceMatrix() const {
+  std::vector<TimeDistance> td;
+  td.reserve(best_.size());
+  for (const auto& best : best_) {
+    td.emplace_back(std::round(best.secs), std::round(best.length));
+  }
+  return td;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,254 @@
+#include "thor/chquery.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+using queue_entry_t = std::pair<float, uint32_t>;
+using min_queue_t =
+    std::priority_queue<queue_entry_t, std::vector<queue_entry_t>, std::greater<queue_entry_t>>;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+CHQuery::CHQuery(const std::shared_ptr<const CHGraph>& graph) : PathAlgorithm(), graph_(graph) {
+}
+
+CHQuery::~CHQuery() {
+  Clear();
+}
+
+void CHQuery::Clear() {
+  forward_.clear();
+  reverse_.clear();
+  has_ferry_ = false;
+}
+
+bool CHQuery::Supports(const CostingOptions& costing_options) const {
+  return graph_ && graph_->costing_options == costing_options.SerializeAsString();
+}
+
+void CHQuery::Unpack(const uint32_t edge, std::vector<uint32_t>& path) const {
+  // Depth first, the first child of a shortcut comes before the second
+  std::vector<uint32_t> stack{edge};
+  while (!stack.empty()) {
+    const auto& e = graph_->edges[stack.back()];
+    if (e.is_shortcut()) {
+      stack.back() = e.child2;
+      stack.push_back(e.child1);
+    } else {
+      path.push_back(stack.back());
+      stack.pop_back();
+    }
+  }
+}
+
+bool CHQuery::Search(const std::vector<seed_t>& sources,
+                     const std::vector<seed_t>& targets,
+                     std::vector<uint32_t>& path,
+                     uint32_t& source,
+                     uint32_t& target,
+                     float& cost) {
+  path.clear();
+  forward_.clear();
+  reverse_.clear();
+
+  // Seed both searches
+  min_queue_t forward_queue, reverse_queue;
+  const auto seed = [](const std::vector<seed_t>& seeds, std::unordered_map<uint32_t, Label>& labels,
+                       min_queue_t& queue) {
+    for (uint32_t i = 0; i < seeds.size(); ++i) {
+      auto inserted =
+          labels.emplace(seeds[i].first, Label{seeds[i].second, kInvalidCHIndex, i});
+      if (!inserted.second && seeds[i].second < inserted.first->second.cost) {
+        inserted.first->second = Label{seeds[i].second, kInvalidCHIndex, i};
+      }
+      queue.emplace(seeds[i].second, seeds[i].first);
+    }
+  };
+  seed(sources, forward_, forward_queue);
+  seed(targets, reverse_, reverse_queue);
+
+  float best = std::numeric_limits<float>::max();
+  uint32_t meet = kInvalidCHIndex;
+  size_t n = 0;
+  while (true) {
+    // The searches are done once neither can improve on the best connection
+    bool forward = !forward_queue.empty() && forward_queue.top().first < best;
+    bool reverse = !reverse_queue.empty() && reverse_queue.top().first < best;
+    if (!forward && !reverse) {
+      break;
+    }
+    if (forward && reverse) {
+      forward = forward_queue.top().first <= reverse_queue.top().first;
+    }
+
+    // Check for interrupt
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    auto& queue = forward ? forward_queue : reverse_queue;
+    auto& labels = forward ? forward_ : reverse_;
+    auto& other = forward ? reverse_ : forward_;
+    auto top = queue.top();
+    queue.pop();
+    const uint32_t node = top.second;
+    if (top.first > labels[node].cost) {
+      continue;
+    }
+
+    // Connection with the other search
+    auto found = other.find(node);
+    if (found != other.end() && top.first + found->second.cost < best) {
+      best = top.first + found->second.cost;
+      meet = node;
+    }
+
+    // Stall on demand: the node can be reached cheaper through a higher
+    // ranked node so nothing found from here can be on a shortest path.
+    // The forward search looks at the edges coming down into the node and
+    // the reverse search at the edges going up from it.
+    const auto& stall_offsets = forward ? graph_->down_offsets : graph_->up_offsets;
+    const auto& stall_edges = forward ? graph_->down_edges : graph_->up_edges;
+    bool stalled = false;
+    for (uint32_t i = stall_offsets[node]; i < stall_offsets[node + 1] && !stalled; ++i) {
+      const auto& e = graph_->edges[stall_edges[i]];
+      auto higher = labels.find(forward ? e.from : e.to);
+      stalled = higher != labels.end() && higher->second.cost + e.cost < top.first;
+    }
+    if (stalled) {
+      continue;
+    }
+
+    // Relax the edges up the hierarchy (forward) or coming down to the node (reverse)
+    const auto& offsets = forward ? graph_->up_offsets : graph_->down_offsets;
+    const auto& edges = forward ? graph_->up_edges : graph_->down_edges;
+    const uint32_t seed_index = labels[node].seed;
+    for (uint32_t i = offsets[node]; i < offsets[node + 1]; ++i) {
+      const auto& e = graph_->edges[edges[i]];
+      const uint32_t next = forward ? e.to : e.from;
+      const float c = top.first + e.cost;
+      auto inserted = labels.emplace(next, Label{c, edges[i], seed_index});
+      if (inserted.second || c < inserted.first->second.cost) {
+        inserted.first->second = Label{c, edges[i], seed_index};
+        queue.emplace(c, next);
+      }
+    }
+  }
+
+  if (meet == kInvalidCHIndex) {
+    return false;
+  }
+
+  // Walk back to the source and forward to the target, unpacking shortcuts
+  std::vector<uint32_t> edges;
+  uint32_t node = meet;
+  for (auto label = forward_[node]; label.edge != kInvalidCHIndex; label = forward_[node]) {
+    edges.push_back(label.edge);
+    node = graph_->edges[label.edge].from;
+  }
+  source = forward_[node].seed;
+  std::reverse(edges.begin(), edges.end());
+  node = meet;
+  for (auto label = reverse_[node]; label.edge != kInvalidCHIndex; label = reverse_[node]) {
+    edges.push_back(label.edge);
+    node = graph_->edges[label.edge].to;
+  }
+  target = reverse_[node].seed;
+  for (auto e : edges) {
+    Unpack(e, path);
+  }
+  cost = best;
+  return true;
+}
+
+std::vector<std::vector<PathInfo>>
+CHQuery::GetBestPath(valhalla::Location& origin,
+                     valhalla::Location& dest,
+                     GraphReader& graphreader,
+                     const std::shared_ptr<DynamicCost>* mode_costing,
+                     const TravelMode mode,
+                     const Options& options) {
+  if (!graph_) {
+    return {};
+  }
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+
+  // The forward search starts at the end node of each origin edge with the
+  // cost of the remaining part of the edge, the reverse search at the start
+  // node of each destination edge with the cost of the part before it
+  struct candidate_t {
+    GraphId edgeid;
+    Cost cost;
+  };
+  std::vector<seed_t> sources, targets;
+  std::vector<candidate_t> origin_edges, dest_edges;
+  for (const auto& edge : origin.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    uint32_t node = graph_->node_index(directededge->endnode());
+    if (node == kInvalidCHIndex) {
+      continue;
+    }
+    Cost cost = costing->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    sources.emplace_back(node, cost.cost);
+    origin_edges.push_back({edgeid, cost});
+  }
+  for (const auto& edge : dest.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    uint32_t node = graph_->node_index(graphreader.edge_startnode(edgeid));
+    if (node == kInvalidCHIndex) {
+      continue;
+    }
+    Cost cost = costing->EdgeCost(directededge, tile) * edge.percent_along();
+    targets.emplace_back(node, cost.cost);
+    dest_edges.push_back({edgeid, cost});
+  }
+
+  std::vector<uint32_t> edges;
+  uint32_t source, target;
+  float total;
+  if (sources.empty() || targets.empty() || !Search(sources, targets, edges, source, target, total)) {
+    LOG_DEBUG("No contraction hierarchy path found");
+    return {};
+  }
+
+  // Form the path: origin edge, edges of the hierarchy path (transitions
+  // between levels are not edges of the path) and the destination edge
+  std::vector<PathInfo> path;
+  Cost elapsed = origin_edges[source].cost;
+  path.emplace_back(mode, elapsed.secs, origin_edges[source].edgeid, 0, elapsed.cost, false);
+  for (auto index : edges) {
+    const auto& e = graph_->edges[index];
+    if (e.edgeid == kInvalidGraphId) {
+      continue;
+    }
+    elapsed += Cost(e.cost, e.secs);
+    path.emplace_back(mode, elapsed.secs, GraphId(e.edgeid), 0, elapsed.cost, false);
+  }
+  elapsed += dest_edges[target].cost;
+  path.emplace_back(mode, elapsed.secs, dest_edges[target].edgeid, 0, elapsed.cost, false);
+  return {path};
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <cmath>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "midgard/logging.h"
@@ -13,6 +15,10 @@ namespace {
 
 constexpr uint32_t kMaxMatrixIterations = 2000000;
 
+// Each iteration only expands one edge per location, below this many locations
+// waking up the thread pool costs more than it saves
+constexpr uint32_t kMinParallelLocations = 64;
+
 // Find a threshold to continue the search - should be based on
 // the max edge cost in the adjacency set?
 int GetThreshold(const TravelMode mode, const int n) {
@@ -24,6 +30,45 @@ bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
          (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
 }
 
+// Locations snapped to the same edges at the same places along them expand the same way, so only
+// one of them is searched from. Gets which of the different locations each location is and the
+// snapped edges of the different locations
+std::vector<std::string>
+distinct_locations(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                   std::vector<uint32_t>& distinct_index) {
+  std::vector<std::string> distinct;
+  std::unordered_map<std::string, uint32_t> seen;
+  distinct_index.clear();
+  for (const auto& location : locations) {
+    std::string key;
+    for (const auto& edge : location.path_edges()) {
+      auto serialized = edge.SerializeAsString();
+      key += std::to_string(serialized.size());
+      key.push_back(':');
+      key += serialized;
+    }
+    auto inserted = seen.emplace(key, distinct.size());
+    if (inserted.second) {
+      distinct.push_back(std::move(key));
+    }
+    distinct_index.push_back(inserted.first->second);
+  }
+  return distinct;
+}
+
+// The first of each of the different locations
+google::protobuf::RepeatedPtrField<valhalla::Location>
+first_locations(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                const std::vector<uint32_t>& distinct_index) {
+  google::protobuf::RepeatedPtrField<valhalla::Location> first;
+  for (int i = 0; i < locations.size(); ++i) {
+    if (distinct_index[i] == static_cast<uint32_t>(first.size())) {
+      first.Add()->CopyFrom(locations.Get(i));
+    }
+  }
+  return first;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -31,8 +76,11 @@ namespace thor {
 
 // Constructor with cost threshold.
 CostMatrix::CostMatrix()
-    : mode_(TravelMode::kDrive), access_mode_(kAutoAccess), source_count_(0), remaining_sources_(0),
-      target_count_(0), remaining_targets_(0), current_cost_threshold_(0) {
+    : queue_type_(LabelQueueType::kDoubleBucket), thread_pool_(nullptr), interrupt_(nullptr),
+      symmetric_(false), targets_are_sources_(false), max_time_(0), mode_(TravelMode::kDrive),
+      access_mode_(kAutoAccess), source_count_(0), remaining_sources_(0), target_count_(0),
+      remaining_targets_(0), current_cost_threshold_(0),
+      edgestatus_pool_(std::make_shared<EdgeStatusPool>()), target_marks_(edgestatus_pool_) {
 }
 
 float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
@@ -59,6 +107,7 @@ float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
 // construction.
 void CostMatrix::Clear() {
   // Clear the target edge markings
+  target_marks_.clear();
   targets_.clear();
 
   // Clear all source adjacency lists, edge labels, and edge status
@@ -97,6 +146,17 @@ void CostMatrix::Clear() {
   target_hierarchy_limits_.clear();
   source_status_.clear();
   target_status_.clear();
+  for (auto& reached : reached_edges_) {
+    reached.clear();
+  }
+  for (auto& pending : pending_status_) {
+    pending.clear();
+  }
+  for (auto& settled : settled_) {
+    settled.clear();
+  }
+  exhausted_.clear();
+  targets_are_sources_ = false;
 }
 
 // Form a time distance matrix from the set of source locations
@@ -113,50 +173,69 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   access_mode_ = costing_->access_mode();
 
+  // Neither search goes past the time of the pairs that are wanted, a path within it is still
+  // found as the search from its source alone gets to the edges of its target
   current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
+  if (max_time_ > 0) {
+    current_cost_threshold_ = std::min(current_cost_threshold_, max_time_);
+  }
+
+  // Search from one of each of the locations that snapped the same way
+  std::vector<uint32_t> source_index, target_index;
+  auto distinct_sources = distinct_locations(source_location_list, source_index);
+  auto distinct_targets = distinct_locations(target_location_list, target_index);
+  google::protobuf::RepeatedPtrField<valhalla::Location> first_sources, first_targets;
+  const auto* sources = &source_location_list;
+  if (distinct_sources.size() < static_cast<size_t>(source_location_list.size())) {
+    first_sources = first_locations(source_location_list, source_index);
+    sources = &first_sources;
+  }
+  const auto* targets = &target_location_list;
+  if (distinct_targets.size() < static_cast<size_t>(target_location_list.size())) {
+    first_targets = first_locations(target_location_list, target_index);
+    targets = &first_targets;
+  }
 
-  // Set the source and target locations
+  // Set the source and target locations, the targets are searched from as sources when they are
+  // the same and the costs are the same both ways
   Clear();
-  SetSources(graphreader, source_location_list);
-  SetTargets(graphreader, target_location_list);
+  targets_are_sources_ = symmetric_ && distinct_sources == distinct_targets;
+  SetSources(graphreader, *sources);
+  if (targets_are_sources_) {
+    target_count_ = source_count_;
+  } else {
+    SetTargets(graphreader, *targets);
+  }
+  reached_edges_.resize(target_count_);
+  settled_.resize(source_count_);
+  exhausted_.assign(source_count_, 0);
+  pending_status_.resize(std::max(source_count_, target_count_));
 
   // Initialize best connections and status. Any locations that are the
   // same get set to 0 time, distance and are not added to the remaining
   // location set.
-  Initialize(source_location_list, target_location_list);
+  Initialize(*sources, *targets);
 
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
-  // spaces is checked during the forward search.
+  // spaces is checked during the forward search. Every iteration expands a
+  // label of each location so the interrupt is checked about as often as in
+  // the path algorithms.
+  const int interrupt_interval =
+      std::max<int>(kInterruptIterationsInterval / (source_count_ + target_count_), 1);
   int n = 0;
   while (true) {
+    if (interrupt_ && (n % interrupt_interval) == 0) {
+      (*interrupt_)();
+    }
+
     // Iterate all target locations in a backwards search
-    for (uint32_t i = 0; i < target_count_; i++) {
-      if (target_status_[i].threshold > 0) {
-        target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        if (target_status_[i].threshold == 0) {
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
-          }
-        }
-      }
+    if (!targets_are_sources_) {
+      Iterate(false, n, graphreader);
     }
 
     // Iterate all source locations in a forward search
-    for (uint32_t i = 0; i < source_count_; i++) {
-      if (source_status_[i].threshold > 0) {
-        source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader);
-        if (source_status_[i].threshold == 0) {
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
-          }
-        }
-      }
-    }
+    Iterate(true, n, graphreader);
 
     // Break out when remaining sources and targets to expand are both 0
     if (remaining_sources_ == 0 && remaining_targets_ == 0) {
@@ -172,12 +251,23 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
     n++;
   }
 
-  // Form the time, distance matrix from the destinations list
-  uint32_t idx = 0;
+  // Form the time, distance matrix from the destinations list, locations that snapped the same
+  // way as another get its row or column
   std::vector<TimeDistance> td;
-  for (const auto& connection : best_connection_) {
-    td.emplace_back(std::round(connection.cost.secs), std::round(connection.distance));
-    idx++;
+  td.reserve(source_index.size() * target_index.size());
+  for (int i = 0; i < source_location_list.size(); i++) {
+    for (int j = 0; j < target_location_list.size(); j++) {
+      if (equals(source_location_list.Get(i).ll(), target_location_list.Get(j).ll())) {
+        td.emplace_back(0, 0);
+        continue;
+      }
+      const auto& connection = best_connection_[source_index[i] * target_count_ + target_index[j]];
+      if (max_time_ > 0 && connection.cost.secs > max_time_) {
+        td.emplace_back(kMaxCost, kMaxCost);
+        continue;
+      }
+      td.emplace_back(std::round(connection.cost.secs), std::round(connection.distance));
+    }
   }
   return td;
 }
@@ -231,6 +321,104 @@ void CostMatrix::Initialize(
   }
 }
 
+// Run one iteration of the forward or backward searches. The searches of
+// different locations only write to their own labels, status and row of best
+// connections, anything shared is recorded and applied afterwards in location
+// order so the result does not depend on how the searches were scheduled.
+void CostMatrix::Iterate(const bool forward, const uint32_t n, GraphReader& graphreader) {
+  // The search from a source is also the search to the target with its index when the sources
+  // are the targets, it goes on while either of them has to
+  const bool both = forward && targets_are_sources_;
+  auto& status = forward ? source_status_ : target_status_;
+  active_.clear();
+  for (uint32_t i = 0; i < status.size(); i++) {
+    bool active = false;
+    if (status[i].threshold > 0) {
+      status[i].threshold--;
+      active = true;
+    }
+    if (both && target_status_[i].threshold > 0) {
+      target_status_[i].threshold--;
+      active = true;
+    }
+    if (active) {
+      active_.push_back(i);
+    }
+  }
+
+  const auto run = [this, &graphreader](const std::function<void(const uint32_t)>& step) {
+    if (thread_pool_ != nullptr && active_.size() >= kMinParallelLocations &&
+        graphreader.IsThreadSafe()) {
+      thread_pool_->parallel_for(active_.size(), step);
+    } else {
+      for (uint32_t i = 0; i < active_.size(); i++) {
+        step(i);
+      }
+    }
+  };
+  run([this, forward, n, &graphreader](const uint32_t i) {
+    if (forward) {
+      ForwardSearch(active_[i], n, graphreader);
+    } else {
+      BackwardSearch(active_[i], graphreader);
+    }
+  });
+
+  // Add to the list of targets that have reached these edges
+  if (!forward || both) {
+    for (const auto index : active_) {
+      for (const auto& reached : reached_edges_[index]) {
+        MarkTarget(reached.first, reached.second, index);
+      }
+      reached_edges_[index].clear();
+    }
+  }
+
+  // Now that no search changes, the sources look for the targets they connect to
+  if (both) {
+    run([this, n](const uint32_t i) { CheckSettled(active_[i], n); });
+  }
+
+  for (const auto index : active_) {
+    for (const auto& pending : pending_status_[index]) {
+      ApplyStatus(pending);
+    }
+    pending_status_[index].clear();
+
+    if (status[index].threshold == 0) {
+      status[index].threshold = -1;
+      uint32_t& remaining = forward ? remaining_sources_ : remaining_targets_;
+      if (remaining > 0) {
+        remaining--;
+      }
+    }
+    if (both && target_status_[index].threshold == 0) {
+      target_status_[index].threshold = -1;
+      if (remaining_targets_ > 0) {
+        remaining_targets_--;
+      }
+    }
+  }
+}
+
+// Check the connections of the edges a source settled, and update the status of everything it
+// could not reach if it ran out of edges
+void CostMatrix::CheckSettled(const uint32_t index, const uint32_t n) {
+  if (exhausted_[index]) {
+    exhausted_[index] = 0;
+    for (uint32_t target = 0; target < target_count_; target++) {
+      UpdateStatus(index, index, target);
+    }
+    for (uint32_t source = 0; source < source_count_; source++) {
+      UpdateStatus(index, source, index);
+    }
+  }
+  for (const auto& pred : settled_[index]) {
+    CheckForwardConnections(index, pred, n);
+  }
+  settled_[index].clear();
+}
+
 // Iterate the forward search from the source/origin location.
 void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphReader& graphreader) {
   // Get the next edge from the adjacency list for this source location
@@ -239,18 +427,27 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   uint32_t pred_idx = adj->pop();
   if (pred_idx == kInvalidLabel) {
     // Forward search is exhausted - mark this and update so we don't
-    // extend searches more than we need to
-    for (uint32_t target = 0; target < target_count_; target++) {
-      UpdateStatus(index, target);
+    // extend searches more than we need to. When the sources are the
+    // targets the others may still be searching so it is done after
+    if (targets_are_sources_) {
+      exhausted_[index] = 1;
+      target_status_[index].threshold = std::min(target_status_[index].threshold, 0);
+    } else {
+      for (uint32_t target = 0; target < target_count_; target++) {
+        UpdateStatus(index, index, target);
+      }
     }
-    source_status_[index].threshold = 0;
+    source_status_[index].threshold = std::min(source_status_[index].threshold, 0);
     return;
   }
 
   // Get edge label and check cost threshold
   BDEdgeLabel pred = edgelabels[pred_idx];
   if (pred.cost().secs > current_cost_threshold_) {
-    source_status_[index].threshold = 0;
+    source_status_[index].threshold = std::min(source_status_[index].threshold, 0);
+    if (targets_are_sources_) {
+      target_status_[index].threshold = std::min(target_status_[index].threshold, 0);
+    }
     return;
   }
 
@@ -258,8 +455,13 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   auto& edgestate = source_edgestatus_[index];
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
 
-  // Check for connections to backwards search.
-  CheckForwardConnections(index, pred, n);
+  // Check for connections to backwards search, after every search did this
+  // iteration when the sources are the targets
+  if (targets_are_sources_) {
+    settled_[index].push_back(pred);
+  } else {
+    CheckForwardConnections(index, pred, n);
+  }
 
   // Prune path if predecessor is not a through edge
   if (pred.not_thru() && pred.not_thru_pruning()) {
@@ -284,18 +486,32 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
     uint32_t shortcuts = 0;
     GraphId edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
     EdgeStatusInfo* es = edgestate.GetPtr(edgeid, tile);
-    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
+
+    // Check access and get the costs of all of the edges of the node at once
+    AllowedEdges allowed;
+    costing_->GetAllowedEdges(directededge, nodeinfo->edge_count(), edgeid, pred, tile,
+                              kInvalidSecondsOfWeek, allowed);
+    uint32_t next_allowed = 0;
     for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
+      // The slot of this edge in the allowed edges, or -1 if it is not allowed
+      int32_t slot = -1;
+      if (next_allowed < allowed.count && allowed.index[next_allowed] == i) {
+        slot = next_allowed++;
+      }
+
       // Skip shortcut edges until we have stopped expanding on the next level. Use regular
       // edges while still expanding on the next level since we can still transition down to
-      // that level. If using a shortcut, set the shortcuts mask. Skip if this is a regular
-      // edge superseded by a shortcut.
+      // that level. If using a shortcut the costing allows, set the shortcuts mask. Otherwise
+      // its regular edges are the way around what it is not allowed on. Skip if this is a
+      // regular edge superseded by a shortcut.
       if (directededge->is_shortcut()) {
-        if (hierarchy_limits[edgeid.level() + 1].StopExpanding()) {
-          shortcuts |= directededge->shortcut();
-        } else {
+        if (!hierarchy_limits[edgeid.level() + 1].StopExpanding()) {
           continue;
         }
+        if (slot >= 0) {
+          shortcuts |= directededge->shortcut();
+        }
       } else if (shortcuts & directededge->superseded()) {
         continue;
       }
@@ -308,15 +524,14 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
 
       // Skip this edge if no access is allowed (based on costing method)
       // or if a complex restriction prevents transition onto this edge.
-      bool has_time_restrictions = false;
-      if (!costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
-          costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, true)) {
+      if (slot < 0 || costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, true)) {
         continue;
       }
+      bool has_time_restrictions = allowed.has_time_restrictions[slot];
 
       // Get cost. Separate out transition cost.
       Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-      Cost newcost = pred.cost() + tc + costing_->EdgeCost(directededge, tile);
+      Cost newcost = pred.cost() + tc + allowed.cost[slot];
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -336,6 +551,10 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
       if (t2 == nullptr) {
         continue;
       }
+      if (directededge->leaves_tile()) {
+        // Start loading what is past this tile since the searches spread out in all directions
+        graphreader.PrefetchNeighbors(directededge->endnode());
+      }
       GraphId oppedge = t2->GetOpposingEdgeId(directededge);
 
       // Add edge label, add to the adjacency list and set edge status
@@ -346,11 +565,16 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
                               (pred.not_thru_pruning() || !directededge->not_thru()),
                               has_time_restrictions);
       adj->add(idx);
+
+      // The search to the target with this index reached the edge too
+      if (targets_are_sources_) {
+        reached_edges_[index].emplace_back(edgeid, tile);
+      }
     }
 
     // Handle transitions - expand from the end node of the transition
     if (!from_transition && nodeinfo->transition_count() > 0) {
-      const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+      const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
       for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
         if (trans->up()) {
           hierarchy_limits[node.level()].up_transition_count++;
@@ -395,13 +619,13 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
   // Get the opposing edge. Get a list of target locations whose reverse
   // search has reached this edge.
   GraphId oppedge = pred.opp_edgeid();
-  auto targets = targets_.find(oppedge);
-  if (targets == targets_.end()) {
+  EdgeStatusInfo mark = target_marks_.GetShared(oppedge);
+  if (mark.set() == EdgeSet::kUnreached) {
     return;
   }
 
   // Iterate through the targets
-  for (auto target : targets->second) {
+  for (auto target : targets_[mark.index()]) {
     uint32_t idx = source * target_count_ + target;
     if (best_connection_[idx].found) {
       continue;
@@ -413,13 +637,13 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
       continue;
     }
 
-    const auto& edgestate = target_edgestatus_[target];
+    const auto& edgestate = target_edgestatus(target);
 
     // If this edge has been reached then a shortest path has been found
     // to the end node of this directed edge.
-    EdgeStatusInfo oppedgestatus = edgestate.Get(oppedge);
+    EdgeStatusInfo oppedgestatus = edgestate.GetShared(oppedge);
     if (oppedgestatus.set() != EdgeSet::kUnreached) {
-      const auto& edgelabels = target_edgelabel_[target];
+      const auto& edgelabels = target_edgelabels(target);
       uint32_t predidx = edgelabels[oppedgestatus.index()].predecessor();
       const BDEdgeLabel& opp_el = edgelabels[oppedgestatus.index()];
 
@@ -437,7 +661,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        UpdateStatus(source, source, target);
       } else {
         float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels[predidx].cost().cost;
         float c = pred.cost().cost + oppcost + opp_el.transition_cost();
@@ -453,21 +677,31 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
           best_connection_[idx].Update(pred.edgeid(), oppedge, Cost(c, s), d);
           if (best_connection_[idx].threshold == 0) {
             best_connection_[idx].threshold =
-                n + GetThreshold(mode_,
-                                 source_edgelabel_[source].size() + target_edgelabel_[target].size());
+                n + GetThreshold(mode_, source_edgelabel_[source].size() + edgelabels.size());
           }
 
           // Update status and update threshold if this is the last location
           // to find for this source or target
-          UpdateStatus(source, target);
+          UpdateStatus(source, source, target);
         }
       }
     }
   }
 }
 
-// Update status when a connection is found.
-void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
+// Record a status update when a connection is found. The threshold is taken
+// now while the edge labels are the ones the connection was found with.
+void CostMatrix::UpdateStatus(const uint32_t step, const uint32_t source, const uint32_t target) {
+  pending_status_[step].push_back(
+      {source, target,
+       GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabels(target).size())});
+}
+
+// Update status for a connection that was found.
+void CostMatrix::ApplyStatus(const PendingStatus& status) {
+  const uint32_t source = status.source;
+  const uint32_t target = status.target;
+
   // Remove the target from the source status
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
@@ -476,8 +710,7 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
     if (s.empty() && source_status_[source].threshold > 0) {
       // At least 1 connection has been found to each target for this source.
       // Set a threshold to continue search for a limited number of times.
-      source_status_[source].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      source_status_[source].threshold = status.threshold;
     }
   }
 
@@ -489,12 +722,21 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
     if (t.empty() && target_status_[target].threshold > 0) {
       // At least 1 connection has been found to each source for this target.
       // Set a threshold to continue search for a limited number of times.
-      target_status_[target].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      target_status_[target].threshold = status.threshold;
     }
   }
 }
 
+// The first target to reach an edge gives it a list of targets, the others join it
+void CostMatrix::MarkTarget(const GraphId& edgeid, const GraphTile* tile, const uint32_t target) {
+  EdgeStatusInfo* mark = target_marks_.GetPtr(edgeid, tile);
+  if (mark->set() == EdgeSet::kUnreached) {
+    *mark = {EdgeSet::kTemporary, static_cast<uint32_t>(targets_.size())};
+    targets_.emplace_back();
+  }
+  targets_[mark->index()].push_back(target);
+}
+
 // Expand the backwards search trees.
 void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader) {
   // Get the next edge from the adjacency list for this target location
@@ -505,7 +747,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
     // Backward search is exhausted - mark this and update so we don't
     // extend searches more than we need to
     for (uint32_t source = 0; source < source_count_; source++) {
-      UpdateStatus(source, index);
+      UpdateStatus(index, source, index);
     }
     target_status_[index].threshold = 0;
     return;
@@ -546,16 +788,15 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
     uint32_t shortcuts = 0;
     GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
     EdgeStatusInfo* es = edgestate.GetPtr(edgeid, tile);
-    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
     for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
       // Skip shortcut edges until we have stopped expanding on the next level. Use regular
       // edges while still expanding on the next level since we can still transition down to
-      // that level. If using a shortcut, set the shortcuts mask. Skip if this is a regular
-      // edge superseded by a shortcut.
+      // that level. Once a shortcut is found to be allowed by the costing set the shortcuts
+      // mask, until then its regular edges are the way around what it is not allowed on. Skip
+      // if this is a regular edge superseded by a shortcut.
       if (directededge->is_shortcut()) {
-        if (hierarchy_limits[edgeid.level() + 1].StopExpanding()) {
-          shortcuts |= directededge->shortcut();
-        } else {
+        if (!hierarchy_limits[edgeid.level() + 1].StopExpanding()) {
           continue;
         }
       } else if (shortcuts & directededge->superseded()) {
@@ -565,6 +806,9 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       // Skip edges not allowed by the access mode. Do this here to avoid having
       // to get opposing edge. Also skip edges that are permanently labeled (
       // best path already found to this directed edge).
+      if (es->set() == EdgeSet::kPermanent && directededge->is_shortcut()) {
+        shortcuts |= directededge->shortcut();
+      }
       if (!(directededge->reverseaccess() & access_mode_) || es->set() == EdgeSet::kPermanent) {
         continue;
       }
@@ -575,6 +819,10 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       if (t2 == nullptr) {
         continue;
       }
+      if (directededge->leaves_tile()) {
+        // Start loading what is past this tile since the searches spread out in all directions
+        graphreader.PrefetchNeighbors(directededge->endnode());
+      }
       GraphId oppedge = t2->GetOpposingEdgeId(directededge);
 
       // Skip this edge if no access is allowed (based on costing method)
@@ -586,6 +834,9 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
           costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, false)) {
         continue;
       }
+      if (directededge->is_shortcut()) {
+        shortcuts |= directededge->shortcut();
+      }
 
       // Get cost. Use opposing edge for EdgeCost. Separate the transition seconds so
       // we can properly recover elapsed time on the reverse path.
@@ -614,13 +865,13 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
                               has_time_restrictions);
       adj->add(idx);
 
-      // Add to the list of targets that have reached this edge
-      targets_[edgeid].push_back(index);
+      // Remember this edge was reached, the target marks are updated after the iteration
+      reached_edges_[index].emplace_back(edgeid, tile);
     }
 
     // Handle transitions - expand from the end node of the transition
     if (!from_transition && nodeinfo->transition_count() > 0) {
-      const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+      const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
       for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
         if (trans->up()) {
           hierarchy_limits[node.level()].up_transition_count++;
@@ -666,7 +917,10 @@ void CostMatrix::SetSources(GraphReader& graphreader,
   // Allocate edge labels and edge status
   source_count_ = sources.size();
   source_edgelabel_.resize(source_count_);
-  source_edgestatus_.resize(source_count_);
+  source_edgestatus_.reserve(source_count_);
+  while (source_edgestatus_.size() < source_count_) {
+    source_edgestatus_.emplace_back(edgestatus_pool_);
+  }
   source_adjacency_.resize(source_count_);
   source_hierarchy_limits_.resize(source_count_);
 
@@ -681,8 +935,8 @@ void CostMatrix::SetSources(GraphReader& graphreader,
 
     // Allocate the adjacency list and hierarchy limits for this source.
     // Use the cost threshold to size the adjacency list.
-    source_adjacency_[index].reset(
-        new DoubleBucketQueue(0, current_cost_threshold_, costing_->UnitSize(), edgecost));
+    source_adjacency_[index] =
+        make_label_queue(queue_type_, 0, current_cost_threshold_, costing_->UnitSize(), edgecost);
     source_hierarchy_limits_[index] = costing_->GetHierarchyLimits();
 
     // Iterate through edges and add to adjacency list
@@ -731,6 +985,9 @@ void CostMatrix::SetSources(GraphReader& graphreader,
       source_edgelabel_[index].push_back(std::move(edge_label));
       source_adjacency_[index]->add(idx);
       source_edgestatus_[index].Set(edgeid, EdgeSet::kUnreached, idx, tile);
+      if (targets_are_sources_) {
+        MarkTarget(edgeid, tile, index);
+      }
     }
     index++;
   }
@@ -743,7 +1000,10 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
   // Allocate target edge labels and edge status
   target_count_ = targets.size();
   target_edgelabel_.resize(targets.size());
-  target_edgestatus_.resize(targets.size());
+  target_edgestatus_.reserve(target_count_);
+  while (target_edgestatus_.size() < target_count_) {
+    target_edgestatus_.emplace_back(edgestatus_pool_);
+  }
   target_adjacency_.resize(targets.size());
   target_hierarchy_limits_.resize(targets.size());
 
@@ -758,8 +1018,8 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
 
     // Allocate the adjacency list and hierarchy limits for target location.
     // Use the cost threshold to size the adjacency list.
-    target_adjacency_[index].reset(
-        new DoubleBucketQueue(0, current_cost_threshold_, costing_->UnitSize(), edgecost));
+    target_adjacency_[index] =
+        make_label_queue(queue_type_, 0, current_cost_threshold_, costing_->UnitSize(), edgecost);
     target_hierarchy_limits_[index] = costing_->GetHierarchyLimits();
 
     // Iterate through edges and add to adjacency list
@@ -817,9 +1077,9 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
       uint32_t idx = target_edgelabel_[index].size();
       target_edgelabel_[index].push_back(std::move(edge_label));
       target_adjacency_[index]->add(idx);
-      target_edgestatus_[index].Set(opp_edge_id, EdgeSet::kUnreached, idx,
-                                    graphreader.GetGraphTile(opp_edge_id));
-      targets_[opp_edge_id].push_back(index);
+      const GraphTile* opp_tile = graphreader.GetGraphTile(opp_edge_id);
+      target_edgestatus_[index].Set(opp_edge_id, EdgeSet::kUnreached, idx, opp_tile);
+      MarkTarget(opp_edge_id, opp_tile, index);
     }
     index++;
   }
@@ -0,0 +1,147 @@
+#include "thor/depotoracle.h"
+#include "sif/costingcache.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+bool DepotReach::Get(const valhalla::Location& location,
+                     GraphReader& graphreader,
+                     const sif::DynamicCost& costing,
+                     TimeDistance& result) const {
+  bool found = false;
+  sif::Cost best{kMaxCost, kMaxCost};
+  for (const auto& edge : location.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    if (costing.AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    // The edge was settled through the graph, or the depot is on it behind the location
+    const EdgeReach* reach = nullptr;
+    auto settled = std::lower_bound(edges.cbegin(), edges.cend(), edge.graph_id(),
+                                    [](const EdgeReach& reach, const uint64_t edgeid) {
+                                      return reach.edgeid < edgeid;
+                                    });
+    if (settled != edges.cend() && settled->edgeid == edge.graph_id()) {
+      reach = &*settled;
+    }
+    for (const auto& origin : origins) {
+      if (origin.second.edgeid == edge.graph_id() && origin.first <= edge.percent_along() &&
+          (!reach || origin.second.cost < reach->cost)) {
+        reach = &origin.second;
+      }
+    }
+    if (!reach) {
+      continue;
+    }
+
+    // Take off the part of the edge beyond the location
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    float remainder = 1.0f - edge.percent_along();
+    sif::Cost cost =
+        sif::Cost(reach->cost, reach->secs) - costing.EdgeCost(directededge, tile) * remainder;
+    if (cost.cost < best.cost) {
+      best = cost;
+      result = TimeDistance(cost.secs, reach->distance - directededge->length() * remainder);
+      found = true;
+    }
+  }
+  return found;
+}
+
+DepotOracle::DepotOracle(const std::vector<midgard::PointLL>& depots,
+                         const size_t max_depots,
+                         const uint32_t max_age)
+    : max_depots_(max_depots), max_age_(max_age) {
+  for (const auto& depot : depots) {
+    depots_.insert(Cell(depot.lng(), depot.lat()));
+  }
+}
+
+// Five decimals of a degree are about a meter
+uint64_t DepotOracle::Cell(const double lng, const double lat) {
+  auto x = static_cast<uint64_t>(std::llround((lng + 180.0) * 1e5));
+  auto y = static_cast<uint64_t>(std::llround((lat + 90.0) * 1e5));
+  return (y << 32) | x;
+}
+
+bool DepotOracle::IsDepot(const valhalla::Location& location) const {
+  return location.has_ll() && depots_.count(Cell(location.ll().lng(), location.ll().lat())) != 0;
+}
+
+DepotOracle::reach_t DepotOracle::Find(const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = reaches_.find(key);
+  if (found == reaches_.end() || (max_age_.count() != 0 &&
+                                  std::chrono::steady_clock::now() - found->second.computed >=
+                                      max_age_)) {
+    return nullptr;
+  }
+  return found->second.reach;
+}
+
+void DepotOracle::Put(const std::string& key, const reach_t& reach) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto now = std::chrono::steady_clock::now();
+  auto found = reaches_.find(key);
+  if (found != reaches_.end()) {
+    found->second = {reach, now};
+    return;
+  }
+  if (reaches_.size() >= max_depots_) {
+    reaches_.clear();
+  }
+  reaches_.emplace(key, entry_t{reach, now});
+}
+
+size_t DepotOracle::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return reaches_.size();
+}
+
+void DepotOracle::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  reaches_.clear();
+}
+
+// The search from a depot reads the costing and the edges the depot snapped to, matrices do not
+// use the time so it is not part of the key
+std::string
+DepotOracle::Key(const Costing costing, const Options& options, const valhalla::Location& depot) {
+  std::string key = sif::CostingCache::Key(costing, options);
+  for (const auto& edge : depot.path_edges()) {
+    auto serialized = edge.SerializeAsString();
+    key.push_back(':');
+    key += std::to_string(serialized.size());
+    key.push_back(':');
+    key += serialized;
+  }
+  return key;
+}
+
+std::shared_ptr<DepotOracle> DepotOracle::Global(const std::vector<midgard::PointLL>& depots,
+                                                 const size_t max_depots,
+                                                 const uint32_t max_age) {
+  static std::mutex global_mutex;
+  static std::shared_ptr<DepotOracle> global_oracle;
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (depots.empty() || max_depots == 0) {
+    return nullptr;
+  }
+  if (!global_oracle) {
+    global_oracle = std::make_shared<DepotOracle>(depots, max_depots, max_age);
+  }
+  return global_oracle;
+}
+
+} // namespace thor
+} // namespace valhalla
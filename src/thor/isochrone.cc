@@ -43,10 +43,15 @@ namespace thor {
 constexpr uint32_t kBucketCount = 20000;
 constexpr uint32_t kInitialEdgeLabelCount = 500000;
 
+// Segments of settled edges to collect before drawing them into the isotile
+constexpr size_t kSegmentBatch = 65536;
+
 // Default constructor
 Isochrone::Isochrone()
     : has_date_time_(false), start_tz_index_(0), access_mode_(kAutoAccess), shape_interval_(50.0f),
-      mode_(TravelMode::kDrive), adjacencylist_(nullptr) {
+      mode_(TravelMode::kDrive), edgelabel_arena_(kInitialEdgeLabelCount),
+      bdedgelabel_arena_(kInitialEdgeLabelCount), mmedgelabel_arena_(kInitialEdgeLabelCount),
+      adjacencylist_(nullptr) {
 }
 
 // Destructor
@@ -56,13 +61,16 @@ Isochrone::~Isochrone() {
 
 // Clear the temporary information generated during path construction.
 void Isochrone::Clear() {
-  // Clear the edge labels, edge status flags, and adjacency list
-  // TODO - clear only the edge label set that was used?
-  edgelabels_.clear();
-  bdedgelabels_.clear();
-  mmedgelabels_.clear();
-  adjacencylist_.reset();
+  // Clear the edge labels, edge status flags, and adjacency list. The
+  // storage is kept for the next search.
+  edgelabel_arena_.recycle(edgelabels_);
+  bdedgelabel_arena_.recycle(bdedgelabels_);
+  mmedgelabel_arena_.recycle(mmedgelabels_);
+  if (adjacencylist_) {
+    adjacencylist_->clear();
+  }
   edgestatus_.clear();
+  segments_.clear();
 }
 
 // Construct the isotile. Use a fixed grid size. Convert time in minutes to
@@ -150,42 +158,54 @@ void Isochrone::ConstructIsoTile(
   }
 }
 
-// Initialize - create adjacency list, edgestatus support, and reserve
-// edgelabels
+// Initialize - create (or reuse) adjacency list, edgestatus support, and
+// reserve edgelabels
 void Isochrone::Initialize(const uint32_t bucketsize) {
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  edgelabel_arena_.reserve(edgelabels_);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
 
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  if (adjacencylist_) {
+    adjacencylist_->reuse(0.0f, range, bucketsize, edgecost);
+  } else {
+    adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  }
   edgestatus_.clear();
 }
 
-// Initialize - create adjacency list, edgestatus support, and reserve
-// edgelabels
+// Initialize - create (or reuse) adjacency list, edgestatus support, and
+// reserve edgelabels
 void Isochrone::InitializeReverse(const uint32_t bucketsize) {
-  bdedgelabels_.reserve(kInitialEdgeLabelCount);
+  bdedgelabel_arena_.reserve(bdedgelabels_);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return bdedgelabels_[label].sortcost(); };
 
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  if (adjacencylist_) {
+    adjacencylist_->reuse(0.0f, range, bucketsize, edgecost);
+  } else {
+    adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  }
   edgestatus_.clear();
 }
 
-// Initialize - create adjacency list, edgestatus support, and reserve
-// edgelabels
+// Initialize - create (or reuse) adjacency list, edgestatus support, and
+// reserve edgelabels
 void Isochrone::InitializeMultiModal(const uint32_t bucketsize) {
-  mmedgelabels_.reserve(kInitialEdgeLabelCount);
+  mmedgelabel_arena_.reserve(mmedgelabels_);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return mmedgelabels_[label].sortcost(); };
 
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  if (adjacencylist_) {
+    adjacencylist_->reuse(0.0f, range, bucketsize, edgecost);
+  } else {
+    adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  }
   edgestatus_.clear();
 }
 
@@ -288,7 +308,7 @@ void Isochrone::ExpandForward(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true, localtime, seconds_of_week);
     }
@@ -347,7 +367,7 @@ Isochrone::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origi
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
-      return isotile_;
+      return DrawIsoTile();
     }
 
     // Copy the EdgeLabel for use in costing and settle the edge.
@@ -368,10 +388,10 @@ Isochrone::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origi
     // Return after the time interval has been met
     if (pred.cost().secs > max_seconds || pred.cost().cost > max_seconds * 4) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
-      return isotile_;
+      return DrawIsoTile();
     }
   }
-  return isotile_; // Should never get here
+  return DrawIsoTile(); // Should never get here
 }
 
 // Expand from a node in reverse direction.
@@ -482,7 +502,7 @@ void Isochrone::ExpandReverse(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true, localtime,
                     seconds_of_week);
@@ -542,7 +562,7 @@ Isochrone::ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Location>
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
-      return isotile_;
+      return DrawIsoTile();
     }
 
     // Copy the EdgeLabel for use in costing and settle the edge.
@@ -567,10 +587,10 @@ Isochrone::ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Location>
     // Return after the time interval has been met
     if (pred.cost().secs > max_seconds || pred.cost().cost > max_seconds * 4) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
-      return isotile_;
+      return DrawIsoTile();
     }
   }
-  return isotile_; // Should never get here
+  return DrawIsoTile(); // Should never get here
 }
 
 // Expand from a node using multi-modal algorithm.
@@ -672,7 +692,7 @@ bool Isochrone::ExpandForwardMM(GraphReader& graphreader,
   // Expand from end node.
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
     // Skip shortcut edges and edges that are permanently labeled (best
     // path already found to this directed edge).
@@ -843,7 +863,7 @@ bool Isochrone::ExpandForwardMM(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       ExpandForwardMM(graphreader, trans->endnode(), pred, pred_idx, true, pc, tc, mode_costing);
     }
@@ -883,7 +903,7 @@ Isochrone::ComputeMultiModal(google::protobuf::RepeatedPtrField<valhalla::Locati
   // For now the date_time must be set on the origin.
   if (!origin_locations.Get(0).has_date_time()) {
     LOG_ERROR("No date time set on the origin location");
-    return isotile_;
+    return DrawIsoTile();
   }
 
   // Update start time
@@ -915,7 +935,7 @@ Isochrone::ComputeMultiModal(google::protobuf::RepeatedPtrField<valhalla::Locati
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
-      return isotile_;
+      return DrawIsoTile();
     }
 
     // Copy the EdgeLabel for use in costing and settle the edge.
@@ -929,10 +949,10 @@ Isochrone::ComputeMultiModal(google::protobuf::RepeatedPtrField<valhalla::Locati
 
     // Expand from the end node of the predecessor edge.
     if (ExpandForwardMM(graphreader, pred.endnode(), pred, predindex, false, pc, tc, mode_costing)) {
-      return isotile_;
+      return DrawIsoTile();
     }
   }
-  return isotile_; // Should never get here
+  return DrawIsoTile(); // Should never get here
 }
 
 // Update the isotile
@@ -965,69 +985,44 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred,
   // For short edges just mark the segment between the 2 nodes of the edge. This
   // avoid getting the shape for short edges.
   if (edge->length() < shape_interval_ * 1.5f) {
-    // Mark tiles that intersect the segment. Optimize this to avoid calling the Intersect
-    // method unless more than 2 tiles are crossed by the segment.
     PointLL ll0 = tile->get_node_ll(t2->directededge(opp)->endnode());
-    auto tile1 = isotile_->TileId(ll0);
-    auto tile2 = isotile_->TileId(ll);
-    if (tile1 == tile2) {
-      isotile_->SetIfLessThan(tile1, secs1 * kMinPerSec);
-    } else if (isotile_->AreNeighbors(tile1, tile2)) {
-      // If tile 2 is directly east, west, north, or south of tile 1 then the
-      // segment will not intersect any other tiles other than tile1 and tile2.
-      isotile_->SetIfLessThan(tile1, secs1 * kMinPerSec);
-      isotile_->SetIfLessThan(tile2, secs1 * kMinPerSec);
-    } else {
-      // Find intersecting tiles (using a Bresenham method)
-      auto tiles = isotile_->Intersect(std::list<PointLL>{ll0, ll});
-      for (auto t : tiles) {
-        isotile_->SetIfLessThan(t.first, secs1 * kMinPerSec);
-      }
+    segments_.push_back({ll0, ll, secs1 * kMinPerSec});
+  } else {
+    // Get the shape and make sure shape is forward direction. Resample it to
+    // the shape interval to get regular spacing. Use the faster resample method.
+    // This does not use spherical interpolation - so it is not as accurate but
+    // interpolation is over short distances so accuracy should be fine.
+    auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
+    auto resampled = resample_polyline(shape, edge->length(), shape_interval_);
+    if (!edge->forward()) {
+      std::reverse(resampled.begin(), resampled.end());
     }
-    return;
-  }
 
-  // Get the shape and make sure shape is forward direction. Resample it to
-  // the shape interval to get regular spacing. Use the faster resample method.
-  // This does not use spherical interpolation - so it is not as accurate but
-  // interpolation is over short distances so accuracy should be fine.
-  auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
-  auto resampled = resample_polyline(shape, edge->length(), shape_interval_);
-  if (!edge->forward()) {
-    std::reverse(resampled.begin(), resampled.end());
+    // Mark grid cells along the shape if time is less than what is
+    // already populated.
+    float minutes = secs0 * kMinPerSec;
+    float delta = ((secs1 - secs0) / (resampled.size() - 1)) * kMinPerSec;
+    auto itr1 = resampled.begin();
+    for (auto itr2 = itr1 + 1; itr2 < resampled.end(); itr1++, itr2++) {
+      minutes += delta;
+      segments_.push_back({*itr1, *itr2, minutes});
+    }
   }
 
-  // Mark grid cells along the shape if time is less than what is
-  // already populated. Get intersection of tiles along each segment
-  // (just use a bounding box around the segment) so this doesn't miss
-  // shape that crosses tile corners
-  float minutes = secs0 * kMinPerSec;
-  float delta = ((secs1 - secs0) / (resampled.size() - 1)) * kMinPerSec;
-  auto itr1 = resampled.begin();
-  for (auto itr2 = itr1 + 1; itr2 < resampled.end(); itr1++, itr2++) {
-    minutes += delta;
-
-    // Mark tiles that intersect the segment. Optimize this to avoid calling the Intersect
-    // method unless more than 2 tiles are crossed by the segment.
-    auto tile1 = isotile_->TileId(*itr1);
-    auto tile2 = isotile_->TileId(*itr2);
-    if (tile1 == tile2) {
-      isotile_->SetIfLessThan(tile1, minutes);
-    } else if (isotile_->AreNeighbors(tile1, tile2)) {
-      // If tile 2 is directly east, west, north, or south of tile 1 then the
-      // segment will not intersect any other tiles other than tile1 and tile2.
-      isotile_->SetIfLessThan(tile1, minutes);
-      isotile_->SetIfLessThan(tile2, minutes);
-    } else {
-      // Find intersecting tiles (using a Bresenham method)
-      auto tiles = isotile_->Intersect(std::list<PointLL>{*itr1, *itr2});
-      for (auto t : tiles) {
-        isotile_->SetIfLessThan(t.first, minutes);
-      }
-    }
+  // The cells are drawn in batches, the least time wins whatever order they are drawn in
+  if (segments_.size() >= kSegmentBatch) {
+    isotile_->SetIfLessThan(segments_, parallel_for_);
+    segments_.clear();
   }
 }
 
+// Draw whatever segments are left and hand out the isotile
+std::shared_ptr<const GriddedData<PointLL>> Isochrone::DrawIsoTile() {
+  isotile_->SetIfLessThan(segments_, parallel_for_);
+  segments_.clear();
+  return isotile_;
+}
+
 // Add edge(s) at each origin to the adjacency list
 void Isochrone::SetOriginLocations(
     GraphReader& graphreader,
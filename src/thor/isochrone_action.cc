@@ -26,20 +26,156 @@ std::string thor_worker_t::isochrones(Api& request) {
     options.set_generalize(kOptimalGeneralization);
   }
 
+  // a batch gets an isochrone from each location on its own
+  bool multimodal = costing == "multimodal" || costing == "transit";
+  if (options.batch()) {
+    return batch_isochrones(request, costing, contours, colors);
+  }
+
   // get the raster
   // Extend the times in the 2-D grid to be 10 minutes beyond the highest contour time.
   // Cost (including penalties) is used when adding to the adjacency list but the elapsed
   // time in seconds is used when terminating the search. The + 10 minutes adds a buffer for edges
   // where there has been a higher cost that might still be marked in the isochrone
-  auto grid = (costing == "multimodal" || costing == "transit")
-                  ? isochrone_gen.ComputeMultiModal(*options.mutable_locations(),
-                                                    contours.back() + 10, *reader, mode_costing, mode)
-                  : isochrone_gen.Compute(*options.mutable_locations(), contours.back() + 10, *reader,
-                                          mode_costing, mode);
+  // where, how and when from are the same for another set of contours we reuse its grid. The
+  // grid is drawn and then contoured concurrently if we have the threads for it
+  GriddedData<PointLL>::parallel_for_t parallel_for;
+  if (matrix_pool) {
+    parallel_for = [this](const uint32_t count, const std::function<void(uint32_t)>& work) {
+      matrix_pool->parallel_for(count, work);
+    };
+  }
+
+  // The time from the locations, to them or both. Both ways are expansions of their own over the
+  // same tiles so they run side by side on the pool if the reader can be shared between threads
+  std::vector<bool> reverse;
+  if (options.isochrone_direction() != Options::to_locations) {
+    reverse.push_back(false);
+  }
+  if (options.isochrone_direction() != Options::from_locations) {
+    reverse.push_back(true);
+  }
+  if (multimodal && reverse.back()) {
+    throw valhalla_exception_t{166};
+  }
+  const uint32_t max_minutes = contours.back() + 10;
+  std::vector<IsochroneCache::grid_t> grids(reverse.size());
+  std::vector<uint32_t> missing;
+  for (uint32_t i = 0; i < grids.size(); ++i) {
+    grids[i] = isochrone_cache.Find(options.costing(), options, max_minutes, reverse[i]);
+    if (!grids[i]) {
+      missing.push_back(i);
+    }
+  }
+  bool parallel = matrix_pool && missing.size() > 1 && reader->IsThreadSafe();
+  if (missing.size() > 1 && batch_isochrone_gens.empty()) {
+    batch_isochrone_gens.emplace_back(new Isochrone());
+  }
+  std::vector<SearchStatistics> statistics(record_statistics(options) ? grids.size() : 0);
+  // each expansion fills in the time zone of the locations so they get a copy of their own
+  std::vector<google::protobuf::RepeatedPtrField<valhalla::Location>> locations(missing.size(),
+                                                                               options.locations());
+  auto work = [&](const uint32_t m) {
+    auto i = missing[m];
+    Isochrone& generator = m == 0 ? isochrone_gen : *batch_isochrone_gens.front();
+    generator.set_parallel_for(parallel ? nullptr : parallel_for);
+    auto start = start_search();
+    grids[i] = multimodal ? generator.ComputeMultiModal(locations[m], max_minutes, *reader,
+                                                        mode_costing, mode)
+                          : reverse[i] ? generator.ComputeReverse(locations[m], max_minutes,
+                                                                  *reader, mode_costing, mode)
+                                       : generator.Compute(locations[m], max_minutes, *reader,
+                                                           mode_costing, mode);
+    end_search(statistics.empty() ? nullptr : &statistics[i],
+               reverse[i] ? "reverse_isochrone" : "isochrone", generator.queue_stats(), start);
+    generator.set_parallel_for(nullptr);
+  };
+  if (parallel) {
+    matrix_pool->parallel_for(missing.size(), work);
+  } else {
+    for (uint32_t m = 0; m < missing.size(); ++m) {
+      work(m);
+    }
+  }
+  for (auto i : missing) {
+    isochrone_cache.Put(options.costing(), options, max_minutes, grids[i], reverse[i]);
+    if (!statistics.empty()) {
+      request.add_statistics()->Swap(&statistics[i]);
+    }
+  }
+  if (missing.size() > 1) {
+    batch_isochrone_gens.front()->Clear();
+  }
+  log_statistics(request);
 
   // turn it into geojson
-  auto isolines =
-      grid->GenerateContours(contours, options.polygons(), options.denoise(), options.generalize());
+  std::vector<GriddedData<PointLL>::contours_t> isolines;
+  for (const auto& grid : grids) {
+    isolines.push_back(grid->GenerateContours(contours, options.polygons(), options.denoise(),
+                                              options.generalize(), parallel_for));
+  }
+  if (isolines.size() > 1) {
+    return tyr::serializeIsochrones<PointLL>(request, isolines.front(), isolines.back(),
+                                             options.polygons(), colors, options.show_locations());
+  }
+  return tyr::serializeIsochrones<PointLL>(request, isolines.front(), options.polygons(), colors,
+                                           options.show_locations());
+}
+
+std::string thor_worker_t::batch_isochrones(Api& request,
+                                            const std::string& costing,
+                                            const std::vector<float>& contours,
+                                            const std::unordered_map<float, std::string>& colors) {
+  auto& options = *request.mutable_options();
+  bool multimodal = costing == "multimodal" || costing == "transit";
+
+  // Each location gets the time from it or to it, not both
+  bool reverse = options.isochrone_direction() == Options::to_locations;
+  if (options.isochrone_direction() == Options::from_and_to_locations || (multimodal && reverse)) {
+    throw valhalla_exception_t{166};
+  }
+
+  // The expansions are independent so they run on the pool if the tiles can be shared between
+  // its threads. Multimodal costing changes while expanding so those run one after the other.
+  bool parallel =
+      matrix_pool && !multimodal && reader->IsThreadSafe() && options.locations_size() > 1;
+  uint32_t slots = parallel ? matrix_pool->concurrency() : 1;
+  isochrone_gen.set_parallel_for(nullptr);
+  while (batch_isochrone_gens.size() + 1 < slots) {
+    batch_isochrone_gens.emplace_back(new Isochrone());
+  }
+
+  // Expand and contour each location with the isochrone of the thread doing it
+  std::vector<GriddedData<PointLL>::contours_t> isolines(options.locations_size());
+  std::vector<SearchStatistics> statistics(record_statistics(options) ? isolines.size() : 0);
+  auto work = [&](const uint32_t i, const uint32_t slot) {
+    Isochrone& generator = slot == 0 ? isochrone_gen : *batch_isochrone_gens[slot - 1];
+    google::protobuf::RepeatedPtrField<valhalla::Location> location;
+    location.Add()->CopyFrom(options.locations(i));
+    auto start = start_search();
+    auto grid = multimodal ? generator.ComputeMultiModal(location, contours.back() + 10, *reader,
+                                                         mode_costing, mode)
+                           : reverse ? generator.ComputeReverse(location, contours.back() + 10,
+                                                                *reader, mode_costing, mode)
+                                     : generator.Compute(location, contours.back() + 10, *reader,
+                                                         mode_costing, mode);
+    end_search(statistics.empty() ? nullptr : &statistics[i], "isochrone", generator.queue_stats(),
+               start);
+    isolines[i] = grid->GenerateContours(contours, options.polygons(), options.denoise(),
+                                         options.generalize());
+    generator.Clear();
+  };
+  if (parallel) {
+    matrix_pool->parallel_for(options.locations_size(), work);
+  } else {
+    for (int i = 0; i < options.locations_size(); ++i) {
+      work(i, 0);
+    }
+  }
+  for (auto& location_statistics : statistics) {
+    request.add_statistics()->Swap(&location_statistics);
+  }
+  log_statistics(request);
 
   return tyr::serializeIsochrones<PointLL>(request, isolines, options.polygons(), colors,
                                            options.show_locations());
@@ -0,0 +1,96 @@
+#include "thor/isochronecache.h"
+#include "baldr/predictedspeeds.h"
+#include "sif/costingcache.h"
+
+#include <cctype>
+
+namespace valhalla {
+namespace thor {
+
+IsochroneCache::IsochroneCache(const size_t max_grids, const uint32_t max_age)
+    : max_grids_(max_grids), max_age_(max_age) {
+}
+
+size_t IsochroneCache::size() const {
+  return grids_.size();
+}
+
+void IsochroneCache::Clear() {
+  grids_.clear();
+}
+
+IsochroneCache::grid_t IsochroneCache::Find(const Costing costing,
+                                            const Options& options,
+                                            const uint32_t max_minutes,
+                                            const bool reverse) const {
+  if (max_grids_ == 0 || costing == Costing::transit || costing == Costing::multimodal) {
+    return nullptr;
+  }
+  auto found = grids_.find(Key(costing, options, max_minutes, reverse));
+  auto now = std::chrono::steady_clock::now();
+  if (found == grids_.end() ||
+      (max_age_.count() != 0 && now - found->second.computed >= max_age_)) {
+    return nullptr;
+  }
+  return found->second.grid;
+}
+
+void IsochroneCache::Put(const Costing costing,
+                         const Options& options,
+                         const uint32_t max_minutes,
+                         const grid_t& grid,
+                         const bool reverse) {
+  if (max_grids_ == 0 || costing == Costing::transit || costing == Costing::multimodal) {
+    return;
+  }
+  auto key = Key(costing, options, max_minutes, reverse);
+  auto now = std::chrono::steady_clock::now();
+  auto found = grids_.find(key);
+  if (found != grids_.end()) {
+    found->second = {grid, now};
+    return;
+  }
+  if (grids_.size() >= max_grids_) {
+    grids_.clear();
+  }
+  grids_.emplace(std::move(key), entry_t{grid, now});
+}
+
+// The isochrone reads the costing, the edges the locations snapped to and the time at the origin.
+// The time is rounded down to the predicted speed bucket, departures in the same bucket share
+// their grid.
+std::string IsochroneCache::Key(const Costing costing,
+                                const Options& options,
+                                const uint32_t max_minutes,
+                                const bool reverse) {
+  std::string key = sif::CostingCache::Key(costing, options);
+  key.push_back(':');
+  key += std::to_string(max_minutes);
+  if (reverse) {
+    key += ":to";
+  }
+  for (const auto& location : options.locations()) {
+    key.push_back(':');
+    if (location.has_date_time()) {
+      // YYYY-MM-DDTHH:MM
+      auto date_time = location.date_time();
+      if (date_time.size() == 16 && std::isdigit(date_time[14]) && std::isdigit(date_time[15])) {
+        int minute = (date_time[14] - '0') * 10 + (date_time[15] - '0');
+        minute -= minute % baldr::kSpeedBucketSizeMinutes;
+        date_time[14] = '0' + minute / 10;
+        date_time[15] = '0' + minute % 10;
+      }
+      key += date_time;
+    }
+    for (const auto& edge : location.path_edges()) {
+      auto serialized = edge.SerializeAsString();
+      key += std::to_string(serialized.size());
+      key.push_back(':');
+      key += serialized;
+    }
+  }
+  return key;
+}
+
+} // namespace thor
+} // namespace valhalla
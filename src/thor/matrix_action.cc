@@ -1,6 +1,9 @@
+#include <algorithm>
+
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/chmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
@@ -16,7 +19,40 @@ using namespace valhalla::thor;
 namespace {
 
 constexpr double kMilePerMeter = 0.000621371;
+
+// Distances are in the requested units, kilometers if none are specified
+double distance_scale(const Options& options) {
+  return options.units() == Options::miles ? kMilePerMeter : kKmPerMeter;
+}
+
+// The sources of a matrix all depart at the date_time of the request unless they have their own,
+// a matrix can not arrive by a time so then none of them has one
+void depart_sources_at_date_time(Options& options) {
+  if (!options.has_date_time()) {
+    return;
+  }
+  for (auto& source : *options.mutable_sources()) {
+    if (options.date_time_type() == Options::arrive_by) {
+      source.clear_date_time();
+    } else if (!source.has_date_time()) {
+      source.set_date_time(options.date_time());
+    }
+  }
+}
+
+// The depots and the bucket engine search everything, the pairs beyond the time the request wants
+// are not found
+void drop_beyond_max_time(const Options& options, std::vector<TimeDistance>& time_distances) {
+  if (options.max_time() <= 0) {
+    return;
+  }
+  for (auto& td : time_distances) {
+    if (td.time != kMaxCost && td.time > options.max_time()) {
+      td = TimeDistance(kMaxCost, kMaxCost);
+    }
+  }
 }
+} // namespace
 
 namespace valhalla {
 namespace thor {
@@ -24,35 +60,161 @@ namespace thor {
 constexpr uint32_t kCostMatrixThreshold = 5;
 
 std::string thor_worker_t::matrix(Api& request) {
+  auto time_distances = compute_matrix(request);
+  return tyr::serializeMatrix(request, time_distances, distance_scale(request.options()));
+}
+
+void thor_worker_t::fill_matrix(Api& request) {
+  auto time_distances = compute_matrix(request);
+  tyr::fillMatrix(request, time_distances, distance_scale(request.options()));
+}
+
+std::vector<TimeDistance> thor_worker_t::compute_matrix(Api& request) {
   parse_locations(request);
   auto costing = parse_costing(request);
+  depart_sources_at_date_time(*request.mutable_options());
   const auto& options = request.options();
+  const bool time_dependent =
+      std::any_of(options.sources().begin(), options.sources().end(),
+                  [](const valhalla::Location& source) { return source.has_date_time(); });
 
   if (!options.do_not_track()) {
     valhalla::midgard::logging::Log("matrix_type::" + Options_Action_Enum_Name(options.action()),
                                     " [ANALYTICS] ");
   }
 
-  // Parse out units; if none specified, use kilometers
-  double distance_scale = kKmPerMeter;
-  if (options.units() == Options::miles) {
-    distance_scale = kMilePerMeter;
-  }
-
-  json::MapPtr json;
   // do the real work
   std::vector<TimeDistance> time_distances;
+  auto* statistics = record_statistics(options) ? request.add_statistics() : nullptr;
+  auto start = start_search();
+
+  // The rows of depots are looked up in what the depot reaches, which is searched the first time
+  // it is asked for. The other sources, and depots that do not reach every target, go through
+  // the matrix
+  const auto* sources = &options.sources();
+  const auto& targets = options.targets();
+  google::protobuf::RepeatedPtrField<valhalla::Location> matrix_sources;
+  std::vector<uint32_t> matrix_rows;
+  std::vector<TimeDistance> depot_rows;
+  if (depot_oracle && mode != TravelMode::kPublicTransit && !time_dependent) {
+    depot_rows.resize(sources->size() * targets.size());
+    thor::TimeDistanceMatrix search;
+    search.set_queue_type(get_queue_type(costing));
+    search.set_interrupt(interrupt);
+    baldr::LabelQueueStats searched;
+    for (int i = 0; i < sources->size(); ++i) {
+      const auto& source = sources->Get(i);
+      bool looked_up = false;
+      if (depot_oracle->IsDepot(source)) {
+        auto key = DepotOracle::Key(options.costing(), options, source);
+        auto reach = depot_oracle->Find(key);
+        if (!reach) {
+          reach = std::make_shared<const DepotReach>(
+              search.OneToAll(source, *reader, mode_costing, mode,
+                              max_matrix_distance.find(costing)->second));
+          searched += search.queue_stats();
+          search.Clear();
+          depot_oracle->Put(key, reach);
+        }
+        looked_up = true;
+        for (int j = 0; j < targets.size() && looked_up; ++j) {
+          looked_up = reach->Get(targets.Get(j), *reader, *mode_costing[static_cast<int>(mode)],
+                                 depot_rows[i * targets.size() + j]);
+        }
+      }
+      if (!looked_up) {
+        matrix_rows.push_back(i);
+        matrix_sources.Add()->CopyFrom(source);
+      }
+    }
+    if (searched.popped != 0) {
+      end_search(statistics, "depot_oracle", searched, start);
+      start = start_search();
+    }
+    if (matrix_sources.size() == sources->size()) {
+      depot_rows.clear();
+    } else {
+      sources = &matrix_sources;
+    }
+  }
+  if (sources->empty()) {
+    drop_beyond_max_time(options, depot_rows);
+    log_statistics(request);
+    return depot_rows;
+  }
+
   auto costmatrix = [&]() {
     thor::CostMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+    matrix.set_queue_type(get_queue_type(costing));
+    matrix.set_thread_pool(matrix_pool.get());
+    matrix.set_interrupt(interrupt);
+    matrix.set_symmetric(options.symmetric());
+    matrix.set_max_time(options.max_time());
+    // The limits tuned for the region of the locations, the costing is reset before its next use
+    if (!hierarchy_limits.empty()) {
+      std::vector<midgard::PointLL> lls;
+      for (const auto* locations : {sources, &targets}) {
+        for (const auto& location : *locations) {
+          lls.emplace_back(location.ll().lng(), location.ll().lat());
+        }
+      }
+      hierarchy_limits.Apply(costing, lls,
+                             mode_costing[static_cast<int>(mode)]->GetHierarchyLimits());
+    }
+    auto result = matrix.SourceToTarget(*sources, targets, *reader, mode_costing, mode,
+                                        max_matrix_distance.find(costing)->second);
+    end_search(statistics, "costmatrix", matrix.queue_stats(), start);
+    return result;
   };
   auto timedistancematrix = [&]() {
     thor::TimeDistanceMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+    matrix.set_queue_type(get_queue_type(costing));
+    matrix.set_thread_pool(matrix_pool.get());
+    matrix.set_interrupt(interrupt);
+    matrix.set_max_time(options.max_time());
+    auto result = matrix.SourceToTarget(*sources, targets, *reader, mode_costing, mode,
+                                        max_matrix_distance.find(costing)->second);
+    end_search(statistics, "timedistancematrix", matrix.queue_stats(), start);
+    return result;
+  };
+  auto bucketmatrix = [&]() {
+    thor::CHMatrix matrix(ch_graphs.find(options.costing())->second);
+    auto result = matrix.SourceToTarget(*sources, targets, *reader, mode_costing, mode,
+                                        max_matrix_distance.find(costing)->second);
+    // The buckets are filled by upward searches without a label queue, only the tiles count
+    end_search(statistics, "bucket", {}, start);
+    return result;
   };
-  switch (source_to_target_algorithm) {
+
+  // The request can pick the engine, otherwise use the configured one
+  auto algorithm = source_to_target_algorithm;
+  switch (options.matrix_algorithm()) {
+    case Options::costmatrix:
+      algorithm = COST_MATRIX;
+      break;
+    case Options::timedistancematrix:
+      algorithm = TIME_DISTANCE_MATRIX;
+      break;
+    case Options::bucket:
+      algorithm = BUCKET_MATRIX;
+      break;
+    default:
+      break;
+  }
+
+  // The bucket engine needs a contraction hierarchy for the request's costing
+  if (algorithm == BUCKET_MATRIX && !use_contraction_hierarchy(options)) {
+    LOG_DEBUG("No contraction hierarchy for this matrix request, using CostMatrix");
+    algorithm = COST_MATRIX;
+  }
+
+  // Only the searches from the sources can cost the edges at the time they are reached
+  if (time_dependent && algorithm != TIME_DISTANCE_MATRIX) {
+    LOG_DEBUG("Sources depart at a time, using TimeDistanceMatrix");
+    algorithm = TIME_DISTANCE_MATRIX;
+  }
+
+  switch (algorithm) {
     case SELECT_OPTIMAL:
       // TODO - Do further performance testing to pick the best algorithm for the job
       switch (mode) {
@@ -60,8 +222,7 @@ std::string thor_worker_t::matrix(Api& request) {
         case TravelMode::kBicycle:
           // Use CostMatrix if number of sources and number of targets
           // exceeds some threshold
-          if (options.sources().size() > kCostMatrixThreshold &&
-              options.targets().size() > kCostMatrixThreshold) {
+          if (sources->size() > kCostMatrixThreshold && targets.size() > kCostMatrixThreshold) {
             time_distances = costmatrix();
           } else {
             time_distances = timedistancematrix();
@@ -80,8 +241,23 @@ std::string thor_worker_t::matrix(Api& request) {
     case TIME_DISTANCE_MATRIX:
       time_distances = timedistancematrix();
       break;
+    case BUCKET_MATRIX:
+      time_distances = bucketmatrix();
+      break;
+  }
+
+  // Put the rows of the matrix between the rows of the depots
+  if (!depot_rows.empty()) {
+    for (size_t row = 0; row < matrix_rows.size(); ++row) {
+      std::copy(time_distances.begin() + row * targets.size(),
+                time_distances.begin() + (row + 1) * targets.size(),
+                depot_rows.begin() + matrix_rows[row] * targets.size());
+    }
+    time_distances = std::move(depot_rows);
   }
-  return tyr::serializeMatrix(request, time_distances, distance_scale);
+  drop_beyond_max_time(options, time_distances);
+  log_statistics(request);
+  return time_distances;
 }
 } // namespace thor
 } // namespace valhalla
@@ -43,7 +43,8 @@ constexpr uint64_t kInitialEdgeLabelCount = 200000;
 // Default constructor
 MultiModalPathAlgorithm::MultiModalPathAlgorithm()
     : PathAlgorithm(), walking_distance_(0), mode_(TravelMode::kPedestrian), travel_type_(0),
-      adjacencylist_(nullptr), max_label_count_(std::numeric_limits<uint32_t>::max()) {
+      adjacencylist_(nullptr), max_label_count_(std::numeric_limits<uint32_t>::max()),
+      edgelabel_arena_(kInitialEdgeLabelCount) {
 }
 
 // Destructor
@@ -59,17 +60,22 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& origll,
   astarheuristic_.Init(destll, 0.0f);
 
   // Reserve size for edge labels - do this here rather than in constructor so
-  // to limit how much extra memory is used for persistent objects
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  // to limit how much extra memory is used for persistent objects. The
+  // reservation follows the label counts of recent searches.
+  edgelabel_arena_.reserve(edgelabels_);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
 
-  // Construct adjacency list and edge status.
+  // Construct (or reuse) the adjacency list and edge status.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing->UnitSize();
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  if (adjacencylist_) {
+    adjacencylist_->reuse(0.0f, range, bucketsize, edgecost);
+  } else {
+    adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  }
   edgestatus_.clear();
 
   // Get hierarchy limits from the costing. Get a copy since we increment
@@ -80,11 +86,14 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& origll,
 // Clear the temporary information generated during path construction.
 void MultiModalPathAlgorithm::Clear() {
   // Clear the edge labels and destination list
-  edgelabels_.clear();
+  edgelabel_arena_.recycle(edgelabels_);
   destinations_.clear();
 
-  // Clear elements from the adjacency list
-  adjacencylist_.reset();
+  // Clear elements from the adjacency list, its buckets are kept for the
+  // next search
+  if (adjacencylist_) {
+    adjacencylist_->clear();
+  }
 
   // Clear the edge status flags
   edgestatus_.clear();
@@ -339,7 +348,7 @@ bool MultiModalPathAlgorithm::ExpandForward(GraphReader& graphreader,
   // Expand from end node.
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
     // Skip shortcuts and edges that are permanently labeled (best path already found to
     // this directed edge).
@@ -530,7 +539,7 @@ bool MultiModalPathAlgorithm::ExpandForward(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true, pc, tc, mode_costing);
     }
@@ -722,7 +731,7 @@ bool MultiModalPathAlgorithm::ExpandFromNode(baldr::GraphReader& graphreader,
   // Expand edges from the node
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
     // Skip this edge if permanently labeled (best path already found to this directed edge) or
     // access is not allowed for this mode.
@@ -758,7 +767,7 @@ bool MultiModalPathAlgorithm::ExpandFromNode(baldr::GraphReader& graphreader,
 
   // Handle transitions - expand from the end node each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       ExpandFromNode(graphreader, trans->endnode(), pred, pred_idx, costing, edgestatus, edgelabels,
                      adjlist, true);
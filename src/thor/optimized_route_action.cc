@@ -29,9 +29,17 @@ void thor_worker_t::optimized_route(Api& request) {
 
   // Use CostMatrix to find costs from each location to every other location
   CostMatrix costmatrix;
+  costmatrix.set_queue_type(get_queue_type(costing));
+  costmatrix.set_thread_pool(matrix_pool.get());
+  costmatrix.set_interrupt(interrupt);
+  costmatrix.set_symmetric(options.symmetric());
+  auto start = start_search();
   std::vector<thor::TimeDistance> td =
       costmatrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
                                 max_matrix_distance.find(costing)->second);
+  if (record_statistics(options)) {
+    end_search(request.add_statistics(), "costmatrix", costmatrix.queue_stats(), start);
+  }
 
   // Return an error if any locations are totally unreachable
   const auto& correlated =
@@ -53,7 +61,21 @@ void thor_worker_t::optimized_route(Api& request) {
     time_costs.emplace_back(static_cast<float>(td[i].time));
   }
 
+  // The request can pick the optimizer, otherwise use the configured one
   Optimizer optimizer;
+  switch (options.optimizer()) {
+    case Options::anneal:
+      optimizer.set_method(OptimizerMethod::kAnneal);
+      break;
+    case Options::local_search:
+      optimizer.set_method(OptimizerMethod::kLocalSearch);
+      break;
+    default:
+      optimizer.set_method(optimizer_method);
+      break;
+  }
+  optimizer.set_restarts(optimizer_restarts);
+  optimizer.set_thread_pool(matrix_pool.get());
   // returns the optimal order of the path_locations
   auto optimal_order = optimizer.Solve(correlated.size(), time_costs);
   // put the optimal order into the locations array
@@ -1,6 +1,13 @@
 #include "thor/optimizer.h"
 #include "midgard/logging.h"
 
+namespace {
+
+// Smallest decrease of the tour cost for a local search move to be applied
+constexpr double kMinImprovement = 0.001;
+
+} // namespace
+
 namespace valhalla {
 namespace thor {
 
@@ -21,6 +28,10 @@ std::vector<uint32_t> Optimizer::Solve(const uint32_t count, const std::vector<f
     return (TourCost(costs, tour1) < TourCost(costs, tour2)) ? tour1 : tour2;
   }
 
+  if (method_ == OptimizerMethod::kLocalSearch) {
+    return LocalSearch(costs);
+  }
+
   // Populate the initial tour with a random order. The first and last
   // locations must remain fixed as the tour begin and end locations do not
   // change.
@@ -168,6 +179,182 @@ float Optimizer::TemperatureDifference(const std::vector<float>& costs,
   return (c / static_cast<float>(count_));
 }
 
+// Optimize the tour with the local search, restarted from perturbations of the
+// first tour it finds.
+std::vector<uint32_t> Optimizer::LocalSearch(const std::vector<float>& costs) {
+  auto neighbors = NearestNeighbors(costs);
+  auto tour = NearestNeighborTour(costs);
+  ImproveTour(costs, neighbors, tour);
+
+  // Each restart perturbs the best tour it has by swapping two adjacent runs
+  // of locations (a double bridge move) and improves it again, keeping it if
+  // it is better. The generator of a restart is seeded by its index so the
+  // result does not depend on how the restarts are scheduled.
+  std::vector<std::vector<uint32_t>> tours(restarts_, tour);
+  std::vector<float> tour_costs(restarts_);
+  auto restart = [&](const uint32_t r) {
+    auto& best = tours[r];
+    float best_cost = TourCost(costs, best);
+    std::mt19937 generator(r + 1);
+    std::uniform_int_distribution<uint32_t> cut(1, count_ - 1);
+    for (uint32_t i = 0; i < count_; i++) {
+      uint32_t a, b, c;
+      do {
+        a = cut(generator);
+        b = cut(generator);
+        c = cut(generator);
+      } while (a == b || a == c || b == c);
+      if (a > b) {
+        std::swap(a, b);
+      }
+      if (b > c) {
+        std::swap(b, c);
+      }
+      if (a > b) {
+        std::swap(a, b);
+      }
+      auto candidate = best;
+      std::rotate(candidate.begin() + a, candidate.begin() + b, candidate.begin() + c);
+      ImproveTour(costs, neighbors, candidate);
+      float cost = TourCost(costs, candidate);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best.swap(candidate);
+      }
+    }
+    tour_costs[r] = best_cost;
+  };
+  if (thread_pool_ != nullptr && restarts_ > 1) {
+    thread_pool_->parallel_for(restarts_, restart);
+  } else {
+    for (uint32_t r = 0; r < restarts_; r++) {
+      restart(r);
+    }
+  }
+
+  // Take the best tour, the first one on a tie
+  auto best = std::min_element(tour_costs.begin(), tour_costs.end()) - tour_costs.begin();
+  LOG_DEBUG("Best tour cost = " + std::to_string(tour_costs[best]));
+  return tours[best];
+}
+
+// Create a tour by going to the nearest location not yet visited.
+std::vector<uint32_t> Optimizer::NearestNeighborTour(const std::vector<float>& costs) const {
+  std::vector<uint32_t> tour{0};
+  std::vector<bool> visited(count_, false);
+  for (uint32_t i = 1; i < count_ - 1; i++) {
+    uint32_t nearest = 0;
+    for (uint32_t loc = 1; loc < count_ - 1; loc++) {
+      if (!visited[loc] &&
+          (nearest == 0 || Cost(costs, tour.back(), loc) < Cost(costs, tour.back(), nearest))) {
+        nearest = loc;
+      }
+    }
+    visited[nearest] = true;
+    tour.push_back(nearest);
+  }
+  tour.push_back(count_ - 1);
+  return tour;
+}
+
+// Improve a tour with 2-opt and Or-opt moves until none of them lowers its
+// cost. The costs may differ in each direction so the cost of reversing part
+// of the tour comes from sums of the costs along the tour in both directions.
+void Optimizer::ImproveTour(const std::vector<float>& costs,
+                            const std::vector<uint32_t>& neighbors,
+                            std::vector<uint32_t>& tour) const {
+  const uint32_t n = count_;
+  const uint32_t k = neighbors.size() / n;
+  std::vector<uint32_t> position(n);
+  std::vector<double> forward(n), backward(n);
+  auto cost = [&](const uint32_t i, const uint32_t j) -> double {
+    return Cost(costs, tour[i], tour[j]);
+  };
+
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    forward[0] = backward[0] = 0.0;
+    position[tour[0]] = 0;
+    for (uint32_t i = 1; i < n; i++) {
+      position[tour[i]] = i;
+      forward[i] = forward[i - 1] + cost(i - 1, i);
+      backward[i] = backward[i - 1] + cost(i, i - 1);
+    }
+
+    // 2-opt: reverse the locations from i to j so that the location before i
+    // is followed by one of its neighbors
+    for (uint32_t i = 1; i < n - 2 && !improved; i++) {
+      for (uint32_t m = 0; m < k; m++) {
+        uint32_t j = position[neighbors[tour[i - 1] * k + m]];
+        if (j <= i || j > n - 2) {
+          continue;
+        }
+        double delta = cost(i - 1, j) + cost(i, j + 1) + (backward[j] - backward[i]) -
+                       cost(i - 1, i) - cost(j, j + 1) - (forward[j] - forward[i]);
+        if (delta < -kMinImprovement) {
+          std::reverse(tour.begin() + i, tour.begin() + j + 1);
+          improved = true;
+          break;
+        }
+      }
+    }
+    if (improved) {
+      continue;
+    }
+
+    // Or-opt: move a run of up to 3 locations from i to e in between p and q
+    // so that it is followed by one of the neighbors of its last location
+    for (uint32_t length = 1; length <= 3 && !improved; length++) {
+      for (uint32_t i = 1; i + length < n && !improved; i++) {
+        uint32_t e = i + length - 1;
+        for (uint32_t m = 0; m < k; m++) {
+          uint32_t q = position[neighbors[tour[e] * k + m]];
+          if (q == 0 || (q >= i && q <= e + 1)) {
+            continue;
+          }
+          uint32_t p = q - 1;
+          double delta = cost(i - 1, e + 1) + cost(p, i) + cost(e, q) - cost(i - 1, i) -
+                         cost(e, e + 1) - cost(p, q);
+          if (delta < -kMinImprovement) {
+            if (q < i) {
+              std::rotate(tour.begin() + q, tour.begin() + i, tour.begin() + e + 1);
+            } else {
+              std::rotate(tour.begin() + i, tour.begin() + e + 1, tour.begin() + q);
+            }
+            improved = true;
+            break;
+          }
+        }
+      }
+    }
+  }
+}
+
+// Get the nearest neighbors of each location by the cost to go to them. The
+// origin never follows another location so it is nobody's neighbor.
+std::vector<uint32_t> Optimizer::NearestNeighbors(const std::vector<float>& costs) const {
+  const uint32_t k = std::min(kOptimizerNeighbors, count_ - 2);
+  std::vector<uint32_t> neighbors;
+  neighbors.reserve(count_ * k);
+  std::vector<uint32_t> locations;
+  for (uint32_t from = 0; from < count_; from++) {
+    locations.clear();
+    for (uint32_t to = 1; to < count_; to++) {
+      if (to != from) {
+        locations.push_back(to);
+      }
+    }
+    std::partial_sort(locations.begin(), locations.begin() + k, locations.end(),
+                      [&](const uint32_t a, const uint32_t b) {
+                        float ca = Cost(costs, from, a), cb = Cost(costs, from, b);
+                        return ca < cb || (ca == cb && a < b);
+                      });
+    neighbors.insert(neighbors.end(), locations.begin(), locations.begin() + k);
+  }
+  return neighbors;
+}
+
 // Get the cost for the specified tour (order of locations).
 float Optimizer::TourCost(const std::vector<float>& costs, const std::vector<uint32_t>& tour) const {
   float c = 0;
@@ -0,0 +1,607 @@
+#include "thor/raptor.h"
+#include "baldr/datetime.h"
+#include "midgard/logging.h"
+#include <algorithm>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Time to change from one trip to another within a stop
+constexpr uint32_t kInStopTransferSecs = 30;
+
+// Departures of frequency based trips are made for the request, fixed ones point into the tile
+struct departure_deleter_t {
+  void operator()(const TransitDeparture* departure) const {
+    if (departure->type() == kFrequencySchedule) {
+      delete departure;
+    }
+  }
+};
+using departure_ptr = std::unique_ptr<const TransitDeparture, departure_deleter_t>;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+constexpr uint64_t kInitialEdgeLabelCount = 200000;
+
+// Default constructor
+RaptorPathAlgorithm::RaptorPathAlgorithm()
+    : PathAlgorithm(), start_tz_index_(0), start_time_(0), date_set_(false),
+      date_before_tile_(false), day_(0), dow_(0), max_transfer_distance_(0),
+      edgelabel_arena_(kInitialEdgeLabelCount), adjacencylist_(nullptr), walk_trips_(0),
+      best_{std::numeric_limits<float>::max(), kInvalidLabel, 0} {
+}
+
+// Destructor
+RaptorPathAlgorithm::~RaptorPathAlgorithm() {
+  Clear();
+}
+
+// Clear the temporary information generated during path construction.
+void RaptorPathAlgorithm::Clear() {
+  // Clear the edge labels, destinations and stops
+  edgelabel_arena_.recycle(edgelabels_);
+  destinations_.clear();
+  arrivals_.clear();
+  ridden_.clear();
+  processed_tiles_.clear();
+
+  // Clear elements from the adjacency list, its buckets are kept for the
+  // next search
+  if (adjacencylist_) {
+    adjacencylist_->clear();
+  }
+
+  // Clear the edge status flags
+  edgestatus_.clear();
+
+  // Set the ferry flag to false
+  has_ferry_ = false;
+}
+
+// Calculate the best transit path in rounds of riding trips and walking.
+std::vector<std::vector<PathInfo>>
+RaptorPathAlgorithm::GetBestPath(valhalla::Location& origin,
+                                 valhalla::Location& destination,
+                                 GraphReader& graphreader,
+                                 const std::shared_ptr<DynamicCost>* mode_costing,
+                                 const TravelMode mode,
+                                 const Options& options) {
+  // Walks use pedestrian costing allowing transit connections up to the multimodal distance
+  pc_ = mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)];
+  pc_->SetAllowTransitConnections(true);
+  pc_->UseMaxMultiModalDistance();
+  tc_ = mode_costing[static_cast<uint32_t>(TravelMode::kPublicTransit)];
+  max_transfer_distance_ = mode_costing[static_cast<uint32_t>(mode)]->GetMaxTransferDistanceMM();
+
+  // For now the date_time must be set on the origin.
+  if (!origin.has_date_time()) {
+    return {};
+  }
+
+  // Reserve size for edge labels following the label counts of recent searches
+  edgelabel_arena_.reserve(edgelabels_);
+  stats_ = {};
+  date_set_ = false;
+  date_before_tile_ = false;
+  best_ = {std::numeric_limits<float>::max(), kInvalidLabel, 0};
+
+  // Set the destination first so that walks from the origin can reach it
+  SetDestination(graphreader, destination);
+  auto stops = WalkFromOrigin(graphreader, origin, destination);
+
+  // Set route start time (seconds from midnight) and timezone
+  origin_date_time_ = origin.date_time();
+  start_time_ = DateTime::seconds_from_midnight(origin_date_time_);
+  start_tz_index_ = edgelabels_.size() == 0 ? 0 : GetTimezone(graphreader, edgelabels_[0].endnode());
+  if (start_tz_index_ == 0) {
+    LOG_ERROR("Could not get the timezone at the origin location");
+    return {};
+  }
+
+  // Each round rides one more trip from the stops the round before arrived at earlier and walks
+  // from the stops the trips arrived at earlier
+  for (uint32_t round = 1; round <= kMaxTransitRounds && !stops.empty(); ++round) {
+    auto improved = Ride(graphreader, stops);
+    auto walked = WalkFromStops(graphreader, improved, round);
+    stops = std::move(improved);
+    stops.insert(stops.end(), walked.begin(), walked.end());
+  }
+
+  if (best_.label == kInvalidLabel) {
+    LOG_ERROR("Route failed after iterations = " + std::to_string(edgelabels_.size()));
+    return {};
+  }
+  return {FormPath(best_.label)};
+}
+
+// Add the origin edges and walk from them
+std::vector<GraphId> RaptorPathAlgorithm::WalkFromOrigin(GraphReader& graphreader,
+                                                         valhalla::Location& origin,
+                                                         const valhalla::Location& destination) {
+  StartWalk(0.0f, 0);
+
+  // Only skip inbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(origin.path_edges().begin(), origin.path_edges().end(),
+                [&has_other_edges](const valhalla::Location::PathEdge& e) {
+                  has_other_edges = has_other_edges || !e.end_node();
+                });
+
+  const NodeInfo* closest_ni = nullptr;
+  for (const auto& edge : origin.path_edges()) {
+    // If origin is at a node - skip any inbound edge (dist = 1)
+    if (has_other_edges && edge.end_node()) {
+      continue;
+    }
+
+    // Disallow any user avoid edges if the avoid location is ahead of the origin along the edge
+    GraphId edgeid(edge.graph_id());
+    if (pc_->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    // Skip the edge if the tile at its end node is not found as we won't be able to walk on
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    const GraphTile* endtile = graphreader.GetGraphTile(directededge->endnode());
+    if (endtile == nullptr) {
+      continue;
+    }
+    if (closest_ni == nullptr) {
+      closest_ni = endtile->node(directededge->endnode());
+    }
+
+    Cost cost = pc_->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    uint32_t d = static_cast<uint32_t>(directededge->length() * (1.0f - edge.percent_along()));
+
+    // A destination further along the origin edge is reached without expanding
+    if (destinations_.find(edgeid) != destinations_.end() &&
+        IsTrivial(edgeid, origin, destination)) {
+      for (const auto& destination_edge : destination.path_edges()) {
+        if (destination_edge.graph_id() == edgeid) {
+          Cost trivial = pc_->EdgeCost(directededge, tile) *
+                         (destination_edge.percent_along() - edge.percent_along());
+          uint32_t idx = edgelabels_.size();
+          edgelabels_.emplace_back(kInvalidLabel, edgeid, directededge, trivial, trivial.secs, 0.0f,
+                                   TravelMode::kPedestrian, d, 0, GraphId(), 0, 0, false);
+          edgelabels_.back().set_origin();
+          Arrive(trivial.secs, idx, 0);
+        }
+      }
+    }
+
+    // Add the origin edge to the walk (but do not set its status, it messes up trivial paths
+    // with oneways)
+    uint32_t idx = edgelabels_.size();
+    edgelabels_.emplace_back(kInvalidLabel, edgeid, directededge, cost, cost.secs, 0.0f,
+                             TravelMode::kPedestrian, d, 0, GraphId(), 0, 0, false);
+    edgelabels_.back().set_origin();
+    adjacencylist_->add(idx);
+  }
+
+  // Set the origin timezone
+  if (closest_ni != nullptr && origin.date_time() == "current") {
+    origin.set_date_time(
+        DateTime::iso_date_time(DateTime::get_tz_db().from_index(closest_ni->timezone())));
+  }
+
+  std::vector<GraphId> reached;
+  Walk(graphreader, reached);
+  return reached;
+}
+
+// Walk from the stops the trips of a round arrived at
+std::vector<GraphId> RaptorPathAlgorithm::WalkFromStops(GraphReader& graphreader,
+                                                        const std::vector<GraphId>& stops,
+                                                        const uint32_t trips) {
+  std::vector<GraphId> reached;
+  if (stops.empty()) {
+    return reached;
+  }
+
+  float min_secs = std::numeric_limits<float>::max();
+  for (const auto& stop : stops) {
+    min_secs = std::min(min_secs, arrivals_[stop].secs);
+  }
+  StartWalk(min_secs, trips);
+
+  // Queue the edges leaving the stops, the stops themselves are already improved
+  for (const auto& stop : stops) {
+    ExpandWalk(graphreader, stop, arrivals_[stop].label, false, nullptr);
+  }
+  Walk(graphreader, reached);
+  return reached;
+}
+
+// Start a walk with an empty queue
+void RaptorPathAlgorithm::StartWalk(const float min_secs, const uint32_t trips) {
+  // Walks are sorted by the time of arrival
+  const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
+  uint32_t bucketsize = pc_->UnitSize();
+  float range = kBucketCount * bucketsize;
+  if (adjacencylist_) {
+    adjacencylist_->reuse(min_secs, range, bucketsize, edgecost);
+  } else {
+    adjacencylist_.reset(new DoubleBucketQueue(min_secs, range, bucketsize, edgecost));
+  }
+  edgestatus_.clear();
+  walk_trips_ = trips;
+}
+
+// Expand the queued walk
+void RaptorPathAlgorithm::Walk(GraphReader& graphreader, std::vector<GraphId>& reached) {
+  size_t expanded = 0;
+  uint32_t predindex;
+  while ((predindex = adjacencylist_->pop()) != kInvalidLabel) {
+    // Allow this process to be aborted
+    if (interrupt && ++expanded % kInterruptIterationsInterval == 0) {
+      (*interrupt)();
+    }
+
+    // Nothing after an arrival at the destination can arrive earlier
+    MMEdgeLabel pred = edgelabels_[predindex];
+    if (pred.cost().secs >= best_.secs) {
+      break;
+    }
+
+    // Origin edges only reach the destination along the edge, which is added when walking
+    // from the origin
+    if (!pred.origin() && destinations_.find(pred.edgeid()) != destinations_.end()) {
+      Arrive(pred.cost().secs, predindex, walk_trips_);
+      break;
+    }
+
+    // Mark the edge as permanently labeled. Do not do this for an origin
+    // edge (this will allow loops/around the block cases)
+    if (!pred.origin()) {
+      edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+    }
+
+    ExpandWalk(graphreader, pred.endnode(), predindex, false, &reached);
+  }
+  stats_ += adjacencylist_->stats();
+  adjacencylist_->clear();
+}
+
+// Expand a walk from a node
+void RaptorPathAlgorithm::ExpandWalk(GraphReader& graphreader,
+                                     const GraphId& node,
+                                     const uint32_t pred_idx,
+                                     const bool from_transition,
+                                     std::vector<GraphId>* reached) {
+  // Get the tile and the node info. Skip if tile is null (can happen
+  // with regional data sets).
+  const GraphTile* tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(node);
+
+  // Copy the label, adding labels may move it
+  const MMEdgeLabel pred = edgelabels_[pred_idx];
+
+  // Stop at transit stops, after a trip only within the transfer distance
+  if (reached != nullptr && nodeinfo->type() == NodeType::kMultiUseTransitPlatform) {
+    if (processed_tiles_.emplace(tile->id().tileid()).second) {
+      tc_->AddToExcludeList(tile);
+    }
+    if (!tc_->IsExcluded(tile, nodeinfo) &&
+        (walk_trips_ == 0 || pred.path_distance() <= max_transfer_distance_) &&
+        Improve(node, pred.cost().secs, pred_idx)) {
+      reached->push_back(node);
+    }
+  }
+
+  GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+  EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
+  const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
+    // Skip shortcuts, edges that are permanently labeled and transit lines, which are ridden
+    if (directededge->is_shortcut() || es->set() == EdgeSet::kPermanent ||
+        directededge->IsTransitLine()) {
+      continue;
+    }
+
+    // Prevent going from one transit connection directly to another at a transit stop - this is
+    // like entering a station and exiting without getting on transit
+    if (nodeinfo->type() == NodeType::kTransitEgress && pred.use() == Use::kTransitConnection &&
+        directededge->use() == Use::kTransitConnection) {
+      continue;
+    }
+
+    // Check access, this also validates the walking distance has not been exceeded
+    bool has_time_restrictions = false;
+    if (!pc_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions)) {
+      continue;
+    }
+
+    // Walking after a trip starts a new walking distance
+    Cost c = pc_->EdgeCost(directededge, tile);
+    c.cost *= pc_->GetModeFactor();
+    Cost newcost = pred.cost() + c;
+    uint32_t walking_distance = directededge->length();
+    if (pred.mode() == TravelMode::kPedestrian) {
+      newcost += pc_->TransitionCost(directededge, nodeinfo, pred);
+      walking_distance += pred.path_distance();
+    }
+
+    // If this edge is a destination, subtract the partial/remainder cost
+    // (cost from the dest. location to the end of the edge)
+    auto p = destinations_.find(edgeid);
+    if (p != destinations_.end()) {
+      newcost -= p->second;
+    }
+
+    // Check if edge is temporarily labeled and this path arrives earlier
+    if (es->set() == EdgeSet::kTemporary) {
+      MMEdgeLabel& lab = edgelabels_[es->index()];
+      if (newcost.secs < lab.cost().secs) {
+        adjacencylist_->decrease(es->index(), newcost.secs);
+        lab.Update(pred_idx, newcost, newcost.secs, walking_distance, 0, 0, has_time_restrictions);
+      }
+      continue;
+    }
+
+    // Add edge label, add to the adjacency list and set edge status
+    uint32_t idx = edgelabels_.size();
+    *es = {EdgeSet::kTemporary, idx};
+    edgelabels_.emplace_back(pred_idx, edgeid, directededge, newcost, newcost.secs, 0.0f,
+                             TravelMode::kPedestrian, walking_distance, 0, GraphId(), 0, 0,
+                             pred.has_transit(), has_time_restrictions);
+    adjacencylist_->add(idx);
+  }
+
+  // Handle transitions - expand from the end node each transition
+  if (!from_transition && nodeinfo->transition_count() > 0) {
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      ExpandWalk(graphreader, trans->endnode(), pred_idx, true, reached);
+    }
+  }
+}
+
+// Board the trips leaving the stops and ride them
+std::vector<GraphId> RaptorPathAlgorithm::Ride(GraphReader& graphreader,
+                                               const std::vector<GraphId>& stops) {
+  ridden_.clear();
+  std::vector<GraphId> improved;
+  std::unordered_set<uint64_t> boarded;
+  for (const auto& stop : stops) {
+    // A stop improved by a trip and then by a walk is boarded once
+    if (!boarded.emplace(stop).second) {
+      continue;
+    }
+    const GraphTile* tile = graphreader.GetGraphTile(stop);
+    if (tile == nullptr) {
+      continue;
+    }
+    const NodeInfo* nodeinfo = tile->node(stop);
+    if (processed_tiles_.emplace(tile->id().tileid()).second) {
+      tc_->AddToExcludeList(tile);
+    }
+    if (tc_->IsExcluded(tile, nodeinfo)) {
+      continue;
+    }
+
+    // we must get the date from level 3 transit tiles and not level 2.  The level 3 date is
+    // set when the fetcher grabbed the transit data and created the schedules.
+    if (!date_set_) {
+      uint32_t date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(origin_date_time_));
+      dow_ = DateTime::day_of_week_mask(origin_date_time_);
+      uint32_t date_created = tile->header()->date_created();
+      if (date < date_created) {
+        date_before_tile_ = true;
+      } else {
+        day_ = date - date_created;
+      }
+      date_set_ = true;
+    }
+
+    // Time to get to a vehicle: changing within the stop after a trip or entering the stop on foot
+    const arrival_t arrival = arrivals_[stop];
+    const MMEdgeLabel pred = edgelabels_[arrival.label];
+    bool transfer = pred.has_transit();
+    uint32_t localtime = LocalTime(nodeinfo, arrival.secs);
+    uint32_t boarding =
+        localtime + (pred.mode() == TravelMode::kPublicTransit
+                         ? kInStopTransferSecs
+                         : (transfer ? tc_->TransferCost().secs : tc_->DefaultTransferCost().secs));
+
+    // Board the next departure of every line leaving the stop
+    GraphId edgeid(stop.tileid(), stop.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid) {
+      bool has_time_restrictions = false;
+      if (!directededge->IsTransitLine() ||
+          !tc_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
+          tc_->IsExcluded(tile, directededge)) {
+        continue;
+      }
+      departure_ptr departure(tile->GetNextDeparture(directededge->lineid(), boarding, day_, dow_,
+                                                     date_before_tile_, tc_->wheelchair(),
+                                                     tc_->bicycle()));
+      // Staying on the trip the stop was reached with was ridden on already
+      if (!departure || departure->tripid() == pred.tripid()) {
+        continue;
+      }
+
+      // The wait for the departure is part of the cost of the edge
+      Cost cost = pred.cost() + tc_->EdgeCost(directededge, departure.get(), localtime);
+      if (transfer) {
+        cost.cost += tc_->TransferCost().cost;
+      }
+      uint32_t idx = edgelabels_.size();
+      edgelabels_.emplace_back(arrival.label, edgeid, directededge, cost, cost.secs, 0.0f,
+                               TravelMode::kPublicTransit, 0, departure->tripid(), stop,
+                               departure->blockid(), 0, true, has_time_restrictions);
+      RideTrip(graphreader, idx, departure.get(), improved);
+    }
+  }
+  return improved;
+}
+
+// Ride a trip stop by stop
+void RaptorPathAlgorithm::RideTrip(GraphReader& graphreader,
+                                   uint32_t label,
+                                   const TransitDeparture* departure,
+                                   std::vector<GraphId>& improved) {
+  const uint32_t tripid = departure->tripid();
+  departure_ptr next;
+  while (true) {
+    // Stop once the trip cannot arrive earlier than the destination was or another boarding of
+    // the trip in this round already rode on from here
+    const GraphId node = edgelabels_[label].endnode();
+    const float secs = edgelabels_[label].cost().secs;
+    if (secs >= best_.secs || !ridden_.emplace(tripid, node).second) {
+      return;
+    }
+    if (Improve(node, secs, label)) {
+      improved.push_back(node);
+    }
+
+    const GraphTile* tile = graphreader.GetGraphTile(node);
+    if (tile == nullptr) {
+      return;
+    }
+    const NodeInfo* nodeinfo = tile->node(node);
+    if (processed_tiles_.emplace(tile->id().tileid()).second) {
+      tc_->AddToExcludeList(tile);
+    }
+    if (tc_->IsExcluded(tile, nodeinfo)) {
+      return;
+    }
+
+    // Find the departure of the trip on the next edge, timed by the trip itself
+    const MMEdgeLabel pred = edgelabels_[label];
+    uint32_t arrival_time = departure->departure_time() + departure->elapsed_time();
+    GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
+    bool found = false;
+    for (uint32_t i = 0; i < nodeinfo->edge_count() && !found; i++, directededge++, ++edgeid) {
+      bool has_time_restrictions = false;
+      if (!directededge->IsTransitLine() ||
+          !tc_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
+          tc_->IsExcluded(tile, directededge)) {
+        continue;
+      }
+      departure_ptr onward(
+          tile->GetTransitDeparture(directededge->lineid(), tripid, arrival_time));
+      if (!onward) {
+        continue;
+      }
+      Cost cost = pred.cost() + tc_->EdgeCost(directededge, onward.get(), arrival_time);
+      uint32_t idx = edgelabels_.size();
+      edgelabels_.emplace_back(label, edgeid, directededge, cost, cost.secs, 0.0f,
+                               TravelMode::kPublicTransit, 0, tripid, node, onward->blockid(), 0,
+                               true, has_time_restrictions);
+      label = idx;
+      next = std::move(onward);
+      departure = next.get();
+      found = true;
+    }
+    if (!found) {
+      return;
+    }
+  }
+}
+
+// Keep the earliest arrival at a stop
+bool RaptorPathAlgorithm::Improve(const GraphId& stop, const float secs, const uint32_t label) {
+  if (secs >= best_.secs) {
+    return false;
+  }
+  auto arrival = arrivals_.emplace(stop, arrival_t{secs, label});
+  if (!arrival.second) {
+    if (secs >= arrival.first->second.secs) {
+      return false;
+    }
+    arrival.first->second = {secs, label};
+  }
+  return true;
+}
+
+// Keep the best arrival at the destination. Later arrivals lose, so do earlier ones with more
+// transfers than they are worth
+void RaptorPathAlgorithm::Arrive(const float secs, const uint32_t label, const uint32_t trips) {
+  const float penalty = tc_->TransferCost().cost;
+  const auto score = [penalty](const candidate_t& candidate) {
+    return candidate.secs + (candidate.trips > 1 ? candidate.trips - 1 : 0) * penalty;
+  };
+  candidate_t candidate{secs, label, trips};
+  if (best_.label == kInvalidLabel || score(candidate) < score(best_)) {
+    best_ = candidate;
+  }
+}
+
+// Local time at a node, adjusted for its time zone if different from the one at the start
+uint32_t RaptorPathAlgorithm::LocalTime(const NodeInfo* nodeinfo, const float secs) const {
+  uint32_t localtime = start_time_ + secs;
+  if (nodeinfo->timezone() != start_tz_index_) {
+    localtime += DateTime::timezone_diff(localtime, DateTime::get_tz_db().from_index(start_tz_index_),
+                                         DateTime::get_tz_db().from_index(nodeinfo->timezone()));
+  }
+  return localtime;
+}
+
+// Add a destination edge
+void RaptorPathAlgorithm::SetDestination(GraphReader& graphreader, const valhalla::Location& dest) {
+  // Only skip outbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(dest.path_edges().begin(), dest.path_edges().end(),
+                [&has_other_edges](const valhalla::Location::PathEdge& e) {
+                  has_other_edges = has_other_edges || !e.begin_node();
+                });
+
+  for (const auto& edge : dest.path_edges()) {
+    // If destination is at a node skip any outbound edges
+    if (has_other_edges && edge.begin_node()) {
+      continue;
+    }
+
+    // Disallow any user avoided edges if the avoid location is behind the destination along the edge
+    GraphId edgeid(edge.graph_id());
+    if (pc_->AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    // Keep the cost to traverse the partial distance for the remainder of the edge. This cost
+    // is subtracted from the total cost up to the end of the destination edge.
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* dest_diredge = tile->directededge(edgeid);
+    destinations_[edge.graph_id()] =
+        pc_->EdgeCost(dest_diredge, tile) * (1.0f - edge.percent_along());
+  }
+}
+
+// Form the path from the labels.
+std::vector<PathInfo> RaptorPathAlgorithm::FormPath(const uint32_t dest) {
+  // Metrics to track
+  LOG_DEBUG("path_cost::" + std::to_string(edgelabels_[dest].cost().cost));
+  LOG_DEBUG("path_iterations::" + std::to_string(edgelabels_.size()));
+
+  // Work backwards from the destination
+  std::vector<PathInfo> path;
+  for (auto edgelabel_index = dest; edgelabel_index != kInvalidLabel;
+       edgelabel_index = edgelabels_[edgelabel_index].predecessor()) {
+    const MMEdgeLabel& edgelabel = edgelabels_[edgelabel_index];
+    path.emplace_back(edgelabel.mode(), edgelabel.cost().secs, edgelabel.edgeid(), edgelabel.tripid(),
+                      edgelabel.cost().cost, edgelabel.has_time_restriction());
+
+    // Check if this is a ferry
+    if (edgelabel.use() == Use::kFerry) {
+      has_ferry_ = true;
+    }
+  }
+
+  // Reverse the list and return
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
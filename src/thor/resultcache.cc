@@ -0,0 +1,130 @@
+#include "thor/resultcache.h"
+#include "baldr/predictedspeeds.h"
+
+#include <cctype>
+
+namespace {
+
+// Round a date time down to the predicted speed bucket so that departures in the same bucket
+// share their result. Leaving now is the bucket of the current time
+void round_date_time(std::string& date_time) {
+  if (date_time == "current") {
+    auto minutes = std::chrono::duration_cast<std::chrono::minutes>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    date_time += ':' + std::to_string(minutes / valhalla::baldr::kSpeedBucketSizeMinutes);
+    return;
+  }
+  // YYYY-MM-DDTHH:MM
+  if (date_time.size() == 16 && std::isdigit(date_time[14]) && std::isdigit(date_time[15])) {
+    int minute = (date_time[14] - '0') * 10 + (date_time[15] - '0');
+    minute -= minute % valhalla::baldr::kSpeedBucketSizeMinutes;
+    date_time[14] = '0' + minute / 10;
+    date_time[15] = '0' + minute % 10;
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ResultCache::ResultCache(const size_t max_bytes, const uint32_t max_age)
+    : max_bytes_(max_bytes), bytes_(0), max_age_(max_age) {
+}
+
+bool ResultCache::Get(const std::string& key, std::string& result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = results_.find(key);
+  if (found == results_.end()) {
+    return false;
+  }
+  if (max_age_.count() != 0 &&
+      std::chrono::steady_clock::now() - found->second.computed >= max_age_) {
+    Drop(found);
+    return false;
+  }
+  used_.splice(used_.begin(), used_, found->second.used);
+  result = found->second.result;
+  return true;
+}
+
+void ResultCache::Put(const std::string& key, const std::string& result) {
+  auto bytes = key.size() + result.size();
+  if (bytes > max_bytes_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = results_.find(key);
+  if (found != results_.end()) {
+    Drop(found);
+  }
+  while (bytes_ + bytes > max_bytes_) {
+    Drop(results_.find(used_.back()));
+  }
+  used_.push_front(key);
+  results_.emplace(key, entry_t{result, std::chrono::steady_clock::now(), used_.begin()});
+  bytes_ += bytes;
+}
+
+size_t ResultCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return results_.size();
+}
+
+size_t ResultCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+void ResultCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  used_.clear();
+  results_.clear();
+  bytes_ = 0;
+}
+
+void ResultCache::Drop(std::unordered_map<std::string, entry_t>::iterator entry) {
+  bytes_ -= entry->first.size() + entry->second.result.size();
+  used_.erase(entry->second.used);
+  results_.erase(entry);
+}
+
+// The options as loki correlated them are all thor reads, without what only says how and when the
+// request is worked on. Transit schedules and the work done by the searches are not cached
+std::string ResultCache::Key(const Options& options) {
+  if ((options.action() != Options::route && options.action() != Options::optimized_route &&
+       options.action() != Options::sources_to_targets) ||
+      options.costing() == Costing::transit || options.costing() == Costing::multimodal ||
+      options.statistics()) {
+    return {};
+  }
+  Options normalized(options);
+  normalized.clear_deadline();
+  normalized.clear_cost();
+  if (normalized.has_date_time()) {
+    round_date_time(*normalized.mutable_date_time());
+  }
+  for (auto* locations : {normalized.mutable_locations(), normalized.mutable_sources(),
+                          normalized.mutable_targets()}) {
+    for (auto& location : *locations) {
+      if (location.has_date_time()) {
+        round_date_time(*location.mutable_date_time());
+      }
+    }
+  }
+  return normalized.SerializeAsString();
+}
+
+std::shared_ptr<ResultCache> ResultCache::Global(const size_t max_bytes, const uint32_t max_age) {
+  static std::mutex global_mutex;
+  static std::shared_ptr<ResultCache> global_cache;
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (!global_cache && max_bytes > 0) {
+    global_cache = std::make_shared<ResultCache>(max_bytes, max_age);
+  }
+  return max_bytes > 0 ? global_cache : nullptr;
+}
+
+} // namespace thor
+} // namespace valhalla
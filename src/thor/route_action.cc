@@ -129,20 +129,24 @@ namespace valhalla {
 namespace thor {
 
 std::string thor_worker_t::expansion(Api& request) {
-  // default the expansion geojson so its easy to add to as we go
-  rapidjson::Document dom;
-  dom.SetObject();
-  rapidjson::Pointer("/type").Set(dom, "FeatureCollection");
-  rapidjson::Pointer("/properties/algorithm").Set(dom, "none");
-  rapidjson::Pointer("/features/0/type").Set(dom, "Feature");
-  rapidjson::Pointer("/features/0/geometry/type").Set(dom, "MultiLineString");
-  rapidjson::Pointer("/features/0/geometry/coordinates").Create(dom).SetArray();
-  rapidjson::Pointer("/features/0/properties/edge_ids").Create(dom).SetArray();
-  rapidjson::Pointer("/features/0/properties/statuses").Create(dom).SetArray();
-
-  // a lambda that the path algorithm can call to add stuff to the dom
-  auto track_expansion = [&dom](baldr::GraphReader& reader, const char* algorithm,
-                                baldr::GraphId edgeid, const char* status, bool full_shape = false) {
+  // the edges are written out as they are tracked instead of piling up in a document. Either as
+  // one feature of all the edges with its properties in arrays alongside or, for ndjson, as a
+  // feature per edge on lines of their own
+  const bool lines = request.options().format() == Options::ndjson;
+  std::string algorithm = "none";
+  rapidjson::StringBuffer coords_buffer, ids_buffer, statuses_buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> coords(coords_buffer), ids(ids_buffer),
+      statuses(statuses_buffer);
+  coords.SetMaxDecimalPlaces(5);
+  if (!lines) {
+    coords.StartArray();
+    ids.StartArray();
+    statuses.StartArray();
+  }
+
+  // a lambda that the path algorithm can call to write out an edge
+  auto track_expansion = [&](baldr::GraphReader& reader, const char* alg, baldr::GraphId edgeid,
+                             const char* status, bool full_shape = false) {
     // full shape might be overkill but meh, its trace
     const auto* tile = reader.GetGraphTile(edgeid);
     const auto* edge = tile->directededge(edgeid);
@@ -151,29 +155,49 @@ std::string thor_worker_t::expansion(Api& request) {
       std::reverse(shape.begin(), shape.end());
     if (!full_shape && shape.size() > 2)
       shape.erase(shape.begin() + 1, shape.end() - 1);
+    algorithm = alg;
+
+    // a whole feature on a line of its own
+    if (lines) {
+      coords.Reset(coords_buffer);
+      coords.StartObject();
+      coords.Key("type");
+      coords.String("Feature");
+      coords.Key("geometry");
+      coords.StartObject();
+      coords.Key("type");
+      coords.String("LineString");
+      coords.Key("coordinates");
+    }
 
     // make the geom
-    auto& a = dom.GetAllocator();
-    auto* coords = rapidjson::Pointer("/features/0/geometry/coordinates").Get(dom);
-    coords->GetArray().PushBack(rapidjson::Value(rapidjson::kArrayType), a);
-    auto& linestring = (*coords)[coords->Size() - 1];
+    coords.StartArray();
     for (const auto& p : shape) {
-      linestring.GetArray().PushBack(rapidjson::Value(rapidjson::kArrayType), a);
-      auto point = linestring[linestring.Size() - 1].GetArray();
-      point.PushBack(p.first, a);
-      point.PushBack(p.second, a);
+      coords.StartArray();
+      coords.Double(p.first);
+      coords.Double(p.second);
+      coords.EndArray();
     }
+    coords.EndArray();
 
     // make the properties
-    rapidjson::Pointer("/properties/algorithm").Set(dom, algorithm);
-    rapidjson::Pointer("/features/0/properties/edge_ids")
-        .Get(dom)
-        ->GetArray()
-        .PushBack(static_cast<uint64_t>(edgeid), a);
-    rapidjson::Pointer("/features/0/properties/statuses")
-        .Get(dom)
-        ->GetArray()
-        .PushBack(rapidjson::Value{}.SetString(status, a), a);
+    if (lines) {
+      coords.EndObject();
+      coords.Key("properties");
+      coords.StartObject();
+      coords.Key("algorithm");
+      coords.String(alg);
+      coords.Key("edge_id");
+      coords.Uint64(static_cast<uint64_t>(edgeid));
+      coords.Key("status");
+      coords.String(status);
+      coords.EndObject();
+      coords.EndObject();
+      coords_buffer.Put('\n');
+    } else {
+      ids.Uint64(static_cast<uint64_t>(edgeid));
+      statuses.String(status);
+    }
   };
 
   // tell all the algorithms how to track expansion
@@ -201,8 +225,47 @@ std::string thor_worker_t::expansion(Api& request) {
     alg->set_track_expansion(nullptr);
   }
 
-  // serialize it
-  return rapidjson::to_string(dom, 5);
+  if (lines) {
+    return std::string(coords_buffer.GetString(), coords_buffer.GetSize());
+  }
+
+  // put the arrays into the feature
+  coords.EndArray();
+  ids.EndArray();
+  statuses.EndArray();
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("FeatureCollection");
+  writer.Key("properties");
+  writer.StartObject();
+  writer.Key("algorithm");
+  writer.String(algorithm.c_str());
+  writer.EndObject();
+  writer.Key("features");
+  writer.StartArray();
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("Feature");
+  writer.Key("geometry");
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("MultiLineString");
+  writer.Key("coordinates");
+  writer.RawValue(coords_buffer.GetString(), coords_buffer.GetSize(), rapidjson::kArrayType);
+  writer.EndObject();
+  writer.Key("properties");
+  writer.StartObject();
+  writer.Key("edge_ids");
+  writer.RawValue(ids_buffer.GetString(), ids_buffer.GetSize(), rapidjson::kArrayType);
+  writer.Key("statuses");
+  writer.RawValue(statuses_buffer.GetString(), statuses_buffer.GetSize(), rapidjson::kArrayType);
+  writer.EndObject();
+  writer.EndObject();
+  writer.EndArray();
+  writer.EndObject();
+  return std::string(buffer.GetString(), buffer.GetSize());
 }
 
 void thor_worker_t::route(Api& request) {
@@ -217,6 +280,7 @@ void thor_worker_t::route(Api& request) {
   } else {
     path_depart_at(request, costing);
   }
+  log_statistics(request);
   // log admin areas
   if (!options.do_not_track()) {
     for (const auto& route : request.trip().routes()) {
@@ -229,65 +293,155 @@ void thor_worker_t::route(Api& request) {
 
 thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routetype,
                                                        const valhalla::Location& origin,
-                                                       const valhalla::Location& destination) {
-  // Have to use multimodal for transit based routing
+                                                       const valhalla::Location& destination,
+                                                       const Options& options,
+                                                       leg_algorithms_t* algorithms) {
+  // Have to use multimodal or the round based router for transit based routing
   if (routetype == "multimodal" || routetype == "transit") {
+    if (transit_raptor) {
+      raptor.set_interrupt(interrupt);
+      return &raptor;
+    }
     multi_modal_astar.set_interrupt(interrupt);
     return &multi_modal_astar;
   }
 
-  // If the origin has date_time set use timedep_forward method if the distance
-  // between location is below some maximum distance (TBD).
-  if (origin.has_date_time()) {
-    PointLL ll1(origin.ll().lng(), origin.ll().lat());
-    PointLL ll2(destination.ll().lng(), destination.ll().lat());
-    if (ll1.Distance(ll2) < max_timedep_distance) {
-      timedep_forward.set_interrupt(interrupt);
-      return &timedep_forward;
+  // Whether any origin and destination edges are the same or are connected. Bidirectional A*
+  // does not handle these trivial cases with oneways and has issues when cost of origin or
+  // destination edge is high (needs a high threshold to find the proper connection).
+  auto adjacent = [&]() {
+    for (auto& edge1 : origin.path_edges()) {
+      for (auto& edge2 : destination.path_edges()) {
+        if (edge1.graph_id() == edge2.graph_id() ||
+            reader->AreEdgesConnected(GraphId(edge1.graph_id()), GraphId(edge2.graph_id()))) {
+          return true;
+        }
+      }
     }
-  }
+    return false;
+  };
 
-  // If the destination has date_time set use timedep_reverse method if the distance
-  // between location is below some maximum distance (TBD).
-  if (destination.has_date_time()) {
+  // If the origin or the destination has date_time set use the time dependent A* from that end
+  // if the distance between location is below some maximum distance (TBD). Otherwise, or if
+  // thor.timedep_bidirectional is set, bidirectional A* makes the search from that end time
+  // dependent, unless the locations are adjacent.
+  if (origin.has_date_time() || destination.has_date_time()) {
     PointLL ll1(origin.ll().lng(), origin.ll().lat());
     PointLL ll2(destination.ll().lng(), destination.ll().lat());
-    if (ll1.Distance(ll2) < max_timedep_distance) {
+    if (ll1.Distance(ll2) < max_timedep_distance && (!timedep_bidirectional || adjacent())) {
+      if (origin.has_date_time()) {
+        timedep_forward.set_interrupt(interrupt);
+        timedep_forward.set_queue_type(get_queue_type(routetype));
+        return &timedep_forward;
+      }
       timedep_reverse.set_interrupt(interrupt);
+      timedep_reverse.set_queue_type(get_queue_type(routetype));
       return &timedep_reverse;
     }
   }
 
   // Use A* if any origin and destination edges are the same or are connected - otherwise
-  // use bidirectional A*. Bidirectional A* does not handle trivial cases with oneways and
-  // has issues when cost of origin or destination edge is high (needs a high threshold to
-  // find the proper connection).
-  for (auto& edge1 : origin.path_edges()) {
-    for (auto& edge2 : destination.path_edges()) {
-      if (edge1.graph_id() == edge2.graph_id() ||
-          reader->AreEdgesConnected(GraphId(edge1.graph_id()), GraphId(edge2.graph_id()))) {
-        astar.set_interrupt(interrupt);
-        return &astar;
-      }
-    }
+  // use bidirectional A*. The algorithms of another thread can not check for interrupts.
+  auto* leg_interrupt = algorithms ? nullptr : interrupt;
+  if (adjacent()) {
+    auto& leg_astar = algorithms ? algorithms->astar : astar;
+    leg_astar.set_interrupt(leg_interrupt);
+    leg_astar.set_queue_type(get_queue_type(routetype));
+    return &leg_astar;
+  }
+  auto& leg_bidir_astar = algorithms ? algorithms->bidir_astar : bidir_astar;
+  leg_bidir_astar.set_interrupt(leg_interrupt);
+  leg_bidir_astar.set_queue_type(get_queue_type(routetype));
+
+  // The contraction hierarchies only know the default options of their costing and
+  // no time dependence, bidirectional A* stays around in case it finds no path. Only
+  // bidirectional A* forms alternates.
+  if (!algorithms && !origin.has_date_time() && !destination.has_date_time() &&
+      options.alternates() == 0 && use_contraction_hierarchy(options)) {
+    ch_query.set_graph(ch_graphs.find(options.costing())->second);
+    ch_query.set_interrupt(interrupt);
+    return &ch_query;
+  }
+
+  // Otherwise the customization of the cell partition for these costing options, made the first
+  // time they are seen. It knows no avoids either.
+  if (!algorithms && !origin.has_date_time() && !destination.has_date_time() &&
+      options.alternates() == 0 && options.avoid_locations_size() == 0 &&
+      options.avoid_polygons_size() == 0 && cell_partition && cell_overlays) {
+    const auto& costing = *mode_costing[static_cast<uint32_t>(mode)];
+    overlay_query.set_overlay(
+        cell_overlays->Get(sif::CostingCache::Key(options.costing(), options), [&]() {
+          return CellOverlay::Customize(cell_partition, *reader, costing);
+        }));
+    overlay_query.set_interrupt(interrupt);
+    return &overlay_query;
   }
-  bidir_astar.set_interrupt(interrupt);
-  return &bidir_astar;
+  return &leg_bidir_astar;
 }
 
+// The hierarchy limits tuned for the region of a leg replace those of the costing while its path is
+// searched, the next leg may be in another region
 std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm* path_algorithm,
                                                                  valhalla::Location& origin,
                                                                  valhalla::Location& destination,
                                                                  const std::string& costing,
-                                                                 const Options& options) {
+                                                                 const Options& options,
+                                                                 leg_algorithms_t* algorithms,
+                                                                 SearchStatistics* statistics) {
+  if (hierarchy_limits.empty()) {
+    return search_path(path_algorithm, origin, destination, costing, options, algorithms,
+                       statistics);
+  }
+  auto& cost = (algorithms ? algorithms->mode_costing : mode_costing)[static_cast<uint32_t>(mode)];
+  auto costing_limits = cost->GetHierarchyLimits();
+  hierarchy_limits.Apply(costing,
+                         {PointLL(origin.ll().lng(), origin.ll().lat()),
+                          PointLL(destination.ll().lng(), destination.ll().lat())},
+                         cost->GetHierarchyLimits());
+  auto paths =
+      search_path(path_algorithm, origin, destination, costing, options, algorithms, statistics);
+  cost->GetHierarchyLimits() = costing_limits;
+  return paths;
+}
+
+std::vector<std::vector<thor::PathInfo>>
+thor_worker_t::search_path(PathAlgorithm* path_algorithm,
+                           valhalla::Location& origin,
+                           valhalla::Location& destination,
+                           const std::string& costing,
+                           const Options& options,
+                           leg_algorithms_t* algorithms,
+                           SearchStatistics* statistics) {
+  // Another thread finding a leg has its own algorithms and costing
+  auto& leg_astar = algorithms ? algorithms->astar : astar;
+  auto& leg_bidir_astar = algorithms ? algorithms->bidir_astar : bidir_astar;
+  auto* leg_costing = algorithms ? algorithms->mode_costing : mode_costing;
+
+  // Try the contraction hierarchy or the cell overlay first and fall back to bidirectional A*
+  // when it has no path (e.g. the locations are not in the hierarchy or the partition)
+  if (path_algorithm == &ch_query || path_algorithm == &overlay_query) {
+    auto start = start_search();
+    auto paths =
+        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    end_search(statistics, path_algorithm->name(), path_algorithm->queue_stats(), start);
+    if (!paths.empty()) {
+      return paths;
+    }
+    path_algorithm->Clear();
+    path_algorithm = &bidir_astar;
+  }
+
   // Find the path. If bidirectional A* disable use of destination only edges on the
   // first pass. If there is a failure, we allow them on the second pass.
-  valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
-  if (path_algorithm == &bidir_astar) {
+  valhalla::sif::cost_ptr_t cost = leg_costing[static_cast<uint32_t>(mode)];
+  if (path_algorithm == &leg_bidir_astar) {
     cost->set_allow_destination_only(false);
   }
   cost->set_pass(0);
-  auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+  auto start = start_search();
+  auto paths =
+      path_algorithm->GetBestPath(origin, destination, *reader, leg_costing, mode, options);
+  end_search(statistics, path_algorithm->name(), path_algorithm->queue_stats(), start);
 
   // Check if we should run a second pass pedestrian route with different A*
   // (to look for better routes where a ferry is taken)
@@ -311,15 +465,17 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
 
     path_algorithm->Clear();
     cost->set_pass(1);
-    bool using_astar = (path_algorithm == &astar);
+    bool using_astar = (path_algorithm == &leg_astar);
     float relax_factor = using_astar ? 16.0f : 8.0f;
     float expansion_within_factor = using_astar ? 4.0f : 2.0f;
     cost->RelaxHierarchyLimits(relax_factor, expansion_within_factor);
     cost->set_allow_destination_only(true);
 
     // Get the best path. Return if not empty (else return the original path)
+    start = start_search();
     auto relaxed_paths =
-        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+        path_algorithm->GetBestPath(origin, destination, *reader, leg_costing, mode, options);
+    end_search(statistics, path_algorithm->name(), path_algorithm->queue_stats(), start);
     if (!relaxed_paths.empty()) {
       return relaxed_paths;
     }
@@ -332,6 +488,55 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
   return paths;
 }
 
+// Find the legs of a route on the thread pool when they do not depend on each other. That is
+// when no location is passed through on the edge the leg before arrived on, no date_time is
+// carried from one leg to the next and no second pass adds filtered edges to a location that
+// the next leg starts from. Returns nothing when the legs have to be found one after the other.
+std::vector<std::vector<std::vector<thor::PathInfo>>>
+thor_worker_t::get_legs(Api& api, const std::string& costing) {
+  const auto& options = api.options();
+  const auto& locations = options.locations();
+  if (!matrix_pool || !reader->IsThreadSafe() || locations.size() < 3 ||
+      options.action() == Options::expansion || costing == "multimodal" || costing == "transit" ||
+      use_contraction_hierarchy(options)) {
+    return {};
+  }
+  for (const auto& location : locations) {
+    if (location.type() == valhalla::Location::kThrough ||
+        location.type() == valhalla::Location::kBreakThrough || location.has_date_time() ||
+        location.filtered_edges_size() > 0) {
+      return {};
+    }
+  }
+
+  // The calling thread uses the algorithms and costing of the worker, the others their own
+  while (leg_algorithms.size() + 1 < matrix_pool->concurrency()) {
+    leg_algorithms.emplace_back(new leg_algorithms_t());
+    leg_algorithms.back()->astar.set_landmarks(landmarks);
+    leg_algorithms.back()->bidir_astar.set_landmarks(landmarks);
+  }
+  for (auto& algorithms : leg_algorithms) {
+    algorithms->mode_costing[static_cast<uint32_t>(mode)] = get_costing(options.costing(), options);
+  }
+
+  // Each leg works on copies of its locations since the leg before and after share them
+  std::vector<std::vector<std::vector<thor::PathInfo>>> legs(locations.size() - 1);
+  std::vector<SearchStatistics> statistics(record_statistics(options) ? legs.size() : 0);
+  matrix_pool->parallel_for(legs.size(), [&](const uint32_t i, const uint32_t slot) {
+    auto* algorithms = slot == 0 ? nullptr : leg_algorithms[slot - 1].get();
+    valhalla::Location origin(locations.Get(i));
+    valhalla::Location destination(locations.Get(i + 1));
+    auto* path_algorithm = get_path_algorithm(costing, origin, destination, options, algorithms);
+    path_algorithm->Clear();
+    legs[i] = get_path(path_algorithm, origin, destination, costing, options, algorithms,
+                       statistics.empty() ? nullptr : &statistics[i]);
+  });
+  for (auto& leg_statistics : statistics) {
+    api.add_statistics()->Swap(&leg_statistics);
+  }
+  return legs;
+}
+
 void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
   // Things we'll need
   TripRoute* route = nullptr;
@@ -344,7 +549,8 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
   for (auto origin = ++correlated.rbegin(); origin != correlated.rend(); ++origin) {
     // Get the algorithm type for this location pair
     auto destination = std::prev(origin);
-    thor::PathAlgorithm* path_algorithm = get_path_algorithm(costing, *origin, *destination);
+    thor::PathAlgorithm* path_algorithm =
+        get_path_algorithm(costing, *origin, *destination, api.options());
     path_algorithm->Clear();
 
     // TODO: delete this and send all cases to the function above
@@ -360,7 +566,9 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
     }
 
     // Get best path and keep it
-    auto temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    auto temp_paths =
+        get_path(path_algorithm, *origin, *destination, costing, api.options(), nullptr,
+                 record_statistics(api.options()) ? api.add_statistics() : nullptr);
     for (auto& temp_path : temp_paths) {
       // back propagate time information
       if (destination->has_date_time()) {
@@ -433,27 +641,40 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
   std::list<valhalla::TripLeg> trip_paths;
   auto& correlated = *api.mutable_options()->mutable_locations();
 
+  // Find the legs up front if they do not depend on each other
+  auto legs = get_legs(api, costing);
+
   // For each pair of locations
   for (auto destination = ++correlated.begin(); destination != correlated.end(); ++destination) {
     // Get the algorithm type for this location pair
     auto origin = std::prev(destination);
-    thor::PathAlgorithm* path_algorithm = get_path_algorithm(costing, *origin, *destination);
-    path_algorithm->Clear();
-
-    // TODO: delete this and send all cases to the function above
-    // If we are continuing through a location we need to make sure we
-    // only allow the edge that was used previously (avoid u-turns)
-    bool through = origin->type() == valhalla::Location::kThrough ||
-                   origin->type() == valhalla::Location::kBreakThrough;
-    while (through && last_edge.Is_Valid() && origin->path_edges_size() > 1) {
-      if (origin->path_edges().rbegin()->graph_id() == last_edge) {
-        origin->mutable_path_edges()->SwapElements(0, origin->path_edges_size() - 1);
+    std::vector<std::vector<thor::PathInfo>> temp_paths;
+    if (!legs.empty()) {
+      temp_paths.swap(legs[std::distance(correlated.begin(), origin)]);
+    } else {
+      thor::PathAlgorithm* path_algorithm =
+          get_path_algorithm(costing, *origin, *destination, api.options());
+      path_algorithm->Clear();
+
+      // TODO: delete this and send all cases to the function above
+      // If we are continuing through a location we need to make sure we
+      // only allow the edge that was used previously (avoid u-turns)
+      bool through = origin->type() == valhalla::Location::kThrough ||
+                     origin->type() == valhalla::Location::kBreakThrough;
+      while (through && last_edge.Is_Valid() && origin->path_edges_size() > 1) {
+        if (origin->path_edges().rbegin()->graph_id() == last_edge) {
+          origin->mutable_path_edges()->SwapElements(0, origin->path_edges_size() - 1);
+        }
+        origin->mutable_path_edges()->RemoveLast();
       }
-      origin->mutable_path_edges()->RemoveLast();
+
+      // Get best path
+      temp_paths =
+          get_path(path_algorithm, *origin, *destination, costing, api.options(), nullptr,
+                   record_statistics(api.options()) ? api.add_statistics() : nullptr);
     }
 
-    // Get best path and keep it
-    auto temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    // Keep the best path
     for (auto& temp_path : temp_paths) {
       // forward propagate time information
       if (origin->has_date_time()) {
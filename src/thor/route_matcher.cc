@@ -3,7 +3,9 @@
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include <algorithm>
+#include <cmath>
 #include <exception>
+#include <unordered_map>
 #include <vector>
 
 #include "thor/route_matcher.h"
@@ -94,142 +96,259 @@ end_node_t GetEndEdges(GraphReader& reader,
   return end_nodes;
 }
 
+// Size (degrees) of the cells the shape points are binned into. It is bigger than twice the
+// tolerance of PointLL::ApproximatelyEqual so the points equal to a position are always within
+// the cells around the one the position falls in.
+constexpr float kShapeCellSize = 0.0001f;
+
+// The shape points binned by position along with the distance along the shape to each. The
+// points an edge may end at are looked up in the cells around its end node rather than walked
+// to one by one along the shape for every edge tried.
+class shape_index_t {
+public:
+  shape_index_t(const std::vector<meili::Measurement>& shape) {
+    distances_.reserve(shape.size());
+    float total_distance = 0.0f;
+    for (size_t i = 0; i < shape.size(); i++) {
+      if (i > 0) {
+        total_distance += shape[i].lnglat().Distance(shape[i - 1].lnglat());
+      }
+      distances_.push_back(total_distance);
+      cells_[cell(shape[i].lnglat(), 0, 0)].push_back(i);
+    }
+  }
+
+  // Distance along the shape to a shape point
+  float distance(const size_t index) const {
+    return distances_[index];
+  }
+
+  // Total distance along the shape
+  float total_distance() const {
+    return distances_.back();
+  }
+
+  /**
+   * Finds the first shape point from an index on that is approximately at a position and that
+   * is at most some distance along the shape from another shape point.
+   * @param shape       The shape that was indexed.
+   * @param first       First index to consider.
+   * @param base        Index to measure the distance along the shape from.
+   * @param max_length  Farthest to look along the shape from base.
+   * @param ll          Position to find.
+   * @param accept      Called with the distance along the shape from base to each point found
+   *                    in turn until it returns true.
+   * @return Returns the index of the shape point, the shape size if there is none.
+   */
+  template <typename accept_t>
+  size_t find(const std::vector<meili::Measurement>& shape,
+              const size_t first,
+              const size_t base,
+              const float max_length,
+              const midgard::PointLL& ll,
+              const accept_t& accept) const {
+    candidates_.clear();
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        auto found = cells_.find(cell(ll, dx, dy));
+        if (found == cells_.end()) {
+          continue;
+        }
+        for (auto i = std::lower_bound(found->second.begin(), found->second.end(), first);
+             i != found->second.end() && distances_[*i] - distances_[base] <= max_length; ++i) {
+          candidates_.push_back(*i);
+        }
+      }
+    }
+    std::sort(candidates_.begin(), candidates_.end());
+    for (auto i : candidates_) {
+      if (shape[i].lnglat().ApproximatelyEqual(ll) && accept(distances_[i] - distances_[base])) {
+        return i;
+      }
+    }
+    return shape.size();
+  }
+
+private:
+  static uint64_t cell(const midgard::PointLL& ll, const int dx, const int dy) {
+    auto x = static_cast<int32_t>(std::floor(ll.lng() / kShapeCellSize)) + dx;
+    auto y = static_cast<int32_t>(std::floor(ll.lat() / kShapeCellSize)) + dy;
+    return static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32 | static_cast<uint32_t>(x);
+  }
+
+  std::vector<float> distances_;
+  std::unordered_map<uint64_t, std::vector<size_t>> cells_;
+  mutable std::vector<size_t> candidates_;
+};
+
+// A node the edge walk expands from, along with how far it got through the edges and
+// transitions of the node
+struct expansion_t {
+  size_t correlated_index;
+  const GraphTile* tile;
+  GraphId node;
+  bool from_transition;
+  bool started;
+  bool transitions; // done with the edges, on to the transitions
+  uint32_t i;       // edge or transition being followed
+  sif::Cost cost;   // added by the edge being followed, to take back if the walk along it fails
+};
+
 // Expand from a correlated node. Walks the shape ahead to find the next correlated
 // node and expands from there. Returns true once the end node has been found (and
 // distance is approximately what it should be). Returns false if expansion from this
 // node fails (cannot find edges that match the trace - either in position or distance).
+// The walk backtracks over edges that lead nowhere, it keeps the nodes on its way on a
+// stack of its own rather than recursing so long shapes cannot overflow the call stack.
 bool expand_from_node(const std::shared_ptr<DynamicCost>* mode_costing,
                       const TravelMode& mode,
                       GraphReader& reader,
                       const std::vector<meili::Measurement>& shape,
-                      std::vector<std::pair<float, float>>& distances,
+                      const shape_index_t& shape_index,
                       uint32_t origin_epoch,
                       const bool use_timestamps,
-                      size_t& correlated_index,
+                      const size_t correlated_index,
                       const GraphTile* tile,
                       const GraphId& node,
                       end_node_t& end_nodes,
                       EdgeLabel& prev_edge_label,
                       sif::Cost& elapsed,
                       std::vector<PathInfo>& path_infos,
-                      const bool from_transition,
                       GraphId& end_node,
                       followed_edges_t& followed_edges) {
-  // Done expanding when node equals stop node and the accumulated distance to that node
-  // plus the partial last edge distance is approximately equal to the total distance
-  auto n = end_nodes.find(node);
-  if (n != end_nodes.end() &&
-      midgard::equal<float>((distances[correlated_index].second + n->second.second),
-                            distances.back().second, kTotalDistanceEpsilon)) {
-    end_node = node;
-    return true;
-  }
-
-  // Get the last edge followed from this index
-  uint32_t level = node.level();
-  uint32_t start_de = followed_edges[correlated_index][level].first;
-
-  // Iterate through directed edges from this node
-  const NodeInfo* nodeinfo = tile->node(node);
-  GraphId edge_id(node.tileid(), level, nodeinfo->edge_index());
-  const DirectedEdge* de = tile->directededge(nodeinfo->edge_index());
-  for (uint32_t i = start_de; i < nodeinfo->edge_count(); i++, de++, ++edge_id) {
-    // Mark the directed edge as already followed
-    followed_edges[correlated_index][level].first = i;
-
-    // Skip shortcuts and transit connection edges
-    // TODO - later might allow transit connections for multi-modal
-    if (de->is_shortcut() || de->use() == Use::kTransitConnection) {
-      continue;
-    }
+  std::vector<expansion_t> stack;
+  stack.push_back({correlated_index, tile, node, false, false, false, 0, {}});
+  while (!stack.empty()) {
+    expansion_t& expansion = stack.back();
+    const size_t index = expansion.correlated_index;
+    const uint32_t level = expansion.node.level();
+    const NodeInfo* nodeinfo = expansion.tile->node(expansion.node);
+
+    if (!expansion.started) {
+      expansion.started = true;
+
+      // Done expanding when node equals stop node and the accumulated distance to that node
+      // plus the partial last edge distance is approximately equal to the total distance
+      auto n = end_nodes.find(expansion.node);
+      if (n != end_nodes.end() &&
+          midgard::equal<float>((shape_index.distance(index) + n->second.second),
+                                shape_index.total_distance(), kTotalDistanceEpsilon)) {
+        end_node = expansion.node;
+        return true;
+      }
 
-    // Look back in path_infos by 1-2 edges to make sure we aren't in a loop.
-    // A loop can occur if we have edges shorter than the lat,lng tolerance.
-    uint32_t n = path_infos.size();
-    if (n > 1 && (edge_id == path_infos[n - 2].edgeid || edge_id == path_infos[n - 1].edgeid)) {
-      continue;
+      // Start from the last edge followed from this index
+      expansion.i = followed_edges[index][level].first;
     }
 
-    // Get the end node LL and set up the length comparison
-    const GraphTile* end_node_tile = reader.GetGraphTile(de->endnode());
-    if (end_node_tile == nullptr) {
-      continue;
-    }
-    midgard::PointLL de_end_ll = end_node_tile->get_node_ll(de->endnode());
-    float de_length = length_comparison(de->length(), true);
-
-    // Process current edge until shape matches end node or shape length is longer than
-    // the current edge. Increment to the next shape point after the correlated index.
-    size_t index = correlated_index + 1;
-    float length = 0.0f;
-    while (index < shape.size()) {
-      // Exclude edge if length along shape is longer than the edge length
-      length += distances.at(index).first;
-      if (length > de_length) {
-        break;
+    // Iterate through directed edges from this node until one matches the shape
+    bool expanded = false;
+    for (; !expansion.transitions && expansion.i < nodeinfo->edge_count(); ++expansion.i) {
+      // Mark the directed edge as already followed
+      followed_edges[index][level].first = expansion.i;
+      GraphId edge_id(expansion.node.tileid(), level, nodeinfo->edge_index() + expansion.i);
+      const DirectedEdge* de =
+          expansion.tile->directededge_unchecked(nodeinfo->edge_index() + expansion.i);
+
+      // Skip shortcuts and transit connection edges
+      // TODO - later might allow transit connections for multi-modal
+      if (de->is_shortcut() || de->use() == Use::kTransitConnection) {
+        continue;
       }
 
-      // Found a match if shape equals directed edge LL within tolerance
-      if (shape.at(index).lnglat().ApproximatelyEqual(de_end_ll) &&
-          de->length() < length_comparison(length, true)) {
-
-        // Get seconds from beginning of the week accounting for any changes to timezone on the path
-        uint32_t second_of_week = kInvalidSecondsOfWeek;
-        if (origin_epoch != 0 && nodeinfo) {
-          second_of_week =
-              DateTime::second_of_week(origin_epoch + static_cast<uint32_t>(elapsed.secs),
-                                       DateTime::get_tz_db().from_index(nodeinfo->timezone()));
-        }
+      // Look back in path_infos by 1-2 edges to make sure we aren't in a loop.
+      // A loop can occur if we have edges shorter than the lat,lng tolerance.
+      uint32_t n = path_infos.size();
+      if (n > 1 && (edge_id == path_infos[n - 2].edgeid || edge_id == path_infos[n - 1].edgeid)) {
+        continue;
+      }
 
-        // get the cost of traversing the node and the edge
-        auto& costing = mode_costing[static_cast<int>(mode)];
-        auto cost = costing->TransitionCost(de, nodeinfo, prev_edge_label) +
-                    costing->EdgeCost(de, end_node_tile, second_of_week);
-        elapsed += cost;
-        // overwrite time with timestamps
-        if (use_timestamps)
-          elapsed.secs = shape[index].epoch_time() - shape[0].epoch_time();
+      // Get the end node LL and set up the length comparison
+      const GraphTile* end_node_tile = reader.GetGraphTile(de->endnode());
+      if (end_node_tile == nullptr) {
+        continue;
+      }
+      midgard::PointLL de_end_ll = end_node_tile->get_node_ll(de->endnode());
+      float de_length = length_comparison(de->length(), true);
+
+      // Find the first shape point after the correlated index that matches the end node
+      // without the shape being longer than the edge
+      size_t next = shape_index.find(shape, index + 1, index, de_length, de_end_ll,
+                                     [de](const float length) {
+                                       return de->length() < length_comparison(length, true);
+                                     });
+      if (next == shape.size()) {
+        continue;
+      }
 
-        // Add edge and update correlated index
-        path_infos.emplace_back(mode, elapsed.secs, edge_id, 0, elapsed.cost, false);
+      // Get seconds from beginning of the week accounting for any changes to timezone on the path
+      uint32_t second_of_week = kInvalidSecondsOfWeek;
+      if (origin_epoch != 0 && nodeinfo) {
+        second_of_week =
+            DateTime::second_of_week(origin_epoch + static_cast<uint32_t>(elapsed.secs),
+                                     DateTime::get_tz_db().from_index(nodeinfo->timezone()));
+      }
 
-        // Set previous edge label
-        prev_edge_label = {kInvalidLabel, edge_id, de, {}, 0, 0, mode, 0};
+      // get the cost of traversing the node and the edge
+      auto& costing = mode_costing[static_cast<int>(mode)];
+      auto cost = costing->TransitionCost(de, nodeinfo, prev_edge_label) +
+                  costing->EdgeCost(de, end_node_tile, second_of_week);
+      elapsed += cost;
+      // overwrite time with timestamps
+      if (use_timestamps)
+        elapsed.secs = shape[next].epoch_time() - shape[0].epoch_time();
+
+      // Add edge and update correlated index
+      path_infos.emplace_back(mode, elapsed.secs, edge_id, 0, elapsed.cost, false);
+
+      // Set previous edge label
+      prev_edge_label = {kInvalidLabel, edge_id, de, {}, 0, 0, mode, 0};
+
+      // Continue walking shape to find the end edge...
+      expansion.cost = cost;
+      stack.push_back({next, end_node_tile, de->endnode(), false, false, false, 0, {}});
+      expanded = true;
+      break;
+    }
+    if (expanded) {
+      continue;
+    }
 
-        // Continue walking shape to find the end edge...
-        if (expand_from_node(mode_costing, mode, reader, shape, distances, origin_epoch,
-                             use_timestamps, index, end_node_tile, de->endnode(), end_nodes,
-                             prev_edge_label, elapsed, path_infos, false, end_node, followed_edges)) {
-          return true;
-        } else {
-          // Match failed along this edge, pop the last entry off path_infos as well as what it
-          // contributed to the elapsed cost/time and try to keep going on the next edge
-          elapsed -= cost;
-          path_infos.pop_back();
-          break;
+    // Handle transitions - expand from the transition end nodes, starting from the last
+    // transition followed from this index
+    if (!expansion.transitions) {
+      expansion.transitions = true;
+      expansion.i = followed_edges[index][level].second;
+    }
+    if (!expansion.from_transition && nodeinfo->transition_count() > 0) {
+      const NodeTransition* trans =
+          expansion.tile->transition_unchecked(nodeinfo->transition_index() + expansion.i);
+      for (; expansion.i < nodeinfo->transition_count(); ++expansion.i, ++trans) {
+        followed_edges[index][level].second = expansion.i;
+        const GraphTile* end_node_tile = reader.GetGraphTile(trans->endnode());
+        if (end_node_tile == nullptr) {
+          continue;
         }
+        stack.push_back({index, end_node_tile, trans->endnode(), true, false, false, 0, {}});
+        expanded = true;
+        break;
       }
-      index++;
     }
-  }
-
-  // Get the last transition followed from this index
-  uint32_t start_trans = followed_edges[correlated_index][level].second;
+    if (expanded) {
+      continue;
+    }
 
-  // Handle transitions - expand from the transition end nodes
-  if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
-    for (uint32_t i = start_trans; i < nodeinfo->transition_count(); ++i, ++trans) {
-      followed_edges[correlated_index][level].second = i;
-      const GraphTile* end_node_tile = reader.GetGraphTile(trans->endnode());
-      if (end_node_tile == nullptr) {
-        continue;
-      }
-      if (expand_from_node(mode_costing, mode, reader, shape, distances, origin_epoch, use_timestamps,
-                           correlated_index, end_node_tile, trans->endnode(), end_nodes,
-                           prev_edge_label, elapsed, path_infos, true, end_node, followed_edges)) {
-        return true;
+    // Expansion from this node failed, go back to the node it was reached from
+    stack.pop_back();
+    if (!stack.empty()) {
+      auto& parent = stack.back();
+      if (!parent.transitions) {
+        // Match failed along this edge, pop the last entry off path_infos as well as what it
+        // contributed to the elapsed cost/time and try to keep going on the next edge
+        elapsed -= parent.cost;
+        path_infos.pop_back();
       }
+      ++parent.i;
     }
   }
   return false;
@@ -249,15 +368,8 @@ bool RouteMatcher::FormPath(const std::shared_ptr<DynamicCost>* mode_costing,
     throw std::runtime_error("Invalid shape - less than 2 points");
   }
 
-  // Form distances between shape points and accumulated distance from start to each shape point
-  float total_distance = 0.0f;
-  std::vector<std::pair<float, float>> distances;
-  distances.push_back(std::make_pair(0.0f, 0.0f));
-  for (size_t i = 1; i < shape.size(); i++) {
-    float d = shape[i].lnglat().Distance(shape[i - 1].lnglat());
-    total_distance += d;
-    distances.push_back(std::make_pair(d, total_distance));
-  }
+  // Index the shape points by position and accumulated distance from start to each
+  shape_index_t shape_index(shape);
 
   // Keep a record of followed edges and transition from each shape index (for each hierarchy level) -
   // this prevents doubling back and causing an infinite loop (could be due to transitions)
@@ -329,24 +441,65 @@ bool RouteMatcher::FormPath(const std::shared_ptr<DynamicCost>* mode_costing,
     }
     midgard::PointLL de_end_ll = end_node_tile->get_node_ll(de->endnode());
 
-    // Initialize indexes and shape
-    size_t index = 0;
-    float length = 0.0f;
+    // Find the shape point within tolerance at the end node
     float de_remaining_length = de->length() * (1 - edge.percent_along());
     float de_length = length_comparison(de_remaining_length, true);
     EdgeLabel prev_edge_label;
     Cost elapsed;
-
-    // Loop over shape to form path from matching edges
-    while (index < shape.size()) {
-      length += distances.at(index).first;
-      if (length > de_length) {
-        break;
+    size_t index = shape_index.find(shape, 0, 0, de_length, de_end_ll,
+                                    [de_remaining_length](const float length) {
+                                      return de_remaining_length < length_comparison(length, true);
+                                    });
+
+    // Form path from matching edges
+    if (index < shape.size()) {
+      // Get seconds from beginning of the week accounting for any changes to timezone on the path
+      uint32_t second_of_week = kInvalidSecondsOfWeek;
+      if (origin_epoch != 0 && nodeinfo) {
+        second_of_week =
+            DateTime::second_of_week(origin_epoch + static_cast<uint32_t>(elapsed.secs),
+                                     DateTime::get_tz_db().from_index(nodeinfo->timezone()));
       }
 
-      // Check if shape is within tolerance at the end node
-      if (shape.at(index).lnglat().ApproximatelyEqual(de_end_ll) &&
-          de_remaining_length < length_comparison(length, true)) {
+      // Get the cost of traversing the edge
+      elapsed += mode_costing[static_cast<int>(mode)]->EdgeCost(de, end_node_tile, second_of_week) *
+                 (1 - edge.percent_along());
+      // overwrite time with timestamps
+      if (options.use_timestamps())
+        elapsed.secs = shape[index].epoch_time() - shape[0].epoch_time();
+
+      // Add begin edge
+      path_infos.emplace_back(mode, elapsed.secs, graphid, 0, elapsed.cost, false);
+
+      // Set previous edge label
+      prev_edge_label = {kInvalidLabel, graphid, de, {}, 0, 0, mode, 0};
+
+      // Continue walking shape to find the end node
+      GraphId end_node;
+      if (expand_from_node(mode_costing, mode, reader, shape, shape_index, origin_epoch,
+                           options.use_timestamps(), index, end_node_tile, de->endnode(), end_nodes,
+                           prev_edge_label, elapsed, path_infos, end_node, followed_edges)) {
+        // If node equals stop node then when are done expanding - get the matching end edge
+        auto n = end_nodes.find(end_node);
+        if (n == end_nodes.end()) {
+          return false;
+        }
+
+        // If the end edge is at a node then we are done (no partial time
+        // along a destination edge)
+        auto end_edge = n->second.first;
+        if (end_edge.end_node()) {
+          return true;
+        }
+
+        // Get the end edge and add transition time and partial time along
+        // the destination edge.
+        GraphId end_edge_graphid(end_edge.graph_id());
+        const GraphTile* end_edge_tile = reader.GetGraphTile(end_edge_graphid);
+        if (end_edge_tile == nullptr) {
+          throw std::runtime_error("End edge tile is null");
+        }
+        const DirectedEdge* end_de = end_edge_tile->directededge(end_edge_graphid);
 
         // Get seconds from beginning of the week accounting for any changes to timezone on the path
         uint32_t second_of_week = kInvalidSecondsOfWeek;
@@ -356,73 +509,23 @@ bool RouteMatcher::FormPath(const std::shared_ptr<DynamicCost>* mode_costing,
                                        DateTime::get_tz_db().from_index(nodeinfo->timezone()));
         }
 
-        // Get the cost of traversing the edge
-        elapsed += mode_costing[static_cast<int>(mode)]->EdgeCost(de, end_node_tile, second_of_week) *
-                   (1 - edge.percent_along());
+        // get the cost of traversing the node and the remaining part of the edge
+        auto& costing = mode_costing[static_cast<int>(mode)];
+        nodeinfo = end_edge_tile->node(n->first);
+        elapsed +=
+            costing->TransitionCost(end_de, nodeinfo, prev_edge_label) +
+            costing->EdgeCost(end_de, end_edge_tile, second_of_week) * end_edge.percent_along();
         // overwrite time with timestamps
         if (options.use_timestamps())
-          elapsed.secs = shape[index].epoch_time() - shape[0].epoch_time();
-
-        // Add begin edge
-        path_infos.emplace_back(mode, elapsed.secs, graphid, 0, elapsed.cost, false);
-
-        // Set previous edge label
-        prev_edge_label = {kInvalidLabel, graphid, de, {}, 0, 0, mode, 0};
-
-        // Continue walking shape to find the end node
-        GraphId end_node;
-        if (expand_from_node(mode_costing, mode, reader, shape, distances, origin_epoch,
-                             options.use_timestamps(), index, end_node_tile, de->endnode(), end_nodes,
-                             prev_edge_label, elapsed, path_infos, false, end_node, followed_edges)) {
-          // If node equals stop node then when are done expanding - get the matching end edge
-          auto n = end_nodes.find(end_node);
-          if (n == end_nodes.end()) {
-            return false;
-          }
-
-          // If the end edge is at a node then we are done (no partial time
-          // along a destination edge)
-          auto end_edge = n->second.first;
-          if (end_edge.end_node()) {
-            return true;
-          }
-
-          // Get the end edge and add transition time and partial time along
-          // the destination edge.
-          GraphId end_edge_graphid(end_edge.graph_id());
-          const GraphTile* end_edge_tile = reader.GetGraphTile(end_edge_graphid);
-          if (end_edge_tile == nullptr) {
-            throw std::runtime_error("End edge tile is null");
-          }
-          const DirectedEdge* end_de = end_edge_tile->directededge(end_edge_graphid);
-
-          // Get seconds from beginning of the week accounting for any changes to timezone on the path
-          uint32_t second_of_week = kInvalidSecondsOfWeek;
-          if (origin_epoch != 0 && nodeinfo) {
-            second_of_week =
-                DateTime::second_of_week(origin_epoch + static_cast<uint32_t>(elapsed.secs),
-                                         DateTime::get_tz_db().from_index(nodeinfo->timezone()));
-          }
-
-          // get the cost of traversing the node and the remaining part of the edge
-          auto& costing = mode_costing[static_cast<int>(mode)];
-          nodeinfo = end_edge_tile->node(n->first);
-          elapsed +=
-              costing->TransitionCost(end_de, nodeinfo, prev_edge_label) +
-              costing->EdgeCost(end_de, end_edge_tile, second_of_week) * end_edge.percent_along();
-          // overwrite time with timestamps
-          if (options.use_timestamps())
-            elapsed.secs = shape.back().epoch_time() - shape[0].epoch_time();
-
-          // Add end edge
-          path_infos.emplace_back(mode, elapsed.secs, end_edge_graphid, 0, elapsed.cost, false);
-          return true;
-        } else {
-          // Did not find an edge that correlates with the trace, return false.
-          return false;
-        }
+          elapsed.secs = shape.back().epoch_time() - shape[0].epoch_time();
+
+        // Add end edge
+        path_infos.emplace_back(mode, elapsed.secs, end_edge_graphid, 0, elapsed.cost, false);
+        return true;
+      } else {
+        // Did not find an edge that correlates with the trace, return false.
+        return false;
       }
-      index++;
     }
 
     // Did not find the end of the origin edge. Check for special case where
@@ -0,0 +1,94 @@
+#include "thor/threadpool.h"
+
+namespace valhalla {
+namespace thor {
+
+ThreadPool::ThreadPool(const uint32_t concurrency)
+    : work_(nullptr), count_(0), next_(0), busy_(0), generation_(0), stop_(false) {
+  uint32_t threads = concurrency > 0 ? concurrency : std::thread::hardware_concurrency();
+  for (uint32_t i = 1; i < threads; ++i) {
+    threads_.emplace_back(&ThreadPool::run, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::parallel_for(const uint32_t count, const std::function<void(uint32_t)>& work) {
+  parallel_for(count, [&work](const uint32_t i, const uint32_t) { work(i); });
+}
+
+void ThreadPool::parallel_for(const uint32_t count,
+                              const std::function<void(uint32_t, uint32_t)>& work) {
+  // Not worth waking anybody up
+  if (threads_.empty() || count < 2) {
+    for (uint32_t i = 0; i < count; ++i) {
+      work(i, 0);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    work_ = &work;
+    count_ = count;
+    next_ = 0;
+    busy_ = threads_.size();
+    error_ = nullptr;
+    ++generation_;
+  }
+  start_.notify_all();
+  drain(0);
+
+  // Wait for the other threads to finish their last item
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this]() { return busy_ == 0; });
+  work_ = nullptr;
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void ThreadPool::drain(const uint32_t slot) {
+  for (uint32_t i = next_++; i < count_; i = next_++) {
+    try {
+      (*work_)(i, slot);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+void ThreadPool::run(const uint32_t slot) {
+  uint64_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, generation]() { return stop_ || generation_ != generation; });
+      if (stop_) {
+        return;
+      }
+      generation = generation_;
+    }
+    drain(slot);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --busy_;
+    }
+    done_.notify_one();
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
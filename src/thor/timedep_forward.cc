@@ -91,7 +91,7 @@ bool TimeDepForward::ExpandForward(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       if (trans->up()) {
         hierarchy_limits_[node.level()].up_transition_count++;
@@ -215,7 +215,8 @@ inline bool TimeDepForward::ExpandForwardInner(GraphReader& graphreader,
     if (t2 == nullptr) {
       return false;
     }
-    sortcost += astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+    sortcost +=
+        astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), meta.edge->endnode(), dist);
   }
 
   // Add to the adjacency list and edge labels.
@@ -241,6 +242,10 @@ TimeDepForward::GetBestPath(valhalla::Location& origin,
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   travel_type_ = costing_->travel_type();
 
+  // Edges are costed again as their predecessors change, keep the speeds decoded for them
+  speed_memo_.clear();
+  baldr::PredictedSpeedMemo::scope_t speed_memo_scope(&speed_memo_);
+
   // date_time must be set on the origin. Log an error but allow routes for now.
   if (!origin.has_date_time()) {
     LOG_ERROR("TimeDepForward called without time set on the origin location");
@@ -257,6 +262,13 @@ TimeDepForward::GetBestPath(valhalla::Location& origin,
   Init(origin_new, destination_new);
   float mindist = astarheuristic_.GetDistance(origin_new);
 
+  // Bound the heuristic with the landmarks of the access mode if there are any
+  if (const auto* landmarks = GetLandmarks(costing_->access_mode())) {
+    astarheuristic_.SetLandmarks(landmarks,
+                                 GetLandmarkTargets(*landmarks, graphreader, destination, false),
+                                 false);
+  }
+
   // Set seconds from beginning of the week
   seconds_of_week_ = DateTime::day_of_week(origin.date_time()) * midgard::kSecondsPerDay +
                      DateTime::seconds_from_midnight(origin.date_time());
@@ -19,7 +19,8 @@ constexpr uint64_t kInitialEdgeLabelCount = 500000;
 constexpr uint32_t kMaxIterationsWithoutConvergence = 800000;
 
 // Default constructor
-TimeDepReverse::TimeDepReverse() : AStarPathAlgorithm() {
+TimeDepReverse::TimeDepReverse()
+    : AStarPathAlgorithm(), edgelabel_arena_rev_(kInitialEdgeLabelCount) {
   mode_ = TravelMode::kDrive;
   travel_type_ = 0;
   adjacencylist_ = nullptr;
@@ -36,7 +37,7 @@ TimeDepReverse::~TimeDepReverse() {
 
 void TimeDepReverse::Clear() {
   AStarPathAlgorithm::Clear();
-  edgelabels_rev_.clear();
+  edgelabel_arena_rev_.recycle(edgelabels_rev_);
 }
 
 // Initialize prior to finding best path
@@ -49,18 +50,19 @@ void TimeDepReverse::Init(const midgard::PointLL& origll, const midgard::PointLL
   float mincost = astarheuristic_.Get(destll);
 
   // Reserve size for edge labels - do this here rather than in constructor so
-  // to limit how much extra memory is used for persistent objects.
+  // to limit how much extra memory is used for persistent objects. The
+  // reservation follows the label counts of recent searches.
   // TODO - reserve based on estimate based on distance and route type.
-  edgelabels_rev_.reserve(kInitialEdgeLabelCount);
+  edgelabel_arena_rev_.reserve(edgelabels_rev_);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return edgelabels_rev_[label].sortcost(); };
 
-  // Construct adjacency list, clear edge status.
+  // Construct (or reuse) the adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue(mincost, range, bucketsize, edgecost));
+  reuse_label_queue(adjacencylist_, queue_type_, mincost, range, bucketsize, edgecost);
   edgestatus_.clear();
 
   // Get hierarchy limits from the costing. Get a copy since we increment
@@ -128,7 +130,7 @@ bool TimeDepReverse::ExpandReverse(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       if (trans->up()) {
         hierarchy_limits_[node.level()].up_transition_count++;
@@ -272,7 +274,8 @@ inline bool TimeDepReverse::ExpandReverseInner(GraphReader& graphreader,
     if (t2 == nullptr) {
       return false;
     }
-    sortcost += astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+    sortcost +=
+        astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), meta.edge->endnode(), dist);
   }
 
   // Add edge label, add to the adjacency list and set edge status
@@ -301,6 +304,10 @@ TimeDepReverse::GetBestPath(valhalla::Location& origin,
   travel_type_ = costing_->travel_type();
   access_mode_ = costing_->access_mode();
 
+  // Edges are costed again as their predecessors change, keep the speeds decoded for them
+  speed_memo_.clear();
+  baldr::PredictedSpeedMemo::scope_t speed_memo_scope(&speed_memo_);
+
   // date_time must be set on the destination. Log an error but allow routes for now.
   if (!destination.has_date_time()) {
     LOG_ERROR("TimeDepReverse called without time set on the destination location");
@@ -317,6 +324,13 @@ TimeDepReverse::GetBestPath(valhalla::Location& origin,
   Init(origin_new, destination_new);
   float mindist = astarheuristic_.GetDistance(origin_new);
 
+  // Bound the heuristic with the landmarks of the access mode if there are any
+  if (const auto* landmarks = GetLandmarks(costing_->access_mode())) {
+    astarheuristic_.SetLandmarks(landmarks,
+                                 GetLandmarkTargets(*landmarks, graphreader, origin, true),
+                                 true);
+  }
+
   // Set seconds from beginning of the week
   seconds_of_week_ = DateTime::day_of_week(destination.date_time()) * midgard::kSecondsPerDay +
                      DateTime::seconds_from_midnight(destination.date_time());
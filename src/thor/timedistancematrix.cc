@@ -28,7 +28,9 @@ namespace thor {
 
 // Constructor with cost threshold.
 TimeDistanceMatrix::TimeDistanceMatrix()
-    : mode_(TravelMode::kDrive), settled_count_(0), current_cost_threshold_(0) {
+    : queue_type_(LabelQueueType::kDoubleBucket), thread_pool_(nullptr), interrupt_(nullptr),
+      max_time_(0), settled_count_(0), current_cost_threshold_(0), mode_(TravelMode::kDrive),
+      has_date_time_(false), start_seconds_of_week_(0), start_time_(0) {
 }
 
 float TimeDistanceMatrix::GetCostThreshold(const float max_matrix_distance) const {
@@ -56,8 +58,10 @@ void TimeDistanceMatrix::Clear() {
   destinations_.clear();
   dest_edges_.clear();
 
-  // Clear elements from the adjacency list
-  adjacencylist_.reset();
+  // Clear elements from the adjacency list, it is reused by the next search
+  if (adjacencylist_) {
+    adjacencylist_->clear();
+  }
 
   // Clear the edge status flags
   edgestatus_.clear();
@@ -80,10 +84,15 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
     return;
   }
 
+  // The local time the node is reached at, restrictions only apply at times when departing at one
+  const uint64_t localtime =
+      has_date_time_ ? start_time_ + static_cast<uint64_t>(pred.cost().secs) : 0;
+  const uint32_t tz_index = has_date_time_ ? nodeinfo->timezone() : 0;
+
   // Expand from end node.
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
     // Skip shortcut edges
     if (directededge->is_shortcut()) {
@@ -95,13 +104,15 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
     // method), or if a complex restriction prevents this path.
     bool has_time_restrictions = false;
     if (es->set() == EdgeSet::kPermanent ||
-        !costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
-        costing_->Restricted(directededge, pred, edgelabels_, tile, edgeid, true)) {
+        !costing_->Allowed(directededge, pred, tile, edgeid, localtime, tz_index,
+                           has_time_restrictions) ||
+        costing_->Restricted(directededge, pred, edgelabels_, tile, edgeid, true, localtime,
+                             tz_index)) {
       continue;
     }
 
     // Get cost and update distance
-    Cost newcost = pred.cost() + costing_->EdgeCost(directededge, tile) +
+    Cost newcost = pred.cost() + EdgeCost(directededge, tile, pred.cost().secs) +
                    costing_->TransitionCost(directededge, nodeinfo, pred);
     uint32_t distance = pred.path_distance() + directededge->length();
 
@@ -128,7 +139,7 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true);
     }
@@ -156,17 +167,24 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
   uint32_t bucketsize = costing_->UnitSize();
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
-  adjacencylist_.reset(new DoubleBucketQueue(0.0f, current_cost_threshold_, bucketsize, edgecost));
+  reuse_label_queue(adjacencylist_, queue_type_, 0.0f, current_cost_threshold_, bucketsize,
+                    edgecost);
   edgestatus_.clear();
 
   // Initialize the origin and destination locations
   settled_count_ = 0;
+  SetOriginTime(graphreader, origin);
   SetOriginOneToMany(graphreader, origin);
   SetDestinations(graphreader, locations);
 
   // Find shortest path
   const GraphTile* tile;
+  size_t n = 0;
   while (true) {
+    if (interrupt_ && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -197,8 +215,9 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
       }
     }
 
-    // Terminate when we are beyond the cost threshold
-    if (pred.cost().cost > current_cost_threshold_) {
+    // Terminate when we are beyond the cost threshold or the time of the wanted pairs
+    if (pred.cost().cost > current_cost_threshold_ ||
+        (max_time_ > 0 && pred.cost().secs > max_time_)) {
       return FormTimeDistanceMatrix();
     }
 
@@ -208,6 +227,63 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
   return {}; // Should never get here
 }
 
+// Search from one origin until the cost threshold, keeping every edge settled on the way
+DepotReach TimeDistanceMatrix::OneToAll(const valhalla::Location& origin,
+                                        GraphReader& graphreader,
+                                        const std::shared_ptr<DynamicCost>* mode_costing,
+                                        const TravelMode mode,
+                                        const float max_matrix_distance) {
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
+  // The reach is looked up by matrices departing at any time so it is searched without one
+  has_date_time_ = false;
+
+  astarheuristic_.Init({origin.ll().lng(), origin.ll().lat()}, 0.0f);
+  uint32_t bucketsize = costing_->UnitSize();
+  const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
+  reuse_label_queue(adjacencylist_, queue_type_, 0.0f, current_cost_threshold_, bucketsize,
+                    edgecost);
+  edgestatus_.clear();
+  SetOriginOneToMany(graphreader, origin);
+
+  DepotReach reach;
+  size_t n = 0;
+  uint32_t predindex;
+  while ((predindex = adjacencylist_->pop()) != kInvalidLabel) {
+    if (interrupt_ && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+
+    // Origin edges are not marked permanent so the search can come around to them again, they
+    // only reach what is ahead of the origin
+    EdgeLabel pred = edgelabels_[predindex];
+    EdgeReach edge{pred.edgeid(), pred.cost().cost, pred.cost().secs, pred.path_distance()};
+    if (pred.origin()) {
+      for (const auto& origin_edge : origin.path_edges()) {
+        if (origin_edge.graph_id() == pred.edgeid()) {
+          reach.origins.emplace_back(origin_edge.percent_along(), edge);
+        }
+      }
+    } else {
+      edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      reach.edges.push_back(edge);
+    }
+
+    // Terminate when we are beyond the cost threshold
+    if (pred.cost().cost > current_cost_threshold_) {
+      break;
+    }
+    ExpandForward(graphreader, pred.endnode(), pred, predindex, false);
+  }
+  queue_stats_ = adjacencylist_->stats();
+
+  std::sort(reach.edges.begin(), reach.edges.end(),
+            [](const EdgeReach& a, const EdgeReach& b) { return a.edgeid < b.edgeid; });
+  return reach;
+}
+
 // Expand from the node along the reverse search path.
 void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
                                        const GraphId& node,
@@ -226,7 +302,7 @@ void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
   }
 
   // Get the opposing predecessor directed edge
-  const DirectedEdge* opp_pred_edge = tile->directededge(nodeinfo->edge_index());
+  const DirectedEdge* opp_pred_edge = tile->directededge_unchecked(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, opp_pred_edge++) {
     if (opp_pred_edge->localedgeidx() == pred.opp_local_idx()) {
       break;
@@ -236,7 +312,7 @@ void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
   // Expand from end node.
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge_unchecked(nodeinfo->edge_index());
   for (uint32_t i = 0, n = nodeinfo->edge_count(); i < n; i++, directededge++, ++edgeid, ++es) {
     // Skip shortcut edges and edges permanently labeled (best
     // path already found to this directed edge).
@@ -290,7 +366,7 @@ void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
 
   // Handle transitions - expand from the end node each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    const NodeTransition* trans = tile->transition_unchecked(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, true);
     }
@@ -310,6 +386,8 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
+  // Searching backwards the time a location departs at is not known
+  has_date_time_ = false;
 
   // Construct adjacency list, edge status, and done set. Set bucket size and
   // cost range based on DynamicCost. Initialize A* heuristic with 0 cost
@@ -317,7 +395,8 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
   astarheuristic_.Init({dest.ll().lng(), dest.ll().lat()}, 0.0f);
   uint32_t bucketsize = costing_->UnitSize();
   const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
-  adjacencylist_.reset(new DoubleBucketQueue(0.0f, current_cost_threshold_, bucketsize, edgecost));
+  reuse_label_queue(adjacencylist_, queue_type_, 0.0f, current_cost_threshold_, bucketsize,
+                    edgecost);
   edgestatus_.clear();
 
   // Initialize the origin and destination locations
@@ -327,7 +406,12 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
 
   // Find shortest path
   const GraphTile* tile;
+  size_t n = 0;
   while (true) {
+    if (interrupt_ && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -358,8 +442,9 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
       }
     }
 
-    // Terminate when we are beyond the cost threshold
-    if (pred.cost().cost > current_cost_threshold_) {
+    // Terminate when we are beyond the cost threshold or the time of the wanted pairs
+    if (pred.cost().cost > current_cost_threshold_ ||
+        (max_time_ > 0 && pred.cost().secs > max_time_)) {
       return FormTimeDistanceMatrix();
     }
 
@@ -387,22 +472,51 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
     const std::shared_ptr<sif::DynamicCost>* mode_costing,
     const sif::TravelMode mode,
     const float max_matrix_distance) {
-  // Run a series of one to many calls and concatenate the results.
-  std::vector<TimeDistance> many_to_many;
-  if (source_location_list.size() <= target_location_list.size()) {
-    for (const auto& origin : source_location_list) {
-      std::vector<TimeDistance> td = OneToMany(origin, target_location_list, graphreader,
-                                               mode_costing, mode, max_matrix_distance);
-      many_to_many.insert(many_to_many.end(), td.begin(), td.end());
-      Clear();
-    }
-  } else {
-    for (const auto& destination : target_location_list) {
-      std::vector<TimeDistance> td = ManyToOne(destination, source_location_list, graphreader,
-                                               mode_costing, mode, max_matrix_distance);
-      many_to_many.insert(many_to_many.end(), td.begin(), td.end());
-      Clear();
-    }
+  // Run a series of one to many (or many to one) calls and concatenate the results.
+  // Each call writes its own slice of the output so they can run in any order. Sources
+  // that depart at a time need the searches from them.
+  const bool one_to_many =
+      source_location_list.size() <= target_location_list.size() ||
+      std::any_of(source_location_list.begin(), source_location_list.end(),
+                  [](const valhalla::Location& source) { return source.has_date_time(); });
+  const auto& rows = one_to_many ? source_location_list : target_location_list;
+  const auto& columns = one_to_many ? target_location_list : source_location_list;
+  std::vector<TimeDistance> many_to_many(rows.size() * columns.size());
+  const auto row = [&](TimeDistanceMatrix& matrix, const uint32_t i) {
+    std::vector<TimeDistance> td =
+        one_to_many ? matrix.OneToMany(rows.Get(i), columns, graphreader, mode_costing, mode,
+                                       max_matrix_distance)
+                    : matrix.ManyToOne(rows.Get(i), columns, graphreader, mode_costing, mode,
+                                       max_matrix_distance);
+    std::copy(td.begin(), td.end(), many_to_many.begin() + i * columns.size());
+    if (matrix.adjacencylist_) {
+      matrix.queue_stats_ += matrix.adjacencylist_->stats();
+    }
+    matrix.Clear();
+  };
+
+  queue_stats_ = {};
+  if (thread_pool_ == nullptr || rows.size() < 2 || !graphreader.IsThreadSafe()) {
+    for (int i = 0; i < rows.size(); ++i) {
+      row(*this, i);
+    }
+    return many_to_many;
+  }
+
+  // The calling thread uses this matrix, every other thread of the pool its own
+  while (slot_matrices_.size() + 1 < thread_pool_->concurrency()) {
+    slot_matrices_.emplace_back(new TimeDistanceMatrix());
+  }
+  for (auto& matrix : slot_matrices_) {
+    matrix->set_queue_type(queue_type_);
+    matrix->set_max_time(max_time_);
+    matrix->queue_stats_ = {};
+  }
+  thread_pool_->parallel_for(rows.size(), [&](const uint32_t i, const uint32_t slot) {
+    row(slot == 0 ? *this : *slot_matrices_[slot - 1], i);
+  });
+  for (const auto& matrix : slot_matrices_) {
+    queue_stats_ += matrix->queue_stats_;
   }
   return many_to_many;
 }
@@ -443,7 +557,7 @@ void TimeDistanceMatrix::SetOriginOneToMany(GraphReader& graphreader,
 
     // Get cost. Use this as sortcost since A* is not used for time+distance
     // matrix computations. . Get distance along the remainder of this edge.
-    Cost cost = costing_->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    Cost cost = EdgeCost(directededge, tile, 0.0f) * (1.0f - edge.percent_along());
     uint32_t d = static_cast<uint32_t>(directededge->length() * (1.0f - edge.percent_along()));
 
     // We need to penalize this location based on its score (distance in meters from input)
@@ -461,6 +575,33 @@ void TimeDistanceMatrix::SetOriginOneToMany(GraphReader& graphreader,
   }
 }
 
+// Depart at the date_time of the origin in the timezone of the node its first edge leads to
+void TimeDistanceMatrix::SetOriginTime(GraphReader& graphreader, const valhalla::Location& origin) {
+  has_date_time_ = false;
+  if (!origin.has_date_time() || origin.path_edges().empty()) {
+    return;
+  }
+  GraphId edgeid(origin.path_edges(0).graph_id());
+  const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+  if (tile == nullptr) {
+    return;
+  }
+  GraphId node = tile->directededge(edgeid)->endnode();
+  const GraphTile* endtile = graphreader.GetGraphTile(node);
+  if (endtile == nullptr || endtile->node(node)->timezone() == 0) {
+    LOG_ERROR("Could not get the timezone at the origin");
+    return;
+  }
+
+  const auto* time_zone = DateTime::get_tz_db().from_index(endtile->node(node)->timezone());
+  std::string date_time =
+      origin.date_time() == "current" ? DateTime::iso_date_time(time_zone) : origin.date_time();
+  start_time_ = DateTime::seconds_since_epoch(date_time, time_zone);
+  start_seconds_of_week_ = DateTime::day_of_week(date_time) * midgard::kSecondsPerDay +
+                           DateTime::seconds_from_midnight(date_time);
+  has_date_time_ = true;
+}
+
 // Add origin for a many to one time distance matrix.
 void TimeDistanceMatrix::SetOriginManyToOne(GraphReader& graphreader,
                                             const valhalla::Location& dest) {
@@ -649,7 +790,9 @@ bool TimeDistanceMatrix::UpdateDestinations(
     // Get the cost. The predecessor cost is cost to the end of the edge.
     // Subtract the partial remaining cost and distance along the edge.
     float remainder = dest_edge->second;
-    Cost newcost = pred.cost() - (costing_->EdgeCost(edge, tile) * remainder);
+    float entered =
+        pred.predecessor() == kInvalidLabel ? 0.0f : edgelabels_[pred.predecessor()].cost().secs;
+    Cost newcost = pred.cost() - (EdgeCost(edge, tile, entered) * remainder);
     if (newcost.cost < dest.best_cost.cost) {
       dest.best_cost = newcost;
       dest.distance = pred.path_distance() - (edge->length() * remainder);
@@ -703,7 +846,11 @@ bool TimeDistanceMatrix::UpdateDestinations(
 std::vector<TimeDistance> TimeDistanceMatrix::FormTimeDistanceMatrix() {
   std::vector<TimeDistance> td;
   for (auto& dest : destinations_) {
-    td.emplace_back(dest.best_cost.secs, dest.distance);
+    if (max_time_ > 0 && dest.best_cost.secs > max_time_) {
+      td.emplace_back(kMaxCost, kMaxCost);
+    } else {
+      td.emplace_back(dest.best_cost.secs, dest.distance);
+    }
   }
   return td;
 }
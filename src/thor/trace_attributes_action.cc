@@ -1,10 +1,13 @@
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "baldr/datetime.h"
 #include "baldr/directededge.h"
+#include "baldr/edgeinfo.h"
 #include "baldr/graphconstants.h"
 #include "baldr/json.h"
 #include "midgard/constants.h"
@@ -106,8 +109,133 @@ std::string thor_worker_t::trace_attributes(Api& request) {
       break;
   }
 
+  log_statistics(request);
   return tyr::serializeTraceAttributes(request, controller, map_match_results);
 }
 
+/*
+ * Fill the columns of the requested edge attributes straight from the tiles, for the columnar
+ * trace_attributes which has no use for the rest of a TripLeg. The values are the ones the
+ * TripLegBuilder would have given the edges, lengths and speeds are scaled from kilometers to the
+ * requested units.
+ */
+void thor_worker_t::path_columns(const std::vector<PathInfo>::const_iterator path_begin,
+                                 const std::vector<PathInfo>::const_iterator path_end,
+                                 const float start_pct,
+                                 const float end_pct,
+                                 const valhalla::Location& origin,
+                                 const double distance_scale,
+                                 TraceAttributes& columns) {
+  (*interrupt)();
+
+  // Look up which columns are wanted once rather than for every edge
+  const bool want_id = controller.attributes.at(kEdgeId);
+  const bool want_way_id = controller.attributes.at(kEdgeWayId);
+  const bool want_length = controller.attributes.at(kEdgeLength);
+  const bool want_speed = controller.attributes.at(kEdgeSpeed);
+  const bool want_road_class = controller.attributes.at(kEdgeRoadClass);
+  const bool want_use = controller.attributes.at(kEdgeUse);
+  const bool want_surface = controller.attributes.at(kEdgeSurface);
+  const bool want_speed_limit = controller.attributes.at(kEdgeSpeedLimit);
+  const bool want_lane_count = controller.attributes.at(kEdgeLaneCount);
+  const bool want_density = controller.attributes.at(kEdgeDensity);
+  const bool want_toll = controller.attributes.at(kEdgeToll);
+  const bool want_tunnel = controller.attributes.at(kEdgeTunnel);
+  const bool want_bridge = controller.attributes.at(kEdgeBridge);
+  const bool want_roundabout = controller.attributes.at(kEdgeRoundabout);
+
+  const GraphTile* tile = nullptr;
+  const GraphTile* node_tile = nullptr;
+  uint64_t origin_epoch = 0;
+  double elapsed_time = 0;
+  GraphId start_node;
+  for (auto edge_itr = path_begin; edge_itr != path_end; ++edge_itr) {
+    const auto* edge = reader->directededge(edge_itr->edgeid, tile);
+    if (edge == nullptr) {
+      throw valhalla_exception_t{442};
+    }
+
+    // Only the edges at the ends of the path are partial
+    const bool is_first_edge = edge_itr == path_begin;
+    const bool is_last_edge = edge_itr == path_end - 1;
+    float length_pct = 1.f;
+    if (is_first_edge && is_last_edge) {
+      length_pct = std::abs(end_pct - start_pct);
+    } else if (is_first_edge) {
+      length_pct = 1.f - start_pct;
+    } else if (is_last_edge) {
+      length_pct = end_pct;
+    }
+
+    if (want_id) {
+      columns.add_ids(edge_itr->edgeid.value);
+    }
+    if (want_length) {
+      columns.add_lengths(std::max(edge->length() * kKmPerMeter * length_pct, 0.001f) *
+                          distance_scale);
+    }
+    if (want_speed) {
+      // the speed at the time the edge is entered when the trace has one, like the TripLegBuilder.
+      // The first edge takes the time zone of its end node, which is nearly always the same
+      uint32_t second_of_week = kInvalidSecondsOfWeek;
+      if (origin.has_date_time()) {
+        const auto* node =
+            reader->nodeinfo(is_first_edge ? edge->endnode() : start_node, node_tile);
+        if (node != nullptr) {
+          const auto* tz = DateTime::get_tz_db().from_index(node->timezone());
+          if (origin_epoch == 0) {
+            origin_epoch = DateTime::seconds_since_epoch(origin.date_time(), tz);
+          }
+          second_of_week =
+              DateTime::second_of_week(origin_epoch + static_cast<uint32_t>(elapsed_time), tz);
+        }
+      }
+      const auto& costing = mode_costing[static_cast<uint32_t>(edge_itr->mode)];
+      columns.add_speeds(static_cast<uint32_t>(std::round(
+          edge->length() / costing->EdgeCost(edge, tile, second_of_week).secs * 3.6 *
+          distance_scale)));
+    }
+    if (want_road_class) {
+      columns.add_road_classes(static_cast<uint32_t>(edge->classification()));
+    }
+    if (want_use) {
+      columns.add_uses(static_cast<uint32_t>(edge->use()));
+    }
+    if (want_surface) {
+      columns.add_surfaces(static_cast<uint32_t>(edge->surface()));
+    }
+    if (want_way_id || want_speed_limit) {
+      auto edgeinfo = tile->edgeinfo(edge->edgeinfo_offset());
+      if (want_way_id) {
+        columns.add_way_ids(edgeinfo.wayid());
+      }
+      if (want_speed_limit) {
+        columns.add_speed_limits(
+            static_cast<uint32_t>(std::round(edgeinfo.speed_limit() * distance_scale)));
+      }
+    }
+    if (want_lane_count) {
+      columns.add_lane_counts(edge->lanecount());
+    }
+    if (want_density) {
+      columns.add_densities(edge->density());
+    }
+    if (want_toll) {
+      columns.add_tolls(edge->toll());
+    }
+    if (want_tunnel) {
+      columns.add_tunnels(edge->tunnel());
+    }
+    if (want_bridge) {
+      columns.add_bridges(edge->bridge());
+    }
+    if (want_roundabout) {
+      columns.add_roundabouts(edge->roundabout());
+    }
+    elapsed_time = edge_itr->elapsed_time;
+    start_node = edge->endnode();
+  }
+}
+
 } // namespace thor
 } // namespace valhalla
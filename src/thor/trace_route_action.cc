@@ -54,6 +54,21 @@ void add_path_edge(valhalla::Location* l, const meili::MatchResult& m) {
   // edge->set_minimum_reachability();
 }
 
+// How far along the edge a correlated location is, if the edge is one of its candidates
+float percent_along(const valhalla::Location& location, const GraphId& edge_id, float otherwise) {
+  for (const auto& e : location.path_edges()) {
+    if (e.graph_id() == edge_id) {
+      return e.percent_along();
+    }
+  }
+  return otherwise;
+}
+
+// Kilometers to the units of the request
+double distance_scale(const valhalla::Options& options) {
+  return options.units() == valhalla::Options::miles ? midgard::kMilePerKm : 1.0;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -107,6 +122,7 @@ void thor_worker_t::trace_route(Api& request) {
       }
       break;
   }
+  log_statistics(request);
 
   // log admin areas
   if (!options.do_not_track()) {
@@ -141,6 +157,16 @@ void thor_worker_t::route_match(Api& request) {
     if (options.shape(0).has_date_time())
       options.mutable_locations(0)->set_date_time(options.shape(0).date_time());
 
+    // Only fill the columns of a columnar trace_attributes, there is no trip path to build
+    if (options.columnar()) {
+      const auto& origin = options.locations(0);
+      const auto& destination = *options.locations().rbegin();
+      path_columns(path.cbegin(), path.cend(), percent_along(origin, path.front().edgeid, 0.f),
+                   percent_along(destination, path.back().edgeid, 1.f), origin,
+                   distance_scale(options), *request.add_trace_attributes());
+      return;
+    }
+
     // Form the trip path based on mode costing, origin, destination, and path edges
     auto& leg = *request.mutable_trip()->mutable_routes()->Add()->mutable_legs()->Add();
     thor::TripLegBuilder::Build(controller, *reader, mode_costing, path.begin(), path.end(),
@@ -169,7 +195,12 @@ thor_worker_t::map_match(Api& request) {
   // we don't allow multi path for trace route at the moment, discontinuities force multi route
   int topk =
       request.options().action() == Options::trace_attributes ? request.options().best_paths() : 1;
+  auto start = start_search();
   auto topk_match_results = matcher->OfflineMatch(trace, topk);
+  if (record_statistics(options)) {
+    end_search(request.add_statistics(), "map_matching",
+               matcher->transition_cost_model().queue_stats(), start);
+  }
 
   // Process each score/match result
   std::vector<std::tuple<float, float, std::vector<thor::MatchResult>>> map_match_results;
@@ -203,9 +234,8 @@ thor_worker_t::map_match(Api& request) {
         auto* pe = options.mutable_shape(i)->mutable_path_edges()->Add();
         pe->mutable_ll()->set_lat(match.lnglat.lat());
         pe->mutable_ll()->set_lng(match.lnglat.lng());
-        for (const auto& n : reader->edgeinfo(match.edgeid).GetNames()) {
-          pe->mutable_names()->Add()->assign(n);
-        }
+        reader->edgeinfo(match.edgeid).ForEachName(
+            [pe](const char* name, bool) { pe->mutable_names()->Add()->assign(name); });
 
         // signal how many edge candidates there were at this stateid by adding empty path edges
         if (!match.HasState()) {
@@ -222,7 +252,7 @@ thor_worker_t::map_match(Api& request) {
     std::vector<thor::MatchResult> enhanced_match_results;
     std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>>
         route_discontinuities;
-    if (options.action() == Options::trace_attributes &&
+    if (options.action() == Options::trace_attributes && !options.columnar() &&
         controller.category_attribute_enabled(kMatchedCategory)) {
       // Populate for matched points so we have 1:1 with trace points
       for (const auto& match_result : match_results) {
@@ -394,8 +424,37 @@ thor_worker_t::map_match(Api& request) {
 #endif
     }
 
-    // trace_attributes always returns a single trip path and may have discontinuities
-    if (options.action() == Options::trace_attributes) {
+    // a columnar trace_attributes only needs the columns of the edges, where the path starts and
+    // ends on them comes from the candidates of the first and last matched points
+    if (options.action() == Options::trace_attributes && options.columnar()) {
+      auto has_state = [](const meili::MatchResult& result) {
+        return result.HasState() && result.edgeid.Is_Valid();
+      };
+      auto first_result_with_state =
+          std::find_if(match_results.begin(), match_results.end(), has_state);
+      auto last_result_with_state =
+          std::find_if(match_results.rbegin(), match_results.rend(), has_state);
+      if (first_result_with_state == match_results.end()) {
+        throw valhalla_exception_t{442};
+      }
+      auto candidate_percent = [this](const meili::MatchResult& result, const GraphId& edge_id,
+                                      float otherwise) {
+        for (const auto& e : matcher->state_container().state(result.stateid).candidate().edges) {
+          if (e.id == edge_id) {
+            return e.percent_along;
+          }
+        }
+        return otherwise;
+      };
+      auto& columns = *request.add_trace_attributes();
+      if (!path_edges.empty()) {
+        path_columns(path_edges.cbegin(), path_edges.cend(),
+                     candidate_percent(*first_result_with_state, path_edges.front().edgeid, 0.f),
+                     candidate_percent(*last_result_with_state, path_edges.back().edgeid, 1.f),
+                     valhalla::Location{}, distance_scale(options), columns);
+      }
+    } // trace_attributes always returns a single trip path and may have discontinuities
+    else if (options.action() == Options::trace_attributes) {
       // we make a new route to hold the result of each iteration of top k
       auto& route = *request.mutable_trip()->mutable_routes()->Add();
       path_map_match(match_results, path_edges, *route.mutable_legs()->Add(), route_discontinuities);
@@ -2,6 +2,7 @@
 #include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -12,6 +13,7 @@
 #include "baldr/graphconstants.h"
 #include "baldr/signinfo.h"
 #include "baldr/tilehierarchy.h"
+#include "midgard/aabb2.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -30,6 +32,36 @@ using namespace valhalla::thor;
 
 namespace {
 
+// Groups of attributes that each need their own lookups in the tiles
+constexpr uint32_t kEdgeSignGroup = 1;
+constexpr uint32_t kJunctionNameGroup = 2;
+constexpr uint32_t kIntersectingEdgeGroup = 4;
+
+/**
+ * Finds which groups of attributes have any of their attributes enabled. This is done once per
+ * leg so that the lookups in the tiles that only feed those attributes can be skipped for every
+ * edge of the leg when none of them is wanted.
+ * @param  controller  Controller to determine which attributes to set.
+ * @return Returns the groups as a mask.
+ */
+uint32_t GetEnabledAttributeGroups(const AttributesController& controller) {
+  uint32_t groups = 0;
+  for (const auto* key : {&kEdgeSignExitNumber, &kEdgeSignExitBranch, &kEdgeSignExitToward,
+                          &kEdgeSignExitName, &kEdgeSignGuideBranch, &kEdgeSignGuideToward}) {
+    if (controller.attributes.at(*key)) {
+      groups |= kEdgeSignGroup;
+      break;
+    }
+  }
+  if (controller.attributes.at(kEdgeSignJunctionName)) {
+    groups |= kJunctionNameGroup;
+  }
+  if (controller.category_attribute_enabled(kNodeIntersectingEdgeCategory)) {
+    groups |= kIntersectingEdgeGroup;
+  }
+  return groups;
+}
+
 void TrimShape(std::vector<PointLL>& shape,
                const float start,
                const PointLL& start_vertex,
@@ -143,6 +175,24 @@ void SetShapeAttributes(const AttributesController& controller,
         costing->EdgeCost(edge, tile, second_of_week).secs * edge_percentage; // seconds
     // TODO: get the measured length from shape (full shape) to increase precision
     double edge_length = edge->length() * edge_percentage; // meters
+    // Look up which attributes are wanted once rather than for every point
+    bool want_time = controller.attributes.at(kShapeAttributesTime);
+    bool want_length = controller.attributes.at(kShapeAttributesLength);
+    bool want_speed = controller.attributes.at(kShapeAttributesSpeed);
+    auto* shape_attributes = trip_path.mutable_shape_attributes();
+    auto count = static_cast<int>(std::distance(shape_begin, shape_end)) - 1;
+    if (count > 0) {
+      if (want_time) {
+        shape_attributes->mutable_time()->Reserve(shape_attributes->time_size() + count);
+      }
+      if (want_length) {
+        shape_attributes->mutable_length()->Reserve(shape_attributes->length_size() + count);
+      }
+      if (want_speed) {
+        shape_attributes->mutable_speed()->Reserve(shape_attributes->speed_size() + count);
+      }
+    }
+
     // Set the shape attributes
     for (++shape_begin; shape_begin < shape_end; ++shape_begin) {
       double distance = shape_begin->Distance(*(shape_begin - 1)); // meters
@@ -150,29 +200,28 @@ void SetShapeAttributes(const AttributesController& controller,
       double time = edge_time * distance_pct;                      // seconds
 
       // Set shape attributes time per shape point if requested
-      if (controller.attributes.at(kShapeAttributesTime)) {
+      if (want_time) {
         // convert time to milliseconds and then round to an integer
-        trip_path.mutable_shape_attributes()->add_time((time * kMillisecondPerSec) + 0.5);
+        shape_attributes->add_time((time * kMillisecondPerSec) + 0.5);
       }
 
       // Set shape attributes length per shape point if requested
-      if (controller.attributes.at(kShapeAttributesLength)) {
+      if (want_length) {
         // convert length to decimeters and then round to an integer
-        trip_path.mutable_shape_attributes()->add_length((distance * kDecimeterPerMeter) + 0.5);
+        shape_attributes->add_length((distance * kDecimeterPerMeter) + 0.5);
       }
 
       // Set shape attributes speed per shape point if requested
-      if (controller.attributes.at(kShapeAttributesSpeed)) {
+      if (want_speed) {
         // convert speed to decimeters per sec and then round to an integer
-        trip_path.mutable_shape_attributes()->add_speed((distance * kDecimeterPerMeter / time) + 0.5);
+        shape_attributes->add_speed((distance * kDecimeterPerMeter / time) + 0.5);
       }
     }
   }
 }
 
 // Set the bounding box (min,max lat,lon) for the shape
-void SetBoundingBox(TripLeg& trip_path, std::vector<PointLL>& shape) {
-  AABB2<PointLL> bbox(shape);
+void SetBoundingBox(TripLeg& trip_path, const AABB2<PointLL>& bbox) {
   LatLng* min_ll = trip_path.mutable_bbox()->mutable_min_ll();
   min_ll->set_lat(bbox.miny());
   min_ll->set_lng(bbox.minx());
@@ -521,6 +570,7 @@ void AddTransitNodes(TripLeg_Node* trip_node,
 /**
  * Add trip edge. (TODO more comments)
  * @param  controller         Controller to determine which attributes to set.
+ * @param  attribute_groups   The groups of attributes that have any attribute enabled.
  * @param  edge               Identifier of an edge within the tiled, hierarchical graph.
  * @param  trip_id            Trip Id (0 if not a transit edge).
  * @param  block_id           Transit block Id (0 if not a transit edge)
@@ -539,6 +589,7 @@ void AddTransitNodes(TripLeg_Node* trip_node,
  *
  */
 TripLeg_Edge* AddTripEdge(const AttributesController& controller,
+                          const uint32_t attribute_groups,
                           const GraphId& edge,
                           const uint32_t trip_id,
                           const uint32_t block_id,
@@ -566,12 +617,12 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 
   // Add names to edge if requested
   if (controller.attributes.at(kEdgeNames)) {
-    auto names_and_types = edgeinfo.GetNamesAndTypes();
-    for (const auto& name_and_type : names_and_types) {
+    // Straight from the tile into the leg
+    edgeinfo.ForEachName([trip_edge](const char* name, bool is_route_number) {
       auto* trip_edge_name = trip_edge->mutable_name()->Add();
-      trip_edge_name->set_value(name_and_type.first);
-      trip_edge_name->set_is_route_number(name_and_type.second);
-    }
+      trip_edge_name->set_value(name);
+      trip_edge_name->set_is_route_number(is_route_number);
+    });
   }
 
 #ifdef LOGGING_LEVEL_TRACE
@@ -579,7 +630,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 #endif
 
   // Set the exits (if the directed edge has exit sign information) and if requested
-  if (directededge->sign()) {
+  if (directededge->sign() && (attribute_groups & kEdgeSignGroup)) {
     // Add the edge signs
     std::vector<SignInfo> edge_signs = graphtile->GetSigns(idx);
     if (!edge_signs.empty()) {
@@ -642,7 +693,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Process the named junctions
-  if (has_junction_name && start_tile) {
+  if (has_junction_name && start_tile && (attribute_groups & kJunctionNameGroup)) {
     // Add the node signs
     std::vector<SignInfo> node_signs = start_tile->GetSigns(start_node_idx, true);
     if (!node_signs.empty()) {
@@ -862,12 +913,23 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
+  // Set the elevation profile along the edge if the tiles have one
+  if (controller.attributes.at(kEdgeElevation) && graphtile->header()->has_elevation()) {
+    auto profile = edgeinfo.elevation_profile();
+    if (!directededge->forward()) {
+      std::reverse(profile.begin(), profile.end());
+    }
+    for (auto elevation : profile) {
+      trip_edge->add_elevation(elevation);
+    }
+  }
+
   if (controller.attributes.at(kEdgeLaneCount)) {
     trip_edge->set_lane_count(directededge->lanecount());
   }
 
   if (directededge->laneconnectivity() && controller.attributes.at(kEdgeLaneConnectivity)) {
-    for (const auto& l : graphtile->GetLaneConnectivity(idx)) {
+    for (const auto& l : graphtile->GetLaneConnectivityRange(idx)) {
       TripLeg_LaneConnectivity* path_lane = trip_edge->add_lane_connectivity();
       path_lane->set_from_way_id(l.from());
       path_lane->set_to_lanes(l.to_lanes());
@@ -1190,6 +1252,9 @@ void TripLegBuilder::Build(
     tp_dest->set_side_of_street(GetTripLegSideOfStreet(end_sos));
   }
 
+  // Which of the lookups in the tiles the enabled attributes need
+  const uint32_t attribute_groups = GetEnabledAttributeGroups(controller);
+
   // Structures to process admins
   std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher> admin_info_map;
   std::vector<AdminInfo> admin_info_list;
@@ -1206,7 +1271,8 @@ void TripLegBuilder::Build(
 
     // Get the shape. Reverse if the directed edge direction does
     // not match the traversal direction (based on start and end percent).
-    auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
+    auto points = tile->edgeinfo(edge->edgeinfo_offset()).lazy_shape();
+    std::vector<PointLL> shape(points.begin(), points.end());
     if (edge->forward() != (start_pct < end_pct)) {
       std::reverse(shape.begin(), shape.end());
     }
@@ -1236,8 +1302,8 @@ void TripLegBuilder::Build(
 
     // Add trip edge
     auto trip_edge =
-        AddTripEdge(controller, path_begin->edgeid, path_begin->trip_id, 0, path_begin->mode,
-                    travel_types[static_cast<int>(path_begin->mode)],
+        AddTripEdge(controller, attribute_groups, path_begin->edgeid, path_begin->trip_id, 0,
+                    path_begin->mode, travel_types[static_cast<int>(path_begin->mode)],
                     mode_costing[static_cast<uint32_t>(path_begin->mode)], edge, drive_on_right,
                     trip_path.add_node(), tile, origin_second_of_week, std::abs(end_pct - start_pct),
                     startnode.id(), false, nullptr, path_begin->has_time_restrictions);
@@ -1279,11 +1345,13 @@ void TripLegBuilder::Build(
     }
 
     // Set the bounding box of the shape
-    SetBoundingBox(trip_path, shape);
+    SetBoundingBox(trip_path, AABB2<PointLL>(shape));
 
     // Set shape if requested
     if (controller.attributes.at(kShape)) {
-      trip_path.set_shape(encode<std::vector<PointLL>>(shape));
+      auto* encoded = trip_path.mutable_shape();
+      encoded->reserve(shape.size() * 8);
+      encode(shape.begin(), shape.end(), std::back_inserter(*encoded));
     }
 
     if (controller.attributes.at(kOsmChangeset)) {
@@ -1303,6 +1371,8 @@ void TripLegBuilder::Build(
   uint32_t block_id = 0;
   uint32_t prior_opp_local_index = -1;
   std::vector<PointLL> trip_shape;
+  std::vector<PointLL> edge_shape;
+  AABB2<PointLL> bbox;
   std::string arrival_time;
   bool assumed_schedule = false;
   uint64_t osmchangeset = 0;
@@ -1561,21 +1631,22 @@ void TripLegBuilder::Build(
     auto is_last_edge = edge_itr == (path_end - 1);
     float length_pct = (is_first_edge ? 1.f - start_pct : (is_last_edge ? end_pct : 1.f));
     TripLeg_Edge* trip_edge =
-        AddTripEdge(controller, edge, trip_id, block_id, mode, travel_type, costing, directededge,
-                    node->drive_on_right(), trip_node, graphtile, second_of_week, length_pct,
-                    startnode.id(), node->named_intersection(), start_tile,
-                    edge_itr->has_time_restrictions);
+        AddTripEdge(controller, attribute_groups, edge, trip_id, block_id, mode, travel_type,
+                    costing, directededge, node->drive_on_right(), trip_node, graphtile,
+                    second_of_week, length_pct, startnode.id(), node->named_intersection(),
+                    start_tile, edge_itr->has_time_restrictions);
 
     // Get the shape and set shape indexes (directed edge forward flag
     // determines whether shape is traversed forward or reverse).
     auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
+    auto points = edgeinfo.lazy_shape();
     uint32_t begin_index = (is_first_edge) ? 0 : trip_shape.size() - 1;
 
     // Process the shape for edges where a route discontinuity occurs
     if (route_discontinuities && !route_discontinuities->empty() &&
         route_discontinuities->count(edge_index) > 0) {
       // Get edge shape and reverse it if directed edge is not forward.
-      auto edge_shape = edgeinfo.shape();
+      edge_shape.assign(points.begin(), points.end());
       if (!directededge->forward()) {
         std::reverse(edge_shape.begin(), edge_shape.end());
       }
@@ -1624,7 +1695,7 @@ void TripLegBuilder::Build(
     } // We need to clip the shape if its at the beginning or end
     else if (is_first_edge || is_last_edge) {
       // Get edge shape and reverse it if directed edge is not forward.
-      auto edge_shape = edgeinfo.shape();
+      edge_shape.assign(points.begin(), points.end());
       if (!directededge->forward()) {
         std::reverse(edge_shape.begin(), edge_shape.end());
       }
@@ -1641,13 +1712,26 @@ void TripLegBuilder::Build(
       trip_shape.insert(trip_shape.end(), edge_shape.begin() + is_last_edge, edge_shape.end());
     } // Just get the shape in there in the right direction no clipping needed
     else {
+      // Decode straight into the trip shape skipping the point the previous edge ended on,
+      // against the shape direction that is the last point and the rest get flipped around
       if (directededge->forward()) {
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().begin() + 1, edgeinfo.shape().end());
+        trip_shape.insert(trip_shape.end(), ++points.begin(), points.end());
       } else {
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().rbegin() + 1, edgeinfo.shape().rend());
+        trip_shape.insert(trip_shape.end(), points.begin(), points.end());
+        trip_shape.pop_back();
+        std::reverse(trip_shape.begin() + begin_index + 1, trip_shape.end());
       }
     }
 
+    // Grow the bounding box by the points this edge added while they are still in cache instead
+    // of walking the whole shape again at the end
+    if (is_first_edge) {
+      bbox = AABB2<PointLL>(trip_shape.front(), trip_shape.front());
+    }
+    for (auto point = trip_shape.cbegin() + begin_index; point != trip_shape.cend(); ++point) {
+      bbox.Expand(*point);
+    }
+
     // Set begin shape index if requested
     if (controller.attributes.at(kEdgeBeginShapeIndex)) {
       trip_edge->set_begin_shape_index(begin_index);
@@ -1685,7 +1769,7 @@ void TripLegBuilder::Build(
     //          A || \\ G
     //            ||  \\
     //            (1)  (X)
-    if (startnode.Is_Valid()) {
+    if (startnode.Is_Valid() && (attribute_groups & kIntersectingEdgeGroup)) {
       // Iterate through edges on this level to find any intersecting edges
       // Follow any upwards or downward transitions
       const DirectedEdge* de = start_tile->directededge(node->edge_index());
@@ -1733,7 +1817,7 @@ void TripLegBuilder::Build(
     // Set the endnode of this directed edge as the startnode of the next edge.
     startnode = directededge->endnode();
 
-    if (!directededge->IsTransitLine()) {
+    if (!directededge->IsTransitLine() && (attribute_groups & kIntersectingEdgeGroup)) {
       // Save the opposing edge as the previous DirectedEdge (for name consistency)
       const GraphTile* t2 =
           directededge->leaves_tile() ? graphreader.GetGraphTile(directededge->endnode()) : graphtile;
@@ -1767,11 +1851,13 @@ void TripLegBuilder::Build(
   AssignAdmins(controller, trip_path, admin_info_list);
 
   // Set the bounding box of the shape
-  SetBoundingBox(trip_path, trip_shape);
+  SetBoundingBox(trip_path, bbox);
 
   // Set shape if requested
   if (controller.attributes.at(kShape)) {
-    trip_path.set_shape(encode<std::vector<PointLL>>(trip_shape));
+    auto* encoded = trip_path.mutable_shape();
+    encoded->reserve(trip_shape.size() * 8);
+    encode(trip_shape.begin(), trip_shape.end(), std::back_inserter(*encoded));
   }
 
   if (osmchangeset != 0 && controller.attributes.at(kOsmChangeset)) {
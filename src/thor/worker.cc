@@ -1,12 +1,18 @@
+#include <chrono>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "baldr/cellpartition.h"
+#include "baldr/chgraph.h"
 #include "baldr/json.h"
+#include "baldr/landmarks.h"
 #include "midgard/constants.h"
 #include "midgard/logging.h"
 #include <boost/property_tree/ptree.hpp>
@@ -49,6 +55,24 @@ const std::unordered_map<std::string, float> kMaxDistances = {
 constexpr float kDistanceScale = 10.f;
 constexpr double kMilePerMeter = 0.000621371;
 
+// Contraction hierarchies and landmarks are large and read only so all the
+// workers of a process share the ones they load
+template <typename T>
+std::shared_ptr<const T> load_shared(const std::string& file, const std::string& what) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<const T>> loaded;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto data = loaded[file].lock();
+  if (!data) {
+    data = T::load(file);
+    if (!data) {
+      LOG_WARN("Could not load " + what + " " + file);
+    }
+    loaded[file] = data;
+  }
+  return data;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -56,23 +80,57 @@ namespace thor {
 
 thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
-    : mode(valhalla::sif::TravelMode::kPedestrian), matcher_factory(config, graph_reader),
+    : mode(valhalla::sif::TravelMode::kPedestrian),
+      costing_cache(config.get<size_t>("thor.costing_cache_size", 0)),
+      isochrone_cache(config.get<size_t>("thor.isochrone_cache_size", 0),
+                      config.get<uint32_t>("thor.isochrone_cache_max_age", 0)),
+      matcher_factory(config, graph_reader),
       reader(graph_reader), controller{},
-      long_request(config.get<float>("thor.logging.long_request")) {
+      long_request(config.get<float>("thor.logging.long_request")),
+      log_search_statistics(config.get<bool>("thor.logging.statistics", false)), metrics("thor"),
+      admission(config, "thor") {
   // If we weren't provided with a graph reader make our own
   if (!reader)
     reader = matcher_factory.graphreader();
+  tile_extract_version = reader->tile_extract_version();
 
   // Register standard edge/node costing methods
   factory.RegisterStandardCostingModels();
 
+  // Share the costs of edges costed without a time with the other workers of this process
+  edge_cost_cache = sif::EdgeCostCache::Global(config.get<size_t>("thor.edge_cost_cache_size", 0));
+
+  // Hierarchy limits tuned per costing and region replace those of the costings
+  if (auto tuned = config.get_child_optional("thor.hierarchy_limits")) {
+    hierarchy_limits = sif::TunedHierarchyLimits(*tuned);
+  }
+
+  // Share the results of routes and matrices with the other workers of this process
+  result_cache = ResultCache::Global(config.get<size_t>("thor.result_cache_size", 0),
+                                     config.get<uint32_t>("thor.result_cache_max_age", 60));
+
+  // Share what the depots matrices keep starting from reach with the other workers, the depots
+  // are a flat list of latitudes and longitudes
+  std::vector<midgard::PointLL> depots;
+  if (auto coordinates = config.get_child_optional("thor.depots")) {
+    std::vector<double> values;
+    for (const auto& coordinate : *coordinates) {
+      values.push_back(coordinate.second.get_value<double>());
+    }
+    for (size_t i = 0; i + 1 < values.size(); i += 2) {
+      depots.emplace_back(values[i + 1], values[i]);
+    }
+  }
+  depot_oracle = DepotOracle::Global(depots, config.get<size_t>("thor.depot_oracle_size", 0),
+                                     config.get<uint32_t>("thor.depot_oracle_max_age", 0));
+
   // Select the matrix algorithm based on the conf file (defaults to
   // select_optimal if not present)
   auto conf_algorithm = config.get<std::string>("thor.source_to_target_algorithm", "select_optimal");
   for (const auto& kv : config.get_child("service_limits")) {
     if (kv.first == "max_avoid_locations" || kv.first == "max_reachability" ||
         kv.first == "max_radius" || kv.first == "max_timedep_distance" ||
-        kv.first == "max_alternates") {
+        kv.first == "max_alternates" || kv.first == "max_timeout") {
       continue;
     }
     if (kv.first != "skadi" && kv.first != "trace" && kv.first != "isochrone") {
@@ -85,12 +143,117 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "bucket") {
+    source_to_target_algorithm = BUCKET_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
 
+  // Threads expanding a CostMatrix or the rows of a TimeDistanceMatrix, 0 uses all cores
+  auto matrix_threads = config.get<uint32_t>("thor.matrix_threads", 1);
+  if (matrix_threads != 1) {
+    matrix_pool.reset(new ThreadPool(matrix_threads));
+  }
+
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
+  timedep_bidirectional = config.get<bool>("thor.timedep_bidirectional", false);
+
+  // Router of transit and multimodal routes
+  auto conf_transit = config.get<std::string>("thor.transit_algorithm", "multimodal");
+  if (conf_transit != "multimodal" && conf_transit != "raptor") {
+    throw std::runtime_error("Unknown thor.transit_algorithm: " + conf_transit);
+  }
+  transit_raptor = conf_transit == "raptor";
+
+  // Optimizer for the order of the locations of optimized routes
+  auto conf_optimizer = config.get<std::string>("thor.optimizer", "local_search");
+  if (conf_optimizer == "anneal") {
+    optimizer_method = OptimizerMethod::kAnneal;
+  } else if (conf_optimizer == "local_search") {
+    optimizer_method = OptimizerMethod::kLocalSearch;
+  } else {
+    throw std::runtime_error("Unknown thor.optimizer: " + conf_optimizer);
+  }
+  optimizer_restarts = config.get<uint32_t>("thor.optimizer_restarts", kOptimizerRestarts);
+
+  // Select the priority queue of the path algorithms, by default and per costing
+  default_queue_type = baldr::LabelQueueType::kDoubleBucket;
+  auto priority_queue = config.get_child_optional("thor.priority_queue");
+  if (priority_queue) {
+    for (const auto& kv : *priority_queue) {
+      baldr::LabelQueueType type;
+      if (!baldr::parse_label_queue_type(kv.second.get_value<std::string>(), type)) {
+        throw std::runtime_error("Unknown thor.priority_queue." + kv.first + ": " +
+                                 kv.second.get_value<std::string>());
+      }
+      if (kv.first == "default") {
+        default_queue_type = type;
+      } else {
+        queue_types.emplace(kv.first, type);
+      }
+    }
+  }
+
+  // Use the contraction hierarchies built by mjolnir for the routes of their costings if enabled
+  if (config.get<bool>("thor.contraction_hierarchy", false)) {
+    std::vector<std::string> costings{"auto"};
+    if (auto listed = config.get_child_optional("mjolnir.contraction_hierarchy_costings")) {
+      costings.clear();
+      for (const auto& costing : *listed) {
+        costings.push_back(costing.second.get_value<std::string>());
+      }
+    }
+    for (const auto& name : costings) {
+      Costing costing;
+      if (!Costing_Enum_Parse(name, &costing)) {
+        throw std::runtime_error("Unknown contraction hierarchy costing: " + name);
+      }
+      auto file = CHGraph::file_name(config.get<std::string>("mjolnir.tile_dir"), name);
+      if (auto graph = load_shared<CHGraph>(file, "contraction hierarchy")) {
+        ch_graphs.emplace(costing, graph);
+      }
+    }
+  }
+
+  // Customize the cell partition built by mjolnir for the costing options of routes if enabled,
+  // the customizations are shared with the other workers of this process
+  if (config.get<bool>("thor.cell_overlay", false)) {
+    auto file = CellPartition::file_name(config.get<std::string>("mjolnir.tile_dir"));
+    cell_partition = load_shared<CellPartition>(file, "cell partition");
+    cell_overlays = CellOverlayCache::Global(config.get<size_t>("thor.cell_overlay_cache_size", 8));
+  }
+
+  // Bound the A* heuristics of the modes mjolnir built landmarks for if enabled
+  if (config.get<bool>("thor.landmarks", false)) {
+    for (const auto* mode : kLandmarkModes) {
+      auto file = Landmarks::file_name(config.get<std::string>("mjolnir.tile_dir"), mode);
+      if (auto mode_landmarks = load_shared<Landmarks>(file, "landmarks")) {
+        landmarks.push_back(mode_landmarks);
+      }
+    }
+    astar.set_landmarks(landmarks);
+    bidir_astar.set_landmarks(landmarks);
+    timedep_forward.set_landmarks(landmarks);
+    timedep_reverse.set_landmarks(landmarks);
+  }
+}
+
+// Can a contraction hierarchy answer requests made with these options? Each only
+// knows its costing with the options it was built for and no avoids
+bool thor_worker_t::use_contraction_hierarchy(const Options& options) const {
+  auto graph = ch_graphs.find(options.costing());
+  return graph != ch_graphs.end() && options.avoid_locations_size() == 0 &&
+         options.avoid_polygons_size() == 0 &&
+         options.costing_options_size() > static_cast<int>(options.costing()) &&
+         graph->second->costing_options ==
+             options.costing_options(static_cast<int>(options.costing())).SerializeAsString();
+}
+
+// Returns the priority queue the searches for the given costing should use
+baldr::LabelQueueType thor_worker_t::get_queue_type(const std::string& costing) const {
+  auto found = queue_types.find(costing);
+  return found == queue_types.end() ? default_queue_type : found->second;
 }
 
 thor_worker_t::~thor_worker_t() {
@@ -105,26 +268,51 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
   auto s = std::chrono::system_clock::now();
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Thor Request " + std::to_string(info.id));
-  Api request;
+  Api& request = new_request();
   try {
     // crack open the original request
     request.ParseFromArray(job.front().data(), job.front().size());
+    metrics.queue_wait(request);
     const auto& options = request.options();
 
-    // Set the interrupt function
+    // Set the interrupt function and when to give up on the request
     service_worker_t::set_interrupt(interrupt_function);
+    service_worker_t::set_deadline(options.deadline());
+    auto ticket = admission.admit(request, *interrupt);
+
+    // Polling clients repeat their requests, answer them with the result of the first one
+    auto cache_key = result_cache ? ResultCache::Key(options) : std::string();
+    std::string cached;
+    bool hit = !cache_key.empty() && result_cache->Get(cache_key, cached);
+    if (!cache_key.empty()) {
+      metrics.cache(hit);
+    }
 
     prime_server::worker_t::result_t result{true};
     double denominator = 0;
     // do request specific processing
     switch (options.action()) {
-      case Options::sources_to_targets:
-        result = to_response_json(matrix(request), info, request);
+      case Options::sources_to_targets: {
+        if (!hit) {
+          cached = matrix(request);
+          if (!cache_key.empty()) {
+            result_cache->Put(cache_key, cached);
+          }
+        }
+        result = to_response(cached, info, request);
         denominator = options.sources_size() + options.targets_size();
         break;
+      }
       case Options::optimized_route: {
-        optimized_route(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        if (hit) {
+          restore_result(request, cached);
+        } else {
+          optimized_route(request);
+          if (!cache_key.empty()) {
+            result_cache->Put(cache_key, request.SerializeAsString());
+          }
+        }
+        result.messages.emplace_back(forward(request));
         denominator = std::max(options.sources_size(), options.targets_size());
         break;
       }
@@ -133,19 +321,26 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
         denominator = options.sources_size() * options.targets_size();
         break;
       case Options::route: {
-        route(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        if (hit) {
+          restore_result(request, cached);
+        } else {
+          route(request);
+          if (!cache_key.empty()) {
+            result_cache->Put(cache_key, request.SerializeAsString());
+          }
+        }
+        result.messages.emplace_back(forward(request));
         denominator = options.locations_size();
         break;
       }
       case Options::trace_route: {
         trace_route(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(forward(request));
         denominator = trace.size() / 1100;
         break;
       }
       case Options::trace_attributes:
-        result = to_response_json(trace_attributes(request), info, request);
+        result = to_response(trace_attributes(request), info, request);
         denominator = trace.size() / 1100;
         break;
       case Options::expansion: {
@@ -159,6 +354,7 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
 
     double elapsed_time =
         std::chrono::duration<float, std::milli>(std::chrono::system_clock::now() - s).count();
+    metrics.request(request, elapsed_time / 1000);
     if (!options.do_not_track() && elapsed_time / denominator > long_request) {
       LOG_WARN("thor::" + Options_Action_Enum_Name(options.action()) +
                " request elapsed time (ms)::" + std::to_string(elapsed_time));
@@ -190,7 +386,11 @@ void run_service(const boost::property_tree::ptree& config) {
 
   // listen for requests
   zmq::context_t context;
-  thor_worker_t thor_worker(config);
+  auto reader = std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"));
+  // warm up the tile cache with the tiles used most before taking any requests
+  reader->Preload(config.get<size_t>("mjolnir.preload_tiles", 0),
+                  config.get<size_t>("mjolnir.preload_threads", 4));
+  thor_worker_t thor_worker(config, reader);
   prime_server::worker_t worker(context, upstream_endpoint, downstream_endpoint, loopback_endpoint,
                                 interrupt_endpoint,
                                 std::bind(&thor_worker_t::work, std::ref(thor_worker),
@@ -206,7 +406,68 @@ void run_service(const boost::property_tree::ptree& config) {
 // Get the costing options if in the config or get the empty default.
 // Creates the cost in the cost factory
 valhalla::sif::cost_ptr_t thor_worker_t::get_costing(const Costing costing, const Options& options) {
-  return factory.Create(costing, options);
+  auto start = std::chrono::steady_clock::now();
+  auto cost = factory.Create(costing, options);
+  metrics.costing(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  if (edge_cost_cache) {
+    cost->set_edge_cost_cache(edge_cost_cache, sif::EdgeCostCache::Hash(costing, options));
+  }
+  return cost;
+}
+
+// Whether the searches of a request count their work, for the response or the log
+bool thor_worker_t::record_statistics(const Options& options) const {
+  return options.statistics() || log_search_statistics;
+}
+
+thor_worker_t::search_start_t thor_worker_t::start_search() const {
+  return {reader->tiles_fetched(), reader->tiles_missed()};
+}
+
+// Adds the work of a search to the statistics. The tile counts are those of the whole reader so
+// they include the tiles fetched by searches running at the same time on other threads
+void thor_worker_t::end_search(SearchStatistics* statistics,
+                               const char* algorithm,
+                               const baldr::LabelQueueStats& queue,
+                               const search_start_t& start) const {
+  if (!statistics) {
+    return;
+  }
+  statistics->set_algorithm(algorithm);
+  statistics->set_labels_added(statistics->labels_added() + queue.added);
+  statistics->set_labels_decreased(statistics->labels_decreased() + queue.decreased);
+  statistics->set_labels_settled(statistics->labels_settled() + queue.popped);
+  statistics->set_queue_rebuilds(statistics->queue_rebuilds() + queue.rebuilds);
+  statistics->set_tiles_fetched(statistics->tiles_fetched() + reader->tiles_fetched() -
+                                start.tiles_fetched);
+  statistics->set_tiles_missed(statistics->tiles_missed() + reader->tiles_missed() -
+                               start.tiles_missed);
+}
+
+void thor_worker_t::log_statistics(const Api& request) const {
+  if (!log_search_statistics) {
+    return;
+  }
+  for (const auto& statistics : request.statistics()) {
+    LOG_INFO("thor::" + Options_Action_Enum_Name(request.options().action()) +
+             " search statistics::" + statistics.algorithm() +
+             " labels_added=" + std::to_string(statistics.labels_added()) +
+             " labels_decreased=" + std::to_string(statistics.labels_decreased()) +
+             " labels_settled=" + std::to_string(statistics.labels_settled()) +
+             " queue_rebuilds=" + std::to_string(statistics.queue_rebuilds()) +
+             " tiles_fetched=" + std::to_string(statistics.tiles_fetched()) +
+             " tiles_missed=" + std::to_string(statistics.tiles_missed()));
+  }
+}
+
+// The paths thor found for an earlier request with the same key, worked on with the deadline and
+// lane of this request
+void thor_worker_t::restore_result(Api& request, const std::string& cached) const {
+  auto deadline = request.options().deadline();
+  auto cost = request.options().cost();
+  request.ParseFromString(cached);
+  request.mutable_options()->set_deadline(deadline);
+  request.mutable_options()->set_cost(cost);
 }
 
 std::string thor_worker_t::parse_costing(const Api& request) {
@@ -225,7 +486,9 @@ std::string thor_worker_t::parse_costing(const Api& request) {
     mode_costing[3] = get_costing(Costing::transit, options);
     mode = valhalla::sif::TravelMode::kPedestrian;
   } else {
-    valhalla::sif::cost_ptr_t cost = get_costing(costing, options);
+    // Reuse the costing of an earlier request with the same costing options
+    valhalla::sif::cost_ptr_t cost =
+        costing_cache.Get(costing, options, [&]() { return get_costing(costing, options); });
     mode = cost->travel_mode();
     mode_costing[static_cast<uint32_t>(mode)] = cost;
   }
@@ -356,12 +619,37 @@ void thor_worker_t::parse_filter_attributes(const Api& request, bool is_strict_f
 void thor_worker_t::cleanup() {
   astar.Clear();
   bidir_astar.Clear();
+  ch_query.Clear();
+  overlay_query.Clear();
   timedep_forward.Clear();
   timedep_reverse.Clear();
   multi_modal_astar.Clear();
+  raptor.Clear();
+  for (auto& algorithms : leg_algorithms) {
+    algorithms->astar.Clear();
+    algorithms->bidir_astar.Clear();
+  }
   trace.clear();
   isochrone_gen.Clear();
   matcher_factory.ClearFullCache();
+  // The reader may switch to a newly swapped in tile extract between requests, what was cached
+  // from the previous one is stale then
+  reader->UpdateTileExtract();
+  if (reader->tile_extract_version() != tile_extract_version) {
+    tile_extract_version = reader->tile_extract_version();
+    matcher_factory.ClearCache();
+    isochrone_cache.Clear();
+    if (edge_cost_cache) {
+      edge_cost_cache->Clear();
+    }
+    if (result_cache) {
+      result_cache->Clear();
+    }
+    if (depot_oracle) {
+      depot_oracle->Clear();
+    }
+  }
+  reader->ReportMetrics();
   if (reader->OverCommitted()) {
     reader->Trim();
   }
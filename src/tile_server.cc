@@ -3,43 +3,30 @@
 #include "valhalla/filesystem.h"
 
 #include "baldr/compression_utils.h"
+#include "midgard/sequence.h"
 
 #include <prime_server/http_protocol.hpp>
 #include <prime_server/http_util.hpp>
 #include <prime_server/prime_server.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <thread>
+#include <unordered_map>
 
 using namespace prime_server;
 
 namespace {
-std::string gzip(std::string& uncompressed) {
-  auto deflate_src = [&uncompressed](z_stream& s) {
-    s.next_in = static_cast<Byte*>(static_cast<void*>(&uncompressed[0]));
-    s.avail_in = static_cast<unsigned int>(uncompressed.size() * sizeof(std::string::value_type));
-    return Z_FINISH;
-  };
-
+std::string gzip(const char* uncompressed, size_t size) {
   std::string compressed;
-  auto deflate_dst = [&compressed](z_stream& s) {
-    // if the whole buffer wasn't used we are done
-    auto size = compressed.size();
-    if (s.total_out < size)
-      compressed.resize(s.total_out);
-    // we need more space
-    else {
-      // set the pointer to the next spot
-      compressed.resize(size + 16);
-      s.next_out = static_cast<Byte*>(static_cast<void*>(&compressed[0] + size));
-      s.avail_out = 16;
-    }
-  };
-
-  if (!valhalla::baldr::deflate(deflate_src, deflate_dst))
+  if (!valhalla::baldr::deflate(uncompressed, size, compressed))
     throw std::logic_error("Can't write gzipped string");
 
   return compressed;
@@ -54,10 +41,101 @@ std::string extract_file_path_from_request(const std::string& request_path) {
   return request_path.substr(pos);
 }
 
+// A tile ready to be served, with its gzipped variant made the first time a client asks for it
+struct served_tile_t {
+  // the bytes point into the mapped extract or into owned when read from a directory
+  const char* data;
+  size_t size;
+  std::string owned;
+  // quoted hash of the bytes, which tells clients whether their copy is still current
+  std::string etag;
+  std::once_flag gzipped_once;
+  std::string gzipped;
+
+  served_tile_t(const char* data, size_t size) : data(data), size(size) {
+    // fnv-1a over the whole tile
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+    }
+    std::ostringstream quoted;
+    quoted << '"' << std::hex << hash << '"';
+    etag = quoted.str();
+  }
+
+  const std::string& gz() {
+    std::call_once(gzipped_once, [this]() { gzipped = gzip(data, size); });
+    return gzipped;
+  }
+};
+
+/**
+ * Serves tiles out of a tile extract, which stays memory mapped so the tiles are copied straight
+ * from the mapping into the response, or out of a tile directory, whose files are read once and
+ * then kept. Either way the served tiles, and their gzipped variants, are cached so that concurrent
+ * workers only do the work for each tile once.
+ */
+class tile_source_t {
+public:
+  explicit tile_source_t(const std::string& tile_source) : tile_source_(tile_source) {
+    if (filesystem::is_regular_file(tile_source_)) {
+      extract_.reset(new valhalla::midgard::tar(tile_source_));
+    }
+  }
+
+  std::shared_ptr<served_tile_t> get(const std::string& path) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto cached = cache_.find(path);
+      if (cached != cache_.end()) {
+        return cached->second;
+      }
+    }
+
+    // make the tile outside of the lock since reading and hashing it can take a while
+    std::shared_ptr<served_tile_t> tile;
+    if (extract_) {
+      auto entry = extract_->contents.find(path);
+      if (entry == extract_->contents.end()) {
+        return nullptr;
+      }
+      tile = std::make_shared<served_tile_t>(entry->second.first, entry->second.second);
+    } else {
+      std::ifstream input(tile_source_ + (filesystem::path::preferred_separator + path),
+                          std::ios::in | std::ios::binary | std::ios::ate);
+      if (!input) {
+        return nullptr;
+      }
+      std::string buffer(static_cast<size_t>(input.tellg()), '\0');
+      input.seekg(0);
+      input.read(&buffer[0], buffer.size());
+      tile = std::make_shared<served_tile_t>(buffer.data(), buffer.size());
+      tile->owned = std::move(buffer);
+      tile->data = tile->owned.data();
+    }
+
+    // whoever got here first wins, tiles dont change while being served
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.emplace(path, tile).first->second;
+  }
+
+private:
+  std::string tile_source_;
+  std::unique_ptr<valhalla::midgard::tar> extract_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<served_tile_t>> cache_;
+};
+
+bool accepts_gzip(const http_request_t& request) {
+  auto encoding_it = request.headers.find("Accept-Encoding");
+  return encoding_it != request.headers.end() &&
+         encoding_it->second.find("gzip") != std::string::npos;
+}
+
 worker_t::result_t disk_work(const std::list<zmq::message_t>& job,
                              void* request_info,
                              worker_t::interrupt_function_t&,
-                             const std::string& tile_source_dir) {
+                             const std::shared_ptr<tile_source_t>& tile_source) {
   worker_t::result_t result{false, std::list<std::string>(), ""};
   auto* info = static_cast<http_request_info_t*>(request_info);
   try {
@@ -65,20 +143,22 @@ worker_t::result_t disk_work(const std::list<zmq::message_t>& job,
     const auto request =
         http_request_t::from_string(static_cast<const char*>(job.front().data()), job.front().size());
 
-    auto encoding_it = request.headers.find("Accept-Encoding");
-    auto gz = encoding_it != request.headers.end() && encoding_it->second == "gzip";
-
-    auto path = extract_file_path_from_request(request.path);
-    // load the file and gzip it if we have to
-    std::string full_path = tile_source_dir + (filesystem::path::preferred_separator + path);
-    std::fstream input(full_path, std::ios::in | std::ios::binary);
-    if (input) {
-      std::string buffer((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
-      if (gz) {
-        buffer = gzip(buffer);
+    auto gz = accepts_gzip(request);
+    auto tile = tile_source->get(extract_file_path_from_request(request.path));
+    if (tile) {
+      // the client already has this exact tile
+      auto if_none_match = request.headers.find("If-None-Match");
+      if (if_none_match != request.headers.end() && if_none_match->second == tile->etag) {
+        http_response_t response(304, "Not Modified", "", headers_t{{"ETag", tile->etag}});
+        response.from_info(*info);
+        result.messages = {response.to_string()};
+        return result;
       }
-      http_response_t response(200, "OK", buffer,
-                               headers_t{{"Content-Encoding", gz ? "gzip" : "identity"}});
+
+      // send the cached gzipped variant if we can, otherwise the bytes as they are
+      http_response_t response(200, "OK", gz ? tile->gz() : std::string(tile->data, tile->size),
+                               headers_t{{"Content-Encoding", gz ? "gzip" : "identity"},
+                                         {"ETag", tile->etag}});
       response.from_info(*info);
       result.messages = {response.to_string()};
     }
@@ -104,7 +184,9 @@ namespace valhalla {
 const std::string test_tile_server_t::server_url = "127.0.0.1:8004";
 
 // static
-void test_tile_server_t::start(const std::string& tile_source_dir, zmq::context_t& context) {
+void test_tile_server_t::start(const std::string& tile_source,
+                               zmq::context_t& context,
+                               unsigned int worker_count) {
   // change these to tcp://known.ip.address.with:port if you want to do this across machines
   std::string result_endpoint = "ipc:///tmp/http_test_result_endpoint";
   std::string request_interrupt = "ipc:///tmp/http_test_request_interrupt";
@@ -121,14 +203,17 @@ void test_tile_server_t::start(const std::string& tile_source_dir, zmq::context_
                                                               proxy_endpoint + "_downstream")));
   file_proxy.detach();
 
-  // file serving thread
-  std::thread file_worker(
-      std::bind(&worker_t::work,
-                worker_t(context, proxy_endpoint + "_downstream", "ipc:///dev/null", result_endpoint,
-                         request_interrupt,
-                         std::bind(&disk_work, std::placeholders::_1, std::placeholders::_2,
-                                   std::placeholders::_3, tile_source_dir))));
-  file_worker.detach();
+  // file serving threads, the proxy hands each request to whichever one is free
+  auto source = std::make_shared<tile_source_t>(tile_source);
+  for (unsigned int i = 0; i < std::max(worker_count, 1u); ++i) {
+    std::thread file_worker(
+        std::bind(&worker_t::work,
+                  worker_t(context, proxy_endpoint + "_downstream", "ipc:///dev/null",
+                           result_endpoint, request_interrupt,
+                           std::bind(&disk_work, std::placeholders::_1, std::placeholders::_2,
+                                     std::placeholders::_3, source))));
+    file_worker.detach();
+  }
 
   std::this_thread::sleep_for(std::chrono::seconds(1));
 }
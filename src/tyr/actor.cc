@@ -1,6 +1,9 @@
 #include "tyr/actor.h"
+#include <chrono>
+
 #include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
+#include "midgard/logging.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
 #include "tyr/serializers.h"
@@ -18,10 +21,13 @@ struct actor_t::pimpl_t {
       : reader(new baldr::GraphReader(config.get_child("mjolnir"))), loki_worker(config, reader),
         thor_worker(config, reader), odin_worker(config) {
   }
-  void set_interrupts(const std::function<void()>& interrupt_function) {
+  void set_interrupts(const std::function<void()>& interrupt_function, const uint64_t deadline) {
     loki_worker.set_interrupt(interrupt_function);
     thor_worker.set_interrupt(interrupt_function);
     odin_worker.set_interrupt(interrupt_function);
+    loki_worker.set_deadline(deadline);
+    thor_worker.set_deadline(deadline);
+    odin_worker.set_deadline(deadline);
   }
   void cleanup() {
     loki_worker.cleanup();
@@ -42,187 +48,259 @@ void actor_t::cleanup() {
   pimpl->cleanup();
 }
 
-std::string actor_t::route(const std::string& request_str, const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
-  // parse the request
-  Api request;
-  ParseApi(request_str, Options::route, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.route(request);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.route(request);
-  // get some directions back from them
-  pimpl->odin_worker.narrate(request);
-  // serialize them out to json string
-  auto bytes = tyr::serializeDirections(request);
+std::string actor_t::act(Api& request, const std::function<void()>& interrupt) {
+  // set the interrupts and when to give up on the request
+  pimpl->loki_worker.limit_deadline(request);
+  pimpl->set_interrupts(interrupt, request.options().deadline());
+  std::string response;
+  switch (request.options().action()) {
+    case Options::route:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.route(request);
+      // route between the locations in the graph to find the best path
+      pimpl->thor_worker.route(request);
+      // get some directions back from them
+      pimpl->odin_worker.narrate(request);
+      // serialize them out to json string
+      response = tyr::serializeDirections(request);
+      break;
+    case Options::locate:
+      // check the request and locate the locations in the graph
+      response = pimpl->loki_worker.locate(request);
+      break;
+    case Options::sources_to_targets:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.matrix(request);
+      // compute the matrix
+      response = pimpl->thor_worker.matrix(request);
+      break;
+    case Options::optimized_route:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.matrix(request);
+      // compute compute all pairs and then the shortest path through them all
+      pimpl->thor_worker.optimized_route(request);
+      // get some directions back from them
+      pimpl->odin_worker.narrate(request);
+      // serialize them out to json string
+      response = tyr::serializeDirections(request);
+      break;
+    case Options::isochrone:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.isochrones(request);
+      // compute the isochrones
+      response = pimpl->thor_worker.isochrones(request);
+      break;
+    case Options::trace_route:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.trace(request);
+      // route between the locations in the graph to find the best path
+      pimpl->thor_worker.trace_route(request);
+      // get some directions back from them
+      pimpl->odin_worker.narrate(request);
+      // serialize them out to json string
+      response = tyr::serializeDirections(request);
+      break;
+    case Options::trace_attributes:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.trace(request);
+      // get the path and turn it into attribution along it
+      response = pimpl->thor_worker.trace_attributes(request);
+      break;
+    case Options::height:
+      // get the height at each point
+      response = pimpl->loki_worker.height(request);
+      break;
+    case Options::transit_available:
+      // check the request and locate the locations in the graph
+      response = pimpl->loki_worker.transit_available(request);
+      break;
+    case Options::expansion:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.route(request);
+      // route between the locations in the graph to find the best path
+      response = pimpl->thor_worker.expansion(request);
+      break;
+    default:
+      // apparently you wanted something that we figured we'd support but havent written yet
+      throw valhalla_exception_t{107};
+  }
   // if they want you do to do the cleanup automatically
   if (auto_cleanup) {
     cleanup();
   }
-  return bytes;
+  return response;
 }
 
-std::string actor_t::locate(const std::string& request_str, const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
-  // parse the request
-  Api request;
-  ParseApi(request_str, Options::locate, request);
-  // check the request and locate the locations in the graph
-  auto json = pimpl->loki_worker.locate(request);
+void actor_t::compute(Api& request, const std::function<void()>& interrupt) {
+  // set the interrupts and when to give up on the request
+  pimpl->loki_worker.limit_deadline(request);
+  pimpl->set_interrupts(interrupt, request.options().deadline());
+  switch (request.options().action()) {
+    case Options::route:
+      pimpl->loki_worker.route(request);
+      pimpl->thor_worker.route(request);
+      pimpl->odin_worker.narrate(request);
+      break;
+    case Options::sources_to_targets:
+      pimpl->loki_worker.matrix(request);
+      pimpl->thor_worker.fill_matrix(request);
+      break;
+    case Options::optimized_route:
+      pimpl->loki_worker.matrix(request);
+      pimpl->thor_worker.optimized_route(request);
+      pimpl->odin_worker.narrate(request);
+      break;
+    case Options::trace_route:
+      pimpl->loki_worker.trace(request);
+      pimpl->thor_worker.trace_route(request);
+      pimpl->odin_worker.narrate(request);
+      break;
+    default:
+      // the rest only have a json output
+      throw valhalla_exception_t{167};
+  }
   // if they want you do to do the cleanup automatically
   if (auto_cleanup) {
     cleanup();
   }
-  return json;
+}
+
+std::string actor_t::shard_url(const Api& request) const {
+  return pimpl->loki_worker.shard_url(request);
+}
+
+std::string actor_t::route(const std::string& request_str, const std::function<void()>& interrupt) {
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::route, request);
+  return act(request, interrupt);
+}
+
+std::string actor_t::locate(const std::string& request_str, const std::function<void()>& interrupt) {
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::locate, request);
+  return act(request, interrupt);
 }
 
 std::string actor_t::matrix(const std::string& request_str, const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::sources_to_targets, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.matrix(request);
-  // compute the matrix
-  auto json = pimpl->thor_worker.matrix(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  return act(request, interrupt);
 }
 
 std::string actor_t::optimized_route(const std::string& request_str,
                                      const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::optimized_route, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.matrix(request);
-  // compute compute all pairs and then the shortest path through them all
-  pimpl->thor_worker.optimized_route(request);
-  // get some directions back from them
-  pimpl->odin_worker.narrate(request);
-  // serialize them out to json string
-  auto bytes = tyr::serializeDirections(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return bytes;
+  return act(request, interrupt);
 }
 
 std::string actor_t::isochrone(const std::string& request_str,
                                const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::isochrone, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.isochrones(request);
-  // compute the isochrones
-  auto json = pimpl->thor_worker.isochrones(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  return act(request, interrupt);
 }
 
 std::string actor_t::trace_route(const std::string& request_str,
                                  const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::trace_route, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.trace(request);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.trace_route(request);
-  // get some directions back from them
-  pimpl->odin_worker.narrate(request);
-  // serialize them out to json string
-  auto bytes = tyr::serializeDirections(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return bytes;
+  return act(request, interrupt);
 }
 
 std::string actor_t::trace_attributes(const std::string& request_str,
                                       const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::trace_attributes, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.trace(request);
-  // get the path and turn it into attribution along it
-  auto json = pimpl->thor_worker.trace_attributes(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  return act(request, interrupt);
 }
 
 std::string actor_t::height(const std::string& request_str, const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::height, request);
-  // get the height at each point
-  auto json = pimpl->loki_worker.height(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  return act(request, interrupt);
 }
 
 std::string actor_t::transit_available(const std::string& request_str,
                                        const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::transit_available, request);
-  // check the request and locate the locations in the graph
-  auto json = pimpl->loki_worker.transit_available(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  return act(request, interrupt);
 }
 
 std::string actor_t::expansion(const std::string& request_str,
                                const std::function<void()>& interrupt) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::expansion, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.route(request);
-  // route between the locations in the graph to find the best path
-  auto json = pimpl->thor_worker.expansion(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  return act(request, interrupt);
+}
+
+#ifdef HAVE_HTTP
+void run_service(const boost::property_tree::ptree& config) {
+  // gets requests from the http server
+  auto upstream_endpoint = config.get<std::string>("loki.service.proxy") + "_out";
+  // and returns the responses straight back to it
+  auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
+  auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
+
+  // all of the stages work on the same request so nothing is serialized between them
+  actor_t actor(config, true);
+  service_metrics_t metrics("tyr");
+  admission_t admission(config, "tyr");
+  auto work = [&actor, &metrics, &admission](const std::list<zmq::message_t>& job,
+                                             void* request_info,
+                                             const std::function<void()>& interrupt) {
+    auto s = std::chrono::steady_clock::now();
+    auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
+    LOG_INFO("Got Request " + std::to_string(info.id));
+    Api request;
+    try {
+      auto http_request =
+          prime_server::http_request_t::from_string(static_cast<const char*>(job.front().data()),
+                                                    job.front().size());
+      ParseApi(http_request, request);
+      if (!request.options().has_action()) {
+        return jsonify_error({106}, info, request);
+      }
+      // requests the tiles of another shard serve are sent there
+      auto url = actor.shard_url(request);
+      if (!url.empty()) {
+        return to_redirect(url, http_request, info);
+      }
+      // expensive requests may have to wait for a turn so they do not hold up the cheap ones
+      auto ticket = admission.admit(request, interrupt);
+      auto response = actor.act(request, interrupt);
+      metrics.request(request,
+                      std::chrono::duration<double>(std::chrono::steady_clock::now() - s).count());
+      return to_response(response, info, request);
+    } catch (const valhalla_exception_t& e) {
+      midgard::logging::Log("400::" + std::string(e.what()), " [ANALYTICS] ");
+      return jsonify_error(e, info, request);
+    } catch (const std::exception& e) {
+      midgard::logging::Log("400::" + std::string(e.what()), " [ANALYTICS] ");
+      return jsonify_error({199, std::string(e.what())}, info, request);
+    }
+  };
+
+  // listen for requests
+  zmq::context_t context;
+  prime_server::worker_t worker(context, upstream_endpoint, "ipc:///dev/null", loopback_endpoint,
+                                interrupt_endpoint, work);
+  worker.work();
+
+  // TODO: should we listen for SIGINT and terminate gracefully/exit(0)?
 }
+#endif
 
 } // namespace tyr
 } // namespace valhalla
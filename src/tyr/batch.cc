@@ -0,0 +1,146 @@
+#include "tyr/batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "baldr/rapidjson_utils.h"
+#include "tyr/actor.h"
+#include "worker.h"
+
+namespace {
+
+// the error response of a request in a batch, the same as the python bindings give
+std::string batch_error(unsigned code, unsigned http_code, const std::string& message) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("error_code");
+  writer.Uint(code);
+  writer.Key("http_code");
+  writer.Uint(http_code);
+  writer.Key("message");
+  writer.String(message);
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace tyr {
+
+std::vector<std::string> read_batch(const std::string& file_name) {
+  std::ifstream file(file_name);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open the batch of requests: " + file_name);
+  }
+
+  // either the json alone or the json in a -j '<json>' like the test_requests
+  std::vector<std::string> requests;
+  std::string line;
+  while (std::getline(file, line)) {
+    auto begin = line.find('{');
+    auto end = line.find_last_of('}');
+    if (begin == std::string::npos || end == std::string::npos || end < begin) {
+      continue;
+    }
+    requests.emplace_back(line.substr(begin, end - begin + 1));
+  }
+  return requests;
+}
+
+std::vector<batch_result_t> run_batch(const boost::property_tree::ptree& config,
+                                      const Options::Action action,
+                                      const std::vector<std::string>& requests,
+                                      unsigned int threads) {
+  // the actors all read the same tiles so unless the config already shares a thread safe cache
+  // they share the sharded one
+  auto shared = config;
+  if (!shared.get<bool>("mjolnir.global_synchronized_cache", false)) {
+    shared.put("mjolnir.use_sharded_tile_cache", true);
+  }
+
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  threads = std::max<size_t>(std::min<size_t>(threads, requests.size()), 1);
+  std::vector<std::unique_ptr<actor_t>> actors;
+  for (unsigned int i = 0; i < threads; ++i) {
+    actors.emplace_back(new actor_t(shared, true));
+  }
+
+  // each thread takes the next request until there are none left
+  std::vector<batch_result_t> results(requests.size());
+  std::atomic<size_t> next(0);
+  std::exception_ptr failure;
+  std::mutex failure_mutex;
+  auto work = [&](actor_t& actor) {
+    try {
+      for (size_t i = next++; i < requests.size(); i = next++) {
+        auto& result = results[i];
+        auto start = std::chrono::steady_clock::now();
+        try {
+          Api api;
+          ParseApi(requests[i], action, api);
+          result.response = actor.act(api);
+          result.ok = true;
+        } catch (const valhalla_exception_t& e) {
+          actor.cleanup();
+          result.response = batch_error(e.code, e.http_code, e.message);
+          result.ok = false;
+        } catch (const std::exception& e) {
+          actor.cleanup();
+          result.response = batch_error(0, 500, e.what());
+          result.ok = false;
+        }
+        result.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(failure_mutex);
+      failure = std::current_exception();
+      next = requests.size();
+    }
+  };
+  std::vector<std::thread> pool;
+  for (size_t i = 1; i < actors.size(); ++i) {
+    pool.emplace_back(work, std::ref(*actors[i]));
+  }
+  work(*actors.front());
+  for (auto& thread : pool) {
+    thread.join();
+  }
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  return results;
+}
+
+void write_batch(const std::vector<batch_result_t>& results,
+                 std::ostream* responses,
+                 std::ostream* timings) {
+  if (responses) {
+    for (const auto& result : results) {
+      *responses << result.response << '\n';
+    }
+    responses->flush();
+  }
+  if (timings) {
+    *timings << "request,ok,milliseconds\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      *timings << i << ',' << (results[i].ok ? "true" : "false") << ','
+               << results[i].seconds * 1e3 << '\n';
+    }
+    timings->flush();
+  }
+}
+
+} // namespace tyr
+} // namespace valhalla
@@ -1,6 +1,8 @@
+#include <cmath>
 #include <sstream>
 
 #include "baldr/json.h"
+#include "midgard/encoded.h"
 #include "skadi/sample.h"
 #include "tyr/serializers.h"
 
@@ -45,6 +47,43 @@ json::ArrayPtr serialize_height(const std::vector<double>& heights, const double
   return array;
 }
 
+// polyline encodes the heights in meters, each one after the distance to it if there are any.
+// there is no null in a polyline so missing heights keep the no data value
+std::string encode_heights(const std::vector<float>& ranges, const std::vector<double>& heights) {
+  std::string encoded;
+  auto out = std::back_inserter(encoded);
+  int last_range = 0, last_height = 0;
+  for (size_t i = 0; i < heights.size(); ++i) {
+    if (!ranges.empty()) {
+      int range = static_cast<int>(std::round(ranges[i]));
+      out = midgard::encode_number(range - last_range, out);
+      last_range = range;
+    }
+    int height = static_cast<int>(std::round(heights[i]));
+    out = midgard::encode_number(height - last_height, out);
+    last_height = height;
+  }
+  return encoded;
+}
+
+// the heights go in the response as arrays or as polylines
+void serialize_heights(const json::MapPtr& json,
+                       const std::vector<float>& ranges,
+                       const std::vector<double>& heights,
+                       const Options::HeightEncoding encoding) {
+  const auto no_data_value = skadi::sample::get_no_data_value();
+  const char* key = ranges.empty() ? "height" : "range_height";
+  if (encoding == Options::height_polyline) {
+    json->emplace(key, encode_heights(ranges, heights));
+  } // get the distances between the postings
+  else if (!ranges.empty()) {
+    json->emplace(key, serialize_range_height(ranges, heights, no_data_value));
+  } // just the postings
+  else {
+    json->emplace(key, serialize_height(heights, no_data_value));
+  }
+}
+
 json::ArrayPtr serialize_shape(const google::protobuf::RepeatedPtrField<valhalla::Location>& shape) {
   auto array = json::array({});
   for (const auto& p : shape) {
@@ -54,6 +93,16 @@ json::ArrayPtr serialize_shape(const google::protobuf::RepeatedPtrField<valhalla
   return array;
 }
 
+json::ArrayPtr
+serialize_points(const google::protobuf::RepeatedPtrField<valhalla::LatLng>& points) {
+  auto array = json::array({});
+  for (const auto& p : points) {
+    array->emplace_back(
+        json::map({{"lon", json::fp_t{p.lng(), 6}}, {"lat", json::fp_t{p.lat(), 6}}}));
+  }
+  return array;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -69,15 +118,8 @@ std::string serializeHeight(const Api& request,
                             const std::vector<double>& heights,
                             const std::vector<float>& ranges) {
   auto json = json::map({});
+  serialize_heights(json, ranges, heights, request.options().height_encoding());
 
-  // get the distances between the postings
-  if (ranges.size()) {
-    json = json::map({{"range_height",
-                       serialize_range_height(ranges, heights, skadi::sample::get_no_data_value())}});
-  } // just the postings
-  else {
-    json = json::map({{"height", serialize_height(heights, skadi::sample::get_no_data_value())}});
-  }
   // send back the shape as well
   if (request.options().has_encoded_polyline()) {
     json->emplace("encoded_polyline", request.options().encoded_polyline());
@@ -92,5 +134,32 @@ std::string serializeHeight(const Api& request,
   ss << *json;
   return ss.str();
 }
+
+std::string serializeHeights(const Api& request,
+                             const std::vector<std::vector<double>>& heights,
+                             const std::vector<std::vector<float>>& ranges) {
+  // each shape goes back with its heights, in the form it was sent
+  auto shapes = json::array({});
+  for (int i = 0; i < request.options().height_shapes_size(); ++i) {
+    const auto& shape = request.options().height_shapes(i);
+    auto json = json::map({});
+    serialize_heights(json, ranges[i], heights[i], request.options().height_encoding());
+    if (shape.has_encoded_polyline()) {
+      json->emplace("encoded_polyline", shape.encoded_polyline());
+    } else {
+      json->emplace("shape", serialize_points(shape.points()));
+    }
+    shapes->emplace_back(json);
+  }
+
+  auto json = json::map({{"heights", shapes}});
+  if (request.options().has_id()) {
+    json->emplace("id", request.options().id());
+  }
+
+  std::stringstream ss;
+  ss << *json;
+  return ss.str();
+}
 } // namespace tyr
 } // namespace valhalla
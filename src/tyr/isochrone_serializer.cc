@@ -6,28 +6,29 @@
 
 #include <cmath>
 #include <iomanip>
+#include <iterator>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 using namespace valhalla::baldr::json;
 
 namespace {
 using rgba_t = std::tuple<float, float, float>;
-}
-
-namespace valhalla {
-namespace tyr {
 
+// The contours of a grid and the locations it was expanded from as a feature collection, the
+// members of the collection object are written and the caller closes it
 template <class coord_t>
-std::string
-serializeIsochrones(const Api& request,
-                    const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
-                    bool polygons,
-                    const std::unordered_map<float, std::string>& colors,
-                    bool show_locations) {
+void featureCollection(
+    Writer& writer,
+    const typename valhalla::midgard::GriddedData<coord_t>::contours_t& grid_contours,
+    bool polygons,
+    const std::unordered_map<float, std::string>& colors,
+    const std::vector<const valhalla::Location*>& locations) {
+  writer("type", "FeatureCollection");
+  writer.start_array("features");
   // for each contour interval
   int i = 0;
-  auto features = array({});
   for (const auto& interval : grid_contours) {
     auto color_itr = colors.find(interval.first);
     // color was supplied
@@ -50,65 +51,158 @@ serializeIsochrones(const Api& request,
 
     // for each feature on that interval
     for (const auto& feature : interval.second) {
-      // for each contour in that feature
-      auto geom = array({});
-      for (const auto& contour : feature) {
-        // make some geometry
-        auto coords = array({});
-        for (const auto& coord : contour) {
-          coords->push_back(array({fp_t{coord.first, 6}, fp_t{coord.second, 6}}));
+      // add a feature
+      writer.start_object();
+      writer("type", "Feature");
+      writer.start_object("geometry");
+      writer("type", polygons ? "Polygon" : "LineString");
+      // its either rings or a single line, if someone has more than one contour per feature
+      // they messed up and only the last one is kept
+      writer.start_array("coordinates");
+      auto contour = feature.cbegin();
+      if (!polygons && !feature.empty()) {
+        contour = std::prev(feature.cend());
+      }
+      for (; contour != feature.cend(); ++contour) {
+        if (polygons) {
+          writer.start_array();
+        }
+        for (const auto& coord : *contour) {
+          writer.start_array();
+          writer(fp_t{coord.first, 6});
+          writer(fp_t{coord.second, 6});
+          writer.end_array();
         }
-        // its either a ring
         if (polygons) {
-          geom->emplace_back(coords);
-          // or a single line, if someone has more than one contour per feature they messed up
-        } else {
-          geom = coords;
+          writer.end_array();
         }
       }
-      // add a feature
-      features->emplace_back(map({
-          {"type", std::string("Feature")},
-          {"geometry", map({
-                           {"type", std::string(polygons ? "Polygon" : "LineString")},
-                           {"coordinates", geom},
-                       })},
-          {"properties", map({
-                             {"contour", static_cast<uint64_t>(interval.first)},
-                             {"color", hex.str()},            // lines
-                             {"fill", hex.str()},             // geojson.io polys
-                             {"fillColor", hex.str()},        // leaflet polys
-                             {"opacity", fp_t{.33f, 2}},      // lines
-                             {"fill-opacity", fp_t{.33f, 2}}, // geojson.io polys
-                             {"fillOpacity", fp_t{.33f, 2}},  // leaflet polys
-                         })},
-      }));
+      writer.end_array();
+      writer.end_object();
+      writer.start_object("properties");
+      writer("contour", static_cast<uint64_t>(interval.first));
+      writer("color", hex.str());            // lines
+      writer("fill", hex.str());             // geojson.io polys
+      writer("fillColor", hex.str());        // leaflet polys
+      writer("opacity", fp_t{.33f, 2});      // lines
+      writer("fill-opacity", fp_t{.33f, 2}); // geojson.io polys
+      writer("fillOpacity", fp_t{.33f, 2});  // leaflet polys
+      writer.end_object();
+      writer.end_object();
     }
   }
   // Add original locations to the geojson
+  for (const auto* location : locations) {
+    writer.start_object();
+    writer("type", "Feature");
+    writer.start_object("properties");
+    writer.end_object();
+    writer.start_object("geometry");
+    writer("type", "Point");
+    writer.start_array("coordinates");
+    writer(fp_t{location->ll().lng(), 6});
+    writer(fp_t{location->ll().lat(), 6});
+    writer.end_array();
+    writer.end_object();
+    writer.end_object();
+  }
+  writer.end_array();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace tyr {
+
+template <class coord_t>
+std::string
+serializeIsochrones(const Api& request,
+                    const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
+                    bool polygons,
+                    const std::unordered_map<float, std::string>& colors,
+                    bool show_locations) {
+  // Add original locations to the geojson
+  std::vector<const valhalla::Location*> locations;
   if (show_locations) {
     for (const auto& location : request.options().locations()) {
-      features->emplace_back(
-          map({{"type", std::string("Feature")},
-               {"properties", map({})},
-               {"geometry", map({{"type", std::string("Point")},
-                                 {"coordinates", array({fp_t{location.ll().lng(), 6},
-                                                        fp_t{location.ll().lat(), 6}})}})}}));
+      locations.push_back(&location);
     }
   }
-  // make the collection
-  auto feature_collection = map({
-      {"type", std::string("FeatureCollection")},
-      {"features", features},
-  });
+  Writer writer;
+  writer.start_object();
+  featureCollection<coord_t>(writer, grid_contours, polygons, colors, locations);
+  if (request.options().has_id()) {
+    writer("id", request.options().id());
+  }
+  if (request.options().statistics()) {
+    writer("statistics", serializeStatistics(request));
+  }
+  writer.end_object();
+  return writer.release();
+}
 
+template <class coord_t>
+std::string serializeIsochrones(
+    const Api& request,
+    const std::vector<typename midgard::GriddedData<coord_t>::contours_t>& grid_contours,
+    bool polygons,
+    const std::unordered_map<float, std::string>& colors,
+    bool show_locations) {
+  // a feature collection per location, with only that location
+  Writer writer;
+  writer.start_object();
+  writer.start_array("isochrones");
+  for (size_t i = 0; i < grid_contours.size(); ++i) {
+    std::vector<const valhalla::Location*> locations;
+    if (show_locations) {
+      locations.push_back(&request.options().locations(i));
+    }
+    writer.start_object();
+    featureCollection<coord_t>(writer, grid_contours[i], polygons, colors, locations);
+    writer.end_object();
+  }
+  writer.end_array();
   if (request.options().has_id()) {
-    feature_collection->emplace("id", request.options().id());
+    writer("id", request.options().id());
+  }
+  if (request.options().statistics()) {
+    writer("statistics", serializeStatistics(request));
   }
+  writer.end_object();
+  return writer.release();
+}
 
-  std::stringstream ss;
-  ss << *feature_collection;
-  return ss.str();
+template <class coord_t>
+std::string
+serializeIsochrones(const Api& request,
+                    const typename midgard::GriddedData<coord_t>::contours_t& from_contours,
+                    const typename midgard::GriddedData<coord_t>::contours_t& to_contours,
+                    bool polygons,
+                    const std::unordered_map<float, std::string>& colors,
+                    bool show_locations) {
+  // both directions get the locations as they were expanded from (or to) all of them
+  std::vector<const valhalla::Location*> locations;
+  if (show_locations) {
+    for (const auto& location : request.options().locations()) {
+      locations.push_back(&location);
+    }
+  }
+  Writer writer;
+  writer.start_object();
+  writer.start_object("from");
+  featureCollection<coord_t>(writer, from_contours, polygons, colors, locations);
+  writer.end_object();
+  writer.start_object("to");
+  featureCollection<coord_t>(writer, to_contours, polygons, colors, locations);
+  writer.end_object();
+  if (request.options().has_id()) {
+    writer("id", request.options().id());
+  }
+  if (request.options().statistics()) {
+    writer("statistics", serializeStatistics(request));
+  }
+  writer.end_object();
+  return writer.release();
 }
 
 template std::string
@@ -123,6 +217,19 @@ serializeIsochrones<midgard::PointLL>(const Api&,
                                       bool,
                                       const std::unordered_map<float, std::string>&,
                                       bool);
+template std::string serializeIsochrones<midgard::PointLL>(
+    const Api&,
+    const std::vector<midgard::GriddedData<midgard::PointLL>::contours_t>&,
+    bool,
+    const std::unordered_map<float, std::string>&,
+    bool);
+template std::string
+serializeIsochrones<midgard::PointLL>(const Api&,
+                                      const midgard::GriddedData<midgard::PointLL>::contours_t&,
+                                      const midgard::GriddedData<midgard::PointLL>::contours_t&,
+                                      bool,
+                                      const std::unordered_map<float, std::string>&,
+                                      bool);
 
 } // namespace tyr
 } // namespace valhalla
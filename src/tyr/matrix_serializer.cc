@@ -1,4 +1,5 @@
 #include <cstdint>
+#include <limits>
 
 #include "baldr/json.h"
 #include "thor/costmatrix.h"
@@ -9,65 +10,76 @@ using namespace valhalla::midgard;
 using namespace valhalla::baldr;
 using namespace valhalla::thor;
 
+namespace {
+
+// About how many bytes the time and distance of a pair take in the output of each format
+constexpr size_t kOsrmPairSize = 16;
+constexpr size_t kValhallaPairSize = 72;
+
+} // namespace
+
 namespace osrm_serializers {
 
-json::ArrayPtr
-serialize_duration(const std::vector<TimeDistance>& tds, size_t start_td, const size_t td_count) {
-  auto time = json::array({});
+void serialize_duration(json::Writer& writer,
+                        const std::vector<TimeDistance>& tds,
+                        size_t start_td,
+                        const size_t td_count) {
+  writer.start_array();
   for (size_t i = start_td; i < start_td + td_count; ++i) {
     // check to make sure a route was found; if not, return null for time in matrix result
     if (tds[i].time != kMaxCost) {
-      time->emplace_back(static_cast<uint64_t>(tds[i].time));
+      writer(static_cast<uint64_t>(tds[i].time));
     } else {
-      time->emplace_back(static_cast<std::nullptr_t>(nullptr));
+      writer(nullptr);
     }
   }
-  return time;
+  writer.end_array();
 }
 
-json::ArrayPtr serialize_distance(const std::vector<TimeDistance>& tds,
-                                  size_t start_td,
-                                  const size_t td_count,
-                                  const size_t source_index,
-                                  const size_t target_index,
-                                  double distance_scale) {
-  auto distance = json::array({});
+void serialize_distance(json::Writer& writer,
+                        const std::vector<TimeDistance>& tds,
+                        size_t start_td,
+                        const size_t td_count,
+                        double distance_scale) {
+  writer.start_array();
   for (size_t i = start_td; i < start_td + td_count; ++i) {
     // check to make sure a route was found; if not, return null for distance in matrix result
     if (tds[i].time != kMaxCost) {
-      distance->emplace_back(json::fp_t{tds[i].dist * distance_scale, 3});
+      writer(json::fp_t{tds[i].dist * distance_scale, 3});
     } else {
-      distance->emplace_back(static_cast<std::nullptr_t>(nullptr));
+      writer(nullptr);
     }
   }
-  return distance;
+  writer.end_array();
 }
 
 // Serialize route response in OSRM compatible format.
-json::MapPtr serialize(const Api& request,
-                       const std::vector<TimeDistance>& time_distances,
-                       double distance_scale) {
-  auto json = json::map({});
-  auto time = json::array({});
-  auto distance = json::array({});
+void serialize(json::Writer& writer,
+               const Api& request,
+               const std::vector<TimeDistance>& time_distances,
+               double distance_scale) {
   const auto& options = request.options();
 
   // If here then the matrix succeeded. Set status code to OK and serialize
   // waypoints (locations).
-  json->emplace("code", std::string("Ok"));
-  json->emplace("sources", osrm::waypoints(options.sources()));
-  json->emplace("destinations", osrm::waypoints(options.targets()));
+  writer.start_object();
+  writer("code", "Ok");
+  writer("sources", osrm::waypoints(options.sources()));
+  writer("destinations", osrm::waypoints(options.targets()));
 
+  writer.start_array("durations");
+  for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
+    serialize_duration(writer, time_distances, source_index * options.targets_size(),
+                       options.targets_size());
+  }
+  writer.end_array();
+  writer.start_array("distances");
   for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
-    time->emplace_back(serialize_duration(time_distances, source_index * options.targets_size(),
-                                          options.targets_size()));
-    distance->emplace_back(serialize_distance(time_distances, source_index * options.targets_size(),
-                                              options.targets_size(), source_index, 0,
-                                              distance_scale));
-  }
-  json->emplace("durations", time);
-  json->emplace("distances", distance);
-  return json;
+    serialize_distance(writer, time_distances, source_index * options.targets_size(),
+                       options.targets_size(), distance_scale);
+  }
+  writer.end_array();
+  writer.end_object();
 }
 } // namespace osrm_serializers
 
@@ -78,77 +90,171 @@ valhalla output looks like this:
 
 */
 
-json::ArrayPtr locations(const google::protobuf::RepeatedPtrField<valhalla::Location>& correlated) {
-  auto input_locs = json::array({});
+void locations(json::Writer& writer,
+               const google::protobuf::RepeatedPtrField<valhalla::Location>& correlated) {
+  writer.start_array();
   for (size_t i = 0; i < correlated.size(); i++) {
-    input_locs->emplace_back(json::map({{"lat", json::fp_t{correlated.Get(i).ll().lat(), 6}},
-                                        {"lon", json::fp_t{correlated.Get(i).ll().lng(), 6}}}));
+    writer.start_object();
+    writer("lat", json::fp_t{correlated.Get(i).ll().lat(), 6});
+    writer("lon", json::fp_t{correlated.Get(i).ll().lng(), 6});
+    writer.end_object();
   }
-  return input_locs;
+  writer.end_array();
 }
 
-json::ArrayPtr serialize_row(const std::vector<TimeDistance>& tds,
-                             size_t start_td,
-                             const size_t td_count,
-                             const size_t source_index,
-                             const size_t target_index,
-                             double distance_scale) {
-  auto row = json::array({});
+void serialize_row(json::Writer& writer,
+                   const std::vector<TimeDistance>& tds,
+                   size_t start_td,
+                   const size_t td_count,
+                   const size_t source_index,
+                   const size_t target_index,
+                   double distance_scale) {
+  writer.start_array();
   for (size_t i = start_td; i < start_td + td_count; ++i) {
+    writer.start_object();
+    writer("from_index", static_cast<uint64_t>(source_index));
+    writer("to_index", static_cast<uint64_t>(target_index + (i - start_td)));
     // check to make sure a route was found; if not, return null for distance & time in matrix
     // result
     if (tds[i].time != kMaxCost) {
-      row->emplace_back(json::map({{"from_index", static_cast<uint64_t>(source_index)},
-                                   {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-                                   {"time", static_cast<uint64_t>(tds[i].time)},
-                                   {"distance", json::fp_t{tds[i].dist * distance_scale, 3}}}));
+      writer("time", static_cast<uint64_t>(tds[i].time));
+      writer("distance", json::fp_t{tds[i].dist * distance_scale, 3});
     } else {
-      row->emplace_back(json::map({{"from_index", static_cast<uint64_t>(source_index)},
-                                   {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-                                   {"time", static_cast<std::nullptr_t>(nullptr)},
-                                   {"distance", static_cast<std::nullptr_t>(nullptr)}}));
+      writer("time", nullptr);
+      writer("distance", nullptr);
     }
+    writer.end_object();
   }
-  return row;
+  writer.end_array();
 }
 
-json::MapPtr serialize(const Api& request,
-                       const std::vector<TimeDistance>& time_distances,
-                       double distance_scale) {
-  json::ArrayPtr matrix = json::array({});
+// Only the pairs that were reached, as an array per item instead of an object per pair
+void serialize_sparse(json::Writer& writer,
+                      const std::vector<TimeDistance>& tds,
+                      const size_t target_count,
+                      double distance_scale) {
+  writer.start_object("sources_to_targets");
+  writer.start_array("from_index");
+  for (size_t i = 0; i < tds.size(); ++i) {
+    if (tds[i].time != kMaxCost) {
+      writer(static_cast<uint64_t>(i / target_count));
+    }
+  }
+  writer.end_array();
+  writer.start_array("to_index");
+  for (size_t i = 0; i < tds.size(); ++i) {
+    if (tds[i].time != kMaxCost) {
+      writer(static_cast<uint64_t>(i % target_count));
+    }
+  }
+  writer.end_array();
+  writer.start_array("time");
+  for (const auto& td : tds) {
+    if (td.time != kMaxCost) {
+      writer(static_cast<uint64_t>(td.time));
+    }
+  }
+  writer.end_array();
+  writer.start_array("distance");
+  for (const auto& td : tds) {
+    if (td.time != kMaxCost) {
+      writer(json::fp_t{td.dist * distance_scale, 3});
+    }
+  }
+  writer.end_array();
+  writer.end_object();
+}
+
+void serialize(json::Writer& writer,
+               const Api& request,
+               const std::vector<TimeDistance>& time_distances,
+               double distance_scale) {
   const auto& options = request.options();
-  for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
-    matrix->emplace_back(serialize_row(time_distances, source_index * options.targets_size(),
-                                       options.targets_size(), source_index, 0, distance_scale));
+  writer.start_object();
+  if (options.sparse()) {
+    serialize_sparse(writer, time_distances, options.targets_size(), distance_scale);
+  } else {
+    writer.start_array("sources_to_targets");
+    for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
+      serialize_row(writer, time_distances, source_index * options.targets_size(),
+                    options.targets_size(), source_index, 0, distance_scale);
+    }
+    writer.end_array();
   }
-  auto json = json::map({
-      {"sources_to_targets", matrix},
-      {"units", Options_Units_Enum_Name(options.units())},
-  });
-  json->emplace("targets", json::array({locations(options.targets())}));
-  json->emplace("sources", json::array({locations(options.sources())}));
+  writer("units", Options_Units_Enum_Name(options.units()));
+  writer.start_array("targets");
+  locations(writer, options.targets());
+  writer.end_array();
+  writer.start_array("sources");
+  locations(writer, options.sources());
+  writer.end_array();
 
   if (options.has_id()) {
-    json->emplace("id", options.id());
+    writer("id", options.id());
+  }
+  if (options.statistics()) {
+    writer("statistics", tyr::serializeStatistics(request));
   }
-  return json;
+  writer.end_object();
 }
 } // namespace valhalla_serializers
 
 namespace valhalla {
 namespace tyr {
 
-std::string serializeMatrix(const Api& request,
+void fillMatrix(Api& request,
+                const std::vector<TimeDistance>& time_distances,
+                double distance_scale) {
+  auto* matrix = request.mutable_matrix();
+
+  // only the pairs with a route, each with its source and target
+  if (request.options().sparse()) {
+    const size_t target_count = request.options().targets_size();
+    for (size_t i = 0; i < time_distances.size(); ++i) {
+      const auto& td = time_distances[i];
+      if (td.time != kMaxCost) {
+        matrix->add_sources(i / target_count);
+        matrix->add_targets(i % target_count);
+        matrix->add_times(td.time);
+        matrix->add_distances(static_cast<float>(td.dist * distance_scale));
+      }
+    }
+    return;
+  }
+
+  matrix->mutable_times()->Reserve(time_distances.size());
+  matrix->mutable_distances()->Reserve(time_distances.size());
+  for (const auto& td : time_distances) {
+    // check to make sure a route was found; if not, mark it as such in the matrix result
+    if (td.time != kMaxCost) {
+      matrix->add_times(td.time);
+      matrix->add_distances(static_cast<float>(td.dist * distance_scale));
+    } else {
+      matrix->add_times(std::numeric_limits<uint32_t>::max());
+      matrix->add_distances(-1.f);
+    }
+  }
+}
+
+std::string serializeMatrix(Api& request,
                             const std::vector<TimeDistance>& time_distances,
                             double distance_scale) {
+  // the caller can load the numbers without parsing any text
+  if (request.options().format() == Options::pbf) {
+    fillMatrix(request, time_distances, distance_scale);
+    return request.SerializeAsString();
+  }
 
-  auto json = request.options().format() == Options::osrm
-                  ? osrm_serializers::serialize(request, time_distances, distance_scale)
-                  : valhalla_serializers::serialize(request, time_distances, distance_scale);
-
-  std::stringstream ss;
-  ss << *json;
-  return ss.str();
+  // a row of the matrix per source, write them as we go instead of making a tree of them. the
+  // output is reserved up front at about what a pair takes so that it doesnt double while growing
+  if (request.options().format() == Options::osrm) {
+    json::Writer writer(time_distances.size() * kOsrmPairSize + 1024);
+    osrm_serializers::serialize(writer, request, time_distances, distance_scale);
+    return writer.release();
+  }
+  json::Writer writer(time_distances.size() * kValhallaPairSize + 1024);
+  valhalla_serializers::serialize(writer, request, time_distances, distance_scale);
+  return writer.release();
 }
 
 } // namespace tyr
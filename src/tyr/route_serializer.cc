@@ -31,7 +31,7 @@ namespace {
  */
 std::string pathToGPX(const google::protobuf::RepeatedPtrField<TripLeg>& legs) {
   // start the gpx, we'll use 6 digits of precision
-  std::stringstream gpx;
+  pooled_ostream gpx;
   gpx << std::setprecision(6) << std::fixed;
   gpx << R"(<?xml version="1.0" encoding="UTF-8" standalone="no"?><gpx version="1.1" creator="libvalhalla"><metadata/>)";
 
@@ -85,6 +85,8 @@ std::string serializeDirections(Api& request) {
       return pathToGPX(request.trip().routes(0).legs());
     case Options_Format_json:
       return valhalla_serializers::serialize(request);
+    case Options_Format_pbf:
+      return request.SerializeAsString();
     default:
       throw;
   }
@@ -1,3 +1,4 @@
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -1033,26 +1034,72 @@ json::MapPtr osrm_maneuver(const valhalla::DirectionsLeg::Maneuver& maneuver,
   return osrm_man;
 }
 
+// The shape of a leg polyline encoded once, along with where each point starts in the encoding,
+// so that the geometry of each step can be cut out of it instead of being encoded all over again
+struct encoded_leg_shape_t {
+  std::string encoded;
+  // offset of the first character of each point, plus one past the end of the last point
+  std::vector<uint32_t> offsets;
+  // each point shifted to the precision and truncated, lat then lon like the encoding
+  std::vector<std::pair<int32_t, int32_t>> fixed;
+
+  encoded_leg_shape_t(const std::vector<PointLL>& shape, const int precision) {
+    encoded.reserve(shape.size() * 8);
+    offsets.reserve(shape.size() + 1);
+    fixed.reserve(shape.size());
+    auto out = std::back_inserter(encoded);
+    int32_t last_lat = 0, last_lon = 0;
+    for (const auto& p : shape) {
+      int32_t lon = static_cast<int32_t>(floor(static_cast<double>(p.first) * precision));
+      int32_t lat = static_cast<int32_t>(floor(static_cast<double>(p.second) * precision));
+      offsets.push_back(encoded.size());
+      fixed.emplace_back(lat, lon);
+      out = midgard::encode_number(lat - last_lat, out);
+      out = midgard::encode_number(lon - last_lon, out);
+      last_lat = lat;
+      last_lon = lon;
+    }
+    offsets.push_back(encoded.size());
+  }
+
+  // The encoding of the points [begin_idx, end_idx]. The first point has to be written again as
+  // an offset from 0 but every point after it is the same offset as in the leg so is just copied
+  std::string slice(const uint32_t begin_idx, const uint32_t end_idx, bool repeat_last) const {
+    std::string sliced;
+    sliced.reserve(offsets[end_idx + 1] - offsets[begin_idx] + 16);
+    auto out = std::back_inserter(sliced);
+    out = midgard::encode_number(fixed[begin_idx].first, out);
+    out = midgard::encode_number(fixed[begin_idx].second, out);
+    sliced.append(encoded, offsets[begin_idx + 1], offsets[end_idx + 1] - offsets[begin_idx + 1]);
+    // the point repeated at the end of the arrive step is always the last point of the leg
+    if (repeat_last) {
+      out = midgard::encode_number(fixed.back().first - fixed[end_idx].first, out);
+      out = midgard::encode_number(fixed.back().second - fixed[end_idx].second, out);
+    }
+    return sliced;
+  }
+};
+
 // Method to get the geometry string for a maneuver.
 void maneuver_geometry(json::MapPtr& step,
                        const uint32_t begin_idx,
                        const uint32_t end_idx,
                        const std::vector<PointLL>& shape,
-                       bool is_arrive_maneuver,
-                       const valhalla::Options& options) {
+                       const encoded_leg_shape_t* encoded_shape,
+                       bool is_arrive_maneuver) {
+  // Polylines are cut straight out of the encoded leg
+  if (encoded_shape) {
+    step->emplace("geometry", encoded_shape->slice(begin_idx, end_idx, is_arrive_maneuver));
+    return;
+  }
+
   // Must add one to the end range since maneuver end shape index is exclusive
   std::vector<PointLL> maneuver_shape(shape.begin() + begin_idx, shape.begin() + end_idx + 1);
   // Last maneuver shape is a linestring with two identical points at the destination
   if (is_arrive_maneuver) {
     maneuver_shape.push_back(shape.back());
   }
-
-  if (options.shape_format() == geojson) {
-    step->emplace("geometry", geojson_shape(maneuver_shape));
-  } else {
-    int precision = options.shape_format() == polyline6 ? 1e6 : 1e5;
-    step->emplace("geometry", midgard::encode(maneuver_shape, precision));
-  }
+  step->emplace("geometry", geojson_shape(maneuver_shape));
 }
 
 // Get the mode
@@ -1189,6 +1236,12 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
     // Get the full shape for the leg. We want to use this for serializing
     // encoded shape for each step (maneuver) in OSRM output.
     auto shape = midgard::decode<std::vector<PointLL>>(leg->shape());
+    // Encode it once at the requested precision, each step is then a slice of the encoding
+    std::unique_ptr<encoded_leg_shape_t> encoded_shape;
+    if (options.shape_format() != geojson) {
+      encoded_shape.reset(
+          new encoded_leg_shape_t(shape, options.shape_format() == polyline6 ? 1e6 : 1e5));
+    }
 
     //#########################################################################
     // Iterate through maneuvers - convert to OSRM steps
@@ -1215,7 +1268,7 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
 
       // Add geometry for this maneuver
       maneuver_geometry(step, maneuver.begin_shape_index(), maneuver.end_shape_index(), shape,
-                        arrive_maneuver, options);
+                        encoded_shape.get(), arrive_maneuver);
 
       // Add mode, driving side, weight, distance, duration, name
       float distance = maneuver.length() * (imperial ? 1609.34f : 1000.0f);
@@ -1370,7 +1423,7 @@ std::string serialize(valhalla::Api& api) {
   // Routes are called matchings in osrm map matching mode
   json->emplace(options.action() == valhalla::Options::trace_route ? "matchings" : "routes", routes);
 
-  std::stringstream ss;
+  pooled_ostream ss;
   ss << *json;
   return ss.str();
 }
@@ -574,6 +574,9 @@ std::string serialize(const Api& api) {
   if (api.options().has_id()) {
     json->emplace("id", api.options().id());
   }
+  if (api.options().statistics()) {
+    json->emplace("statistics", tyr::serializeStatistics(api));
+  }
 
   std::stringstream ss;
   ss << *json;
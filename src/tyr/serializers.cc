@@ -116,3 +116,25 @@ json::ArrayPtr waypoints(const valhalla::Trip& trip) {
 }
 
 } // namespace osrm
+
+namespace valhalla {
+namespace tyr {
+
+json::ArrayPtr serializeStatistics(const Api& request) {
+  auto statistics = json::array({});
+  for (const auto& search : request.statistics()) {
+    statistics->emplace_back(json::map({
+        {"algorithm", search.algorithm()},
+        {"labels_added", search.labels_added()},
+        {"labels_decreased", search.labels_decreased()},
+        {"labels_settled", search.labels_settled()},
+        {"queue_rebuilds", search.queue_rebuilds()},
+        {"tiles_fetched", search.tiles_fetched()},
+        {"tiles_missed", search.tiles_missed()},
+    }));
+  }
+  return statistics;
+}
+
+} // namespace tyr
+} // namespace valhalla
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdint>
 
 #include "baldr/json.h"
@@ -20,6 +21,9 @@ constexpr size_t kRawScoreIndex = 1;
 constexpr size_t kMatchResultsIndex = 2;
 constexpr size_t kTripLegIndex = 3;
 
+// About how many bytes a value of a column takes in the json
+constexpr size_t kColumnValueSize = 8;
+
 json::ArrayPtr serialize_admins(const TripLeg& trip_path) {
   auto admin_array = json::array({});
   for (const auto& admin : trip_path.admin()) {
@@ -116,6 +120,14 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
         }
         edge_map->emplace("mean_elevation", static_cast<int64_t>(mean));
       }
+      if (edge.elevation_size() > 0) {
+        auto elevation = json::array({});
+        bool feet = options.has_units() && options.units() == Options::miles;
+        for (auto e : edge.elevation()) {
+          elevation->push_back(json::fp_t{feet ? e * kFeetPerMeter : e, 1});
+        }
+        edge_map->emplace("elevation", elevation);
+      }
       if (edge.has_way_id()) {
         edge_map->emplace("way_id", static_cast<uint64_t>(edge.way_id()));
       }
@@ -432,6 +444,108 @@ json::MapPtr serialize_shape_attributes(const AttributesController& controller,
   return attributes_map;
 }
 
+// Write a column of values, a column of an attribute that was not asked for is empty and left out
+template <class Values, class Convert>
+void write_column(json::Writer& writer,
+                  const std::string& key,
+                  const Values& values,
+                  const Convert& convert) {
+  if (values.empty()) {
+    return;
+  }
+  writer.start_array(key);
+  for (const auto& value : values) {
+    writer(convert(value));
+  }
+  writer.end_array();
+}
+
+void write_columns(json::Writer& writer,
+                   const AttributesController& controller,
+                   const TraceAttributes& columns) {
+  if (controller.attributes.at(kConfidenceScore)) {
+    writer("confidence_score", json::fp_t{columns.confidence_score(), 3});
+  }
+  if (controller.attributes.at(kRawScore)) {
+    writer("raw_score", json::fp_t{columns.raw_score(), 3});
+  }
+
+  auto number = [](uint64_t value) { return value; };
+  auto flag = [](bool value) { return value; };
+  writer.start_object("edges");
+  write_column(writer, "id", columns.ids(), number);
+  write_column(writer, "way_id", columns.way_ids(), number);
+  write_column(writer, "length", columns.lengths(),
+               [](float value) { return json::fp_t{value, 3}; });
+  write_column(writer, "speed", columns.speeds(), number);
+  write_column(writer, "road_class", columns.road_classes(),
+               [](uint32_t value) { return to_string(static_cast<baldr::RoadClass>(value)); });
+  write_column(writer, "use", columns.uses(),
+               [](uint32_t value) { return to_string(static_cast<baldr::Use>(value)); });
+  write_column(writer, "surface", columns.surfaces(),
+               [](uint32_t value) { return to_string(static_cast<baldr::Surface>(value)); });
+  write_column(writer, "speed_limit", columns.speed_limits(), number);
+  write_column(writer, "lane_count", columns.lane_counts(), number);
+  write_column(writer, "density", columns.densities(), number);
+  write_column(writer, "toll", columns.tolls(), flag);
+  write_column(writer, "tunnel", columns.tunnels(), flag);
+  write_column(writer, "bridge", columns.bridges(), flag);
+  write_column(writer, "roundabout", columns.roundabouts(), flag);
+  writer.end_object();
+}
+
+// The edges of each path as a column per attribute, thor filled them out instead of trip paths
+std::string serialize_columns(
+    Api& request,
+    const AttributesController& controller,
+    const std::vector<std::tuple<float, float, std::vector<thor::MatchResult>>>& results) {
+  int paths = std::min<int>(results.size(), request.trace_attributes_size());
+  for (int i = 0; i < paths; ++i) {
+    auto* columns = request.mutable_trace_attributes(i);
+    columns->set_confidence_score(std::get<kConfidenceScoreIndex>(results[i]));
+    columns->set_raw_score(std::get<kRawScoreIndex>(results[i]));
+  }
+
+  // the caller can load the columns without parsing any text
+  if (request.options().format() == Options::pbf) {
+    return request.SerializeAsString();
+  }
+
+  size_t values = 0;
+  for (const auto& columns : request.trace_attributes()) {
+    values += columns.ids_size() + columns.way_ids_size() + columns.lengths_size() +
+              columns.speeds_size() + columns.road_classes_size() + columns.uses_size() +
+              columns.surfaces_size() + columns.speed_limits_size() + columns.lane_counts_size() +
+              columns.densities_size() + columns.tolls_size() + columns.tunnels_size() +
+              columns.bridges_size() + columns.roundabouts_size();
+  }
+  json::Writer writer(values * kColumnValueSize + 1024);
+  writer.start_object();
+  if (request.options().has_id()) {
+    writer("id", request.options().id());
+  }
+  if (request.options().statistics()) {
+    writer("statistics", serializeStatistics(request));
+  }
+  if (request.options().has_units()) {
+    writer("units", valhalla::Options_Units_Enum_Name(request.options().units()));
+  }
+
+  // the best path and then the alternates like the edges of trip paths
+  writer.start_array("alternate_paths");
+  for (int i = 1; i < request.trace_attributes_size(); ++i) {
+    writer.start_object();
+    write_columns(writer, controller, request.trace_attributes(i));
+    writer.end_object();
+  }
+  writer.end_array();
+  if (request.trace_attributes_size() > 0) {
+    write_columns(writer, controller, request.trace_attributes(0));
+  }
+  writer.end_object();
+  return writer.release();
+}
+
 void append_trace_info(
     const json::MapPtr& json,
     const AttributesController& controller,
@@ -486,9 +600,13 @@ namespace valhalla {
 namespace tyr {
 
 std::string serializeTraceAttributes(
-    const Api& request,
+    Api& request,
     const AttributesController& controller,
     std::vector<std::tuple<float, float, std::vector<thor::MatchResult>>>& map_match_results) {
+  // Thor filled out the columns of the edges without making trip paths
+  if (request.options().columnar()) {
+    return serialize_columns(request, controller, map_match_results);
+  }
 
   // Create json map to return
   auto json = json::map({});
@@ -498,6 +616,11 @@ std::string serializeTraceAttributes(
     json->emplace("id", request.options().id());
   }
 
+  // Add the work of the map matching, if asked for
+  if (request.options().statistics()) {
+    json->emplace("statistics", serializeStatistics(request));
+  }
+
   // Add units, if specified
   if (request.options().has_units()) {
     json->emplace("units", valhalla::Options_Units_Enum_Name(request.options().units()));
@@ -1,4 +1,6 @@
 #include "baldr/rapidjson_utils.h"
+#include <algorithm>
+#include <atomic>
 #include <boost/format.hpp>
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
@@ -8,6 +10,7 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -37,12 +40,14 @@ int main(int argc, char* argv[]) {
       "\n");
 
   std::string minll, maxll, config;
+  unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
   options.add_options()("help,h", "Print this help message.")("version,v",
                                                               "Print the version of this software.")(
       "min,n", boost::program_options::value<std::string>(&minll),
       "minll: lat,lng")("max,x", boost::program_options::value<std::string>(&maxll), "maxll: lat,lng")
       // positional arguments
-      ("config,c", bpo::value<std::string>(&config), "Valhalla configuration file");
+      ("config,c", bpo::value<std::string>(&config), "Valhalla configuration file")(
+          "concurrency,j", bpo::value<unsigned int>(&num_threads), "Number of threads to use.");
 
   bpo::positional_options_description pos_options;
   pos_options.add("config", 1);
@@ -105,17 +110,33 @@ int main(int argc, char* argv[]) {
   auto tiles = tile_hierarchy.levels().rbegin()->second.tiles;
   std::vector<int32_t> tilelist = tiles.TileList(bb);
 
-  // Find unconnected way ids within the tiles
-  std::set<uint64_t> wayids;
-  for (auto local_tile : tilelist) {
-    GraphId tile_id(local_tile, local_level, 0);
-    const GraphTile* tile = reader.GetGraphTile(tile_id);
-    const DirectedEdge* de = tile->directededge(0);
-    for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, de++) {
-      if (de->unreachable()) {
-        wayids.insert(tile->edgeinfo(de->edgeinfo_offset())->wayid());
+  // Find unconnected way ids within the tiles. Each thread reads the tiles it takes with a reader
+  // of its own and keeps the ways it finds to itself until they are merged at the end
+  std::atomic<size_t> next(0);
+  std::vector<std::set<uint64_t>> thread_wayids(std::max(1u, num_threads));
+  std::vector<std::thread> threads(thread_wayids.size());
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i] = std::thread([&, i]() {
+      valhalla::baldr::GraphReader reader(pt.get_child("mjolnir.hierarchy"));
+      for (size_t t = next++; t < tilelist.size(); t = next++) {
+        GraphId tile_id(tilelist[t], local_level, 0);
+        const GraphTile* tile = reader.GetGraphTile(tile_id);
+        const DirectedEdge* de = tile->directededge(0);
+        for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, de++) {
+          if (de->unreachable()) {
+            thread_wayids[i].insert(tile->edgeinfo(de->edgeinfo_offset())->wayid());
+          }
+        }
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
       }
-    }
+    });
+  }
+  std::set<uint64_t> wayids;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+    wayids.insert(thread_wayids[i].begin(), thread_wayids[i].end());
   }
 
   // Log the list of unreachable ways
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <deque>
+#include <functional>
 #include <future>
 #include <mutex>
 #include <thread>
@@ -156,13 +157,13 @@ struct edge_association {
 
   // Get the "leftovers" - these are edge-segment associations where the
   // edges are not in the same tile as the OSMLR segment.
-  const leftovers_t& leftovers() const {
+  leftovers_t& leftovers() {
     return m_leftover_associations;
   }
 
   // Get the chunks. These are edges that associate to more than 1 OSMLR
   // segment.
-  const chunk_t& chunks() const {
+  chunk_t& chunks() {
     return traffic_chunks;
   }
 
@@ -180,6 +181,7 @@ struct edge_association {
   }
 
 private:
+  void search_lrps(const pbf::Tile& tile, const uint8_t level);
   std::vector<CandidateEdge>
   candidate_edges(bool origin, const pbf::Segment::LocationReference& lrp, const uint8_t level);
   bool match_segment(vb::GraphId segment_id, const pbf::Segment& segment, MatchType& match_type);
@@ -193,11 +195,15 @@ private:
   vm::PointLL lookup_start_coord(const vb::GraphId& edge_id);
 
   vb::GraphReader m_reader;
+  vl::node_search_t m_node_search;
   vs::TravelMode m_travel_mode;
   std::shared_ptr<vt::AStarPathAlgorithm> m_path_algo;
   std::shared_ptr<vs::DynamicCost> m_costing;
   std::shared_ptr<vj::GraphTileBuilder> m_tile_builder;
 
+  // Edges near the first and last location references of the segments in the current tile
+  std::unordered_map<vb::Location, vb::PathLocation> m_lrp_edges;
+
   // Statistics
   std::unordered_map<uint32_t, uint32_t> success_count_;
   std::unordered_map<uint32_t, uint32_t> failure_count_;
@@ -356,12 +362,16 @@ vb::Location location_for_lrp(const pbf::Segment::LocationReference& lrp) {
   return location;
 }
 
-vo::Location loki_search_single(const vb::Location& loc, vb::GraphReader& reader, uint8_t level) {
-  // we dont want non real edges but also we want the edges to be on the right level
-  // also right now only driveable edges please
-  auto edge_filter = [level](const DirectedEdge* edge) -> float {
+// we dont want non real edges but also we want the edges to be on the right level
+// also right now only driveable edges please
+std::function<float(const DirectedEdge*)> level_edge_filter(const uint8_t level) {
+  return [level](const DirectedEdge* edge) -> float {
     return (edge->endnode().level() == level && allow_edge_pred(edge)) ? 1.0f : 0.0f;
   };
+}
+
+vo::Location loki_search_single(const vb::Location& loc, vb::GraphReader& reader, uint8_t level) {
+  auto edge_filter = level_edge_filter(level);
 
   // we only have one location so we only get one result
   std::vector<vb::Location> locs{loc};
@@ -399,22 +409,21 @@ private:
 // Find nodes on the specified level that are within a specified distance
 // from the lat,lon location
 std::vector<vb::GraphId>
-find_nearby_nodes(vb::GraphReader& reader, const vm::PointLL& pt, const uint8_t level) {
+find_nearby_nodes(vl::node_search_t& search, const vm::PointLL& pt, const uint8_t level) {
   // Create a bounding box and find nodes within the bounding box
   float meters_per_lng = vm::DistanceApproximator::MetersPerLngDegree(pt.lat());
   float delta_lng = kNodeDistanceTolerance / meters_per_lng;
   float delta_lat = kNodeDistanceTolerance / vm::kMetersPerDegreeLat;
   vm::AABB2<vm::PointLL> bbox({pt.lng() - delta_lng, pt.lat() - delta_lat},
                               {pt.lng() + delta_lng, pt.lat() + delta_lat});
-  auto nodes = vl::nodes_in_bbox(bbox, reader);
 
-  // Remove nodes that are not on the specified level
+  // Keep the nodes that are on the specified level
   std::vector<vb::GraphId> level_nodes;
-  for (const auto node : nodes) {
+  search.visit(bbox, [&level_nodes, level](const vb::GraphId& node) {
     if (node.level() == level) {
       level_nodes.emplace_back(node);
     }
-  }
+  });
   return level_nodes;
 }
 
@@ -496,8 +505,30 @@ vb::GraphId next_edge(const GraphId& edge_id,
 
 // Edge association constructor
 edge_association::edge_association(const bpt::ptree& pt)
-    : m_reader(pt.get_child("mjolnir")), m_travel_mode(vs::TravelMode::kDrive),
-      m_path_algo(new vt::AStarPathAlgorithm()), m_costing(new DistanceOnlyCost(m_travel_mode)) {
+    : m_reader(pt.get_child("mjolnir")), m_node_search(m_reader),
+      m_travel_mode(vs::TravelMode::kDrive), m_path_algo(new vt::AStarPathAlgorithm()),
+      m_costing(new DistanceOnlyCost(m_travel_mode)) {
+}
+
+// Find the edges near the first and last location references of the segments in a tile that
+// are not at nodes. One search over all of them shares the bins and tiles they have in common
+// instead of going through them again for every location.
+void edge_association::search_lrps(const pbf::Tile& tile, const uint8_t level) {
+  std::vector<vb::Location> locations;
+  for (const auto& entry : tile.entries()) {
+    if (entry.has_marker()) {
+      continue;
+    }
+    const auto& segment = entry.segment();
+    for (int i : {0, segment.lrps_size() - 1}) {
+      if (!segment.lrps(i).at_node()) {
+        locations.emplace_back(coord_for_lrp(segment.lrps(i)));
+        locations.back().radius_ = kEdgeDistanceTolerance;
+      }
+    }
+  }
+  m_lrp_edges =
+      vl::Search(locations, m_reader, level_edge_filter(level), vl::PassThroughNodeFilter);
 }
 
 // Get a list of candidate edges for the location.
@@ -509,15 +540,17 @@ edge_association::candidate_edges(bool origin,
   std::vector<CandidateEdge> edges;
   if (lrp.at_node()) {
     // Find nearby nodes and get allowed edges
-    auto nodes = find_nearby_nodes(m_reader, ll, level);
+    auto nodes = find_nearby_nodes(m_node_search, ll, level);
     edges = GetEdgesFromNodes(m_reader, nodes, ll, origin);
   } else {
-    // Use edge search with loki
-    auto loc = loki_search_single(vb::Location(ll), m_reader, level);
-    for (const auto& edge : loc.path_edges()) {
-      PathLocation::PathEdge e(GraphId(edge.graph_id()), edge.percent_along(),
-                               PointLL{edge.ll().lng(), edge.ll().lat()}, edge.distance());
-      edges.emplace_back(std::move(e), 0.0f); // TODO??
+    // Use the edges loki found for the tile
+    vb::Location location(ll);
+    location.radius_ = kEdgeDistanceTolerance;
+    auto found = m_lrp_edges.find(location);
+    if (found != m_lrp_edges.end()) {
+      for (const auto& edge : found->second.edges) {
+        edges.emplace_back(edge, 0.0f); // TODO??
+      }
     }
     if (origin) {
       // Remove inbound edges to an origin node
@@ -822,6 +855,9 @@ void edge_association::add_tile(const std::string& file_name) {
     }
   }
 
+  // Find the edges near the location references all at once
+  search_lrps(tile, base_id.level());
+
   // Get a tile builder ready for this tile
   m_tile_builder.reset(new vj::GraphTileBuilder(m_reader.tile_dir(), base_id, false));
   m_tile_builder->InitializeTrafficSegments();
@@ -848,9 +884,12 @@ void edge_association::add_tile(const std::string& file_name) {
     entry_id += 1;
   }
 
-  // Finish this tile
+  // Finish this tile. Its neighbours are kept in the cache for the next tiles unless it is full
   m_tile_builder->UpdateTrafficSegments(false);
-  m_reader.Clear();
+  m_lrp_edges.clear();
+  if (m_reader.OverCommitted()) {
+    m_reader.Trim();
+  }
 }
 
 // Add OSMLR segment associations to each tile in the list. Any "local"
@@ -1069,25 +1108,20 @@ int main(int argc, char** argv) {
       path_count[x.first] += x.second;
     }
 
-    // Leftovers
-    for (const auto& association : associations.leftovers()) {
-      auto leftover = leftovers.insert({association.first.Tile_Base(), {}}).first;
-      leftover->second.push_back(association);
-    }
+    // Leftovers, moved by tile so there is only ever one copy of them
     leftover_count += associations.leftovers().size();
+    for (auto& association : associations.leftovers()) {
+      leftovers[association.first.Tile_Base()].emplace_back(std::move(association));
+    }
+    leftovers_t().swap(associations.leftovers());
 
     // Temporary chunks
-    using single_chunk_t = std::pair<vb::GraphId, std::vector<vb::TrafficChunk>>;
-    for (const auto& association : associations.chunks()) {
-      vb::GraphId tileid = association.first.Tile_Base();
-      single_chunk_t c = std::make_pair(association.first, association.second);
-      if (chunks.find(tileid) == chunks.end()) {
-        chunks[tileid] = {c};
-      } else {
-        chunks[tileid].push_back(c);
-      }
-    }
     chunk_count += associations.chunks().size();
+    for (auto& association : associations.chunks()) {
+      chunks[association.first.Tile_Base()].emplace_back(association.first,
+                                                         std::move(association.second));
+    }
+    chunk_t().swap(associations.chunks());
   }
 
   for (const auto& x : success_count) {
@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "loki/worker.h"
+#include "midgard/logging.h"
+#include "odin/worker.h"
+#include "thor/worker.h"
+#include "tyr/serializers.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+using namespace valhalla::odin;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// the stages a request goes through in process, the same ones tyr::actor_t runs
+enum stage_t { kParse, kLoki, kThor, kOdin, kSerialize, kStageCount };
+const char* kStageNames[kStageCount] = {"parse", "loki", "thor", "odin", "serialize"};
+
+struct request_t {
+  Options::Action action;
+  std::string json;
+};
+
+struct sample_t {
+  Options::Action action;
+  bool ok;
+  double latency;             // seconds from when the request was due to when it was answered
+  double stages[kStageCount]; // seconds spent in each stage
+};
+
+// A line is a json request, optionally preceded by the action it is for, or a line of the files in
+// test_requests which wrap the json like: -j '{...}'
+bool parse_line(std::string line, Options::Action default_action, request_t& request) {
+  request.action = default_action;
+  auto json = line.find('{');
+  if (json == std::string::npos) {
+    return false;
+  }
+  auto prefix = line.substr(0, json);
+  auto ignored = [](char c) { return std::isspace(static_cast<unsigned char>(c)) || c == '\''; };
+  prefix.erase(std::remove_if(prefix.begin(), prefix.end(), ignored), prefix.end());
+  if (!prefix.empty() && prefix != "-j" && !Options_Action_Enum_Parse(prefix, &request.action)) {
+    return false;
+  }
+  auto end = line.find_last_of('}');
+  request.json = line.substr(json, end - json + 1);
+  return true;
+}
+
+// the workers of one thread, with a reader of their own
+struct stages_t {
+  stages_t(const boost::property_tree::ptree& config)
+      : reader(std::make_shared<GraphReader>(config.get_child("mjolnir"))), loki(config, reader),
+        thor(config, reader), odin(config) {
+  }
+
+  // runs the request through the stages of its action like tyr::actor_t::act does
+  void run(const request_t& request, sample_t& sample) {
+    using clock = std::chrono::steady_clock;
+    auto last = clock::now();
+    auto lap = [&last, &sample](stage_t stage) {
+      auto now = clock::now();
+      sample.stages[stage] += std::chrono::duration<double>(now - last).count();
+      last = now;
+    };
+    Api api;
+    ParseApi(request.json, request.action, api);
+    lap(kParse);
+    std::string response;
+    switch (request.action) {
+      case Options::route:
+        loki.route(api);
+        lap(kLoki);
+        thor.route(api);
+        lap(kThor);
+        odin.narrate(api);
+        lap(kOdin);
+        response = tyr::serializeDirections(api);
+        lap(kSerialize);
+        break;
+      case Options::locate:
+        response = loki.locate(api);
+        lap(kLoki);
+        break;
+      case Options::sources_to_targets:
+        loki.matrix(api);
+        lap(kLoki);
+        response = thor.matrix(api);
+        lap(kThor);
+        break;
+      case Options::optimized_route:
+        loki.matrix(api);
+        lap(kLoki);
+        thor.optimized_route(api);
+        lap(kThor);
+        odin.narrate(api);
+        lap(kOdin);
+        response = tyr::serializeDirections(api);
+        lap(kSerialize);
+        break;
+      case Options::isochrone:
+        loki.isochrones(api);
+        lap(kLoki);
+        response = thor.isochrones(api);
+        lap(kThor);
+        break;
+      case Options::trace_route:
+        loki.trace(api);
+        lap(kLoki);
+        thor.trace_route(api);
+        lap(kThor);
+        odin.narrate(api);
+        lap(kOdin);
+        response = tyr::serializeDirections(api);
+        lap(kSerialize);
+        break;
+      case Options::trace_attributes:
+        loki.trace(api);
+        lap(kLoki);
+        response = thor.trace_attributes(api);
+        lap(kThor);
+        break;
+      default:
+        throw valhalla_exception_t{107};
+    }
+  }
+
+  void cleanup() {
+    loki.cleanup();
+    thor.cleanup();
+    odin.cleanup();
+  }
+
+  std::shared_ptr<GraphReader> reader;
+  loki_worker_t loki;
+  thor_worker_t thor;
+  odin_worker_t odin;
+};
+
+double percentile(std::vector<double>& values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t index = std::ceil(p * values.size());
+  std::nth_element(values.begin(), values.begin() + std::max<size_t>(index, 1) - 1, values.end());
+  return values[std::max<size_t>(index, 1) - 1];
+}
+
+void report(const std::string& name, const std::vector<const sample_t*>& samples) {
+  std::vector<double> latencies;
+  size_t errors = 0;
+  double stages[kStageCount] = {};
+  for (const auto* sample : samples) {
+    if (!sample->ok) {
+      ++errors;
+      continue;
+    }
+    latencies.push_back(sample->latency);
+    for (int stage = 0; stage < kStageCount; ++stage) {
+      stages[stage] += sample->stages[stage];
+    }
+  }
+  double ok = std::max<double>(latencies.size(), 1);
+  std::cout << std::left << std::setw(20) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(9) << samples.size() << std::setw(8) << errors
+            << std::setw(10) << percentile(latencies, 0.5) * 1000 << std::setw(10)
+            << percentile(latencies, 0.9) * 1000 << std::setw(10)
+            << percentile(latencies, 0.99) * 1000 << std::setw(10)
+            << percentile(latencies, 1.0) * 1000;
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    std::cout << std::setw(11) << stages[stage] / ok * 1000;
+  }
+  std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  std::string config_file, action_name, cache;
+  std::vector<std::string> request_files;
+  size_t threads, passes, warmup;
+  double rate;
+
+  bpo::options_description options(
+      "valhalla_benchmark_service " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_benchmark_service [options] <request_file>...\n"
+      "\n"
+      "valhalla_benchmark_service replays recorded requests through loki, thor and odin in "
+      "process on many threads, each with its own workers, and reports throughput, latency "
+      "percentiles and the time spent in each stage per action. A request file has a request "
+      "per line, either the json alone, the json preceded by its action (e.g. route or "
+      "sources_to_targets) or the -j '<json>' lines of test_requests. Requests are replayed in "
+      "the order of the files. With a rate they are due at fixed intervals and latency is "
+      "counted from when they were due, so it includes the time they waited for a free thread."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")(
+      "version,v", "Print the version of this software.")(
+      "config,c", bpo::value<std::string>(&config_file)->required(),
+      "Path to the json configuration file.")(
+      "action,a", bpo::value<std::string>(&action_name)->default_value("route"),
+      "Action of the requests that do not say which they are for.")(
+      "threads,t",
+      bpo::value<size_t>(&threads)->default_value(
+          std::max(static_cast<size_t>(std::thread::hardware_concurrency()), size_t(1))),
+      "How many threads replay requests at the same time.")(
+      "rate,r", bpo::value<double>(&rate)->default_value(0),
+      "Requests per second to replay at, 0 replays them as fast as the threads can.")(
+      "passes,p", bpo::value<size_t>(&passes)->default_value(1),
+      "How many times to replay all of the requests.")(
+      "warmup,w", bpo::value<size_t>(&warmup)->default_value(0),
+      "How many requests to replay before measuring, to fill the caches.")(
+      "cache", bpo::value<std::string>(&cache)->default_value("per-thread"),
+      "Tile cache of the readers of the threads, either per-thread, synchronized (one cache "
+      "shared behind a lock, mjolnir.global_synchronized_cache) or sharded (one cache shared in "
+      "shards, mjolnir.use_sharded_tile_cache).")(
+      "request_files", bpo::value<std::vector<std::string>>(&request_files)->multitoken(),
+      "Files of requests to replay.");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("request_files", -1);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+    if (vm.count("help")) {
+      std::cout << options << "\n";
+      return EXIT_SUCCESS;
+    }
+    if (vm.count("version")) {
+      std::cout << "valhalla_benchmark_service " << VALHALLA_VERSION << "\n";
+      return EXIT_SUCCESS;
+    }
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  Options::Action default_action;
+  if (!Options_Action_Enum_Parse(action_name, &default_action)) {
+    std::cerr << "Unknown action: " << action_name << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (request_files.empty() || threads == 0 || passes == 0) {
+    std::cout << options << "\n";
+    return EXIT_FAILURE;
+  }
+
+  boost::property_tree::ptree config;
+  rapidjson::read_json(config_file.c_str(), config);
+  if (cache == "synchronized") {
+    config.put("mjolnir.global_synchronized_cache", true);
+  } else if (cache == "sharded") {
+    config.put("mjolnir.use_sharded_tile_cache", true);
+  } else if (cache != "per-thread") {
+    std::cerr << "Unknown cache: " << cache << std::endl;
+    return EXIT_FAILURE;
+  }
+  logging::Configure({{"type", ""}});
+
+  // the requests in the order they will be replayed
+  std::vector<request_t> requests;
+  for (const auto& file_name : request_files) {
+    std::ifstream file(file_name);
+    if (!file) {
+      std::cerr << "Unable to open request file: " << file_name << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      request_t request;
+      if (parse_line(line, default_action, request)) {
+        requests.push_back(std::move(request));
+      }
+    }
+  }
+  if (requests.empty()) {
+    std::cerr << "No requests to replay" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // the workers take a while to make so make them all before starting the clock
+  std::vector<std::unique_ptr<stages_t>> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    workers.emplace_back(new stages_t(config));
+  }
+
+  // every thread takes the next request due until there are none left
+  auto run = [&](size_t total, std::vector<sample_t>& samples) {
+    std::atomic<size_t> next(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (auto& worker : workers) {
+      pool.emplace_back([&, total, &stages = *worker]() {
+        for (size_t i = next++; i < total; i = next++) {
+          auto due = start;
+          if (rate > 0) {
+            due += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(i / rate));
+            std::this_thread::sleep_until(due);
+          } else {
+            due = std::chrono::steady_clock::now();
+          }
+          const auto& request = requests[i % requests.size()];
+          auto& sample = samples[i];
+          sample = sample_t{request.action, true, 0, {}};
+          try {
+            stages.run(request, sample);
+          } catch (...) { sample.ok = false; }
+          stages.cleanup();
+          sample.latency =
+              std::chrono::duration<double>(std::chrono::steady_clock::now() - due).count();
+        }
+      });
+    }
+    for (auto& thread : pool) {
+      thread.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  std::vector<sample_t> samples(warmup);
+  run(warmup, samples);
+  samples.resize(requests.size() * passes);
+  double elapsed = run(samples.size(), samples);
+
+  // overall and per action
+  std::map<std::string, std::vector<const sample_t*>> actions;
+  std::vector<const sample_t*> all;
+  for (const auto& sample : samples) {
+    actions[Options_Action_Enum_Name(sample.action)].push_back(&sample);
+    all.push_back(&sample);
+  }
+  std::cout << std::fixed << std::setprecision(2) << samples.size() << " requests on " << threads
+            << " threads with a " << cache << " cache in " << elapsed << "s: "
+            << samples.size() / elapsed << " requests per second" << std::endl;
+  std::cout << std::left << std::setw(20) << "action" << std::right << std::setw(9) << "requests"
+            << std::setw(8) << "errors" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms"
+            << std::setw(10) << "p99 ms" << std::setw(10) << "max ms";
+  for (const auto* stage : kStageNames) {
+    std::cout << std::setw(11) << (std::string(stage) + " ms");
+  }
+  std::cout << std::endl;
+  for (const auto& action : actions) {
+    report(action.first, action.second);
+  }
+  if (actions.size() > 1) {
+    report("all", all);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "config.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "loki/worker.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "thor/astar.h"
+#include "thor/bidirectional_astar.h"
+#include "thor/costmatrix.h"
+#include "thor/isochrone.h"
+#include "thor/timedep.h"
+#include "thor/timedistancematrix.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+// Every allocation of the program is counted so we can see how many a search makes
+namespace {
+std::atomic<uint64_t> allocations(0);
+}
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+// Same limits as the tests use for the utrecht tiles, only the tile_dir is set on the command line
+const auto kConfig = R"({
+    "mjolnir":{"concurrency": 1},
+    "loki":{
+      "actions":["route","sources_to_targets","isochrone"],
+      "logging":{"long_request": 100},
+      "service_defaults":{"minimum_reachability": 50,"radius": 0,"search_cutoff": 35000, "node_snap_tolerance": 5, "street_side_tolerance": 5, "heading_tolerance": 60}
+    },
+    "service_limits": {
+      "auto": {"max_distance": 5000000.0, "max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 1,"max_time": 120},
+      "max_avoid_locations": 50,"max_radius": 200,"max_reachability": 100,"max_alternates":2,
+      "pedestrian": {"max_distance": 250000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50,"max_transit_walking_distance": 10000,"min_transit_walking_distance": 1},
+      "skadi": {"max_shape": 750000,"min_resample": 10.0},
+      "trace": {"max_distance": 200000.0,"max_gps_accuracy": 100.0,"max_search_radius": 100,"max_shape": 16000,"max_best_paths":4,"max_best_paths_shape":100}
+    }
+  })";
+
+// Fixed origins and destinations in the utrecht tiles, from short trips within a neighbourhood
+// to ones across the whole extract
+const std::vector<std::pair<PointLL, PointLL>> kRoutes = {
+    {{5.101728, 52.106337}, {5.087099, 52.100469}}, {{5.115197, 52.079079}, {5.101497, 52.106126}},
+    {{5.089717, 52.111276}, {5.087099, 52.100469}}, {{5.081005, 52.103105}, {5.075254, 52.094273}},
+    {{5.101728, 52.106337}, {5.075254, 52.094273}}, {{5.06813, 52.103948}, {5.115197, 52.079079}},
+    {{5.115321, 52.078937}, {5.089717, 52.111276}}, {{5.06813, 52.103948}, {5.101497, 52.106126}},
+};
+
+// Sources and targets of the matrices
+const std::vector<PointLL> kSources = {{5.101728, 52.106337},
+                                       {5.089717, 52.111276},
+                                       {5.081005, 52.103105},
+                                       {5.06813, 52.103948}};
+const std::vector<PointLL> kTargets = {{5.101497, 52.106126},
+                                       {5.087099, 52.100469},
+                                       {5.081005, 52.103105},
+                                       {5.075254, 52.094273}};
+
+// Origins of the isochrones and how far they reach
+const std::vector<PointLL> kIsochrones = {{5.101728, 52.106337}, {5.115197, 52.079079}};
+constexpr unsigned int kIsochroneMinutes = 15;
+
+std::string to_json(const std::vector<PointLL>& lls) {
+  std::stringstream ss;
+  ss << std::setprecision(7) << '[';
+  for (const auto& ll : lls) {
+    ss << (&ll == &lls.front() ? "" : ",") << "{\"lat\":" << ll.lat() << ",\"lon\":" << ll.lng()
+       << '}';
+  }
+  ss << ']';
+  return ss.str();
+}
+
+// What the searches of a benchmark did, summed over all of them
+struct tally_t {
+  uint64_t searches = 0;
+  uint64_t nanoseconds = 0;
+  uint64_t labels = 0;
+  uint64_t tiles = 0;
+  uint64_t allocations = 0;
+
+  // Counts the labels of a search and the tiles their edges are in
+  template <class label_container_t> void count(const label_container_t& labels) {
+    for (const auto& label : labels) {
+      tiles_.insert(label.edgeid().Tile_Base());
+    }
+    this->labels += labels.size();
+  }
+
+  // Done counting the labels of a search
+  void next() {
+    tiles += tiles_.size();
+    tiles_.clear();
+  }
+
+protected:
+  std::unordered_set<GraphId> tiles_;
+};
+
+// The algorithms keep their labels until they are cleared, these let us count them
+struct astar_t : public AStarPathAlgorithm {
+  void count(tally_t& tally) const {
+    tally.count(edgelabels_);
+  }
+};
+
+struct bidirectional_astar_t : public BidirectionalAStar {
+  void count(tally_t& tally) const {
+    tally.count(edgelabels_forward_);
+    tally.count(edgelabels_reverse_);
+  }
+};
+
+struct timedep_forward_t : public TimeDepForward {
+  void count(tally_t& tally) const {
+    tally.count(edgelabels_);
+  }
+};
+
+struct costmatrix_t : public CostMatrix {
+  void count(tally_t& tally) const {
+    for (const auto& labels : source_edgelabel_) {
+      tally.count(labels);
+    }
+    for (const auto& labels : target_edgelabel_) {
+      tally.count(labels);
+    }
+  }
+};
+
+struct timedistancematrix_t : public TimeDistanceMatrix {
+  void count(tally_t& tally) const {
+    tally.count(edgelabels_);
+  }
+};
+
+struct isochrone_t : public Isochrone {
+  void count(tally_t& tally) const {
+    tally.count(edgelabels_);
+  }
+};
+
+// A benchmark runs a number of cases (an origin and destination, a source or a whole matrix),
+// only the search is timed. Counting and clearing happen after the clock is stopped
+struct benchmark_t {
+  std::string name;
+  size_t cases;
+  std::function<void(size_t)> search;
+  std::function<void(tally_t&)> count;
+  std::function<void()> clear;
+};
+
+tally_t run(const benchmark_t& benchmark, const uint32_t iterations) {
+  // The first pass loads the tiles so we time the searches, not the disk
+  for (size_t i = 0; i < benchmark.cases; ++i) {
+    benchmark.search(i);
+    benchmark.clear();
+  }
+
+  tally_t tally;
+  for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+    for (size_t i = 0; i < benchmark.cases; ++i) {
+      uint64_t allocated = allocations.load();
+      auto start = std::chrono::steady_clock::now();
+      benchmark.search(i);
+      auto end = std::chrono::steady_clock::now();
+      tally.allocations += allocations.load() - allocated;
+      tally.nanoseconds +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+      benchmark.count(tally);
+      tally.next();
+      benchmark.clear();
+      ++tally.searches;
+    }
+  }
+  return tally;
+}
+
+void report(const std::string& name, const tally_t& tally) {
+  double searches = std::max(tally.searches, uint64_t(1));
+  std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(10) << tally.searches << std::setw(14)
+            << tally.nanoseconds / searches / 1000.0 << std::setw(12) << tally.labels / searches
+            << std::setw(10) << tally.tiles / searches << std::setw(10)
+            << (tally.labels ? static_cast<double>(tally.nanoseconds) / tally.labels : 0.0)
+            << std::setw(12) << tally.allocations / searches << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  std::string tile_dir;
+  uint32_t iterations;
+
+  bpo::options_description options(
+      "valhalla " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_benchmark_thor [options] <tile_dir>\n"
+      "\n"
+      "valhalla_benchmark_thor runs the path algorithms of thor over fixed origins and "
+      "destinations in the utrecht test tiles (test/data/utrecht_tiles) and reports per "
+      "search the time, labels settled, tiles touched, time per label and allocations."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")(
+      "version,v", "Print the version of this software.")(
+      "iterations,i", bpo::value<uint32_t>(&iterations)->default_value(10),
+      "How many times to run every search.")(
+      "tile_dir", bpo::value<std::string>(&tile_dir)->default_value("test/data/utrecht_tiles"),
+      "Directory of the utrecht test tiles.");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("tile_dir", 1);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+    bpo::notify(vm);
+
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_benchmark_thor " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  // The searches log when they fail, nothing else should show up between the results
+  logging::Configure({{"type", ""}});
+
+  boost::property_tree::ptree config;
+  std::stringstream ss(kConfig);
+  rapidjson::read_json(ss, config);
+  config.put("mjolnir.tile_dir", tile_dir);
+  auto reader = std::make_shared<GraphReader>(config.get_child("mjolnir"));
+  loki_worker_t loki_worker(config, reader);
+
+  // Correlate all the locations once up front
+  std::vector<Api> routes, timedep_routes;
+  for (const auto& route : kRoutes) {
+    auto locations = to_json({route.first, route.second});
+    routes.emplace_back();
+    ParseApi(R"({"costing":"auto","locations":)" + locations + "}", Options::route, routes.back());
+    loki_worker.route(routes.back());
+    timedep_routes.emplace_back();
+    ParseApi(R"({"costing":"auto","date_time":{"type":1,"value":"2018-06-28T07:00"},"locations":)" +
+                 locations + "}",
+             Options::route, timedep_routes.back());
+    loki_worker.route(timedep_routes.back());
+  }
+  Api matrix;
+  ParseApi(R"({"costing":"auto","sources":)" + to_json(kSources) +
+               R"(,"targets":)" + to_json(kTargets) + "}",
+           Options::sources_to_targets, matrix);
+  loki_worker.matrix(matrix);
+  std::vector<Api> isochrones;
+  for (const auto& origin : kIsochrones) {
+    isochrones.emplace_back();
+    ParseApi(R"({"costing":"auto","contours":[{"time":)" + std::to_string(kIsochroneMinutes) +
+                 R"(}],"locations":)" + to_json({origin}) + "}",
+             Options::isochrone, isochrones.back());
+    loki_worker.isochrones(isochrones.back());
+  }
+
+  CostFactory<DynamicCost> factory;
+  factory.RegisterStandardCostingModels();
+  auto costing = factory.Create(Costing::auto_, routes.front().options());
+  auto mode = costing->travel_mode();
+  std::shared_ptr<DynamicCost> mode_costing[4];
+  mode_costing[static_cast<uint32_t>(mode)] = costing;
+  float max_matrix_distance = config.get<float>("service_limits.auto.max_matrix_distance");
+
+  astar_t astar;
+  bidirectional_astar_t bidirectional_astar;
+  timedep_forward_t timedep_forward;
+  costmatrix_t costmatrix;
+  timedistancematrix_t timedistancematrix;
+  isochrone_t isochrone;
+
+  // A path algorithm over the routes of the given requests
+  const auto path = [&](const std::string& name, auto& algorithm, std::vector<Api>& requests) {
+    return benchmark_t{name, requests.size(),
+                       [&, name](size_t i) {
+                         auto& locations = *requests[i].mutable_options()->mutable_locations();
+                         if (algorithm
+                                 .GetBestPath(locations[0], locations[1], *reader, mode_costing, mode)
+                                 .empty()) {
+                           throw std::runtime_error(name + " found no path for route " +
+                                                    std::to_string(i));
+                         }
+                       },
+                       [&](tally_t& tally) { algorithm.count(tally); },
+                       [&]() { algorithm.Clear(); }};
+  };
+
+  std::vector<benchmark_t> benchmarks = {
+      path("AStarPathAlgorithm", astar, routes),
+      path("BidirectionalAStar", bidirectional_astar, routes),
+      path("TimeDepForward", timedep_forward, timedep_routes),
+      {"CostMatrix", 1,
+       [&](size_t) {
+         costmatrix.SourceToTarget(matrix.options().sources(), matrix.options().targets(), *reader,
+                                   mode_costing, mode, max_matrix_distance);
+       },
+       [&](tally_t& tally) { costmatrix.count(tally); }, [&]() { costmatrix.Clear(); }},
+      {"TimeDistanceMatrix", static_cast<size_t>(matrix.options().sources_size()),
+       [&](size_t i) {
+         timedistancematrix.OneToMany(matrix.options().sources(i), matrix.options().targets(),
+                                      *reader, mode_costing, mode, max_matrix_distance);
+       },
+       [&](tally_t& tally) { timedistancematrix.count(tally); },
+       [&]() { timedistancematrix.Clear(); }},
+      {"Isochrone", isochrones.size(),
+       [&](size_t i) {
+         isochrone.Compute(*isochrones[i].mutable_options()->mutable_locations(),
+                           kIsochroneMinutes + 10, *reader, mode_costing, mode);
+       },
+       [&](tally_t& tally) { isochrone.count(tally); }, [&]() { isochrone.Clear(); }},
+  };
+
+  std::cout << std::left << std::setw(24) << "algorithm" << std::right << std::setw(10)
+            << "searches" << std::setw(14) << "us/search" << std::setw(12) << "labels"
+            << std::setw(10) << "tiles" << std::setw(10) << "ns/label" << std::setw(12)
+            << "allocs" << std::endl;
+  for (const auto& benchmark : benchmarks) {
+    report(benchmark.name, run(benchmark, iterations));
+  }
+
+  return EXIT_SUCCESS;
+}
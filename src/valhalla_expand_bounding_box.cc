@@ -1,20 +1,84 @@
 #include "baldr/graphreader.h"
 #include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "config.h"
 
 namespace bpo = boost::program_options;
 namespace bpt = boost::property_tree;
 
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// Expands the box by the shape of the edges leaving the nodes within it for the tiles the thread
+// takes from the list. Both directions of an edge have the same shape so an edge is skipped when
+// its opposing edge was already looked at, which is tracked per tile by edge index
+AABB2<PointLL> expand(const bpt::ptree& config,
+                      const AABB2<PointLL>& bb,
+                      const std::vector<GraphId>& ids,
+                      std::atomic<size_t>& next) {
+  GraphReader reader(config);
+  AABB2<PointLL> min_bb{PointLL{}, PointLL{}};
+  std::vector<bool> done;
+  for (size_t t = next++; t < ids.size(); t = next++) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    const auto* tile = reader.GetGraphTile(ids[t]);
+    if (!tile) {
+      continue;
+    }
+    done.assign(tile->header()->directededgecount(), false);
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      const auto* node = tile->node(i);
+      auto node_ll = node->latlng(tile->header()->base_ll());
+      if (!bb.Contains(node_ll)) {
+        continue;
+      }
+      if (!min_bb.minpt().IsValid()) {
+        min_bb = AABB2<PointLL>(node_ll, node_ll);
+      }
+      uint32_t idx = node->edge_index();
+      const auto* edge = tile->directededge(idx);
+      for (uint32_t j = 0; j < node->edge_count(); ++j, ++idx, ++edge) {
+        if (done[idx]) {
+          continue;
+        }
+        auto shape = tile->edgeinfo(edge->edgeinfo_offset()).lazy_shape();
+        while (!shape.empty()) {
+          min_bb.Expand(shape.pop());
+        }
+        if (edge->endnode().Tile_Base() == ids[t] && !edge->leaves_tile()) {
+          auto opp = tile->node(edge->endnode())->edge_index() + edge->opp_index();
+          if (opp < done.size() &&
+              tile->directededge(opp)->edgeinfo_offset() == edge->edgeinfo_offset()) {
+            done[opp] = true;
+          }
+        }
+      }
+    }
+  }
+  return min_bb;
+}
+
+} // namespace
+
 int main(int argc, char** argv) {
   std::string config, bbox;
   std::string inline_config;
   std::string config_file_path;
+  unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
 
   bpo::options_description options("valhalla_expand_bounding_box " VALHALLA_VERSION "\n"
                                    "\n"
@@ -34,6 +98,7 @@ int main(int argc, char** argv) {
   adder(
       "bounding-box,b", bpo::value<std::string>(&bbox),
       "Bounding box to expand. The format is lower left lng/lat and upper right lng/lat or min_x,min_y,max_x,max_y");
+  adder("concurrency,j", bpo::value<unsigned int>(&num_threads), "Number of threads to use.");
 
   bpo::positional_options_description pos_options;
   pos_options.add("bounding-box", 1);
@@ -100,10 +165,28 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
-  valhalla::midgard::AABB2<valhalla::midgard::PointLL> bb{{result[0], result[1]},
-                                                          {result[2], result[3]}};
-  valhalla::baldr::GraphReader reader(pt.get_child("mjolnir"));
-  bb = reader.GetMinimumBoundingBox(bb);
+  // Each thread gathers the tiles it takes into a box of its own and the boxes are joined after
+  AABB2<PointLL> bb{{result[0], result[1]}, {result[2], result[3]}};
+  const auto ids = TileHierarchy::GetGraphIds(bb);
+  std::atomic<size_t> next(0);
+  std::vector<AABB2<PointLL>> boxes(std::max(1u, num_threads));
+  std::vector<std::thread> threads(boxes.size());
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i] =
+        std::thread([&, i]() { boxes[i] = expand(pt.get_child("mjolnir"), bb, ids, next); });
+  }
+  bb = AABB2<PointLL>{PointLL{}, PointLL{}};
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+    if (!boxes[i].minpt().IsValid()) {
+      continue;
+    }
+    if (!bb.minpt().IsValid()) {
+      bb = boxes[i];
+    } else {
+      bb.Expand(boxes[i]);
+    }
+  }
 
   std::cout << std::fixed << std::setprecision(6) << bb.minx() << "," << bb.miny() << "," << bb.maxx()
             << "," << bb.maxy() << std::endl;
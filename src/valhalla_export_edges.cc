@@ -10,7 +10,11 @@
 #include "midgard/logging.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include "config.h"
@@ -26,19 +30,28 @@ std::string row_separator = "\n";
 std::string config;
 bool ferries;
 bool unnamed;
+unsigned int num_threads = std::thread::hardware_concurrency();
 
 namespace {
 
-// a place we can mark what edges we've seen, even for the planet we should need < 100mb
+// a place we can mark what edges we've seen, even for the planet we should need < 100mb. the
+// threads share it so the bits are set atomically
 struct bitset_t {
-  bitset_t(size_t size) {
-    bits.resize(std::ceil(size / 64.0));
+  bitset_t(size_t size) : bits(std::ceil(size / 64.0)) {
+    for (auto& word : bits) {
+      word = 0;
+    }
   }
   void set(const uint64_t id) {
+    claim(id);
+  }
+  // sets the bit and returns whether it was this call that set it
+  bool claim(const uint64_t id) {
     if (id >= bits.size() * 64) {
       throw std::runtime_error("id out of bounds");
     }
-    bits[id / 64] |= static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    auto bit = static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    return !(bits[id / 64].fetch_or(bit) & bit);
   }
   bool get(const uint64_t id) const {
     if (id >= bits.size() * 64) {
@@ -48,7 +61,7 @@ struct bitset_t {
   }
 
 protected:
-  std::vector<uint64_t> bits;
+  std::vector<std::atomic<uint64_t>> bits;
 };
 
 // often we need both the edge id and the directed edge, so lets have something to represent that
@@ -84,12 +97,27 @@ edge_t opposing(GraphReader& reader, const GraphTile* tile, const DirectedEdge*
   return {id, t->directededge(id)};
 }
 
+// the index of an edge in the bitset
+uint64_t index(const std::unordered_map<GraphId, uint64_t>& tile_set, const GraphId& id) {
+  return tile_set.find(id.Tile_Base())->second + id.id();
+}
+
+// claims an edge and its opposing edge for this thread. two threads walking the same road from
+// either side both go for the bit of the edge with the lower index so only one gets the pair
+bool claim(bitset_t& edge_set, const uint64_t edge, const uint64_t other) {
+  bool claimed = edge_set.claim(std::min(edge, other));
+  edge_set.set(std::max(edge, other));
+  return claimed;
+}
+
+// the next like named edge from the end of this one and its opposing edge, both claimed
 edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
-            const bitset_t& edge_set,
+            bitset_t& edge_set,
             GraphReader& reader,
             const GraphTile*& tile,
             const edge_t& edge,
-            const std::vector<std::string>& names) {
+            const std::vector<std::string>& names,
+            edge_t& other) {
   // get the right tile
   if (tile->id() != edge.e->endnode().Tile_Base()) {
     tile = reader.GetGraphTile(edge.e->endnode());
@@ -104,7 +132,7 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
     GraphId id = tile->id();
     id.set_id(node->edge_index() + i);
     // already used
-    if (edge_set.get(tile_set.find(tile->id())->second + id.id())) {
+    if (edge_set.get(index(tile_set, id))) {
       continue;
     }
     edge_t candidate{id, tile->directededge(id)};
@@ -121,7 +149,15 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
     auto candidate_names = tile->edgeinfo(candidate.e->edgeinfo_offset()).GetNames();
     if (names.size() == candidate_names.size() &&
         std::equal(names.cbegin(), names.cend(), candidate_names.cbegin())) {
-      return candidate;
+      // without an opposing edge it is only marked
+      other = opposing(reader, tile, candidate);
+      if (other.e == nullptr) {
+        edge_set.set(index(tile_set, id));
+        return candidate;
+      }
+      if (claim(edge_set, index(tile_set, id), index(tile_set, other))) {
+        return candidate;
+      }
     }
   }
 
@@ -167,10 +203,11 @@ int main(int argc, char* argv[]) {
                                                               "Print the version of this software.")(
       "column,c", bpo::value<std::string>(&column_separator),
       "What separator to use between columns [default=\\0].")(
-      "row,r", bpo::value<std::string>(&column_separator),
+      "row,r", bpo::value<std::string>(&row_separator),
       "What separator to use between row [default=\\n].")("ferries,f",
                                                           "Export ferries as well [default=false]")(
-      "unnamed,u", "Export unnamed edges as well [default=false]")
+      "unnamed,u", "Export unnamed edges as well [default=false]")(
+      "concurrency,j", bpo::value<unsigned int>(&num_threads), "Number of threads to use.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file [required]");
 
@@ -197,8 +234,9 @@ int main(int argc, char* argv[]) {
     return EXIT_SUCCESS;
   }
 
-  bool ferries = vm.count("ferries");
-  bool unnamed = vm.count("unnamed");
+  ferries = vm.count("ferries");
+  unnamed = vm.count("unnamed");
+  num_threads = std::max(num_threads, 1u);
 
   // parse the config
   boost::property_tree::ptree pt;
@@ -231,119 +269,150 @@ int main(int argc, char* argv[]) {
   // this is how we know what i've touched and what we havent
   bitset_t edge_set(edge_count);
 
-  // TODO: we could parallelize this and it might be quite a bit faster but if we really want to
-  // maximize continuous edges we need to avoid the lady and the tramp scenario where two threads
-  // are
-  // consuming the same stretch of road at the same time
+  // the tiles are worked on in parallel but written out in this order. threads walking the same
+  // stretch of road from either end (the lady and the tramp) each keep the part they claimed
+  // first, so with more than one thread the roads can be cut into more pieces
+  std::vector<std::pair<GraphId, uint64_t>> tiles(tile_set.begin(), tile_set.end());
+  std::sort(tiles.begin(), tiles.end(),
+            [](const std::pair<GraphId, uint64_t>& a, const std::pair<GraphId, uint64_t>& b) {
+              return a.first.value < b.first.value;
+            });
+  std::vector<std::string> output(tiles.size());
+  std::vector<bool> written(tiles.size(), false);
+  std::mutex lock;
+  std::condition_variable ready;
 
   // for each tile
   LOG_INFO("Exporting " + std::to_string(edge_count) + " edges");
-  int progress = -1;
-  uint64_t set = 0;
-  for (const auto& tile_count_pair : tile_set) {
-    // for each edge in the tile
-    reader.Clear();
-    const auto* tile = reader.GetGraphTile(tile_count_pair.first);
-    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
-      // we've seen this one already
-      if (edge_set.get(tile_count_pair.second + i)) {
-        continue;
-      }
-
-      // TODO: dont mark transition edges since we may need to use them to change levels multiple
-      // times maybe we should mark them though once every normal edge connected there has been
-      // marked
-
-      // make sure we dont ever look at this again
-      edge_t edge{tile_count_pair.first, tile->directededge(i)};
-      edge.i.set_id(i);
-      edge_set.set(tile_count_pair.second + i);
-      ++set;
-
-      // these wont have opposing edges that we care about
-      if (edge.e->use() == Use::kTransitConnection ||
-          edge.e->IsTransitLine()) { // these 2 should never happen
-        continue;
-      }
-
-      // get the opposing edge as well (ensure a valid edge is returned)
-      edge_t opposing_edge = opposing(reader, tile, edge);
-      if (opposing_edge.e == nullptr) {
-        continue;
-      }
-      edge_set.set(tile_set.find(opposing_edge.i.Tile_Base())->second + opposing_edge.i.id());
-      ++set;
-
-      // shortcuts arent real and maybe we dont want ferries
-      if (edge.e->is_shortcut() || (!ferries && edge.e->use() == Use::kFerry)) {
-        continue;
-      }
-
-      // no name no thanks
-      auto edge_info = tile->edgeinfo(edge.e->edgeinfo_offset());
-      auto names = edge_info.GetNames();
-      if (names.size() == 0 && !unnamed) {
-        continue;
-      }
-
-      // TODO: at this point we need to traverse the graph from this edge to build a subgraph of
-      // like-named connected edges. what we would like is that from that subgraph we extract
-      // linestrings which are of the maximum length. this makes people's lives easier downstream.
-      // finding such segments is NP-Hard and indeed even verifying a solution is NP-Complete. there
-      // are some tricks though.. you can do this in linear time if your subgraph is a DAG. this
-      // can't be guaranteed in the overall graph, but we can create the subgraphs in such a way
-      // that
-      // they are DAGs. this can produce suboptimal results however and depends on the initial edge.
-      // so for now we'll just greedily export edges
-
-      // keep some state about this section of road
-      std::list<edge_t> edges{edge};
-
-      // go forward
-      const auto* t = tile;
-      while ((edge = next(tile_set, edge_set, reader, t, edge, names))) {
-        // mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
-        edge_t other = opposing(reader, t, edge);
-        if (other.e == nullptr) {
-          continue;
-        }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
-        // keep this
-        edges.push_back(edge);
-      }
-
-      // go backward
-      edge = opposing_edge;
-      while ((edge = next(tile_set, edge_set, reader, t, edge, names))) {
-        // mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
-        edge_t other = opposing(reader, t, edge);
-        if (other.e == nullptr) {
-          continue;
+  std::atomic<size_t> next_tile(0);
+  std::atomic<uint64_t> set(0);
+  std::vector<std::thread> threads(num_threads);
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      GraphReader reader(pt.get_child("mjolnir"));
+      for (size_t tile_index; (tile_index = next_tile++) < tiles.size();) {
+        // for each edge in the tile
+        std::string rows;
+        const auto& tile_count_pair = tiles[tile_index];
+        reader.Clear();
+        const auto* tile = reader.GetGraphTile(tile_count_pair.first);
+        for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+          // we've seen this one already
+          if (edge_set.get(tile_count_pair.second + i)) {
+            continue;
+          }
+
+          // TODO: dont mark transition edges since we may need to use them to change levels
+          // multiple times maybe we should mark them though once every normal edge connected
+          // there has been marked
+
+          // make sure we dont ever look at this again
+          edge_t edge{tile_count_pair.first, tile->directededge(i)};
+          edge.i.set_id(i);
+
+          // these wont have opposing edges that we care about
+          if (edge.e->use() == Use::kTransitConnection ||
+              edge.e->IsTransitLine()) { // these 2 should never happen
+            edge_set.set(tile_count_pair.second + i);
+            ++set;
+            continue;
+          }
+
+          // get the opposing edge as well (ensure a valid edge is returned)
+          edge_t opposing_edge = opposing(reader, tile, edge);
+          if (opposing_edge.e == nullptr) {
+            edge_set.set(tile_count_pair.second + i);
+            ++set;
+            continue;
+          }
+          if (!claim(edge_set, tile_count_pair.second + i, index(tile_set, opposing_edge))) {
+            continue;
+          }
+          set += 2;
+
+          // shortcuts arent real and maybe we dont want ferries
+          if (edge.e->is_shortcut() || (!ferries && edge.e->use() == Use::kFerry)) {
+            continue;
+          }
+
+          // no name no thanks
+          auto edge_info = tile->edgeinfo(edge.e->edgeinfo_offset());
+          auto names = edge_info.GetNames();
+          if (names.size() == 0 && !unnamed) {
+            continue;
+          }
+
+          // TODO: at this point we need to traverse the graph from this edge to build a subgraph
+          // of like-named connected edges. what we would like is that from that subgraph we
+          // extract linestrings which are of the maximum length. this makes people's lives easier
+          // downstream. finding such segments is NP-Hard and indeed even verifying a solution is
+          // NP-Complete. there are some tricks though.. you can do this in linear time if your
+          // subgraph is a DAG. this can't be guaranteed in the overall graph, but we can create
+          // the subgraphs in such a way that they are DAGs. this can produce suboptimal results
+          // however and depends on the initial edge. so for now we'll just greedily export edges
+
+          // keep some state about this section of road
+          std::list<edge_t> edges{edge};
+
+          // go forward
+          const auto* t = tile;
+          edge_t other;
+          while ((edge = next(tile_set, edge_set, reader, t, edge, names, other))) {
+            if (other.e == nullptr) {
+              continue;
+            }
+            set += 2;
+            // keep this
+            edges.push_back(edge);
+          }
+
+          // go backward
+          edge = opposing_edge;
+          while ((edge = next(tile_set, edge_set, reader, t, edge, names, other))) {
+            if (other.e == nullptr) {
+              continue;
+            }
+            set += 2;
+            // keep this
+            edges.push_front(other);
+          }
+
+          // get the shape
+          std::list<PointLL> shape;
+          for (const auto& e : edges) {
+            extend(reader, t, e, shape);
+          }
+
+          // output it as: shape,name,name,...
+          rows += encode(shape);
+          rows += column_separator;
+          for (const auto& name : names) {
+            rows += name;
+            rows += &name == &names.back() ? "" : column_separator;
+          }
+          rows += row_separator;
         }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
-        // keep this
-        edges.push_front(other);
-      }
 
-      // get the shape
-      std::list<PointLL> shape;
-      for (const auto& e : edges) {
-        extend(reader, t, e, shape);
+        // hand the rows of the tile to the writer
+        std::lock_guard<std::mutex> guard(lock);
+        output[tile_index] = std::move(rows);
+        written[tile_index] = true;
+        ready.notify_one();
       }
+    });
+  }
 
-      // output it as: shape,name,name,...
-      auto encoded = encode(shape);
-      std::cout << encoded << column_separator;
-      for (const auto& name : names) {
-        std::cout << name << (&name == &names.back() ? "" : column_separator);
-      }
-      std::cout << row_separator;
-      std::cout.flush();
+  // write the tiles out in order as they are done
+  std::ios::sync_with_stdio(false);
+  int progress = -1;
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    std::string rows;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      ready.wait(guard, [&written, t]() { return written[t]; });
+      rows.swap(output[t]);
     }
+    std::cout.write(rows.data(), rows.size());
 
     // check progress
     int procent = (100.f * set) / edge_count;
@@ -351,6 +420,10 @@ int main(int argc, char* argv[]) {
       LOG_INFO(std::to_string(progress = procent) + "%");
     }
   }
+  std::cout.flush();
+  for (auto& thread : threads) {
+    thread.join();
+  }
   LOG_INFO("Done");
 
   for (uint64_t i = 0; i < edge_count; ++i) {
@@ -0,0 +1,183 @@
+#include "baldr/rapidjson_utils.h"
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+
+#include "baldr/connectivity_map.h"
+#include "baldr/graphreader.h"
+#include "baldr/json.h"
+#include "baldr/tilehierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+
+using namespace valhalla::baldr;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// the binary export is a header followed by a record per tile sorted by level and tile id
+constexpr char kTileAccessesMagic[8] = {'V', 'T', 'A', 'C', 'C', '0', '0', '1'};
+
+struct tile_accesses_header_t {
+  char magic[8];
+  uint64_t count;
+};
+
+struct tile_accesses_record_t {
+  uint32_t level;
+  uint32_t tileid;
+  uint64_t count;
+  uint64_t misses;
+  uint64_t miss_micros;
+};
+
+// from yellow for the tiles used least to red for the ones used most, on a log scale
+std::string heat(uint64_t count, uint64_t most) {
+  double ratio = most > 1 ? std::log(static_cast<double>(std::max<uint64_t>(count, 1))) /
+                                std::log(static_cast<double>(most))
+                          : 1.0;
+  char color[8];
+  std::snprintf(color, sizeof(color), "#ff%02x00", static_cast<int>(std::round(255 * (1 - ratio))));
+  return color;
+}
+
+bool write_binary(const std::string& file_name,
+                  const std::map<GraphId, GraphReader::TileAccesses>& accesses) {
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  tile_accesses_header_t header{};
+  std::copy(kTileAccessesMagic, kTileAccessesMagic + sizeof(kTileAccessesMagic), header.magic);
+  header.count = accesses.size();
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const auto& tile : accesses) {
+    tile_accesses_record_t record{tile.first.level(), tile.first.tileid(), tile.second.count,
+                                  tile.second.misses, tile.second.miss_micros};
+    file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+  }
+  return static_cast<bool>(file);
+}
+
+bool write_geojson(const std::string& prefix,
+                   const std::map<GraphId, GraphReader::TileAccesses>& accesses) {
+  // a collection of squares per level, colored by how much they are used
+  std::map<uint32_t, std::unordered_map<uint32_t, json::MapPtr>> levels;
+  uint64_t most = 0;
+  for (const auto& tile : accesses) {
+    most = std::max(most, tile.second.count);
+  }
+  for (const auto& tile : accesses) {
+    const auto& a = tile.second;
+    double mean_miss_ms = a.misses ? a.miss_micros / 1000.0 / a.misses : 0.0;
+    levels[tile.first.level()].emplace(
+        tile.first.tileid(), json::map({
+                                 {"id", static_cast<uint64_t>(tile.first.tileid())},
+                                 {"count", a.count},
+                                 {"misses", a.misses},
+                                 {"mean_miss_ms", json::fp_t{mean_miss_ms, 3}},
+                                 {"fill", heat(a.count, most)},
+                                 {"stroke", std::string("white")},
+                                 {"stroke-width", static_cast<uint64_t>(1)},
+                                 {"fill-opacity", json::fp_t{0.8, 1}},
+                             }));
+  }
+  for (const auto& level : levels) {
+    std::string file_name = prefix + std::to_string(level.first) + ".geojson";
+    std::ofstream file(file_name, std::ios::trunc);
+    file << tiles_to_geojson(level.first, level.second);
+    if (!file) {
+      std::cerr << "Unable to write output file: " << file_name << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+// program entry point
+int main(int argc, char* argv[]) {
+  std::string config, log, format, output;
+  bpo::options_description options(
+      "valhalla_export_tile_accesses " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_export_tile_accesses [options]\n"
+      "\n"
+      "valhalla_export_tile_accesses exports the tile access log that the services keep when "
+      "mjolnir.tile_access_log is configured, with how often each tile was asked for, missed "
+      "the cache and how long loading it took, to see which tiles are hot. The geojson format "
+      "writes a file per level with a square per tile colored by its use, the binary format one "
+      "file with a record per tile."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "log,l", bpo::value<std::string>(&log),
+      "Tile access log to export [default=mjolnir.tile_access_log of the config].")(
+      "format,f", bpo::value<std::string>(&format)->default_value("geojson"),
+      "Either geojson or binary.")(
+      "output,o", bpo::value<std::string>(&output)->default_value("tile_accesses"),
+      "Output file, for geojson the prefix of the file of each level.")
+      // positional arguments
+      ("config", bpo::value<std::string>(&config), "Valhalla configuration file [required]");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("config", 1);
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help") || (!vm.count("config") && !vm.count("log"))) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_export_tile_accesses " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (format != "geojson" && format != "binary") {
+    std::cerr << "Unknown format: " << format << "\n\n" << options << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // find the log in the config unless we were told where it is
+  if (log.empty()) {
+    boost::property_tree::ptree pt;
+    rapidjson::read_json(config.c_str(), pt);
+    log = pt.get<std::string>("mjolnir.tile_access_log", "");
+    if (log.empty()) {
+      std::cerr << "The config has no mjolnir.tile_access_log" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // sorted by level and tile id
+  auto read = GraphReader::ReadTileAccessLog(log);
+  std::map<GraphId, GraphReader::TileAccesses> accesses(read.begin(), read.end());
+  if (accesses.empty()) {
+    std::cerr << "No tile accesses in " << log << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bool written = format == "binary" ? write_binary(output, accesses)
+                                    : write_geojson(output, accesses);
+  return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,9 +3,12 @@
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -22,6 +25,7 @@
 #include "thor/costmatrix.h"
 #include "thor/optimizer.h"
 #include "thor/timedistancematrix.h"
+#include "tyr/batch.h"
 #include "worker.h"
 
 using namespace valhalla;
@@ -83,6 +87,37 @@ void LogResults(const bool optimize,
   }
 }
 
+// Runs a batch of requests on threads sharing their tiles and writes what came of them
+int RunBatch(const boost::property_tree::ptree& pt,
+             const std::string& batch,
+             const uint32_t concurrency,
+             const std::string& results,
+             const std::string& timings) {
+  auto requests = tyr::read_batch(batch);
+  auto t0 = std::chrono::high_resolution_clock::now();
+  auto done = tyr::run_batch(pt, Options::sources_to_targets, requests, concurrency);
+  auto t1 = std::chrono::high_resolution_clock::now();
+  float secs = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() / 1000.0f;
+
+  // the responses go to stdout unless they should go to a file
+  std::ofstream results_file, timings_file;
+  if (!results.empty()) {
+    results_file.open(results);
+  }
+  if (!timings.empty()) {
+    timings_file.open(timings);
+  }
+  tyr::write_batch(done, results.empty() ? &std::cout : &results_file,
+                   timings.empty() ? nullptr : &timings_file);
+
+  size_t failed =
+      std::count_if(done.cbegin(), done.cend(), [](const tyr::batch_result_t& r) { return !r.ok; });
+  LOG_INFO("Batch of " + std::to_string(done.size()) + " requests with " +
+           std::to_string(failed) + " failures took " + std::to_string(secs) + " secs (" +
+           std::to_string(secs > 0 ? done.size() / secs : 0.f) + " requests/sec)");
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 // Main method for testing time and distance matrix methods
 int main(int argc, char* argv[]) {
   bpo::options_description poptions(
@@ -96,8 +131,9 @@ int main(int argc, char* argv[]) {
       "\n"
       "\n");
 
-  std::string json, config;
+  std::string json, config, batch, results, timings;
   uint32_t iterations = 1;
+  uint32_t concurrency = 0;
   poptions.add_options()("help,h", "Print this help message.")("version,v",
                                                                "Print the version of this software.")(
       // TODO - update example
@@ -111,7 +147,15 @@ int main(int argc, char* argv[]) {
       "York\",\"state\":\"NY\",\"postal_code\":\"10017-3507\",\"country\":\"US\"}],\"costing\":"
       "\"auto\",\"directions_options\":{\"units\":\"miles\"}}'")(
       "multi-run", bpo::value<uint32_t>(&iterations),
-      "Generate the route N additional times before exiting.")
+      "Generate the route N additional times before exiting.")(
+      "batch,b", bpo::value<std::string>(&batch),
+      "File of matrix requests to run instead of -j, one json or -j '<json>' per line.")(
+      "concurrency", bpo::value<uint32_t>(&concurrency),
+      "Number of threads to run the --batch on, defaults to the number of cores.")(
+      "results", bpo::value<std::string>(&results),
+      "File to write the --batch responses to, one per line, instead of stdout.")(
+      "timings", bpo::value<std::string>(&timings),
+      "File to write the milliseconds each --batch request took to as csv.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file");
 
@@ -137,10 +181,6 @@ int main(int argc, char* argv[]) {
     return EXIT_SUCCESS;
   }
 
-  Api request;
-  ParseApi(json, valhalla::Options::sources_to_targets, request);
-  const auto& options = request.options();
-
   // parse the config
   boost::property_tree::ptree pt;
   rapidjson::read_json(config.c_str(), pt);
@@ -155,6 +195,15 @@ int main(int argc, char* argv[]) {
     valhalla::midgard::logging::Configure(logging_config);
   }
 
+  // run many requests at once on all the cores rather than the one request in detail
+  if (vm.count("batch")) {
+    return RunBatch(pt, batch, concurrency, results, timings);
+  }
+
+  Api request;
+  ParseApi(json, valhalla::Options::sources_to_targets, request);
+  const auto& options = request.options();
+
   // Get something we can use to fetch tiles
   valhalla::baldr::GraphReader reader(pt.get_child("mjolnir"));
 
@@ -198,7 +247,8 @@ int main(int argc, char* argv[]) {
     // Skip over any service limits that are not for a costing method
     if (kv.first == "max_avoid_locations" || kv.first == "max_reachability" ||
         kv.first == "max_radius" || kv.first == "max_timedep_distance" || kv.first == "skadi" ||
-        kv.first == "trace" || kv.first == "isochrone") {
+        kv.first == "trace" || kv.first == "isochrone" || kv.first == "max_alternates" ||
+        kv.first == "max_timeout") {
       continue;
     }
     max_matrix_distance.emplace(kv.first,
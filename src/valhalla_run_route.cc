@@ -2,6 +2,8 @@
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -33,6 +35,7 @@
 #include "thor/route_matcher.h"
 #include "thor/timedep.h"
 #include "thor/triplegbuilder.h"
+#include "tyr/batch.h"
 #include "worker.h"
 
 #include <valhalla/proto/api.pb.h>
@@ -54,6 +57,38 @@ namespace bpo = boost::program_options;
 
 namespace {
 
+// Runs a batch of requests on threads sharing their tiles and writes what came of them
+int RunBatch(const boost::property_tree::ptree& pt,
+             const valhalla::Options::Action action,
+             const std::string& batch,
+             const uint32_t concurrency,
+             const std::string& results,
+             const std::string& timings) {
+  auto requests = valhalla::tyr::read_batch(batch);
+  auto t0 = std::chrono::high_resolution_clock::now();
+  auto done = valhalla::tyr::run_batch(pt, action, requests, concurrency);
+  auto t1 = std::chrono::high_resolution_clock::now();
+  float secs = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() / 1000.0f;
+
+  // the responses go to stdout unless they should go to a file
+  std::ofstream results_file, timings_file;
+  if (!results.empty()) {
+    results_file.open(results);
+  }
+  if (!timings.empty()) {
+    timings_file.open(timings);
+  }
+  valhalla::tyr::write_batch(done, results.empty() ? &std::cout : &results_file,
+                             timings.empty() ? nullptr : &timings_file);
+
+  size_t failed = std::count_if(done.cbegin(), done.cend(),
+                                [](const valhalla::tyr::batch_result_t& r) { return !r.ok; });
+  LOG_INFO("Batch of " + std::to_string(done.size()) + " requests with " +
+           std::to_string(failed) + " failures took " + std::to_string(secs) + " secs (" +
+           std::to_string(secs > 0 ? done.size() / secs : 0.f) + " requests/sec)");
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 std::string get_env(const std::string& key) {
   char* val = std::getenv(key.c_str());
   return val == nullptr ? std::string("") : std::string(val);
@@ -487,10 +522,11 @@ int main(int argc, char* argv[]) {
       "\n"
       "\n");
 
-  std::string json, config;
+  std::string json, config, batch, results, timings;
   bool multi_run = false;
   bool match_test = false;
   uint32_t iterations;
+  uint32_t concurrency = 0;
 
   poptions.add_options()("help,h", "Print this help message.")("version,v",
                                                                "Print the version of this software.")(
@@ -505,7 +541,15 @@ int main(int argc, char* argv[]) {
       "\"auto\",\"directions_options\":{\"units\":\"miles\"}}'")(
       "match-test", "Test RouteMatcher with resulting shape.")(
       "multi-run", bpo::value<uint32_t>(&iterations),
-      "Generate the route N additional times before exiting.")
+      "Generate the route N additional times before exiting.")(
+      "batch,b", bpo::value<std::string>(&batch),
+      "File of route requests to run instead of -j, one json or -j '<json>' per line.")(
+      "concurrency", bpo::value<uint32_t>(&concurrency),
+      "Number of threads to run the --batch on, defaults to the number of cores.")(
+      "results", bpo::value<std::string>(&results),
+      "File to write the --batch responses to, one per line, instead of stdout.")(
+      "timings", bpo::value<std::string>(&timings),
+      "File to write the milliseconds each --batch request took to as csv.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file");
 
@@ -541,6 +585,25 @@ int main(int argc, char* argv[]) {
     multi_run = true;
   }
 
+  // parse the config
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(config.c_str(), pt);
+
+  // configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree =
+      pt.get_child_optional("thor.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  // run many requests at once on all the cores rather than the one request in detail
+  if (vm.count("batch")) {
+    return RunBatch(pt, valhalla::Options::route, batch, concurrency, results, timings);
+  }
+
   // Grab the directions options, if they exist
   valhalla::Api request;
   valhalla::ParseApi(json, valhalla::Options::route, request);
@@ -556,19 +619,6 @@ int main(int argc, char* argv[]) {
     throw;
   }
 
-  // parse the config
-  boost::property_tree::ptree pt;
-  rapidjson::read_json(config.c_str(), pt);
-
-  // configure logging
-  boost::optional<boost::property_tree::ptree&> logging_subtree =
-      pt.get_child_optional("thor.logging");
-  if (logging_subtree) {
-    auto logging_config =
-        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
-                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
-    valhalla::midgard::logging::Configure(logging_config);
-  }
   // Something to hold the statistics
   uint32_t n = locations.size() - 1;
   PathStatistics data({locations[0].latlng_.lat(), locations[0].latlng_.lng()},
@@ -1,12 +1,20 @@
+#include <cerrno>
+#include <csignal>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <list>
 #include <memory>
+#include <pthread.h>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <thread>
+#include <unistd.h>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "baldr/rapidjson_utils.h"
@@ -18,9 +26,307 @@ using namespace prime_server;
 
 #include "midgard/logging.h"
 
+#include "baldr/connectivity_map.h"
+#include "baldr/datetime.h"
+#include "baldr/graphreader.h"
 #include "loki/worker.h"
+#include "midgard/metrics.h"
+#include "odin/util.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
+#include "tyr/actor.h"
+
+namespace {
+
+// answers every request with the metrics of the process, whatever its path
+worker_t::result_t expose_metrics(const std::list<zmq::message_t>&,
+                                  void* request_info,
+                                  const std::function<void()>&) {
+  auto& info = *static_cast<http_request_info_t*>(request_info);
+  worker_t::result_t result{false};
+  http_response_t response(200, "OK", valhalla::midgard::metrics::Expose(),
+                           headers_t{{"Content-type", "text/plain; version=0.0.4"}});
+  response.from_info(info);
+  result.messages.emplace_back(response.to_string());
+  return result;
+}
+
+// a server of its own for the metrics so scraping them does not wait behind routing requests
+void serve_metrics(zmq::context_t& context,
+                   const std::string& listen,
+                   const std::string& loopback,
+                   const std::string& interrupt) {
+  auto proxy = loopback + "_metrics_proxy";
+  std::thread server_thread(std::bind(&http_server_t::serve,
+                                      http_server_t(context, listen, proxy + "_in",
+                                                    loopback + "_metrics", interrupt + "_metrics",
+                                                    false)));
+  server_thread.detach();
+  std::thread proxy_thread(
+      std::bind(&proxy_t::forward, proxy_t(context, proxy + "_in", proxy + "_out")));
+  proxy_thread.detach();
+  std::thread worker_thread([&context, proxy, loopback, interrupt]() {
+    worker_t worker(context, proxy + "_out", "ipc:///dev/null", loopback + "_metrics",
+                    interrupt + "_metrics", expose_metrics);
+    worker.work();
+  });
+  worker_thread.detach();
+}
+
+// swaps in the tile extract of the config file whenever the process gets a hangup, so new tiles
+// are deployed by replacing the extract and signalling instead of restarting. the workers switch
+// to it between their requests. the signal is blocked before any other thread starts so that
+// only the thread waiting for it takes it
+void swap_tiles_on_hangup(const std::string& config_file) {
+  sigset_t hangup;
+  sigemptyset(&hangup);
+  sigaddset(&hangup, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &hangup, nullptr);
+  std::thread swap_thread([hangup, config_file]() {
+    while (true) {
+      int signal;
+      if (sigwait(&hangup, &signal) != 0) {
+        continue;
+      }
+      try {
+        boost::property_tree::ptree config;
+        rapidjson::read_json(config_file, config);
+        valhalla::baldr::GraphReader::SwapTileExtract(config.get_child("mjolnir"));
+      } catch (const std::exception& e) {
+        LOG_ERROR("Tile extract swap failed: " + std::string(e.what()));
+      }
+    }
+  });
+  swap_thread.detach();
+}
+
+// the http server and the proxies in front of each layer of workers
+std::thread start_server(zmq::context_t& context, const boost::property_tree::ptree& config) {
+  std::string listen = config.get<std::string>("httpd.service.listen");
+  std::string loopback = config.get<std::string>("httpd.service.loopback");
+  std::string interrupt = config.get<std::string>("httpd.service.interrupt");
+  std::string loki_proxy = config.get<std::string>("loki.service.proxy");
+  std::string thor_proxy = config.get<std::string>("thor.service.proxy");
+  std::string odin_proxy = config.get<std::string>("odin.service.proxy");
+
+  std::thread server_thread =
+      std::thread(std::bind(&http_server_t::serve, http_server_t(context, listen, loki_proxy + "_in",
+                                                                 loopback, interrupt, true)));
+
+  // metrics of the workers of this process, if they should be served
+  auto metrics_listen = config.get<std::string>("httpd.service.metrics", "");
+  if (!metrics_listen.empty()) {
+    serve_metrics(context, metrics_listen, loopback, interrupt);
+  }
+
+  // loki layer
+  std::thread loki_proxy_thread(
+      std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
+  loki_proxy_thread.detach();
+
+  // fused workers run every stage of a request themselves so there are no other layers
+  if (!config.get<bool>("httpd.service.fused", false)) {
+    // thor layer
+    std::thread thor_proxy_thread(
+        std::bind(&proxy_t::forward, proxy_t(context, thor_proxy + "_in", thor_proxy + "_out")));
+    thor_proxy_thread.detach();
+
+    // odin layer
+    std::thread odin_proxy_thread(
+        std::bind(&proxy_t::forward, proxy_t(context, odin_proxy + "_in", odin_proxy + "_out")));
+    odin_proxy_thread.detach();
+  }
+
+  return server_thread;
+}
+
+// the workers of each layer, which connect to the proxies of this process or the server process
+void start_workers(const boost::property_tree::ptree& config, size_t worker_concurrency) {
+  if (config.get<bool>("httpd.service.fused", false)) {
+    // one worker runs every stage of a request instead of passing it on to the next layer
+    std::list<std::thread> worker_threads;
+    for (size_t i = 0; i < worker_concurrency; ++i) {
+      worker_threads.emplace_back(valhalla::tyr::run_service, config);
+      worker_threads.back().detach();
+    }
+    return;
+  }
+
+  std::list<std::thread> loki_worker_threads;
+  for (size_t i = 0; i < worker_concurrency; ++i) {
+    loki_worker_threads.emplace_back(valhalla::loki::run_service, config);
+    loki_worker_threads.back().detach();
+  }
+  std::list<std::thread> thor_worker_threads;
+  for (size_t i = 0; i < worker_concurrency; ++i) {
+    thor_worker_threads.emplace_back(valhalla::thor::run_service, config);
+    thor_worker_threads.back().detach();
+  }
+  std::list<std::thread> odin_worker_threads;
+  for (size_t i = 0; i < worker_concurrency; ++i) {
+    odin_worker_threads.emplace_back(valhalla::odin::run_service, config);
+    odin_worker_threads.back().detach();
+  }
+}
+
+// loads what the workers only ever read before any worker process is forked, so that rather than
+// every process loading its own copy they all share the pages of the supervisor copy-on-write
+void warm_up(const boost::property_tree::ptree& config) {
+  // maps and indexes the tile extract and the traffic extract, and fills the tile cache of the
+  // process with the tiles used most
+  valhalla::baldr::GraphReader reader(config.get_child("mjolnir"));
+  auto preloaded = reader.Preload(config.get<size_t>("mjolnir.preload_tiles", 0),
+                                  config.get<size_t>("mjolnir.preload_threads", 4));
+  // colors the tiles for the loki workers
+  if (config.get<bool>("loki.use_connectivity", true)) {
+    valhalla::baldr::connectivity_map_t::Global(config.get_child("mjolnir"));
+  }
+  // narrative of odin and the time zones of costing and date times
+  valhalla::odin::get_locales();
+  valhalla::baldr::DateTime::get_tz_db();
+  LOG_INFO("Warmed up the state shared by the worker processes with " + std::to_string(preloaded) +
+           " preloaded tiles");
+}
+
+// forks a process running role, which should never return, with the signals the supervisor
+// waits for unblocked again
+pid_t spawn(const std::function<void()>& role, const sigset_t& mask) {
+  auto pid = fork();
+  if (pid == 0) {
+    pthread_sigmask(SIG_SETMASK, &mask, nullptr);
+    role();
+    _exit(EXIT_FAILURE);
+  }
+  if (pid < 0) {
+    LOG_ERROR("Could not fork a worker process: " + std::string(strerror(errno)));
+  }
+  return pid;
+}
+
+// warms up the state the workers read once, then forks a process for the http server and the
+// proxies and processes of workers that share that state. a process that dies is forked again,
+// a hangup swaps the tile extract of the supervisor and is passed on to the worker processes and
+// a terminate or interrupt is passed on to all of them before exiting
+int supervise(boost::property_tree::ptree config,
+              const std::string& config_file,
+              size_t processes,
+              size_t worker_concurrency) {
+  // the processes only talk to each other over ipc or tcp
+  for (const auto& key : {"httpd.service.loopback", "httpd.service.interrupt", "loki.service.proxy",
+                          "thor.service.proxy", "odin.service.proxy"}) {
+    if (config.get<std::string>(key).find("inproc://") == 0) {
+      LOG_ERROR(std::string(key) + " must not be inproc:// to run more than one process");
+      return EXIT_FAILURE;
+    }
+  }
+
+  // the metrics are those of the workers of one process, which the server process has none of
+  if (!config.get<std::string>("httpd.service.metrics", "").empty()) {
+    LOG_WARN("httpd.service.metrics is not served by more than one process");
+    config.put("httpd.service.metrics", "");
+  }
+
+  // every worker of a process reads the same tiles, so unless the config already shares a thread
+  // safe cache they share the sharded one which the supervisor fills before forking
+  if (!config.get<bool>("mjolnir.global_synchronized_cache", false)) {
+    config.put("mjolnir.use_sharded_tile_cache", true);
+  }
+
+  // the supervisor only ever waits for signals, the processes it forks get them as usual
+  sigset_t original, waited;
+  sigemptyset(&waited);
+  for (auto signal : {SIGCHLD, SIGHUP, SIGINT, SIGTERM}) {
+    sigaddset(&waited, signal);
+  }
+  pthread_sigmask(SIG_BLOCK, &waited, &original);
+
+  // nothing may have started a thread or a zmq context before forking
+  warm_up(config);
+  bool swaps = config.get_optional<std::string>("mjolnir.tile_extract").is_initialized();
+  auto server = [&config]() {
+    signal(SIGHUP, SIG_IGN);
+    zmq::context_t context;
+    start_server(context, config).join();
+  };
+  auto workers = [&config, &config_file, swaps, worker_concurrency]() {
+    if (swaps) {
+      swap_tiles_on_hangup(config_file);
+    }
+    start_workers(config, worker_concurrency);
+    while (true) {
+      pause();
+    }
+  };
+
+  // which processes are running and what they run
+  std::unordered_map<pid_t, bool> running;
+  auto server_pid = spawn(server, original);
+  if (server_pid > 0) {
+    running.emplace(server_pid, false);
+  }
+  for (size_t i = 0; i < processes; ++i) {
+    auto pid = spawn(workers, original);
+    if (pid > 0) {
+      running.emplace(pid, true);
+    }
+  }
+  LOG_INFO("Started " + std::to_string(processes) + " worker processes with " +
+           std::to_string(worker_concurrency) + " workers per layer each");
+
+  while (true) {
+    int signal;
+    if (sigwait(&waited, &signal) != 0) {
+      continue;
+    }
+    if (signal == SIGCHLD) {
+      // fork whatever died again, unless it was asked to stop
+      int status;
+      pid_t pid;
+      while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        auto found = running.find(pid);
+        if (found == running.cend()) {
+          continue;
+        }
+        auto worker = found->second;
+        running.erase(found);
+        if (WIFSIGNALED(status) && (WTERMSIG(status) == SIGINT || WTERMSIG(status) == SIGTERM)) {
+          continue;
+        }
+        LOG_WARN("Process " + std::to_string(pid) + " exited, forking it again");
+        auto again = spawn(worker ? std::function<void()>(workers) : server, original);
+        if (again > 0) {
+          running.emplace(again, worker);
+        }
+      }
+    } else if (signal == SIGHUP) {
+      // processes forked from now on start from the new extract, the running ones swap to it
+      if (swaps) {
+        try {
+          boost::property_tree::ptree swapped;
+          rapidjson::read_json(config_file, swapped);
+          valhalla::baldr::GraphReader::SwapTileExtract(swapped.get_child("mjolnir"));
+        } catch (const std::exception& e) {
+          LOG_ERROR("Tile extract swap failed: " + std::string(e.what()));
+        }
+        for (const auto& process : running) {
+          if (process.second) {
+            kill(process.first, SIGHUP);
+          }
+        }
+      }
+    } else {
+      for (const auto& process : running) {
+        kill(process.first, SIGTERM);
+      }
+      for (const auto& process : running) {
+        waitpid(process.first, nullptr, 0);
+      }
+      return EXIT_SUCCESS;
+    }
+  }
+}
+
+} // namespace
 
 int main(int argc, char** argv) {
 
@@ -35,16 +341,8 @@ int main(int argc, char** argv) {
   boost::property_tree::ptree config;
   rapidjson::read_json(config_file, config);
 
-  // grab the endpoints
-  std::string listen = config.get<std::string>("httpd.service.listen");
-  std::string loopback = config.get<std::string>("httpd.service.loopback");
-  std::string interrupt = config.get<std::string>("httpd.service.interrupt");
-  std::string loki_proxy = config.get<std::string>("loki.service.proxy");
-  std::string thor_proxy = config.get<std::string>("thor.service.proxy");
-  std::string odin_proxy = config.get<std::string>("odin.service.proxy");
-  // TODO: add multipoint accumulator worker
-
   // check the server endpoint
+  std::string listen = config.get<std::string>("httpd.service.listen");
   if (listen.find("tcp://") != 0) {
     if (listen.find("ipc://") != 0) {
       LOG_ERROR("You must listen on either tcp://ip:port or ipc://some_socket_file");
@@ -64,47 +362,28 @@ int main(int argc, char** argv) {
     valhalla::midgard::logging::Configure(logging_config);
   }
 
-  // number of workers to use at each stage
-  auto worker_concurrency = std::thread::hardware_concurrency();
+  // number of workers to use at each stage, split between the worker processes if there are more
+  auto processes = std::max(config.get<size_t>("httpd.service.processes", 1), size_t(1));
+  size_t worker_concurrency =
+      std::max(std::thread::hardware_concurrency() / processes, size_t(1));
   if (argc > 2) {
     worker_concurrency = std::stoul(argv[2]);
   }
 
-  // setup the cluster within this process
-  zmq::context_t context;
-  std::thread server_thread =
-      std::thread(std::bind(&http_server_t::serve, http_server_t(context, listen, loki_proxy + "_in",
-                                                                 loopback, interrupt, true)));
-
-  // loki layer
-  std::thread loki_proxy_thread(
-      std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
-  loki_proxy_thread.detach();
-  std::list<std::thread> loki_worker_threads;
-  for (size_t i = 0; i < worker_concurrency; ++i) {
-    loki_worker_threads.emplace_back(valhalla::loki::run_service, config);
-    loki_worker_threads.back().detach();
+  // a supervisor forks the server and the worker processes from its warmed up state
+  if (processes > 1) {
+    return supervise(config, config_file, processes, worker_concurrency);
   }
 
-  // thor layer
-  std::thread thor_proxy_thread(
-      std::bind(&proxy_t::forward, proxy_t(context, thor_proxy + "_in", thor_proxy + "_out")));
-  thor_proxy_thread.detach();
-  std::list<std::thread> thor_worker_threads;
-  for (size_t i = 0; i < worker_concurrency; ++i) {
-    thor_worker_threads.emplace_back(valhalla::thor::run_service, config);
-    thor_worker_threads.back().detach();
+  // new tile extracts can be swapped in while serving
+  if (config.get_optional<std::string>("mjolnir.tile_extract")) {
+    swap_tiles_on_hangup(config_file);
   }
 
-  // odin layer
-  std::thread odin_proxy_thread(
-      std::bind(&proxy_t::forward, proxy_t(context, odin_proxy + "_in", odin_proxy + "_out")));
-  odin_proxy_thread.detach();
-  std::list<std::thread> odin_worker_threads;
-  for (size_t i = 0; i < worker_concurrency; ++i) {
-    odin_worker_threads.emplace_back(valhalla::odin::run_service, config);
-    odin_worker_threads.back().detach();
-  }
+  // setup the cluster within this process
+  zmq::context_t context;
+  std::thread server_thread = start_server(context, config);
+  start_workers(config, worker_concurrency);
 
   // TODO: add multipoint accumulator
 
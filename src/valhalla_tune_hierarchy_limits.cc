@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "loki/worker.h"
+#include "midgard/aabb2.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "thor/bidirectional_astar.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// The pairs of a region and how each candidate did on them
+struct region_t {
+  std::string name;
+  bool everywhere;
+  AABB2<PointLL> bbox;
+  size_t pairs = 0;
+  uint64_t unlimited_popped = 0;
+  std::vector<size_t> good;
+  std::vector<uint64_t> popped;
+};
+
+std::vector<double> split(const std::string& text) {
+  std::vector<double> values;
+  std::stringstream ss(text);
+  std::string value;
+  while (std::getline(ss, value, ',')) {
+    values.push_back(std::stod(value));
+  }
+  return values;
+}
+
+std::string to_json(const PointLL& a, const PointLL& b) {
+  std::stringstream ss;
+  ss << std::setprecision(7) << "[{\"lat\":" << a.lat() << ",\"lon\":" << a.lng()
+     << "},{\"lat\":" << b.lat() << ",\"lon\":" << b.lng() << "}]";
+  return ss.str();
+}
+
+// The limits of the costing scaled by a candidate factor, unlimited levels stay unlimited
+std::vector<HierarchyLimits> scale(std::vector<HierarchyLimits> limits, const double factor) {
+  for (auto& limit : limits) {
+    if (limit.max_up_transitions != kUnlimitedTransitions) {
+      limit.max_up_transitions = static_cast<uint32_t>(limit.max_up_transitions * factor);
+    }
+    if (limit.expansion_within_dist != kMaxDistance) {
+      limit.expansion_within_dist = static_cast<float>(limit.expansion_within_dist * factor);
+    }
+  }
+  return limits;
+}
+
+// Runs one search with the given limits and returns what it cost and how much work it did
+bool search(BidirectionalAStar& astar,
+            Api& request,
+            GraphReader& reader,
+            const std::shared_ptr<DynamicCost>* mode_costing,
+            const TravelMode mode,
+            const std::vector<HierarchyLimits>& limits,
+            float& cost,
+            uint64_t& popped) {
+  mode_costing[static_cast<uint32_t>(mode)]->GetHierarchyLimits() = limits;
+  auto& locations = *request.mutable_options()->mutable_locations();
+  auto paths = astar.GetBestPath(locations[0], locations[1], reader, mode_costing, mode,
+                                 request.options());
+  popped = astar.queue_stats().popped;
+  astar.Clear();
+  if (paths.empty() || paths.front().empty()) {
+    return false;
+  }
+  cost = paths.front().back().elapsed_cost;
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  std::string config_file, costing_name, factors_text;
+  std::vector<std::string> region_texts, pair_files;
+  float tolerance, quality;
+
+  bpo::options_description options(
+      "valhalla " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_tune_hierarchy_limits [options] <od_pairs_file>...\n"
+      "\n"
+      "valhalla_tune_hierarchy_limits routes logged origin and destination pairs with the "
+      "bidirectional A* both without hierarchy limits and with the limits of the costing scaled "
+      "by each candidate factor. Per region it picks the candidate that settles the fewest labels "
+      "while enough of the pairs cost no more than the tolerance over the unlimited search, and "
+      "writes the tuned limits under thor.hierarchy_limits of the config or prints them. Every "
+      "line of a pairs file is an origin and a destination as lat,lon,lat,lon."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")(
+      "version,v", "Print the version of this software.")(
+      "config,c", bpo::value<std::string>(&config_file)->required(),
+      "Path to the json configuration file.")(
+      "costing", bpo::value<std::string>(&costing_name)->default_value("auto"),
+      "Costing to tune the limits of.")(
+      "region,r", bpo::value<std::vector<std::string>>(&region_texts),
+      "Region to tune separately as min_lon,min_lat,max_lon,max_lat, can be repeated. Pairs "
+      "outside of every region tune the limits used everywhere else.")(
+      "factors", bpo::value<std::string>(&factors_text)->default_value("0.25,0.5,1,2,4"),
+      "Candidate factors to scale the limits of the costing by.")(
+      "tolerance", bpo::value<float>(&tolerance)->default_value(0.01f),
+      "How much more than the unlimited search a path may cost, relative to its cost.")(
+      "quality", bpo::value<float>(&quality)->default_value(0.99f),
+      "Fraction of the pairs of a region that must be within the tolerance.")(
+      "write,w", "Write the tuned limits into the config instead of printing them.")(
+      "pairs", bpo::value<std::vector<std::string>>(&pair_files)->required(),
+      "Files of origin and destination pairs.");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("pairs", -1);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+
+    if (vm.count("help")) {
+      std::cout << options << "\n";
+      return EXIT_SUCCESS;
+    }
+
+    if (vm.count("version")) {
+      std::cout << "valhalla_tune_hierarchy_limits " << VALHALLA_VERSION << "\n";
+      return EXIT_SUCCESS;
+    }
+
+    bpo::notify(vm);
+
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<double> factors = split(factors_text);
+  std::vector<region_t> regions;
+  for (const auto& text : region_texts) {
+    auto corners = split(text);
+    if (corners.size() != 4) {
+      std::cerr << "A region needs min_lon,min_lat,max_lon,max_lat: " << text << std::endl;
+      return EXIT_FAILURE;
+    }
+    regions.push_back(
+        {text, false, AABB2<PointLL>(corners[0], corners[1], corners[2], corners[3])});
+  }
+  regions.push_back({"everywhere else", true, {}});
+  for (auto& region : regions) {
+    region.good.resize(factors.size(), 0);
+    region.popped.resize(factors.size(), 0);
+  }
+
+  // Failed searches log, only the results should show up
+  logging::Configure({{"type", ""}});
+
+  boost::property_tree::ptree config;
+  rapidjson::read_json(config_file, config);
+  auto reader = std::make_shared<GraphReader>(config.get_child("mjolnir"));
+  loki_worker_t loki_worker(config, reader);
+
+  CostFactory<DynamicCost> factory;
+  factory.RegisterStandardCostingModels();
+  std::shared_ptr<DynamicCost> mode_costing[4];
+  TravelMode mode = TravelMode::kDrive;
+  std::vector<HierarchyLimits> limits, unlimited;
+  BidirectionalAStar astar;
+
+  size_t skipped = 0;
+  for (const auto& pair_file : pair_files) {
+    std::ifstream file(pair_file);
+    std::string line;
+    while (std::getline(file, line)) {
+      auto coordinates = split(line);
+      if (coordinates.size() != 4) {
+        ++skipped;
+        continue;
+      }
+      PointLL origin(coordinates[1], coordinates[0]), destination(coordinates[3], coordinates[2]);
+      Api request;
+      try {
+        ParseApi(R"({"costing":")" + costing_name + R"(","locations":)" +
+                     to_json(origin, destination) + "}",
+                 Options::route, request);
+        loki_worker.route(request);
+      } catch (const std::exception&) {
+        ++skipped;
+        continue;
+      }
+
+      // The limits of the costing are what the candidates scale
+      if (limits.empty()) {
+        auto costing = factory.Create(request.options().costing(), request.options());
+        mode = costing->travel_mode();
+        mode_costing[static_cast<uint32_t>(mode)] = costing;
+        limits = unlimited = costing->GetHierarchyLimits();
+        for (auto& limit : unlimited) {
+          limit.max_up_transitions = kUnlimitedTransitions;
+          limit.expansion_within_dist = kMaxDistance;
+        }
+      }
+
+      float best;
+      uint64_t popped;
+      if (!search(astar, request, *reader, mode_costing, mode, unlimited, best, popped)) {
+        ++skipped;
+        continue;
+      }
+      auto region = std::find_if(regions.begin(), regions.end(), [&](const region_t& region) {
+        return region.everywhere ||
+               (region.bbox.Contains(origin) && region.bbox.Contains(destination));
+      });
+      ++region->pairs;
+      region->unlimited_popped += popped;
+      for (size_t i = 0; i < factors.size(); ++i) {
+        float cost;
+        if (search(astar, request, *reader, mode_costing, mode, scale(limits, factors[i]), cost,
+                   popped) &&
+            cost <= best * (1.0f + tolerance)) {
+          ++region->good[i];
+        }
+        region->popped[i] += popped;
+      }
+    }
+  }
+
+  // The candidate of each region that does the least work with enough good paths
+  std::cerr << std::left << std::setw(40) << "region" << std::right << std::setw(8) << "pairs"
+            << std::setw(10) << "factor" << std::setw(10) << "good" << std::setw(12) << "work"
+            << std::endl;
+  rapidjson::Document tuned;
+  tuned.SetArray();
+  auto& allocator = tuned.GetAllocator();
+  for (const auto& region : regions) {
+    int pick = -1;
+    for (size_t i = 0; i < factors.size(); ++i) {
+      if (region.pairs != 0 && region.good[i] >= quality * region.pairs &&
+          (pick < 0 || region.popped[i] < region.popped[pick])) {
+        pick = i;
+      }
+    }
+    if (pick < 0) {
+      if (region.pairs != 0) {
+        std::cerr << std::left << std::setw(40) << region.name << std::right << std::setw(8)
+                  << region.pairs << "  no candidate is good enough" << std::endl;
+      }
+      continue;
+    }
+    std::cerr << std::left << std::setw(40) << region.name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(8) << region.pairs << std::setw(10)
+              << factors[pick] << std::setw(10)
+              << static_cast<double>(region.good[pick]) / region.pairs << std::setw(12)
+              << static_cast<double>(region.popped[pick]) /
+                     std::max(region.unlimited_popped, uint64_t(1))
+              << std::endl;
+
+    rapidjson::Value entry(rapidjson::kObjectType), ups(rapidjson::kArrayType),
+        dists(rapidjson::kArrayType);
+    if (!region.everywhere) {
+      rapidjson::Value bbox(rapidjson::kArrayType);
+      bbox.PushBack(region.bbox.minx(), allocator).PushBack(region.bbox.miny(), allocator);
+      bbox.PushBack(region.bbox.maxx(), allocator).PushBack(region.bbox.maxy(), allocator);
+      entry.AddMember("bbox", bbox, allocator);
+    }
+    for (const auto& limit : scale(limits, factors[pick])) {
+      ups.PushBack(limit.max_up_transitions, allocator);
+      dists.PushBack(limit.expansion_within_dist, allocator);
+    }
+    entry.AddMember("max_up_transitions", ups, allocator);
+    entry.AddMember("expansion_within_dist", dists, allocator);
+    tuned.PushBack(entry, allocator);
+  }
+  if (skipped != 0) {
+    std::cerr << skipped << " pairs could not be routed and were skipped" << std::endl;
+  }
+
+  // Replace the limits of the costing in the config or print them
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+  if (vm.count("write")) {
+    rapidjson::Document document;
+    std::ifstream in(config_file);
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (document.Parse(json.c_str()).HasParseError()) {
+      std::cerr << "Unable to parse " << config_file << std::endl;
+      return EXIT_FAILURE;
+    }
+    rapidjson::Pointer("/thor/hierarchy_limits/" + costing_name)
+        .Set(document, rapidjson::Value(tuned, document.GetAllocator()));
+    document.Accept(writer);
+    std::ofstream(config_file) << buffer.GetString() << std::endl;
+  } else {
+    tuned.Accept(writer);
+    std::cout << buffer.GetString() << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,12 +1,22 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
+#include <vector>
+
+#include <google/protobuf/arena.h>
 
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
 #include "baldr/location.h"
+#include "midgard/aabb2.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/pointll.h"
 #include "midgard/util.h"
 #include "odin/util.h"
 #include "sif/costfactory.h"
@@ -18,6 +28,9 @@ using namespace prime_server;
 #endif
 
 namespace {
+// The most memory the arena of the requests keeps from one job to the next
+constexpr size_t kMaxArenaBlockSize = 16 * 1024 * 1024;
+
 // Credits: http://werkzeug.pocoo.org/
 const std::unordered_map<unsigned, std::string> HTTP_STATUS_CODES{
     // 1xx
@@ -92,17 +105,20 @@ const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
 
     {120, 400}, {121, 400}, {122, 400}, {123, 400}, {124, 400}, {125, 400}, {126, 400},
 
-    {130, 400}, {131, 400}, {132, 400}, {133, 400}, {136, 400},
+    {130, 400}, {131, 400}, {132, 400}, {133, 400}, {136, 400}, {137, 400}, {138, 400},
 
     {140, 400}, {141, 501}, {142, 501},
 
     {150, 400}, {151, 400}, {152, 400}, {153, 400}, {154, 400}, {155, 400}, {156, 400},
     {157, 400}, {158, 400}, {159, 400},
 
-    {160, 400}, {161, 400}, {162, 400}, {163, 400}, {164, 400},
+    {160, 400}, {161, 400}, {162, 400}, {163, 400}, {164, 400}, {165, 400}, {166, 400}, {167, 400},
+    {168, 400}, {169, 400},
 
     {170, 400}, {171, 400}, {172, 400},
 
+    {180, 504}, {181, 503},
+
     {199, 400},
 
     {200, 500}, {201, 500}, {202, 500},
@@ -117,7 +133,7 @@ const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
 
     {304, 404}, {305, 501},
 
-    {310, 400}, {311, 400}, {312, 400}, {313, 400}, {314, 400},
+    {310, 400}, {311, 400}, {312, 400}, {313, 400}, {314, 400}, {315, 400}, {316, 400},
 
     {399, 400},
 
@@ -170,6 +186,10 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
     {136,
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {137,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {138,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
 
     {140,
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
@@ -205,6 +225,14 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
     {164,
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {165,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {166,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {167,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {168,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
 
     {170, R"({"code":"NoRoute","message":"Impossible route between points"})"},
     {171,
@@ -240,6 +268,8 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
     {313, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
     {314,
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {315, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
+    {316, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
 
     {399, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
 
@@ -278,9 +308,38 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
 
     {599, R"({"code":"InvalidUrl","message":"URL string is invalid."})"}};
 
+// How much memory a thread keeps for the values of the requests it parses, when a request needs
+// more it is allocated and freed again when the next one is parsed
+constexpr size_t kParsePoolSize = 64 * 1024;
+
+// The memory a thread parses its requests in. The json is copied into a string, which keeps its
+// capacity from one request to the next, and parsed in place so the strings of the document point
+// into it. The values are allocated from a pool that starts out on a block of our own
+struct parse_memory_t {
+  std::string json;
+  std::unique_ptr<char[]> block;
+  rapidjson::MemoryPoolAllocator<> allocator;
+  parse_memory_t() : block(new char[kParsePoolSize]), allocator(block.get(), kParsePoolSize) {
+  }
+};
+
+// Parse json into a document whose memory belongs to this thread, so that parsing a request does
+// not allocate. The document can only be used until the next one is parsed on this thread
+rapidjson::Document parse_in_place(const char* json, size_t size) {
+  static thread_local std::unique_ptr<parse_memory_t> memory(new parse_memory_t());
+  memory->allocator.Clear();
+  rapidjson::Document d(&memory->allocator);
+  if (json == nullptr) {
+    d.SetObject();
+    return d;
+  }
+  memory->json.assign(json, size);
+  d.ParseInsitu(&memory->json[0]);
+  return d;
+}
+
 rapidjson::Document from_string(const std::string& json, const valhalla_exception_t& e) {
-  rapidjson::Document d;
-  d.Parse(json.c_str());
+  auto d = parse_in_place(json.data(), json.size());
   if (d.HasParseError()) {
     throw e;
   }
@@ -508,6 +567,86 @@ void parse_contours(const rapidjson::Document& doc,
   }
 }
 
+// Each avoid polygon is a ring of [lon, lat] pairs or an object with the ring as its coordinates
+// and a name, which lets loki reuse what it found under the polygon for other requests
+void parse_avoid_polygons(const rapidjson::Document& doc, Options& options) {
+  auto json_polygons =
+      rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/avoid_polygons");
+  if (!json_polygons) {
+    return;
+  }
+  for (const auto& json_polygon : *json_polygons) {
+    auto* polygon = options.add_avoid_polygons();
+    const rapidjson::Value* ring = &json_polygon;
+    if (json_polygon.IsObject()) {
+      auto name = rapidjson::get_optional<std::string>(json_polygon, "/name");
+      if (name) {
+        polygon->set_name(*name);
+      }
+      auto coordinates = rapidjson::get_child_optional(json_polygon, "/coordinates");
+      ring = coordinates ? &*coordinates : nullptr;
+    }
+    if (!ring || !ring->IsArray() || ring->Size() < 3) {
+      throw valhalla_exception_t{138};
+    }
+    for (const auto& coordinate : ring->GetArray()) {
+      if (!coordinate.IsArray() || coordinate.Size() < 2 || !coordinate[0].IsNumber() ||
+          !coordinate[1].IsNumber() || coordinate[1].GetDouble() < -90.0 ||
+          coordinate[1].GetDouble() > 90.0) {
+        throw valhalla_exception_t{138};
+      }
+      auto* point = polygon->add_points();
+      point->set_lng(midgard::circular_range_clamp<float>(coordinate[0].GetDouble(), -180, 180));
+      point->set_lat(coordinate[1].GetDouble());
+    }
+  }
+}
+
+void parse_height_shapes(const rapidjson::Document& doc, Options& options) {
+  auto json_shapes = rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/shapes");
+  if (json_shapes) {
+    for (const auto& json_shape : *json_shapes) {
+      if (!json_shape.IsObject()) {
+        throw valhalla_exception_t{315};
+      }
+      auto* shape = options.add_height_shapes();
+      auto encoded_polyline = rapidjson::get_optional<std::string>(json_shape, "/encoded_polyline");
+      auto points = rapidjson::get_optional<rapidjson::Value::ConstArray>(json_shape, "/shape");
+      if (encoded_polyline) {
+        shape->set_encoded_polyline(*encoded_polyline);
+        for (const auto& ll : midgard::decode<std::vector<midgard::PointLL>>(*encoded_polyline)) {
+          auto* point = shape->add_points();
+          point->set_lng(ll.lng());
+          point->set_lat(ll.lat());
+        }
+      } else if (points) {
+        for (const auto& json_point : *points) {
+          auto lat = rapidjson::get_optional<double>(json_point, "/lat");
+          auto lon = rapidjson::get_optional<double>(json_point, "/lon");
+          if (!lat || !lon || *lat < -90.0 || *lat > 90.0) {
+            throw valhalla_exception_t{315};
+          }
+          auto* point = shape->add_points();
+          point->set_lng(midgard::circular_range_clamp<float>(*lon, -180, 180));
+          point->set_lat(*lat);
+        }
+      }
+      if (shape->points_size() == 0) {
+        throw valhalla_exception_t{315};
+      }
+    }
+  }
+
+  auto height_encoding = rapidjson::get_optional<std::string>(doc, "/height_encoding");
+  if (height_encoding) {
+    Options::HeightEncoding encoding;
+    if (!Options_HeightEncoding_Enum_Parse(*height_encoding, &encoding)) {
+      throw valhalla_exception_t{316};
+    }
+    options.set_height_encoding(encoding);
+  }
+}
+
 void from_json(rapidjson::Document& doc, Options& options) {
   bool track = !options.has_do_not_track() || !options.do_not_track();
 
@@ -531,6 +670,18 @@ void from_json(rapidjson::Document& doc, Options& options) {
   if (fmt && Options_Format_Enum_Parse(*fmt, &format)) {
     options.set_format(format);
   }
+  // only the routes, the matrix and columnar trace attributes have a protobuf output
+  options.set_columnar(options.action() == Options::trace_attributes &&
+                       rapidjson::get(doc, "/columnar", false));
+  if (options.format() == Options::pbf && options.action() != Options::route &&
+      options.action() != Options::optimized_route && options.action() != Options::trace_route &&
+      options.action() != Options::sources_to_targets && !options.columnar()) {
+    throw valhalla_exception_t{167};
+  }
+  // and only the expansion has a feature per line
+  if (options.format() == Options::ndjson && options.action() != Options::expansion) {
+    throw valhalla_exception_t{167};
+  }
 
   auto id = rapidjson::get_optional<std::string>(doc, "/id");
   if (id) {
@@ -552,7 +703,7 @@ void from_json(rapidjson::Document& doc, Options& options) {
   }
 
   auto language = rapidjson::get_optional<std::string>(doc, "/language");
-  if (language && odin::get_locales().find(*language) != odin::get_locales().end()) {
+  if (language && odin::has_locale(*language)) {
     options.set_language(*language);
   }
 
@@ -568,6 +719,23 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_directions_type(directions_type);
   }
 
+  // if specified, only narrate these instructions, asking for none of them is asking for maneuvers
+  auto instruction_types =
+      rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/instruction_types");
+  if (instruction_types) {
+    for (const auto& instruction_type : *instruction_types) {
+      Options::InstructionType type;
+      if (!instruction_type.IsString() ||
+          !Options_InstructionType_Enum_Parse(instruction_type.GetString(), &type)) {
+        throw valhalla_exception_t{168};
+      }
+      options.add_instruction_types(type);
+    }
+    if (instruction_types->Empty() && options.directions_type() == DirectionsType::instructions) {
+      options.set_directions_type(DirectionsType::maneuvers);
+    }
+  }
+
   // date_time
   auto date_time_type = rapidjson::get_optional<unsigned int>(doc, "/date_time/type");
   auto date_time_value = rapidjson::get_optional<std::string>(doc, "/date_time/value");
@@ -627,6 +795,9 @@ void from_json(rapidjson::Document& doc, Options& options) {
     }
   }
 
+  // the many shapes of a batched height request
+  parse_height_shapes(doc, options);
+
   // Begin time for timestamps when entered given durations/delta times (defaults to 0)
   auto t = rapidjson::get_optional<unsigned int>(doc, "/begin_time");
   double begin_time = 0.0;
@@ -693,6 +864,45 @@ void from_json(rapidjson::Document& doc, Options& options) {
     }
   }
 
+  // if specified, get the matrix engine for sources_to_targets
+  auto matrix_algorithm = rapidjson::get_optional<std::string>(doc, "/matrix_algorithm");
+  if (matrix_algorithm) {
+    Options::MatrixAlgorithm algorithm;
+    if (!Options_MatrixAlgorithm_Enum_Parse(*matrix_algorithm, &algorithm)) {
+      throw valhalla_exception_t{165};
+    }
+    options.set_matrix_algorithm(algorithm);
+  }
+
+  // if specified, whether the costs are the same both ways so a matrix among the same locations
+  // needs half of the searches
+  auto symmetric = rapidjson::get_optional<bool>(doc, "/symmetric");
+  if (symmetric) {
+    options.set_symmetric(*symmetric);
+  }
+
+  // if specified, the seconds beyond which matrix pairs are not searched for
+  auto max_time = rapidjson::get_optional<double>(doc, "/max_time");
+  if (max_time) {
+    if (!(*max_time > 0)) {
+      throw valhalla_exception_t{137};
+    }
+    options.set_max_time(static_cast<float>(std::min(*max_time, 1e9)));
+  }
+
+  // if specified, whether the matrix only has the pairs that were reached
+  options.set_sparse(rapidjson::get(doc, "/sparse", false));
+
+  // if specified, get the optimizer for optimized_route
+  auto optimizer = rapidjson::get_optional<std::string>(doc, "/optimizer");
+  if (optimizer) {
+    Options::OptimizerMethod method;
+    if (!Options_OptimizerMethod_Enum_Parse(*optimizer, &method)) {
+      throw valhalla_exception_t{166};
+    }
+    options.set_optimizer(method);
+  }
+
   // TODO: remove this?
   options.set_do_not_track(rapidjson::get_optional<bool>(doc, "/healthcheck").get_value_or(false));
 
@@ -700,6 +910,19 @@ void from_json(rapidjson::Document& doc, Options& options) {
 
   options.set_verbose(rapidjson::get(doc, "/verbose", false));
 
+  options.set_statistics(rapidjson::get(doc, "/statistics", false));
+
+  // how many seconds the client waits for the response, after that the work is abandoned
+  auto timeout = rapidjson::get_optional<double>(doc, "/timeout");
+  if (timeout) {
+    if (!(*timeout > 0)) {
+      throw valhalla_exception_t{169};
+    }
+    // a timeout of decades is still no reason to overflow
+    options.set_deadline(microseconds_since_epoch() +
+                         static_cast<uint64_t>(std::min(*timeout, 1e9) * 1e6));
+  }
+
   // costing
   auto costing_str = rapidjson::get_optional<std::string>(doc, "/costing");
   if (costing_str) {
@@ -788,6 +1011,7 @@ void from_json(rapidjson::Document& doc, Options& options) {
 
   // get the avoids in there
   parse_locations(doc, options, "avoid_locations", 133, track);
+  parse_avoid_polygons(doc, options);
 
   // if not a time dependent route/mapmatch disable time dependent edge speed/flow data sources
   // TODO: this is because bidirectional a* defaults to middle of the day time for speed lookup
@@ -814,6 +1038,22 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_polygons(*polygons);
   }
 
+  // if specified, get the batch boolean in there
+  auto batch = rapidjson::get_optional<bool>(doc, "/batch");
+  if (batch) {
+    options.set_batch(*batch);
+  }
+
+  // if specified, whether the isochrones are the time from the locations, to them or both
+  auto direction = rapidjson::get_optional<std::string>(doc, "/direction");
+  if (direction) {
+    Options::IsochroneDirection isochrone_direction;
+    if (!Options_IsochroneDirection_Enum_Parse(*direction, &isochrone_direction)) {
+      throw valhalla_exception_t{166};
+    }
+    options.set_isochrone_direction(isochrone_direction);
+  }
+
   // if specified, get the denoise in there
   auto denoise = rapidjson::get_optional<float>(doc, "/denoise");
   if (denoise) {
@@ -1022,6 +1262,8 @@ bool Options_Format_Enum_Parse(const std::string& format, Options::Format* f) {
       {"json", Options::json},
       {"gpx", Options::gpx},
       {"osrm", Options::osrm},
+      {"pbf", Options::pbf},
+      {"ndjson", Options::ndjson},
   };
   auto i = formats.find(format);
   if (i == formats.cend())
@@ -1036,6 +1278,8 @@ const std::string& Options_Format_Enum_Name(const Options::Format match) {
       {Options::json, "json"},
       {Options::gpx, "gpx"},
       {Options::osrm, "osrm"},
+      {Options::pbf, "pbf"},
+      {Options::ndjson, "ndjson"},
   };
   auto i = formats.find(match);
   return i == formats.cend() ? empty : i->second;
@@ -1086,6 +1330,72 @@ bool DirectionsType_Enum_Parse(const std::string& dtype, DirectionsType* t) {
   return true;
 }
 
+bool Options_MatrixAlgorithm_Enum_Parse(const std::string& algorithm,
+                                        Options::MatrixAlgorithm* a) {
+  static const std::unordered_map<std::string, Options::MatrixAlgorithm> algorithms{
+      {"costmatrix", Options::costmatrix},
+      {"timedistancematrix", Options::timedistancematrix},
+      {"bucket", Options::bucket},
+  };
+  auto i = algorithms.find(algorithm);
+  if (i == algorithms.cend())
+    return false;
+  *a = i->second;
+  return true;
+}
+
+bool Options_OptimizerMethod_Enum_Parse(const std::string& method, Options::OptimizerMethod* m) {
+  static const std::unordered_map<std::string, Options::OptimizerMethod> methods{
+      {"anneal", Options::anneal},
+      {"local_search", Options::local_search},
+  };
+  auto i = methods.find(method);
+  if (i == methods.cend())
+    return false;
+  *m = i->second;
+  return true;
+}
+
+bool Options_IsochroneDirection_Enum_Parse(const std::string& direction,
+                                            Options::IsochroneDirection* d) {
+  static const std::unordered_map<std::string, Options::IsochroneDirection> directions{
+      {"from", Options::from_locations},
+      {"to", Options::to_locations},
+      {"both", Options::from_and_to_locations},
+  };
+  auto i = directions.find(direction);
+  if (i == directions.cend())
+    return false;
+  *d = i->second;
+  return true;
+}
+
+bool Options_HeightEncoding_Enum_Parse(const std::string& encoding, Options::HeightEncoding* e) {
+  static const std::unordered_map<std::string, Options::HeightEncoding> encodings{
+      {"array", Options::height_array},
+      {"polyline", Options::height_polyline},
+  };
+  auto i = encodings.find(encoding);
+  if (i == encodings.cend())
+    return false;
+  *e = i->second;
+  return true;
+}
+
+bool Options_InstructionType_Enum_Parse(const std::string& type, Options::InstructionType* t) {
+  static const std::unordered_map<std::string, Options::InstructionType> types{
+      {"text_instruction", Options::text_instruction},
+      {"verbal_transition_alert_instruction", Options::verbal_transition_alert_instruction},
+      {"verbal_pre_transition_instruction", Options::verbal_pre_transition_instruction},
+      {"verbal_post_transition_instruction", Options::verbal_post_transition_instruction},
+  };
+  auto i = types.find(type);
+  if (i == types.cend())
+    return false;
+  *t = i->second;
+  return true;
+}
+
 bool PreferredSide_Enum_Parse(const std::string& pside, valhalla::Location::PreferredSide* p) {
   static const std::unordered_map<std::string, valhalla::Location::PreferredSide> types{
       {"either", valhalla::Location::either},
@@ -1126,19 +1436,18 @@ void ParseApi(const http_request_t& request, valhalla::Api& api) {
     throw valhalla_exception_t{101};
   };
 
-  rapidjson::Document document;
-  auto& allocator = document.GetAllocator();
   // parse the input
   const auto& json = request.query.find("json");
+  const std::string* input = nullptr;
   if (json != request.query.end() && json->second.size() && json->second.front().size()) {
-    document.Parse(json->second.front().c_str());
+    input = &json->second.front();
     // no json parameter, check the body
   } else if (!request.body.empty()) {
-    document.Parse(request.body.c_str());
-    // no json at all
-  } else {
-    document.SetObject();
+    input = &request.body;
   }
+  // no json at all is an empty object
+  auto document = parse_in_place(input ? input->data() : nullptr, input ? input->size() : 0);
+  auto& allocator = document.GetAllocator();
   // if parsing failed
   if (document.HasParseError()) {
     throw valhalla_exception_t{100};
@@ -1187,8 +1496,27 @@ const headers_t::value_type JSON_MIME{"Content-type", "application/json;charset=
 const headers_t::value_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
 const headers_t::value_type XML_MIME{"Content-type", "text/xml;charset=utf-8"};
 const headers_t::value_type GPX_MIME{"Content-type", "application/gpx+xml;charset=utf-8"};
+const headers_t::value_type PBF_MIME{"Content-type", "application/x-protobuf"};
+const headers_t::value_type NDJSON_MIME{"Content-type", "application/x-ndjson;charset=utf-8"};
 const headers_t::value_type ATTACHMENT{"Content-Disposition", "attachment; filename=route.gpx"};
 
+// percent encodes all but the unreserved characters of a query
+std::string url_encode(const std::string& text) {
+  static const char* hex = "0123456789ABCDEF";
+  std::string encoded;
+  encoded.reserve(text.size());
+  for (unsigned char c : text) {
+    if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      encoded.push_back(c);
+    } else {
+      encoded.push_back('%');
+      encoded.push_back(hex[c >> 4]);
+      encoded.push_back(hex[c & 15]);
+    }
+  }
+  return encoded;
+}
+
 worker_t::result_t jsonify_error(const valhalla_exception_t& exception,
                                  http_request_info_t& request_info,
                                  const Api& request) {
@@ -1265,43 +1593,342 @@ to_response(const baldr::json::MapPtr& map, http_request_info_t& request_info, c
   return result;
 }
 
+worker_t::result_t to_redirect(const std::string& url,
+                               const http_request_t& request,
+                               http_request_info_t& request_info) {
+  std::string location = url + request.path;
+  char separator = '?';
+  for (const auto& kv : request.query) {
+    for (const auto& value : kv.second) {
+      location += separator + url_encode(kv.first) + '=' + url_encode(value);
+      separator = '&';
+    }
+  }
+  worker_t::result_t result{false, std::list<std::string>(), ""};
+  http_response_t response(307, "Temporary Redirect", "", headers_t{CORS, {"Location", location}});
+  response.from_info(request_info);
+  result.messages.emplace_back(response.to_string());
+  return result;
+}
+
 worker_t::result_t
 to_response_json(const std::string& json, http_request_info_t& request_info, const Api& request) {
-  std::ostringstream stream;
-  // jsonp callback if need be
-  if (request.options().has_jsonp()) {
-    stream << request.options().jsonp() << '(';
-  }
-  stream << json;
+  worker_t::result_t result{false, std::list<std::string>(), ""};
+  // jsonp callback if need be, otherwise the json is used as is since it can be huge
   if (request.options().has_jsonp()) {
-    stream << ')';
+    std::string jsonp;
+    jsonp.reserve(request.options().jsonp().size() + json.size() + 2);
+    jsonp.append(request.options().jsonp()).append(1, '(').append(json).append(1, ')');
+    http_response_t response(200, "OK", jsonp, headers_t{CORS, JS_MIME});
+    response.from_info(request_info);
+    result.messages.emplace_back(response.to_string());
+  } else {
+    http_response_t response(200, "OK", json,
+                             headers_t{CORS, request.options().format() == Options::ndjson
+                                                 ? NDJSON_MIME
+                                                 : JSON_MIME});
+    response.from_info(request_info);
+    result.messages.emplace_back(response.to_string());
   }
+  return result;
+}
 
+worker_t::result_t
+to_response_xml(const std::string& xml, http_request_info_t& request_info, const Api&) {
   worker_t::result_t result{false, std::list<std::string>(), ""};
-  http_response_t response(200, "OK", stream.str(),
-                           headers_t{CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME});
+  http_response_t response(200, "OK", xml, headers_t{CORS, GPX_MIME, ATTACHMENT});
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
   return result;
 }
 
 worker_t::result_t
-to_response_xml(const std::string& xml, http_request_info_t& request_info, const Api&) {
+to_response_pbf(const std::string& pbf, http_request_info_t& request_info, const Api&) {
   worker_t::result_t result{false, std::list<std::string>(), ""};
-  http_response_t response(200, "OK", xml, headers_t{CORS, GPX_MIME, ATTACHMENT});
+  http_response_t response(200, "OK", pbf, headers_t{CORS, PBF_MIME});
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
   return result;
 }
 
+worker_t::result_t
+to_response(const std::string& response, http_request_info_t& request_info, const Api& request) {
+  switch (request.options().format()) {
+    case Options::gpx:
+      return to_response_xml(response, request_info, request);
+    case Options::pbf:
+      return to_response_pbf(response, request_info, request);
+    default:
+      return to_response_json(response, request_info, request);
+  }
+}
+
 #endif
 
-service_worker_t::service_worker_t() : interrupt(nullptr) {
+namespace {
+
+// upper bounds in seconds, making a costing takes from microseconds up to parsing big avoids
+const std::vector<double> kCostingBuckets = {0.00001, 0.00005, 0.0001, 0.0005,
+                                             0.001,   0.005,   0.01,   0.05};
+
+} // namespace
+
+service_metrics_t::service_metrics_t(const std::string& service)
+    : service(service),
+      wait(midgard::metrics::GetHistogram("valhalla_queue_wait_seconds",
+                                          "Time a request waited for the stage to pick it up",
+                                          midgard::metrics::kLatencyBuckets,
+                                          {{"service", service}})),
+      costing_construction(
+          midgard::metrics::GetHistogram("valhalla_costing_construction_seconds",
+                                         "Time taken to make the costing of a request",
+                                         kCostingBuckets, {{"service", service}})),
+      cache_hits(midgard::metrics::GetCounter("valhalla_result_cache_total",
+                                              "Lookups of request results in the result cache",
+                                              {{"service", service}, {"result", "hit"}})),
+      cache_misses(midgard::metrics::GetCounter("valhalla_result_cache_total",
+                                                "Lookups of request results in the result cache",
+                                                {{"service", service}, {"result", "miss"}})) {
+}
+
+void service_metrics_t::request(const Api& request, double seconds) {
+  // look the histogram of an action up once, after that counting is lock free
+  auto action = request.options().action();
+  auto found = durations.find(action);
+  if (found == durations.end()) {
+    auto& histogram =
+        midgard::metrics::GetHistogram("valhalla_request_duration_seconds",
+                                       "Time a stage worked on a request",
+                                       midgard::metrics::kLatencyBuckets,
+                                       {{"service", service},
+                                        {"action", Options_Action_Enum_Name(action)}});
+    found = durations.emplace(action, &histogram).first;
+  }
+  found->second->observe(seconds);
+}
+
+void service_metrics_t::queue_wait(Api& request) {
+  if (!request.has_forwarded_at()) {
+    return;
+  }
+  // the clocks of stages on different machines can be a bit off
+  auto now = microseconds_since_epoch();
+  auto waited = now > request.forwarded_at() ? now - request.forwarded_at() : 0;
+  wait.observe(waited * 1e-6);
+  request.clear_forwarded_at();
+}
+
+void service_metrics_t::costing(double seconds) {
+  costing_construction.observe(seconds);
+}
+
+void service_metrics_t::cache(bool hit) {
+  (hit ? cache_hits : cache_misses).add();
+}
+
+uint64_t microseconds_since_epoch() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+float estimate_cost(const Options& options) {
+  using locations_t = google::protobuf::RepeatedPtrField<valhalla::Location>;
+  const auto point = [](const valhalla::Location& location) {
+    return midgard::PointLL(location.ll().lng(), location.ll().lat());
+  };
+  // from one location to the next
+  const auto length = [&point](const locations_t& locations) {
+    float meters = 0;
+    for (int i = 1; i < locations.size(); ++i) {
+      meters += point(locations.Get(i - 1)).Distance(point(locations.Get(i)));
+    }
+    return meters / 1000;
+  };
+  // the diagonal of the box around the locations
+  const auto extent = [&point](const std::vector<const locations_t*>& lists) {
+    midgard::AABB2<midgard::PointLL> box;
+    bool empty = true;
+    for (const auto* locations : lists) {
+      for (const auto& location : *locations) {
+        if (empty) {
+          box = {point(location), point(location)};
+          empty = false;
+        } else {
+          box.Expand(point(location));
+        }
+      }
+    }
+    return empty ? 0.f : box.minpt().Distance(box.maxpt()) / 1000;
+  };
+
+  switch (options.action()) {
+    case Options::route:
+    case Options::expansion:
+      return length(options.locations());
+    case Options::trace_route:
+    case Options::trace_attributes:
+      return length(options.shape());
+    case Options::sources_to_targets:
+    case Options::optimized_route: {
+      auto searches = options.sources_size() + options.targets_size();
+      if (!searches) {
+        searches = options.locations_size() * 2;
+      }
+      return searches * extent({&options.sources(), &options.targets(), &options.locations()});
+    }
+    case Options::isochrone: {
+      float minutes = 0;
+      for (const auto& contour : options.contours()) {
+        minutes = std::max(minutes, contour.time());
+      }
+      return options.locations_size() * minutes;
+    }
+    default:
+      return 0;
+  }
+}
+
+// The requests of a lane that are worked on and waiting, shared by the workers of a stage
+struct admission_t::lane_t {
+  std::mutex lock;
+  std::condition_variable turn;
+  uint32_t concurrency;
+  uint32_t queue;
+  uint32_t running = 0;
+  uint32_t waiting = 0;
+};
+
+admission_t::ticket_t::~ticket_t() {
+  if (lane) {
+    std::lock_guard<std::mutex> lock(lane->lock);
+    --lane->running;
+    lane->turn.notify_one();
+  }
+}
+
+admission_t::admission_t(const boost::property_tree::ptree& config, const std::string& service)
+    : batch_cost(config.get<float>("httpd.service.batch_cost", 0.f)),
+      refused(midgard::metrics::GetCounter("valhalla_requests_refused_total",
+                                           "Batch requests turned away because their lane and "
+                                           "its queue were full",
+                                           {{"service", service}})),
+      wait(midgard::metrics::GetHistogram("valhalla_lane_wait_seconds",
+                                          "Time a batch request waited for a turn in its lane",
+                                          midgard::metrics::kLatencyBuckets,
+                                          {{"service", service}})) {
+  // lanes are never removed so the workers can keep a pointer to theirs
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::unique_ptr<lane_t>> lanes;
+  std::lock_guard<std::mutex> guard(lock);
+  auto& found = lanes[service];
+  if (!found) {
+    found.reset(new lane_t());
+    found->concurrency = std::max(config.get<uint32_t>("httpd.service.batch_concurrency", 1), 1u);
+    found->queue = config.get<uint32_t>("httpd.service.batch_queue", 0);
+  }
+  lane = found.get();
+}
+
+admission_t::ticket_t admission_t::admit(Api& request, const std::function<void()>& interrupt) {
+  auto& options = *request.mutable_options();
+  if (!options.has_cost()) {
+    options.set_cost(estimate_cost(options));
+  }
+  if (batch_cost <= 0 || options.cost() <= batch_cost) {
+    return ticket_t();
+  }
+
+  std::unique_lock<std::mutex> lock(lane->lock);
+  if (lane->running < lane->concurrency) {
+    ++lane->running;
+    return ticket_t(lane);
+  }
+  if (lane->waiting >= lane->queue) {
+    refused.add();
+    throw valhalla_exception_t{181};
+  }
+
+  // wait for a turn, checking every now and then that the request is still wanted
+  auto start = std::chrono::steady_clock::now();
+  ++lane->waiting;
+  try {
+    while (lane->running >= lane->concurrency) {
+      if (lane->turn.wait_for(lock, std::chrono::milliseconds(100)) == std::cv_status::timeout) {
+        if (options.deadline() && microseconds_since_epoch() >= options.deadline()) {
+          throw valhalla_exception_t{180};
+        }
+        interrupt();
+      }
+    }
+  } catch (...) {
+    --lane->waiting;
+    throw;
+  }
+  --lane->waiting;
+  ++lane->running;
+  wait.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  return ticket_t(lane);
+}
+
+std::string forward(Api& request) {
+  request.set_forwarded_at(microseconds_since_epoch());
+  return request.SerializeAsString();
+}
+
+// The arena of the requests, its first block is ours so it is kept from one job to the next
+struct service_worker_t::arena_t {
+  std::vector<char> block;
+  std::unique_ptr<google::protobuf::Arena> arena;
+};
+
+// What the interrupt of the workers checks, the one of the server and the deadline of the request
+struct service_worker_t::interrupt_t {
+  const std::function<void()>* server = nullptr;
+  uint64_t deadline = 0;
+  std::function<void()> check;
+};
+
+service_worker_t::service_worker_t()
+    : interrupt(nullptr), arena(std::make_shared<arena_t>()),
+      interrupts(std::make_shared<interrupt_t>()) {
+  auto* state = interrupts.get();
+  state->check = [state]() {
+    if (state->server) {
+      (*state->server)();
+    }
+    if (state->deadline && microseconds_since_epoch() >= state->deadline) {
+      throw valhalla_exception_t{180};
+    }
+  };
+  interrupt = &interrupts->check;
 }
 service_worker_t::~service_worker_t() {
 }
+Api& service_worker_t::new_request() {
+  // Grow the first block to what the last job needed and free the rest of its blocks
+  if (arena->arena) {
+    auto allocated = static_cast<size_t>(arena->arena->SpaceAllocated());
+    arena->arena.reset();
+    if (allocated > arena->block.size()) {
+      arena->block.resize(std::min(allocated, kMaxArenaBlockSize));
+    }
+  }
+  google::protobuf::ArenaOptions options;
+  options.initial_block = arena->block.empty() ? nullptr : arena->block.data();
+  options.initial_block_size = arena->block.size();
+  arena->arena.reset(new google::protobuf::Arena(options));
+  return *google::protobuf::Arena::CreateMessage<Api>(arena->arena.get());
+}
 void service_worker_t::set_interrupt(const std::function<void()>& interrupt_function) {
-  interrupt = &interrupt_function;
+  interrupts->server = &interrupt_function;
+}
+void service_worker_t::set_deadline(const uint64_t deadline) {
+  interrupts->deadline = deadline;
+  // there is no point in starting on a request whose client stopped waiting in the queue
+  if (deadline && microseconds_since_epoch() >= deadline) {
+    throw valhalla_exception_t{180};
+  }
 }
 
 } // namespace valhalla
@@ -1,11 +1,14 @@
 #include "test.h"
 
+#include <fstream>
 #include <stdexcept>
 
 #include "baldr/rapidjson_utils.h"
 #include <boost/property_tree/ptree.hpp>
 
 #include "tyr/actor.h"
+#include "tyr/batch.h"
+#include "worker.h"
 
 #if !defined(VALHALLA_SOURCE_DIR)
 #define VALHALLA_SOURCE_DIR
@@ -118,6 +121,133 @@ void test_interrupt() {
   // TODO: test the rest of them
 }
 
+void test_deadline() {
+  auto conf = make_conf();
+  tyr::actor_t actor(conf);
+  const std::string locations =
+      R"("locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+        {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto")";
+
+  // with time to spare it routes as usual
+  Api request;
+  ParseApi("{" + locations + R"(,"timeout":60})", Options::route, request);
+  if (!request.options().has_deadline())
+    throw std::logic_error("Expected the timeout to give the request a deadline");
+  actor.act(request);
+
+  // a request picked up after its deadline is not worked on
+  ParseApi("{" + locations + R"(,"timeout":60})", Options::route, request);
+  request.mutable_options()->set_deadline(1);
+  try {
+    actor.act(request);
+    throw std::logic_error("Expected the request past its deadline to be abandoned");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 180 || e.http_code != 504)
+      throw std::logic_error("Expected the request past its deadline to time out");
+  }
+
+  // the timeout is in seconds and has to be positive
+  try {
+    actor.route("{" + locations + R"(,"timeout":-1})");
+    throw std::logic_error("Expected a negative timeout to be rejected");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 169)
+      throw std::logic_error("Expected a negative timeout to be invalid");
+  }
+}
+
+void test_compute() {
+  auto conf = make_conf();
+  tyr::actor_t actor(conf, true);
+  const std::string locations =
+      R"("locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+        {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto")";
+
+  // a route comes back as its trip and directions
+  Api request;
+  ParseApi("{" + locations + "}", Options::route, request);
+  actor.compute(request);
+  if (request.trip().routes_size() != 1 || request.trip().routes(0).legs_size() != 1 ||
+      request.directions().routes_size() != 1 ||
+      request.directions().routes(0).legs(0).maneuver_size() != 2)
+    throw std::logic_error("Expected the route to be in the request");
+
+  // a matrix as its times and distances, the same as in the json
+  ParseApi(R"({"sources":[{"lat":40.546115,"lon":-76.385076}],
+      "targets":[{"lat":40.546115,"lon":-76.385076},{"lat":40.544232,"lon":-76.385752}],
+      "costing":"auto"})",
+           Options::sources_to_targets, request);
+  actor.compute(request);
+  if (request.matrix().times_size() != 2 || request.matrix().distances_size() != 2 ||
+      request.matrix().times(0) != 0 || request.matrix().times(1) == 0 ||
+      request.matrix().distances(1) <= 0.f)
+    throw std::logic_error("Expected the matrix to be in the request");
+  auto matrix = json_to_pt(actor.matrix(R"({"sources":[{"lat":40.546115,"lon":-76.385076}],
+      "targets":[{"lat":40.546115,"lon":-76.385076},{"lat":40.544232,"lon":-76.385752}],
+      "costing":"auto"})"));
+  auto time = matrix.get_child("sources_to_targets").front().second.back().second.get<uint32_t>(
+      "time");
+  if (time != request.matrix().times(1))
+    throw std::logic_error("Expected the matrix to have the same times as the json one");
+
+  // the rest only have json
+  ParseApi("{" + locations + "}", Options::locate, request);
+  try {
+    actor.compute(request);
+    throw std::logic_error("Expected locate to have no protobuf output");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 167)
+      throw std::logic_error("Expected locate to have an unsupported format");
+  }
+}
+
+void test_batch() {
+  // the requests of a batch can be the json alone or the -j lines of test_requests
+  std::string route = R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},)"
+                      R"({"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"})";
+  std::string back = R"({"locations":[{"lat":40.544232,"lon":-76.385752,"type":"break"},)"
+                     R"({"lat":40.546115,"lon":-76.385076,"type":"break"}],"costing":"auto"})";
+  std::string unknown = R"({"locations":[{"lat":40.546115,"lon":-76.385076}],"costing":"auto"})";
+  {
+    std::ofstream file("test/batch_requests.txt");
+    file << route << "\n-j '" << back << "'\n\n" << unknown << "\n-j '" << route << "'\n";
+  }
+  auto requests = tyr::read_batch("test/batch_requests.txt");
+  if (requests != std::vector<std::string>{route, back, unknown, route})
+    throw std::logic_error("Expected the json of every line with a request");
+
+  // the responses should be the ones the requests get one after the other
+  auto conf = make_conf();
+  tyr::actor_t actor(conf, true);
+  auto expected = actor.route(route);
+  auto expected_back = actor.route(back);
+  auto results = tyr::run_batch(conf, Options::route, requests, 3);
+  if (results.size() != requests.size())
+    throw std::logic_error("Expected a result per request");
+  if (!results[0].ok || results[0].response != expected || !results[1].ok ||
+      results[1].response != expected_back || !results[3].ok || results[3].response != expected)
+    throw std::logic_error("Expected the batch to give the responses in the order of the requests");
+
+  // a bad request gets its error without stopping the others
+  auto error = json_to_pt(results[2].response);
+  if (results[2].ok || error.get<unsigned>("error_code") != 120 ||
+      error.get<unsigned>("http_code") != 400)
+    throw std::logic_error("Expected the request with one location to fail");
+
+  std::stringstream responses, timings;
+  tyr::write_batch(results, &responses, &timings);
+  std::string line;
+  size_t lines = 0;
+  while (std::getline(responses, line))
+    ++lines;
+  if (lines != results.size())
+    throw std::logic_error("Expected a line per response");
+  std::getline(timings, line);
+  if (line != "request,ok,milliseconds" || !std::getline(timings, line) ||
+      line.find("0,true,") != 0)
+    throw std::logic_error("Expected the timings as csv");
+}
+
 } // namespace
 
 int main() {
@@ -127,5 +257,11 @@ int main() {
 
   suite.test(TEST_CASE(test_interrupt));
 
+  suite.test(TEST_CASE(test_deadline));
+
+  suite.test(TEST_CASE(test_compute));
+
+  suite.test(TEST_CASE(test_batch));
+
   return suite.tear_down();
 }
@@ -0,0 +1,182 @@
+#include "test.h"
+#include "worker.h"
+
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <boost/property_tree/ptree.hpp>
+
+using namespace valhalla;
+
+namespace {
+
+boost::property_tree::ptree make_config(float batch_cost, uint32_t concurrency, uint32_t queue) {
+  boost::property_tree::ptree config;
+  config.put("httpd.service.batch_cost", batch_cost);
+  config.put("httpd.service.batch_concurrency", concurrency);
+  config.put("httpd.service.batch_queue", queue);
+  return config;
+}
+
+void add_location(google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                  double lng,
+                  double lat) {
+  auto* location = locations.Add();
+  location->mutable_ll()->set_lng(lng);
+  location->mutable_ll()->set_lat(lat);
+}
+
+// a matrix of 2 sources and 2 targets about 11km apart on the equator
+Api make_matrix() {
+  Api request;
+  auto& options = *request.mutable_options();
+  options.set_action(Options::sources_to_targets);
+  add_location(*options.mutable_sources(), 0, 0);
+  add_location(*options.mutable_sources(), 0.05, 0);
+  add_location(*options.mutable_targets(), 0.1, 0);
+  add_location(*options.mutable_targets(), 0.05, 0);
+  return request;
+}
+
+void expect_code(const std::function<void()>& call, unsigned code, const std::string& what) {
+  try {
+    call();
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != code)
+      throw std::runtime_error(what + ": got " + std::to_string(e.code));
+    return;
+  }
+  throw std::runtime_error(what + ": nothing was thrown");
+}
+
+void TestEstimateCost() {
+  Api route;
+  route.mutable_options()->set_action(Options::route);
+  add_location(*route.mutable_options()->mutable_locations(), 0, 0);
+  add_location(*route.mutable_options()->mutable_locations(), 0.1, 0);
+  add_location(*route.mutable_options()->mutable_locations(), 0, 0);
+  auto cost = estimate_cost(route.options());
+  if (cost < 22 || cost > 23)
+    throw std::runtime_error("Expected a route to cost the length of its legs, not " +
+                             std::to_string(cost));
+
+  // every search of a matrix covers the extent of the locations
+  cost = estimate_cost(make_matrix().options());
+  if (cost < 44 || cost > 45)
+    throw std::runtime_error("Expected a matrix to cost its searches times its extent, not " +
+                             std::to_string(cost));
+
+  Api isochrone;
+  isochrone.mutable_options()->set_action(Options::isochrone);
+  add_location(*isochrone.mutable_options()->mutable_locations(), 0, 0);
+  isochrone.mutable_options()->add_contours()->set_time(10);
+  isochrone.mutable_options()->add_contours()->set_time(30);
+  if (estimate_cost(isochrone.options()) != 30)
+    throw std::runtime_error("Expected an isochrone to cost the reach of its longest contour");
+
+  Api locate;
+  locate.mutable_options()->set_action(Options::locate);
+  add_location(*locate.mutable_options()->mutable_locations(), 0, 0);
+  if (estimate_cost(locate.options()) != 0)
+    throw std::runtime_error("Expected locate to cost nothing");
+}
+
+void TestLanes() {
+  admission_t admission(make_config(40, 1, 0), "test_lanes");
+  const std::function<void()> interrupt = []() {};
+
+  // the first request stamps its estimate for the next stages
+  auto batch = make_matrix();
+  auto ticket = admission.admit(batch, interrupt);
+  if (!batch.options().has_cost())
+    throw std::runtime_error("Expected the estimate to be put in the request");
+
+  // the lane is full but cheap requests still get in
+  Api route;
+  route.mutable_options()->set_action(Options::route);
+  add_location(*route.mutable_options()->mutable_locations(), 0, 0);
+  add_location(*route.mutable_options()->mutable_locations(), 0.01, 0);
+  admission.admit(route, interrupt);
+
+  // without a queue the next batch request is turned away
+  auto next = make_matrix();
+  expect_code([&]() { admission.admit(next, interrupt); }, 181,
+              "Expected a full lane to turn batch work away");
+
+  // until the first one is done
+  { auto done = std::move(ticket); }
+  admission.admit(next, interrupt);
+}
+
+void TestQueue() {
+  admission_t admission(make_config(40, 1, 1), "test_queue");
+  const std::function<void()> interrupt = []() {};
+
+  // the waiting request gets its turn when the running one is done
+  auto first = make_matrix();
+  auto ticket = new admission_t::ticket_t(admission.admit(first, interrupt));
+  std::thread release([ticket]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    delete ticket;
+  });
+  auto second = make_matrix();
+  auto waited = admission.admit(second, interrupt);
+  release.join();
+
+  // one may wait, the next is turned away
+  auto third = make_matrix();
+  third.mutable_options()->set_deadline(microseconds_since_epoch() + 200000);
+  std::exception_ptr error;
+  std::thread waiting([&]() {
+    try {
+      expect_code([&]() { admission.admit(third, interrupt); }, 180,
+                  "Expected the wait to end at the deadline");
+    } catch (...) { error = std::current_exception(); }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto fourth = make_matrix();
+  expect_code([&]() { admission.admit(fourth, interrupt); }, 181,
+              "Expected a full queue to turn batch work away");
+  waiting.join();
+  if (error)
+    std::rethrow_exception(error);
+
+  // the interrupt also ends the wait
+  struct test_exception_t {};
+  auto fifth = make_matrix();
+  bool interrupted = false;
+  try {
+    admission.admit(fifth, []() { throw test_exception_t{}; });
+  } catch (const test_exception_t&) { interrupted = true; }
+  if (!interrupted)
+    throw std::runtime_error("Expected the interrupt to end the wait");
+}
+
+void TestDisabled() {
+  // without a batch cost everything gets in
+  admission_t admission(make_config(0, 1, 0), "test_disabled");
+  const std::function<void()> interrupt = []() {};
+  auto first = make_matrix();
+  auto second = make_matrix();
+  auto ticket = admission.admit(first, interrupt);
+  admission.admit(second, interrupt);
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("admission");
+
+  suite.test(TEST_CASE(TestEstimateCost));
+
+  suite.test(TEST_CASE(TestLanes));
+
+  suite.test(TEST_CASE(TestQueue));
+
+  suite.test(TEST_CASE(TestDisabled));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,140 @@
+#include "sif/dynamiccost.h"
+#include "test.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "baldr/directededge.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphtile.h"
+#include "baldr/graphtileheader.h"
+#include "baldr/rapidjson_utils.h"
+#include "sif/autocost.h"
+#include "sif/edgecostcache.h"
+#include "sif/edgelabel.h"
+#include "sif/pedestriancost.h"
+#include "sif/truckcost.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// a tile with nothing but a header and some edges
+struct test_tile : public GraphTile {
+  test_tile(const GraphId& id, const std::vector<DirectedEdge>& edges) : edges(edges) {
+    header.set_graphid(id);
+    header.set_directededgecount(edges.size());
+    header_ = &header;
+    directededges_ = this->edges.data();
+  }
+  GraphTileHeader header;
+  std::vector<DirectedEdge> edges;
+};
+
+// edges out of one node that get allowed or not for all kinds of reasons
+std::vector<DirectedEdge> make_edges() {
+  std::vector<DirectedEdge> edges;
+  for (uint32_t i = 0; i < 12; ++i) {
+    DirectedEdge edge;
+    edge.set_localedgeidx(i);
+    edge.set_length(100 + i * 10);
+    edge.set_speed(20 + i * 5);
+    edge.set_forwardaccess(i % 3 == 0 ? kPedestrianAccess : kAllAccess);
+    if (i == 4)
+      edge.set_surface(Surface::kImpassable);
+    if (i == 5)
+      edge.set_dest_only(true);
+    edges.push_back(edge);
+  }
+  return edges;
+}
+
+// the predecessor comes in on the edge opposing edge 1 and cant turn onto edge 7
+EdgeLabel make_pred() {
+  DirectedEdge edge;
+  edge.set_opp_local_idx(1);
+  edge.set_restrictions(1 << 7);
+  edge.set_forwardaccess(kAllAccess);
+  return {0, {11, 2, 0}, &edge, {}, 0, 0, TravelMode::kDrive, 0};
+}
+
+Options make_options() {
+  Options options;
+  const rapidjson::Document doc;
+  ParseAutoCostOptions(doc, "/costing_options/auto", options.add_costing_options());
+  options.add_costing_options();
+  options.add_costing_options();
+  ParseBusCostOptions(doc, "/costing_options/bus", options.add_costing_options());
+  options.add_costing_options();
+  options.add_costing_options();
+  options.add_costing_options();
+  options.add_costing_options();
+  ParsePedestrianCostOptions(doc, "/costing_options/pedestrian", options.add_costing_options());
+  options.add_costing_options();
+  ParseTruckCostOptions(doc, "/costing_options/truck", options.add_costing_options());
+  return options;
+}
+
+// the allowed edges should be what checking and costing them one at a time gets
+void compare(const cost_ptr_t& costing, const std::string& name, const uint32_t seconds) {
+  test_tile tile({10, 2, 0}, make_edges());
+  const GraphTile* t = &tile;
+  auto pred = make_pred();
+  GraphId edgeid(10, 2, 0);
+  AllowedEdges allowed;
+  costing->GetAllowedEdges(tile.edges.data(), tile.edges.size(), edgeid, pred, t, seconds, allowed);
+
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < tile.edges.size(); ++i, ++edgeid) {
+    bool has_time_restrictions = false;
+    if (!costing->Allowed(&tile.edges[i], pred, t, edgeid, 0, 0, has_time_restrictions))
+      continue;
+    auto cost = seconds == kInvalidSecondsOfWeek ? costing->EdgeCost(&tile.edges[i], t)
+                                                 : costing->EdgeCost(&tile.edges[i], t, seconds);
+    if (n >= allowed.count || allowed.index[n] != i)
+      throw std::logic_error(name + " should have allowed edge " + std::to_string(i));
+    if (allowed.cost[n].cost != cost.cost || allowed.cost[n].secs != cost.secs ||
+        allowed.has_time_restrictions[n] != has_time_restrictions)
+      throw std::logic_error(name + " got the wrong cost for edge " + std::to_string(i));
+    ++n;
+  }
+  if (n != allowed.count || n == 0)
+    throw std::logic_error(name + " allowed the wrong number of edges");
+}
+
+void TestAllowedEdges() {
+  auto options = make_options();
+  compare(CreateAutoCost(Costing::auto_, options), "auto", kConstrainedFlowSecondOfDay);
+  compare(CreateTruckCost(Costing::truck, options), "truck", kConstrainedFlowSecondOfDay);
+  compare(CreatePedestrianCost(Costing::pedestrian, options), "pedestrian",
+          kConstrainedFlowSecondOfDay);
+  // derived from auto but with its own access
+  compare(CreateBusCost(Costing::bus, options), "bus", kConstrainedFlowSecondOfDay);
+}
+
+void TestAllowedEdgesCached() {
+  auto options = make_options();
+  auto costing = CreateAutoCost(Costing::auto_, options);
+  auto cache = std::make_shared<EdgeCostCache>(100);
+  costing->set_edge_cost_cache(cache, EdgeCostCache::Hash(Costing::auto_, options));
+  compare(costing, "cached auto", kInvalidSecondsOfWeek);
+  // only the allowed edges get costed
+  if (cache->size() == 0 || cache->size() >= make_edges().size())
+    throw std::logic_error("Expected the costs to be cached");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("allowededges");
+
+  suite.test(TEST_CASE(TestAllowedEdges));
+
+  suite.test(TEST_CASE(TestAllowedEdgesCached));
+
+  return suite.tear_down();
+}
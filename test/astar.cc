@@ -962,6 +962,39 @@ void test_time_restricted_road_bidirectional() {
   }
 }
 
+void test_alternates() {
+  // Alternates come from the same bidirectional expansion as the best path
+  auto conf = get_conf("utrecht_tiles");
+  route_tester tester(conf);
+  std::string request =
+      R"({"locations":[{"lat":52.09015,"lon":5.06362},{"lat":52.07890,"lon":5.12932}],"costing":"auto","alternates":2})";
+  auto response = tester.test(request);
+
+  const auto& routes = response.trip().routes();
+  if (routes.size() < 1 || routes.size() > 3) {
+    throw std::logic_error("Expected the best path and at most 2 alternates, got " +
+                           std::to_string(routes.size()) + " routes");
+  }
+  for (int i = 0; i < routes.size(); ++i) {
+    if (routes.Get(i).legs_size() != 1) {
+      throw std::logic_error("Each alternate should have 1 leg");
+    }
+    for (int j = 0; j < i; ++j) {
+      if (routes.Get(i).legs(0).shape() == routes.Get(j).legs(0).shape()) {
+        throw std::logic_error("Alternates should differ from the other routes");
+      }
+    }
+  }
+
+  // The best path is the same as without alternates
+  request =
+      R"({"locations":[{"lat":52.09015,"lon":5.06362},{"lat":52.07890,"lon":5.12932}],"costing":"auto"})";
+  auto best = tester.test(request);
+  if (best.trip().routes(0).legs(0).shape() != routes.Get(0).legs(0).shape()) {
+    throw std::logic_error("The first route should be the best path");
+  }
+}
+
 Api route_on_timerestricted(std::string& costing_str, int16_t hour) {
   // Try routing over "Via Montebello" in Rome which is a time restricted road
   // The restriction is
@@ -1075,6 +1108,7 @@ int main() {
   suite.test(TEST_CASE(test_oneway));
   suite.test(TEST_CASE(test_oneway_wrong_way));
   suite.test(TEST_CASE(test_time_restricted_road_bidirectional));
+  suite.test(TEST_CASE(test_alternates));
   suite.test(TEST_CASE(test_time_restricted_road_denied_on_timedep));
   suite.test(TEST_CASE(test_time_restricted_road_allowed_on_timedep));
 
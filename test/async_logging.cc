@@ -0,0 +1,84 @@
+#include "midgard/logging.h"
+#include "midgard/metrics.h"
+#include "test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+size_t work(size_t records) {
+  for (size_t i = 0; i < records; ++i) {
+    LOG_INFO("record " + std::to_string(i));
+  }
+  return records;
+}
+
+void TestAsyncFileLogger() {
+  // get rid of it first so we don't append
+  std::remove("test/async_file_log_test.log");
+
+  // the sink has to be a logger that writes records out
+  try {
+    logging::Configure({{"type", "async"}, {"sink", "async"}});
+    throw std::runtime_error("Configuring an async sink should have thrown");
+  } catch (...) {}
+  // a queue small enough that some records are dropped
+  logging::Configure({{"type", "async"},
+                      {"sink", "file"},
+                      {"file_name", "test/async_file_log_test.log"},
+                      {"queue_size", "16"}});
+
+  // log from a few threads at once
+  std::vector<std::future<size_t>> results;
+  for (size_t i = 0; i < 4; ++i) {
+    results.emplace_back(std::async(std::launch::async, work, 500));
+  }
+  size_t logged = 0;
+  for (auto& result : results) {
+    logged += result.get();
+  }
+
+  // give the writer a chance to catch up
+  auto& dropped = metrics::GetCounter("valhalla_log_records_dropped_total",
+                                      "Log records the async logger had no room for");
+  size_t written = 0, reported = 0;
+  for (int tries = 0; tries < 100 && written + dropped.value() != logged; ++tries) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ifstream file("test/async_file_log_test.log");
+    std::string line;
+    written = reported = 0;
+    while (std::getline(file, line)) {
+      if (line.find(" [INFO] record ") != std::string::npos) {
+        ++written;
+      } else if (line.find(" [WARN] ") != std::string::npos) {
+        reported += std::stoul(line.substr(line.find(" [WARN] ") + 8));
+      }
+    }
+  }
+
+  // every record was either written or counted as dropped
+  if (written + dropped.value() != logged)
+    throw std::runtime_error("Expected " + std::to_string(logged) + " records but " +
+                             std::to_string(written) + " were written and " +
+                             std::to_string(dropped.value()) + " dropped");
+  if (reported != dropped.value())
+    throw std::runtime_error("Expected the dropped records to be logged");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("async_logging");
+
+  suite.test(TEST_CASE(TestAsyncFileLogger));
+
+  return suite.tear_down();
+}
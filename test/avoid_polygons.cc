@@ -0,0 +1,153 @@
+#include "loki/avoid_polygons.h"
+#include "test.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "midgard/aabb2.h"
+#include "sif/autocost.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <stdexcept>
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+using namespace valhalla::sif;
+
+namespace {
+
+boost::property_tree::ptree get_conf() {
+  boost::property_tree::ptree conf;
+  conf.put<std::string>("tile_dir", "test/data/utrecht_tiles");
+  return conf;
+}
+
+// A square around the center of Utrecht
+const AABB2<PointLL> square(5.110, 52.085, 5.125, 52.095);
+
+void add_square(Options& options, const std::string& name = "") {
+  auto* polygon = options.add_avoid_polygons();
+  for (const auto& corner : {PointLL(square.minx(), square.miny()),
+                             PointLL(square.maxx(), square.miny()),
+                             PointLL(square.maxx(), square.maxy()),
+                             PointLL(square.minx(), square.maxy())}) {
+    auto* point = polygon->add_points();
+    point->set_lng(corner.lng());
+    point->set_lat(corner.lat());
+  }
+  if (!name.empty()) {
+    polygon->set_name(name);
+  }
+}
+
+void TestRasterize() {
+  GraphReader reader(get_conf());
+  std::vector<PointLL> ring{{square.minx(), square.miny()},
+                            {square.maxx(), square.miny()},
+                            {square.maxx(), square.maxy()},
+                            {square.minx(), square.maxy()}};
+  auto masks = RasterizeAvoidPolygon(ring, reader);
+  if (masks.empty())
+    throw std::runtime_error("Expected the square to cover some edges");
+
+  // An edge is masked exactly when a part of its shape is within the square
+  size_t masked = 0;
+  for (const auto& tile_mask : masks) {
+    const GraphTile* tile = reader.GetGraphTile(tile_mask.first);
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      auto shape = tile->edgeinfo(tile->directededge(i)->edgeinfo_offset()).shape();
+      bool within = false;
+      for (size_t j = 1; j < shape.size() && !within; ++j) {
+        within = square.Intersects(shape[j - 1], shape[j]);
+      }
+      bool bit = (tile_mask.second[i >> 6] >> (i & 63)) & 1;
+      if (bit != within)
+        throw std::runtime_error("Edge " + std::to_string(i) + " of tile " +
+                                 std::to_string(tile_mask.first.value) + " is masked wrongly");
+      masked += bit;
+    }
+  }
+  if (masked == 0)
+    throw std::runtime_error("Expected masked edges");
+
+  if (!RasterizeAvoidPolygon({ring[0], ring[1]}, reader).empty())
+    throw std::runtime_error("Expected no masks without an area");
+}
+
+void TestCosting() {
+  GraphReader reader(get_conf());
+  Options options;
+  add_square(options);
+  AddAvoidMasks(options, reader, nullptr);
+  if (options.avoid_masks_size() == 0)
+    throw std::runtime_error("Expected avoid masks in the options");
+
+  options.add_costing_options();
+  const rapidjson::Document doc;
+  ParseAutoCostOptions(doc, "/costing_options/auto", options.mutable_costing_options(0));
+  auto costing = CreateAutoCost(Costing::auto_, options);
+  Options unmasked = options;
+  unmasked.clear_avoid_masks();
+  auto unmasked_costing = CreateAutoCost(Costing::auto_, unmasked);
+
+  // The costing avoids the masked edges and nothing else, without the masks it avoids nothing
+  const auto& mask = options.avoid_masks(0);
+  GraphId tile_id(mask.tile_id());
+  for (uint32_t i = 0; i < mask.edges_size() * 64; ++i) {
+    GraphId edgeid(tile_id.tileid(), tile_id.level(), i);
+    bool bit = (mask.edges(i >> 6) >> (i & 63)) & 1;
+    if (costing->IsUserAvoidEdge(edgeid) != bit)
+      throw std::runtime_error("Costing does not follow the avoid mask");
+    if (unmasked_costing->IsUserAvoidEdge(edgeid))
+      throw std::runtime_error("Costing avoids edges without masks");
+  }
+}
+
+void TestCache() {
+  GraphReader reader(get_conf());
+  AvoidMaskCache cache(4);
+
+  // Only named polygons are cached, the same name and points give the same masks
+  Options unnamed;
+  add_square(unnamed);
+  AddAvoidMasks(unnamed, reader, &cache);
+  if (cache.size() != 0)
+    throw std::runtime_error("Expected unnamed polygons not to be cached");
+
+  Options first, second;
+  add_square(first, "center");
+  add_square(second, "center");
+  AddAvoidMasks(first, reader, &cache);
+  AddAvoidMasks(second, reader, &cache);
+  if (cache.size() != 1)
+    throw std::runtime_error("Expected the named polygon to be cached once");
+  if (first.SerializeAsString() != second.SerializeAsString() ||
+      first.avoid_masks_size() != unnamed.avoid_masks_size())
+    throw std::runtime_error("Expected the cached masks to match");
+
+  // Two polygons over the same tiles get one mask per tile
+  Options twice;
+  add_square(twice);
+  add_square(twice, "center");
+  AddAvoidMasks(twice, reader, &cache);
+  if (twice.avoid_masks_size() != unnamed.avoid_masks_size())
+    throw std::runtime_error("Expected one mask per tile");
+
+  if (AvoidMaskCache::Global(0))
+    throw std::runtime_error("Expected no global cache without room");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("avoid_polygons");
+
+  suite.test(TEST_CASE(TestRasterize));
+
+  suite.test(TEST_CASE(TestCosting));
+
+  suite.test(TEST_CASE(TestCache));
+
+  return suite.tear_down();
+}
@@ -51,3 +51,32 @@ test('route: returns an error if request format is wrong', function(assert) {
     assert.end();
   })
 });
+
+test('route: promises resolve with the route and reject with the error', function(assert) {
+  var hersheyRequest = '{"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"}, {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"}';
+  var badRequest = '{"locations":[{"lat":5,"lon":-76.385076,"type":"break"}, {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"}';
+  valhalla.promises.route(hersheyRequest).then((resp) => {
+    const route = JSON.parse(resp);
+    assert.equal(route['trip']['status_message'], 'Found route between points', 'route was found');
+    return valhalla.promises.route(badRequest);
+  }).then(() => {
+    assert.fail('should have rejected');
+  }, (err) => {
+    assert.equal(err.message, '{"error_code":171,"http_code":400,"message":"No suitable edges near location"}', 'rejects with the http and error codes');
+  }).then(() => assert.end());
+});
+
+test('route: concurrent requests are all answered', function(assert) {
+  var hersheyRequest = '{"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"}, {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"}';
+  var parallel = new Valhalla(JSON.stringify(config));
+  var requests = [];
+  for (var i = 0; i < 16; ++i) requests.push(parallel.promises.route(hersheyRequest));
+  Promise.all(requests).then((resps) => {
+    assert.equal(resps.length, 16, 'every request was answered');
+    resps.forEach((resp) => assert.equal(resp, resps[0], 'every actor found the same route'));
+    assert.end();
+  }, (err) => {
+    assert.error(err, 'should not error');
+    assert.end();
+  });
+});
@@ -0,0 +1,231 @@
+#include "baldr/cellpartition.h"
+#include "thor/celloverlay.h"
+#include "test.h"
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace {
+
+constexpr float kUnreachable = 99999999.9999f;
+
+// A grid of one way and two way roads, the cells of level l are squares of 2^(l+1) nodes a side
+std::shared_ptr<CellPartition> make_partition(const uint32_t width,
+                                              const uint32_t height,
+                                              const uint32_t levels,
+                                              std::mt19937& gen) {
+  std::uniform_int_distribution<int> kind(0, 5);
+  auto partition = std::make_shared<CellPartition>();
+  partition->cells.resize(levels);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint32_t node = y * width + x;
+      partition->nodes.push_back(GraphId(node, 2, 0).value);
+      for (uint32_t level = 0; level < levels; ++level) {
+        partition->cells[level].push_back(((y >> (level + 1)) << 16) | (x >> (level + 1)));
+      }
+      const uint32_t right = x + 1 < width ? node + 1 : node;
+      const uint32_t down = y + 1 < height ? node + width : node;
+      for (uint32_t next : {right, down}) {
+        if (next == node) {
+          continue;
+        }
+        int k = kind(gen);
+        if (k != 0) {
+          partition->edges.push_back({partition->edges.size(), node, next});
+        }
+        if (k != 1) {
+          partition->edges.push_back({partition->edges.size(), next, node});
+        }
+      }
+    }
+  }
+  partition->Finish();
+  return partition;
+}
+
+// Random costs for the edges, some of them not allowed
+std::vector<Cost> make_costs(const CellPartition& partition, std::mt19937& gen) {
+  std::uniform_real_distribution<float> cost(1.f, 100.f);
+  std::uniform_int_distribution<int> allowed(0, 19);
+  std::vector<Cost> costs;
+  for (size_t i = 0; i < partition.edges.size(); ++i) {
+    float c = allowed(gen) == 0 ? kUnreachable : cost(gen);
+    costs.emplace_back(c, c * 2.f);
+  }
+  return costs;
+}
+
+// Plain Dijkstra over the edges
+std::vector<float>
+dijkstra(const CellPartition& partition, const std::vector<Cost>& costs, const uint32_t source) {
+  std::vector<float> dist(partition.nodes.size(), std::numeric_limits<float>::infinity());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second]) {
+      continue;
+    }
+    for (uint32_t e = partition.offsets[top.second]; e < partition.offsets[top.second + 1]; ++e) {
+      if (costs[e].cost >= kUnreachable) {
+        continue;
+      }
+      float d = top.first + costs[e].cost;
+      if (d < dist[partition.edges[e].to]) {
+        dist[partition.edges[e].to] = d;
+        queue.emplace(d, partition.edges[e].to);
+      }
+    }
+  }
+  return dist;
+}
+
+void TestPartition() {
+  std::mt19937 gen(11);
+  auto partition = make_partition(8, 8, 2, gen);
+  if (partition->levels() != 2 || partition->offsets.size() != 65 ||
+      partition->offsets.back() != partition->edges.size())
+    throw runtime_error("Unexpected partition layout");
+
+  // Every edge between cells starts and ends at boundary nodes, the others never make one
+  for (uint32_t level = 0; level < partition->levels(); ++level) {
+    std::vector<bool> boundary(partition->nodes.size(), false);
+    for (const auto& edge : partition->edges) {
+      if (partition->cells[level][edge.from] != partition->cells[level][edge.to]) {
+        boundary[edge.from] = boundary[edge.to] = true;
+      }
+    }
+    for (uint32_t node = 0; node < partition->nodes.size(); ++node) {
+      auto index = partition->boundary_index[level][node];
+      if (boundary[node] != (index != kInvalidCellIndex))
+        throw runtime_error("Unexpected boundary node");
+      if (index != kInvalidCellIndex &&
+          partition->boundaries[level].at(partition->cells[level][node])[index] != node)
+        throw runtime_error("Boundary index does not lead back to the node");
+    }
+  }
+}
+
+void TestSearch() {
+  std::mt19937 gen(7);
+  const uint32_t width = 16, height = 12;
+  auto partition = make_partition(width, height, 3, gen);
+  auto costs = make_costs(*partition, gen);
+  CellOverlay overlay(partition, std::vector<Cost>(costs));
+
+  const uint32_t n = width * height;
+  for (uint32_t source = 0; source < n; source += 7) {
+    auto expected = dijkstra(*partition, costs, source);
+    for (uint32_t target = 0; target < n; ++target) {
+      std::vector<uint32_t> path;
+      uint32_t s, t;
+      float cost;
+      bool found = overlay.Search({{source, 0.f}}, {{target, 0.f}}, path, s, t, cost);
+      if (std::isinf(expected[target])) {
+        if (found)
+          throw runtime_error("Found a path where there is none");
+        continue;
+      }
+      if (!found || std::abs(cost - expected[target]) > 0.01f)
+        throw runtime_error("Cell overlay cost differs from Dijkstra");
+
+      // The unpacked path is made of edges leading from source to target
+      uint32_t at = source;
+      float sum = 0.f;
+      for (auto e : path) {
+        if (e >= partition->edges.size() || partition->edges[e].from != at)
+          throw runtime_error("Unpacked path is not contiguous");
+        at = partition->edges[e].to;
+        sum += overlay.edge_cost(e).cost;
+      }
+      if (at != target || std::abs(sum - cost) > 0.01f)
+        throw runtime_error("Unpacked path does not add up to its cost");
+    }
+  }
+
+  // The cheapest pair of seeds wins
+  std::vector<uint32_t> path;
+  uint32_t s, t;
+  float cost;
+  auto from_0 = dijkstra(*partition, costs, 0);
+  auto from_5 = dijkstra(*partition, costs, 5);
+  if (!overlay.Search({{0, 1000.f}, {5, 0.f}}, {{n - 1, 0.f}}, path, s, t, cost) ||
+      std::abs(cost - std::min(from_0[n - 1] + 1000.f, from_5[n - 1])) > 0.01f ||
+      s != (from_0[n - 1] + 1000.f < from_5[n - 1] ? 0 : 1) || t != 0)
+    throw runtime_error("Unexpected seeds used");
+}
+
+void TestCache() {
+  std::mt19937 gen(3);
+  auto partition = make_partition(4, 4, 1, gen);
+  CellOverlayCache cache(2);
+  size_t customized = 0;
+  const auto customize = [&]() {
+    ++customized;
+    return std::make_shared<CellOverlay>(partition, make_costs(*partition, gen));
+  };
+  auto a = cache.Get("a", customize);
+  if (cache.Get("a", customize) != a || customized != 1)
+    throw runtime_error("Expected the cached customization");
+  cache.Get("b", customize);
+  cache.Get("a", customize);
+  cache.Get("c", customize);
+  if (cache.size() != 2 || customized != 3)
+    throw runtime_error("Expected the cache to stay within its size");
+  if (cache.Get("a", customize) != a || customized != 3)
+    throw runtime_error("Expected the least recently used customization to be dropped");
+  cache.Get("b", customize);
+  if (customized != 4)
+    throw runtime_error("Expected the dropped customization to be made again");
+  if (CellOverlayCache::Global(0))
+    throw runtime_error("Expected no global cache without room");
+}
+
+void TestWriteLoad() {
+  std::mt19937 gen(5);
+  auto partition = make_partition(6, 5, 2, gen);
+  partition->write("test/data/celloverlay.bin");
+  auto loaded = CellPartition::load("test/data/celloverlay.bin");
+  if (!loaded || loaded->nodes != partition->nodes || loaded->cells != partition->cells ||
+      loaded->offsets != partition->offsets ||
+      loaded->boundary_index != partition->boundary_index)
+    throw runtime_error("Loaded cell partition differs from the one written");
+  if (loaded->node_index(GraphId(3, 2, 0)) != 3 ||
+      loaded->node_index(GraphId(30, 2, 0)) != kInvalidCellIndex)
+    throw runtime_error("Unexpected node index");
+  if (CellPartition::load("test/data/does_not_exist.bin"))
+    throw runtime_error("Expected no partition for a missing file");
+  if (CellPartition::file_name("tiles") != "tiles/crp/partition.bin")
+    throw runtime_error("Unexpected partition file name");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("celloverlay");
+
+  suite.test(TEST_CASE(TestPartition));
+
+  suite.test(TEST_CASE(TestSearch));
+
+  suite.test(TEST_CASE(TestCache));
+
+  suite.test(TEST_CASE(TestWriteLoad));
+
+  return suite.tear_down();
+}
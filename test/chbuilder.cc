@@ -0,0 +1,242 @@
+#include "baldr/chgraph.h"
+#include "mjolnir/chbuilder.h"
+#include "thor/chmatrix.h"
+#include "thor/chquery.h"
+#include "test.h"
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// A grid of one way and two way roads with random costs
+std::vector<CHEdge> make_grid(const uint32_t width, const uint32_t height, std::mt19937& gen) {
+  std::uniform_real_distribution<float> cost(1.f, 100.f);
+  std::uniform_int_distribution<int> kind(0, 5);
+  std::vector<CHEdge> edges;
+  const auto add = [&edges](uint32_t from, uint32_t to, float c) {
+    edges.push_back(
+        {edges.size(), from, to, c, c * 2.f, c * 10.f, kInvalidCHIndex, kInvalidCHIndex});
+  };
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint32_t node = y * width + x;
+      for (uint32_t next : {x + 1 < width ? node + 1 : node, y + 1 < height ? node + width : node}) {
+        if (next == node) {
+          continue;
+        }
+        int k = kind(gen);
+        if (k != 0) {
+          add(node, next, cost(gen));
+        }
+        if (k != 1) {
+          add(next, node, cost(gen));
+        }
+      }
+    }
+  }
+  return edges;
+}
+
+// Plain Dijkstra over the original edges
+std::vector<float> dijkstra(const uint32_t node_count,
+                            const std::vector<CHEdge>& edges,
+                            const uint32_t source) {
+  std::vector<std::vector<uint32_t>> out(node_count);
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    out[edges[i].from].push_back(i);
+  }
+  std::vector<float> dist(node_count, std::numeric_limits<float>::infinity());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second]) {
+      continue;
+    }
+    for (auto e : out[top.second]) {
+      float d = top.first + edges[e].cost;
+      if (d < dist[edges[e].to]) {
+        dist[edges[e].to] = d;
+        queue.emplace(d, edges[e].to);
+      }
+    }
+  }
+  return dist;
+}
+
+void TestContractedCosts() {
+  std::mt19937 gen(7);
+  const uint32_t width = 12, height = 9, n = width * height;
+  auto original = make_grid(width, height, gen);
+  auto copy = original;
+  auto graph = std::make_shared<CHGraph>(CHBuilder::Contract(n, std::move(copy)));
+  if (graph->ranks.size() != n || graph->up_offsets.size() != n + 1 ||
+      graph->down_offsets.size() != n + 1)
+    throw runtime_error("Unexpected contraction hierarchy layout");
+
+  // Upward edges go to higher ranks, downward edges come from them
+  for (uint32_t v = 0; v < n; ++v) {
+    for (uint32_t i = graph->up_offsets[v]; i < graph->up_offsets[v + 1]; ++i) {
+      const auto& e = graph->edges[graph->up_edges[i]];
+      if (e.from != v || graph->ranks[e.to] <= graph->ranks[v])
+        throw runtime_error("Upward edge does not go up the hierarchy");
+    }
+    for (uint32_t i = graph->down_offsets[v]; i < graph->down_offsets[v + 1]; ++i) {
+      const auto& e = graph->edges[graph->down_edges[i]];
+      if (e.to != v || graph->ranks[e.from] <= graph->ranks[v])
+        throw runtime_error("Downward edge does not come down the hierarchy");
+    }
+  }
+
+  CHQuery query(graph);
+  for (uint32_t source = 0; source < n; source += 5) {
+    auto expected = dijkstra(n, original, source);
+    for (uint32_t target = 0; target < n; ++target) {
+      std::vector<uint32_t> path;
+      uint32_t s, t;
+      float cost;
+      bool found = query.Search({{source, 0.f}}, {{target, 0.f}}, path, s, t, cost);
+      if (std::isinf(expected[target])) {
+        if (found)
+          throw runtime_error("Found a path where there is none");
+        continue;
+      }
+      if (!found || std::abs(cost - expected[target]) > 0.01f)
+        throw runtime_error("Contraction hierarchy cost differs from Dijkstra");
+
+      // The unpacked path is made of original edges leading from source to target
+      uint32_t at = source;
+      float sum = 0.f;
+      for (auto e : path) {
+        if (e >= original.size() || graph->edges[e].from != at)
+          throw runtime_error("Unpacked path is not contiguous");
+        at = graph->edges[e].to;
+        sum += graph->edges[e].cost;
+      }
+      if (at != target || std::abs(sum - cost) > 0.01f)
+        throw runtime_error("Unpacked path does not add up to its cost");
+    }
+  }
+}
+
+void TestSeeds() {
+  // 0 -> 1 -> 2 -> 3 and 4 -> 3, the best seeds are not the cheapest ones
+  std::vector<CHEdge> edges = {{0, 0, 1, 10.f, 10.f, 10.f, kInvalidCHIndex, kInvalidCHIndex},
+                               {1, 1, 2, 10.f, 10.f, 10.f, kInvalidCHIndex, kInvalidCHIndex},
+                               {2, 2, 3, 10.f, 10.f, 10.f, kInvalidCHIndex, kInvalidCHIndex},
+                               {3, 4, 3, 50.f, 50.f, 50.f, kInvalidCHIndex, kInvalidCHIndex}};
+  auto graph = std::make_shared<CHGraph>(CHBuilder::Contract(5, std::move(edges)));
+  CHQuery query(graph);
+  std::vector<uint32_t> path;
+  uint32_t s, t;
+  float cost;
+  if (!query.Search({{4, 0.f}, {0, 5.f}}, {{3, 1.f}, {2, 0.f}}, path, s, t, cost) || s != 1 ||
+      t != 1 || cost != 25.f)
+    throw runtime_error("Expected the path from the second source to the second target");
+  if (query.Search({{3, 0.f}}, {{0, 0.f}}, path, s, t, cost))
+    throw runtime_error("Expected no path against the one way edges");
+}
+
+void TestMatrix() {
+  std::mt19937 gen(11);
+  const uint32_t width = 10, height = 10, n = width * height;
+  auto original = make_grid(width, height, gen);
+  auto copy = original;
+  auto graph = std::make_shared<CHGraph>(CHBuilder::Contract(n, std::move(copy)));
+
+  // Every 7th node is a source, every 3rd a target. One source has two seeds.
+  std::vector<std::vector<CHMatrix::Seed>> sources, targets;
+  for (uint32_t v = 0; v < n; v += 7) {
+    sources.push_back({{v, 0.f, 0.f, 0.f}});
+  }
+  sources.back().push_back({n - 1, 20.f, 40.f, 200.f});
+  for (uint32_t v = 1; v < n; v += 3) {
+    targets.push_back({{v, 0.f, 0.f, 0.f}});
+  }
+
+  CHMatrix matrix(graph);
+  auto td = matrix.Compute(sources, targets, 1e9f);
+  if (td.size() != sources.size() * targets.size())
+    throw runtime_error("Unexpected matrix size");
+  for (uint32_t i = 0; i < sources.size(); ++i) {
+    // Cost along grid edges is secs / 2 and length / 10
+    std::vector<float> expected(n, std::numeric_limits<float>::infinity());
+    for (const auto& seed : sources[i]) {
+      auto dist = dijkstra(n, original, seed.node);
+      for (uint32_t v = 0; v < n; ++v) {
+        expected[v] = std::min(expected[v], dist[v] + seed.cost);
+      }
+    }
+    for (uint32_t j = 0; j < targets.size(); ++j) {
+      const auto& result = td[i * targets.size() + j];
+      float cost = expected[targets[j].front().node];
+      if (std::isinf(cost)) {
+        if (result.time != std::round(kMaxCost))
+          throw runtime_error("Expected no connection");
+        continue;
+      }
+      if (std::abs(result.time - cost * 2.f) > 1.f || std::abs(result.dist - cost * 10.f) > 5.f)
+        throw runtime_error("Bucket matrix differs from Dijkstra");
+    }
+  }
+
+  // A threshold below every cost leaves only the trivial connections
+  td = matrix.Compute({{{5, 0.f, 0.f, 0.f}}}, {{{5, 0.f, 0.f, 0.f}}, {{6, 0.f, 0.f, 0.f}}}, 0.5f);
+  if (td[0].time != 0 || td[1].time != std::round(kMaxCost))
+    throw runtime_error("Expected the threshold to stop the searches");
+}
+
+void TestWriteLoad() {
+  std::mt19937 gen(3);
+  auto graph = CHBuilder::Contract(20, make_grid(5, 4, gen));
+  for (uint64_t i = 0; i < 20; ++i) {
+    graph.nodes.push_back(GraphId(i * 3, 2, 0).value);
+  }
+  graph.costing_options = "options";
+  graph.write("test/data/chbuilder.ch");
+
+  auto loaded = CHGraph::load("test/data/chbuilder.ch");
+  if (!loaded || loaded->costing_options != "options" || loaded->nodes != graph.nodes ||
+      loaded->ranks != graph.ranks || loaded->edges.size() != graph.edges.size() ||
+      loaded->up_edges != graph.up_edges || loaded->down_offsets != graph.down_offsets)
+    throw runtime_error("Loaded contraction hierarchy differs from the one written");
+  if (loaded->node_index(GraphId(9, 2, 0)) != 3 ||
+      loaded->node_index(GraphId(10, 2, 0)) != kInvalidCHIndex)
+    throw runtime_error("Unexpected node index");
+  if (CHGraph::load("test/data/does_not_exist.ch"))
+    throw runtime_error("Expected no graph for a missing file");
+  if (CHGraph::file_name("tiles") != "tiles/ch/auto.ch" ||
+      CHGraph::file_name("tiles", "bicycle") != "tiles/ch/bicycle.ch")
+    throw runtime_error("Expected a file per costing");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("chbuilder");
+
+  suite.test(TEST_CASE(TestContractedCosts));
+
+  suite.test(TEST_CASE(TestSeeds));
+
+  suite.test(TEST_CASE(TestMatrix));
+
+  suite.test(TEST_CASE(TestWriteLoad));
+
+  return suite.tear_down();
+}
@@ -2,6 +2,7 @@
 #include "test.h"
 
 #include <string>
+#include <vector>
 
 namespace {
 
@@ -114,6 +115,79 @@ void fail_inflate() {
     throw std::logic_error("dst should fail");
 }
 
+void buffers() {
+  std::string message;
+  for (int i = 0; i < 10000; ++i)
+    message += "message " + std::to_string(i) + " in a gzipped bottle ";
+
+  // the streams of the thread are reused with each header and level
+  for (bool gzip : {true, false, true}) {
+    for (int level : {Z_BEST_COMPRESSION, Z_BEST_SPEED}) {
+      std::string deflated;
+      if (!valhalla::baldr::deflate(message.data(), message.size(), deflated, level, gzip))
+        throw std::logic_error("Can't deflate the buffer");
+      if (deflated.size() >= message.size())
+        throw std::logic_error("Deflating should make it smaller");
+      if ((valhalla::baldr::gzip_size(deflated.data(), deflated.size()) != 0) != gzip)
+        throw std::logic_error("Only gzip should record the inflated size");
+      if (gzip && valhalla::baldr::gzip_size(deflated.data(), deflated.size()) != message.size())
+        throw std::logic_error("gzip should record the size of the message");
+
+      std::vector<char> inflated;
+      if (!valhalla::baldr::inflate(deflated.data(), deflated.size(), inflated) ||
+          std::string(inflated.begin(), inflated.end()) != message)
+        throw std::logic_error("Growing buffer does not match the message");
+
+      std::vector<char> fixed(message.size());
+      size_t size = fixed.size();
+      if (!valhalla::baldr::inflate(deflated.data(), deflated.size(), fixed.data(), size) ||
+          size != message.size() || std::string(fixed.begin(), fixed.end()) != message)
+        throw std::logic_error("Fixed buffer does not match the message");
+
+      // the callback flavor shares the stream
+      std::string streamed;
+      if (!valhalla::baldr::inflate(std::bind(inflate_src, std::placeholders::_1,
+                                              std::ref(deflated)),
+                                    std::bind(inflate_dst, std::placeholders::_1,
+                                              std::ref(streamed))) ||
+          streamed != message)
+        throw std::logic_error("Streamed buffer does not match the message");
+    }
+  }
+
+  // an empty buffer still makes a stream
+  std::string empty;
+  std::vector<char> inflated{'x'};
+  if (!valhalla::baldr::deflate(nullptr, 0, empty) ||
+      !valhalla::baldr::inflate(empty.data(), empty.size(), inflated) || !inflated.empty())
+    throw std::logic_error("Empty buffer should round trip");
+}
+
+void fail_buffers() {
+  std::string message = "message in a gzipped bottle message in a gzipped bottle";
+  std::string deflated;
+  if (!valhalla::baldr::deflate(message.data(), message.size(), deflated))
+    throw std::logic_error("Can't deflate the buffer");
+
+  // too little room, too little input and not deflated at all
+  std::vector<char> fixed(message.size() - 1);
+  size_t size = fixed.size();
+  if (valhalla::baldr::inflate(deflated.data(), deflated.size(), fixed.data(), size))
+    throw std::logic_error("Should not fit in a smaller buffer");
+  std::vector<char> inflated;
+  if (valhalla::baldr::inflate(deflated.data(), deflated.size() / 2, inflated))
+    throw std::logic_error("Should not inflate a truncated buffer");
+  if (valhalla::baldr::inflate(message.data(), message.size(), inflated) || !inflated.empty())
+    throw std::logic_error("Should not inflate data that was never deflated");
+  if (valhalla::baldr::gzip_size(message.data(), message.size()) != 0)
+    throw std::logic_error("Should not find a size without a gzip header");
+
+  // a failure leaves the stream of the thread usable
+  if (!valhalla::baldr::inflate(deflated.data(), deflated.size(), inflated) ||
+      std::string(inflated.begin(), inflated.end()) != message)
+    throw std::logic_error("Should inflate after a failure");
+}
+
 } // namespace
 
 int main() {
@@ -126,5 +200,9 @@ int main() {
 
   suite.test(TEST_CASE(fail_inflate));
 
+  suite.test(TEST_CASE(buffers));
+
+  suite.test(TEST_CASE(fail_buffers));
+
   return suite.tear_down();
 }
\ No newline at end of file
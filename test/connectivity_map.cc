@@ -0,0 +1,132 @@
+#include "baldr/connectivity_map.h"
+#include "test.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphid.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+std::string tile_dir = "test/data/connectivity_tiles";
+std::string connectivity_file = "test/data/connectivity.bin";
+
+// two neighbouring local tiles, one far from them and a highway tile
+std::vector<GraphId> tiles() {
+  auto first = TileHierarchy::GetGraphId({5.1, 52.1}, 2);
+  return {first, GraphId(first.tileid() + 1, 2, 0), TileHierarchy::GetGraphId({-70.1, -30.1}, 2),
+          TileHierarchy::GetGraphId({5.1, 52.1}, 0)};
+}
+
+// the color map only needs to know which tiles there are so empty files will do
+void make_tiles() {
+  if (filesystem::exists(tile_dir)) {
+    filesystem::remove_all(tile_dir);
+  }
+  for (const auto& id : tiles()) {
+    auto file_name = tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(id);
+    filesystem::create_directories(
+        file_name.substr(0, file_name.find_last_of(filesystem::path::preferred_separator)));
+    std::ofstream file(file_name, std::ios::binary | std::ios::out);
+    file << ' ';
+  }
+}
+
+boost::property_tree::ptree config(const std::string& dir) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", dir);
+  conf.put("connectivity_file", connectivity_file);
+  return conf;
+}
+
+void compare(const connectivity_map_t& expected, const connectivity_map_t& actual) {
+  for (const auto& id : tiles()) {
+    if (expected.get_color(id) != actual.get_color(id))
+      throw std::logic_error("Wrong color for tile " + std::to_string(id.value));
+  }
+  for (uint32_t level = 0; level <= TileHierarchy::levels().rbegin()->first + 1; ++level) {
+    if (expected.has_data(level) != actual.has_data(level))
+      throw std::logic_error("Wrong levels");
+  }
+}
+
+void TestColors() {
+  make_tiles();
+  std::remove(connectivity_file.c_str());
+  connectivity_map_t map(config(tile_dir));
+  auto ids = tiles();
+  if (map.get_color(ids[0]) == 0 || map.get_color(ids[0]) != map.get_color(ids[1]))
+    throw std::logic_error("Neighbouring tiles should be connected");
+  if (map.get_color(ids[0]) == map.get_color(ids[2]))
+    throw std::logic_error("Far apart tiles should not be connected");
+  if (!map.has_data(0) || map.has_data(1) || !map.has_data(2))
+    throw std::logic_error("Expected data for the levels with tiles");
+}
+
+void TestSaveLoad() {
+  connectivity_map_t computed(config(tile_dir), false);
+  computed.save(connectivity_file);
+
+  // there are no tiles in the wrong dir so it can only have come from the file
+  connectivity_map_t loaded(config(tile_dir + "_missing"));
+  compare(computed, loaded);
+
+  // unless we dont want it to
+  connectivity_map_t unloaded(config(tile_dir + "_missing"), false);
+  if (unloaded.has_data(0) || unloaded.has_data(2))
+    throw std::logic_error("Expected no data without tiles");
+}
+
+void TestGlobal() {
+  auto global = connectivity_map_t::Global(config(tile_dir));
+  if (!global || global != connectivity_map_t::Global(config(tile_dir)))
+    throw std::logic_error("The same tiles should share a connectivity map");
+  compare(connectivity_map_t(config(tile_dir), false), *global);
+
+  // other tiles get a map of their own
+  boost::property_tree::ptree missing;
+  missing.put("tile_dir", tile_dir + "_missing");
+  auto other = connectivity_map_t::Global(missing);
+  if (other == global || other->has_data(0) || other->has_data(2))
+    throw std::logic_error("Other tiles should have their own connectivity map");
+}
+
+void TestInvalidFile() {
+  connectivity_map_t computed(config(tile_dir), false);
+
+  // a truncated file is computed from the tiles again
+  {
+    std::ofstream file(connectivity_file, std::ios::binary | std::ios::out | std::ios::trunc);
+    file << "VCONN001 and then some";
+  }
+  connectivity_map_t loaded(config(tile_dir));
+  compare(computed, loaded);
+
+  std::remove(connectivity_file.c_str());
+  filesystem::remove_all(tile_dir);
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("connectivity_map");
+
+  suite.test(TEST_CASE(TestColors));
+
+  suite.test(TEST_CASE(TestSaveLoad));
+
+  suite.test(TEST_CASE(TestGlobal));
+
+  suite.test(TEST_CASE(TestInvalidFile));
+
+  return suite.tear_down();
+}
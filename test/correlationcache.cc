@@ -0,0 +1,106 @@
+#include "loki/correlationcache.h"
+#include "test.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+using namespace valhalla::midgard;
+
+namespace {
+
+PathLocation make_correlation(const Location& location, uint32_t edge_id) {
+  PathLocation correlation(location);
+  correlation.edges.emplace_back(GraphId(edge_id, 2, 0), .5f, location.latlng_, 1.f);
+  return correlation;
+}
+
+void TestGetPut() {
+  CorrelationCache cache(10);
+  Location depot(PointLL(5.1f, 52.1f));
+  auto key = CorrelationCache::Key(depot, "auto");
+  PathLocation result(depot);
+  if (cache.Get(key, 1, depot, result))
+    throw std::logic_error("An empty cache should not have a correlation");
+
+  cache.Put(key, 1, make_correlation(depot, 7));
+  if (!cache.Get(key, 1, depot, result) || cache.size() != 1 || result.edges.size() != 1 ||
+      result.edges.front().id != GraphId(7, 2, 0))
+    throw std::logic_error("The correlation should have been cached");
+
+  // the candidates are given back for the location that was asked for
+  Location named(PointLL(5.1f, 52.1f));
+  named.name_ = "depot 12";
+  if (!cache.Get(CorrelationCache::Key(named, "auto"), 1, named, result) ||
+      result.name_ != "depot 12" || result.edges.size() != 1)
+    throw std::logic_error("The name of a location should not change its correlation");
+
+  // another tile extract version is searched again
+  if (cache.Get(key, 2, depot, result) || cache.size() != 0)
+    throw std::logic_error("A correlation from another version should have been dropped");
+
+  cache.Put(key, 2, make_correlation(depot, 7));
+  cache.Clear();
+  if (cache.Get(key, 2, depot, result) || cache.size() != 0)
+    throw std::logic_error("The cache should have been cleared");
+}
+
+void TestKey() {
+  Location depot(PointLL(5.1f, 52.1f));
+  auto key = CorrelationCache::Key(depot, "auto");
+  if (key != CorrelationCache::Key(Location(PointLL(5.1f, 52.1f)), "auto"))
+    throw std::logic_error("The same location should have the same key");
+  if (key == CorrelationCache::Key(depot, "pedestrian"))
+    throw std::logic_error("Another costing should change the key");
+
+  Location moved(PointLL(5.1001f, 52.1f));
+  Location wider(PointLL(5.1f, 52.1f), Location::StopType::BREAK, 0, 0, 100);
+  Location heading(PointLL(5.1f, 52.1f));
+  heading.heading_ = 90.f;
+  for (const auto& other : {moved, wider, heading}) {
+    if (key == CorrelationCache::Key(other, "auto"))
+      throw std::logic_error("What changes the search should change the key");
+  }
+}
+
+void TestEviction() {
+  CorrelationCache cache(2);
+  Location a(PointLL(5.1f, 52.1f)), b(PointLL(5.2f, 52.1f)), c(PointLL(5.3f, 52.1f));
+  auto key_a = CorrelationCache::Key(a, ""), key_b = CorrelationCache::Key(b, ""),
+       key_c = CorrelationCache::Key(c, "");
+  PathLocation result(a);
+  cache.Put(key_a, 1, make_correlation(a, 1));
+  cache.Put(key_b, 1, make_correlation(b, 2));
+  // using a makes b the least recently used
+  cache.Get(key_a, 1, a, result);
+  cache.Put(key_c, 1, make_correlation(c, 3));
+  if (!cache.Get(key_a, 1, a, result) || cache.Get(key_b, 1, b, result) ||
+      !cache.Get(key_c, 1, c, result) || cache.size() != 2)
+    throw std::logic_error("The least recently used correlation should have been dropped");
+}
+
+void TestGlobal() {
+  if (CorrelationCache::Global(0))
+    throw std::logic_error("A size of 0 should mean no cache");
+  auto cache = CorrelationCache::Global(10);
+  if (!cache || cache != CorrelationCache::Global(20))
+    throw std::logic_error("The global cache should be shared");
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("correlationcache");
+
+  suite.test(TEST_CASE(TestGetPut));
+
+  suite.test(TEST_CASE(TestKey));
+
+  suite.test(TEST_CASE(TestEviction));
+
+  suite.test(TEST_CASE(TestGlobal));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,126 @@
+#include "sif/costingcache.h"
+#include "test.h"
+
+#include <stdexcept>
+
+#include "baldr/rapidjson_utils.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla;
+using namespace valhalla::sif;
+
+namespace {
+
+Options make_options() {
+  Options options;
+  const rapidjson::Document doc;
+  for (int i = 0; i <= static_cast<int>(Costing::truck); ++i) {
+    options.add_costing_options();
+  }
+  ParseAutoCostOptions(doc, "/costing_options/auto",
+                       options.mutable_costing_options(Costing::auto_));
+  ParsePedestrianCostOptions(doc, "/costing_options/pedestrian",
+                             options.mutable_costing_options(Costing::pedestrian));
+  ParseTransitCostOptions(doc, "/costing_options/transit",
+                          options.mutable_costing_options(Costing::transit));
+  return options;
+}
+
+const CostFactory<DynamicCost>& make_factory() {
+  static CostFactory<DynamicCost> factory;
+  factory.RegisterStandardCostingModels();
+  return factory;
+}
+
+// get a costing from the cache counting how many times it had to be made
+cost_ptr_t
+get(CostingCache& cache, const Costing costing, const Options& options, uint32_t& count) {
+  static const auto& factory = make_factory();
+  return cache.Get(costing, options, [&]() {
+    ++count;
+    return factory.Create(costing, options);
+  });
+}
+
+void TestGet() {
+  CostingCache cache(10);
+  auto options = make_options();
+  uint32_t count = 0;
+
+  auto a = get(cache, Costing::auto_, options, count);
+  auto b = get(cache, Costing::auto_, options, count);
+  if (a != b || count != 1)
+    throw std::logic_error("The auto costing should have been reused");
+
+  // another costing or other options make another costing
+  get(cache, Costing::pedestrian, options, count);
+  options.mutable_costing_options(Costing::auto_)->set_use_highways(0.1f);
+  auto c = get(cache, Costing::auto_, options, count);
+  auto* avoid = options.add_avoid_edges();
+  avoid->set_id(1234);
+  avoid->set_percent_along(.5f);
+  auto d = get(cache, Costing::auto_, options, count);
+  if (c == a || d == c || count != 4 || cache.size() != 4)
+    throw std::logic_error("Costings with other options should not have been reused");
+}
+
+void TestReset() {
+  CostingCache cache(10);
+  auto options = make_options();
+  uint32_t count = 0;
+
+  // what a second pass of a route changes should be put back
+  auto a = get(cache, Costing::auto_, options, count);
+  auto limits = a->GetHierarchyLimits();
+  a->set_pass(1);
+  a->set_allow_destination_only(false);
+  a->RelaxHierarchyLimits(16.0f, 4.0f);
+  auto b = get(cache, Costing::auto_, options, count);
+  if (b != a || b->pass() != 0)
+    throw std::logic_error("The pass should have been reset");
+  for (size_t i = 0; i < limits.size(); ++i) {
+    if (b->GetHierarchyLimits()[i].max_up_transitions != limits[i].max_up_transitions ||
+        b->GetHierarchyLimits()[i].expansion_within_dist != limits[i].expansion_within_dist)
+      throw std::logic_error("The hierarchy limits should have been reset");
+  }
+}
+
+void TestNotCached() {
+  auto options = make_options();
+  uint32_t count = 0;
+
+  // transit keeps lists that grow while routing
+  CostingCache cache(10);
+  get(cache, Costing::transit, options, count);
+  get(cache, Costing::transit, options, count);
+  if (count != 2 || cache.size() != 0)
+    throw std::logic_error("Transit costings should not be cached");
+
+  // no room means no cache
+  CostingCache none(0);
+  get(none, Costing::auto_, options, count);
+  get(none, Costing::auto_, options, count);
+  if (count != 4 || none.size() != 0)
+    throw std::logic_error("A cache without room should not cache");
+
+  // a full cache is cleared
+  CostingCache small(1);
+  get(small, Costing::auto_, options, count);
+  get(small, Costing::pedestrian, options, count);
+  if (small.size() != 1)
+    throw std::logic_error("A full cache should have been cleared");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("costingcache");
+
+  suite.test(TEST_CASE(TestGet));
+
+  suite.test(TEST_CASE(TestReset));
+
+  suite.test(TEST_CASE(TestNotCached));
+
+  return suite.tear_down();
+}
@@ -238,6 +238,28 @@ void TestGetDaysFromPivotDate() {
   TryGetDaysFromPivotDate("2015-05-06T08:00", 490);
 }
 
+void TestFormattedDate() {
+  // the dates are read by hand, they have to come out the same as they do from date::parse
+  for (const std::string date :
+       {"2016-11-06T01:00", "2016-11-06", "2016-2-6", "2016-02-29", "2016-11-06T23:59",
+        "2014-01-01T07:01-05:00", "2016-13-01", "2016-02-30", "2016-11-06T24:00", "2014-01-01T",
+        "1999-01-01-T:00:00", "20140101", "Blah", ""}) {
+    std::istringstream in{date};
+    date::local_seconds expected;
+    if (date.find('T') != std::string::npos)
+      in >> date::parse("%FT%R", expected);
+    else if (date.find('-') != std::string::npos)
+      in >> date::parse("%F", expected);
+
+    if (DateTime::get_formatted_date(date) != expected)
+      throw std::runtime_error("Formatted date of " + date + " test failed.  Expected: " +
+                               std::to_string(expected.time_since_epoch().count()) + " but got " +
+                               std::to_string(DateTime::get_formatted_date(date)
+                                                  .time_since_epoch()
+                                                  .count()));
+  }
+}
+
 void TestDOW() {
 
   TryGetDOW("2014-01-01T07:01", kWednesday);
@@ -544,6 +566,34 @@ void TestTimezoneDiff() {
                       "America/New_York");
 }
 
+void TestCachedOffsets() {
+  // offsets and conditions are cached per thread, going back and forth across a transition
+  // or between days has to give the same answers as the first time
+  auto ny = DateTime::get_tz_db().from_index(DateTime::get_tz_db().to_index("America/New_York"));
+  auto phx = DateTime::get_tz_db().from_index(DateTime::get_tz_db().to_index("America/Phoenix"));
+  // New York moves to daylight saving time at 2016-03-13T07:00Z, Phoenix does not
+  for (int i = 0; i < 2; ++i) {
+    if (DateTime::timezone_diff(1457852399, ny, phx) != -7200)
+      throw std::runtime_error("Expected a 2 hour difference before the transition");
+    if (DateTime::timezone_diff(1457852400, ny, phx) != -10800)
+      throw std::runtime_error("Expected a 3 hour difference after the transition");
+    if (DateTime::timezone_diff(1457852400, phx, ny) != 10800)
+      throw std::runtime_error("Expected a 3 hour difference the other way");
+  }
+
+  TimeDomain td = TimeDomain(23622321788); // Mo-Fr 06:00-11:00
+  for (int i = 0; i < 2; ++i) {
+    TryIsRestricted(td, "2018-04-17T06:00", true);
+    TryIsRestricted(td, "2018-04-21T06:00", false);
+    TryIsRestricted(td, "2018-04-17T11:11", false);
+  }
+  td = TimeDomain(1106007905274112); // Oct 16-Nov 15: 09:00-17:30
+  for (int i = 0; i < 2; ++i) {
+    TryIsRestricted(td, "2018-10-16T11:00", true);
+    TryIsRestricted(td, "2018-10-10T11:00", false);
+  }
+}
+
 void TestDayOfWeek() {
   std::string date = "2018-07-22T10:00";
   uint32_t dow = DateTime::day_of_week(date);
@@ -592,6 +642,7 @@ int main(void) {
   test::suite suite("datetime");
 
   suite.test(TEST_CASE(TestGetDaysFromPivotDate));
+  suite.test(TEST_CASE(TestFormattedDate));
   suite.test(TEST_CASE(TestGetSecondsFromMidnight));
   suite.test(TEST_CASE(TestDOW));
   suite.test(TEST_CASE(TestDuration));
@@ -600,6 +651,7 @@ int main(void) {
   suite.test(TEST_CASE(TestIsRestricted));
   suite.test(TEST_CASE(TestDST));
   suite.test(TEST_CASE(TestTimezoneDiff));
+  suite.test(TEST_CASE(TestCachedOffsets));
   suite.test(TEST_CASE(TestDayOfWeek));
   suite.test(TEST_CASE(TestSecondOfWeek));
 
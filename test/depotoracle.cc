@@ -0,0 +1,107 @@
+#include "thor/depotoracle.h"
+#include "test.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::thor;
+
+namespace {
+
+Options make_options() {
+  Options options;
+  for (int i = 0; i <= static_cast<int>(Costing::truck); ++i) {
+    options.add_costing_options();
+  }
+  return options;
+}
+
+valhalla::Location make_location(const double lng, const double lat, const uint64_t edge_id) {
+  valhalla::Location location;
+  location.mutable_ll()->set_lng(lng);
+  location.mutable_ll()->set_lat(lat);
+  auto* edge = location.add_path_edges();
+  edge->set_graph_id(edge_id);
+  edge->set_percent_along(.25f);
+  return location;
+}
+
+DepotOracle::reach_t make_reach(const uint64_t edge_id) {
+  auto reach = std::make_shared<DepotReach>();
+  reach->edges.push_back({edge_id, 10.f, 8.f, 100});
+  return reach;
+}
+
+void TestIsDepot() {
+  DepotOracle oracle({{13.38886, 52.51704}, {-73.98565, 40.74844}}, 10, 0);
+  if (!oracle.IsDepot(make_location(13.38886, 52.51704, 1)) ||
+      !oracle.IsDepot(make_location(-73.985652, 40.748438, 1)))
+    throw std::logic_error("Locations at a depot should be depots");
+  if (oracle.IsDepot(make_location(13.38896, 52.51704, 1)) ||
+      oracle.IsDepot(make_location(52.51704, 13.38886, 1)) || oracle.IsDepot(valhalla::Location()))
+    throw std::logic_error("Other locations should not be depots");
+}
+
+void TestFindPut() {
+  DepotOracle oracle({{13.38886, 52.51704}}, 2, 0);
+  auto options = make_options();
+  auto depot = make_location(13.38886, 52.51704, 1234);
+  auto key = DepotOracle::Key(Costing::auto_, options, depot);
+  if (oracle.Find(key))
+    throw std::logic_error("Nothing should be found yet");
+  auto reach = make_reach(1);
+  oracle.Put(key, reach);
+  if (oracle.Find(key) != reach || oracle.size() != 1)
+    throw std::logic_error("The reach should be found");
+
+  // another costing, other costing options or other edges are another reach
+  auto other = DepotOracle::Key(Costing::pedestrian, options, depot);
+  options.mutable_costing_options(Costing::auto_)->set_use_highways(0.1f);
+  if (other == key || DepotOracle::Key(Costing::auto_, options, depot) == key ||
+      DepotOracle::Key(Costing::auto_, make_options(), make_location(13.38886, 52.51704, 1235)) ==
+          key)
+    throw std::logic_error("Other depots should have other keys");
+
+  // a full oracle is cleared
+  oracle.Put(other, make_reach(2));
+  oracle.Put("third", make_reach(3));
+  if (oracle.size() != 1 || oracle.Find(key) || !oracle.Find("third"))
+    throw std::logic_error("A full oracle should have been cleared");
+}
+
+void TestAge() {
+  DepotOracle oracle({{13.38886, 52.51704}}, 10, 1);
+  oracle.Put("depot", make_reach(1));
+  if (!oracle.Find("depot"))
+    throw std::logic_error("A new reach should be found");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  if (oracle.Find("depot"))
+    throw std::logic_error("An old reach should be searched again");
+}
+
+void TestGlobal() {
+  if (DepotOracle::Global({}, 10, 0) || DepotOracle::Global({{13.38886, 52.51704}}, 0, 0))
+    throw std::logic_error("No depots or no room should mean no oracle");
+  auto oracle = DepotOracle::Global({{13.38886, 52.51704}}, 10, 0);
+  if (!oracle || DepotOracle::Global({{0, 0}}, 5, 0) != oracle)
+    throw std::logic_error("The oracle should be shared");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("depotoracle");
+
+  suite.test(TEST_CASE(TestIsDepot));
+
+  suite.test(TEST_CASE(TestFindPut));
+
+  suite.test(TEST_CASE(TestAge));
+
+  suite.test(TEST_CASE(TestGlobal));
+
+  return suite.tear_down();
+}
@@ -1,6 +1,7 @@
 #include "test.h"
 
 #include "baldr/directededge.h"
+#include "baldr/routingedge.h"
 
 using namespace std;
 using namespace valhalla::baldr;
@@ -148,6 +149,31 @@ void TestMaxSlope() {
 
 } // namespace
 
+void TestRoutingEdge() {
+  if (sizeof(RoutingEdge) != 8)
+    throw std::runtime_error("RoutingEdge should be 8 bytes but is " +
+                             std::to_string(sizeof(RoutingEdge)));
+
+  // The copy has to agree with the directed edge it was made from
+  DirectedEdge edge;
+  edge.set_localedgeidx(5);
+  edge.set_superseded(3);
+  edge.set_leaves_tile(true);
+  edge.set_forwardaccess(kAutoAccess | kPedestrianAccess);
+  edge.set_reverseaccess(kBicycleAccess);
+  RoutingEdge routing(edge);
+  if (routing.localedgeidx != edge.localedgeidx() || routing.superseded != edge.superseded() ||
+      routing.shortcut != edge.shortcut() || routing.is_shortcut != edge.is_shortcut() ||
+      !routing.leaves_tile || routing.forwardaccess != edge.forwardaccess() ||
+      routing.reverseaccess != edge.reverseaccess())
+    throw runtime_error("RoutingEdge does not match its directed edge");
+
+  edge.set_shortcut(2);
+  routing = RoutingEdge(edge);
+  if (!routing.is_shortcut || routing.shortcut != edge.shortcut())
+    throw runtime_error("RoutingEdge shortcut does not match its directed edge");
+}
+
 int main(void) {
   test::suite suite("directededge");
 
@@ -159,5 +185,8 @@ int main(void) {
   // Test max slopes
   suite.test(TEST_CASE(TestMaxSlope));
 
+  // Test the hot attributes copied for expansion
+  suite.test(TEST_CASE(TestRoutingEdge));
+
   return suite.tear_down();
 }
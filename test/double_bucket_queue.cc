@@ -80,6 +80,46 @@ void TestClear() {
   TryClear(costs);
 }
 
+void TestReuse() {
+  std::vector<float> edgelabels;
+  const auto edgecost = [&edgelabels](const uint32_t label) { return edgelabels[label]; };
+
+  // Leave some labels behind in the first "search", including the overflow bucket
+  DoubleBucketQueue adjlist(0, 10000, 50, edgecost);
+  std::vector<uint32_t> costs = {67, 325, 25, 466, 1000, 100005, 758, 111111000};
+  for (uint32_t i = 0; i < costs.size(); ++i) {
+    edgelabels.emplace_back(costs[i]);
+    adjlist.add(i);
+  }
+  adjlist.pop();
+
+  // Reuse it with a different minimum cost, range and bucket size. Any label
+  // left over from the previous search would break the expected order below.
+  edgelabels.clear();
+  adjlist.reuse(1000, 5000, 5, edgecost);
+  std::vector<uint32_t> second = {1067, 9000, 1025, 3466, 2000, 1005, 1758};
+  for (uint32_t i = 0; i < second.size(); ++i) {
+    edgelabels.emplace_back(second[i]);
+    adjlist.add(i);
+  }
+  std::sort(second.begin(), second.end());
+  for (auto expected : second) {
+    uint32_t labelindex = adjlist.pop();
+    if (labelindex == kInvalidLabel || edgelabels[labelindex] != expected)
+      throw runtime_error("TestReuse: expected order test failed");
+  }
+  if (adjlist.pop() != kInvalidLabel)
+    throw runtime_error("TestReuse: expected the queue to be empty");
+
+  // Invalid parameters are still caught
+  bool caught = false;
+  try {
+    adjlist.reuse(0, 10000, 0, edgecost);
+  } catch (...) { caught = true; }
+  if (!caught)
+    throw runtime_error("TestReuse: invalid bucket size not caught");
+}
+
 /**
    void TestDecreseCost() {
    std::vector<uint32_t> costs = { 67, 325, 25, 466, 1000, 100005, 758, 167,
@@ -162,6 +202,29 @@ void TrySimulation(DoubleBucketQueue& dbqueue,
   TryRemove(dbqueue, addedLabels.size(), costs);
 }
 
+void TestStats() {
+  std::vector<float> edgelabels = {10, 20, 20000};
+  const auto edgecost = [&edgelabels](const uint32_t label) { return edgelabels[label]; };
+  DoubleBucketQueue adjlist(0, 10000, 50, edgecost);
+  for (uint32_t i = 0; i < edgelabels.size(); ++i) {
+    adjlist.add(i);
+  }
+  adjlist.decrease(1, 5);
+  edgelabels[1] = 5;
+  while (adjlist.pop() != kInvalidLabel) {
+  }
+
+  // The label in the overflow bucket is moved to the low level buckets once
+  const auto& stats = adjlist.stats();
+  if (stats.added != 3 || stats.decreased != 1 || stats.popped != 3 || stats.rebuilds != 1)
+    throw runtime_error("TestStats: unexpected queue counts");
+
+  // A new search starts counting over
+  adjlist.reuse(0, 10000, 50, edgecost);
+  if (adjlist.stats().added != 0 || adjlist.stats().popped != 0 || adjlist.stats().rebuilds != 0)
+    throw runtime_error("TestStats: expected reuse to clear the counts");
+}
+
 void TestSimulation() {
   {
     std::vector<float> costs;
@@ -199,8 +262,12 @@ int main() {
 
   suite.test(TEST_CASE(TestClear));
 
+  suite.test(TEST_CASE(TestReuse));
+
   //  suite.test(TEST_CASE(TestDecreaseCost));
 
+  suite.test(TEST_CASE(TestStats));
+
   suite.test(TEST_CASE(TestSimulation));
 
   return suite.tear_down();
@@ -1,5 +1,6 @@
 #include "test.h"
 #include <cstdint>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -261,6 +262,77 @@ void TestCollapseEdgeChain() {
   }
 }
 
+void TestParallelCollapseEdgeAcrossTiles() {
+  vb::GraphId a_id = vb::TileHierarchy::GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b_id = vb::TileHierarchy::GetGraphId(valhalla::midgard::PointLL(4, 0), 0);
+
+  // a chain crossing from tile a into tile b and a chain inside tile b:
+  //
+  //  (a0)<-->(a1)<-|->(b0)<-->(b1)    (b2)<-->(b3)<-->(b4)
+  //
+  graph_tile_builder builder;
+  valhalla::midgard::PointLL a_ll(0.0f, 0.0f);
+  builder.append_node(a_ll, 0.00f, 0.0f, 1, 0);
+  builder.append_node(a_ll, 0.01f, 0.0f, 2, 1);
+  builder.append_edge(a_id + uint64_t(1), 1113);
+  builder.append_edge(a_id + uint64_t(0), 1113);
+  builder.append_edge(b_id + uint64_t(0), 1113);
+  builder.commit_tile(a_id);
+
+  valhalla::midgard::PointLL b_ll(4.0f, 0.0f);
+  builder.append_node(b_ll, 0.00f, 0.0f, 2, 0);
+  builder.append_node(b_ll, 0.01f, 0.0f, 1, 2);
+  builder.append_node(b_ll, 0.00f, 0.1f, 1, 3);
+  builder.append_node(b_ll, 0.01f, 0.1f, 2, 4);
+  builder.append_node(b_ll, 0.02f, 0.1f, 1, 6);
+  builder.append_edge(a_id + uint64_t(1), 1113);
+  builder.append_edge(b_id + uint64_t(1), 1113);
+  builder.append_edge(b_id + uint64_t(0), 1113);
+  builder.append_edge(b_id + uint64_t(3), 1113);
+  builder.append_edge(b_id + uint64_t(2), 1113);
+  builder.append_edge(b_id + uint64_t(4), 1113);
+  builder.append_edge(b_id + uint64_t(3), 1113);
+  builder.commit_tile(b_id);
+  assert(builder.tiles.size() == 2);
+
+  std::mutex lock;
+  size_t count = 0;
+  std::set<vb::GraphId> edges;
+  for (uint64_t i = 0; i < 3; ++i) {
+    edges.insert(a_id + i);
+  }
+  for (uint64_t i = 0; i < 7; ++i) {
+    edges.insert(b_id + i);
+  }
+
+  std::vector<vb::GraphId> tiles;
+  tiles.push_back(a_id);
+  tiles.push_back(b_id);
+
+  vb::merge::parallel_merge(
+      tiles,
+      [&]() { return std::unique_ptr<vb::GraphReader>(new test_graph_reader(builder.tiles)); }, 2,
+      [](const vb::DirectedEdge*) -> bool { return true; },
+      [](const vb::DirectedEdge*) -> bool { return true; },
+      [&](const vb::merge::path& p) {
+        std::lock_guard<std::mutex> guard(lock);
+        count += 1;
+        for (auto id : p.m_edges) {
+          if (edges.count(id) != 1) {
+            throw std::runtime_error("Edge not found - either invalid or duplicate!");
+          }
+          edges.erase(id);
+        }
+      });
+
+  if (count != 4) {
+    throw std::runtime_error("Should have collapsed to 4 paths.");
+  }
+  if (!edges.empty()) {
+    throw std::runtime_error("Some edges left over!");
+  }
+}
+
 } // anonymous namespace
 
 int main() {
@@ -269,6 +341,7 @@ int main() {
   suite.test(TEST_CASE(TestCollapseEdgeSimple));
   suite.test(TEST_CASE(TestCollapseEdgeJunction));
   suite.test(TEST_CASE(TestCollapseEdgeChain));
+  suite.test(TEST_CASE(TestParallelCollapseEdgeAcrossTiles));
 
   return suite.tear_down();
 }
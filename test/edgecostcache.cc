@@ -0,0 +1,174 @@
+#include "sif/edgecostcache.h"
+#include "test.h"
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "baldr/directededge.h"
+#include "baldr/graphid.h"
+#include "baldr/graphtile.h"
+#include "baldr/graphtileheader.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// a tile with nothing but a header and some edges
+struct test_tile : public GraphTile {
+  test_tile(const GraphId& id, const size_t count) : edges(count) {
+    header.set_graphid(id);
+    header.set_directededgecount(count);
+    header_ = &header;
+    directededges_ = edges.data();
+  }
+  GraphTileHeader header;
+  std::vector<DirectedEdge> edges;
+};
+
+// the cost of an edge is its index in the tile so we can tell them apart
+struct counting_cost_t {
+  Cost operator()() const {
+    ++count;
+    return {static_cast<float>(index) + .5f, static_cast<float>(index)};
+  }
+  size_t index;
+  std::atomic<uint32_t>& count;
+};
+
+void TestGet() {
+  EdgeCostCache cache(100);
+  test_tile tile({10, 2, 0}, 20);
+  std::atomic<uint32_t> count(0);
+  for (int pass = 0; pass < 3; ++pass) {
+    for (size_t i = 0; i < tile.edges.size(); ++i) {
+      auto cost = cache.Get(1, &tile, &tile.edges[i], counting_cost_t{i, count});
+      if (cost.cost != i + .5f || cost.secs != i)
+        throw std::logic_error("Wrong cost for edge " + std::to_string(i));
+    }
+  }
+  if (count != tile.edges.size())
+    throw std::logic_error("Every edge should have been costed once but got " +
+                           std::to_string(count));
+
+  // another costing has its own table
+  cache.Get(2, &tile, &tile.edges[0], counting_cost_t{0, count});
+  if (count != tile.edges.size() + 1 || cache.size() != tile.edges.size() * 2)
+    throw std::logic_error("Expected another table for another costing");
+}
+
+void TestNotInTile() {
+  EdgeCostCache cache(100);
+  test_tile tile({10, 2, 0}, 5);
+  test_tile other({11, 2, 0}, 5);
+  std::atomic<uint32_t> count(0);
+  for (int pass = 0; pass < 3; ++pass) {
+    cache.Get(1, &tile, &other.edges[2], counting_cost_t{2, count});
+  }
+  if (count != 3)
+    throw std::logic_error("An edge that is not in the tile should not be cached");
+}
+
+void TestFull() {
+  EdgeCostCache cache(25);
+  std::atomic<uint32_t> count(0);
+  test_tile first({10, 2, 0}, 20);
+  test_tile second({11, 2, 0}, 20);
+  cache.Get(1, &first, &first.edges[0], counting_cost_t{0, count});
+  cache.Get(1, &second, &second.edges[0], counting_cost_t{0, count});
+  if (cache.size() != 20)
+    throw std::logic_error("The cache should have started over when it was full");
+
+  // a table that can never fit just isnt kept
+  test_tile huge({12, 2, 0}, 30);
+  cache.Get(1, &huge, &huge.edges[0], counting_cost_t{0, count});
+  cache.Get(1, &huge, &huge.edges[0], counting_cost_t{0, count});
+  if (count != 4 || cache.size() != 20)
+    throw std::logic_error("A tile larger than the cache should not be cached");
+
+  cache.Clear();
+  if (cache.size() != 0)
+    throw std::logic_error("Expected an empty cache");
+}
+
+void TestThreads() {
+  EdgeCostCache cache(1000);
+  std::vector<test_tile> tiles;
+  tiles.reserve(4);
+  for (uint32_t i = 0; i < 4; ++i) {
+    tiles.emplace_back(GraphId(i, 2, 0), 100);
+  }
+
+  // every thread costs every edge of every tile over and over, bouncing between the tiles
+  std::atomic<uint32_t> count(0);
+  std::atomic<bool> wrong(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      for (int pass = 0; pass < 10; ++pass) {
+        for (size_t i = 0; i < 100; ++i) {
+          for (auto& tile : tiles) {
+            auto cost = cache.Get(1, &tile, &tile.edges[i], counting_cost_t{i, count});
+            wrong = wrong || cost.cost != i + .5f || cost.secs != i;
+          }
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (wrong)
+    throw std::logic_error("Wrong cost from another thread");
+  // threads can race to cost an edge the first time but after that its always cached
+  if (count < 400 || count > 1600)
+    throw std::logic_error("Expected the edges to be costed about once but got " +
+                           std::to_string(count));
+}
+
+void TestHash() {
+  Options options;
+  for (int i = 0; i <= static_cast<int>(Costing::truck); ++i) {
+    options.add_costing_options();
+  }
+  auto hash = EdgeCostCache::Hash(Costing::auto_, options);
+  if (hash != EdgeCostCache::Hash(Costing::auto_, options))
+    throw std::logic_error("The hash should not change");
+  if (hash == EdgeCostCache::Hash(Costing::truck, options))
+    throw std::logic_error("Different costings should hash differently");
+  options.mutable_costing_options(static_cast<int>(Costing::auto_))->set_use_tolls(.9f);
+  if (hash == EdgeCostCache::Hash(Costing::auto_, options))
+    throw std::logic_error("Different options should hash differently");
+}
+
+void TestGlobal() {
+  if (EdgeCostCache::Global(0))
+    throw std::logic_error("No size means no cache");
+  auto cache = EdgeCostCache::Global(10);
+  if (!cache || cache != EdgeCostCache::Global(20))
+    throw std::logic_error("Expected the one cache of the process");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("edgecostcache");
+
+  suite.test(TEST_CASE(TestGet));
+
+  suite.test(TEST_CASE(TestNotInTile));
+
+  suite.test(TEST_CASE(TestFull));
+
+  suite.test(TEST_CASE(TestThreads));
+
+  suite.test(TEST_CASE(TestHash));
+
+  suite.test(TEST_CASE(TestGlobal));
+
+  return suite.tear_down();
+}
@@ -108,6 +108,83 @@ void TestWriteRead() {
   }
 }
 
+void TestElevationProfile() {
+  EdgeInfoBuilder eibuilder;
+  std::vector<PointLL> shape{{-76.3002, 40.0433}, {-76.3036, 40.043}};
+  eibuilder.set_shape(shape);
+
+  // No profile unless one is set
+  boost::shared_array<char> memblock = ToFileAndBack(eibuilder);
+  std::unique_ptr<EdgeInfo> ei(new EdgeInfo(memblock.get(), nullptr, 0));
+  if (!ei->elevation_profile().empty())
+    throw runtime_error("Expected no elevation profile");
+  size_t size = eibuilder.SizeOf();
+
+  // Below sea level, large jumps and flat stretches all survive to a decimeter
+  std::vector<double> elevations{-12.34, 0.0, 250.06, 250.06, 8848.0, 3.3};
+  eibuilder.set_elevation_profile(elevations);
+  if (eibuilder.SizeOf() % 8 != 0 || eibuilder.SizeOf() <= size)
+    throw runtime_error("Expected the profile to grow the padded size");
+  memblock = ToFileAndBack(eibuilder);
+  ei.reset(new EdgeInfo(memblock.get(), nullptr, 0));
+  auto profile = ei->elevation_profile();
+  if (profile.size() != elevations.size())
+    throw runtime_error("Wrong number of elevation samples");
+  for (size_t i = 0; i < profile.size(); ++i) {
+    if (std::abs(profile[i] - elevations[i]) > kElevationProfilePrecision / 2 + 1e-3)
+      throw runtime_error("Wrong elevation sample");
+  }
+  if (!shape[1].ApproximatelyEqual(ei->shape()[1]))
+    throw runtime_error("Shape should be unchanged by the profile");
+
+  // Copying the encoded profile gives the same profile
+  EdgeInfoBuilder copy;
+  copy.set_encoded_shape(ei->encoded_shape());
+  copy.set_encoded_elevation_profile(ei->encoded_elevation_profile());
+  memblock = ToFileAndBack(copy);
+  EdgeInfo copied(memblock.get(), nullptr, 0);
+  if (copied.elevation_profile() != profile)
+    throw runtime_error("Expected the copied profile to match");
+}
+
+void TestNames() {
+  // A text list with a name, a route number and a tagged name which is never read
+  const char text[] = "\0Main Street\0US 30\0tagged";
+  EdgeInfoBuilder eibuilder;
+  std::vector<NameInfo> name_info_list{{1}, {13}, {19}};
+  name_info_list[1].is_route_num_ = 1;
+  name_info_list[2].tagged_ = 1;
+  eibuilder.set_name_info_list(name_info_list);
+  std::vector<PointLL> shape{{-76.3002, 40.0433}, {-76.3036, 40.043}};
+  eibuilder.set_shape(shape);
+  boost::shared_array<char> memblock = ToFileAndBack(eibuilder);
+  EdgeInfo ei(memblock.get(), text, sizeof(text));
+
+  // The names are visited in place
+  std::vector<std::pair<const char*, bool>> visited;
+  ei.ForEachName([&visited](const char* name, bool is_route_number) {
+    visited.emplace_back(name, is_route_number);
+  });
+  if (visited.size() != 2 || visited[0].first != text + 1 || visited[0].second ||
+      visited[1].first != text + 13 || !visited[1].second)
+    throw runtime_error("Expected the names to point into the text list");
+
+  // And copied by the convenience methods
+  if (ei.GetNames() != std::vector<std::string>{"Main Street", "US 30"})
+    throw runtime_error("Wrong names");
+  auto names_and_types = ei.GetNamesAndTypes();
+  if (names_and_types.size() != 2 || names_and_types[1].first != "US 30" ||
+      !names_and_types[1].second)
+    throw runtime_error("Wrong names and types");
+
+  // A name past the end of the text list
+  EdgeInfo truncated(memblock.get(), text, 13);
+  try {
+    truncated.ForEachName([](const char*, bool) {});
+    throw std::logic_error("Expected an offset past the text list to throw");
+  } catch (const std::runtime_error&) {}
+}
+
 } // namespace
 
 int main() {
@@ -116,5 +193,11 @@ int main() {
   // Write to file and read into EdgeInfo
   suite.test(TEST_CASE(TestWriteRead));
 
+  // Elevation profile after the shape
+  suite.test(TEST_CASE(TestElevationProfile));
+
+  // Names straight from the text list
+  suite.test(TEST_CASE(TestNames));
+
   return suite.tear_down();
 }
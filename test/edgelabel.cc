@@ -0,0 +1,84 @@
+#include "sif/edgelabel.h"
+#include "test.h"
+
+#include "baldr/directededge.h"
+#include "baldr/graphid.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+DirectedEdge make_edge(const GraphId& endnode) {
+  DirectedEdge edge;
+  edge.set_endnode(endnode);
+  edge.set_opp_index(5);
+  edge.set_opp_local_idx(3);
+  edge.set_use(Use::kFerry);
+  edge.set_classification(RoadClass::kServiceOther);
+  edge.set_toll(true);
+  edge.set_dest_only(true);
+  return edge;
+}
+
+void test_ids() {
+  // the largest ids and tiles must survive being split across the words of the label
+  GraphId edgeid(kMaxGraphTileId, 7, kMaxGraphId - 1), endnode(kMaxGraphTileId - 1, 6, 1234567);
+  auto edge = make_edge(endnode);
+  EdgeLabel label(17, edgeid, &edge, {1.f, 2.f}, 3.f, 4.f, TravelMode::kBicycle, 5, true);
+  if (label.edgeid() != edgeid || label.endnode() != endnode)
+    throw std::logic_error("Wrong edge or end node");
+  if (label.predecessor() != 17 || label.opp_index() != 5 || label.opp_local_idx() != 3 ||
+      label.mode() != TravelMode::kBicycle || label.use() != Use::kFerry ||
+      label.classification() != RoadClass::kServiceOther || !label.toll() || !label.destonly() ||
+      !label.has_time_restriction() || label.path_distance() != 5)
+    throw std::logic_error("Wrong edge attributes");
+}
+
+void test_opp_edgeid() {
+  // the opposing edge leaves the end node so it is in the end node's tile
+  GraphId edgeid(1000, 2, 10), endnode(1001, 2, 20), oppedgeid(1001, 2, 300);
+  auto edge = make_edge(endnode);
+  BDEdgeLabel label(0, edgeid, oppedgeid, &edge, {}, 0.f, 0.f, TravelMode::kDrive, {6.f, 5.f}, true,
+                    false);
+  if (label.opp_edgeid() != oppedgeid || !label.not_thru_pruning() || label.edgeid() != edgeid)
+    throw std::logic_error("Wrong opposing edge");
+  if (label.transition_cost() != 6.f || label.transition_secs() != 5.f)
+    throw std::logic_error("Wrong transition cost");
+
+  BDEdgeLabel matrix_label(0, edgeid, oppedgeid, &edge, {2.f, 1.f}, TravelMode::kDrive, {}, 77,
+                           false, false);
+  if (matrix_label.opp_edgeid() != oppedgeid || matrix_label.not_thru_pruning() ||
+      matrix_label.path_distance() != 77 || matrix_label.sortcost() != 2.f)
+    throw std::logic_error("Wrong opposing edge for the matrix");
+
+  // labels without an opposing edge
+  BDEdgeLabel no_opp(0, edgeid, GraphId(), &edge, {}, 0.f, 0.f, TravelMode::kDrive, {}, false,
+                     false);
+  if (no_opp.opp_edgeid().Is_Valid())
+    throw std::logic_error("The opposing edge should be invalid");
+  BDEdgeLabel origin(0, edgeid, &edge, {}, 0.f, 0.f, TravelMode::kDrive, false);
+  if (origin.opp_edgeid().Is_Valid())
+    throw std::logic_error("Origins have no opposing edge");
+}
+
+void test_size() {
+  // bidirectional labels only add the opposing edge, flags and the transition cost
+  if (alignof(EdgeLabel) != 4 || sizeof(BDEdgeLabel) != sizeof(EdgeLabel) + 12)
+    throw std::logic_error("Bidirectional labels should not be padded");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("edgelabel");
+
+  suite.test(TEST_CASE(test_ids));
+
+  suite.test(TEST_CASE(test_opp_edgeid));
+
+  suite.test(TEST_CASE(test_size));
+
+  return suite.tear_down();
+}
@@ -66,6 +66,52 @@ void TestStatus() {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreached);
 }
 
+void TestManyTiles() {
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile tt;
+  tt.header_ = &header;
+  const GraphTile* tile = &tt;
+
+  // share the pool between two edge status so the arrays get recycled
+  auto pool = std::make_shared<EdgeStatusPool>();
+  EdgeStatus edgestatus(pool);
+  for (uint32_t i = 0; i < 500; ++i) {
+    edgestatus.Set(GraphId(i, 2, i), EdgeSet::kTemporary, i, tile);
+  }
+  for (uint32_t i = 0; i < 500; ++i) {
+    edgestatus.Update(GraphId(i, 2, i), EdgeSet::kPermanent);
+  }
+  for (uint32_t i = 0; i < 500; ++i) {
+    EdgeStatusInfo r = edgestatus.Get(GraphId(i, 2, i));
+    if (r.set() != EdgeSet::kPermanent || r.index() != i)
+      throw runtime_error("EdgeStatus lookup over many tiles failed");
+    TryGet(edgestatus, GraphId(i, 1, i), EdgeSet::kUnreached);
+  }
+
+  // recycled arrays have to come back unreached
+  edgestatus.clear();
+  EdgeStatus other(pool);
+  for (uint32_t i = 0; i < 500; ++i) {
+    EdgeStatusInfo* r = other.GetPtr(GraphId(i, 2, 0), tile);
+    for (uint32_t j = 0; j < header.directededgecount(); ++j, ++r) {
+      if (r->set() != EdgeSet::kUnreached || r->index() != 0)
+        throw runtime_error("Recycled EdgeStatus should be unreached");
+    }
+  }
+
+  // moving keeps the statuses
+  other.Set(GraphId(7, 2, 3), EdgeSet::kPermanent, 42, tile);
+  EdgeStatus moved(std::move(other));
+  if (moved.Get(GraphId(7, 2, 3)).index() != 42)
+    throw runtime_error("Moved EdgeStatus lost its statuses");
+
+  // updating an edge never set should throw
+  test::assert_throw<std::runtime_error>([&]() {
+    moved.Update(GraphId(9999, 0, 0), EdgeSet::kPermanent);
+  }, "Update of an unset edge should throw");
+}
+
 } // namespace
 
 int main() {
@@ -74,5 +120,8 @@ int main() {
   // Test setting status, getting status, and clearing
   suite.test(TEST_CASE(TestStatus));
 
+  // Test many tiles, recycling arrays through the pool and moving
+  suite.test(TEST_CASE(TestManyTiles));
+
   return suite.tear_down();
 }
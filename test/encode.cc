@@ -3,6 +3,7 @@
 #include "midgard/util.h"
 #include "test.h"
 
+#include <iterator>
 #include <string>
 
 using namespace std;
@@ -630,6 +631,95 @@ void test_varint() {
                   {58.26482, -169.02219}});
 }
 
+void test_shape_iterator() {
+  container_t points{{-86.36737, 90.75251}, {22.62106, 29.07404}, {-29.06206, -163.63365},
+                     {-37.89193, 2.07912}, {-21.17342, -109.54591}};
+
+  // iterating gives the same points as decoding into a container
+  auto encoded = encode7<container_t>(points);
+  Shape7Decoder<container_t::value_type> shape(encoded.data(), encoded.size());
+  container_t iterated(shape.begin(), shape.end());
+  if (iterated != decode7<container_t>(encoded))
+    throw std::runtime_error("Iterating a shape did not match decoding it. Expected: " +
+                             to_string(decode7<container_t>(encoded)) +
+                             " Got: " + to_string(iterated));
+  if (std::distance(shape.begin(), shape.end()) != static_cast<long>(points.size()))
+    throw std::runtime_error("Iterating a shape should not consume the decoder");
+
+  // once points are popped only the remaining ones are iterated over
+  shape.pop();
+  shape.pop();
+  container_t remaining;
+  for (const auto& point : shape) {
+    remaining.push_back(point);
+  }
+  if (!appx_equal(remaining, container_t(points.begin() + 2, points.end())))
+    throw std::runtime_error("Expected the points after the popped ones. Got: " +
+                             to_string(remaining));
+
+  Shape7Decoder<container_t::value_type> empty(encoded.data(), 0);
+  if (empty.begin() != empty.end())
+    throw std::runtime_error("Expected an empty shape to have no points");
+
+  // the 5 digit polyline decoder iterates the same way
+  auto encoded5 = encode<container_t>(points);
+  Shape5Decoder<container_t::value_type> shape5(encoded5.data(), encoded5.size());
+  if (!appx_equal(container_t(shape5.begin(), shape5.end()), points))
+    throw std::runtime_error("Iterating a polyline did not match its points");
+}
+
+void test_bulk() {
+  container_t points{{-86.36737, 90.75251}, {22.62106, 29.07404}, {-29.06206, -163.63365},
+                     {-37.89193, 2.07912}, {-21.17342, -109.54591}, {0, 0}, {0.000001, -0.000001}};
+
+  // encoding into an iterator writes the same as encoding into a string
+  std::string encoded;
+  encode(points.begin(), points.end(), std::back_inserter(encoded), 1e5);
+  if (encoded != encode<container_t>(points, 1e5))
+    throw std::runtime_error("Encoding into an iterator did not match encoding into a string");
+  std::string encoded7;
+  encode7(points.begin(), points.end(), std::back_inserter(encoded7));
+  if (encoded7 != encode7<container_t>(points))
+    throw std::runtime_error("Varint encoding into an iterator did not match");
+
+  // decoding in bulk gives the same points as popping them one at a time, also after a pop
+  for (size_t popped = 0; popped < 2; ++popped) {
+    Shape5Decoder<container_t::value_type> shape5(encoded.data(), encoded.size(), 1e-5);
+    Shape5Decoder<container_t::value_type> bulk5 = shape5;
+    Shape7Decoder<container_t::value_type> shape7(encoded7.data(), encoded7.size());
+    Shape7Decoder<container_t::value_type> bulk7 = shape7;
+    for (size_t i = 0; i < popped; ++i) {
+      bulk5.pop();
+      bulk7.pop();
+    }
+    container_t popped5, popped7, all5, all7;
+    for (auto i = 0; !shape5.empty(); ++i) {
+      auto point = shape5.pop();
+      if (i >= static_cast<int>(popped))
+        popped5.push_back(point);
+    }
+    for (auto i = 0; !shape7.empty(); ++i) {
+      auto point = shape7.pop();
+      if (i >= static_cast<int>(popped))
+        popped7.push_back(point);
+    }
+    bulk5.pop_all(std::back_inserter(all5));
+    bulk7.pop_all(std::back_inserter(all7));
+    if (all5 != popped5 || all7 != popped7 || !bulk5.empty() || !bulk7.empty())
+      throw std::runtime_error("Decoding in bulk did not match popping the points");
+  }
+
+  // a shape cut short is as bad in bulk as it is one point at a time
+  for (const auto& cut : {encoded.substr(0, encoded.size() - 1), encoded.substr(0, 1)}) {
+    bool threw = false;
+    try {
+      decode<container_t>(cut);
+    } catch (const std::runtime_error&) { threw = true; }
+    if (!threw)
+      throw std::runtime_error("Expected a cut polyline to fail to decode");
+  }
+}
+
 } // namespace
 
 int main() {
@@ -638,6 +728,8 @@ int main() {
   suite.test(TEST_CASE(test_polyline));
   suite.test(TEST_CASE(test_polyline5));
   suite.test(TEST_CASE(test_varint));
+  suite.test(TEST_CASE(test_shape_iterator));
+  suite.test(TEST_CASE(test_bulk));
 
   return suite.tear_down();
 }
@@ -0,0 +1,122 @@
+#include "midgard/flat_hash.h"
+
+#include "test.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "baldr/graphid.h"
+
+using namespace std;
+using namespace valhalla::midgard;
+using valhalla::baldr::GraphId;
+
+namespace {
+
+void TestMapInsertFind() {
+  flat_hash_map<GraphId, uint32_t> map;
+  if (!map.empty() || map.find(GraphId(1, 2, 3)) != map.end())
+    throw runtime_error("A new map should be empty");
+
+  // all of the ids of one tile, which only differ in their high bits
+  for (uint32_t id = 0; id < 1000; ++id) {
+    auto inserted = map.emplace(GraphId(747, 2, id), id * 2);
+    if (!inserted.second || inserted.first->second != id * 2)
+      throw runtime_error("Insert of a new key should succeed");
+  }
+  if (map.size() != 1000)
+    throw runtime_error("Map should have 1000 values");
+
+  auto again = map.insert({GraphId(747, 2, 5), 1});
+  if (again.second || again.first->second != 10)
+    throw runtime_error("Insert of an existing key should find the existing value");
+
+  for (uint32_t id = 0; id < 1000; ++id) {
+    auto found = map.find(GraphId(747, 2, id));
+    if (found == map.end() || found->second != id * 2)
+      throw runtime_error("Inserted key was not found");
+  }
+  if (map.count(GraphId(747, 2, 1000)) || map.count(GraphId(748, 2, 0)))
+    throw runtime_error("Key that was not inserted was found");
+
+  map[GraphId(1, 0, 0)] += 7;
+  if (map.at(GraphId(1, 0, 0)) != 7 || map.size() != 1001)
+    throw runtime_error("operator[] should insert a default value");
+
+  size_t count = 0;
+  for (const auto& value : map) {
+    count += map.find(value.first) != map.end();
+  }
+  if (count != map.size())
+    throw runtime_error("Iteration should visit each value once");
+
+  map.clear();
+  if (!map.empty() || map.begin() != map.end() || map.count(GraphId(747, 2, 0)))
+    throw runtime_error("Map should be empty after clear");
+}
+
+void TestSetMatchesUnorderedSet() {
+  // random inserts and erases, which exercise the shifting back of the probe sequences
+  flat_hash_set<uint64_t> set;
+  unordered_set<uint64_t> expected;
+  mt19937 generator(17);
+  uniform_int_distribution<uint64_t> keys(0, 2000);
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t key = keys(generator);
+    if (generator() % 3 == 0) {
+      if (set.erase(key) != expected.erase(key))
+        throw runtime_error("Erase should find the same keys as unordered_set");
+    } else if (set.insert(key).second != expected.insert(key).second) {
+      throw runtime_error("Insert should find the same keys as unordered_set");
+    }
+  }
+  if (set.size() != expected.size())
+    throw runtime_error("Set should have as many keys as unordered_set");
+  for (uint64_t key = 0; key <= 2000; ++key) {
+    if (set.count(key) != expected.count(key))
+      throw runtime_error("Set should have the same keys as unordered_set");
+  }
+
+  // drain it from the front like a queue
+  while (!set.empty()) {
+    uint64_t key = *set.begin();
+    set.erase(set.begin());
+    if (set.count(key) || expected.erase(key) != 1)
+      throw runtime_error("Erasing the first key should only remove it");
+  }
+  if (!expected.empty())
+    throw runtime_error("Draining the set should visit every key");
+}
+
+void TestMapGrowAndErase() {
+  // values that own memory have to survive the table growing
+  flat_hash_map<uint32_t, string> map(4);
+  for (uint32_t i = 0; i < 500; ++i) {
+    map.emplace(i, to_string(i));
+  }
+  for (uint32_t i = 0; i < 500; i += 2) {
+    map.erase(i);
+  }
+  for (uint32_t i = 0; i < 500; ++i) {
+    auto found = map.find(i);
+    if ((i % 2 == 0) != (found == map.end()) || (found != map.end() && found->second != to_string(i)))
+      throw runtime_error("Values should be kept through growing and erasing");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("flat_hash");
+
+  suite.test(TEST_CASE(TestMapInsertFind));
+
+  suite.test(TEST_CASE(TestSetMatchesUnorderedSet));
+
+  suite.test(TEST_CASE(TestMapGrowAndErase));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,151 @@
+#include "mjolnir/graphcomponents.h"
+#include "test.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "mjolnir/graphtilebuilder.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+std::string tile_dir = "test/data/component_tiles";
+GraphId tile_id = TileHierarchy::GetGraphId({.125, .125}, 2);
+PointLL base_ll = TileHierarchy::get_tiling(tile_id.level()).Base(tile_id.tileid());
+
+// this is what it looks like
+//
+//   0 - 1 - ... - 9 = 10 - 11 - ... - 19 = 0      20 - 21
+//   |
+//   v
+//   22
+//
+// a ring of 20 nodes where the edges between 9 and 10 and between 19 and 0 are steps so cycling
+// splits it into 2 rows of 10, an island of 2 nodes and a one way spur from 0 to 22
+constexpr uint32_t kRingSize = 20;
+constexpr uint32_t kIsland = 20;
+constexpr uint32_t kSpur = 22;
+
+void make_tile() {
+  if (boost::filesystem::is_directory(tile_dir)) {
+    boost::filesystem::remove_all(tile_dir);
+  }
+
+  // the edges out of every node as pairs of end node and whether its steps
+  std::vector<std::vector<std::pair<uint32_t, bool>>> edges(kSpur + 1);
+  for (uint32_t i = 0; i < kRingSize; ++i) {
+    uint32_t next = (i + 1) % kRingSize;
+    bool steps = i == 9 || i == 19;
+    edges[i].emplace_back(next, steps);
+    edges[next].emplace_back(i, steps);
+  }
+  edges[kIsland].emplace_back(kIsland + 1, false);
+  edges[kIsland + 1].emplace_back(kIsland, false);
+  edges[0].emplace_back(kSpur, false);
+
+  GraphTileBuilder tile(tile_dir, tile_id, false);
+  uint32_t edge_index = 0;
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    for (const auto& edge : edges[i]) {
+      DirectedEdgeBuilder edge_builder({}, GraphId(tile_id.tileid(), tile_id.level(), edge.first),
+                                       true, 100, 1, 1, edge.second ? Use::kSteps : Use::kRoad,
+                                       RoadClass::kResidential, 0, false, 0, 0, false);
+      edge_builder.set_forwardaccess(kAllAccess);
+      tile.directededges().emplace_back(std::move(edge_builder));
+    }
+    NodeInfo node_builder;
+    node_builder.set_latlng(base_ll, {.01f + i * .001f, .01f});
+    node_builder.set_access(kAllAccess);
+    node_builder.set_edge_count(edges[i].size());
+    node_builder.set_edge_index(edge_index);
+    edge_index += edges[i].size();
+    tile.nodes().emplace_back(std::move(node_builder));
+  }
+  tile.StoreTileData();
+}
+
+void TestLabel() {
+  boost::property_tree::ptree conf;
+  conf.put("mjolnir.tile_dir", tile_dir);
+  conf.put("mjolnir.concurrency", 1);
+  // all but the island and the spur for driving and walking, the 2 rows for cycling
+  auto labeled = GraphComponents::Label(conf);
+  if (labeled != kRingSize * 2)
+    throw std::logic_error("Expected the ring edges to be labeled but got " +
+                           std::to_string(labeled));
+
+  GraphTile tile(tile_dir, tile_id);
+  for (uint32_t i = 0; i <= kSpur; ++i) {
+    const auto* node = tile.node(i);
+    for (const auto& edge : tile.GetDirectedEdges(node)) {
+      auto end = edge.endnode().id();
+      uint32_t ring = i < kRingSize && end < kRingSize ? 2 : 0;
+      // cycling cant take the steps so the rows it can get around in are 10 nodes long, the
+      // steps are between rows so they get the same class even though cycling cant use them
+      uint32_t row = ring ? 1 : 0;
+      if (edge.component_class(0) != ring || edge.component_class(1) != ring ||
+          edge.component_class(2) != row)
+        throw std::logic_error("Wrong component class for the edge from " + std::to_string(i) +
+                               " to " + std::to_string(end));
+    }
+  }
+}
+
+void TestUsable() {
+  DirectedEdge edge;
+  edge.set_forwardaccess(kAllAccess);
+  for (uint32_t mode = 0; mode < kComponentModeCount; ++mode)
+    if (!GraphComponents::Usable(edge, mode))
+      throw std::logic_error("Expected a plain edge to be usable");
+
+  // shortcuts are never part of it
+  edge.set_shortcut(1);
+  for (uint32_t mode = 0; mode < kComponentModeCount; ++mode)
+    if (GraphComponents::Usable(edge, mode))
+      throw std::logic_error("Expected shortcuts to be unusable");
+
+  // nothing but access for driving, easy hiking for walking and smooth enough for cycling
+  DirectedEdge rough;
+  rough.set_forwardaccess(kAllAccess);
+  rough.set_surface(Surface::kDirt);
+  rough.set_sac_scale(SacScale::kHiking);
+  if (!GraphComponents::Usable(rough, 0) || GraphComponents::Usable(rough, 1) ||
+      GraphComponents::Usable(rough, 2))
+    throw std::logic_error("Expected a rough trail to only be usable for driving");
+}
+
+void TestClass() {
+  DirectedEdge edge;
+  edge.set_component_class(0, 3);
+  edge.set_component_class(1, 100);
+  edge.set_component_class(2, 1);
+  if (edge.component_class(0) != 3 || edge.component_class(1) != kMaxComponentClass ||
+      edge.component_class(2) != 1)
+    throw std::logic_error("Component classes should be set per mode and clamped");
+  edge.set_component_class(1, 0);
+  if (edge.component_class(0) != 3 || edge.component_class(1) != 0 || edge.component_class(2) != 1)
+    throw std::logic_error("Setting a component class should leave the others alone");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("graphcomponents");
+
+  suite.test(TEST_CASE(make_tile));
+
+  suite.test(TEST_CASE(TestLabel));
+
+  suite.test(TEST_CASE(TestUsable));
+
+  suite.test(TEST_CASE(TestClass));
+
+  return suite.tear_down();
+}
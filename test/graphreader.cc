@@ -5,8 +5,11 @@
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 
+#include <atomic>
 #include <boost/filesystem.hpp>
 #include <fcntl.h>
+#include <fstream>
+#include <thread>
 
 using namespace std;
 using namespace valhalla::baldr;
@@ -879,6 +882,457 @@ void Test_TileCacheLRU_SOFT_TrimOnExactlyFullCache() {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+void Test_ShardedTileCache_PutGet() {
+  ShardedTileCache cache(1000, 8);
+
+  GraphId id1(100, 2, 0);
+  const GraphTile* inserted1 = cache.Put(id1, TestGraphTile(id1, 123), 123);
+  CheckGraphTile(inserted1, id1, 123);
+
+  GraphId id2(300, 1, 0);
+  const GraphTile* inserted2 = cache.Put(id2, TestGraphTile(id2, 200), 200);
+  CheckGraphTile(inserted2, id2, 200);
+
+  test::assert_bool(cache.Get(id1) == inserted1, "tile1 should be returned");
+  test::assert_bool(cache.Get(id2) == inserted2, "tile2 should be returned");
+  test::assert_bool(cache.Contains(id1) && cache.Contains(id2), "tiles not found");
+  test::assert_bool(cache.Get({100, 1, 0}) == nullptr && cache.Get({1000000, 2, 0}) == nullptr,
+                    "Cache returned entry that has never been inserted");
+
+  // the first copy wins so pointers other threads hold stay valid
+  test::assert_bool(cache.Put(id1, TestGraphTile(id1, 123), 123) == inserted1,
+                    "second put should return the existing tile");
+  test::assert_bool(!cache.OverCommitted(), "unexpected overcommit");
+
+  // copies share the same storage
+  ShardedTileCache view(cache);
+  test::assert_bool(view.Get(id2) == inserted2, "copy should see the same tiles");
+
+  cache.Clear();
+  test::assert_bool(!view.Contains(id1) && !view.Contains(id2), "tiles should be cleared");
+  test::assert_bool(!cache.OverCommitted(), "unexpected overcommit");
+}
+
+void Test_ShardedTileCache_Trim() {
+  ShardedTileCache cache(1000, 4);
+
+  GraphId id1(100, 2, 0);
+  cache.Put(id1, TestGraphTile(id1, 400), 400);
+  GraphId id2(300, 1, 0);
+  cache.Put(id2, TestGraphTile(id2, 400), 400);
+  test::assert_bool(!cache.OverCommitted(), "unexpected overcommit");
+  cache.Trim();
+  test::assert_bool(cache.Contains(id1) && cache.Contains(id2),
+                    "no evictions expected when within the limit");
+
+  GraphId id3(1000, 0, 0);
+  cache.Put(id3, TestGraphTile(id3, 400), 400);
+  test::assert_bool(cache.OverCommitted(), "expecting overcommit");
+
+  // only tile1 was read recently so the trim should evict one of the others
+  cache.Get(id1);
+  cache.Trim();
+  test::assert_bool(!cache.OverCommitted(), "unexpected overcommit");
+  test::assert_bool(cache.Contains(id1), "recently used tile should survive the trim");
+}
+
+void Test_TileCache_Handles() {
+  GraphId id1(100, 2, 0);
+
+  // handles from the sharded cache share the cached tile
+  ShardedTileCache sharded(1000, 8);
+  const GraphTile* inserted = sharded.Put(id1, TestGraphTile(id1, 123), 123);
+  graph_tile_ptr handle = sharded.GetHandle(id1);
+  test::assert_bool(handle.get() == inserted, "handle should share the cached tile");
+  sharded.Clear();
+  test::assert_bool(sharded.GetHandle(id1) == nullptr, "no handle for evicted tiles");
+  CheckGraphTile(handle.get(), id1, 123);
+
+  // other caches hand out copies which outlive the cache entry too
+  SimpleTileCache simple(1000);
+  simple.Put(id1, TestGraphTile(id1, 123), 123);
+  handle = simple.GetHandle(id1);
+  simple.Clear();
+  CheckGraphTile(handle.get(), id1, 123);
+}
+
+void Test_ShardedTileCache_Concurrent() {
+  ShardedTileCache cache(1073741824, 16);
+  std::vector<std::thread> threads;
+  std::atomic<size_t> mismatches(0);
+  for (size_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&cache, &mismatches]() {
+      for (uint32_t i = 0; i < 2000; ++i) {
+        GraphId id(i, 2, 0);
+        const GraphTile* tile = cache.Get(id);
+        if (!tile) {
+          tile = cache.Put(id, TestGraphTile(id, 10), 10);
+        }
+        if (tile->id() != id || cache.Get(id) != tile) {
+          ++mismatches;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  test::assert_bool(mismatches == 0, "threads should agree on the cached tiles");
+  for (uint32_t i = 0; i < 2000; ++i) {
+    test::assert_bool(cache.Contains({i, 2, 0}), "every tile should be cached");
+  }
+}
+
+void Test_TileCacheTinyLFU_ScanResistance() {
+  TileCacheTinyLFU cache(1000, TileCacheLRU::MemoryLimitControl::SOFT);
+
+  // a working set asked for over and over
+  std::vector<GraphId> hot;
+  for (uint32_t i = 0; i < 5; ++i) {
+    hot.emplace_back(i, 2, 0);
+    for (int j = 0; j < 3; ++j) {
+      if (!cache.Get(hot.back())) {
+        cache.Put(hot.back(), TestGraphTile(hot.back(), 100), 100);
+      }
+    }
+  }
+  cache.Trim();
+  test::assert_bool(cache.Frequency(hot.front()) == 3, "frequency should count every request");
+
+  // a scan of tiles asked for once, trimmed after it like a request would be
+  for (uint32_t i = 100; i < 120; ++i) {
+    GraphId id(i, 2, 0);
+    if (!cache.Get(id)) {
+      cache.Put(id, TestGraphTile(id, 100), 100);
+    }
+  }
+  test::assert_bool(cache.OverCommitted(), "expecting overcommit");
+  cache.Trim();
+  test::assert_bool(!cache.OverCommitted(), "unexpected overcommit");
+  for (const auto& id : hot) {
+    test::assert_bool(cache.Contains(id), "the working set should survive the scan");
+  }
+
+  cache.Clear();
+  test::assert_bool(!cache.Contains(hot.front()) && !cache.OverCommitted(),
+                    "tiles should be cleared");
+}
+
+void Test_TileCacheTinyLFU_HARD_Admission() {
+  TileCacheTinyLFU cache(300, TileCacheLRU::MemoryLimitControl::HARD);
+
+  GraphId id1(1, 2, 0);
+  const GraphTile* inserted = cache.Put(id1, TestGraphTile(id1, 100), 100);
+  CheckGraphTile(inserted, id1, 100);
+  test::assert_bool(cache.Get(id1) == inserted, "tile1 should be returned");
+  GraphId id2(2, 2, 0);
+  cache.Put(id2, TestGraphTile(id2, 100), 100);
+  GraphId id3(3, 2, 0);
+  cache.Put(id3, TestGraphTile(id3, 100), 100);
+  cache.Get(id1);
+  cache.Get(id1);
+  cache.Get(id3);
+  cache.Get(id3);
+
+  // the cache is full, a tile asked for once loses against the ones asked for more often
+  GraphId id4(4, 2, 0);
+  cache.Put(id4, TestGraphTile(id4, 100), 100);
+  GraphId id5(5, 2, 0);
+  cache.Put(id5, TestGraphTile(id5, 100), 100);
+  test::assert_bool(!cache.OverCommitted(), "hard control should never overcommit");
+  test::assert_bool(cache.Contains(id1) && cache.Contains(id3),
+                    "tiles asked for more often should stay");
+  test::assert_bool(cache.Contains(id5), "the newest tile should be cached");
+
+  // overwrites keep their place and size
+  CheckGraphTile(cache.Put(id3, TestGraphTile(id3, 150), 150), id3, 150);
+  test::assert_bool(!cache.OverCommitted(), "hard control should never overcommit");
+  test::assert_bool(cache.Contains(id3), "the overwritten tile should stay");
+}
+
+void Test_PinningTileCache_Trim() {
+  PinningTileCache cache({0, 1}, 1000,
+                         std::unique_ptr<TileCache>(
+                             new TileCacheLRU(500, TileCacheLRU::MemoryLimitControl::SOFT)));
+
+  GraphId highway(10, 0, 0);
+  const GraphTile* pinned = cache.Put(highway, TestGraphTile(highway, 400), 400);
+  CheckGraphTile(pinned, highway, 400);
+  GraphId arterial(20, 1, 0);
+  cache.Put(arterial, TestGraphTile(arterial, 400), 400);
+  test::assert_bool(cache.pinned_size() == 800, "both tiles should be pinned");
+
+  // local tiles are cached as usual and overcommitting them does not touch the pinned ones
+  GraphId local1(100, 2, 0);
+  cache.Put(local1, TestGraphTile(local1, 400), 400);
+  GraphId local2(200, 2, 0);
+  cache.Put(local2, TestGraphTile(local2, 400), 400);
+  test::assert_bool(cache.OverCommitted(), "expecting overcommit");
+  cache.Trim();
+  test::assert_bool(!cache.OverCommitted(), "unexpected overcommit");
+  test::assert_bool(cache.Get(highway) == pinned && cache.Contains(arterial),
+                    "pinned tiles should survive the trim");
+  test::assert_bool(!cache.Contains(local1) || !cache.Contains(local2),
+                    "the trim should evict a local tile");
+  test::assert_bool(cache.pinned_size() == 800, "the trim should not change the pinned tiles");
+
+  cache.Clear();
+  test::assert_bool(!cache.Contains(highway) && !cache.Contains(arterial),
+                    "pinned tiles should be cleared");
+  test::assert_bool(cache.pinned_size() == 0, "nothing should be pinned after clearing");
+}
+
+void Test_PinningTileCache_Budget() {
+  PinningTileCache cache({0}, 500,
+                         std::unique_ptr<TileCache>(
+                             new TileCacheLRU(500, TileCacheLRU::MemoryLimitControl::HARD)));
+
+  // once the budget is spent tiles of pinned levels go to the other cache and can be evicted
+  GraphId highway1(10, 0, 0);
+  cache.Put(highway1, TestGraphTile(highway1, 400), 400);
+  GraphId highway2(20, 0, 0);
+  cache.Put(highway2, TestGraphTile(highway2, 400), 400);
+  test::assert_bool(cache.pinned_size() == 400, "only the first tile fits the budget");
+  GraphId local(100, 2, 0);
+  cache.Put(local, TestGraphTile(local, 400), 400);
+  test::assert_bool(cache.Contains(highway1) && cache.Contains(local),
+                    "pinned and newest tile should be cached");
+  test::assert_bool(!cache.Contains(highway2), "tile over the budget should have been evicted");
+
+  // handles of pinned tiles outlive the cache entry
+  graph_tile_ptr handle = cache.GetHandle(highway1);
+  cache.Clear();
+  CheckGraphTile(handle.get(), highway1, 400);
+}
+
+// Writes a tile holding nothing but its header, renamed into place like a deploy would
+void write_header_tile(const GraphId& graphid, const uint64_t dataset_id, const std::string& tile_dir) {
+  GraphTileHeader header;
+  header.set_graphid(graphid);
+  header.set_dataset_id(dataset_id);
+  header.set_end_offset(sizeof(GraphTileHeader));
+  auto fullpath = tile_dir + '/' + GraphTile::FileSuffix(graphid);
+  boost::filesystem::create_directories(boost::filesystem::path(fullpath).parent_path());
+  {
+    std::ofstream file(fullpath + ".tmp", std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  boost::filesystem::rename(fullpath + ".tmp", fullpath);
+}
+
+void TestMappedTileFiles() {
+  const std::string tile_dir = "test/gphrdr_mmap_test";
+  boost::filesystem::remove_all(tile_dir);
+  GraphId id(42, 2, 0);
+  write_header_tile(id, 1, tile_dir);
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("mmap_tiles", true);
+  pt.put("mmap_populate", true);
+  pt.put("mmap_advice", "random");
+  GraphReader reader(pt);
+  const GraphTile* tile = reader.GetGraphTile(id);
+  test::assert_bool(tile && tile->header()->dataset_id() == 1, "tile file should be mapped");
+  test::assert_bool(!reader.GetGraphTile({43, 2, 0}), "missing tiles should not be found");
+
+  // Replacing the file leaves the cached tile alone, the new one shows up once it leaves the cache
+  auto handle = reader.GetGraphTileHandle(id);
+  write_header_tile(id, 2, tile_dir);
+  test::assert_bool(reader.GetGraphTile(id)->header()->dataset_id() == 1,
+                    "cached tile should still be the old one");
+  reader.Clear();
+  test::assert_bool(reader.GetGraphTile(id)->header()->dataset_id() == 2,
+                    "new tile should be mapped after clearing the cache");
+  test::assert_bool(handle->header()->dataset_id() == 1, "handles should keep the old mapping");
+
+  pt.put("mmap_advice", "sometimes");
+  bool threw = false;
+  try {
+    GraphReader bad(pt);
+  } catch (const std::runtime_error&) { threw = true; }
+  test::assert_bool(threw, "unknown mmap advice should throw");
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void TestTileCounts() {
+  const std::string tile_dir = "test/gphrdr_counts_test";
+  boost::filesystem::remove_all(tile_dir);
+  GraphId id(42, 2, 0);
+  write_header_tile(id, 1, tile_dir);
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  GraphReader reader(pt);
+  reader.GetGraphTile(id);
+  reader.GetGraphTile(id);
+  reader.GetGraphTile({43, 2, 0});
+
+  // Only the first look up of a tile and the one that is not there miss the cache
+  test::assert_bool(reader.tiles_fetched() == 3, "every look up should be counted");
+  test::assert_bool(reader.tiles_missed() == 2, "only the tiles not in the cache are missed");
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void TestPrefetchNeighbors() {
+  const std::string tile_dir = "test/gphrdr_prefetch_test";
+  boost::filesystem::remove_all(tile_dir);
+  const auto& tiles = TileHierarchy::levels().find(2)->second.tiles;
+  int32_t center = tiles.TileId(100, 100);
+  std::vector<GraphId> ids;
+  for (int32_t row = 99; row <= 101; ++row) {
+    for (int32_t col = 99; col <= 101; ++col) {
+      ids.emplace_back(tiles.TileId(col, row), 2, 0);
+      write_header_tile(ids.back(), ids.back().tileid(), tile_dir);
+    }
+  }
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("prefetch_threads", 2);
+  {
+    GraphReader reader(pt);
+    GraphId center_id(center, 2, 0);
+    test::assert_bool(reader.GetGraphTile(center_id) != nullptr, "center tile should be found");
+
+    // Whether a tile comes from the background or is loaded when asked for it is the same one
+    reader.PrefetchNeighbors(center_id, tiles.Center(tiles.TileId(101, 100)));
+    reader.PrefetchNeighbors(center_id);
+    reader.PrefetchNeighbors({tiles.TileId(101, 101), 2, 0});
+    for (const auto& id : ids) {
+      const GraphTile* tile = reader.GetGraphTile(id);
+      test::assert_bool(tile && tile->header()->dataset_id() == id.tileid(),
+                        "prefetched tiles should be the ones asked for");
+    }
+    test::assert_bool(!reader.GetGraphTile({tiles.TileId(102, 102), 2, 0}),
+                      "missing tiles should not be found");
+    reader.Clear();
+    test::assert_bool(reader.GetGraphTile({tiles.TileId(99, 99), 2, 0}) != nullptr,
+                      "tiles should load again after clearing");
+
+    // Asking for a list of tiles, missing and duplicate ones included, loads the same tiles
+    std::vector<GraphId> list(ids);
+    list.emplace_back(tiles.TileId(102, 102), 2, 0);
+    list.push_back(ids.front());
+    reader.Clear();
+    reader.Prefetch(list);
+    for (const auto& id : ids) {
+      const GraphTile* tile = reader.GetGraphTile(id);
+      test::assert_bool(tile && tile->header()->dataset_id() == id.tileid(),
+                        "listed tiles should be the ones asked for");
+    }
+  }
+
+  // Going away with work still queued has to stop the threads
+  {
+    pt.put("prefetch_threads", 1);
+    GraphReader reader(pt);
+    reader.PrefetchNeighbors({center, 2, 0});
+  }
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void TestPreload() {
+  const std::string tile_dir = "test/gphrdr_preload_test";
+  const std::string access_log = tile_dir + "/access.log";
+  boost::filesystem::remove_all(tile_dir);
+  const auto& tiles = TileHierarchy::levels().find(2)->second.tiles;
+  std::vector<GraphId> ids;
+  for (int32_t col = 10; col < 14; ++col) {
+    ids.emplace_back(tiles.TileId(col, 10), 2, 0);
+    write_header_tile(ids.back(), ids.back().tileid(), tile_dir);
+  }
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("tile_access_log", access_log);
+  {
+    // Without a log yet there is nothing to preload
+    GraphReader reader(pt);
+    test::assert_bool(reader.Preload(10, 2) == 0, "nothing should be preloaded without a log");
+    // The first tile is used the most, the last one not at all
+    for (size_t i = 0; i < ids.size() - 1; ++i) {
+      for (size_t j = i; j < ids.size() - 1; ++j) {
+        reader.GetGraphTile(ids[i]);
+      }
+    }
+  }
+  test::assert_bool(boost::filesystem::exists(access_log),
+                    "the access log should be written when the reader goes away");
+
+  // Remove the tiles from disk so only the preloaded ones can be found afterwards
+  {
+    GraphReader reader(pt);
+    test::assert_bool(reader.Preload(2, 2) == 2, "the 2 tiles used most should be preloaded");
+    boost::filesystem::remove_all(tile_dir + "/2");
+    test::assert_bool(reader.GetGraphTile(ids[0]) && reader.GetGraphTile(ids[1]),
+                      "the tiles used most should be in the cache");
+    test::assert_bool(!reader.GetGraphTile(ids[2]) && !reader.GetGraphTile(ids[3]),
+                      "the other tiles should not have been preloaded");
+  }
+
+  // Preloading stops when the cache would be full
+  for (const auto& id : ids) {
+    write_header_tile(id, id.tileid(), tile_dir);
+  }
+  pt.put("max_cache_size", 1);
+  {
+    GraphReader reader(pt);
+    test::assert_bool(reader.Preload(10, 2) == 0, "preloading should respect max_cache_size");
+  }
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void TestTileAccessLog() {
+  const std::string tile_dir = "test/gphrdr_access_log_test";
+  boost::filesystem::remove_all(tile_dir);
+  const auto& tiles = TileHierarchy::levels().find(2)->second.tiles;
+  GraphId a(tiles.TileId(20, 10), 2, 0), b(tiles.TileId(21, 10), 2, 0);
+  write_header_tile(a, a.tileid(), tile_dir);
+  write_header_tile(b, b.tileid(), tile_dir);
+
+  // Every lookup is counted, and the misses with them
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("tile_access_log", tile_dir + "/all.log");
+  {
+    GraphReader reader(pt);
+    for (int i = 0; i < 3; ++i) {
+      reader.GetGraphTile(a);
+    }
+    reader.GetGraphTile(b);
+  }
+  auto accesses = GraphReader::ReadTileAccessLog(tile_dir + "/all.log");
+  test::assert_bool(accesses.size() == 2, "both tiles should be in the log");
+  test::assert_bool(accesses[a].count == 3 && accesses[a].misses == 1,
+                    "a was asked for 3 times and missed once");
+  test::assert_bool(accesses[b].count == 1 && accesses[b].misses == 1,
+                    "b was asked for once and missed once");
+
+  // Sampled lookups count for the ones that were skipped
+  pt.put("tile_access_log", tile_dir + "/sampled.log");
+  pt.put("tile_access_log_sample_rate", 2);
+  {
+    GraphReader reader(pt);
+    for (int i = 0; i < 4; ++i) {
+      reader.GetGraphTile(a);
+    }
+  }
+  accesses = GraphReader::ReadTileAccessLog(tile_dir + "/sampled.log");
+  test::assert_bool(accesses.size() == 1 && accesses[a].count == 4,
+                    "every other lookup should be counted twice");
+
+  // Logs written before misses were counted can still be read
+  {
+    std::ofstream old(tile_dir + "/old.log");
+    old << b.level() << ' ' << b.tileid() << ' ' << 7 << '\n';
+  }
+  accesses = GraphReader::ReadTileAccessLog(tile_dir + "/old.log");
+  test::assert_bool(accesses.size() == 1 && accesses[b].count == 7 && accesses[b].misses == 0,
+                    "a log without misses should read as having none");
+  boost::filesystem::remove_all(tile_dir);
+}
+
 } // namespace
 
 int main() {
@@ -888,6 +1342,16 @@ int main() {
 
   suite.test(TEST_CASE(TestConnectivityMap));
 
+  suite.test(TEST_CASE(TestMappedTileFiles));
+
+  suite.test(TEST_CASE(TestTileCounts));
+
+  suite.test(TEST_CASE(TestPrefetchNeighbors));
+
+  suite.test(TEST_CASE(TestPreload));
+
+  suite.test(TEST_CASE(TestTileAccessLog));
+
   // SimpleTileCahe unit tests
   suite.test(TEST_CASE(TestCacheLimits));
   suite.test(TEST_CASE(Test_SimpleTileCache_Clear));
@@ -920,5 +1384,15 @@ int main() {
   suite.test(TEST_CASE(Test_TileCacheLRU_SOFT_InsertWithEvictionBasic));
   suite.test(TEST_CASE(Test_TileCacheLRU_SOFT_TrimOnExactlyFullCache));
 
+  // sharded tile cache unit tests
+  suite.test(TEST_CASE(Test_ShardedTileCache_PutGet));
+  suite.test(TEST_CASE(Test_ShardedTileCache_Trim));
+  suite.test(TEST_CASE(Test_ShardedTileCache_Concurrent));
+  suite.test(TEST_CASE(Test_TileCache_Handles));
+  suite.test(TEST_CASE(Test_TileCacheTinyLFU_ScanResistance));
+  suite.test(TEST_CASE(Test_TileCacheTinyLFU_HARD_Admission));
+  suite.test(TEST_CASE(Test_PinningTileCache_Trim));
+  suite.test(TEST_CASE(Test_PinningTileCache_Budget));
+
   return suite.tear_down();
 }
@@ -4,7 +4,9 @@
 #include "baldr/tilehierarchy.h"
 #include "midgard/encoded.h"
 #include "midgard/pointll.h"
+#include "mjolnir/complexrestrictionbuilder.h"
 #include "mjolnir/graphtilebuilder.h"
+#include <boost/filesystem.hpp>
 #include <fstream>
 #include <streambuf>
 #include <string>
@@ -213,6 +215,189 @@ void TestAddBins() {
   }
 }
 
+void TestCompressColdSections() {
+  // a tile with names, shapes and signs on its edges
+  GraphId id(744881, 2, 0);
+  std::string source_dir = "test/data/compressed_tiles/source";
+  {
+    GraphTileBuilder builder(source_dir, id, false);
+    builder.AddAdmin("Nederland", "Utrecht", "NL", "UT");
+    for (uint32_t i = 0; i < 100; ++i) {
+      bool added = false;
+      std::list<PointLL> shape{{5.1f + i * 0.001f, 52.0f}, {5.1f + i * 0.001f, 52.001f}};
+      uint32_t offset =
+          builder.AddEdgeInfo(i, GraphId(744881, 2, i), GraphId(744881, 2, i + 1), i, 0, 0, 50,
+                              shape, {"Straat " + std::to_string(i % 10), "N" + std::to_string(i)},
+                              0, added);
+      DirectedEdge edge;
+      edge.set_edgeinfo_offset(offset);
+      edge.set_sign(i % 3 == 0);
+      builder.directededges().emplace_back(edge);
+      if (edge.sign()) {
+        builder.AddSigns(i, {{Sign::Type::kExitNumber, false, std::to_string(i)}});
+      }
+    }
+    builder.StoreTileData();
+  }
+  GraphTile t(source_dir, id);
+  if (!t.header())
+    throw std::runtime_error("Couldn't load test tile");
+
+  std::string compressed_dir = "test/data/compressed_tiles/compressed";
+  if (!GraphTileBuilder::CompressColdSections(compressed_dir, &t))
+    throw std::logic_error("Tile should have been compressed");
+  GraphTile c(compressed_dir, id);
+  if (!c.header() || c.header()->cold_size() == 0 ||
+      c.header()->end_offset() >= t.header()->end_offset())
+    throw std::logic_error("Compressed tile should be smaller");
+  if (GraphTileBuilder::CompressColdSections(compressed_dir, &c))
+    throw std::logic_error("Compressed tiles should not be compressed again");
+
+  // The graph is the same and so is everything read from the inflated sections
+  if (memcmp(reinterpret_cast<const char*>(t.header()) + sizeof(GraphTileHeader),
+             reinterpret_cast<const char*>(c.header()) + sizeof(GraphTileHeader),
+             t.header()->edgeinfo_offset() - sizeof(GraphTileHeader)))
+    throw std::logic_error("Sections before the edge info should not change");
+  auto check = [&t](const GraphTile& other) {
+    for (size_t i = 0; i < t.header()->directededgecount(); ++i) {
+      auto a = t.edgeinfo(t.directededge(i)->edgeinfo_offset());
+      auto b = other.edgeinfo(other.directededge(i)->edgeinfo_offset());
+      if (a.encoded_shape() != b.encoded_shape() || a.GetNames() != b.GetNames())
+        throw std::logic_error("Edge info should match once inflated");
+      if (t.directededge(i)->sign() &&
+          t.GetSigns(i).front().text() != other.GetSigns(i).front().text())
+        throw std::logic_error("Signs should match once inflated");
+    }
+    if (t.admininfo(1).country_text() != other.admininfo(1).country_text())
+      throw std::logic_error("Admins should match once inflated");
+  };
+  check(c);
+
+  // Copies share what was inflated
+  GraphTile copy(c);
+  check(copy);
+
+  // Deserializing a compressed tile stores it uncompressed again
+  std::string rebuilt_dir = "test/data/compressed_tiles/rebuilt";
+  GraphTileBuilder builder(compressed_dir, id, true);
+  builder.StoreTileData(rebuilt_dir);
+  GraphTile r(rebuilt_dir, id);
+  if (!r.header() || r.header()->cold_size() != 0)
+    throw std::logic_error("Rebuilt tile should not be compressed");
+  check(r);
+  boost::filesystem::remove_all("test/data/compressed_tiles");
+}
+
+void TestNodeRanges() {
+  // a tile whose nodes each have two of its edges
+  GraphId id(744881, 2, 0);
+  std::string tile_dir = "test/data/node_ranges";
+  auto build = [&id, &tile_dir](uint32_t edge_count) {
+    GraphTileBuilder builder(tile_dir, id, false);
+    for (uint32_t i = 0; i < 3; ++i) {
+      NodeInfo node;
+      node.set_edge_index(i * 2);
+      node.set_edge_count(edge_count);
+      builder.nodes().emplace_back(node);
+    }
+    for (uint32_t i = 0; i < 6; ++i) {
+      DirectedEdge edge;
+      edge.set_endnode(GraphId(744881, 2, (i / 2 + 1) % 3));
+      builder.directededges().emplace_back(edge);
+    }
+    builder.StoreTileData();
+  };
+  build(2);
+  GraphTile t(tile_dir, id);
+  if (!t.header())
+    throw std::runtime_error("Couldn't load test tile");
+
+  // the unchecked accessors see the same edges, and the nodes start on a cache line
+  for (uint32_t i = 0; i < 3; ++i) {
+    const auto* node = t.node(i);
+    if (t.node_unchecked(i) != node ||
+        t.directededge_unchecked(node->edge_index()) != t.directededge(node->edge_index()) ||
+        t.GetDirectedEdges(i).begin() != t.directededge(node->edge_index()))
+      throw std::logic_error("Unchecked accessors should match the checked ones");
+  }
+  if (reinterpret_cast<uintptr_t>(t.node(0)) % 64 != 0)
+    throw std::logic_error("Nodes of loaded tiles should start on a cache line");
+
+  // a node whose edges run past the end of the tile is caught when the tile is loaded
+  build(3);
+  bool thrown = false;
+  try {
+    GraphTile corrupt(tile_dir, id);
+  } catch (const std::runtime_error&) { thrown = true; }
+  if (!thrown)
+    throw std::logic_error("Loading a tile with nodes out of bounds should throw");
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void TestRestrictionRanges() {
+  // a tile with access restrictions, lane connections and complex restrictions on its edges
+  GraphId id(744881, 2, 0);
+  std::string tile_dir = "test/data/restriction_ranges";
+  {
+    GraphTileBuilder builder(tile_dir, id, false);
+    for (uint32_t i = 0; i < 4; ++i) {
+      bool added = false;
+      std::list<PointLL> shape{{5.1f + i * 0.001f, 52.0f}, {5.1f + i * 0.001f, 52.001f}};
+      uint32_t offset = builder.AddEdgeInfo(i, GraphId(744881, 2, i), GraphId(744881, 2, i + 1), i,
+                                            0, 0, 50, shape, {}, 0, added);
+      DirectedEdge edge;
+      edge.set_edgeinfo_offset(offset);
+      builder.directededges().emplace_back(edge);
+    }
+    builder.AddAccessRestriction(AccessRestriction(2, AccessType::kMaxWeight, kTruckAccess, 10));
+    builder.AddAccessRestriction(AccessRestriction(0, AccessType::kMaxHeight, kAutoAccess, 3));
+    builder.AddAccessRestriction(AccessRestriction(2, AccessType::kMaxHeight, kAutoAccess, 4));
+    builder.AddLaneConnectivity({{3, 7, "1|2", "1|2"}, {1, 5, "1", "2"}, {3, 8, "3", "1"}});
+    ComplexRestrictionBuilder complex_restriction;
+    complex_restriction.set_from_id(GraphId(744881, 2, 0));
+    complex_restriction.set_via_list({GraphId(744881, 2, 1)});
+    complex_restriction.set_to_id(GraphId(744881, 2, 2));
+    complex_restriction.set_type(RestrictionType::kNoLeftTurn);
+    complex_restriction.set_modes(kAutoAccess);
+    builder.AddForwardComplexRestriction(complex_restriction);
+    complex_restriction.set_modes(kTruckAccess);
+    builder.AddForwardComplexRestriction(complex_restriction);
+    builder.StoreTileData();
+  }
+  GraphTile t(tile_dir, id);
+  if (!t.header())
+    throw std::runtime_error("Couldn't load test tile");
+
+  // Everything of an edge, in place in the tile
+  auto access = t.GetAccessRestrictionRange(2);
+  if (access.size() != 2 || access.begin()->edgeindex() != 2 ||
+      (access.begin() + 1)->edgeindex() != 2)
+    throw std::logic_error("Expected both access restrictions of the edge");
+  if (t.GetAccessRestrictionRange(1).size() != 0 || t.GetAccessRestrictionRange(3).size() != 0)
+    throw std::logic_error("Expected no access restrictions");
+  if (t.GetAccessRestrictions(2, kTruckAccess).size() != 1)
+    throw std::logic_error("Expected only the truck restriction");
+  auto lanes = t.GetLaneConnectivityRange(3);
+  if (lanes.size() != 2 || lanes.begin()->to() != 3 || (lanes.begin() + 1)->to() != 3)
+    throw std::logic_error("Expected both lane connections of the edge");
+  if (t.GetLaneConnectivityRange(0).size() != 0 || t.GetLaneConnectivity(1).size() != 1)
+    throw std::logic_error("Wrong lane connections");
+
+  // Complex restrictions are visited until the visitor stops
+  size_t visited = 0;
+  t.ForEachRestriction(true, GraphId(744881, 2, 2), kAutoAccess | kTruckAccess,
+                       [&visited](const ComplexRestriction*) {
+                         ++visited;
+                         return false;
+                       });
+  if (visited != 1)
+    throw std::logic_error("Expected the visit to stop after the first restriction");
+  if (t.GetRestrictions(true, GraphId(744881, 2, 2), kTruckAccess).size() != 1 ||
+      t.GetRestrictions(true, GraphId(744881, 2, 1), kAutoAccess).size() != 0)
+    throw std::logic_error("Wrong complex restrictions");
+  boost::filesystem::remove_all(tile_dir);
+}
+
 struct fake_tile : public GraphTile {
 public:
   fake_tile(const std::string& plyenc_shape) {
@@ -277,8 +462,14 @@ int main() {
   // Add bins to a tile and see if its still ok
   suite.test(TEST_CASE(TestAddBins));
 
+  suite.test(TEST_CASE(TestCompressColdSections));
+
   // Test bin edges of some tricky edges
   suite.test(TEST_CASE(TestBinEdges));
 
+  suite.test(TEST_CASE(TestRestrictionRanges));
+
+  suite.test(TEST_CASE(TestNodeRanges));
+
   return suite.tear_down();
 }
@@ -1,7 +1,12 @@
 #include "midgard/gridded_data.h"
 #include "midgard/pointll.h"
 #include "test.h"
+#include <cmath>
+#include <functional>
 #include <limits>
+#include <list>
+#include <random>
+#include <thread>
 //#include <iostream>
 
 using namespace valhalla::midgard;
@@ -68,6 +73,90 @@ void test_gridded() {
   std::cout << "]}";*/
 }
 
+void test_parallel_contours() {
+  // a few bumps so each interval has several lines
+  GriddedData<PointLL> g({-5, -5, 5, 5}, .25f, 60);
+  Tiles<PointLL> t({-5, -5, 5, 5}, .25f);
+  for (int i = 0; i < t.ncolumns(); ++i) {
+    for (int j = 0; j < t.nrows(); ++j) {
+      auto b = t.Base(t.TileId(i, j));
+      g.Set(b, std::abs(b.first * 7) + std::abs(b.second * 5) + 3 * std::sin(b.first * b.second));
+    }
+  }
+
+  // tracing the intervals on their own threads has to give the same lines
+  std::vector<float> iso_markers{10, 20, 30, 40};
+  auto parallel_for = [](const uint32_t count, const std::function<void(uint32_t)>& work) {
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < count; ++i) {
+      threads.emplace_back(work, i);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  for (bool rings_only : {true, false}) {
+    auto expected = g.GenerateContours(iso_markers, rings_only, 0.f);
+    auto contours = g.GenerateContours(iso_markers, rings_only, 0.f, 200.f, parallel_for);
+    if (contours.size() != iso_markers.size() || contours.size() != expected.size())
+      throw std::logic_error("There should be an iso line per interval");
+    for (auto a = contours.cbegin(), b = expected.cbegin(); a != contours.cend(); ++a, ++b) {
+      if (a->first != b->first || a->second != b->second)
+        throw std::logic_error("Iso line " + std::to_string(a->first) +
+                               " should not depend on the threads");
+    }
+  }
+}
+
+void test_segments() {
+  // short and long segments, some of them leaving the grid
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<float> coord(-6.f, 6.f), step(-.4f, .4f), value(0.f, 60.f);
+  std::vector<GriddedData<PointLL>::segment_t> segments;
+  for (int i = 0; i < 40000; ++i) {
+    PointLL a(coord(gen), coord(gen));
+    PointLL b = i % 10 ? PointLL(a.first + step(gen), a.second + step(gen))
+                       : PointLL(coord(gen), coord(gen));
+    segments.push_back({a, b, value(gen)});
+  }
+
+  // drawing them one cell at a time like the isochrone used to
+  GriddedData<PointLL> expected({-5, -5, 5, 5}, .25f, 60);
+  for (const auto& segment : segments) {
+    auto tile1 = expected.TileId(segment.a);
+    auto tile2 = expected.TileId(segment.b);
+    if (tile1 == tile2) {
+      expected.SetIfLessThan(tile1, segment.value);
+    } else if (expected.AreNeighbors(tile1, tile2)) {
+      expected.SetIfLessThan(tile1, segment.value);
+      expected.SetIfLessThan(tile2, segment.value);
+    } else {
+      for (const auto& t : expected.Intersect(std::list<PointLL>{segment.a, segment.b})) {
+        expected.SetIfLessThan(t.first, segment.value);
+      }
+    }
+  }
+
+  // in a batch and in bands of rows on their own threads the cells should come out the same
+  auto parallel_for = [](const uint32_t count, const std::function<void(uint32_t)>& work) {
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < count; ++i) {
+      threads.emplace_back(work, i);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  GriddedData<PointLL> batch({-5, -5, 5, 5}, .25f, 60);
+  batch.SetIfLessThan(segments);
+  GriddedData<PointLL> parallel({-5, -5, 5, 5}, .25f, 60);
+  parallel.SetIfLessThan(segments, parallel_for);
+  if (batch.data() != expected.data())
+    throw std::logic_error("Drawing a batch should set the same cells");
+  if (parallel.data() != expected.data())
+    throw std::logic_error("Drawing bands concurrently should set the same cells");
+}
+
 } // namespace
 
 int main() {
@@ -75,5 +164,9 @@ int main() {
 
   suite.test(TEST_CASE(test_gridded));
 
+  suite.test(TEST_CASE(test_parallel_contours));
+
+  suite.test(TEST_CASE(test_segments));
+
   return suite.tear_down();
 }
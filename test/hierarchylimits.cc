@@ -0,0 +1,70 @@
+#include "sif/hierarchylimits.h"
+#include "test.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include "baldr/rapidjson_utils.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+
+namespace {
+
+TunedHierarchyLimits make_limits(const std::string& json) {
+  boost::property_tree::ptree pt;
+  std::stringstream ss(json);
+  rapidjson::read_json(ss, pt);
+  return TunedHierarchyLimits(pt);
+}
+
+std::vector<HierarchyLimits> defaults() {
+  return {HierarchyLimits(0), HierarchyLimits(1), HierarchyLimits(2)};
+}
+
+void TestApply() {
+  auto tuned = make_limits(R"({"auto":[
+      {"bbox":[5.0,52.0,5.2,52.2],"max_up_transitions":[0,100,20],"expansion_within_dist":[1,2,3]},
+      {"max_up_transitions":[0,800]}],
+    "truck":[{"bbox":[5.0,52.0,5.2,52.2],"max_up_transitions":[0,50,10]}]})");
+  if (tuned.empty())
+    throw std::logic_error("The limits should have been read");
+
+  // Both locations in the region get its limits
+  auto limits = defaults();
+  if (!tuned.Apply("auto", {{5.1, 52.1}, {5.15, 52.05}}, limits) ||
+      limits[1].max_up_transitions != 100 || limits[2].max_up_transitions != 20 ||
+      limits[2].expansion_within_dist != 3)
+    throw std::logic_error("The limits of the region should have been applied");
+
+  // A location outside of it gets the limits without a bbox, the levels not listed stay
+  limits = defaults();
+  if (!tuned.Apply("auto", {{5.1, 52.1}, {6.0, 52.1}}, limits) ||
+      limits[1].max_up_transitions != 800 ||
+      limits[2].max_up_transitions != HierarchyLimits(2).max_up_transitions ||
+      limits[1].expansion_within_dist != HierarchyLimits(1).expansion_within_dist)
+    throw std::logic_error("The limits used everywhere should have been applied");
+
+  // Nothing for this costing or outside of every region of it
+  limits = defaults();
+  if (tuned.Apply("pedestrian", {{5.1, 52.1}}, limits) ||
+      tuned.Apply("truck", {{6.0, 52.1}}, limits) ||
+      limits[1].max_up_transitions != HierarchyLimits(1).max_up_transitions)
+    throw std::logic_error("No limits should have been applied");
+}
+
+void TestBadBbox() {
+  test::assert_throw<std::runtime_error>([]() { make_limits(R"({"auto":[{"bbox":[5.0,52.0]}]})"); },
+                                         "A bbox without 4 corners should be rejected");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("hierarchylimits");
+
+  suite.test(TEST_CASE(TestApply));
+  suite.test(TEST_CASE(TestBadBbox));
+
+  return suite.tear_down();
+}
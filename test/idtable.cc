@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <unordered_set>
+#include <vector>
 
 using namespace std;
 using namespace valhalla::mjolnir;
@@ -50,23 +51,55 @@ void TestRandom() {
 void TestBounds() {
   IdTable t(10);
 
-  for (int i = 60; i < 70; ++i)
+  if (t.max() != IdTable::kChunkIds - 1)
+    throw std::logic_error("Max id should be the end of the first chunk");
+
+  uint64_t first = IdTable::kChunkIds * 3 - 5;
+  for (uint64_t i = first; i < first + 10; ++i)
     if (t.get(i))
       throw std::logic_error("No bits can be set when they are higher than max");
 
-  if (t.max() != 63)
-    throw std::logic_error("Max id should be 10");
-
-  for (int i = 60; i < 70; ++i)
+  for (uint64_t i = first; i < first + 10; ++i)
     if (i % 2)
       t.set(i);
 
-  for (int i = 60; i < 70; ++i)
+  for (uint64_t i = first; i < first + 10; ++i)
     if (i % 2 != t.get(i))
       throw std::logic_error("The odd ids should be set");
 
-  if (t.max() != 191)
-    throw std::logic_error("The max id should have been increased to 181");
+  if (t.max() != IdTable::kChunkIds * 4 - 1)
+    throw std::logic_error("The max id should have grown by whole chunks");
+}
+
+void TestRankSelect() {
+  // ids spread over a few chunks with empty chunks in between
+  IdTable t(10);
+  std::vector<uint64_t> ids;
+  for (uint64_t i = 0; i < 5000; ++i) {
+    uint64_t id = (i / 1000) * IdTable::kChunkIds * 2 + (i % 1000) * (i % 7 + 1) * 97 + i;
+    if (ids.empty() || id > ids.back())
+      ids.push_back(id);
+  }
+  for (auto id : ids)
+    t.set(id);
+
+  if (t.count() != ids.size())
+    throw std::logic_error("Wrong number of set ids");
+  for (uint64_t index = 0; index < ids.size(); ++index) {
+    if (t.rank(ids[index]) != index)
+      throw std::logic_error("Rank of a set id should be its dense index");
+    if (t.select(index) != ids[index])
+      throw std::logic_error("Select should give back the id of the dense index");
+    if (t.rank(ids[index] + 1) != index + 1)
+      throw std::logic_error("Rank past a set id should include it");
+  }
+  if (t.rank(t.max() + 100) != ids.size())
+    throw std::logic_error("Rank past the end should count all the ids");
+
+  // setting another id invalidates the ranks
+  t.set(ids.back() + 1);
+  if (t.count() != ids.size() + 1 || t.select(ids.size()) != ids.back() + 1)
+    throw std::logic_error("Ranks were not updated");
 }
 
 void TestX86() {
@@ -85,6 +118,7 @@ int main() {
   suite.test(TEST_CASE(TestSetGet));
   suite.test(TEST_CASE(TestRandom));
   suite.test(TEST_CASE(TestBounds));
+  suite.test(TEST_CASE(TestRankSelect));
   suite.test(TEST_CASE(TestX86));
 
   return suite.tear_down();
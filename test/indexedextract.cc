@@ -0,0 +1,95 @@
+#include "test.h"
+#include <cstdint>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtileheader.h"
+#include "baldr/tileindex.h"
+#include "midgard/sequence.h"
+#include "mjolnir/util.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Writes a tile with only a header and some bytes after it to the tile directory
+void write_tile(const std::string& tile_dir, const GraphId& graphid, const size_t extra) {
+  GraphTileHeader header;
+  header.set_graphid(graphid);
+  header.set_dataset_id(graphid.tileid() + 1);
+  header.set_end_offset(sizeof(GraphTileHeader) + extra);
+  auto file = boost::filesystem::path(tile_dir) / GraphTile::FileSuffix(graphid);
+  boost::filesystem::create_directories(file.parent_path());
+  std::ofstream out(file.string(), std::ios::binary);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  std::vector<char> bytes(extra, 7);
+  out.write(bytes.data(), bytes.size());
+}
+
+void TestWriteExtract() {
+  const std::string tile_dir = "test/data/indexed_extract_tiles";
+  const std::string extract = "test/data/indexed_extract.tar";
+  const std::vector<GraphId> ids{{42, 2, 0}, {7, 1, 0}, {0, 0, 0}, {1000, 2, 0}};
+  boost::filesystem::remove_all(tile_dir);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    write_tile(tile_dir, ids[i], i * 3000);
+  }
+  boost::property_tree::ptree pt;
+  pt.put("mjolnir.tile_dir", tile_dir);
+  pt.put("mjolnir.concurrency", 2);
+  test::assert_bool(WriteTileExtract(pt, extract) == ids.size(), "every tile should be written");
+
+  // it is still a tar with every tile in it, each starting on a page
+  tar archive(extract);
+  size_t tiles = 0;
+  for (const auto& file : archive.contents) {
+    if (file.first == kTileIndexFile || file.first == ".padding") {
+      continue;
+    }
+    ++tiles;
+    test::assert_bool((file.second.first - archive.mm.get()) % 4096 == 0,
+                      "tiles should start on a page");
+  }
+  test::assert_bool(tiles == ids.size() && archive.corrupt_blocks == 0,
+                    "the extract should be a tar of the tiles");
+
+  // but with the index the rest of the tar is not walked
+  tar indexed(extract, true, kTileIndexFile);
+  test::assert_bool(indexed.contents.size() == 1 &&
+                        indexed.contents.begin()->second.second ==
+                            ids.size() * sizeof(TileIndexEntry),
+                    "only the index should be read");
+
+  // The extract is shared by every reader in the process so this is its only test
+  boost::property_tree::ptree reader_pt;
+  reader_pt.put("tile_extract", extract);
+  reader_pt.put("max_cache_size", 1);
+  GraphReader reader(reader_pt);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    const GraphTile* tile = reader.GetGraphTile(ids[i]);
+    test::assert_bool(tile && tile->header()->dataset_id() == ids[i].tileid() + 1 &&
+                          tile->header()->end_offset() == sizeof(GraphTileHeader) + i * 3000,
+                      "tiles should be found through the index");
+    test::assert_bool(reinterpret_cast<uintptr_t>(tile->header()) % 4096 == 0,
+                      "tiles should be page aligned");
+  }
+  test::assert_bool(!reader.GetGraphTile({43, 2, 0}), "other tiles should not be found");
+  boost::filesystem::remove_all(tile_dir);
+  boost::filesystem::remove(extract);
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("indexedextract");
+
+  suite.test(TEST_CASE(TestWriteExtract));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,161 @@
+#include "thor/isochronecache.h"
+#include "test.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::thor;
+
+namespace {
+
+Options make_options() {
+  Options options;
+  for (int i = 0; i <= static_cast<int>(Costing::truck); ++i) {
+    options.add_costing_options();
+  }
+  auto* location = options.add_locations();
+  auto* edge = location->add_path_edges();
+  edge->set_graph_id(1234);
+  edge->set_percent_along(.25f);
+  edge = location->add_path_edges();
+  edge->set_graph_id(1235);
+  edge->set_percent_along(.75f);
+  return options;
+}
+
+// get a grid from the cache counting how many times it had to be computed
+IsochroneCache::grid_t get(IsochroneCache& cache,
+                           const Costing costing,
+                           const Options& options,
+                           const uint32_t max_minutes,
+                           uint32_t& count) {
+  return cache.Get(costing, options, max_minutes, [&]() {
+    ++count;
+    return std::make_shared<const GriddedData<PointLL>>(AABB2<PointLL>{0, 0, 1, 1}, .1f,
+                                                        max_minutes);
+  });
+}
+
+void TestGet() {
+  IsochroneCache cache(10, 0);
+  auto options = make_options();
+  uint32_t count = 0;
+
+  auto a = get(cache, Costing::auto_, options, 70, count);
+  auto b = get(cache, Costing::auto_, options, 70, count);
+  if (a != b || count != 1)
+    throw std::logic_error("The grid should have been reused");
+
+  // the contours and how they are drawn are not part of the grid
+  options.set_denoise(.5f);
+  options.set_polygons(true);
+  options.add_contours()->set_time(10);
+  if (get(cache, Costing::auto_, options, 70, count) != a || count != 1)
+    throw std::logic_error("The grid should have been reused for other contours");
+
+  // but another costing, more minutes, other costing options or other edges are another grid
+  get(cache, Costing::pedestrian, options, 70, count);
+  get(cache, Costing::auto_, options, 80, count);
+  options.mutable_costing_options(Costing::auto_)->set_use_highways(0.1f);
+  get(cache, Costing::auto_, options, 70, count);
+  options.mutable_locations(0)->mutable_path_edges(1)->set_percent_along(.5f);
+  get(cache, Costing::auto_, options, 70, count);
+  if (count != 5 || cache.size() != 5)
+    throw std::logic_error("Other isochrones should not have reused the grid");
+}
+
+void TestTime() {
+  IsochroneCache cache(10, 0);
+  auto options = make_options();
+  uint32_t count = 0;
+
+  // departures within the same speed bucket share their grid
+  options.mutable_locations(0)->set_date_time("2019-11-21T08:10");
+  auto a = get(cache, Costing::auto_, options, 70, count);
+  options.mutable_locations(0)->set_date_time("2019-11-21T08:14");
+  auto b = get(cache, Costing::auto_, options, 70, count);
+  options.mutable_locations(0)->set_date_time("2019-11-21T08:15");
+  auto c = get(cache, Costing::auto_, options, 70, count);
+  options.mutable_locations(0)->clear_date_time();
+  auto d = get(cache, Costing::auto_, options, 70, count);
+  if (a != b || b == c || c == d || count != 3)
+    throw std::logic_error("Departures should be cached per speed bucket");
+}
+
+void TestNotCached() {
+  auto options = make_options();
+  uint32_t count = 0;
+
+  // multimodal isochrones are not cached
+  IsochroneCache cache(10, 0);
+  get(cache, Costing::multimodal, options, 70, count);
+  get(cache, Costing::multimodal, options, 70, count);
+  if (count != 2 || cache.size() != 0)
+    throw std::logic_error("Multimodal isochrones should not be cached");
+
+  // no room means no cache
+  IsochroneCache none(0, 0);
+  get(none, Costing::auto_, options, 70, count);
+  get(none, Costing::auto_, options, 70, count);
+  if (count != 4 || none.size() != 0)
+    throw std::logic_error("A cache without room should not cache");
+
+  // a full cache is cleared
+  IsochroneCache small(1, 0);
+  get(small, Costing::auto_, options, 70, count);
+  get(small, Costing::pedestrian, options, 70, count);
+  if (small.size() != 1)
+    throw std::logic_error("A full cache should have been cleared");
+
+  // old grids are computed again
+  IsochroneCache aging(10, 1);
+  auto a = get(aging, Costing::auto_, options, 70, count);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  auto b = get(aging, Costing::auto_, options, 70, count);
+  if (a == b || count != 8 || aging.size() != 1)
+    throw std::logic_error("An old grid should have been computed again");
+}
+
+void TestDirection() {
+  IsochroneCache cache(10, 0);
+  auto options = make_options();
+
+  // the time to the locations is another grid than the time from them
+  auto from = std::make_shared<const GriddedData<PointLL>>(AABB2<PointLL>{0, 0, 1, 1}, .1f, 70);
+  auto to = std::make_shared<const GriddedData<PointLL>>(AABB2<PointLL>{0, 0, 1, 1}, .1f, 70);
+  if (IsochroneCache::Key(Costing::auto_, options, 70) ==
+      IsochroneCache::Key(Costing::auto_, options, 70, true))
+    throw std::logic_error("The directions should have different keys");
+  if (cache.Find(Costing::auto_, options, 70) || cache.Find(Costing::auto_, options, 70, true))
+    throw std::logic_error("Nothing should be found yet");
+  cache.Put(Costing::auto_, options, 70, from);
+  cache.Put(Costing::auto_, options, 70, to, true);
+  if (cache.Find(Costing::auto_, options, 70) != from ||
+      cache.Find(Costing::auto_, options, 70, true) != to || cache.size() != 2)
+    throw std::logic_error("Each direction should find its own grid");
+
+  // what is put in one direction is what get finds
+  uint32_t count = 0;
+  if (cache.Get(Costing::auto_, options, 70, [&]() { ++count; return from; }, true) != to ||
+      count != 0)
+    throw std::logic_error("Get should find the reverse grid");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("isochronecache");
+
+  suite.test(TEST_CASE(TestGet));
+
+  suite.test(TEST_CASE(TestTime));
+
+  suite.test(TEST_CASE(TestNotCached));
+
+  suite.test(TEST_CASE(TestDirection));
+
+  return suite.tear_down();
+}
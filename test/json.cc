@@ -3,6 +3,7 @@
 #include "test.h"
 
 #include <cstdint>
+#include <limits>
 #include <set>
 
 namespace {
@@ -69,6 +70,76 @@ void TestJsonSerialize() {
     throw std::logic_error("Wrong json");
 }
 
+void TestJsonWriter() {
+  using namespace std;
+  using namespace valhalla::baldr;
+  // write it as we go
+  json::Writer writer(16);
+  writer.start_object();
+  writer("escaped_string", string("\"\t\r\n\\\a/"));
+  writer("status", uint64_t(0));
+  writer("offset", int64_t(-3));
+  writer("found_alternative", false);
+  writer("hint", nullptr);
+  writer.start_array("via_points");
+  writer.start_array();
+  writer(json::fp_t{40.744377, 3});
+  writer(json::fp_t{-73.990433, 3});
+  writer.end_array();
+  writer(json::fp_t{std::numeric_limits<double>::infinity(), 2});
+  writer.start_object();
+  writer.end_object();
+  writer(json::array({uint64_t(1), string("tree")}));
+  writer.end_array();
+  writer.start_object("summary");
+  writer("total_time", uint64_t(145));
+  writer.end_object();
+  writer.end_object();
+
+  // the tree only has one member per object so it writes them in the same order
+  stringstream tree;
+  tree << *json::array(
+      {string("\"\t\r\n\\\a/"), uint64_t(0), int64_t(-3), false, nullptr,
+       json::array({json::array({json::fp_t{40.744377, 3}, json::fp_t{-73.990433, 3}}),
+                    json::fp_t{std::numeric_limits<double>::infinity(), 2}, json::map({}),
+                    json::array({uint64_t(1), string("tree")})}),
+       json::map({{"total_time", uint64_t(145)}})});
+
+  string answer = "{\"escaped_string\":\"\\\"\\t\\r\\n\\\\\\u0007\\/\",\"status\":0,"
+                  "\"offset\":-3,\"found_alternative\":false,\"hint\":null,\"via_points\":[[40.744,"
+                  "-73.990],\"inf\",{},[1,\"tree\"]],\"summary\":{\"total_time\":145}}";
+  if (writer.get_buffer() != answer)
+    throw std::logic_error("Wrong json: " + writer.get_buffer());
+
+  string values = "[\"\\\"\\t\\r\\n\\\\\\u0007\\/\",0,-3,false,null,[[40.744,-73.990],\"inf\",{},"
+                  "[1,\"tree\"]],{\"total_time\":145}]";
+  if (tree.str() != values)
+    throw std::logic_error("Writer and tree disagree: " + tree.str());
+
+  // can be reused
+  writer.clear();
+  writer.start_array();
+  writer(uint64_t(1));
+  writer.end_array();
+  if (writer.get_buffer() != "[1]")
+    throw std::logic_error("Wrong json after clear: " + writer.get_buffer());
+}
+
+void TestJsonPointer() {
+  rapidjson::Document d;
+  d.Parse(R"({"a":{"b":[1,{"c":"d"}],"":2,"e/f":3},"10":4})");
+  // the paths we walk ourselves agree with rapidjson
+  for (const char* path : {"", "/a", "/a/b", "/a/b/0", "/a/b/1/c", "/a/", "/10", "/a/b/2", "/a/b/01",
+                           "/a/b/x", "/a/b/0/c", "/x", "/a/e~1f", "/a/e/f"}) {
+    const rapidjson::Value& root = d;
+    if (rapidjson::find(root, path) != rapidjson::Pointer{path}.Get(root))
+      throw std::logic_error(std::string("Wrong value at ") + path);
+  }
+  if (rapidjson::get<std::string>(d, "/a/b/1/c") != "d" ||
+      rapidjson::get<int>(d, "/a/e~1f") != 3 || rapidjson::get<int>(d, "/x", 5) != 5)
+    throw std::logic_error("Wrong value from get");
+}
+
 } // namespace
 
 int main() {
@@ -76,5 +147,9 @@ int main() {
 
   suite.test(TEST_CASE(TestJsonSerialize));
 
+  suite.test(TEST_CASE(TestJsonWriter));
+
+  suite.test(TEST_CASE(TestJsonPointer));
+
   return suite.tear_down();
 }
@@ -0,0 +1,72 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/labelarena.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+using namespace valhalla::thor;
+
+namespace {
+
+void TestInitialReserve() {
+  LabelArena arena(50000, 1000);
+  std::vector<uint32_t> labels;
+  arena.reserve(labels);
+  if (labels.capacity() < 50000 || arena.target() != 50000)
+    throw runtime_error("Initial reservation should match the initial count");
+
+  // Clearing labels that were never used does not change the target
+  arena.recycle(labels);
+  arena.recycle(labels);
+  if (arena.target() != 50000)
+    throw runtime_error("Recycling an empty label set should not change the target");
+}
+
+void TestGrowAndShrink() {
+  LabelArena arena(1000, 100);
+  std::vector<uint32_t> labels;
+
+  // A large search raises the target above what it used
+  arena.reserve(labels);
+  labels.resize(100000);
+  arena.recycle(labels);
+  if (!labels.empty() || arena.target() < 100000)
+    throw runtime_error("Target should follow the largest recent search");
+  if (labels.capacity() < 100000)
+    throw runtime_error("Storage of a search near the target should be kept");
+
+  // Many small searches decay the target and eventually release the storage
+  for (int i = 0; i < 100; ++i) {
+    arena.reserve(labels);
+    labels.resize(200);
+    arena.recycle(labels);
+  }
+  if (arena.target() > 1000)
+    throw runtime_error("Target should decay after small searches: " +
+                        std::to_string(arena.target()));
+  if (labels.capacity() > 2 * arena.target())
+    throw runtime_error("Excess label storage should have been released");
+
+  // Never below the minimum
+  for (int i = 0; i < 100; ++i) {
+    labels.resize(1);
+    arena.recycle(labels);
+  }
+  if (arena.target() != 100)
+    throw runtime_error("Target should not drop below the minimum");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("labelarena");
+
+  suite.test(TEST_CASE(TestInitialReserve));
+
+  suite.test(TEST_CASE(TestGrowAndShrink));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,199 @@
+#include "baldr/landmarks.h"
+#include "mjolnir/landmarkbuilder.h"
+#include "thor/astarheuristic.h"
+#include "test.h"
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// A grid of one way and two way roads with random lengths, spaced 100m apart, and a separate
+// island of two nodes at the end
+std::vector<LandmarkEdge> make_grid(const uint32_t width, const uint32_t height, std::mt19937& gen) {
+  std::uniform_real_distribution<float> length(100.f, 400.f);
+  std::uniform_int_distribution<int> kind(0, 5);
+  std::vector<LandmarkEdge> edges;
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint32_t node = y * width + x;
+      for (uint32_t next : {x + 1 < width ? node + 1 : node, y + 1 < height ? node + width : node}) {
+        if (next == node) {
+          continue;
+        }
+        int k = kind(gen);
+        if (k != 0) {
+          edges.push_back({node, next, length(gen)});
+        }
+        if (k != 1) {
+          edges.push_back({next, node, length(gen)});
+        }
+      }
+    }
+  }
+  uint32_t island = width * height;
+  edges.push_back({island, island + 1, 50.f});
+  edges.push_back({island + 1, island, 50.f});
+  return edges;
+}
+
+// Plain Dijkstra over the edges
+std::vector<float> dijkstra(const uint32_t node_count,
+                            const std::vector<LandmarkEdge>& edges,
+                            const uint32_t source) {
+  std::vector<std::vector<uint32_t>> out(node_count);
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    out[edges[i].from].push_back(i);
+  }
+  std::vector<float> dist(node_count, std::numeric_limits<float>::infinity());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second]) {
+      continue;
+    }
+    for (auto e : out[top.second]) {
+      float d = top.first + edges[e].length;
+      if (d < dist[edges[e].to]) {
+        dist[edges[e].to] = d;
+        queue.emplace(d, edges[e].to);
+      }
+    }
+  }
+  return dist;
+}
+
+void test_lower_bounds() {
+  std::mt19937 gen(7);
+  const uint32_t width = 30, height = 20, node_count = width * height + 2;
+  auto edges = make_grid(width, height, gen);
+  auto landmarks = LandmarkBuilder::Compute(node_count, edges, 8, 10.f);
+  if (landmarks.count != 8 || landmarks.landmarks.size() != 8 ||
+      landmarks.values.size() != size_t(node_count) * 2 * 8)
+    throw std::logic_error("Wrong number of landmarks");
+  for (size_t i = 0; i < landmarks.landmarks.size(); ++i)
+    for (size_t j = 0; j < i; ++j)
+      if (landmarks.landmarks[i] == landmarks.landmarks[j])
+        throw std::logic_error("Landmarks should be distinct");
+
+  // the bound never overestimates and on a grid it is usually a good part of the real length
+  std::uniform_int_distribution<uint32_t> node(0, node_count - 1);
+  double bounds = 0, lengths = 0;
+  for (int i = 0; i < 50; ++i) {
+    auto source = node(gen);
+    auto dist = dijkstra(node_count, edges, source);
+    for (int j = 0; j < 50; ++j) {
+      auto target = node(gen);
+      auto bound = landmarks.LowerBound(&landmarks.values[size_t(source) * 16],
+                                        &landmarks.values[size_t(target) * 16]);
+      if (bound > dist[target])
+        throw std::logic_error("Bound " + std::to_string(bound) + " is over the path length " +
+                               std::to_string(dist[target]));
+      if (dist[target] != std::numeric_limits<float>::infinity()) {
+        bounds += bound;
+        lengths += dist[target];
+      }
+    }
+  }
+  if (bounds < lengths * .5)
+    throw std::logic_error("The bounds should be tighter than that");
+}
+
+void test_file() {
+  std::mt19937 gen(3);
+  auto edges = make_grid(4, 3, gen);
+  auto landmarks = LandmarkBuilder::Compute(14, edges, 16, 10.f);
+  if (landmarks.count == 0 || landmarks.count > 14)
+    throw std::logic_error("Small graphs should get as many landmarks as they can");
+
+  // two tiles with 10 and 4 nodes
+  landmarks.access = kPedestrianAccess;
+  landmarks.tiles = {GraphId(5, 2, 0).value, GraphId(9, 2, 0).value};
+  landmarks.offsets = {0, 10, 14};
+  landmarks.write("test/data/landmarks.alt");
+  auto loaded = Landmarks::load("test/data/landmarks.alt");
+  if (!loaded || loaded->access != kPedestrianAccess || loaded->count != landmarks.count ||
+      loaded->values != landmarks.values || loaded->landmarks != landmarks.landmarks)
+    throw std::logic_error("Landmarks did not survive the round trip");
+
+  auto stride = 2 * loaded->count;
+  if (loaded->lengths(GraphId(5, 2, 3)) != loaded->values.data() + 3 * stride ||
+      loaded->lengths(GraphId(9, 2, 2)) != loaded->values.data() + 12 * stride)
+    throw std::logic_error("Wrong lengths for a node");
+  if (loaded->lengths(GraphId(9, 2, 4)) || loaded->lengths(GraphId(6, 2, 0)) ||
+      loaded->lengths(GraphId(5, 1, 0)))
+    throw std::logic_error("Unknown nodes should have no lengths");
+
+  if (Landmarks::load("test/data/does_not_exist.alt"))
+    throw std::logic_error("Missing files should not load");
+}
+
+void test_heuristic() {
+  // a line of nodes 1km apart going east and a detour of 5km between the first two
+  std::vector<LandmarkEdge> edges;
+  for (uint32_t i = 0; i + 1 < 6; ++i) {
+    float length = i == 0 ? 5000.f : 1000.f;
+    edges.push_back({i, i + 1, length});
+    edges.push_back({i + 1, i, length});
+  }
+  auto landmarks = LandmarkBuilder::Compute(6, edges, 2, 10.f);
+  landmarks.tiles = {GraphId(0, 2, 0).value};
+  landmarks.offsets = {0, 6};
+
+  // nodes 0 and 1 are right next to each other as the crow flies
+  PointLL origin(0.f, 0.f), destination(0.f, 0.f);
+  AStarHeuristic heuristic;
+  heuristic.Init(destination, 2.f);
+  float dist = 0.f;
+  auto great_circle = heuristic.Get(origin, GraphId(0, 2, 0), dist);
+  heuristic.SetLandmarks(&landmarks, {landmarks.lengths(GraphId(0, 2, 1))}, false);
+  auto bounded = heuristic.Get(origin, GraphId(0, 2, 0), dist);
+  if (great_circle != 0.f || dist != 0.f)
+    throw std::logic_error("The great circle part should not change");
+  if (bounded < 2.f * 4980.f || bounded > 2.f * 5000.f)
+    throw std::logic_error("The landmarks should bound the detour, got " + std::to_string(bounded));
+
+  // the path from 1 to 0 in reverse, the closest of several targets and nodes it does not know
+  heuristic.SetLandmarks(&landmarks, {landmarks.lengths(GraphId(0, 2, 1))}, true);
+  if (std::abs(heuristic.Get(origin, GraphId(0, 2, 0), dist) - bounded) > 1.f)
+    throw std::logic_error("The reverse bound should be the same");
+  heuristic.SetLandmarks(&landmarks,
+                         {landmarks.lengths(GraphId(0, 2, 5)), landmarks.lengths(GraphId(0, 2, 1))},
+                         false);
+  if (std::abs(heuristic.Get(origin, GraphId(0, 2, 0), dist) - bounded) > 1.f)
+    throw std::logic_error("The closest target should bound the estimate");
+  if (heuristic.Get(origin, GraphId(0, 1, 0), dist) != great_circle)
+    throw std::logic_error("Unknown nodes should keep the great circle estimate");
+  heuristic.Init(destination, 2.f);
+  if (heuristic.Get(origin, GraphId(0, 2, 0), dist) != great_circle)
+    throw std::logic_error("Init should drop the landmarks");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("landmarks");
+
+  suite.test(TEST_CASE(test_lower_bounds));
+
+  suite.test(TEST_CASE(test_file));
+
+  suite.test(TEST_CASE(test_heuristic));
+
+  return suite.tear_down();
+}
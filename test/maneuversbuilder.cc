@@ -1753,7 +1753,7 @@ void TryIsIntersectingForwardEdge(ManeuversBuilderTest& mbTest, int node_index,
   auto curr_edge = mbTest.trip_path()->GetCurrEdge(node_index);
 
   bool intersecting_forward_link =
-      mbTest.IsIntersectingForwardEdge(node_index, prev_edge.get(), curr_edge.get());
+      mbTest.IsIntersectingForwardEdge(node_index, prev_edge, curr_edge);
 
   if (intersecting_forward_link != expected) {
     throw std::runtime_error("Incorrect intersecting forward link value - expected: " +
@@ -9,10 +9,16 @@
 #include <boost/property_tree/ptree.hpp>
 
 #include "baldr/json.h"
+#include "baldr/tilehierarchy.h"
 #include "loki/worker.h"
+#include "meili/batch_matcher.h"
+#include "meili/map_matcher_factory.h"
+#include "meili/openlr_decoder.h"
+#include "meili/openlr_encoder.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/openlr.h"
 #include "midgard/util.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
@@ -694,6 +700,49 @@ void test_topk_validate() {
     throw std::logic_error("There should be only one result");
 }
 
+void test_columnar_trace_attributes() {
+  // the columns have the same edges and values as the objects per edge
+  tyr::actor_t actor(conf, true);
+  std::string trace = R"("shape_match":"map_snap","shape":[
+         {"lat":52.09579,"lon":5.13137,"accuracy":5,"time":2},
+         {"lat":52.09652,"lon":5.13184,"accuracy":5,"time":4},
+         {"lat":52.09705,"lon":5.13231,"accuracy":5,"time":6}],
+         "filters":{"attributes":["edge.id","edge.way_id","edge.length","edge.road_class",
+         "edge.speed","confidence_score"],"action":"include"})";
+  auto rows = json_to_pt(actor.trace_attributes(R"({"costing":"auto",)" + trace + "}"));
+  auto columns =
+      json_to_pt(actor.trace_attributes(R"({"costing":"auto","columnar":true,)" + trace + "}"));
+
+  const auto& edges = rows.get_child("edges");
+  const auto& edge_columns = columns.get_child("edges");
+  if (edges.empty() ||
+      columns.get<float>("confidence_score") != rows.get<float>("confidence_score"))
+    throw std::logic_error("Expected a matched path");
+  for (const auto& key : {"id", "way_id", "length", "road_class", "speed"}) {
+    const auto& column = edge_columns.get_child(key);
+    if (column.size() != edges.size())
+      throw std::logic_error(std::string("Expected a value per edge in the column ") + key);
+    auto value = column.begin();
+    for (const auto& edge : edges) {
+      if (edge.second.get<std::string>(key) != value->second.get_value<std::string>())
+        throw std::logic_error(std::string("Expected the same values in the column ") + key);
+      ++value;
+    }
+  }
+  if (edge_columns.count("use"))
+    throw std::logic_error("Only the requested attributes should have a column");
+
+  // or the same columns as protobuf
+  Api api;
+  api.ParseFromString(
+      actor.trace_attributes(R"({"costing":"auto","columnar":true,"format":"pbf",)" + trace + "}"));
+  if (api.trace_attributes_size() != 1 ||
+      api.trace_attributes(0).ids_size() != static_cast<int>(edges.size()) ||
+      api.trace_attributes(0).ids(0) != edges.front().second.get<uint64_t>("id") ||
+      !api.trace_attributes(0).uses().empty())
+    throw std::logic_error("Expected the columns as protobuf");
+}
+
 void test_topk_fork_alternate() {
   // tests a fork in the road
   tyr::actor_t actor(conf, true);
@@ -1076,6 +1125,314 @@ void test_intersection_matching() {
     }
   }
 }
+
+std::vector<uint64_t> edges_of(const std::vector<meili::MatchResult>& results) {
+  std::vector<uint64_t> edges;
+  for (const auto& result : results)
+    edges.push_back(result.edgeid);
+  return edges;
+}
+
+void test_online_match() {
+  // a trace along a route, one measurement a second
+  tyr::actor_t actor(conf, true);
+  std::string request =
+      R"({"costing":"auto","locations":[{"lat":52.0957,"lon":5.1099},{"lat":52.0802,"lon":5.1290}]})";
+  auto route = json_to_pt(actor.route(request));
+  auto shape = midgard::decode<std::vector<PointLL>>(
+      route.get_child("trip.legs").front().second.get<std::string>("shape"));
+  shape = midgard::resample_spherical_polyline(shape, 12);
+  std::vector<meili::Measurement> measurements;
+  for (size_t i = 0; i < shape.size(); ++i)
+    measurements.emplace_back(shape[i], 5.f, 15.f, 1000. + i);
+
+  Api api;
+  ParseApi(request, Options::route, api);
+  meili::MapMatcherFactory factory(conf);
+  std::shared_ptr<meili::MapMatcher> matcher(factory.Create(api.options()));
+  auto offline = matcher->OfflineMatch(measurements).front();
+
+  // matching the measurements as they come in gives the same matches and route
+  matcher->Clear();
+  std::vector<meili::MatchResult> results;
+  std::vector<uint64_t> edges;
+  size_t max_window = 0;
+  for (size_t i = 0; i <= measurements.size(); ++i) {
+    auto online = i < measurements.size() ? matcher->OnlineMatch(measurements[i])
+                                          : matcher->FinishOnlineMatch();
+    std::copy(online.results.cbegin(), online.results.cend(), std::back_inserter(results));
+    for (auto edge : online.edges)
+      if (edges.empty() || edges.back() != edge)
+        edges.push_back(edge);
+    max_window = std::max<size_t>(max_window, matcher->state_container().size() -
+                                                  matcher->state_container().first_time());
+  }
+  if (edges_of(results) != edges_of(offline.results))
+    throw std::logic_error("Online matches should be the offline ones");
+  if (edges != offline.edges)
+    throw std::logic_error("Online route should be the offline one");
+  if (max_window * 2 > measurements.size())
+    throw std::logic_error("Online matching should have dropped the measurements it matched");
+
+  // paths that take too long to converge are cut to bound the memory
+  auto small_window = conf;
+  small_window.put("meili.default.online_window", 2);
+  meili::MapMatcherFactory small_factory(small_window);
+  matcher.reset(small_factory.Create(api.options()));
+  results.clear();
+  for (const auto& measurement : measurements) {
+    auto online = matcher->OnlineMatch(measurement);
+    std::copy(online.results.cbegin(), online.results.cend(), std::back_inserter(results));
+    if (matcher->state_container().size() - matcher->state_container().first_time() > 4)
+      throw std::logic_error("Online matching should cut the paths after 2 measurements");
+  }
+  auto online = matcher->FinishOnlineMatch();
+  std::copy(online.results.cbegin(), online.results.cend(), std::back_inserter(results));
+  if (results.size() != offline.results.size())
+    throw std::logic_error("Every measurement should have a match result");
+}
+
+void test_shared_grid_cache() {
+  baldr::GraphReader reader(conf.get_child("mjolnir"));
+  auto cell = baldr::TileHierarchy::levels().rbegin()->second.tiles.TileSize() / 500;
+  auto cache = std::make_shared<meili::CandidateGridCache>(100);
+  meili::CandidateGridQuery first(reader, cell, cell, cache);
+  meili::CandidateGridQuery second(reader, cell, cell, cache);
+  meili::CandidateGridQuery own(reader, cell, cell);
+  PointLL point(5.1099, 52.0957);
+
+  // the second query gets the grids the first one made
+  auto candidates = first.Query(point, 50 * 50, nullptr);
+  auto grids = cache->size();
+  if (candidates.empty() || grids == 0 || first.size() != grids)
+    throw std::logic_error("The first query should have made the grids");
+  auto shared = second.Query(point, 50 * 50, nullptr);
+  if (cache->size() != grids || second.size() != grids)
+    throw std::logic_error("The second query should have reused the grids");
+  auto expected = own.Query(point, 50 * 50, nullptr);
+  if (shared.size() != expected.size() || candidates.size() != expected.size())
+    throw std::logic_error("Shared grids should find the same candidates");
+
+  // clearing the shared cache leaves the grids the queries have, a full one is cleared
+  cache->Clear();
+  if (first.Query(point, 50 * 50, nullptr).size() != expected.size() || cache->size() != 0)
+    throw std::logic_error("Queries should keep using their grids");
+  auto small = std::make_shared<meili::CandidateGridCache>(1);
+  meili::CandidateGridQuery bounded(reader, cell, cell, small);
+  bounded.Query(point, 2000 * 2000, nullptr);
+  if (small->size() != 1)
+    throw std::logic_error("A full shared cache should have been cleared");
+}
+
+void test_batch_match() {
+  // traces along a few routes
+  tyr::actor_t actor(conf, true);
+  std::vector<std::pair<PointLL, PointLL>> routes{{{5.1099, 52.0957}, {5.1290, 52.0802}},
+                                                  {{5.0636, 52.0902}, {5.1293, 52.0789}},
+                                                  {{5.1171, 52.0934}, {5.0946, 52.0700}}};
+  std::vector<std::vector<meili::Measurement>> traces;
+  for (size_t i = 0; i < 4; ++i) {
+    for (const auto& route : routes) {
+      std::string request = R"({"costing":"auto","locations":[{"lat":)" +
+                            std::to_string(route.first.lat()) + R"(,"lon":)" +
+                            std::to_string(route.first.lng()) + R"(},{"lat":)" +
+                            std::to_string(route.second.lat()) + R"(,"lon":)" +
+                            std::to_string(route.second.lng()) + "}]}";
+      auto shape = midgard::decode<std::vector<PointLL>>(json_to_pt(actor.route(request))
+                                                             .get_child("trip.legs")
+                                                             .front()
+                                                             .second.get<std::string>("shape"));
+      // every repetition is resampled a bit differently
+      shape = midgard::resample_spherical_polyline(shape, 10 + i * 5);
+      traces.emplace_back();
+      for (size_t j = 0; j < shape.size(); ++j)
+        traces.back().emplace_back(shape[j], 5.f, 15.f, 1000. + j);
+    }
+  }
+
+  // what matching them one after another gives
+  Options options;
+  options.set_costing(Costing::auto_);
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+  std::vector<std::vector<uint64_t>> expected;
+  for (const auto& trace : traces)
+    expected.push_back(matcher->OfflineMatch(trace).front().edges);
+
+  // matching them at once gives the same, handed back in order
+  meili::BatchMatcher batch(conf, nullptr, 3);
+  if (batch.concurrency() != 3)
+    throw std::logic_error("Expected a matcher per thread");
+  size_t taken = 0, index = 0;
+  batch.Match(
+      options,
+      [&](std::vector<meili::Measurement>& measurements) {
+        if (taken == traces.size())
+          return false;
+        measurements = traces[taken++];
+        return true;
+      },
+      [&](size_t i, std::vector<meili::Measurement>&& measurements,
+          std::vector<meili::MatchResults>&& results) {
+        if (i != index++)
+          throw std::logic_error("Traces should be handed back in order");
+        if (measurements.size() != traces[i].size() || results.front().edges != expected[i])
+          throw std::logic_error("Batch matching should match like one matcher does");
+      });
+  if (index != traces.size())
+    throw std::logic_error("Every trace should have been handed back");
+
+  // errors stop the batch and are thrown to the caller
+  bool thrown = false;
+  try {
+    taken = 0;
+    batch.Match(
+        options,
+        [&](std::vector<meili::Measurement>& measurements) {
+          if (taken++ == 2)
+            throw std::runtime_error("bad trace");
+          measurements = traces.front();
+          return taken < traces.size();
+        },
+        [](size_t, std::vector<meili::Measurement>&&, std::vector<meili::MatchResults>&&) {});
+  } catch (const std::runtime_error& e) {
+    thrown = std::string(e.what()) == "bad trace";
+  }
+  if (!thrown)
+    throw std::logic_error("Batch matching should throw the error of a trace");
+}
+
+float path_length(baldr::GraphReader& reader, const meili::OpenLRDecoder::path_t& path) {
+  float length = 0.f;
+  for (const auto& segment : path) {
+    const auto* edge = reader.directededge(segment.edgeid);
+    length += (segment.target - segment.source) * edge->length();
+  }
+  return length;
+}
+
+// location references along a few routes
+std::vector<std::string> route_references() {
+  tyr::actor_t actor(conf, true);
+  std::vector<std::pair<PointLL, PointLL>> routes{{{5.1099, 52.0957}, {5.1290, 52.0802}},
+                                                  {{5.0636, 52.0902}, {5.1293, 52.0789}},
+                                                  {{5.1171, 52.0934}, {5.0946, 52.0700}}};
+  std::vector<std::string> references;
+  for (const auto& route : routes) {
+    std::string request = R"({"costing":"auto","locations":[{"lat":)" +
+                          std::to_string(route.first.lat()) + R"(,"lon":)" +
+                          std::to_string(route.first.lng()) + R"(},{"lat":)" +
+                          std::to_string(route.second.lat()) + R"(,"lon":)" +
+                          std::to_string(route.second.lng()) + "}]}";
+    auto leg = json_to_pt(actor.route(request)).get_child("trip.legs").front().second;
+    auto shape = midgard::decode<std::vector<PointLL>>(leg.get<std::string>("shape"));
+    std::string empty(16, 0);
+    empty[0] = 0x0b;
+    OpenLR::LineLocation location(empty);
+    location.first.longitude = shape.front().lng();
+    location.first.latitude = shape.front().lat();
+    location.first.distance = leg.get<float>("summary.length") * 1000;
+    location.last.longitude = shape.back().lng();
+    location.last.latitude = shape.back().lat();
+    references.push_back(location.toBinary());
+  }
+  return references;
+}
+
+void test_openlr_decode() {
+  auto references = route_references();
+  const size_t routes = references.size();
+  // the same references again and one that is not a reference at all
+  references.push_back(references.front());
+  references.push_back("nope");
+
+  Options options;
+  options.set_costing(Costing::auto_);
+  auto reader = std::make_shared<baldr::GraphReader>(conf.get_child("mjolnir"));
+  meili::OpenLRDecoder decoder(conf, reader, 2);
+  auto paths = decoder.Decode(options, references);
+  if (paths.size() != references.size() || paths.back() || paths.front() != paths[routes])
+    throw std::logic_error("Expected a path for each valid reference");
+  for (size_t i = 0; i < routes; ++i) {
+    if (!paths[i] || paths[i]->empty())
+      throw std::logic_error("Expected a path for the reference along route " + std::to_string(i));
+    for (auto segment = std::next(paths[i]->cbegin()); segment != paths[i]->cend(); ++segment) {
+      if (!std::prev(segment)->Adjoined(*reader, *segment))
+        throw std::logic_error("The edges of a decoded path should be connected");
+    }
+    OpenLR::LineLocation location(references[i]);
+    if (location.getFirstCoordinate().Distance(paths[i]->front().Shape(*reader).front()) > 50 ||
+        location.getLastCoordinate().Distance(paths[i]->back().Shape(*reader).back()) > 50)
+      throw std::logic_error("A decoded path should go from the first to the last point");
+  }
+
+  // references that come again are not matched again
+  if (decoder.cached() != routes)
+    throw std::logic_error("Expected the decoded paths to be cached");
+  auto again = decoder.Decode(options, {references[1]});
+  if (again.front() != paths[1] || decoder.cached() != routes)
+    throw std::logic_error("A cached path should have been reused");
+
+  // offsets are trimmed off of the path
+  OpenLR::LineLocation location(references.front());
+  location.poff = 200;
+  location.noff = 300;
+  OpenLR::LineLocation trimmed_location(location.toBinary());
+  auto trimmed = decoder.Decode(options, {location.toBinary()}).front();
+  float expected = path_length(*reader, *paths.front()) - trimmed_location.poff -
+                   trimmed_location.noff;
+  if (!trimmed || std::abs(path_length(*reader, *trimmed) - expected) > 1)
+    throw std::logic_error("The offsets should have been trimmed off of the path");
+}
+
+void test_openlr_encode() {
+  Options options;
+  options.set_costing(Costing::auto_);
+  auto reader = std::make_shared<baldr::GraphReader>(conf.get_child("mjolnir"));
+  meili::OpenLRDecoder decoder(conf, reader, 2, 0);
+  auto references = route_references();
+  std::vector<meili::OpenLREncoder::path_t> paths;
+  for (const auto& path : decoder.Decode(options, references)) {
+    if (!path)
+      throw std::logic_error("Expected a path for each reference");
+    paths.push_back(*path);
+  }
+  // cut into the ends so the references have offsets
+  paths.front().front().source = .5f;
+  paths.front().back().target = .5f;
+
+  // the encoded references decode to the paths they were encoded from
+  meili::OpenLREncoder encoder(*reader);
+  auto encoded = encoder.Encode(paths);
+  auto decoded = decoder.Decode(options, encoded);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (!decoded[i] || decoded[i]->size() < 2)
+      throw std::logic_error("Expected the encoded reference to decode");
+    auto edges = [](const meili::OpenLREncoder::path_t& path) {
+      std::vector<uint64_t> edges;
+      for (auto segment = std::next(path.cbegin()); segment != std::prev(path.cend()); ++segment)
+        edges.push_back(segment->edgeid);
+      return edges;
+    };
+    if (edges(*decoded[i]) != edges(paths[i]))
+      throw std::logic_error("The encoded reference should follow the same edges");
+    if (std::abs(path_length(*reader, *decoded[i]) - path_length(*reader, paths[i])) > 60)
+      throw std::logic_error("The encoded reference should be as long as the path");
+  }
+
+  // a location reference point is never further from the next than can be encoded
+  OpenLR::LineLocation location(encoded[1]);
+  if (location.first.distance > 255 * 58.6f)
+    throw std::logic_error("Location reference points are too far apart");
+  for (const auto& lrp : location.intermediate) {
+    if (lrp.distance > 255 * 58.6f)
+      throw std::logic_error("Location reference points are too far apart");
+  }
+
+  // nothing to encode
+  if (!encoder.Encode(meili::OpenLREncoder::path_t{}).empty())
+    throw std::logic_error("An empty path should have no reference");
+}
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1108,6 +1465,8 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(test_topk_validate));
 
+  suite.test(TEST_CASE(test_columnar_trace_attributes));
+
   suite.test(TEST_CASE(test_topk_fork_alternate));
 
   suite.test(TEST_CASE(test_topk_loop_alternate));
@@ -1124,5 +1483,15 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(test_intersection_matching));
 
+  suite.test(TEST_CASE(test_online_match));
+
+  suite.test(TEST_CASE(test_batch_match));
+
+  suite.test(TEST_CASE(test_shared_grid_cache));
+
+  suite.test(TEST_CASE(test_openlr_decode));
+
+  suite.test(TEST_CASE(test_openlr_encode));
+
   return suite.tear_down();
 }
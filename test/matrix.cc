@@ -1,6 +1,9 @@
 #include "test.h"
 
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -13,6 +16,7 @@
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
+#include "tyr/serializers.h"
 
 using namespace valhalla;
 using namespace valhalla::thor;
@@ -315,6 +319,251 @@ void test_matrix() {
   }
 }
 
+void test_matrix_parallel() {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  // Rows only run on the pool with a reader that can be shared by its threads
+  auto sharded = config.get_child("mjolnir");
+  sharded.put("use_sharded_tile_cache", true);
+  GraphReader reader(sharded);
+  if (!reader.IsThreadSafe())
+    throw std::runtime_error("Expected the sharded reader to be thread-safe");
+
+  cost_ptr_t costing = CreateSimpleCost(request.options());
+  ThreadPool pool(4);
+  TimeDistanceMatrix timedist_matrix;
+  timedist_matrix.set_thread_pool(&pool);
+  for (int run = 0; run < 3; ++run) {
+    auto results =
+        timedist_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                       reader, &costing, TravelMode::kDrive, 400000.0);
+    if (results.size() != matrix_answers.size())
+      throw std::runtime_error("Unexpected TimeDistMatrix size on the thread pool");
+    for (uint32_t i = 0; i < results.size(); ++i) {
+      if (!within_tolerance(results[i].dist, matrix_answers[i].dist) ||
+          !within_tolerance(results[i].time, matrix_answers[i].time))
+        throw std::runtime_error("result " + std::to_string(i) +
+                                 " of TimeDistMatrix differs on the thread pool");
+    }
+  }
+}
+
+void test_matrix_shared_expansions() {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.options());
+  CostMatrix cost_matrix;
+  auto expected =
+      cost_matrix.SourceToTarget(request.options().sources(), request.options().targets(), reader,
+                                 &costing, TravelMode::kDrive, 400000.0);
+
+  // Locations snapped the same way are searched from once and get the same row or column
+  const std::vector<int> source_order{0, 1, 0, 2, 3, 1};
+  const std::vector<int> target_order{3, 3, 0, 1, 2};
+  google::protobuf::RepeatedPtrField<valhalla::Location> sources, targets;
+  for (auto i : source_order) {
+    sources.Add()->CopyFrom(request.options().sources(i));
+  }
+  for (auto j : target_order) {
+    targets.Add()->CopyFrom(request.options().targets(j));
+  }
+  auto results =
+      cost_matrix.SourceToTarget(sources, targets, reader, &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != source_order.size() * target_order.size())
+    throw std::runtime_error("Expected a result for every pair of duplicated locations");
+  for (size_t i = 0; i < source_order.size(); ++i) {
+    for (size_t j = 0; j < target_order.size(); ++j) {
+      const auto& result = results[i * target_order.size() + j];
+      const auto& answer = expected[source_order[i] * 4 + target_order[j]];
+      if (result.time != answer.time || result.dist != answer.dist)
+        throw std::runtime_error("Expected duplicated locations to get the same results");
+    }
+  }
+
+  // The sources are the targets, each is searched from once. The costing has oneways so the
+  // results are only close to the ones searched from and to each location
+  cost_matrix.set_symmetric(true);
+  results = cost_matrix.SourceToTarget(request.options().sources(), request.options().sources(),
+                                       reader, &costing, TravelMode::kDrive, 400000.0);
+  cost_matrix.set_symmetric(false);
+  expected = cost_matrix.SourceToTarget(request.options().sources(), request.options().sources(),
+                                        reader, &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != expected.size())
+    throw std::runtime_error("Expected a symmetric result for every pair");
+  for (size_t i = 0; i < results.size(); ++i) {
+    bool off = i % 5 == 0 ? results[i].time != 0 || results[i].dist != 0
+                          : results[i].time < expected[i].time / 2 ||
+                                results[i].time > expected[i].time * 2;
+    if (off)
+      throw std::runtime_error("result " + std::to_string(i) +
+                               " of the symmetric CostMatrix is too far off");
+  }
+}
+
+void test_matrix_max_time() {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  try {
+    ParseApi(std::string(test_request).insert(1, R"("max_time":0,)"), Options::sources_to_targets,
+             request);
+    throw std::logic_error("Expected a max time of 0 to be rejected");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 137)
+      throw std::runtime_error("Expected a max time of 0 to be rejected");
+  }
+  request.Clear();
+  ParseApi(std::string(test_request).insert(1, R"("max_time":1e12,"sparse":true,)"),
+           Options::sources_to_targets, request);
+  if (request.options().max_time() != 1e9f || !request.options().sparse())
+    throw std::runtime_error("Expected the max time and sparse to be parsed");
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  // Cut the pairs in the middle of the widest gap between their times
+  std::vector<uint32_t> times;
+  for (const auto& answer : matrix_answers) {
+    times.push_back(answer.time);
+  }
+  std::sort(times.begin(), times.end());
+  size_t gap = 0;
+  for (size_t i = 1; i + 1 < times.size(); ++i) {
+    if (times[i + 1] - times[i] > times[gap + 1] - times[gap]) {
+      gap = i;
+    }
+  }
+  const float max_time = (times[gap] + times[gap + 1]) / 2.f;
+
+  GraphReader reader(config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.options());
+  const auto check = [&max_time](const std::vector<TimeDistance>& results, const char* engine) {
+    if (results.size() != matrix_answers.size())
+      throw std::runtime_error(std::string("Expected a result for every pair from ") + engine);
+    for (size_t i = 0; i < results.size(); ++i) {
+      bool off = matrix_answers[i].time > max_time
+                     ? results[i].time != kMaxCost
+                     : !within_tolerance(results[i].time, matrix_answers[i].time) ||
+                           !within_tolerance(results[i].dist, matrix_answers[i].dist);
+      if (off)
+        throw std::runtime_error("result " + std::to_string(i) + " of " + engine +
+                                 " does not respect the max time");
+    }
+  };
+  CostMatrix cost_matrix;
+  cost_matrix.set_max_time(max_time);
+  check(cost_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                   reader, &costing, TravelMode::kDrive, 400000.0),
+        "CostMatrix");
+  TimeDistanceMatrix timedist_matrix;
+  timedist_matrix.set_max_time(max_time);
+  check(timedist_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                       reader, &costing, TravelMode::kDrive, 400000.0),
+        "TimeDistanceMatrix");
+
+  // The sparse matrix only has the pairs with a route
+  request.mutable_options()->set_format(Options::pbf);
+  auto time_distances = matrix_answers;
+  time_distances[1].time = kMaxCost;
+  time_distances.back().time = kMaxCost;
+  Api response;
+  if (!response.ParseFromString(serializeMatrix(request, time_distances, 0.001)))
+    throw std::runtime_error("Expected the sparse matrix to be protobuf");
+  const auto& matrix = response.matrix();
+  if (matrix.times_size() != time_distances.size() - 2 ||
+      matrix.distances_size() != matrix.times_size() ||
+      matrix.sources_size() != matrix.times_size() || matrix.targets_size() != matrix.times_size())
+    throw std::runtime_error("Expected a time, distance, source and target per reached pair");
+  for (int i = 0; i < matrix.times_size(); ++i) {
+    const auto& answer = time_distances[matrix.sources(i) * 4 + matrix.targets(i)];
+    if (answer.time == kMaxCost || matrix.times(i) != answer.time ||
+        (i > 0 && matrix.sources(i) * 4 + matrix.targets(i) <=
+                      matrix.sources(i - 1) * 4 + matrix.targets(i - 1)))
+      throw std::runtime_error("pair " + std::to_string(i) + " differs in the sparse matrix");
+  }
+}
+
+void test_matrix_time_dependent() {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.options());
+
+  // Departing at a time the searches cost the edges with the speeds at the time they are reached
+  auto sources = request.options().sources();
+  for (auto& source : sources) {
+    source.set_date_time("2020-01-06T08:00");
+  }
+  TimeDistanceMatrix timedist_matrix;
+  auto results = timedist_matrix.SourceToTarget(sources, request.options().targets(), reader,
+                                                &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != matrix_answers.size())
+    throw std::runtime_error("Expected a time dependent result for every pair");
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i].time == kMaxCost || results[i].time > matrix_answers[i].time * 2 ||
+        results[i].time * 2 < matrix_answers[i].time)
+      throw std::runtime_error("time dependent result " + std::to_string(i) + " is too far off");
+  }
+
+  // The searches go from the sources even when there are fewer targets
+  google::protobuf::RepeatedPtrField<valhalla::Location> target;
+  target.Add()->CopyFrom(request.options().targets(1));
+  auto column = timedist_matrix.SourceToTarget(sources, target, reader, &costing,
+                                               TravelMode::kDrive, 400000.0);
+  for (size_t i = 0; i < column.size(); ++i) {
+    if (!within_tolerance(column[i].time, results[i * 4 + 1].time) ||
+        !within_tolerance(column[i].dist, results[i * 4 + 1].dist))
+      throw std::runtime_error("Expected the time dependent column to be searched from sources");
+  }
+}
+
+void test_matrix_interrupt() {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.options());
+
+  // the matrix gives up as soon as the interrupt throws
+  struct test_exception_t {};
+  std::function<void()> interrupt = []() { throw test_exception_t{}; };
+  CostMatrix cost_matrix;
+  cost_matrix.set_interrupt(&interrupt);
+  try {
+    cost_matrix.SourceToTarget(request.options().sources(), request.options().targets(), reader,
+                               &costing, TravelMode::kDrive, 400000.0);
+    throw std::logic_error("Expected the interrupt to stop the CostMatrix");
+  } catch (const test_exception_t&) {}
+
+  // without one it still finds the answers
+  cost_matrix.Clear();
+  cost_matrix.set_interrupt(nullptr);
+  auto results = cost_matrix.SourceToTarget(request.options().sources(),
+                                            request.options().targets(), reader, &costing,
+                                            TravelMode::kDrive, 400000.0);
+  if (results.size() != matrix_answers.size())
+    throw std::runtime_error("Expected the CostMatrix to work again after an interrupt");
+}
+
 void test_matrix_osrm() {
   loki_worker_t loki_worker(config);
 
@@ -371,11 +620,55 @@ void test_matrix_osrm() {
   }
 }
 
+void test_matrix_pbf() {
+  Api request;
+  ParseApi(std::string(test_request).insert(1, R"("format":"pbf",)"), Options::sources_to_targets,
+           request);
+  if (request.options().format() != Options::pbf)
+    throw std::runtime_error("Expected the pbf format to be parsed");
+
+  // the answers with a pair that has no route at the end
+  auto time_distances = matrix_answers;
+  time_distances.back().time = kMaxCost;
+  Api response;
+  if (!response.ParseFromString(serializeMatrix(request, time_distances, 0.001)))
+    throw std::runtime_error("Expected the matrix to be protobuf");
+  const auto& matrix = response.matrix();
+  if (matrix.times_size() != time_distances.size() ||
+      matrix.distances_size() != time_distances.size())
+    throw std::runtime_error("Expected a time and distance per pair");
+  for (size_t i = 0; i + 1 < time_distances.size(); ++i) {
+    if (matrix.times(i) != time_distances[i].time ||
+        std::abs(matrix.distances(i) - time_distances[i].dist * 0.001f) > 1e-4f)
+      throw std::runtime_error("result " + std::to_string(i) + " differs in the pbf matrix");
+  }
+  if (matrix.times(time_distances.size() - 1) != std::numeric_limits<uint32_t>::max() ||
+      matrix.distances(time_distances.size() - 1) != -1.f)
+    throw std::runtime_error("Expected the pair without a route to be marked");
+  if (response.options().sources_size() != 4 || response.options().targets_size() != 4)
+    throw std::runtime_error("Expected the locations to come back with the matrix");
+
+  // only routes and matrices can be protobuf
+  try {
+    ParseApi(std::string(test_request).insert(1, R"("format":"pbf",)"), Options::locate, request);
+    throw std::logic_error("Expected locate to reject the pbf format");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 167)
+      throw std::runtime_error("Expected locate to reject the pbf format");
+  }
+}
+
 int main(int argc, char* argv[]) {
   test::suite suite("matrix");
   logging::Configure({{"type", ""}}); // silence logs
 
   suite.test(TEST_CASE(test_matrix));
+  suite.test(TEST_CASE(test_matrix_parallel));
+  suite.test(TEST_CASE(test_matrix_shared_expansions));
+  suite.test(TEST_CASE(test_matrix_max_time));
+  suite.test(TEST_CASE(test_matrix_time_dependent));
+  suite.test(TEST_CASE(test_matrix_pbf));
+  suite.test(TEST_CASE(test_matrix_interrupt));
   // suite.test(TEST_CASE(test_matrix_osrm));
 
   return suite.tear_down();
@@ -0,0 +1,92 @@
+#include "midgard/metrics.h"
+#include "test.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+bool contains(const std::string& text, const std::string& line) {
+  return text.find(line + '\n') != std::string::npos;
+}
+
+void TestCounter() {
+  auto& counter = metrics::GetCounter("test_counter_total", "Things counted", {{"kind", "a"}});
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&counter]() {
+      for (int j = 0; j < 1000; ++j) {
+        counter.add();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (counter.value() != 4000)
+    throw std::runtime_error("Expected every add from every thread to be counted");
+
+  // Looking it up again gets the same one, other labels another one
+  if (&metrics::GetCounter("test_counter_total", "Things counted", {{"kind", "a"}}) != &counter ||
+      &metrics::GetCounter("test_counter_total", "Things counted", {{"kind", "b"}}) == &counter)
+    throw std::runtime_error("Expected a counter per name and labels");
+
+  auto text = metrics::Expose();
+  if (!contains(text, "# TYPE test_counter_total counter") ||
+      !contains(text, "test_counter_total{kind=\"a\"} 4000") ||
+      !contains(text, "test_counter_total{kind=\"b\"} 0"))
+    throw std::runtime_error("Unexpected counter exposition:\n" + text);
+}
+
+void TestHistogram() {
+  auto& histogram = metrics::GetHistogram("test_seconds", "Time taken", {0.1, 1.0});
+  histogram.observe(0.05);
+  histogram.observe(0.1);
+  histogram.observe(0.5);
+  histogram.observe(5.0);
+  if (histogram.count(0) != 2 || histogram.count(1) != 1 || histogram.count(2) != 1 ||
+      histogram.count() != 4 || std::abs(histogram.sum() - 5.65) > 1e-9)
+    throw std::runtime_error("Unexpected histogram counts");
+
+  // The buckets are cumulative when exposed
+  auto text = metrics::Expose();
+  if (!contains(text, "# TYPE test_seconds histogram") ||
+      !contains(text, "test_seconds_bucket{le=\"0.1\"} 2") ||
+      !contains(text, "test_seconds_bucket{le=\"1\"} 3") ||
+      !contains(text, "test_seconds_bucket{le=\"+Inf\"} 4") ||
+      !contains(text, "test_seconds_sum 5.65") || !contains(text, "test_seconds_count 4"))
+    throw std::runtime_error("Unexpected histogram exposition:\n" + text);
+
+  // A name is either a counter or a histogram
+  bool threw = false;
+  try {
+    metrics::GetCounter("test_seconds", "Time taken");
+  } catch (const std::logic_error&) { threw = true; }
+  if (!threw)
+    throw std::runtime_error("Expected a name to keep its type");
+}
+
+void TestLabelEscaping() {
+  metrics::GetCounter("test_escaped_total", "Escaped labels", {{"path", "a\"b\\c"}}).add(2);
+  if (!contains(metrics::Expose(), "test_escaped_total{path=\"a\\\"b\\\\c\"} 2"))
+    throw std::runtime_error("Expected label values to be escaped");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("metrics");
+
+  suite.test(TEST_CASE(TestCounter));
+
+  suite.test(TEST_CASE(TestHistogram));
+
+  suite.test(TEST_CASE(TestLabelEscaping));
+
+  return suite.tear_down();
+}
@@ -64,8 +64,10 @@ boost::property_tree::ptree get_conf() {
 }
 
 struct route_tester {
-  route_tester()
-      : conf(get_conf()), reader(new GraphReader(conf.get_child("mjolnir"))),
+  route_tester() : route_tester(get_conf()) {
+  }
+  explicit route_tester(const boost::property_tree::ptree& config)
+      : conf(config), reader(new GraphReader(conf.get_child("mjolnir"))),
         loki_worker(conf, reader), thor_worker(conf, reader), odin_worker(conf) {
   }
   Api test(const std::string& request_json) {
@@ -334,6 +336,40 @@ void test_mid_break_through_arrive_by() {
   test_mid_break_through(R"(,"date_time":{"type":2,"value":"2016-07-03T08:06"}})");
 }
 
+void test_parallel_legs() {
+  std::string request =
+      R"({"locations":[{"lat":52.09015,"lon":5.06362},{"lat":52.09041,"lon":5.06337},{"lat":52.09015,"lon":5.06362,"type":"via"},{"lat":52.09041,"lon":5.06337}],"costing":"auto"})";
+  route_tester sequential;
+  auto expected = sequential.test(request);
+
+  // the legs are found on the thread pool with a reader its threads can share and narrated on
+  // threads of their own
+  auto conf = get_conf();
+  conf.put("mjolnir.use_sharded_tile_cache", true);
+  conf.put("thor.matrix_threads", 4);
+  conf.put("odin.narration_threads", 2);
+  route_tester parallel(conf);
+  if (!parallel.reader->IsThreadSafe())
+    throw std::logic_error("Expected the sharded reader to be thread-safe");
+  for (int run = 0; run < 3; ++run) {
+    auto response = parallel.test(request);
+    const auto& legs = response.directions().routes(0).legs();
+    const auto& expected_legs = expected.directions().routes(0).legs();
+    if (legs.size() != 2 || legs.size() != expected_legs.size())
+      throw std::logic_error("Should have two legs with two sets of directions");
+    for (int i = 0; i < legs.size(); ++i) {
+      if (!equal(legs.Get(i).summary().length(), expected_legs.Get(i).summary().length(), 0.001f) ||
+          legs.Get(i).maneuver_size() != expected_legs.Get(i).maneuver_size())
+        throw std::logic_error("Legs found in parallel should be the same as one after the other");
+      for (int j = 0; j < legs.Get(i).maneuver_size(); ++j) {
+        if (legs.Get(i).maneuver(j).text_instruction() !=
+            expected_legs.Get(i).maneuver(j).text_instruction())
+          throw std::logic_error("Legs narrated in parallel should be the same as in order");
+      }
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -369,5 +405,8 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(test_mid_break_through_arrive_by));
 
+  // legs found in parallel
+  suite.test(TEST_CASE(test_parallel_legs));
+
   return suite.tear_down();
 }
@@ -1432,6 +1432,32 @@ void test_en_US_verbal_multi_cue() {
   validate(phrase_0, "<CURRENT_VERBAL_CUE> Then <NEXT_VERBAL_CUE>");
 }
 
+void test_en_US_render() {
+  const NarrativeDictionary& dictionary = GetNarrativeDictionary("en-US");
+  const std::string cardinal_direction = "north";
+  const std::string begin_street_names = "Main Street";
+  const std::string street_names = "Broadway";
+
+  // Every tag replaced by its value
+  validate(dictionary.start_subset.Render(2, {{kCardinalDirectionTag, cardinal_direction},
+                                              {kStreetNamesTag, street_names},
+                                              {kBeginStreetNamesTag, begin_street_names}}),
+           "Head north on Main Street. Continue on Broadway.");
+
+  // Tags without a value are left in the phrase
+  validate(dictionary.start_subset.Render(1, {{kCardinalDirectionTag, cardinal_direction}}),
+           "Head north on <STREET_NAMES>.");
+
+  // Phrases without tags
+  validate(dictionary.destination_subset.Render(0), "You have arrived at your destination.");
+
+  // Ids that are not in the dictionary
+  try {
+    dictionary.start_subset.Render(3);
+    throw std::logic_error("Missing phrase should throw");
+  } catch (const std::out_of_range&) {}
+}
+
 } // namespace
 
 int main() {
@@ -1614,5 +1640,8 @@ int main() {
   // test the en-US verbal_multi_cue phrases
   suite.test(TEST_CASE(test_en_US_verbal_multi_cue));
 
+  // test forming en-US phrases with their tags replaced
+  suite.test(TEST_CASE(test_en_US_render));
+
   return suite.tear_down();
 }
@@ -7591,6 +7591,35 @@ void TestBuildVerbalMultiCue_0_miles_en_US() {
   TryBuild(options, maneuvers, expected_maneuvers);
 }
 
+void TestBuildInstructionTypes_en_US() {
+  std::string country_code = "US";
+  std::string state_code = "PA";
+
+  // Only the text instruction
+  Options options;
+  options.set_units(Options::miles);
+  options.set_language("en-US");
+  options.add_instruction_types(Options::text_instruction);
+
+  std::list<Maneuver> maneuvers;
+  PopulateStartManeuverList_0(maneuvers, country_code, state_code);
+  std::list<Maneuver> expected_maneuvers;
+  PopulateStartManeuverList_0(expected_maneuvers, country_code, state_code);
+  SetExpectedManeuverInstructions(expected_maneuvers, "Head east.", "", "", "");
+  TryBuild(options, maneuvers, expected_maneuvers);
+
+  // Only the verbal pre transition instruction
+  options.clear_instruction_types();
+  options.add_instruction_types(Options::verbal_pre_transition_instruction);
+
+  maneuvers.clear();
+  PopulateStartManeuverList_0(maneuvers, country_code, state_code);
+  expected_maneuvers.clear();
+  PopulateStartManeuverList_0(expected_maneuvers, country_code, state_code);
+  SetExpectedManeuverInstructions(expected_maneuvers, "", "", "Head east for a half mile.", "");
+  TryBuild(options, maneuvers, expected_maneuvers);
+}
+
 Maneuver
 CreateVerbalPostManeuver(const std::vector<std::pair<std::string, bool>>& street_names,
                          float kilometers,
@@ -9359,6 +9388,9 @@ int main() {
   // BuildVerbalMultiCue_0_miles_en_US
   suite.test(TEST_CASE(TestBuildVerbalMultiCue_0_miles_en_US));
 
+  // BuildInstructionTypes_en_US
+  suite.test(TEST_CASE(TestBuildInstructionTypes_en_US));
+
   // End of the build phrase tests
   //////////
 
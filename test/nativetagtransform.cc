@@ -0,0 +1,185 @@
+#include "mjolnir/nativetagtransform.h"
+#include "test.h"
+
+#include <string>
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+const NativeTagTransform transform;
+
+// checks the transformed tags have the expected values, an empty value for keys that must be gone
+void expect(const Tags& tags, const Tags& expected, const std::string& what) {
+  for (const auto& tag : expected) {
+    auto found = tags.find(tag.first);
+    auto value = found == tags.end() ? std::string() : found->second;
+    if (value != tag.second)
+      throw std::runtime_error(what + ": expected " + tag.first + "=" + tag.second + " but got " +
+                               (found == tags.end() ? "nothing" : value));
+  }
+}
+
+void test_node_access() {
+  auto tags = transform.Transform(OSMType::kNode, {{"highway", "traffic_signals"},
+                                                   {"name", "Main"}});
+  expect(tags, {{"access_mask", "2047"}, {"gate", "false"}, {"bollard", "false"},
+                {"junction", "named"}, {"payment_mask", "0"}},
+         "Signal");
+
+  // bollards only let pedestrians, wheelchairs and bikes through
+  tags = transform.Transform(OSMType::kNode, {{"barrier", "bollard"}});
+  expect(tags, {{"access_mask", "262"}, {"bollard", "true"}}, "Bollard");
+
+  tags = transform.Transform(OSMType::kNode, {{"barrier", "bollard"}, {"bollard", "rising"}});
+  expect(tags, {{"access_mask", "2047"}, {"bollard", "false"}, {"gate", "true"}},
+         "Rising bollard");
+
+  // vehicle=no keeps pedestrians
+  tags = transform.Transform(OSMType::kNode, {{"vehicle", "no"}});
+  expect(tags, {{"access_mask", "2"}}, "No vehicles");
+
+  tags = transform.Transform(OSMType::kNode, {{"barrier", "toll_booth"},
+                                              {"payment:coins", "yes"},
+                                              {"payment:e_zpass", "yes"}});
+  expect(tags, {{"toll_booth", "true"}, {"payment_mask", "5"}}, "Toll booth");
+}
+
+void test_way_oneway() {
+  auto tags = transform.Transform(OSMType::kWay, {{"highway", "residential"},
+                                                  {"oneway", "-1"},
+                                                  {"maxspeed", "30 mph"},
+                                                  {"lanes", "2"},
+                                                  {"lanes:forward", "20"},
+                                                  {"note", "reversed"}});
+  expect(tags,
+         {{"auto_forward", "false"},   {"auto_backward", "true"},    {"truck_forward", "false"},
+          {"truck_backward", "true"},  {"bike_forward", "false"},    {"bike_backward", "true"},
+          {"pedestrian", "true"},      {"emergency_forward", "false"},
+          {"oneway", "true"},          {"oneway_reverse", "true"},   {"max_speed", "48"},
+          {"lanes", "2"},              {"forward_lanes", ""},        {"road_class", "6"},
+          {"default_speed", "35"},     {"use", "0"},                 {"hov_forward", "false"},
+          {"hov_backward", "true"},    {"shoulder_right", "false"},  {"cycle_lane_right", "0"},
+          {"bridge", "false"},         {"toll", "false"},            {"private", "false"},
+          {"ferry", "false"},          {"rail", "false"},            {"roundabout", "false"},
+          {"auto_tag", ""},            {"bike_network_mask", "0"},   {"note", ""}},
+         "Reversed oneway");
+}
+
+void test_way_filtered() {
+  if (!transform.Transform(OSMType::kWay, {}).empty())
+    throw std::runtime_error("Ways without tags should be filtered");
+  if (!transform.Transform(OSMType::kWay, {{"highway", "construction"}}).empty())
+    throw std::runtime_error("Construction should be filtered");
+  if (!transform.Transform(OSMType::kWay, {{"highway", "footway"}, {"area", "yes"}}).empty())
+    throw std::runtime_error("Areas should be filtered");
+  if (!transform.Transform(OSMType::kWay, {{"highway", "platform"}}).empty())
+    throw std::runtime_error("Ways no mode can use should be filtered");
+  if (!transform.Transform(OSMType::kWay, {{"highway", "service"}, {"access", "private"}})
+           .empty())
+    throw std::runtime_error("Private service roads should be filtered");
+  if (transform.Transform(OSMType::kWay, {{"highway", "bridleway"}}).empty())
+    throw std::runtime_error("Bridleways are kept for the country access");
+}
+
+void test_way_ferry() {
+  auto tags =
+      transform.Transform(OSMType::kWay, {{"route", "ferry"}, {"motor_vehicle", "no"}});
+  expect(tags,
+         {{"auto_forward", "false"}, {"truck_forward", "false"}, {"pedestrian", "true"},
+          {"bike_forward", "true"}, {"bike_backward", "true"}, {"auto_tag", "false"},
+          {"road_class", "2"}, {"default_speed", "75"}, {"ferry", "true"}},
+         "Ferry");
+}
+
+void test_way_cycle_lanes() {
+  // a lane on the right of a oneway that bikes may use both ways is a two way cycle lane
+  auto tags = transform.Transform(OSMType::kWay, {{"highway", "secondary"},
+                                                  {"oneway", "yes"},
+                                                  {"oneway:bicycle", "no"},
+                                                  {"cycleway:right", "lane"}});
+  expect(tags,
+         {{"auto_backward", "false"}, {"bike_forward", "true"}, {"bike_backward", "true"},
+          {"cycle_lane_right", "2"}, {"cycle_lane_left", "2"},
+          {"cycle_lane_right_opposite", "false"}, {"cycle_lane_left_opposite", "true"}},
+         "Cycle lanes");
+
+  tags = transform.Transform(OSMType::kWay, {{"highway", "cycleway"}, {"segregated", "yes"}});
+  expect(tags,
+         {{"use", "20"}, {"cycle_lane_right", "3"}, {"cycle_lane_left", "3"},
+          {"auto_forward", "false"}},
+         "Cycleway");
+}
+
+void test_way_measurements() {
+  auto tags = transform.Transform(OSMType::kWay, {{"highway", "primary"},
+                                                  {"maxweight", "7500 kg"},
+                                                  {"maxaxleload", "10 t"},
+                                                  {"maxheight", "12'6\""},
+                                                  {"maxwidth", "6'"},
+                                                  {"maxlength", "4.5 m"},
+                                                  {"maxspeed:hgv", "200"},
+                                                  {"hazmat", "no"}});
+  expect(tags,
+         {{"maxweight", "7.5"}, {"maxaxleload", "10"}, {"maxheight", "3.81"},
+          {"maxwidth", "1.83"}, {"maxlength", "4.5"}, {"maxspeed:hgv", ""}, {"hazmat", "false"}},
+         "Measurements");
+}
+
+void test_relations() {
+  auto tags = transform.Transform(OSMType::kRelation,
+                                  {{"type", "restriction"}, {"restriction", "no_left_turn"}});
+  expect(tags, {{"restriction", "0"}, {"type", "restriction"}}, "Restriction");
+
+  tags = transform.Transform(OSMType::kRelation,
+                             {{"type", "restriction"},
+                              {"restriction:conditional", "no_right_turn @ (Mo-Fr 07:00-09:00)"}});
+  expect(tags, {{"restriction", "1"}, {"restriction:conditional", "(Mo-Fr 07:00-09:00)"}},
+         "Conditional restriction");
+
+  // restrictions of a mode win
+  tags = transform.Transform(OSMType::kRelation, {{"type", "restriction"},
+                                                  {"restriction", "no_left_turn"},
+                                                  {"restriction:hgv", "no_u_turn"}});
+  expect(tags, {{"restriction", ""}, {"restriction:hgv", "3"}}, "Restriction of a mode");
+
+  tags = transform.Transform(OSMType::kRelation, {{"type", "route"},
+                                                  {"route", "bicycle"},
+                                                  {"network", "rcn"},
+                                                  {"day_on", "monday"}});
+  expect(tags, {{"bike_network_mask", "2"}, {"day_on", ""}}, "Bike route");
+
+  if (!transform.Transform(OSMType::kRelation, {{"type", "restriction"}}).empty())
+    throw std::runtime_error("Restrictions without a restriction should be filtered");
+  if (!transform
+           .Transform(OSMType::kRelation,
+                      {{"type", "route"}, {"route", "bus"}, {"restriction", "no_entry"}})
+           .empty())
+    throw std::runtime_error("Routes with a restriction should be filtered");
+  if (!transform.Transform(OSMType::kRelation, {{"type", "multipolygon"}}).empty())
+    throw std::runtime_error("Multipolygons should be filtered");
+  if (transform.Transform(OSMType::kRelation, {{"type", "connectivity"}}).empty())
+    throw std::runtime_error("Connectivity should be kept");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("nativetagtransform");
+
+  suite.test(TEST_CASE(test_node_access));
+
+  suite.test(TEST_CASE(test_way_oneway));
+
+  suite.test(TEST_CASE(test_way_filtered));
+
+  suite.test(TEST_CASE(test_way_ferry));
+
+  suite.test(TEST_CASE(test_way_cycle_lanes));
+
+  suite.test(TEST_CASE(test_way_measurements));
+
+  suite.test(TEST_CASE(test_relations));
+
+  return suite.tear_down();
+}
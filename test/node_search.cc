@@ -1,5 +1,6 @@
 #include "loki/node_search.h"
 #include "test.h"
+#include <algorithm>
 #include <cstdint>
 
 #include "baldr/rapidjson_utils.h"
@@ -423,6 +424,37 @@ void test_opposite_in_another_tile() {
   }
 }
 
+void test_reused_search() {
+  // make the config file
+  std::stringstream json;
+  json << "{ \"tile_dir\": \"" << test_tile_dir << "\" }";
+  boost::property_tree::ptree conf;
+  rapidjson::read_json(json, conf);
+
+  // one search over and over should find the same nodes as the one off searches, each once
+  vb::GraphReader reader(conf);
+  valhalla::loki::node_search_t search(reader);
+  std::vector<vm::AABB2<vm::PointLL>> boxes{{{-0.0025, -0.0025}, {0.0025, 0.0025}},
+                                            {{0.0, 0.0}, {0.0051, 0.0051}},
+                                            {{0.0, 0.250}, {0.001, 0.253}},
+                                            {{0.5, 0.5}, {0.51, 0.51}},
+                                            {{0.0, 0.0}, {0.3, 0.3}},
+                                            {{0.0, 0.0}, {0.0051, 0.0051}}};
+  for (const auto& box : boxes) {
+    std::vector<vb::GraphId> nodes;
+    search.visit(box, [&nodes](const vb::GraphId& node) { nodes.push_back(node); });
+    std::sort(nodes.begin(), nodes.end());
+    if (std::adjacent_find(nodes.begin(), nodes.end()) != nodes.end()) {
+      throw std::runtime_error("Expecting to visit every node once");
+    }
+    auto expected = valhalla::loki::nodes_in_bbox(box, reader);
+    if (nodes != expected) {
+      throw std::runtime_error("Expecting to find " + std::to_string(expected.size()) +
+                               " nodes, but got " + std::to_string(nodes.size()));
+    }
+  }
+}
+
 } // anonymous namespace
 
 int main() {
@@ -433,6 +465,7 @@ int main() {
   suite.test(TEST_CASE(test_small_node_block));
   suite.test(TEST_CASE(test_node_at_tile_boundary));
   suite.test(TEST_CASE(test_opposite_in_another_tile));
+  suite.test(TEST_CASE(test_reused_search));
 
   return suite.tear_down();
 }
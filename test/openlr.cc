@@ -190,6 +190,20 @@ void test_too_small_reference() {
   throw std::runtime_error("No error returned");
 }
 
+void test_from_points() {
+  // a location made up of its points encodes to what the points decode from
+  auto reference = LineLocation(decode64("CwG1ASK3PhD82sz0CIAQ89r83hRxEAM="));
+  LineLocation location(reference.first, reference.intermediate, reference.last, 4000.f, 3000.f);
+  LineLocation decoded(location.toBinary());
+  check_close(decoded.getFirstCoordinate().lng(), 2.400523, "First coordinate longitude incorrect.");
+  check_close(decoded.getLastCoordinate().lat(), 48.893158, "Last coordinate latitude incorrect.");
+  if (decoded.intermediate.size() != 1)
+    throw std::runtime_error("Incorrect number of intermediate LRP");
+  check_close(decoded.getLength(), 2 * 12774.8, "Distance incorrect.", 1e-3);
+  check_close(decoded.poff, 4000.f, "Positive offset incorrect.", 58.6);
+  check_close(decoded.noff, 3000.f, "Negative offset incorrect.", 58.6);
+}
+
 } // namespace
 
 int main(void) {
@@ -198,6 +212,7 @@ int main(void) {
   suite.test(TEST_CASE(test_decode));
   suite.test(TEST_CASE(test_internal_reference_points));
   suite.test(TEST_CASE(test_offsets_overrun));
+  suite.test(TEST_CASE(test_from_points));
   suite.test(TEST_CASE(test_too_small_reference));
 
   return suite.tear_down();
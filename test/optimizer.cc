@@ -2,8 +2,11 @@
 #include "config.h"
 #include "test.h"
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <numeric>
+#include <random>
 #include <vector>
 
 using namespace std;
@@ -22,8 +25,7 @@ void TryOptimizer(const uint32_t nlocs,
   }
 }
 
-void TestOptimizer() {
-  std::vector<float> costs = {0,    3036, 707,  956,  318,  1934, 355,  1170, 1286, 3171, 2133,
+const std::vector<float> kCosts = {0,    3036, 707,  956,  318,  1934, 355,  1170, 1286, 3171, 2133,
                               2978, 0,    2664, 3613, 3102, 2011, 3139, 3846, 1764, 2050, 1143,
                               638,  2638, 0,    1295, 763,  1536, 800,  1528, 888,  2773, 1735,
                               940,  3457, 1281, 0,    582,  2450, 630,  655,  1796, 3681, 2643,
@@ -34,8 +36,81 @@ void TestOptimizer() {
                               1214, 1750, 900,  1849, 1338, 634,  1375, 2082, 0,    1907, 846,
                               3128, 2036, 2814, 3763, 3252, 2549, 3290, 3228, 1914, 0,    2010,
                               2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854,  2000, 0};
+
+float TourCost(const uint32_t nlocs,
+               const std::vector<float>& costs,
+               const std::vector<uint32_t>& tour) {
+  float cost = 0;
+  for (size_t i = 1; i < tour.size(); ++i) {
+    cost += costs[tour[i - 1] * nlocs + tour[i]];
+  }
+  return cost;
+}
+
+void TestOptimizer() {
   std::vector<uint32_t> expected_order = {0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10};
-  TryOptimizer(11, costs, expected_order);
+  TryOptimizer(11, kCosts, expected_order);
+}
+
+void TestLocalSearch() {
+  Optimizer optimizer;
+  optimizer.set_method(OptimizerMethod::kLocalSearch);
+  auto order = optimizer.Solve(11, kCosts);
+  // at least as good as the annealing
+  if (TourCost(11, kCosts, order) > TourCost(11, kCosts, {0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10}))
+    throw runtime_error("TestLocalSearch: the tour should be as good as the annealed one");
+
+  // the best of all orders of a small asymmetric problem
+  const uint32_t nlocs = 8;
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> distribution(1, 1000);
+  std::vector<float> costs(nlocs * nlocs);
+  for (auto& cost : costs)
+    cost = distribution(generator);
+  std::vector<uint32_t> tour(nlocs);
+  std::iota(tour.begin(), tour.end(), 0);
+  float best = TourCost(nlocs, costs, tour);
+  while (std::next_permutation(tour.begin() + 1, tour.end() - 1))
+    best = std::min(best, TourCost(nlocs, costs, tour));
+  order = optimizer.Solve(nlocs, costs);
+  if (order.front() != 0 || order.back() != nlocs - 1 || TourCost(nlocs, costs, order) != best)
+    throw runtime_error("TestLocalSearch: expected the best tour");
+}
+
+void TestParallelLocalSearch() {
+  // a larger problem gives the same tour with and without threads
+  const uint32_t nlocs = 60;
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> distribution(0, 100);
+  std::vector<std::pair<float, float>> points(nlocs);
+  for (auto& point : points)
+    point = {distribution(generator), distribution(generator)};
+  std::vector<float> costs(nlocs * nlocs);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    for (uint32_t j = 0; j < nlocs; ++j) {
+      // slower one way than the other
+      costs[i * nlocs + j] = std::hypot(points[i].first - points[j].first,
+                                        points[i].second - points[j].second) *
+                             (i < j ? 1.f : 1.2f);
+    }
+  }
+
+  Optimizer optimizer;
+  optimizer.set_method(OptimizerMethod::kLocalSearch);
+  auto order = optimizer.Solve(nlocs, costs);
+  auto sorted = order;
+  std::sort(sorted.begin(), sorted.end());
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    if (sorted[i] != i)
+      throw runtime_error("TestParallelLocalSearch: each location should be visited once");
+  }
+  if (order.front() != 0 || order.back() != nlocs - 1)
+    throw runtime_error("TestParallelLocalSearch: the origin and destination should be kept");
+
+  ThreadPool pool(4);
+  optimizer.set_thread_pool(&pool);
+  if (optimizer.Solve(nlocs, costs) != order)
+    throw runtime_error("TestParallelLocalSearch: threads should not change the tour");
 }
 
 } // namespace
@@ -45,5 +120,9 @@ int main() {
 
   suite.test(TEST_CASE(TestOptimizer));
 
+  suite.test(TEST_CASE(TestLocalSearch));
+
+  suite.test(TEST_CASE(TestParallelLocalSearch));
+
   return suite.tear_down();
 }
@@ -384,6 +384,36 @@ void TestDistance() {
   }
 }
 
+void TestBatchDistancesAndHeadings() {
+  std::vector<PointLL> pts{{-76.299179f, 40.042572f}, {-76.299171f, 40.042519f},
+                           {-76.298477f, 40.042809f}, {-76.299179f, 40.042572f},
+                           {-76.299179f, 40.042572f}, {179.9f, -60.0f},
+                           {-179.9f, -60.1f},         {10.0f, 89.0f},
+                           {45.0f, 45.0f},            {45.0f, 40.0f}};
+  std::vector<float> lngs, lats;
+  for (const auto& p : pts) {
+    lngs.push_back(p.lng());
+    lats.push_back(p.lat());
+  }
+  std::vector<float> dists(pts.size() - 1), headings(pts.size() - 1);
+  PointLL::Distances(lngs.data(), lats.data(), pts.size(), dists.data());
+  PointLL::Headings(lngs.data(), lats.data(), pts.size(), headings.data());
+
+  for (size_t i = 0; i < dists.size(); ++i) {
+    float d = pts[i].Distance(pts[i + 1]);
+    if (std::abs(dists[i] - d) > std::max(0.01f, d * 1e-4f)) {
+      throw std::logic_error("Batch distance " + std::to_string(dists[i]) + " should be " +
+                             std::to_string(d));
+    }
+    float h = pts[i].Heading(pts[i + 1]);
+    float dh = std::abs(headings[i] - h);
+    if (std::min(dh, 360.0f - dh) > 0.01f) {
+      throw std::logic_error("Batch heading " + std::to_string(headings[i]) + " should be " +
+                             std::to_string(h));
+    }
+  }
+}
+
 } // namespace
 
 int main() {
@@ -410,6 +440,8 @@ int main() {
 
   // Test Distance
   suite.test(TEST_CASE(TestDistance));
+
+  suite.test(TEST_CASE(TestBatchDistancesAndHeadings));
   // TODO: many more!
 
   return suite.tear_down();
@@ -5,6 +5,8 @@
 
 #include <algorithm>
 #include <iostream>
+#include <list>
+#include <unordered_set>
 #include <vector>
 
 #include "midgard/point2.h"
@@ -127,6 +129,31 @@ void TestGeneralizeSimplification() {
     throw std::logic_error("No points should be removed.");
 }
 
+void TestGeneralizeLong() {
+  // a zig zag long enough to have blown the stack with recursion, nothing can be removed
+  std::vector<Point2> zig;
+  for (size_t i = 0; i < 200000; ++i)
+    zig.emplace_back(i, i % 2);
+  auto zag = zig;
+  Polyline2<Point2>::Generalize(zag, 0.1f);
+  if (zag != zig)
+    throw std::logic_error("No zig zag points should be removed.");
+
+  // a long straight line goes down to its ends but keeps the points we ask it to
+  std::vector<Point2> line;
+  for (size_t i = 0; i < 200000; ++i)
+    line.emplace_back(i, (i * 7 % 13) * 1e-4f);
+  std::list<Point2> list(line.begin(), line.end());
+  std::unordered_set<size_t> indices{5, 100000, 150001};
+  Polyline2<Point2>::Generalize(line, 0.1f, indices);
+  Polyline2<Point2>::Generalize(list, 0.1f, indices);
+  if (line.size() != 5 || line[1].first != 5 || line[2].first != 100000 ||
+      line[3].first != 150001)
+    throw std::logic_error("Only the ends and the kept points should be left.");
+  if (!std::equal(line.begin(), line.end(), list.begin(), list.end()))
+    throw std::logic_error("Vectors and lists should generalize the same way.");
+}
+
 void TryClosestPoint(const Polyline2<Point2>& pl, const Point2& a, const Point2& b) {
 
   auto result = pl.ClosestPoint(a);
@@ -232,6 +259,9 @@ int main() {
   // Test Generalize for which points are removed
   suite.test(TEST_CASE(TestGeneralizeSimplification));
 
+  // Test Generalize of long inputs and of lists
+  suite.test(TEST_CASE(TestGeneralizeLong));
+
   // Test distance of a point to a line segment
   suite.test(TEST_CASE(TestClosestPoint));
 
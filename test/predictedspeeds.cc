@@ -4,8 +4,10 @@
 #include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 
+#include <cmath>
 #include <iostream>
 
+#include "baldr/graphid.h"
 #include "baldr/predictedspeeds.h"
 #include "midgard/util.h"
 
@@ -248,6 +250,71 @@ void test_negative_speeds() {
   }
 }
 
+/**
+ * Test that the dot product used to decode speeds matches decoding one coefficient at a time.
+ */
+void test_decode_speed() {
+  int16_t coefficients[kCoefficientCount];
+  for (uint32_t i = 0; i < kCoefficientCount; ++i) {
+    coefficients[i] = static_cast<int16_t>((i * 7919) % 401) - 200;
+  }
+  for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
+    float expected = coefficients[0] * k1OverSqrt2;
+    for (uint32_t k = 1; k < kCoefficientCount; ++k) {
+      expected += coefficients[k] * cosf(kPiBucketConstant * (bucket + 0.5f) * k);
+    }
+    float speed = decode_speed(coefficients, BucketCosTable::GetInstance().get(bucket));
+    if (std::abs(speed - expected) > 0.01f) {
+      throw std::runtime_error("Decoded " + std::to_string(speed) + " but expected " +
+                               std::to_string(expected) + " for bucket " + std::to_string(bucket));
+    }
+  }
+}
+
+/**
+ * Test that the memo only decodes a speed once per edge and bucket.
+ */
+void test_memo() {
+  PredictedSpeedMemo memo(256);
+  uint32_t decoded = 0;
+  auto decode = [&decoded]() {
+    ++decoded;
+    return 42.0f;
+  };
+  for (int pass = 0; pass < 3; ++pass) {
+    for (uint32_t i = 0; i < 10; ++i) {
+      GraphId edge_id(1234, 2, i);
+      if (memo.get(edge_id, 7, decode) != 42.0f || memo.get(edge_id, 8, decode) != 42.0f) {
+        throw std::runtime_error("Wrong speed from the memo");
+      }
+    }
+  }
+  // 20 speeds in 256 places might collide but surely not all of them
+  if (decoded < 20 || decoded >= 40) {
+    throw std::runtime_error("Speeds should have been decoded once but were decoded " +
+                             std::to_string(decoded) + " times");
+  }
+  memo.clear();
+  memo.get(GraphId(1234, 2, 0), 7, decode);
+  if (decoded < 21) {
+    throw std::runtime_error("Cleared memo should decode again");
+  }
+
+  // the memo is only the memo of the thread while it is in scope
+  if (PredictedSpeedMemo::current() != nullptr) {
+    throw std::runtime_error("No memo should be set");
+  }
+  {
+    PredictedSpeedMemo::scope_t scope(&memo);
+    if (PredictedSpeedMemo::current() != &memo) {
+      throw std::runtime_error("The memo should be set");
+    }
+  }
+  if (PredictedSpeedMemo::current() != nullptr) {
+    throw std::runtime_error("The memo should have been unset");
+  }
+}
+
 } // namespace
 
 int main(void) {
@@ -259,5 +326,9 @@ int main(void) {
 
   suite.test(TEST_CASE(test_negative_speeds));
 
+  suite.test(TEST_CASE(test_decode_speed));
+
+  suite.test(TEST_CASE(test_memo));
+
   return suite.tear_down();
 }
@@ -0,0 +1,136 @@
+#include "baldr/double_bucket_queue.h"
+#include "baldr/radix_queue.h"
+#include "config.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+void TestAddRemove() {
+  std::vector<float> costs = {67,  325, 25,  466,   1000, 100005,
+                              758, 167, 258, 16442, 278,  111111000};
+  RadixQueue queue(0, [&costs](const uint32_t label) { return costs[label]; });
+  for (uint32_t i = 0; i < costs.size(); ++i) {
+    queue.add(i);
+  }
+  std::vector<float> expected = costs;
+  std::sort(expected.begin(), expected.end());
+  for (auto cost : expected) {
+    auto label = queue.pop();
+    if (label == kInvalidLabel || costs[label] != cost)
+      throw runtime_error("RadixQueue expected order test failed");
+  }
+  if (queue.pop() != kInvalidLabel)
+    throw runtime_error("RadixQueue should be empty");
+}
+
+void TestSimulation() {
+  // Dijkstra style use: pop the minimum, add costs above it and decrease some
+  // of the labels still in the queue. Labels must come out in exact order.
+  std::vector<float> costs;
+  std::vector<bool> queued;
+  RadixQueue queue(0, [&costs](const uint32_t label) { return costs[label]; });
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> increment(0.f, 5000.f);
+  std::uniform_int_distribution<int> coin(0, 3);
+
+  costs.push_back(0.f);
+  queued.push_back(true);
+  queue.add(0);
+  float last = 0.f;
+  size_t popped = 0;
+  for (auto label = queue.pop(); label != kInvalidLabel; label = queue.pop()) {
+    if (costs[label] < last)
+      throw runtime_error("RadixQueue popped labels out of order");
+    last = costs[label];
+    queued[label] = false;
+    if (++popped > 20000)
+      continue;
+
+    for (int i = 0; i < 3; ++i) {
+      costs.push_back(last + increment(gen));
+      queued.push_back(true);
+      queue.add(costs.size() - 1);
+    }
+
+    // Decrease a queued label, never below the last cost popped
+    uint32_t candidate = costs.size() - 1 - coin(gen);
+    if (queued[candidate] && coin(gen) == 0) {
+      float newcost = last + (costs[candidate] - last) / 2.f;
+      queue.decrease(candidate, newcost);
+      costs[candidate] = newcost;
+    }
+  }
+  if (popped != costs.size())
+    throw runtime_error("RadixQueue lost labels");
+}
+
+void TestMonotone() {
+  // Costs below the last label popped come out next instead of being lost
+  std::vector<float> costs = {100.f, 200.f, 50.f, -1.f};
+  RadixQueue queue(0, [&costs](const uint32_t label) { return costs[label]; });
+  queue.add(0);
+  queue.add(1);
+  if (queue.pop() != 0)
+    throw runtime_error("RadixQueue expected the lowest cost label");
+  queue.add(2);
+  queue.add(3);
+  auto a = queue.pop();
+  auto b = queue.pop();
+  if (!((a == 2 && b == 3) || (a == 3 && b == 2)))
+    throw runtime_error("RadixQueue expected labels below the last cost next");
+  if (queue.pop() != 1)
+    throw runtime_error("RadixQueue expected the remaining label last");
+}
+
+void TestFactoryReuse() {
+  std::vector<float> costs = {10.f, 5.f};
+  const auto labelcost = [&costs](const uint32_t label) { return costs[label]; };
+
+  std::shared_ptr<LabelQueue> queue;
+  reuse_label_queue(queue, LabelQueueType::kRadixHeap, 0, 1000, 1, labelcost);
+  if (!queue || queue->type() != LabelQueueType::kRadixHeap)
+    throw runtime_error("Expected a radix heap queue");
+  queue->add(0);
+  queue->add(1);
+
+  // Reusing with the same type keeps the queue but empties it
+  auto* previous = queue.get();
+  reuse_label_queue(queue, LabelQueueType::kRadixHeap, 0, 1000, 1, labelcost);
+  if (queue.get() != previous || queue->pop() != kInvalidLabel)
+    throw runtime_error("Expected the same, empty, queue");
+
+  // A different type replaces it
+  reuse_label_queue(queue, LabelQueueType::kDoubleBucket, 0, 1000, 1, labelcost);
+  if (queue->type() != LabelQueueType::kDoubleBucket)
+    throw runtime_error("Expected a double bucket queue");
+
+  LabelQueueType type;
+  if (!parse_label_queue_type("radix_heap", type) || type != LabelQueueType::kRadixHeap ||
+      !parse_label_queue_type("double_bucket", type) || type != LabelQueueType::kDoubleBucket ||
+      parse_label_queue_type("fibonacci", type))
+    throw runtime_error("Queue type names not parsed as expected");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("radix_queue");
+
+  suite.test(TEST_CASE(TestAddRemove));
+
+  suite.test(TEST_CASE(TestSimulation));
+
+  suite.test(TEST_CASE(TestMonotone));
+
+  suite.test(TEST_CASE(TestFactoryReuse));
+
+  return suite.tear_down();
+}
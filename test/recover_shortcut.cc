@@ -9,6 +9,8 @@
 #include "baldr/tilehierarchy.h"
 #include "midgard/encoded.h"
 #include "midgard/util.h"
+#include "mjolnir/util.h"
+#include <boost/filesystem.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 using namespace valhalla;
@@ -154,6 +156,61 @@ void test_recover_shortcut_edges() {
     throw std::logic_error("More than 0.1% is too much");
 }
 
+void test_shortcut_expansions() {
+  // expand the shortcuts of a copy of the tiles
+  auto conf = get_conf();
+  std::string tile_dir = "test/data/utrecht_expanded_tiles";
+  boost::filesystem::remove_all(tile_dir);
+  for (boost::filesystem::recursive_directory_iterator i("test/data/utrecht_tiles"), end; i != end;
+       ++i) {
+    auto path = tile_dir + i->path().string().substr(std::string("test/data/utrecht_tiles").size());
+    if (boost::filesystem::is_directory(i->path()))
+      boost::filesystem::create_directories(path);
+    else
+      boost::filesystem::copy_file(i->path(), path);
+  }
+  conf.put("mjolnir.tile_dir", tile_dir);
+  if (valhalla::mjolnir::AddShortcutExpansions(conf) == 0)
+    throw std::logic_error("Tiles with shortcuts should get expansions");
+
+  // every shortcut should be read back as a chain of edges ending where it ends with its length
+  GraphReader graphreader(conf.get_child("mjolnir"));
+  size_t total = 0;
+  size_t bad = 0;
+  for (const auto& tileid : graphreader.GetTileSet()) {
+    const auto* tile = graphreader.GetGraphTile(tileid);
+    for (size_t j = 0; j < tile->header()->directededgecount(); ++j) {
+      const auto* edge = tile->directededge(j);
+      if (!edge->is_shortcut())
+        continue;
+      ++total;
+      auto shortcutid = tileid;
+      shortcutid.set_id(j);
+      auto listed = tile->GetShortcutEdges(j);
+      auto edgeids = graphreader.RecoverShortcut(shortcutid);
+      if (listed.size() == 0 || edgeids.size() != listed.size()) {
+        ++bad;
+        continue;
+      }
+      uint32_t length = 0;
+      GraphId node = graphreader.edge_startnode(shortcutid);
+      for (auto edgeid : edgeids) {
+        if (graphreader.edge_startnode(edgeid) != node)
+          throw std::logic_error("Expanded edges should be connected");
+        const auto* de = graphreader.directededge(edgeid);
+        length += de->length();
+        node = de->endnode();
+      }
+      if (node != edge->endnode() || length != edge->length())
+        throw std::logic_error("Expanded edges should end with the shortcut");
+    }
+  }
+  printf("bad: %zu, total: %zu\n", bad, total);
+  if (total == 0 || double(bad) / double(total) > .001)
+    throw std::logic_error("More than 0.1% is too much");
+  boost::filesystem::remove_all(tile_dir);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -163,5 +220,7 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(test_recover_shortcut_edges));
 
+  suite.test(TEST_CASE(test_shortcut_expansions));
+
   return suite.tear_down();
 }
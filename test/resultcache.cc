@@ -0,0 +1,149 @@
+#include "thor/resultcache.h"
+#include "test.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+Options make_options() {
+  Options options;
+  options.set_action(Options::route);
+  options.set_costing(Costing::auto_);
+  for (int i = 0; i <= static_cast<int>(Costing::truck); ++i) {
+    options.add_costing_options();
+  }
+  for (uint64_t id : {1234, 5678}) {
+    auto* edge = options.add_locations()->add_path_edges();
+    edge->set_graph_id(id);
+    edge->set_percent_along(.25f);
+  }
+  return options;
+}
+
+void TestGetPut() {
+  ResultCache cache(1000, 0);
+  std::string result;
+  if (cache.Get("a", result))
+    throw std::logic_error("An empty cache should not have a result");
+
+  cache.Put("a", "route a");
+  if (!cache.Get("a", result) || result != "route a" || cache.size() != 1 || cache.bytes() != 8)
+    throw std::logic_error("The result should have been cached");
+
+  // putting it again replaces it
+  cache.Put("a", "route b");
+  if (!cache.Get("a", result) || result != "route b" || cache.size() != 1 || cache.bytes() != 8)
+    throw std::logic_error("The result should have been replaced");
+
+  cache.Clear();
+  if (cache.Get("a", result) || cache.size() != 0 || cache.bytes() != 0)
+    throw std::logic_error("The cache should have been cleared");
+}
+
+void TestEviction() {
+  ResultCache cache(20, 0);
+  std::string result;
+  cache.Put("a", "123456789");
+  cache.Put("b", "123456789");
+  // using a makes b the least recently used
+  cache.Get("a", result);
+  cache.Put("c", "123456789");
+  if (!cache.Get("a", result) || cache.Get("b", result) || !cache.Get("c", result) ||
+      cache.bytes() != 20)
+    throw std::logic_error("The least recently used result should have been dropped");
+
+  // a result larger than the whole cache is not kept and drops nothing
+  cache.Put("d", std::string(20, 'x'));
+  if (cache.Get("d", result) || cache.size() != 2)
+    throw std::logic_error("A result larger than the cache should not be cached");
+
+  // old results are computed again
+  ResultCache aging(100, 1);
+  aging.Put("a", "route");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  if (aging.Get("a", result) || aging.size() != 0 || aging.bytes() != 0)
+    throw std::logic_error("An old result should have been dropped");
+}
+
+void TestKey() {
+  auto options = make_options();
+  auto key = ResultCache::Key(options);
+  if (key.empty())
+    throw std::logic_error("A route should be cached");
+
+  // how and when the request is worked on is not part of the result
+  options.set_deadline(1234567);
+  options.set_cost(12.5f);
+  if (ResultCache::Key(options) != key)
+    throw std::logic_error("The deadline and cost should not be part of the key");
+
+  // but what is computed is
+  options.mutable_costing_options(static_cast<int>(Costing::auto_))->set_use_highways(.1f);
+  auto highways = ResultCache::Key(options);
+  options.mutable_locations(1)->mutable_path_edges(0)->set_percent_along(.5f);
+  auto edges = ResultCache::Key(options);
+  if (highways == key || edges == highways)
+    throw std::logic_error("Other costing options or edges should be another key");
+
+  // departures within the same speed bucket share their result
+  options.mutable_locations(0)->set_date_time("2019-11-21T08:10");
+  auto a = ResultCache::Key(options);
+  options.mutable_locations(0)->set_date_time("2019-11-21T08:14");
+  auto b = ResultCache::Key(options);
+  options.mutable_locations(0)->set_date_time("2019-11-21T08:15");
+  auto c = ResultCache::Key(options);
+  options.mutable_locations(0)->set_date_time("current");
+  auto d = ResultCache::Key(options);
+  if (a != b || b == c || c == d || d == edges)
+    throw std::logic_error("Departures should be keyed per speed bucket");
+}
+
+void TestNotCached() {
+  auto options = make_options();
+  options.set_statistics(true);
+  if (!ResultCache::Key(options).empty())
+    throw std::logic_error("Requests for statistics should not be cached");
+
+  options = make_options();
+  options.set_costing(Costing::multimodal);
+  if (!ResultCache::Key(options).empty())
+    throw std::logic_error("Multimodal routes should not be cached");
+
+  options = make_options();
+  options.set_action(Options::trace_route);
+  if (!ResultCache::Key(options).empty())
+    throw std::logic_error("Map matching should not be cached");
+
+  options.set_action(Options::sources_to_targets);
+  if (ResultCache::Key(options).empty())
+    throw std::logic_error("A matrix should be cached");
+
+  // no room means no cache
+  if (ResultCache::Global(0, 0))
+    throw std::logic_error("A cache without room should not be made");
+  auto global = ResultCache::Global(100, 0);
+  if (!global || ResultCache::Global(200, 0) != global)
+    throw std::logic_error("The process should share one cache");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("resultcache");
+
+  suite.test(TEST_CASE(TestGetPut));
+
+  suite.test(TEST_CASE(TestEviction));
+
+  suite.test(TEST_CASE(TestKey));
+
+  suite.test(TEST_CASE(TestNotCached));
+
+  return suite.tear_down();
+}
@@ -210,6 +210,73 @@ void TestRoutePathIterator() {
   test::assert_bool(it5 == the_end, "TestRoutePathIterator: wrong advance");
 }
 
+void TestStatusTable() {
+  meili::StatusTable table;
+  baldr::GraphId node(10, 2, 5), other_tile(11, 2, 70000), same_tile(10, 2, 3);
+  table.emplace(node, 7);
+  table.emplace(other_tile, 8);
+  table.emplace(uint16_t(3), 9);
+  test::assert_bool(table.find(node)->label_idx == 7 && table.find(other_tile)->label_idx == 8 &&
+                        table.find(uint16_t(3))->label_idx == 9,
+                    "TestStatusTable: wrong status found");
+  test::assert_bool(!table.find(same_tile) && !table.find(uint16_t(2)),
+                    "TestStatusTable: unreached nodes and destinations should have no status");
+
+  table.find(node)->permanent = true;
+  test::assert_bool(table.find(node)->permanent, "TestStatusTable: status should be changeable");
+
+  // clearing forgets every status but the table can be used again
+  table.clear();
+  test::assert_bool(table.empty() && !table.find(node) && !table.find(other_tile) &&
+                        !table.find(uint16_t(3)),
+                    "TestStatusTable: cleared statuses should read as not reached");
+  table.emplace(node, 1);
+  test::assert_bool(table.find(node)->label_idx == 1 && !table.find(node)->permanent,
+                    "TestStatusTable: wrong status after clearing");
+
+  // copies have statuses of their own
+  meili::StatusTable copy(table);
+  copy.emplace(same_tile, 2);
+  test::assert_bool(copy.find(node)->label_idx == 1 && copy.find(same_tile) &&
+                        !table.find(same_tile),
+                    "TestStatusTable: a copy should not change the table it was copied from");
+}
+
+void TestReuseWorkspace() {
+  sif::TravelMode travelmode = static_cast<sif::TravelMode>(0);
+  baldr::DirectedEdge de;
+
+  // a search leaves labels behind and hands back its workspace
+  meili::LabelSet first(100);
+  first.put(0, travelmode, nullptr);
+  first.put(1, baldr::GraphId(), 0.f, 1.f, {30.f, 0.f}, 0.f, 30.f, 0, &de, travelmode);
+  first.pop();
+  auto workspace = first.release();
+  test::assert_bool(workspace.queue && workspace.status.empty(),
+                    "TestReuseWorkspace: the workspace should be handed back cleared");
+  test::assert_bool(first.label(1).cost().cost == 30.f && first.label(1).predecessor() == 0,
+                    "TestReuseWorkspace: the labels should be kept to recover the paths");
+
+  // the next search reuses it with another range and pops in order of cost, the origin that was
+  // permanent in the first search is put again since the statuses were cleared
+  auto* queue = workspace.queue.get();
+  meili::LabelSet second(200, 1.0f, std::move(workspace));
+  second.put(0, travelmode, nullptr);
+  second.put(1, baldr::GraphId(), 0.f, 1.f, {150.f, 0.f}, 0.f, 150.f, 0, &de, travelmode);
+  second.put(2, baldr::GraphId(), 0.f, 1.f, {20.f, 0.f}, 0.f, 20.f, 0, &de, travelmode);
+  second.put(1, baldr::GraphId(), 0.f, 1.f, {10.f, 0.f}, 0.f, 10.f, 0, &de, travelmode);
+  std::vector<uint32_t> popped;
+  for (auto idx = second.pop(); idx != baldr::kInvalidLabel; idx = second.pop()) {
+    popped.push_back(idx);
+  }
+  test::assert_bool(popped == std::vector<uint32_t>{0, 1, 2},
+                    "TestReuseWorkspace: wrong order from the reused queue");
+  test::assert_bool(second.label(1).cost().cost == 10.f,
+                    "TestReuseWorkspace: the cheaper label should have replaced the other");
+  test::assert_bool(second.release().queue.get() == queue,
+                    "TestReuseWorkspace: the queue should have been reused");
+}
+
 int main(int argc, char* argv[]) {
   test::suite suite("routing");
 
@@ -221,5 +288,9 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(TestRoutePathIterator));
 
+  suite.test(TEST_CASE(TestStatusTable));
+
+  suite.test(TEST_CASE(TestReuseWorkspace));
+
   return suite.tear_down();
 }
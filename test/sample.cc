@@ -3,12 +3,16 @@
 #include "test.h"
 
 #include "baldr/compression_utils.h"
+#include "filesystem.h"
 #include "midgard/sequence.h"
 #include "midgard/util.h"
 
+#include <atomic>
 #include <cmath>
 #include <fstream>
 #include <list>
+#include <thread>
+#include <vector>
 
 using namespace valhalla;
 
@@ -107,6 +111,77 @@ void getgz() {
   _get("test/data/samplegz");
 };
 
+void get_all_batched() {
+  // postings all over the place, in and out of the tile, in a few runs, should be the same as
+  // asking for them one at a time
+  skadi::sample s("test/data/sample");
+  std::vector<std::pair<double, double>> postings;
+  for (int i = 0; i < 2000; ++i)
+    postings.emplace_back(-77.2 + (i % 500) * .0029, 39.8 + (i * 7 % 1999) * .0007);
+  postings.emplace_back(-76.5, 40.0);
+  postings.emplace_back(-76.5, 41.0 - 1e-9);
+  postings.emplace_back(200.0, 200.0);
+  auto heights = s.get_all(postings);
+  size_t with_data = 0;
+  for (size_t i = 0; i < postings.size(); ++i) {
+    if (heights[i] != s.get(postings[i]))
+      throw std::runtime_error("Batched height differs at " + std::to_string(i));
+    with_data += heights[i] != skadi::sample::get_no_data_value();
+  }
+  if (with_data == 0 || with_data == postings.size())
+    throw std::runtime_error("Expected postings with and without data");
+
+  std::list<std::pair<float, float>> float_postings;
+  for (const auto& p : postings)
+    float_postings.emplace_back(p.first, p.second);
+  auto float_heights = s.get_all(float_postings);
+  auto p = float_postings.begin();
+  for (size_t i = 0; i < float_heights.size(); ++i, ++p) {
+    if (float_heights[i] != s.get(*p))
+      throw std::runtime_error("Batched float height differs at " + std::to_string(i));
+  }
+}
+
+void getgz_cache_dir() {
+  // unzipped into a file that is gone again once the sample is
+  {
+    skadi::sample s("test/data/samplegz", 0, "test/data");
+    auto expected = skadi::sample("test/data/samplegz").get(std::make_pair(-76.503915, 40.678783));
+    if (s.get(std::make_pair(-76.503915, 40.678783)) != expected)
+      throw std::runtime_error("Wrong value unzipped into a file");
+    bool found = false;
+    for (filesystem::directory_iterator i("test/data"), end; i != end; ++i)
+      found = found || i->path().string().find("unzipped_") != std::string::npos;
+    if (!found)
+      throw std::runtime_error("Expected the unzipped tile in the cache dir");
+  }
+  for (filesystem::directory_iterator i("test/data"), end; i != end; ++i)
+    if (i->path().string().find("unzipped_") != std::string::npos)
+      throw std::runtime_error("Unzipped tile file should be removed");
+}
+
+void getgz_threads() {
+  // one sample shared by a few threads all wanting the same gzipped tile
+  skadi::sample s("test/data/samplegz", 2);
+  std::vector<std::pair<double, double>> postings;
+  for (int i = 0; i < 1000; ++i)
+    postings.emplace_back(-76.99 + i * .00098, 40.01 + i * .00097);
+  auto expected = skadi::sample("test/data/samplegz").get_all(postings);
+  std::atomic<int> wrong(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      for (int r = 0; r < 5; ++r)
+        if (s.get_all(postings) != expected || s.get(postings[r]) != expected[r])
+          ++wrong;
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  if (wrong)
+    throw std::runtime_error("Threads sharing a sample got different heights");
+}
+
 struct testable_sample_t : public skadi::sample {
   testable_sample_t(const std::string& dir) : sample(dir) {
     {
@@ -178,8 +253,14 @@ int main() {
 
   suite.test(TEST_CASE(edges));
 
+  suite.test(TEST_CASE(get_all_batched));
+
   suite.test(TEST_CASE(getgz));
 
+  suite.test(TEST_CASE(getgz_threads));
+
+  suite.test(TEST_CASE(getgz_cache_dir));
+
   suite.test(TEST_CASE(lazy_load));
 
   return suite.tear_down();
@@ -381,6 +381,75 @@ void test_search_cutoff() {
   search(x, 2, 0);
 }
 
+void test_bin_bounds() {
+  using namespace valhalla::mjolnir;
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  GraphReader reader(conf);
+  GraphTile binned(tile_dir, tile_id);
+  GraphTileBuilder::AddBinBounds(tile_dir, &binned, GraphTileBuilder::BoundBins(&binned, reader));
+
+  // every binned edge has a box around its shape
+  GraphTile bounded(tile_dir, tile_id);
+  for (size_t i = 0; i < kBinCount; ++i) {
+    auto edges = bounded.GetBin(i);
+    auto bounds = bounded.GetBinBounds(i);
+    if (edges.size() != bounds.size())
+      throw std::logic_error("Expected a box for every edge in the bin");
+    for (size_t j = 0; j < edges.size(); ++j) {
+      auto box = bounds[j].box(bounded.GetBinCorner(i));
+      const auto* edge = bounded.directededge(edges[j]);
+      for (const auto& point : bounded.edgeinfo(edge->edgeinfo_offset()).lazy_shape()) {
+        if (!bounds[j].bounded() || !box.Contains(point))
+          throw std::logic_error("Expected the box to contain the shape of the edge");
+      }
+    }
+  }
+
+  // bounding it again replaces the old bounds
+  GraphTileBuilder::AddBinBounds(tile_dir, &bounded, GraphTileBuilder::BoundBins(&bounded, reader));
+  GraphTile rebounded(tile_dir, tile_id);
+  if (rebounded.header()->end_offset() != bounded.header()->end_offset() ||
+      rebounded.header()->bin_bounds_offset() != bounded.header()->bin_bounds_offset())
+    throw std::logic_error("Expected the bounds to be replaced");
+
+  // the edges the bounds let the search skip must not change what it finds
+  test_edge_search();
+  test_reachability_radius();
+  test_search_cutoff();
+}
+
+void test_batch_search() {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  valhalla::baldr::GraphReader reader(conf);
+
+  // lots of locations sharing bins all over the tile and a few in bins of their own
+  std::vector<Location> locations;
+  for (float lat = 0.f; lat < .25f; lat += .005f)
+    for (float lon = 0.f; lon < .25f; lon += .005f)
+      locations.emplace_back(PointLL{lon + .0001f, lat + .0002f}, Location::StopType::BREAK, 0, 0,
+                             lat < .1f ? 500 : 0);
+
+  // projecting them on multiple threads must find exactly what a single thread does
+  const auto expected = Search(locations, reader, nullptr, 1);
+  const auto results = Search(locations, reader, nullptr, 4);
+  if (results.size() != expected.size() || expected.size() != locations.size())
+    throw std::logic_error("Expected every location to be found");
+  for (const auto& location : locations) {
+    const auto& a = expected.at(location).edges;
+    const auto& b = results.at(location).edges;
+    if (a.size() != b.size())
+      throw std::logic_error("Wrong number of edges");
+    for (size_t i = 0; i < a.size(); ++i) {
+      if (a[i].id != b[i].id || a[i].percent_along != b[i].percent_along ||
+          a[i].distance != b[i].distance || a[i].sos != b[i].sos ||
+          !a[i].projected.ApproximatelyEqual(b[i].projected))
+        throw std::logic_error("Expected the same edges from every thread count");
+    }
+  }
+}
+
 } // namespace
 
 int main() {
@@ -394,5 +463,9 @@ int main() {
 
   suite.test(TEST_CASE(test_search_cutoff));
 
+  suite.test(TEST_CASE(test_bin_bounds));
+
+  suite.test(TEST_CASE(test_batch_search));
+
   return suite.tear_down();
 }
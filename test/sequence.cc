@@ -1,6 +1,9 @@
 #include "midgard/sequence.h"
 #include "test.h"
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <vector>
 
 using namespace valhalla::midgard;
 
@@ -26,6 +29,8 @@ void sort_nodes(const std::string& file_name) {
 
 void read_nodes(const std::string& file_name, const uint64_t count) {
   sequence<osm_node> sequence(file_name, false, 512);
+  // small window so the scan below keeps moving it along
+  sequence.readahead(16);
   auto less_than = [](const osm_node& a, const osm_node& b) { return a.id < b.id; };
   for (uint64_t i = 0; i < count; ++i) {
     // grab an element
@@ -52,6 +57,43 @@ void test_read_write() {
   read_nodes(file_name, count);
 }
 
+void test_merge_sort() {
+  // scrambled ids with plenty of duplicates, the attributes record the original position
+  std::string file_name = "merge.nd";
+  uint64_t count = 10000;
+  {
+    sequence<osm_node> sequence(file_name, true, 512);
+    for (uint64_t i = 0; i < count; ++i)
+      sequence.push_back({(i * 7919) % 997, 0.f, 0.f, static_cast<uint32_t>(i)});
+  }
+
+  // chunks smaller than the file on a few threads have to be merged
+  {
+    sequence<osm_node> sequence(file_name, false, 512);
+    sequence.sort([](const osm_node& a, const osm_node& b) { return a.id < b.id; }, 333, 3);
+    if (sequence.size() != count)
+      throw std::runtime_error("Merge sort changed the number of elements");
+    // and the sequence is still usable afterwards
+    sequence.push_back({997, 0.f, 0.f, 0});
+  }
+
+  sequence<osm_node> sequence(file_name, false, 512);
+  if (sequence.size() != count + 1)
+    throw std::runtime_error("Sequence not usable after merge sort");
+  std::vector<int> seen(count, 0);
+  osm_node last = *sequence[0];
+  for (uint64_t i = 0; i < count; ++i) {
+    osm_node node = *sequence[i];
+    if (node.id < last.id)
+      throw std::runtime_error("Merge sort out of order at: " + std::to_string(i));
+    seen[node.attributes]++;
+    last = node;
+  }
+  if (std::any_of(seen.begin(), seen.end(), [](int s) { return s != 1; }))
+    throw std::runtime_error("Merge sort lost or duplicated elements");
+  std::remove(file_name.c_str());
+}
+
 void test_iterator() {
   sequence<osm_node> sequence("nodes.nd", false, 512);
   auto i = sequence.begin();
@@ -77,6 +119,8 @@ int main() {
 
   suite.test(TEST_CASE(test_read_write));
 
+  suite.test(TEST_CASE(test_merge_sort));
+
   suite.test(TEST_CASE(test_iterator));
 
   return suite.tear_down();
@@ -222,6 +222,37 @@ void test_shape_attributes_no_turncosts() {
   }
 }
 
+void test_intersecting_edges_filtered() {
+  tyr::actor_t actor(conf);
+  auto edges_with_intersecting_edges = [&actor](const std::string& attributes) {
+    auto result_json = actor.trace_attributes(R"({"shape":[
+        {"lat":52.09110,"lon":5.09806},
+        {"lat":52.09050,"lon":5.09769},
+        {"lat":52.09098,"lon":5.09679}
+      ],"costing":"auto","shape_match":"map_snap",
+      "filters":{"attributes":[)" + attributes + R"(],"action":"include"}})");
+    rapidjson::Document doc;
+    doc.Parse(result_json);
+    if (doc.HasParseError()) {
+      throw std::logic_error("Could not parse json response");
+    }
+    size_t count = 0;
+    for (const auto& edge : rapidjson::Pointer("/edges").Get(doc)->GetArray()) {
+      count += edge.HasMember("end_node") && edge["end_node"].HasMember("intersecting_edges");
+    }
+    return count;
+  };
+
+  // The intersecting edges are only found when one of their attributes is asked for
+  if (edges_with_intersecting_edges(R"("node.elapsed_time")") != 0) {
+    throw std::logic_error("Intersecting edges should not have been found");
+  }
+  if (edges_with_intersecting_edges(
+          R"("node.elapsed_time","node.intersecting_edge.begin_heading")") == 0) {
+    throw std::logic_error("Intersecting edges should have been found");
+  }
+}
+
 } // namespace
 
 int main() {
@@ -229,6 +260,7 @@ int main() {
 
   suite.test(TEST_CASE(test_shape_attributes_included));
   suite.test(TEST_CASE(test_shape_attributes_no_turncosts));
+  suite.test(TEST_CASE(test_intersecting_edges_filtered));
 
   return suite.tear_down();
 }
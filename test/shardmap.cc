@@ -0,0 +1,102 @@
+#include "baldr/shardmap.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "test.h"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+void TestGrid() {
+  auto map = ShardMap::Grid({-10.f, 40.f, 10.f, 50.f}, 2, 1, 1.f, "http://shard-{name}:8002");
+  if (map.shards().size() != 2 || map.shards()[0].name != "0_0" || map.shards()[1].name != "1_0")
+    throw std::logic_error("Expected a shard per column");
+  if (map.shards()[0].region.maxx() != 0.f || map.shards()[1].region.minx() != 0.f ||
+      map.shards()[1].region.maxx() != 10.f)
+    throw std::logic_error("Expected the columns to split the bounds");
+  if (map.shards()[1].url != "http://shard-1_0:8002")
+    throw std::logic_error("Expected the name in the url");
+  if (map.Index("1_0") != 1 || map.Index("2_0") != -1)
+    throw std::logic_error("Expected shards to be found by name");
+  auto bounds = map.Bounds(0);
+  if (bounds.minx() != -11.f || bounds.maxx() != 1.f || bounds.maxy() != 51.f)
+    throw std::logic_error("Expected the bounds to be grown by the border");
+}
+
+void TestKeeps() {
+  auto map = ShardMap::Grid({-10.f, 40.f, 10.f, 50.f}, 2, 1, 1.f);
+  // local tiles in the west, in the border and in the east
+  auto west = TileHierarchy::GetGraphId({-5.f, 45.f}, 2);
+  auto border = TileHierarchy::GetGraphId({.5f, 45.f}, 2);
+  auto east = TileHierarchy::GetGraphId({5.f, 45.f}, 2);
+  if (!map.Keeps(0, west) || map.Keeps(1, west))
+    throw std::logic_error("Expected the west tile only in the west");
+  if (!map.Keeps(0, border) || !map.Keeps(1, border))
+    throw std::logic_error("Expected the tile in the border in both shards");
+  if (map.Keeps(0, east) || !map.Keeps(1, east))
+    throw std::logic_error("Expected the east tile only in the east");
+  // transit tiles go with their region too
+  GraphId transit(east.tileid(), TileHierarchy::GetTransitLevel().level, 0);
+  if (map.Keeps(0, transit) || !map.Keeps(1, transit))
+    throw std::logic_error("Expected the east transit tile only in the east");
+  // every shard has the highways, even far away
+  auto highway = TileHierarchy::GetGraphId({5.f, 45.f}, 0);
+  auto far = TileHierarchy::GetGraphId({100.f, -30.f}, 0);
+  if (!map.Keeps(0, highway) || !map.Keeps(0, far) || !map.Keeps(1, far))
+    throw std::logic_error("Expected every shard to keep the highway tiles");
+}
+
+void TestFind() {
+  auto map = ShardMap::Grid({-10.f, 40.f, 10.f, 50.f}, 2, 1, 1.f);
+  if (map.Find({{-5.f, 45.f}, {-4.f, 46.f}}) != 0 || map.Find({{5.f, 45.f}, {6.f, 46.f}}) != 1)
+    throw std::logic_error("Expected requests in a region to go to its shard");
+  // the border holds both, the origin's shard wins
+  if (map.Find({{.5f, 45.f}, {-.5f, 45.f}}) != 1 || map.Find({{-.5f, 45.f}, {.5f, 45.f}}) != 0)
+    throw std::logic_error("Expected the shard of the origin on a tie");
+  // the shard holding most of the locations otherwise
+  if (map.Find({{-5.f, 45.f}, {5.f, 45.f}, {6.f, 45.f}}) != 1)
+    throw std::logic_error("Expected the shard with the most locations");
+  // across the shards the origin routes over the highways
+  if (map.Find({{-5.f, 45.f}, {5.f, 45.f}}) != 0)
+    throw std::logic_error("Expected a route across the shards to start at the origin");
+  if (map.Find({{50.f, 0.f}}) != -1 || map.Find({}) != -1)
+    throw std::logic_error("Expected no shard outside of the shards");
+}
+
+void TestJson() {
+  auto map = ShardMap::Grid({-10.f, 40.f, 10.f, 50.f}, 2, 2, .5f, "http://{name}");
+  std::stringstream json(map.ToJson());
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(json, pt);
+  ShardMap read(pt);
+  if (read.border() != .5f || read.shards().size() != 4)
+    throw std::logic_error("Expected the shards to be read back");
+  for (size_t i = 0; i < 4; ++i) {
+    const auto& a = map.shards()[i];
+    const auto& b = read.shards()[i];
+    if (a.name != b.name || a.url != b.url || a.region.minx() != b.region.minx() ||
+        a.region.miny() != b.region.miny() || a.region.maxx() != b.region.maxx() ||
+        a.region.maxy() != b.region.maxy())
+      throw std::logic_error("Expected the same shards to be read back");
+  }
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("shardmap");
+
+  suite.test(TEST_CASE(TestGrid));
+
+  suite.test(TEST_CASE(TestKeeps));
+
+  suite.test(TEST_CASE(TestFind));
+
+  suite.test(TEST_CASE(TestJson));
+
+  return suite.tear_down();
+}
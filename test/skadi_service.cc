@@ -73,6 +73,25 @@ const std::vector<http_request_t> requests{
         "IxaIcF~|@cBngJiMjj@_I`HwXlJuO^kKj@gJkAeaBy`AgNoHwDkAeELwD|@uDfC_i@bq@mOjUaCvDqBrEcAbGWbG|@"
         "jVd@rPkAbGsAfDqBvCaIrFsP~RoNjWajBlnD{OtZoNfXyBtE{B~HyAtEsFhL_DvDsGrF_I`HwDpGoH|T_"
         "IzLaMzKuOrFqfAbPwCl@_h@fN}OnI\"}"),
+    http_request_t(
+        POST,
+        "/height",
+        "{\"shapes\":[{\"shape\":[{\"lat\":40.712431, \"lon\":-76.504916},{\"lat\":40.712275, "
+        "\"lon\":-76.605259},{\"lat\":40.712122, \"lon\":-76.805694},{\"lat\":40.722431, "
+        "\"lon\":-76.884916},{\"lat\":40.812275, \"lon\":-76.905259},{\"lat\":40.912122, "
+        "\"lon\":-76.965694}]},{\"encoded_polyline\":\"s{cplAfiz{pCa]xBxBx`AhC|gApBrz@{[hBsZhB_c@"
+        "rFodDbRaG\\\\ypAfDec@l@mrBnHg|@?}TzAia@dFw^xKqWhNe^hWegBfvAcGpG{dAdy@_`CpoBqGfC_SnI{KrFgx@"
+        "?ofA_Tus@c[qfAgw@s_Agc@}^}JcF{@_Dz@eFfEsArEs@pHm@pg@wDpkEx\\\\vjT}Djj@eUppAeKzj@eZpuE_"
+        "IxaIcF~|@cBngJiMjj@_I`HwXlJuO^kKj@gJkAeaBy`AgNoHwDkAeELwD|@uDfC_i@bq@mOjUaCvDqBrEcAbGWbG|@"
+        "jVd@rPkAbGsAfDqBvCaIrFsP~RoNjWajBlnD{OtZoNfXyBtE{B~HyAtEsFhL_DvDsGrF_I`HwDpGoH|T_"
+        "IzLaMzKuOrFqfAbPwCl@_h@fN}OnI\"}]}"),
+    http_request_t(
+        POST,
+        "/height",
+        "{\"range\":true,\"height_encoding\":\"polyline\",\"id\":\"profiles\",\"shapes\":[{"
+        "\"shape\":[{\"lat\":40.712431, \"lon\":-76.504916},{\"lat\":40.712275, \"lon\":-76.605259},"
+        "{\"lat\":40.712122, \"lon\":-76.805694},{\"lat\":40.722431, \"lon\":-76.884916},{"
+        "\"lat\":40.812275, \"lon\":-76.905259},{\"lat\":40.912122, \"lon\":-76.965694}]}]}"),
 };
 
 const std::vector<std::string> responses{
@@ -151,7 +170,26 @@ const std::vector<std::string> responses{
         "216,223,227,227,228,230,232,236,251,251,251,251,251,254,258,267,283,289,298,308,316,318,"
         "320,322,323,324,328,359,445,452,463,463,448,405,393,336,329,326,316,311,309,308,289,291,"
         "292,292,291,289,278,279,279,280,281,281,280,281,281,282,282,282,280,276,251,248,247,246,"
-        "244,243,240,239,239,238,239,241,241,239,236,221,221,225,224]}")};
+        "244,243,240,239,239,238,239,241,241,239,236,221,221,225,224]}"),
+    std::string(
+        "{\"heights\":[{\"shape\":[{\"lat\":40.712433,\"lon\":-76.504913},{\"lat\":40.712276,"
+        "\"lon\":-76.605263},{\"lat\":40.712124,\"lon\":-76.805695},{\"lat\":40.722431,\"lon\":"
+        "-76.884918},{\"lat\":40.812275,\"lon\":-76.905258},{\"lat\":40.912121,\"lon\":-76."
+        "965691}],\"height\":[307,272,204,204,180,198]},{\"encoded_polyline\":\"s{cplAfiz{pCa]xBxBx`"
+        "AhC|gApBrz@{[hBsZhB_c@rFodDbRaG\\\\ypAfDec@l@mrBnHg|@?}TzAia@dFw^xKqWhNe^hWegBfvAcGpG{dAdy@"
+        "_`CpoBqGfC_SnI{KrFgx@?ofA_Tus@c[qfAgw@s_Agc@}^}JcF{@_Dz@eFfEsArEs@pHm@pg@wDpkEx\\\\vjT}Djj@"
+        "eUppAeKzj@eZpuE_IxaIcF~|@cBngJiMjj@_I`HwXlJuO^kKj@gJkAeaBy`AgNoHwDkAeELwD|@uDfC_i@bq@mOjUaC"
+        "vDqBrEcAbGWbG|@jVd@rPkAbGsAfDqBvCaIrFsP~RoNjWajBlnD{OtZoNfXyBtE{B~HyAtEsFhL_DvDsGrF_I`HwDpG"
+        "oH|T_IzLaMzKuOrFqfAbPwCl@_h@fN}OnI\",\"height\":[258,258,259,257,255,253,246,245,233,233,"
+        "221,216,223,227,227,228,230,232,236,251,251,251,251,251,254,258,267,283,289,298,308,316,318,"
+        "320,322,323,324,328,359,445,452,463,463,448,405,393,336,329,326,316,311,309,308,289,291,292,"
+        "292,291,289,278,279,279,280,281,281,280,281,281,282,282,282,280,276,251,248,247,246,244,243,"
+        "240,239,239,238,239,241,241,239,236,221,221,225,224]}]}"),
+    std::string(
+        "{\"id\":\"profiles\",\"heights\":[{\"shape\":[{\"lat\":40.712433,\"lon\":-76.504913},{"
+        "\"lat\":40.712276,\"lon\":-76.605263},{\"lat\":40.712124,\"lon\":-76.805695},{\"lat\":"
+        "40.722431,\"lon\":-76.884918},{\"lat\":40.812275,\"lon\":-76.905258},{\"lat\":40.912121,"
+        "\"lon\":-76.965691}],\"range_height\":\"?eRepOdAa``@fC{fL?eyRn@_{Vc@\"}]}")};
 
 // TODO: add tests that do resampling as well
 
@@ -0,0 +1,105 @@
+#include "test.h"
+#include <cstdint>
+#include <stdexcept>
+
+#include "mjolnir/osmdata.h"
+#include "mjolnir/sortedmultimap.h"
+
+using namespace std;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+void TestEqualRange() {
+  SortedMultiMap<uint32_t, uint32_t> map;
+  map.insert({7, 1});
+  map.insert({3, 2});
+  map.insert({7, 3});
+  map.insert({5, 4});
+  map.insert({7, 5});
+
+  // Lookups before sorting are a bug
+  try {
+    map.find(7);
+    throw runtime_error("Expected lookup before sorting to throw");
+  } catch (const logic_error&) {}
+
+  map.sort();
+  auto range = map.equal_range(7);
+  vector<uint32_t> values;
+  for (auto it = range.first; it != range.second; ++it) {
+    values.push_back(it->second);
+  }
+  if (values != vector<uint32_t>{1, 3, 5})
+    throw runtime_error("Expected values of a key in insertion order");
+
+  // Missing keys give end() the way the hash maps did
+  for (uint32_t key : {0, 4, 6, 8}) {
+    range = map.equal_range(key);
+    if (range.first != map.end() || range.second != map.end())
+      throw runtime_error("Expected end() for a missing key");
+  }
+  if (map.find(3) == map.end() || map.find(3)->second != 2)
+    throw runtime_error("Expected to find key 3");
+}
+
+void TestSortedSet() {
+  SortedSet<uint32_t> set;
+  for (uint32_t key : {9, 2, 9, 4, 2}) {
+    set.insert(key);
+  }
+  set.sort();
+  if (set.size() != 3)
+    throw runtime_error("Expected duplicates to be dropped");
+  if (set.find(4) == set.end() || set.find(3) != set.end())
+    throw runtime_error("Unexpected set membership");
+}
+
+void TestTempFiles() {
+  OSMData osmdata{};
+  osmdata.bike_relations.insert(BikeMultiMap::value_type(42, OSMBike{1, 2, 3}));
+  osmdata.bike_relations.insert(BikeMultiMap::value_type(12, OSMBike{4, 5, 6}));
+  osmdata.via_set.insert(8);
+  osmdata.via_set.insert(1);
+  osmdata.add_to_name_map(99, "north", "I 95");
+  osmdata.add_to_name_map(99, "south", "US 1");
+  osmdata.add_to_name_map(98, "west", "A 1", false);
+  if (!osmdata.write_to_temp_files("test/data/"))
+    throw runtime_error("Failed to write temp files");
+
+  OSMData read{};
+  if (!read.read_from_temp_files("test/data/"))
+    throw runtime_error("Failed to read temp files");
+  OSMData::cleanup_temp_files("test/data/");
+
+  auto bike = read.bike_relations.find(42);
+  if (read.bike_relations.size() != 2 || bike == read.bike_relations.end() ||
+      bike->second.ref_index != 3)
+    throw runtime_error("Bike relations did not survive the temp files");
+  if (read.via_set.size() != 2 || read.via_set.find(8) == read.via_set.end())
+    throw runtime_error("Via set did not survive the temp files");
+
+  // The refs of a way are joined in the order they were added
+  auto ref = read.way_ref.find(99);
+  if (read.way_ref.size() != 1 || ref == read.way_ref.end() ||
+      read.name_offset_map.name(ref->second) != "I 95|North;US 1|South")
+    throw runtime_error("Expected the way refs to be joined");
+  auto ref_rev = read.way_ref_rev.find(98);
+  if (ref_rev == read.way_ref_rev.end() || read.name_offset_map.name(ref_rev->second) != "A 1|West")
+    throw runtime_error("Expected the reverse way ref");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("sortedmultimap");
+
+  suite.test(TEST_CASE(TestEqualRange));
+
+  suite.test(TEST_CASE(TestSortedSet));
+
+  // Test the maps of OSMData going through the temp files
+  suite.test(TEST_CASE(TestTempFiles));
+
+  return suite.tear_down();
+}
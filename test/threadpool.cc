@@ -0,0 +1,95 @@
+#include "thor/threadpool.h"
+#include "test.h"
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace valhalla::thor;
+
+namespace {
+
+void TestParallelFor() {
+  ThreadPool pool(4);
+  if (pool.concurrency() != 4)
+    throw std::runtime_error("Expected 4 threads");
+
+  // Every item runs exactly once, over and over again
+  for (uint32_t count : {0u, 1u, 3u, 100u, 1000u}) {
+    for (int round = 0; round < 20; ++round) {
+      std::vector<std::atomic<uint32_t>> runs(count);
+      pool.parallel_for(count, [&runs](const uint32_t i) { runs[i]++; });
+      for (const auto& r : runs) {
+        if (r != 1)
+          throw std::runtime_error("Expected every item to run once");
+      }
+    }
+  }
+}
+
+void TestException() {
+  ThreadPool pool(3);
+  std::atomic<uint32_t> done(0);
+  try {
+    pool.parallel_for(50, [&done](const uint32_t i) {
+      if (i == 17) {
+        throw std::logic_error("17");
+      }
+      done++;
+    });
+    throw std::runtime_error("Expected the exception to be rethrown");
+  } catch (const std::logic_error&) {}
+  if (done != 49)
+    throw std::runtime_error("Expected the other items to run");
+
+  // The pool is still usable
+  done = 0;
+  pool.parallel_for(10, [&done](const uint32_t) { done++; });
+  if (done != 10)
+    throw std::runtime_error("Expected the pool to keep working");
+}
+
+void TestSlots() {
+  ThreadPool pool(3);
+
+  // No two items of the same slot overlap so unguarded per slot state is fine
+  std::vector<uint32_t> per_slot(pool.concurrency(), 0);
+  std::vector<std::atomic<bool>> busy(pool.concurrency());
+  pool.parallel_for(3000, [&](const uint32_t, const uint32_t slot) {
+    if (slot >= per_slot.size() || busy[slot].exchange(true))
+      throw std::runtime_error("Slot used by two threads at once");
+    per_slot[slot]++;
+    busy[slot] = false;
+  });
+  uint32_t total = 0;
+  for (auto count : per_slot) {
+    total += count;
+  }
+  if (total != 3000)
+    throw std::runtime_error("Expected every item to run once");
+}
+
+void TestSingleThread() {
+  ThreadPool pool(1);
+  std::vector<uint32_t> order;
+  pool.parallel_for(5, [&order](const uint32_t i) { order.push_back(i); });
+  if (order != std::vector<uint32_t>{0, 1, 2, 3, 4})
+    throw std::runtime_error("Expected the items to run in order on the calling thread");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("threadpool");
+
+  suite.test(TEST_CASE(TestParallelFor));
+
+  suite.test(TEST_CASE(TestException));
+
+  suite.test(TEST_CASE(TestSlots));
+
+  suite.test(TEST_CASE(TestSingleThread));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,162 @@
+#include "test.h"
+#include <cstdint>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtileheader.h"
+#include "baldr/tileindex.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+// Appends a header only tile to a tar
+void write_tar_entry(std::ofstream& tar, const GraphId& graphid, const uint64_t dataset_id) {
+  GraphTileHeader tile;
+  tile.set_graphid(graphid);
+  tile.set_dataset_id(dataset_id);
+  tile.set_end_offset(sizeof(GraphTileHeader));
+
+  char header[512] = {};
+  snprintf(header, 100, "%s", GraphTile::FileSuffix(graphid).c_str());
+  snprintf(header + 100, 8, "%07o", 0644);
+  snprintf(header + 108, 8, "%07o", 0);
+  snprintf(header + 116, 8, "%07o", 0);
+  snprintf(header + 124, 12, "%011o", static_cast<unsigned>(sizeof(tile)));
+  snprintf(header + 136, 12, "%011o", 0);
+  header[156] = '0';
+  memcpy(header + 257, "ustar", 6);
+  memcpy(header + 263, "00", 2);
+  memset(header + 148, ' ', 8);
+  unsigned checksum = 0;
+  for (auto c : header) {
+    checksum += static_cast<unsigned char>(c);
+  }
+  snprintf(header + 148, 8, "%06o", checksum);
+  tar.write(header, sizeof(header));
+
+  std::vector<char> data(512 * ((sizeof(tile) + 511) / 512), 0);
+  memcpy(data.data(), &tile, sizeof(tile));
+  tar.write(data.data(), data.size());
+}
+
+void TestExtractTiles() {
+  const std::string tar_file = "test/data/tileextract_test.tar";
+  const std::string index_file = "test/data/tileextract_test.idx";
+  boost::filesystem::remove(index_file);
+  const std::vector<GraphId> ids{{42, 2, 0}, {7, 1, 0}, {0, 0, 0}, {1000, 2, 0}};
+  {
+    std::ofstream tar(tar_file, std::ios::binary);
+    for (const auto& id : ids) {
+      write_tar_entry(tar, id, id.tileid() + 1);
+    }
+    std::vector<char> end(1024, 0);
+    tar.write(end.data(), end.size());
+  }
+
+  // The extract is shared by every reader in the process so this is its only test
+  boost::property_tree::ptree pt;
+  pt.put("tile_extract", tar_file);
+  pt.put("tile_extract_index", index_file);
+  pt.put("max_cache_size", 1);
+  GraphReader reader(pt);
+
+  // Walking the tar wrote the index for the next process
+  test::assert_bool(boost::filesystem::exists(index_file) &&
+                        boost::filesystem::file_size(index_file) ==
+                            ids.size() * sizeof(TileIndexEntry),
+                    "the tiles of the extract should be indexed");
+  {
+    std::vector<TileIndexEntry> entries(ids.size());
+    std::ifstream index(index_file, std::ios::binary);
+    index.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(TileIndexEntry));
+    for (const auto& entry : entries) {
+      size_t at = std::find(ids.cbegin(), ids.cend(), GraphId(entry.tile_id)) - ids.cbegin();
+      test::assert_bool(at < ids.size() && entry.offset == 512 * (2 * at + 1) &&
+                            entry.size == sizeof(GraphTileHeader),
+                        "the index should say where each tile is");
+    }
+  }
+  for (const auto& id : ids) {
+    const GraphTile* tile = reader.GetGraphTile(id);
+    test::assert_bool(tile && tile->header()->dataset_id() == id.tileid() + 1,
+                      "tiles should be found in the extract");
+    test::assert_bool(reader.GetGraphTile(GraphId(id.tileid(), id.level(), 5)) == tile,
+                      "any id within a tile should give the same tile");
+    test::assert_bool(reader.DoesTileExist(id), "tiles in the extract should exist");
+  }
+  test::assert_bool(!reader.GetGraphTile({43, 2, 0}) && !reader.GetGraphTile({5000, 2, 0}) &&
+                        !reader.GetGraphTile({42, 3, 0}) && !reader.GetGraphTile(GraphId()),
+                    "tiles not in the extract should not be found");
+
+  // The tiles do not count against the cache, so they stay after clearing it
+  test::assert_bool(!reader.OverCommitted(), "extract tiles should not fill the cache");
+  const GraphTile* tile = reader.GetGraphTile(ids.front());
+  reader.Clear();
+  test::assert_bool(reader.GetGraphTile(ids.front()) == tile, "extract tiles should stay put");
+  test::assert_bool(reader.Preload(10, 2) == 0, "extract tiles should never need preloading");
+
+  // Other readers share the tiles
+  GraphReader other(pt);
+  test::assert_bool(other.GetGraphTile(ids.front()) == tile, "readers should share the tiles");
+
+  // A new extract is swapped in next to the old one and readers switch when they update
+  const std::string swap_file = "test/data/tileextract_swap_test.tar";
+  {
+    std::ofstream tar(swap_file, std::ios::binary);
+    for (const auto& id : ids) {
+      write_tar_entry(tar, id, id.tileid() + 100);
+    }
+    std::vector<char> end(1024, 0);
+    tar.write(end.data(), end.size());
+  }
+  auto swap_pt = pt;
+  swap_pt.put("tile_extract", swap_file);
+  swap_pt.erase("tile_extract_index");
+  auto version = reader.tile_extract_version();
+  test::assert_bool(GraphReader::SwapTileExtract(swap_pt) == version + 1,
+                    "swapping should make a new version");
+  test::assert_bool(reader.GetGraphTile(ids.front()) == tile &&
+                        tile->header()->dataset_id() == ids.front().tileid() + 1,
+                    "readers should keep their version until they update");
+  test::assert_bool(reader.UpdateTileExtract() && !reader.UpdateTileExtract() &&
+                        reader.tile_extract_version() == version + 1,
+                    "readers should update to the new version once");
+  test::assert_bool(reader.GetGraphTile(ids.front())->header()->dataset_id() ==
+                        ids.front().tileid() + 100,
+                    "updated readers should get the tiles of the new version");
+  test::assert_bool(other.GetGraphTile(ids.front()) == tile &&
+                        tile->header()->dataset_id() == ids.front().tileid() + 1,
+                    "the old version should stay while a reader uses it");
+  test::assert_bool(GraphReader(pt).tile_extract_version() == version + 1,
+                    "new readers should start on the new version");
+
+  // An extract without tiles is not swapped in
+  swap_pt.put("tile_extract", "test/data/tileextract_missing.tar");
+  test::assert_throw<std::runtime_error>([&swap_pt]() { GraphReader::SwapTileExtract(swap_pt); },
+                                         "swapping in an extract without tiles should fail");
+  test::assert_bool(!reader.UpdateTileExtract() && GraphReader(pt).tile_extract_version() ==
+                                                       version + 1,
+                    "a failed swap should keep the version");
+
+  boost::filesystem::remove(tar_file);
+  boost::filesystem::remove(swap_file);
+  boost::filesystem::remove(index_file);
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("tileextract");
+
+  suite.test(TEST_CASE(TestExtractTiles));
+
+  return suite.tear_down();
+}
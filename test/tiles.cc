@@ -315,6 +315,38 @@ void test_random_linestring() {
   }
 }
 
+void test_intersect_bins() {
+  // the masks have to match the sets for random lines crossing lots of tiles and coming back
+  Tiles<Point2> t(AABB2<Point2>{-10, -10, 10, 10}, 1, 5);
+  std::mt19937 generator;
+  std::uniform_real_distribution<> distribution(-10, 10);
+  for (int i = 0; i < 100; ++i) {
+    std::list<Point2> linestring;
+    for (int j = 0; j < 100; ++j)
+      linestring.emplace_back(distribution(generator), distribution(generator));
+    auto expected = t.Intersect(linestring);
+    auto answer = t.IntersectBins(linestring);
+    if (answer.size() != expected.size())
+      throw std::logic_error("Wrong number of tiles intersected");
+    for (size_t k = 0; k < answer.size(); ++k) {
+      if (k > 0 && answer[k - 1].first >= answer[k].first)
+        throw std::logic_error("Tiles should be unique and in order");
+      uint64_t mask = 0;
+      for (auto sub : expected[answer[k].first])
+        mask |= uint64_t(1) << sub;
+      if (answer[k].second != mask)
+        throw std::logic_error("Wrong bins intersected in tile " + std::to_string(answer[k].first));
+    }
+  }
+
+  // too many subdivisions to fit in a mask
+  Tiles<Point2> fine(AABB2<Point2>{-10, -10, 10, 10}, 1, 9);
+  try {
+    fine.IntersectBins(std::vector<Point2>{{0, 0}, {1, 1}});
+    throw std::runtime_error("Too many subdivisions should throw");
+  } catch (const std::logic_error&) {}
+}
+
 template <class coord_t>
 std::pair<int32_t, int32_t> to_xy(std::tuple<int32_t, unsigned short, float> tile,
                                   const Tiles<coord_t>& t) {
@@ -560,6 +592,8 @@ int main() {
 
   suite.test(TEST_CASE(test_random_linestring));
 
+  suite.test(TEST_CASE(test_intersect_bins));
+
   suite.test(TEST_CASE(test_intersect_bbox_world));
   suite.test(TEST_CASE(test_intersect_bbox_single));
   suite.test(TEST_CASE(test_intersect_bbox_rounding));
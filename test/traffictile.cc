@@ -0,0 +1,120 @@
+#include "baldr/traffictile.h"
+#include "test.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "baldr/directededge.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphtile.h"
+#include "baldr/graphtileheader.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// a tile with nothing but a header and some edges
+struct test_tile : public GraphTile {
+  test_tile(const GraphId& id, const size_t count) : edges(count) {
+    header.set_graphid(id);
+    header.set_directededgecount(count);
+    header_ = &header;
+    directededges_ = edges.data();
+    for (auto& edge : edges) {
+      edge.set_speed(50);
+      edge.set_constrained_flow_speed(40);
+    }
+  }
+  GraphTileHeader header;
+  std::vector<DirectedEdge> edges;
+};
+
+TrafficSpeed make_speed(const uint32_t kph) {
+  TrafficSpeed speed{};
+  speed.speed = kph;
+  speed.congestion = 50;
+  return speed;
+}
+
+void test_speeds() {
+  GraphId id(1234, 2, 0);
+  auto data = TrafficTile::Create(id, 3);
+  TrafficTile traffic(data.data(), data.size());
+  if (!traffic || traffic.header()->tile_id != id.value || traffic.header()->directed_edge_count != 3)
+    throw std::logic_error("Expected an empty traffic tile");
+  for (uint32_t i = 0; i < 3; ++i) {
+    if (traffic.speed(i).valid())
+      throw std::logic_error("An empty traffic tile should have no speeds");
+  }
+
+  traffic.set_speed(1, make_speed(17));
+  auto speed = traffic.speed(1);
+  if (!speed.valid() || speed.speed != 17 || speed.congestion != 50)
+    throw std::logic_error("Wrong speed after setting it");
+  // out of range edges have no speed and setting them does nothing
+  traffic.set_speed(3, make_speed(17));
+  if (traffic.speed(3).valid())
+    throw std::logic_error("Edges past the end should have no speed");
+
+  // too small or of another version is no traffic at all
+  if (TrafficTile(data.data(), data.size() - 1))
+    throw std::logic_error("A truncated traffic tile should be ignored");
+  reinterpret_cast<TrafficTileHeader*>(data.data())->traffic_tile_version = kTrafficTileVersion + 1;
+  if (TrafficTile(data.data(), data.size()))
+    throw std::logic_error("A traffic tile of another version should be ignored");
+}
+
+void test_get_speed() {
+  GraphId id(1234, 2, 0);
+  test_tile tile(id, 3);
+  auto data = TrafficTile::Create(id, 3);
+  tile.set_traffic_tile(TrafficTile(data.data(), data.size()));
+  if (!tile.traffic_tile())
+    throw std::logic_error("The tile should have traffic");
+
+  // no live speed yet so the constrained flow speed
+  uint8_t sources;
+  if (tile.GetSpeed(&tile.edges[0], kDefaultFlowMask, kInvalidSecondsOfWeek, &sources) != 40 ||
+      sources != kConstrainedFlowMask)
+    throw std::logic_error("Expected the constrained flow speed");
+
+  // another process updates the speed in place and the next lookup sees it
+  TrafficTile updater(data.data(), data.size());
+  updater.set_speed(0, make_speed(12));
+  if (tile.GetSpeed(&tile.edges[0], kDefaultFlowMask, kInvalidSecondsOfWeek, &sources) != 12 ||
+      sources != kCurrentFlowMask)
+    throw std::logic_error("Expected the live speed");
+  if (tile.GetSpeed(&tile.edges[1], kDefaultFlowMask) != 40)
+    throw std::logic_error("Only the updated edge should have a live speed");
+
+  // unless the current flow was not asked for
+  if (tile.GetSpeed(&tile.edges[0], kConstrainedFlowMask) != 40)
+    throw std::logic_error("The live speed should only be used for the current flow");
+}
+
+void test_mismatch() {
+  // traffic for another tile or with another number of edges is not used
+  test_tile tile(GraphId(1234, 2, 0), 3);
+  auto other = TrafficTile::Create(GraphId(1235, 2, 0), 3);
+  tile.set_traffic_tile(TrafficTile(other.data(), other.size()));
+  auto fewer = TrafficTile::Create(GraphId(1234, 2, 0), 2);
+  tile.set_traffic_tile(TrafficTile(fewer.data(), fewer.size()));
+  if (tile.traffic_tile())
+    throw std::logic_error("Traffic that does not match the tile should be ignored");
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("traffictile");
+
+  suite.test(TEST_CASE(test_speeds));
+
+  suite.test(TEST_CASE(test_get_speed));
+
+  suite.test(TEST_CASE(test_mismatch));
+
+  return suite.tear_down();
+}
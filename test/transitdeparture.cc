@@ -1,7 +1,11 @@
 #include "test.h"
 
+#include "baldr/graphtile.h"
 #include "baldr/transitdeparture.h"
 
+#include <memory>
+#include <vector>
+
 using namespace std;
 using namespace valhalla::baldr;
 
@@ -215,6 +219,67 @@ void TestSort() {
     throw runtime_error("TransitDeparture sort (4) failed");
   }
 }
+
+// A tile holding nothing but departures and their schedules
+struct test_tile : public GraphTile {
+  test_tile(const std::vector<TransitDeparture>& departures,
+            const std::vector<TransitSchedule>& schedules)
+      : departures(departures), schedules(schedules) {
+    header.set_departurecount(departures.size());
+    header.set_schedulecount(schedules.size());
+    header_ = &header;
+    departures_ = this->departures.data();
+    transit_schedules_ = this->schedules.data();
+    IndexTransitLines();
+  }
+  GraphTileHeader header;
+  std::vector<TransitDeparture> departures;
+  std::vector<TransitSchedule> schedules;
+};
+
+void TestNextDeparture() {
+  // schedule 0 runs every day, schedule 1 never does
+  test_tile tile({{1, 10, 0, 0, 0, 100, 60, 1, true, true},
+                  {1, 11, 0, 0, 0, 200, 60, 0, false, true},
+                  {1, 12, 0, 0, 0, 300, 60, 0, true, true},
+                  {1, 13, 0, 0, 0, 150, 1000, 100, 60, 0, false, true},
+                  {2, 20, 0, 0, 0, 500, 60, 0, true, true}},
+                 {{~0ULL, kAllDaysOfWeek, 63}, {0, 0, 63}});
+  auto next = [&tile](uint32_t lineid, uint32_t time, bool wheelchair) {
+    const TransitDeparture* dep =
+        tile.GetNextDeparture(lineid, time, 0, kMonday, false, wheelchair, false);
+    auto result = dep ? std::make_pair(dep->tripid(), dep->departure_time())
+                      : std::make_pair(0u, 0u);
+    if (dep && dep->type() == kFrequencySchedule) {
+      delete dep;
+    }
+    return result;
+  };
+
+  // the frequency based trip leaves before the first fixed departure running on the day
+  if (next(1, 50, false) != std::make_pair(13u, 150u))
+    throw runtime_error("Expected the first run of the frequency based trip");
+  // and after the next fixed one
+  if (next(1, 160, false) != std::make_pair(11u, 200u))
+    throw runtime_error("Expected the next fixed departure");
+  if (next(1, 160, true) != std::make_pair(12u, 300u))
+    throw runtime_error("Expected the next wheelchair accessible departure");
+  if (next(1, 310, false) != std::make_pair(13u, 350u))
+    throw runtime_error("Expected the next run of the frequency based trip");
+  if (next(1, 1000, false).first != 0 || next(3, 0, false).first != 0)
+    throw runtime_error("Expected no departure past the end of the line or on another line");
+  if (next(2, 0, false) != std::make_pair(20u, 500u))
+    throw runtime_error("Expected the departure of the other line");
+
+  const auto* dep = tile.GetTransitDeparture(1, 12, 250);
+  if (!dep || dep->departure_time() != 300)
+    throw runtime_error("Expected the fixed departure of the trip");
+  std::unique_ptr<const TransitDeparture> run(tile.GetTransitDeparture(1, 13, 260));
+  if (!run || run->departure_time() != 350)
+    throw runtime_error("Expected the run of the frequency based trip");
+  if (tile.GetTransitDeparture(2, 12, 0) || tile.GetTransitDepartures().size() != 2)
+    throw runtime_error("Expected the trips to be found on their lines");
+}
 } // namespace
 
 int main(void) {
@@ -231,5 +296,8 @@ int main(void) {
   // Test sorting
   suite.test(TEST_CASE(TestSort));
 
+  // Test finding the departures of the lines of a tile
+  suite.test(TEST_CASE(TestNextDeparture));
+
   return suite.tear_down();
 }
@@ -461,6 +461,48 @@ void TestSimilarAndEqual() {
   }
 }
 
+void TestClosest() {
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> offset(-.01f, .01f);
+  for (size_t count = 1; count < 40; ++count) {
+    // a random walk with some repeated points for zero length segments
+    std::vector<PointLL> shape{{-76.3f, 40.1f}};
+    for (size_t i = 1; i < count; ++i) {
+      shape.push_back(i % 7 == 0 ? shape.back()
+                                 : PointLL(shape.back().first + offset(generator),
+                                           shape.back().second + offset(generator)));
+    }
+    projector_t projector(PointLL(-76.3f + offset(generator), 40.1f + offset(generator)));
+
+    // one segment at a time
+    PointLL expected_point;
+    float expected_distance = std::numeric_limits<float>::max();
+    size_t expected = count;
+    for (size_t i = 0; i + 1 < count; ++i) {
+      auto point = projector(shape[i], shape[i + 1]);
+      auto distance = projector.approx.DistanceSquared(point);
+      if (distance < expected_distance) {
+        expected_point = point;
+        expected_distance = distance;
+        expected = i;
+      }
+    }
+
+    // in batches must be exactly the same
+    PointLL point;
+    float distance = std::numeric_limits<float>::max();
+    auto closest = projector.closest(shape.data(), count, point, distance);
+    if (closest != expected || distance != expected_distance ||
+        (closest < count && point != expected_point))
+      throw std::logic_error("Batched projection disagrees with projecting one segment at a time");
+
+    // nothing closer than a distance that cant be beaten
+    distance = 0.f;
+    if (projector.closest(shape.data(), count, point, distance) != count)
+      throw std::logic_error("Nothing should be closer than 0");
+  }
+}
+
 } // namespace
 
 int main() {
@@ -500,5 +542,7 @@ int main() {
   // Test similar and equal edge cases
   suite.test(TEST_CASE(TestSimilarAndEqual));
 
+  suite.test(TEST_CASE(TestClosest));
+
   return suite.tear_down();
 }
@@ -0,0 +1,202 @@
+#include "mjolnir/admin.h"
+#include "mjolnir/util.h"
+#include "test.h"
+
+#include "baldr/tilehierarchy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+void scheduler_order() {
+  // the most expensive tiles come first, ties keep their order
+  TileScheduler<int> scheduler({{1, 5}, {2, 500}, {3, 5}, {4, 50}, {5, 0}});
+  std::vector<int> order;
+  int tile;
+  while (scheduler.next(tile)) {
+    order.push_back(tile);
+  }
+  if (order != std::vector<int>{2, 4, 1, 3, 5})
+    throw std::runtime_error("Tiles were not handed out by cost");
+  if (scheduler.next(tile))
+    throw std::runtime_error("Done scheduler should have nothing left");
+}
+
+void scheduler_threads() {
+  // every tile is claimed by exactly one thread
+  std::vector<std::pair<size_t, size_t>> tiles;
+  for (size_t i = 0; i < 10000; ++i) {
+    tiles.emplace_back(i, i % 97);
+  }
+  TileScheduler<size_t> scheduler(tiles);
+  std::vector<std::atomic<int>> claims(tiles.size());
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&scheduler, &claims]() {
+      size_t tile;
+      while (scheduler.next(tile)) {
+        claims[tile]++;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (std::any_of(claims.begin(), claims.end(), [](const std::atomic<int>& c) { return c != 1; }))
+    throw std::runtime_error("Every tile should be claimed once");
+}
+
+void stealing_scheduler_order() {
+  // each worker starts on its own stretch and steals the back half of the longest one left
+  StealingTileScheduler<int> scheduler({0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}, 2);
+  int tile;
+  std::vector<int> first, second;
+  for (int i = 0; i < 6 && scheduler.next(0, tile); ++i) {
+    first.push_back(tile);
+  }
+  if (first != std::vector<int>{0, 1, 2, 3, 4, 5})
+    throw std::runtime_error("First worker should keep to its stretch");
+  // the first worker steals 9-11 from the second, which takes 11 back once done with 6-8
+  scheduler.next(0, tile);
+  first.push_back(tile);
+  while (scheduler.next(1, tile)) {
+    second.push_back(tile);
+  }
+  while (scheduler.next(0, tile)) {
+    first.push_back(tile);
+  }
+  if (first != std::vector<int>{0, 1, 2, 3, 4, 5, 9, 10} ||
+      second != std::vector<int>{6, 7, 8, 11})
+    throw std::runtime_error("Workers did not steal the far half of what was left");
+}
+
+void stealing_scheduler_threads() {
+  // every tile is claimed by exactly one worker, even with more workers than tiles
+  for (size_t count : {3, 10000}) {
+    std::vector<size_t> tiles(count);
+    std::iota(tiles.begin(), tiles.end(), 0);
+    StealingTileScheduler<size_t> scheduler(tiles, 4);
+    std::vector<std::atomic<int>> claims(tiles.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+      threads.emplace_back([&scheduler, &claims, t]() {
+        size_t tile;
+        while (scheduler.next(t, tile)) {
+          claims[tile]++;
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    if (std::any_of(claims.begin(), claims.end(), [](const std::atomic<int>& c) { return c != 1; }))
+      throw std::runtime_error("Every tile should be claimed once");
+  }
+}
+
+void dirty_tiles() {
+  // a change within one local tile dirties it and the 8 around it
+  const auto& tiles = valhalla::baldr::TileHierarchy::levels().rbegin()->second.tiles;
+  auto center = tiles.TileId(valhalla::midgard::PointLL(-76.6, 40.6));
+  using box_t = valhalla::midgard::AABB2<valhalla::midgard::PointLL>;
+  auto dirty = DirtyTiles({box_t(-76.7, 40.55, -76.55, 40.7)}, 2);
+  if (dirty.size() != 9 || !dirty.count(valhalla::baldr::GraphId(center, 2, 0)))
+    throw std::runtime_error("Expected the changed tile and its neighbours");
+  auto center_base = tiles.Base(center);
+  for (const auto& tile : dirty) {
+    auto base = tiles.Base(tile.tileid());
+    if (std::abs(base.lat() - center_base.lat()) > tiles.TileSize() * 1.5 ||
+        std::abs(base.lng() - center_base.lng()) > tiles.TileSize() * 1.5)
+      throw std::runtime_error("Unexpected dirty tile " + std::to_string(tile));
+  }
+}
+
+void polygon_grid() {
+  // a polygon covering the tile, one inside it and one crossing its corner
+  std::unordered_multimap<uint32_t, multi_polygon_type> polys;
+  for (const auto& wkt : {"MULTIPOLYGON(((0.1 0.1,0.2 0.6,0.55 0.5,0.5 0.1,0.1 0.1)))",
+                          "MULTIPOLYGON(((0.5 0.5,0.5 1.2,1.3 1.2,0.5 0.5)))",
+                          "MULTIPOLYGON(((0 0,0 1,1 1,1 0,0 0)))"}) {
+    multi_polygon_type poly;
+    boost::geometry::read_wkt(wkt, poly);
+    polys.emplace(polys.size() + 1, poly);
+  }
+
+  // the grid has to answer the same as testing every polygon
+  PolygonGrid grid(polys, AABB2<PointLL>(0, 0, 1, 1), nullptr, 8);
+  for (int i = 0; i <= 100; ++i) {
+    for (int j = 0; j <= 100; ++j) {
+      PointLL ll(i / 100.0, j / 100.0);
+      if (grid.Get(ll) != GetMultiPolyId(polys, ll))
+        throw std::runtime_error("Wrong polygon at " + std::to_string(ll.lng()) + "," +
+                                 std::to_string(ll.lat()));
+    }
+  }
+  if (PolygonGrid({}, AABB2<PointLL>(0, 0, 1, 1)).Get(PointLL(0.5, 0.5)) != 0)
+    throw std::runtime_error("Expected no polygon");
+}
+
+void build_profile() {
+  const std::string tile_dir = "test/build_profile_test";
+  boost::filesystem::remove_all(tile_dir);
+  boost::filesystem::create_directories(tile_dir);
+  BuildProfile profile(tile_dir, tile_dir + "/profile.json");
+  {
+    // a stage that writes 4MB and keeps 64MB resident
+    BuildProfile::Stage measure(profile, BuildStage::kParse);
+    std::vector<char> memory(64 << 20, 1);
+    std::ofstream file(tile_dir + "/ways.bin", std::ios::binary);
+    file.write(memory.data(), 4 << 20);
+  }
+  if (profile.stages().size() != 1 || profile.stages().front().stage != BuildStage::kParse)
+    throw std::runtime_error("Expected the parse stage to be measured");
+  const auto& usage = profile.stages().front();
+  if (usage.wall_seconds <= 0 || usage.cpu_seconds < 0)
+    throw std::runtime_error("Expected the stage to take time");
+  if (usage.tile_dir_bytes < (4 << 20))
+    throw std::runtime_error("Expected the tile dir to hold what the stage wrote");
+  if (usage.peak_rss_bytes < (64 << 20))
+    throw std::runtime_error("Expected the memory of the stage to be resident");
+#ifdef __linux__
+  if (usage.bytes_written < (4 << 20))
+    throw std::runtime_error("Expected the bytes written to be counted");
+#endif
+
+  // the summary is written as each stage ends
+  std::ifstream file(tile_dir + "/profile.json");
+  std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (json != profile.ToJson() || json.find(R"("stage":"parse")") == std::string::npos)
+    throw std::runtime_error("Unexpected build profile: " + json);
+  boost::filesystem::remove_all(tile_dir);
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("util_mjolnir");
+
+  suite.test(TEST_CASE(scheduler_order));
+
+  suite.test(TEST_CASE(scheduler_threads));
+
+  suite.test(TEST_CASE(stealing_scheduler_order));
+
+  suite.test(TEST_CASE(stealing_scheduler_threads));
+
+  suite.test(TEST_CASE(dirty_tiles));
+
+  suite.test(TEST_CASE(polygon_grid));
+
+  suite.test(TEST_CASE(build_profile));
+
+  return suite.tear_down();
+}
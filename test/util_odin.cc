@@ -19,6 +19,19 @@ void test_get_locales() {
     throw std::runtime_error("Should find 'en-US' locales file");
 }
 
+void test_get_locale() {
+  // aliases share the dictionary of their language tag, which is only parsed once
+  auto en_US = get_locale("en-US");
+  if (!en_US || en_US->GetLanguageTag() != "en-US")
+    throw std::runtime_error("Should find 'en-US' locale");
+  if (get_locale("en") != en_US || get_locale("en-US") != en_US)
+    throw std::runtime_error("Should get the same 'en-US' dictionary for its alias");
+  if (get_locale("xx-XX") || has_locale("xx-XX"))
+    throw std::runtime_error("Should not find a locale for an unknown language");
+  if (!has_locale("pirate") || !has_locale("en-US"))
+    throw std::runtime_error("Should know the locales without loading them");
+}
+
 void try_get_formatted_time(const std::string& date_time,
                             const std::string& expected_date_time,
                             const std::locale& locale) {
@@ -211,6 +224,7 @@ int main() {
 
   suite.test(TEST_CASE(test_supported_locales));
   suite.test(TEST_CASE(test_get_locales));
+  suite.test(TEST_CASE(test_get_locale));
   suite.test(TEST_CASE(test_time));
   suite.test(TEST_CASE(test_date));
 
@@ -536,6 +536,84 @@ void TestTopKSearch() {
   }
 }
 
+void test_online_viterbi_search(const std::vector<Column>& columns) {
+  ViterbiSearch offline;
+  offline.set_emission_cost_model(EmissionCostModel(columns));
+  offline.set_transition_cost_model(TransitionCostModel(columns));
+  AddColumns(offline, columns);
+  std::vector<StateId> expected;
+  if (!columns.empty()) {
+    std::copy(offline.SearchPath(columns.size() - 1), offline.PathEnd(),
+              std::back_inserter(expected));
+    std::reverse(expected.begin(), expected.end());
+  }
+
+  // Add the columns one at a time keeping the path up to where it converged
+  ViterbiSearch online;
+  online.set_emission_cost_model(EmissionCostModel(columns));
+  online.set_transition_cost_model(TransitionCostModel(columns));
+  std::vector<StateId> path;
+  size_t max_window = 0;
+  for (StateId::Time time = 0; time < columns.size(); ++time) {
+    for (uint32_t idx = 0; idx < columns[time].size(); ++idx) {
+      online.AddStateId(StateId(time, idx));
+    }
+    online.SearchWinner(time);
+    const auto converged = online.ConvergedTime();
+    if (converged == kInvalidTime || converged <= path.size()) {
+      max_window = std::max<size_t>(max_window, time + 1 - online.first_time());
+      continue;
+    }
+    std::vector<StateId> tail;
+    for (auto it = online.SearchPath(time); it != online.PathEnd(); ++it) {
+      if (it.time() < converged) {
+        tail.push_back(*it);
+      }
+    }
+    std::copy(tail.rbegin() + (path.size() - online.first_time()), tail.rend(),
+              std::back_inserter(path));
+    online.Forget(converged - 1);
+    max_window = std::max<size_t>(max_window, time + 1 - online.first_time());
+  }
+
+  // The rest of the path is final once there are no more columns
+  if (!columns.empty()) {
+    std::vector<StateId> tail;
+    std::copy(online.SearchPath(columns.size() - 1), online.PathEnd(), std::back_inserter(tail));
+    std::copy(tail.rbegin() + (path.size() - online.first_time()), tail.rend(),
+              std::back_inserter(path));
+  }
+
+  test::assert_bool(path == expected, "the online path should be the offline path");
+  test::assert_bool(columns.size() < 10 || max_window < columns.size(),
+                    "the online search should have forgotten some of the columns");
+}
+
+void TestOnlineViterbiSearch() {
+  for (size_t count : {0, 1, 2, 10, 1000}) {
+    const auto& columns = generate_columns(
+        // transition costs
+        std::uniform_int_distribution<int>(0, 50),
+        // emission costs
+        std::uniform_int_distribution<int>(0, 100),
+        generate_column_counts(count,
+                               // column sizes
+                               std::uniform_int_distribution<size_t>(1, 10)));
+    test_online_viterbi_search(columns);
+  }
+
+  // with breakages where no state of a column can be reached
+  const auto& columns = generate_columns(
+      // transition costs
+      std::uniform_int_distribution<int>(-10, 50),
+      // emission costs
+      std::uniform_int_distribution<int>(-10, 100),
+      generate_column_counts(1000,
+                             // column sizes
+                             std::uniform_int_distribution<size_t>(0, 10)));
+  test_online_viterbi_search(columns);
+}
+
 int main(int argc, char* argv[]) {
   test::suite suite("viterbi search & topk search");
 
@@ -543,5 +621,7 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(TestTopKSearch));
 
+  suite.test(TEST_CASE(TestOnlineViterbiSearch));
+
   return suite.tear_down();
 }
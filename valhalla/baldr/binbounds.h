@@ -0,0 +1,87 @@
+#ifndef VALHALLA_BALDR_BINBOUNDS_H_
+#define VALHALLA_BALDR_BINBOUNDS_H_
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Bin bounds are kept in units of this many degrees from the south west corner of their bin
+constexpr double kBinBoundsPrecision = 1e-5;
+// Units the bounds are widened by to cover rounding of the corner and of the shape points
+constexpr int32_t kBinBoundsMargin = 2;
+
+/**
+ * The bounding box of the shape of one edge in a bin. A tile can keep one of these next to every
+ * edge id in its bins so a search can tell whether an edge could be any closer than what it has
+ * found already without ever getting at its tile or decoding its shape. The box is quantized
+ * relative to the corner of the bin and always contains the whole shape. Shapes which go too far
+ * outside of the bin to be quantized, or empty boxes, get an unbounded box.
+ */
+struct BinBounds {
+  int16_t minx; // Minimum longitude
+  int16_t miny; // Minimum latitude
+  int16_t maxx; // Maximum longitude
+  int16_t maxy; // Maximum latitude
+
+  BinBounds() = default;
+
+  /**
+   * Quantizes the bounding box of an edge shape, rounding outwards.
+   * @param  box     Bounding box of the shape.
+   * @param  corner  South west corner of the bin.
+   */
+  BinBounds(const midgard::AABB2<midgard::PointLL>& box, const midgard::PointLL& corner) {
+    auto quantize = [](const double degrees, const int32_t margin) -> int32_t {
+      auto units = degrees / kBinBoundsPrecision;
+      return static_cast<int32_t>(margin < 0 ? std::floor(units) : std::ceil(units)) + margin;
+    };
+    int32_t x0 = quantize(double(box.minx()) - corner.lng(), -kBinBoundsMargin);
+    int32_t y0 = quantize(double(box.miny()) - corner.lat(), -kBinBoundsMargin);
+    int32_t x1 = quantize(double(box.maxx()) - corner.lng(), kBinBoundsMargin);
+    int32_t y1 = quantize(double(box.maxy()) - corner.lat(), kBinBoundsMargin);
+    auto fits = [](const int32_t units) {
+      return units >= std::numeric_limits<int16_t>::min() &&
+             units <= std::numeric_limits<int16_t>::max();
+    };
+    if (x0 <= x1 && y0 <= y1 && fits(x0) && fits(y0) && fits(x1) && fits(y1)) {
+      minx = x0;
+      miny = y0;
+      maxx = x1;
+      maxy = y1;
+    } else {
+      minx = miny = std::numeric_limits<int16_t>::max();
+      maxx = maxy = std::numeric_limits<int16_t>::min();
+    }
+  }
+
+  /**
+   * Does the box bound the shape, shapes too far outside of the bin have unbounded boxes.
+   * @return  Returns false if nothing is known about where the shape is.
+   */
+  bool bounded() const {
+    return minx <= maxx && miny <= maxy;
+  }
+
+  /**
+   * Gets the box in degrees.
+   * @param  corner  South west corner of the bin.
+   * @return  Returns the bounding box, only meaningful if the box is bounded.
+   */
+  midgard::AABB2<midgard::PointLL> box(const midgard::PointLL& corner) const {
+    return midgard::AABB2<midgard::PointLL>(corner.lng() + minx * kBinBoundsPrecision,
+                                            corner.lat() + miny * kBinBoundsPrecision,
+                                            corner.lng() + maxx * kBinBoundsPrecision,
+                                            corner.lat() + maxy * kBinBoundsPrecision);
+  }
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_BINBOUNDS_H_
@@ -0,0 +1,101 @@
+#ifndef VALHALLA_BALDR_CELLPARTITION_H_
+#define VALHALLA_BALDR_CELLPARTITION_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t kInvalidCellIndex = 0xffffffff;
+
+/**
+ * An edge of the graph a cell partition is over. Either a directed edge of the routing graph
+ * or a transition between hierarchy levels (edgeid invalid).
+ */
+struct PartitionEdge {
+  uint64_t edgeid; // Directed edge, kInvalidGraphId for a transition
+  uint32_t from;   // Index of the start node
+  uint32_t to;     // Index of the end node
+};
+
+/**
+ * Multilevel partition of the routing graph into cells for customizable route planning, built
+ * by mjolnir. The cells of the lowest level are squares of a grid finer than the local tiles and
+ * every level up merges 2x2 cells of the level below, so the cells of a level nest in those of
+ * the next. The nodes of a cell with an edge to or from another cell of the level are its
+ * boundary nodes.
+ *
+ * The partition only knows the topology of the graph. A customization costs its edges for one
+ * set of costing options and finds the costs between the boundary nodes of every cell, see
+ * thor::CellOverlay. The partition is kept in a file next to the routing tiles.
+ */
+class CellPartition {
+public:
+  /**
+   * Returns the location of the partition within a tile directory.
+   * @param  tile_dir  Tile directory.
+   * @return Returns the file name.
+   */
+  static std::string file_name(const std::string& tile_dir);
+
+  /**
+   * Loads a partition file.
+   * @param  file  File to load.
+   * @return Returns the partition, nullptr if the file does not exist or is invalid.
+   */
+  static std::shared_ptr<const CellPartition> load(const std::string& file);
+
+  /**
+   * Writes the partition to a file.
+   * @param  file  File to write.
+   */
+  void write(const std::string& file) const;
+
+  /**
+   * Returns the node index of a graph node.
+   * @param  node  Graph node.
+   * @return Returns the node index or kInvalidCellIndex if it is not in the partition.
+   */
+  uint32_t node_index(const GraphId& node) const;
+
+  /**
+   * Sorts the edges by their start node and finds the boundary nodes of the cells of every
+   * level. Loading does this, a partition made in memory has to do it before it is used.
+   */
+  void Finish();
+
+  /**
+   * Returns the number of levels of cells.
+   * @return Returns the levels.
+   */
+  uint32_t levels() const {
+    return cells.size();
+  }
+
+  // Node GraphIds, sorted
+  std::vector<uint64_t> nodes;
+
+  // Per level, the cell every node is in
+  std::vector<std::vector<uint32_t>> cells;
+
+  // Every edge of the graph and, once finished, where those of each node start (one more entry
+  // than nodes)
+  std::vector<PartitionEdge> edges;
+  std::vector<uint32_t> offsets;
+
+  // Per level, the boundary nodes of each cell keyed by the cell, and the index of every node
+  // among the boundary nodes of its cell (kInvalidCellIndex if it is not one). Found by Finish
+  std::vector<std::unordered_map<uint32_t, std::vector<uint32_t>>> boundaries;
+  std::vector<std::vector<uint32_t>> boundary_index;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CELLPARTITION_H_
@@ -0,0 +1,96 @@
+#ifndef VALHALLA_BALDR_CHGRAPH_H_
+#define VALHALLA_BALDR_CHGRAPH_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t kInvalidCHIndex = 0xffffffff;
+
+/**
+ * An edge of a contraction hierarchy. Either an edge of the routing graph
+ * (edgeid is valid), a transition between hierarchy levels (edgeid invalid
+ * and no children) or a shortcut that replaces the two edges child1 and
+ * child2 around a contracted node.
+ */
+struct CHEdge {
+  uint64_t edgeid; // Directed edge represented by this edge
+  uint32_t from;   // Index of the start node
+  uint32_t to;     // Index of the end node
+  float cost;      // Cost of the edge (or of the edges it replaces)
+  float secs;      // Elapsed time in seconds
+  float length;    // Length in meters
+  uint32_t child1; // Shortcuts: index of the first edge replaced
+  uint32_t child2; // Shortcuts: index of the second edge replaced
+
+  bool is_shortcut() const {
+    return child1 != kInvalidCHIndex;
+  }
+};
+
+/**
+ * Contraction hierarchy built by mjolnir for one costing (auto, bicycle or
+ * pedestrian) with its default options. Nodes are routing graph nodes (all
+ * hierarchy levels) ordered by their GraphId, each node lists the edges going
+ * up the hierarchy from it (searched by the forward search) and the edges
+ * coming down the hierarchy into it (searched, in reverse, by the backward
+ * search). The graph is kept in a file per costing next to the routing tiles.
+ */
+class CHGraph {
+public:
+  /**
+   * Returns the location of the contraction hierarchy of a costing within a tile directory.
+   * @param  tile_dir  Tile directory.
+   * @param  costing   Name of the costing the hierarchy is built for.
+   * @return Returns the file name.
+   */
+  static std::string file_name(const std::string& tile_dir, const std::string& costing = "auto");
+
+  /**
+   * Loads a contraction hierarchy file.
+   * @param  file  File to load.
+   * @return Returns the graph, nullptr if the file does not exist or is invalid.
+   */
+  static std::shared_ptr<const CHGraph> load(const std::string& file);
+
+  /**
+   * Writes the contraction hierarchy to a file.
+   * @param  file  File to write.
+   */
+  void write(const std::string& file) const;
+
+  /**
+   * Returns the node index of a graph node.
+   * @param  node  Graph node.
+   * @return Returns the node index or kInvalidCHIndex if it is not in the hierarchy.
+   */
+  uint32_t node_index(const GraphId& node) const;
+
+  // Serialized options of the costing the hierarchy was built for
+  std::string costing_options;
+
+  // Node GraphIds (sorted) and their rank in the contraction order
+  std::vector<uint64_t> nodes;
+  std::vector<uint32_t> ranks;
+
+  // Every edge of the hierarchy, shortcuts refer to their children by index
+  std::vector<CHEdge> edges;
+
+  // Per node, indexes into edges of its upward edges (up_offsets has one
+  // more entry than nodes) and of the downward edges ending at it
+  std::vector<uint32_t> up_offsets;
+  std::vector<uint32_t> up_edges;
+  std::vector<uint32_t> down_offsets;
+  std::vector<uint32_t> down_edges;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CHGRAPH_H_
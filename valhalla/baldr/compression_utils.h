@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <functional>
+#include <string>
+#include <vector>
 #include <zlib.h>
 
 namespace valhalla {
@@ -26,5 +29,45 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
 bool inflate(const std::function<void(z_stream&)>& src_func,
              const std::function<int(z_stream&)>& dst_func);
 
+/* Deflates a buffer with gzip or zlib wrapper. Like the rest of these functions it reuses the
+ * zlib state of the calling thread instead of allocating a new one for every call
+ * @param src       the data to deflate
+ * @param src_size  how many bytes of data there are
+ * @param dst       where to write the deflated data, it is resized to fit it
+ * @param level     what compression level to use
+ * @param gzip      whether or not to write a gzip header instead of a zlib one
+ * @return          returns true if the data was successfully deflated, false otherwise
+ */
+bool deflate(const char* src,
+             size_t src_size,
+             std::string& dst,
+             int level = Z_BEST_COMPRESSION,
+             bool gzip = true);
+
+/* Inflates a gzip or zlib wrapped deflated buffer into a buffer of known size
+ * @param src       the deflated data
+ * @param src_size  how many bytes of deflated data there are
+ * @param dst       where to write the inflated data
+ * @param dst_size  how many bytes dst holds, set to how many bytes were inflated
+ * @return          returns true if the data was successfully inflated and fit, false otherwise
+ */
+bool inflate(const char* src, size_t src_size, char* dst, size_t& dst_size);
+
+/* Inflates a gzip or zlib wrapped deflated buffer into a growing buffer
+ * @param src       the deflated data
+ * @param src_size  how many bytes of deflated data there are
+ * @param dst       where to write the inflated data, it is resized to fit it
+ * @return          returns true if the data was successfully inflated, false otherwise
+ */
+bool inflate(const char* src, size_t src_size, std::vector<char>& dst);
+
+/* Gets the inflated size gzip records at the end of a gzipped buffer, so that it can be inflated
+ * without growing the buffer it is written to
+ * @param src       the gzipped data
+ * @param src_size  how many bytes of gzipped data there are
+ * @return          returns the inflated size or 0 if the data has no gzip header
+ */
+size_t gzip_size(const char* src, size_t src_size);
+
 } // namespace baldr
 } // namespace valhalla
\ No newline at end of file
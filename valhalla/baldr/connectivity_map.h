@@ -1,9 +1,12 @@
 #ifndef VALHALLA_BALDR_CONNECTIVITY_MAP_H_
 #define VALHALLA_BALDR_CONNECTIVITY_MAP_H_
 
+#include <valhalla/baldr/json.h>
 #include <valhalla/baldr/pathlocation.h>
 
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -14,10 +17,29 @@ namespace baldr {
 class connectivity_map_t {
 public:
   /**
-   * Constructs the connectivity map
-   * @param pt   the ptree sub child labeled mjolnir in the valhalla json config
+   * Constructs the connectivity map. If the config names a connectivity_file written by
+   * valhalla_build_connectivity it is loaded from there, otherwise it is computed from the tiles
+   * @param pt    the ptree sub child labeled mjolnir in the valhalla json config
+   * @param load  whether to use the connectivity file if there is one or always compute it
    */
-  connectivity_map_t(const boost::property_tree::ptree& pt);
+  connectivity_map_t(const boost::property_tree::ptree& pt, bool load = true);
+
+  /**
+   * Returns the connectivity map of the tiles of the config, made by the first caller and shared
+   * by the rest of the process instead of each loki worker coloring the tiles again. Worker
+   * processes forked after it is made share its memory as well
+   * @param pt  the ptree sub child labeled mjolnir in the valhalla json config
+   * @return    the connectivity map shared by the process
+   */
+  static std::shared_ptr<const connectivity_map_t> Global(const boost::property_tree::ptree& pt);
+
+  /**
+   * Writes the connectivity map to a file that later constructions can load instead of going
+   * over all of the tiles again
+   *
+   * @param file_name  the file to write
+   */
+  void save(const std::string& file_name) const;
 
   /**
    * Returns the color for the given graphid
@@ -65,10 +87,29 @@ public:
   }
 
 private:
+  /**
+   * Fills the colors from a file written by save
+   *
+   * @param file_name  the file to read
+   * @return true if the file was there and valid
+   */
+  bool load_file(const std::string& file_name);
+
   uint32_t transit_level;
   // this is a map(tile_level, map(tile_id, tile_color))
   std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> colors;
 };
+
+/**
+ * Returns geojson with a square per tile, drawn like the regions of the connectivity map, for
+ * coloring tiles by something other than their connectivity
+ *
+ * @param hierarchy_level  the hierarchy level the tiles are on
+ * @param properties       the properties of the feature of each tile, by tile id
+ * @return string          the geojson
+ */
+std::string tiles_to_geojson(const uint32_t hierarchy_level,
+                             const std::unordered_map<uint32_t, json::MapPtr>& properties);
 } // namespace baldr
 } // namespace valhalla
 
@@ -1048,6 +1048,25 @@ public:
     return bss_connection_;
   }
 
+  /**
+   * Set the size class of the strongly connected components the nodes at the ends of this edge
+   * are in, within the graph one of the labeled access modes can use.
+   * @param  mode             Index of the access mode in kComponentAccess.
+   * @param  component_class  Size class, the smaller of the 2 components.
+   */
+  void set_component_class(const uint32_t mode, const uint32_t component_class);
+
+  /**
+   * Get the size class of the strongly connected components the nodes at the ends of this edge
+   * are in, within the graph one of the labeled access modes can use. An edge the mode can get
+   * onto has at least kComponentClassSizes[class] nodes of reach in both directions.
+   * @param  mode  Index of the access mode in kComponentAccess.
+   * @return  Returns the size class, 0 if it is unknown.
+   */
+  uint32_t component_class(const uint32_t mode) const {
+    return (components_ >> (mode * 3)) & kMaxComponentClass;
+  }
+
   /**
    * Create a json object representing this edge
    * @return  Returns the json object
@@ -1111,7 +1130,7 @@ protected:
   uint64_t seasonal_ : 1;       // Seasonal access (ex. no access in winter)
   uint64_t deadend_ : 1;        // Leads to a dead-end (no other driveable roads) TODO
   uint64_t bss_connection_ : 1; // Does this lead to(come out from) a bike share station?
-  uint64_t spare4_ : 9;
+  uint64_t components_ : 9;     // Component size class per mode (see kComponentAccess)
 
   // 5th 8-byte word
   uint64_t turntype_ : 24;      // Turn type (see graphconstants.h)
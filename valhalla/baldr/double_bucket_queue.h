@@ -4,19 +4,13 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/midgard/util.h>
 #include <vector>
 
 namespace valhalla {
 namespace baldr {
 
-constexpr uint32_t kInvalidLabel = std::numeric_limits<uint32_t>::max();
-
-/**
- * A callable element which returns the cost for a label.
- */
-using LabelCost = std::function<float(const uint32_t label)>;
-
 // Bucket type and bucket list type.
 using bucket_t = std::vector<uint32_t>;
 using buckets_t = std::vector<bucket_t>;
@@ -28,7 +22,7 @@ using buckets_t = std::vector<bucket_t>;
  * into the overflow bucket and are moved into the low-level buckets as
  * needed. Each bucket stores label indexes into external data.
  */
-class DoubleBucketQueue {
+class DoubleBucketQueue final : public LabelQueue {
 public:
   /**
    * Constructor given a minimum cost, a range of costs held within the
@@ -44,7 +38,27 @@ public:
   DoubleBucketQueue(const float mincost,
                     const float range,
                     const uint32_t bucketsize,
-                    const LabelCost& labelcost) {
+                    const LabelCost& labelcost)
+      : mincost_(0.0f), currentcost_(0.0f), currentbucket_(buckets_.end()) {
+    reuse(mincost, range, bucketsize, labelcost);
+  }
+
+  /**
+   * Reinitializes the queue for a new search given a minimum cost, a range
+   * of costs held within the bucket sort, and a bucket size. Any labels still
+   * in the queue are removed. The low-level buckets are kept so the memory
+   * they have grown to is reused rather than allocated again for each search.
+   * @param mincost    Minimum cost. Used to create the initial range for
+   *                   bucket sorting.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   *                   Must be an integer value.
+   * @param labelcost  Functor to get a cost given a label index.
+   */
+  void reuse(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const LabelCost& labelcost) override {
     // We need at least a bucketsize of 1 or more
     if (bucketsize < 1) {
       throw std::runtime_error("Bucketsize must be 1 or greater");
@@ -55,6 +69,10 @@ public:
       throw std::runtime_error("Bucketrange must be greater than 0");
     }
 
+    // Remove anything left over from a previous search
+    clear();
+    stats_ = {};
+
     // Adjust min cost to be the start of a bucket
     uint32_t c = static_cast<uint32_t>(mincost);
     currentcost_ = (c - (c % bucketsize));
@@ -84,10 +102,18 @@ public:
     clear();
   }
 
+  /**
+   * Returns the kind of queue.
+   * @return  Returns LabelQueueType::kDoubleBucket.
+   */
+  LabelQueueType type() const override {
+    return LabelQueueType::kDoubleBucket;
+  }
+
   /**
    * Clear all labels from the low-level buckets and the overflow buckets.
    */
-  void clear() {
+  void clear() override {
     // Empty the overflow bucket and each bucket
     overflowbucket_.clear();
     while (currentbucket_ != buckets_.end()) {
@@ -107,8 +133,9 @@ public:
    * cost then the label is placed in the current bucket to prevent underflow.
    * @param   label  Label index to add to the queue.
    */
-  void add(const uint32_t label) {
+  void add(const uint32_t label) override {
     get_bucket(labelcost_(label)).push_back(label);
+    ++stats_.added;
   }
 
   /**
@@ -118,11 +145,12 @@ public:
    * @param  label        Label index to reorder.
    * @param  newcost      New sort cost.
    */
-  void decrease(const uint32_t label, const float newcost) {
+  void decrease(const uint32_t label, const float newcost) override {
     // Get the buckets of the previous and new costs. Nothing needs to be done
     // if old cost and the new cost are in the same buckets.
     bucket_t& prevbucket = get_bucket(labelcost_(label));
     bucket_t& newbucket = get_bucket(newcost);
+    ++stats_.decreased;
     if (prevbucket != newbucket) {
       // Add label to newbucket and remove from previous bucket
       newbucket.push_back(label);
@@ -135,7 +163,7 @@ public:
    * @return  Returns the label index of the lowest cost label. Returns
    *          kInvalidLabel if the buckets are empty.
    */
-  uint32_t pop() {
+  uint32_t pop() override {
     if (empty()) {
       // No labels found in the low-level buckets.
       if (overflowbucket_.empty()) {
@@ -157,6 +185,7 @@ public:
     // Return label from lowest non-empty bucket
     uint32_t label = currentbucket_->back();
     currentbucket_->pop_back();
+    ++stats_.popped;
     return label;
   }
 
@@ -217,6 +246,7 @@ private:
 
     // If there is actually stuff to move
     if (itr != overflowbucket_.end()) {
+      ++stats_.rebuilds;
 
       // Adjust cost range so smallest element is in the buckets_
       float min = labelcost_(*itr);
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <iostream>
 #include <ostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,9 @@ constexpr float kElevationBinSize = 2.0f;
 constexpr float kMinElevation = -500.0f;
 constexpr float kMaxElevation = kMinElevation + (kElevationBinSize * kMaxStoredElevation);
 
+// Elevation profiles along the shape are stored with decimeter precision
+constexpr float kElevationProfilePrecision = 0.1f;
+
 // Name information. Information about names added to the names list within
 // the tile. A name can have a textual representation followed by optional
 // fields that provide additional information about the name.
@@ -146,6 +150,27 @@ public:
    */
   std::vector<std::pair<std::string, bool>> GetNamesAndTypes() const;
 
+  /**
+   * Visit the names of an edge without copying them out of the tile. The visitor is called with
+   * each name, as a pointer into the text list of the tile that stays valid as long as the tile
+   * does, and its route number flag.
+   * @param  visitor  Callable as visitor(const char* name, bool is_route_number).
+   */
+  template <class Visitor> void ForEachName(Visitor&& visitor) const {
+    const NameInfo* ni = name_info_list_;
+    for (uint32_t i = 0; i < name_count(); i++, ni++) {
+      // Skip any tagged names (FUTURE code may make use of them)
+      if (ni->tagged_) {
+        continue;
+      }
+      if (ni->name_offset_ < names_list_length_) {
+        visitor(names_list_ + ni->name_offset_, static_cast<bool>(ni->is_route_num_));
+      } else {
+        throw std::runtime_error("ForEachName: offset exceeds size of text list");
+      }
+    }
+  }
+
   /**
    * Convenience method to get the types for the names.
    * @return   Returns types - If a bit is set, it is a route number.
@@ -159,6 +184,11 @@ public:
    */
   const std::vector<midgard::PointLL>& shape() const;
 
+  /**
+   * Get a decoder over the shape of the edge. It decodes the points as they are popped or
+   * iterated over instead of decoding them all into a vector, so it never allocates.
+   * @return  Returns the shape decoder, iterable with a range based for loop.
+   */
   midgard::Shape7Decoder<midgard::PointLL> lazy_shape() const {
     return midgard::Shape7Decoder<midgard::PointLL>(encoded_shape_, item_->encoded_shape_size);
   }
@@ -169,6 +199,21 @@ public:
    */
   std::string encoded_shape() const;
 
+  /**
+   * Get the elevation profile of the edge if the tiles were built with one. The samples are
+   * spaced evenly from the start to the end of the shape.
+   * @return  Returns the elevations in meters, empty if this edge has no profile.
+   */
+  std::vector<float> elevation_profile() const;
+
+  /**
+   * Returns the encoded elevation profile, the zig zag varint encoded deltas of the samples.
+   * @return  Returns the encoded profile, empty if this edge has no profile.
+   */
+  std::string encoded_elevation_profile() const {
+    return std::string(encoded_elevation_, encoded_elevation_size_);
+  }
+
   /**
    * Returns json representing this object
    * @return json object
@@ -181,8 +226,9 @@ public:
   struct PackedItem {
     uint32_t name_count : 4;
     uint32_t encoded_shape_size : 16;
-    uint32_t reserved : 5; // Reserved for use by forks of Valhalla
-    uint32_t spare : 7;
+    uint32_t reserved : 5;              // Reserved for use by forks of Valhalla
+    uint32_t has_elevation_profile : 1; // An elevation profile follows the shape
+    uint32_t spare : 6;
   };
 
 protected:
@@ -208,6 +254,10 @@ protected:
   // The encoded shape of the edge
   const char* encoded_shape_;
 
+  // The encoded elevation profile of the edge and its size
+  const char* encoded_elevation_;
+  uint32_t encoded_elevation_size_;
+
   // Lng, lat shape of the edge
   mutable std::vector<midgard::PointLL> shape_;
 
@@ -1,6 +1,7 @@
 #ifndef VALHALLA_BALDR_EDGE_TRACKER_H_
 #define VALHALLA_BALDR_EDGE_TRACKER_H_
 
+#include <atomic>
 #include <cstdint>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
@@ -37,6 +38,40 @@ protected:
   }
 };
 
+// the same as bitset_t except that several threads can set and get bits at once
+struct atomic_bitset_t {
+  typedef uint64_t value_type;
+  static const size_t bits_per_value = sizeof(value_type) * CHAR_BIT;
+
+  atomic_bitset_t(size_t size);
+  // returns true if this call set the bit, false if it was set already
+  bool set(const uint64_t id);
+  bool get(const uint64_t id) const;
+
+protected:
+  std::vector<std::atomic<value_type>> bits;
+};
+
+// keep the global number of edges encountered at the point we encounter each tile
+// this allows an edge to have a sequential global id and makes storing it very small
+template <typename TileSet>
+uint64_t index_edges(TileSet& tiles,
+                     GraphReader& reader,
+                     std::unordered_map<GraphId, uint64_t>& edges_in_tiles) {
+  uint64_t edge_count = 0;
+  for (GraphId tile_id : tiles) {
+    // TODO: just read the header, parsing the whole thing isnt worth it at this point
+    edges_in_tiles.emplace(tile_id, edge_count);
+    const auto* tile = reader.GetGraphTile(tile_id);
+    edge_count += tile->header()->directededgecount();
+    // clear the cache if it is overcommitted to avoid running out of memory.
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  return edge_count;
+}
+
 // edge tracker wraps a bitset to provide compact storage of GraphIds.
 //
 // A TileSet is used to enumerate all relevant tiles, and the range of tile IDs
@@ -60,22 +95,38 @@ private:
 };
 
 template <typename TileSet> edge_tracker edge_tracker::create(TileSet& tiles, GraphReader& reader) {
-  // keep the global number of edges encountered at the point we encounter each tile
-  // this allows an edge to have a sequential global id and makes storing it very small
-  uint64_t edge_count = 0;
   edge_tracker::edge_index_t edges_in_tiles;
-  for (GraphId tile_id : tiles) {
-    // TODO: just read the header, parsing the whole thing isnt worth it at this point
-    edges_in_tiles.emplace(tile_id, edge_count);
-    const auto* tile = reader.GetGraphTile(tile_id);
-    edge_count += tile->header()->directededgecount();
-    // clear the cache if it is overcommitted to avoid running out of memory.
-    if (reader.OverCommitted()) {
-      reader.Trim();
-    }
+  uint64_t edge_count = index_edges(tiles, reader, edges_in_tiles);
+  return edge_tracker(std::move(edges_in_tiles), edge_count);
+}
+
+// the same as edge_tracker for threads that work on the same graph at once. the bits of the edges
+// of a tile are next to each other so threads working on different tiles rarely share a word
+struct concurrent_edge_tracker {
+  typedef edge_tracker::edge_index_t edge_index_t;
+
+  template <typename TileSet>
+  static concurrent_edge_tracker create(TileSet& tiles, GraphReader& reader);
+
+  bool get(const GraphId& edge_id) const;
+  // returns true if this call marked the edge, false if it was marked already
+  bool set(const GraphId& edge_id);
+
+  // the index is not changed once made so every thread can read it
+  edge_index_t m_edges_in_tiles;
+  atomic_bitset_t m_edge_set;
+
+private:
+  concurrent_edge_tracker(edge_index_t&& edges, size_t n)
+      : m_edges_in_tiles(std::move(edges)), m_edge_set(n) {
   }
+};
 
-  return edge_tracker(std::move(edges_in_tiles), edge_count);
+template <typename TileSet>
+concurrent_edge_tracker concurrent_edge_tracker::create(TileSet& tiles, GraphReader& reader) {
+  concurrent_edge_tracker::edge_index_t edges_in_tiles;
+  uint64_t edge_count = index_edges(tiles, reader, edges_in_tiles);
+  return concurrent_edge_tracker(std::move(edges_in_tiles), edge_count);
 }
 
 } // namespace baldr
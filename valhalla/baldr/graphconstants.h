@@ -35,6 +35,15 @@ constexpr uint16_t kAllAccess = 4095;
 constexpr uint32_t kVehicularAccess = kAutoAccess | kTruckAccess | kMopedAccess | kMotorcycleAccess |
                                       kTaxiAccess | kBusAccess | kHOVAccess;
 
+// The access modes whose strongly connected components are labeled on the directed edges and
+// the least number of nodes a component of each size class has. Class 0 is an edge that was not
+// labeled or whose component is too small to bother with, its reach has to be expanded instead.
+constexpr uint32_t kComponentModeCount = 3;
+constexpr uint16_t kComponentAccess[kComponentModeCount] = {kAutoAccess, kPedestrianAccess,
+                                                            kBicycleAccess};
+constexpr uint32_t kComponentClassSizes[] = {0, 8, 16, 32, 64, 128, 256, 512};
+constexpr uint32_t kMaxComponentClass = 7;
+
 // Maximum number of transit records per tile and other max. transit
 // field values.
 constexpr uint32_t kMaxTransitDepartures = 16777215;
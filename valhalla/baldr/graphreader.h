@@ -1,10 +1,13 @@
 #ifndef VALHALLA_BALDR_GRAPHREADER_H_
 #define VALHALLA_BALDR_GRAPHREADER_H_
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 #include <valhalla/baldr/curler.h>
@@ -12,6 +15,7 @@
 #include <valhalla/baldr/graphtile.h>
 #include <valhalla/baldr/tilehierarchy.h>
 #include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/flat_hash.h>
 #include <valhalla/midgard/pointll.h>
 
 namespace valhalla {
@@ -55,6 +59,15 @@ public:
    */
   virtual const GraphTile* Get(const GraphId& graphid) const = 0;
 
+  /**
+   * Get a reference counted handle to a graph tile object given a GraphId.
+   * Unlike the pointer returned by Get the handle stays valid after the tile
+   * is evicted. By default the handle holds a copy which shares the tile memory.
+   * @param graphid  the graphid of the tile
+   * @return handle to the graph tile or nullptr if it is not cached
+   */
+  virtual graph_tile_ptr GetHandle(const GraphId& graphid) const;
+
   /**
    * Lets you know if the cache is too large.
    * @return true if the cache is over committed with respect to the limit
@@ -71,6 +84,15 @@ public:
    *  Some implementations may simply clear the entire cache
    */
   virtual void Trim() = 0;
+
+  /**
+   * Lets you know if several threads can use the cache at once and keep
+   * using the tiles it handed out.
+   * @return true if the cache synchronizes access on its own
+   */
+  virtual bool IsThreadSafe() const {
+    return false;
+  }
 };
 
 /**
@@ -247,6 +269,218 @@ protected:
   size_t max_cache_size_;
 };
 
+/**
+ * Tile cache which admits tiles by how often they were asked for, in the manner of W-TinyLFU.
+ * New tiles go to a small window kept in LRU order. When the window is full its oldest tile has
+ * to win a place in the main cache against the main cache's least recently used tile: the one
+ * asked for less often according to a compact frequency sketch is evicted. A scan of tiles that
+ * are asked for once, like a large isochrone, so only churns the window and leaves the tiles
+ * asked for over and over alone.
+ * It is NOT thread-safe!
+ */
+class TileCacheTinyLFU : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param mem_control  strategy our cache will use to control its memory
+   */
+  TileCacheTinyLFU(size_t max_size, TileCacheLRU::MemoryLimitControl mem_control);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items and sizes the frequency
+   * sketch after the number of items.
+   * @param tile_size approximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the window of the cache.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  const GraphTile* Put(const GraphId& graphid, const GraphTile& tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId, counting the request in the sketch
+   * whether or not the tile is cached.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  const GraphTile* Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache, the frequencies are kept.
+   */
+  void Clear() override;
+
+  /**
+   * Evicts tiles until the cache is within its limit, admitting tiles from the window to the
+   * main cache by their frequency.
+   */
+  void Trim() override;
+
+  /**
+   * Get how often a tile was asked for lately, as estimated by the sketch.
+   * @param graphid  the graphid of the tile
+   * @return the estimated frequency, at most 15
+   */
+  uint8_t Frequency(const GraphId& graphid) const;
+
+protected:
+  struct KeyValue {
+    GraphId id;
+    GraphTile tile;
+    size_t size;
+  };
+  using KeyValueList = std::list<KeyValue>;
+  using KeyValueIter = KeyValueList::iterator;
+
+  // Where a cached tile is
+  struct Slot {
+    bool main;
+    KeyValueIter entry;
+  };
+
+  /**
+   * Evicts tiles until required_size in bytes is free in the cache.
+   * @param  required_size   size in bytes that should be free in the cache
+   */
+  void TrimToFit(const size_t required_size);
+
+  /**
+   * Evicts the least recently used tile of a list.
+   * @param  list  the window or the main cache
+   */
+  void Evict(KeyValueList& list);
+
+  /**
+   * Counts a request for a tile in the sketch, halving every count once enough were counted so
+   * that the frequencies follow what is asked for lately.
+   * @param graphid  the graphid of the tile
+   */
+  void Increment(const GraphId& graphid) const;
+
+  std::unordered_map<GraphId, Slot> cache_;
+
+  // The window and the main cache, most recently used first
+  mutable KeyValueList window_;
+  mutable KeyValueList main_;
+
+  // Count-min sketch of 4 bit counters, 4 per tile
+  mutable std::vector<uint8_t> sketch_;
+  mutable size_t additions_;
+  size_t sample_size_;
+
+  TileCacheLRU::MemoryLimitControl mem_control_;
+  size_t window_size_;
+  size_t main_size_;
+  size_t max_window_size_;
+  size_t max_cache_size_;
+};
+
+/**
+ * Tile cache that pins the tiles of some hierarchy levels, by default the highway and arterial
+ * levels every long route goes through, so that a burst of local tiles cannot evict them. Tiles
+ * of the pinned levels are kept until the cache is cleared, within a budget of their own. The
+ * rest of the tiles, and pinned tiles once that budget is spent, go to another cache which
+ * evicts and trims them as usual.
+ * It is NOT thread-safe!
+ */
+class PinningTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param pinned_levels  the levels whose tiles are pinned
+   * @param pinned_size    maximum size of the pinned tiles
+   * @param others         cache of the tiles which are not pinned
+   */
+  PinningTileCache(const std::vector<uint8_t>& pinned_levels,
+                   size_t pinned_size,
+                   std::unique_ptr<TileCache>&& others);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache, pinned if its level is and there is room for it.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  const GraphTile* Put(const GraphId& graphid, const GraphTile& tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  const GraphTile* Get(const GraphId& graphid) const override;
+
+  /**
+   * Get a reference counted handle to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return handle to the graph tile or nullptr if it is not cached
+   */
+  graph_tile_ptr GetHandle(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache of the tiles which are not pinned is too large.
+   * @return true if it is over committed with respect to its limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache, pinned tiles included.
+   */
+  void Clear() override;
+
+  /**
+   * Trims the tiles which are not pinned.
+   */
+  void Trim() override;
+
+  /**
+   * Get the size of the pinned tiles.
+   * @return bytes of the pinned tiles
+   */
+  size_t pinned_size() const {
+    return pinned_size_;
+  }
+
+protected:
+  // Whether the tiles of a level are pinned, by level
+  std::vector<bool> pinned_levels_;
+  std::unordered_map<GraphId, GraphTile> pinned_;
+  size_t pinned_size_;
+  size_t max_pinned_size_;
+  std::unique_ptr<TileCache> others_;
+};
+
 /**
  * TileCache wrapper synchronized using external mutex.
  * It is thread-safe.
@@ -287,6 +521,13 @@ public:
    */
   const GraphTile* Get(const GraphId& graphid) const override;
 
+  /**
+   * Get a reference counted handle to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return handle to the graph tile or nullptr if it is not cached
+   */
+  graph_tile_ptr GetHandle(const GraphId& graphid) const override;
+
   /**
    * Lets you know if the cache is too large.
    * @return true if the cache is over committed with respect to the limit
@@ -309,6 +550,138 @@ private:
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Thread-safe tile cache meant to be shared by many readers at once. Tiles are split into shards
+ * by their tile value and each shard has its own mutex which is only taken when tiles are added
+ * or evicted. Lookups never lock, they go straight to a slot directly indexed by the tile value.
+ * Copies of the cache share the same underlying storage.
+ * Like the other caches, tile pointers handed out are invalidated by Clear and Trim, use
+ * GetHandle to keep a tile alive across evictions.
+ */
+class ShardedTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param shard_count  number of shards, rounded up to the next power of 2
+   */
+  ShardedTileCache(size_t max_size, size_t shard_count);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache. If another thread already put the
+   * same tile the existing copy is kept and returned.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  const GraphTile* Put(const GraphId& graphid, const GraphTile& tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  const GraphTile* Get(const GraphId& graphid) const override;
+
+  /**
+   * Get a reference counted handle to a graph tile object given a GraphId.
+   * The handle shares ownership with the cache so no copy is made.
+   * @param graphid  the graphid of the tile
+   * @return handle to the graph tile or nullptr if it is not cached
+   */
+  graph_tile_ptr GetHandle(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   * Evicts tiles until the cache is back within its limit. Tiles which have not been
+   * read since the last trim go first (clock/second chance), the rest only if needed.
+   */
+  void Trim() override;
+
+  /**
+   * Lets you know if several threads can use the cache at once.
+   * @return true, lookups are lock free and each shard synchronizes its writers
+   */
+  bool IsThreadSafe() const override {
+    return true;
+  }
+
+protected:
+  // A directly indexed cache entry. The tile is owned by the shard, the slot just publishes it
+  struct slot_t {
+    std::atomic<const GraphTile*> tile;
+    mutable std::atomic<bool> referenced;
+  };
+
+  struct entry_t {
+    graph_tile_ptr tile;
+    size_t size;
+  };
+
+  // Writers of a shard serialize on its mutex, readers never touch it
+  struct shard_t {
+    std::mutex mutex;
+    std::unordered_map<uint32_t, entry_t> tiles;
+  };
+
+  struct state_t {
+    state_t(size_t max_size, size_t shard_count);
+    ~state_t();
+    // Slots are allocated in chunks on first use and live as long as the cache
+    std::unique_ptr<std::atomic<slot_t*>[]> chunks;
+    std::vector<shard_t> shards;
+    uint32_t shard_shift;
+    std::atomic<size_t> cache_size;
+    std::atomic<size_t> clock_hand;
+    size_t max_cache_size;
+  };
+
+  /**
+   * Returns the slot for a tile value or nullptr if its chunk was never allocated.
+   * @param tile_value  the tile value (level and tile id)
+   * @param allocate    whether a missing chunk should be allocated
+   */
+  slot_t* slot(uint32_t tile_value, bool allocate) const;
+
+  /**
+   * Returns the shard owning a tile value.
+   * @param tile_value  the tile value (level and tile id)
+   */
+  shard_t& shard(uint32_t tile_value) const;
+
+  /**
+   * Evicts the tiles of a shard until the cache is no longer over committed.
+   * @param shard        the shard to evict from (must be locked by the caller)
+   * @param second_pass  when false recently read tiles are spared and their read bit is reset
+   */
+  void TrimShard(shard_t& shard, bool second_pass);
+
+  std::shared_ptr<state_t> state_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -335,6 +708,11 @@ public:
    */
   GraphReader(const boost::property_tree::ptree& pt);
 
+  /**
+   * Destructor, stops the prefetch threads if there are any.
+   */
+  ~GraphReader();
+
   /**
    * Test if tile exists
    * @param  graphid  GraphId of the tile to test (tile id and level).
@@ -349,6 +727,15 @@ public:
    */
   const GraphTile* GetGraphTile(const GraphId& graphid);
 
+  /**
+   * Get a reference counted handle to a graph tile object given a GraphId. The
+   * tile is loaded if needed and, unlike the raw pointer, the handle keeps it
+   * alive even if the cache is trimmed or cleared by another thread.
+   * @param graphid  the graphid of the tile
+   * @return graph_tile_ptr handle to the graph tile or nullptr if not found
+   */
+  graph_tile_ptr GetGraphTileHandle(const GraphId& graphid);
+
   /**
    * Get a pointer to a graph tile object given a GraphId. This method also
    * supplies the current graph tile - so if the same tile is requested in
@@ -386,12 +773,77 @@ public:
   }
 
   /**
-   * Clears the cache
+   * Hints that the tiles around the given one are likely to be needed soon, for example
+   * because a search just crossed into it. The neighbors that are not farther from the point
+   * the search is heading to than the tile itself are loaded in the background (from disk or
+   * tile_url) and handed to the cache once they are asked for. Does nothing unless
+   * prefetch_threads is configured.
+   * @param graphid  a graphid within the tile the search is in
+   * @param toward   where the search is heading
+   */
+  void PrefetchNeighbors(const GraphId& graphid, const midgard::PointLL& toward) {
+    if (prefetcher_) {
+      QueueNeighbors(graphid, &toward);
+    }
+  }
+
+  /**
+   * Loads the given tiles in the background, in order, for callers that know a set of tiles
+   * they are about to use (the tiles along a route for example). With tile_url they are
+   * fetched prefetch_threads at a time. Does nothing unless prefetch_threads is configured.
+   * @param tiles  ids of tiles to load
+   */
+  void Prefetch(const std::vector<GraphId>& tiles);
+
+  /**
+   * Lets you know if tiles can be loaded in the background
+   * @return true if prefetch_threads is configured
+   */
+  bool Prefetching() const {
+    return prefetcher_ != nullptr;
+  }
+
+  /**
+   * Same as above but hints all 8 tiles around the given one, for searches that head in
+   * many directions at once.
+   * @param graphid  a graphid within the tile the search is in
    */
-  void Clear() {
-    cache_->Clear();
+  void PrefetchNeighbors(const GraphId& graphid) {
+    if (prefetcher_) {
+      QueueNeighbors(graphid, nullptr);
+    }
   }
 
+  /**
+   * Puts the tiles used most according to the tile access log in the cache, most used first.
+   * Meant to be called before a service starts taking requests so the first ones do not have
+   * to wait for the cache to fill. Stops once max_cache_size would be exceeded.
+   * @param  max_tiles  Maximum number of tiles to load, 0 loads none.
+   * @param  threads    Number of threads loading tiles at the same time.
+   * @return Returns the number of tiles put in the cache.
+   */
+  size_t Preload(size_t max_tiles, size_t threads);
+
+  // What the tile access log counted for a tile
+  struct TileAccesses {
+    uint64_t count;       // Times it was asked for
+    uint64_t misses;      // Times it was not in the cache
+    uint64_t miss_micros; // Microseconds spent loading it on those misses
+  };
+
+  /**
+   * Reads the tile access log that readers configured with tile_access_log keep, to see which
+   * tiles are hot. Counts are estimates when tile_access_log_sample_rate is above 1.
+   * @param  path  The tile access log.
+   * @return Returns what was counted for each tile, by the base id of the tile.
+   */
+  static std::unordered_map<GraphId, TileAccesses> ReadTileAccessLog(const std::string& path);
+
+  /**
+   * Clears the cache
+   */
+  void Clear();
+
   /**
    * Tries to ensure the cache footprint below allowed maximum
    * In some cases may even remove the entire cache.
@@ -400,6 +852,15 @@ public:
     cache_->Trim();
   }
 
+  /**
+   * Lets you know if several threads can use the reader at once, which is
+   * the case when its tile cache is sharded
+   * @return true if the reader is thread-safe
+   */
+  bool IsThreadSafe() const {
+    return cache_->IsThreadSafe();
+  }
+
   /**
    * Returns the maximum number of threads that can
    * use the reader concurrently without blocking
@@ -416,6 +877,55 @@ public:
     return cache_->OverCommitted();
   }
 
+  /**
+   * Number of times a tile was looked up in the cache since the reader was made. Lookups of
+   * the tile a caller already holds do not reach the cache and are not counted.
+   * @return Returns the number of lookups.
+   */
+  uint64_t tiles_fetched() const {
+    return tiles_fetched_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Number of times a tile was not in the cache and had to be loaded (or was not found) since
+   * the reader was made.
+   * @return Returns the number of cache misses.
+   */
+  uint64_t tiles_missed() const {
+    return tiles_missed_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Adds the cache lookups and misses since the last report to the metrics of the process.
+   * Workers sharing the reader can each call it after a request without counting twice.
+   */
+  void ReportMetrics();
+
+  /**
+   * Switch to the latest version of the tile extract if another one was swapped in since the
+   * reader last looked. Tiles the reader handed out before are from the version it used until
+   * now, so workers call this between requests. A version is unmapped once the last reader using
+   * it switched away from it.
+   * @return Returns true if the reader switched versions.
+   */
+  bool UpdateTileExtract();
+
+  /**
+   * Version of the tile extract the reader uses, it goes up with each swap.
+   * @return Returns the version.
+   */
+  uint64_t tile_extract_version() const;
+
+  /**
+   * Load the tile extract of the config next to the one in use and make it the latest version,
+   * which readers switch to on their next UpdateTileExtract. Readers keep working on the version
+   * they use while the new one loads, so a new extract can be deployed without restarting.
+   * @param  pt  Config of the readers, with the extract to load.
+   * @return Returns the version of the loaded extract.
+   * @throws std::runtime_error if the extract has no usable tiles, the readers then keep theirs.
+   */
+  static uint64_t SwapTileExtract(const boost::property_tree::ptree& pt);
+
   /**
    * Convenience method to get an opposing directed edge.
    * @param  edgeid  Graph Id of the directed edge.
@@ -737,24 +1247,70 @@ public:
   midgard::AABB2<midgard::PointLL> GetMinimumBoundingBox(const midgard::AABB2<midgard::PointLL>& bb);
 
 protected:
+  // A version of the (tar) extract of tiles with its copies, the reader keeps the version it uses
+  // alive until it updates to the latest one
+  struct tile_set_t;
+  std::shared_ptr<const tile_set_t> tile_set_;
+  static std::mutex latest_tile_set_lock_;
+  static std::shared_ptr<const tile_set_t> latest_tile_set_;
+  static std::atomic<uint64_t> latest_tile_set_version_;
+  static std::shared_ptr<const GraphReader::tile_set_t>
+  get_tile_set(const boost::property_tree::ptree& pt);
+
   // (Tar) extract of tiles - the contents are empty if not being used
   struct tile_extract_t;
   std::shared_ptr<const tile_extract_t> tile_extract_;
   static std::shared_ptr<const GraphReader::tile_extract_t>
   get_extract_instance(const boost::property_tree::ptree& pt);
 
+  // (Tar) extract of live traffic tiles updated in place by another process - the contents are
+  // empty if not being used
+  struct traffic_extract_t;
+  std::shared_ptr<const traffic_extract_t> traffic_extract_;
+  static std::shared_ptr<const GraphReader::traffic_extract_t>
+  get_traffic_extract_instance(const boost::property_tree::ptree& pt);
+
+  // Gives the tile its live traffic speeds if the traffic extract has them
+  void AttachTraffic(GraphTile& tile) const;
+
   // Information about where the tiles are kept
   const std::string tile_dir_;
 
+  // Whether tile files in tile_dir_ are memory mapped rather than read and how
+  const bool mmap_tiles_;
+  const bool mmap_populate_;
+  int mmap_advice_;
+
   // Stuff for getting at remote tiles
   std::unique_ptr<curler_pool_t> curlers_;
+  const std::string user_agent_;
   const std::string tile_url_;
   const bool tile_url_gz_;
 
   std::mutex _404s_lock;
-  std::unordered_set<GraphId> _404s;
+  midgard::flat_hash_set<GraphId> _404s;
 
+  const size_t max_cache_size_;
   std::unique_ptr<TileCache> cache_;
+
+  // Loads the tile from disk or the tile url, the tile has no header if neither has it
+  GraphTile LoadTile(const GraphId& base, curler_pool_t& curlers, bool& mapped);
+
+  // Background loading of tiles that searches expect to need
+  struct prefetcher_t;
+  std::unique_ptr<prefetcher_t> prefetcher_;
+  void QueueNeighbors(const GraphId& graphid, const midgard::PointLL* toward);
+
+  // How often tiles were asked for and missed, written to tile_access_log for Preload and
+  // ReadTileAccessLog to use later
+  struct access_log_t;
+  std::unique_ptr<access_log_t> access_log_;
+
+  // Counts of cache lookups and misses, several threads can share the reader
+  std::atomic<uint64_t> tiles_fetched_;
+  std::atomic<uint64_t> tiles_missed_;
+  std::atomic<uint64_t> tiles_fetched_reported_;
+  std::atomic<uint64_t> tiles_missed_reported_;
 };
 
 } // namespace baldr
@@ -4,6 +4,7 @@
 #include "filesystem.h"
 #include <valhalla/baldr/accessrestriction.h>
 #include <valhalla/baldr/admininfo.h>
+#include <valhalla/baldr/binbounds.h>
 #include <valhalla/baldr/complexrestriction.h>
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/datetime.h>
@@ -16,8 +17,11 @@
 #include <valhalla/baldr/nodeinfo.h>
 #include <valhalla/baldr/nodetransition.h>
 #include <valhalla/baldr/predictedspeeds.h>
+#include <valhalla/baldr/routingedge.h>
+#include <valhalla/baldr/shortcutexpansion.h>
 #include <valhalla/baldr/sign.h>
 #include <valhalla/baldr/signinfo.h>
+#include <valhalla/baldr/traffictile.h>
 #include <valhalla/baldr/transitdeparture.h>
 #include <valhalla/baldr/transitroute.h>
 #include <valhalla/baldr/transitschedule.h>
@@ -30,6 +34,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
@@ -63,6 +68,20 @@ public:
    */
   GraphTile(const GraphId& graphid, char* ptr, size_t size);
 
+  /**
+   * Construct a tile by memory mapping its file in the tile directory rather
+   * than reading it. The mapping is read only and shared so processes using
+   * the same files share their pages. Replacing a file (write a new one and
+   * rename it over the old) leaves tiles that are already mapped untouched.
+   * @param  tile_dir  Tile directory.
+   * @param  graphid   Tile Id.
+   * @param  populate  Whether to fault in the whole file up front (MAP_POPULATE where available)
+   * @param  advice    posix_madvise advice for the mapping
+   * @return the tile, without a header if the file could not be mapped (gzipped or missing)
+   */
+  static GraphTile
+  MapTileFile(const std::string& tile_dir, const GraphId& graphid, bool populate, int advice);
+
   /**
    * Construct a tile given a url for the tile using curl
    * @param  tile_url URL of tile
@@ -157,6 +176,17 @@ public:
         " nodecount= " + std::to_string(header_->nodecount()));
   }
 
+  /**
+   * Get a pointer to a node without checking the index, for the inner loops of the path
+   * algorithms. The edge and transition ranges of the nodes are checked when the tile is
+   * loaded, so indices taken from the tile itself need no further check.
+   * @param  idx  Index of the node within the current tile.
+   * @return  Returns a pointer to the node.
+   */
+  const NodeInfo* node_unchecked(const size_t idx) const {
+    return &nodes_[idx];
+  }
+
   /**
    * Convenience method to get the lat,lon of a node.
    * @param  nodeid  GraphId of the node.
@@ -195,6 +225,32 @@ public:
         " directededgecount= " + std::to_string(header_->directededgecount()));
   }
 
+  /**
+   * Get a pointer to a edge without checking the index, like the edge_index of a node of this
+   * tile which is checked when the tile is loaded.
+   * @param  idx  Index of the directed edge within the current tile.
+   * @return  Returns a pointer to the edge.
+   */
+  const DirectedEdge* directededge_unchecked(const size_t idx) const {
+    return &directededges_[idx];
+  }
+
+  /**
+   * Get a pointer to the routing attributes of an edge, see RoutingEdge. The routing edges
+   * of a node can be walked alongside its directed edges.
+   * @param  idx  Index of the directed edge within the current tile.
+   * @return  Returns a pointer to the routing edge.
+   */
+  const RoutingEdge* routing_edge(const size_t idx) const {
+    if (idx < routing_edges_.size()) {
+      return &routing_edges_[idx];
+    }
+    throw std::runtime_error(
+        "GraphTile RoutingEdge index out of bounds: " + std::to_string(header_->graphid().tileid()) +
+        "," + std::to_string(header_->graphid().level()) + "," + std::to_string(idx) +
+        " directededgecount= " + std::to_string(header_->directededgecount()));
+  }
+
   /**
    * Get an iterable set of directed edges from a node in this tile
    * @param  node  Node from which the edges leave
@@ -244,6 +300,16 @@ public:
                              " transitioncount= " + std::to_string(header_->transitioncount()));
   }
 
+  /**
+   * Get a pointer to a node transition without checking the index, like the transition_index
+   * of a node of this tile which is checked when the tile is loaded.
+   * @param  idx  Index of the node transition within the current tile.
+   * @return  Returns a pointer to the node transition.
+   */
+  const NodeTransition* transition_unchecked(const uint32_t idx) const {
+    return &transitions_[idx];
+  }
+
   /**
    * Get an iterable set of transitions from a node in this tile
    * @param  node  Node from which the transitions leave
@@ -297,6 +363,33 @@ public:
   std::vector<ComplexRestriction*>
   GetRestrictions(const bool forward, const GraphId id, const uint64_t modes) const;
 
+  /**
+   * Visit the complex restrictions of an edge in place, without collecting them into a vector.
+   * @param   forward - do we want the restrictions in reverse order?
+   * @param   id - edge id
+   * @param   modes - access modes
+   * @param   visitor - callable as visitor(const ComplexRestriction*), returns false to stop
+   */
+  template <class Visitor>
+  void ForEachRestriction(const bool forward,
+                          const GraphId id,
+                          const uint64_t modes,
+                          Visitor&& visitor) const {
+    const char* restrictions =
+        forward ? complex_restriction_forward_ : complex_restriction_reverse_;
+    size_t size = forward ? complex_restriction_forward_size_ : complex_restriction_reverse_size_;
+    size_t offset = 0;
+    while (offset < size) {
+      const auto* cr = reinterpret_cast<const ComplexRestriction*>(restrictions + offset);
+      offset += cr->SizeOf();
+      if ((forward ? cr->to_graphid() : cr->from_graphid()) == id && (cr->modes() & modes)) {
+        if (!visitor(cr)) {
+          return;
+        }
+      }
+    }
+  }
+
   /**
    * Convenience method to get the directed edges originating at a node.
    * @param  node_index  Node Id within this tile.
@@ -450,6 +543,14 @@ public:
   std::vector<AccessRestriction> GetAccessRestrictions(const uint32_t edgeid,
                                                        const uint32_t access) const;
 
+  /**
+   * Get the access restrictions of an edge in place in the tile, for all access modes.
+   * @param   edgeid  Directed edge index within the tile.
+   * @return  Returns the restrictions of the edge, empty if it has none.
+   */
+  midgard::iterable_t<const AccessRestriction>
+  GetAccessRestrictionRange(const uint32_t edgeid) const;
+
   /**
    * Get an iteratable list of GraphIds given a bin in the tile
    * @param  column the bin's column
@@ -465,6 +566,29 @@ public:
    */
   midgard::iterable_t<GraphId> GetBin(size_t index) const;
 
+  /**
+   * Get the bounding boxes of the shapes of the edges in a bin, one for each of the edges
+   * GetBin returns and in the same order. Only tiles built with bin bounds have them.
+   * @param  index the bin's index in the row major array
+   * @return iterable container of the bounds, empty if the tile has none
+   */
+  midgard::iterable_t<BinBounds> GetBinBounds(size_t index) const;
+
+  /**
+   * Get the south west corner of a bin in the tile, the bin bounds are relative to it.
+   * @param  index the bin's index in the row major array
+   * @return the corner of the bin
+   */
+  midgard::PointLL GetBinCorner(size_t index) const;
+
+  /**
+   * Get the edges a shortcut in this tile supersedes, in the order they are traversed. Only
+   * tiles built with shortcut expansions have them.
+   * @param  idx  Index of the shortcut directed edge within the tile.
+   * @return iterable container of the edge ids, empty if the tile has none for the edge
+   */
+  midgard::iterable_t<GraphId> GetShortcutEdges(const uint32_t idx) const;
+
   /**
    * Get lane connections ending on this edge.
    * @param  idx  GraphId of the directed edge.
@@ -472,6 +596,33 @@ public:
    */
   std::vector<LaneConnectivity> GetLaneConnectivity(const uint32_t idx) const;
 
+  /**
+   * Get lane connections ending on this edge in place in the tile.
+   * @param  idx  Directed edge index within the tile.
+   * @return  Returns the lane connections ending on this edge, empty if there are none.
+   */
+  midgard::iterable_t<const LaneConnectivity> GetLaneConnectivityRange(const uint32_t idx) const;
+
+  /**
+   * Set the live traffic speeds of the tile. They are only used if the traffic tile has a speed for
+   * every directed edge of this tile.
+   * @param  traffic_tile  Live traffic speeds of this tile.
+   */
+  void set_traffic_tile(const TrafficTile& traffic_tile) {
+    if (header_ && traffic_tile && traffic_tile.header()->tile_id == header_->graphid().value &&
+        traffic_tile.header()->directed_edge_count == header_->directededgecount()) {
+      traffic_tile_ = traffic_tile;
+    }
+  }
+
+  /**
+   * Get the live traffic speeds of the tile.
+   * @return Returns the traffic tile, without traffic if the tile has none.
+   */
+  const TrafficTile& traffic_tile() const {
+    return traffic_tile_;
+  }
+
   /**
    * Convenience method to get the speed for an edge given the directed
    * edge and a time (seconds since start of the week).
@@ -496,13 +647,28 @@ public:
 
     // TODO: current with coefficient based on distance in time from start of route
 
+    // use the live speed if the current flow layer was requested and the traffic has one for the
+    // edge, it is read with a single atomic load as the traffic can be updated at any time
+    if ((flow_mask & kCurrentFlowMask) && traffic_tile_) {
+      auto live = traffic_tile_.speed(de - directededges_);
+      if (live.valid()) {
+        *flow_sources |= kCurrentFlowMask;
+        return live.speed;
+      }
+    }
+
     // use predicted speed if a time was passed in, the predicted speed layer was requested, and if
     // the edge has predicted speed
     auto invalid_time = seconds == kInvalidSecondsOfWeek;
     if (!invalid_time && (flow_mask & kPredictedFlowMask) && de->has_predicted_speed()) {
       seconds %= midgard::kSecondsPerWeek;
       uint32_t idx = de - directededges_;
-      float speed = predictedspeeds_.speed(idx, seconds);
+      auto* memo = PredictedSpeedMemo::current();
+      float speed =
+          memo ? memo->get(GraphId(header_->graphid().tileid(), header_->graphid().level(), idx),
+                           seconds / kSpeedBucketSizeSeconds,
+                           [this, idx, seconds]() { return predictedspeeds_.speed(idx, seconds); })
+               : predictedspeeds_.speed(idx, seconds);
       if (valid_speed(speed)) {
         *flow_sources |= kPredictedFlowMask;
         return static_cast<uint32_t>(speed + .5f);
@@ -555,7 +721,11 @@ public:
    */
   std::vector<uint16_t> turnlanes(const uint32_t idx) const {
     uint32_t offset = turnlanes_offset(idx);
-    return (offset > 0) ? TurnLanes::lanemasks(textlist_ + offset) : std::vector<uint16_t>();
+    if (offset == 0) {
+      return {};
+    }
+    InflateColdSections();
+    return TurnLanes::lanemasks(textlist_ + offset);
   }
 
   /**
@@ -570,6 +740,9 @@ protected:
   // Graph tile memory, this must be shared so that we can put it into cache
   std::shared_ptr<std::vector<char>> graphtile_;
 
+  // Memory mapped tile file, unmapped once the last copy of the tile is gone
+  std::shared_ptr<const char> mapped_;
+
   // Header information for the tile
   GraphTileHeader* header_;
 
@@ -583,6 +756,9 @@ protected:
   // List of directed edges. Fixed size structure indexed by Id within the tile.
   DirectedEdge* directededges_;
 
+  // Copy of the attributes of the directed edges that are checked most during expansion
+  std::vector<RoutingEdge> routing_edges_;
+
   // Extended directed edge records. For expansion. These are indexed by the same
   // Id as the directed edge.
   DirectedEdgeExt* ext_directededges_;
@@ -594,6 +770,21 @@ protected:
   // sorted by departure time)
   TransitDeparture* departures_;
 
+  // Where the departures of a transit line are. Departures are sorted by line, by type and then
+  // by time so each line has its fixed departures followed by its frequency based ones
+  struct transit_line_t {
+    uint32_t lineid;
+    uint32_t begin;     // First fixed departure
+    uint32_t frequency; // First frequency based departure
+    uint32_t end;       // Past the last departure
+  };
+
+  // The transit lines of the tile sorted by line Id
+  std::vector<transit_line_t> transit_lines_;
+
+  // Departure time of each departure, searched without reading the departures themselves
+  std::vector<uint32_t> departure_times_;
+
   // Transit stops (indexed by stop index within the tile)
   TransitStop* transit_stops_;
 
@@ -652,9 +843,37 @@ protected:
   // Number of bytes in lane connectivity data.
   std::size_t lane_connectivity_size_;
 
+  // Bounding boxes of the edges in the bins, one per edge graph id in edge_bins_
+  BinBounds* bin_bounds_;
+
+  // Shortcuts with the edges they supersede, sorted by shortcut and followed by one entry that
+  // ends the last shortcut's edges
+  ShortcutExpansion* shortcut_expansions_;
+  uint32_t shortcut_expansion_count_;
+  GraphId* shortcut_edges_;
+
+  // Edge info, text list and lane connectivity of tiles that store them deflated, inflated
+  // the first time one of them is used. Shared by the copies of the tile
+  struct cold_sections_t;
+  std::shared_ptr<cold_sections_t> cold_;
+
+  /**
+   * Makes sure the edge info, text list and lane connectivity can be read, for tiles that store
+   * them compressed they are inflated the first time.
+   */
+  void InflateColdSections() const {
+    if (cold_) {
+      InflateCompressedSections();
+    }
+  }
+  void InflateCompressedSections() const;
+
   // Predicted speeds
   PredictedSpeeds predictedspeeds_;
 
+  // Live traffic speeds, empty unless the reader has a traffic extract with this tile
+  TrafficTile traffic_tile_;
+
   // Map of stop one stops in this tile.
   std::unordered_map<std::string, GraphId> stop_one_stops;
 
@@ -682,6 +901,18 @@ protected:
    */
   void AssociateOneStopIds(const GraphId& graphid);
 
+  /**
+   * Index the departures of each transit line.
+   */
+  void IndexTransitLines();
+
+  /**
+   * Get where the departures of a transit line are.
+   * @param  lineid  Transit line Id.
+   * @return Returns the line or nullptr if it has no departures.
+   */
+  const transit_line_t* GetTransitLine(const uint32_t lineid) const;
+
   /** Decrompresses tile bytes into the internal graphtile byte buffer
    * @param  graphid     the id of the tile to be decompressed
    * @param  compressed  the compressed bytes
@@ -691,6 +922,9 @@ protected:
   bool DecompressTile(const GraphId& graphid, std::vector<char>& compressed);
 };
 
+// Reference counted handle to a tile, keeps the tile alive after it leaves the cache
+using graph_tile_ptr = std::shared_ptr<const GraphTile>;
+
 } // namespace baldr
 } // namespace valhalla
 
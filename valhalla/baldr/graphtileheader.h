@@ -16,7 +16,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 11;
+constexpr size_t kEmptySlots = 8;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -582,6 +582,58 @@ public:
     tile_size_ = offset;
   }
 
+  /**
+   * Gets the size of the edge info, text list and lane connectivity sections when the tile
+   * stores them deflated. Those sections then take the place of the edge info as one compressed
+   * block, the offsets of the text list and of the lane connectivity are where they will be
+   * once the block is inflated and the offsets of everything else are where they are stored.
+   * @return the inflated size in bytes of those sections or 0 if they are not compressed
+   */
+  uint32_t cold_size() const {
+    return cold_size_;
+  }
+
+  /**
+   * Sets the size of the compressed edge info, text list and lane connectivity once inflated.
+   * @param size the size in bytes, 0 if they are not compressed
+   */
+  void set_cold_size(uint32_t size) {
+    cold_size_ = size;
+  }
+
+  /**
+   * Gets the offset to the bounding boxes of the edges in the bins. There is one box for
+   * every edge id in the bins and in the same order.
+   * @return the offset in bytes or 0 if the tile has no bin bounds
+   */
+  uint32_t bin_bounds_offset() const {
+    return bin_bounds_offset_;
+  }
+
+  /**
+   * Sets the offset to the bounding boxes of the edges in the bins.
+   * @param offset the offset in bytes, 0 if the tile has no bin bounds
+   */
+  void set_bin_bounds_offset(uint32_t offset) {
+    bin_bounds_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the edges that the shortcuts in the tile supersede.
+   * @return the offset in bytes or 0 if the tile has no shortcut expansions
+   */
+  uint32_t shortcut_expansions_offset() const {
+    return shortcut_expansions_offset_;
+  }
+
+  /**
+   * Sets the offset to the edges that the shortcuts in the tile supersede.
+   * @param offset the offset in bytes, 0 if the tile has no shortcut expansions
+   */
+  void set_shortcut_expansions_offset(uint32_t offset) {
+    shortcut_expansions_offset_ = offset;
+  }
+
 protected:
   // GraphId (tileid and level) of this tile. Data quality metrics.
   uint64_t graphid_ : 46;
@@ -679,6 +731,15 @@ protected:
   // GraphTile data size in bytes
   uint32_t tile_size_;
 
+  // Inflated size of the compressed edge info, text list and lane connectivity
+  uint32_t cold_size_;
+
+  // Offset to the bounding boxes of the edges in the bins
+  uint32_t bin_bounds_offset_;
+
+  // Offset to the edges the shortcuts supersede
+  uint32_t shortcut_expansions_offset_;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
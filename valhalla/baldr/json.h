@@ -5,6 +5,7 @@
 #include <cinttypes>
 #include <cmath>
 #include <cstddef>
+#include <cstdio>
 #include <iomanip>
 #include <list>
 #include <memory>
@@ -192,6 +193,214 @@ inline ArrayPtr array(std::initializer_list<Jarray::value_type> list) {
   return ArrayPtr(new Jarray(list));
 }
 
+/**
+ * Writes json straight into a string instead of building up a tree of maps and arrays first, for
+ * the responses that are too big to allocate a node per value. Members are written in the order
+ * they are given, with operator()(key, value) inside of objects and operator()(value) inside of
+ * arrays. The output is formatted the same way the tree is.
+ */
+class Writer {
+public:
+  /**
+   * Constructor
+   * @param reserve  How many bytes to reserve for the output.
+   */
+  explicit Writer(size_t reserve = 4096) : first_(true) {
+    buffer_.reserve(reserve);
+  }
+
+  void start_object() {
+    separate();
+    open('{');
+  }
+
+  void start_object(const std::string& key) {
+    write_key(key);
+    open('{');
+  }
+
+  void end_object() {
+    close('}');
+  }
+
+  void start_array() {
+    separate();
+    open('[');
+  }
+
+  void start_array(const std::string& key) {
+    write_key(key);
+    open('[');
+  }
+
+  void end_array() {
+    close(']');
+  }
+
+  // A member of an object
+  template <class T> void operator()(const std::string& key, const T& value) {
+    write_key(key);
+    write(value);
+    first_ = false;
+  }
+
+  // An element of an array
+  template <class T> void operator()(const T& value) {
+    separate();
+    write(value);
+    first_ = false;
+  }
+
+  /**
+   * Get what was written so far.
+   * @return Returns the json.
+   */
+  const std::string& get_buffer() const {
+    return buffer_;
+  }
+
+  /**
+   * Give the json to the caller without copying it, the writer starts over empty.
+   * @return Returns the json.
+   */
+  std::string release() {
+    std::string json;
+    json.swap(buffer_);
+    first_ = true;
+    return json;
+  }
+
+  /**
+   * Start over, keeping the memory of the buffer.
+   */
+  void clear() {
+    buffer_.clear();
+    first_ = true;
+  }
+
+protected:
+  void separate() {
+    if (!first_) {
+      buffer_.push_back(',');
+    }
+  }
+
+  void open(char bracket) {
+    buffer_.push_back(bracket);
+    first_ = true;
+  }
+
+  void close(char bracket) {
+    buffer_.push_back(bracket);
+    first_ = false;
+  }
+
+  void write_key(const std::string& key) {
+    separate();
+    write(key);
+    buffer_.push_back(':');
+  }
+
+  void write(const std::string& value) {
+    buffer_.push_back('"');
+    for (const auto& c : value) {
+      switch (c) {
+        case '\\':
+          buffer_.append("\\\\");
+          break;
+        case '"':
+          buffer_.append("\\\"");
+          break;
+        case '/':
+          buffer_.append("\\/");
+          break;
+        case '\b':
+          buffer_.append("\\b");
+          break;
+        case '\f':
+          buffer_.append("\\f");
+          break;
+        case '\n':
+          buffer_.append("\\n");
+          break;
+        case '\r':
+          buffer_.append("\\r");
+          break;
+        case '\t':
+          buffer_.append("\\t");
+          break;
+        default:
+          if (c >= 0 && c < 32) {
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "\\u%04X", static_cast<int>(c));
+            buffer_.append(hex);
+          } else {
+            buffer_.push_back(c);
+          }
+          break;
+      }
+    }
+    buffer_.push_back('"');
+  }
+
+  void write(const char* value) {
+    write(std::string(value));
+  }
+
+  void write(uint64_t value) {
+    char number[24];
+    buffer_.append(number, std::snprintf(number, sizeof(number), "%" PRIu64, value));
+  }
+
+  void write(int64_t value) {
+    char number[24];
+    buffer_.append(number, std::snprintf(number, sizeof(number), "%" PRId64, value));
+  }
+
+  void write(const fp_t& value) {
+    // non finite numbers are quoted like the tree does
+    bool finite = std::isfinite(value.value);
+    if (!finite) {
+      buffer_.push_back('"');
+    }
+    char number[64];
+    auto precision = static_cast<int>(value.precision);
+    auto length = std::snprintf(number, sizeof(number), "%.*Lf", precision, value.value);
+    if (length < static_cast<int>(sizeof(number))) {
+      buffer_.append(number, length);
+    } else {
+      std::string big(length + 1, '\0');
+      std::snprintf(&big[0], big.size(), "%.*Lf", precision, value.value);
+      buffer_.append(big, 0, length);
+    }
+    if (!finite) {
+      buffer_.push_back('"');
+    }
+  }
+
+  void write(bool value) {
+    buffer_.append(value ? "true" : "false");
+  }
+
+  void write(std::nullptr_t) {
+    buffer_.append("null");
+  }
+
+  // Parts that are still built as a tree
+  template <class Nullable> void write(const std::shared_ptr<Nullable>& value) {
+    if (value) {
+      std::stringstream ss;
+      ss << *value;
+      buffer_.append(ss.str());
+    } else {
+      write(nullptr);
+    }
+  }
+
+  std::string buffer_;
+  bool first_;
+};
+
 } // namespace json
 } // namespace baldr
 } // namespace valhalla
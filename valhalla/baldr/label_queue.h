@@ -0,0 +1,162 @@
+#ifndef VALHALLA_BALDR_LABEL_QUEUE_H_
+#define VALHALLA_BALDR_LABEL_QUEUE_H_
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t kInvalidLabel = std::numeric_limits<uint32_t>::max();
+
+/**
+ * A callable element which returns the cost for a label.
+ */
+using LabelCost = std::function<float(const uint32_t label)>;
+
+/**
+ * Priority queue implementations the path algorithms can choose from.
+ */
+enum class LabelQueueType : uint8_t {
+  kDoubleBucket = 0, // Approximate bucket sort with an overflow bucket
+  kRadixHeap = 1     // Exact monotone radix heap
+};
+
+/**
+ * Counts of the work a queue did for a search, see LabelQueue::stats.
+ */
+struct LabelQueueStats {
+  uint64_t added = 0;     // Labels added
+  uint64_t decreased = 0; // Labels whose cost was lowered while in the queue
+  uint64_t popped = 0;    // Labels removed, settled by the search
+  uint64_t rebuilds = 0;  // Times labels had to be redistributed to find the next lowest cost
+
+  LabelQueueStats& operator+=(const LabelQueueStats& other) {
+    added += other.added;
+    decreased += other.decreased;
+    popped += other.popped;
+    rebuilds += other.rebuilds;
+    return *this;
+  }
+};
+
+/**
+ * Interface of the priority queues used by the path algorithms. Queues store
+ * label indexes into external data and get the sort cost of each label through
+ * a LabelCost functor. All implementations are monotone: a label added with a
+ * cost below that of the last label popped is treated as having the cost of the
+ * last label popped.
+ */
+class LabelQueue {
+public:
+  virtual ~LabelQueue() {
+  }
+
+  /**
+   * Returns the kind of queue.
+   * @return  Returns the queue type.
+   */
+  virtual LabelQueueType type() const = 0;
+
+  /**
+   * Reinitializes the queue for a new search. Any labels still in the queue
+   * are removed while memory already allocated is kept where possible.
+   * @param mincost    Minimum cost of the search.
+   * @param range      Cost range a bucketed queue should sort, queues
+   *                    that do not need it ignore it.
+   * @param bucketsize Bucket size of a bucketed queue (otherwise ignored).
+   * @param labelcost  Functor to get a cost given a label index.
+   */
+  virtual void reuse(const float mincost,
+                     const float range,
+                     const uint32_t bucketsize,
+                     const LabelCost& labelcost) = 0;
+
+  /**
+   * Removes all labels from the queue.
+   */
+  virtual void clear() = 0;
+
+  /**
+   * Adds a label index to the queue.
+   * @param   label  Label index to add to the queue.
+   */
+  virtual void add(const uint32_t label) = 0;
+
+  /**
+   * The specified label index now has a smaller cost. Must be called before
+   * the cost returned by the LabelCost functor is updated to the new cost.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   */
+  virtual void decrease(const uint32_t label, const float newcost) = 0;
+
+  /**
+   * Removes the lowest cost label index from the queue.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the queue is empty.
+   */
+  virtual uint32_t pop() = 0;
+
+  /**
+   * Returns what the queue did since it was last reinitialized for a search.
+   * Clearing the queue keeps the counts, so they can be read after the search
+   * cleaned up.
+   * @return  Returns the counts.
+   */
+  const LabelQueueStats& stats() const {
+    return stats_;
+  }
+
+protected:
+  LabelQueueStats stats_;
+};
+
+/**
+ * Creates a queue of the requested type.
+ * @param type       Queue type.
+ * @param mincost    Minimum cost of the search.
+ * @param range      Cost range for bucketed queues.
+ * @param bucketsize Bucket size for bucketed queues.
+ * @param labelcost  Functor to get a cost given a label index.
+ * @return Returns the new queue.
+ */
+std::shared_ptr<LabelQueue> make_label_queue(const LabelQueueType type,
+                                             const float mincost,
+                                             const float range,
+                                             const uint32_t bucketsize,
+                                             const LabelCost& labelcost);
+
+/**
+ * Prepares a queue for a new search. The existing queue is reused when it
+ * is of the requested type, otherwise it is replaced by a new queue.
+ * @param queue      Queue to prepare (may be empty).
+ * @param type       Queue type.
+ * @param mincost    Minimum cost of the search.
+ * @param range      Cost range for bucketed queues.
+ * @param bucketsize Bucket size for bucketed queues.
+ * @param labelcost  Functor to get a cost given a label index.
+ */
+void reuse_label_queue(std::shared_ptr<LabelQueue>& queue,
+                       const LabelQueueType type,
+                       const float mincost,
+                       const float range,
+                       const uint32_t bucketsize,
+                       const LabelCost& labelcost);
+
+/**
+ * Parses a queue type from its configuration name ("double_bucket" or
+ * "radix_heap").
+ * @param name  Name of the queue type.
+ * @param type  Set to the parsed type on success.
+ * @return Returns true if the name is a known queue type.
+ */
+bool parse_label_queue_type(const std::string& name, LabelQueueType& type);
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_LABEL_QUEUE_H_
@@ -0,0 +1,93 @@
+#ifndef VALHALLA_BALDR_LANDMARKS_H_
+#define VALHALLA_BALDR_LANDMARKS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+// The access modes landmarks are built for and the names of their files
+constexpr uint32_t kLandmarkModeCount = 2;
+constexpr uint16_t kLandmarkAccess[kLandmarkModeCount] = {kPedestrianAccess, kBicycleAccess};
+constexpr const char* kLandmarkModes[kLandmarkModeCount] = {"pedestrian", "bicycle"};
+
+// Distance of a node that a landmark does not reach or that is too far to store
+constexpr uint16_t kUnreachedLandmark = 0xffff;
+
+/**
+ * Shortest path lengths between every node of the routing graph and a few landmarks, built by
+ * mjolnir for the graph one access mode may use. By the triangle inequality the lengths give a
+ * lower bound on the length of the shortest path between any two nodes, which is a much tighter
+ * A* heuristic than the great circle distance when the roads make detours (rivers, motorways
+ * and the like). The lengths are taken over every edge the access mode is allowed on, so the
+ * bound holds for any costing options of that access mode. The landmarks are kept in a file
+ * next to the routing tiles.
+ */
+class Landmarks {
+public:
+  /**
+   * Returns the location of the landmarks of an access mode within a tile directory.
+   * @param  tile_dir  Tile directory.
+   * @param  mode      Name of the access mode (pedestrian, bicycle).
+   * @return Returns the file name.
+   */
+  static std::string file_name(const std::string& tile_dir, const std::string& mode);
+
+  /**
+   * Loads a landmarks file.
+   * @param  file  File to load.
+   * @return Returns the landmarks, nullptr if the file does not exist or is invalid.
+   */
+  static std::shared_ptr<const Landmarks> load(const std::string& file);
+
+  /**
+   * Writes the landmarks to a file.
+   * @param  file  File to write.
+   */
+  void write(const std::string& file) const;
+
+  /**
+   * Returns the lengths of the shortest paths between a node and the landmarks: first the
+   * lengths from each landmark to the node then the lengths from the node to each landmark.
+   * @param  node  Graph node.
+   * @return Returns the 2 * count lengths or nullptr if the node is not known.
+   */
+  const uint16_t* lengths(const GraphId& node) const;
+
+  /**
+   * Lower bound on the length of the shortest path from one node to another.
+   * @param  from  Lengths of the node the path starts at.
+   * @param  to    Lengths of the node the path ends at.
+   * @return Returns the bound in meters, 0 if the landmarks know nothing about the path.
+   */
+  float LowerBound(const uint16_t* from, const uint16_t* to) const;
+
+  // Access mask of the mode whose graph the lengths were found on
+  uint32_t access = 0;
+
+  // Number of landmarks and the meters each unit of length stands for. Lengths are rounded down
+  uint32_t count = 0;
+  float resolution = 0.f;
+
+  // GraphIds of the landmark nodes
+  std::vector<uint64_t> landmarks;
+
+  // Base GraphIds of the tiles (sorted) and the index of the first node of each, offsets has one
+  // more entry than tiles
+  std::vector<uint64_t> tiles;
+  std::vector<uint32_t> offsets;
+
+  // 2 * count lengths per node in the order of the tiles and the nodes within them
+  std::vector<uint16_t> values;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_LANDMARKS_H_
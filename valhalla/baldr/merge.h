@@ -3,7 +3,10 @@
 
 #include <cstdint>
 #include <deque>
+#include <functional>
+#include <memory>
 #include <utility>
+#include <vector>
 #include <valhalla/baldr/edgetracker.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
@@ -43,9 +46,11 @@ struct path {
 
 namespace detail {
 
-struct edge_collapser {
+// the tracker is an edge_tracker when walking on one thread and a concurrent_edge_tracker when
+// walking on several
+template <typename tracker_t> struct edge_collapser {
   edge_collapser(GraphReader& reader,
-                 edge_tracker& tracker,
+                 tracker_t& tracker,
                  std::function<bool(const DirectedEdge*)> edge_merge_pred,
                  std::function<bool(const DirectedEdge*)> edge_allowed_pred,
                  std::function<void(const path&)> func);
@@ -53,18 +58,27 @@ struct edge_collapser {
   GraphId next_node_id(GraphId last_node_id, GraphId node_id);
   GraphId edge_between(GraphId cur, GraphId next);
   void explore(GraphId node_id);
+  // true if every node of the path explore would walk from the node is in the node's tile
+  bool stays_in_tile(GraphId node_id);
 
   // return true if a loop is detected
   bool explore(GraphId prev, GraphId cur, path& forward, path& reverse);
 
 private:
   GraphReader& m_reader;
-  edge_tracker& m_tracker;
+  tracker_t& m_tracker;
   std::function<bool(const DirectedEdge*)> m_edge_merge_predicate;
   std::function<bool(const DirectedEdge*)> m_edge_allowed_predicate;
   std::function<void(const path&)> m_func;
 };
 
+void parallel_merge(const std::vector<GraphId>& tiles,
+                    const std::function<std::unique_ptr<GraphReader>()>& make_reader,
+                    size_t threads,
+                    const std::function<bool(const DirectedEdge*)>& edge_merge_pred,
+                    const std::function<bool(const DirectedEdge*)>& edge_allowed_pred,
+                    const std::function<void(const path&)>& func);
+
 } // namespace detail
 
 /**
@@ -89,7 +103,8 @@ void merge(TileSet& tiles,
            const std::function<bool(const DirectedEdge*)>& edge_allowed_pred,
            const std::function<void(const path&)>& func) {
   edge_tracker tracker = edge_tracker::create(tiles, reader);
-  detail::edge_collapser e(reader, tracker, std::move(edge_merge_pred), edge_allowed_pred, func);
+  detail::edge_collapser<edge_tracker> e(reader, tracker, std::move(edge_merge_pred),
+                                         edge_allowed_pred, func);
 
   // Iterate over tiles. Merge edges at nodes where the edges can be collapsed.
   for (GraphId tile_id : tiles) {
@@ -134,6 +149,33 @@ void merge(TileSet& tiles,
   }
 }
 
+/**
+ * The same as merge but the tiles are shared out to several threads. Each thread walks the paths
+ * starting in its tiles that do not leave them, the paths crossing from one tile to another are
+ * walked on a single thread afterwards. Each edge in the graph is still part of exactly one path.
+ *
+ * @param tiles A range object over GraphId for the tiles to consider.
+ * @param make_reader Makes the graph reader of each thread, readers are not thread safe.
+ * @param threads The number of threads to use.
+ * @param edge_merge_pred   The same as for merge, called from several threads.
+ * @param edge_allowed_pred The same as for merge, called from several threads.
+ * @param func The function to execute for each discovered path. It is called
+ *             from several threads at once.
+ */
+template <typename TileSet>
+void parallel_merge(TileSet& tiles,
+                    const std::function<std::unique_ptr<GraphReader>()>& make_reader,
+                    size_t threads,
+                    const std::function<bool(const DirectedEdge*)>& edge_merge_pred,
+                    const std::function<bool(const DirectedEdge*)>& edge_allowed_pred,
+                    const std::function<void(const path&)>& func) {
+  std::vector<GraphId> tile_ids;
+  for (GraphId tile_id : tiles) {
+    tile_ids.push_back(tile_id);
+  }
+  detail::parallel_merge(tile_ids, make_reader, threads, edge_merge_pred, edge_allowed_pred, func);
+}
+
 } // namespace merge
 } // namespace baldr
 } // namespace valhalla
@@ -1,9 +1,17 @@
 #ifndef VALHALLA_BALDR_PREDICTEDSPEEDS_H_
 #define VALHALLA_BALDR_PREDICTEDSPEEDS_H_
 
+#include <cstdint>
+#include <limits>
 #include <valhalla/midgard/util.h>
 #include <vector>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace valhalla {
 namespace baldr {
 
@@ -20,6 +28,9 @@ constexpr float kSpeedNormalization = 0.031497039f; // sqrt(2.0f / 2016.0f);
 // Size of the cos table for the buckets
 constexpr uint32_t kCosBucketTableSize = kCoefficientCount * kBucketsPerWeek;
 
+// The coefficients are decoded 8 at a time
+static_assert(kCoefficientCount % 8 == 0, "The coefficient count must be a multiple of 8");
+
 // Precompute a cos table for each bucket of the week as a singleton.
 class BucketCosTable final {
 public:
@@ -39,12 +50,14 @@ public:
   }
 
 private:
-  // Construct the cos table
+  // Construct the cos table. The first value of each bucket is the DCT-III weight of the
+  // first coefficient rather than cos(0) so decoding is a plain dot product.
   BucketCosTable() {
     // Fill out the table in bucket order.
     float* t = &table_[0];
     for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
-      for (uint32_t c = 0; c < kCoefficientCount; ++c) {
+      *t++ = k1OverSqrt2;
+      for (uint32_t c = 1; c < kCoefficientCount; ++c) {
         *t++ = cosf(kPiBucketConstant * (bucket + 0.5f) * c);
       }
     }
@@ -60,6 +73,152 @@ private:
   float table_[kCosBucketTableSize];
 };
 
+/**
+ * Dot product of the coefficients of a speed profile and the cos values of a bucket, 8 values at a
+ * time with AVX2, SSE2 or NEON when the build targets them.
+ * @param  coefficients  Compressed speed profile, kCoefficientCount values.
+ * @param  b             Cos values of the bucket, kCoefficientCount values.
+ * @return Returns the dot product.
+ */
+inline float decode_speed(const int16_t* coefficients, const float* b) {
+#if defined(__AVX2__)
+  __m256 sum = _mm256_setzero_ps();
+  for (uint32_t k = 0; k < kCoefficientCount; k += 8) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + k));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(c)),
+                                           _mm256_loadu_ps(b + k)));
+  }
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+#elif defined(__SSE2__)
+  __m128 lo_sum = _mm_setzero_ps();
+  __m128 hi_sum = _mm_setzero_ps();
+  for (uint32_t k = 0; k < kCoefficientCount; k += 8) {
+    // widen to 32 bits by interleaving with the sign
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + k));
+    __m128i sign = _mm_srai_epi16(c, 15);
+    __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(c, sign));
+    __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(c, sign));
+    lo_sum = _mm_add_ps(lo_sum, _mm_mul_ps(lo, _mm_loadu_ps(b + k)));
+    hi_sum = _mm_add_ps(hi_sum, _mm_mul_ps(hi, _mm_loadu_ps(b + k + 4)));
+  }
+  __m128 s = _mm_add_ps(lo_sum, hi_sum);
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+#elif defined(__ARM_NEON)
+  float32x4_t lo_sum = vdupq_n_f32(0.0f);
+  float32x4_t hi_sum = vdupq_n_f32(0.0f);
+  for (uint32_t k = 0; k < kCoefficientCount; k += 8) {
+    int16x8_t c = vld1q_s16(coefficients + k);
+    float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(c)));
+    float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(c)));
+    lo_sum = vmlaq_f32(lo_sum, lo, vld1q_f32(b + k));
+    hi_sum = vmlaq_f32(hi_sum, hi, vld1q_f32(b + k + 4));
+  }
+  float32x4_t s = vaddq_f32(lo_sum, hi_sum);
+  return vgetq_lane_f32(s, 0) + vgetq_lane_f32(s, 1) + vgetq_lane_f32(s, 2) +
+         vgetq_lane_f32(s, 3);
+#else
+  float speed = 0.0f;
+  for (uint32_t k = 0; k < kCoefficientCount; ++k) {
+    speed += coefficients[k] * b[k];
+  }
+  return speed;
+#endif
+}
+
+/**
+ * Memo of the predicted speeds decoded during one search, keyed by edge and bucket of the week.
+ * A search that costs edges at a time sets its memo as the memo of its thread for as long as it
+ * runs (see scope_t) and GraphTile::GetSpeed looks the speeds up in it. It is direct mapped so a
+ * speed that collides with another is simply decoded again.
+ */
+class PredictedSpeedMemo {
+public:
+  /**
+   * Constructor
+   * @param  size  Number of speeds the memo holds, rounded up to a power of 2.
+   */
+  explicit PredictedSpeedMemo(const size_t size = 1 << 14) {
+    shift_ = 64;
+    do {
+      --shift_;
+    } while ((size_t(1) << (64 - shift_)) < size);
+    entries_.resize(size_t(1) << (64 - shift_));
+  }
+
+  /**
+   * Get the speed of an edge in a bucket, decoding it the first time it is asked for.
+   * @param  edge_id  GraphId value of the directed edge.
+   * @param  bucket   Bucket of the week.
+   * @param  decode   Decodes the speed when it is not in the memo.
+   * @return Returns the speed.
+   */
+  template <class decode_t>
+  float get(const uint64_t edge_id, const uint32_t bucket, const decode_t& decode) {
+    uint64_t key = (edge_id << 11) | bucket;
+    uint64_t hash = (key ^ (key >> 33)) * 0xFF51AFD7ED558CCDull;
+    hash = (hash ^ (hash >> 33)) * 0xC4CEB9FE1A85EC53ull;
+    auto& entry = entries_[hash >> shift_];
+    if (entry.key != key) {
+      entry.key = key;
+      entry.speed = decode();
+    }
+    return entry.speed;
+  }
+
+  /**
+   * Forget all of the speeds.
+   */
+  void clear() {
+    for (auto& entry : entries_) {
+      entry.key = kEmpty;
+    }
+  }
+
+  /**
+   * The memo of the search running on this thread.
+   * @return Returns the memo or nullptr if the search has none.
+   */
+  static PredictedSpeedMemo*& current() {
+    static thread_local PredictedSpeedMemo* memo = nullptr;
+    return memo;
+  }
+
+  /**
+   * Makes a memo the memo of this thread until it goes out of scope.
+   */
+  class scope_t {
+  public:
+    explicit scope_t(PredictedSpeedMemo* memo) : previous_(current()) {
+      current() = memo;
+    }
+    ~scope_t() {
+      current() = previous_;
+    }
+    scope_t(const scope_t&) = delete;
+    scope_t& operator=(const scope_t&) = delete;
+
+  private:
+    PredictedSpeedMemo* previous_;
+  };
+
+protected:
+  // Buckets take 11 bits so no key is ever all ones
+  static constexpr uint64_t kEmpty = std::numeric_limits<uint64_t>::max();
+
+  struct entry_t {
+    uint64_t key = kEmpty;
+    float speed = 0.0f;
+  };
+
+  std::vector<entry_t> entries_;
+  uint32_t shift_; // Keeps the top bits of the hash of a key as its index
+};
+
 /**
  * Class to access predicted speed information within a tile.
  */
@@ -104,13 +263,7 @@ public:
     const float* b = BucketCosTable::GetInstance().get(seconds_of_week / kSpeedBucketSizeSeconds);
 
     // DCT-III with speed normalization
-    float speed = *coefficients * k1OverSqrt2;
-    ++coefficients;
-    ++b;
-    for (uint32_t k = 1; k < kCoefficientCount; ++k, ++coefficients, ++b) {
-      speed += *coefficients * *b;
-    }
-    return speed * kSpeedNormalization;
+    return decode_speed(coefficients, b) * kSpeedNormalization;
   }
 
 protected:
@@ -0,0 +1,194 @@
+#ifndef VALHALLA_BALDR_RADIX_QUEUE_H_
+#define VALHALLA_BALDR_RADIX_QUEUE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <valhalla/baldr/label_queue.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Radix heap - a monotone priority queue for label indexes. Costs are mapped
+ * to 32 bit keys (the bit pattern of a non-negative float orders the same way
+ * as its value) and labels are placed in a bucket given by the highest bit in
+ * which their key differs from the key of the last label popped. Unlike the
+ * DoubleBucketQueue there is no fixed cost range, so widely spread costs never
+ * require rebuilding an overflow bucket, and labels come out in exact cost
+ * order. Each label is moved between buckets at most 32 times.
+ */
+class RadixQueue final : public LabelQueue {
+public:
+  /**
+   * Constructor given a minimum cost and a cost functor.
+   * @param mincost    Minimum cost. Labels with a lower cost are treated as
+   *                   having this cost.
+   * @param labelcost  Functor to get a cost given a label index.
+   */
+  RadixQueue(const float mincost, const LabelCost& labelcost) {
+    reuse(mincost, 0.0f, 1, labelcost);
+  }
+
+  /**
+   * Returns the kind of queue.
+   * @return  Returns LabelQueueType::kRadixHeap.
+   */
+  LabelQueueType type() const override {
+    return LabelQueueType::kRadixHeap;
+  }
+
+  /**
+   * Reinitializes the queue for a new search. The bucket range and bucket
+   * size are not used by the radix heap.
+   * @param mincost    Minimum cost.
+   * @param range      Ignored.
+   * @param bucketsize Ignored.
+   * @param labelcost  Functor to get a cost given a label index.
+   */
+  void reuse(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const LabelCost& labelcost) override {
+    clear();
+    stats_ = {};
+    last_ = 0;
+    last_ = key(mincost);
+    labelcost_ = labelcost;
+  }
+
+  /**
+   * Clear all labels from the buckets.
+   */
+  void clear() override {
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+  }
+
+  /**
+   * Adds a label index to the queue.
+   * @param   label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) override {
+    buckets_[bucket(key(labelcost_(label)))].push_back(label);
+    ++stats_.added;
+  }
+
+  /**
+   * The specified label index now has a smaller cost. Moves it to the bucket
+   * of the new cost if it changes.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) override {
+    const uint32_t prevbucket = bucket(key(labelcost_(label)));
+    const uint32_t newbucket = bucket(key(newcost));
+    ++stats_.decreased;
+    if (prevbucket != newbucket) {
+      auto& prev = buckets_[prevbucket];
+      auto itr = std::find(prev.begin(), prev.end(), label);
+      if (itr != prev.end()) {
+        *itr = prev.back();
+        prev.pop_back();
+      }
+      buckets_[newbucket].push_back(label);
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the queue.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the queue is empty.
+   */
+  uint32_t pop() override {
+    if (buckets_[0].empty()) {
+      // Find the lowest non-empty bucket
+      uint32_t b = 1;
+      while (b < kBucketCount && buckets_[b].empty()) {
+        ++b;
+      }
+      if (b == kBucketCount) {
+        return kInvalidLabel;
+      }
+
+      // The smallest key in it becomes the new reference key. Every label in
+      // the bucket now differs from it in a lower bit so they all move down.
+      uint32_t minkey = std::numeric_limits<uint32_t>::max();
+      for (const auto label : buckets_[b]) {
+        minkey = std::min(minkey, key(labelcost_(label)));
+      }
+      last_ = minkey;
+      ++stats_.rebuilds;
+      scratch_.swap(buckets_[b]);
+      for (const auto label : scratch_) {
+        buckets_[bucket(key(labelcost_(label)))].push_back(label);
+      }
+      scratch_.clear();
+    }
+
+    // All labels in bucket 0 have the lowest key
+    uint32_t label = buckets_[0].back();
+    buckets_[0].pop_back();
+    ++stats_.popped;
+    return label;
+  }
+
+protected:
+  // One bucket for keys equal to the last key and one per differing bit
+  static constexpr uint32_t kBucketCount = 33;
+
+  // Key of the last label popped (or of the minimum cost)
+  uint32_t last_;
+
+  // Buckets of label indexes and scratch space used when redistributing
+  std::array<std::vector<uint32_t>, kBucketCount> buckets_;
+  std::vector<uint32_t> scratch_;
+
+  // Cost function to get cost given the label index.
+  LabelCost labelcost_;
+
+  /**
+   * Converts a cost to a key. Non-negative floats order the same way as
+   * their bit patterns, negative costs are treated as 0 and costs below
+   * the last key popped are raised to it to keep the queue monotone.
+   * @param  cost  Cost.
+   * @return Returns the key.
+   */
+  uint32_t key(const float cost) const {
+    uint32_t k = 0;
+    if (cost > 0.0f) {
+      std::memcpy(&k, &cost, sizeof(k));
+    }
+    return std::max(k, last_);
+  }
+
+  /**
+   * Returns the bucket of a key: 0 if it equals the last key, otherwise one
+   * more than the index of the highest bit in which they differ.
+   * @param  k  Key (not below the last key).
+   * @return Returns the bucket index.
+   */
+  uint32_t bucket(const uint32_t k) const {
+    uint32_t diff = k ^ last_;
+#if defined(__GNUC__) || defined(__clang__)
+    return diff == 0 ? 0 : 32 - __builtin_clz(diff);
+#else
+    uint32_t b = 0;
+    while (diff != 0) {
+      diff >>= 1;
+      ++b;
+    }
+    return b;
+#endif
+  }
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_RADIX_QUEUE_H_
@@ -1,6 +1,7 @@
 #ifndef VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 #define VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 
+#include <cstring>
 #include <fstream>
 #include <istream>
 #include <locale>
@@ -40,6 +41,58 @@ inline std::string to_string(const T& document_or_value, int decimal_places = -1
   return std::string(buffer.GetString(), buffer.GetSize());
 }
 
+/**
+ * Find the value at a json pointer. A rapidjson::Pointer allocates its tokens every time it is
+ * made, so the paths without escapes in them, which are all of the ones we use, are walked in place
+ * instead, and the others fall back to a rapidjson::Pointer.
+ * @param v       the value to start from
+ * @param source  the json pointer, ie. /locations/0/lat
+ * @return the value or nullptr when there is none at that path
+ */
+inline const rapidjson::Value* find(const rapidjson::Value& v, const char* source) {
+  if (*source != '\0' && (*source != '/' || std::strchr(source, '~') != nullptr)) {
+    return rapidjson::Pointer{source}.Get(v);
+  }
+  const rapidjson::Value* value = &v;
+  while (*source == '/') {
+    const char* token = ++source;
+    while (*source != '\0' && *source != '/') {
+      ++source;
+    }
+    auto length = static_cast<rapidjson::SizeType>(source - token);
+    if (value->IsObject()) {
+      auto member = value->FindMember(rapidjson::Value(rapidjson::StringRef(token, length)));
+      if (member == value->MemberEnd()) {
+        return nullptr;
+      }
+      value = &member->value;
+    } else if (value->IsArray()) {
+      // an index has only digits and no leading zeros
+      if (length == 0 || (length > 1 && *token == '0')) {
+        return nullptr;
+      }
+      rapidjson::SizeType index = 0;
+      for (const char* digit = token; digit != source; ++digit) {
+        if (*digit < '0' || *digit > '9') {
+          return nullptr;
+        }
+        index = index * 10 + (*digit - '0');
+      }
+      if (index >= value->Size()) {
+        return nullptr;
+      }
+      value = &(*value)[index];
+    } else {
+      return nullptr;
+    }
+  }
+  return value;
+}
+
+inline rapidjson::Value* find(rapidjson::Value& v, const char* source) {
+  return const_cast<rapidjson::Value*>(find(static_cast<const rapidjson::Value&>(v), source));
+}
+
 /* NOTE: all of these helper functions use the dom traversal style syntax for accessing nested keys
  * what this means is that every path you provide has to begin with '/' and allows for multiple to
  * get at children these functions don't currently check for '/' because rapidjson will throw when
@@ -51,7 +104,7 @@ template <typename T, typename V>
 inline typename std::enable_if<!std::is_arithmetic<T>::value, boost::optional<T>>::type
 get_optional(V&& v, const char* source) {
   // if we dont have this key bail
-  auto* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  auto* ptr = find(std::forward<V>(v), source);
   if (!ptr) {
     return boost::none;
   }
@@ -68,7 +121,7 @@ template <typename T, typename V>
 inline typename std::enable_if<std::is_arithmetic<T>::value, boost::optional<T>>::type
 get_optional(V&& v, const char* source) {
   // if we dont have this key bail
-  auto* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  auto* ptr = find(std::forward<V>(v), source);
   if (!ptr) {
     return boost::none;
   }
@@ -123,7 +176,7 @@ template <typename T, typename V> inline T get(V&& v, const char* source) {
 }
 
 template <typename V> inline const rapidjson::Value& get_child(const V& v, const char* source) {
-  const rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(v);
+  const rapidjson::Value* ptr = find(v, source);
   if (!ptr) {
     throw std::runtime_error(std::string("No child: ") + source);
   }
@@ -131,7 +184,7 @@ template <typename V> inline const rapidjson::Value& get_child(const V& v, const
 }
 
 template <typename V> inline rapidjson::Value& get_child(V&& v, const char* source) {
-  rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  rapidjson::Value* ptr = find(std::forward<V>(v), source);
   if (!ptr) {
     throw std::runtime_error(std::string("No child: ") + source);
   }
@@ -141,7 +194,7 @@ template <typename V> inline rapidjson::Value& get_child(V&& v, const char* sour
 template <typename V>
 inline boost::optional<const rapidjson::Value&> get_child_optional(const V& v, const char* source) {
   boost::optional<const rapidjson::Value&> c;
-  const rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(v);
+  const rapidjson::Value* ptr = find(v, source);
   if (ptr) {
     c.reset(*ptr);
   }
@@ -151,7 +204,7 @@ inline boost::optional<const rapidjson::Value&> get_child_optional(const V& v, c
 template <typename V>
 inline boost::optional<rapidjson::Value&> get_child_optional(V&& v, const char* source) {
   boost::optional<rapidjson::Value&> c;
-  rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  rapidjson::Value* ptr = find(std::forward<V>(v), source);
   if (ptr) {
     c.reset(*ptr);
   }
@@ -0,0 +1,44 @@
+#ifndef VALHALLA_BALDR_ROUTINGEDGE_H_
+#define VALHALLA_BALDR_ROUTINGEDGE_H_
+
+#include <cstdint>
+#include <valhalla/baldr/directededge.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The attributes of a directed edge that the path algorithms check for every edge leaving
+ * a node they expand. Many of those edges are rejected by these checks alone (superseded by
+ * a shortcut, no access, the u-turn) so a tile keeps a copy of them per directed edge. That
+ * array is 6 times denser than the directed edges themselves and the full DirectedEdge is
+ * only read for edges that make it past the checks.
+ */
+struct RoutingEdge {
+  uint64_t localedgeidx : 7;   // Index of the edge on the local level
+  uint64_t shortcut : 7;       // Shortcut edge (mask)
+  uint64_t superseded : 7;     // Edge is superseded by a shortcut (mask)
+  uint64_t is_shortcut : 1;    // True if this edge is a shortcut
+  uint64_t leaves_tile : 1;    // Does directed edge end in a different tile?
+  uint64_t forwardaccess : 12; // Access (bit mask) in forward direction
+  uint64_t reverseaccess : 12; // Access (bit mask) in reverse direction
+  uint64_t spare : 17;
+
+  RoutingEdge() = default;
+
+  /**
+   * Copies the hot attributes of the directed edge.
+   * @param  edge  Directed edge.
+   */
+  explicit RoutingEdge(const DirectedEdge& edge)
+      : localedgeidx(edge.localedgeidx()), shortcut(edge.shortcut()),
+        superseded(edge.superseded()), is_shortcut(edge.is_shortcut()),
+        leaves_tile(edge.leaves_tile()), forwardaccess(edge.forwardaccess()),
+        reverseaccess(edge.reverseaccess()), spare(0) {
+  }
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_ROUTINGEDGE_H_
@@ -0,0 +1,122 @@
+#ifndef VALHALLA_BALDR_SHARDMAP_H_
+#define VALHALLA_BALDR_SHARDMAP_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Geographic shards of a tile set, so that no one serving box has to hold all of the tiles. The
+ * bounds of the tiles are split into a grid of regions. Each shard keeps the tiles of its region
+ * grown by a border, so that routes near the edge of the region stay in the shard, plus every
+ * tile of the highway level, which is small and lets any shard route between regions.
+ *
+ * Requests are served by the shard whose grown region holds the most of their locations. A route
+ * between regions is found by the shard of the origin, which reaches the other regions over the
+ * highway tiles it keeps.
+ */
+class ShardMap {
+public:
+  struct shard_t {
+    std::string name;
+    midgard::AABB2<midgard::PointLL> region; // Without the border
+    std::string url;                          // Where the shard is served
+  };
+
+  /**
+   * Constructor of a map without any shards.
+   */
+  ShardMap();
+
+  /**
+   * Constructor.
+   * @param  pt  The shards as valhalla_build_shards writes them: the border in degrees and a list
+   *             of shards with their name, bbox as [minx, miny, maxx, maxy] and url.
+   */
+  ShardMap(const boost::property_tree::ptree& pt);
+
+  /**
+   * Split bounds into a grid of shards.
+   * @param  bounds   Bounds of the tiles to shard.
+   * @param  columns  Number of shards from west to east.
+   * @param  rows     Number of shards from south to north.
+   * @param  border   Degrees each region is grown by.
+   * @param  url      Url of the shards, {name} is replaced with the name of each one.
+   * @return Returns the shards, named column_row.
+   */
+  static ShardMap Grid(const midgard::AABB2<midgard::PointLL>& bounds,
+                       const uint32_t columns,
+                       const uint32_t rows,
+                       const float border,
+                       const std::string& url = "");
+
+  /**
+   * Get the shards.
+   * @return Returns the shards.
+   */
+  const std::vector<shard_t>& shards() const {
+    return shards_;
+  }
+
+  /**
+   * Get the degrees the regions are grown by.
+   * @return Returns the border.
+   */
+  float border() const {
+    return border_;
+  }
+
+  /**
+   * Get the index of a shard from its name.
+   * @param  name  Name of the shard.
+   * @return Returns the index or -1 if there is no shard of that name.
+   */
+  int32_t Index(const std::string& name) const;
+
+  /**
+   * Get the region of a shard grown by the border.
+   * @param  shard  Index of the shard.
+   * @return Returns the bounds of the tiles the shard keeps below the highway level.
+   */
+  midgard::AABB2<midgard::PointLL> Bounds(const size_t shard) const;
+
+  /**
+   * Whether a shard keeps a tile.
+   * @param  shard  Index of the shard.
+   * @param  tile   Tile id.
+   * @return Returns true for highway tiles and tiles intersecting the bounds of the shard.
+   */
+  bool Keeps(const size_t shard, const GraphId& tile) const;
+
+  /**
+   * Find the shard that serves a request.
+   * @param  points  The locations of the request, the first one is the origin.
+   * @return Returns the index of the shard whose bounds hold the most of the points, on a tie the
+   *         one whose region holds the origin, or -1 if none holds any of them.
+   */
+  int32_t Find(const std::vector<midgard::PointLL>& points) const;
+
+  /**
+   * Serialize the shards as the constructor reads them.
+   * @return Returns the json.
+   */
+  std::string ToJson() const;
+
+protected:
+  float border_;
+  std::vector<shard_t> shards_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SHARDMAP_H_
@@ -0,0 +1,24 @@
+#ifndef VALHALLA_BALDR_SHORTCUTEXPANSION_H_
+#define VALHALLA_BALDR_SHORTCUTEXPANSION_H_
+
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Where the edges a shortcut supersedes are listed in a tile. A tile can keep the edges of every
+ * one of its shortcuts in a section at its end so that unpacking a shortcut is a lookup instead
+ * of a walk over the graph. The section starts with the number of shortcuts and of edges, then
+ * has one of these per shortcut sorted by the shortcut's edge index and one more which only
+ * marks where the edges of the last shortcut end, then the GraphIds of the edges in order.
+ */
+struct ShortcutExpansion {
+  uint32_t shortcut; // Index of the shortcut directed edge within the tile
+  uint32_t first;    // Index of its first edge in the list of edges
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SHORTCUTEXPANSION_H_
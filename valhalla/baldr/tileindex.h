@@ -0,0 +1,27 @@
+#ifndef VALHALLA_BALDR_TILEINDEX_H_
+#define VALHALLA_BALDR_TILEINDEX_H_
+
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+// Name of the file at the start of a tile extract that indexes the tiles in it
+constexpr char kTileIndexFile[] = "index.bin";
+
+/**
+ * Where a tile is in a tile extract. An extract written by the build starts with a file named
+ * kTileIndexFile holding one of these per tile, so that loading the extract reads the index
+ * instead of walking the headers of every file in the tar. The data of each tile starts on a
+ * page boundary of the extract.
+ */
+struct TileIndexEntry {
+  uint64_t offset;  // Bytes from the start of the extract to the data of the tile
+  uint64_t tile_id; // GraphId of the tile
+  uint64_t size;    // Bytes of the tile
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TILEINDEX_H_
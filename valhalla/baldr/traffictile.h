@@ -0,0 +1,150 @@
+#ifndef VALHALLA_BALDR_TRAFFICTILE_H_
+#define VALHALLA_BALDR_TRAFFICTILE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t kTrafficTileVersion = 1;
+
+/**
+ * Live speed of a directed edge. Each record is a single 64 bit word so that a process updating
+ * the traffic can replace it with one atomic write while the workers read it without a lock.
+ */
+struct TrafficSpeed {
+  uint64_t speed : 8;      // Speed in kph, 0 when there is no live speed for the edge
+  uint64_t congestion : 8; // Congestion from 1 (free flowing) to 100 (stopped), 0 if unknown
+  uint64_t spare : 48;
+
+  /**
+   * Whether there is a live speed for the edge.
+   * @return Returns true if the speed can be used.
+   */
+  bool valid() const {
+    return speed > 0;
+  }
+};
+static_assert(sizeof(TrafficSpeed) == sizeof(uint64_t), "TrafficSpeed must be 64 bits");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "Traffic speeds are read and written as 64 bit atomics");
+
+/**
+ * Header of a traffic tile, followed by one TrafficSpeed per directed edge of the graph tile in
+ * the order of its directed edges. It is a multiple of 8 bytes so the speeds stay aligned.
+ */
+struct TrafficTileHeader {
+  uint64_t tile_id;             // GraphId of the graph tile the speeds are for
+  uint64_t last_update;         // Seconds since epoch of the last update, set by the updater
+  uint32_t directed_edge_count; // Number of speeds, the directed edge count of the graph tile
+  uint32_t traffic_tile_version;
+  uint32_t spare[2];
+};
+static_assert(sizeof(TrafficTileHeader) % sizeof(uint64_t) == 0,
+              "TrafficTileHeader must keep the speeds aligned");
+
+/**
+ * Live traffic speeds of the directed edges of a graph tile. Traffic tiles live in a memory
+ * mapped extract (see GraphReader) that another process updates in place, so the speeds can
+ * change at any time and are only ever accessed one atomic record at a time.
+ */
+class TrafficTile {
+public:
+  /**
+   * Constructor for a tile without traffic.
+   */
+  TrafficTile() : header_(nullptr), speeds_(nullptr) {
+  }
+
+  /**
+   * Constructor given the memory of a traffic tile.
+   * @param  ptr   Pointer to the start of the traffic tile, must be 8 byte aligned.
+   * @param  size  Size in bytes of the traffic tile.
+   * The tile is left without traffic if the memory does not hold a traffic tile of this version.
+   */
+  TrafficTile(char* ptr, const size_t size) : TrafficTile() {
+    if (ptr == nullptr || size < sizeof(TrafficTileHeader) ||
+        reinterpret_cast<uintptr_t>(ptr) % alignof(uint64_t) != 0) {
+      return;
+    }
+    auto* header = reinterpret_cast<TrafficTileHeader*>(ptr);
+    if (header->traffic_tile_version != kTrafficTileVersion ||
+        size < sizeof(TrafficTileHeader) + header->directed_edge_count * sizeof(TrafficSpeed)) {
+      return;
+    }
+    header_ = header;
+    speeds_ = reinterpret_cast<std::atomic<uint64_t>*>(ptr + sizeof(TrafficTileHeader));
+  }
+
+  /**
+   * Whether the tile has traffic.
+   */
+  explicit operator bool() const {
+    return header_ != nullptr;
+  }
+
+  /**
+   * Get the header of the traffic tile.
+   * @return Returns the header or nullptr if the tile has no traffic.
+   */
+  const TrafficTileHeader* header() const {
+    return header_;
+  }
+
+  /**
+   * Get the live speed of a directed edge.
+   * @param  idx  Directed edge index within the graph tile.
+   * @return Returns the speed, invalid if the edge has none.
+   */
+  TrafficSpeed speed(const uint32_t idx) const {
+    TrafficSpeed speed{};
+    if (header_ && idx < header_->directed_edge_count) {
+      uint64_t packed = speeds_[idx].load(std::memory_order_relaxed);
+      std::memcpy(&speed, &packed, sizeof(speed));
+    }
+    return speed;
+  }
+
+  /**
+   * Set the live speed of a directed edge, for the process updating the traffic.
+   * @param  idx    Directed edge index within the graph tile.
+   * @param  speed  The new speed.
+   */
+  void set_speed(const uint32_t idx, const TrafficSpeed& speed) {
+    if (header_ && idx < header_->directed_edge_count) {
+      uint64_t packed;
+      std::memcpy(&packed, &speed, sizeof(packed));
+      speeds_[idx].store(packed, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Make an empty traffic tile, without a live speed for any edge.
+   * @param  tile_id              GraphId of the graph tile.
+   * @param  directed_edge_count  Number of directed edges in the graph tile.
+   * @return Returns the bytes of the traffic tile.
+   */
+  static std::vector<char> Create(const GraphId& tile_id, const uint32_t directed_edge_count) {
+    std::vector<char> tile(sizeof(TrafficTileHeader) + directed_edge_count * sizeof(TrafficSpeed));
+    TrafficTileHeader header{};
+    header.tile_id = tile_id.Tile_Base();
+    header.directed_edge_count = directed_edge_count;
+    header.traffic_tile_version = kTrafficTileVersion;
+    std::memcpy(tile.data(), &header, sizeof(header));
+    return tile;
+  }
+
+protected:
+  TrafficTileHeader* header_;
+  std::atomic<uint64_t>* speeds_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TRAFFICTILE_H_
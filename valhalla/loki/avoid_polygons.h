@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace loki {
+
+class AvoidMaskCache;
+
+// The avoided directed edges of each tile, a bit per edge at the index of the edge in the tile
+using avoid_masks_t = std::unordered_map<baldr::GraphId, std::vector<uint64_t>>;
+
+/**
+ * Finds the edges an avoid polygon covers, on every level of the hierarchy. An edge is covered if
+ * a point of its shape is inside the polygon or its shape crosses the ring of the polygon.
+ * @param  ring    Ring of the polygon, closed or not.
+ * @param  reader  Graph reader for the tiles under the polygon.
+ * @return Returns the masks of the tiles with covered edges.
+ */
+avoid_masks_t RasterizeAvoidPolygon(const std::vector<midgard::PointLL>& ring,
+                                    baldr::GraphReader& reader);
+
+/**
+ * Rasterizes the avoid polygons of a request into the masks of the edges to avoid, which the
+ * costings read from the options. Named polygons are looked up in the cache first.
+ * @param  options  Options with the avoid polygons, the avoid masks are added to them.
+ * @param  reader   Graph reader for the tiles under the polygons.
+ * @param  cache    Cache of the masks of named polygons, may be nullptr.
+ */
+void AddAvoidMasks(Options& options, baldr::GraphReader& reader, AvoidMaskCache* cache);
+
+/**
+ * Masks of the named avoid polygons requests keep sending, flood zones or city centers say.
+ * Rasterizing a large polygon reads every tile under it so the masks of the most recently used
+ * polygons are kept. One cache is shared by every worker of a process.
+ */
+class AvoidMaskCache {
+public:
+  using masks_t = std::shared_ptr<const avoid_masks_t>;
+
+  /**
+   * Constructor
+   * @param  max_polygons  How many polygons the cache holds the masks of.
+   */
+  explicit AvoidMaskCache(const size_t max_polygons);
+
+  /**
+   * Get the masks of a polygon, rasterizing it if it is not in the cache.
+   * @param  key        Key of the polygon, the tile extract version with its name and points.
+   * @param  rasterize  Makes the masks when they are missing.
+   * @return Returns the masks.
+   */
+  masks_t Get(const std::string& key, const std::function<masks_t()>& rasterize);
+
+  /**
+   * Get the number of polygons in the cache.
+   * @return Returns the number of polygons.
+   */
+  size_t size() const;
+
+  /**
+   * Get the cache shared by the whole process. It is made the first time this is called, later
+   * calls get the same cache regardless of their size.
+   * @param  max_polygons  How many polygons the cache holds, 0 means no cache.
+   * @return Returns the cache, or nullptr if there is no room.
+   */
+  static std::shared_ptr<AvoidMaskCache> Global(const size_t max_polygons);
+
+protected:
+  struct entry_t {
+    masks_t masks;
+    uint64_t used;
+  };
+
+  mutable std::mutex mutex_;
+  size_t max_polygons_;
+  uint64_t uses_;
+  std::unordered_map<std::string, entry_t> polygons_;
+};
+
+} // namespace loki
+} // namespace valhalla
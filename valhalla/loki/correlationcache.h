@@ -0,0 +1,123 @@
+#ifndef VALHALLA_LOKI_CORRELATIONCACHE_H_
+#define VALHALLA_LOKI_CORRELATIONCACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/location.h>
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/sif/dynamiccost.h>
+
+namespace valhalla {
+namespace loki {
+
+/**
+ * Cache of the candidate edges loki::Search correlated locations to, for the depots, stores and
+ * other places that are requested over and over. The key holds the location rounded to a tenth of
+ * a meter, everything about the location that changes how it is searched (radius, heading,
+ * reachability, tolerances) and the key of the costing, since the costing decides which edges
+ * and nodes are candidates.
+ *
+ * Each correlation remembers the version of the tile extract it was made on, and is searched again
+ * once the reader is on another version. The least recently used correlations are dropped first
+ * when the cache is full. One cache can be shared by every worker of a process.
+ */
+class CorrelationCache {
+public:
+  /**
+   * Constructor
+   * @param  max_locations  How many correlated locations the cache holds.
+   */
+  explicit CorrelationCache(const size_t max_locations);
+
+  /**
+   * Correlate the locations, searching only those that are not in the cache yet.
+   * @param  locations    The locations to correlate, see loki::Search.
+   * @param  reader       Graph reader, the version of its tile extract is checked.
+   * @param  costing      Costing whose filters decide the candidates.
+   * @param  costing_key  Key of the costing, see sif::CostingCache::Key.
+   * @param  threads      How many threads project the locations that have to be searched.
+   * @return Returns the correlated locations, like loki::Search.
+   */
+  std::unordered_map<baldr::Location, baldr::PathLocation>
+  Search(const std::vector<baldr::Location>& locations,
+         baldr::GraphReader& reader,
+         const sif::DynamicCost* costing,
+         const std::string& costing_key,
+         size_t threads = 1);
+
+  /**
+   * Get a correlated location from the cache.
+   * @param  key       Key of the location, see Key.
+   * @param  version   Version of the tile extract the correlation has to be from.
+   * @param  location  The location, the correlation is given back for it.
+   * @param  result    Set to the correlated location if it is in the cache.
+   * @return Returns whether the location was in the cache.
+   */
+  bool Get(const std::string& key,
+           const uint64_t version,
+           const baldr::Location& location,
+           baldr::PathLocation& result);
+
+  /**
+   * Put a correlated location in the cache, dropping the least recently used one if it is full.
+   * @param  key          Key of the location, see Key.
+   * @param  version      Version of the tile extract the location was correlated on.
+   * @param  correlation  The correlated location.
+   */
+  void Put(const std::string& key, const uint64_t version, const baldr::PathLocation& correlation);
+
+  /**
+   * Get the number of correlated locations in the cache.
+   * @return Returns the number of locations.
+   */
+  size_t size() const;
+
+  /**
+   * Drop all of the correlated locations.
+   */
+  void Clear();
+
+  /**
+   * Get the key of a location. Two locations with the same key correlate to the same edges.
+   * @param  location     The location.
+   * @param  costing_key  Key of the costing the location is correlated with.
+   * @return Returns the key.
+   */
+  static std::string Key(const baldr::Location& location, const std::string& costing_key);
+
+  /**
+   * Get the cache shared by the whole process. It is made the first time this is called, later
+   * calls get the same cache regardless of their size.
+   * @param  max_locations  How many correlated locations the cache holds, 0 means no cache.
+   * @return Returns the cache, or nullptr if max_locations is 0.
+   */
+  static std::shared_ptr<CorrelationCache> Global(const size_t max_locations);
+
+protected:
+  struct entry_t {
+    baldr::PathLocation correlation;
+    uint64_t version;
+    std::list<std::string>::iterator used;
+  };
+
+  // Drop an entry, the caller holds the lock
+  void Drop(std::unordered_map<std::string, entry_t>::iterator entry);
+
+  mutable std::mutex mutex_;
+  size_t max_locations_;
+  // The keys from the most to the least recently used
+  std::list<std::string> used_;
+  std::unordered_map<std::string, entry_t> correlations_;
+};
+
+} // namespace loki
+} // namespace valhalla
+
+#endif // VALHALLA_LOKI_CORRELATIONCACHE_H_
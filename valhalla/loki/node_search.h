@@ -2,17 +2,48 @@
 #define VALHALLA_LOKI_NODE_SEARCH_H_
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <valhalla/baldr/graphreader.h>
 
 namespace valhalla {
 namespace loki {
 
 /**
- * Find nodes within the given bounding box in the route network.
+ * Finds the nodes within bounding boxes without allocating the buffers of the search for every
+ * bounding box. Keep one around for a loop of searches, ie. one per point of a trace. It uses the
+ * reader it was made with so, like the reader, its for one thread at a time.
+ */
+class node_search_t {
+public:
+  /**
+   * @param  reader  graph reader object to use for loading tiles.
+   */
+  explicit node_search_t(baldr::GraphReader& reader);
+  ~node_search_t();
+
+  /**
+   * Calls the visitor once for every node within the given bounding box, in no particular order.
+   * The nodes are handed over as they are found so there is nothing to sort or deduplicate after.
+   *
+   * @param  bbox     bounding box in which to look for nodes.
+   * @param  visitor  called with the id of each of the nodes in the bounding box.
+   */
+  void visit(const midgard::AABB2<midgard::PointLL>& bbox,
+             const std::function<void(const baldr::GraphId&)>& visitor);
+
+private:
+  struct context_t;
+  std::unique_ptr<context_t> context;
+};
+
+/**
+ * Find nodes within the given bounding box in the route network. This is a one off search, use a
+ * node_search_t to search over and over.
  *
  * @param  bbox   bounding box in which to look for nodes.
  * @param  reader graph reader object to use for loading tiles.
- * @return nodes  a collection of nodes which are in the bounding box.
+ * @return nodes  a collection of nodes which are in the bounding box, sorted by id.
  */
 std::vector<baldr::GraphId> nodes_in_bbox(const midgard::AABB2<midgard::PointLL>& bbox,
                                           baldr::GraphReader& reader);
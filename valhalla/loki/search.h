@@ -22,13 +22,16 @@ namespace loki {
  * proper cache
  * @param edge_filter    a costing object by which we can determine which portions of the graph are
  *                       accessable and therefor potential candidates
+ * @param threads        how many threads project the locations onto the edges of the bins they
+ *                       share, the graph reader is only ever used by the calling thread
  * @return pathLocations the correlated data with in the tile that matches the inputs. If a
  * projection is not found, it will not have any entry in the returned value.
  */
 std::unordered_map<baldr::Location, baldr::PathLocation>
 Search(const std::vector<baldr::Location>& locations,
        baldr::GraphReader& reader,
-       const sif::DynamicCost* costing = nullptr);
+       const sif::DynamicCost* costing = nullptr,
+       size_t threads = 1);
 
 } // namespace loki
 } // namespace valhalla
@@ -11,9 +11,13 @@
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/baldr/shardmap.h>
+#include <valhalla/loki/avoid_polygons.h>
+#include <valhalla/loki/correlationcache.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/costfactory.h>
+#include <valhalla/sif/costingcache.h>
 #include <valhalla/skadi/sample.h>
 #include <valhalla/tyr/actor.h>
 #include <valhalla/worker.h>
@@ -37,6 +41,20 @@ public:
   virtual void cleanup() override;
 
   std::string locate(Api& request);
+  /**
+   * Cap the deadline of the request at service_limits.max_timeout from now, requests without a
+   * timeout get that one. Nothing changes when no max_timeout is configured.
+   * @param  request  the request
+   */
+  void limit_deadline(Api& request) const;
+  /**
+   * Get the url of the shard that serves the request when the tiles are sharded and it is not
+   * the shard of this worker, see loki.shards.
+   * @param  request  the request
+   * @return the url or an empty string if this worker serves the request
+   */
+  std::string shard_url(const Api& request) const;
+
   void route(Api& request);
   void matrix(Api& request);
   void isochrones(Api& request);
@@ -51,6 +69,10 @@ protected:
   void parse_trace(Api& request);
   void parse_costing(Api& request);
   void locations_from_shape(Api& request);
+  // Correlate the locations with the costing of the request, through the correlation cache when
+  // there is one
+  std::unordered_map<baldr::Location, baldr::PathLocation>
+  search(const std::vector<baldr::Location>& locations, const Options& options, size_t threads = 1);
 
   void init_locate(Api& request);
   void init_route(Api& request);
@@ -58,13 +80,17 @@ protected:
   void init_isochrones(Api& request);
   void init_trace(Api& request);
   std::vector<midgard::PointLL> init_height(Api& request);
+  std::string heights(Api& request);
   void init_transit_available(Api& request);
 
   boost::property_tree::ptree config;
   sif::CostFactory<sif::DynamicCost> factory;
+  sif::CostingCache costing_cache;
   sif::cost_ptr_t costing;
   std::shared_ptr<baldr::GraphReader> reader;
-  std::shared_ptr<baldr::connectivity_map_t> connectivity_map;
+  std::shared_ptr<AvoidMaskCache> avoid_mask_cache;
+  std::shared_ptr<CorrelationCache> correlation_cache;
+  std::shared_ptr<const baldr::connectivity_map_t> connectivity_map;
   std::string action_str;
   std::unordered_map<std::string, size_t> max_locations;
   std::unordered_map<std::string, float> max_distance;
@@ -80,11 +106,14 @@ protected:
   unsigned int default_search_cutoff;
   unsigned int default_street_side_tolerance;
   float long_request;
+  service_metrics_t metrics;
+  admission_t admission;
   // Minimum and maximum walking distances (to validate input).
   size_t min_transit_walking_dis;
   size_t max_transit_walking_dis;
   size_t max_contours;
   size_t max_time;
+  size_t max_batch_locations;
   size_t max_trace_shape;
   float max_gps_accuracy;
   float max_search_radius;
@@ -94,6 +123,12 @@ protected:
   size_t max_elevation_shape;
   float min_resample;
   unsigned int max_alternates;
+  float max_timeout;
+  size_t search_threads;
+  size_t height_threads;
+  // The shards of the tile set and which one is served here, -1 when it is not sharded
+  baldr::ShardMap shards;
+  int32_t shard;
 };
 } // namespace loki
 } // namespace valhalla
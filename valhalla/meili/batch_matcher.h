@@ -0,0 +1,71 @@
+// -*- mode: c++ -*-
+#ifndef MMP_BATCH_MATCHER_H_
+#define MMP_BATCH_MATCHER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/meili/map_matcher_factory.h>
+#include <valhalla/meili/match_result.h>
+#include <valhalla/meili/measurement.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Matches many traces at once, for reprocessing lots of them. Each thread has its own
+ * MapMatcherFactory and MapMatcher while they share the tiles of one graph reader, if that
+ * reader is thread safe (see mjolnir.global_synchronized_cache), instead of each loading them.
+ * Traces are pulled one at a time so they can be streamed in, and their results are handed
+ * back in the order the traces came in so they can be streamed out.
+ */
+class BatchMatcher {
+public:
+  // Get the next trace, returns false when there are no more
+  using next_t = std::function<bool(std::vector<Measurement>& measurements)>;
+  // Take the best paths of a trace, given the index of the trace and its measurements
+  using done_t = std::function<void(size_t index,
+                                    std::vector<Measurement>&& measurements,
+                                    std::vector<MatchResults>&& results)>;
+
+  /**
+   * Constructor
+   * @param config   The root config, with the meili and mjolnir sections.
+   * @param reader   The graph reader, the threads only share it if it is thread safe.
+   * @param threads  How many traces are matched at once, 0 uses all cores.
+   */
+  BatchMatcher(const boost::property_tree::ptree& config,
+               const std::shared_ptr<baldr::GraphReader>& reader,
+               unsigned int threads);
+
+  /**
+   * Match traces until there are no more. next is called by one thread at a time as is done,
+   * in the order of the traces. An exception thrown while matching a trace is rethrown once
+   * the other threads stopped.
+   * @param options  Request options with the costing and its options.
+   * @param next     Gets the next trace.
+   * @param done     Takes the best paths of each trace.
+   * @param k        How many best paths to find for each trace.
+   */
+  void Match(const Options& options, const next_t& next, const done_t& done, uint32_t k = 1);
+
+  /**
+   * Get the number of traces matched at once.
+   * @return Returns the number of threads.
+   */
+  size_t concurrency() const {
+    return factories_.size();
+  }
+
+protected:
+  std::vector<std::unique_ptr<MapMatcherFactory>> factories_;
+};
+
+} // namespace meili
+} // namespace valhalla
+#endif // MMP_BATCH_MATCHER_H_
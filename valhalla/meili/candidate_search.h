@@ -4,7 +4,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <mutex>
 #include <tuple>
+#include <unordered_map>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -51,11 +54,79 @@ protected:
   baldr::GraphReader& reader_;
 };
 
-class CandidateGridQuery final : public CandidateQuery {
+/**
+ * Grids of the edges in each bin, shared by the candidate queries of every matcher in the process
+ * so that a bin is indexed once rather than once per worker and again after each of their cache
+ * clears. Grids are not changed once made and are handed out as shared pointers, so the cache can
+ * be cleared while queries still use them. It is thread safe and is cleared when it holds more
+ * than its maximum number of grids.
+ */
+class CandidateGridCache {
 public:
   using grid_t = GridRangeQuery<baldr::GraphId, midgard::PointLL>;
+  using grid_ptr_t = std::shared_ptr<const grid_t>;
+
+  explicit CandidateGridCache(size_t max_grids) : max_grids_(max_grids) {
+  }
+
+  /**
+   * Get the grid of a bin, making it if no query has made it yet. Grids are made outside of the
+   * lock, if two queries make the same one at once the first to finish is kept.
+   * @param  bin_id  Bin id.
+   * @param  make    Makes the grid, returns nullptr if there is none.
+   * @return Returns the grid or nullptr.
+   */
+  template <typename make_t> grid_ptr_t Get(const int32_t bin_id, const make_t& make) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto it = grids_.find(bin_id);
+      if (it != grids_.end()) {
+        return it->second;
+      }
+    }
+    grid_ptr_t grid = make();
+    if (!grid) {
+      return grid;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (grids_.size() >= max_grids_) {
+      grids_.clear();
+    }
+    return grids_.emplace(bin_id, grid).first->second;
+  }
 
-  CandidateGridQuery(baldr::GraphReader& reader, float cell_width, float cell_height);
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return grids_.size();
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    grids_.clear();
+  }
+
+private:
+  mutable std::mutex mutex_;
+  size_t max_grids_;
+  std::unordered_map<int32_t, grid_ptr_t> grids_;
+};
+
+class CandidateGridQuery final : public CandidateQuery {
+public:
+  using grid_t = CandidateGridCache::grid_t;
+
+  /**
+   * Constructor
+   * @param reader        Graph reader to get the tiles from.
+   * @param cell_width    Width of the grid cells.
+   * @param cell_height   Height of the grid cells.
+   * @param shared_cache  Cache of grids shared with other queries, if any. The queries sharing a
+   *                      cache must use the same cell sizes.
+   */
+  CandidateGridQuery(baldr::GraphReader& reader,
+                     float cell_width,
+                     float cell_height,
+                     const std::shared_ptr<CandidateGridCache>& shared_cache = {});
 
   ~CandidateGridQuery();
 
@@ -63,14 +134,19 @@ public:
                                          float sq_search_radius,
                                          sif::EdgeFilter filter) const override;
 
-  std::unordered_map<baldr::GraphId, grid_t>::size_type size() const {
+  size_t size() const {
     return grid_cache_.size();
   }
 
+  // Clear the grids of this query, the shared ones are left for the other queries
   void Clear() {
     grid_cache_.clear();
   }
 
+  const std::shared_ptr<CandidateGridCache>& shared_cache() const {
+    return shared_cache_;
+  }
+
 private:
   // Get a grid for a specified bin within a tile. Tile support for
   // graph tiles and bins is provided to go between bin Ids and tile Ids.
@@ -78,6 +154,11 @@ private:
                         const midgard::Tiles<midgard::PointLL>& tiles,
                         const midgard::Tiles<midgard::PointLL>& bins) const;
 
+  // Index the edges of a bin into a new grid
+  CandidateGridCache::grid_ptr_t MakeGrid(const int32_t bin_id,
+                                          const midgard::Tiles<midgard::PointLL>& tiles,
+                                          const midgard::Tiles<midgard::PointLL>& bins) const;
+
   std::unordered_set<baldr::GraphId> RangeQuery(const midgard::AABB2<midgard::PointLL>& range) const;
 
   uint32_t bin_level_;
@@ -86,7 +167,10 @@ private:
   float cell_height_;
 
   // Grid cache - cached per "bin" within a graph tile
-  mutable std::unordered_map<int32_t, grid_t> grid_cache_;
+  mutable std::unordered_map<int32_t, CandidateGridCache::grid_ptr_t> grid_cache_;
+
+  // Grids shared with the other queries, or nullptr
+  std::shared_ptr<CandidateGridCache> shared_cache_;
 };
 
 } // namespace meili
@@ -29,29 +29,32 @@ Project(const midgard::projector_t& p,
   float closest_partial_length = 0.f;
   float total_length = 0.f;
 
-  // for each segment
-  auto u = first_point;
+  // for each batch of segments, the last point of one batch is the first of the next
+  midgard::PointLL points[midgard::projector_t::kBatchSegments + 1];
+  points[0] = first_point;
   size_t i = 0;
-  for (; !shape.empty(); ++i) {
-    // project a onto b where b is the origin vector representing this segment
-    // and a is the origin vector to the point we are projecting, (a.b/b.b)*b
-    auto v = shape.pop();
-    auto point = p(u, v);
-
-    // check if this point is better
-    const auto distance = p.approx.DistanceSquared(point);
-    if (distance < closest_distance) {
-      closest_point = std::move(point);
-      closest_distance = distance;
-      closest_segment = i;
-      closest_partial_length = total_length;
-      closest_segment_point = u;
+  while (!shape.empty()) {
+    size_t count = 1;
+    for (; count < midgard::projector_t::kBatchSegments + 1 && !shape.empty(); ++count) {
+      points[count] = shape.pop();
     }
 
+    // check if a point on one of these segments is better
+    auto closest = p.closest(points, count, closest_point, closest_distance);
+
     // total edge length
-    total_length += u.Distance(v);
-    u = v;
+    for (size_t j = 0; j + 1 < count; ++j) {
+      if (j == closest) {
+        closest_segment = i + j;
+        closest_partial_length = total_length;
+        closest_segment_point = points[j];
+      }
+      total_length += points[j].Distance(points[j + 1]);
+    }
+    i += count - 1;
+    points[0] = points[count - 1];
   }
+  const auto& u = points[0];
 
   // Offset is a float between 0 and 1 representing the location of
   // the closest point on LineString to the given Point, as a fraction
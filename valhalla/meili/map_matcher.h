@@ -70,12 +70,34 @@ public:
   std::vector<MatchResults> OfflineMatch(const std::vector<Measurement>& measurements,
                                          uint32_t k = 1);
 
+  /**
+   * Match a trace one measurement at a time as it comes in. Measurements close to the last
+   * matched one are interpolated like in OfflineMatch. Once the paths to the candidates of the
+   * latest measurements all go through the same candidate, the matches before it are final and
+   * the states they no longer need are dropped, so the memory stays bounded however long the
+   * trace gets. Paths that do not converge within online_window measurements are cut at the
+   * oldest of them, keeping the candidate of the current best path.
+   * Call Clear() before starting another trace.
+   *
+   * @param measurement  the next measurement of the trace
+   * @return the match results that became final, in order, and their route which continues the
+   *         route returned before
+   */
+  MatchResults OnlineMatch(const Measurement& measurement);
+
+  /**
+   * Finish the trace given to OnlineMatch, its last measurement is always matched.
+   * @return the match results that were not final yet and their route
+   */
+  MatchResults FinishOnlineMatch();
+
   /**
    * Set a callback that will throw when the map-matching should be aborted
    * @param interrupt_callback  the function to periodically call to see if we should abort
    */
   void set_interrupt(const std::function<void()>* interrupt_callback) {
     interrupt_ = interrupt_callback;
+    transition_cost_model_.set_interrupt(interrupt_callback);
   }
 
 private:
@@ -84,6 +106,16 @@ private:
 
   StateId::Time AppendMeasurement(const Measurement& measurement, const float sq_max_search_radius);
 
+  // Set when the trace left the latest matched measurement if it lingered there before the next
+  void UpdateLeaveTime(const Measurement& next);
+
+  // Keep only the states of the best path at the last final time and the two after it
+  void CutOnlineMatch();
+
+  // Take the final match results off the best path up to the given time and drop the states
+  // that are no longer needed
+  MatchResults EmitOnlineMatch(StateId::Time end);
+
   void RemoveRedundancies(const std::vector<StateId>& result);
   // void RemoveRedundancies(const MatchResults& path, std::vector<StateId>& result);
 
@@ -109,6 +141,18 @@ private:
   EmissionCostModel emission_cost_model_;
 
   TransitionCostModel transition_cost_model_;
+
+  // Measurements interpolated after the one matched at each time, for the online matching
+  std::unordered_map<StateId::Time, std::vector<Measurement>> interpolated_;
+
+  // The earliest time whose match result is not final yet
+  StateId::Time online_time_;
+
+  // The match result of the time before it
+  MatchResult online_result_;
+
+  // How many measurements the paths get to converge before they are cut
+  uint32_t online_window_;
 };
 
 bool MergeRoute(std::vector<EdgeSegment>& route, const State& source, const State& target);
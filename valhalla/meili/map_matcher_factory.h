@@ -45,6 +45,9 @@ public:
 
   void ClearFullCache();
 
+  // Clear the candidate grids when there are too many of them, leaving the tiles alone
+  void ClearGridCache();
+
   void ClearCache();
 
   static constexpr size_t kModeCostingCount = 8;
@@ -0,0 +1,94 @@
+// -*- mode: c++ -*-
+#ifndef MMP_OPENLR_DECODER_H_
+#define MMP_OPENLR_DECODER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/meili/batch_matcher.h>
+#include <valhalla/meili/match_result.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Decodes binary OpenLR line location references to the edges they follow, for ingesting lots
+ * of them at once. The location reference points of a reference are matched like a trace: their
+ * candidates come from the candidate grids of the tiles and the shortest path between the
+ * candidates of consecutive points fills in the edges between them. References are matched on a
+ * BatchMatcher and the paths are kept in a cache keyed by the reference, so references that come
+ * again are not matched again.
+ */
+class OpenLRDecoder {
+public:
+  // The edges a location reference follows, trimmed by its offsets
+  using path_t = std::vector<EdgeSegment>;
+  using path_ptr = std::shared_ptr<const path_t>;
+
+  /**
+   * Constructor
+   * @param config      The root config, with the meili and mjolnir sections.
+   * @param reader      The graph reader, the threads only share it if it is thread safe.
+   * @param threads     How many references are matched at once, 0 uses all cores.
+   * @param max_cached  How many paths the cache holds before it is cleared, 0 means they are
+   *                    never cached.
+   */
+  OpenLRDecoder(const boost::property_tree::ptree& config,
+                const std::shared_ptr<baldr::GraphReader>& reader,
+                unsigned int threads,
+                size_t max_cached = 100000);
+
+  /**
+   * Decode binary line location references. The cache holds the paths of one costing, it is
+   * cleared when references are decoded with another one.
+   * @param options     Request options with the costing and its options.
+   * @param references  The binary (not base64) line location references.
+   * @return Returns the path of each reference, in the order of the references. References that
+   *         are invalid or could not be matched have no path.
+   */
+  std::vector<path_ptr> Decode(const Options& options, const std::vector<std::string>& references);
+
+  /**
+   * Get the number of paths in the cache.
+   * @return Returns the number of paths.
+   */
+  size_t cached() const {
+    return cache_.size();
+  }
+
+  /**
+   * Drop all of the cached paths.
+   */
+  void ClearCache() {
+    cache_.clear();
+  }
+
+protected:
+  /**
+   * Trim the offsets of a location reference off of the ends of its path, and merge the pieces
+   * of an edge the path was split into at the location reference points.
+   * @param path  The matched path.
+   * @param poff  Positive offset in meters, from the start of the path.
+   * @param noff  Negative offset in meters, from the end of the path.
+   */
+  void Trim(path_t& path, float poff, float noff) const;
+
+  std::shared_ptr<baldr::GraphReader> reader_;
+  BatchMatcher matcher_;
+  float gps_accuracy_;
+  float search_radius_;
+  size_t max_cached_;
+  Costing costing_;
+  std::unordered_map<std::string, path_ptr> cache_;
+};
+
+} // namespace meili
+} // namespace valhalla
+#endif // MMP_OPENLR_DECODER_H_
@@ -0,0 +1,53 @@
+// -*- mode: c++ -*-
+#ifndef MMP_OPENLR_ENCODER_H_
+#define MMP_OPENLR_ENCODER_H_
+
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/meili/match_result.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Encodes paths of edges, like the ones a matcher or OpenLRDecoder gives back, as binary OpenLR
+ * line location references. The location reference points are put on the nodes of the path and
+ * the parts of the first and last edges that are not on the path become the offsets. Further
+ * points are put between the nodes so that none of them is further from the next than OpenLR
+ * can encode. The tiles come from the graph reader the paths were matched with so they are not
+ * loaded twice.
+ */
+class OpenLREncoder {
+public:
+  using path_t = std::vector<EdgeSegment>;
+
+  /**
+   * Constructor
+   * @param reader  The graph reader to get the edges from.
+   */
+  explicit OpenLREncoder(baldr::GraphReader& reader);
+
+  /**
+   * Encode a path as a line location reference.
+   * @param path  Consecutive edges, the first and last of them can be partial.
+   * @return Returns the binary (not base64) reference, empty if the path has no edges that
+   *         can be found in the tiles.
+   */
+  std::string Encode(const path_t& path) const;
+
+  /**
+   * Encode paths as line location references.
+   * @param paths  The paths.
+   * @return Returns the reference of each path, in the order of the paths.
+   */
+  std::vector<std::string> Encode(const std::vector<path_t>& paths) const;
+
+protected:
+  baldr::GraphReader& reader_;
+};
+
+} // namespace meili
+} // namespace valhalla
+#endif // MMP_OPENLR_ENCODER_H_
@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include <algorithm>
+#include <functional>
 #include <stdexcept>
 #include <unordered_map>
 #include <vector>
@@ -33,7 +34,7 @@ public:
     // zero out the data but set the node Id and edge Id to invalid
     memset(this, 0, sizeof(Label));
     nodeid_ = baldr::GraphId();
-    edgeid_ = baldr::GraphId();
+    set_edgeid(baldr::GraphId());
     predecessor_ = baldr::kInvalidLabel;
   }
 
@@ -146,6 +147,168 @@ struct Status {
   uint32_t permanent : 1;
 };
 
+/**
+ * Status of the nodes and destinations reached by a search. Nodes are kept in a flat array per
+ * tile indexed by the node id and destinations in one indexed by the destination, instead of
+ * hash maps keyed by them. Clearing only starts a new generation: the arrays stay allocated for
+ * the next search and statuses of older generations read as not reached.
+ */
+class StatusTable {
+public:
+  StatusTable() : generation_(1), size_(0), last_tile_(kNoTile), last_(nullptr) {
+  }
+
+  // A copy looks its last tile up again since the pointer is into the other table's arrays
+  StatusTable(const StatusTable& other)
+      : generation_(other.generation_), size_(other.size_), tiles_(other.tiles_),
+        dests_(other.dests_), last_tile_(kNoTile), last_(nullptr) {
+  }
+
+  StatusTable& operator=(const StatusTable& other) {
+    if (this != &other) {
+      generation_ = other.generation_;
+      size_ = other.size_;
+      tiles_ = other.tiles_;
+      dests_ = other.dests_;
+      last_tile_ = kNoTile;
+      last_ = nullptr;
+    }
+    return *this;
+  }
+
+  // Moving keeps the arrays where they are so the pointer stays valid, the moved from table is
+  // left empty
+  StatusTable(StatusTable&& other)
+      : generation_(other.generation_), size_(other.size_), tiles_(std::move(other.tiles_)),
+        dests_(std::move(other.dests_)), last_tile_(other.last_tile_), last_(other.last_) {
+    other.reset();
+  }
+
+  StatusTable& operator=(StatusTable&& other) {
+    if (this != &other) {
+      generation_ = other.generation_;
+      size_ = other.size_;
+      tiles_ = std::move(other.tiles_);
+      dests_ = std::move(other.dests_);
+      last_tile_ = other.last_tile_;
+      last_ = other.last_;
+      other.reset();
+    }
+    return *this;
+  }
+
+  /**
+   * Get the status of a node.
+   * @param  nodeid  Node Id.
+   * @return Returns the status or nullptr if the search did not reach the node.
+   */
+  Status* find(const baldr::GraphId& nodeid) {
+    return current(node_entry(nodeid));
+  }
+
+  /**
+   * Get the status of a destination.
+   * @param  dest  Destination index.
+   * @return Returns the status or nullptr if the search did not reach the destination.
+   */
+  Status* find(const uint16_t dest) {
+    return current(dest_entry(dest));
+  }
+
+  /**
+   * Add the status of a node the search reached.
+   * @param  nodeid     Node Id.
+   * @param  label_idx  Index of its label.
+   */
+  void emplace(const baldr::GraphId& nodeid, const uint32_t label_idx) {
+    set(node_entry(nodeid), label_idx);
+  }
+
+  /**
+   * Add the status of a destination the search reached.
+   * @param  dest       Destination index.
+   * @param  label_idx  Index of its label.
+   */
+  void emplace(const uint16_t dest, const uint32_t label_idx) {
+    set(dest_entry(dest), label_idx);
+  }
+
+  /**
+   * Whether the search reached no node or destination.
+   */
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  /**
+   * Forget all of the statuses, keeping the arrays.
+   */
+  void clear() {
+    size_ = 0;
+    if (++generation_ == 0) {
+      // The generation wrapped around so old statuses could look current
+      reset();
+    }
+  }
+
+private:
+  struct entry_t {
+    entry_t() : generation(0), status(0) {
+    }
+    uint32_t generation;
+    Status status;
+  };
+
+  static constexpr uint32_t kNoTile = std::numeric_limits<uint32_t>::max();
+
+  entry_t& node_entry(const baldr::GraphId& nodeid) {
+    // Consecutive lookups are almost always in the same tile
+    if (nodeid.tile_value() != last_tile_) {
+      last_tile_ = nodeid.tile_value();
+      last_ = &tiles_[last_tile_];
+    }
+    if (nodeid.id() >= last_->size()) {
+      last_->resize(nodeid.id() + 1);
+    }
+    return (*last_)[nodeid.id()];
+  }
+
+  entry_t& dest_entry(const uint16_t dest) {
+    if (dest >= dests_.size()) {
+      dests_.resize(dest + 1);
+    }
+    return dests_[dest];
+  }
+
+  void reset() {
+    tiles_.clear();
+    dests_.clear();
+    last_tile_ = kNoTile;
+    last_ = nullptr;
+    generation_ = 1;
+    size_ = 0;
+  }
+
+  Status* current(entry_t& entry) const {
+    return entry.generation == generation_ ? &entry.status : nullptr;
+  }
+
+  void set(entry_t& entry, const uint32_t label_idx) {
+    if (entry.generation != generation_) {
+      ++size_;
+    }
+    entry.generation = generation_;
+    entry.status = Status(label_idx);
+  }
+
+  uint32_t generation_;
+  size_t size_;
+  std::unordered_map<uint32_t, std::vector<entry_t>> tiles_; // Node statuses by tile
+  std::vector<entry_t> dests_;                               // Destination statuses
+  uint32_t last_tile_;
+  std::vector<entry_t>* last_;
+};
+
 /**
  * LabelSet used during shortest path construction and recovery. Includes a
  * priority queue (sorted by sortdist) and maps that contain status (is the
@@ -153,19 +316,28 @@ struct Status {
  */
 class LabelSet {
 public:
-  LabelSet(const float max_cost, const float bucket_size = 1.0f);
+  /**
+   * The priority queue and statuses. They are only needed while searching, so a label set
+   * hands them back once its search is done and the next search reuses their memory.
+   */
+  struct Workspace {
+    std::shared_ptr<baldr::DoubleBucketQueue> queue;
+    StatusTable status;
+  };
+
+  LabelSet(const float max_cost, const float bucket_size = 1.0f, Workspace workspace = {});
 
   /**
    * Add an origin label using a destination index.
    */
   void put(const uint16_t dest, const sif::TravelMode mode, const Label* edgelabel) {
     // Do not add a duplicate label for the same destination index
-    if (dest_status_.find(dest) == dest_status_.end()) {
+    if (!status_.find(dest)) {
       // If edgelabel is not null, append it to the label set otherwise append
       // a dummy. In both cases add the label to the priority queue, set its
       // predecessor to kInvalidLabel, and initialize costs to 0.
       const uint32_t idx = labels_.size();
-      dest_status_.emplace(dest, idx);
+      status_.emplace(dest, idx);
       labels_.emplace_back(edgelabel ? *edgelabel : Label());
       labels_.back().InitAsOrigin(mode, dest, {});
       queue_->add(idx);
@@ -177,12 +349,12 @@ public:
    */
   void put(const baldr::GraphId& nodeid, const sif::TravelMode mode, const Label* edgelabel) {
     // Do not add a duplicate origin label for the same node
-    if (node_status_.find(nodeid) == node_status_.end()) {
+    if (!status_.find(nodeid)) {
       // If edgelabel is not null, append it to the label set otherwise append
       // a dummy. In both cases add the label to the priority queue and set its
       // predecessor to kInvalidLabel
       const uint32_t idx = labels_.size();
-      node_status_.emplace(nodeid, idx);
+      status_.emplace(nodeid, idx);
       labels_.emplace_back(edgelabel ? *edgelabel : Label());
       labels_.back().InitAsOrigin(mode, kInvalidDestination, nodeid);
       queue_->add(idx);
@@ -241,24 +413,42 @@ public:
   }
 
   /**
-   * Clear the status maps.
+   * Clear the statuses.
    */
   void clear_status() {
-    node_status_.clear();
-    dest_status_.clear();
+    status_.clear();
+  }
+
+  /**
+   * What the priority queue did during the search of this label set.
+   * @return  Returns the queue counts.
+   */
+  const baldr::LabelQueueStats& queue_stats() const {
+    return queue_->stats();
+  }
+
+  /**
+   * Hand back the cleared queue and statuses for another search to reuse. Only the labels
+   * are kept, to recover the paths, so nothing can be put to the label set afterwards.
+   * @return  Returns the workspace.
+   */
+  Workspace release() {
+    clear_queue();
+    clear_status();
+    return {std::move(queue_), std::move(status_)};
   }
 
 private:
   std::shared_ptr<baldr::DoubleBucketQueue> queue_;        // Priority queue
-  std::unordered_map<baldr::GraphId, Status> node_status_; // Node status
-  std::unordered_map<uint16_t, Status> dest_status_;       // Destination status
+  StatusTable status_;                                     // Node and destination status
   std::vector<Label> labels_;                              // Label list.
 };
 
 using labelset_ptr_t = std::shared_ptr<LabelSet>;
 
 /**
- * Find the shortest paths between an origin and a set of destinations.
+ * Find the shortest paths between an origin and a set of destinations. The interrupt, when
+ * given, is called every so many labels and throws when the search should be abandoned.
  */
 std::unordered_map<uint16_t, uint32_t>
 find_shortest_path(baldr::GraphReader& reader,
@@ -271,7 +461,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const Label* edgelabel,
                    const float turn_cost_table[181],
                    const float max_dist,
-                   const float max_time);
+                   const float max_time,
+                   const std::function<void()>* interrupt = nullptr);
 
 // Route path iterator. Methods to assist recovering route paths from Labels.
 class RoutePathIterator : public std::iterator<std::forward_iterator_tag, const Label> {
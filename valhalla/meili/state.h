@@ -2,6 +2,7 @@
 #ifndef MMP_STATE_H_
 #define MMP_STATE_H_
 
+#include <deque>
 #include <unordered_map>
 #include <vector>
 
@@ -39,13 +40,19 @@ public:
       throw std::runtime_error("expect valid labelset but got nullptr");
     }
 
-    // Cache results
+    // Cache results, the routes only go to states at the next time so they are indexed by the id
     label_idx_.clear();
     uint16_t dest = 1; // dest at 0 is remained for the origin
     for (const auto& stateid : stateids) {
+      if (stateid.time() != stateid_.time() + 1) {
+        throw std::logic_error("expect routes to the states at the next time only");
+      }
       const auto it = results.find(dest);
       if (it != results.end()) {
-        label_idx_[stateid] = it->second;
+        if (label_idx_.size() <= stateid.id()) {
+          label_idx_.resize(stateid.id() + 1, baldr::kInvalidLabel);
+        }
+        label_idx_[stateid.id()] = it->second;
       }
       dest++;
     }
@@ -54,19 +61,15 @@ public:
   }
 
   const Label* last_label(const State& state) const {
-    const auto it = label_idx_.find(state.stateid());
-    if (it != label_idx_.end()) {
-      return &labelset_->label(it->second);
+    const auto label_idx = route_label(state);
+    if (label_idx != baldr::kInvalidLabel) {
+      return &labelset_->label(label_idx);
     }
     return nullptr;
   }
 
   RoutePathIterator RouteBegin(const State& state) const {
-    const auto it = label_idx_.find(state.stateid());
-    if (it != label_idx_.end()) {
-      return RoutePathIterator(labelset_.get(), it->second);
-    }
-    return RoutePathIterator(labelset_.get());
+    return RoutePathIterator(labelset_.get(), route_label(state));
   }
 
   RoutePathIterator RouteEnd() const {
@@ -74,13 +77,23 @@ public:
   }
 
 private:
+  // Get the index of the label of the route to a state or kInvalidLabel if there is no route
+  uint32_t route_label(const State& state) const {
+    const auto& stateid = state.stateid();
+    if (stateid.time() == stateid_.time() + 1 && stateid.id() < label_idx_.size()) {
+      return label_idx_[stateid.id()];
+    }
+    return baldr::kInvalidLabel;
+  }
+
   StateId stateid_;
 
   baldr::PathLocation candidate_;
 
   mutable std::shared_ptr<LabelSet> labelset_;
 
-  mutable std::unordered_map<StateId, uint32_t> label_idx_;
+  // Label of the route to each state at the next time by its id, kInvalidLabel if unreached
+  mutable std::vector<uint32_t> label_idx_;
 };
 
 class StateContainer {
@@ -88,37 +101,53 @@ private:
   using Column = std::vector<State>;
 
 public:
-  StateContainer() : measurements_(), leave_times_(), columns_() {
+  StateContainer() : measurements_(), leave_times_(), columns_(), first_time_(0) {
   }
 
   void Clear() {
     measurements_.clear();
     leave_times_.clear();
     columns_.clear();
+    first_time_ = 0;
   }
 
   const State& state(const StateId& stateid) const {
-    return columns_[stateid.time()][stateid.id()];
+    return columns_[stateid.time() - first_time_][stateid.id()];
   }
 
   const Measurement& measurement(const StateId::Time& time) const {
-    return measurements_[time];
+    return measurements_[time - first_time_];
   }
 
   double leave_time(const StateId::Time& time) const {
-    return leave_times_[time];
+    return leave_times_[time - first_time_];
   }
 
   void SetMeasurementLeaveTime(const StateId::Time& time, double leave_time) {
-    leave_times_[time] = leave_time;
+    leave_times_[time - first_time_] = leave_time;
   }
 
   const Column& column(const StateId::Time& time) const {
-    return columns_[time];
+    return columns_[time - first_time_];
   }
 
+  // One past the latest time, the times before first_time() are dropped
   StateId::Time size() const {
-    return static_cast<StateId::Time>(columns_.size());
+    return first_time_ + static_cast<StateId::Time>(columns_.size());
+  }
+
+  StateId::Time first_time() const {
+    return first_time_;
+  }
+
+  // Drop the measurements and states before the given time, the times of the others stay the same
+  void DropBefore(const StateId::Time& time) {
+    while (first_time_ < time && !columns_.empty()) {
+      measurements_.pop_front();
+      leave_times_.pop_front();
+      columns_.pop_front();
+      ++first_time_;
+    }
   }
 
   std::string geojson(const StateId& s) {
@@ -137,11 +166,11 @@ public:
   }
 
   StateId NewStateId() const {
-    return columns_.empty() ? StateId() : StateId(columns_.size() - 1, columns_.back().size());
+    return columns_.empty() ? StateId() : StateId(size() - 1, columns_.back().size());
   }
 
   StateId::Time AppendMeasurement(const Measurement& measurement) {
-    const auto time = measurements_.size();
+    const auto time = size();
 
     measurements_.push_back(measurement);
     leave_times_.push_back(measurement.epoch_time());
@@ -160,7 +189,7 @@ public:
     if (columns_.empty()) {
       throw std::runtime_error("add measurement first");
     }
-    const auto expected_time = columns_.size() - 1;
+    const auto expected_time = size() - 1;
     const auto expected_id = columns_.back().size();
     if (state.stateid() != StateId(expected_time, expected_id)) {
       throw std::runtime_error("state's stateid should be " + std::to_string(expected_time) + "/" +
@@ -173,11 +202,13 @@ public:
   }
 
 private:
-  std::vector<Measurement> measurements_;
+  std::deque<Measurement> measurements_;
+
+  std::deque<double> leave_times_;
 
-  std::vector<double> leave_times_;
+  std::deque<Column> columns_;
 
-  std::vector<Column> columns_;
+  StateId::Time first_time_;
 };
 
 } // namespace meili
@@ -64,6 +64,21 @@ public:
    */
   virtual std::string match(const std::string& json);
 
+  /**
+   * Matches many GPS traces at once and associates each of them to traffic segments. Each
+   * thread has its own MapMatcherFactory, they share the graph reader of this matcher if it is
+   * thread safe (see mjolnir.global_synchronized_cache). The segments are handed back as they
+   * are so nothing is serialized along the way.
+   * @param  options  Request options with the costing and its options.
+   * @param  traces   Measurements of each trace, see parse_measurements.
+   * @param  threads  How many traces are matched at once, 0 uses all cores.
+   * @return Returns the traffic segments of each trace, in the order of the traces.
+   */
+  std::vector<std::vector<traffic_segment_t>>
+  match(const Options& options,
+        const std::vector<std::vector<Measurement>>& traces,
+        unsigned int threads = 1);
+
   /**
    * Parses the input to the traffic matcher, mainly the trace array
    * @param  request request with data {"trace":[{"lat":0,"lon":0,time:0},...]}
@@ -80,6 +95,15 @@ public:
   static std::string serialize(const std::vector<traffic_segment_t>& traffic_segments);
 
 protected:
+  /**
+   * Matches the measurements of a trace and forms the traffic segments along the matched path.
+   * @param  matcher       The matcher to match the trace with.
+   * @param  measurements  Measurements of the trace.
+   * @return Returns the traffic segments along the matched path.
+   */
+  std::vector<traffic_segment_t> match_segments(const std::shared_ptr<MapMatcher>& matcher,
+                                                const std::vector<Measurement>& measurements) const;
+
   /**
    * Updates the matching results include the begin and end points of the edges on the path
    * in doing so it interpolates the times at those points and gives back a distance along
@@ -118,6 +142,7 @@ protected:
   form_segments(const std::list<std::vector<interpolation_t>>& interpolations,
                 baldr::GraphReader& reader) const;
 
+  boost::property_tree::ptree config;
   valhalla::meili::MapMatcherFactory matcher_factory;
   std::unordered_set<std::string> customizable;
 };
@@ -5,6 +5,7 @@
 
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/meili/measurement.h>
+#include <valhalla/meili/routing.h>
 #include <valhalla/meili/state.h>
 #include <valhalla/meili/topk_search.h>
 #include <valhalla/meili/viterbi_search.h>
@@ -50,9 +51,30 @@ public:
 
   float operator()(const StateId& lhs, const StateId& rhs) const;
 
+  // What the priority queues of the routes between candidates did since the counts were cleared
+  const baldr::LabelQueueStats& queue_stats() const {
+    return queue_stats_;
+  }
+
+  void ClearQueueStats() {
+    queue_stats_ = {};
+  }
+
+  /**
+   * Set a callback the routes between candidates call every so many labels, it throws when the
+   * matching should be abandoned
+   * @param interrupt  the function to call, nullptr to not be interrupted
+   */
+  void set_interrupt(const std::function<void()>* interrupt) {
+    interrupt_ = interrupt;
+  }
+
 private:
   void UpdateRoute(const StateId& lhs, const StateId& rhs) const;
 
+  // Get the great circle distance between two measurements
+  float GreatCircleDistance(const StateId::Time& lhs, const StateId::Time& rhs) const;
+
   float ClockDistance(const StateId::Time& lhs, const StateId::Time& rhs) const {
     double clk_dist = -1.0;
 
@@ -90,6 +112,20 @@ private:
 
   // Cost for each degree in [0, 180]
   float turn_cost_table_[181];
+
+  // Called while routing between candidates, throws to abandon the matching
+  const std::function<void()>* interrupt_;
+
+  // Queue and status maps reused by the searches
+  mutable LabelSet::Workspace workspace_;
+
+  // Queue counts summed over the searches
+  mutable baldr::LabelQueueStats queue_stats_;
+
+  // The last pair of measurements and their great circle distance
+  mutable midgard::PointLL distance_left_;
+  mutable midgard::PointLL distance_right_;
+  mutable float distance_ = 0.f;
 };
 
 } // namespace meili
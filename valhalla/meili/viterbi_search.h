@@ -2,6 +2,7 @@
 #ifndef MMP_VITERBI_SEARCH_H_
 #define MMP_VITERBI_SEARCH_H_
 
+#include <deque>
 #include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
@@ -59,6 +60,9 @@ public:
   bool operator==(const StateIdIterator& other) const;
   bool operator!=(const StateIdIterator& other) const;
   const StateId& operator*() const;
+  StateId::Time time() const {
+    return time_;
+  }
 
 private:
   void static ValidateStateId(const StateId::Time time, const StateId& stateid); // Invariant
@@ -94,6 +98,10 @@ public:
   virtual double AccumulatedCost(const StateId& stateid) const = 0;
 
   bool HasStateId(const StateId& stateid) const;
+  // The earliest time whose states are still around, paths are not traced back past it
+  StateId::Time first_time() const {
+    return first_time_;
+  }
   StateIdIterator SearchPath(StateId::Time time, bool allow_breaks = true);
   StateIdIterator PathEnd() const;
   const IEmissionCostModel& emission_cost_model() const;
@@ -112,8 +120,10 @@ protected:
   constexpr static double
   CostSofar(double prev_costsofar, float transition_cost, float emission_cost);
 
-  std::vector<std::vector<StateId>> states_by_time;
-  std::vector<StateId> winner_by_time;
+  // Both are indexed by the time since first_time_
+  std::deque<std::vector<StateId>> states_by_time;
+  std::deque<StateId> winner_by_time;
+  StateId::Time first_time_{0};
 
 private:
   std::unordered_set<StateId> added_states_;
@@ -165,6 +175,25 @@ public:
   StateId Predecessor(const StateId& stateid) const override;
   double AccumulatedCost(const StateId& stateid) const override;
 
+  /**
+   * Find the latest time at which the paths to the states the search can still extend all go
+   * through the same state. The winners of later times only ever extend one of those paths so
+   * the path to the winner at the last searched time is final up to there.
+   *
+   * @return the time or kInvalidTime if the paths did not converge since first_time()
+   */
+  StateId::Time ConvergedTime();
+
+  /**
+   * Forget the states, labels and winners of the times before the given time to bound the
+   * memory of a search that keeps getting new columns. Only searched times are forgotten and
+   * the search carries on as if the paths began at the given time, which is exact when it is
+   * no later than ConvergedTime().
+   *
+   * @param time  the earliest time to keep
+   */
+  void Forget(StateId::Time time);
+
 private:
   // Initialize labels from a column and push them into priority queue
   void InitQueue(const std::vector<StateId>& column);
@@ -172,7 +201,7 @@ private:
   StateId::Time IterativeSearch(StateId::Time target, bool request_new_start);
   constexpr static bool IsInvalidCost(double cost);
 
-  std::vector<std::vector<StateId>> unreached_states_by_time;
+  std::deque<std::vector<StateId>> unreached_states_by_time;
   std::unordered_map<StateId, StateLabel> scanned_labels_;
   SPQueue<StateLabel> queue_;
   StateId::Time earliest_time_{0};
@@ -79,6 +79,22 @@ public:
            sqr((ll.lng() - centerlng_) * m_per_lng_degree_);
   }
 
+  /**
+   * Approximates the squared distances from the test point to many points
+   * given as separate arrays of longitudes and latitudes, which lets the
+   * compiler vectorize the loop.
+   * @param   lngs   Longitudes of the points (degrees)
+   * @param   lats   Latitudes of the points (degrees)
+   * @param   count  Number of points
+   * @param   dists  Receives the squared distance in meters to each point
+   */
+  void DistanceSquared(const float* lngs, const float* lats, size_t count, float* dists) const {
+    for (size_t i = 0; i < count; ++i) {
+      dists[i] = sqr((lats[i] - centerlat_) * kMetersPerDegreeLat) +
+                 sqr((lngs[i] - centerlng_) * m_per_lng_degree_);
+    }
+  }
+
   /**
    * Approximates arc distance between 2 lat,lng positions using meters per
    * latitude and longitude degree.  Uses the mid latitude of the 2 positions
@@ -4,6 +4,8 @@
 #include <valhalla/midgard/shape_decoder.h>
 
 #include <cmath>
+#include <cstdint>
+#include <iterator>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -20,9 +22,7 @@ decode(const char* encoded, size_t length, const double precision = 1e-6) {
   ShapeDecoder shape(encoded, length, precision);
   container_t c;
   c.reserve(length / 4);
-  while (!shape.empty()) {
-    c.emplace_back(shape.pop());
-  }
+  shape.pop_all(std::back_inserter(c));
   return c;
 }
 
@@ -34,9 +34,7 @@ typename std::enable_if<
 decode(const char* encoded, size_t length, const double precision = 1e-6) {
   ShapeDecoder shape(encoded, length, precision);
   container_t c;
-  while (!shape.empty()) {
-    c.emplace_back(shape.pop());
-  }
+  shape.pop_all(std::back_inserter(c));
   return c;
 }
 
@@ -69,90 +67,110 @@ template <class container_t> container_t decode7(const std::string& encoded) {
 }
 
 /**
- * Polyline encode a container of points into a string suitable for web use
+ * Polyline encode a single number into an output iterator, the way each coordinate of a point is
+ * encoded. Polylines encode the offset of each number from the one before it to keep them short
+ *
+ * @param number    the number to encode
+ * @param out       where to write the encoded characters
+ * @return the output iterator past the last character written
+ */
+template <class output_t> output_t encode_number(int32_t number, output_t out) {
+  // move the bits left 1 position and flip all the bits if it was a negative number
+  uint32_t value =
+      number < 0 ? ~(static_cast<uint32_t>(number) << 1) : static_cast<uint32_t>(number) << 1;
+  // write 5 bit chunks of the number
+  while (value >= 0x20) {
+    *out++ = static_cast<char>((0x20 | (value & 0x1f)) + 63);
+    value >>= 5;
+  }
+  // write the last chunk
+  *out++ = static_cast<char>(value + 63);
+  return out;
+}
+
+/**
+ * Polyline encode points into an output iterator, e.g. straight into the buffer of a response.
  * Note: newer versions of this algorithm allow one to specify a zoom level
  * which allows displaying simplified versions of the encoded linestring
  *
- * @param points    the list of points to encode
+ * @param begin     the first of the points to encode
+ * @param end       one past the last of the points to encode
+ * @param out       where to write the encoded characters
  * @param precision Precision of the encoded polyline. Defaults to 6 digit precision.
- * @return string   the encoded container of points
+ * @return the output iterator past the last character written
  */
-template <class container_t>
-std::string encode(const container_t& points, const int precision = 1e6) {
-  // a place to keep the output
-  std::string output;
-  // unless the shape is very course you should probably only need about 3 bytes
-  // per coord, which is 6 bytes with 2 coords, so we overshoot to 8 just in case
-  output.reserve(points.size() * 8);
-
-  // handy lambda to turn an integer into an encoded string
-  auto serialize = [&output](int number) {
-    // move the bits left 1 position and flip all the bits if it was a negative number
-    number = number < 0 ? ~(number << 1) : (number << 1);
-    // write 5 bit chunks of the number
-    while (number >= 0x20) {
-      int nextValue = (0x20 | (number & 0x1f)) + 63;
-      output.push_back(static_cast<char>(nextValue));
-      number >>= 5;
-    }
-    // write the last chunk
-    number += 63;
-    output.push_back(static_cast<char>(number));
-  };
-
+template <class iterator_t, class output_t>
+output_t encode(iterator_t begin, iterator_t end, output_t out, const int precision = 1e6) {
   // this is an offset encoding so we remember the last point we saw
   int last_lon = 0, last_lat = 0;
   // for each point
-  for (const auto& p : points) {
+  for (; begin != end; ++begin) {
     // shift the decimal point 5 places to the right and truncate
-    int lon = static_cast<int>(floor(static_cast<double>(p.first) * precision));
-    int lat = static_cast<int>(floor(static_cast<double>(p.second) * precision));
+    int lon = static_cast<int>(floor(static_cast<double>(begin->first) * precision));
+    int lat = static_cast<int>(floor(static_cast<double>(begin->second) * precision));
     // encode each coordinate, lat first for some reason
-    serialize(lat - last_lat);
-    serialize(lon - last_lon);
+    out = encode_number(lat - last_lat, out);
+    out = encode_number(lon - last_lon, out);
     // remember the last one we encountered
     last_lon = lon;
     last_lat = lat;
   }
-  return output;
+  return out;
 }
 
 /**
- * Varint encode a container of points into a string
+ * Polyline encode a container of points into a string suitable for web use
+ * Note: newer versions of this algorithm allow one to specify a zoom level
+ * which allows displaying simplified versions of the encoded linestring
  *
  * @param points    the list of points to encode
+ * @param precision Precision of the encoded polyline. Defaults to 6 digit precision.
  * @return string   the encoded container of points
  */
-template <class container_t> std::string encode7(const container_t& points) {
+template <class container_t>
+std::string encode(const container_t& points, const int precision = 1e6) {
   // a place to keep the output
   std::string output;
   // unless the shape is very course you should probably only need about 3 bytes
   // per coord, which is 6 bytes with 2 coords, so we overshoot to 8 just in case
   output.reserve(points.size() * 8);
+  encode(points.begin(), points.end(), std::back_inserter(output), precision);
+  return output;
+}
 
-  // handy lambda to turn an integer into an encoded string
-  auto serialize = [&output](int number) {
+/**
+ * Varint encode points into an output iterator
+ *
+ * @param begin     the first of the points to encode
+ * @param end       one past the last of the points to encode
+ * @param out       where to write the encoded bytes
+ * @return the output iterator past the last byte written
+ */
+template <class iterator_t, class output_t>
+output_t encode7(iterator_t begin, iterator_t end, output_t out) {
+  // handy lambda to turn an integer into encoded bytes
+  auto serialize = [&out](int32_t number) {
     // get the sign bit down on the least significant end to
     // make the most significant bits mostly zeros
-    number = number < 0 ? ~(number << 1) : number << 1;
+    uint32_t value = number < 0 ? ~(static_cast<uint32_t>(number) << 1)
+                                : static_cast<uint32_t>(number) << 1;
     // we take 7 bits of this at a time
-    while (number > 0x7f) {
+    while (value > 0x7f) {
       // marking the most significant bit means there are more pieces to come
-      int nextValue = (0x80 | (number & 0x7f));
-      output.push_back(static_cast<char>(nextValue));
-      number >>= 7;
+      *out++ = static_cast<char>(0x80 | (value & 0x7f));
+      value >>= 7;
     }
     // write the last chunk
-    output.push_back(static_cast<char>(number & 0x7f));
+    *out++ = static_cast<char>(value & 0x7f);
   };
 
   // this is an offset encoding so we remember the last point we saw
   int last_lon = 0, last_lat = 0;
   // for each point
-  for (const auto& p : points) {
+  for (; begin != end; ++begin) {
     // shift the decimal point x places to the right and truncate
-    int lon = static_cast<int>(floor(static_cast<double>(p.first) * 1e6));
-    int lat = static_cast<int>(floor(static_cast<double>(p.second) * 1e6));
+    int lon = static_cast<int>(floor(static_cast<double>(begin->first) * 1e6));
+    int lat = static_cast<int>(floor(static_cast<double>(begin->second) * 1e6));
     // encode each coordinate, lat first for some reason
     serialize(lat - last_lat);
     serialize(lon - last_lon);
@@ -160,6 +178,22 @@ template <class container_t> std::string encode7(const container_t& points) {
     last_lon = lon;
     last_lat = lat;
   }
+  return out;
+}
+
+/**
+ * Varint encode a container of points into a string
+ *
+ * @param points    the list of points to encode
+ * @return string   the encoded container of points
+ */
+template <class container_t> std::string encode7(const container_t& points) {
+  // a place to keep the output
+  std::string output;
+  // unless the shape is very course you should probably only need about 3 bytes
+  // per coord, which is 6 bytes with 2 coords, so we overshoot to 8 just in case
+  output.reserve(points.size() * 8);
+  encode7(points.begin(), points.end(), std::back_inserter(output));
   return output;
 }
 
@@ -0,0 +1,68 @@
+#ifndef VALHALLA_MIDGARD_FASTMATH_H_
+#define VALHALLA_MIDGARD_FASTMATH_H_
+
+#include <cmath>
+
+#include <valhalla/midgard/constants.h>
+
+namespace valhalla {
+namespace midgard {
+
+/**
+ * Polynomial approximations of the trig functions used on coordinates. They have no branches or
+ * calls into libm so that loops over arrays of coordinates can be vectorized by the compiler.
+ * fast_sin and fast_cos are within 1e-6 of sinf and cosf, fast_atan2 is within 1e-5 radians of
+ * atan2f, which is well under a meter of distance or a thousandth of a degree of heading.
+ */
+
+/**
+ * Approximates the sine of an angle.
+ * @param  x  Angle in radians, reduced to [-pi, pi] so it should stay within a few turns of 0.
+ * @return Returns the sine of the angle.
+ */
+inline float fast_sin(float x) {
+  constexpr float k2Pi = kPi * 2.0f;
+  x -= k2Pi * std::floor(x * (1.0f / k2Pi) + 0.5f);
+  // reflect into [-pi/2, pi/2] where the polynomial is accurate
+  x = x > kPiOver2 ? kPi - x : (x < -kPiOver2 ? -kPi - x : x);
+  const float x2 = x * x;
+  return x * (1.0f +
+              x2 * (-1.0f / 6.0f +
+                    x2 * (1.0f / 120.0f +
+                          x2 * (-1.0f / 5040.0f +
+                                x2 * (1.0f / 362880.0f + x2 * (-1.0f / 39916800.0f))))));
+}
+
+/**
+ * Approximates the cosine of an angle.
+ * @param  x  Angle in radians, within a few turns of 0.
+ * @return Returns the cosine of the angle.
+ */
+inline float fast_cos(float x) {
+  return fast_sin(x + kPiOver2);
+}
+
+/**
+ * Approximates the angle of the vector (x, y).
+ * @param  y  y component of the vector.
+ * @param  x  x component of the vector.
+ * @return Returns the angle in radians in the range [-pi, pi], 0 for the zero vector.
+ */
+inline float fast_atan2(float y, float x) {
+  const float ax = std::fabs(x), ay = std::fabs(y);
+  const float hi = ax > ay ? ax : ay, lo = ax > ay ? ay : ax;
+  const float a = hi > 0.0f ? lo / hi : 0.0f;
+  const float a2 = a * a;
+  float r = a * (0.99997726f +
+                 a2 * (-0.33262347f +
+                       a2 * (0.19354346f +
+                             a2 * (-0.11643287f + a2 * (0.05265332f + a2 * -0.01172120f)))));
+  r = ay > ax ? kPiOver2 - r : r;
+  r = x < 0.0f ? kPi - r : r;
+  return y < 0.0f ? -r : r;
+}
+
+} // namespace midgard
+} // namespace valhalla
+
+#endif // VALHALLA_MIDGARD_FASTMATH_H_
@@ -0,0 +1,384 @@
+#ifndef VALHALLA_MIDGARD_FLAT_HASH_H_
+#define VALHALLA_MIDGARD_FLAT_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace midgard {
+
+/**
+ * Hash for the flat hash containers. The std::hash of a GraphId, like that of the integers, is the
+ * value itself, whose low bits are mostly the level and tile. Masked down to the size of a power
+ * of 2 table that would put all of the ids of a tile in a handful of slots, so the bits are mixed
+ * (the murmur3 finalizer) to spread them over the whole table.
+ */
+template <typename Key> struct flat_hash {
+  size_t operator()(const Key& key) const {
+    uint64_t h = static_cast<uint64_t>(std::hash<Key>()(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+};
+
+namespace detail {
+
+// Gets the key out of a value of a set
+struct identity_key {
+  template <typename T> const T& operator()(const T& value) const {
+    return value;
+  }
+};
+
+// Gets the key out of a value of a map
+struct pair_key {
+  template <typename T> const typename T::first_type& operator()(const T& value) const {
+    return value.first;
+  }
+};
+
+/**
+ * Open addressing hash table with linear probing. The values are stored inline in one array so a
+ * lookup touches a couple of neighbouring slots instead of chasing a pointer to a node per entry,
+ * and inserting doesn't allocate until the table has to grow. Erasing shifts the following entries
+ * of the probe sequence back instead of leaving tombstones, so lookups never get slower over time.
+ *
+ * Unlike the std unordered containers, growing the table moves the values so references and
+ * iterators are only good until the next insert, and erasing can move another value into the
+ * erased slot. Values must be default constructible, an empty slot holds a default value.
+ */
+template <typename Value, typename Key, typename KeyOf, typename Hash, typename Equal>
+class flat_hash_table {
+public:
+  using key_type = Key;
+  using value_type = Value;
+  using size_type = size_t;
+  using hasher = Hash;
+  using key_equal = Equal;
+
+  template <typename table_t, typename value_t> class iterator_t {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_t*;
+    using reference = value_t&;
+
+    iterator_t() : table_(nullptr), index_(0) {
+    }
+    iterator_t(table_t* table, size_t index) : table_(table), index_(index) {
+    }
+    // allow an iterator to become a const_iterator
+    template <typename other_table_t, typename other_value_t>
+    iterator_t(const iterator_t<other_table_t, other_value_t>& other)
+        : table_(other.table_), index_(other.index_) {
+    }
+    reference operator*() const {
+      return table_->values_[index_];
+    }
+    pointer operator->() const {
+      return &table_->values_[index_];
+    }
+    iterator_t& operator++() {
+      index_ = table_->next_full(index_ + 1);
+      return *this;
+    }
+    iterator_t operator++(int) {
+      iterator_t previous = *this;
+      ++*this;
+      return previous;
+    }
+    template <typename other_table_t, typename other_value_t>
+    bool operator==(const iterator_t<other_table_t, other_value_t>& other) const {
+      return index_ == other.index_;
+    }
+    template <typename other_table_t, typename other_value_t>
+    bool operator!=(const iterator_t<other_table_t, other_value_t>& other) const {
+      return index_ != other.index_;
+    }
+
+  private:
+    template <typename, typename> friend class iterator_t;
+    friend class flat_hash_table;
+    table_t* table_;
+    size_t index_;
+  };
+  using iterator = iterator_t<flat_hash_table, Value>;
+  using const_iterator = iterator_t<const flat_hash_table, const Value>;
+
+  explicit flat_hash_table(size_t count = 0, const Hash& hash = Hash(), const Equal& equal = Equal())
+      : size_(0), hash_(hash), equal_(equal) {
+    reserve(count);
+  }
+
+  iterator begin() {
+    return iterator(this, next_full(0));
+  }
+  const_iterator begin() const {
+    return const_iterator(this, next_full(0));
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  iterator end() {
+    return iterator(this, values_.size());
+  }
+  const_iterator end() const {
+    return const_iterator(this, values_.size());
+  }
+  const_iterator cend() const {
+    return end();
+  }
+
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  /**
+   * Removes all of the values but keeps the memory of the table for the next use.
+   */
+  void clear() {
+    if (size_ == 0) {
+      return;
+    }
+    for (size_t i = 0; i < values_.size(); ++i) {
+      if (full_[i]) {
+        values_[i] = Value();
+        full_[i] = 0;
+      }
+    }
+    size_ = 0;
+  }
+
+  /**
+   * Makes room for count values without growing the table again.
+   * @param  count  The number of values the table should hold.
+   */
+  void reserve(size_t count) {
+    size_t capacity = kMinCapacity;
+    while (capacity * kMaxLoadNumerator < count * kMaxLoadDenominator) {
+      capacity <<= 1;
+    }
+    if (capacity > values_.size()) {
+      rehash(capacity);
+    }
+  }
+
+  iterator find(const Key& key) {
+    return iterator(this, find_index(key));
+  }
+  const_iterator find(const Key& key) const {
+    return const_iterator(this, find_index(key));
+  }
+  size_t count(const Key& key) const {
+    return find_index(key) != values_.size() ? 1 : 0;
+  }
+
+  /**
+   * Inserts the value unless there is already a value with the same key.
+   * @return Returns the iterator to the value with the key and whether it was inserted.
+   */
+  std::pair<iterator, bool> insert(const Value& value) {
+    return insert_value(Value(value));
+  }
+  std::pair<iterator, bool> insert(Value&& value) {
+    return insert_value(std::move(value));
+  }
+  template <typename... Args> std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert_value(Value(std::forward<Args>(args)...));
+  }
+
+  /**
+   * Erases the value with the key, if there is one.
+   * @return Returns the number of values erased.
+   */
+  size_t erase(const Key& key) {
+    size_t index = find_index(key);
+    if (index == values_.size()) {
+      return 0;
+    }
+    erase_index(index);
+    return 1;
+  }
+
+  /**
+   * Erases the value the iterator points to. Another value may be moved into its slot, so unlike
+   * the std containers this does not give back an iterator to continue from.
+   */
+  void erase(const_iterator pos) {
+    erase_index(pos.index_);
+  }
+
+  void swap(flat_hash_table& other) {
+    values_.swap(other.values_);
+    full_.swap(other.full_);
+    std::swap(size_, other.size_);
+    std::swap(hash_, other.hash_);
+    std::swap(equal_, other.equal_);
+  }
+
+protected:
+  // The table is grown when it would become more than 3/4 full, past that the probe sequences of
+  // linear probing start to run long
+  static constexpr size_t kMaxLoadNumerator = 3;
+  static constexpr size_t kMaxLoadDenominator = 4;
+  static constexpr size_t kMinCapacity = 8;
+
+  std::vector<Value> values_;
+  std::vector<uint8_t> full_;
+  size_t size_;
+  Hash hash_;
+  Equal equal_;
+
+  size_t home(const Key& key) const {
+    return hash_(key) & (values_.size() - 1);
+  }
+
+  size_t next_full(size_t index) const {
+    while (index < values_.size() && !full_[index]) {
+      ++index;
+    }
+    return index;
+  }
+
+  size_t find_index(const Key& key) const {
+    if (size_ == 0) {
+      return values_.size();
+    }
+    const size_t mask = values_.size() - 1;
+    for (size_t index = home(key); full_[index]; index = (index + 1) & mask) {
+      if (equal_(KeyOf()(values_[index]), key)) {
+        return index;
+      }
+    }
+    return values_.size();
+  }
+
+  std::pair<iterator, bool> insert_value(Value&& value) {
+    if ((size_ + 1) * kMaxLoadDenominator > values_.size() * kMaxLoadNumerator) {
+      rehash(values_.empty() ? size_t(kMinCapacity) : values_.size() * 2);
+    }
+    const size_t mask = values_.size() - 1;
+    size_t index = home(KeyOf()(value));
+    for (; full_[index]; index = (index + 1) & mask) {
+      if (equal_(KeyOf()(values_[index]), KeyOf()(value))) {
+        return std::make_pair(iterator(this, index), false);
+      }
+    }
+    values_[index] = std::move(value);
+    full_[index] = 1;
+    ++size_;
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  void erase_index(size_t index) {
+    // shift back every following value of the run whose home is not between the hole and itself,
+    // otherwise a lookup for it would stop at the hole
+    const size_t mask = values_.size() - 1;
+    size_t next = (index + 1) & mask;
+    while (full_[next]) {
+      size_t next_home = home(KeyOf()(values_[next]));
+      if (((next - next_home) & mask) >= ((next - index) & mask)) {
+        values_[index] = std::move(values_[next]);
+        index = next;
+      }
+      next = (next + 1) & mask;
+    }
+    values_[index] = Value();
+    full_[index] = 0;
+    --size_;
+  }
+
+  void rehash(size_t capacity) {
+    std::vector<Value> values(capacity);
+    std::vector<uint8_t> full(capacity, 0);
+    values.swap(values_);
+    full.swap(full_);
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (full[i]) {
+        size_t index = home(KeyOf()(values[i]));
+        while (full_[index]) {
+          index = (index + 1) & mask;
+        }
+        values_[index] = std::move(values[i]);
+        full_[index] = 1;
+      }
+    }
+  }
+};
+
+} // namespace detail
+
+/**
+ * Hash map stored in a flat open addressing table, see detail::flat_hash_table. It has the parts of
+ * the interface of std::unordered_map that the code base uses. The key of the pairs is not const
+ * because the table moves them around, but it must not be changed through an iterator.
+ */
+template <typename Key,
+          typename T,
+          typename Hash = flat_hash<Key>,
+          typename Equal = std::equal_to<Key>>
+class flat_hash_map
+    : public detail::flat_hash_table<std::pair<Key, T>, Key, detail::pair_key, Hash, Equal> {
+  using base_t = detail::flat_hash_table<std::pair<Key, T>, Key, detail::pair_key, Hash, Equal>;
+
+public:
+  using mapped_type = T;
+  using base_t::base_t;
+
+  /**
+   * Gets the value of the key, inserting a default value for it if there isn't one.
+   */
+  T& operator[](const Key& key) {
+    auto found = this->find(key);
+    if (found != this->end()) {
+      return found->second;
+    }
+    return this->insert_value(std::make_pair(key, T())).first->second;
+  }
+
+  T& at(const Key& key) {
+    auto found = this->find(key);
+    if (found == this->end()) {
+      throw std::out_of_range("flat_hash_map::at key not found");
+    }
+    return found->second;
+  }
+  const T& at(const Key& key) const {
+    auto found = this->find(key);
+    if (found == this->end()) {
+      throw std::out_of_range("flat_hash_map::at key not found");
+    }
+    return found->second;
+  }
+};
+
+/**
+ * Hash set stored in a flat open addressing table, see detail::flat_hash_table. It has the parts of
+ * the interface of std::unordered_set that the code base uses.
+ */
+template <typename Key, typename Hash = flat_hash<Key>, typename Equal = std::equal_to<Key>>
+class flat_hash_set : public detail::flat_hash_table<Key, Key, detail::identity_key, Hash, Equal> {
+  using base_t = detail::flat_hash_table<Key, Key, detail::identity_key, Hash, Equal>;
+
+public:
+  using base_t::base_t;
+};
+
+} // namespace midgard
+} // namespace valhalla
+
+#endif // VALHALLA_MIDGARD_FLAT_HASH_H_
@@ -1,6 +1,8 @@
 #ifndef VALHALLA_MIDGARD_GRIDDEDDATA_H_
 #define VALHALLA_MIDGARD_GRIDDEDDATA_H_
 
+#include <cstdint>
+#include <functional>
 #include <limits>
 #include <list>
 #include <map>
@@ -82,6 +84,27 @@ public:
   using feature_t = std::list<contour_t>;
   using contours_t =
       std::map<float, std::list<feature_t>, std::function<bool(const float, const float)>>;
+  // Calls work(i) for every i in [0, count), possibly concurrently, and returns once all are done
+  using parallel_for_t =
+      std::function<void(const uint32_t count, const std::function<void(uint32_t)>& work)>;
+
+  // A straight segment and the value to set along it
+  struct segment_t {
+    coord_t a;
+    coord_t b;
+    float value;
+  };
+
+  /**
+   * Set the value of every grid cell a segment passes through if it is less than the current
+   * value, for a batch of segments. Setting the least value does not depend on the order of the
+   * segments so big batches are drawn concurrently if a parallel_for is given, each call drawing
+   * the cells of its own band of rows.
+   * @param  segments      The segments to draw.
+   * @param  parallel_for  Draws the bands of rows concurrently if given.
+   */
+  void SetIfLessThan(const std::vector<segment_t>& segments,
+                     const parallel_for_t& parallel_for = nullptr);
   /**
    * TODO: implement two versions of this, leave this one for linestring contours
    * and make another for polygons
@@ -97,15 +120,31 @@ public:
    * @param generalize           Generalization factor in meters. A special value
    *                             kOptimalGeneralization will let the method choose
    *                             an optimal generalization factor based on grid size.
+   * @param parallel_for         Runs the intervals concurrently if given, each interval
+   *                             is traced and generalized on its own.
    *
    * @return contour line geometries with the larger intervals first (for rendering purposes)
    */
   contours_t GenerateContours(const std::vector<float>& contour_intervals,
                               const bool rings_only = false,
                               const float denoise = 1.f,
-                              const float generalize = 200.f) const;
+                              const float generalize = 200.f,
+                              const parallel_for_t& parallel_for = nullptr) const;
 
 protected:
+  /**
+   * Trace, clean up and generalize the contour lines of a single interval.
+   * @param contour     The interval value.
+   * @param rings_only  See GenerateContours.
+   * @param denoise     See GenerateContours.
+   * @param gen_factor  Generalization factor in meters, 0 to not generalize.
+   * @return the features of the interval
+   */
+  std::list<feature_t> GenerateContour(const float contour,
+                                       const bool rings_only,
+                                       const float denoise,
+                                       const float gen_factor) const;
+
   float max_value_;         // Maximum value stored in the tile
   std::vector<float> data_; // Data value within each tile
 };
@@ -0,0 +1,99 @@
+#ifndef VALHALLA_MIDGARD_METRICS_H_
+#define VALHALLA_MIDGARD_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace midgard {
+
+/**
+ * A registry of counters and histograms that the services update while they work and that is
+ * exported in the prometheus text format. Looking a metric up takes a lock, so callers keep the
+ * reference they get back (metrics are never removed). Updating one is lock free.
+ */
+namespace metrics {
+
+// name and value pairs that tell apart the metrics of the same name
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+// upper bounds in seconds, for the time a request or a part of it takes
+const std::vector<double> kLatencyBuckets = {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+                                             0.25,  0.5,    1.0,   2.5,  5.0,   10.0};
+
+// a count that only goes up
+class Counter {
+public:
+  Counter() : value_(0) {
+  }
+
+  void add(const uint64_t value = 1) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+protected:
+  std::atomic<uint64_t> value_;
+};
+
+// counts of the observed values below each of a fixed set of upper bounds, and their sum
+class Histogram {
+public:
+  explicit Histogram(const std::vector<double>& bounds);
+
+  void observe(const double value);
+
+  const std::vector<double>& bounds() const {
+    return bounds_;
+  }
+
+  // observations in the bucket, the one past the last bound counts what is above all of them
+  uint64_t count(const size_t bucket) const {
+    return counts_[bucket].load(std::memory_order_relaxed);
+  }
+
+  uint64_t count() const;
+
+  double sum() const {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+protected:
+  std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  std::atomic<double> sum_;
+};
+
+/**
+ * Get the counter of the given name and labels, making it on first use
+ * @param name    prometheus metric name, e.g. valhalla_tile_bytes_read_total
+ * @param help    what it counts
+ * @param labels  what tells it apart from the others of the same name
+ * @return the counter, it lives as long as the process
+ */
+Counter& GetCounter(const std::string& name, const std::string& help, const Labels& labels = {});
+
+/**
+ * Get the histogram of the given name and labels, making it on first use. The bounds only matter
+ * the first time, later look ups get the histogram that was made then.
+ */
+Histogram& GetHistogram(const std::string& name,
+                        const std::string& help,
+                        const std::vector<double>& bounds = kLatencyBuckets,
+                        const Labels& labels = {});
+
+// all of the metrics in the prometheus text exposition format
+std::string Expose();
+
+} // namespace metrics
+} // namespace midgard
+} // namespace valhalla
+
+#endif // VALHALLA_MIDGARD_METRICS_H_
@@ -5,7 +5,10 @@
 
 #include <assert.h>
 #include <bitset>
+#include <cmath>
 #include <numeric>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace valhalla {
@@ -120,6 +123,14 @@ struct LocationReferencePoint {
 // Line locations, p.19, section 3.1
 // Only line location with 2 location reference points are supported
 struct LineLocation {
+  LineLocation(const LocationReferencePoint& first,
+               const std::vector<LocationReferencePoint>& intermediate,
+               const LocationReferencePoint& last,
+               float poff = 0.f,
+               float noff = 0.f)
+      : first(first), last(last), intermediate(intermediate), poff(poff), noff(noff) {
+  }
+
   LineLocation(const std::string& reference) {
     //  Line location data size: 16 + (n-2)*7 + [0/1/2] bytes
     if (reference.size() < 16)
@@ -2,11 +2,14 @@
 #define VALHALLA_MJOLNIR_SEQUENCE_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -16,6 +19,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -68,7 +72,9 @@
 #define MAP_ANONYMOUS 0x20
 #define MAP_FAILED (reinterpret_cast<void*>(static_cast<LONG_PTR>(-1)))
 #define POSIX_MADV_NORMAL 0     // ignored
+#define POSIX_MADV_RANDOM 1     // ignored
 #define POSIX_MADV_SEQUENTIAL 2 // ignored
+#define POSIX_MADV_WILLNEED 3   // ignored
 
 inline void* mmap(void* addr, size_t length, int prot, int flags, int fd, long long offset) {
   (void)addr; // ignored
@@ -213,6 +219,20 @@ public:
     }
   }
 
+  // hint at how a range of elements is going to be used, ie. POSIX_MADV_WILLNEED to page it in
+  void advise(size_t index, size_t n, int advice) {
+#ifndef _MSC_VER
+    if (ptr && index < count) {
+      n = std::min(n, count - index);
+      // the range has to start on a page boundary
+      static const size_t page_size = sysconf(_SC_PAGESIZE);
+      auto* begin = static_cast<char*>(ptr) + index * sizeof(T);
+      auto offset = reinterpret_cast<uintptr_t>(begin) % page_size;
+      posix_madvise(begin - offset, n * sizeof(T) + offset, advice);
+    }
+#endif
+  }
+
   T* get() const {
     return static_cast<T*>(ptr);
   }
@@ -258,7 +278,7 @@ public:
       : file(new std::fstream(file_name,
                               std::ios_base::binary | std::ios_base::in | std::ios_base::out |
                                   (create ? std::ios_base::trunc : std::ios_base::ate))),
-        file_name(file_name) {
+        file_name(file_name), readahead_window(0), prefetched(0) {
 
     // crack open the file
     if (!*file) {
@@ -289,6 +309,14 @@ public:
     }
   }
 
+  // for sequences that are mostly scanned front to back. the whole map is advised as sequential
+  // and as the scan moves along the next window of elements is asked to be paged in ahead of it
+  void readahead(size_t window = 1024 * 1024 * 16 / sizeof(T)) {
+    readahead_window = window;
+    prefetched = 0;
+    memmap.advise(0, memmap.size(), window ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_NORMAL);
+  }
+
   // finds the first matching object by scanning O(n)
   // assumes nothing about the order of the file
   // the predicate should be something like an equality check
@@ -307,19 +335,113 @@ public:
     return npos;
   }
 
-  // sort the file based on the predicate
+  // sort the file based on the predicate. if the file is larger than the buffer or more than one
+  // thread is asked for, chunks of at most buffer_size elements are sorted in place concurrently
+  // and then merged into a new file which replaces this one
   void sort(const std::function<bool(const T&, const T&)>& predicate,
-            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T)) {
-    using queue_t =
-        std::map<T, std::list<std::fstream>::iterator, std::function<bool(const T&, const T&)>>;
-
+            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T),
+            unsigned int threads = 1) {
     flush();
     // if no elements we are done
     if (memmap.size() == 0) {
       return;
     }
-    std::sort(static_cast<T*>(memmap), static_cast<T*>(memmap) + memmap.size(), predicate);
-    return;
+    T* begin = static_cast<T*>(memmap);
+    size_t count = memmap.size();
+    threads = std::max(threads, 1u);
+    if (threads == 1 && count <= buffer_size) {
+      std::sort(begin, begin + count, predicate);
+      return;
+    }
+
+    // cut it into chunks, at least one per thread
+    size_t chunk_size = std::max(std::min(buffer_size, (count + threads - 1) / threads),
+                                 static_cast<size_t>(1));
+    std::vector<std::pair<T*, T*>> chunks;
+    for (size_t i = 0; i < count; i += chunk_size) {
+      chunks.emplace_back(begin + i, begin + std::min(i + chunk_size, count));
+    }
+
+    // sort the chunks on the threads
+    std::atomic<size_t> next_chunk(0);
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> pool;
+    for (unsigned int i = 0; i < threads; ++i) {
+      pool.emplace_back([&chunks, &next_chunk, &predicate, &errors, i]() {
+        try {
+          for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++) {
+            std::sort(chunks[c].first, chunks[c].second, predicate);
+          }
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+    }
+    for (auto& thread : pool) {
+      thread.join();
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+    if (chunks.size() == 1) {
+      return;
+    }
+
+    // k-way merge of the chunks into a new file, ties go to the earlier chunk
+    auto later = [&predicate, &chunks](size_t a, size_t b) {
+      if (predicate(*chunks[b].first, *chunks[a].first)) {
+        return true;
+      }
+      return !predicate(*chunks[a].first, *chunks[b].first) && a > b;
+    };
+    std::vector<size_t> heap(chunks.size());
+    for (size_t i = 0; i < heap.size(); ++i) {
+      heap[i] = i;
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+    std::string merged_name = file_name + ".merge";
+    {
+      std::ofstream merged(merged_name, std::ios_base::binary | std::ios_base::trunc);
+      if (!merged) {
+        throw std::runtime_error("sequence: " + merged_name + ": " + strerror(errno));
+      }
+      std::vector<T> out;
+      out.reserve(write_buffer.capacity());
+      while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto& chunk = chunks[heap.back()];
+        out.push_back(*chunk.first++);
+        if (chunk.first == chunk.second) {
+          heap.pop_back();
+        } else {
+          std::push_heap(heap.begin(), heap.end(), later);
+        }
+        if (out.size() == out.capacity() || heap.empty()) {
+          merged.write(static_cast<const char*>(static_cast<const void*>(out.data())),
+                       out.size() * sizeof(T));
+          out.clear();
+        }
+      }
+      if (!merged.flush()) {
+        throw std::runtime_error("sequence: " + merged_name + ": " + strerror(errno));
+      }
+    }
+
+    // swap the merged file in for this one
+    memmap.unmap();
+    file.reset();
+    if (std::remove(file_name.c_str()) || std::rename(merged_name.c_str(), file_name.c_str())) {
+      throw std::runtime_error("sequence: " + file_name + ": " + strerror(errno));
+    }
+    file.reset(new std::fstream(file_name, std::ios_base::binary | std::ios_base::in |
+                                               std::ios_base::out | std::ios_base::ate));
+    if (!*file) {
+      throw std::runtime_error("sequence: " + file_name + ": " + strerror(errno));
+    }
+    memmap.map(file_name, count);
+    prefetched = 0;
   }
 
   // perform an volatile operation on all the items of this sequence
@@ -355,6 +477,9 @@ public:
       file->flush();
       memmap.map(file_name, memmap.size() + write_buffer.size());
       write_buffer.clear();
+      if (readahead_window) {
+        readahead(readahead_window);
+      }
     }
   }
 
@@ -398,16 +523,17 @@ public:
       return operator T();
     }
     iterator& operator++() {
-      ++index;
+      parent->prefetch(++index);
       return *this;
     }
     iterator operator++(int) {
       auto other = *this;
-      ++index;
+      parent->prefetch(++index);
       return other;
     }
     iterator& operator+=(size_t offset) {
       index += offset;
+      parent->prefetch(index);
       return *this;
     }
     iterator operator+(size_t offset) {
@@ -474,6 +600,7 @@ public:
 
   iterator at(size_t index) {
     // dump to file and make an element
+    prefetch(index);
     return iterator(this, index);
   }
 
@@ -504,10 +631,25 @@ public:
   }
 
 protected:
+  // keep the next window of elements on its way in once the cursor gets close to it
+  void prefetch(size_t index) {
+    if (readahead_window == 0 || index + readahead_window < prefetched) {
+      return;
+    }
+    size_t begin = std::max(prefetched, index);
+    size_t end = std::min(index + 2 * readahead_window, memmap.size());
+    if (begin < end) {
+      memmap.advise(begin, end - begin, POSIX_MADV_WILLNEED);
+      prefetched = end;
+    }
+  }
+
   std::shared_ptr<std::fstream> file;
   std::string file_name;
   std::vector<T> write_buffer;
   mem_map<T> memmap;
+  size_t readahead_window;
+  size_t prefetched;
 };
 
 struct tar {
@@ -574,7 +716,13 @@ struct tar {
     }
   };
 
-  tar(const std::string& tar_file, bool regular_files_only = true)
+  // When the first file is named index_file it says where the others are, so the archive is not
+  // walked any further and only that file is in the contents. Without traversing the file is only
+  // mapped, for callers that know where the files are from elsewhere
+  tar(const std::string& tar_file,
+      bool regular_files_only = true,
+      const std::string& index_file = "",
+      bool traverse = true)
       : tar_file(tar_file), corrupt_blocks(0) {
     // get the file size
     struct stat s;
@@ -589,6 +737,9 @@ struct tar {
 
     // map the file
     mm.map(tar_file, s.st_size);
+    if (!traverse) {
+      return;
+    }
 
     // rip through the tar to see whats in it noting that most tars end with 2 empty blocks
     // but we can concatenate tars and get empty blocks in between so we'll just be pretty
@@ -609,6 +760,10 @@ struct tar {
         contents.emplace(std::piecewise_construct, std::forward_as_tuple(std::string{h->name}),
                          std::forward_as_tuple(position, size));
       }
+      if (!index_file.empty() && position == mm.get() + sizeof(header_t) &&
+          strncmp(h->name, index_file.c_str(), sizeof(h->name)) == 0) {
+        break;
+      }
       // every entry's data is rounded to the nearst header_t sized "block"
       auto blocks = static_cast<size_t>(std::ceil(static_cast<double>(size) / sizeof(header_t)));
       position += blocks * sizeof(header_t);
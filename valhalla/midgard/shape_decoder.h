@@ -1,15 +1,67 @@
 #ifndef VALHALLA_MIDGARD_SHAPE_DECODER_H_
 #define VALHALLA_MIDGARD_SHAPE_DECODER_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <stdexcept>
 
 namespace valhalla {
 namespace midgard {
 
+/**
+ * Input iterator over the points of an encoded shape. The points are decoded one at a time as
+ * the iterator advances so walking a shape does not allocate. The iterator keeps its own copy
+ * of the decoder state so any number of them can walk the same encoded shape.
+ */
+template <typename Point, typename Decoder> class ShapeIterator {
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = Point;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const Point*;
+  using reference = const Point&;
+
+  explicit ShapeIterator(const Decoder& decoder) : decoder(decoder), done(decoder.empty()) {
+    if (!done) {
+      point = this->decoder.pop();
+    }
+  }
+  reference operator*() const {
+    return point;
+  }
+  pointer operator->() const {
+    return &point;
+  }
+  ShapeIterator& operator++() noexcept(false) {
+    done = decoder.empty();
+    if (!done) {
+      point = decoder.pop();
+    }
+    return *this;
+  }
+  ShapeIterator operator++(int) noexcept(false) {
+    ShapeIterator previous = *this;
+    ++*this;
+    return previous;
+  }
+  bool operator==(const ShapeIterator& other) const {
+    return done == other.done && decoder.position() == other.decoder.position();
+  }
+  bool operator!=(const ShapeIterator& other) const {
+    return !(*this == other);
+  }
+
+private:
+  Decoder decoder;
+  Point point;
+  bool done;
+};
+
 template <typename Point> class Shape7Decoder {
 public:
   Shape7Decoder(const char* begin, const size_t size, const int = 7)
-      : begin(begin), end(begin + size) {
+      : begin_(begin), end_(begin + size) {
   }
   Point pop() noexcept(false) {
     lat = next(lat);
@@ -17,12 +69,59 @@ public:
     return Point(double(lon) * 1e-6, double(lat) * 1e-6);
   }
   bool empty() const {
-    return begin == end;
+    return begin_ == end_;
+  }
+  const char* position() const {
+    return begin_;
+  }
+
+  /**
+   * Decodes all of the points not yet popped in a single pass over the bytes, which skips the
+   * per number bookkeeping of pop() when the whole shape is wanted anyway.
+   * @param out  Output iterator the points are written to.
+   * @return Returns the output iterator past the last point written.
+   */
+  template <typename output_t> output_t pop_all(output_t out) noexcept(false) {
+    int32_t result = 0, shift = 0;
+    bool have_lat = false;
+    for (; begin_ != end_; ++begin_) {
+      // take the least significant 7 bits shifted into place, if the most significant bit is
+      // set there is more to this number
+      int32_t byte = int32_t(*begin_);
+      result |= (byte & 0x7f) << shift;
+      if (byte & 0x80) {
+        shift += 7;
+        continue;
+      }
+      // handle the bit flipping and add to previous since its an offset
+      int32_t delta = (result & 1 ? ~result : result) >> 1;
+      result = shift = 0;
+      if (!have_lat) {
+        lat += delta;
+      } else {
+        lon += delta;
+        *out++ = Point(double(lon) * 1e-6, double(lat) * 1e-6);
+      }
+      have_lat = !have_lat;
+    }
+    if (shift || have_lat) {
+      throw std::runtime_error("Bad encoded polyline");
+    }
+    return out;
+  }
+
+  // Iterate over the points not yet popped, e.g. with a range based for loop
+  using iterator = ShapeIterator<Point, Shape7Decoder>;
+  iterator begin() const {
+    return iterator(*this);
+  }
+  iterator end() const {
+    return iterator(Shape7Decoder(end_, 0));
   }
 
 private:
-  const char* begin;
-  const char* end;
+  const char* begin_;
+  const char* end_;
   int32_t lat = 0;
   int32_t lon = 0;
 
@@ -33,7 +132,7 @@ private:
         throw std::runtime_error("Bad encoded polyline");
       }
       // take the least significant 7 bits shifted into place
-      byte = int32_t(*begin++);
+      byte = int32_t(*begin_++);
       result |= (byte & 0x7f) << shift;
       shift += 7;
       // if the most significant bit is set there is more to this number
@@ -46,7 +145,7 @@ private:
 template <typename Point> class Shape5Decoder {
 public:
   Shape5Decoder(const char* begin, const size_t size, const double precision = 1e-6)
-      : begin(begin), end(begin + size), prec(precision) {
+      : begin_(begin), end_(begin + size), prec(precision) {
   }
   Point pop() noexcept(false) {
     lat = next(lat);
@@ -54,12 +153,59 @@ public:
     return Point(double(lon) * prec, double(lat) * prec);
   }
   bool empty() const {
-    return begin == end;
+    return begin_ == end_;
+  }
+  const char* position() const {
+    return begin_;
+  }
+
+  /**
+   * Decodes all of the points not yet popped in a single pass over the bytes, which skips the
+   * per number bookkeeping of pop() when the whole shape is wanted anyway.
+   * @param out  Output iterator the points are written to.
+   * @return Returns the output iterator past the last point written.
+   */
+  template <typename output_t> output_t pop_all(output_t out) noexcept(false) {
+    int32_t result = 0, shift = 0;
+    bool have_lat = false;
+    for (; begin_ != end_; ++begin_) {
+      // take the least significant 5 bits shifted into place, if the most significant bit is
+      // set there is more to this number
+      int32_t byte = int32_t(*begin_) - 63;
+      result |= (byte & 0x1f) << shift;
+      if (byte >= 0x20) {
+        shift += 5;
+        continue;
+      }
+      // handle the bit flipping and add to previous since its an offset
+      int32_t delta = result & 1 ? ~(result >> 1) : (result >> 1);
+      result = shift = 0;
+      if (!have_lat) {
+        lat += delta;
+      } else {
+        lon += delta;
+        *out++ = Point(double(lon) * prec, double(lat) * prec);
+      }
+      have_lat = !have_lat;
+    }
+    if (shift || have_lat) {
+      throw std::runtime_error("Bad encoded polyline");
+    }
+    return out;
+  }
+
+  // Iterate over the points not yet popped, e.g. with a range based for loop
+  using iterator = ShapeIterator<Point, Shape5Decoder>;
+  iterator begin() const {
+    return iterator(*this);
+  }
+  iterator end() const {
+    return iterator(Shape5Decoder(end_, 0, prec));
   }
 
 private:
-  const char* begin;
-  const char* end;
+  const char* begin_;
+  const char* end_;
   int32_t lat = 0;
   int32_t lon = 0;
   double prec;
@@ -72,7 +218,7 @@ private:
         throw std::runtime_error("Bad encoded polyline");
       }
       // take the least significant 5 bits shifted into place
-      byte = int32_t(*begin++) - 63;
+      byte = int32_t(*begin_++) - 63;
       result |= (byte & 0x1f) << shift;
       shift += 5;
       // if the most significant bit is set there is more to this number
@@ -7,6 +7,8 @@
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/constants.h>
@@ -361,6 +363,16 @@ public:
   std::unordered_map<int32_t, std::unordered_set<unsigned short>>
   Intersect(const container_t& line_string) const;
 
+  /**
+   * Intersect the linestring with the tiles like Intersect does but without hashing, for
+   * long linestrings. Only works when there are at most 64 sub cells per tile.
+   * @param line_string  the linestring to be tested against the cells
+   * @return             each tile intersected, in increasing order, along with a mask which has
+   *                     the bit of each of its intersected sub cell indices set
+   */
+  template <class container_t>
+  std::vector<std::pair<int32_t, uint64_t>> IntersectBins(const container_t& line_string) const;
+
   /**
    * Intersect the bounding box with the tiles to see which tiles and sub-cells
    * (a.k.a bins) it intersects with. This can be used to reduce the number of
@@ -382,6 +394,14 @@ public:
   std::function<std::tuple<int32_t, unsigned short, float>()> ClosestFirst(const coord_t& seed) const;
 
 protected:
+  /**
+   * Marks the global sub cells the linestring passes through
+   * @param line_string  the linestring to be rasterized
+   * @param mark         called with the tile and the sub cell index of each cell it touches
+   */
+  template <class container_t, class mark_t>
+  void Rasterize(const container_t& line_string, const mark_t& mark) const;
+
   // Does the tile bounds wrap in the x direction (e.g. at longitude = 180)
   bool wrapx_;
 
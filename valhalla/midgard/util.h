@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -602,6 +603,63 @@ struct projector_t {
     return {u.first + bx * scale, u.second + by * scale};
   }
 
+  // the number of segments closest() projects onto at once
+  static constexpr size_t kBatchSegments = 8;
+
+  /**
+   * Projects onto the segments between consecutive points of a shape and keeps the closest. The
+   * segments are done kBatchSegments at a time with the same branch free arithmetic per segment
+   * so that the compiler can put a batch in vector registers (AVX2, NEON) where the target has
+   * them and it stays plain scalar code where it doesnt. The result is exactly what projecting
+   * onto each segment in order with operator() would find.
+   * @param shape        the points of the shape
+   * @param count        the number of points
+   * @param point        set to the closest point when one is closer than sq_distance
+   * @param sq_distance  the squared distance to beat, set to that of the closest point
+   * @return the index of the segment the closest point is on or count if none were closer
+   */
+  size_t closest(const PointLL* shape, size_t count, PointLL& point, float& sq_distance) const {
+    size_t closest = count;
+    for (size_t first = 0; first + 1 < count; first += kBatchSegments) {
+      // copy the segments into lanes, padding with the last one so a batch is always full
+      size_t lanes = std::min(kBatchSegments, count - 1 - first);
+      double ux[kBatchSegments], uy[kBatchSegments], vx[kBatchSegments], vy[kBatchSegments];
+      for (size_t i = 0; i < kBatchSegments; ++i) {
+        const auto* u = shape + first + std::min(i, lanes - 1);
+        ux[i] = u[0].first;
+        uy[i] = u[0].second;
+        vx[i] = u[1].first;
+        vy[i] = u[1].second;
+      }
+
+      // same as operator() but selecting the end points instead of returning early
+      float px[kBatchSegments], py[kBatchSegments], distances[kBatchSegments];
+      for (size_t i = 0; i < kBatchSegments; ++i) {
+        auto bx = vx[i] - ux[i];
+        auto by = vy[i] - uy[i];
+        auto bx2 = bx * lon_scale;
+        auto sq = bx2 * bx2 + by * by;
+        auto scale = (lng - ux[i]) * lon_scale * bx2 + (lat - uy[i]) * by;
+        auto ratio = scale / sq;
+        px[i] = scale <= 0.0 ? ux[i] : (scale >= sq ? vx[i] : ux[i] + bx * ratio);
+        py[i] = scale <= 0.0 ? uy[i] : (scale >= sq ? vy[i] : uy[i] + by * ratio);
+      }
+      for (size_t i = 0; i < kBatchSegments; ++i) {
+        distances[i] = approx.DistanceSquared(PointLL(px[i], py[i]));
+      }
+
+      // the first of the closest wins just like it would one segment at a time
+      for (size_t i = 0; i < lanes; ++i) {
+        if (distances[i] < sq_distance) {
+          sq_distance = distances[i];
+          point = PointLL(px[i], py[i]);
+          closest = first + i;
+        }
+      }
+    }
+    return closest;
+  }
+
   // critical data
   double lon_scale;
   double lat;
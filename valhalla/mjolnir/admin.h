@@ -6,12 +6,18 @@
 #include <boost/geometry/geometries/polygon.hpp>
 #include <boost/geometry/io/wkt/wkt.hpp>
 #include <boost/geometry/multi/geometries/multi_polygon.hpp>
+#include <boost/optional.hpp>
 #include <cstdint>
+#include <memory>
 #include <sqlite3.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
+
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/pointll.h>
+#include <valhalla/midgard/sequence.h>
 #include <valhalla/mjolnir/graphtilebuilder.h>
 
 using namespace valhalla::baldr;
@@ -51,6 +57,60 @@ uint32_t GetMultiPolyId(const std::unordered_multimap<uint32_t, multi_polygon_ty
 uint32_t GetMultiPolyId(const std::unordered_multimap<uint32_t, multi_polygon_type>& polys,
                         const PointLL& ll);
 
+/**
+ * Finds which of the polygons of a tile a point is in the same way GetMultiPolyId does, but
+ * splits the tile into a grid of cells first. A cell that is entirely covered by every polygon
+ * touching it has the same answer for all of its points, so only the points in cells a polygon
+ * boundary runs through are tested against the polygons, and only against those touching the
+ * cell. Cells are worked out the first time a point falls in them.
+ */
+class PolygonGrid {
+public:
+  /**
+   * Constructor.
+   * @param  polys      unordered map of polys, they are not copied so have to outlive the grid.
+   * @param  bounds     bounding box of the tile.
+   * @param  graphtile  graphtilebuilder used to prefer state polys over country polys, like
+   *                    GetMultiPolyId does for admins. Leave it out for timezones.
+   * @param  divisions  number of cells along each side of the tile.
+   */
+  PolygonGrid(const std::unordered_multimap<uint32_t, multi_polygon_type>& polys,
+              const AABB2<PointLL>& bounds,
+              GraphTileBuilder* graphtile = nullptr,
+              const uint32_t divisions = 16);
+
+  /**
+   * Get the polygon index of a point within the tile.
+   * @param  ll  point that needs to be checked.
+   * @return Returns the index of the polygon or 0 if it is in none of them.
+   */
+  uint32_t Get(const PointLL& ll);
+
+protected:
+  using poly_t = std::unordered_multimap<uint32_t, multi_polygon_type>::value_type;
+
+  struct cell_t {
+    bool ready = false;   // whether the polys touching the cell were found yet
+    bool covered = false; // whether every poly touching the cell covers all of it
+    uint32_t index = 0;   // the answer when covered
+    std::vector<const poly_t*> polys;
+  };
+
+  // Work out which polys touch the cell and whether they cover it
+  void Prepare(cell_t& cell, const uint32_t row, const uint32_t col);
+
+  // Pick the poly a point is in from the candidates, all of them are taken to cover it if covered
+  uint32_t Find(const std::vector<const poly_t*>& polys, const point_type& p, bool covered) const;
+
+  const std::unordered_multimap<uint32_t, multi_polygon_type>& polys_;
+  AABB2<PointLL> bounds_;
+  GraphTileBuilder* graphtile_;
+  uint32_t divisions_;
+  double cell_width_;
+  double cell_height_;
+  std::vector<cell_t> cells_;
+};
+
 /**
  * Get the timezone polys from the db
  * @param  db_handle    sqlite3 db handle
@@ -92,6 +152,103 @@ GetAdminInfo(sqlite3* db_handle,
              const AABB2<PointLL>& aabb,
              GraphTileBuilder& tilebuilder);
 
+/**
+ * A polygon read from a PolygonFile along with what it describes.
+ */
+struct PackedPolygon {
+  // For admins the country name, state name, country iso and state iso. For timezones the tz id
+  std::vector<std::string> names;
+  bool drive_on_right;
+  bool allow_intersection_names;
+  multi_polygon_type polygon;
+};
+
+/**
+ * The admin or timezone polygons of a database packed into a binary file that is mapped into
+ * memory, so that tile builders can find the polygons of a tile without running spatial queries
+ * against the database from every thread. The file holds the names and coordinates of each
+ * polygon followed by a table with the bounding box of each one, which is what is searched.
+ */
+class PolygonFile {
+public:
+  enum class Kind : uint32_t { kAdmins = 1, kTimeZones = 2 };
+
+  /**
+   * Constructor. Throws if the file is not a polygon file.
+   * @param  file  polygon file location.
+   */
+  explicit PolygonFile(const std::string& file);
+
+  /**
+   * Get what kind of polygons are in the file.
+   */
+  Kind kind() const;
+
+  /**
+   * Get the polygons that intersect a bounding box, in the order they were written.
+   * @param  aabb  bb of the tile
+   */
+  std::vector<PackedPolygon> Get(const AABB2<PointLL>& aabb) const;
+
+protected:
+  midgard::mem_map<char> memory_;
+  Kind kind_;
+  uint64_t count_;
+  const char* records_;
+};
+
+/**
+ * Open a polygon file if one is configured and it exists.
+ * @param  file  polygon file location.
+ * @param  kind  what kind of polygons the file has to have.
+ * @return Returns nullptr when there is no such file or it has the wrong kind of polygons, the db
+ *         is to be used instead then.
+ */
+std::unique_ptr<PolygonFile> OpenPolygonFile(const boost::optional<std::string>& file,
+                                             PolygonFile::Kind kind);
+
+/**
+ * Pack the admin polys of an admin db into a polygon file. States come first like they do from
+ * GetAdminInfo.
+ * @param  db_handle  sqlite3 db handle
+ * @param  file       polygon file location.
+ * @return Returns the number of polygons written.
+ */
+size_t WriteAdminPolygons(sqlite3* db_handle, const std::string& file);
+
+/**
+ * Pack the timezone polys of a timezone db into a polygon file.
+ * @param  db_handle  sqlite3 db handle
+ * @param  file       polygon file location.
+ * @return Returns the number of polygons written.
+ */
+size_t WriteTimeZonePolygons(sqlite3* db_handle, const std::string& file);
+
+/**
+ * Get the timezone polys from a polygon file
+ * @param  file         polygon file of timezones
+ * @param  aabb         bb of the tile
+ */
+std::unordered_multimap<uint32_t, multi_polygon_type> GetTimeZones(const PolygonFile& file,
+                                                                   const AABB2<PointLL>& aabb);
+
+/**
+ * Get the admin polys that intersect with the tile bounding box from a polygon file.
+ * @param  file             polygon file of admins
+ * @param  drive_on_right   unordered map that indicates if a country drives on right side of the
+ * road
+ * @param  allow_intersection_names   unordered map that indicates if we call out intersections
+ * names for this country
+ * @param  aabb             bb of the tile
+ * @param  tilebuilder      Graph tile builder
+ */
+std::unordered_multimap<uint32_t, multi_polygon_type>
+GetAdminInfo(const PolygonFile& file,
+             std::unordered_map<uint32_t, bool>& drive_on_right,
+             std::unordered_map<uint32_t, bool>& allow_intersection_names,
+             const AABB2<PointLL>& aabb,
+             GraphTileBuilder& tilebuilder);
+
 /**
  * Get all the country access records from the db and save them to a map.
  * @param  db_handle    sqlite3 db handle
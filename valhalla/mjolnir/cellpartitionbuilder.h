@@ -0,0 +1,38 @@
+#ifndef VALHALLA_MJOLNIR_CELLPARTITIONBUILDER_H
+#define VALHALLA_MJOLNIR_CELLPARTITIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the multilevel cell partition of the routing graph for customizable
+ * route planning. Unlike a contraction hierarchy the partition does not depend on a costing, so
+ * thor can customize it for the options of any request. The cells of the lowest level split the
+ * local tiles 8x8 and every level up merges 2x2 cells, the number of levels comes from
+ * mjolnir.cell_partition_levels. Shortcuts are left out, the cells stand in for them.
+ */
+class CellPartitionBuilder {
+public:
+  /**
+   * Build the partition from the tiles in the mjolnir tile dir.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+
+  /**
+   * Get the cell a location is in.
+   * @param  ll     Location.
+   * @param  level  Level of the partition, 0 is the smallest cells.
+   * @return Returns the cell, its row and column on the grid of the level.
+   */
+  static uint32_t Cell(const midgard::PointLL& ll, const uint32_t level);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CELLPARTITIONBUILDER_H
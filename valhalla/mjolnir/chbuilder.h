@@ -0,0 +1,47 @@
+#ifndef VALHALLA_MJOLNIR_CHBUILDER_H
+#define VALHALLA_MJOLNIR_CHBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/chgraph.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build contraction hierarchies for the auto, bicycle and
+ * pedestrian costings with their default options. Unlike the shortcut
+ * builder, which only merges chains of edges within a hierarchy level, every
+ * node of the routing graph is contracted in order of importance and the
+ * resulting upward and downward edges are written next to the tiles for the
+ * contraction hierarchy query in thor. Bicycles and pedestrians get little
+ * out of the road hierarchy, so their long routes gain the most. The
+ * hierarchy is node based: turn costs and turn restrictions are not part of
+ * it.
+ */
+class CHBuilder {
+public:
+  /**
+   * Build the contraction hierarchies of the costings listed in
+   * mjolnir.contraction_hierarchy_costings (auto if none are) from the tiles
+   * in the mjolnir tile dir.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+
+  /**
+   * Contracts a graph given as a list of edges between node indexes. Node
+   * ids, ranks and the costing options of the returned graph are left to the
+   * caller, shortcuts are appended to the edges.
+   * @param  node_count  Number of nodes.
+   * @param  edges       Edges of the graph (from, to, cost, secs and edgeid set).
+   * @return Returns the contraction hierarchy.
+   */
+  static baldr::CHGraph Contract(const uint32_t node_count, std::vector<baldr::CHEdge>&& edges);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CHBUILDER_H
@@ -89,6 +89,19 @@ public:
    */
   void set_encoded_shape(const std::string& encoded_shape);
 
+  /**
+   * Set the elevation profile of the edge, samples spaced evenly from the start to the end
+   * of the shape.
+   * @param  elevations  Elevations in meters.
+   */
+  void set_elevation_profile(const std::vector<double>& elevations);
+
+  /**
+   * Set the encoded elevation profile.
+   * @param  encoded_elevation  Encoded elevation profile (see EdgeInfo)
+   */
+  void set_encoded_elevation_profile(const std::string& encoded_elevation);
+
   /**
    * Get the size of this edge info (without padding).
    * @return  Returns the size in bytes of this object.
@@ -122,6 +135,9 @@ protected:
   // Lat,lng shape of the edge
   std::string encoded_shape_;
 
+  // Elevation profile along the shape
+  std::string encoded_elevation_;
+
   friend std::ostream& operator<<(std::ostream& os, const EdgeInfoBuilder& id);
 };
 
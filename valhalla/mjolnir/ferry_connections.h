@@ -63,9 +63,12 @@ uint32_t GetBestNonFerryClass(const std::map<Edge, size_t>& edges);
 
 /**
  * Form the shortest path from the start node until a node that
- * touches the specified road classification.
+ * touches the specified road classification. Only reads the edges so
+ * several paths can be formed at once.
+ * @return  Returns the indexes of the edges along the path whose
+ *          classification is below the specified one.
  */
-uint32_t ShortestPath(const uint32_t start_node_idx,
+std::vector<size_t> ShortestPath(const uint32_t start_node_idx,
                       const uint32_t node_idx,
                       sequence<OSMWay>& ways,
                       sequence<OSMWayNode>& way_nodes,
@@ -88,14 +91,16 @@ bool ShortFerry(const uint32_t node_index,
 
 /**
  * Reclassify edges from a ferry along the shortest path to the
- * specified road classification.
+ * specified road classification. The paths are formed on several
+ * threads and the edges along them are upgraded once all are formed.
  */
 void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& way_nodes_file,
                                 const std::string& nodes_file,
                                 const std::string& edges_file,
                                 const uint32_t rc,
-                                DataQuality& stats);
+                                DataQuality& stats,
+                                const unsigned int thread_count = 1);
 
 } // namespace mjolnir
 } // namespace valhalla
@@ -0,0 +1,50 @@
+#ifndef VALHALLA_MJOLNIR_GRAPHCOMPONENTS_H
+#define VALHALLA_MJOLNIR_GRAPHCOMPONENTS_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/nodeinfo.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to label the directed edges with the size of the strongly connected components
+ * they are in. Loki can then tell that an edge on the main network has plenty of reach with a
+ * look at the edge instead of expanding from it, which only has to be done on small islands.
+ */
+class GraphComponents {
+public:
+  /**
+   * Find the strongly connected components of the graph each of the modes in kComponentAccess
+   * can use and label every directed edge with the size class of the components at its ends.
+   * @param  pt  Property tree with the mjolnir configuration.
+   * @return  Returns the number of directed edges with a label for at least one mode.
+   */
+  static size_t Label(const boost::property_tree::ptree& pt);
+
+  /**
+   * Whether a mode can certainly use an edge. This must be at least as strict as the edge filter
+   * of every costing with that access mode, otherwise a label could promise a reach the costing
+   * does not get.
+   * @param  edge  Directed edge.
+   * @param  mode  Index of the access mode in kComponentAccess.
+   * @return  Returns true if the edge is part of the graph of the mode.
+   */
+  static bool Usable(const baldr::DirectedEdge& edge, const uint32_t mode);
+
+  /**
+   * Whether a mode can certainly pass through a node, the node filter counterpart of Usable.
+   * @param  node  Node.
+   * @param  mode  Index of the access mode in kComponentAccess.
+   * @return  Returns true if the node is part of the graph of the mode.
+   */
+  static bool Usable(const baldr::NodeInfo& node, const uint32_t mode);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_GRAPHCOMPONENTS_H
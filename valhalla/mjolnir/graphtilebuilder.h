@@ -7,6 +7,7 @@
 #include <fstream>
 #include <iostream>
 #include <list>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -15,6 +16,7 @@
 
 #include <valhalla/baldr/admin.h>
 #include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/graphtile.h>
 #include <valhalla/baldr/graphtileheader.h>
 #include <valhalla/baldr/nodetransition.h>
@@ -65,6 +67,13 @@ public:
    */
   void StoreTileData();
 
+  /**
+   * Output the tile to a file in another directory than the one it was read from, e.g. so that
+   * the original tile can still be read by others while the new one is being built.
+   * @param  tile_dir  Base directory path to store the tile in.
+   */
+  void StoreTileData(const std::string& tile_dir);
+
   /**
    * Update a graph tile with new nodes and directed edges. Assumes no new
    * nodes or edges are added. Attributes within existing nodes and edges
@@ -267,6 +276,14 @@ public:
    */
   void set_mean_elevation(const uint32_t offset, const float elev);
 
+  /**
+   * Set the elevation profile of the EdgeInfo given the edge info offset. This requires
+   * a serialized tile builder. The offsets of the edge infos change when the tile is stored.
+   * @param offset Edge info offset.
+   * @param elevations Elevations evenly spaced along the shape.
+   */
+  void set_elevation_profile(const uint32_t offset, const std::vector<double>& elevations);
+
   /**
    * Add a name to the text list.
    * @param  name  Name/text to add.
@@ -399,6 +416,60 @@ public:
                       const GraphTile* tile,
                       const std::array<std::vector<GraphId>, kBinCount>& more_bins);
 
+  /**
+   * Gets the bounding boxes of the shapes of the edges in the bins of the tile.
+   * @param tile    the tile whose bins are bounded
+   * @param reader  to get at the edges in the bins, they can be in other tiles
+   * @return a box for every edge id in the bins, in the same order
+   */
+  static std::vector<BinBounds> BoundBins(const GraphTile* tile, GraphReader& reader);
+
+  /**
+   * Rewrites the tile with the bounding boxes of the edges in its bins appended, replacing the
+   * ones it had. Everything else is copied as is. The tile is written to a temporary file which
+   * is then renamed over it so threads reading the tile at the same time see either version.
+   * @param tile_dir   Base tile directory
+   * @param tile       the tile whose bins are bounded
+   * @param bounds     a box for every edge id in the bins, in the same order
+   */
+  static void AddBinBounds(const std::string& tile_dir,
+                           const GraphTile* tile,
+                           const std::vector<BinBounds>& bounds);
+
+  /**
+   * Finds the edges each shortcut in the tile supersedes. They are the edges alike the shortcut
+   * from the one it supersedes at its begin node to its end node, adding up to its length, and
+   * are searched depth first so that edges alike but not on the shortcut are backed out of.
+   * @param tile    the tile whose shortcuts are expanded
+   * @param reader  to get at the superseded edges, they can be in other tiles
+   * @return the superseded edges by the index of the shortcut, shortcuts whose edges could not
+   *         be found are left out
+   */
+  static std::map<uint32_t, std::vector<GraphId>> ExpandShortcuts(const GraphTile* tile,
+                                                                  GraphReader& reader);
+
+  /**
+   * Rewrites the tile with the edges its shortcuts supersede appended, replacing the ones it
+   * had. Everything else is copied as is. The tile is written to a temporary file which is then
+   * renamed over it so threads reading the tile at the same time see either version.
+   * @param tile_dir    Base tile directory
+   * @param tile        the tile whose shortcuts are expanded
+   * @param expansions  the superseded edges by the index of the shortcut
+   */
+  static void AddShortcutExpansions(const std::string& tile_dir,
+                                    const GraphTile* tile,
+                                    const std::map<uint32_t, std::vector<GraphId>>& expansions);
+
+  /**
+   * Rewrites the tile with its edge info, text list and lane connectivity deflated into one
+   * block, which readers only inflate once one of those sections is used. Everything else is
+   * copied as is. Tiles which are already compressed or would not get smaller are left alone.
+   * @param tile_dir   Base tile directory
+   * @param tile       the tile to compress
+   * @return true if the tile was rewritten
+   */
+  static bool CompressColdSections(const std::string& tile_dir, const GraphTile* tile);
+
   /**
    * Get the turn lane builder at the specified index.
    * @param  idx  Index of the turn lane builder.
@@ -466,6 +537,9 @@ protected:
                            : std::make_tuple(edgeindex, nodeb, nodea);
   }
 
+  // Move the edge info offsets of the directed edges after edge infos changed size
+  void UpdateEdgeInfoOffsets();
+
   // Write all edgeinfo items to specified stream
   void SerializeEdgeInfosToOstream(std::ostream& out) const;
 
@@ -531,6 +605,7 @@ protected:
   size_t edge_info_offset_ = 0;
   std::unordered_map<edge_tuple, size_t, EdgeTupleHasher> edge_offset_map_;
   std::unordered_map<uint32_t, EdgeInfoBuilder*> edgeinfo_offset_map_;
+  bool edgeinfo_resized_ = false;
 
   // The edgeinfo list
   std::list<EdgeInfoBuilder> edgeinfo_list_;
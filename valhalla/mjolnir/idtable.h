@@ -2,9 +2,10 @@
 #define VALHALLA_MJOLNIR_IDTABLE_H
 
 #include <algorithm>
-#include <cmath>
+#include <bitset>
 #include <cstdint>
-#include <midgard/logging.h>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace valhalla {
@@ -12,20 +13,22 @@ namespace mjolnir {
 
 /**
  * A method for marking OSM Ids that are used by ways/nodes/relations.
- * Uses a vector where 1 bit is used for each possible Id.
- * So for a maximum OSM Id of 4 billion this uses 500MB memory
+ * Uses 1 bit for each possible Id, kept in fixed size chunks which are only
+ * allocated once an Id within them is set. So ranges of Ids that are never
+ * used cost nothing and growing the table past the maximum Id only adds
+ * chunks instead of copying the whole bitset. Once marking is done the table
+ * can also map the set Ids to dense indices (rank) and back (select).
  */
 class IdTable {
 public:
+  // Ids per chunk, 2MB of bits each
+  static constexpr uint64_t kChunkIds = static_cast<uint64_t>(1) << 24;
+
   /**
    * Constructor
-   * @param   maxosmid   Maximum OSM Id to support.
+   * @param   maxosmid   Maximum OSM Id to support. Ids above it can still be set.
    */
-  IdTable(const uint64_t maxosmid) {
-    // Create a vector to mark bits. Initialize to 0.
-    bitmarkers_.resize((maxosmid / 64) + 1, 0);
-    // Set this to the actual maximum as dictated by the storage
-    maxosmid_ = bitmarkers_.size() * static_cast<uint64_t>(64) - 1;
+  IdTable(const uint64_t maxosmid) : chunks_(maxosmid / kChunkIds + 1), ranked_(false) {
   }
 
   /**
@@ -39,8 +42,15 @@ public:
    * @param   osmid   OSM Id of the way/node/relation.
    */
   inline void set(const uint64_t id) {
-    auto idx = maybe_resize(id);
-    bitmarkers_[idx] |= static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    uint64_t chunk = id / kChunkIds;
+    if (chunk >= chunks_.size()) {
+      chunks_.resize(chunk + 1);
+    }
+    if (!chunks_[chunk]) {
+      chunks_[chunk].reset(new uint64_t[kChunkWords]());
+    }
+    chunks_[chunk][(id % kChunkIds) / 64] |= static_cast<uint64_t>(1) << (id % 64);
+    ranked_ = false;
   }
 
   /**
@@ -48,10 +58,10 @@ public:
    * @param  id  OSM Id
    * @return  Returns true if the OSM Id is used. False if not.
    */
-  inline const bool get(const uint64_t id) {
-    return id > maxosmid_ ? false
-                          : bitmarkers_[id / 64] &
-                                (static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64)));
+  inline const bool get(const uint64_t id) const {
+    uint64_t chunk = id / kChunkIds;
+    return chunk < chunks_.size() && chunks_[chunk] &&
+           (chunks_[chunk][(id % kChunkIds) / 64] & (static_cast<uint64_t>(1) << (id % 64)));
   }
 
   /**
@@ -59,30 +69,122 @@ public:
    * @return maximum id
    */
   inline uint64_t max() const {
-    return maxosmid_;
+    return chunks_.size() * kChunkIds - 1;
+  }
+
+  /**
+   * Counts the set Ids below the given Id, for a set Id this is its dense index.
+   * The ranks are worked out on first use after the last set.
+   * @param  id  OSM Id
+   * @return Returns the number of set Ids less than id.
+   */
+  uint64_t rank(const uint64_t id) {
+    build_ranks();
+    uint64_t chunk = id / kChunkIds;
+    if (chunk >= chunks_.size()) {
+      return chunk_ranks_.back();
+    }
+    uint64_t rank = chunk_ranks_[chunk];
+    if (!chunks_[chunk]) {
+      return rank;
+    }
+    uint64_t word = (id % kChunkIds) / 64;
+    uint64_t block = word / kBlockWords;
+    rank += block_ranks_[chunk][block];
+    const uint64_t* words = chunks_[chunk].get();
+    for (uint64_t w = block * kBlockWords; w < word; ++w) {
+      rank += popcount(words[w]);
+    }
+    uint64_t below = (static_cast<uint64_t>(1) << (id % 64)) - 1;
+    return rank + popcount(words[word] & below);
+  }
+
+  /**
+   * Finds the set Id with the given dense index, the inverse of rank.
+   * @param  index  Dense index, must be less than the number of set Ids.
+   * @return Returns the OSM Id.
+   */
+  uint64_t select(const uint64_t index) {
+    build_ranks();
+    if (index >= chunk_ranks_.back()) {
+      throw std::out_of_range("IdTable select past the number of set ids");
+    }
+    // the last chunk starting at or below the index, this one has set ids
+    auto starts = std::upper_bound(chunk_ranks_.begin(), chunk_ranks_.end(), index);
+    uint64_t chunk = starts - chunk_ranks_.begin() - 1;
+    uint64_t remaining = index - chunk_ranks_[chunk];
+    const auto& blocks = block_ranks_[chunk];
+    uint64_t block =
+        std::upper_bound(blocks.begin(), blocks.end(), remaining) - blocks.begin() - 1;
+    remaining -= blocks[block];
+    const uint64_t* words = chunks_[chunk].get();
+    uint64_t word = block * kBlockWords;
+    for (uint64_t count; (count = popcount(words[word])) <= remaining; ++word) {
+      remaining -= count;
+    }
+    uint64_t bits = words[word];
+    for (; remaining > 0; --remaining) {
+      bits &= bits - 1;
+    }
+    return chunk * kChunkIds + word * 64 + ctz(bits);
+  }
+
+  /**
+   * Gets the number of set Ids.
+   * @return number of set Ids
+   */
+  uint64_t count() {
+    build_ranks();
+    return chunk_ranks_.back();
   }
 
 private:
+  static constexpr uint64_t kChunkWords = kChunkIds / 64;
+  // Words between the stored counts within a chunk
+  static constexpr uint64_t kBlockWords = 8;
+
+  static inline uint64_t popcount(const uint64_t word) {
+    return std::bitset<64>(word).count();
+  }
+
+  // the zeros below the lowest set bit
+  static inline uint64_t ctz(const uint64_t word) {
+    return popcount((word & (~word + 1)) - 1);
+  }
+
   /**
-   * Resizes the internal storage and adjusts maxosmid_ if needed
-   * the idea is that we dont need to actually do this very often
-   *
-   * @param the id which needs to fit in storage
-   * @returns the index holding the bit
+   * Counts the set Ids before each chunk and before each block within a chunk
+   * so rank and select only have to look at a few words.
    */
-  inline uint64_t maybe_resize(const uint64_t id) {
-    // we dont double it because that could be huge, so we stay conservative
-    uint64_t idx = id / 64;
-    if (id > maxosmid_) {
-      LOG_WARN("Max osmid exceeded bitset, resizing to fit id: " + std::to_string(id));
-      bitmarkers_.resize(std::ceil(idx * 1.01 + 1), 0);
-      maxosmid_ = bitmarkers_.size() * static_cast<uint64_t>(64) - 1;
+  void build_ranks() {
+    if (ranked_) {
+      return;
+    }
+    chunk_ranks_.assign(chunks_.size() + 1, 0);
+    block_ranks_.clear();
+    block_ranks_.resize(chunks_.size());
+    for (size_t c = 0; c < chunks_.size(); ++c) {
+      uint64_t rank = 0;
+      if (chunks_[c]) {
+        auto& blocks = block_ranks_[c];
+        blocks.resize(kChunkWords / kBlockWords);
+        const uint64_t* words = chunks_[c].get();
+        for (uint64_t w = 0; w < kChunkWords; ++w) {
+          if (w % kBlockWords == 0) {
+            blocks[w / kBlockWords] = rank;
+          }
+          rank += popcount(words[w]);
+        }
+      }
+      chunk_ranks_[c + 1] = chunk_ranks_[c] + rank;
     }
-    return idx;
+    ranked_ = true;
   }
 
-  uint64_t maxosmid_;
-  std::vector<uint64_t> bitmarkers_;
+  std::vector<std::unique_ptr<uint64_t[]>> chunks_;
+  std::vector<uint64_t> chunk_ranks_;
+  std::vector<std::vector<uint32_t>> block_ranks_;
+  bool ranked_;
 };
 } // namespace mjolnir
 } // namespace valhalla
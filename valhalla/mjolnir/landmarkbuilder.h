@@ -0,0 +1,53 @@
+#ifndef VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+#define VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/landmarks.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+// An edge of the graph landmarks are found on, between node indexes
+struct LandmarkEdge {
+  uint32_t from;
+  uint32_t to;
+  float length;
+};
+
+/**
+ * Class used to pick landmarks and find the lengths of the shortest paths between them and every
+ * node, for the ALT (A*, landmarks and triangle inequality) heuristic of the path algorithms in
+ * thor. There is one set of landmarks per access mode in kLandmarkAccess, each over every edge
+ * that mode is allowed on.
+ */
+class LandmarkBuilder {
+public:
+  /**
+   * Build the landmarks of each access mode from the tiles in the mjolnir tile dir.
+   * @param  pt  Property tree with the mjolnir configuration.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+
+  /**
+   * Picks landmarks far away from each other and finds the lengths of the shortest paths from
+   * each to every node and back. The access mode and the tiles of the returned landmarks are left
+   * to the caller, its landmarks are node indexes.
+   * @param  node_count  Number of nodes.
+   * @param  edges       Edges of the graph.
+   * @param  count       Number of landmarks to pick, fewer if the graph is too small.
+   * @param  resolution  Meters each unit of the stored lengths stands for.
+   * @return Returns the landmarks.
+   */
+  static baldr::Landmarks Compute(const uint32_t node_count,
+                                  const std::vector<LandmarkEdge>& edges,
+                                  const uint32_t count,
+                                  const float resolution);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_LANDMARKBUILDER_H
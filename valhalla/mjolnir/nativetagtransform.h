@@ -0,0 +1,31 @@
+#ifndef VALHALLA_MJOLNIR_NATIVETAGTRANSFORM_H_
+#define VALHALLA_MJOLNIR_NATIVETAGTRANSFORM_H_
+
+#include <valhalla/mjolnir/luatagtransform.h>
+#include <valhalla/mjolnir/osmdata.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Transforms the tags of OSM nodes, ways and relations the way lua/graph.lua does, with its
+ * tables compiled into lookup tables. This saves building a Lua table from the tags of every
+ * element and copying the result back, which LuaTagTransform has to do. Custom scripts still
+ * need LuaTagTransform.
+ */
+class NativeTagTransform {
+public:
+  /**
+   * Transforms the tags of an element like the nodes_proc, ways_proc and rels_proc functions
+   * of lua/graph.lua.
+   * @param type  the type of the element
+   * @param tags  the tags of the element
+   * @return the transformed tags, empty if the element is of no use
+   */
+  Tags Transform(OSMType type, const Tags& tags) const;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_NATIVETAGTRANSFORM_H_
@@ -5,13 +5,13 @@
 #include <map>
 #include <memory>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include <valhalla/mjolnir/osmaccessrestriction.h>
 #include <valhalla/mjolnir/osmnode.h>
 #include <valhalla/mjolnir/osmrestriction.h>
 #include <valhalla/mjolnir/osmway.h>
+#include <valhalla/mjolnir/sortedmultimap.h>
 #include <valhalla/mjolnir/uniquenames.h>
 
 namespace valhalla {
@@ -43,15 +43,18 @@ struct OSMLaneConnectivity {
 };
 
 // Data types used within OSMData. Note that any maps using OSM way Id as a key can be
-// 32 bit (OSM nodes require 64 bits, but ways do not)
-using RestrictionsMultiMap = std::unordered_multimap<uint32_t, OSMRestriction>;
-using ViaSet = std::unordered_set<uint32_t>;
-using AccessRestrictionsMultiMap = std::unordered_multimap<uint32_t, OSMAccessRestriction>;
-using BikeMultiMap = std::unordered_multimap<uint32_t, OSMBike>;
-using OSMLaneConnectivityMultiMap = std::unordered_multimap<uint32_t, OSMLaneConnectivity>;
-
-// OSMString map uses the way Id as the key and the name index into UniqueNames as the value
-using OSMStringMap = std::unordered_map<uint32_t, uint32_t>;
+// 32 bit (OSM nodes require 64 bits, but ways do not). These are flat sorted arrays rather
+// than hash maps since on a planet they hold hundreds of millions of entries, they are appended
+// to while parsing and have to be sorted (see OSMData::sort_maps) before being looked up
+using RestrictionsMultiMap = SortedMultiMap<uint32_t, OSMRestriction>;
+using ViaSet = SortedSet<uint32_t>;
+using AccessRestrictionsMultiMap = SortedMultiMap<uint32_t, OSMAccessRestriction>;
+using BikeMultiMap = SortedMultiMap<uint32_t, OSMBike>;
+using OSMLaneConnectivityMultiMap = SortedMultiMap<uint32_t, OSMLaneConnectivity>;
+
+// OSMString map uses the way Id as the key and the name index into UniqueNames as the value.
+// While parsing a way can have several entries, sorting joins them into one
+using OSMStringMap = SortedMultiMap<uint32_t, uint32_t>;
 
 /**
  * Simple container for OSM data.
@@ -76,6 +79,12 @@ struct OSMData {
    */
   bool read_from_unique_names_file(const std::string& tile_dir);
 
+  /**
+   * Sort the maps so they can be looked up, done once parsing is finished. Entries of the way
+   * ref maps for the same way are joined into one ref.
+   */
+  void sort_maps();
+
   /**
    * add the direction information to the forward or reverse map for relations.
    */
@@ -31,8 +31,10 @@
 #ifndef __OSMPBFPARSER__
 #define __OSMPBFPARSER__
 
+#include <cstdint>
 #include <fstream>
 #include <string>
+#include <vector>
 
 // this describes the low-level blob storage
 #include <valhalla/proto/fileformat.pb.h>
@@ -75,14 +77,36 @@ struct Callback {
   virtual void
   relation_callback(const uint64_t osmid, const Tags& tags, const std::vector<Member>& members) = 0;
   virtual void changeset_callback(const uint64_t changeset_id) = 0;
+  // whether the callback looks at the tags of an object, the tags of the others are not copied
+  // out of the string table of their block and their callbacks get no tags
+  virtual bool wants_tags(const Interest type, const uint64_t osmid) {
+    return true;
+  }
+};
+
+// where the blobs of a file are and what they hold. an empty index gets filled in by the parse
+// that is given it, later parses of the same file given the index only read the blobs holding
+// something they are interested in
+struct BlobIndex {
+  struct Entry {
+    uint64_t offset;  // file offset of the blob header size
+    uint8_t contents; // Interest bits of the objects in the blob
+  };
+  std::vector<Entry> entries;
 };
 
 // the parser used to get data out of the osmpbf file
 class Parser {
 public:
   Parser() = delete;
-  // parse the pbf file for the things you are interested in
-  static void parse(std::ifstream& file, const Interest interest, Callback& callback);
+  // parse the pbf file for the things you are interested in. with more than one thread the
+  // blobs are inflated and decoded concurrently while the callbacks still happen in file order
+  // on the calling thread, so callbacks need not be thread safe
+  static void parse(std::ifstream& file,
+                    const Interest interest,
+                    Callback& callback,
+                    const unsigned int threads = 1,
+                    BlobIndex* index = nullptr);
   // clean up protobuf library level memory, this will make protobuf unusable after its called
   static void free();
 };
@@ -0,0 +1,179 @@
+#ifndef VALHALLA_MJOLNIR_SORTEDMULTIMAP_H
+#define VALHALLA_MJOLNIR_SORTEDMULTIMAP_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * A multimap kept as one flat array of key value pairs. It is filled in by appending (while
+ * parsing) and then sorted once, after which lookups are binary searches. This costs only the
+ * size of the pairs themselves instead of a node and bucket per element like a hash map, and the
+ * sorted pairs can be written to and read back from a file as they are.
+ */
+template <class Key, class Value> class SortedMultiMap {
+public:
+  // Trivially copyable stand in for std::pair so the array can be written out in one go
+  struct value_type {
+    Key first;
+    Value second;
+    value_type() = default;
+    value_type(const Key& k, const Value& v) : first(k), second(v) {
+    }
+  };
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  SortedMultiMap() : sorted_(true) {
+  }
+
+  /**
+   * Adds a pair. The map has to be sorted again before looking anything up.
+   * @param  v  Key and value to add.
+   */
+  void insert(const value_type& v) {
+    sorted_ = sorted_ && (items_.empty() || !(v.first < items_.back().first));
+    items_.push_back(v);
+  }
+
+  /**
+   * Sorts the pairs by key. Values of the same key keep the order they were inserted in.
+   */
+  void sort() {
+    if (!sorted_) {
+      std::stable_sort(items_.begin(), items_.end(),
+                       [](const value_type& a, const value_type& b) { return a.first < b.first; });
+      sorted_ = true;
+    }
+    items_.shrink_to_fit();
+  }
+
+  /**
+   * Replaces the contents with pairs that are already sorted by key, for example ones read back
+   * from a file that was written from a sorted map.
+   * @param  items  Pairs sorted by key.
+   */
+  void assign_sorted(std::vector<value_type>&& items) {
+    items_ = std::move(items);
+    sorted_ = true;
+  }
+
+  /**
+   * Returns the range of pairs with the given key. If there are none both iterators are end().
+   * @param  key  Key to look for.
+   */
+  std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+    check_sorted();
+    auto lower = std::lower_bound(items_.cbegin(), items_.cend(), key,
+                                  [](const value_type& a, const Key& k) { return a.first < k; });
+    if (lower == items_.cend() || key < lower->first) {
+      return {items_.cend(), items_.cend()};
+    }
+    auto upper = std::upper_bound(lower, items_.cend(), key,
+                                  [](const Key& k, const value_type& a) { return k < a.first; });
+    return {lower, upper};
+  }
+
+  /**
+   * Returns the first pair with the given key or end() if there is none.
+   * @param  key  Key to look for.
+   */
+  const_iterator find(const Key& key) const {
+    return equal_range(key).first;
+  }
+
+  const_iterator begin() const {
+    return items_.cbegin();
+  }
+  const_iterator end() const {
+    return items_.cend();
+  }
+  size_t size() const {
+    return items_.size();
+  }
+  bool empty() const {
+    return items_.empty();
+  }
+  bool sorted() const {
+    return sorted_;
+  }
+  const std::vector<value_type>& items() const {
+    return items_;
+  }
+
+protected:
+  void check_sorted() const {
+    if (!sorted_) {
+      throw std::logic_error("SortedMultiMap must be sorted before looking anything up");
+    }
+  }
+
+  std::vector<value_type> items_;
+  bool sorted_;
+};
+
+/**
+ * Same idea as SortedMultiMap for a set of keys. Sorting also drops duplicates.
+ */
+template <class Key> class SortedSet {
+public:
+  using const_iterator = typename std::vector<Key>::const_iterator;
+
+  SortedSet() : sorted_(true) {
+  }
+
+  void insert(const Key& key) {
+    sorted_ = sorted_ && (keys_.empty() || keys_.back() < key);
+    keys_.push_back(key);
+  }
+
+  void sort() {
+    if (!sorted_) {
+      std::sort(keys_.begin(), keys_.end());
+      keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+      sorted_ = true;
+    }
+    keys_.shrink_to_fit();
+  }
+
+  void assign_sorted(std::vector<Key>&& keys) {
+    keys_ = std::move(keys);
+    sorted_ = true;
+  }
+
+  const_iterator find(const Key& key) const {
+    if (!sorted_) {
+      throw std::logic_error("SortedSet must be sorted before looking anything up");
+    }
+    auto found = std::lower_bound(keys_.cbegin(), keys_.cend(), key);
+    return found != keys_.cend() && !(key < *found) ? found : keys_.cend();
+  }
+
+  const_iterator begin() const {
+    return keys_.cbegin();
+  }
+  const_iterator end() const {
+    return keys_.cend();
+  }
+  size_t size() const {
+    return keys_.size();
+  }
+  bool empty() const {
+    return keys_.empty();
+  }
+  const std::vector<Key>& items() const {
+    return keys_;
+  }
+
+protected:
+  std::vector<Key> keys_;
+  bool sorted_;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_SORTEDMULTIMAP_H
@@ -1,12 +1,21 @@
 #ifndef VALHALLA_MJOLNIR_UTIL_H_
 #define VALHALLA_MJOLNIR_UTIL_H_
 
+#include <algorithm>
+#include <atomic>
 #include <boost/property_tree/ptree.hpp>
+#include <chrono>
+#include <cstdint>
 #include <list>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/pointll.h>
 
 namespace valhalla {
@@ -25,10 +34,11 @@ enum class BuildStage : int8_t {
   kBss = 6,
   kHierarchy = 7,
   kShortcuts = 8,
-  kRestrictions = 9,
-  kElevation = 10,
-  kValidate = 11,
-  kCleanup = 12
+  kContraction = 9,
+  kRestrictions = 10,
+  kElevation = 11,
+  kValidate = 12,
+  kCleanup = 13
 };
 
 // Convert string to BuildStage
@@ -43,6 +53,7 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"bss", BuildStage::kBss},
        {"hierarchy", BuildStage::kHierarchy},
        {"shortcuts", BuildStage::kShortcuts},
+       {"contraction", BuildStage::kContraction},
        {"restrictions", BuildStage::kRestrictions},
        {"elevation", BuildStage::kElevation},
        {"validate", BuildStage::kValidate},
@@ -64,6 +75,7 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kBss), "bss"},
        {static_cast<int8_t>(BuildStage::kHierarchy), "hierarchy"},
        {static_cast<int8_t>(BuildStage::kShortcuts), "shortcuts"},
+       {static_cast<int8_t>(BuildStage::kContraction), "contraction"},
        {static_cast<int8_t>(BuildStage::kRestrictions), "restrictions"},
        {static_cast<int8_t>(BuildStage::kElevation), "elevation"},
        {static_cast<int8_t>(BuildStage::kValidate), "validate"},
@@ -105,6 +117,248 @@ bool shapes_match(const std::vector<midgard::PointLL>& shape1,
  */
 uint32_t compute_curvature(const std::list<midgard::PointLL>& shape);
 
+/**
+ * Hands out the tiles of a build stage to its threads one at a time, most expensive first. Tiles
+ * differ in size by orders of magnitude so splitting them into fixed chunks per thread leaves
+ * most threads idle at the end, and starting with the biggest ones keeps a thread from picking
+ * up a huge tile just as the others run out of work.
+ */
+template <class T> class TileScheduler {
+public:
+  /**
+   * Constructor.
+   * @param  tiles  Tiles (or whatever describes a unit of work) with an estimate of the cost of
+   *                working on each. Ties keep their order.
+   */
+  explicit TileScheduler(std::vector<std::pair<T, size_t>> tiles) : next_(0) {
+    std::stable_sort(tiles.begin(), tiles.end(),
+                     [](const std::pair<T, size_t>& a, const std::pair<T, size_t>& b) {
+                       return a.second > b.second;
+                     });
+    tiles_.reserve(tiles.size());
+    for (auto& tile : tiles) {
+      tiles_.emplace_back(std::move(tile.first));
+    }
+  }
+
+  /**
+   * Constructor for tiles that are to be handed out in the given order, ie. to keep threads
+   * working on tiles near each other when they share a cache of something geographic.
+   * @param  tiles  Tiles (or whatever describes a unit of work) in the order to work on them.
+   */
+  explicit TileScheduler(std::vector<T> tiles) : tiles_(std::move(tiles)), next_(0) {
+  }
+
+  /**
+   * Claims the next tile to work on. Safe to call from any number of threads at once.
+   * @param  tile  Set to the claimed tile.
+   * @return Returns false once all tiles have been claimed.
+   */
+  bool next(T& tile) {
+    size_t i = next_++;
+    if (i >= tiles_.size()) {
+      return false;
+    }
+    tile = tiles_[i];
+    return true;
+  }
+
+  size_t size() const {
+    return tiles_.size();
+  }
+
+protected:
+  std::vector<T> tiles_;
+  std::atomic<size_t> next_;
+};
+
+/**
+ * Hands out tiles to a fixed set of workers, each starting on its own stretch of the given order.
+ * With the tiles in spatial order a worker keeps to one region, so whatever it caches about the
+ * tiles around the one it works on is likely still there for the next one. A worker that is
+ * done with its stretch steals the far half of the longest stretch left, which keeps the work
+ * balanced without a worker jumping around between regions for every tile.
+ */
+template <class T> class StealingTileScheduler {
+public:
+  /**
+   * Constructor.
+   * @param  tiles    Tiles (or whatever describes a unit of work) in the order to work on them.
+   * @param  workers  Number of workers that will claim tiles.
+   */
+  StealingTileScheduler(std::vector<T> tiles, size_t workers) : tiles_(std::move(tiles)) {
+    workers = std::max(workers, static_cast<size_t>(1));
+    stretches_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+      stretches_.emplace_back(tiles_.size() * i / workers, tiles_.size() * (i + 1) / workers);
+    }
+  }
+
+  /**
+   * Claims the next tile for a worker. Safe to call from any number of threads at once as long
+   * as each uses its own worker index.
+   * @param  worker  Index of the worker, less than the number of workers.
+   * @param  tile    Set to the claimed tile.
+   * @return Returns false once all tiles have been claimed.
+   */
+  bool next(size_t worker, T& tile) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto& stretch = stretches_[worker];
+    if (stretch.first == stretch.second) {
+      // Steal the back half of the longest stretch. The last tile of a stretch is left to its
+      // worker, which is about to claim it anyway.
+      auto victim = std::max_element(stretches_.begin(), stretches_.end(),
+                                     [](const std::pair<size_t, size_t>& a,
+                                        const std::pair<size_t, size_t>& b) {
+                                       return a.second - a.first < b.second - b.first;
+                                     });
+      if (victim->second - victim->first < 2) {
+        return false;
+      }
+      size_t split = victim->second - (victim->second - victim->first) / 2;
+      stretch = {split, victim->second};
+      victim->second = split;
+    }
+    tile = tiles_[stretch.first++];
+    return true;
+  }
+
+  size_t size() const {
+    return tiles_.size();
+  }
+
+protected:
+  std::vector<T> tiles_;
+  // Per worker the range of tiles it has left to claim
+  std::vector<std::pair<size_t, size_t>> stretches_;
+  std::mutex lock_;
+};
+
+/**
+ * Estimates the cost of working on tiles already in the tile directory by the size of their
+ * files, for handing to a TileScheduler.
+ * @param  tile_dir  Directory the tiles are in.
+ * @param  tiles     Tiles to estimate.
+ * @return Returns the tiles with their estimated cost.
+ */
+std::vector<std::pair<baldr::GraphId, size_t>>
+TileCosts(const std::string& tile_dir, const std::unordered_set<baldr::GraphId>& tiles);
+
+/**
+ * Finds the tiles of a level that have to be rebuilt when the OSM data within some areas has
+ * changed. These are the tiles the areas touch plus the tiles around them, because the edges
+ * leaving the neighbouring tiles end on the (renumbered) nodes of the changed tiles.
+ * @param  changed  Bounding boxes of the changed ways and nodes.
+ * @param  level    Hierarchy level of the tiles.
+ * @return Returns the tiles to rebuild.
+ */
+std::unordered_set<baldr::GraphId>
+DirtyTiles(const std::vector<midgard::AABB2<midgard::PointLL>>& changed, const uint8_t level);
+
+/**
+ * Adds the bounding boxes of the shapes of the edges in the bins to every tile that has bins,
+ * which lets searches skip the edges too far away to matter without decoding their shapes.
+ * It has to run once the bins are done, tiles rewritten by a GraphTileBuilder or with new
+ * bins afterwards lose their bounds.
+ * @param config  Used to find the tiles and how many threads to bound them with
+ * @return Returns the number of tiles that got bounds.
+ */
+size_t AddBinBounds(const boost::property_tree::ptree& config);
+
+/**
+ * Adds the edges every shortcut supersedes to the tiles with shortcuts, which makes recovering
+ * the edges of a shortcut a lookup. It has to run once the edges of the tiles are final, tiles
+ * rewritten by a GraphTileBuilder afterwards lose their expansions.
+ * @param config  Used to find the tiles and how many threads to expand them with
+ * @return Returns the number of tiles that got expansions.
+ */
+size_t AddShortcutExpansions(const boost::property_tree::ptree& config);
+
+/**
+ * Deflates the edge info, text list and lane connectivity of every tile in the tile directory
+ * so they take less space, readers inflate them once a tile's names or shapes are used.
+ * Tiles rewritten by a GraphTileBuilder afterwards are stored uncompressed again.
+ * @param config  Used to find the tiles and how many threads to compress them with
+ * @return Returns the number of tiles that were compressed.
+ */
+size_t CompressColdSections(const boost::property_tree::ptree& config);
+
+/**
+ * Writes every tile in the tile directory into a single tar, indexed by a first file the
+ * GraphReader loads instead of walking the tar and with the data of each tile starting on a page
+ * boundary. The tiles are copied in on several threads, each to where the index puts it.
+ * @param config     Used to find the tiles and how many threads to copy them with
+ * @param extract    Where to write the extract, it replaces any file there once it is complete
+ * @return Returns the number of tiles in the extract.
+ */
+size_t WriteTileExtract(const boost::property_tree::ptree& config, const std::string& extract);
+
+/**
+ * Measures what the stages of a tile build take: wall and cpu time, peak resident memory, the
+ * bytes read and written, and the size of the tile directory after each of them. Builds run on
+ * machines sized by these numbers.
+ */
+class BuildProfile {
+public:
+  // What one stage took
+  struct Usage {
+    BuildStage stage;
+    double wall_seconds;
+    double cpu_seconds;            // Of all of the threads of the process
+    uint64_t peak_rss_bytes;       // Most memory resident at once during the stage
+    uint64_t bytes_read;           // Through read calls, whether from storage or the page cache
+    uint64_t bytes_written;        // Through write calls, ie. appending to sequences and tiles
+    uint64_t storage_bytes_read;   // That had to come from storage, mapped files included
+    uint64_t storage_bytes_written; // That went to storage, mapped files included
+    uint64_t tile_dir_bytes;       // Size of the tiles and temporary files after the stage
+  };
+
+  // Measures a stage from its construction to its destruction
+  class Stage {
+  public:
+    Stage(BuildProfile& profile, const BuildStage stage);
+    ~Stage();
+
+  protected:
+    struct counters_t {
+      std::chrono::steady_clock::time_point time;
+      double cpu_seconds;
+      uint64_t bytes_read;
+      uint64_t bytes_written;
+      uint64_t storage_bytes_read;
+      uint64_t storage_bytes_written;
+    };
+    static counters_t Now();
+
+    BuildProfile& profile_;
+    BuildStage stage_;
+    counters_t start_;
+  };
+
+  /**
+   * Constructor
+   * @param  tile_dir     Directory the tiles are built in.
+   * @param  output_file  File the json summary is rewritten to after every stage, empty for none.
+   */
+  BuildProfile(const std::string& tile_dir, const std::string& output_file = "");
+
+  const std::vector<Usage>& stages() const {
+    return stages_;
+  }
+
+  /**
+   * The measurements as json: {"stages":[{"stage":"parse","wall_seconds":...},...]}
+   */
+  std::string ToJson() const;
+
+protected:
+  void Add(const Usage& usage);
+
+  std::string tile_dir_;
+  std::string output_file_;
+  std::vector<Usage> stages_;
+};
+
 /**
  * Build an entire valhalla tileset give a config file and some input pbfs. The
  * tile building process is split into stages. This method allows either the entire
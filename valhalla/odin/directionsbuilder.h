@@ -1,6 +1,8 @@
 #ifndef VALHALLA_ODIN_DIRECTIONSBUILDER_H_
 #define VALHALLA_ODIN_DIRECTIONSBUILDER_H_
 
+#include <cstdint>
+#include <functional>
 #include <list>
 
 #include <valhalla/odin/enhancedtrippath.h>
@@ -23,12 +25,28 @@ public:
    * calls PopulateDirectionsLeg to transform the maneuver list into the
    * trip directions.
    *
-   * @param api   the protobuf object containing the request, the path and a place
-   *              to store the resulting directions
+   * @param api      the protobuf object containing the request, the path and a place
+   *                 to store the resulting directions
+   * @param threads  how many legs can be narrated at the same time, including on the
+   *                 calling thread, 0 uses the hardware concurrency
+   * @param interrupt  called on the calling thread before each leg it narrates, throws when
+   *                   the directions should be abandoned
    */
-  static void Build(Api& api);
+  static void
+  Build(Api& api, uint32_t threads = 1, const std::function<void()>* interrupt = nullptr);
 
 protected:
+  /**
+   * Builds the directions of one leg. Legs are independent of each other so this
+   * can run for several of them at the same time.
+   *
+   * @param options     The directions options.
+   * @param trip_path   The leg of the path, its headings get updated.
+   * @param trip_directions  Where to put the directions of the leg.
+   */
+  static void
+  BuildLeg(const Options& options, TripLeg& trip_path, DirectionsLeg& trip_directions);
+
   /**
    * Update the heading of ~0 length edges.
    *
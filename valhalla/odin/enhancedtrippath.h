@@ -22,102 +22,6 @@ class EnhancedTripLeg_Edge;
 class EnhancedTripLeg_Node;
 class EnhancedTripLeg_Admin;
 
-class EnhancedTripLeg {
-public:
-  EnhancedTripLeg(TripLeg& trip_path);
-
-  const std::string& shape() const {
-    return trip_path_.shape();
-  }
-
-  int node_size() const {
-    return trip_path_.node_size();
-  }
-
-  const ::valhalla::TripLeg_Node& node(int index) const {
-    return trip_path_.node(index);
-  }
-
-  ::valhalla::TripLeg_Node* mutable_node(int index) const {
-    return trip_path_.mutable_node(index);
-  }
-
-  const ::google::protobuf::RepeatedPtrField<::valhalla::TripLeg_Node>& node() const {
-    return trip_path_.node();
-  }
-
-  int location_size() const {
-    return trip_path_.location_size();
-  }
-
-  const ::valhalla::Location& location(int index) const {
-    return trip_path_.location(index);
-  }
-
-  int admin_size() const {
-    return trip_path_.admin_size();
-  }
-
-  ::valhalla::TripLeg_Admin* mutable_admin(int index) {
-    return trip_path_.mutable_admin(index);
-  }
-
-  uint64_t osm_changeset() const {
-    return trip_path_.osm_changeset();
-  }
-
-  uint64_t trip_id() const {
-    return trip_path_.trip_id();
-  }
-
-  uint32_t leg_id() const {
-    return trip_path_.leg_id();
-  }
-
-  uint32_t leg_count() const {
-    return trip_path_.leg_count();
-  }
-
-  const ::google::protobuf::RepeatedPtrField<::valhalla::Location>& location() const {
-    return trip_path_.location();
-  }
-
-  const ::valhalla::BoundingBox& bbox() const {
-    return trip_path_.bbox();
-  }
-
-  std::unique_ptr<EnhancedTripLeg_Node> GetEnhancedNode(const int node_index);
-
-  std::unique_ptr<EnhancedTripLeg_Edge> GetPrevEdge(const int node_index, int delta = 1);
-
-  std::unique_ptr<EnhancedTripLeg_Edge> GetCurrEdge(const int node_index) const;
-
-  std::unique_ptr<EnhancedTripLeg_Edge> GetNextEdge(const int node_index, int delta = 1) const;
-
-  bool IsValidNodeIndex(int node_index) const;
-
-  bool IsFirstNodeIndex(int node_index) const;
-
-  bool IsLastNodeIndex(int node_index) const;
-
-  int GetLastNodeIndex() const;
-
-  std::unique_ptr<EnhancedTripLeg_Admin> GetAdmin(size_t index);
-
-  std::string GetCountryCode(int node_index);
-
-  std::string GetStateCode(int node_index);
-
-  const ::valhalla::Location& GetOrigin() const;
-
-  const ::valhalla::Location& GetDestination() const;
-
-  float GetLength(const Options::Units& units);
-
-protected:
-  TripLeg& trip_path_;
-};
-
 class EnhancedTripLeg_Edge {
 public:
   EnhancedTripLeg_Edge(TripLeg_Edge* mutable_edge);
@@ -670,6 +574,115 @@ protected:
   TripLeg_Admin* mutable_admin_;
 };
 
+class EnhancedTripLeg {
+public:
+  EnhancedTripLeg(TripLeg& trip_path);
+
+  const std::string& shape() const {
+    return trip_path_.shape();
+  }
+
+  int node_size() const {
+    return trip_path_.node_size();
+  }
+
+  const ::valhalla::TripLeg_Node& node(int index) const {
+    return trip_path_.node(index);
+  }
+
+  ::valhalla::TripLeg_Node* mutable_node(int index) const {
+    return trip_path_.mutable_node(index);
+  }
+
+  const ::google::protobuf::RepeatedPtrField<::valhalla::TripLeg_Node>& node() const {
+    return trip_path_.node();
+  }
+
+  int location_size() const {
+    return trip_path_.location_size();
+  }
+
+  const ::valhalla::Location& location(int index) const {
+    return trip_path_.location(index);
+  }
+
+  int admin_size() const {
+    return trip_path_.admin_size();
+  }
+
+  ::valhalla::TripLeg_Admin* mutable_admin(int index) {
+    return trip_path_.mutable_admin(index);
+  }
+
+  uint64_t osm_changeset() const {
+    return trip_path_.osm_changeset();
+  }
+
+  uint64_t trip_id() const {
+    return trip_path_.trip_id();
+  }
+
+  uint32_t leg_id() const {
+    return trip_path_.leg_id();
+  }
+
+  uint32_t leg_count() const {
+    return trip_path_.leg_count();
+  }
+
+  const ::google::protobuf::RepeatedPtrField<::valhalla::Location>& location() const {
+    return trip_path_.location();
+  }
+
+  const ::valhalla::BoundingBox& bbox() const {
+    return trip_path_.bbox();
+  }
+
+  // The nodes, edges and admins are wrapped once, the first time they are asked for, and the
+  // same wrappers are handed out after that. The wrappers are owned by this object.
+  EnhancedTripLeg_Node* GetEnhancedNode(const int node_index);
+
+  EnhancedTripLeg_Edge* GetPrevEdge(const int node_index, int delta = 1);
+
+  EnhancedTripLeg_Edge* GetCurrEdge(const int node_index) const;
+
+  EnhancedTripLeg_Edge* GetNextEdge(const int node_index, int delta = 1) const;
+
+  bool IsValidNodeIndex(int node_index) const;
+
+  bool IsFirstNodeIndex(int node_index) const;
+
+  bool IsLastNodeIndex(int node_index) const;
+
+  int GetLastNodeIndex() const;
+
+  EnhancedTripLeg_Admin* GetAdmin(size_t index);
+
+  std::string GetCountryCode(int node_index);
+
+  std::string GetStateCode(int node_index);
+
+  const ::valhalla::Location& GetOrigin() const;
+
+  const ::valhalla::Location& GetDestination() const;
+
+  float GetLength(const Options::Units& units);
+
+protected:
+  // wraps all of the nodes, edges and admins if nodes or admins were added since the last time
+  void Index() const;
+
+  TripLeg& trip_path_;
+
+  // the wrappers of the nodes, of the edges leaving all but the last node and of the admins in
+  // the order of the trip leg. the last node normally has no edge, one is only made for it when
+  // it is asked for as that adds the edge to the trip leg
+  mutable std::vector<EnhancedTripLeg_Node> nodes_;
+  mutable std::vector<EnhancedTripLeg_Edge> edges_;
+  mutable std::unique_ptr<EnhancedTripLeg_Edge> last_edge_;
+  mutable std::vector<EnhancedTripLeg_Admin> admins_;
+};
+
 const std::unordered_map<uint8_t, std::string> TripLeg_TravelMode_Strings{
     {static_cast<uint8_t>(TripLeg_TravelMode_kDrive), "drive"},
     {static_cast<uint8_t>(TripLeg_TravelMode_kPedestrian), "pedestrian"},
@@ -1,6 +1,8 @@
 #ifndef VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 #define VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 
+#include <cstdint>
+#include <initializer_list>
 #include <locale>
 #include <string>
 #include <unordered_map>
@@ -152,8 +154,71 @@ constexpr auto kTransitPlatformCountLabelTag = "<TRANSIT_STOP_COUNT_LABEL>";
 namespace valhalla {
 namespace odin {
 
+/**
+ * A phrase that was split at its tags when the dictionary was loaded. An instruction is formed by
+ * appending the text between the tags and the values of the tags, rather than by searching the
+ * whole phrase again for every tag that gets replaced.
+ */
+class PhraseTemplate {
+public:
+  // A tag and the value to put in its place
+  struct Value {
+    const char* tag;
+    const std::string& value;
+  };
+
+  PhraseTemplate() = default;
+
+  /**
+   * Splits the phrase at its tags.
+   *
+   * @param  phrase  The phrase with tags like <STREET_NAMES> in it.
+   */
+  explicit PhraseTemplate(const std::string& phrase);
+
+  /**
+   * Returns whether this template was made from a phrase.
+   */
+  bool loaded() const {
+    return !pieces_.empty();
+  }
+
+  /**
+   * Returns the phrase with its tags replaced by their values. Tags that have no value are
+   * left in the phrase as they are.
+   *
+   * @param  values  The tags and their values.
+   * @return the phrase with the values in it.
+   */
+  std::string Render(std::initializer_list<Value> values) const;
+
+protected:
+  // A part of the phrase, either text or a tag
+  struct Piece {
+    uint32_t begin;
+    uint32_t end;
+    bool tag;
+  };
+
+  std::string phrase_;
+  std::vector<Piece> pieces_;
+};
+
 struct PhraseSet {
   std::unordered_map<std::string, std::string> phrases;
+  // The phrases split at their tags, at the index of their id
+  std::vector<PhraseTemplate> templates;
+
+  /**
+   * Returns the phrase of the specified id with its tags replaced by their values.
+   *
+   * @param  phrase_id  The id of the phrase.
+   * @param  values  The tags and their values.
+   * @return the phrase with the values in it.
+   * @throws std::out_of_range when there is no phrase with that id.
+   */
+  std::string Render(uint32_t phrase_id,
+                     std::initializer_list<PhraseTemplate::Value> values = {}) const;
 };
 
 struct StartSubset : PhraseSet {
@@ -515,6 +515,11 @@ protected:
   const EnhancedTripLeg* trip_path_;
   const NarrativeDictionary& dictionary_;
   bool articulated_preposition_enabled_;
+  // Which of the instructions of a maneuver are formed
+  bool text_enabled_;
+  bool verbal_alert_enabled_;
+  bool verbal_pre_enabled_;
+  bool verbal_post_enabled_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
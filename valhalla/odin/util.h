@@ -48,12 +48,30 @@ std::string get_localized_date(const std::string& date_time, const std::locale&
 
 using locales_singleton_t = std::unordered_map<std::string, std::shared_ptr<NarrativeDictionary>>;
 /**
- * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information
+ * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information.
+ * This parses every locale, get_locale only parses the ones requests ask for
  *
  * @return the map of locales to NarrativeDictionaries
  */
 const locales_singleton_t& get_locales();
 
+/**
+ * Returns the NarrativeDictionary of a language tag or one of its aliases. The locale of the
+ * language is parsed the first time it is asked for
+ *
+ * @param  language  the language tag or alias
+ * @return the NarrativeDictionary or nullptr if there is no locale for the language
+ */
+std::shared_ptr<NarrativeDictionary> get_locale(const std::string& language);
+
+/**
+ * Returns whether there is a locale for a language tag or alias, without parsing it
+ *
+ * @param  language  the language tag or alias
+ * @return true if the language has a locale
+ */
+bool has_locale(const std::string& language);
+
 /**
  * Returns locale strings mapped to json strings defining the dictionaries
  *
@@ -23,6 +23,11 @@ public:
   virtual void cleanup() override;
 
   void narrate(Api& request) const;
+
+protected:
+  uint32_t narration_threads;
+  service_metrics_t metrics;
+  admission_t admission;
 };
 } // namespace odin
 } // namespace valhalla
@@ -0,0 +1,97 @@
+#ifndef VALHALLA_SIF_COSTINGCACHE_H_
+#define VALHALLA_SIF_COSTINGCACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/hierarchylimits.h>
+
+namespace valhalla {
+namespace sif {
+
+/**
+ * Cache of the costings a worker has made, keyed by the costing type, its options and the edges
+ * to avoid, so requests with the same costing options reuse the costing instead of parsing the
+ * options and filling in its tables again.
+ *
+ * The algorithms change a few things on a costing while routing (the pass, whether destination
+ * only edges are allowed and the hierarchy limits). These are put back to how they were when the
+ * costing was made every time it is reused. Transit and multimodal costings keep lists that grow
+ * while routing so they are never cached. A cache is not thread safe, each worker has its own.
+ */
+class CostingCache {
+public:
+  /**
+   * Constructor
+   * @param  max_costings  How many costings the cache holds before it is cleared, 0 means
+   *                       costings are never cached.
+   */
+  explicit CostingCache(const size_t max_costings);
+
+  /**
+   * Get a costing from the cache. The costing is made the first time it is asked for.
+   * @param  costing  Costing type.
+   * @param  options  Request options holding the costing options.
+   * @param  create   Makes the costing when it is not in the cache.
+   * @return Returns the costing.
+   */
+  template <class create_t>
+  cost_ptr_t Get(const Costing costing, const Options& options, const create_t& create) {
+    if (max_costings_ == 0 || costing == Costing::transit || costing == Costing::multimodal) {
+      return create();
+    }
+    auto key = Key(costing, options);
+    auto found = costings_.find(key);
+    if (found != costings_.end()) {
+      Reset(found->second);
+      return found->second.costing;
+    }
+    cost_ptr_t cost = create();
+    if (costings_.size() >= max_costings_) {
+      costings_.clear();
+    }
+    costings_.emplace(std::move(key), entry_t{cost, cost->GetHierarchyLimits()});
+    return cost;
+  }
+
+  /**
+   * Get the number of costings in the cache.
+   * @return Returns the number of costings.
+   */
+  size_t size() const;
+
+  /**
+   * Drop all of the costings.
+   */
+  void Clear();
+
+  /**
+   * Get the key of a costing. Two costings with the same key are made the same way.
+   * @param  costing  Costing type.
+   * @param  options  Request options holding the costing options and edges to avoid.
+   * @return Returns the key.
+   */
+  static std::string Key(const Costing costing, const Options& options);
+
+protected:
+  struct entry_t {
+    cost_ptr_t costing;
+    std::vector<HierarchyLimits> hierarchy_limits;
+  };
+
+  // Put back what the algorithms change on a costing
+  static void Reset(entry_t& entry);
+
+  size_t max_costings_;
+  std::unordered_map<std::string, entry_t> costings_;
+};
+
+} // namespace sif
+} // namespace valhalla
+
+#endif // VALHALLA_SIF_COSTINGCACHE_H_
@@ -13,11 +13,14 @@
 #include <valhalla/baldr/rapidjson_utils.h>
 #include <valhalla/baldr/timedomain.h>
 #include <valhalla/baldr/transitdeparture.h>
+#include <valhalla/midgard/flat_hash.h>
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/costconstants.h>
+#include <valhalla/sif/edgecostcache.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/sif/hierarchylimits.h>
 
+#include <array>
 #include <memory>
 #include <third_party/rapidjson/include/rapidjson/document.h>
 #include <unordered_map>
@@ -54,6 +57,17 @@ constexpr float kMaxPenalty = 12.0f * midgard::kSecPerHour; // 12 hours
 // since a ferry is sometimes required to complete a route.
 constexpr float kMaxFerryPenalty = 6.0f * midgard::kSecPerHour; // 6 hours
 
+/**
+ * The outbound edges of a node that a costing allows along with their costs, in the order of the
+ * edges of the node. Each field is its own array so the expansion only reads what it needs.
+ */
+struct AllowedEdges {
+  uint32_t count = 0;                                  // Number of allowed edges
+  uint8_t index[baldr::kMaxEdgesPerNode];              // Index of the edge at the node
+  bool has_time_restrictions[baldr::kMaxEdgesPerNode]; // Edge has time dependent restrictions
+  Cost cost[baldr::kMaxEdgesPerNode];                  // Cost of the edge, no transition cost
+};
+
 /**
  * Base class for dynamic edge costing. This class defines the interface for
  * costing methods and includes a few base methods that define default behavior
@@ -219,13 +233,43 @@ public:
 
   /**
    * Get the cost to traverse the specified directed edge. Cost includes
-   * the time (seconds) to traverse the edge.
+   * the time (seconds) to traverse the edge. The cost comes from the edge
+   * cost cache if the costing has one.
    * @param   edge    Pointer to a directed edge.
    * @param   tile    Pointer to the tile which contains the directed edge for speed lookup
    * @return  Returns the cost and time (seconds).
    */
   virtual Cost EdgeCost(const baldr::DirectedEdge* edge, const baldr::GraphTile* tile) const;
 
+  /**
+   * Keep the costs of the edges costed without a time in a cache, which can be shared with other
+   * costings of the same type and options. The options must not change after this is set.
+   * @param  cache         Edge cost cache, nullptr to not use one.
+   * @param  costing_hash  Hash of the costing type and options, see EdgeCostCache::Hash.
+   */
+  void set_edge_cost_cache(const std::shared_ptr<EdgeCostCache>& cache, const uint64_t costing_hash);
+
+  /**
+   * Checks which outbound edges of a node are allowed and gets their costs, as if Allowed and then
+   * EdgeCost were called for every edge, so that the expansion only makes one call per node. The
+   * route is not time dependent, the edges are checked with a current time of 0.
+   * @param  edges    Pointer to the first directed edge.
+   * @param  count    Number of directed edges.
+   * @param  edgeid   GraphId of the first directed edge.
+   * @param  pred     Predecessor edge information.
+   * @param  tile     Tile containing the directed edges.
+   * @param  seconds  Seconds of week for the speed lookup, kInvalidSecondsOfWeek to use the
+   *                  costs of the edges without a time (see EdgeCost(edge, tile)).
+   * @param  allowed  The allowed edges and their costs.
+   */
+  virtual void GetAllowedEdges(const baldr::DirectedEdge* edges,
+                               const uint32_t count,
+                               const baldr::GraphId& edgeid,
+                               const EdgeLabel& pred,
+                               const baldr::GraphTile*& tile,
+                               const uint32_t seconds,
+                               AllowedEdges& allowed) const;
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -294,34 +338,36 @@ public:
     // if the edge marks the start of a complex restriction.
     if ((forward && (edge->end_restriction() & access_mode())) ||
         (!forward && (edge->start_restriction() & access_mode()))) {
-      // Get complex restrictions. Return false if no restrictions are found
-      auto restrictions = tile->GetRestrictions(forward, edgeid, access_mode());
-      if (restrictions.size() == 0) {
-        return false;
-      }
-
-      // Iterate through the restrictions
-      const EdgeLabel* first_pred = &pred;
-      for (const auto& cr : restrictions) {
-        // Walk the via list, move to the next restriction if the via edge
-        // Ids do not match the path for this restriction.
+      // Check the restrictions in place in the tile until one applies. The edge ids of the path
+      // are only walked back once for all of the restrictions of the edge and only as far as the
+      // via lists need. A via count never exceeds what the path has room for
+      bool restricted = false;
+      std::array<uint64_t, baldr::kMaxViasPerRestriction + 1> path;
+      const EdgeLabel* last_pred = &pred;
+      path[0] = pred.edgeid().value;
+      size_t walked = 1;
+      auto path_at = [&](const size_t i) {
+        for (; walked <= i; ++walked) {
+          last_pred = next_predecessor(last_pred);
+          path[walked] = last_pred->edgeid().value;
+        }
+        return path[i];
+      };
+      auto check = [&](const baldr::ComplexRestriction* cr) {
+        // Move to the next restriction if the via edge Ids do not match the path for this
+        // restriction. The via list starts immediately after the structure
         bool match = true;
-        const EdgeLabel* next_pred = first_pred;
-        if (cr->via_count() > 0) {
-          // The via list starts immediately after the structure
-          baldr::GraphId* via = reinterpret_cast<baldr::GraphId*>(cr + 1);
-          for (uint32_t i = 0; i < cr->via_count(); i++, via++) {
-            if (via->value != next_pred->edgeid().value) {
-              match = false;
-              break;
-            }
-            next_pred = next_predecessor(next_pred);
+        const baldr::GraphId* via = reinterpret_cast<const baldr::GraphId*>(cr + 1);
+        for (uint32_t i = 0; i < cr->via_count(); i++, via++) {
+          if (via->value != path_at(i)) {
+            match = false;
+            break;
           }
         }
 
         // Check against the start/end of the complex restriction
-        if (match && ((forward && next_pred->edgeid() == cr->from_graphid()) ||
-                      (!forward && next_pred->edgeid() == cr->to_graphid()))) {
+        if (match && ((forward && path_at(cr->via_count()) == cr->from_graphid().value) ||
+                      (!forward && path_at(cr->via_count()) == cr->to_graphid().value))) {
 
           if (current_time && cr->has_dt()) {
             // TODO Possibly a bug here. Shouldn't both kTimedDenied and kTimedAllowed
@@ -334,17 +380,23 @@ public:
                                                        cr->end_day_dow(), current_time,
                                                        baldr::DateTime::get_tz_db().from_index(
                                                            tz_index))) {
-              return true;
+              restricted = true;
+              return false;
             }
-            continue;
+            return true;
           }
           // TODO: If a user runs a non-time dependent route, we need to provide Manuever Notes for
           // the timed restriction.
           else if (!current_time && cr->has_dt())
             return false;
-          return true; // Otherwise this is a non-timed restriction and it exists all the time.
+          // Otherwise this is a non-timed restriction and it exists all the time.
+          restricted = true;
+          return false;
         }
-      }
+        return true;
+      };
+      tile->ForEachRestriction(forward, edgeid, access_mode(), check);
+      return restricted;
     }
     return false;
   }
@@ -395,10 +447,13 @@ public:
                                    const uint64_t current_time,
                                    const uint32_t tz_index,
                                    bool& has_time_restrictions) const {
-    if (edge->access_restriction()) {
-      const std::vector<baldr::AccessRestriction>& restrictions =
-          tile->GetAccessRestrictions(edgeid.id(), auto_type);
-      for (const auto& restriction : restrictions) {
+    // The edge knows which modes it has restrictions for, most edges have none for this one
+    if (edge->access_restriction() & auto_type) {
+      for (const auto& restriction : tile->GetAccessRestrictionRange(edgeid.id())) {
+        // Only the restrictions for the access that we are interested in
+        if (!(restriction.modes() & auto_type)) {
+          continue;
+        }
         // Compare the time to the time-based restrictions
         baldr::AccessType access_type = restriction.type();
         if (access_type == baldr::AccessType::kTimedAllowed ||
@@ -556,14 +611,27 @@ public:
   void AddUserAvoidEdges(const std::vector<AvoidEdge>& avoid_edges);
 
   /**
-   * Check if the edge is in the user-specified avoid list.
+   * Check if the edge is in the user-specified avoid list or in an avoid polygon.
    * @param  edgeid  Directed edge Id.
-   * @return Returns true if the edge Id is in the user avoid edges set,
-   *         false otherwise.
+   * @return Returns true if the edge Id is in the user avoid edges set or
+   *         its bit is set in the avoid mask of its tile, false otherwise.
    */
   bool IsUserAvoidEdge(const baldr::GraphId& edgeid) const {
     return (user_avoid_edges_.size() != 0 &&
-            user_avoid_edges_.find(edgeid) != user_avoid_edges_.end());
+            user_avoid_edges_.find(edgeid) != user_avoid_edges_.end()) ||
+           (user_avoid_masks_.size() != 0 && IsMaskedEdge(edgeid));
+  }
+
+  /**
+   * Check if the bit of the edge is set in the avoid mask of its tile.
+   * @param  edgeid  Directed edge Id.
+   * @return Returns true if an avoid polygon covers the edge.
+   */
+  bool IsMaskedEdge(const baldr::GraphId& edgeid) const {
+    auto mask = user_avoid_masks_.find(edgeid.Tile_Base());
+    const uint32_t id = edgeid.id();
+    return mask != user_avoid_masks_.end() && (id >> 6) < mask->second.size() &&
+           (mask->second[id >> 6] & (1ull << (id & 63)));
   }
 
   /**
@@ -621,7 +689,10 @@ protected:
   std::vector<HierarchyLimits> hierarchy_limits_;
 
   // User specified edges to avoid with percent along (for avoiding PathEdges of locations)
-  std::unordered_map<baldr::GraphId, float> user_avoid_edges_;
+  midgard::flat_hash_map<baldr::GraphId, float> user_avoid_edges_;
+
+  // Edges covered by avoid polygons, a bit per directed edge of each tile under them
+  midgard::flat_hash_map<baldr::GraphId, std::vector<uint64_t>> user_avoid_masks_;
 
   // Weighting to apply to ferry edges
   float ferry_factor_;
@@ -640,6 +711,29 @@ protected:
   // A mask which determines which flow data the costing should use from the tile
   uint8_t flow_mask_;
 
+  // Cache of the costs of edges without a time and the hash of this costing in it
+  std::shared_ptr<EdgeCostCache> edge_cost_cache_;
+  uint64_t costing_hash_;
+
+  // Whether the costs of the edges of the tile costed without a time can be kept in the edge cost
+  // cache, not when their live traffic speeds are used since those change at any time
+  bool CacheEdgeCosts(const baldr::GraphTile* tile) const {
+    return edge_cost_cache_ && !(tile->traffic_tile() && (flow_mask_ & baldr::kCurrentFlowMask));
+  }
+
+  /**
+   * Fill in the allowed edges of GetAllowedEdges with the costing methods of CostingT, see
+   * CostingCalls. The costing must be exactly of type CostingT.
+   */
+  template <class CostingT>
+  void FillAllowedEdges(const baldr::DirectedEdge* edges,
+                        const uint32_t count,
+                        baldr::GraphId edgeid,
+                        const EdgeLabel& pred,
+                        const baldr::GraphTile*& tile,
+                        const uint32_t seconds,
+                        AllowedEdges& allowed) const;
+
   /**
    * Get the base transition costs (and ferry factor) from the costing options.
    * @param costing_options Protocol buffer of costing options.
@@ -783,6 +877,150 @@ protected:
 
 using cost_ptr_t = std::shared_ptr<DynamicCost>;
 
+/**
+ * The costing methods the path algorithms call for every edge they expand. When the exact type
+ * of the costing is known they are called non virtually so that they can be inlined into the
+ * expansion, the DynamicCost specialization calls them through the vtable for everything else.
+ * The costing must be of exactly this type, a derived costing would get the methods of its base.
+ */
+template <class CostingT> struct CostingCalls {
+  static bool Allowed(const DynamicCost& costing, const baldr::NodeInfo* node) {
+    return static_cast<const CostingT&>(costing).CostingT::Allowed(node);
+  }
+
+  static bool Allowed(const DynamicCost& costing,
+                      const baldr::DirectedEdge* edge,
+                      const EdgeLabel& pred,
+                      const baldr::GraphTile*& tile,
+                      const baldr::GraphId& edgeid,
+                      const uint64_t current_time,
+                      const uint32_t tz_index,
+                      bool& has_time_restrictions) {
+    return static_cast<const CostingT&>(costing).CostingT::Allowed(edge, pred, tile, edgeid,
+                                                                   current_time, tz_index,
+                                                                   has_time_restrictions);
+  }
+
+  static bool AllowedReverse(const DynamicCost& costing,
+                             const baldr::DirectedEdge* edge,
+                             const EdgeLabel& pred,
+                             const baldr::DirectedEdge* opp_edge,
+                             const baldr::GraphTile*& tile,
+                             const baldr::GraphId& opp_edgeid,
+                             const uint64_t current_time,
+                             const uint32_t tz_index,
+                             bool& has_time_restrictions) {
+    return static_cast<const CostingT&>(costing).CostingT::AllowedReverse(edge, pred, opp_edge,
+                                                                          tile, opp_edgeid,
+                                                                          current_time, tz_index,
+                                                                          has_time_restrictions);
+  }
+
+  static Cost EdgeCost(const DynamicCost& costing,
+                       const baldr::DirectedEdge* edge,
+                       const baldr::GraphTile* tile,
+                       const uint32_t seconds) {
+    return static_cast<const CostingT&>(costing).CostingT::EdgeCost(edge, tile, seconds);
+  }
+
+  static Cost TransitionCost(const DynamicCost& costing,
+                             const baldr::DirectedEdge* edge,
+                             const baldr::NodeInfo* node,
+                             const EdgeLabel& pred) {
+    return static_cast<const CostingT&>(costing).CostingT::TransitionCost(edge, node, pred);
+  }
+
+  static Cost TransitionCostReverse(const DynamicCost& costing,
+                                    const uint32_t idx,
+                                    const baldr::NodeInfo* node,
+                                    const baldr::DirectedEdge* pred,
+                                    const baldr::DirectedEdge* edge) {
+    return static_cast<const CostingT&>(costing).CostingT::TransitionCostReverse(idx, node, pred,
+                                                                                 edge);
+  }
+};
+
+template <> struct CostingCalls<DynamicCost> {
+  static bool Allowed(const DynamicCost& costing, const baldr::NodeInfo* node) {
+    return costing.Allowed(node);
+  }
+
+  static bool Allowed(const DynamicCost& costing,
+                      const baldr::DirectedEdge* edge,
+                      const EdgeLabel& pred,
+                      const baldr::GraphTile*& tile,
+                      const baldr::GraphId& edgeid,
+                      const uint64_t current_time,
+                      const uint32_t tz_index,
+                      bool& has_time_restrictions) {
+    return costing.Allowed(edge, pred, tile, edgeid, current_time, tz_index, has_time_restrictions);
+  }
+
+  static bool AllowedReverse(const DynamicCost& costing,
+                             const baldr::DirectedEdge* edge,
+                             const EdgeLabel& pred,
+                             const baldr::DirectedEdge* opp_edge,
+                             const baldr::GraphTile*& tile,
+                             const baldr::GraphId& opp_edgeid,
+                             const uint64_t current_time,
+                             const uint32_t tz_index,
+                             bool& has_time_restrictions) {
+    return costing.AllowedReverse(edge, pred, opp_edge, tile, opp_edgeid, current_time, tz_index,
+                                  has_time_restrictions);
+  }
+
+  static Cost EdgeCost(const DynamicCost& costing,
+                       const baldr::DirectedEdge* edge,
+                       const baldr::GraphTile* tile,
+                       const uint32_t seconds) {
+    return costing.EdgeCost(edge, tile, seconds);
+  }
+
+  static Cost TransitionCost(const DynamicCost& costing,
+                             const baldr::DirectedEdge* edge,
+                             const baldr::NodeInfo* node,
+                             const EdgeLabel& pred) {
+    return costing.TransitionCost(edge, node, pred);
+  }
+
+  static Cost TransitionCostReverse(const DynamicCost& costing,
+                                    const uint32_t idx,
+                                    const baldr::NodeInfo* node,
+                                    const baldr::DirectedEdge* pred,
+                                    const baldr::DirectedEdge* edge) {
+    return costing.TransitionCostReverse(idx, node, pred, edge);
+  }
+};
+
+template <class CostingT>
+void DynamicCost::FillAllowedEdges(const baldr::DirectedEdge* edges,
+                                   const uint32_t count,
+                                   baldr::GraphId edgeid,
+                                   const EdgeLabel& pred,
+                                   const baldr::GraphTile*& tile,
+                                   const uint32_t seconds,
+                                   AllowedEdges& allowed) const {
+  const bool cached = seconds == baldr::kInvalidSecondsOfWeek && CacheEdgeCosts(tile);
+  allowed.count = 0;
+  for (uint32_t i = 0; i < count; ++i, ++edgeid) {
+    const baldr::DirectedEdge* edge = edges + i;
+    bool has_time_restrictions = false;
+    if (!CostingCalls<CostingT>::Allowed(*this, edge, pred, tile, edgeid, 0, 0,
+                                         has_time_restrictions)) {
+      continue;
+    }
+    auto n = allowed.count++;
+    allowed.index[n] = i;
+    allowed.has_time_restrictions[n] = has_time_restrictions;
+    allowed.cost[n] = cached ? edge_cost_cache_->Get(costing_hash_, tile, edge,
+                                                     [this, edge, tile, seconds]() {
+                                                       return CostingCalls<CostingT>::EdgeCost(
+                                                           *this, edge, tile, seconds);
+                                                     })
+                             : CostingCalls<CostingT>::EdgeCost(*this, edge, tile, seconds);
+  }
+}
+
 /**
  * Parses the cost options from json and stores values in pbf.
  * @param object The json request represented as a DOM tree.
@@ -0,0 +1,149 @@
+#ifndef VALHALLA_SIF_EDGECOSTCACHE_H_
+#define VALHALLA_SIF_EDGECOSTCACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphtile.h>
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/costconstants.h>
+
+namespace valhalla {
+namespace sif {
+
+/**
+ * Cache of the costs of directed edges for the algorithms that cost edges without a time, where
+ * the cost of an edge only depends on the costing and its options. Each tile has one table of
+ * costs per costing, keyed by a hash of the costing type and options. The tables are filled in
+ * lazily as the edges are costed.
+ *
+ * One cache can be shared by every thread of a process. A lock is only taken to find a table,
+ * so costing an edge in the table the thread used last takes no lock at all.
+ */
+class EdgeCostCache {
+public:
+  /**
+   * Constructor
+   * @param  max_edges  How many edge costs the tables can hold before they are cleared.
+   */
+  explicit EdgeCostCache(const size_t max_edges);
+
+  /**
+   * Get the cost of an edge from the cache. The cost is computed the first time it is asked for.
+   * @param  costing_hash  Hash of the costing, see Hash.
+   * @param  tile          Tile of the edge.
+   * @param  edge          Directed edge.
+   * @param  compute       Computes the cost when it is not in the cache.
+   * @return Returns the cost and time (seconds) of the edge.
+   */
+  template <class compute_t>
+  Cost Get(const uint64_t costing_hash,
+           const baldr::GraphTile* tile,
+           const baldr::DirectedEdge* edge,
+           const compute_t& compute) {
+    auto* slot = Slot(costing_hash, tile, edge);
+    if (slot == nullptr) {
+      return compute();
+    }
+    auto packed = slot->load(std::memory_order_relaxed);
+    if (packed != kEmpty) {
+      return Unpack(packed);
+    }
+    Cost cost = compute();
+    slot->store(Pack(cost), std::memory_order_relaxed);
+    return cost;
+  }
+
+  /**
+   * Get the number of edges the tables in the cache have room for.
+   * @return Returns the number of edges.
+   */
+  size_t size() const;
+
+  /**
+   * Drop all of the tables.
+   */
+  void Clear();
+
+  /**
+   * Hash the costing and its options. Two costings with the same hash cost edges the same.
+   * @param  costing  Costing type.
+   * @param  options  Request options holding the costing options.
+   * @return Returns the hash.
+   */
+  static uint64_t Hash(const Costing costing, const Options& options);
+
+  /**
+   * Get the cache shared by the whole process. It is made the first time this is called, later
+   * calls get the same cache regardless of their size.
+   * @param  max_edges  How many edge costs the tables can hold, 0 means no cache.
+   * @return Returns the cache, or nullptr if max_edges is 0.
+   */
+  static std::shared_ptr<EdgeCostCache> Global(const size_t max_edges);
+
+protected:
+  // Two NaNs, an edge never costs this
+  static constexpr uint64_t kEmpty = std::numeric_limits<uint64_t>::max();
+
+  struct table_t {
+    explicit table_t(const size_t count);
+    std::vector<std::atomic<uint64_t>> costs;
+  };
+
+  // The table the thread used last, so finding it again takes no lock
+  struct last_t {
+    const EdgeCostCache* cache = nullptr;
+    uint64_t costing_hash = 0;
+    uint64_t tile_id = 0;
+    std::shared_ptr<table_t> table;
+  };
+  static thread_local last_t last_;
+
+  // The slot of the cost of the edge, or nullptr if it cannot be cached
+  std::atomic<uint64_t>*
+  Slot(const uint64_t costing_hash, const baldr::GraphTile* tile, const baldr::DirectedEdge* edge);
+
+  // Find the table or make it, clearing the cache when it is full
+  std::shared_ptr<table_t> Table(const uint64_t costing_hash,
+                                 const uint64_t tile_id,
+                                 const size_t count);
+
+  static uint64_t Pack(const Cost& cost) {
+    uint32_t parts[2];
+    std::memcpy(&parts[0], &cost.cost, sizeof(float));
+    std::memcpy(&parts[1], &cost.secs, sizeof(float));
+    return (static_cast<uint64_t>(parts[0]) << 32) | parts[1];
+  }
+
+  static Cost Unpack(const uint64_t packed) {
+    uint32_t parts[2] = {static_cast<uint32_t>(packed >> 32), static_cast<uint32_t>(packed)};
+    Cost cost;
+    std::memcpy(&cost.cost, &parts[0], sizeof(float));
+    std::memcpy(&cost.secs, &parts[1], sizeof(float));
+    return cost;
+  }
+
+  struct key_hash_t {
+    size_t operator()(const std::pair<uint64_t, uint64_t>& key) const {
+      return std::hash<uint64_t>()(key.first) ^ (std::hash<uint64_t>()(key.second) * 31);
+    }
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::pair<uint64_t, uint64_t>, std::shared_ptr<table_t>, key_hash_t> tables_;
+  size_t max_edges_;
+  size_t edges_;
+};
+
+} // namespace sif
+} // namespace valhalla
+
+#endif // VALHALLA_SIF_EDGECOSTCACHE_H_
@@ -51,9 +51,10 @@ public:
             const uint32_t path_distance,
             bool has_time_restrictions = false)
       : predecessor_(predecessor), path_distance_(path_distance), restrictions_(edge->restrictions()),
-        edgeid_(edgeid), opp_index_(edge->opp_index()), opp_local_idx_(edge->opp_local_idx()),
-        mode_(static_cast<uint32_t>(mode)), endnode_(edge->endnode()),
-        has_time_restrictions_(has_time_restrictions), use_(static_cast<uint32_t>(edge->use())),
+        edgeid_(static_cast<uint32_t>(edgeid.value)), edgeid_high_(edgeid.value >> 32),
+        opp_index_(edge->opp_index()), opp_local_idx_(edge->opp_local_idx()),
+        mode_(static_cast<uint32_t>(mode)), endnode_(static_cast<uint32_t>(edge->endnode().value)),
+        endnode_high_(edge->endnode().value >> 32), has_time_restrictions_(has_time_restrictions), use_(static_cast<uint32_t>(edge->use())),
         classification_(static_cast<uint32_t>(edge->classification())), shortcut_(edge->shortcut()),
         dest_only_(edge->destonly()), origin_(0), toll_(edge->toll()), not_thru_(edge->not_thru()),
         deadend_(edge->deadend()), on_complex_rest_(edge->part_of_complex_restriction()), cost_(cost),
@@ -112,7 +113,7 @@ public:
    * @return  Returns the GraphId of this directed edge.
    */
   baldr::GraphId edgeid() const {
-    return baldr::GraphId(edgeid_);
+    return baldr::GraphId(static_cast<uint64_t>(edgeid_high_) << 32 | edgeid_);
   }
 
   /**
@@ -122,7 +123,7 @@ public:
    * @return  Returns the GraphId of the end node of this directed edge.
    */
   baldr::GraphId endnode() const {
-    return baldr::GraphId(endnode_);
+    return baldr::GraphId(static_cast<uint64_t>(endnode_high_) << 32 | endnode_);
   }
 
   /**
@@ -315,6 +316,19 @@ public:
   }
 
 protected:
+  /**
+   * Set the GraphId of the directed edge.
+   * @param  edgeid  GraphId of the directed edge.
+   */
+  void set_edgeid(const baldr::GraphId& edgeid) {
+    edgeid_ = static_cast<uint32_t>(edgeid.value);
+    edgeid_high_ = edgeid.value >> 32;
+  }
+
+  // Labels are kept in large vectors by the path algorithms, so the 46 bit GraphIds are split
+  // into 32 bit words to keep the labels at 4 byte alignment. That lets the derived labels add
+  // 32 bit members without padding.
+
   // predecessor_: Index to the predecessor edge label information.
   // Note: invalid predecessor value uses all 32 bits (so if this needs to
   // be part of a bit field make sure kInvalidLabel is changed.
@@ -327,20 +341,22 @@ protected:
   uint32_t restrictions_ : 7;
 
   /**
-   * edgeid_:         Graph Id of the edge.
+   * edgeid_:         Graph Id of the edge (low 32 bits, edgeid_high_ has the rest).
    * opp_index_:     Index at the end node of the opposing directed edge.
    * opp_local_idx_: Index at the end node of the opposing local edge. This
    *                 value can be compared to the directed edge local_edge_idx
    *                 for edge transition costing and Uturn detection.
    * mode_:          Current transport mode.
    */
-  uint64_t edgeid_ : 46;
-  uint64_t opp_index_ : 7;
-  uint64_t opp_local_idx_ : 7;
-  uint64_t mode_ : 4;
+  uint32_t edgeid_;
+  uint32_t edgeid_high_ : 14;
+  uint32_t opp_index_ : 7;
+  uint32_t opp_local_idx_ : 7;
+  uint32_t mode_ : 4;
 
   /**
-   * endnode_:        GraphId of the end node of the edge. This allows the
+   * endnode_:        GraphId of the end node of the edge (low 32 bits,
+   *                  endnode_high_ has the rest). This allows the
    *                  expansion to occur by reading the node and not having
    *                  to re-read the directed edge.
    * use_:            Use of the prior edge.
@@ -353,18 +369,19 @@ protected:
    * deadend_:        Flag indicating edge is a dead-end.
    * on_complex_rest: Part of a complex restriction.
    */
-  uint64_t endnode_ : 46;
-  uint64_t spare_ : 1; // Unused  bit
-  uint64_t has_time_restrictions_ : 1;
-  uint64_t use_ : 6;
-  uint64_t classification_ : 3;
-  uint64_t shortcut_ : 1;
-  uint64_t dest_only_ : 1;
-  uint64_t origin_ : 1;
-  uint64_t toll_ : 1;
-  uint64_t not_thru_ : 1;
-  uint64_t deadend_ : 1;
-  uint64_t on_complex_rest_ : 1;
+  uint32_t endnode_;
+  uint32_t endnode_high_ : 14;
+  uint32_t spare_ : 1; // Unused  bit
+  uint32_t has_time_restrictions_ : 1;
+  uint32_t use_ : 6;
+  uint32_t classification_ : 3;
+  uint32_t shortcut_ : 1;
+  uint32_t dest_only_ : 1;
+  uint32_t origin_ : 1;
+  uint32_t toll_ : 1;
+  uint32_t not_thru_ : 1;
+  uint32_t deadend_ : 1;
+  uint32_t on_complex_rest_ : 1;
 
   Cost cost_;      // Cost and elapsed time along the path.
   float sortcost_; // Sort cost - includes A* heuristic.
@@ -387,7 +404,7 @@ public:
    * @param predecessor  Index into the edge label list for the predecessor
    *                     directed edge in the shortest path.
    * @param edgeid       Directed edge Id.
-   * @param oppedgeid    Opposing directed edge Id.
+   * @param oppedgeid    Opposing directed edge Id (it leaves the end node).
    * @param edge         Directed edge.
    * @param cost         True cost (cost and time in seconds) to the edge.
    * @param sortcost     Cost for sorting (includes A* heuristic)n
@@ -408,7 +425,8 @@ public:
               const bool not_thru_pruning,
               const bool has_time_restrictions)
       : EdgeLabel(predecessor, edgeid, edge, cost, sortcost, dist, mode, 0, has_time_restrictions),
-        opp_edgeid_(oppedgeid), not_thru_pruning_(not_thru_pruning), transition_cost_(tc) {
+        opp_edgeid_(oppedgeid.Is_Valid() ? oppedgeid.id() : kInvalidOppEdgeId),
+        not_thru_pruning_(not_thru_pruning), transition_cost_(tc) {
   }
 
   /**
@@ -417,7 +435,7 @@ public:
    * @param predecessor  Index into the edge label list for the predecessor
    *                       directed edge in the shortest path.
    * @param edgeid        Directed edge.
-   * @param oppedgeid     Opposing directed edge Id.
+   * @param oppedgeid     Opposing directed edge Id (it leaves the end node).
    * @param edge          End node of the directed edge.
    * @param cost          True cost (cost and time in seconds) to the edge.
    * @param mode          Mode of travel along this edge.
@@ -444,7 +462,8 @@ public:
                   mode,
                   path_distance,
                   has_time_restrictions),
-        opp_edgeid_(oppedgeid), not_thru_pruning_(not_thru_pruning), transition_cost_(tc) {
+        opp_edgeid_(oppedgeid.Is_Valid() ? oppedgeid.id() : kInvalidOppEdgeId),
+        not_thru_pruning_(not_thru_pruning), transition_cost_(tc) {
   }
 
   /**
@@ -467,8 +486,7 @@ public:
               const sif::TravelMode mode,
               const bool has_time_restrictions)
       : EdgeLabel(predecessor, edgeid, edge, cost, sortcost, dist, mode, 0, has_time_restrictions),
-        not_thru_pruning_(false) {
-    opp_edgeid_ = {};
+        opp_edgeid_(kInvalidOppEdgeId), not_thru_pruning_(false) {
     transition_cost_ = {};
   }
 
@@ -520,7 +538,12 @@ public:
    * @return  Returns the GraphId of the opposing directed edge.
    */
   baldr::GraphId opp_edgeid() const {
-    return baldr::GraphId(opp_edgeid_);
+    if (opp_edgeid_ == kInvalidOppEdgeId) {
+      return {};
+    }
+    baldr::GraphId opp_edgeid = endnode();
+    opp_edgeid.set_id(opp_edgeid_);
+    return opp_edgeid;
   }
 
   /**
@@ -552,10 +575,15 @@ public:
   }
 
 protected:
-  // Graph Id of the opposing edge.
+  // Marks a label without an opposing edge
+  static constexpr uint32_t kInvalidOppEdgeId = baldr::kMaxGraphId;
+
+  // opp_edgeid_:       Id of the opposing edge within its tile. The opposing
+  //                    edge leaves the end node so it is in the end node's tile.
   // not_thru_pruning_: Is not thru pruning enabled?
-  uint64_t opp_edgeid_ : 63; // Could be 46 (to provide more spare)
-  uint64_t not_thru_pruning_ : 1;
+  uint32_t opp_edgeid_ : 21;
+  uint32_t not_thru_pruning_ : 1;
+  uint32_t spare_bd_ : 10;
 
   // Transition cost (for recovering elapsed time on reverse path)
   sif::Cost transition_cost_;
@@ -3,6 +3,11 @@
 
 #include <boost/property_tree/ptree.hpp>
 #include <limits>
+#include <string>
+#include <vector>
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
 
 // Default hierarchy transitions. Note that this corresponds to a 3 level
 // strategy: highway, arterial, local. Any changes to this will require
@@ -91,6 +96,56 @@ struct HierarchyLimits {
   }
 };
 
+/**
+ * Hierarchy limits tuned for costings from the searches of logged routes, see
+ * valhalla_tune_hierarchy_limits. The limits of a costing can be tuned for regions, the first
+ * region of the costing that contains all of the locations of a search replaces the limits of
+ * the costing for it. A region without a bounding box contains every location. The config has
+ * a list of regions per costing, each with the limits per level starting at level 0:
+ *
+ *   "auto": [{"bbox": [min_lon, min_lat, max_lon, max_lat],
+ *             "max_up_transitions": [0, 250, 50], "expansion_within_dist": [...]}, ...]
+ */
+class TunedHierarchyLimits {
+public:
+  TunedHierarchyLimits() = default;
+
+  /**
+   * Read the tuned limits.
+   * @param  pt  Property tree of the lists of regions keyed by costing.
+   */
+  explicit TunedHierarchyLimits(const boost::property_tree::ptree& pt);
+
+  /**
+   * Replace the limits of a costing with those tuned for the region of the locations.
+   * @param  costing    Name of the costing.
+   * @param  locations  Where the search goes from and to.
+   * @param  limits     Limits per level of the costing, those of the region replace them.
+   * @return Returns whether a region of the costing contains the locations.
+   */
+  bool Apply(const std::string& costing,
+             const std::vector<midgard::PointLL>& locations,
+             std::vector<HierarchyLimits>& limits) const;
+
+  /**
+   * Whether no limits are tuned.
+   * @return Returns true if there are no regions.
+   */
+  bool empty() const {
+    return regions_.empty();
+  }
+
+protected:
+  struct region_t {
+    std::string costing;
+    bool everywhere;
+    midgard::AABB2<midgard::PointLL> bbox;
+    std::vector<uint32_t> max_up_transitions;
+    std::vector<float> expansion_within_dist;
+  };
+  std::vector<region_t> regions_;
+};
+
 } // namespace sif
 } // namespace valhalla
 
@@ -17,16 +17,24 @@ class sample {
 public:
   // non-default-constructable and non-copyable
   sample() = delete;
-  sample(sample&&) = default;
-  sample& operator=(sample&&) = default;
+  sample(sample&&);
+  sample& operator=(sample&&);
   sample(const sample&) = delete;
   sample& operator=(const sample&) = delete;
 
   /**
    * Constructor
-   * @param data_source  directory name of the datasource from which to sample
+   * @param data_source   directory name of the datasource from which to sample
+   * @param cache_size    bytes of decompressed tiles to keep around, each one is about 26MB and
+   *                      at least one is always kept
+   * @param cache_dir     if not empty tiles are decompressed into memory mapped files in this
+   *                      directory instead of onto the heap, so the os can page them out
    */
-  sample(const std::string& data_source);
+  sample(const std::string& data_source,
+         size_t cache_size = 0,
+         const std::string& cache_dir = "");
+
+  ~sample();
 
   /**
    * Get a single sample from the datasource
@@ -45,12 +53,25 @@ public:
    */
   static double get_no_data_value();
 
+  /**
+   * @return how many bytes a decompressed data tile takes
+   */
+  static size_t get_tile_bytes();
+
 protected:
+  // the data of a tile, holding on to unzipped data keeps it alive while it is being used even if
+  // it has been dropped from the cache in the mean time
+  struct tile_data_t {
+    const int16_t* data;
+    std::shared_ptr<const int16_t> holder;
+  };
+
   /**
+   * Safe to call from several threads at once
    * @param  index  the index of the data tile being requested
    * @return the array of data or nullptr if there was none
    */
-  const int16_t* source(uint16_t index) const;
+  tile_data_t source(uint16_t index) const;
 
   enum class format_t { UNKNOWN = 0, GZIP = 1, RAW = 3 };
   /**
@@ -66,9 +87,9 @@ protected:
   // using memory maps
   mutable std::vector<std::pair<format_t, midgard::mem_map<char>>> mapped_cache;
 
-  // TODO: make an LRU
-  using unzipped_t = std::pair<int16_t, std::vector<int16_t>>;
-  mutable unzipped_t unzipped_cache;
+  // LRU of unzipped tiles, shared by all the threads sampling
+  struct unzipped_cache_t;
+  std::unique_ptr<unzipped_cache_t> unzipped_cache;
 
   std::string data_source;
 };
@@ -16,6 +16,7 @@
 #include <valhalla/sif/hierarchylimits.h>
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelarena.h>
 #include <valhalla/thor/pathalgorithm.h>
 #include <valhalla/thor/pathinfo.h>
 
@@ -67,6 +68,18 @@ public:
    */
   virtual void Clear();
 
+  const char* name() const override {
+    return "astar";
+  }
+
+  /**
+   * What the priority queue did during the last search.
+   * @return  Returns the queue counts.
+   */
+  baldr::LabelQueueStats queue_stats() const override {
+    return adjacencylist_ ? adjacencylist_->stats() : baldr::LabelQueueStats{};
+  }
+
   /**
    * Set a maximum label count. The path algorithm terminates if this
    * is exceeded.
@@ -92,9 +105,10 @@ protected:
 
   // Vector of edge labels (requires access by index).
   std::vector<sif::EdgeLabel> edgelabels_;
+  LabelArena edgelabel_arena_;
 
-  // Adjacency list - approximate double bucket sort
-  std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
+  // Adjacency list - approximate double bucket sort or radix heap
+  std::shared_ptr<baldr::LabelQueue> adjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -1,6 +1,13 @@
 #ifndef VALHALLA_THOR_ASTARHEURISTIC_H_
 #define VALHALLA_THOR_ASTARHEURISTIC_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
@@ -17,7 +24,7 @@ public:
   /**
    * Constructor.
    */
-  AStarHeuristic() : costfactor_(1.0f), distapprox_({}) {
+  AStarHeuristic() : costfactor_(1.0f), distapprox_({}), landmarks_(nullptr), reverse_(false) {
   }
 
   /**
@@ -33,6 +40,27 @@ public:
   void Init(const midgard::PointLL& ll, const float factor) {
     distapprox_.SetTestPoint(ll);
     costfactor_ = factor;
+    landmarks_ = nullptr;
+    targets_.clear();
+  }
+
+  /**
+   * Also bound the estimates with landmarks (ALT). The cost factor has to be the least cost per
+   * meter of any edge, which is what keeps the great circle estimate under the true cost too.
+   * Must be set again after every Init.
+   * @param  landmarks  Landmarks of the access mode of the costing.
+   * @param  targets    Lengths of the nodes the path to the destination can end at, or of the
+   *                    nodes the path from the origin can start at when reverse is set. An empty
+   *                    list (a node the landmarks do not know) keeps the great circle estimate.
+   * @param  reverse    Whether the estimate is for the path from the targets to a node rather
+   *                    than from a node to the targets.
+   */
+  void SetLandmarks(const baldr::Landmarks* landmarks,
+                    std::vector<const uint16_t*>&& targets,
+                    const bool reverse) {
+    landmarks_ = targets.empty() ? nullptr : landmarks;
+    targets_ = std::move(targets);
+    reverse_ = reverse;
   }
 
   /**
@@ -77,10 +105,40 @@ public:
     return dist * costfactor_;
   }
 
+  /**
+   * Get the A* heuristic given the lat,lng of a node and the node. Also return distance via an
+   * argument, which stays the great circle distance even when landmarks raise the estimate.
+   * @param   ll    Lat,lng
+   * @param   node  The node at the lat,lng.
+   * @param   dist  Distance (meters) to the destination.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const midgard::PointLL& ll, const baldr::GraphId& node, float& dist) const {
+    dist = sqrtf(distapprox_.DistanceSquared(ll));
+    if (landmarks_ == nullptr) {
+      return dist * costfactor_;
+    }
+    const uint16_t* lengths = landmarks_->lengths(node);
+    if (lengths == nullptr) {
+      return dist * costfactor_;
+    }
+    // the path goes to (or comes from) the closest of the targets
+    float length = std::numeric_limits<float>::max();
+    for (const auto* target : targets_) {
+      length = std::min(length, reverse_ ? landmarks_->LowerBound(target, lengths)
+                                         : landmarks_->LowerBound(lengths, target));
+    }
+    return std::max(dist, length) * costfactor_;
+  }
+
 private:
   midgard::DistanceApproximator distapprox_; // Distance approximation
   float costfactor_;                         // Cost factor - ensures the cost estimate
                                              // underestimates the true cost.
+  const baldr::Landmarks* landmarks_;        // Landmarks bounding the estimate, if any
+  std::vector<const uint16_t*> targets_;     // Lengths of the nodes at the destination
+  bool reverse_;                             // Whether the estimate is from the targets
 };
 
 } // namespace thor
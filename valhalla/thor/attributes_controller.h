@@ -57,6 +57,7 @@ const std::string kEdgeWeightedGrade = "edge.weighted_grade";
 const std::string kEdgeMaxUpwardGrade = "edge.max_upward_grade";
 const std::string kEdgeMaxDownwardGrade = "edge.max_downward_grade";
 const std::string kEdgeMeanElevation = "edge.mean_elevation";
+const std::string kEdgeElevation = "edge.elevation";
 const std::string kEdgeLaneCount = "edge.lane_count";
 const std::string kEdgeLaneConnectivity = "edge.lane_connectivity";
 const std::string kEdgeCycleLane = "edge.cycle_lane";
@@ -129,6 +130,7 @@ const std::string kShapeAttributesSpeed = "shape_attributes.speed";
 
 // Categories
 const std::string kNodeCategory = "node.";
+const std::string kNodeIntersectingEdgeCategory = "node.intersecting_edge.";
 const std::string kAdminCategory = "admin.";
 const std::string kMatchedCategory = "matched.";
 const std::string kShapeAttributesCategory = "shape_attributes.";
@@ -14,6 +14,7 @@
 #include <valhalla/sif/hierarchylimits.h>
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelarena.h>
 #include <valhalla/thor/pathalgorithm.h>
 
 namespace valhalla {
@@ -36,7 +37,14 @@ struct CandidateConnection {
 };
 
 /**
- * Bidirectional A* algorithm. Method for finding least-cost path.
+ * Bidirectional A* algorithm. Method for finding least-cost path. When the origin has a
+ * date_time the forward search costs its edges at the time they are reached, likewise the
+ * reverse search when only the destination has one. The opposite search stays time invariant.
+ *
+ * When alternates are requested the searches go on past the first connection and every edge
+ * where they meet is a candidate via edge. Alternates are formed from the candidates that are
+ * not much more costly than the best path, share little with the paths already found and are
+ * locally optimal around the via edge, all from the same expansion.
  */
 class BidirectionalAStar : public PathAlgorithm {
 public:
@@ -74,6 +82,24 @@ public:
    */
   void Clear();
 
+  const char* name() const override {
+    return "bidirectional_astar";
+  }
+
+  /**
+   * What the priority queues of both directions did during the last search.
+   * @return  Returns the queue counts.
+   */
+  baldr::LabelQueueStats queue_stats() const override {
+    baldr::LabelQueueStats stats;
+    for (const auto* queue : {adjacencylist_forward_.get(), adjacencylist_reverse_.get()}) {
+      if (queue) {
+        stats += queue->stats();
+      }
+    }
+    return stats;
+  }
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -96,13 +122,24 @@ protected:
   AStarHeuristic astarheuristic_forward_;
   AStarHeuristic astarheuristic_reverse_;
 
+  // Second of the week the forward search leaves the origin at or the reverse search arrives at
+  // the destination at, kInvalidSecondsOfWeek when that search is not time dependent
+  uint32_t origin_seconds_of_week_;
+  uint32_t destination_seconds_of_week_;
+
+  // Where the searches are heading, to hint the tiles they will need next
+  midgard::PointLL origin_ll_;
+  midgard::PointLL destination_ll_;
+
   // Vector of edge labels (requires access by index).
   std::vector<sif::BDEdgeLabel> edgelabels_forward_;
   std::vector<sif::BDEdgeLabel> edgelabels_reverse_;
+  LabelArena edgelabel_arena_forward_;
+  LabelArena edgelabel_arena_reverse_;
 
-  // Adjacency list - approximate double bucket sort
-  std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_forward_;
-  std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_reverse_;
+  // Adjacency list - approximate double bucket sort or radix heap
+  std::shared_ptr<baldr::LabelQueue> adjacencylist_forward_;
+  std::shared_ptr<baldr::LabelQueue> adjacencylist_reverse_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_forward_;
@@ -112,6 +149,11 @@ protected:
   float threshold_;
   CandidateConnection best_connection_;
 
+  // Number of paths asked for, the best one and its alternates, and all of the connections
+  // found when there are alternates to form from them
+  uint32_t desired_paths_;
+  std::vector<CandidateConnection> best_connections_;
+
   /**
    * Initialize the A* heuristic and adjacency lists for both the forward
    * and reverse search.
@@ -121,25 +163,45 @@ protected:
   void Init(const midgard::PointLL& origll, const midgard::PointLL& destll);
 
   /**
-   * Expand from the node along the forward search path.
+   * Get the second of the week to cost the edges of the forward search at.
+   * @param  elapsed  Seconds elapsed since leaving the origin.
+   * @return Returns the second of the week, noon if the forward search is not time dependent.
+   */
+  uint32_t ForwardSecondsOfWeek(const float elapsed) const;
+
+  /**
+   * Get the second of the week to cost the edges of the reverse search at.
+   * @param  elapsed  Seconds elapsed until arriving at the destination.
+   * @return Returns the second of the week, noon if the reverse search is not time dependent.
+   */
+  uint32_t ReverseSecondsOfWeek(const float elapsed) const;
+
+  /**
+   * Expand from the node along the forward search path. The expansion is instantiated for the
+   * costings it can call non virtually, see sif::CostingCalls, and for DynamicCost.
    */
+  template <class CostingT>
   bool ExpandForward(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      sif::BDEdgeLabel& pred,
                      const uint32_t pred_idx,
                      const bool from_transition);
   // Private helper function for `ExpandForward`
+  template <class CostingT>
   bool ExpandForwardInner(baldr::GraphReader& graphreader,
                           const sif::BDEdgeLabel& pred,
                           const baldr::NodeInfo* nodeinfo,
                           const uint32_t pred_idx,
                           const EdgeMetadata& meta,
                           uint32_t& shortcuts,
-                          const baldr::GraphTile* tile);
+                          const baldr::GraphTile* tile,
+                          const sif::AllowedEdges& allowed,
+                          const int32_t slot);
 
   /**
    * Expand from the node along the reverse search path.
    */
+  template <class CostingT>
   bool ExpandReverse(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      sif::BDEdgeLabel& pred,
@@ -148,6 +210,7 @@ protected:
                      const bool from_transition);
 
   // Private helper function for `ExpandReverse`
+  template <class CostingT>
   bool ExpandReverseInner(baldr::GraphReader& graphreader,
                           const sif::BDEdgeLabel& pred,
                           const baldr::DirectedEdge* opp_pred_edge,
@@ -201,6 +264,22 @@ protected:
    */
   std::vector<std::vector<PathInfo>> FormPath(baldr::GraphReader& graphreader,
                                               const Options& options);
+
+  /**
+   * Form the path through a connection of the forward and reverse search trees.
+   * @param   connection  The connection.
+   * @return  Returns the path infos ordered from origin to destination.
+   */
+  std::vector<PathInfo> FormPath(const CandidateConnection& connection);
+
+  /**
+   * Get the cost of the plateau around a connection, the edges next to it whose labels on both
+   * search trees lead along the same path. The path through the connection is a shortest path
+   * along its plateau.
+   * @param   connection  The connection.
+   * @return  Returns the cost of the plateau, including the connecting edge.
+   */
+  float PlateauCost(const CandidateConnection& connection) const;
 };
 
 } // namespace thor
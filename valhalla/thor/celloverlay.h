@@ -0,0 +1,250 @@
+#ifndef VALHALLA_THOR_CELLOVERLAY_H_
+#define VALHALLA_THOR_CELLOVERLAY_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/cellpartition.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Customization of a cell partition for one costing with its options, for customizable route
+ * planning. Customizing costs every edge of the partition and then, level by level from the
+ * smallest cells up, finds the least cost between every pair of boundary nodes of each cell:
+ * within the smallest cells over the edges, within the larger ones over the costs found for the
+ * cells of the level below and the edges between them. A query only searches the edges around
+ * its locations and the costs between boundary nodes everywhere else.
+ *
+ * Turn costs and restrictions are not part of the costs, as with the contraction hierarchy.
+ * A customization is read only once made so the workers of a process share them, see
+ * CellOverlayCache.
+ */
+class CellOverlay {
+public:
+  /**
+   * Constructor, customizes the partition with the given edge costs.
+   * @param  partition   The cell partition.
+   * @param  edge_costs  Cost of every edge of the partition, kMaxCost where it is not allowed.
+   */
+  CellOverlay(const std::shared_ptr<const baldr::CellPartition>& partition,
+              std::vector<sif::Cost>&& edge_costs);
+
+  /**
+   * Customizes the partition for a costing.
+   * @param  partition    The cell partition.
+   * @param  graphreader  Graph reader for the edges.
+   * @param  costing      Costing with the options of the request.
+   * @return Returns the customization.
+   */
+  static std::shared_ptr<const CellOverlay>
+  Customize(const std::shared_ptr<const baldr::CellPartition>& partition,
+            baldr::GraphReader& graphreader,
+            const sif::DynamicCost& costing);
+
+  // Start or end of the search: a node index and its initial cost
+  using seed_t = std::pair<uint32_t, float>;
+
+  /**
+   * Finds the least cost path between any source and any target node.
+   * @param  sources    Node indexes and initial costs at the start of the path.
+   * @param  targets    Node indexes and costs to add at the end of the path.
+   * @param  path       Set to the indexes of the partition edges along the path.
+   * @param  source     Set to the index (within sources) of the source used.
+   * @param  target     Set to the index (within targets) of the target used.
+   * @param  cost       Set to the cost of the path including the initial costs.
+   * @param  interrupt  Called now and then to abort the search by throwing.
+   * @return Returns false if no path exists.
+   */
+  bool Search(const std::vector<seed_t>& sources,
+              const std::vector<seed_t>& targets,
+              std::vector<uint32_t>& path,
+              uint32_t& source,
+              uint32_t& target,
+              float& cost,
+              const std::function<void()>* interrupt = nullptr) const;
+
+  /**
+   * Get the partition the overlay customizes.
+   * @return Returns the partition.
+   */
+  const baldr::CellPartition& partition() const {
+    return *partition_;
+  }
+
+  /**
+   * Get the cost of an edge of the partition.
+   * @param  edge  Index of the edge.
+   * @return Returns the cost, kMaxCost if the costing does not allow it.
+   */
+  const sif::Cost& edge_cost(const uint32_t edge) const {
+    return edge_costs_[edge];
+  }
+
+  /**
+   * Get the bytes the customization takes.
+   * @return Returns the bytes.
+   */
+  size_t bytes() const;
+
+protected:
+  // Label of a node reached by a search. It was reached over an edge of the partition or, when
+  // edge is invalid, over the costs between the boundary nodes of a cell of the given level
+  struct Label {
+    float cost;
+    uint32_t pred;
+    uint32_t edge;
+    uint32_t level;
+  };
+  using labels_t = std::unordered_map<uint32_t, Label>;
+
+  /**
+   * Calls f(to, cost, edge, level) for every arc leaving a node in the overlay graph of a level.
+   * Level 0 is the graph itself, level k the boundary nodes of the cells of level k - 1 with the
+   * costs between them and the edges connecting them to other cells.
+   */
+  template <typename arc_f> void ForArcs(const uint32_t node, const uint32_t level, arc_f f) const;
+
+  /**
+   * Searches the overlay graph of a level from a node without leaving its cell on that level.
+   * @param  level   Level of the overlay graph and of the cell.
+   * @param  source  Node to start from.
+   * @param  target  Node to stop at, kInvalidCellIndex to settle the whole cell.
+   * @param  labels  Set to the labels of the nodes reached.
+   */
+  void CellSearch(const uint32_t level,
+                  const uint32_t source,
+                  const uint32_t target,
+                  labels_t& labels) const;
+
+  /**
+   * Appends the edges the cost between two boundary nodes of a cell stands for.
+   * @param  level  Level of the cell.
+   * @param  from   Boundary node the cost is from.
+   * @param  to     Boundary node the cost is to.
+   * @param  path   Edge indexes to append to.
+   */
+  void Unpack(const uint32_t level,
+              const uint32_t from,
+              const uint32_t to,
+              std::vector<uint32_t>& path) const;
+
+  std::shared_ptr<const baldr::CellPartition> partition_;
+  std::vector<sif::Cost> edge_costs_;
+
+  // Per level and cell the costs between its boundary nodes, a row per boundary node
+  std::vector<std::unordered_map<uint32_t, std::vector<float>>> cliques_;
+};
+
+/**
+ * Path algorithm searching a customization of the cell partition, see CellOverlay. Only valid
+ * for the costing and options it was customized for.
+ */
+class CellOverlayQuery : public PathAlgorithm {
+public:
+  /**
+   * Set the customization to search.
+   * @param  overlay  Customization for the costing of the next searches.
+   */
+  void set_overlay(const std::shared_ptr<const CellOverlay>& overlay) {
+    overlay_ = overlay;
+  }
+
+  /**
+   * Form path between and origin and destination location using the customization.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return Returns the path edges (and elapsed time/modes at end of
+   *          each edge).
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const std::shared_ptr<sif::DynamicCost>* mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override {
+    overlay_.reset();
+    has_ferry_ = false;
+  }
+
+  const char* name() const override {
+    return "cell_overlay";
+  }
+
+protected:
+  std::shared_ptr<const CellOverlay> overlay_;
+};
+
+/**
+ * Customizations of the cell partition for the costing options requests keep using. Making one
+ * costs every edge of the graph, so those of popular options are kept and the least recently
+ * used is dropped when the cache is full. One cache is shared by every worker of a process.
+ */
+class CellOverlayCache {
+public:
+  using overlay_t = std::shared_ptr<const CellOverlay>;
+
+  /**
+   * Constructor
+   * @param  max_overlays  How many customizations the cache holds.
+   */
+  explicit CellOverlayCache(const size_t max_overlays);
+
+  /**
+   * Get the customization for a key, customizing if it is not in the cache.
+   * @param  key        Key of the costing options, see sif::CostingCache::Key.
+   * @param  customize  Makes the customization when it is missing.
+   * @return Returns the customization.
+   */
+  overlay_t Get(const std::string& key, const std::function<overlay_t()>& customize);
+
+  /**
+   * Get the number of customizations in the cache.
+   * @return Returns the number of customizations.
+   */
+  size_t size() const;
+
+  /**
+   * Get the cache shared by the whole process. It is made the first time this is called, later
+   * calls get the same cache regardless of their size.
+   * @param  max_overlays  How many customizations the cache holds, 0 means no cache.
+   * @return Returns the cache, or nullptr if there is no room.
+   */
+  static std::shared_ptr<CellOverlayCache> Global(const size_t max_overlays);
+
+protected:
+  struct entry_t {
+    overlay_t overlay;
+    uint64_t used;
+  };
+
+  mutable std::mutex mutex_;
+  size_t max_overlays_;
+  uint64_t uses_;
+  std::unordered_map<std::string, entry_t> overlays_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CELLOVERLAY_H_
@@ -0,0 +1,149 @@
+#ifndef VALHALLA_THOR_CHMATRIX_H_
+#define VALHALLA_THOR_CHMATRIX_H_
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/chgraph.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/tripcommon.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Many to many time and distance matrix over the contraction hierarchy
+ * built by mjolnir. Every target runs one upward search against the edge
+ * direction and leaves a bucket entry (target, cost) at each node it settles,
+ * then every source runs one upward search and scans the buckets of the nodes
+ * it settles. Upward searches only settle a small part of the graph so the work
+ * grows with the number of sources plus targets rather than their product.
+ * Like CHQuery it is only valid for the costing the hierarchy was built for.
+ */
+class CHMatrix {
+public:
+  /**
+   * Constructor.
+   * @param  graph  Contraction hierarchy.
+   */
+  explicit CHMatrix(const std::shared_ptr<const baldr::CHGraph>& graph = {});
+
+  /**
+   * Set the contraction hierarchy to use.
+   * @param  graph  Contraction hierarchy.
+   */
+  void set_graph(const std::shared_ptr<const baldr::CHGraph>& graph) {
+    graph_ = graph;
+  }
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from all sources to all targets
+   */
+  std::vector<TimeDistance>
+  SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+                 const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+                 baldr::GraphReader& graphreader,
+                 const std::shared_ptr<sif::DynamicCost>* mode_costing,
+                 const sif::TravelMode mode,
+                 const float max_matrix_distance);
+
+  // Where a search starts: a node index with the cost, time and length to reach it
+  struct Seed {
+    uint32_t node;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  /**
+   * Computes the matrix between seeded sources and targets. The initial
+   * costs of the seeds are part of the results.
+   * @param  sources         Seeds of each source.
+   * @param  targets         Seeds of each target.
+   * @param  cost_threshold  Searches stop past this cost.
+   * @return Returns, row by row, the time and distance from each source to
+   *         each target (kMaxCost for both if not connected).
+   */
+  std::vector<TimeDistance> Compute(const std::vector<std::vector<Seed>>& sources,
+                                    const std::vector<std::vector<Seed>>& targets,
+                                    const float cost_threshold);
+
+  /**
+   * Clear the temporary information generated during matrix construction.
+   */
+  void Clear();
+
+protected:
+  // A node settled by a search along with what it took to get there
+  struct Settled {
+    uint32_t node;
+    uint32_t location; // Index of the source or target
+    float cost;
+    float secs;
+    float length;
+
+    bool operator<(const Settled& other) const {
+      return node < other.node || (node == other.node && location < other.location);
+    }
+  };
+
+  std::shared_ptr<const baldr::CHGraph> graph_;
+
+  // Labels of the current search by node
+  std::unordered_map<uint32_t, Settled> labels_;
+
+  // Bucket entries left by the target searches, sorted by node
+  std::vector<Settled> buckets_;
+
+  // Best connection found per source and target (row major), location is unused
+  std::vector<Settled> best_;
+
+  /**
+   * Runs the target searches, then the source searches, and keeps the best
+   * connection of every pair in best_.
+   * @param  sources         Seeds of each source.
+   * @param  targets         Seeds of each target.
+   * @param  cost_threshold  Searches stop past this cost.
+   */
+  void Search(const std::vector<std::vector<Seed>>& sources,
+              const std::vector<std::vector<Seed>>& targets,
+              const float cost_threshold);
+
+  /**
+   * Form the time, distance matrix from the best connections.
+   * @return Returns the time and distance of each pair.
+   */
+  std::vector<TimeDistance> FormTimeDistanceMatrix() const;
+
+  /**
+   * Runs an upward search and appends the nodes it settles (skipping the
+   * stalled ones) to settled.
+   * @param  seeds           Start of the search.
+   * @param  location        Source or target index written to the settled nodes.
+   * @param  forward         Search along (sources) or against (targets) the edges.
+   * @param  cost_threshold  Stop past this cost.
+   * @param  settled         Settled nodes are added here.
+   */
+  void Expand(const std::vector<Seed>& seeds,
+              const uint32_t location,
+              const bool forward,
+              const float cost_threshold,
+              std::vector<Settled>& settled);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CHMATRIX_H_
@@ -0,0 +1,129 @@
+#ifndef VALHALLA_THOR_CHQUERY_H_
+#define VALHALLA_THOR_CHQUERY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/chgraph.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Contraction hierarchy query. Runs a bidirectional Dijkstra over the
+ * contraction hierarchy built by mjolnir (forward search only goes up the
+ * hierarchy, the reverse search only comes down it) with stall-on-demand,
+ * then unpacks the shortcuts of the best path into directed edges. Only
+ * valid for the costing and options the hierarchy was built with, see
+ * Supports().
+ */
+class CHQuery : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param  graph  Contraction hierarchy, may be empty (then Supports() is false).
+   */
+  explicit CHQuery(const std::shared_ptr<const baldr::CHGraph>& graph = {});
+
+  /**
+   * Destructor
+   */
+  virtual ~CHQuery();
+
+  /**
+   * Set the contraction hierarchy to query.
+   * @param  graph  Contraction hierarchy.
+   */
+  void set_graph(const std::shared_ptr<const baldr::CHGraph>& graph) {
+    graph_ = graph;
+  }
+
+  /**
+   * Can the hierarchy answer requests made with these costing options?
+   * @param  costing_options  Options of the costing used by the request.
+   * @return Returns true if a hierarchy is loaded and was built with the same options.
+   */
+  bool Supports(const CostingOptions& costing_options) const;
+
+  /**
+   * Form path between and origin and destination location using the
+   * contraction hierarchy.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return Returns the path edges (and elapsed time/modes at end of
+   *          each edge).
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const std::shared_ptr<sif::DynamicCost>* mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+  const char* name() const override {
+    return "ch_query";
+  }
+
+  // Start (forward) or end (reverse) of the search: a node index and its initial cost
+  using seed_t = std::pair<uint32_t, float>;
+
+  /**
+   * Finds the least cost path between any source and any target node.
+   * @param  sources  Node indexes and initial costs of the forward search.
+   * @param  targets  Node indexes and initial costs of the reverse search.
+   * @param  path     Set to the indexes of the hierarchy edges along the path
+   *                  with all shortcuts unpacked.
+   * @param  source   Set to the index (within sources) of the source used.
+   * @param  target   Set to the index (within targets) of the target used.
+   * @param  cost     Set to the cost of the path including the initial costs.
+   * @return Returns false if no path exists.
+   */
+  bool Search(const std::vector<seed_t>& sources,
+              const std::vector<seed_t>& targets,
+              std::vector<uint32_t>& path,
+              uint32_t& source,
+              uint32_t& target,
+              float& cost);
+
+protected:
+  // Label of a node reached by one of the searches
+  struct Label {
+    float cost;    // Cost from the seed
+    uint32_t edge; // Hierarchy edge leading here, kInvalidCHIndex at a seed
+    uint32_t seed; // Index of the seed this label came from
+  };
+
+  std::shared_ptr<const baldr::CHGraph> graph_;
+  std::unordered_map<uint32_t, Label> forward_;
+  std::unordered_map<uint32_t, Label> reverse_;
+
+  /**
+   * Appends the edges of the graph a hierarchy edge stands for.
+   * @param  edge  Hierarchy edge index.
+   * @param  path  Edge indexes to append to.
+   */
+  void Unpack(const uint32_t edge, std::vector<uint32_t>& path) const;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CHQUERY_H_
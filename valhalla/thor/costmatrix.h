@@ -2,6 +2,7 @@
 #define VALHALLA_THOR_COSTMATRIX_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -12,10 +13,13 @@
 #include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/proto/tripcommon.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/threadpool.h>
 
 namespace valhalla {
 namespace thor {
@@ -55,6 +59,17 @@ struct LocationStatus {
   }
 };
 
+/**
+ * A connection found by the expansion of one location that still has to be
+ * applied to the status of the locations. Expansions running concurrently
+ * record these and they are applied in location order once all are done.
+ */
+struct PendingStatus {
+  uint32_t source;
+  uint32_t target;
+  int threshold; // Threshold to use if this was the last location to find
+};
+
 /**
  * Best connection. Information about the best connection found between
  * a source and target pair.
@@ -119,7 +134,88 @@ public:
    */
   void Clear();
 
+  /**
+   * What the priority queues of all the sources and targets did during the
+   * last SourceToTarget.
+   * @return  Returns the queue counts.
+   */
+  baldr::LabelQueueStats queue_stats() const {
+    baldr::LabelQueueStats stats;
+    for (const auto* queues : {&source_adjacency_, &target_adjacency_}) {
+      for (const auto& queue : *queues) {
+        if (queue) {
+          stats += queue->stats();
+        }
+      }
+    }
+    return stats;
+  }
+
+  /**
+   * Set the priority queue used by the searches.
+   * @param  type  Queue type.
+   */
+  void set_queue_type(const baldr::LabelQueueType type) {
+    queue_type_ = type;
+  }
+
+  /**
+   * Set a thread pool to run the expansions of the sources (and of the
+   * targets) concurrently. It is only used with a thread-safe graph reader,
+   * results are the same as without a pool.
+   * @param  pool  Thread pool, nullptr to expand on the calling thread.
+   */
+  void set_thread_pool(ThreadPool* pool) {
+    thread_pool_ = pool;
+  }
+
+  /**
+   * Set a function that is called on the calling thread every so many
+   * expanded labels and throws when the matrix should be abandoned.
+   * @param  interrupt  Interrupt function, nullptr to never be interrupted.
+   */
+  void set_interrupt(const std::function<void()>* interrupt) {
+    interrupt_ = interrupt;
+  }
+
+  /**
+   * Say that the costing costs every path the same as the way back. When the sources and the
+   * targets are then the same locations, the expansion from each location also serves as the
+   * expansion to it and only half of the searches are run. Costings with oneways, turn
+   * penalties that depend on the direction or avoids get wrong results this way.
+   * @param  symmetric  Whether the costs are the same both ways.
+   */
+  void set_symmetric(const bool symmetric) {
+    symmetric_ = symmetric;
+  }
+
+  /**
+   * Set the seconds beyond which pairs are not searched for. The searches stop expanding past
+   * them and the pairs that take longer are returned as not found.
+   * @param  max_time  Maximum seconds of a pair, 0 to only be limited by the matrix distance.
+   */
+  void set_max_time(const float max_time) {
+    max_time_ = max_time;
+  }
+
 protected:
+  // Priority queue used for the source and target searches
+  baldr::LabelQueueType queue_type_;
+
+  // Optional pool to run the expansions on
+  ThreadPool* thread_pool_;
+
+  // Optional interrupt, called between iterations
+  const std::function<void()>* interrupt_;
+
+  // Whether the costs are the same both ways, and whether the sources are also the targets of the
+  // current query because of that so only the forward searches run
+  bool symmetric_;
+  bool targets_are_sources_;
+
+  // Seconds beyond which pairs are not searched for, 0 for no limit
+  float max_time_;
+
   // Access mode used by the costing method
   uint32_t access_mode_;
 
@@ -145,19 +241,41 @@ protected:
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each
   // source location (forward traversal)
   std::vector<std::vector<sif::HierarchyLimits>> source_hierarchy_limits_;
-  std::vector<std::shared_ptr<baldr::DoubleBucketQueue>> source_adjacency_;
+  std::vector<std::shared_ptr<baldr::LabelQueue>> source_adjacency_;
   std::vector<std::vector<sif::BDEdgeLabel>> source_edgelabel_;
   std::vector<EdgeStatus> source_edgestatus_;
 
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each
   // target location (reverse traversal)
   std::vector<std::vector<sif::HierarchyLimits>> target_hierarchy_limits_;
-  std::vector<std::shared_ptr<baldr::DoubleBucketQueue>> target_adjacency_;
+  std::vector<std::shared_ptr<baldr::LabelQueue>> target_adjacency_;
   std::vector<std::vector<sif::BDEdgeLabel>> target_edgelabel_;
   std::vector<EdgeStatus> target_edgestatus_;
 
-  // Mark each target edge with a list of target indexes that have reached it
-  std::unordered_map<baldr::GraphId, std::vector<uint32_t>> targets_;
+  // Per-tile edge status arrays recycled between the sources, targets and requests
+  std::shared_ptr<EdgeStatusPool> edgestatus_pool_;
+
+  // Mark each edge reached by a target with the index of the list of target indexes that have
+  // reached it. The marks are dense per tile so checking an edge that no target reached, which
+  // is what most edges settled by the sources are, does not hash the edge
+  EdgeStatus target_marks_;
+  std::vector<std::vector<uint32_t>> targets_;
+
+  // Edges reached by each target during the current iteration with their tiles, added to the
+  // target marks after it
+  std::vector<std::vector<std::pair<baldr::GraphId, const baldr::GraphTile*>>> reached_edges_;
+
+  // When the sources are the targets, the edges each source settled and whether it ran out of
+  // edges during the current iteration. The connections are checked once all of the searches,
+  // which are also the searches of the targets, are done with the iteration
+  std::vector<std::vector<sif::BDEdgeLabel>> settled_;
+  std::vector<uint8_t> exhausted_;
+
+  // Connections found by each location during the current iteration
+  std::vector<std::vector<PendingStatus>> pending_status_;
+
+  // Locations expanded during the current iteration
+  std::vector<uint32_t> active_;
 
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
@@ -178,6 +296,16 @@ protected:
   void Initialize(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
                   const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list);
 
+  /**
+   * Runs one iteration of the forward or backward searches of all locations
+   * whose threshold has not been reached, then applies what they found in
+   * location order.
+   * @param  forward      Run the source (true) or the target (false) searches.
+   * @param  n            Iteration counter.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   */
+  void Iterate(const bool forward, const uint32_t n, baldr::GraphReader& graphreader);
+
   /**
    * Iterate the forward search from the source/origin location.
    * @param  index        Index of the source location.
@@ -196,11 +324,19 @@ protected:
   void CheckForwardConnections(const uint32_t source, const sif::BDEdgeLabel& pred, const uint32_t n);
 
   /**
-   * Update status when a connection is found.
+   * Record a status update when a connection is found. It is applied by
+   * ApplyStatus once the current iteration is done.
+   * @param  step    Index of the location being expanded
    * @param  source  Source index
    * @param  target  Target index
    */
-  void UpdateStatus(const uint32_t source, const uint32_t target);
+  void UpdateStatus(const uint32_t step, const uint32_t source, const uint32_t target);
+
+  /**
+   * Update status for a connection that was found.
+   * @param  status  Connection and threshold recorded by UpdateStatus.
+   */
+  void ApplyStatus(const PendingStatus& status);
 
   /**
    * Iterate the backward search from the target/destination location.
@@ -209,6 +345,43 @@ protected:
    */
   void BackwardSearch(const uint32_t index, baldr::GraphReader& graphreader);
 
+  /**
+   * Check the connections of what a source settled during the iteration, when the sources are
+   * the targets.
+   * @param  index  Index of the source location.
+   * @param  n      Iteration count.
+   */
+  void CheckSettled(const uint32_t index, const uint32_t n);
+
+  /**
+   * Get the edge labels of the backward search of a target, which are those of the forward search
+   * of the source with the same index when the sources are the targets.
+   * @param  target  Index of the target.
+   * @return Returns the edge labels.
+   */
+  const std::vector<sif::BDEdgeLabel>& target_edgelabels(const uint32_t target) const {
+    return targets_are_sources_ ? source_edgelabel_[target] : target_edgelabel_[target];
+  }
+
+  /**
+   * Get the edge status of the backward search of a target, see target_edgelabels.
+   * @param  target  Index of the target.
+   * @return Returns the edge status.
+   */
+  const EdgeStatus& target_edgestatus(const uint32_t target) const {
+    return targets_are_sources_ ? source_edgestatus_[target] : target_edgestatus_[target];
+  }
+
+  /**
+   * Mark that a target reached an edge, so the sources settling its opposing edge check for a
+   * connection to the target.
+   * @param  edgeid  Edge reached by the target.
+   * @param  tile    Tile of the edge.
+   * @param  target  Index of the target.
+   */
+  void
+  MarkTarget(const baldr::GraphId& edgeid, const baldr::GraphTile* tile, const uint32_t target);
+
   /**
    * Sets the source/origin locations. Search expands forward from these
    * locations.
@@ -0,0 +1,162 @@
+#ifndef VALHALLA_THOR_DEPOTORACLE_H_
+#define VALHALLA_THOR_DEPOTORACLE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * The cost, time and distance of reaching the end of an edge from a depot.
+ */
+struct EdgeReach {
+  uint64_t edgeid;
+  float cost;
+  float secs;
+  uint32_t distance;
+};
+
+/**
+ * Everything a search from a depot reached within the cost threshold of its travel mode, so the
+ * time and distance to any location on those edges is a lookup instead of a search.
+ */
+struct DepotReach {
+  // The edges settled through the graph, sorted by id
+  std::vector<EdgeReach> edges;
+  // The edges the depot is on with how far along them it is, they only reach what is ahead
+  std::vector<std::pair<float, EdgeReach>> origins;
+
+  /**
+   * Get the time and distance from the depot to a location the way a one to many matrix would,
+   * the best of the edges the location is on less the part of the edge beyond the location.
+   * @param  location     The location with the edges it snapped to.
+   * @param  graphreader  Graph reader for the edges.
+   * @param  costing      Costing the depot was searched with.
+   * @param  result       Set to the time and distance when the location was reached.
+   * @return Returns whether the search from the depot reached the location.
+   */
+  bool Get(const valhalla::Location& location,
+           baldr::GraphReader& graphreader,
+           const sif::DynamicCost& costing,
+           TimeDistance& result) const;
+
+  /**
+   * Get the bytes the reach takes.
+   * @return Returns the bytes.
+   */
+  size_t bytes() const {
+    return edges.size() * sizeof(EdgeReach) + origins.size() * sizeof(origins.front());
+  }
+};
+
+/**
+ * Oracle of the times and distances from a configured set of depots, for fleets whose matrices
+ * keep starting from the same places. The first matrix from a depot searches everything it can
+ * reach once, later matrices with the same snapped depot and costing options look their rows up.
+ *
+ * The reaches are dropped after a maximum age so they follow changes of the live traffic and all
+ * of them are dropped when the oracle is full. One oracle is shared by every worker of a process.
+ */
+class DepotOracle {
+public:
+  using reach_t = std::shared_ptr<const DepotReach>;
+
+  /**
+   * Constructor
+   * @param  depots      Where the depots are.
+   * @param  max_depots  How many reaches the oracle holds before it is cleared.
+   * @param  max_age     Seconds after which a reach is searched again, 0 keeps them until the
+   *                     oracle is cleared.
+   */
+  DepotOracle(const std::vector<midgard::PointLL>& depots,
+              const size_t max_depots,
+              const uint32_t max_age);
+
+  /**
+   * Whether a location was asked for at a depot, to within about a meter.
+   * @param  location  The location.
+   * @return Returns true if it is a depot.
+   */
+  bool IsDepot(const valhalla::Location& location) const;
+
+  /**
+   * Find the reach of a depot.
+   * @param  key  Key of the depot, see Key.
+   * @return Returns the reach or nothing if it was not searched yet or is too old.
+   */
+  reach_t Find(const std::string& key) const;
+
+  /**
+   * Put the reach of a depot in the oracle.
+   * @param  key    Key of the depot, see Key.
+   * @param  reach  The reach.
+   */
+  void Put(const std::string& key, const reach_t& reach);
+
+  /**
+   * Get the number of reaches in the oracle.
+   * @return Returns the number of reaches.
+   */
+  size_t size() const;
+
+  /**
+   * Drop all of the reaches.
+   */
+  void Clear();
+
+  /**
+   * Get the key of a depot. Two depots with the same key reach the same edges at the same cost.
+   * @param  costing  Costing type.
+   * @param  options  Request options with the costing options.
+   * @param  depot    The depot with the edges it snapped to.
+   * @return Returns the key.
+   */
+  static std::string
+  Key(const Costing costing, const Options& options, const valhalla::Location& depot);
+
+  /**
+   * Get the oracle shared by the whole process. It is made the first time this is called, later
+   * calls get the same oracle regardless of their depots, size and age.
+   * @param  depots      Where the depots are, none means no oracle.
+   * @param  max_depots  How many reaches the oracle holds, 0 means no oracle.
+   * @param  max_age     Seconds after which a reach is searched again.
+   * @return Returns the oracle, or nullptr if there are no depots or no room.
+   */
+  static std::shared_ptr<DepotOracle> Global(const std::vector<midgard::PointLL>& depots,
+                                             const size_t max_depots,
+                                             const uint32_t max_age);
+
+protected:
+  struct entry_t {
+    reach_t reach;
+    std::chrono::steady_clock::time_point computed;
+  };
+
+  // The coordinates of a depot rounded to about a meter
+  static uint64_t Cell(const double lng, const double lat);
+
+  mutable std::mutex mutex_;
+  std::unordered_set<uint64_t> depots_;
+  size_t max_depots_;
+  std::chrono::seconds max_age_;
+  std::unordered_map<std::string, entry_t> reaches_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_DEPOTORACLE_H_
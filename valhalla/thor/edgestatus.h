@@ -1,7 +1,13 @@
 #ifndef VALHALLA_THOR_EDGESTATUS_H_
 #define VALHALLA_THOR_EDGESTATUS_H_
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
@@ -39,31 +45,139 @@ struct EdgeStatusInfo {
   }
 };
 
+/**
+ * Recycles the per-tile EdgeStatusInfo arrays used by EdgeStatus so that
+ * repeated searches do not have to go back to the heap for every tile they
+ * touch. Arrays are kept in power of 2 size classes. It is NOT thread-safe,
+ * share a pool only between EdgeStatus objects used by the same thread.
+ */
+class EdgeStatusPool {
+public:
+  EdgeStatusPool() = default;
+  EdgeStatusPool(const EdgeStatusPool&) = delete;
+  EdgeStatusPool& operator=(const EdgeStatusPool&) = delete;
+
+  /**
+   * Destructor. Delete all of the recycled arrays.
+   */
+  ~EdgeStatusPool() {
+    for (auto& size_class : free_) {
+      for (auto* statuses : size_class) {
+        delete[] statuses;
+      }
+    }
+  }
+
+  /**
+   * Get an array which can hold at least count statuses. The first count
+   * statuses are reset to unreached.
+   * @param  count  Number of statuses needed (directed edges in the tile).
+   * @return Returns the array.
+   */
+  EdgeStatusInfo* acquire(const uint32_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& size_class = free_[size_class_of(count)];
+    if (size_class.empty()) {
+      return new EdgeStatusInfo[capacity_of(count)];
+    }
+    EdgeStatusInfo* statuses = size_class.back();
+    size_class.pop_back();
+    std::fill_n(statuses, count, EdgeStatusInfo());
+    return statuses;
+  }
+
+  /**
+   * Give back an array acquired from this pool.
+   * @param  statuses  The array.
+   * @param  count     The count it was acquired with.
+   */
+  void release(EdgeStatusInfo* statuses, const uint32_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_[size_class_of(count)].push_back(statuses);
+  }
+
+private:
+  static uint32_t size_class_of(const uint32_t count) {
+    uint32_t size_class = 0;
+    while ((1u << size_class) < count) {
+      ++size_class;
+    }
+    return size_class;
+  }
+
+  static uint32_t capacity_of(const uint32_t count) {
+    return 1u << size_class_of(count);
+  }
+
+  // Recycled arrays by size class, size class i holds arrays of 2^i statuses
+  std::array<std::vector<EdgeStatusInfo*>, 33> free_;
+
+  // Searches running on different threads can share a pool
+  std::mutex mutex_;
+};
+
 /**
  * Class to define / lookup the status and index of an edge in the edge label
  * list during shortest path algorithms. This method stores status info for
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * The arrays are found through an open addressing table keyed by the tile
+ * value, with the last tile remembered since consecutive lookups are almost
+ * always for the same tile. The arrays come from an EdgeStatusPool, which can
+ * be shared between several EdgeStatus objects (one per source in CostMatrix)
+ * so that clearing them recycles the arrays for the next search.
  */
 class EdgeStatus {
 public:
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
+   * Constructor using a pool of its own.
+   */
+  EdgeStatus() : EdgeStatus(std::make_shared<EdgeStatusPool>()) {
+  }
+
+  /**
+   * Constructor using a shared pool.
+   * @param  pool  Pool to get the per-tile arrays from and return them to.
+   */
+  explicit EdgeStatus(std::shared_ptr<EdgeStatusPool> pool)
+      : pool_(std::move(pool)), table_(kInitialTableSize), size_(0), last_(nullptr) {
+  }
+
+  EdgeStatus(const EdgeStatus&) = delete;
+  EdgeStatus& operator=(const EdgeStatus&) = delete;
+
+  EdgeStatus(EdgeStatus&& other) noexcept
+      : pool_(std::move(other.pool_)), table_(std::move(other.table_)), size_(other.size_),
+        last_(other.last_) {
+    other.table_.clear();
+    other.size_ = 0;
+    other.last_ = nullptr;
+  }
+
+  /**
+   * Destructor. Give the allocated EdgeStatusInfo arrays back to the pool.
    */
   ~EdgeStatus() {
     clear();
   }
 
   /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Clear the edge status. The EdgeStatusInfo arrays are returned to the pool.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    if (size_ == 0) {
+      return;
     }
-    edgestatus_.clear();
+    for (auto& slot : table_) {
+      if (slot.statuses) {
+        pool_->release(slot.statuses, slot.count);
+        slot = {};
+      }
+    }
+    size_ = 0;
+    last_ = nullptr;
   }
 
   /**
@@ -77,16 +191,7 @@ public:
            const EdgeSet set,
            const uint32_t index,
            const baldr::GraphTile* tile) {
-    auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value(),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+    *GetPtr(edgeid, tile) = {set, index};
   }
 
   /**
@@ -96,9 +201,9 @@ public:
    * @param  set      Label set for this directed edge.
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set) {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+    const slot_t* slot = find(edgeid.tile_value());
+    if (slot) {
+      slot->statuses[edgeid.id()].set_ = static_cast<uint32_t>(set);
     } else {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
@@ -110,8 +215,19 @@ public:
    * @return  Returns edge status info.
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid) const {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const slot_t* slot = find(edgeid.tile_value());
+    return slot ? slot->statuses[edgeid.id()] : EdgeStatusInfo();
+  }
+
+  /**
+   * Get the status info of a directed edge without remembering its tile, so
+   * several threads can look up the same edge status while it is not changing.
+   * @param   edgeid  GraphId of the directed edge.
+   * @return  Returns edge status info.
+   */
+  EdgeStatusInfo GetShared(const baldr::GraphId& edgeid) const {
+    const slot_t* slot = lookup(edgeid.tile_value());
+    return slot ? slot->statuses[edgeid.id()] : EdgeStatusInfo();
   }
 
   /**
@@ -123,23 +239,99 @@ public:
    * @return  Returns a pointer to edge status info for this edge.
    */
   EdgeStatusInfo* GetPtr(const baldr::GraphId& edgeid, const baldr::GraphTile* tile) {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
+    const slot_t* slot = find(edgeid.tile_value());
+    if (!slot) {
+      // Tile is not in the table. Add an array of EdgeStatusInfo, sized to
       // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value(),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
+      slot = insert(edgeid.tile_value(), tile->header()->directededgecount());
     }
+    return &slot->statuses[edgeid.id()];
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // Open addressing table entry, an empty slot has no statuses
+  struct slot_t {
+    uint32_t tile_value;
+    uint32_t count;
+    EdgeStatusInfo* statuses;
+    slot_t() : tile_value(0), count(0), statuses(nullptr) {
+    }
+  };
+
+  static constexpr size_t kInitialTableSize = 64;
+
+  static size_t hash(const uint32_t tile_value) {
+    return tile_value * 0x9E3779B1u;
+  }
+
+  const slot_t* find(const uint32_t tile_value) const {
+    if (last_ && last_->tile_value == tile_value) {
+      return last_;
+    }
+    const slot_t* slot = lookup(tile_value);
+    if (slot) {
+      last_ = slot;
+    }
+    return slot;
+  }
+
+  const slot_t* lookup(const uint32_t tile_value) const {
+    if (size_ == 0) {
+      return nullptr;
+    }
+    const size_t mask = table_.size() - 1;
+    for (size_t i = hash(tile_value) & mask;; i = (i + 1) & mask) {
+      const slot_t& slot = table_[i];
+      if (!slot.statuses) {
+        return nullptr;
+      }
+      if (slot.tile_value == tile_value) {
+        return &slot;
+      }
+    }
+  }
+
+  const slot_t* insert(const uint32_t tile_value, const uint32_t count) {
+    // Keep the table at most half full so probe sequences stay short
+    if ((size_ + 1) * 2 > table_.size()) {
+      std::vector<slot_t> table(table_.empty() ? kInitialTableSize : table_.size() * 2);
+      table_.swap(table);
+      for (const auto& slot : table) {
+        if (slot.statuses) {
+          place(slot);
+        }
+      }
+    }
+    slot_t slot;
+    slot.tile_value = tile_value;
+    slot.count = count;
+    slot.statuses = pool_->acquire(count);
+    ++size_;
+    last_ = place(slot);
+    return last_;
+  }
+
+  const slot_t* place(const slot_t& slot) {
+    const size_t mask = table_.size() - 1;
+    size_t i = hash(slot.tile_value) & mask;
+    while (table_[i].statuses) {
+      i = (i + 1) & mask;
+    }
+    table_[i] = slot;
+    return &table_[i];
+  }
+
+  // Where the per-tile arrays come from and go back to
+  std::shared_ptr<EdgeStatusPool> pool_;
+
+  // Edge status - keyed by the tile Ids (level and tile Id) and the values
+  // are arrays of EdgeStatusInfo (sized based on the directed edge count
+  // within the tile).
+  std::vector<slot_t> table_;
+  size_t size_;
+
+  // The most recently used table entry
+  mutable const slot_t* last_;
 };
 
 } // namespace thor
@@ -17,6 +17,7 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelarena.h>
 
 namespace valhalla {
 namespace thor {
@@ -43,6 +44,24 @@ public:
    */
   void Clear();
 
+  /**
+   * What the priority queue did during the last isochrone computed.
+   * @return  Returns the queue counts.
+   */
+  baldr::LabelQueueStats queue_stats() const {
+    return adjacencylist_ ? adjacencylist_->stats() : baldr::LabelQueueStats{};
+  }
+
+  /**
+   * Draw the settled edges into the grid concurrently with the given parallel_for. Drawing is
+   * otherwise done on the thread computing the isochrone.
+   * @param  parallel_for  Runs the drawing of a batch of edges concurrently, can be empty.
+   */
+  void
+  set_parallel_for(const midgard::GriddedData<midgard::PointLL>::parallel_for_t& parallel_for) {
+    parallel_for_ = parallel_for;
+  }
+
   /**
    * Compute an isochrone grid. This creates and populates a lat,lon grid with
    * time taken to reach each grid point. This gridded data is then contoured
@@ -117,6 +136,9 @@ protected:
   std::vector<sif::EdgeLabel> edgelabels_;
   std::vector<sif::BDEdgeLabel> bdedgelabels_;
   std::vector<sif::MMEdgeLabel> mmedgelabels_;
+  LabelArena edgelabel_arena_;
+  LabelArena bdedgelabel_arena_;
+  LabelArena mmedgelabel_arena_;
 
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
@@ -127,6 +149,10 @@ protected:
   // Isochrone gridded time data
   std::shared_ptr<midgard::GriddedData<midgard::PointLL>> isotile_;
 
+  // Segments of the settled edges waiting to be drawn into the isotile and what draws them
+  std::vector<midgard::GriddedData<midgard::PointLL>::segment_t> segments_;
+  midgard::GriddedData<midgard::PointLL>::parallel_for_t parallel_for_;
+
   /**
    * Initialize prior to computing the isochrones. Creates adjacency list,
    * edgestatus support, and reserves edgelabels.
@@ -240,6 +266,12 @@ protected:
                      const midgard::PointLL& ll,
                      const float secs0);
 
+  /**
+   * Draws the segments collected by UpdateIsoTile into the isotile.
+   * @return the isotile
+   */
+  std::shared_ptr<const midgard::GriddedData<midgard::PointLL>> DrawIsoTile();
+
   /**
    * Add edge(s) at each origin location to the adjacency list.
    * @param  graphreader       Graph tile reader.
@@ -0,0 +1,128 @@
+#ifndef VALHALLA_THOR_ISOCHRONECACHE_H_
+#define VALHALLA_THOR_ISOCHRONECACHE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <valhalla/midgard/gridded_data.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Cache of the isochrone grids a worker has computed, keyed by the edges the locations snapped
+ * to, the costing and its options, the time of departure rounded down to the speed bucket, the
+ * number of minutes the grid covers and whether it is the time from or to the locations.
+ * Requests that only differ in their contours, polygons, denoise or generalize are contoured from
+ * the cached grid instead of expanding the graph again.
+ *
+ * Grids can be given a maximum age so that they follow changes of the live traffic. Transit and
+ * multimodal isochrones are never cached. A cache is not thread safe, each worker has its own.
+ */
+class IsochroneCache {
+public:
+  using grid_t = std::shared_ptr<const midgard::GriddedData<midgard::PointLL>>;
+
+  /**
+   * Constructor
+   * @param  max_grids    How many grids the cache holds before it is cleared, 0 means grids
+   *                      are never cached.
+   * @param  max_age      Seconds after which a grid is computed again, 0 keeps them until the
+   *                      cache is cleared.
+   */
+  IsochroneCache(const size_t max_grids, const uint32_t max_age);
+
+  /**
+   * Get a grid from the cache. The grid is computed the first time it is asked for.
+   * @param  costing      Costing type.
+   * @param  options      Request options with the costing options and the snapped locations.
+   * @param  max_minutes  Minutes the grid covers.
+   * @param  compute      Computes the grid when it is not in the cache.
+   * @param  reverse      Whether the grid is the time to the locations.
+   * @return Returns the grid.
+   */
+  template <class compute_t>
+  grid_t Get(const Costing costing,
+             const Options& options,
+             const uint32_t max_minutes,
+             const compute_t& compute,
+             const bool reverse = false) {
+    auto grid = Find(costing, options, max_minutes, reverse);
+    if (!grid) {
+      grid = compute();
+      Put(costing, options, max_minutes, grid, reverse);
+    }
+    return grid;
+  }
+
+  /**
+   * Find a grid in the cache without computing it.
+   * @param  costing      Costing type.
+   * @param  options      Request options with the costing options and the snapped locations.
+   * @param  max_minutes  Minutes the grid covers.
+   * @param  reverse      Whether the grid is the time to the locations.
+   * @return Returns the grid or nothing if it is not cached or is too old.
+   */
+  grid_t Find(const Costing costing,
+              const Options& options,
+              const uint32_t max_minutes,
+              const bool reverse = false) const;
+
+  /**
+   * Put a grid computed elsewhere into the cache.
+   * @param  costing      Costing type.
+   * @param  options      Request options with the costing options and the snapped locations.
+   * @param  max_minutes  Minutes the grid covers.
+   * @param  grid         The grid.
+   * @param  reverse      Whether the grid is the time to the locations.
+   */
+  void Put(const Costing costing,
+           const Options& options,
+           const uint32_t max_minutes,
+           const grid_t& grid,
+           const bool reverse = false);
+
+  /**
+   * Get the number of grids in the cache.
+   * @return Returns the number of grids.
+   */
+  size_t size() const;
+
+  /**
+   * Drop all of the grids.
+   */
+  void Clear();
+
+  /**
+   * Get the key of a grid. Two requests with the same key expand the graph the same way.
+   * @param  costing      Costing type.
+   * @param  options      Request options with the costing options and the snapped locations.
+   * @param  max_minutes  Minutes the grid covers.
+   * @param  reverse      Whether the grid is the time to the locations.
+   * @return Returns the key.
+   */
+  static std::string Key(const Costing costing,
+                         const Options& options,
+                         const uint32_t max_minutes,
+                         const bool reverse = false);
+
+protected:
+  struct entry_t {
+    grid_t grid;
+    std::chrono::steady_clock::time_point computed;
+  };
+
+  size_t max_grids_;
+  std::chrono::seconds max_age_;
+  std::unordered_map<std::string, entry_t> grids_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_ISOCHRONECACHE_H_
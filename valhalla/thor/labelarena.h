@@ -0,0 +1,80 @@
+#ifndef VALHALLA_THOR_LABELARENA_H_
+#define VALHALLA_THOR_LABELARENA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Sizes the edge label storage of a path algorithm across requests. Path
+ * algorithms live as long as the worker that owns them, so their label
+ * vectors are reused from one search to the next. Rather than always
+ * reserving a fixed large count, the arena keeps a decaying high-water mark
+ * of how many labels recent searches used and reserves a little above it.
+ * When a request needed far more labels than the searches that follow it,
+ * the excess memory is released instead of being held for the life of the
+ * worker.
+ */
+class LabelArena {
+public:
+  /**
+   * Constructor.
+   * @param  initial_count  Labels to reserve before any search has run.
+   * @param  minimum_count  Never reserve fewer labels than this.
+   */
+  explicit LabelArena(const size_t initial_count, const size_t minimum_count = kMinimumLabelCount)
+      : minimum_count_(minimum_count), high_water_(initial_count - initial_count / 5) {
+  }
+
+  /**
+   * Reserves label storage for the next search.
+   * @param  labels  Label vector of the path algorithm.
+   */
+  template <typename label_t> void reserve(std::vector<label_t>& labels) const {
+    labels.reserve(target());
+  }
+
+  /**
+   * Clears the labels after a search and records how many were used. If
+   * the vector has grown well beyond what recent searches needed its memory
+   * is released, the next call to reserve allocates the smaller target.
+   * @param  labels  Label vector of the path algorithm.
+   */
+  template <typename label_t> void recycle(std::vector<label_t>& labels) {
+    // Clear can be called more than once between searches, only searches
+    // that actually added labels update the high-water mark
+    if (!labels.empty()) {
+      high_water_ = std::max(labels.size(), high_water_ - high_water_ / kDecayDivisor);
+    }
+    labels.clear();
+    if (labels.capacity() > kShrinkFactor * target()) {
+      std::vector<label_t>().swap(labels);
+    }
+  }
+
+  /**
+   * Returns the number of labels the next search will reserve.
+   * @return  Returns the label count.
+   */
+  size_t target() const {
+    return std::max(minimum_count_, high_water_ + high_water_ / 4);
+  }
+
+protected:
+  static constexpr size_t kMinimumLabelCount = 10000;
+  // 1/8 of the high-water mark decays away per search
+  static constexpr size_t kDecayDivisor = 8;
+  // Release storage once it is more than this many times the target
+  static constexpr size_t kShrinkFactor = 2;
+
+  size_t minimum_count_;
+  size_t high_water_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_LABELARENA_H_
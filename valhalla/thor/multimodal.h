@@ -18,6 +18,7 @@
 #include <valhalla/thor/astar.h>
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelarena.h>
 #include <valhalla/thor/pathinfo.h>
 
 namespace valhalla {
@@ -63,6 +64,18 @@ public:
    */
   void Clear();
 
+  const char* name() const override {
+    return "multimodal";
+  }
+
+  /**
+   * What the priority queue did during the last search.
+   * @return  Returns the queue counts.
+   */
+  baldr::LabelQueueStats queue_stats() const override {
+    return adjacencylist_ ? adjacencylist_->stats() : baldr::LabelQueueStats{};
+  }
+
 protected:
   // Current walking distance.
   uint32_t walking_distance_;
@@ -94,6 +107,7 @@ protected:
 
   // Vector of edge labels (requires access by index).
   std::vector<sif::MMEdgeLabel> edgelabels_;
+  LabelArena edgelabel_arena_;
 
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
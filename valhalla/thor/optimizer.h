@@ -6,6 +6,8 @@
 #include <random>
 #include <vector>
 
+#include <valhalla/thor/threadpool.h>
+
 namespace valhalla {
 namespace thor {
 
@@ -23,6 +25,19 @@ constexpr float kCoolingRate = 0.93f;
 //            a start and end location.
 enum AlterationType { kRotate, kReverse };
 
+// Optimization method.
+// kAnneal      - Simulated annealing starting from a random tour.
+// kLocalSearch - Nearest neighbor tour improved with 2-opt and Or-opt moves
+//                over the nearest neighbors of each location, then restarted
+//                from perturbed copies of the best tour. Deterministic.
+enum class OptimizerMethod { kAnneal, kLocalSearch };
+
+// Number of nearest locations considered for the moves of the local search
+constexpr uint32_t kOptimizerNeighbors = 10;
+
+// Number of restarts of the local search, each run from its own perturbation
+constexpr uint32_t kOptimizerRestarts = 8;
+
 // Simple structure with 3 values describing a possible tour alteration
 struct TourAlteration {
   uint32_t start;     // Index of 1st location
@@ -32,12 +47,16 @@ struct TourAlteration {
 };
 
 /**
- * Optimization method using simulated annealing. Optimizes the order of
- * locations - keeping the first location (origin) and last location
- * (destination) fixed.
+ * Optimizes the order of locations - keeping the first location (origin) and
+ * last location (destination) fixed - using simulated annealing or a local
+ * search (see OptimizerMethod).
  */
 class Optimizer {
 public:
+  Optimizer()
+      : method_(OptimizerMethod::kAnneal), restarts_(kOptimizerRestarts), thread_pool_(nullptr) {
+  }
+
   /**
    * Optimize the tour through a set of locations given the cost matrix
    * among all locations. The first location (origin) and last location
@@ -58,7 +77,36 @@ public:
     random_generator_.seed(seed);
   }
 
+  /**
+   * Set the optimization method.
+   * @param  method  Simulated annealing or local search.
+   */
+  void set_method(const OptimizerMethod method) {
+    method_ = method;
+  }
+
+  /**
+   * Set the number of restarts of the local search.
+   * @param  restarts  Number of restarts, at least 1.
+   */
+  void set_restarts(const uint32_t restarts) {
+    restarts_ = std::max(restarts, 1u);
+  }
+
+  /**
+   * Set a thread pool to run the restarts of the local search concurrently.
+   * The tour is the same as without a pool.
+   * @param  pool  Thread pool, nullptr to run on the calling thread.
+   */
+  void set_thread_pool(ThreadPool* pool) {
+    thread_pool_ = pool;
+  }
+
 protected:
+  OptimizerMethod method_;  // Optimization method
+  uint32_t restarts_;       // # of restarts of the local search
+  ThreadPool* thread_pool_; // Optional pool to run the restarts on
+
   // Random number generation: 0 <= r < 1
   std::mt19937_64 random_generator_;
   std::uniform_real_distribution<float> uniform_distribution_{0.0, 1.0};
@@ -100,6 +148,41 @@ protected:
    */
   void CreateRandomTour();
 
+  /**
+   * Optimize the tour with the local search, restarted from perturbations
+   * of the first tour it finds.
+   * @param  costs  2-D cost matrix.
+   * @return Returns the best tour found.
+   */
+  std::vector<uint32_t> LocalSearch(const std::vector<float>& costs);
+
+  /**
+   * Create a tour by going to the nearest location not yet visited.
+   * @param  costs  2-D cost matrix.
+   * @return Returns the tour.
+   */
+  std::vector<uint32_t> NearestNeighborTour(const std::vector<float>& costs) const;
+
+  /**
+   * Improve a tour with 2-opt and Or-opt moves until none of them lowers
+   * its cost. Only moves connecting a location to one of its nearest
+   * neighbors are tried.
+   * @param  costs      2-D cost matrix.
+   * @param  neighbors  Nearest neighbors of each location, see NearestNeighbors.
+   * @param  tour       Tour to improve in place.
+   */
+  void ImproveTour(const std::vector<float>& costs,
+                   const std::vector<uint32_t>& neighbors,
+                   std::vector<uint32_t>& tour) const;
+
+  /**
+   * Get the nearest neighbors of each location by the cost to go to them.
+   * @param  costs  2-D cost matrix.
+   * @return Returns the same number of locations, up to kOptimizerNeighbors,
+   *         for every location one after the other, nearest first.
+   */
+  std::vector<uint32_t> NearestNeighbors(const std::vector<float>& costs) const;
+
   /**
    * Get the cost for the specified tour (order of locations).
    * @param  costs  2-D cost array between locations.
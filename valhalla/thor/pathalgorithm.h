@@ -9,6 +9,8 @@
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/label_queue.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/thor/edgestatus.h>
@@ -29,7 +31,9 @@ public:
   /**
    * Constructor
    */
-  PathAlgorithm() : interrupt(nullptr), has_ferry_(false), expansion_callback_() {
+  PathAlgorithm()
+      : interrupt(nullptr), has_ferry_(false), expansion_callback_(),
+        queue_type_(baldr::LabelQueueType::kDoubleBucket) {
   }
 
   /**
@@ -62,6 +66,12 @@ public:
    */
   virtual void Clear() = 0;
 
+  /**
+   * Name of the algorithm, used when reporting what a search did.
+   * @return  Returns the name.
+   */
+  virtual const char* name() const = 0;
+
   /**
    * Set a callback that will throw when the path computation should be aborted
    * @param interrupt_callback  the function to periodically call to see if
@@ -71,6 +81,22 @@ public:
     interrupt = interrupt_callback;
   }
 
+  /**
+   * Set the priority queue used by the searches.
+   * @param  type  Queue type.
+   */
+  void set_queue_type(const baldr::LabelQueueType type) {
+    queue_type_ = type;
+  }
+
+  /**
+   * Set the landmarks the A* heuristics of the searches may be bounded with.
+   * @param  landmarks  Landmarks of each access mode they were built for.
+   */
+  void set_landmarks(const std::vector<std::shared_ptr<const baldr::Landmarks>>& landmarks) {
+    landmarks_ = landmarks;
+  }
+
   /**
    * Does the path include a ferry?
    * @return  Returns true if the path includes a ferry.
@@ -79,6 +105,14 @@ public:
     return has_ferry_;
   }
 
+  /**
+   * What the priority queues did during the last search.
+   * @return  Returns the queue counts, all 0 for algorithms that do not keep them.
+   */
+  virtual baldr::LabelQueueStats queue_stats() const {
+    return {};
+  }
+
   /**
    * Sets the functor which will track the algorithms expansion.
    *
@@ -99,6 +133,52 @@ protected:
   // for tracking the expansion of the algorithm visually
   expansion_callback_t expansion_callback_;
 
+  // Priority queue used for the adjacency lists
+  baldr::LabelQueueType queue_type_;
+
+  // Landmarks for the A* heuristics
+  std::vector<std::shared_ptr<const baldr::Landmarks>> landmarks_;
+
+  /**
+   * Get the landmarks of an access mode.
+   * @param  access_mode  Access mode of the costing.
+   * @return Returns the landmarks or nullptr if there are none for the mode.
+   */
+  const baldr::Landmarks* GetLandmarks(const uint32_t access_mode) const {
+    for (const auto& landmarks : landmarks_) {
+      if (landmarks && landmarks->access == access_mode) {
+        return landmarks.get();
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Get the landmark lengths of the nodes a path can end at when it goes to a location (the start
+   * nodes of its edges) or can start at when it comes from a location (the end nodes).
+   * @param  landmarks    Landmarks of the access mode of the costing.
+   * @param  graphreader  Graph reader.
+   * @param  location     Location with its edges.
+   * @param  from         Whether the path comes from the location.
+   * @return Returns the lengths of each node, empty if the landmarks do not know one of them.
+   */
+  std::vector<const uint16_t*> GetLandmarkTargets(const baldr::Landmarks& landmarks,
+                                                  baldr::GraphReader& graphreader,
+                                                  const valhalla::Location& location,
+                                                  const bool from) const {
+    std::vector<const uint16_t*> targets;
+    for (const auto& edge : location.path_edges()) {
+      baldr::GraphId edgeid(edge.graph_id());
+      auto node = from ? graphreader.edge_endnode(edgeid) : graphreader.edge_startnode(edgeid);
+      const uint16_t* lengths = node.Is_Valid() ? landmarks.lengths(node) : nullptr;
+      if (lengths == nullptr) {
+        return {};
+      }
+      targets.push_back(lengths);
+    }
+    return targets;
+  }
+
   /**
    * Check for path completion along the same edge. Edge ID in question
    * is along both an origin and destination and origin shows up at the
@@ -141,6 +221,7 @@ struct EdgeMetadata {
   const baldr::DirectedEdge* edge;
   baldr::GraphId edge_id;
   EdgeStatusInfo* edge_status;
+  const baldr::RoutingEdge* routing_edge;
 
   inline static EdgeMetadata make(const baldr::GraphId& node,
                                   const baldr::NodeInfo* nodeinfo,
@@ -149,13 +230,15 @@ struct EdgeMetadata {
     baldr::GraphId edge_id = {node.tileid(), node.level(), nodeinfo->edge_index()};
     EdgeStatusInfo* edge_status = edge_status_.GetPtr(edge_id, tile);
     const baldr::DirectedEdge* directededge = tile->directededge(edge_id);
-    return {directededge, edge_id, edge_status};
+    const baldr::RoutingEdge* routing_edge = tile->routing_edge(edge_id.id());
+    return {directededge, edge_id, edge_status, routing_edge};
   }
 
   inline void increment_pointers() {
     ++edge;
     ++edge_id;
     ++edge_status;
+    ++routing_edge;
   }
 };
 
@@ -0,0 +1,262 @@
+#ifndef VALHALLA_THOR_RAPTOR_H_
+#define VALHALLA_THOR_RAPTOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/tripcommon.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelarena.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+// The most transit trips a path found by the round based transit router takes
+constexpr uint32_t kMaxTransitRounds = 6;
+
+/**
+ * Round based public transit router in the manner of RAPTOR. Round k finds the earliest arrival
+ * at every transit stop using at most k trips. Each round boards the trips leaving the stops the
+ * round before improved, rides them stop by stop along the departures of the transit tiles and
+ * then walks from the stops they improved to the destination and to other stops nearby.
+ *
+ * Walking only happens at the origin, between trips and at the destination, so unlike
+ * MultiModalPathAlgorithm it does not label the whole pedestrian network at every point in time.
+ * The path with the earliest arrival wins, less a penalty per transfer taken from the transit
+ * costing so that a slightly later arrival with fewer trips is preferred.
+ */
+class RaptorPathAlgorithm : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   */
+  RaptorPathAlgorithm();
+
+  /**
+   * Destructor
+   */
+  virtual ~RaptorPathAlgorithm();
+
+  /**
+   * Form a transit path between an origin and destination location, walking to, between and
+   * from the trips.
+   * @param  origin  Origin location, must have a date_time
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return  Returns the path edges (and elapsed time/modes at end of
+   *          each edge).
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const std::shared_ptr<sif::DynamicCost>* mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+  const char* name() const override {
+    return "raptor";
+  }
+
+  /**
+   * What the priority queue of the walks did during the last search.
+   * @return  Returns the queue counts.
+   */
+  baldr::LabelQueueStats queue_stats() const override {
+    return stats_;
+  }
+
+protected:
+  // The earliest arrival at a stop and the label of the edge arriving there
+  struct arrival_t {
+    float secs;
+    uint32_t label;
+  };
+
+  // The arrival at the destination of a path taking a number of trips
+  struct candidate_t {
+    float secs;
+    uint32_t label;
+    uint32_t trips;
+  };
+
+  // Hash of a trip passing a stop
+  struct ride_hash_t {
+    size_t operator()(const std::pair<uint32_t, uint64_t>& ride) const {
+      return std::hash<uint64_t>()(ride.second) ^ (static_cast<size_t>(ride.first) << 1);
+    }
+  };
+
+  int start_tz_index_;  // Timezone at the origin
+  uint32_t start_time_; // Seconds from midnight at the origin
+  std::string origin_date_time_;
+  bool date_set_;
+  bool date_before_tile_;
+  uint32_t day_;
+  uint32_t dow_;
+  uint32_t max_transfer_distance_;
+
+  // Costing of the walks and the trips
+  std::shared_ptr<sif::DynamicCost> pc_;
+  std::shared_ptr<sif::DynamicCost> tc_;
+  std::unordered_set<uint32_t> processed_tiles_;
+
+  // Labels of the edges walked and ridden, shared by all the rounds so paths can be formed
+  std::vector<sif::MMEdgeLabel> edgelabels_;
+  LabelArena edgelabel_arena_;
+
+  // Queue and edge status of the walk being expanded
+  std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
+  EdgeStatus edgestatus_;
+  baldr::LabelQueueStats stats_;
+
+  // Destination edges and the cost from the destination to their end
+  std::unordered_map<uint64_t, sif::Cost> destinations_;
+
+  // Earliest arrival at each stop over all rounds and the trips ridden past each stop in the
+  // current round
+  std::unordered_map<uint64_t, arrival_t> arrivals_;
+  std::unordered_set<std::pair<uint32_t, uint64_t>, ride_hash_t> ridden_;
+
+  // Trips taken before the walk being expanded
+  uint32_t walk_trips_;
+
+  // The best arrival at the destination
+  candidate_t best_;
+
+  /**
+   * Walk to the origin edges and expand the walk from them.
+   * @param  graphreader  Graph reader.
+   * @param  origin       Origin location.
+   * @param  destination  Destination location.
+   * @return Returns the stops reached.
+   */
+  std::vector<baldr::GraphId> WalkFromOrigin(baldr::GraphReader& graphreader,
+                                             valhalla::Location& origin,
+                                             const valhalla::Location& destination);
+
+  /**
+   * Walk from the stops the trips of a round arrived at.
+   * @param  graphreader  Graph reader.
+   * @param  stops        Stops the round improved.
+   * @param  trips        Trips taken to arrive at the stops.
+   * @return Returns the other stops reached.
+   */
+  std::vector<baldr::GraphId> WalkFromStops(baldr::GraphReader& graphreader,
+                                            const std::vector<baldr::GraphId>& stops,
+                                            const uint32_t trips);
+
+  /**
+   * Start a walk with an empty queue.
+   * @param  min_secs  The earliest time the walk starts at.
+   * @param  trips     Trips taken before the walk.
+   */
+  void StartWalk(const float min_secs, const uint32_t trips);
+
+  /**
+   * Expand the queued walk until it is empty or reaches the destination.
+   * @param  graphreader  Graph reader.
+   * @param  reached      Stops the walk improved.
+   */
+  void Walk(baldr::GraphReader& graphreader, std::vector<baldr::GraphId>& reached);
+
+  /**
+   * Expand a walk from a node, also expanding from the nodes it transitions to.
+   * @param  graphreader      Graph reader.
+   * @param  node             Node to expand from.
+   * @param  pred_idx         Label of the edge arriving at the node.
+   * @param  from_transition  Whether the node was reached by a transition.
+   * @param  reached          Stops the walk improved, nullptr to not stop at the node.
+   */
+  void ExpandWalk(baldr::GraphReader& graphreader,
+                  const baldr::GraphId& node,
+                  const uint32_t pred_idx,
+                  const bool from_transition,
+                  std::vector<baldr::GraphId>* reached);
+
+  /**
+   * Board the trips leaving the stops improved by the last round and ride them.
+   * @param  graphreader  Graph reader.
+   * @param  stops        Stops to board at.
+   * @return Returns the stops the trips improved.
+   */
+  std::vector<baldr::GraphId> Ride(baldr::GraphReader& graphreader,
+                                   const std::vector<baldr::GraphId>& stops);
+
+  /**
+   * Ride a trip from the edge it was boarded on, adding a label per edge until the trip ends,
+   * leaves the data or reaches a stop it already reached in this round.
+   * @param  graphreader  Graph reader.
+   * @param  label        Label of the edge the trip was boarded on.
+   * @param  departure    Departure of the trip on that edge.
+   * @param  improved     Stops the trip improved.
+   */
+  void RideTrip(baldr::GraphReader& graphreader,
+                uint32_t label,
+                const baldr::TransitDeparture* departure,
+                std::vector<baldr::GraphId>& improved);
+
+  /**
+   * Keep the arrival at a stop if it is the earliest so far and can still lead to an earlier
+   * arrival at the destination.
+   * @param  stop   The stop.
+   * @param  secs   Seconds since the departure from the origin.
+   * @param  label  Label of the edge arriving at the stop.
+   * @return Returns true if the arrival was kept.
+   */
+  bool Improve(const baldr::GraphId& stop, const float secs, const uint32_t label);
+
+  /**
+   * Keep an arrival at the destination if it is better than the best so far.
+   * @param  secs   Seconds since the departure from the origin.
+   * @param  label  Label of the destination edge.
+   * @param  trips  Trips taken.
+   */
+  void Arrive(const float secs, const uint32_t label, const uint32_t trips);
+
+  /**
+   * Local time at a node for an elapsed time since the departure from the origin.
+   * @param  nodeinfo  The node.
+   * @param  secs      Seconds since the departure from the origin.
+   * @return Returns the seconds from midnight at the node.
+   */
+  uint32_t LocalTime(const baldr::NodeInfo* nodeinfo, const float secs) const;
+
+  /**
+   * Set the destination edge(s).
+   * @param   graphreader  Graph tile reader.
+   * @param   dest         Location information of the destination.
+   */
+  void SetDestination(baldr::GraphReader& graphreader, const valhalla::Location& dest);
+
+  /**
+   * Form the path from the labels.
+   * @param   dest  Label of the destination edge.
+   * @return  Returns the path info.
+   */
+  std::vector<PathInfo> FormPath(const uint32_t dest);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_RAPTOR_H_
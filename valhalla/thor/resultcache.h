@@ -0,0 +1,108 @@
+#ifndef VALHALLA_THOR_RESULTCACHE_H_
+#define VALHALLA_THOR_RESULTCACHE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Cache of the results thor computed for routes, optimized routes and matrices, keyed by the
+ * options of the request as loki correlated them. The key holds the edges the locations snapped
+ * to, the costing and its options and the times of the locations rounded down to the speed
+ * bucket, so polling clients asking for the same thing over and over are answered from the cache.
+ *
+ * Results are dropped after a maximum age so that they follow changes of the live traffic and the
+ * ones used least recently are dropped first when the cache is over its size. One cache can be
+ * shared by every worker of a process.
+ */
+class ResultCache {
+public:
+  /**
+   * Constructor
+   * @param  max_bytes  How many bytes of keys and results the cache holds.
+   * @param  max_age    Seconds after which a result is computed again, 0 keeps them until they
+   *                    are the least recently used.
+   */
+  ResultCache(const size_t max_bytes, const uint32_t max_age);
+
+  /**
+   * Get a result from the cache.
+   * @param  key     Key of the request, see Key.
+   * @param  result  Set to the result if it is in the cache.
+   * @return Returns whether the result was in the cache.
+   */
+  bool Get(const std::string& key, std::string& result);
+
+  /**
+   * Put a result in the cache, dropping the least recently used ones to make room for it.
+   * Results larger than the whole cache are not kept.
+   * @param  key     Key of the request, see Key.
+   * @param  result  The result.
+   */
+  void Put(const std::string& key, const std::string& result);
+
+  /**
+   * Get the number of results in the cache.
+   * @return Returns the number of results.
+   */
+  size_t size() const;
+
+  /**
+   * Get the bytes of keys and results in the cache.
+   * @return Returns the bytes.
+   */
+  size_t bytes() const;
+
+  /**
+   * Drop all of the results.
+   */
+  void Clear();
+
+  /**
+   * Get the key of a request. Two requests with the same key get the same result.
+   * @param  options  Request options with the costing options and the snapped locations.
+   * @return Returns the key, or an empty string if the result of the request cannot be cached.
+   */
+  static std::string Key(const Options& options);
+
+  /**
+   * Get the cache shared by the whole process. It is made the first time this is called, later
+   * calls get the same cache regardless of their size and age.
+   * @param  max_bytes  How many bytes of keys and results the cache holds, 0 means no cache.
+   * @param  max_age    Seconds after which a result is computed again.
+   * @return Returns the cache, or nullptr if max_bytes is 0.
+   */
+  static std::shared_ptr<ResultCache> Global(const size_t max_bytes, const uint32_t max_age);
+
+protected:
+  struct entry_t {
+    std::string result;
+    std::chrono::steady_clock::time_point computed;
+    std::list<std::string>::iterator used;
+  };
+
+  // Drop an entry, the caller holds the lock
+  void Drop(std::unordered_map<std::string, entry_t>::iterator entry);
+
+  mutable std::mutex mutex_;
+  size_t max_bytes_;
+  size_t bytes_;
+  std::chrono::seconds max_age_;
+  // The keys from the most to the least recently used
+  std::list<std::string> used_;
+  std::unordered_map<std::string, entry_t> results_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_RESULTCACHE_H_
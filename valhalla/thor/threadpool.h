@@ -0,0 +1,90 @@
+#ifndef VALHALLA_THOR_THREADPOOL_H_
+#define VALHALLA_THOR_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * A small pool of threads owned by a worker to run independent pieces of one
+ * request concurrently, e.g. the per-location expansions of CostMatrix. The
+ * threads are started once and wait between calls to parallel_for, the
+ * calling thread takes part in the work.
+ */
+class ThreadPool {
+public:
+  /**
+   * Constructor.
+   * @param  concurrency  Number of threads working on a parallel_for including
+   *                      the calling thread, 0 uses the hardware concurrency.
+   */
+  explicit ThreadPool(const uint32_t concurrency);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * Destructor. Stops and joins the threads.
+   */
+  ~ThreadPool();
+
+  /**
+   * Returns the number of threads working on a parallel_for, including the
+   * calling thread.
+   */
+  uint32_t concurrency() const {
+    return threads_.size() + 1;
+  }
+
+  /**
+   * Calls work(i) for every i in [0, count) and returns once all calls are
+   * done. Calls may run concurrently and in any order. If any of them throws
+   * the first exception is rethrown here after the others finished.
+   * @param  count  Number of work items.
+   * @param  work   Function doing one work item.
+   */
+  void parallel_for(const uint32_t count, const std::function<void(uint32_t)>& work);
+
+  /**
+   * Same as above but work(i, slot) is also told which thread runs it. Slots
+   * are in [0, concurrency()), the calling thread is slot 0. Two calls with
+   * the same slot never run at the same time so per slot state needs no lock.
+   * @param  count  Number of work items.
+   * @param  work   Function doing one work item.
+   */
+  void parallel_for(const uint32_t count, const std::function<void(uint32_t, uint32_t)>& work);
+
+protected:
+  // Runs work items until none are left
+  void drain(const uint32_t slot);
+
+  // Loop of each thread
+  void run(const uint32_t slot);
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+
+  // Current parallel_for, guarded by mutex_ except for next_
+  const std::function<void(uint32_t, uint32_t)>* work_;
+  uint32_t count_;
+  std::atomic<uint32_t> next_;
+  uint32_t busy_;
+  uint64_t generation_;
+  bool stop_;
+  std::exception_ptr error_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_THREADPOOL_H_
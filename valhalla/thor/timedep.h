@@ -1,6 +1,7 @@
 #ifndef VALHALLA_THOR_TIMEDEP_H_
 #define VALHALLA_THOR_TIMEDEP_H_
 
+#include <valhalla/baldr/predictedspeeds.h>
 #include <valhalla/thor/astar.h>
 
 namespace valhalla {
@@ -43,10 +44,17 @@ public:
               const sif::TravelMode mode,
               const Options& options = Options::default_instance());
 
+  const char* name() const override {
+    return "timedep_forward";
+  }
+
 protected:
   uint32_t origin_tz_index_;
   uint32_t seconds_of_week_;
 
+  // Predicted speeds decoded during the search
+  baldr::PredictedSpeedMemo speed_memo_;
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
@@ -129,16 +137,24 @@ public:
    */
   virtual void Clear();
 
+  const char* name() const override {
+    return "timedep_reverse";
+  }
+
 protected:
   uint32_t dest_tz_index_;
   uint32_t seconds_of_week_;
 
+  // Predicted speeds decoded during the search
+  baldr::PredictedSpeedMemo speed_memo_;
+
   // Access mode used by the costing method
   uint32_t access_mode_;
 
   // Vector of edge labels that support reverse search (so use the
   // bidirectional edge label structure.
   std::vector<sif::BDEdgeLabel> edgelabels_rev_;
+  LabelArena edgelabel_arena_rev_;
 
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
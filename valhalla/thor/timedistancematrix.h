@@ -2,22 +2,27 @@
 #define VALHALLA_THOR_TIMEDISTANCEMATRIX_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <valhalla/baldr/datetime.h>
 #include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/astar.h>
 #include <valhalla/thor/costmatrix.h>
+#include <valhalla/thor/depotoracle.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/threadpool.h>
 
 namespace valhalla {
 namespace thor {
@@ -60,7 +65,10 @@ public:
 
   /**
    * One to many time and distance cost matrix. Computes time and distance
-   * matrix from one origin location to many other locations.
+   * matrix from one origin location to many other locations. When the origin
+   * has a date_time the search departs then and costs the edges with their
+   * predicted speeds and time dependent restrictions at the time they are
+   * reached.
    * @param  origin        Location of the origin.
    * @param  locations     List of locations.
    * @param  graphreader   Graph reader for accessing routing graph.
@@ -77,6 +85,24 @@ public:
             const sif::TravelMode mode,
             const float max_matrix_distance);
 
+  /**
+   * One to all times and distances. Searches from the origin until the cost
+   * threshold of the mode and keeps what it costs to reach the end of every
+   * edge it settles, so that the row of the origin to any locations on them
+   * can be looked up later.
+   * @param  origin        Location of the origin.
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  mode_costing  Costing methods.
+   * @param  mode          Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return the edges reached from the origin
+   */
+  DepotReach OneToAll(const valhalla::Location& origin,
+                      baldr::GraphReader& graphreader,
+                      const std::shared_ptr<sif::DynamicCost>* mode_costing,
+                      const sif::TravelMode mode,
+                      const float max_matrix_distance);
+
   /**
    * Many to one time and distance cost matrix. Computes time and distance
    * matrix from many locations to one destination location.
@@ -115,7 +141,11 @@ public:
 
   /**
    * Forms a time distance matrix from the set of source locations
-   * to the set of target locations.
+   * to the set of target locations. Runs one to many searches from the
+   * sources, or many to one searches to the targets if there are fewer of
+   * them and no source has a date_time to depart at. With a thread pool and
+   * a thread-safe graph reader the searches run concurrently, each thread
+   * with its own TimeDistanceMatrix.
    * @param  source_location_list  List of source/origin locations.
    * @param  target_location_list  List of target/destination locations.
    * @param  graphreader           Graph reader for accessing routing graph.
@@ -138,7 +168,69 @@ public:
    */
   void Clear();
 
+  /**
+   * What the priority queue did during the searches of the last SourceToTarget,
+   * summed over all of them, or during the last OneToAll.
+   * @return  Returns the queue counts.
+   */
+  const baldr::LabelQueueStats& queue_stats() const {
+    return queue_stats_;
+  }
+
+  /**
+   * Set the priority queue used by the searches.
+   * @param  type  Queue type.
+   */
+  void set_queue_type(const baldr::LabelQueueType type) {
+    queue_type_ = type;
+  }
+
+  /**
+   * Set a thread pool to run the searches of SourceToTarget concurrently.
+   * @param  pool  Thread pool, nullptr to run them on the calling thread.
+   */
+  void set_thread_pool(ThreadPool* pool) {
+    thread_pool_ = pool;
+  }
+
+  /**
+   * Set a function that is called every so many expanded labels and throws
+   * when the matrix should be abandoned. Only the searches that run on the
+   * calling thread call it.
+   * @param  interrupt  Interrupt function, nullptr to never be interrupted.
+   */
+  void set_interrupt(const std::function<void()>* interrupt) {
+    interrupt_ = interrupt;
+  }
+
+  /**
+   * Set the seconds beyond which pairs are not searched for. The searches stop expanding past
+   * them and the pairs that take longer are returned as not found.
+   * @param  max_time  Maximum seconds of a pair, 0 to only be limited by the matrix distance.
+   */
+  void set_max_time(const float max_time) {
+    max_time_ = max_time;
+  }
+
 protected:
+  // Priority queue used for the searches
+  baldr::LabelQueueType queue_type_;
+
+  // Optional pool to run the searches of SourceToTarget on
+  ThreadPool* thread_pool_;
+
+  // Optional interrupt, the matrices of the other pool threads have none
+  const std::function<void()>* interrupt_;
+
+  // Seconds beyond which pairs are not searched for, 0 for no limit
+  float max_time_;
+
+  // Matrices running the searches of the other pool threads, kept between requests
+  std::vector<std::unique_ptr<TimeDistanceMatrix>> slot_matrices_;
+
+  // Queue counts of the searches of the last SourceToTarget
+  baldr::LabelQueueStats queue_stats_;
+
   // Number of destinations that have been found and settled (least cost path
   // computed).
   uint32_t settled_count_;
@@ -159,8 +251,8 @@ protected:
   // Vector of edge labels (requires access by index).
   std::vector<sif::EdgeLabel> edgelabels_;
 
-  // Adjacency list - approximate double bucket sort
-  std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
+  // Adjacency list - approximate double bucket sort or radix heap
+  std::shared_ptr<baldr::LabelQueue> adjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -169,6 +261,12 @@ protected:
 
   sif::TravelMode mode_;
 
+  // When the origin of the current one to many search departs, in seconds of the week and local
+  // seconds since the epoch, if it has a date_time
+  bool has_date_time_;
+  int32_t start_seconds_of_week_;
+  uint64_t start_time_;
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
@@ -219,6 +317,32 @@ protected:
    */
   void SetOriginOneToMany(baldr::GraphReader& graphreader, const valhalla::Location& origin);
 
+  /**
+   * Set when the search departs from the date_time of the origin, in the
+   * timezone at the origin. A date_time of "current" departs now.
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  origin        Origin location information.
+   */
+  void SetOriginTime(baldr::GraphReader& graphreader, const valhalla::Location& origin);
+
+  /**
+   * Get the cost of an edge entered so many seconds after the origin departs,
+   * with the predicted speed at that time if the search departs at a time.
+   * @param  edge   Directed edge.
+   * @param  tile   Tile of the edge.
+   * @param  secs   Seconds since the origin departed.
+   * @return Returns the cost and time of the edge.
+   */
+  sif::Cost EdgeCost(const baldr::DirectedEdge* edge,
+                     const baldr::GraphTile* tile,
+                     const float secs) const {
+    return has_date_time_ ? costing_->EdgeCost(edge, tile,
+                                               baldr::DateTime::normalize_seconds_of_week(
+                                                   start_seconds_of_week_ +
+                                                   static_cast<int32_t>(secs)))
+                          : costing_->EdgeCost(edge, tile);
+  }
+
   /**
    * Sets the origin for a many to one time+distance matrix computation.
    * @param  graphreader   Graph reader for accessing routing graph.
@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <tuple>
+#include <unordered_map>
+#include <memory>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
@@ -11,18 +13,29 @@
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/meili/map_matcher_factory.h>
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/proto/trip.pb.h>
 #include <valhalla/sif/costfactory.h>
+#include <valhalla/sif/costingcache.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/astar.h>
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/celloverlay.h>
+#include <valhalla/thor/chquery.h>
+#include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/isochrone.h>
+#include <valhalla/thor/depotoracle.h>
+#include <valhalla/thor/isochronecache.h>
 #include <valhalla/thor/match_result.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/raptor.h>
+#include <valhalla/thor/optimizer.h>
+#include <valhalla/thor/resultcache.h>
+#include <valhalla/thor/threadpool.h>
 #include <valhalla/thor/timedep.h>
 #include <valhalla/thor/triplegbuilder.h>
 #include <valhalla/tyr/actor.h>
@@ -37,7 +50,12 @@ void run_service(const boost::property_tree::ptree& config);
 
 class thor_worker_t : public service_worker_t {
 public:
-  enum SOURCE_TO_TARGET_ALGORITHM { SELECT_OPTIMAL = 0, COST_MATRIX = 1, TIME_DISTANCE_MATRIX = 2 };
+  enum SOURCE_TO_TARGET_ALGORITHM {
+    SELECT_OPTIMAL = 0,
+    COST_MATRIX = 1,
+    TIME_DISTANCE_MATRIX = 2,
+    BUCKET_MATRIX = 3
+  };
   thor_worker_t(const boost::property_tree::ptree& config,
                 const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
   virtual ~thor_worker_t();
@@ -50,6 +68,7 @@ public:
 
   void route(Api& request);
   std::string matrix(Api& request);
+  void fill_matrix(Api& request);
   void optimized_route(Api& request);
   std::string isochrones(Api& request);
   void trace_route(Api& request);
@@ -57,16 +76,43 @@ public:
   std::string expansion(Api& request);
 
 protected:
+  // The path algorithms and costing of another thread finding the legs of a route
+  struct leg_algorithms_t {
+    AStarPathAlgorithm astar;
+    BidirectionalAStar bidir_astar;
+    sif::cost_ptr_t mode_costing[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
+  };
+
   std::vector<std::vector<thor::PathInfo>> get_path(PathAlgorithm* path_algorithm,
                                                     Location& origin,
                                                     Location& destination,
                                                     const std::string& costing,
-                                                    const Options& options);
+                                                    const Options& options,
+                                                    leg_algorithms_t* algorithms = nullptr,
+                                                    SearchStatistics* statistics = nullptr);
+  std::vector<std::vector<thor::PathInfo>> search_path(PathAlgorithm* path_algorithm,
+                                                       Location& origin,
+                                                       Location& destination,
+                                                       const std::string& costing,
+                                                       const Options& options,
+                                                       leg_algorithms_t* algorithms,
+                                                       SearchStatistics* statistics);
+  std::vector<std::vector<std::vector<thor::PathInfo>>> get_legs(Api& api,
+                                                                 const std::string& costing);
+  bool use_contraction_hierarchy(const Options& options) const;
+  std::vector<thor::TimeDistance> compute_matrix(Api& request);
+  std::string batch_isochrones(Api& request,
+                               const std::string& costing,
+                               const std::vector<float>& contours,
+                               const std::unordered_map<float, std::string>& colors);
   void log_admin(const TripLeg&);
   sif::cost_ptr_t get_costing(const Costing costing, const Options& options);
+  baldr::LabelQueueType get_queue_type(const std::string& costing) const;
   thor::PathAlgorithm* get_path_algorithm(const std::string& routetype,
                                           const Location& origin,
-                                          const Location& destination);
+                                          const Location& destination,
+                                          const Options& options,
+                                          leg_algorithms_t* algorithms = nullptr);
   void route_match(Api& request);
   std::vector<std::tuple<float, float, std::vector<thor::MatchResult>>> map_match(Api& request);
   void path_map_match(const std::vector<meili::MatchResult>& match_results,
@@ -74,6 +120,13 @@ protected:
                       TripLeg& leg,
                       std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>>&
                           route_discontinuities);
+  void path_columns(const std::vector<PathInfo>::const_iterator path_begin,
+                    const std::vector<PathInfo>::const_iterator path_end,
+                    const float start_pct,
+                    const float end_pct,
+                    const valhalla::Location& origin,
+                    const double distance_scale,
+                    TraceAttributes& columns);
   void path_arrive_by(Api& api, const std::string& costing);
   void path_depart_at(Api& api, const std::string& costing);
 
@@ -81,6 +134,19 @@ protected:
   void parse_measurements(const Api& request);
   std::string parse_costing(const Api& request);
   void parse_filter_attributes(const Api& request, bool is_strict_filter = false);
+  // Tile counts of the reader when a search started, to tell which tiles the search fetched
+  struct search_start_t {
+    uint64_t tiles_fetched;
+    uint64_t tiles_missed;
+  };
+  bool record_statistics(const Options& options) const;
+  search_start_t start_search() const;
+  void end_search(SearchStatistics* statistics,
+                  const char* algorithm,
+                  const baldr::LabelQueueStats& queue,
+                  const search_start_t& start) const;
+  void log_statistics(const Api& request) const;
+  void restore_result(Api& request, const std::string& cached) const;
   static std::string offset_date(baldr::GraphReader& reader,
                                  const std::string& in_dt,
                                  const baldr::GraphId& in_edge,
@@ -89,19 +155,49 @@ protected:
   sif::TravelMode mode;
   std::vector<meili::Measurement> trace;
   sif::CostFactory<sif::DynamicCost> factory;
+  std::shared_ptr<sif::EdgeCostCache> edge_cost_cache;
+  sif::CostingCache costing_cache;
+  sif::TunedHierarchyLimits hierarchy_limits;
   sif::cost_ptr_t mode_costing[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
   // Path algorithms (TODO - perhaps use a map?))
   AStarPathAlgorithm astar;
   BidirectionalAStar bidir_astar;
+  CHQuery ch_query;
+  std::unordered_map<int, std::shared_ptr<const baldr::CHGraph>> ch_graphs;
+  std::vector<std::shared_ptr<const baldr::Landmarks>> landmarks;
+  CellOverlayQuery overlay_query;
+  std::shared_ptr<const baldr::CellPartition> cell_partition;
+  std::shared_ptr<CellOverlayCache> cell_overlays;
   MultiModalPathAlgorithm multi_modal_astar;
+  RaptorPathAlgorithm raptor;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
   Isochrone isochrone_gen;
+  // The isochrones of the other threads of a batch, the first also expands to the locations
+  // while isochrone_gen expands from them
+  std::vector<std::unique_ptr<Isochrone>> batch_isochrone_gens;
+  // The path algorithms of the other threads finding the legs of a route
+  std::vector<std::unique_ptr<leg_algorithms_t>> leg_algorithms;
+  IsochroneCache isochrone_cache;
+  std::shared_ptr<ResultCache> result_cache;
+  std::shared_ptr<DepotOracle> depot_oracle;
+  // The version of the tile extract everything cached above was found on
+  uint64_t tile_extract_version;
   std::shared_ptr<meili::MapMatcher> matcher;
   float long_request;
+  bool log_search_statistics;
+  service_metrics_t metrics;
+  admission_t admission;
   float max_timedep_distance;
+  bool timedep_bidirectional;
+  bool transit_raptor;
   std::unordered_map<std::string, float> max_matrix_distance;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
+  std::unique_ptr<ThreadPool> matrix_pool;
+  OptimizerMethod optimizer_method;
+  uint32_t optimizer_restarts;
+  baldr::LabelQueueType default_queue_type;
+  std::unordered_map<std::string, baldr::LabelQueueType> queue_types;
   meili::MapMatcherFactory matcher_factory;
   std::shared_ptr<baldr::GraphReader> reader;
   AttributesController controller;
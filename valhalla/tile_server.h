@@ -10,7 +10,15 @@ namespace valhalla {
 class test_tile_server_t {
 public:
   static const std::string server_url;
-  static void start(const std::string& tile_source_dir, zmq::context_t& context);
+
+  /**
+   * Starts serving tiles in the background, the way a tile_url server would
+   * @param tile_source   Tile directory or tile extract to serve the tiles from
+   * @param context       Zmq context the server, proxy and workers talk over
+   * @param worker_count  How many requests can be worked on at the same time
+   */
+  static void
+  start(const std::string& tile_source, zmq::context_t& context, unsigned int worker_count = 1);
 };
 
 } // namespace valhalla
\ No newline at end of file
@@ -2,16 +2,56 @@
 #define VALHALLA_TYR_ACTOR_H_
 
 #include <boost/property_tree/ptree.hpp>
+#include <functional>
 #include <memory>
+#include <string>
 #include <unordered_map>
 
 namespace valhalla {
+class Api;
 namespace tyr {
 
+#ifdef HAVE_HTTP
+/**
+ * Serve requests from the http server with one worker that runs loki, thor and odin on the same
+ * request, instead of a worker per stage that each parse the request and serialize it for the
+ * next one over zmq.
+ * @param config  The config, with the httpd and loki service endpoints.
+ */
+void run_service(const boost::property_tree::ptree& config);
+#endif
+
 class actor_t {
 public:
   actor_t(const boost::property_tree::ptree& config, bool auto_cleanup = false);
   void cleanup();
+
+  /**
+   * Run every stage an already parsed request goes through.
+   * @param request    The request, its options say what action it is.
+   * @param interrupt  Called periodically, throws when the work should stop.
+   * @return Returns the serialized response.
+   */
+  std::string act(Api& request, const std::function<void()>& interrupt = []() -> void {});
+
+  /**
+   * Run every stage an already parsed request goes through but leave the results in the request
+   * instead of serializing them, so embedding callers read the protobuf without any json. Routes,
+   * optimized routes and map matched routes fill the trip and directions, matrices the matrix.
+   * Other actions have no protobuf output and throw.
+   * @param request    The request, its options say what action it is.
+   * @param interrupt  Called periodically, throws when the work should stop.
+   */
+  void compute(Api& request, const std::function<void()>& interrupt = []() -> void {});
+
+  /**
+   * Get the url of the shard that serves a request when the tiles are sharded and it is not the
+   * shard of this actor, see loki.shards.
+   * @param request  The request.
+   * @return Returns the url or an empty string if this actor serves the request.
+   */
+  std::string shard_url(const Api& request) const;
+
   std::string route(const std::string& request_str,
                     const std::function<void()>& interrupt = []() -> void {});
   std::string locate(const std::string& request_str,
@@ -0,0 +1,61 @@
+#ifndef VALHALLA_TYR_BATCH_H_
+#define VALHALLA_TYR_BATCH_H_
+
+#include <boost/property_tree/ptree.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace tyr {
+
+/**
+ * What came of one request of a batch.
+ */
+struct batch_result_t {
+  std::string response; // The json response, or the json error if the request failed
+  double seconds;       // How long the request took
+  bool ok;              // Whether the request succeeded
+};
+
+/**
+ * Get the json requests of a file with one per line, either the json alone or the -j '<json>'
+ * lines of test_requests. Lines without a json object are skipped.
+ * @param  file_name  The file.
+ * @return Returns the requests in the order of the file.
+ */
+std::vector<std::string> read_batch(const std::string& file_name);
+
+/**
+ * Run requests of one action on several threads of this process, each with an actor of its own.
+ * The actors share one tile cache instead of each loading the tiles, the sharded cache unless the
+ * config already shares a thread safe one (mjolnir.global_synchronized_cache). A request that
+ * fails gets its error as the response so that it does not stop the others.
+ * @param  config    The config.
+ * @param  action    The action of every request.
+ * @param  requests  The json requests.
+ * @param  threads   How many requests run at once, 0 uses all cores.
+ * @return Returns the result of each request in the order of the requests.
+ */
+std::vector<batch_result_t> run_batch(const boost::property_tree::ptree& config,
+                                      const Options::Action action,
+                                      const std::vector<std::string>& requests,
+                                      unsigned int threads = 0);
+
+/**
+ * Write the results of a batch, the responses a line each and the timings as csv with the index
+ * of the request, whether it succeeded and its milliseconds.
+ * @param  results    The results in the order of the requests.
+ * @param  responses  Where to write the responses, nothing is written if it is null.
+ * @param  timings    Where to write the timings, nothing is written if it is null.
+ */
+void write_batch(const std::vector<batch_result_t>& results,
+                 std::ostream* responses,
+                 std::ostream* timings);
+
+} // namespace tyr
+} // namespace valhalla
+
+#endif // VALHALLA_TYR_BATCH_H_
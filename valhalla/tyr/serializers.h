@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <list>
+#include <ostream>
+#include <streambuf>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -23,18 +25,69 @@
 namespace valhalla {
 namespace tyr {
 
+/**
+ * An output stream that writes into a buffer kept per thread and reused from one response to the
+ * next, so serializing a large response doesn't regrow a buffer from nothing every time. Only one
+ * should be alive per thread at a time since they all write to the same buffer.
+ */
+class pooled_ostream : private std::streambuf, public std::ostream {
+public:
+  pooled_ostream() : std::ostream(this), buffer_(pool()) {
+    buffer_.clear();
+  }
+  ~pooled_ostream() {
+    // dont hang on to the memory of an unusually large response forever
+    if (buffer_.capacity() > kMaxPooledBytes) {
+      std::string().swap(buffer_);
+    }
+  }
+  std::string str() const {
+    return buffer_;
+  }
+
+protected:
+  using traits = std::streambuf::traits_type;
+  std::streambuf::int_type overflow(std::streambuf::int_type c) override {
+    if (traits::eq_int_type(c, traits::eof())) {
+      return traits::not_eof(c);
+    }
+    buffer_.push_back(traits::to_char_type(c));
+    return c;
+  }
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    buffer_.append(s, n);
+    return n;
+  }
+
+private:
+  static constexpr size_t kMaxPooledBytes = 16 * 1024 * 1024;
+  static std::string& pool() {
+    static thread_local std::string buffer;
+    return buffer;
+  }
+  std::string& buffer_;
+};
+
 /**
  * Turn path and directions into a route that one can follow
  */
 std::string serializeDirections(Api& request);
 
 /**
- * Turn a time distance matrix into json that one can look up location pair results from
+ * Turn a time distance matrix into json that one can look up location pair results from, or into
+ * the matrix of the request when it wants protobuf
  */
-std::string serializeMatrix(const Api& request,
+std::string serializeMatrix(Api& request,
                             const std::vector<thor::TimeDistance>& time_distances,
                             double distance_scale);
 
+/**
+ * Put a time distance matrix into the matrix of the request, for callers that read the protobuf
+ */
+void fillMatrix(Api& request,
+                const std::vector<thor::TimeDistance>& time_distances,
+                double distance_scale);
+
 /**
  * Turn grid data contours into geojson
  *
@@ -49,6 +102,34 @@ serializeIsochrones(const Api& request,
                     const std::unordered_map<float, std::string>& colors = {},
                     bool show_locations = false);
 
+/**
+ * Turn the contours of a batch of isochrones, one per location, into a geojson feature
+ * collection per location
+ *
+ * @param grid_contours    the contours generated from the grid of each location
+ * @param colors           the #ABC123 hex string color used in geojson fill color
+ */
+template <class coord_t>
+std::string serializeIsochrones(
+    const Api& request,
+    const std::vector<typename midgard::GriddedData<coord_t>::contours_t>& grid_contours,
+    bool polygons = true,
+    const std::unordered_map<float, std::string>& colors = {},
+    bool show_locations = false);
+
+/**
+ * Turn the contours of the time from the locations and to them into a geojson feature
+ * collection for each direction
+ */
+template <class coord_t>
+std::string
+serializeIsochrones(const Api& request,
+                    const typename midgard::GriddedData<coord_t>::contours_t& from_contours,
+                    const typename midgard::GriddedData<coord_t>::contours_t& to_contours,
+                    bool polygons = true,
+                    const std::unordered_map<float, std::string>& colors = {},
+                    bool show_locations = false);
+
 /**
  * Turn heights and ranges into a height response
  *
@@ -60,6 +141,18 @@ std::string serializeHeight(const Api& request,
                             const std::vector<double>& heights,
                             const std::vector<float>& ranges = {});
 
+/**
+ * Turn the heights and ranges of the many shapes of a request into a height response
+ *
+ * @param request  The original request with its height shapes
+ * @param heights  The actual height at each point of each shape
+ * @param ranges   The distances between the points of each shape. If a shape has none no ranges
+ *                 are serialized for it
+ */
+std::string serializeHeights(const Api& request,
+                             const std::vector<std::vector<double>>& heights,
+                             const std::vector<std::vector<float>>& ranges);
+
 /**
  * Turn some correlated points on the graph into info about those locations
  *
@@ -87,17 +180,26 @@ std::string serializeTransitAvailable(const Api& request,
                                       const std::unordered_set<baldr::Location>& found);
 
 /**
- * Turn trip paths and the match results of each into attributes based on the filter specified
+ * Turn trip paths and the match results of each into attributes based on the filter specified. A
+ * columnar request has the columns thor filled out instead, which are written as an array per
+ * attribute or as the protobuf of the request
  *
  * @param request     The original request
  * @param controller  The filter for what attributes should be serialized
  * @param results     The vector of trip paths and match results for each match found
  */
 std::string serializeTraceAttributes(
-    const Api& request,
+    Api& request,
     const thor::AttributesController& controller,
     std::vector<std::tuple<float, float, std::vector<thor::MatchResult>>>& results);
 
+/**
+ * Turn the work the searches of a request did into an array with an object per search
+ *
+ * @param request  The request with the statistics thor filled out
+ */
+baldr::json::ArrayPtr serializeStatistics(const Api& request);
+
 } // namespace tyr
 } // namespace valhalla
 
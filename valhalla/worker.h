@@ -1,9 +1,16 @@
 #ifndef __VALHALLA_SERVICE_H__
 #define __VALHALLA_SERVICE_H__
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+
+#include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/baldr/json.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/midgard/metrics.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/valhalla.h>
 
@@ -28,6 +35,13 @@ const std::string& Options_Units_Enum_Name(const Options::Units unit);
 bool FilterAction_Enum_Parse(const std::string& action, FilterAction* a);
 const std::string& FilterAction_Enum_Name(const FilterAction action);
 bool DirectionsType_Enum_Parse(const std::string& dtype, DirectionsType* t);
+bool Options_MatrixAlgorithm_Enum_Parse(const std::string& algorithm,
+                                        Options::MatrixAlgorithm* a);
+bool Options_OptimizerMethod_Enum_Parse(const std::string& method, Options::OptimizerMethod* m);
+bool Options_IsochroneDirection_Enum_Parse(const std::string& direction,
+                                           Options::IsochroneDirection* d);
+bool Options_InstructionType_Enum_Parse(const std::string& type, Options::InstructionType* t);
+bool Options_HeightEncoding_Enum_Parse(const std::string& encoding, Options::HeightEncoding* e);
 bool PreferredSide_Enum_Parse(const std::string& pside, valhalla::Location::PreferredSide* p);
 
 const std::unordered_map<unsigned, std::string>
@@ -59,6 +73,8 @@ const std::unordered_map<unsigned, std::string>
                 {134, "Failed to parse shape"},
                 {135, "Failed to parse trace"},
                 {136, "durations size not compatible with trace size"},
+                {137, "Invalid max_time, it must be a positive number of seconds"},
+                {138, "Failed to parse avoid polygon, it needs a ring of at least 3 [lon, lat]"},
 
                 {140, "Action does not support multimodal costing"},
                 {141, "Arrive by for multimodal not implemented yet"},
@@ -81,10 +97,18 @@ const std::unordered_map<unsigned, std::string>
                 {162, "Date and time is invalid.  Format is YYYY-MM-DDTHH:MM"},
                 {163, "Invalid date_type"},
                 {164, "Invalid shape format"},
+                {165, "Invalid matrix algorithm"},
+                {166, "Invalid optimizer"},
+                {167, "Format is not supported by this action"},
+                {168, "Invalid instruction type"},
+                {169, "Invalid timeout, it must be a positive number of seconds"},
 
                 {170, "Locations are in unconnected regions. Go check/edit the map at osm.org"},
                 {171, "No suitable edges near location"},
 
+                {180, "The request took longer than its timeout and was abandoned"},
+                {181, "Too many expensive requests at once, try again later"},
+
                 {199, "Unknown"},
 
                 // odin project 2xx
@@ -114,6 +138,8 @@ const std::unordered_map<unsigned, std::string>
                 {312, "Insufficiently specified required parameter 'shape' or 'encoded_polyline'"},
                 {313, "'resample_distance' must be >= "},
                 {314, "Too many shape points"},
+                {315, "Failed to parse shapes, each one needs a 'shape' or 'encoded_polyline'"},
+                {316, "Invalid height_encoding, it must be 'array' or 'polyline'"},
 
                 {399, "Unknown"},
 
@@ -181,8 +207,136 @@ prime_server::worker_t::result_t to_response_json(const std::string& json,
 prime_server::worker_t::result_t to_response_xml(const std::string& xml,
                                                  prime_server::http_request_info_t& request_info,
                                                  const Api& options);
+prime_server::worker_t::result_t to_response_pbf(const std::string& pbf,
+                                                 prime_server::http_request_info_t& request_info,
+                                                 const Api& options);
+// A response in the format the request asked for
+prime_server::worker_t::result_t to_response(const std::string& response,
+                                             prime_server::http_request_info_t& request_info,
+                                             const Api& options);
+// Send the client to the same path and query at another url, keeping the method and body
+prime_server::worker_t::result_t to_redirect(const std::string& url,
+                                             const prime_server::http_request_t& request,
+                                             prime_server::http_request_info_t& request_info);
 #endif
 
+/**
+ * Estimate how much work a request is in kilometers searched, as the crow flies: the legs of a
+ * route, the length of a trace, the extent of the locations for every search of a matrix and the
+ * reach of the longest contour (at 60km/h) for every location of an isochrone
+ * @param  options  the request
+ * @return the estimate, 0 for the actions that do not search the graph
+ */
+float estimate_cost(const Options& options);
+
+/**
+ * Admission of the requests of a stage into lanes by their estimated cost. Requests that cost up
+ * to httpd.service.batch_cost are interactive and always get in. The others are batch work, only
+ * httpd.service.batch_concurrency of them are worked on by the stage in the process at once and
+ * up to httpd.service.batch_queue more wait for a turn, so batch work never takes all of the
+ * workers from the interactive requests. A batch_cost of 0 admits everything.
+ */
+class admission_t {
+public:
+  struct lane_t;
+
+  // The place of a request in its lane, given back when the ticket goes away
+  class ticket_t {
+  public:
+    explicit ticket_t(lane_t* lane = nullptr) : lane(lane) {
+    }
+    ticket_t(ticket_t&& other) : lane(other.lane) {
+      other.lane = nullptr;
+    }
+    ticket_t(const ticket_t&) = delete;
+    ticket_t& operator=(const ticket_t&) = delete;
+    ~ticket_t();
+
+  protected:
+    lane_t* lane;
+  };
+
+  /**
+   * Constructor
+   * @param  config   the config of the service
+   * @param  service  the stage, the workers of a stage in the process share its lane
+   */
+  admission_t(const boost::property_tree::ptree& config, const std::string& service);
+
+  /**
+   * Admit a request, waiting for a turn if it is batch work and the lane is busy. The first stage
+   * estimates the cost of the request, the others take the estimate it puts in the request.
+   * @param  request    the request
+   * @param  interrupt  called while waiting, throws when the request should be abandoned
+   * @return the ticket to hold while working on the request
+   * @throws valhalla_exception_t 181 when the lane and its queue are full, 180 when the request
+   *         waited past its deadline
+   */
+  ticket_t admit(Api& request, const std::function<void()>& interrupt);
+
+protected:
+  float batch_cost;
+  lane_t* lane;
+  midgard::metrics::Counter& refused;
+  midgard::metrics::Histogram& wait;
+};
+
+// The metrics a stage of the service keeps about the requests it works on
+class service_metrics_t {
+public:
+  /**
+   * Constructor
+   * @param  service  the label of the metrics of this stage, loki, thor, odin or tyr when fused
+   */
+  explicit service_metrics_t(const std::string& service);
+
+  /**
+   * Count a finished request by its action
+   * @param  request  the request
+   * @param  seconds  how long this stage worked on it
+   */
+  void request(const Api& request, double seconds);
+
+  /**
+   * Count how long a request waited between the stage before passing it on and this stage
+   * picking it up. Requests that were not passed on by another stage are not counted. The stamp
+   * is cleared so it does not end up in the response.
+   * @param  request  the request
+   */
+  void queue_wait(Api& request);
+
+  /**
+   * Count how long it took to make the costing of a request
+   * @param  seconds  the time taken
+   */
+  void costing(double seconds);
+
+  /**
+   * Count a lookup of the result of a request in the result cache
+   * @param  hit  whether the result was in the cache
+   */
+  void cache(bool hit);
+
+protected:
+  std::string service;
+  std::unordered_map<int, midgard::metrics::Histogram*> durations;
+  midgard::metrics::Histogram& wait;
+  midgard::metrics::Histogram& costing_construction;
+  midgard::metrics::Counter& cache_hits;
+  midgard::metrics::Counter& cache_misses;
+};
+
+// The clock of the stamps and deadlines requests carry from one stage to the next
+uint64_t microseconds_since_epoch();
+
+/**
+ * Serialize a request to pass it on to the next stage, stamped with when that happened so the
+ * next stage can tell how long it waited
+ * @param  request  the request
+ * @return the serialized request
+ */
+std::string forward(Api& request);
+
 class service_worker_t {
 public:
   service_worker_t();
@@ -220,8 +374,31 @@ public:
    */
   virtual void set_interrupt(const std::function<void()>& interrupt) final;
 
+  /**
+   * Abandon the work on the request once its deadline passed. From then on the interrupt throws
+   * 180 as well, the long loops of every stage call it every so many iterations. A request that
+   * is picked up after its deadline is not started at all.
+   * @param  deadline  microseconds since the epoch, 0 for no deadline
+   */
+  void set_deadline(const uint64_t deadline);
+
 protected:
+  /**
+   * Get an empty request for the next job. It is allocated on an arena which keeps the memory of
+   * the last job, so building up big trips and directions does not go to the heap for every
+   * message. The request is only valid until this is called again.
+   * @return Returns the empty request.
+   */
+  Api& new_request();
+
+  // checks the interrupt of the server and the deadline of the request, never null
   const std::function<void()>* interrupt;
+
+private:
+  struct arena_t;
+  std::shared_ptr<arena_t> arena;
+  struct interrupt_t;
+  std::shared_ptr<interrupt_t> interrupts;
 };
 } // namespace valhalla
 